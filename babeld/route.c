@@ -161,6 +161,30 @@ resize_route_table(int new_slots)
     return 1;
 }
 
+static void
+link_neighbour_route(struct babel_route *route)
+{
+    struct neighbour *neigh = route->neigh;
+
+    route->neigh_prev = NULL;
+    route->neigh_next = neigh->routes;
+    if(neigh->routes)
+        neigh->routes->neigh_prev = route;
+    neigh->routes = route;
+}
+
+static void
+unlink_neighbour_route(struct babel_route *route)
+{
+    if(route->neigh_prev)
+        route->neigh_prev->neigh_next = route->neigh_next;
+    else
+        route->neigh->routes = route->neigh_next;
+    if(route->neigh_next)
+        route->neigh_next->neigh_prev = route->neigh_prev;
+    route->neigh_next = route->neigh_prev = NULL;
+}
+
 /* Insert a route into the table.  If successful, retains the route.
    On failure, caller must free the route. */
 static struct babel_route *
@@ -193,6 +217,7 @@ insert_route(struct babel_route *route)
         route->next = NULL;
     }
 
+    link_neighbour_route(route);
     return route;
 }
 
@@ -212,6 +237,8 @@ flush_route(struct babel_route *route)
         lost = 1;
     }
 
+    unlink_neighbour_route(route);
+
     i = find_route_slot(route->src->prefix, route->src->plen, NULL);
     assert(i >= 0 && i < route_slots);
 
@@ -270,23 +297,8 @@ flush_all_routes(void)
 void
 flush_neighbour_routes(struct neighbour *neigh)
 {
-    int i;
-
-    i = 0;
-    while(i < route_slots) {
-        struct babel_route *r;
-        r = routes[i];
-        while(r) {
-            if(r->neigh == neigh) {
-                flush_route(r);
-                goto again;
-            }
-            r = r->next;
-        }
-        i++;
-    again:
-        ;
-    }
+    while(neigh->routes)
+        flush_route(neigh->routes);
 }
 
 void
@@ -751,16 +763,10 @@ update_neighbour_metric(struct neighbour *neigh, int changed)
 {
 
     if(changed) {
-        int i;
-
-        for(i = 0; i < route_slots; i++) {
-            struct babel_route *r = routes[i];
-            while(r) {
-                if(r->neigh == neigh)
-                    update_route_metric(r);
-                r = r->next;
-            }
-        }
+        struct babel_route *r;
+
+        for(r = neigh->routes; r; r = r->neigh_next)
+            update_route_metric(r);
     }
 }
 
@@ -987,20 +993,14 @@ consider_route(struct babel_route *route)
 void
 retract_neighbour_routes(struct neighbour *neigh)
 {
-    int i;
+    struct babel_route *r;
 
-    for(i = 0; i < route_slots; i++) {
-        struct babel_route *r = routes[i];
-        while(r) {
-            if(r->neigh == neigh) {
-                if(r->refmetric != INFINITY) {
-                    unsigned short oldmetric = route_metric(r);
-                    retract_route(r);
-                    if(oldmetric != INFINITY)
-                        route_changed(r, r->src, oldmetric);
-                }
-            }
-            r = r->next;
+    for(r = neigh->routes; r; r = r->neigh_next) {
+        if(r->refmetric != INFINITY) {
+            unsigned short oldmetric = route_metric(r);
+            retract_route(r);
+            if(oldmetric != INFINITY)
+                route_changed(r, r->src, oldmetric);
         }
     }
 }
@@ -51,6 +51,8 @@ struct babel_route {
     short installed;
     unsigned char channels[DIVERSITY_HOPS];
     struct babel_route *next;
+    /* Other routes through the same neighbour. */
+    struct babel_route *neigh_next, *neigh_prev;
 };
 
 struct route_stream;
@@ -64,6 +64,15 @@ struct in6_addr zero_addr;
 /** BFD profiles list. */
 struct bfdproflist bplist;
 
+/*
+ * Direct mapped cache in front of the discriminator hash, for the lookup
+ * done on each received control packet of an established session: a
+ * single probe, discriminators being random.
+ */
+#define BFD_ID_CACHE_SIZE 8192
+#define BFD_ID_CACHE_SLOT(id) ((id) & (BFD_ID_CACHE_SIZE - 1))
+static struct bfd_session *bfd_id_cache[BFD_ID_CACHE_SIZE];
+
 /*
  * Functions
  */
@@ -587,9 +596,17 @@ static struct bfd_session *bfd_find_disc(struct sockaddr_any *sa,
 {
 	struct bfd_session *bs;
 
-	bs = bfd_id_lookup(ldisc);
-	if (bs == NULL)
-		return NULL;
+	bs = bfd_id_cache[BFD_ID_CACHE_SLOT(ldisc)];
+	if (bs && bs->discrs.my_discr == ldisc)
+		bglobal.lookup_id_cache++;
+	else {
+		bs = bfd_id_lookup(ldisc);
+		if (bs == NULL)
+			return NULL;
+
+		bglobal.lookup_id_hash++;
+		bfd_id_cache[BFD_ID_CACHE_SLOT(ldisc)] = bs;
+	}
 
 	switch (bs->key.family) {
 	case AF_INET:
@@ -616,10 +633,15 @@ struct bfd_session *ptm_bfd_sess_find(struct bfd_pkt *cp,
 {
 	struct vrf *vrf;
 	struct bfd_key key;
+	struct bfd_session *bs;
 
 	/* Find our session using the ID signaled by the remote end. */
-	if (cp->discrs.remote_discr)
-		return bfd_find_disc(peer, ntohl(cp->discrs.remote_discr));
+	if (cp->discrs.remote_discr) {
+		bs = bfd_find_disc(peer, ntohl(cp->discrs.remote_discr));
+		if (bs == NULL)
+			bglobal.lookup_miss++;
+		return bs;
+	}
 
 	/* Search for session without using discriminator. */
 	vrf = vrf_lookup_by_id(vrfid);
@@ -628,7 +650,12 @@ struct bfd_session *ptm_bfd_sess_find(struct bfd_pkt *cp,
 		    vrf ? vrf->name : VRF_DEFAULT_NAME);
 
 	/* XXX maybe remoteDiscr should be checked for remoteHeard cases. */
-	return bfd_key_lookup(key);
+	bs = bfd_key_lookup(key);
+	if (bs)
+		bglobal.lookup_key++;
+	else
+		bglobal.lookup_miss++;
+	return bs;
 }
 
 void bfd_xmt_cb(struct thread *t)
@@ -1699,11 +1726,15 @@ struct bfd_session *bfd_key_lookup(struct bfd_key key)
  */
 struct bfd_session *bfd_id_delete(uint32_t id)
 {
-	struct bfd_session bs;
+	struct bfd_session bs, *bsp;
 
 	bs.discrs.my_discr = id;
 
-	return hash_release(bfd_id_hash, &bs);
+	bsp = hash_release(bfd_id_hash, &bs);
+	if (bsp && bfd_id_cache[BFD_ID_CACHE_SLOT(id)] == bsp)
+		bfd_id_cache[BFD_ID_CACHE_SLOT(id)] = NULL;
+
+	return bsp;
 }
 
 struct bfd_session *bfd_key_delete(struct bfd_key key)
@@ -501,6 +501,12 @@ struct bfd_global {
 	 * - Network system call failures.
 	 */
 	bool debug_network;
+
+	/* Received control packets by session lookup done to match them. */
+	uint64_t lookup_id_cache;
+	uint64_t lookup_id_hash;
+	uint64_t lookup_key;
+	uint64_t lookup_miss;
 };
 
 extern struct bfd_global bglobal;
@@ -786,29 +786,22 @@ static void cp_debug(bool mhop, struct sockaddr_any *peer,
 		   mhop ? "yes" : "no", peerstr, localstr, portstr, vrfstr);
 }
 
-void bfd_recv_cb(struct thread *t)
+/*
+ * Reads and processes one control packet. Returns false if there was
+ * nothing to read.
+ */
+static bool bfd_recv_ctrl(struct bfd_vrf_global *bvrf, int sd)
 {
-	int sd = THREAD_FD(t);
 	struct bfd_session *bfd;
 	struct bfd_pkt *cp;
 	bool is_mhop;
-	ssize_t mlen = 0;
+	ssize_t mlen = -1;
 	uint8_t ttl = 0;
 	vrf_id_t vrfid;
 	ifindex_t ifindex = IFINDEX_INTERNAL;
 	struct sockaddr_any local, peer;
 	uint8_t msgbuf[1516];
 	struct interface *ifp = NULL;
-	struct bfd_vrf_global *bvrf = THREAD_ARG(t);
-
-	/* Schedule next read. */
-	bfd_sd_reschedule(bvrf, sd);
-
-	/* Handle echo packets. */
-	if (sd == bvrf->bg_echo || sd == bvrf->bg_echov6) {
-		ptm_bfd_process_echo_pkt(bvrf, sd);
-		return;
-	}
 
 	/* Sanitize input/output. */
 	memset(&local, 0, sizeof(local));
@@ -825,6 +818,8 @@ void bfd_recv_cb(struct thread *t)
 		mlen = bfd_recv_ipv6(sd, msgbuf, sizeof(msgbuf), &ttl, &ifindex,
 				     &local, &peer);
 	}
+	if (mlen == -1)
+		return false;
 
 	/*
 	 * With netns backend, we have a separate socket in each VRF. It means
@@ -845,14 +840,14 @@ void bfd_recv_cb(struct thread *t)
 	if (mlen < BFD_PKT_LEN) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "too small (%ld bytes)", mlen);
-		return;
+		return true;
 	}
 
 	/* Validate single hop packet TTL. */
 	if ((!is_mhop) && (ttl != BFD_TTL_VAL)) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "invalid TTL: %d expected %d", ttl, BFD_TTL_VAL);
-		return;
+		return true;
 	}
 
 	/*
@@ -866,24 +861,24 @@ void bfd_recv_cb(struct thread *t)
 	if (BFD_GETVER(cp->diag) != BFD_VERSION) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "bad version %d", BFD_GETVER(cp->diag));
-		return;
+		return true;
 	}
 
 	if (cp->detect_mult == 0) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "detect multiplier set to zero");
-		return;
+		return true;
 	}
 
 	if ((cp->len < BFD_PKT_LEN) || (cp->len > mlen)) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid, "too small");
-		return;
+		return true;
 	}
 
 	if (cp->discrs.my_discr == 0) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "'my discriminator' is zero");
-		return;
+		return true;
 	}
 
 	/* Find the session that this packet belongs. */
@@ -891,7 +886,7 @@ void bfd_recv_cb(struct thread *t)
 	if (bfd == NULL) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "no session found");
-		return;
+		return true;
 	}
 	/*
 	 * We may have a situation where received packet is on wrong vrf
@@ -899,7 +894,7 @@ void bfd_recv_cb(struct thread *t)
 	if (bfd && bfd->vrf && bfd->vrf != bvrf->vrf) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "wrong vrfid.");
-		return;
+		return true;
 	}
 
 	/* Ensure that existing good sessions are not overridden. */
@@ -907,7 +902,7 @@ void bfd_recv_cb(struct thread *t)
 	    bfd->ses_state != PTM_BFD_ADM_DOWN) {
 		cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 			 "'remote discriminator' is zero, not overridden");
-		return;
+		return true;
 	}
 
 	/*
@@ -920,7 +915,7 @@ void bfd_recv_cb(struct thread *t)
 			cp_debug(is_mhop, &peer, &local, ifindex, vrfid,
 				 "exceeded max hop count (expected %d, got %d)",
 				 bfd->mh_ttl, ttl);
-			return;
+			return true;
 		}
 	} else {
 
@@ -1011,6 +1006,35 @@ void bfd_recv_cb(struct thread *t)
 		/* Send the control packet with the final bit immediately. */
 		ptm_bfd_snd(bfd, 1);
 	}
+
+	return true;
+}
+
+/*
+ * Control packets read per wakeup: with many sessions there's usually more
+ * than one waiting, no need for an event loop iteration per packet.
+ */
+#define BFD_RECV_BURST 32
+
+void bfd_recv_cb(struct thread *t)
+{
+	int sd = THREAD_FD(t);
+	struct bfd_vrf_global *bvrf = THREAD_ARG(t);
+	int i;
+
+	/* Schedule next read. */
+	bfd_sd_reschedule(bvrf, sd);
+
+	/* Handle echo packets. */
+	if (sd == bvrf->bg_echo || sd == bvrf->bg_echov6) {
+		ptm_bfd_process_echo_pkt(bvrf, sd);
+		return;
+	}
+
+	/* Handle control packets. */
+	for (i = 0; i < BFD_RECV_BURST; i++)
+		if (!bfd_recv_ctrl(bvrf, sd))
+			break;
 }
 
 /*
@@ -811,6 +811,24 @@ DEFPY(show_bfd_distributed, show_bfd_distributed_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFPY(show_bfd_lookup_counters, show_bfd_lookup_counters_cmd,
+      "show bfd lookup-counters",
+      SHOW_STR
+      "Bidirection Forwarding Detection\n"
+      "Show how received control packets were matched to sessions\n")
+{
+#define SHOW_COUNTER(label, counter)                                           \
+	vty_out(vty, "%28s: %" PRIu64 "\n", (label), (counter))
+
+	SHOW_COUNTER("Discriminator (cached)", bglobal.lookup_id_cache);
+	SHOW_COUNTER("Discriminator (hash)", bglobal.lookup_id_hash);
+	SHOW_COUNTER("Addresses", bglobal.lookup_key);
+	SHOW_COUNTER("No session", bglobal.lookup_miss);
+#undef SHOW_COUNTER
+
+	return CMD_SUCCESS;
+}
+
 DEFPY(
 	bfd_debug_distributed, bfd_debug_distributed_cmd,
 	"[no] debug bfd distributed",
@@ -1035,6 +1053,7 @@ void bfdd_vty_init(void)
 	install_element(ENABLE_NODE, &bfd_show_peer_cmd);
 	install_element(ENABLE_NODE, &bfd_show_peers_brief_cmd);
 	install_element(ENABLE_NODE, &show_bfd_distributed_cmd);
+	install_element(ENABLE_NODE, &show_bfd_lookup_counters_cmd);
 	install_element(ENABLE_NODE, &show_debugging_bfd_cmd);
 
 	install_element(ENABLE_NODE, &bfd_debug_distributed_cmd);
@@ -51,6 +51,11 @@ DEFINE_MTYPE_STATIC(BFDD, BFDD_DPLANE_CTX,
 
 /** Data plane client socket buffer size. */
 #define BFD_DPLANE_CLIENT_BUF_SIZE 8192
+/**
+ * Data plane client output buffer maximum size: enough to install a few
+ * thousand sessions at once when the data plane connects.
+ */
+#define BFD_DPLANE_CLIENT_OUTBUF_MAX (BFD_DPLANE_CLIENT_BUF_SIZE * 128)
 
 struct bfd_dplane_ctx {
 	/** Client file descriptor. */
@@ -421,10 +426,21 @@ static int bfd_dplane_enqueue(struct bfd_dplane_ctx *bdc, const void *buf,
 	if (bdc->client && bdc->sock == -1)
 		return -1;
 
-	/* Not enough space. */
+	/* Not enough space: grow the buffer until the data plane catches up. */
 	if (buflen > STREAM_WRITEABLE(bdc->outbuf)) {
-		bdc->out_fullev++;
-		return -1;
+		size_t size = STREAM_SIZE(bdc->outbuf);
+
+		stream_pulldown(bdc->outbuf);
+		while (buflen > STREAM_WRITEABLE(bdc->outbuf)
+		       && size < BFD_DPLANE_CLIENT_OUTBUF_MAX) {
+			size *= 2;
+			stream_resize_inplace(&bdc->outbuf, size);
+		}
+
+		if (buflen > STREAM_WRITEABLE(bdc->outbuf)) {
+			bdc->out_fullev++;
+			return -1;
+		}
 	}
 
 	/* Show debug message if active. */
@@ -636,8 +652,9 @@ static void _bfd_session_register_dplane(struct hash_bucket *hb, void *arg)
 	/* Disable software session. */
 	bfd_session_disable(bs);
 
-	/* Move session to data plane. */
-	_bfd_dplane_add_session(bdc, bs);
+	/* Move session to data plane, keep it in software if that failed. */
+	if (_bfd_dplane_add_session(bdc, bs) != 0)
+		bfd_session_enable(bs);
 }
 
 static struct bfd_dplane_ctx *bfd_dplane_ctx_new(int sock)
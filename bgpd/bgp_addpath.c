@@ -89,18 +89,31 @@ void bgp_addpath_init_bgp_data(struct bgp_addpath_bgp_data *d)
 	}
 }
 
+/*
+ * Only prefixes that had IDs assigned have their own pools, not to spend
+ * memory on them in every prefix when addpath isn't used.
+ */
+static struct bgp_addpath_node_data *
+bgp_addpath_node_data_get(struct bgp_addpath_node_data **nd)
+{
+	if (!*nd)
+		*nd = XCALLOC(MTYPE_BGP_ADDPATH_NODE, sizeof(**nd));
+	return *nd;
+}
+
 /*
  * Free up resources associated with BGP route info structures.
  */
 void bgp_addpath_free_info_data(struct bgp_addpath_info_data *d,
-			      struct bgp_addpath_node_data *nd)
+			      struct bgp_addpath_node_data **nd)
 {
 	int i;
 
 	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
 		if (d->addpath_tx_id[i] != IDALLOC_INVALID)
-			idalloc_free_to_pool(&nd->free_ids[i],
-					     d->addpath_tx_id[i]);
+			idalloc_free_to_pool(
+				&bgp_addpath_node_data_get(nd)->free_ids[i],
+				d->addpath_tx_id[i]);
 	}
 }
 
@@ -136,15 +149,19 @@ bool bgp_addpath_info_has_ids(struct bgp_addpath_info_data *d)
  * Releases any ID's associated with the BGP prefix.
  */
 void bgp_addpath_free_node_data(struct bgp_addpath_bgp_data *bd,
-			      struct bgp_addpath_node_data *nd, afi_t afi,
+			      struct bgp_addpath_node_data **nd, afi_t afi,
 			      safi_t safi)
 {
 	int i;
 
+	if (!*nd)
+		return;
+
 	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
 		idalloc_drain_pool(bd->id_allocators[afi][safi][i],
-				   &(nd->free_ids[i]));
+				   &((*nd)->free_ids[i]));
 	}
+	XFREE(MTYPE_BGP_ADDPATH_NODE, *nd);
 }
 
 /*
@@ -182,9 +199,11 @@ static void bgp_addpath_flush_type_rn(struct bgp *bgp, afi_t afi, safi_t safi,
 {
 	struct bgp_path_info *pi;
 
-	idalloc_drain_pool(
-		bgp->tx_addpath.id_allocators[afi][safi][addpath_type],
-		&(dest->tx_addpath.free_ids[addpath_type]));
+	UNSET_FLAG(dest->addpath_ids, 1 << addpath_type);
+	if (dest->tx_addpath)
+		idalloc_drain_pool(
+			bgp->tx_addpath.id_allocators[afi][safi][addpath_type],
+			&(dest->tx_addpath->free_ids[addpath_type]));
 	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
 		if (pi->tx_addpath.addpath_tx_id[addpath_type]
 		    != IDALLOC_INVALID) {
@@ -234,30 +253,15 @@ static void bgp_addpath_flush_type(struct bgp *bgp, afi_t afi, safi_t safi,
 }
 
 /*
- * Allocate an Addpath ID for the given type on a path, if necessary.
- */
-static void bgp_addpath_populate_path(struct id_alloc *allocator,
-				      struct bgp_path_info *path,
-				      enum bgp_addpath_strat addpath_type)
-{
-	if (bgp_addpath_tx_path(addpath_type, path)) {
-		path->tx_addpath.addpath_tx_id[addpath_type] =
-			idalloc_allocate(allocator);
-	}
-}
-
-/*
- * Compute addpath ID's on a BGP instance associated with the addpath strategy,
- * and afi/safi combination. Since we won't waste the time computing addpath IDs
- * for unused strategies, the first time a peer is configured to use a strategy,
- * we have to backfill the data.
+ * Set up the ID allocator for an addpath strategy used for the first time
+ * on a BGP instance and afi/safi combination.  The paths get their IDs
+ * when their prefix is next processed or announced, see
+ * bgp_addpath_ensure_ids(), instead of walking the whole table here.
  */
 static void bgp_addpath_populate_type(struct bgp *bgp, afi_t afi, safi_t safi,
 				    enum bgp_addpath_strat addpath_type)
 {
-	struct bgp_dest *dest, *ndest;
 	char buf[200];
-	struct id_alloc *allocator;
 
 	snprintf(buf, sizeof(buf), "Addpath ID Allocator %s:%d/%d",
 		 bgp_addpath_names(addpath_type)->config_name, (int)afi,
@@ -271,33 +275,6 @@ static void bgp_addpath_populate_type(struct bgp *bgp, afi_t afi, safi_t safi,
 
 	idalloc_reserve(bgp->tx_addpath.id_allocators[afi][safi][addpath_type],
 		BGP_ADDPATH_TX_ID_FOR_DEFAULT_ORIGINATE);
-
-	allocator = bgp->tx_addpath.id_allocators[afi][safi][addpath_type];
-
-	for (dest = bgp_table_top(bgp->rib[afi][safi]); dest;
-	     dest = bgp_route_next(dest)) {
-		struct bgp_path_info *bi;
-
-		if (safi == SAFI_MPLS_VPN) {
-			struct bgp_table *table;
-
-			table = bgp_dest_get_bgp_table_info(dest);
-			if (!table)
-				continue;
-
-			for (ndest = bgp_table_top(table); ndest;
-			     ndest = bgp_route_next(ndest))
-				for (bi = bgp_dest_get_bgp_path_info(ndest); bi;
-				     bi = bi->next)
-					bgp_addpath_populate_path(allocator, bi,
-								  addpath_type);
-		} else {
-			for (bi = bgp_dest_get_bgp_path_info(dest); bi;
-			     bi = bi->next)
-				bgp_addpath_populate_path(allocator, bi,
-							  addpath_type);
-		}
-	}
 }
 
 /*
@@ -418,6 +395,9 @@ void bgp_addpath_set_peer_type(struct peer *peer, afi_t afi, safi_t safi,
 
 }
 
+/* IDs handed from one path to another within bgp_addpath_update_ids() */
+#define BGP_ADDPATH_SPARE_IDS 16
+
 /*
  * Intended to run after bestpath. This function will take TX IDs from paths
  * that no longer need them, and give them to paths that do. This prevents
@@ -430,21 +410,32 @@ void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *bn, afi_t afi,
 	int i;
 	struct bgp_path_info *pi;
 	struct id_alloc_pool **pool_ptr;
+	uint32_t spare[BGP_ADDPATH_SPARE_IDS];
+	unsigned int nspare;
 
 	for (i = 0; i < BGP_ADDPATH_MAX; i++) {
 		struct id_alloc *alloc =
 			bgp->tx_addpath.id_allocators[afi][safi][i];
-		pool_ptr = &(bn->tx_addpath.free_ids[i]);
-
 		if (bgp->tx_addpath.peercount[afi][safi][i] == 0)
 			continue;
 
-		/* Free Unused IDs back to the pool.*/
+		pool_ptr = &(bgp_addpath_node_data_get(&bn->tx_addpath)
+				     ->free_ids[i]);
+
+		SET_FLAG(bn->addpath_ids, 1 << i);
+		nspare = 0;
+
+		/* Take unused IDs, the holding pool only if there are many */
 		for (pi = bgp_dest_get_bgp_path_info(bn); pi; pi = pi->next) {
 			if (pi->tx_addpath.addpath_tx_id[i] != IDALLOC_INVALID
 			    && !bgp_addpath_tx_path(i, pi)) {
-				idalloc_free_to_pool(pool_ptr,
-					pi->tx_addpath.addpath_tx_id[i]);
+				if (nspare < array_size(spare))
+					spare[nspare++] =
+						pi->tx_addpath.addpath_tx_id[i];
+				else
+					idalloc_free_to_pool(
+						pool_ptr,
+						pi->tx_addpath.addpath_tx_id[i]);
 				pi->tx_addpath.addpath_tx_id[i] =
 					IDALLOC_INVALID;
 			}
@@ -454,13 +445,40 @@ void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *bn, afi_t afi,
 		for (pi = bgp_dest_get_bgp_path_info(bn); pi; pi = pi->next) {
 			if (pi->tx_addpath.addpath_tx_id[i] == IDALLOC_INVALID
 			    && bgp_addpath_tx_path(i, pi)) {
-				pi->tx_addpath.addpath_tx_id[i] =
-					idalloc_allocate_prefer_pool(
-						alloc, pool_ptr);
+				if (nspare)
+					pi->tx_addpath.addpath_tx_id[i] =
+						spare[--nspare];
+				else
+					pi->tx_addpath.addpath_tx_id[i] =
+						idalloc_allocate_prefer_pool(
+							alloc, pool_ptr);
 			}
 		}
 
-		/* Free any IDs left in the pool to the main allocator */
+		/* Free any IDs left over to the main allocator */
+		idalloc_free_bulk(alloc, spare, nspare);
 		idalloc_drain_pool(alloc, pool_ptr);
 	}
 }
+
+/*
+ * Gives the paths of a prefix their TX IDs if a strategy was enabled
+ * since the prefix was last processed.
+ */
+void bgp_addpath_ensure_ids(struct bgp *bgp, struct bgp_dest *dest)
+{
+	struct bgp_table *table = bgp_dest_table(dest);
+	int i;
+
+	if (!bgp_addpath_is_addpath_used(&bgp->tx_addpath, table->afi,
+					 table->safi))
+		return;
+
+	for (i = 0; i < BGP_ADDPATH_MAX; i++)
+		if (bgp->tx_addpath.peercount[table->afi][table->safi][i]
+		    && !CHECK_FLAG(dest->addpath_ids, 1 << i)) {
+			bgp_addpath_update_ids(bgp, dest, table->afi,
+					       table->safi);
+			return;
+		}
+}
@@ -36,11 +36,11 @@ bool bgp_addpath_is_addpath_used(struct bgp_addpath_bgp_data *d, afi_t afi,
 				 safi_t safi);
 
 void bgp_addpath_free_node_data(struct bgp_addpath_bgp_data *bd,
-			      struct bgp_addpath_node_data *nd,
+			      struct bgp_addpath_node_data **nd,
 			      afi_t afi, safi_t safi);
 
 void bgp_addpath_free_info_data(struct bgp_addpath_info_data *d,
-			      struct bgp_addpath_node_data *nd);
+			      struct bgp_addpath_node_data **nd);
 
 
 bool bgp_addpath_info_has_ids(struct bgp_addpath_info_data *d);
@@ -68,5 +68,7 @@ void bgp_addpath_set_peer_type(struct peer *peer, afi_t afi, safi_t safi,
 void bgp_addpath_update_ids(struct bgp *bgp, struct bgp_dest *dest, afi_t afi,
 			    safi_t safi);
 
+void bgp_addpath_ensure_ids(struct bgp *bgp, struct bgp_dest *dest);
+
 void bgp_addpath_type_changed(struct bgp *bgp);
 #endif
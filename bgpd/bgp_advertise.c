@@ -39,6 +39,7 @@
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_pipeline.h"
 
 /* BGP advertise attribute is used for pack same attribute update into
    one packet.  To do that we maintain attribute hash in struct
@@ -84,7 +85,11 @@ bool bgp_advertise_attr_hash_cmp(const void *p1, const void *p2)
    information.  */
 struct bgp_advertise *bgp_advertise_new(void)
 {
-	return XCALLOC(MTYPE_BGP_ADVERTISE, sizeof(struct bgp_advertise));
+	struct bgp_advertise *adv;
+
+	adv = XCALLOC(MTYPE_BGP_ADVERTISE, sizeof(struct bgp_advertise));
+	adv->since = bgp_pipe_now();
+	return adv;
 }
 
 void bgp_advertise_free(struct bgp_advertise *adv)
@@ -151,6 +156,7 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 {
 	struct bgp_adj_out *adj;
 	struct peer_af *paf;
+	struct bgp_table *table;
 	afi_t afi;
 	safi_t safi;
 	bool addpath_capable;
@@ -176,6 +182,12 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 						: (adj->attr ? true : false));
 			}
 
+	/* compact subgroups only keep adj-outs while they are pending */
+	table = bgp_dest_table(dest);
+	paf = peer_af_find(peer, table->afi, table->safi);
+	if (paf && paf->subgroup)
+		return bgp_adj_out_compact_advertised(paf->subgroup, dest);
+
 	return false;
 }
 
@@ -194,7 +206,7 @@ void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer, struct attr *attr,
 			return;
 		}
 	}
-	adj = XCALLOC(MTYPE_BGP_ADJ_IN, sizeof(struct bgp_adj_in));
+	adj = XSLAB_CALLOC(MTYPE_BGP_ADJ_IN, sizeof(struct bgp_adj_in));
 	adj->peer = peer_lock(peer); /* adj_in peer reference */
 	adj->attr = bgp_attr_intern(attr);
 	adj->uptime = monotime(NULL);
@@ -209,7 +221,7 @@ void bgp_adj_in_remove(struct bgp_dest *dest, struct bgp_adj_in *bai)
 	BGP_ADJ_IN_DEL(dest, bai);
 	bgp_dest_unlock_node(dest);
 	peer_unlock(bai->peer); /* adj_in peer reference */
-	XFREE(MTYPE_BGP_ADJ_IN, bai);
+	XSLAB_FREE(MTYPE_BGP_ADJ_IN, bai);
 }
 
 bool bgp_adj_in_unset(struct bgp_dest *dest, struct peer *peer,
@@ -58,6 +58,12 @@ struct bgp_advertise {
 
 	/* BGP info.  */
 	struct bgp_path_info *pathi;
+
+	/* encoded into a packet that isn't queued yet */
+	bool built;
+
+	/* bgp_pipe_now() when queued */
+	int64_t since;
 };
 
 DECLARE_DLIST(bgp_adv_fifo, struct bgp_advertise, fifo);
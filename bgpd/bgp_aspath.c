@@ -27,9 +27,10 @@
 #include "log.h"
 #include "stream.h"
 #include "command.h"
-#include "jhash.h"
+#include "fhash.h"
 #include "queue.h"
 #include "filter.h"
+#include "frr_pthread.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_aspath.h"
@@ -88,6 +89,17 @@ struct assegment_header {
 /* Hash for aspath.  This is the top level structure of AS path. */
 static struct hash *ashash;
 
+/*
+ * Guards ashash and the reference counts of interned AS paths, so that AS
+ * paths can be interned and released from the I/O pthread as well.  Only
+ * aspath_intern(), aspath_ref() and aspath_unintern() may change refcnt.
+ * Apart from that, the only thing written on an interned path is the JSON
+ * built on demand by aspath_json_get(), also under the lock, and the
+ * atomic acl_cache.  Everything else is fixed before the path goes into
+ * the hash, so reading it does not need the lock.
+ */
+static pthread_mutex_t ashash_mtx = PTHREAD_MUTEX_INITIALIZER;
+
 /* Stream for SNMP. See aspath_snmp_pathseg */
 static struct stream *snmp_stream;
 
@@ -335,15 +347,17 @@ void aspath_unintern(struct aspath **aspath)
 
 	asp = *aspath;
 
-	if (asp->refcnt)
-		asp->refcnt--;
+	frr_with_mutex (&ashash_mtx) {
+		if (asp->refcnt)
+			asp->refcnt--;
 
-	if (asp->refcnt == 0) {
-		/* This aspath must exist in aspath hash table. */
-		ret = hash_release(ashash, asp);
-		assert(ret != NULL);
-		aspath_free(asp);
-		*aspath = NULL;
+		if (asp->refcnt == 0) {
+			/* This aspath must exist in aspath hash table. */
+			ret = hash_release(ashash, asp);
+			assert(ret != NULL);
+			aspath_free(asp);
+			*aspath = NULL;
+		}
 	}
 }
 
@@ -410,6 +424,9 @@ unsigned int aspath_count_hops(const struct aspath *aspath)
 	int count = 0;
 	struct assegment *seg = aspath->segments;
 
+	if (aspath->asmask)
+		return aspath->hops;
+
 	while (seg) {
 		if (seg->type == AS_SEQUENCE)
 			count += seg->length;
@@ -659,6 +676,8 @@ static void aspath_make_str_count(struct aspath *as, bool make_json)
 void aspath_str_update(struct aspath *as, bool make_json)
 {
 	XFREE(MTYPE_AS_STR, as->str);
+	memset(as->acl_cache, 0, sizeof(as->acl_cache));
+	as->asmask = 0;
 
 	if (as->json) {
 		json_object_free(as->json);
@@ -668,6 +687,77 @@ void aspath_str_update(struct aspath *as, bool make_json)
 	aspath_make_str_count(as, make_json);
 }
 
+static inline uint64_t aspath_asn_bit(as_t asn)
+{
+	return 1ULL << ((asn * 0x9e3779b1U) >> 26);
+}
+
+static uint32_t aspath_segments_hash(const struct aspath *aspath)
+{
+	const struct assegment *seg;
+	uint64_t key = fhash_init(2334325);
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		key = fhash_add(key, seg->type, seg->length);
+		key = fhash64(seg->as, seg->length * sizeof(as_t), key);
+	}
+
+	return fhash_final(key);
+}
+
+/* Caches what is asked for most on a path that is being interned. */
+static void aspath_summarize(struct aspath *aspath)
+{
+	const struct assegment *seg;
+	int i;
+
+	aspath->asmask = 0;
+	aspath->hops = 0;
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		for (i = 0; i < seg->length; i++)
+			aspath->asmask |= aspath_asn_bit(seg->as[i]);
+
+		if (seg->type == AS_SEQUENCE)
+			aspath->hops += seg->length;
+		else if (seg->type == AS_SET)
+			aspath->hops++;
+	}
+
+	aspath->hash = aspath_segments_hash(aspath);
+}
+
+/* Take another reference on an interned AS path. */
+struct aspath *aspath_ref(struct aspath *aspath)
+{
+	assert(aspath->refcnt);
+
+	frr_with_mutex (&ashash_mtx) {
+		aspath->refcnt++;
+	}
+
+	return aspath;
+}
+
+/* JSON representation of an interned AS path, built on first use.  This
+   leaves the string and the cached summary alone, other pthreads may be
+   looking at them.  */
+json_object *aspath_json_get(struct aspath *aspath)
+{
+	struct aspath tmp = {};
+
+	frr_with_mutex (&ashash_mtx) {
+		if (!aspath->json) {
+			tmp.segments = aspath->segments;
+			aspath_make_str_count(&tmp, true);
+			XFREE(MTYPE_AS_STR, tmp.str);
+			aspath->json = tmp.json;
+		}
+	}
+
+	return aspath->json;
+}
+
 /* Intern allocated AS path. */
 struct aspath *aspath_intern(struct aspath *aspath)
 {
@@ -678,13 +768,18 @@ struct aspath *aspath_intern(struct aspath *aspath)
 	assert(aspath->refcnt == 0);
 	assert(aspath->str);
 
+	/* still private, the copy in the hash must not change anymore */
+	aspath_summarize(aspath);
+
 	/* Check AS path hash. */
-	find = hash_get(ashash, aspath, hash_alloc_intern);
+	frr_with_mutex (&ashash_mtx) {
+		find = hash_get(ashash, aspath, hash_alloc_intern);
+		find->refcnt++;
+	}
+
 	if (find != aspath)
 		aspath_free(aspath);
 
-	find->refcnt++;
-
 	return find;
 }
 
@@ -721,9 +816,6 @@ static void *aspath_hash_alloc(void *arg)
 	const struct aspath *aspath = arg;
 	struct aspath *new;
 
-	/* Malformed AS path value. */
-	assert(aspath->str);
-
 	/* New aspath structure is needed. */
 	new = XMALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
 
@@ -733,6 +825,12 @@ static void *aspath_hash_alloc(void *arg)
 	new->str = aspath->str;
 	new->str_len = aspath->str_len;
 	new->json = aspath->json;
+	memset(new->acl_cache, 0, sizeof(new->acl_cache));
+
+	/* only paths new to the hash need their string built */
+	if (!new->str)
+		aspath_make_str_count(new, false);
+	aspath_summarize(new);
 
 	return new;
 }
@@ -858,25 +956,43 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 	if (assegments_parse(s, length, &as.segments, use32bit) < 0)
 		return NULL;
 
-	/* If already same aspath exist then return it. */
-	find = hash_get(ashash, &as, aspath_hash_alloc);
-
-	/* if the aspath was already hashed free temporary memory. */
-	if (find->refcnt) {
-		assegment_free_all(as.segments);
-		/* aspath_key_make() always updates the string */
-		XFREE(MTYPE_AS_STR, as.str);
-		if (as.json) {
-			json_object_free(as.json);
-			as.json = NULL;
-		}
-	}
+	frr_with_mutex (&ashash_mtx) {
+		/* If already same aspath exist then return it. */
+		find = hash_get(ashash, &as, aspath_hash_alloc);
 
-	find->refcnt++;
+		/* if the aspath was already hashed free temporary memory. */
+		if (find->refcnt)
+			assegment_free_all(as.segments);
+
+		find->refcnt++;
+	}
 
 	return find;
 }
 
+/* Decode an AS path without interning it.  The string representation is
+   built as well, so the result can be handed to aspath_intern() later on.
+
+   On error NULL is returned.
+ */
+struct aspath *aspath_decode(struct stream *s, size_t length, int use32bit)
+{
+	struct aspath *as;
+	struct assegment *segments = NULL;
+
+	if (length % AS16_VALUE_SIZE)
+		return NULL;
+
+	if (assegments_parse(s, length, &segments, use32bit) < 0)
+		return NULL;
+
+	as = aspath_new();
+	as->segments = segments;
+	aspath_str_update(as, false);
+
+	return as;
+}
+
 static void assegment_data_put(struct stream *s, as_t *as, int num,
 			       int use32bit)
 {
@@ -1173,6 +1289,9 @@ int aspath_loop_check(struct aspath *aspath, as_t asno)
 	if ((aspath == NULL) || (aspath->segments == NULL))
 		return 0;
 
+	if (aspath->asmask && !(aspath->asmask & aspath_asn_bit(asno)))
+		return 0;
+
 	seg = aspath->segments;
 
 	while (seg) {
@@ -1884,7 +2003,13 @@ struct aspath *aspath_empty_get(void)
 
 unsigned long aspath_count(void)
 {
-	return ashash->count;
+	unsigned long count;
+
+	frr_with_mutex (&ashash_mtx) {
+		count = ashash->count;
+	}
+
+	return count;
 }
 
 /*
@@ -2038,14 +2163,11 @@ struct aspath *aspath_str2aspath(const char *str)
 unsigned int aspath_key_make(const void *p)
 {
 	const struct aspath *aspath = p;
-	unsigned int key = 0;
 
-	if (!aspath->str)
-		aspath_str_update((struct aspath *)aspath, false);
+	if (aspath->asmask)
+		return aspath->hash;
 
-	key = jhash(aspath->str, aspath->str_len, 2334325);
-
-	return key;
+	return aspath_segments_hash(aspath);
 }
 
 /* If two aspath have same value then return 1 else return 0 */
@@ -2054,6 +2176,9 @@ bool aspath_cmp(const void *arg1, const void *arg2)
 	const struct assegment *seg1 = ((const struct aspath *)arg1)->segments;
 	const struct assegment *seg2 = ((const struct aspath *)arg2)->segments;
 
+	if (arg1 == arg2)
+		return true;
+
 	while (seg1 || seg2) {
 		int i;
 		if ((!seg1 && seg2) || (seg1 && !seg2))
@@ -2076,6 +2201,7 @@ void aspath_init(void)
 {
 	ashash = hash_create_size(32768, aspath_key_make, aspath_cmp,
 				  "BGP AS Path");
+	hash_set_incremental(ashash, true);
 }
 
 void aspath_finish(void)
@@ -2122,9 +2248,12 @@ static void aspath_show_all_iterator(struct hash_bucket *bucket,
    `show [ip] bgp paths' command. */
 void aspath_print_all_vty(struct vty *vty)
 {
-	hash_iterate(ashash, (void (*)(struct hash_bucket *,
+	frr_with_mutex (&ashash_mtx) {
+		hash_iterate(ashash,
+			     (void (*)(struct hash_bucket *,
 				       void *))aspath_show_all_iterator,
-		     vty);
+			     vty);
+	}
 }
 
 static struct aspath *bgp_aggr_aspath_lookup(struct bgp_aggregate *aggregate,
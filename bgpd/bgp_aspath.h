@@ -22,6 +22,7 @@
 #define _QUAGGA_BGP_ASPATH_H
 
 #include "lib/json.h"
+#include "lib/frratomic.h"
 #include "bgpd/bgp_route.h"
 
 /* AS path segment type.  */
@@ -58,6 +59,8 @@ struct assegment {
 };
 
 /* AS path may be include some AsSegments.  */
+#define ASPATH_ACL_CACHE 2
+
 struct aspath {
 	/* Reference count to this aspath.  */
 	unsigned long refcnt;
@@ -72,6 +75,16 @@ struct aspath {
 	   and AS path regular expression match.  */
 	char *str;
 	unsigned short str_len;
+
+	/* as-path access-list results for this path, see as_list_apply() */
+	_Atomic uint64_t acl_cache[ASPATH_ACL_CACHE];
+
+	/* Set when interned, as the path doesn't change anymore: hash key,
+	   hop count and one bit per AS (hashed) for quick loop checks.
+	   Only valid if asmask is nonzero.  */
+	uint64_t asmask;
+	uint32_t hash;
+	uint32_t hops;
 };
 
 #define ASPATH_STR_DEFAULT_LEN 32
@@ -81,6 +94,8 @@ extern void aspath_init(void);
 extern void aspath_finish(void);
 extern struct aspath *aspath_parse(struct stream *s, size_t length,
 				   int use32bit);
+extern struct aspath *aspath_decode(struct stream *s, size_t length,
+				    int use32bit);
 extern struct aspath *aspath_dup(struct aspath *aspath);
 extern struct aspath *aspath_aggregate(struct aspath *as1, struct aspath *as2);
 extern struct aspath *aspath_prepend(struct aspath *as1, struct aspath *as2);
@@ -102,7 +117,9 @@ extern struct aspath *aspath_str2aspath(const char *str);
 extern void aspath_str_update(struct aspath *as, bool make_json);
 extern void aspath_free(struct aspath *aspath);
 extern struct aspath *aspath_intern(struct aspath *aspath);
+extern struct aspath *aspath_ref(struct aspath *aspath);
 extern void aspath_unintern(struct aspath **aspath);
+extern json_object *aspath_json_get(struct aspath *aspath);
 extern const char *aspath_print(struct aspath *aspath);
 extern void aspath_print_vty(struct vty *vty, const char *format,
 			     struct aspath *aspath, const char *suffix);
@@ -28,6 +28,7 @@
 #include "log.h"
 #include "hash.h"
 #include "jhash.h"
+#include "fhash.h"
 #include "queue.h"
 #include "table.h"
 #include "filter.h"
@@ -657,53 +658,61 @@ unsigned long int attr_unknown_count(void)
 unsigned int attrhash_key_make(const void *p)
 {
 	const struct attr *attr = (struct attr *)p;
-	uint32_t key = 0;
-#define MIX(val)	key = jhash_1word(val, key)
-#define MIX3(a, b, c)	key = jhash_3words((a), (b), (c), key)
-
-	MIX3(attr->origin, attr->nexthop.s_addr, attr->med);
-	MIX3(attr->local_pref, attr->aggregator_as,
-	     attr->aggregator_addr.s_addr);
-	MIX3(attr->weight, attr->mp_nexthop_global_in.s_addr,
-	     attr->originator_id.s_addr);
-	MIX3(attr->tag, attr->label, attr->label_index);
-
-	if (attr->aspath)
-		MIX(aspath_key_make(attr->aspath));
-	if (bgp_attr_get_community(attr))
-		MIX(community_hash_make(bgp_attr_get_community(attr)));
-	if (bgp_attr_get_lcommunity(attr))
-		MIX(lcommunity_hash_make(bgp_attr_get_lcommunity(attr)));
-	if (bgp_attr_get_ecommunity(attr))
-		MIX(ecommunity_hash_make(bgp_attr_get_ecommunity(attr)));
-	if (bgp_attr_get_ipv6_ecommunity(attr))
-		MIX(ecommunity_hash_make(bgp_attr_get_ipv6_ecommunity(attr)));
-	if (bgp_attr_get_cluster(attr))
-		MIX(cluster_hash_key_make(bgp_attr_get_cluster(attr)));
-	if (bgp_attr_get_transit(attr))
-		MIX(transit_hash_key_make(bgp_attr_get_transit(attr)));
-	if (attr->encap_subtlvs)
-		MIX(encap_hash_key_make(attr->encap_subtlvs));
-	if (attr->srv6_l3vpn)
-		MIX(srv6_l3vpn_hash_key_make(attr->srv6_l3vpn));
-	if (attr->srv6_vpn)
-		MIX(srv6_vpn_hash_key_make(attr->srv6_vpn));
+	uint64_t key = fhash_init(0);
+	uint32_t sub[11], *subp = sub;
+
+	/* 2 x 32 bits per 64-bit word */
+#define W(hi, lo)	(((uint64_t)(uint32_t)(hi) << 32) | (uint32_t)(lo))
+#define MIX4(a, b, c, d) key = fhash_add(key, W(a, b), W(c, d))
+#define SUB(val)	*subp++ = (val)
+
+	MIX4(attr->origin, attr->nexthop.s_addr, attr->med, attr->local_pref);
+	MIX4(attr->aggregator_as, attr->aggregator_addr.s_addr, attr->weight,
+	     attr->mp_nexthop_global_in.s_addr);
+	MIX4(attr->originator_id.s_addr, attr->tag, attr->label,
+	     attr->label_index);
+
+	/* absent sub-attributes hash as 0, matching the pointer compare */
+	SUB(attr->aspath ? aspath_key_make(attr->aspath) : 0);
+	SUB(bgp_attr_get_community(attr)
+		    ? community_hash_make(bgp_attr_get_community(attr))
+		    : 0);
+	SUB(bgp_attr_get_lcommunity(attr)
+		    ? lcommunity_hash_make(bgp_attr_get_lcommunity(attr))
+		    : 0);
+	SUB(bgp_attr_get_ecommunity(attr)
+		    ? ecommunity_hash_make(bgp_attr_get_ecommunity(attr))
+		    : 0);
+	SUB(bgp_attr_get_ipv6_ecommunity(attr)
+		    ? ecommunity_hash_make(bgp_attr_get_ipv6_ecommunity(attr))
+		    : 0);
+	SUB(bgp_attr_get_cluster(attr)
+		    ? cluster_hash_key_make(bgp_attr_get_cluster(attr))
+		    : 0);
+	SUB(bgp_attr_get_transit(attr)
+		    ? transit_hash_key_make(bgp_attr_get_transit(attr))
+		    : 0);
+	SUB(attr->encap_subtlvs ? encap_hash_key_make(attr->encap_subtlvs)
+				: 0);
+	SUB(attr->srv6_l3vpn ? srv6_l3vpn_hash_key_make(attr->srv6_l3vpn) : 0);
+	SUB(attr->srv6_vpn ? srv6_vpn_hash_key_make(attr->srv6_vpn) : 0);
 #ifdef ENABLE_BGP_VNC
 	struct bgp_attr_encap_subtlv *vnc_subtlvs =
 		bgp_attr_get_vnc_subtlvs(attr);
-	if (vnc_subtlvs)
-		MIX(encap_hash_key_make(vnc_subtlvs));
+	SUB(vnc_subtlvs ? encap_hash_key_make(vnc_subtlvs) : 0);
 #endif
-	MIX(attr->mp_nexthop_len);
-	key = jhash(attr->mp_nexthop_global.s6_addr, IPV6_MAX_BYTELEN, key);
-	key = jhash(attr->mp_nexthop_local.s6_addr, IPV6_MAX_BYTELEN, key);
-	MIX3(attr->nh_ifindex, attr->nh_lla_ifindex, attr->distance);
-	MIX(attr->rmap_table_id);
-	MIX(attr->nh_type);
-	MIX(attr->bh_type);
-	MIX(attr->otc);
-
-	return key;
+	key = fhash64(sub, (subp - sub) * sizeof(sub[0]), key);
+
+	key = fhash64(attr->mp_nexthop_global.s6_addr, IPV6_MAX_BYTELEN, key);
+	key = fhash64(attr->mp_nexthop_local.s6_addr, IPV6_MAX_BYTELEN, key);
+	MIX4(attr->mp_nexthop_len, attr->nh_ifindex, attr->nh_lla_ifindex,
+	     attr->distance);
+	MIX4(attr->rmap_table_id, attr->nh_type, attr->bh_type, attr->otc);
+
+#undef SUB
+#undef MIX4
+#undef W
+	return fhash_final(key);
 }
 
 bool attrhash_cmp(const void *p1, const void *p2)
@@ -776,6 +785,7 @@ static void attrhash_init(void)
 {
 	attrhash =
 		hash_create(attrhash_key_make, attrhash_cmp, "BGP Attributes");
+	hash_set_incremental(attrhash, true);
 }
 
 /*
@@ -855,7 +865,7 @@ struct attr *bgp_attr_intern(struct attr *attr)
 		if (!attr->aspath->refcnt)
 			attr->aspath = aspath_intern(attr->aspath);
 		else
-			attr->aspath->refcnt++;
+			aspath_ref(attr->aspath);
 	}
 
 	comm = bgp_attr_get_community(attr);
@@ -1489,6 +1499,33 @@ bgp_attr_origin(struct bgp_attr_parser_args *args)
 	return 0;
 }
 
+/*
+ * Get the AS path at the current position of peer->curr, using the one
+ * decoded by the I/O pthread if it is still applicable.
+ */
+static struct aspath *bgp_attr_aspath_get(struct peer *peer, bool as4,
+					  bgp_size_t length, int use32bit)
+{
+	struct bgp_attr_preparse_aspath *pa;
+	struct aspath *aspath;
+
+	if (!peer->curr_preparse)
+		return aspath_parse(peer->curr, length, use32bit);
+
+	pa = as4 ? &peer->curr_preparse->as4_path
+		 : &peer->curr_preparse->as_path;
+
+	if (!pa->aspath || pa->offset != stream_get_getp(peer->curr)
+	    || pa->length != length || pa->use32bit != use32bit)
+		return aspath_parse(peer->curr, length, use32bit);
+
+	aspath = pa->aspath;
+	pa->aspath = NULL;
+	stream_forward_getp(peer->curr, length);
+
+	return aspath;
+}
+
 /* Parse AS path information.  This function is wrapper of
    aspath_parse. */
 static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
@@ -1501,8 +1538,8 @@ static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
 	 * peer with AS4 => will get 4Byte ASnums
 	 * otherwise, will get 16 Bit
 	 */
-	attr->aspath = aspath_parse(
-		peer->curr, length,
+	attr->aspath = bgp_attr_aspath_get(
+		peer, false, length,
 		CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV)
 			&& CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV));
 
@@ -1597,7 +1634,7 @@ static int bgp_attr_as4_path(struct bgp_attr_parser_args *args,
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
 
-	*as4_path = aspath_parse(peer->curr, length, 1);
+	*as4_path = bgp_attr_aspath_get(peer, true, length, 1);
 
 	/* In case of IBGP, length will be zero. */
 	if (!*as4_path) {
@@ -3185,6 +3222,141 @@ static int bgp_attr_check(struct peer *peer, struct attr *attr)
 	return BGP_ATTR_PARSE_PROCEED;
 }
 
+/*
+ * Walk the path attributes of a received UPDATE and decode AS_PATH and
+ * AS4_PATH.  This is called from bgp_process_reads() on the I/O pthread,
+ * before the packet is handed to the main pthread, so it must only look at
+ * the packet itself and at peer state that is stable while the session is
+ * up.  Decoded paths are interned right away, which is safe from here since
+ * the AS path hash has its own lock.  bgp_attr_aspath() / bgp_attr_as4_path()
+ * take over the reference, or fall back to normal parsing whenever the entry
+ * does not match what they are looking at.
+ *
+ * Nothing here is authoritative: malformed packets are simply left for
+ * bgp_attr_parse() to complain about.
+ */
+struct bgp_attr_preparse *bgp_attr_preparse(struct peer *peer,
+					    struct stream *pkt)
+{
+	struct bgp_attr_preparse *pre = NULL;
+	struct bgp_attr_preparse_aspath *pa;
+	size_t endp = stream_get_endp(pkt);
+	size_t getp, attr_endp;
+	bgp_size_t length;
+	uint8_t flag, type;
+	int use32bit;
+
+	if (endp < BGP_HEADER_SIZE + 2 * sizeof(uint16_t)
+	    || stream_getc_from(pkt, BGP_MARKER_SIZE + 2) != BGP_MSG_UPDATE)
+		return NULL;
+
+	use32bit = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV)
+		   && CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+
+	/* skip withdrawn routes */
+	getp = BGP_HEADER_SIZE;
+	getp += sizeof(uint16_t) + stream_getw_from(pkt, getp);
+	if (getp + sizeof(uint16_t) > endp)
+		return NULL;
+
+	attr_endp = getp + sizeof(uint16_t) + stream_getw_from(pkt, getp);
+	getp += sizeof(uint16_t);
+	if (attr_endp > endp)
+		return NULL;
+
+	while (getp + BGP_ATTR_MIN_LEN <= attr_endp) {
+		flag = stream_getc_from(pkt, getp);
+		type = stream_getc_from(pkt, getp + 1);
+
+		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN)) {
+			if (getp + BGP_ATTR_MIN_LEN + 1 > attr_endp)
+				break;
+			length = stream_getw_from(pkt, getp + 2);
+			getp += BGP_ATTR_MIN_LEN + 1;
+		} else {
+			length = stream_getc_from(pkt, getp + 2);
+			getp += BGP_ATTR_MIN_LEN;
+		}
+
+		if (getp + length > attr_endp)
+			break;
+
+		if (length
+		    && (type == BGP_ATTR_AS_PATH || type == BGP_ATTR_AS4_PATH)) {
+			if (!pre) {
+				pre = XCALLOC(MTYPE_BGP_ATTR_PREPARSE,
+					      sizeof(*pre));
+				pre->pkt = pkt;
+			}
+
+			pa = (type == BGP_ATTR_AS_PATH) ? &pre->as_path
+							: &pre->as4_path;
+
+			/* duplicates are ignored by bgp_attr_parse() */
+			if (!pa->length) {
+				pa->offset = getp;
+				pa->length = length;
+				pa->use32bit =
+					(type == BGP_ATTR_AS_PATH) ? use32bit : 1;
+
+				stream_set_getp(pkt, getp);
+				pa->aspath = aspath_decode(pkt, length,
+							   pa->use32bit);
+				if (pa->aspath)
+					pa->aspath = aspath_intern(pa->aspath);
+			}
+		}
+
+		getp += length;
+	}
+
+	stream_set_getp(pkt, 0);
+
+	return pre;
+}
+
+/*
+ * Take the preparse entry for 'pkt' off the peer queue, if there is one.
+ *
+ * Requires: peer->io_mtx
+ */
+struct bgp_attr_preparse *bgp_attr_preparse_pop(struct peer *peer,
+						struct stream *pkt)
+{
+	struct bgp_attr_preparse *pre = bgp_preparse_first(&peer->preparse);
+
+	if (!pre || pre->pkt != pkt)
+		return NULL;
+
+	return bgp_preparse_pop(&peer->preparse);
+}
+
+void bgp_attr_preparse_free(struct bgp_attr_preparse **pre)
+{
+	if (!*pre)
+		return;
+
+	aspath_unintern(&(*pre)->as_path.aspath);
+	aspath_unintern(&(*pre)->as4_path.aspath);
+	XFREE(MTYPE_BGP_ATTR_PREPARSE, *pre);
+}
+
+/*
+ * Drop all queued preparse entries, along with the one for the packet
+ * currently being processed.
+ *
+ * Requires: peer->io_mtx
+ */
+void bgp_attr_preparse_flush(struct peer *peer)
+{
+	struct bgp_attr_preparse *pre;
+
+	while ((pre = bgp_preparse_pop(&peer->preparse)))
+		bgp_attr_preparse_free(&pre);
+
+	bgp_attr_preparse_free(&peer->curr_preparse);
+}
+
 /* Read attribute of update packet.  This function is called from
    bgp_update_receive() in bgp_packet.c.  */
 enum bgp_attr_parse_ret bgp_attr_parse(struct peer *peer, struct attr *attr,
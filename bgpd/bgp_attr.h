@@ -386,12 +386,46 @@ enum bgp_attr_parse_ret {
 
 struct bpacket_attr_vec_arr;
 
+/* AS path attribute decoded ahead of time by the I/O pthread. */
+struct bgp_attr_preparse_aspath {
+	/* getp of the attribute value in the packet */
+	size_t offset;
+	bgp_size_t length;
+	int use32bit;
+
+	/* interned, reference owned by the preparse entry */
+	struct aspath *aspath;
+};
+
+/*
+ * Work done on a received UPDATE by bgp_process_reads() before the packet is
+ * queued for the main pthread.  Entries are kept on peer->preparse in the
+ * same order as the packets on peer->ibuf.
+ */
+struct bgp_attr_preparse {
+	struct bgp_preparse_item item;
+
+	/* packet this was computed from, only used for matching */
+	const struct stream *pkt;
+
+	struct bgp_attr_preparse_aspath as_path;
+	struct bgp_attr_preparse_aspath as4_path;
+};
+
+DECLARE_LIST(bgp_preparse, struct bgp_attr_preparse, item);
+
 /* Prototypes. */
 extern void bgp_attr_init(void);
 extern void bgp_attr_finish(void);
 extern enum bgp_attr_parse_ret
 bgp_attr_parse(struct peer *peer, struct attr *attr, bgp_size_t size,
 	       struct bgp_nlri *mp_update, struct bgp_nlri *mp_withdraw);
+extern struct bgp_attr_preparse *bgp_attr_preparse(struct peer *peer,
+						  struct stream *pkt);
+extern struct bgp_attr_preparse *bgp_attr_preparse_pop(struct peer *peer,
+						      struct stream *pkt);
+extern void bgp_attr_preparse_free(struct bgp_attr_preparse **pre);
+extern void bgp_attr_preparse_flush(struct peer *peer);
 extern struct attr *bgp_attr_intern(struct attr *attr);
 extern void bgp_attr_unintern_sub(struct attr *attr);
 extern void bgp_attr_unintern(struct attr **pattr);
@@ -18,6 +18,7 @@
  */
 
 #include <zebra.h>
+#include <sys/uio.h>
 
 #include "log.h"
 #include "stream.h"
@@ -27,7 +28,7 @@
 #include "thread.h"
 #include "linklist.h"
 #include "queue.h"
-#include "pullwr.h"
+#include "frr_pthread.h"
 #include "memory.h"
 #include "network.h"
 #include "filter.h"
@@ -42,6 +43,8 @@
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_dump.h"
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_packet.h"
@@ -51,6 +54,7 @@
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_network.h"
+#include "bgpd/bgp_open.h"
 
 static void bmp_close(struct bmp *bmp);
 static struct bmp_bgp *bmp_bgp_find(struct bgp *bgp);
@@ -59,6 +63,8 @@ static struct bmp_bgp_peer *bmp_bgp_peer_find(uint64_t peerid);
 static struct bmp_bgp_peer *bmp_bgp_peer_get(struct peer *peer);
 static void bmp_active_disconnected(struct bmp_active *ba);
 static void bmp_active_put(struct bmp_active *ba);
+static void bmp_fill(struct thread *t);
+static void bmp_wrerr_event(struct thread *t);
 
 DEFINE_MGROUP(BMP, "BMP (BGP Monitoring Protocol)");
 
@@ -73,6 +79,21 @@ DEFINE_MTYPE_STATIC(BMP, BMP,		"BMP instance state");
 DEFINE_MTYPE_STATIC(BMP, BMP_MIRRORQ,	"BMP route mirroring buffer");
 DEFINE_MTYPE_STATIC(BMP, BMP_PEER,	"BMP per BGP peer data");
 DEFINE_MTYPE_STATIC(BMP, BMP_OPEN,	"BMP stored BGP OPEN message");
+DEFINE_MTYPE_STATIC(BMP, BMP_MSG,	"BMP encoded message");
+DEFINE_MTYPE_STATIC(BMP, BMP_OUTQ,	"BMP output queue item");
+
+/* stop encoding for a session above this many queued bytes, resume below
+ * BMP_OUTQ_LOW; most of this is shared between sessions anyway.
+ */
+#define BMP_OUTQ_HIGH		(256 * 1024)
+#define BMP_OUTQ_LOW		(64 * 1024)
+/* max µs to spend encoding for one session before yielding */
+#define BMP_FILL_MAXSPIN	2500
+/* max messages per writev() */
+#define BMP_WRITE_BATCH		64
+
+/* socket writes for all sessions */
+static struct frr_pthread *bmp_pth;
 
 DEFINE_QOBJ_TYPE(bmp_targets);
 
@@ -152,6 +173,8 @@ DECLARE_SORTLIST_UNIQ(bmp_targets, struct bmp_targets, bti, bmp_targets_cmp);
 
 DECLARE_LIST(bmp_session, struct bmp, bsi);
 
+DECLARE_DLIST(bmp_outq, struct bmp_outmsg, boi);
+
 DECLARE_DLIST(bmp_qlist, struct bmp_queue_entry, bli);
 
 static int bmp_qhash_cmp(const struct bmp_queue_entry *a,
@@ -237,6 +260,9 @@ static struct bmp *bmp_new(struct bmp_targets *bt, int bmp_sock)
 	new->targets = bt;
 	new->socket = bmp_sock;
 	new->syncafi = AFI_MAX;
+	pthread_mutex_init(&new->outq_mtx, NULL);
+	bmp_outq_init(&new->outq);
+	bmp_pthread_start();
 
 	FOREACH_AFI_SAFI (afi, safi) {
 		new->afistate[afi][safi] = bt->afimon[afi][safi]
@@ -250,9 +276,172 @@ static struct bmp *bmp_new(struct bmp_targets *bt, int bmp_sock)
 static void bmp_free(struct bmp *bmp)
 {
 	bmp_session_del(&bmp->targets->sessions, bmp);
+	bmp_outq_fini(&bmp->outq);
+	pthread_mutex_destroy(&bmp->outq_mtx);
 	XFREE(MTYPE_BMP_CONN, bmp);
 }
 
+/* the pthread can't be started before daemonizing, so this is done when
+ * the first session comes up
+ */
+static void bmp_pthread_start(void)
+{
+	if (atomic_load_explicit(&bmp_pth->running, memory_order_relaxed))
+		return;
+
+	frr_pthread_run(bmp_pth, NULL);
+	frr_pthread_wait_running(bmp_pth);
+}
+
+/* takes ownership of the streams */
+static struct bmp_msg *bmp_msg_new(struct stream *hdr, struct stream *body)
+{
+	struct bmp_msg *msg = XCALLOC(MTYPE_BMP_MSG, sizeof(*msg));
+
+	stream_chain_init(&msg->chain, 0);
+	if (hdr)
+		stream_chain_append(&msg->chain, hdr);
+	if (body)
+		stream_chain_append(&msg->chain, body);
+	atomic_store_explicit(&msg->refcount, 1, memory_order_relaxed);
+	return msg;
+}
+
+static void bmp_msg_put(struct bmp_msg **msgp)
+{
+	struct bmp_msg *msg = *msgp;
+
+	if (!msg)
+		return;
+	*msgp = NULL;
+
+	if (atomic_fetch_sub_explicit(&msg->refcount, 1, memory_order_acq_rel)
+	    > 1)
+		return;
+
+	stream_chain_reset(&msg->chain);
+	XFREE(MTYPE_BMP_MSG, msg);
+}
+
+/* runs on the BMP I/O pthread; everything but outq, its entries' pos and
+ * the atomics is off limits here.
+ */
+static void bmp_write(struct thread *t)
+{
+	struct bmp *bmp = THREAD_ARG(t);
+	struct bmp_outmsg *om, *oms[BMP_WRITE_BATCH];
+	struct iovec iov[2 * BMP_WRITE_BATCH];
+	unsigned int count = 0, done, iovsz = 0, i;
+	size_t prev, rem;
+	ssize_t nwr, num;
+	bool more;
+
+	/* only this pthread removes items, so they stay valid unlocked */
+	frr_with_mutex (&bmp->outq_mtx) {
+		frr_each (bmp_outq, &bmp->outq, om) {
+			if (count == array_size(oms))
+				break;
+			oms[count++] = om;
+		}
+	}
+	if (!count)
+		return;
+
+	/* a message that doesn't fit entirely is the last one this time */
+	for (i = 0; i < count && iovsz < array_size(iov); i++)
+		iovsz += stream_chain_iov(&oms[i]->msg->chain, oms[i]->pos,
+					  &iov[iovsz], array_size(iov) - iovsz);
+	count = i;
+
+	nwr = writev(bmp->socket, iov, iovsz);
+	if (nwr <= 0) {
+		if (nwr < 0 && ERRNO_IO_RETRY(errno)) {
+			thread_add_write(bmp_pth->master, bmp_write, bmp,
+					 bmp->socket, &bmp->t_write);
+			return;
+		}
+
+		/* 0 for EOF */
+		atomic_store_explicit(&bmp->wr_errno, nwr < 0 ? errno : 0,
+				      memory_order_relaxed);
+		thread_add_event(bm->master, bmp_wrerr_event, bmp, 0,
+				 &bmp->t_err);
+		return;
+	}
+
+	atomic_fetch_add_explicit(&bmp->cnt_bytes, nwr, memory_order_relaxed);
+	prev = atomic_fetch_sub_explicit(&bmp->outq_bytes, nwr,
+					 memory_order_relaxed);
+
+	num = nwr;
+	for (done = 0; done < count; done++) {
+		om = oms[done];
+		rem = stream_chain_len(&om->msg->chain) - om->pos;
+		if ((size_t)num < rem) {
+			om->pos += num;
+			break;
+		}
+		num -= rem;
+	}
+
+	frr_with_mutex (&bmp->outq_mtx) {
+		for (i = 0; i < done; i++)
+			bmp_outq_del(&bmp->outq, oms[i]);
+		more = bmp_outq_count(&bmp->outq) > 0;
+	}
+
+	for (i = 0; i < done; i++) {
+		bmp_msg_put(&oms[i]->msg);
+		XFREE(MTYPE_BMP_OUTQ, oms[i]);
+	}
+
+	if (prev >= BMP_OUTQ_LOW && prev - nwr < BMP_OUTQ_LOW)
+		thread_add_event(bm->master, bmp_fill, bmp, 0, &bmp->t_fill);
+	if (more)
+		thread_add_write(bmp_pth->master, bmp_write, bmp, bmp->socket,
+				 &bmp->t_write);
+}
+
+/* queue msg on the session, with a reference of its own */
+static void bmp_send(struct bmp *bmp, struct bmp_msg *msg)
+{
+	struct bmp_outmsg *om;
+	size_t qlen;
+
+	om = XCALLOC(MTYPE_BMP_OUTQ, sizeof(*om));
+	atomic_fetch_add_explicit(&msg->refcount, 1, memory_order_relaxed);
+	om->msg = msg;
+
+	/* counted before queueing so the writer can't take it below 0 */
+	qlen = atomic_fetch_add_explicit(&bmp->outq_bytes,
+					 stream_chain_len(&msg->chain),
+					 memory_order_relaxed)
+	       + stream_chain_len(&msg->chain);
+	bmp->outq_max = MAX(bmp->outq_max, qlen);
+
+	frr_with_mutex (&bmp->outq_mtx) {
+		bmp_outq_add_tail(&bmp->outq, om);
+	}
+
+	thread_add_write(bmp_pth->master, bmp_write, bmp, bmp->socket,
+			 &bmp->t_write);
+}
+
+/* takes ownership of the streams */
+static void bmp_send_stream(struct bmp *bmp, struct stream *hdr,
+			    struct stream *body)
+{
+	struct bmp_msg *msg = bmp_msg_new(hdr, body);
+
+	bmp_send(bmp, msg);
+	bmp_msg_put(&msg);
+}
+
+static void bmp_bump(struct bmp *bmp)
+{
+	thread_add_event(bm->master, bmp_fill, bmp, 0, &bmp->t_fill);
+}
+
 static void bmp_common_hdr(struct stream *s, uint8_t ver, uint8_t type)
 {
 	stream_putc(s, ver);
@@ -268,10 +457,12 @@ static void bmp_per_peer_hdr(struct stream *s, struct peer *peer,
 #define BMP_PEER_TYPE_GLOBAL_INSTANCE 0
 #define BMP_PEER_TYPE_RD_INSTANCE     1
 #define BMP_PEER_TYPE_LOCAL_INSTANCE  2
+#define BMP_PEER_TYPE_LOC_RIB_INSTANCE 3
 
 #define BMP_PEER_FLAG_V (1 << 7)
 #define BMP_PEER_FLAG_L (1 << 6)
 #define BMP_PEER_FLAG_A (1 << 5)
+#define BMP_PEER_FLAG_O (1 << 4)
 
 	/* Peer Type */
 	stream_putc(s, BMP_PEER_TYPE_GLOBAL_INSTANCE);
@@ -318,6 +509,43 @@ static void bmp_per_peer_hdr(struct stream *s, struct peer *peer,
 	}
 }
 
+/* RFC 9069 4.1, the "peer" is the BGP instance itself */
+static void bmp_locrib_hdr(struct stream *s, struct bgp *bgp, uint8_t flags,
+			   const struct timeval *tv)
+{
+	/* Peer Type */
+	stream_putc(s, BMP_PEER_TYPE_LOC_RIB_INSTANCE);
+
+	/* Peer Flags, F (filtered) is never set */
+	stream_putc(s, flags);
+
+	/* Peer Distinguisher, anything unique to the instance */
+	stream_putl(s, 0);
+	stream_putl(s, bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT
+			       ? 0 : bgp->vrf_id);
+
+	/* Peer Address, zero */
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+	stream_putl(s, 0);
+
+	/* Peer AS */
+	stream_putl(s, bgp->as);
+
+	/* Peer BGP ID */
+	stream_put_in_addr(s, &bgp->router_id);
+
+	/* Timestamp */
+	if (tv) {
+		stream_putl(s, tv->tv_sec);
+		stream_putl(s, tv->tv_usec);
+	} else {
+		stream_putl(s, 0);
+		stream_putl(s, 0);
+	}
+}
+
 static void bmp_put_info_tlv(struct stream *s, uint16_t type,
 		const char *string)
 {
@@ -343,8 +571,7 @@ static int bmp_send_initiation(struct bmp *bmp)
 	len = stream_get_endp(s);
 	stream_putl_at(s, BMP_LENGTH_POS, len); //message length is set.
 
-	pullwr_write_stream(bmp->pullwr, s);
-	stream_free(s);
+	bmp_send_stream(bmp, s, NULL);
 	return 0;
 }
 
@@ -477,6 +704,114 @@ static struct stream *bmp_peerstate(struct peer *peer, bool down)
 	return s;
 }
 
+static bool bmp_targets_locrib(struct bmp_targets *bt)
+{
+	afi_t afi;
+	safi_t safi;
+
+	FOREACH_AFI_SAFI (afi, safi)
+		if (bt->afimon[afi][safi] & BMP_MON_LOC_RIB)
+			return true;
+	return false;
+}
+
+/* RFC 9069 5.3, there is no actual session so the OPEN is made up */
+static void bmp_locrib_open(struct stream *s, struct bmp_targets *bt)
+{
+	struct bgp *bgp = bt->bgp;
+	size_t start = stream_get_endp(s), optlen_pos, caplen_pos;
+	iana_afi_t pkt_afi;
+	iana_safi_t pkt_safi;
+	afi_t afi;
+	safi_t safi;
+
+	bgp_packet_set_marker(s, BGP_MSG_OPEN);
+	stream_putc(s, BGP_VERSION_4);
+	stream_putw(s, bgp->as > BGP_AS_MAX ? BGP_AS_TRANS : bgp->as);
+	stream_putw(s, 0);
+	stream_put_in_addr(s, &bgp->router_id);
+
+	optlen_pos = stream_get_endp(s);
+	stream_putc(s, 0);
+
+	stream_putc(s, BGP_OPEN_OPT_CAP);
+	caplen_pos = stream_get_endp(s);
+	stream_putc(s, 0);
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		if (!(bt->afimon[afi][safi] & BMP_MON_LOC_RIB))
+			continue;
+
+		bgp_map_afi_safi_int2iana(afi, safi, &pkt_afi, &pkt_safi);
+		stream_putc(s, CAPABILITY_CODE_MP);
+		stream_putc(s, CAPABILITY_CODE_MP_LEN);
+		stream_putw(s, pkt_afi);
+		stream_putc(s, 0);
+		stream_putc(s, pkt_safi);
+	}
+
+	stream_putc(s, CAPABILITY_CODE_AS4);
+	stream_putc(s, CAPABILITY_CODE_AS4_LEN);
+	stream_putl(s, bgp->as);
+
+	stream_putc_at(s, caplen_pos, stream_get_endp(s) - caplen_pos - 1);
+	stream_putc_at(s, optlen_pos, stream_get_endp(s) - optlen_pos - 1);
+	stream_putw_at(s, start + BGP_MARKER_SIZE, stream_get_endp(s) - start);
+}
+
+static struct stream *bmp_locrib_peerstate(struct bmp_targets *bt, bool down)
+{
+	struct bgp *bgp = bt->bgp;
+	struct stream *s;
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	s = stream_new(BGP_MAX_PACKET_SIZE);
+
+	if (!down) {
+		bmp_common_hdr(s, BMP_VERSION_3,
+				BMP_TYPE_PEER_UP_NOTIFICATION);
+		bmp_locrib_hdr(s, bgp, 0, &tv);
+
+		/* Local Address, Local Port, Remote Port: all zero */
+		stream_putl(s, 0);
+		stream_putl(s, 0);
+		stream_putl(s, 0);
+		stream_putl(s, 0);
+		stream_putw(s, 0);
+		stream_putw(s, 0);
+
+		/* same OPEN as "sent" and "received" */
+		bmp_locrib_open(s, bt);
+		bmp_locrib_open(s, bt);
+
+#define BMP_INFO_TYPE_VRF_NAME	3
+		bmp_put_info_tlv(s, BMP_INFO_TYPE_VRF_NAME,
+				 bgp->name ? bgp->name : VRF_DEFAULT_NAME);
+	} else {
+		bmp_common_hdr(s, BMP_VERSION_3,
+				BMP_TYPE_PEER_DOWN_NOTIFICATION);
+		bmp_locrib_hdr(s, bgp, 0, &tv);
+		stream_putc(s, BMP_PEERDOWN_DECONFIGURED);
+	}
+
+	stream_putl_at(s, BMP_LENGTH_POS, stream_get_endp(s));
+	return s;
+}
+
+/* Loc-RIB monitoring was enabled or disabled on a running session */
+static void bmp_locrib_update(struct bmp *bmp)
+{
+	bool want = bmp_targets_locrib(bmp->targets);
+
+	if (bmp->state != BMP_Run || want == bmp->locrib_up)
+		return;
+
+	bmp_send_stream(bmp, bmp_locrib_peerstate(bmp->targets, !want), NULL);
+	bmp->locrib_up = want;
+}
+
 
 static int bmp_send_peerup(struct bmp *bmp)
 {
@@ -487,23 +822,28 @@ static int bmp_send_peerup(struct bmp *bmp)
 	/* Walk down all peers */
 	for (ALL_LIST_ELEMENTS_RO(bmp->targets->bgp->peer, node, peer)) {
 		s = bmp_peerstate(peer, false);
-		pullwr_write_stream(bmp->pullwr, s);
-		stream_free(s);
+		bmp_send_stream(bmp, s, NULL);
 	}
 
+	bmp->locrib_up = bmp_targets_locrib(bmp->targets);
+	if (bmp->locrib_up)
+		bmp_send_stream(bmp, bmp_locrib_peerstate(bmp->targets, false),
+				NULL);
+
 	return 0;
 }
 
-/* XXX: kludge - filling the pullwr's buffer */
+/* one message, queued to all sessions; takes ownership of s */
 static void bmp_send_all(struct bmp_bgp *bmpbgp, struct stream *s)
 {
 	struct bmp_targets *bt;
 	struct bmp *bmp;
+	struct bmp_msg *msg = bmp_msg_new(s, NULL);
 
 	frr_each(bmp_targets, &bmpbgp->targets, bt)
 		frr_each(bmp_session, &bt->sessions, bmp)
-			pullwr_write_stream(bmp->pullwr, s);
-	stream_free(s);
+			bmp_send(bmp, msg);
+	bmp_msg_put(&msg);
 }
 
 /*
@@ -516,6 +856,12 @@ static void bmp_send_all(struct bmp_bgp *bmpbgp, struct stream *s)
 #define BMP_MIRROR_INFO_CODE_ERRORPDU   0
 #define BMP_MIRROR_INFO_CODE_LOSTMSGS   1
 
+static void bmp_mirrorq_free(struct bmp_mirrorq *bmq)
+{
+	bmp_msg_put(&bmq->msg);
+	XFREE(MTYPE_BMP_MIRRORQ, bmq);
+}
+
 static struct bmp_mirrorq *bmp_pull_mirror(struct bmp *bmp)
 {
 	struct bmp_mirrorq *bmq;
@@ -551,15 +897,16 @@ static void bmp_mirror_cull(struct bmp_bgp *bmpbgp)
 					continue;
 
 				while ((inner = bmp_pull_mirror(bmp))) {
+					bmp->cnt_mirror_dropped++;
+					bt->cnt_mirror_dropped++;
 					if (!inner->refcount)
-						XFREE(MTYPE_BMP_MIRRORQ,
-								inner);
+						bmp_mirrorq_free(inner);
 				}
 
 				zlog_warn("bmp[%s] lost mirror messages due to buffer size limit",
 						bmp->remote);
 				bmp->mirror_lost = true;
-				pullwr_bump(bmp->pullwr);
+				bmp_bump(bmp);
 			}
 		}
 	}
@@ -573,6 +920,7 @@ static int bmp_mirror_packet(struct peer *peer, uint8_t type, bgp_size_t size,
 	struct bmp_mirrorq *qitem;
 	struct bmp_targets *bt;
 	struct bmp *bmp;
+	struct stream *s;
 
 	frrtrace(3, frr_bgp, bmp_mirror_packet, peer, type, packet);
 
@@ -591,11 +939,10 @@ static int bmp_mirror_packet(struct peer *peer, uint8_t type, bgp_size_t size,
 	if (!bmpbgp)
 		return 0;
 
-	qitem = XCALLOC(MTYPE_BMP_MIRRORQ, sizeof(*qitem) + size);
+	qitem = XCALLOC(MTYPE_BMP_MIRRORQ, sizeof(*qitem));
 	qitem->peerid = peer->qobj_node.nid;
 	qitem->tv = tv;
 	qitem->len = size;
-	memcpy(qitem->data, packet->data, size);
 
 	frr_each(bmp_targets, &bmpbgp->targets, bt) {
 		if (!bt->mirror)
@@ -604,12 +951,17 @@ static int bmp_mirror_packet(struct peer *peer, uint8_t type, bgp_size_t size,
 			qitem->refcount++;
 			if (!bmp->mirrorpos)
 				bmp->mirrorpos = qitem;
-			pullwr_bump(bmp->pullwr);
+			bmp_bump(bmp);
 		}
 	}
 	if (qitem->refcount == 0)
 		XFREE(MTYPE_BMP_MIRRORQ, qitem);
 	else {
+		/* the only copy of the packet, shared by all sessions */
+		s = stream_new(size);
+		stream_put(s, packet->data, size);
+		qitem->msg = bmp_msg_new(NULL, s);
+
 		bmpbgp->mirror_qsize += sizeof(*qitem) + size;
 		bmp_mirrorq_add_tail(&bmpbgp->mirrorq, qitem);
 
@@ -621,7 +973,7 @@ static int bmp_mirror_packet(struct peer *peer, uint8_t type, bgp_size_t size,
 	return 0;
 }
 
-static void bmp_wrmirror_lost(struct bmp *bmp, struct pullwr *pullwr)
+static void bmp_wrmirror_lost(struct bmp *bmp)
 {
 	struct stream *s;
 	struct timeval tv;
@@ -639,18 +991,16 @@ static void bmp_wrmirror_lost(struct bmp *bmp, struct pullwr *pullwr)
 	stream_putl_at(s, BMP_LENGTH_POS, stream_get_endp(s));
 
 	bmp->cnt_mirror_overruns++;
-	pullwr_write_stream(bmp->pullwr, s);
-	stream_free(s);
+	bmp_send_stream(bmp, s, NULL);
 }
 
-static bool bmp_wrmirror(struct bmp *bmp, struct pullwr *pullwr)
+static bool bmp_wrmirror(struct bmp *bmp)
 {
 	struct bmp_mirrorq *bmq;
 	struct peer *peer;
-	bool written = false;
 
 	if (bmp->mirror_lost) {
-		bmp_wrmirror_lost(bmp, pullwr);
+		bmp_wrmirror_lost(bmp);
 		bmp->mirror_lost = false;
 		return true;
 	}
@@ -665,28 +1015,31 @@ static bool bmp_wrmirror(struct bmp *bmp, struct pullwr *pullwr)
 		goto out;
 	}
 
-	struct stream *s;
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	/* header is the same for every session, first one adds it */
+	if (stream_chain_len(&bmq->msg->chain) == bmq->len) {
+		struct stream *s;
 
-	bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_ROUTE_MIRRORING);
-	bmp_per_peer_hdr(s, peer, 0, &bmq->tv);
+		s = stream_new(BGP_MAX_PACKET_SIZE);
 
-	/* BMP Mirror TLV. */
-	stream_putw(s, BMP_MIRROR_TLV_TYPE_BGP_MESSAGE);
-	stream_putw(s, bmq->len);
-	stream_putl_at(s, BMP_LENGTH_POS, stream_get_endp(s) + bmq->len);
+		bmp_common_hdr(s, BMP_VERSION_3, BMP_TYPE_ROUTE_MIRRORING);
+		bmp_per_peer_hdr(s, peer, 0, &bmq->tv);
 
-	bmp->cnt_mirror++;
-	pullwr_write_stream(bmp->pullwr, s);
-	pullwr_write(bmp->pullwr, bmq->data, bmq->len);
+		/* BMP Mirror TLV. */
+		stream_putw(s, BMP_MIRROR_TLV_TYPE_BGP_MESSAGE);
+		stream_putw(s, bmq->len);
+		stream_putl_at(s, BMP_LENGTH_POS,
+			       stream_get_endp(s) + bmq->len);
 
-	stream_free(s);
-	written = true;
+		stream_chain_prepend(&bmq->msg->chain, s);
+	}
+
+	bmp->cnt_mirror++;
+	bmp_send(bmp, bmq->msg);
 
 out:
 	if (!bmq->refcount)
-		XFREE(MTYPE_BMP_MIRRORQ, bmq);
-	return written;
+		bmp_mirrorq_free(bmq);
+	return true;
 }
 
 static int bmp_outgoing_packet(struct peer *peer, uint8_t type, bgp_size_t size,
@@ -774,7 +1127,187 @@ static int bmp_peer_backward(struct peer *peer)
 	return 0;
 }
 
-static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
+/*
+ * Route Monitoring
+ *
+ * Prefixes with the same peer and attributes are put into one UPDATE, so
+ * the attributes are only encoded once for all of them.
+ */
+static void bmp_batch_flush(struct bmp *bmp, struct bmp_batch *b)
+{
+	struct stream *s = b->s, *hdr;
+	struct timeval tv = { .tv_sec = b->uptime, .tv_usec = 0 };
+	struct timeval uptime_real;
+	bool mp = !(b->afi == AFI_IP && b->safi == SAFI_UNICAST);
+
+	if (b->attr && !mp) {
+		stream_putw_at(s, b->attrlen_pos, b->attrlen);
+	} else if (b->attr) {
+		bgp_packet_mpattr_end(s, b->mplen_pos);
+		stream_putw_at(s, b->attrlen_pos,
+			       b->attrlen + stream_get_endp(s) - b->mp_start);
+	} else if (!mp) {
+		stream_putw_at(s, BGP_HEADER_SIZE,
+			       stream_get_endp(s) - BGP_HEADER_SIZE
+				       - BGP_UNFEASIBLE_LEN);
+		/* Total Path Attribute Length */
+		stream_putw(s, 0);
+	} else {
+		bgp_packet_mpunreach_end(s, b->mplen_pos);
+		stream_putw_at(s, b->attrlen_pos,
+			       stream_get_endp(s) - b->mp_start);
+	}
+	bgp_packet_set_size(s);
+
+	monotime_to_realtime(&tv, &uptime_real);
+
+	hdr = stream_new(BGP_MAX_PACKET_SIZE);
+	bmp_common_hdr(hdr, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
+	if (b->locrib)
+		bmp_locrib_hdr(hdr, bmp->targets->bgp, b->flags, &uptime_real);
+	else
+		bmp_per_peer_hdr(hdr, b->peer, b->flags, &uptime_real);
+
+	stream_putl_at(hdr, BMP_LENGTH_POS,
+			stream_get_endp(hdr) + stream_get_endp(s));
+
+	bmp->cnt_update++;
+	bmp_send_stream(bmp, hdr, s);
+
+	if (b->attr)
+		bgp_attr_unintern(&b->attr);
+
+	/* the order of open batches doesn't matter */
+	*b = bmp->batch[--bmp->nbatch];
+}
+
+static void bmp_batch_flush_all(struct bmp *bmp)
+{
+	while (bmp->nbatch)
+		bmp_batch_flush(bmp, &bmp->batch[0]);
+}
+
+static void bmp_batch_drop_all(struct bmp *bmp)
+{
+	struct bmp_batch *b;
+
+	while (bmp->nbatch) {
+		b = &bmp->batch[--bmp->nbatch];
+		stream_free(b->s);
+		if (b->attr)
+			bgp_attr_unintern(&b->attr);
+	}
+}
+
+static void bmp_batch_start(struct bmp_batch *b)
+{
+	struct bpacket_attr_vec_arr vecarr;
+	struct stream *s;
+	bool mp = !(b->afi == AFI_IP && b->safi == SAFI_UNICAST);
+
+	s = b->s = stream_new(BGP_MAX_PACKET_SIZE);
+	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
+
+	/* Withdrawn Routes Length, fixed up on flush */
+	stream_putw(s, 0);
+
+	b->count = 0;
+	b->attrlen = 0;
+
+	if (b->attr) {
+		bpacket_attr_vec_arr_reset(&vecarr);
+
+		b->attrlen_pos = stream_get_endp(s);
+		stream_putw(s, 0);
+
+		/* all the attributes, except MP_REACH_NLRI */
+		b->attrlen = bgp_packet_attribute(NULL, b->peer, s, b->attr,
+						  &vecarr, NULL, b->afi,
+						  b->safi, b->peer, NULL, NULL,
+						  0, 0, 0);
+
+		/* peer_cap_enhe & add-path removed, MPLS too */
+		if (mp) {
+			b->mp_start = stream_get_endp(s);
+			b->mplen_pos = bgp_packet_mpattr_start(s, b->peer,
+							       b->afi, b->safi,
+							       &vecarr,
+							       b->attr);
+		}
+	} else if (mp) {
+		b->attrlen_pos = stream_get_endp(s);
+		stream_putw(s, 0);
+		b->mp_start = stream_get_endp(s);
+		b->mplen_pos = bgp_packet_mpunreach_start(s, b->afi, b->safi);
+	}
+}
+
+static struct bmp_batch *bmp_batch_get(struct bmp *bmp, bool locrib,
+				       struct peer *peer, uint8_t flags,
+				       struct attr *attr, afi_t afi,
+				       safi_t safi, time_t uptime)
+{
+	struct bmp_batch *b;
+	unsigned int i;
+
+	for (i = 0; i < bmp->nbatch; i++) {
+		b = &bmp->batch[i];
+		if (b->locrib == locrib && b->peer == peer
+		    && b->flags == flags && b->attr == attr && b->afi == afi
+		    && b->safi == safi)
+			return b;
+	}
+
+	if (bmp->nbatch == BMP_BATCH_MAX)
+		bmp_batch_flush(bmp, &bmp->batch[0]);
+
+	b = &bmp->batch[bmp->nbatch++];
+	memset(b, 0, sizeof(*b));
+	b->locrib = locrib;
+	b->peer = peer;
+	b->flags = flags;
+	b->attr = attr ? bgp_attr_intern(attr) : NULL;
+	b->afi = afi;
+	b->safi = safi;
+	b->uptime = uptime;
+	bmp_batch_start(b);
+	return b;
+}
+
+static void bmp_monitor(struct bmp *bmp, bool locrib, struct peer *peer,
+			uint8_t flags, const struct prefix *p,
+			struct prefix_rd *prd, struct attr *attr, afi_t afi,
+			safi_t safi, time_t uptime)
+{
+	struct bmp_batch *b;
+	struct stream *s;
+
+	b = bmp_batch_get(bmp, locrib, peer, flags, attr, afi, safi, uptime);
+	if (b->count
+	    && STREAM_WRITEABLE(b->s) < bgp_packet_mpattr_prefix_size(afi, safi,
+								     p)
+						+ BGP_UNFEASIBLE_LEN) {
+		bmp_batch_flush(bmp, b);
+		b = bmp_batch_get(bmp, locrib, peer, flags, attr, afi, safi,
+				  uptime);
+	}
+	s = b->s;
+
+	if (afi == AFI_IP && safi == SAFI_UNICAST)
+		stream_put_prefix(s, p);
+	else if (attr)
+		bgp_packet_mpattr_prefix(s, afi, safi, p, prd, NULL, 0, 0, 0,
+					 attr);
+	else
+		bgp_packet_mpunreach_prefix(s, p, afi, safi, prd, NULL, 0, 0, 0,
+					    NULL);
+
+	b->count++;
+	bmp->cnt_update_pfx++;
+}
+
+static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags,
+		    bool locrib)
 {
 	struct peer *peer;
 	struct listnode *node;
@@ -784,6 +1317,9 @@ static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
 
 	frrtrace(3, frr_bgp, bmp_eor, afi, safi, flags);
 
+	/* anything batched for the table has to go out before its EoR */
+	bmp_batch_flush_all(bmp);
+
 	s = stream_new(BGP_MAX_PACKET_SIZE);
 
 	/* Make BGP update packet. */
@@ -810,6 +1346,20 @@ static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
 
 	bgp_packet_set_size(s);
 
+	if (locrib) {
+		s2 = stream_new(BGP_MAX_PACKET_SIZE);
+
+		bmp_common_hdr(s2, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
+		bmp_locrib_hdr(s2, bmp->targets->bgp, flags, NULL);
+
+		stream_putl_at(s2, BMP_LENGTH_POS,
+				stream_get_endp(s) + stream_get_endp(s2));
+
+		bmp->cnt_update++;
+		bmp_send_stream(bmp, s2, s);
+		return;
+	}
+
 	for (ALL_LIST_ELEMENTS_RO(bmp->targets->bgp->peer, node, peer)) {
 		if (!peer->afc_nego[afi][safi])
 			continue;
@@ -824,133 +1374,89 @@ static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags)
 				stream_get_endp(s) + stream_get_endp(s2));
 
 		bmp->cnt_update++;
-		pullwr_write_stream(bmp->pullwr, s2);
-		pullwr_write_stream(bmp->pullwr, s);
-		stream_free(s2);
+		bmp_send_stream(bmp, s2, stream_dup(s));
 	}
 	stream_free(s);
 }
 
-static struct stream *bmp_update(const struct prefix *p, struct prefix_rd *prd,
-				 struct peer *peer, struct attr *attr,
-				 afi_t afi, safi_t safi)
+static struct bgp_path_info *bmp_bestpath(struct bgp_dest *bn)
 {
-	struct bpacket_attr_vec_arr vecarr;
-	struct stream *s;
-	size_t attrlen_pos = 0, mpattrlen_pos = 0;
-	bgp_size_t total_attr_len = 0;
-
-	bpacket_attr_vec_arr_reset(&vecarr);
-
-	s = stream_new(BGP_MAX_PACKET_SIZE);
-	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
-
-	/* 2: withdrawn routes length */
-	stream_putw(s, 0);
-
-	/* 3: total attributes length - attrlen_pos stores the position */
-	attrlen_pos = stream_get_endp(s);
-	stream_putw(s, 0);
-
-	/* 5: Encode all the attributes, except MP_REACH_NLRI attr. */
-	total_attr_len = bgp_packet_attribute(NULL, peer, s, attr,
-			&vecarr, NULL, afi, safi, peer, NULL, NULL, 0, 0, 0);
+	struct bgp_path_info *bpi;
 
-	/* space check? */
-
-	/* peer_cap_enhe & add-path removed */
-	if (afi == AFI_IP && safi == SAFI_UNICAST)
-		stream_put_prefix(s, p);
-	else {
-		size_t p1 = stream_get_endp(s);
-
-		/* MPLS removed for now */
-
-		mpattrlen_pos = bgp_packet_mpattr_start(s, peer, afi, safi,
-				&vecarr, attr);
-		bgp_packet_mpattr_prefix(s, afi, safi, p, prd, NULL, 0, 0, 0,
-					 attr);
-		bgp_packet_mpattr_end(s, mpattrlen_pos);
-		total_attr_len += stream_get_endp(s) - p1;
-	}
-
-	/* set the total attribute length correctly */
-	stream_putw_at(s, attrlen_pos, total_attr_len);
-	bgp_packet_set_size(s);
-	return s;
+	for (bpi = bn ? bgp_dest_get_bgp_path_info(bn) : NULL; bpi;
+	     bpi = bpi->next)
+		if (CHECK_FLAG(bpi->flags, BGP_PATH_SELECTED))
+			return bpi;
+	return NULL;
 }
 
-static struct stream *bmp_withdraw(const struct prefix *p,
-				   struct prefix_rd *prd, afi_t afi,
-				   safi_t safi)
+/* whether bn has been advertised to peer */
+static bool bmp_adjout_has(struct peer *peer, struct bgp_dest *bn, afi_t afi,
+			   safi_t safi)
 {
-	struct stream *s;
-	size_t attrlen_pos = 0, mp_start, mplen_pos;
-	bgp_size_t total_attr_len = 0;
-	bgp_size_t unfeasible_len;
+	struct peer_af *paf = peer_af_find(peer, afi, safi);
+	struct bgp_adj_out *adj;
 
-	s = stream_new(BGP_MAX_PACKET_SIZE);
+	if (!paf || !paf->subgroup)
+		return false;
 
-	bgp_packet_set_marker(s, BGP_MSG_UPDATE);
-	stream_putw(s, 0);
+	RB_FOREACH (adj, bgp_adj_out_rb, &bn->adj_out)
+		if (adj->subgroup == paf->subgroup && adj->attr)
+			return true;
 
-	if (afi == AFI_IP && safi == SAFI_UNICAST) {
-		stream_put_prefix(s, p);
-		unfeasible_len = stream_get_endp(s) - BGP_HEADER_SIZE
-				 - BGP_UNFEASIBLE_LEN;
-		stream_putw_at(s, BGP_HEADER_SIZE, unfeasible_len);
-		stream_putw(s, 0);
-	} else {
-		attrlen_pos = stream_get_endp(s);
-		/* total attr length = 0 for now. reevaluate later */
-		stream_putw(s, 0);
-		mp_start = stream_get_endp(s);
-		mplen_pos = bgp_packet_mpunreach_start(s, afi, safi);
+	return CHECK_FLAG(paf->subgroup->sflags, SUBGRP_STATUS_ADJ_COMPACT)
+	       && bgp_adj_out_compact_advertised(paf->subgroup, bn);
+}
 
-		bgp_packet_mpunreach_prefix(s, p, afi, safi, prd, NULL, 0, 0, 0,
-					    NULL);
-		/* Set the mp_unreach attr's length */
-		bgp_packet_mpunreach_end(s, mplen_pos);
+/* next peer after syncpeerid that bn has been advertised to */
+static struct peer *bmp_adjout_next(struct bmp *bmp, struct bgp_dest *bn,
+				    afi_t afi, safi_t safi)
+{
+	struct peer *peer, *found = NULL;
+	struct listnode *node;
 
-		/* Set total path attribute length. */
-		total_attr_len = stream_get_endp(s) - mp_start;
-		stream_putw_at(s, attrlen_pos, total_attr_len);
+	for (ALL_LIST_ELEMENTS_RO(bmp->targets->bgp->peer, node, peer)) {
+		if (peer->qobj_node.nid <= bmp->syncpeerid)
+			continue;
+		if (found && peer->qobj_node.nid > found->qobj_node.nid)
+			continue;
+		if (!peer_established(peer) || !peer->afc_nego[afi][safi])
+			continue;
+		if (bmp_adjout_has(peer, bn, afi, safi))
+			found = peer;
 	}
-
-	bgp_packet_set_size(s);
-	return s;
+	return found;
 }
 
-static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
-			const struct prefix *p, struct prefix_rd *prd,
-			struct attr *attr, afi_t afi, safi_t safi,
-			time_t uptime)
+static void bmp_adjout_monitor(struct bmp *bmp, struct peer *peer,
+			       struct bgp_dest *bn, struct prefix_rd *prd,
+			       afi_t afi, safi_t safi)
 {
-	struct stream *hdr, *msg;
-	struct timeval tv = { .tv_sec = uptime, .tv_usec = 0 };
-	struct timeval uptime_real;
+	struct peer_af *paf = peer_af_find(peer, afi, safi);
+	struct bgp_adj_out *adj, *compact;
+	const struct prefix *p = bgp_dest_get_prefix(bn);
 
-	monotime_to_realtime(&tv, &uptime_real);
-	if (attr)
-		msg = bmp_update(p, prd, peer, attr, afi, safi);
-	else
-		msg = bmp_withdraw(p, prd, afi, safi);
+	compact = bgp_adj_out_compact_materialize(paf->subgroup, bn);
 
-	hdr = stream_new(BGP_MAX_PACKET_SIZE);
-	bmp_common_hdr(hdr, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
-	bmp_per_peer_hdr(hdr, peer, flags, &uptime_real);
+	RB_FOREACH (adj, bgp_adj_out_rb, &bn->adj_out) {
+		if (adj->subgroup != paf->subgroup || !adj->attr)
+			continue;
 
-	stream_putl_at(hdr, BMP_LENGTH_POS,
-			stream_get_endp(hdr) + stream_get_endp(msg));
+		bmp_monitor(bmp, false, peer,
+			    BMP_PEER_FLAG_O | BMP_PEER_FLAG_L, p, prd,
+			    adj->attr, afi, safi, peer->uptime);
+		break;
+	}
+	if (compact)
+		bmp_monitor(bmp, false, peer,
+			    BMP_PEER_FLAG_O | BMP_PEER_FLAG_L, p, prd,
+			    compact->attr, afi, safi, peer->uptime);
 
-	bmp->cnt_update++;
-	pullwr_write_stream(bmp->pullwr, hdr);
-	pullwr_write_stream(bmp->pullwr, msg);
-	stream_free(hdr);
-	stream_free(msg);
+	/* the batch holds its own reference on the attributes */
+	bgp_adj_out_compact_release(compact);
 }
 
-static bool bmp_wrsync(struct bmp *bmp, struct pullwr *pullwr)
+static bool bmp_wrsync(struct bmp *bmp)
 {
 	afi_t afi;
 	safi_t safi;
@@ -983,7 +1489,9 @@ afibreak:
 	afi = bmp->syncafi;
 	safi = bmp->syncsafi;
 
-	if (!bmp->targets->afimon[afi][safi]) {
+	uint8_t afimon = bmp->targets->afimon[afi][safi];
+
+	if (!afimon) {
 		/* shouldn't happen */
 		bmp->afistate[afi][safi] = BMP_AFI_INACTIVE;
 		bmp->syncafi = AFI_MAX;
@@ -993,8 +1501,11 @@ afibreak:
 
 	struct bgp_table *table = bmp->targets->bgp->rib[afi][safi];
 	struct bgp_dest *bn = NULL;
-	struct bgp_path_info *bpi = NULL, *bpiter;
+	struct bgp_path_info *bpi = NULL, *bpiter, *locrib = NULL;
 	struct bgp_adj_in *adjin = NULL, *adjiter;
+	struct peer *adjout = NULL;
+	uint64_t selfid = bmp->targets->bgp->peer_self->qobj_node.nid;
+	uint64_t nextid;
 
 	if ((afi == AFI_L2VPN && safi == SAFI_EVPN) ||
 	    (safi == SAFI_MPLS_VPN)) {
@@ -1049,8 +1560,15 @@ afibreak:
 				zlog_info("bmp[%s] %s %s table completed (EoR)",
 						bmp->remote, afi2str(afi),
 						safi2str(safi));
-				bmp_eor(bmp, afi, safi, BMP_PEER_FLAG_L);
-				bmp_eor(bmp, afi, safi, 0);
+				bmp_eor(bmp, afi, safi, BMP_PEER_FLAG_L, false);
+				bmp_eor(bmp, afi, safi, 0, false);
+				if (afimon & BMP_MON_ADJ_OUT)
+					bmp_eor(bmp, afi, safi,
+						BMP_PEER_FLAG_O
+							| BMP_PEER_FLAG_L,
+						false);
+				if (afimon & BMP_MON_LOC_RIB)
+					bmp_eor(bmp, afi, safi, 0, true);
 
 				bmp->afistate[afi][safi] = BMP_AFI_LIVE;
 				bmp->syncafi = AFI_MAX;
@@ -1061,7 +1579,12 @@ afibreak:
 			prefix_copy(&bmp->syncpos, bgp_dest_get_prefix(bn));
 		}
 
-		if (bmp->targets->afimon[afi][safi] & BMP_MON_POSTPOLICY) {
+		/* everything for one peer ID goes out in one step; Loc-RIB
+		 * uses the ID of peer_self
+		 */
+		nextid = UINT64_MAX;
+
+		if (afimon & BMP_MON_POSTPOLICY) {
 			for (bpiter = bgp_dest_get_bgp_path_info(bn); bpiter;
 			     bpiter = bpiter->next) {
 				if (!CHECK_FLAG(bpiter->flags, BGP_PATH_VALID))
@@ -1074,8 +1597,10 @@ afibreak:
 					continue;
 				bpi = bpiter;
 			}
+			if (bpi)
+				nextid = MIN(nextid, bpi->peer->qobj_node.nid);
 		}
-		if (bmp->targets->afimon[afi][safi] & BMP_MON_PREPOLICY) {
+		if (afimon & BMP_MON_PREPOLICY) {
 			for (adjiter = bn->adj_in; adjiter;
 			     adjiter = adjiter->next) {
 				if (adjiter->peer->qobj_node.nid
@@ -1086,26 +1611,35 @@ afibreak:
 					continue;
 				adjin = adjiter;
 			}
+			if (adjin)
+				nextid = MIN(nextid,
+					     adjin->peer->qobj_node.nid);
+		}
+		if ((afimon & BMP_MON_LOC_RIB) && selfid > bmp->syncpeerid) {
+			locrib = bmp_bestpath(bn);
+			if (locrib)
+				nextid = MIN(nextid, selfid);
 		}
-		if (bpi || adjin)
+		if (afimon & BMP_MON_ADJ_OUT) {
+			adjout = bmp_adjout_next(bmp, bn, afi, safi);
+			if (adjout)
+				nextid = MIN(nextid, adjout->qobj_node.nid);
+		}
+		if (nextid != UINT64_MAX)
 			break;
 
 		bn = NULL;
 	} while (1);
 
-	if (adjin && bpi
-	    && adjin->peer->qobj_node.nid < bpi->peer->qobj_node.nid) {
+	bmp->syncpeerid = nextid;
+	if (bpi && bpi->peer->qobj_node.nid != nextid)
 		bpi = NULL;
-		bmp->syncpeerid = adjin->peer->qobj_node.nid;
-	} else if (adjin && bpi
-		   && adjin->peer->qobj_node.nid > bpi->peer->qobj_node.nid) {
+	if (adjin && adjin->peer->qobj_node.nid != nextid)
 		adjin = NULL;
-		bmp->syncpeerid = bpi->peer->qobj_node.nid;
-	} else if (bpi) {
-		bmp->syncpeerid = bpi->peer->qobj_node.nid;
-	} else if (adjin) {
-		bmp->syncpeerid = adjin->peer->qobj_node.nid;
-	}
+	if (locrib && selfid != nextid)
+		locrib = NULL;
+	if (adjout && adjout->qobj_node.nid != nextid)
+		adjout = NULL;
 
 	const struct prefix *bn_p = bgp_dest_get_prefix(bn);
 	struct prefix_rd *prd = NULL;
@@ -1114,11 +1648,16 @@ afibreak:
 		prd = (struct prefix_rd *)bgp_dest_get_prefix(bmp->syncrdpos);
 
 	if (bpi)
-		bmp_monitor(bmp, bpi->peer, BMP_PEER_FLAG_L, bn_p, prd,
+		bmp_monitor(bmp, false, bpi->peer, BMP_PEER_FLAG_L, bn_p, prd,
 			    bpi->attr, afi, safi, bpi->uptime);
 	if (adjin)
-		bmp_monitor(bmp, adjin->peer, 0, bn_p, prd, adjin->attr, afi,
-			    safi, adjin->uptime);
+		bmp_monitor(bmp, false, adjin->peer, 0, bn_p, prd,
+			    adjin->attr, afi, safi, adjin->uptime);
+	if (locrib)
+		bmp_monitor(bmp, true, locrib->peer, 0, bn_p, prd,
+			    locrib->attr, afi, safi, locrib->uptime);
+	if (adjout)
+		bmp_adjout_monitor(bmp, adjout, bn, prd, afi, safi);
 
 	if (bn)
 		bgp_dest_unlock_node(bn);
@@ -1144,12 +1683,11 @@ static struct bmp_queue_entry *bmp_pull(struct bmp *bmp)
 	return bqe;
 }
 
-static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
+static bool bmp_wrqueue(struct bmp *bmp)
 {
 	struct bmp_queue_entry *bqe;
 	struct peer *peer;
 	struct bgp_dest *bn = NULL;
-	bool written = false;
 
 	bqe = bmp_pull(bmp);
 	if (!bqe)
@@ -1180,13 +1718,32 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 		zlog_info("bmp: skipping queued item for deleted peer");
 		goto out;
 	}
-	if (!peer_established(peer))
-		goto out;
 
 	bool is_vpn = (bqe->afi == AFI_L2VPN && bqe->safi == SAFI_EVPN) ||
 		      (bqe->safi == SAFI_MPLS_VPN);
 
 	struct prefix_rd *prd = is_vpn ? &bqe->rd : NULL;
+
+	/* peer_self is never established */
+	if (bqe->locrib) {
+		struct bgp_path_info *bpi;
+
+		if (!(bmp->targets->afimon[afi][safi] & BMP_MON_LOC_RIB))
+			goto out;
+
+		bn = bgp_afi_node_lookup(bmp->targets->bgp->rib[afi][safi],
+					 afi, safi, &bqe->p, prd);
+		bpi = bmp_bestpath(bn);
+
+		bmp_monitor(bmp, true, bpi ? bpi->peer : peer, 0, &bqe->p,
+			    prd, bpi ? bpi->attr : NULL, afi, safi,
+			    bpi ? bpi->uptime : monotime(NULL));
+		goto out;
+	}
+
+	if (!peer_established(peer))
+		goto out;
+
 	bn = bgp_afi_node_lookup(bmp->targets->bgp->rib[afi][safi], afi, safi,
 				 &bqe->p, prd);
 
@@ -1202,10 +1759,9 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 				break;
 		}
 
-		bmp_monitor(bmp, peer, BMP_PEER_FLAG_L, &bqe->p, prd,
+		bmp_monitor(bmp, false, peer, BMP_PEER_FLAG_L, &bqe->p, prd,
 			    bpi ? bpi->attr : NULL, afi, safi,
 			    bpi ? bpi->uptime : monotime(NULL));
-		written = true;
 	}
 
 	if (bmp->targets->afimon[afi][safi] & BMP_MON_PREPOLICY) {
@@ -1216,10 +1772,9 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 			if (adjin->peer == peer)
 				break;
 		}
-		bmp_monitor(bmp, peer, 0, &bqe->p, prd,
+		bmp_monitor(bmp, false, peer, 0, &bqe->p, prd,
 			    adjin ? adjin->attr : NULL, afi, safi,
 			    adjin ? adjin->uptime : monotime(NULL));
-		written = true;
 	}
 
 out:
@@ -1229,42 +1784,79 @@ out:
 	if (bn)
 		bgp_dest_unlock_node(bn);
 
-	return written;
+	return true;
 }
 
-static void bmp_wrfill(struct bmp *bmp, struct pullwr *pullwr)
+/* returns false when there is nothing left to do for now */
+static bool bmp_wrfill(struct bmp *bmp)
 {
 	switch(bmp->state) {
 	case BMP_PeerUp:
 		bmp_send_peerup(bmp);
 		bmp->state = BMP_Run;
-		break;
+		return true;
 
 	case BMP_Run:
-		if (bmp_wrmirror(bmp, pullwr))
-			break;
-		if (bmp_wrqueue(bmp, pullwr))
+		if (bmp_wrmirror(bmp))
+			return true;
+		if (bmp_wrqueue(bmp))
+			return true;
+		return bmp_wrsync(bmp);
+	}
+	return false;
+}
+
+/* encodes more messages for the session while its output queue allows */
+static void bmp_fill(struct thread *t)
+{
+	struct bmp *bmp = THREAD_ARG(t);
+	struct timeval t0;
+
+	monotime(&t0);
+
+	/* above BMP_OUTQ_HIGH, the writer brings us back */
+	while (atomic_load_explicit(&bmp->outq_bytes, memory_order_relaxed)
+	       < BMP_OUTQ_HIGH) {
+		if (!bmp_wrfill(bmp))
 			break;
-		if (bmp_wrsync(bmp, pullwr))
+
+		/* check after doing at least one round so we don't spin
+		 * without making progress on slow boxes
+		 */
+		if (monotime_since(&t0, NULL) >= BMP_FILL_MAXSPIN) {
+			bmp_bump(bmp);
 			break;
-		break;
+		}
 	}
+
+	/* the RIB may change before the next run */
+	bmp_batch_flush_all(bmp);
 }
 
-static void bmp_wrerr(struct bmp *bmp, struct pullwr *pullwr, bool eof)
+static void bmp_wrerr(struct bmp *bmp, bool eof, int err)
 {
 	if (eof)
 		zlog_info("bmp[%s] disconnected", bmp->remote);
 	else
 		flog_warn(EC_LIB_SYSTEM_CALL, "bmp[%s] connection error: %s",
-				bmp->remote, strerror(errno));
+				bmp->remote, safe_strerror(err));
 
 	bmp_close(bmp);
 	bmp_free(bmp);
 }
 
+/* the writer failed, on the main pthread */
+static void bmp_wrerr_event(struct thread *t)
+{
+	struct bmp *bmp = THREAD_ARG(t);
+	int err = atomic_load_explicit(&bmp->wr_errno, memory_order_relaxed);
+
+	bmp_wrerr(bmp, !err, err);
+}
+
 static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
-			    safi_t safi, struct bgp_dest *bn, struct peer *peer)
+			    safi_t safi, struct bgp_dest *bn, struct peer *peer,
+			    bool locrib)
 {
 	struct bmp *bmp;
 	struct bmp_queue_entry *bqe, bqeref;
@@ -1279,6 +1871,7 @@ static void bmp_process_one(struct bmp_targets *bt, struct bgp *bgp, afi_t afi,
 	bqeref.peerid = peer->qobj_node.nid;
 	bqeref.afi = afi;
 	bqeref.safi = safi;
+	bqeref.locrib = locrib;
 
 	if ((afi == AFI_L2VPN && safi == SAFI_EVPN && bn->pdest) ||
 	    (safi == SAFI_MPLS_VPN))
@@ -1326,15 +1919,99 @@ static int bmp_process(struct bgp *bgp, afi_t afi, safi_t safi,
 		return 0;
 
 	frr_each(bmp_targets, &bmpbgp->targets, bt) {
-		if (!bt->afimon[afi][safi])
+		if (!(bt->afimon[afi][safi]
+		      & (BMP_MON_PREPOLICY | BMP_MON_POSTPOLICY)))
+			continue;
+
+		bmp_process_one(bt, bgp, afi, safi, bn, peer, false);
+
+		frr_each(bmp_session, &bt->sessions, bmp) {
+			bmp_bump(bmp);
+		}
+	}
+	return 0;
+}
+
+static int bmp_route_update(struct bgp *bgp, afi_t afi, safi_t safi,
+			    struct bgp_dest *bn, struct bgp_path_info *old_route,
+			    struct bgp_path_info *new_route)
+{
+	struct bmp_bgp *bmpbgp = bmp_bgp_find(bgp);
+	struct bmp_targets *bt;
+	struct bmp *bmp;
+
+	if (!bmpbgp)
+		return 0;
+
+	frr_each(bmp_targets, &bmpbgp->targets, bt) {
+		if (!(bt->afimon[afi][safi] & BMP_MON_LOC_RIB))
 			continue;
 
-		bmp_process_one(bt, bgp, afi, safi, bn, peer);
+		bmp_process_one(bt, bgp, afi, safi, bn, bgp->peer_self, true);
+
+		frr_each(bmp_session, &bt->sessions, bmp) {
+			bmp_bump(bmp);
+		}
+	}
+	return 0;
+}
+
+/* Adj-RIB-Out is reported as the UPDATEs that were actually sent, these
+ * are already encoded by the update-group code.
+ */
+static int bmp_update_send(struct peer *peer, afi_t afi, safi_t safi,
+			   struct stream *head, struct stream *pkt)
+{
+	struct bmp_bgp *bmpbgp = bmp_bgp_find(peer->bgp);
+	struct bmp_targets *bt;
+	struct bmp *bmp;
+	struct bmp_msg *msg = NULL;
+	struct stream *hdr, *body;
+	struct timeval tv;
+	size_t hlen = stream_get_endp(head), plen;
+
+	if (!bmpbgp)
+		return 0;
+
+	frr_each(bmp_targets, &bmpbgp->targets, bt) {
+		if (!(bt->afimon[afi][safi] & BMP_MON_ADJ_OUT))
+			continue;
 
 		frr_each(bmp_session, &bt->sessions, bmp) {
-			pullwr_bump(bmp->pullwr);
+			/* before that, the table sync has it */
+			if (bmp->afistate[afi][safi] != BMP_AFI_SYNC
+			    && bmp->afistate[afi][safi] != BMP_AFI_LIVE)
+				continue;
+
+			if (!msg) {
+				plen = pkt && stream_get_endp(pkt) > hlen
+					       ? stream_get_endp(pkt) - hlen
+					       : 0;
+				body = stream_new(hlen + plen);
+				stream_put(body, STREAM_DATA(head), hlen);
+				if (plen)
+					stream_put(body, STREAM_DATA(pkt) + hlen,
+						   plen);
+
+				gettimeofday(&tv, NULL);
+				hdr = stream_new(BGP_MAX_PACKET_SIZE);
+				bmp_common_hdr(hdr, BMP_VERSION_3,
+					       BMP_TYPE_ROUTE_MONITORING);
+				bmp_per_peer_hdr(hdr, peer,
+						 BMP_PEER_FLAG_O
+							 | BMP_PEER_FLAG_L,
+						 &tv);
+				stream_putl_at(hdr, BMP_LENGTH_POS,
+					       stream_get_endp(hdr) + hlen
+						       + plen);
+				msg = bmp_msg_new(hdr, body);
+			}
+
+			bmp->cnt_update++;
+			bmp_send(bmp, msg);
 		}
 	}
+	bmp_msg_put(&msg);
 	return 0;
 }
 
@@ -1413,11 +2090,11 @@ static void bmp_read(struct thread *t)
 		zlog_info("bmp[%s]: unexpectedly received %zu bytes", bmp->remote, n);
 	} else if (n == 0) {
 		/* the TCP session was terminated by the far end */
-		bmp_wrerr(bmp, NULL, true);
+		bmp_wrerr(bmp, true, 0);
 		return;
 	} else if (!(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
 		/* the TCP session experienced a fatal error, likely a timeout */
-		bmp_wrerr(bmp, NULL, false);
+		bmp_wrerr(bmp, false, errno);
 		return;
 	}
 
@@ -1495,10 +2172,9 @@ static struct bmp *bmp_open(struct bmp_targets *bt, int bmp_sock)
 	strlcpy(bmp->remote, buf, sizeof(bmp->remote));
 
 	bmp->state = BMP_PeerUp;
-	bmp->pullwr = pullwr_new(bm->master, bmp_sock, bmp, bmp_wrfill,
-			bmp_wrerr);
 	thread_add_read(bm->master, bmp_read, bmp, bmp_sock, &bmp->t_read);
 	bmp_send_initiation(bmp);
+	bmp_bump(bmp);
 
 	return bmp;
 }
@@ -1528,6 +2204,7 @@ static void bmp_close(struct bmp *bmp)
 {
 	struct bmp_queue_entry *bqe;
 	struct bmp_mirrorq *bmq;
+	struct bmp_outmsg *om;
 
 	THREAD_OFF(bmp->t_read);
 
@@ -1536,13 +2213,25 @@ static void bmp_close(struct bmp *bmp)
 
 	while ((bmq = bmp_pull_mirror(bmp)))
 		if (!bmq->refcount)
-			XFREE(MTYPE_BMP_MIRRORQ, bmq);
+			bmp_mirrorq_free(bmq);
 	while ((bqe = bmp_pull(bmp)))
 		if (!bqe->refcount)
 			XFREE(MTYPE_BMP_QUEUE, bqe);
+	bmp_batch_drop_all(bmp);
 
 	THREAD_OFF(bmp->t_read);
-	pullwr_del(bmp->pullwr);
+
+	/* writer first, it may schedule t_fill or t_err */
+	if (atomic_load_explicit(&bmp_pth->running, memory_order_relaxed))
+		thread_cancel_async(bmp_pth->master, &bmp->t_write, NULL);
+	THREAD_OFF(bmp->t_fill);
+	THREAD_OFF(bmp->t_err);
+
+	while ((om = bmp_outq_pop(&bmp->outq))) {
+		bmp_msg_put(&om->msg);
+		XFREE(MTYPE_BMP_OUTQ, om);
+	}
+	atomic_store_explicit(&bmp->outq_bytes, 0, memory_order_relaxed);
 	close(bmp->socket);
 }
 
@@ -2220,7 +2909,7 @@ DEFPY(bmp_stats_cfg,
 
 DEFPY(bmp_monitor_cfg,
       bmp_monitor_cmd,
-      "[no] bmp monitor <ipv4|ipv6|l2vpn> <unicast|multicast|evpn|vpn> <pre-policy|post-policy>$policy",
+      "[no] bmp monitor <ipv4|ipv6|l2vpn> <unicast|multicast|evpn|vpn> <pre-policy|post-policy|loc-rib|adj-rib-out>$policy",
       NO_STR
       BMP_STR
       "Send BMP route monitoring messages\n"
@@ -2232,7 +2921,9 @@ DEFPY(bmp_monitor_cfg,
       BGP_AF_STR
       BGP_AF_STR
       "Send state before policy and filter processing\n"
-      "Send state with policy and filters applied\n")
+      "Send state with policy and filters applied\n"
+      "Send the BGP instance's selected routes (RFC 9069)\n"
+      "Send what is advertised to peers, with policy applied (RFC 8671)\n")
 {
 	int index = 0;
 	uint8_t flag, prev;
@@ -2245,7 +2936,11 @@ DEFPY(bmp_monitor_cfg,
 	argv_find_and_parse_afi(argv, argc, &index, &afi);
 	argv_find_and_parse_safi(argv, argc, &index, &safi);
 
-	if (policy[1] == 'r')
+	if (policy[0] == 'l')
+		flag = BMP_MON_LOC_RIB;
+	else if (policy[0] == 'a')
+		flag = BMP_MON_ADJ_OUT;
+	else if (policy[1] == 'r')
 		flag = BMP_MON_PREPOLICY;
 	else
 		flag = BMP_MON_POSTPOLICY;
@@ -2273,6 +2968,9 @@ DEFPY(bmp_monitor_cfg,
 		bmp->afistate[afi][safi] = BMP_AFI_NEEDSYNC;
 	}
 
+	frr_each (bmp_session, &bt->sessions, bmp)
+		bmp_locrib_update(bmp);
+
 	return CMD_SUCCESS;
 }
 
@@ -2298,7 +2996,7 @@ DEFPY(bmp_mirror_cfg,
 
 		while ((bmq = bmp_pull_mirror(bmp)))
 			if (!bmq->refcount)
-				XFREE(MTYPE_BMP_MIRRORQ, bmq);
+				bmp_mirrorq_free(bmq);
 	}
 	return CMD_SUCCESS;
 }
@@ -2371,28 +3069,28 @@ DEFPY(show_bmp,
 			vty_out(vty, "  Targets \"%s\":\n", bt->name);
 			vty_out(vty, "    Route Mirroring %sabled\n",
 				bt->mirror ? "en" : "dis");
+			if (bt->mirror)
+				vty_out(vty, "    Route Mirroring %" PRIu64 " messages dropped\n",
+					bt->cnt_mirror_dropped);
 
 			afi_t afi;
 			safi_t safi;
 
 			FOREACH_AFI_SAFI (afi, safi) {
-				const char *str = NULL;
-
-				switch (bt->afimon[afi][safi]) {
-				case BMP_MON_PREPOLICY:
-					str = "pre-policy";
-					break;
-				case BMP_MON_POSTPOLICY:
-					str = "post-policy";
-					break;
-				case BMP_MON_PREPOLICY | BMP_MON_POSTPOLICY:
-					str = "pre-policy and post-policy";
-					break;
-				}
-				if (!str)
+				uint8_t afimon = bt->afimon[afi][safi];
+
+				if (!afimon)
 					continue;
-				vty_out(vty, "    Route Monitoring %s %s %s\n",
-					afi2str(afi), safi2str(safi), str);
+				vty_out(vty, "    Route Monitoring %s %s%s%s%s%s\n",
+					afi2str(afi), safi2str(safi),
+					(afimon & BMP_MON_PREPOLICY)
+						? " pre-policy" : "",
+					(afimon & BMP_MON_POSTPOLICY)
+						? " post-policy" : "",
+					(afimon & BMP_MON_LOC_RIB)
+						? " loc-rib" : "",
+					(afimon & BMP_MON_ADJ_OUT)
+						? " adj-rib-out" : "");
 			}
 
 			vty_out(vty, "    Listeners:\n");
@@ -2447,27 +3145,43 @@ DEFPY(show_bmp,
 			XFREE(MTYPE_TMP, out);
 			ttable_del(tt);
 
-			vty_out(vty, "\n    %zu connected clients:\n",
-					bmp_session_count(&bt->sessions));
+			size_t qtotal = 0, qmax = 0;
+
+			frr_each (bmp_session, &bt->sessions, bmp) {
+				qtotal += atomic_load_explicit(
+					&bmp->outq_bytes, memory_order_relaxed);
+				qmax = MAX(qmax, bmp->outq_max);
+			}
+
+			vty_out(vty, "\n    %zu connected clients, %zu bytes queued (max %zu per client):\n",
+				bmp_session_count(&bt->sessions), qtotal, qmax);
 			tt = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
-			ttable_add_row(tt, "remote|uptime|MonSent|MirrSent|MirrLost|ByteSent|ByteQ|ByteQKernel");
+			ttable_add_row(tt, "remote|uptime|MonSent|MonPfx|MirrSent|MirrLost|MirrDrop|ByteSent|ByteQ|ByteQMax|ByteQKernel");
 			ttable_rowseps(tt, 0, BOTTOM, true, '-');
 
 			frr_each (bmp_session, &bt->sessions, bmp) {
-				uint64_t total;
-				size_t q, kq;
+				int kq;
 
-				pullwr_stats(bmp->pullwr, &total, &q, &kq);
+				if (ioctl(bmp->socket, TIOCOUTQ, &kq) != 0)
+					kq = 0;
 
 				peer_uptime(bmp->t_up.tv_sec, uptime,
 					    sizeof(uptime), false, NULL);
 
-				ttable_add_row(tt, "%s|%s|%Lu|%Lu|%Lu|%Lu|%zu|%zu",
+				ttable_add_row(tt, "%s|%s|%Lu|%Lu|%Lu|%Lu|%Lu|%Lu|%zu|%zu|%d",
 					       bmp->remote, uptime,
 					       bmp->cnt_update,
+					       bmp->cnt_update_pfx,
 					       bmp->cnt_mirror,
 					       bmp->cnt_mirror_overruns,
-					       total, q, kq);
+					       bmp->cnt_mirror_dropped,
+					       atomic_load_explicit(
+						       &bmp->cnt_bytes,
+						       memory_order_relaxed),
+					       atomic_load_explicit(
+						       &bmp->outq_bytes,
+						       memory_order_relaxed),
+					       bmp->outq_max, kq);
 			}
 			out = ttable_dump(tt, "\n");
 			vty_out(vty, "%s", out);
@@ -2520,6 +3234,12 @@ static int bmp_config_write(struct bgp *bgp, struct vty *vty)
 			if (bt->afimon[afi][safi] & BMP_MON_POSTPOLICY)
 				vty_out(vty, "  bmp monitor %s %s post-policy\n",
 					afi_str, safi2str(safi));
+			if (bt->afimon[afi][safi] & BMP_MON_LOC_RIB)
+				vty_out(vty, "  bmp monitor %s %s loc-rib\n",
+					afi_str, safi2str(safi));
+			if (bt->afimon[afi][safi] & BMP_MON_ADJ_OUT)
+				vty_out(vty, "  bmp monitor %s %s adj-rib-out\n",
+					afi_str, safi2str(safi));
 		}
 		frr_each (bmp_listeners, &bt->listeners, bl)
 			vty_out(vty, " \n  bmp listener %pSU port %d\n",
@@ -2541,6 +3261,15 @@ static int bmp_config_write(struct bgp *bgp, struct vty *vty)
 	return 0;
 }
 
+static int bgp_bmp_fini(void)
+{
+	if (atomic_load_explicit(&bmp_pth->running, memory_order_relaxed))
+		frr_pthread_stop(bmp_pth, NULL);
+	frr_pthread_destroy(bmp_pth);
+	bmp_pth = NULL;
+	return 0;
+}
+
 static int bgp_bmp_init(struct thread_master *tm)
 {
 	install_node(&bmp_node);
@@ -2564,6 +3293,14 @@ static int bgp_bmp_init(struct thread_master *tm)
 
 	install_element(VIEW_NODE, &show_bmp_cmd);
 
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+
+	bmp_pth = frr_pthread_new(&attr, "BGP BMP I/O thread", "bgpd_bmp");
+	hook_register(frr_fini, bgp_bmp_fini);
+
 	resolver_init(tm);
 	return 0;
 }
@@ -2575,6 +3312,8 @@ static int bgp_bmp_module_init(void)
 	hook_register(peer_status_changed, bmp_peer_status_changed);
 	hook_register(peer_backward_transition, bmp_peer_backward);
 	hook_register(bgp_process, bmp_process);
+	hook_register(bgp_route_update, bmp_route_update);
+	hook_register(bgp_update_send, bmp_update_send);
 	hook_register(bgp_inst_config_write, bmp_config_write);
 	hook_register(bgp_inst_delete, bmp_bgp_del);
 	hook_register(frr_late_init, bgp_bmp_init);
@@ -22,9 +22,10 @@
 
 #include "zebra.h"
 #include "typesafe.h"
-#include "pullwr.h"
+#include "frratomic.h"
 #include "qobj.h"
 #include "resolver.h"
+#include "stream.h"
 
 #define BMP_VERSION_3	3
 
@@ -41,6 +42,28 @@
 
 #define BMP_READ_BUFSIZ	1024
 
+/* An encoded BMP message, header and (optional) body.  Immutable once it is
+ * queued; the same message is queued to every session that sends it, so
+ * the refcount is touched from both the main and the BMP I/O pthread.
+ */
+struct bmp_msg {
+	_Atomic unsigned int refcount;
+	/* header and body, written out with writev */
+	struct stream_chain chain;
+};
+
+/* a session's reference to a message on its output queue.  pos is only
+ * ever touched by the BMP I/O pthread.
+ */
+PREDECL_DLIST(bmp_outq);
+
+struct bmp_outmsg {
+	struct bmp_outq_item boi;
+
+	struct bmp_msg *msg;
+	size_t pos;
+};
+
 /* bmp->state */
 #define BMP_None        0
 #define BMP_PeerUp      2
@@ -77,6 +100,8 @@ struct bmp_queue_entry {
 	uint64_t peerid;
 	afi_t afi;
 	safi_t safi;
+	/* best path changed (peerid is peer_self), instead of Adj-RIB-In */
+	bool locrib;
 
 	size_t refcount;
 
@@ -90,6 +115,9 @@ struct bmp_queue_entry {
  *
  * There is *one* queue for each "struct bgp *" where we throw everything on,
  * with a size limit.  Refcount works the same as for monitoring above.
+ *
+ * The packet is copied once into msg->body; the BMP header is added by the
+ * first session pulling the item and the whole message is shared by all.
  */
 
 PREDECL_LIST(bmp_mirrorq);
@@ -102,7 +130,7 @@ struct bmp_mirrorq {
 	struct timeval tv;
 
 	size_t len;
-	uint8_t data[0];
+	struct bmp_msg *msg;
 };
 
 enum {
@@ -112,6 +140,31 @@ enum {
 	BMP_AFI_LIVE,
 };
 
+/* a BGP UPDATE for route monitoring that more NLRI with the same peer and
+ * attributes can still be added to.  Batches are only open during one
+ * bmp_fill() run, so the RIB doesn't change while one is being built;
+ * EoR and the end of the run flush them.
+ */
+struct bmp_batch {
+	/* peer_self for Loc-RIB */
+	struct peer *peer;
+	/* NULL for withdrawals, a reference is held while the batch is open */
+	struct attr *attr;
+	afi_t afi;
+	safi_t safi;
+	bool locrib;
+	uint8_t flags;
+	/* of the first prefix, goes into the per-peer header */
+	time_t uptime;
+
+	struct stream *s;
+	size_t attrlen_pos, mp_start, mplen_pos;
+	bgp_size_t attrlen;
+	unsigned int count;
+};
+
+#define BMP_BATCH_MAX	8
+
 PREDECL_LIST(bmp_session);
 
 struct bmp_active;
@@ -127,7 +180,20 @@ struct bmp {
 	char remote[SU_ADDRSTRLEN + 6];
 	struct thread *t_read;
 
-	struct pullwr *pullwr;
+	/* messages are encoded on the main pthread in t_fill and written out
+	 * by the BMP I/O pthread in t_write.  Encoding pauses while more than
+	 * BMP_OUTQ_HIGH bytes are queued and is resumed by the writer once
+	 * that drops below BMP_OUTQ_LOW.  Write errors are handed back to
+	 * the main pthread in t_err.
+	 */
+	struct thread *t_fill, *t_write, *t_err;
+
+	pthread_mutex_t outq_mtx;
+	struct bmp_outq_head outq;	/* Requires: outq_mtx */
+	_Atomic size_t outq_bytes;
+	size_t outq_max;
+	_Atomic uint64_t cnt_bytes;
+	_Atomic int wr_errno;
 
 	int state;
 
@@ -143,13 +209,22 @@ struct bmp {
 
 	/* enum BMP_AFI_* */
 	uint8_t afistate[AFI_MAX][SAFI_MAX];
+	/* Loc-RIB peer up has been sent */
+	bool locrib_up;
+
+	struct bmp_batch batch[BMP_BATCH_MAX];
+	unsigned int nbatch;
 
 	/* counters for the various BMP packet types */
 	uint64_t cnt_update, cnt_mirror;
+	/* prefixes in the route monitoring messages */
+	uint64_t cnt_update_pfx;
 	/* number of times this peer wasn't fast enough in consuming the
 	 * mirror queue
 	 */
 	uint64_t cnt_mirror_overruns;
+	/* number of mirror messages dropped in these overruns */
+	uint64_t cnt_mirror_dropped;
 	struct timeval t_up;
 
 	/* synchronization / startup works by repeatedly finding the next
@@ -234,6 +309,10 @@ struct bmp_targets {
 	 */
 #define BMP_MON_PREPOLICY	(1 << 0)
 #define BMP_MON_POSTPOLICY	(1 << 1)
+/* RFC 9069 */
+#define BMP_MON_LOC_RIB		(1 << 2)
+/* RFC 8671, post-policy */
+#define BMP_MON_ADJ_OUT		(1 << 3)
 	uint8_t afimon[AFI_MAX][SAFI_MAX];
 	bool mirror;
 
@@ -246,6 +325,8 @@ struct bmp_targets {
 	struct bmp_qlist_head updlist;
 
 	uint64_t cnt_accept, cnt_aclrefused;
+	/* mirror messages dropped over all sessions, including closed ones */
+	uint64_t cnt_mirror_dropped;
 
 	QOBJ_FIELDS;
 };
@@ -291,6 +372,8 @@ enum {
 	BMP_PEERDOWN_REMOTE_NOTIFY      = 3,
 	BMP_PEERDOWN_REMOTE_CLOSE       = 4,
 	BMP_PEERDOWN_ENDMONITOR         = 5,
+	/* RFC 9069, Loc-RIB instance went away */
+	BMP_PEERDOWN_DECONFIGURED       = 6,
 };
 
 enum {
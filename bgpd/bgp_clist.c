@@ -149,10 +149,19 @@ static void community_entry_free(struct community_entry *entry)
 	XFREE(MTYPE_COMMUNITY_LIST_ENTRY, entry);
 }
 
+/* changes whenever a community-list or one of its entries changes */
+static uint32_t clist_epoch = 1;
+
 /* Allocate a new community-list.  */
 static struct community_list *community_list_new(void)
 {
-	return XCALLOC(MTYPE_COMMUNITY_LIST, sizeof(struct community_list));
+	static uint32_t next_id;
+	struct community_list *list;
+
+	list = XCALLOC(MTYPE_COMMUNITY_LIST, sizeof(struct community_list));
+	list->id = ++next_id;
+	clist_epoch++;
+	return list;
 }
 
 /* Free community-list.  */
@@ -160,6 +169,12 @@ static void community_list_free(struct community_list *list)
 {
 	XFREE(MTYPE_COMMUNITY_LIST_NAME, list->name);
 	XFREE(MTYPE_COMMUNITY_LIST, list);
+	clist_epoch++;
+}
+
+uint32_t community_list_epoch(void)
+{
+	return clist_epoch;
 }
 
 static struct community_list *
@@ -333,6 +348,7 @@ static void community_list_entry_delete(struct community_list_master *cm,
 		list->head = entry->next;
 
 	community_entry_free(entry);
+	clist_epoch++;
 
 	if (community_list_empty_p(list))
 		community_list_delete(cm, list);
@@ -374,6 +390,8 @@ static void community_list_entry_add(struct community_list *list,
 	struct community_entry *replace;
 	struct community_entry *point;
 
+	clist_epoch++;
+
 	/* Automatic assignment of seq no. */
 	if (entry->seq == COMMUNITY_SEQ_NUMBER_AUTO)
 		entry->seq = bgp_clist_new_seq_get(list);
@@ -665,7 +683,45 @@ static bool ecommunity_regexp_match(struct ecommunity *ecom, regex_t *reg)
 
 /* When given community attribute matches to the community-list return
    1 else return 0.  */
-bool community_list_match(struct community *com, struct community_list *list)
+/*
+ * The same few interned communities are checked against the same lists
+ * over and over, so the last results are kept on the community.  A cache
+ * word is the epoch, the list's ID, whether it was an exact match and the
+ * result; any change to any list bumps the epoch.  Non-interned values
+ * can still change and are not cached.
+ */
+#define CLIST_CACHE(c) ((c) && (c)->refcnt ? (c)->clist_cache : NULL)
+
+#define CLIST_CACHE_WORD(list, exact)                                          \
+	(((uint64_t)clist_epoch << 32) | (((list)->id & 0x7fffff) << 9)        \
+	 | ((exact) ? 0x100 : 0))
+
+static bool clist_cache_get(_Atomic uint64_t *cache,
+			    struct community_list *list, bool exact,
+			    bool *match)
+{
+	uint64_t word;
+
+	word = atomic_load_explicit(&cache[list->id % 2],
+				    memory_order_relaxed);
+	if ((word & ~0xffULL) != CLIST_CACHE_WORD(list, exact))
+		return false;
+
+	*match = word & 0x1;
+	return true;
+}
+
+static void clist_cache_set(_Atomic uint64_t *cache,
+			    struct community_list *list, bool exact,
+			    bool match)
+{
+	atomic_store_explicit(&cache[list->id % 2],
+			      CLIST_CACHE_WORD(list, exact) | match,
+			      memory_order_relaxed);
+}
+
+static bool community_list_match_entries(struct community *com,
+					 struct community_list *list)
 {
 	struct community_entry *entry;
 
@@ -687,7 +743,22 @@ bool community_list_match(struct community *com, struct community_list *list)
 	return false;
 }
 
-bool lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
+bool community_list_match(struct community *com, struct community_list *list)
+{
+	_Atomic uint64_t *cache = CLIST_CACHE(com);
+	bool match;
+
+	if (cache && clist_cache_get(cache, list, false, &match))
+		return match;
+
+	match = community_list_match_entries(com, list);
+	if (cache)
+		clist_cache_set(cache, list, false, match);
+	return match;
+}
+
+static bool lcommunity_list_match_entries(struct lcommunity *lcom,
+					  struct community_list *list)
 {
 	struct community_entry *entry;
 
@@ -706,12 +777,26 @@ bool lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
 	return false;
 }
 
+bool lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
+{
+	_Atomic uint64_t *cache = CLIST_CACHE(lcom);
+	bool match;
+
+	if (cache && clist_cache_get(cache, list, false, &match))
+		return match;
+
+	match = lcommunity_list_match_entries(lcom, list);
+	if (cache)
+		clist_cache_set(cache, list, false, match);
+	return match;
+}
+
 
 /* Perform exact matching.  In case of expanded large-community-list, do
  * same thing as lcommunity_list_match().
  */
-bool lcommunity_list_exact_match(struct lcommunity *lcom,
-				 struct community_list *list)
+static bool lcommunity_list_exact_match_entries(struct lcommunity *lcom,
+						struct community_list *list)
 {
 	struct community_entry *entry;
 
@@ -730,7 +815,23 @@ bool lcommunity_list_exact_match(struct lcommunity *lcom,
 	return false;
 }
 
-bool ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
+bool lcommunity_list_exact_match(struct lcommunity *lcom,
+				 struct community_list *list)
+{
+	_Atomic uint64_t *cache = CLIST_CACHE(lcom);
+	bool match;
+
+	if (cache && clist_cache_get(cache, list, true, &match))
+		return match;
+
+	match = lcommunity_list_exact_match_entries(lcom, list);
+	if (cache)
+		clist_cache_set(cache, list, true, match);
+	return match;
+}
+
+static bool ecommunity_list_match_entries(struct ecommunity *ecom,
+					  struct community_list *list)
 {
 	struct community_entry *entry;
 
@@ -749,10 +850,24 @@ bool ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
 	return false;
 }
 
+bool ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
+{
+	_Atomic uint64_t *cache = CLIST_CACHE(ecom);
+	bool match;
+
+	if (cache && clist_cache_get(cache, list, false, &match))
+		return match;
+
+	match = ecommunity_list_match_entries(ecom, list);
+	if (cache)
+		clist_cache_set(cache, list, false, match);
+	return match;
+}
+
 /* Perform exact matching.  In case of expanded community-list, do
    same thing as community_list_match().  */
-bool community_list_exact_match(struct community *com,
-				struct community_list *list)
+static bool community_list_exact_match_entries(struct community *com,
+					       struct community_list *list)
 {
 	struct community_entry *entry;
 
@@ -774,6 +889,21 @@ bool community_list_exact_match(struct community *com,
 	return false;
 }
 
+bool community_list_exact_match(struct community *com,
+				struct community_list *list)
+{
+	_Atomic uint64_t *cache = CLIST_CACHE(com);
+	bool match;
+
+	if (cache && clist_cache_get(cache, list, true, &match))
+		return match;
+
+	match = community_list_exact_match_entries(com, list);
+	if (cache)
+		clist_cache_set(cache, list, true, match);
+	return match;
+}
+
 /* Delete all permitted communities in the list from com.  */
 struct community *community_list_match_delete(struct community *com,
 					      struct community_list *list)
@@ -67,6 +67,9 @@ struct community_list {
 	/* Community-list entry in this community-list.  */
 	struct community_entry *head;
 	struct community_entry *tail;
+
+	/* For the results cached on interned communities.  */
+	uint32_t id;
 };
 
 /* Each entry in community-list.  */
@@ -165,6 +168,10 @@ community_list_master_lookup(struct community_list_handler *ch, int master);
 extern struct community_list *
 community_list_lookup(struct community_list_handler *c, const char *name,
 		      uint32_t name_hash, int master);
+/* changes whenever a community-list of any kind or one of its entries
+ * changes
+ */
+extern uint32_t community_list_epoch(void);
 
 extern bool community_list_match(struct community *com,
 				 struct community_list *list);
@@ -23,7 +23,7 @@
 #include "command.h"
 #include "hash.h"
 #include "memory.h"
-#include "jhash.h"
+#include "fhash.h"
 #include "frrstr.h"
 
 #include "bgpd/bgp_memory.h"
@@ -59,6 +59,7 @@ void community_free(struct community **com)
 /* Add one community value to the community. */
 void community_add_val(struct community *com, uint32_t val)
 {
+	com->mask = 0;
 	com->size++;
 	com->val = XREALLOC(MTYPE_COMMUNITY_VAL, com->val, com_length(com));
 
@@ -75,6 +76,7 @@ void community_del_val(struct community *com, uint32_t *val)
 	if (!com->val)
 		return;
 
+	com->mask = 0;
 	while (i < com->size) {
 		if (memcmp(com->val + i, val, sizeof(uint32_t)) == 0) {
 			c = com->size - i - 1;
@@ -129,12 +131,42 @@ static int community_compare(const void *a1, const void *a2)
 	return 0;
 }
 
+/* val in network byte order */
+static inline uint64_t community_mask_bit(uint32_t val)
+{
+	return 1ULL << ((val * 0x9e3779b1U) >> 26);
+}
+
+/* Interned communities don't change, so they get a summary for lookups. */
+static void community_summarize(struct community *com)
+{
+	int i;
+
+	com->mask = 0;
+	com->sorted = true;
+
+	for (i = 0; i < com->size; i++) {
+		com->mask |= community_mask_bit(com->val[i]);
+		if (i && community_compare(&com->val[i - 1], &com->val[i]) >= 0)
+			com->sorted = false;
+	}
+}
+
 bool community_include(struct community *com, uint32_t val)
 {
 	int i;
 
 	val = htonl(val);
 
+	if (com->mask) {
+		if (!(com->mask & community_mask_bit(val)))
+			return false;
+		if (com->sorted)
+			return bsearch(&val, com->val, com->size,
+				       sizeof(uint32_t), community_compare)
+			       != NULL;
+	}
+
 	for (i = 0; i < com->size; i++)
 		if (memcmp(&val, com_nthval(com, i), sizeof(uint32_t)) == 0)
 			return true;
@@ -159,7 +191,6 @@ struct community *community_uniq_sort(struct community *com)
 {
 	int i;
 	struct community *new;
-	uint32_t val;
 
 	if (!com)
 		return NULL;
@@ -167,14 +198,21 @@ struct community *community_uniq_sort(struct community *com)
 	new = community_new();
 	new->json = NULL;
 
-	for (i = 0; i < com->size; i++) {
-		val = community_val_get(com, i);
+	if (!com->size)
+		return new;
 
-		if (!community_include(new, val))
-			community_add_val(new, val);
-	}
+	new->val = XMALLOC(MTYPE_COMMUNITY_VAL, com_length(com));
+	memcpy(new->val, com->val, com_length(com));
+	qsort(new->val, com->size, sizeof(uint32_t), community_compare);
 
-	qsort(new->val, new->size, sizeof(uint32_t), community_compare);
+	/* drop duplicates, in place */
+	for (i = 0; i < com->size; i++)
+		if (!new->size || new->val[new->size - 1] != new->val[i])
+			new->val[new->size++] = new->val[i];
+
+	if (new->size != com->size)
+		new->val = XREALLOC(MTYPE_COMMUNITY_VAL, new->val,
+				    com_length(new));
 
 	return new;
 }
@@ -484,6 +522,8 @@ struct community *community_intern(struct community *com)
 	   hash, it should be freed.  */
 	if (find != com)
 		community_free(&com);
+	else
+		community_summarize(find);
 
 	/* Increment refrence counter.  */
 	find->refcnt++;
@@ -570,7 +610,7 @@ unsigned int community_hash_make(const struct community *com)
 {
 	uint32_t *pnt = com->val;
 
-	return jhash2(pnt, com->size, 0x43ea96c1);
+	return fhash(pnt, com->size * sizeof(*pnt), 0x43ea96c1);
 }
 
 bool community_match(const struct community *com1, const struct community *com2)
@@ -587,6 +627,9 @@ bool community_match(const struct community *com1, const struct community *com2)
 	if (com1->size < com2->size)
 		return false;
 
+	if (com1->mask && com2->mask && (com2->mask & ~com1->mask))
+		return false;
+
 	/* Every community on com2 needs to be on com1 for this to match */
 	while (i < com1->size && j < com2->size) {
 		if (memcmp(com1->val + i, com2->val + j, sizeof(uint32_t)) == 0)
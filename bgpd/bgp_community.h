@@ -22,6 +22,7 @@
 #define _QUAGGA_BGP_COMMUNITY_H
 
 #include "lib/json.h"
+#include "lib/frratomic.h"
 #include "bgpd/bgp_route.h"
 
 /* Communities attribute.  */
@@ -41,6 +42,14 @@ struct community {
 	/* String of community attribute.  This sring is used by vty output
 	   and expanded community-list for regular expression match.  */
 	char *str;
+
+	/* community-list results while interned, see community_list_match() */
+	_Atomic uint64_t clist_cache[2];
+
+	/* Set when interned: one bit per value (hashed) for quick negative
+	   checks, and whether the values are in ascending order.  */
+	uint64_t mask;
+	bool sorted;
 };
 
 /* Well-known communities value.  */
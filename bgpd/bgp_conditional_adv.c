@@ -23,51 +23,70 @@
 #include "bgpd/bgp_conditional_adv.h"
 #include "bgpd/bgp_vty.h"
 
-static route_map_result_t
-bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
-				     struct route_map *rmap)
+/* Whether any path of dest is permitted by rmap */
+static bool bgp_conditional_adv_match(struct bgp_dest *dest,
+				      struct route_map *rmap)
 {
 	struct attr dummy_attr = {0};
-	struct bgp_dest *dest;
 	struct bgp_path_info *pi;
 	struct bgp_path_info path = {0};
 	struct bgp_path_info_extra path_extra = {0};
 	const struct prefix *dest_p;
-	route_map_result_t ret = RMAP_DENYMATCH;
+	route_map_result_t ret;
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		dest_p = bgp_dest_get_prefix(dest);
-		assert(dest_p);
+	dest_p = bgp_dest_get_prefix(dest);
+	assert(dest_p);
 
-		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
-			dummy_attr = *pi->attr;
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+			continue;
 
-			/* Fill temp path_info */
-			prep_for_rmap_apply(&path, &path_extra, dest, pi,
-					    pi->peer, &dummy_attr);
+		dummy_attr = *pi->attr;
 
-			RESET_FLAG(dummy_attr.rmap_change_flags);
+		/* Fill temp path_info */
+		prep_for_rmap_apply(&path, &path_extra, dest, pi, pi->peer,
+				    &dummy_attr);
 
-			ret = route_map_apply(rmap, dest_p, &path);
-			bgp_attr_flush(&dummy_attr);
+		RESET_FLAG(dummy_attr.rmap_change_flags);
 
-			if (ret == RMAP_PERMITMATCH) {
-				bgp_dest_unlock_node(dest);
-				if (BGP_DEBUG(update, UPDATE_OUT))
-					zlog_debug(
-						"%s: Condition map routes present in BGP table",
-						__func__);
+		ret = route_map_apply(rmap, dest_p, &path);
+		bgp_attr_flush(&dummy_attr);
 
-				return ret;
-			}
-		}
+		if (ret == RMAP_PERMITMATCH)
+			return true;
+	}
+
+	return false;
+}
+
+/* Looks for a prefix matched by rmap, and keeps it as the witness */
+static route_map_result_t
+bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
+				     struct route_map *rmap,
+				     struct prefix *witness)
+{
+	struct bgp_dest *dest;
+
+	memset(witness, 0, sizeof(*witness));
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		if (!bgp_conditional_adv_match(dest, rmap))
+			continue;
+
+		prefix_copy(witness, bgp_dest_get_prefix(dest));
+		bgp_dest_unlock_node(dest);
+		if (BGP_DEBUG(update, UPDATE_OUT))
+			zlog_debug("%s: Condition map routes present in BGP table",
+				   __func__);
+
+		return RMAP_PERMITMATCH;
 	}
 
 	if (BGP_DEBUG(update, UPDATE_OUT))
 		zlog_debug("%s: Condition map routes not present in BGP table",
 			   __func__);
 
-	return ret;
+	return RMAP_DENYMATCH;
 }
 
 static void bgp_conditional_adv_routes(struct peer *peer, afi_t afi,
@@ -110,6 +129,8 @@ static void bgp_conditional_adv_routes(struct peer *peer, afi_t afi,
 		dest_p = bgp_dest_get_prefix(dest);
 		assert(dest_p);
 
+		bgp_addpath_ensure_ids(peer->bgp, dest);
+
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
 			advmap_attr = *pi->attr;
 
@@ -164,7 +185,8 @@ static void bgp_conditional_adv_routes(struct peer *peer, afi_t afi,
 }
 
 /* Handler of conditional advertisement timer event.
- * Each route in the condition-map is evaluated.
+ * The condition-map is evaluated for the peers whose configuration or
+ * condition-map witness changed.
  */
 static void bgp_conditional_adv_timer(struct thread *t)
 {
@@ -178,14 +200,13 @@ static void bgp_conditional_adv_timer(struct thread *t)
 	struct bgp_filter *filter = NULL;
 	struct listnode *node, *nnode = NULL;
 	struct update_subgroup *subgrp = NULL;
+	enum update_type old_type;
+	bool config_change;
 	route_map_result_t ret;
 
 	bgp = THREAD_ARG(t);
 	assert(bgp);
 
-	thread_add_timer(bm->master, bgp_conditional_adv_timer, bgp,
-			 bgp->condition_check_period, &bgp->t_condition_check);
-
 	/* loop through each peer and advertise or withdraw routes if
 	 * advertise-map is configured and prefix(es) in condition-map
 	 * does exist(exist-map)/not exist(non-exist-map) in BGP table
@@ -220,33 +241,45 @@ static void bgp_conditional_adv_timer(struct thread *t)
 			    || !filter->advmap.amap || !filter->advmap.cmap)
 				continue;
 
-			if (!peer->advmap_config_change[afi][safi]
-			    && !peer->advmap_table_change)
+			config_change = peer->advmap_config_change[afi][safi];
+			if (!config_change
+			    && !peer->advmap_table_change[afi][safi])
 				continue;
 
 			if (BGP_DEBUG(update, UPDATE_OUT)) {
-				if (peer->advmap_table_change)
+				if (peer->advmap_table_change[afi][safi])
 					zlog_debug(
 						"%s: %s - routes changed in BGP table.",
 						__func__, peer->host);
-				if (peer->advmap_config_change[afi][safi])
+				if (config_change)
 					zlog_debug(
 						"%s: %s for %s - advertise/condition map configuration is changed.",
 						__func__, peer->host,
 						get_afi_safi_str(afi, safi,
 								 false));
 			}
+			peer->advmap_table_change[afi][safi] = false;
 
 			/* cmap (route-map attached to exist-map or
-			 * non-exist-map) map validation
+			 * non-exist-map) map validation.  A witness found by
+			 * bgp_conditional_adv_process() is still good, unless
+			 * the route-maps changed since.
 			 */
-			ret = bgp_check_rmap_prefixes_in_bgp_table(
-				table, filter->advmap.cmap);
+			if (config_change)
+				memset(&filter->advmap.witness, 0,
+				       sizeof(filter->advmap.witness));
+			if (filter->advmap.witness.family)
+				ret = RMAP_PERMITMATCH;
+			else
+				ret = bgp_check_rmap_prefixes_in_bgp_table(
+					table, filter->advmap.cmap,
+					&filter->advmap.witness);
 
 			/* Derive conditional advertisement status from
 			 * condition and return value of condition-map
 			 * validation.
 			 */
+			old_type = filter->advmap.update_type;
 			if (filter->advmap.condition == CONDITION_EXIST)
 				filter->advmap.update_type =
 					(ret == RMAP_PERMITMATCH)
@@ -281,7 +314,7 @@ static void bgp_conditional_adv_timer(struct thread *t)
 			 * There is a change in route-map, match-rule, ACLs,
 			 * or route-map filter configuration on the same peer.
 			 */
-			if (peer->advmap_config_change[afi][safi]) {
+			if (config_change) {
 
 				if (BGP_DEBUG(update, UPDATE_OUT))
 					zlog_debug(
@@ -298,17 +331,90 @@ static void bgp_conditional_adv_timer(struct thread *t)
 							paf->subgroup, NULL);
 				}
 				peer->advmap_config_change[afi][safi] = false;
-			}
+			} else if (filter->advmap.update_type == old_type)
+				/* routes coming and going while the condition
+				 * holds are handled by subgroup_announce_check()
+				 */
+				continue;
 
 			/* Send update as per the conditional advertisement */
 			bgp_conditional_adv_routes(peer, afi, safi, table,
 						   filter->advmap.amap,
 						   filter->advmap.update_type);
 		}
-		peer->advmap_table_change = false;
 	}
 }
 
+/* Whether dest changes the condition of peer's advertise-map */
+static bool bgp_conditional_adv_dest_check(struct peer *peer, afi_t afi,
+					   safi_t safi, struct bgp_dest *dest)
+{
+	struct bgp_filter *filter = &peer->filter[afi][safi];
+	const struct prefix *p = bgp_dest_get_prefix(dest);
+
+	if (!peer->afc_nego[afi][safi])
+		return false;
+
+	if (!filter->advmap.amap || !filter->advmap.cmap)
+		return false;
+
+	if (filter->advmap.witness.family) {
+		/* only losing the witness can make the condition fail */
+		if (!prefix_same(&filter->advmap.witness, p)
+		    || bgp_conditional_adv_match(dest, filter->advmap.cmap))
+			return false;
+
+		/* the timer looks for another one */
+		memset(&filter->advmap.witness, 0,
+		       sizeof(filter->advmap.witness));
+	} else {
+		if (!bgp_conditional_adv_match(dest, filter->advmap.cmap))
+			return false;
+
+		prefix_copy(&filter->advmap.witness, p);
+	}
+
+	peer->advmap_table_change[afi][safi] = true;
+	return true;
+}
+
+void bgp_conditional_adv_process(struct bgp *bgp, afi_t afi, safi_t safi,
+				 struct bgp_dest *dest)
+{
+	struct listnode *node;
+	struct peer *peer;
+	bool changed = false;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
+			continue;
+
+		if (!peer_established(peer))
+			continue;
+
+		if (bgp_conditional_adv_dest_check(peer, afi, safi, dest))
+			changed = true;
+
+		/* labeled-unicast routes are in the unicast table too */
+		if (safi == SAFI_UNICAST
+		    && bgp_conditional_adv_dest_check(
+			    peer, afi, SAFI_LABELED_UNICAST, dest))
+			changed = true;
+	}
+
+	if (changed)
+		bgp_conditional_adv_schedule(bgp);
+}
+
+void bgp_conditional_adv_schedule(struct bgp *bgp)
+{
+	if (!bgp->condition_filter_count)
+		return;
+
+	thread_add_timer(bm->master, bgp_conditional_adv_timer, bgp, 0,
+			 &bgp->t_condition_check);
+}
+
 void bgp_conditional_adv_enable(struct peer *peer, afi_t afi, safi_t safi)
 {
 	struct bgp *bgp = peer->bgp;
@@ -321,21 +427,12 @@ void bgp_conditional_adv_enable(struct peer *peer, afi_t afi, safi_t safi)
 	 */
 	peer->advmap_config_change[afi][safi] = true;
 
-	/* advertise-map is already configured on at least one of its
-	 * neighbors (AFI/SAFI). So just increment the counter.
-	 */
-	if (++bgp->condition_filter_count > 1) {
-		if (BGP_DEBUG(update, UPDATE_OUT))
-			zlog_debug("%s: condition_filter_count %d", __func__,
-				   bgp->condition_filter_count);
-
-		return;
-	}
+	++bgp->condition_filter_count;
+	if (BGP_DEBUG(update, UPDATE_OUT))
+		zlog_debug("%s: condition_filter_count %d", __func__,
+			   bgp->condition_filter_count);
 
-	/* Register for conditional routes polling timer */
-	if (!thread_is_scheduled(bgp->t_condition_check))
-		thread_add_timer(bm->master, bgp_conditional_adv_timer, bgp, 0,
-				 &bgp->t_condition_check);
+	bgp_conditional_adv_schedule(bgp);
 }
 
 void bgp_conditional_adv_disable(struct peer *peer, afi_t afi, safi_t safi)
@@ -356,6 +453,6 @@ void bgp_conditional_adv_disable(struct peer *peer, afi_t afi, safi_t safi)
 		return;
 	}
 
-	/* Last filter removed. So cancel conditional routes polling thread. */
+	/* Last filter removed. So cancel a pending evaluation. */
 	THREAD_OFF(bgp->t_condition_check);
 }
@@ -33,9 +33,22 @@
 extern "C" {
 #endif
 
-/* Polling time for monitoring condition-map routes in route table */
+/* Default of "bgp conditional-advertisement timer", which isn't used for
+ * polling anymore: conditions are evaluated again as routes change.
+ */
 #define DEFAULT_CONDITIONAL_ROUTES_POLL_TIME 60
 
+/*
+ * dest, in the table of afi/safi, went through best path selection.
+ * Schedules evaluating advertise-map conditions that may have changed:
+ * for each advertise-map only the prefix last seen matching the
+ * condition-map (the witness) is watched while it keeps matching, and
+ * while there's none every changed prefix is checked.
+ */
+extern void bgp_conditional_adv_process(struct bgp *bgp, afi_t afi,
+					safi_t safi, struct bgp_dest *dest);
+/* advmap_config_change was set for a peer */
+extern void bgp_conditional_adv_schedule(struct bgp *bgp);
 extern void bgp_conditional_adv_enable(struct peer *peer, afi_t afi,
 				       safi_t safi);
 extern void bgp_conditional_adv_disable(struct peer *peer, afi_t afi,
@@ -28,6 +28,7 @@
 #include "thread.h"
 #include "queue.h"
 #include "filter.h"
+#include "jhash.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_damp.h"
@@ -40,75 +41,130 @@
 /* Global variable to access damping configuration */
 static struct bgp_damp_config damp[AFI_MAX][SAFI_MAX];
 
-/* Utility macro to add and delete BGP dampening information to no
-   used list.  */
-#define BGP_DAMP_LIST_ADD(N, A) BGP_PATH_INFO_ADD(N, A, no_reuse_list)
-#define BGP_DAMP_LIST_DEL(N, A) BGP_PATH_INFO_DEL(N, A, no_reuse_list)
+DECLARE_DLIST(bgp_reuse_list, struct bgp_damp_info, list);
 
-/* Calculate reuse list index by penalty value.  */
-static int bgp_reuse_index(int penalty, struct bgp_damp_config *bdc)
+static int bgp_damp_info_cmp(const struct bgp_damp_info *a,
+			     const struct bgp_damp_info *b)
 {
-	unsigned int i;
-	int index;
+	return numcmp((uintptr_t)a->path, (uintptr_t)b->path);
+}
 
-	/*
-	 * reuse_limit can't be zero, this is for Coverity
-	 * to bypass division by zero test.
-	 */
-	assert(bdc->reuse_limit);
+static uint32_t bgp_damp_info_hash(const struct bgp_damp_info *bdi)
+{
+	return jhash(&bdi->path, sizeof(bdi->path), 0x64616d70);
+}
 
-	i = (int)(((double)penalty / bdc->reuse_limit - 1.0)
-		  * bdc->scale_factor);
+DECLARE_HASH(bgp_damp_infos, struct bgp_damp_info, hash, bgp_damp_info_cmp,
+	     bgp_damp_info_hash);
 
-	if (i >= bdc->reuse_index_size)
-		i = bdc->reuse_index_size - 1;
+/* Dampening information is kept here rather than in bgp_path_info_extra,
+ * so paths that only ever flapped don't need one.
+ */
+static struct bgp_damp_infos_head bgp_damp_infos = INIT_HASH(bgp_damp_infos);
 
-	index = bdc->reuse_index[i] - bdc->reuse_index[0];
+struct bgp_damp_info *bgp_damp_info_get(const struct bgp_path_info *path)
+{
+	struct bgp_damp_info key = {
+		.path = (struct bgp_path_info *)path,
+	};
+
+	if (!bgp_damp_infos_count(&bgp_damp_infos))
+		return NULL;
 
-	return (bdc->reuse_offset + index) % bdc->reuse_list_size;
+	return bgp_damp_infos_find(&bgp_damp_infos, &key);
 }
 
-/* Add BGP dampening information to reuse list.  */
-static void bgp_reuse_list_add(struct bgp_damp_info *bdi,
-			       struct bgp_damp_config *bdc)
+/* Return decayed penalty value.  */
+int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
 {
-	int index;
+	time_t i;
 
-	index = bdi->index = bgp_reuse_index(bdi->penalty, bdc);
+	i = tdiff / DELTA_T;
+
+	if (i <= 0)
+		return penalty;
+
+	if (i >= bdc->decay_array_size)
+		return 0;
 
-	bdi->prev = NULL;
-	bdi->next = bdc->reuse_list[index];
-	if (bdc->reuse_list[index])
-		bdc->reuse_list[index]->prev = bdi;
-	bdc->reuse_list[index] = bdi;
+	return ((uint64_t)penalty * bdc->decay_array[i])
+	       >> BGP_DAMP_DECAY_SHIFT;
 }
 
-/* Delete BGP dampening information from reuse list.  */
-static void bgp_reuse_list_delete(struct bgp_damp_info *bdi,
+/* Seconds until penalty decays below the reuse limit, looked up in the
+ * decay array.
+ */
+static time_t bgp_damp_reuse_secs(unsigned int penalty,
 				  struct bgp_damp_config *bdc)
 {
-	if (bdi->next)
-		bdi->next->prev = bdi->prev;
-	if (bdi->prev)
-		bdi->prev->next = bdi->next;
-	else
-		bdc->reuse_list[bdi->index] = bdi->next;
+	unsigned int lo = 1, hi = bdc->decay_array_size, mid;
+
+	if (penalty < bdc->reuse_limit)
+		return 0;
+
+	/* first entry that gets it below, decay_array_size if none */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if ((((uint64_t)penalty * bdc->decay_array[mid])
+		     >> BGP_DAMP_DECAY_SHIFT)
+		    < bdc->reuse_limit)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return (time_t)lo * DELTA_T;
 }
 
-/* Return decayed penalty value.  */
-int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
+/* Calculate reuse list index by penalty value.  */
+static unsigned int bgp_reuse_index(unsigned int penalty,
+				    struct bgp_damp_config *bdc)
 {
-	unsigned int i;
+	time_t ticks;
 
-	i = (int)((double)tdiff / DELTA_T);
+	ticks = (bgp_damp_reuse_secs(penalty, bdc) + DELTA_REUSE - 1)
+		/ DELTA_REUSE;
 
-	if (i == 0)
-		return penalty;
+	/* the list at reuse_offset is the one processed next; routes still
+	 * over the limit when theirs comes around go on a later one
+	 */
+	if (ticks > 0)
+		ticks--;
+	if (ticks >= bdc->reuse_list_size)
+		ticks = bdc->reuse_list_size - 1;
 
-	if (i >= bdc->decay_array_size)
-		return 0;
+	return (bdc->reuse_offset + ticks) % bdc->reuse_list_size;
+}
+
+/* Add BGP dampening information to reuse list.  */
+static void bgp_reuse_list_add(struct bgp_damp_info *bdi,
+			       struct bgp_damp_config *bdc)
+{
+	bdi->index = bgp_reuse_index(bdi->penalty, bdc);
+	bgp_reuse_list_add_head(&bdc->reuse_list[bdi->index], bdi);
+}
 
-	return (int)(penalty * bdc->decay_array[i]);
+/* Delete BGP dampening information from reuse list.  */
+static void bgp_reuse_list_delete(struct bgp_damp_info *bdi,
+				  struct bgp_damp_config *bdc)
+{
+	bgp_reuse_list_del(&bdc->reuse_list[bdi->index], bdi);
+	bdi->index = -1;
+}
+
+/* Utility functions to add and delete BGP dampening information to no
+   used list.  */
+static void bgp_damp_list_add(struct bgp_damp_config *bdc,
+			      struct bgp_damp_info *bdi)
+{
+	bdi->index = -1;
+	bgp_reuse_list_add_head(&bdc->no_reuse_list, bdi);
+}
+
+static void bgp_damp_list_del(struct bgp_damp_config *bdc,
+			      struct bgp_damp_info *bdi)
+{
+	bgp_reuse_list_del(&bdc->no_reuse_list, bdi);
 }
 
 /* Handler of reuse timer event.  Each route in the current reuse-list
@@ -116,7 +172,7 @@ int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
 static void bgp_reuse_timer(struct thread *t)
 {
 	struct bgp_damp_info *bdi;
-	struct bgp_damp_info *next;
+	struct bgp_reuse_list_head list;
 	time_t t_now, t_diff;
 
 	struct bgp_damp_config *bdc = THREAD_ARG(t);
@@ -129,18 +185,19 @@ static void bgp_reuse_timer(struct thread *t)
 
 	/* 1.  save a pointer to the current zeroth queue head and zero the
 	   list head entry.  */
-	bdi = bdc->reuse_list[bdc->reuse_offset];
-	bdc->reuse_list[bdc->reuse_offset] = NULL;
+	bgp_reuse_list_init(&list);
+	bgp_reuse_list_swap_all(&list, &bdc->reuse_list[bdc->reuse_offset]);
 
 	/* 2.  set offset = modulo reuse-list-size ( offset + 1 ), thereby
 	   rotating the circular queue of list-heads.  */
 	bdc->reuse_offset = (bdc->reuse_offset + 1) % bdc->reuse_list_size;
 
 	/* 3. if ( the saved list head pointer is non-empty ) */
-	for (; bdi; bdi = next) {
+	while ((bdi = bgp_reuse_list_pop(&list))) {
 		struct bgp *bgp = bdi->path->peer->bgp;
+		struct bgp_dest *dest = bdi->path->net;
 
-		next = bdi->next;
+		bdi->index = -1;
 
 		/* Set t-diff = t-now - t-updated.  */
 		t_diff = t_now - bdi->t_updated;
@@ -155,29 +212,29 @@ static void bgp_reuse_timer(struct thread *t)
 		/* if (figure-of-merit < reuse).  */
 		if (bdi->penalty < bdc->reuse_limit) {
 			/* Reuse the route.  */
-			bgp_path_info_unset_flag(bdi->dest, bdi->path,
+			bgp_path_info_unset_flag(dest, bdi->path,
 						 BGP_PATH_DAMPED);
 			bdi->suppress_time = 0;
 
 			if (bdi->lastrecord == BGP_RECORD_UPDATE) {
-				bgp_path_info_unset_flag(bdi->dest, bdi->path,
+				bgp_path_info_unset_flag(dest, bdi->path,
 							 BGP_PATH_HISTORY);
 				bgp_aggregate_increment(
-					bgp, bgp_dest_get_prefix(bdi->dest),
+					bgp, bgp_dest_get_prefix(dest),
 					bdi->path, bdi->afi, bdi->safi);
-				bgp_process(bgp, bdi->dest, bdi->afi,
-					    bdi->safi);
+				bgp_process(bgp, dest, bdi->afi, bdi->safi);
 			}
 
-			if (bdi->penalty <= bdc->reuse_limit / 2.0)
+			bgp_damp_list_add(bdc, bdi);
+			if (bdi->penalty <= bdc->reuse_limit / 2)
 				bgp_damp_info_free(bdi, 1, bdc->afi, bdc->safi);
-			else
-				BGP_DAMP_LIST_ADD(bdc, bdi);
 		} else
 			/* Re-insert into another list (See RFC2439 Section
 			 * 4.8.6).  */
 			bgp_reuse_list_add(bdi, bdc);
 	}
+
+	bgp_reuse_list_fini(&list);
 }
 
 /* A route becomes unreachable (RFC2439 Section 4.8.2).  */
@@ -192,8 +249,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 	t_now = monotime(NULL);
 
 	/* Processing Unreachable Messages.  */
-	if (path->extra)
-		bdi = path->extra->damp_info;
+	bdi = bgp_damp_info_get(path);
 
 	if (bdi == NULL) {
 		/* If there is no previous stability history. */
@@ -206,17 +262,15 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		bdi = XCALLOC(MTYPE_BGP_DAMP_INFO,
 			      sizeof(struct bgp_damp_info));
 		bdi->path = path;
-		bdi->dest = dest;
 		bdi->penalty =
 			(attr_change ? DEFAULT_PENALTY / 2 : DEFAULT_PENALTY);
 		bdi->flap = 1;
 		bdi->start_time = t_now;
 		bdi->suppress_time = 0;
-		bdi->index = -1;
 		bdi->afi = afi;
 		bdi->safi = safi;
-		(bgp_path_info_extra_get(path))->damp_info = bdi;
-		BGP_DAMP_LIST_ADD(bdc, bdi);
+		bgp_damp_infos_add(&bgp_damp_infos, bdi);
+		bgp_damp_list_add(bdc, bdi);
 	} else {
 		last_penalty = bdi->penalty;
 
@@ -232,7 +286,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		bdi->flap++;
 	}
 
-	assert((dest == bdi->dest) && (path == bdi->path));
+	assert(dest == path->net);
 
 	bdi->lastrecord = BGP_RECORD_WITHDRAW;
 	bdi->t_updated = t_now;
@@ -255,7 +309,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 	if (bdi->penalty >= bdc->suppress_value) {
 		bgp_path_info_set_flag(dest, path, BGP_PATH_DAMPED);
 		bdi->suppress_time = t_now;
-		BGP_DAMP_LIST_DEL(bdc, bdi);
+		bgp_damp_list_del(bdc, bdi);
 		bgp_reuse_list_add(bdi, bdc);
 	}
 
@@ -270,7 +324,8 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 	int status;
 	struct bgp_damp_config *bdc = &damp[afi][safi];
 
-	if (!path->extra || !((bdi = path->extra->damp_info)))
+	bdi = bgp_damp_info_get(path);
+	if (!bdi)
 		return BGP_DAMP_USED;
 
 	t_now = monotime(NULL);
@@ -287,13 +342,13 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 		 && (bdi->penalty < bdc->reuse_limit)) {
 		bgp_path_info_unset_flag(dest, path, BGP_PATH_DAMPED);
 		bgp_reuse_list_delete(bdi, bdc);
-		BGP_DAMP_LIST_ADD(bdc, bdi);
+		bgp_damp_list_add(bdc, bdi);
 		bdi->suppress_time = 0;
 		status = BGP_DAMP_USED;
 	} else
 		status = BGP_DAMP_SUPPRESSED;
 
-	if (bdi->penalty > bdc->reuse_limit / 2.0)
+	if (bdi->penalty > bdc->reuse_limit / 2)
 		bdi->t_updated = t_now;
 	else
 		bgp_damp_info_free(bdi, 0, afi, safi);
@@ -311,18 +366,18 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw, afi_t afi,
 		return;
 
 	path = bdi->path;
-	path->extra->damp_info = NULL;
+	bgp_damp_infos_del(&bgp_damp_infos, bdi);
 
-	if (CHECK_FLAG(path->flags, BGP_PATH_DAMPED))
+	if (bdi->index >= 0)
 		bgp_reuse_list_delete(bdi, bdc);
 	else
-		BGP_DAMP_LIST_DEL(bdc, bdi);
+		bgp_damp_list_del(bdc, bdi);
 
-	bgp_path_info_unset_flag(bdi->dest, path,
+	bgp_path_info_unset_flag(path->net, path,
 				 BGP_PATH_HISTORY | BGP_PATH_DAMPED);
 
 	if (bdi->lastrecord == BGP_RECORD_WITHDRAW && withdraw)
-		bgp_path_info_delete(bdi->dest, path);
+		bgp_path_info_delete(path->net, path);
 
 	XFREE(MTYPE_BGP_DAMP_INFO, bdi);
 }
@@ -330,66 +385,41 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw, afi_t afi,
 static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup,
 				   struct bgp_damp_config *bdc)
 {
-	double reuse_max_ratio;
+	double ceiling;
 	unsigned int i;
-	double j;
 
 	bdc->suppress_value = sup;
 	bdc->half_life = hlife;
 	bdc->reuse_limit = reuse;
 	bdc->max_suppress_time = maxsup;
 
-	/* Initialize params per bgp_damp_config. */
-	bdc->reuse_index_size = REUSE_ARRAY_SIZE;
-
-	bdc->ceiling = (int)(bdc->reuse_limit
-			     * (pow(2, (double)bdc->max_suppress_time
-					       / bdc->half_life)));
+	ceiling = bdc->reuse_limit
+		  * pow(2, (double)bdc->max_suppress_time / bdc->half_life);
+	bdc->ceiling = ceiling < INT_MAX ? (unsigned int)ceiling : INT_MAX;
 
-	/* Decay-array computations */
+	/* Decay-array computations, floating point only here */
 	bdc->decay_array_size = ceil((double)bdc->max_suppress_time / DELTA_T);
 	bdc->decay_array = XMALLOC(MTYPE_BGP_DAMP_ARRAY,
-				   sizeof(double) * (bdc->decay_array_size));
-	bdc->decay_array[0] = 1.0;
-	bdc->decay_array[1] =
-		exp((1.0 / ((double)bdc->half_life / DELTA_T)) * log(0.5));
+				   sizeof(uint32_t) * (bdc->decay_array_size));
 
-	/* Calculate decay values for all possible times */
-	for (i = 2; i < bdc->decay_array_size; i++)
+	for (i = 0; i < bdc->decay_array_size; i++)
 		bdc->decay_array[i] =
-			bdc->decay_array[i - 1] * bdc->decay_array[1];
-
-	/* Reuse-list computations */
-	i = ceil((double)bdc->max_suppress_time / DELTA_REUSE) + 1;
-	if (i > REUSE_LIST_SIZE || i == 0)
-		i = REUSE_LIST_SIZE;
-	bdc->reuse_list_size = i;
+			lround(ldexp(pow(0.5, (double)i * DELTA_T
+						      / bdc->half_life),
+				     BGP_DAMP_DECAY_SHIFT));
 
+	/* Reuse-list computations, enough lists to cover the max suppress
+	 * time so routes don't go around more than once
+	 */
+	bdc->reuse_list_size = bdc->max_suppress_time / DELTA_REUSE + 2;
 	bdc->reuse_list =
 		XCALLOC(MTYPE_BGP_DAMP_ARRAY,
-			bdc->reuse_list_size * sizeof(struct bgp_reuse_node *));
-
-	/* Reuse-array computations */
-	bdc->reuse_index = XCALLOC(MTYPE_BGP_DAMP_ARRAY,
-				   sizeof(int) * bdc->reuse_index_size);
-
-	reuse_max_ratio = (double)bdc->ceiling / bdc->reuse_limit;
-	j = (exp((double)bdc->max_suppress_time / bdc->half_life) * log10(2.0));
-	if (reuse_max_ratio > j && j != 0)
-		reuse_max_ratio = j;
-
-	bdc->scale_factor =
-		(double)bdc->reuse_index_size / (reuse_max_ratio - 1);
-
-	for (i = 0; i < bdc->reuse_index_size; i++) {
-		bdc->reuse_index[i] =
-			(int)(((double)bdc->half_life / DELTA_REUSE)
-			      * log10(1.0
-				      / (bdc->reuse_limit
-					 * (1.0
-					    + ((double)i / bdc->scale_factor))))
-			      / log10(0.5));
-	}
+			bdc->reuse_list_size * sizeof(bdc->reuse_list[0]));
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		bgp_reuse_list_init(&bdc->reuse_list[i]);
+	bdc->reuse_offset = 0;
+
+	bgp_reuse_list_init(&bdc->no_reuse_list);
 }
 
 int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
@@ -417,44 +447,40 @@ int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 
 static void bgp_damp_config_clean(struct bgp_damp_config *bdc)
 {
+	unsigned int i;
+
 	/* Free decay array */
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->decay_array);
 	bdc->decay_array_size = 0;
 
-	/* Free reuse index array */
-	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->reuse_index);
-	bdc->reuse_index_size = 0;
-
 	/* Free reuse list array. */
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		bgp_reuse_list_fini(&bdc->reuse_list[i]);
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->reuse_list);
 	bdc->reuse_list_size = 0;
+
+	bgp_reuse_list_fini(&bdc->no_reuse_list);
 }
 
 /* Clean all the bgp_damp_info stored in reuse_list. */
 void bgp_damp_info_clean(afi_t afi, safi_t safi)
 {
 	unsigned int i;
-	struct bgp_damp_info *bdi, *next;
+	struct bgp_damp_info *bdi;
 	struct bgp_damp_config *bdc = &damp[afi][safi];
 
-	bdc->reuse_offset = 0;
+	/* dampening isn't enabled */
+	if (!bdc->reuse_list)
+		return;
 
-	for (i = 0; i < bdc->reuse_list_size; i++) {
-		if (!bdc->reuse_list[i])
-			continue;
+	bdc->reuse_offset = 0;
 
-		for (bdi = bdc->reuse_list[i]; bdi; bdi = next) {
-			next = bdi->next;
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		while ((bdi = bgp_reuse_list_first(&bdc->reuse_list[i])))
 			bgp_damp_info_free(bdi, 1, afi, safi);
-		}
-		bdc->reuse_list[i] = NULL;
-	}
 
-	for (bdi = bdc->no_reuse_list; bdi; bdi = next) {
-		next = bdi->next;
+	while ((bdi = bgp_reuse_list_first(&bdc->no_reuse_list)))
 		bgp_damp_info_free(bdi, 1, afi, safi);
-	}
-	bdc->no_reuse_list = NULL;
 }
 
 int bgp_damp_disable(struct bgp *bgp, afi_t afi, safi_t safi)
@@ -509,10 +535,7 @@ static const char *bgp_get_reuse_time(unsigned int penalty, char *buf,
 	int time_store = 0;
 
 	if (penalty > damp[afi][safi].reuse_limit) {
-		reuse_time = (int)(DELTA_T
-				   * ((log((double)damp[afi][safi].reuse_limit
-					   / penalty))
-				      / (log(damp[afi][safi].decay_array[1]))));
+		reuse_time = bgp_damp_reuse_secs(penalty, &damp[afi][safi]);
 
 		if (reuse_time > damp[afi][safi].max_suppress_time)
 			reuse_time = damp[afi][safi].max_suppress_time;
@@ -576,11 +599,8 @@ void bgp_damp_info_vty(struct vty *vty, struct bgp_path_info *path, afi_t afi,
 	int penalty;
 	struct bgp_damp_config *bdc = &damp[afi][safi];
 
-	if (!path->extra)
-		return;
-
 	/* BGP dampening information.  */
-	bdi = path->extra->damp_info;
+	bdi = bgp_damp_info_get(path);
 
 	/* If dampening is not enabled or there is no dampening information,
 	   return immediately.  */
@@ -630,11 +650,8 @@ const char *bgp_damp_reuse_time_vty(struct vty *vty, struct bgp_path_info *path,
 	int penalty;
 	struct bgp_damp_config *bdc = &damp[afi][safi];
 
-	if (!path->extra)
-		return NULL;
-
 	/* BGP dampening information.  */
-	bdi = path->extra->damp_info;
+	bdi = bgp_damp_info_get(path);
 
 	/* If dampening is not enabled or there is no dampening information,
 	   return immediately.  */
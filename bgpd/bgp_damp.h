@@ -21,20 +21,22 @@
 #ifndef _QUAGGA_BGP_DAMP_H
 #define _QUAGGA_BGP_DAMP_H
 
+#include "typesafe.h"
 #include "bgpd/bgp_table.h"
 
+PREDECL_DLIST(bgp_reuse_list);
+PREDECL_HASH(bgp_damp_infos);
+
 /* Structure maintained on a per-route basis. */
 struct bgp_damp_info {
-	/* Doubly linked list.  This information must be linked to
-	   reuse_list or no_reuse_list.  */
-	struct bgp_damp_info *next;
-	struct bgp_damp_info *prev;
+	/* On a reuse list, or on no_reuse_list when index is -1.  */
+	struct bgp_reuse_list_item list;
 
-	/* Figure-of-merit.  */
-	unsigned int penalty;
+	/* In the table of all dampening information, by path.  */
+	struct bgp_damp_infos_item hash;
 
-	/* Number of flapping.  */
-	unsigned int flap;
+	/* Back reference to bgp_path_info. */
+	struct bgp_path_info *path;
 
 	/* First flap time  */
 	time_t start_time;
@@ -45,22 +47,22 @@ struct bgp_damp_info {
 	/* Time of route start to be suppressed.  */
 	time_t suppress_time;
 
-	/* Back reference to bgp_path_info. */
-	struct bgp_path_info *path;
+	/* Figure-of-merit.  */
+	unsigned int penalty;
 
-	/* Back reference to bgp_node. */
-	struct bgp_dest *dest;
+	/* Number of flapping.  */
+	unsigned int flap;
 
 	/* Current index in the reuse_list. */
 	int index;
 
+	afi_t afi;
+	safi_t safi;
+
 	/* Last time message type. */
 	uint8_t lastrecord;
 #define BGP_RECORD_UPDATE	1U
 #define BGP_RECORD_WITHDRAW	2U
-
-	afi_t afi;
-	safi_t safi;
 };
 
 /* Specified parameter set configuration. */
@@ -82,29 +84,27 @@ struct bgp_damp_config {
 	 */
 	time_t tmax; /* Max time previous instability retained */
 	unsigned int reuse_list_size;  /* Number of reuse lists */
-	unsigned int reuse_index_size; /* Size of reuse index array */
 
 	/* Non-configurable parameters.  Most of these are calculated from
 	 * the configurable parameters above.
 	 */
 	unsigned int ceiling;		  /* Max value a penalty can attain */
-	unsigned int decay_rate_per_tick; /* Calculated from half-life */
 	unsigned int decay_array_size; /* Calculated using config parameters */
-	double scale_factor;
-	unsigned int reuse_scale_factor;
-
-	/* Decay array per-set based. */
-	double *decay_array;
 
-	/* Reuse index array per-set based. */
-	int *reuse_index;
+	/* Decay array per-set based, fixed point with BGP_DAMP_DECAY_SHIFT
+	 * fractional bits, for every DELTA_T up to max_suppress_time.
+	 */
+	uint32_t *decay_array;
 
-	/* Reuse list array per-set based. */
-	struct bgp_damp_info **reuse_list;
-	int reuse_offset;
+	/* Reuse list array per-set based.  This is a timer wheel, the list
+	 * at reuse_offset is processed every DELTA_REUSE and a route goes
+	 * into the list for the time its penalty gets below reuse_limit.
+	 */
+	struct bgp_reuse_list_head *reuse_list;
+	unsigned int reuse_offset;
 
 	/* All dampening information which is not on reuse list.  */
-	struct bgp_damp_info *no_reuse_list;
+	struct bgp_reuse_list_head no_reuse_list;
 
 	/* Reuse timer thread per-set base. */
 	struct thread *t_reuse;
@@ -129,8 +129,7 @@ struct bgp_damp_config {
 #define DEFAULT_REUSE 	       	 750
 #define DEFAULT_SUPPRESS 	2000
 
-#define REUSE_LIST_SIZE          256
-#define REUSE_ARRAY_SIZE        1024
+#define BGP_DAMP_DECAY_SHIFT      24
 
 extern int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 			   unsigned int reuse, unsigned int suppress,
@@ -140,6 +139,7 @@ extern int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 			     afi_t afi, safi_t safi, int attr_change);
 extern int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 			   afi_t afi, safi_t saff);
+extern struct bgp_damp_info *bgp_damp_info_get(const struct bgp_path_info *path);
 extern void bgp_damp_info_free(struct bgp_damp_info *path, int withdraw,
 			       afi_t afi, safi_t safi);
 extern void bgp_damp_info_clean(afi_t afi, safi_t safi);
@@ -30,6 +30,12 @@
 #include "queue.h"
 #include "memory.h"
 #include "filter.h"
+#include "frratomic.h"
+#include "frr_pthread.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "bgpd/bgp_table.h"
 #include "bgpd/bgpd.h"
@@ -39,6 +45,8 @@
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_packet.h"
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_DUMP_FILE, "BGP MRT table dump");
+
 enum bgp_dump_type {
 	BGP_DUMP_ALL,
 	BGP_DUMP_ALL_ET,
@@ -73,6 +81,50 @@ enum MRT_MSG_TYPES {
 	MSG_TABLE_DUMP_V2	 /* routing table dump, version 2 */
 };
 
+/* records are collected into chunks of this size for the writer */
+#define BGP_DUMP_CHUNK_SIZE	(64 * 1024)
+/* the table walk waits while this many chunks are not written yet */
+#define BGP_DUMP_CHUNKS_MAX	64
+/* records per run of the table walk */
+#define BGP_DUMP_WALK_BATCH	4096
+
+/*
+ * A routes-mrt dump.  The table is walked on the main pthread a piece at
+ * a time, and the records are written out (and compressed) by the dump
+ * writer pthread.  Once the walk is done and "last" is set, the writer
+ * closes the file and hands the dump back to the main pthread.
+ */
+struct bgp_dump_file {
+	char *filename;
+
+	FILE *fp;
+#ifdef HAVE_ZLIB
+	gzFile gz;
+#endif
+	/* filled chunks, for the writer */
+	struct stream_fifo *fifo;
+	atomic_bool last;
+	struct thread *t_write;
+
+	/* writer pthread only, until the file is closed */
+	bool closed;
+	int error;
+	_Atomic uint64_t bytes;
+
+	/* main pthread only */
+	struct stream *chunk;
+	struct bgp *bgp;
+	afi_t afi;
+	bgp_table_iter_t iter;
+	uint16_t npeers;
+	unsigned int seq;
+	uint64_t prefixes;
+	struct timeval started;
+	bool aborted;
+	struct thread *t_walk;
+	struct thread *t_done;
+};
+
 struct bgp_dump {
 	enum bgp_dump_type type;
 
@@ -85,10 +137,21 @@ struct bgp_dump {
 	char *interval_str;
 
 	struct thread *t_interval;
+
+	/* routes-mrt only */
+	struct bgp_dump_file *running;
+	uint64_t last_records, last_prefixes, last_bytes;
+	struct timeval last_duration;
+	time_t last_end;
+	int last_error;
 };
 
 static int bgp_dump_unset(struct bgp_dump *bgp_dump);
 static void bgp_dump_interval_func(struct thread *);
+static void bgp_dump_file_write(struct thread *t);
+
+/* writes out routes-mrt dumps */
+static struct frr_pthread *bgp_dump_pth;
 
 /* BGP packet dump output buffer. */
 struct stream *bgp_dump_obuf;
@@ -215,7 +278,26 @@ static void bgp_dump_set_size(struct stream *s, int type)
 	stream_putl_at(s, 8, stream_get_endp(s) - BGP_DUMP_HEADER_SIZE);
 }
 
-static void bgp_dump_routes_index_table(struct bgp *bgp)
+/* queues a copy of obuf for the writer */
+static void bgp_dump_file_put(struct bgp_dump_file *df, struct stream *obuf)
+{
+	size_t len = stream_get_endp(obuf);
+
+	if (df->chunk && STREAM_WRITEABLE(df->chunk) < len) {
+		stream_fifo_push_safe(df->fifo, df->chunk);
+		df->chunk = NULL;
+		thread_add_event(bgp_dump_pth->master, bgp_dump_file_write, df,
+				 0, &df->t_write);
+	}
+	if (!df->chunk)
+		df->chunk = stream_new(MAX(len, BGP_DUMP_CHUNK_SIZE));
+
+	stream_put(df->chunk, STREAM_DATA(obuf), len);
+	df->seq++;
+}
+
+static void bgp_dump_routes_index_table(struct bgp_dump_file *df,
+					struct bgp *bgp)
 {
 	struct peer *peer;
 	struct listnode *node;
@@ -292,15 +374,18 @@ static void bgp_dump_routes_index_table(struct bgp *bgp)
 		peerno++;
 	}
 
+	df->npeers = peerno - 1;
+
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
+	bgp_dump_file_put(df, obuf);
 
-	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
-	fflush(bgp_dump_routes.fp);
+	/* sequence numbers are for the RIB entries only */
+	df->seq = 0;
 }
 
 static struct bgp_path_info *
-bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
-			   struct bgp_path_info *path, unsigned int seq)
+bgp_dump_route_node_record(struct bgp_dump_file *df, int afi,
+			   struct bgp_dest *dest, struct bgp_path_info *path)
 {
 	struct stream *obuf;
 	size_t sizep;
@@ -332,7 +417,7 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 				BGP_DUMP_ROUTES);
 
 	/* Sequence number */
-	stream_putl(obuf, seq);
+	stream_putl(obuf, df->seq);
 
 	/* Prefix length */
 	stream_putc(obuf, p->prefixlen);
@@ -363,8 +448,13 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	for (; path; path = path->next) {
 		size_t cur_endp;
 
-		/* Peer index */
-		stream_putw(obuf, path->peer->table_dump_index);
+		/* Peer index, peers that came up during the dump aren't in
+		 * the index table (or are there with an old index)
+		 */
+		if (path->peer->table_dump_index <= df->npeers)
+			stream_putw(obuf, path->peer->table_dump_index);
+		else
+			stream_putw(obuf, 0);
 
 		/* Originated */
 		stream_putl(obuf, time(NULL) - (monotime(NULL) - path->uptime));
@@ -394,49 +484,257 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	stream_putw_at(obuf, sizep, entry_count);
 
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
-	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
+	bgp_dump_file_put(df, obuf);
 
 	return path;
 }
 
 
-/* Runs under child process. */
-static unsigned int bgp_dump_routes_func(int afi, int first_run,
-					 unsigned int seq)
+/* on the writer pthread */
+static void bgp_dump_file_output(struct bgp_dump_file *df, struct stream *s)
+{
+	size_t len = stream_get_endp(s);
+
+	if (df->error)
+		return;
+
+#ifdef HAVE_ZLIB
+	if (df->gz) {
+		if (gzwrite(df->gz, STREAM_DATA(s), len) != (int)len)
+			df->error = EIO;
+		return;
+	}
+#endif
+	if (fwrite(STREAM_DATA(s), len, 1, df->fp) != 1)
+		df->error = errno;
+}
+
+static void bgp_dump_file_done(struct thread *t);
+
+/* writes what is queued; returns true once the file has been closed */
+static bool bgp_dump_file_flush(struct bgp_dump_file *df)
+{
+	bool last = atomic_load_explicit(&df->last, memory_order_acquire);
+	struct stream *s;
+
+	if (df->closed)
+		return false;
+
+	while ((s = stream_fifo_pop_safe(df->fifo))) {
+		bgp_dump_file_output(df, s);
+		atomic_fetch_add_explicit(&df->bytes, stream_get_endp(s),
+					  memory_order_relaxed);
+		stream_free(s);
+	}
+
+	/* everything queued before "last" was set has been written now */
+	if (!last)
+		return false;
+
+#ifdef HAVE_ZLIB
+	if (df->gz && gzclose(df->gz) != Z_OK && !df->error)
+		df->error = EIO;
+	df->gz = NULL;
+#endif
+	if (df->fp && fclose(df->fp) != 0 && !df->error)
+		df->error = errno;
+	df->fp = NULL;
+	df->closed = true;
+	return true;
+}
+
+static void bgp_dump_file_write(struct thread *t)
+{
+	struct bgp_dump_file *df = THREAD_ARG(t);
+
+	if (bgp_dump_file_flush(df))
+		thread_add_event(bm->master, bgp_dump_file_done, df, 0,
+				 &df->t_done);
+}
+
+static void bgp_dump_file_free(struct bgp_dump_file *df)
+{
+	struct stream *s;
+
+	while ((s = stream_fifo_pop_safe(df->fifo)))
+		stream_free(s);
+	stream_fifo_free(df->fifo);
+	stream_free(df->chunk);
+
+	XFREE(MTYPE_BGP_DUMP_STR, df->filename);
+	XFREE(MTYPE_BGP_DUMP_FILE, df);
+}
+
+/* no more records, let the writer finish */
+static void bgp_dump_file_close(struct bgp_dump_file *df)
+{
+	THREAD_OFF(df->t_walk);
+
+	if (df->iter.table)
+		bgp_table_iter_cleanup(&df->iter);
+	if (df->bgp)
+		bgp_unlock(df->bgp);
+	df->bgp = NULL;
+
+	if (df->chunk) {
+		stream_fifo_push_safe(df->fifo, df->chunk);
+		df->chunk = NULL;
+	}
+
+	atomic_store_explicit(&df->last, true, memory_order_release);
+	thread_add_event(bgp_dump_pth->master, bgp_dump_file_write, df, 0,
+			 &df->t_write);
+}
+
+/* back on the main pthread */
+static void bgp_dump_file_done(struct thread *t)
+{
+	struct bgp_dump_file *df = THREAD_ARG(t);
+	struct bgp_dump *bgp_dump = &bgp_dump_routes;
+	struct timeval now;
+
+	/* there may be one more (no-op) write run scheduled */
+	thread_cancel_async(bgp_dump_pth->master, &df->t_write, NULL);
+
+	monotime(&now);
+	timersub(&now, &df->started, &bgp_dump->last_duration);
+	bgp_dump->last_end = time(NULL);
+	bgp_dump->last_records = df->seq;
+	bgp_dump->last_prefixes = df->prefixes;
+	bgp_dump->last_bytes = atomic_load_explicit(&df->bytes,
+						    memory_order_relaxed);
+	bgp_dump->last_error = df->error;
+
+	if (df->error)
+		flog_warn(EC_BGP_DUMP, "MRT table dump to %s failed: %s",
+			  df->filename, safe_strerror(df->error));
+	else
+		zlog_info("MRT table dump to %s %s: %u records, %" PRIu64
+			  " prefixes, %" PRIu64 " bytes in %lld.%03ld s",
+			  df->filename, df->aborted ? "aborted" : "done",
+			  df->seq, df->prefixes, bgp_dump->last_bytes,
+			  (long long)bgp_dump->last_duration.tv_sec,
+			  (long)bgp_dump->last_duration.tv_usec / 1000);
+
+	if (bgp_dump->running == df)
+		bgp_dump->running = NULL;
+	bgp_dump_file_free(df);
+}
+
+/* a piece of the table at a time, so bgpd stays responsive */
+static void bgp_dump_routes_walk(struct thread *t)
 {
+	struct bgp_dump_file *df = THREAD_ARG(t);
 	struct bgp_path_info *path;
 	struct bgp_dest *dest;
+	unsigned int start = df->seq;
+
+	/* let the writer catch up */
+	if (stream_fifo_count_safe(df->fifo) >= BGP_DUMP_CHUNKS_MAX) {
+		thread_add_timer_msec(bm->master, bgp_dump_routes_walk, df, 10,
+				      &df->t_walk);
+		return;
+	}
+
+	while (df->seq - start < BGP_DUMP_WALK_BATCH) {
+		dest = bgp_table_iter_next(&df->iter);
+		if (!dest) {
+			bgp_table_iter_cleanup(&df->iter);
+			if (df->afi == AFI_IP) {
+				df->afi = AFI_IP6;
+				bgp_table_iter_init(
+					&df->iter,
+					df->bgp->rib[AFI_IP6][SAFI_UNICAST]);
+				continue;
+			}
+
+			bgp_dump_file_close(df);
+			return;
+		}
+
+		path = bgp_dest_get_bgp_path_info(dest);
+		if (path)
+			df->prefixes++;
+		while (path)
+			path = bgp_dump_route_node_record(df, df->afi, dest,
+							  path);
+	}
+
+	bgp_table_iter_pause(&df->iter);
+	thread_add_event(bm->master, bgp_dump_routes_walk, df, 0, &df->t_walk);
+}
+
+static void bgp_dump_routes_start(struct bgp_dump *bgp_dump, FILE *fp)
+{
+	struct bgp_dump_file *df;
 	struct bgp *bgp;
-	struct bgp_table *table;
+	size_t len = strlen(bgp_dump->filename);
 
 	bgp = bgp_get_default();
-	if (!bgp)
-		return seq;
+	if (!bgp) {
+		fclose(fp);
+		return;
+	}
 
-	if (bgp_dump_routes.fp == NULL)
-		return seq;
+	if (!atomic_load_explicit(&bgp_dump_pth->running,
+				  memory_order_relaxed)) {
+		frr_pthread_run(bgp_dump_pth, NULL);
+		frr_pthread_wait_running(bgp_dump_pth);
+	}
 
-	/* Note that bgp_dump_routes_index_table will do ipv4 and ipv6 peers,
-	   so this should only be done on the first call to
-	   bgp_dump_routes_func.
-	   ( this function will be called once for ipv4 and once for ipv6 ) */
-	if (first_run)
-		bgp_dump_routes_index_table(bgp);
+	df = XCALLOC(MTYPE_BGP_DUMP_FILE, sizeof(*df));
+	df->filename = XSTRDUP(MTYPE_BGP_DUMP_STR, bgp_dump->filename);
+	df->fifo = stream_fifo_new();
+	df->fp = fp;
 
-	/* Walk down each BGP route. */
-	table = bgp->rib[afi][SAFI_UNICAST];
+	if (len > 3 && !strcmp(bgp_dump->filename + len - 3, ".gz")) {
+#ifdef HAVE_ZLIB
+		int fd = dup(fileno(fp));
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		path = bgp_dest_get_bgp_path_info(dest);
-		while (path) {
-			path = bgp_dump_route_node_record(afi, dest, path, seq);
-			seq++;
+		df->gz = fd >= 0 ? gzdopen(fd, "wb") : NULL;
+		if (df->gz) {
+			fclose(fp);
+			df->fp = NULL;
+		} else {
+			if (fd >= 0)
+				close(fd);
+			flog_warn(EC_BGP_DUMP,
+				  "MRT table dump to %s: gzip setup failed, writing uncompressed",
+				  df->filename);
 		}
+#else
+		flog_warn(EC_BGP_DUMP,
+			  "MRT table dump to %s: built without zlib, writing uncompressed",
+			  df->filename);
+#endif
 	}
 
-	fflush(bgp_dump_routes.fp);
+	monotime(&df->started);
+	bgp_dump->running = df;
 
-	return seq;
+	bgp_lock(bgp);
+	df->bgp = bgp;
+
+	/* Note that bgp_dump_routes_index_table will do ipv4 and ipv6
+	 * peers.
+	 */
+	bgp_dump_routes_index_table(df, bgp);
+
+	df->afi = AFI_IP;
+	bgp_table_iter_init(&df->iter, bgp->rib[AFI_IP][SAFI_UNICAST]);
+	thread_add_event(bm->master, bgp_dump_routes_walk, df, 0, &df->t_walk);
+}
+
+static void bgp_dump_routes_abort(struct bgp_dump *bgp_dump)
+{
+	struct bgp_dump_file *df = bgp_dump->running;
+
+	if (!df || df->aborted)
+		return;
+
+	df->aborted = true;
+	if (!atomic_load_explicit(&df->last, memory_order_relaxed))
+		bgp_dump_file_close(df);
 }
 
 static void bgp_dump_interval_func(struct thread *t)
@@ -444,18 +742,22 @@ static void bgp_dump_interval_func(struct thread *t)
 	struct bgp_dump *bgp_dump;
 	bgp_dump = THREAD_ARG(t);
 
-	/* Reschedule dump even if file couldn't be opened this time... */
-	if (bgp_dump_open_file(bgp_dump) != NULL) {
-		/* In case of bgp_dump_routes, we need special route dump
-		 * function. */
+	if (bgp_dump->type == BGP_DUMP_ROUTES && bgp_dump->running) {
+		flog_warn(EC_BGP_DUMP,
+			  "MRT table dump to %s still running, skipping this one",
+			  bgp_dump->running->filename);
+	} else if (bgp_dump_open_file(bgp_dump) != NULL) {
+		/* Reschedule dump even if file couldn't be opened this
+		 * time...  In case of bgp_dump_routes, the file is handed
+		 * over to the table dump, which closes it when done.  For a
+		 * RIB dump there's no point in leaving it open until the
+		 * next scheduled dump starts.
+		 */
 		if (bgp_dump->type == BGP_DUMP_ROUTES) {
-			unsigned int seq = bgp_dump_routes_func(AFI_IP, 1, 0);
-			bgp_dump_routes_func(AFI_IP6, 0, seq);
-			/* Close the file now. For a RIB dump there's no point
-			 * in leaving
-			 * it open until the next scheduled dump starts. */
-			fclose(bgp_dump->fp);
+			FILE *fp = bgp_dump->fp;
+
 			bgp_dump->fp = NULL;
+			bgp_dump_routes_start(bgp_dump, fp);
 		}
 	}
 
@@ -692,6 +994,11 @@ static int bgp_dump_set(struct vty *vty, struct bgp_dump *bgp_dump,
 
 static int bgp_dump_unset(struct bgp_dump *bgp_dump)
 {
+	/* A table dump in progress stops, what was dumped so far is still
+	 * written out.
+	 */
+	bgp_dump_routes_abort(bgp_dump);
+
 	/* Removing file name. */
 	XFREE(MTYPE_BGP_DUMP_STR, bgp_dump->filename);
 
@@ -799,6 +1106,70 @@ DEFUN (no_dump_bgp_all,
 	return bgp_dump_unset(bgp_dump_struct);
 }
 
+static void bgp_dump_show(struct vty *vty, struct bgp_dump *bgp_dump,
+			  const char *name)
+{
+	struct bgp_dump_file *df = bgp_dump->running;
+	struct timeval now, elapsed;
+	struct tm tm;
+	char buf[32];
+
+	if (!bgp_dump->filename)
+		return;
+
+	vty_out(vty, "%s: %s", name, bgp_dump->filename);
+	if (bgp_dump->interval_str)
+		vty_out(vty, ", every %s", bgp_dump->interval_str);
+	if (bgp_dump->t_interval)
+		vty_out(vty, ", next in %ld s",
+			thread_timer_remain_second(bgp_dump->t_interval));
+	vty_out(vty, "\n");
+
+	if (df) {
+		monotime(&now);
+		timersub(&now, &df->started, &elapsed);
+		vty_out(vty,
+			"  running for %lld.%03ld s: %s %u records, %" PRIu64
+			" prefixes, %" PRIu64 " bytes written\n",
+			(long long)elapsed.tv_sec,
+			(long)elapsed.tv_usec / 1000,
+			atomic_load_explicit(&df->last, memory_order_relaxed)
+				? "writing," : afi2str(df->afi),
+			df->seq, df->prefixes,
+			atomic_load_explicit(&df->bytes, memory_order_relaxed));
+	}
+
+	if (bgp_dump->last_end) {
+		localtime_r(&bgp_dump->last_end, &tm);
+		strftime(buf, sizeof(buf), "%F %T", &tm);
+		vty_out(vty,
+			"  last dump %s: %" PRIu64 " records, %" PRIu64
+			" prefixes, %" PRIu64 " bytes in %lld.%03ld s%s%s\n",
+			buf,
+			bgp_dump->last_records, bgp_dump->last_prefixes,
+			bgp_dump->last_bytes,
+			(long long)bgp_dump->last_duration.tv_sec,
+			(long)bgp_dump->last_duration.tv_usec / 1000,
+			bgp_dump->last_error ? ", failed: " : "",
+			bgp_dump->last_error
+				? safe_strerror(bgp_dump->last_error)
+				: "");
+	}
+}
+
+DEFUN (show_bgp_mrt_dump,
+       show_bgp_mrt_dump_cmd,
+       "show bgp mrt-dump",
+       SHOW_STR
+       BGP_STR
+       "MRT dump status\n")
+{
+	bgp_dump_show(vty, &bgp_dump_all, "all");
+	bgp_dump_show(vty, &bgp_dump_updates, "updates");
+	bgp_dump_show(vty, &bgp_dump_routes, "routes-mrt");
+	return CMD_SUCCESS;
+}
+
 static int config_write_bgp_dump(struct vty *vty);
 /* BGP node structure. */
 static struct cmd_node bgp_dump_node = {
@@ -859,10 +1230,20 @@ void bgp_dump_init(void)
 		stream_new((BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE * 2)
 			   + BGP_DUMP_MSG_HEADER + BGP_DUMP_HEADER_SIZE);
 
+	/* started with the first table dump, that's after daemonizing */
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+
+	bgp_dump_pth = frr_pthread_new(&attr, "BGP MRT dump writer",
+				       "bgpd_dump");
+
 	install_node(&bgp_dump_node);
 
 	install_element(CONFIG_NODE, &dump_bgp_all_cmd);
 	install_element(CONFIG_NODE, &no_dump_bgp_all_cmd);
+	install_element(VIEW_NODE, &show_bgp_mrt_dump_cmd);
 
 	hook_register(bgp_packet_dump, bgp_dump_packet);
 	hook_register(peer_status_changed, bgp_dump_state);
@@ -870,10 +1251,26 @@ void bgp_dump_init(void)
 
 void bgp_dump_finish(void)
 {
+	struct bgp_dump_file *df;
+
 	bgp_dump_unset(&bgp_dump_all);
 	bgp_dump_unset(&bgp_dump_updates);
 	bgp_dump_unset(&bgp_dump_routes);
 
+	if (atomic_load_explicit(&bgp_dump_pth->running, memory_order_relaxed))
+		frr_pthread_stop(bgp_dump_pth, NULL);
+	frr_pthread_destroy(bgp_dump_pth);
+	bgp_dump_pth = NULL;
+
+	/* the writer is gone, finish the last table dump from here */
+	df = bgp_dump_routes.running;
+	if (df) {
+		THREAD_OFF(df->t_done);
+		bgp_dump_file_flush(df);
+		bgp_dump_routes.running = NULL;
+		bgp_dump_file_free(df);
+	}
+
 	stream_free(bgp_dump_obuf);
 	bgp_dump_obuf = NULL;
 	hook_unregister(bgp_packet_dump, bgp_dump_packet);
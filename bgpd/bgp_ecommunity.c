@@ -26,7 +26,7 @@
 #include "command.h"
 #include "queue.h"
 #include "filter.h"
-#include "jhash.h"
+#include "fhash.h"
 #include "stream.h"
 
 #include "lib/printfrr.h"
@@ -70,6 +70,7 @@ void ecommunity_free(struct ecommunity **ecom)
 		return;
 
 	XFREE(MTYPE_ECOMMUNITY_VAL, (*ecom)->val);
+	XFREE(MTYPE_ECOMMUNITY_VAL, (*ecom)->rt_val);
 	XFREE(MTYPE_ECOMMUNITY_STR, (*ecom)->str);
 	XFREE(MTYPE_ECOMMUNITY, *ecom);
 }
@@ -301,6 +302,45 @@ struct ecommunity *ecommunity_merge(struct ecommunity *ecom1,
 	return ecom1;
 }
 
+static bool ecommunity_val_is_rt(const uint8_t *pnt)
+{
+	return (pnt[0] == ECOMMUNITY_ENCODE_AS || pnt[0] == ECOMMUNITY_ENCODE_IP
+		|| pnt[0] == ECOMMUNITY_ENCODE_AS4)
+	       && pnt[1] == ECOMMUNITY_ROUTE_TARGET;
+}
+
+static int ecommunity_val_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, ECOMMUNITY_SIZE);
+}
+
+/* Import decisions check a few configured RTs against a route's
+ * ecommunity, over and over for the same interned ones.
+ */
+static void ecommunity_rt_index(struct ecommunity *ecom)
+{
+	const uint8_t *pnt;
+	uint32_t i;
+
+	if (ecom->unit_size != ECOMMUNITY_SIZE)
+		return;
+
+	for (i = 0; i < ecom->size; i++) {
+		pnt = ecom->val + i * ECOMMUNITY_SIZE;
+		if (!ecommunity_val_is_rt(pnt))
+			continue;
+		if (!ecom->rt_val)
+			ecom->rt_val = XMALLOC(MTYPE_ECOMMUNITY_VAL,
+					       ecom->size * ECOMMUNITY_SIZE);
+		memcpy(ecom->rt_val + ecom->rt_count++ * ECOMMUNITY_SIZE, pnt,
+		       ECOMMUNITY_SIZE);
+	}
+
+	if (ecom->rt_count > 1)
+		qsort(ecom->rt_val, ecom->rt_count, ECOMMUNITY_SIZE,
+		      ecommunity_val_cmp);
+}
+
 /* Intern Extended Communities Attribute.  */
 struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 {
@@ -310,6 +350,8 @@ struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 	find = (struct ecommunity *)hash_get(ecomhash, ecom, hash_alloc_intern);
 	if (find != ecom)
 		ecommunity_free(&ecom);
+	else
+		ecommunity_rt_index(find);
 
 	find->refcnt++;
 
@@ -347,7 +389,7 @@ unsigned int ecommunity_hash_make(const void *arg)
 	const struct ecommunity *ecom = arg;
 	int size = ecom->size * ecom->unit_size;
 
-	return jhash(ecom->val, size, 0x564321ab);
+	return fhash(ecom->val, size, 0x564321ab);
 }
 
 /* Compare two Extended Communities Attribute structure.  */
@@ -1188,6 +1230,59 @@ char *ecommunity_ecom2str(struct ecommunity *ecom, int format, int filter)
 	return str_buf;
 }
 
+/* val is ecom->unit_size long */
+bool ecommunity_has_val(const struct ecommunity *ecom, const uint8_t *val)
+{
+	uint32_t i;
+
+	if (ecom->rt_val && ecommunity_val_is_rt(val))
+		return bsearch(val, ecom->rt_val, ecom->rt_count,
+			       ECOMMUNITY_SIZE, ecommunity_val_cmp)
+		       != NULL;
+
+	for (i = 0; i < ecom->size; i++)
+		if (!memcmp(ecom->val + i * ecom->unit_size, val,
+			    ecom->unit_size))
+			return true;
+	return false;
+}
+
+/* true if any value is on both */
+bool ecommunity_intersect(const struct ecommunity *ecom1,
+			  const struct ecommunity *ecom2)
+{
+	uint32_t i, j;
+
+	if (!ecom1 || !ecom2)
+		return false;
+
+	/* look up the values of the smaller one, usually configuration, on
+	 * the interned one
+	 */
+	if (ecom1->unit_size == ecom2->unit_size
+	    && (ecom2->rt_val || ecom1->rt_val)) {
+		if (!ecom2->rt_val) {
+			const struct ecommunity *tmp = ecom1;
+
+			ecom1 = ecom2;
+			ecom2 = tmp;
+		}
+		for (i = 0; i < ecom1->size; i++)
+			if (ecommunity_has_val(ecom2,
+					       ecom1->val + i * ecom1->unit_size))
+				return true;
+		return false;
+	}
+
+	for (i = 0; i < ecom1->size; i++)
+		for (j = 0; j < ecom2->size; j++)
+			if (!memcmp(ecom1->val + i * ecom1->unit_size,
+				    ecom2->val + j * ecom2->unit_size,
+				    ecom1->unit_size))
+				return true;
+	return false;
+}
+
 bool ecommunity_match(const struct ecommunity *ecom1,
 		      const struct ecommunity *ecom2)
 {
@@ -21,6 +21,7 @@
 #ifndef _QUAGGA_BGP_ECOMMUNITY_H
 #define _QUAGGA_BGP_ECOMMUNITY_H
 
+#include "lib/frratomic.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgpd.h"
 
@@ -125,6 +126,15 @@ struct ecommunity {
 	/* Human readable format string.  */
 	char *str;
 
+	/* community-list results while interned, see community_list_match() */
+	_Atomic uint64_t clist_cache[2];
+
+	/* Route targets among the values, sorted, built when interned for
+	 * ecommunity_has_val() lookups.  NULL for IPv6 ext communities.
+	 */
+	uint8_t *rt_val;
+	uint32_t rt_count;
+
 	/* Disable IEEE floating-point encoding for extended community */
 	bool disable_ieee_floating;
 };
@@ -257,6 +267,10 @@ extern struct ecommunity *ecommunity_str2com_ipv6(const char *str, int type,
 						  int keyword_included);
 extern char *ecommunity_ecom2str(struct ecommunity *, int, int);
 extern void ecommunity_strfree(char **s);
+extern bool ecommunity_has_val(const struct ecommunity *ecom,
+			       const uint8_t *val);
+extern bool ecommunity_intersect(const struct ecommunity *ecom1,
+				 const struct ecommunity *ecom2);
 extern bool ecommunity_match(const struct ecommunity *,
 			     const struct ecommunity *);
 extern char *ecommunity_str(struct ecommunity *);
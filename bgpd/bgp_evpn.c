@@ -576,6 +576,69 @@ struct bgp_dest *bgp_global_evpn_node_lookup(struct bgp_table *table, afi_t afi,
 	return bgp_afi_node_lookup(table, afi, safi, (struct prefix *)evp, prd);
 }
 
+/*
+ * Remote MACIPs go to zebra in batches: zebra takes any number of entries
+ * in one REMOTE_MACIP_ADD/DEL message.  Entries are collected here and sent
+ * from an event, or earlier when the command or VRF changes, the message is
+ * full or some other EVPN message has to go out after them.
+ */
+#define MACIP_BATCH_ENTRY_MAX                                                  \
+	(4 + ETH_ALEN + 2 + IPV6_MAX_BYTELEN + IPV4_MAX_BYTELEN + 1 + 4        \
+	 + sizeof(esi_t))
+
+static struct stream *macip_batch;
+static uint16_t macip_batch_cmd;
+static vrf_id_t macip_batch_vrf;
+static uint32_t macip_batch_count;
+static struct thread *t_macip_batch;
+
+int bgp_evpn_macip_batch_flush(void)
+{
+	struct stream *s;
+
+	THREAD_OFF(t_macip_batch);
+	if (!macip_batch_count)
+		return 0;
+
+	if (!zclient || zclient->sock < 0) {
+		stream_reset(macip_batch);
+		macip_batch_count = 0;
+		return 0;
+	}
+
+	s = zclient->obuf;
+	stream_reset(s);
+
+	zclient_create_header(s, macip_batch_cmd, macip_batch_vrf);
+	stream_put(s, STREAM_DATA(macip_batch), stream_get_endp(macip_batch));
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	if (bgp_debug_zebra(NULL))
+		zlog_debug("Tx %s MACIP batch, %u entries",
+			   macip_batch_cmd == ZEBRA_REMOTE_MACIP_ADD ? "ADD"
+								      : "DEL",
+			   macip_batch_count);
+
+	stream_reset(macip_batch);
+	macip_batch_count = 0;
+
+	return zclient_send_message(zclient);
+}
+
+static void bgp_evpn_macip_batch_send(struct thread *thread)
+{
+	bgp_evpn_macip_batch_flush();
+}
+
+void bgp_evpn_macip_batch_finish(void)
+{
+	THREAD_OFF(t_macip_batch);
+	if (macip_batch)
+		stream_free(macip_batch);
+	macip_batch = NULL;
+	macip_batch_count = 0;
+}
+
 /*
  * Add (update) or delete MACIP from zebra.
  */
@@ -586,6 +649,7 @@ static int bgp_zebra_send_remote_macip(struct bgp *bgp, struct bgpevpn *vpn,
 {
 	struct stream *s;
 	uint16_t ipa_len;
+	uint16_t cmd;
 	static struct in_addr zero_remote_vtep_ip;
 
 	/* Check socket. */
@@ -603,12 +667,21 @@ static int bgp_zebra_send_remote_macip(struct bgp *bgp, struct bgpevpn *vpn,
 
 	if (!esi)
 		esi = zero_esi;
-	s = zclient->obuf;
-	stream_reset(s);
 
-	zclient_create_header(
-		s, add ? ZEBRA_REMOTE_MACIP_ADD : ZEBRA_REMOTE_MACIP_DEL,
-		bgp->vrf_id);
+	if (!macip_batch)
+		macip_batch =
+			stream_new(ZEBRA_MAX_PACKET_SIZ - ZEBRA_HEADER_SIZE);
+
+	cmd = add ? ZEBRA_REMOTE_MACIP_ADD : ZEBRA_REMOTE_MACIP_DEL;
+	if (macip_batch_count
+	    && (macip_batch_cmd != cmd || macip_batch_vrf != bgp->vrf_id
+		|| STREAM_WRITEABLE(macip_batch) < MACIP_BATCH_ENTRY_MAX))
+		bgp_evpn_macip_batch_flush();
+
+	macip_batch_cmd = cmd;
+	macip_batch_vrf = bgp->vrf_id;
+	s = macip_batch;
+
 	stream_putl(s, vpn->vni);
 	stream_put(s, &p->prefix.macip_addr.mac.octet, ETH_ALEN); /* Mac Addr */
 	/* IP address length and IP address, if any. */
@@ -635,8 +708,7 @@ static int bgp_zebra_send_remote_macip(struct bgp *bgp, struct bgpevpn *vpn,
 		stream_putl(s, seq);
 		stream_put(s, esi, sizeof(esi_t));
 	}
-
-	stream_putw_at(s, 0, stream_get_endp(s));
+	macip_batch_count++;
 
 	if (bgp_debug_zebra(NULL))
 		zlog_debug(
@@ -648,7 +720,10 @@ static int bgp_zebra_send_remote_macip(struct bgp *bgp, struct bgpevpn *vpn,
 	frrtrace(5, frr_bgp, evpn_mac_ip_zsend, add, vpn, p, remote_vtep_ip,
 		 esi);
 
-	return zclient_send_message(zclient);
+	thread_add_event(bm->master, bgp_evpn_macip_batch_send, NULL, 0,
+			 &t_macip_batch);
+
+	return 0;
 }
 
 /*
@@ -660,6 +735,9 @@ static int bgp_zebra_send_remote_vtep(struct bgp *bgp, struct bgpevpn *vpn,
 {
 	struct stream *s;
 
+	/* MACIPs queued before the VTEP change go first */
+	bgp_evpn_macip_batch_flush();
+
 	/* Check socket. */
 	if (!zclient || zclient->sock < 0)
 		return 0;
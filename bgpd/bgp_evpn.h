@@ -229,5 +229,8 @@ bgp_evpn_handle_resolve_overlay_index_set(struct hash_bucket *bucket,
 extern void
 bgp_evpn_handle_resolve_overlay_index_unset(struct hash_bucket *bucket,
 					    void *arg);
+/* Sends the remote MACIPs queued for zebra now */
+extern int bgp_evpn_macip_batch_flush(void);
+extern void bgp_evpn_macip_batch_finish(void);
 
 #endif /* _QUAGGA_BGP_EVPN_H */
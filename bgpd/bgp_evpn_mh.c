@@ -1389,6 +1389,7 @@ static int bgp_zebra_send_remote_es_vtep(struct bgp *bgp,
 	if (es_vtep->flags & BGP_EVPNES_VTEP_ESR)
 		flags |= ZAPI_ES_VTEP_FLAG_ESR_RXED;
 
+	bgp_evpn_macip_batch_flush();
 	s = zclient->obuf;
 	stream_reset(s);
 
@@ -4435,6 +4436,7 @@ static void bgp_evpn_nh_zebra_update_send(struct bgp_evpn_nh *nh, bool add)
 		return;
 	}
 
+	bgp_evpn_macip_batch_flush();
 	s = zclient->obuf;
 	stream_reset(s);
 
@@ -59,6 +59,7 @@ struct as_filter {
 
 	regex_t *reg;
 	char *reg_str;
+	struct bgp_regex_fast fast;
 
 	/* Sequence number. */
 	int64_t seq;
@@ -73,8 +74,13 @@ struct as_list {
 
 	struct as_filter *head;
 	struct as_filter *tail;
+
+	/* for the results cached on struct aspath */
+	uint32_t id;
 };
 
+/* changes whenever an as-path access-list or one of its entries changes */
+static uint32_t aslist_epoch = 1;
 
 /* Calculate new sequential number. */
 static int64_t bgp_alist_new_seq_get(struct as_list *list)
@@ -138,6 +144,7 @@ static struct as_filter *as_filter_make(regex_t *reg, const char *reg_str,
 	asfilter->reg = reg;
 	asfilter->type = type;
 	asfilter->reg_str = XSTRDUP(MTYPE_AS_FILTER_STR, reg_str);
+	bgp_regex_fast_compile(reg_str, &asfilter->fast);
 
 	return asfilter;
 }
@@ -219,6 +226,8 @@ static void as_list_filter_add(struct as_list *aslist,
 	}
 
 hook:
+	aslist_epoch++;
+
 	/* Run hook function. */
 	if (as_list_master.add_hook)
 		(*as_list_master.add_hook)(aslist->name);
@@ -241,13 +250,25 @@ struct as_list *as_list_lookup(const char *name)
 
 static struct as_list *as_list_new(void)
 {
-	return XCALLOC(MTYPE_AS_LIST, sizeof(struct as_list));
+	static uint32_t next_id;
+	struct as_list *aslist;
+
+	aslist = XCALLOC(MTYPE_AS_LIST, sizeof(struct as_list));
+	aslist->id = ++next_id;
+	aslist_epoch++;
+	return aslist;
 }
 
 static void as_list_free(struct as_list *aslist)
 {
 	XFREE(MTYPE_AS_STR, aslist->name);
 	XFREE(MTYPE_AS_LIST, aslist);
+	aslist_epoch++;
+}
+
+uint32_t as_list_epoch(void)
+{
+	return aslist_epoch;
 }
 
 /* Insert new AS list to list of as_list.  Each as_list is sorted by
@@ -373,6 +394,7 @@ static void as_list_filter_delete(struct as_list *aslist,
 		aslist->head = asfilter->next;
 
 	as_filter_free(asfilter);
+	aslist_epoch++;
 
 	/* If access_list becomes empty delete it from access_master. */
 	if (as_list_empty(aslist))
@@ -386,25 +408,70 @@ static void as_list_filter_delete(struct as_list *aslist,
 
 static bool as_filter_match(struct as_filter *asfilter, struct aspath *aspath)
 {
+	if (asfilter->fast.len)
+		return bgp_regex_fast_match(&asfilter->fast, aspath->str);
+
 	return bgp_regexec(asfilter->reg, aspath) != REG_NOMATCH;
 }
 
+/*
+ * The same few paths are checked against the same lists over and over, so
+ * the last results are kept on the (usually interned) aspath.  A cache
+ * word is the epoch, the list's ID and the result; any change to any list
+ * bumps the epoch.  Paths are shared between pthreads, hence the single
+ * atomic word.
+ */
+#define ASL_CACHE_WORD(aslist, type)                                          \
+	(((uint64_t)aslist_epoch << 32) | (((aslist)->id & 0xffffff) << 8)    \
+	 | (type))
+
+static bool as_list_cache_get(struct as_list *aslist, struct aspath *aspath,
+			      enum as_filter_type *type)
+{
+	uint64_t word;
+
+	word = atomic_load_explicit(
+		&aspath->acl_cache[aslist->id % ASPATH_ACL_CACHE],
+		memory_order_relaxed);
+	if ((word & ~0xffULL) != ASL_CACHE_WORD(aslist, 0))
+		return false;
+
+	*type = word & 0xff;
+	return true;
+}
+
+static void as_list_cache_set(struct as_list *aslist, struct aspath *aspath,
+			      enum as_filter_type type)
+{
+	atomic_store_explicit(&aspath->acl_cache[aslist->id % ASPATH_ACL_CACHE],
+			      ASL_CACHE_WORD(aslist, type),
+			      memory_order_relaxed);
+}
+
 /* Apply AS path filter to AS. */
 enum as_filter_type as_list_apply(struct as_list *aslist, void *object)
 {
 	struct as_filter *asfilter;
 	struct aspath *aspath;
+	enum as_filter_type type = AS_FILTER_DENY;
 
 	aspath = (struct aspath *)object;
 
 	if (aslist == NULL)
 		return AS_FILTER_DENY;
 
+	if (as_list_cache_get(aslist, aspath, &type))
+		return type;
+
 	for (asfilter = aslist->head; asfilter; asfilter = asfilter->next) {
-		if (as_filter_match(asfilter, aspath))
-			return asfilter->type;
+		if (as_filter_match(asfilter, aspath)) {
+			type = asfilter->type;
+			break;
+		}
 	}
-	return AS_FILTER_DENY;
+
+	as_list_cache_set(aslist, aspath, type);
+	return type;
 }
 
 /* Add hook function. */
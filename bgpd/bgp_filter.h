@@ -31,6 +31,8 @@ extern void bgp_filter_reset(void);
 extern enum as_filter_type as_list_apply(struct as_list *, void *);
 
 extern struct as_list *as_list_lookup(const char *);
+/* changes whenever an as-path access-list or one of its entries changes */
+extern uint32_t as_list_epoch(void);
 extern void as_list_add_hook(void (*func)(char *));
 extern void as_list_delete_hook(void (*func)(const char *));
 extern bool config_bgp_aspath_validate(const char *regstr);
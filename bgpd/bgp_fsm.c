@@ -135,6 +135,8 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 	afi_t afi;
 	safi_t safi;
 	int fd;
+	struct bgp_attr_preparse *pre;
+	struct bgp_obuf_shared *sh;
 	enum bgp_fsm_status status, pstatus;
 	enum bgp_fsm_events last_evt, last_maj_evt;
 
@@ -201,6 +203,9 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 
 		stream_fifo_clean(peer->ibuf);
 		stream_fifo_clean(peer->obuf);
+		stream_fifo_clean(peer->obuf_ctrl);
+		bgp_obuf_shared_flush(peer);
+		bgp_attr_preparse_flush(peer);
 
 		/*
 		 * this should never happen, since bgp_process_packet() is the
@@ -225,11 +230,17 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 		while (from_peer->obuf->head)
 			stream_fifo_push(peer->obuf,
 					 stream_fifo_pop(from_peer->obuf));
+		stream_fifo_splice(peer->obuf_ctrl, NULL,
+				   from_peer->obuf_ctrl);
+		while ((sh = bgp_obuf_shared_pop(&from_peer->obuf_shared)))
+			bgp_obuf_shared_add_tail(&peer->obuf_shared, sh);
 
 		// copy each packet from old peer's input queue to new peer
 		while (from_peer->ibuf->head)
 			stream_fifo_push(peer->ibuf,
 					 stream_fifo_pop(from_peer->ibuf));
+		while ((pre = bgp_preparse_pop(&from_peer->preparse)))
+			bgp_preparse_add_tail(&peer->preparse, pre);
 
 		ringbuf_wipe(peer->ibuf_work);
 		ringbuf_copy(peer->ibuf_work, from_peer->ibuf_work,
@@ -495,6 +506,47 @@ void bgp_timer_set(struct peer *peer)
 
 /* BGP start timer.  This function set BGP_Start event to thread value
    and process event. */
+/*
+ * "bgp session-start-rate": after a reboot the start timers of all configured
+ * peers pop at the same time.  Hand out start slots 1/rate seconds apart and
+ * re-arm the start timer of peers that don't get one right away for their
+ * slot, so the connects, OPEN processing and initial table dumps are spread
+ * out instead of all hitting at once.
+ */
+static bool bgp_start_paced(struct peer *peer)
+{
+	static struct timeval next_slot;
+	struct timeval interval;
+	int64_t wait;
+
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_START_SLOT)) {
+		UNSET_FLAG(peer->sflags, PEER_STATUS_START_SLOT);
+		return false;
+	}
+	if (!bm->start_rate)
+		return false;
+
+	wait = monotime_until(&next_slot, NULL);
+	if (wait <= 0)
+		monotime(&next_slot);
+
+	interval.tv_sec = 0;
+	interval.tv_usec = 1000000 / bm->start_rate;
+	timeradd(&next_slot, &interval, &next_slot);
+
+	if (wait <= 0)
+		return false;
+
+	if (bgp_debug_neighbor_events(peer))
+		zlog_debug("%s [FSM] Start paced, waiting %" PRId64 "ms",
+			   peer->host, wait / 1000);
+
+	SET_FLAG(peer->sflags, PEER_STATUS_START_SLOT);
+	thread_add_timer_msec(bm->master, bgp_start_timer, peer, wait / 1000,
+			      &peer->t_start);
+	return true;
+}
+
 static void bgp_start_timer(struct thread *thread)
 {
 	struct peer *peer;
@@ -504,6 +556,9 @@ static void bgp_start_timer(struct thread *thread)
 	if (bgp_debug_neighbor_events(peer))
 		zlog_debug("%s [FSM] Timer (start timer expire).", peer->host);
 
+	if (bgp_start_paced(peer))
+		return;
+
 	THREAD_VAL(thread) = BGP_Start;
 	bgp_event(thread); /* bgp_event unlocks peer */
 }
@@ -1505,6 +1560,10 @@ int bgp_stop(struct peer *peer)
 			stream_fifo_clean(peer->ibuf);
 		if (peer->obuf)
 			stream_fifo_clean(peer->obuf);
+		if (peer->obuf_ctrl)
+			stream_fifo_clean(peer->obuf_ctrl);
+		bgp_obuf_shared_flush(peer);
+		bgp_attr_preparse_flush(peer);
 
 		if (peer->ibuf_work)
 			ringbuf_wipe(peer->ibuf_work);
@@ -34,11 +34,14 @@
 #include "thread.h"		// for THREAD_OFF, THREAD_ARG, thread...
 
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_attr.h"	// for bgp_attr_preparse
 #include "bgpd/bgp_debug.h"	// for bgp_debug_neighbor_events, bgp_type_str
 #include "bgpd/bgp_errors.h"	// for expanded error reference information
 #include "bgpd/bgp_fsm.h"	// for BGP_EVENT_ADD, bgp_event
 #include "bgpd/bgp_packet.h"	// for bgp_notify_send_with_data, bgp_notify...
+#include "bgpd/bgp_pipeline.h"	// for bgp_pipe_record
 #include "bgpd/bgp_trace.h"	// for frrtraces
+#include "bgpd/bgp_updgrp.h"	// for bgp_obuf_shared
 #include "bgpd/bgpd.h"		// for peer, BGP_MARKER_SIZE, bgp_master, bm
 /* clang-format on */
 
@@ -136,7 +139,8 @@ static void bgp_process_writes(struct thread *thread)
 
 	frr_with_mutex (&peer->io_mtx) {
 		status = bgp_write(peer);
-		reschedule = (stream_fifo_head(peer->obuf) != NULL);
+		reschedule = (stream_fifo_head(peer->obuf) != NULL
+			      || stream_fifo_head(peer->obuf_ctrl) != NULL);
 	}
 
 	/* no problem */
@@ -240,15 +244,24 @@ static void bgp_process_reads(struct thread *thread)
 		 * stream and append to input queue for processing.
 		 */
 		if (ringbuf_remain(ibw) >= pktsize) {
-			struct stream *pkt = stream_new(pktsize);
+			struct stream *pkt = stream_new_pooled(pktsize);
+			struct bgp_attr_preparse *pre;
 
 			assert(STREAM_WRITEABLE(pkt) == pktsize);
 			assert(ringbuf_get(ibw, pkt->data, pktsize) == pktsize);
 			stream_set_endp(pkt, pktsize);
 
+			/* decode what we can outside of the main pthread */
+			pre = bgp_attr_preparse(peer, pkt);
+
 			frrtrace(2, frr_bgp, packet_read, peer, pkt);
 			frr_with_mutex (&peer->io_mtx) {
+				if (!peer->pipe->rx_since)
+					peer->pipe->rx_since = bgp_pipe_now();
 				stream_fifo_push(peer->ibuf, pkt);
+				if (pre)
+					bgp_preparse_add_tail(&peer->preparse,
+							      pre);
 			}
 
 			added_pkt = true;
@@ -275,8 +288,13 @@ static void bgp_process_reads(struct thread *thread)
  * Flush peer output buffer.
  *
  * This function pops packets off of peer->obuf and writes them to peer->fd.
- * The amount of packets written is equal to the minimum of peer->wpkt_quanta
- * and the number of packets on the output buffer, unless an error occurs.
+ * The amount of packets written is at most the minimum of peer->wpkt_quanta
+ * and the number of packets on the output buffer, all of them in a single
+ * writev() call.  Whatever does not fit into the socket buffer is left on
+ * peer->obuf, partially written packets included.
+ *
+ * Packets on peer->obuf_ctrl are moved to the front of peer->obuf first,
+ * behind the head only if that has been written in part already.
  *
  * If write() returns an error, the appropriate FSM event is generated.
  *
@@ -287,91 +305,109 @@ static uint16_t bgp_write(struct peer *peer)
 {
 	uint8_t type;
 	struct stream *s;
+	struct bgp_obuf_shared *sh;
 	int update_last_write = 0;
 	unsigned int count;
 	uint32_t uo = 0;
 	uint16_t status = 0;
 	uint32_t wpkt_quanta_old;
 
-	int writenum = 0;
-	int num;
+	ssize_t num;
+	size_t len;
 	unsigned int iovsz;
-	unsigned int strmsz;
 	unsigned int total_written;
 	time_t now;
 
 	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 					       memory_order_relaxed);
 	struct stream *ostreams[wpkt_quanta_old];
-	struct stream **streams = ostreams;
-	struct iovec iov[wpkt_quanta_old];
+	struct bgp_obuf_shared *oshared[wpkt_quanta_old];
+	/* one for the per-peer part, one for the shared remainder */
+	struct iovec iov[2 * wpkt_quanta_old];
 
 	s = stream_fifo_head(peer->obuf);
+	if (stream_fifo_head(peer->obuf_ctrl)) {
+		stream_fifo_splice(peer->obuf,
+				   s && stream_get_getp(s) ? s : NULL,
+				   peer->obuf_ctrl);
+		s = stream_fifo_head(peer->obuf);
+	}
 
 	if (!s)
 		goto done;
 
-	count = iovsz = 0;
-	while (count < wpkt_quanta_old && iovsz < array_size(iov) && s) {
-		ostreams[iovsz] = s;
-		iov[iovsz].iov_base = stream_pnt(s);
-		iov[iovsz].iov_len = STREAM_READABLE(s);
-		writenum += STREAM_READABLE(s);
+	sh = bgp_obuf_shared_first(&peer->obuf_shared);
+
+	count = 0;
+	while (count < wpkt_quanta_old && s) {
+		ostreams[count] = s;
+		if (sh && sh->head == s) {
+			oshared[count] = sh;
+			sh = bgp_obuf_shared_next(&peer->obuf_shared, sh);
+		} else
+			oshared[count] = NULL;
 		s = s->next;
-		++iovsz;
 		++count;
 	}
 
-	strmsz = iovsz;
-	total_written = 0;
+	iovsz = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		iov[iovsz].iov_base = stream_pnt(ostreams[i]);
+		iov[iovsz].iov_len = STREAM_READABLE(ostreams[i]);
+		iovsz++;
 
-	do {
-		num = writev(peer->fd, iov, iovsz);
+		sh = oshared[i];
+		if (!sh)
+			continue;
 
-		if (num < 0) {
-			if (!ERRNO_IO_RETRY(errno)) {
-				BGP_EVENT_ADD(peer, TCP_fatal_error);
-				SET_FLAG(status, BGP_IO_FATAL_ERR);
-			} else {
-				SET_FLAG(status, BGP_IO_TRANS_ERR);
-			}
+		iov[iovsz].iov_base = STREAM_DATA(sh->buf->s) + sh->getp;
+		iov[iovsz].iov_len = stream_get_endp(sh->buf->s) - sh->getp;
+		iovsz++;
+	}
 
-			break;
-		} else if (num != writenum) {
-			unsigned int msg_written = 0;
-			unsigned int ic = iovsz;
+	/*
+	 * One writev() for the whole batch.  If it comes back short the socket
+	 * buffer is full and trying again right away would only get us EAGAIN,
+	 * so the rest is left for when the socket becomes writable again.
+	 */
+	total_written = 0;
+	num = writev(peer->fd, iov, iovsz);
 
-			for (unsigned int i = 0; i < ic; i++) {
-				size_t ss = iov[i].iov_len;
+	if (num < 0) {
+		if (!ERRNO_IO_RETRY(errno)) {
+			BGP_EVENT_ADD(peer, TCP_fatal_error);
+			SET_FLAG(status, BGP_IO_FATAL_ERR);
+		} else {
+			SET_FLAG(status, BGP_IO_TRANS_ERR);
+		}
 
-				if (ss > (unsigned int) num)
-					break;
+		goto done;
+	}
 
-				msg_written++;
-				iovsz--;
-				writenum -= ss;
-				num -= ss;
-			}
+	/* account for what made it out, message by message */
+	while (total_written < count) {
+		s = ostreams[total_written];
+		sh = oshared[total_written];
 
-			total_written += msg_written;
+		len = MIN((size_t)num, STREAM_READABLE(s));
+		stream_forward_getp(s, len);
+		num -= len;
 
-			assert(total_written < count);
+		if (sh) {
+			len = MIN((size_t)num,
+				  stream_get_endp(sh->buf->s) - sh->getp);
+			sh->getp += len;
+			num -= len;
+		}
 
-			memmove(&iov, &iov[msg_written],
-				sizeof(iov[0]) * iovsz);
-			streams = &streams[msg_written];
-			stream_forward_getp(streams[0], num);
-			iov[0].iov_base = stream_pnt(streams[0]);
-			iov[0].iov_len = STREAM_READABLE(streams[0]);
+		if (STREAM_READABLE(s)
+		    || (sh && sh->getp < stream_get_endp(sh->buf->s)))
+			break;
 
-			writenum -= num;
-			num = 0;
-			assert(writenum > 0);
-		} else {
-			total_written = strmsz;
-		}
+		total_written++;
+	}
 
-	} while (num != writenum);
+	assert(num == 0);
 
 	/* Handle statistics */
 	for (unsigned int i = 0; i < total_written; i++) {
@@ -379,6 +415,13 @@ static uint16_t bgp_write(struct peer *peer)
 
 		assert(s == ostreams[i]);
 
+		if (oshared[i]) {
+			sh = bgp_obuf_shared_pop(&peer->obuf_shared);
+			assert(sh == oshared[i]);
+			bgp_obuf_shared_free(&sh);
+			oshared[i] = NULL;
+		}
+
 		/* Retrieve BGP packet type. */
 		stream_set_getp(s, BGP_MARKER_SIZE + 2);
 		type = stream_getc(s);
@@ -430,6 +473,13 @@ static uint16_t bgp_write(struct peer *peer)
 		update_last_write = 1;
 	}
 
+	if (total_written) {
+		bgp_pipe_record(peer, AFI_UNSPEC, SAFI_UNSPEC,
+				BGP_PIPE_TX_QUEUE, peer->pipe->tx_since);
+		peer->pipe->tx_since =
+			stream_fifo_head(peer->obuf) ? bgp_pipe_now() : 0;
+	}
+
 done : {
 	now = monotime(NULL);
 	/*
@@ -1,5 +1,5 @@
 /* BGP Keepalives.
- * Implements a producer thread to generate BGP keepalives for peers.
+ * Implements producer threads to generate BGP keepalives for peers.
  * Copyright (C) 2017 Cumulus Networks, Inc.
  * Quentin Young
  *
@@ -22,13 +22,12 @@
 
 /* clang-format off */
 #include <zebra.h>
-#include <pthread.h>		// for pthread_mutex_lock, pthread_mutex_unlock
 
 #include "frr_pthread.h"        // for frr_pthread
-#include "hash.h"		// for hash, hash_clean, hash_create_size...
+#include "frratomic.h"		// for atomic_fetch_add_explicit
 #include "log.h"		// for zlog_debug
-#include "memory.h"		// for MTYPE_TMP, XFREE, XCALLOC, XMALLOC
-#include "monotime.h"		// for monotime, monotime_since
+#include "memory.h"		// for XCALLOC, XFREE
+#include "thread.h"		// for thread_add_timer_msec, thread_cancel_async
 
 #include "bgpd/bgpd.h"          // for peer, PEER_THREAD_KEEPALIVES_ON, peer...
 #include "bgpd/bgp_debug.h"	// for bgp_debug_neighbor_events
@@ -36,275 +35,134 @@
 #include "bgpd/bgp_keepalives.h"
 /* clang-format on */
 
-/*
- * Peer KeepAlive Timer.
- * Associates a peer with the time of its last keepalive.
- */
-struct pkat {
-	/* the peer to send keepalives to */
-	struct peer *peer;
-	/* absolute time of last keepalive sent */
-	struct timeval last;
-};
-
-/* List of peers we are sending keepalives for, and associated mutex. */
-static pthread_mutex_t *peerhash_mtx;
-static pthread_cond_t *peerhash_cond;
-static struct hash *peerhash;
-
-static struct pkat *pkat_new(struct peer *peer)
-{
-	struct pkat *pkat = XMALLOC(MTYPE_TMP, sizeof(struct pkat));
-	pkat->peer = peer;
-	monotime(&pkat->last);
-	return pkat;
-}
-
-static void pkat_del(void *pkat)
-{
-	XFREE(MTYPE_TMP, pkat);
-}
-
+DEFINE_MTYPE_STATIC(BGPD, BGP_KA_PTHREADS, "BGP keepalive pthreads");
 
 /*
- * Callback for hash_iterate. Determines if a peer needs a keepalive and if so,
- * generates and sends it.
- *
- * For any given peer, if the elapsed time since its last keepalive exceeds its
- * configured keepalive timer, a keepalive is sent to the peer and its
- * last-sent time is reset. Additionally, If the elapsed time does not exceed
- * the configured keepalive timer, but the time until the next keepalive is due
- * is within a hardcoded tolerance, a keepalive is sent as if the configured
- * timer was exceeded. Doing this helps alleviate nanosecond sleeps between
- * ticks by grouping together peers who are due for keepalives at roughly the
- * same time. This tolerance value is arbitrarily chosen to be 100ms.
- *
- * In addition, this function calculates the maximum amount of time that the
- * keepalive thread can sleep before another tick needs to take place. This is
- * equivalent to shortest time until a keepalive is due for any one peer.
- *
- * @return maximum time to wait until next update (0 if infinity)
+ * Each peer has a timer on one of the keepalive pthreads' thread_masters,
+ * so finding the peers that are due is up to the timer backend (a heap or
+ * a wheel, see --timer-backend) instead of a scan over all of them.
+ * Peers are spread over the pthreads round-robin.
  */
-static void peer_process(struct hash_bucket *hb, void *arg)
-{
-	struct pkat *pkat = hb->data;
-
-	struct timeval *next_update = arg;
+struct frr_pthread *bgp_pth_ka;
 
-	static struct timeval elapsed;  // elapsed time since keepalive
-	static struct timeval ka = {0}; // peer->v_keepalive as a timeval
-	static struct timeval diff;     // ka - elapsed
+static unsigned int bgp_ka_nthreads_cfg = 1;
+static unsigned int bgp_ka_nthreads;
+static struct frr_pthread **bgp_ka_pths;
+static atomic_uint bgp_ka_next;
 
-	static const struct timeval tolerance = {0, 100000};
+/* a peer with the timer at 0 is checked again after this long */
+#define BGP_KA_IDLE_MSEC 1000
 
-	uint32_t v_ka = atomic_load_explicit(&pkat->peer->v_keepalive,
+static void bgp_keepalive_timer(struct thread *thread)
+{
+	struct peer *peer = THREAD_ARG(thread);
+	uint32_t v_ka = atomic_load_explicit(&peer->v_keepalive,
 					     memory_order_relaxed);
 
 	/* 0 keepalive timer means no keepalives */
-	if (v_ka == 0)
-		return;
-
-	/* calculate elapsed time since last keepalive */
-	monotime_since(&pkat->last, &elapsed);
-
-	/* calculate difference between elapsed time and configured time */
-	ka.tv_sec = v_ka;
-	timersub(&ka, &elapsed, &diff);
-
-	int send_keepalive =
-		elapsed.tv_sec >= ka.tv_sec || timercmp(&diff, &tolerance, <);
-
-	if (send_keepalive) {
-		if (bgp_debug_neighbor_events(pkat->peer))
+	if (v_ka) {
+		if (bgp_debug_neighbor_events(peer))
 			zlog_debug("%s [FSM] Timer (keepalive timer expire)",
-				   pkat->peer->host);
+				   peer->host);
 
-		bgp_keepalive_send(pkat->peer);
-		monotime(&pkat->last);
-		memset(&elapsed, 0, sizeof(elapsed));
-		diff = ka;
+		bgp_keepalive_send(peer);
 	}
 
-	/* if calculated next update for this peer < current delay, use it */
-	if (next_update->tv_sec < 0 || timercmp(&diff, next_update, <))
-		*next_update = diff;
+	thread_add_timer_msec(thread->master, bgp_keepalive_timer, peer,
+			      v_ka ? v_ka * 1000 : BGP_KA_IDLE_MSEC,
+			      &peer->t_keepalive);
 }
 
-static bool peer_hash_cmp(const void *f, const void *s)
-{
-	const struct pkat *p1 = f;
-	const struct pkat *p2 = s;
-
-	return p1->peer == p2->peer;
-}
+/* --- thread external functions ------------------------------------------- */
 
-static unsigned int peer_hash_key(const void *arg)
+void bgp_keepalives_set_threads(unsigned int nthreads)
 {
-	const struct pkat *pkat = arg;
-	return (uintptr_t)pkat->peer;
+	bgp_ka_nthreads_cfg = MAX(1U, MIN(nthreads, BGP_KEEPALIVES_THREADS_MAX));
 }
 
-/* Cleanup handler / deinitializer. */
-static void bgp_keepalives_finish(void *arg)
+void bgp_keepalives_init(void)
 {
-	if (peerhash) {
-		hash_clean(peerhash, pkat_del);
-		hash_free(peerhash);
+	unsigned int i;
+
+	assert(!bgp_ka_pths);
+
+	bgp_ka_nthreads = bgp_ka_nthreads_cfg;
+	bgp_ka_pths = XCALLOC(MTYPE_BGP_KA_PTHREADS,
+			      bgp_ka_nthreads * sizeof(*bgp_ka_pths));
+
+	for (i = 0; i < bgp_ka_nthreads; i++) {
+		char name[64];
+		char os_name[OS_THREAD_NAMELEN];
+
+		if (i == 0) {
+			snprintf(name, sizeof(name), "BGP Keepalives thread");
+			snprintf(os_name, sizeof(os_name), "bgpd_ka");
+		} else {
+			snprintf(name, sizeof(name), "BGP Keepalives thread %u",
+				 i + 1);
+			snprintf(os_name, sizeof(os_name), "bgpd_ka%u",
+				 MIN(i + 1, BGP_KEEPALIVES_THREADS_MAX));
+		}
+		bgp_ka_pths[i] = frr_pthread_new(NULL, name, os_name);
 	}
 
-	peerhash = NULL;
-
-	pthread_mutex_unlock(peerhash_mtx);
-	pthread_mutex_destroy(peerhash_mtx);
-	pthread_cond_destroy(peerhash_cond);
-
-	XFREE(MTYPE_TMP, peerhash_mtx);
-	XFREE(MTYPE_TMP, peerhash_cond);
+	bgp_pth_ka = bgp_ka_pths[0];
 }
 
-/*
- * Entry function for peer keepalive generation pthread.
- */
-void *bgp_keepalives_start(void *arg)
+void bgp_keepalives_run(void)
 {
-	struct frr_pthread *fpt = arg;
-	fpt->master->owner = pthread_self();
-
-	struct timeval currtime = {0, 0};
-	struct timeval aftertime = {0, 0};
-	struct timeval next_update = {0, 0};
-	struct timespec next_update_ts = {0, 0};
-
-	peerhash_mtx = XCALLOC(MTYPE_TMP, sizeof(pthread_mutex_t));
-	peerhash_cond = XCALLOC(MTYPE_TMP, sizeof(pthread_cond_t));
-
-	/* initialize mutex */
-	pthread_mutex_init(peerhash_mtx, NULL);
-
-	/* use monotonic clock with condition variable */
-	pthread_condattr_t attrs;
-	pthread_condattr_init(&attrs);
-	pthread_condattr_setclock(&attrs, CLOCK_MONOTONIC);
-	pthread_cond_init(peerhash_cond, &attrs);
-	pthread_condattr_destroy(&attrs);
-
-	/*
-	 * We are not using normal FRR pthread mechanics and are
-	 * not using fpt_run
-	 */
-	frr_pthread_set_name(fpt);
+	unsigned int i;
 
-	/* initialize peer hashtable */
-	peerhash = hash_create_size(2048, peer_hash_key, peer_hash_cmp, NULL);
-	pthread_mutex_lock(peerhash_mtx);
+	for (i = 0; i < bgp_ka_nthreads; i++)
+		frr_pthread_run(bgp_ka_pths[i], NULL);
 
-	/* register cleanup handler */
-	pthread_cleanup_push(&bgp_keepalives_finish, NULL);
-
-	/* notify anybody waiting on us that we are done starting up */
-	frr_pthread_notify_running(fpt);
-
-	while (atomic_load_explicit(&fpt->running, memory_order_relaxed)) {
-		if (peerhash->count > 0)
-			pthread_cond_timedwait(peerhash_cond, peerhash_mtx,
-					       &next_update_ts);
-		else
-			while (peerhash->count == 0
-			       && atomic_load_explicit(&fpt->running,
-						       memory_order_relaxed))
-				pthread_cond_wait(peerhash_cond, peerhash_mtx);
-
-		monotime(&currtime);
-
-		next_update.tv_sec = -1;
-
-		hash_iterate(peerhash, peer_process, &next_update);
-		if (next_update.tv_sec == -1)
-			memset(&next_update, 0, sizeof(next_update));
-
-		monotime_since(&currtime, &aftertime);
-
-		timeradd(&currtime, &next_update, &next_update);
-		TIMEVAL_TO_TIMESPEC(&next_update, &next_update_ts);
-	}
-
-	/* clean up */
-	pthread_cleanup_pop(1);
-
-	return NULL;
+	for (i = 0; i < bgp_ka_nthreads; i++)
+		frr_pthread_wait_running(bgp_ka_pths[i]);
 }
 
-/* --- thread external functions ------------------------------------------- */
+void bgp_keepalives_finish(void)
+{
+	/* the pthreads themselves are freed by frr_pthread_finish() */
+	XFREE(MTYPE_BGP_KA_PTHREADS, bgp_ka_pths);
+	bgp_ka_nthreads = 0;
+	bgp_pth_ka = NULL;
+}
 
 void bgp_keepalives_on(struct peer *peer)
 {
+	struct frr_pthread *fpt;
+	uint32_t v_ka;
+
 	if (CHECK_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON))
 		return;
 
-	struct frr_pthread *fpt = bgp_pth_ka;
+	fpt = bgp_ka_pths[atomic_fetch_add_explicit(&bgp_ka_next, 1,
+						    memory_order_relaxed)
+			  % bgp_ka_nthreads];
 	assert(fpt->running);
 
-	/* placeholder bucket data to use for fast key lookups */
-	static struct pkat holder = {0};
+	v_ka = atomic_load_explicit(&peer->v_keepalive, memory_order_relaxed);
 
-	/*
-	 * We need to ensure that bgp_keepalives_init was called first
-	 */
-	assert(peerhash_mtx);
-
-	frr_with_mutex (peerhash_mtx) {
-		holder.peer = peer;
-		if (!hash_lookup(peerhash, &holder)) {
-			struct pkat *pkat = pkat_new(peer);
-			(void)hash_get(peerhash, pkat, hash_alloc_intern);
-			peer_lock(peer);
-		}
-		SET_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON);
-	}
-	bgp_keepalives_wake();
+	peer_lock(peer);
+	peer->ka_pth = fpt;
+	thread_add_timer_msec(fpt->master, bgp_keepalive_timer, peer,
+			      v_ka ? v_ka * 1000 : BGP_KA_IDLE_MSEC,
+			      &peer->t_keepalive);
+	SET_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON);
 }
 
 void bgp_keepalives_off(struct peer *peer)
 {
+	struct frr_pthread *fpt = peer->ka_pth;
+
 	if (!CHECK_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON))
 		return;
 
-	struct frr_pthread *fpt = bgp_pth_ka;
-	assert(fpt->running);
-
-	/* placeholder bucket data to use for fast key lookups */
-	static struct pkat holder = {0};
-
-	/*
-	 * We need to ensure that bgp_keepalives_init was called first
-	 */
-	assert(peerhash_mtx);
-
-	frr_with_mutex (peerhash_mtx) {
-		holder.peer = peer;
-		struct pkat *res = hash_release(peerhash, &holder);
-		if (res) {
-			pkat_del(res);
-			peer_unlock(peer);
-		}
-		UNSET_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON);
-	}
-}
-
-void bgp_keepalives_wake(void)
-{
-	frr_with_mutex (peerhash_mtx) {
-		pthread_cond_signal(peerhash_cond);
-	}
-}
-
-int bgp_keepalives_stop(struct frr_pthread *fpt, void **result)
-{
 	assert(fpt->running);
 
-	atomic_store_explicit(&fpt->running, false, memory_order_relaxed);
-	bgp_keepalives_wake();
-
-	pthread_join(fpt->thread, result);
-	return 0;
+	/* returns once the timer can't be running anymore */
+	thread_cancel_async(fpt->master, &peer->t_keepalive, NULL);
+	peer->ka_pth = NULL;
+	UNSET_FLAG(peer->thread_flags, PEER_THREAD_KEEPALIVES_ON);
+	peer_unlock(peer);
 }
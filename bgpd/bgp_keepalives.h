@@ -26,14 +26,17 @@
 #include "frr_pthread.h"
 #include "bgpd.h"
 
+/* upper limit for --keepalive_threads */
+#define BGP_KEEPALIVES_THREADS_MAX 16
+
 /**
  * Turns on keepalives for a peer.
  *
- * This function adds the peer to an internal list of peers to generate
- * keepalives for.
- *
- * At set intervals, a BGP KEEPALIVE packet is generated and placed on
- * peer->obuf. This operation is thread-safe with respect to peer->obuf.
+ * This function assigns the peer to one of the keepalive pthreads, which
+ * then sends it a BGP KEEPALIVE at set intervals.  The KEEPALIVE is written
+ * to the peer's socket right away if nothing else is waiting to be sent,
+ * otherwise it is placed on peer->obuf.  This operation is thread-safe with
+ * respect to peer->obuf.
  *
  * peer->v_keepalive determines the interval. Changing this value before
  * unregistering this peer with bgp_keepalives_off() results in undefined
@@ -47,47 +50,32 @@ extern void bgp_keepalives_on(struct peer *);
 /**
  * Turns off keepalives for a peer.
  *
- * Removes the peer from the internal list of peers to generate keepalives for.
+ * Returns once no keepalive is being sent to the peer anymore.
  *
  * If the peer is already unregistered for keepalives, nothing happens.
  */
 extern void bgp_keepalives_off(struct peer *);
 
 /**
- * Pre-run initialization function for keepalives pthread.
- *
- * Initializes synchronization primitives. This should be called before
- * anything else to avoid race conditions.
+ * Sets the number of keepalive pthreads, 1 by default.  Has to be called
+ * before bgp_keepalives_init() to have an effect.
  */
-extern void bgp_keepalives_init(void);
+extern void bgp_keepalives_set_threads(unsigned int nthreads);
 
 /**
- * Entry function for keepalives pthread.
- *
- * This function loops over an internal list of peers, generating keepalives at
- * regular intervals as determined by each peer's keepalive timer.
- *
- * See bgp_keepalives_on() for additional details.
- *
- * @param arg pthread arg, not used
+ * Creates the keepalive pthreads; bgp_pth_ka is the first one.
  */
-extern void *bgp_keepalives_start(void *arg);
+extern void bgp_keepalives_init(void);
 
 /**
- * Poking function for keepalives pthread.
- *
- * Under normal circumstances the pthread will automatically wake itself
- * whenever it is necessary to do work. This function may be used to force the
- * thread to wake up and see if there is any work to do, or if it is time to
- * die.
- *
- * It is not necessary to call this after bgp_keepalives_on().
+ * Starts the keepalive pthreads and waits until they are running.
  */
-extern void bgp_keepalives_wake(void);
+extern void bgp_keepalives_run(void);
 
 /**
- * Stops the thread and blocks until it terminates.
+ * Releases what bgp_keepalives_init() allocated, after the pthreads have
+ * been stopped.
  */
-int bgp_keepalives_stop(struct frr_pthread *fpt, void **result);
+extern void bgp_keepalives_finish(void);
 
 #endif /* _FRR_BGP_KEEPALIVES_H */
@@ -42,9 +42,8 @@
 
 extern struct zclient *zclient;
 
-int bgp_parse_fec_update(void)
+static int bgp_parse_fec_update_one(struct stream *s)
 {
-	struct stream *s;
 	struct bgp_dest *dest;
 	struct bgp *bgp;
 	struct bgp_table *table;
@@ -53,8 +52,6 @@ int bgp_parse_fec_update(void)
 	afi_t afi;
 	safi_t safi;
 
-	s = zclient->ibuf;
-
 	memset(&p, 0, sizeof(p));
 	p.family = stream_getw(s);
 	p.prefixlen = stream_getc(s);
@@ -94,6 +91,19 @@ int bgp_parse_fec_update(void)
 	return 1;
 }
 
+/* zebra packs several FEC updates into one message */
+int bgp_parse_fec_update(void)
+{
+	struct stream *s = zclient->ibuf;
+	int ret = -1;
+
+	while (STREAM_READABLE(s) > 0)
+		if (bgp_parse_fec_update_one(s) > 0)
+			ret = 1;
+
+	return ret;
+}
+
 mpls_label_t bgp_adv_label(struct bgp_dest *dest, struct bgp_path_info *pi,
 			   struct peer *to, afi_t afi, safi_t safi)
 {
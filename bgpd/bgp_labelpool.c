@@ -50,10 +50,20 @@ static struct labelpool *lp;
 /* request this many labels at a time from zebra */
 #define LP_CHUNK_SIZE	50
 
+/*
+ * Chunk requests that come within LP_CHUNK_FAST_SECS of each other double
+ * the chunk size, up to LP_CHUNK_SIZE_MAX; slower ones halve it again.
+ * The next chunk is requested once fewer than half a chunk is left, so
+ * a burst of requests is normally served from the local pool.
+ */
+#define LP_CHUNK_SIZE_MAX	8192
+#define LP_CHUNK_FAST_SECS	2
+
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_CHUNK, "BGP Label Chunk");
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_FIFO, "BGP Label FIFO item");
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_CB, "BGP Dynamic Label Assignment");
 DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_CBQ, "BGP Dynamic Label Callback");
+DEFINE_MTYPE_STATIC(BGPD, BGP_LABEL_FREE, "BGP Label free list");
 
 struct lp_chunk {
 	uint32_t	first;
@@ -90,6 +100,17 @@ struct lp_cbq_item {
 	bool		allocated;	/* false = lost */
 };
 
+static void lp_free_push(mpls_label_t label)
+{
+	if (lp->free_count == lp->free_size) {
+		lp->free_size = MAX(lp->free_size * 2, LP_CHUNK_SIZE);
+		lp->free_labels =
+			XREALLOC(MTYPE_BGP_LABEL_FREE, lp->free_labels,
+				 lp->free_size * sizeof(lp->free_labels[0]));
+	}
+	lp->free_labels[lp->free_count++] = label;
+}
+
 static wq_item_status lp_cbq_docallback(struct work_queue *wq, void *data)
 {
 	struct lp_cbq_item *lcbq = data;
@@ -141,6 +162,7 @@ static wq_item_status lp_cbq_docallback(struct work_queue *wq, void *data)
 							labelid, NULL);
 				}
 				skiplist_delete(lp->inuse, (void *)lbl, NULL);
+				lp_free_push(lcbq->label);
 			}
 		}
 	}
@@ -175,6 +197,7 @@ void bgp_lp_init(struct thread_master *master, struct labelpool *pool)
 	lp->chunks = list_new();
 	lp->chunks->del = lp_chunk_free;
 	lp_fifo_init(&lp->requests);
+	lp->next_chunksize = LP_CHUNK_SIZE;
 	lp->callback_q = work_queue_new(master, "label callbacks");
 
 	lp->callback_q->spec.workfunc = lp_cbq_docallback;
@@ -211,6 +234,8 @@ void bgp_lp_finish(void)
 	lp->inuse = NULL;
 
 	list_delete(&lp->chunks);
+	XFREE(MTYPE_BGP_LABEL_FREE, lp->free_labels);
+	lp->free_count = lp->free_size = 0;
 
 	while ((lf = lp_fifo_pop(&lp->requests))) {
 		check_bgp_lu_cb_unlock(&lf->lcb);
@@ -232,33 +257,57 @@ void bgp_lp_finish(void)
 	lp = NULL;
 }
 
-static mpls_label_t get_label_from_pool(void *labelid)
+static void lp_chunk_request(uint32_t size)
 {
-	struct listnode *node;
-	struct lp_chunk *chunk;
-	int debug = BGP_DEBUG(labelpool, LABELPOOL);
+	if (!zclient || zclient->sock < 0)
+		return;
 
-	/*
-	 * Find a free label
-	 * Linear search is not efficient but should be executed infrequently.
-	 */
-	for (ALL_LIST_ELEMENTS_RO(lp->chunks, node, chunk)) {
-		uintptr_t lbl;
+	if (zclient_send_get_label_chunk(zclient, 0, size, MPLS_LABEL_BASE_ANY)
+	    != ZCLIENT_SEND_FAILURE)
+		lp->pending_count += size;
+}
 
-		if (debug)
-			zlog_debug("%s: chunk first=%u last=%u",
-				__func__, chunk->first, chunk->last);
+/* ask for the next chunk before the local pool runs dry */
+static void lp_chunk_prefetch(void)
+{
+	time_t now;
 
-		for (lbl = chunk->first; lbl <= chunk->last; ++lbl) {
-			/* labelid is key to all-request "ledger" list */
-			if (!skiplist_insert(lp->inuse, (void *)lbl, labelid)) {
-				/*
-				 * Success
-				 */
-				return lbl;
-			}
+	if (!zclient || zclient->sock < 0)
+		return;
+	if (lp->free_count + lp->pending_count >= lp->next_chunksize / 2)
+		return;
+
+	now = monotime(NULL);
+	if (now - lp->last_request < LP_CHUNK_FAST_SECS)
+		lp->next_chunksize =
+			MIN(lp->next_chunksize * 2, LP_CHUNK_SIZE_MAX);
+	else
+		lp->next_chunksize =
+			MAX(lp->next_chunksize / 2, LP_CHUNK_SIZE);
+	lp->last_request = now;
+
+	if (BGP_DEBUG(labelpool, LABELPOOL))
+		zlog_debug("%s: %u free, requesting %u labels", __func__,
+			   lp->free_count, lp->next_chunksize);
+
+	lp_chunk_request(lp->next_chunksize);
+}
+
+static mpls_label_t get_label_from_pool(void *labelid)
+{
+	uintptr_t lbl;
+
+	while (lp->free_count) {
+		lbl = lp->free_labels[--lp->free_count];
+
+		/* labelid is key to all-request "ledger" list */
+		if (!skiplist_insert(lp->inuse, (void *)lbl, labelid)) {
+			lp_chunk_prefetch();
+			return lbl;
 		}
 	}
+
+	lp_chunk_prefetch();
 	return MPLS_LABEL_NONE;
 }
 
@@ -389,14 +438,10 @@ void bgp_lp_get(
 
 	lp_fifo_add_tail(&lp->requests, lf);
 
-	if (lp_fifo_count(&lp->requests) > lp->pending_count) {
-		if (!zclient || zclient->sock < 0)
-			return;
-		if (zclient_send_get_label_chunk(zclient, 0, LP_CHUNK_SIZE,
-						 MPLS_LABEL_BASE_ANY)
-		    != ZCLIENT_SEND_FAILURE)
-			lp->pending_count += LP_CHUNK_SIZE;
-	}
+	if (lp_fifo_count(&lp->requests) > lp->pending_count)
+		lp_chunk_request(MAX(lp->next_chunksize,
+				     (uint32_t)lp_fifo_count(&lp->requests)
+					     - lp->pending_count));
 }
 
 void bgp_lp_release(
@@ -411,7 +456,8 @@ void bgp_lp_release(
 			uintptr_t lbl = label;
 
 			/* no longer in use */
-			skiplist_delete(lp->inuse, (void *)lbl, NULL);
+			if (!skiplist_delete(lp->inuse, (void *)lbl, NULL))
+				lp_free_push(label);
 
 			/* no longer requested */
 			skiplist_delete(lp->ledger, labelid, NULL);
@@ -427,6 +473,8 @@ void bgp_lp_event_chunk(uint8_t keep, uint32_t first, uint32_t last)
 	struct lp_chunk *chunk;
 	int debug = BGP_DEBUG(labelpool, LABELPOOL);
 	struct lp_fifo *lf;
+	uint32_t size;
+	mpls_label_t label;
 
 	if (last < first) {
 		flog_err(EC_BGP_LABEL,
@@ -442,7 +490,12 @@ void bgp_lp_event_chunk(uint8_t keep, uint32_t first, uint32_t last)
 
 	listnode_add(lp->chunks, chunk);
 
-	lp->pending_count -= (last - first + 1);
+	size = last - first + 1;
+	lp->pending_count -= MIN(size, lp->pending_count);
+
+	/* handed out lowest first */
+	for (label = last + 1; label > first; label--)
+		lp_free_push(label - 1);
 
 	if (debug) {
 		zlog_debug("%s: %zu pending requests", __func__,
@@ -567,6 +620,7 @@ void bgp_lp_event_zebra_up(void)
 	 * Invalidate current list of chunks
 	 */
 	list_delete_all_node(lp->chunks);
+	lp->free_count = 0;
 
 	/*
 	 * Invalidate any existing labels and requeue them as requests
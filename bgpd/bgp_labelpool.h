@@ -41,6 +41,15 @@ struct labelpool {
 	struct work_queue	*callback_q;
 	uint32_t		pending_count;	/* requested from zebra */
 	uint32_t reconnect_count;		/* zebra reconnections */
+
+	/* labels of the chunks not in use, taken from the end */
+	mpls_label_t *free_labels;
+	uint32_t free_count;
+	uint32_t free_size;
+
+	/* size of the next chunk request, following demand */
+	uint32_t next_chunksize;
+	time_t last_request;
 };
 
 extern void bgp_lp_init(struct thread_master *master, struct labelpool *pool);
@@ -26,6 +26,7 @@
 #include "command.h"
 #include "filter.h"
 #include "jhash.h"
+#include "fhash.h"
 #include "stream.h"
 
 #include "bgpd/bgpd.h"
@@ -72,6 +73,8 @@ static bool lcommunity_add_val(struct lcommunity *lcom,
 	int ret;
 	int c;
 
+	lcom->mask = 0;
+
 	/* When this is fist value, just add it.  */
 	if (lcom->val == NULL) {
 		lcom->size++;
@@ -251,6 +254,36 @@ static void set_lcommunity_string(struct lcommunity *lcom, bool make_json,
 	lcom->str = str_buf;
 }
 
+static uint64_t lcommunity_mask_bit(const uint8_t *ptr)
+{
+	uint32_t w[3];
+
+	memcpy(w, ptr, sizeof(w));
+	return 1ULL << (jhash_3words(w[0], w[1], w[2], 0) >> 26);
+}
+
+static int lcommunity_val_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, LCOMMUNITY_SIZE);
+}
+
+/* Interned values don't change, so they get a summary for lookups. */
+static void lcommunity_summarize(struct lcommunity *lcom)
+{
+	uint8_t *ptr;
+	int i;
+
+	lcom->mask = 0;
+	lcom->sorted = true;
+
+	for (i = 0; i < lcom->size; i++) {
+		ptr = lcom->val + (i * LCOMMUNITY_SIZE);
+		lcom->mask |= lcommunity_mask_bit(ptr);
+		if (i && lcommunity_val_cmp(ptr - LCOMMUNITY_SIZE, ptr) >= 0)
+			lcom->sorted = false;
+	}
+}
+
 /* Intern Large Communities Attribute.  */
 struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 {
@@ -262,6 +295,8 @@ struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 
 	if (find != lcom)
 		lcommunity_free(&lcom);
+	else
+		lcommunity_summarize(find);
 
 	find->refcnt++;
 
@@ -314,7 +349,7 @@ unsigned int lcommunity_hash_make(const void *arg)
 	const struct lcommunity *lcom = arg;
 	int size = lcom_length(lcom);
 
-	return jhash(lcom->val, size, 0xab125423);
+	return fhash(lcom->val, size, 0xab125423);
 }
 
 /* Compare two Large Communities Attribute structure.  */
@@ -455,6 +490,15 @@ bool lcommunity_include(struct lcommunity *lcom, uint8_t *ptr)
 	int i;
 	uint8_t *lcom_ptr;
 
+	if (lcom->mask) {
+		if (!(lcom->mask & lcommunity_mask_bit(ptr)))
+			return false;
+		if (lcom->sorted)
+			return bsearch(ptr, lcom->val, lcom->size,
+				       LCOMMUNITY_SIZE, lcommunity_val_cmp)
+			       != NULL;
+	}
+
 	for (i = 0; i < lcom->size; i++) {
 		lcom_ptr = lcom->val + (i * LCOMMUNITY_SIZE);
 		if (memcmp(ptr, lcom_ptr, LCOMMUNITY_SIZE) == 0)
@@ -478,6 +522,9 @@ bool lcommunity_match(const struct lcommunity *lcom1,
 	if (lcom1->size < lcom2->size)
 		return false;
 
+	if (lcom1->mask && lcom2->mask && (lcom2->mask & ~lcom1->mask))
+		return false;
+
 	/* Every community on com2 needs to be on com1 for this to match */
 	while (i < lcom1->size && j < lcom2->size) {
 		if (memcmp(lcom1->val + (i * LCOMMUNITY_SIZE),
@@ -502,6 +549,7 @@ void lcommunity_del_val(struct lcommunity *lcom, uint8_t *ptr)
 	if (!lcom->val)
 		return;
 
+	lcom->mask = 0;
 	while (i < lcom->size) {
 		if (memcmp(lcom->val + i * LCOMMUNITY_SIZE, ptr,
 			   LCOMMUNITY_SIZE)
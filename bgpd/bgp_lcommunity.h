@@ -22,6 +22,7 @@
 #define _QUAGGA_BGP_LCOMMUNITY_H
 
 #include "lib/json.h"
+#include "lib/frratomic.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_clist.h"
 
@@ -44,6 +45,14 @@ struct lcommunity {
 
 	/* Human readable format string.  */
 	char *str;
+
+	/* community-list results while interned, see community_list_match() */
+	_Atomic uint64_t clist_cache[2];
+
+	/* Set when interned: one bit per value (hashed) for quick negative
+	   checks, and whether the values are in ascending order.  */
+	uint64_t mask;
+	bool sorted;
 };
 
 /* Large community value is 12 octets.  */
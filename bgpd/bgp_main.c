@@ -61,8 +61,10 @@
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_script.h"
+#include "bgpd/bgp_evpn.h"
 #include "bgpd/bgp_evpn_mh.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_routemap_nb.h"
 #include "bgpd/bgp_community_alias.h"
 
@@ -80,6 +82,7 @@ static const struct option longopts[] = {
 	{"int_num", required_argument, NULL, 'I'},
 	{"no_zebra", no_argument, NULL, 'Z'},
 	{"socket_size", required_argument, NULL, 's'},
+	{"keepalive_threads", required_argument, NULL, 'K'},
 	{0}};
 
 /* signal definitions */
@@ -212,6 +215,8 @@ static __attribute__((__noreturn__)) void bgp_exit(int status)
 		bgp_delete(bgp_default);
 
 	bgp_evpn_mh_finish();
+	bgp_evpn_macip_batch_finish();
+	bgp_nhg_finish();
 	bgp_l3nhg_finish();
 
 	/* reverse bgp_dump_init */
@@ -245,6 +250,7 @@ static __attribute__((__noreturn__)) void bgp_exit(int status)
 	/* reverse prefix_list_init */
 	prefix_list_add_hook(NULL);
 	prefix_list_delete_hook(NULL);
+	prefix_list_entry_hook(NULL);
 	prefix_list_reset();
 
 	/* reverse community_list_init */
@@ -403,7 +409,7 @@ int main(int argc, char **argv)
 
 	frr_preinit(&bgpd_di, argc, argv);
 	frr_opt_add(
-		"p:l:SnZe:I:s:" DEPRECATED_OPTIONS, longopts,
+		"p:l:SnZe:I:s:K:" DEPRECATED_OPTIONS, longopts,
 		"  -p, --bgp_port     Set BGP listen port number (0 means do not listen).\n"
 		"  -l, --listenon     Listen on specified address (implies -n)\n"
 		"  -n, --no_kernel    Do not install route to kernel.\n"
@@ -411,7 +417,8 @@ int main(int argc, char **argv)
 		"  -S, --skip_runas   Skip capabilities checks, and changing user and group IDs.\n"
 		"  -e, --ecmp         Specify ECMP to use.\n"
 		"  -I, --int_num      Set instance number (label-manager)\n"
-		"  -s, --socket_size  Set BGP peer socket send buffer size\n");
+		"  -s, --socket_size  Set BGP peer socket send buffer size\n"
+		"  -K, --keepalive_threads  Set number of keepalive threads\n");
 
 	/* Command line argument treatment. */
 	while (1) {
@@ -473,6 +480,19 @@ int main(int argc, char **argv)
 		case 's':
 			buffer_size = atoi(optarg);
 			break;
+		case 'K': {
+			unsigned long int nthreads = strtoul(optarg, NULL, 10);
+
+			if (nthreads == 0
+			    || nthreads > BGP_KEEPALIVES_THREADS_MAX) {
+				fprintf(stderr,
+					"Keepalive threads must be between 1 and %u\n",
+					BGP_KEEPALIVES_THREADS_MAX);
+				return 1;
+			}
+			bgp_keepalives_set_threads(nthreads);
+			break;
+		}
 		default:
 			frr_help_exit(1);
 		}
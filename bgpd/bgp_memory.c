@@ -42,6 +42,8 @@ DEFINE_MTYPE(BGPD, BGP_PEER_AF, "BGP peer af");
 DEFINE_MTYPE(BGPD, BGP_UPDGRP, "BGP update group");
 DEFINE_MTYPE(BGPD, BGP_UPD_SUBGRP, "BGP update subgroup");
 DEFINE_MTYPE(BGPD, BGP_PACKET, "BGP packet");
+DEFINE_MTYPE(BGPD, BGP_PACKET_BUF, "BGP shared packet buffer");
+DEFINE_MTYPE(BGPD, BGP_OBUF_SHARED, "BGP shared output queue entry");
 DEFINE_MTYPE(BGPD, ATTR, "BGP attribute");
 DEFINE_MTYPE(BGPD, AS_PATH, "BGP aspath");
 DEFINE_MTYPE(BGPD, AS_SEG, "BGP aspath seg");
@@ -59,7 +61,10 @@ DEFINE_MTYPE(BGPD, BGP_ADVERTISE, "BGP adv");
 DEFINE_MTYPE(BGPD, BGP_SYNCHRONISE, "BGP synchronise");
 DEFINE_MTYPE(BGPD, BGP_ADJ_IN, "BGP adj in");
 DEFINE_MTYPE(BGPD, BGP_ADJ_OUT, "BGP adj out");
+DEFINE_MTYPE(BGPD, BGP_ADJ_OUT_IDX, "BGP adj out index");
+DEFINE_MTYPE(BGPD, BGP_ADJ_COMPACT, "BGP compact adj out");
 DEFINE_MTYPE(BGPD, BGP_MPATH_INFO, "BGP multipath info");
+DEFINE_MTYPE(BGPD, BGP_ADDPATH_NODE, "BGP addpath ID pools");
 
 DEFINE_MTYPE(BGPD, AS_LIST, "BGP AS list");
 DEFINE_MTYPE(BGPD, AS_FILTER, "BGP AS filter");
@@ -85,7 +90,11 @@ DEFINE_MTYPE(BGPD, CLUSTER, "Cluster list");
 DEFINE_MTYPE(BGPD, CLUSTER_VAL, "Cluster list val");
 
 DEFINE_MTYPE(BGPD, BGP_PROCESS_QUEUE, "BGP Process queue");
+DEFINE_MTYPE(BGPD, BGP_PROCESS_HINT, "BGP Process preselection");
+DEFINE_MTYPE(BGPD, BGP_UPDGRP_BUILD, "BGP update-group packet build");
+DEFINE_MTYPE(BGPD, BGP_ATTR_PREPARSE, "BGP attribute preparse");
 DEFINE_MTYPE(BGPD, BGP_CLEAR_NODE_QUEUE, "BGP node clear queue");
+DEFINE_MTYPE(BGPD, BGP_STALE_SWEEP, "BGP stale path sweep");
 
 DEFINE_MTYPE(BGPD, TRANSIT, "BGP transit attr");
 DEFINE_MTYPE(BGPD, TRANSIT_VAL, "BGP transit val");
@@ -147,3 +156,5 @@ DEFINE_MTYPE(BGPD, BGP_SRV6_FUNCTION, "BGP srv6 function");
 DEFINE_MTYPE(BGPD, EVPN_REMOTE_IP, "BGP EVPN Remote IP hash entry");
 
 DEFINE_MTYPE(BGPD, BGP_NOTIFICATION, "BGP Notification Message");
+
+DEFINE_MTYPE(BGPD, BGP_RMAP_CACHE, "BGP route-map result cache");
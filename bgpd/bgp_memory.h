@@ -38,6 +38,8 @@ DECLARE_MTYPE(BGP_PEER_AF);
 DECLARE_MTYPE(BGP_UPDGRP);
 DECLARE_MTYPE(BGP_UPD_SUBGRP);
 DECLARE_MTYPE(BGP_PACKET);
+DECLARE_MTYPE(BGP_PACKET_BUF);
+DECLARE_MTYPE(BGP_OBUF_SHARED);
 DECLARE_MTYPE(ATTR);
 DECLARE_MTYPE(AS_PATH);
 DECLARE_MTYPE(AS_SEG);
@@ -55,7 +57,10 @@ DECLARE_MTYPE(BGP_ADVERTISE);
 DECLARE_MTYPE(BGP_SYNCHRONISE);
 DECLARE_MTYPE(BGP_ADJ_IN);
 DECLARE_MTYPE(BGP_ADJ_OUT);
+DECLARE_MTYPE(BGP_ADJ_OUT_IDX);
+DECLARE_MTYPE(BGP_ADJ_COMPACT);
 DECLARE_MTYPE(BGP_MPATH_INFO);
+DECLARE_MTYPE(BGP_ADDPATH_NODE);
 
 DECLARE_MTYPE(AS_LIST);
 DECLARE_MTYPE(AS_FILTER);
@@ -81,7 +86,11 @@ DECLARE_MTYPE(CLUSTER);
 DECLARE_MTYPE(CLUSTER_VAL);
 
 DECLARE_MTYPE(BGP_PROCESS_QUEUE);
+DECLARE_MTYPE(BGP_PROCESS_HINT);
+DECLARE_MTYPE(BGP_UPDGRP_BUILD);
+DECLARE_MTYPE(BGP_ATTR_PREPARSE);
 DECLARE_MTYPE(BGP_CLEAR_NODE_QUEUE);
+DECLARE_MTYPE(BGP_STALE_SWEEP);
 
 DECLARE_MTYPE(TRANSIT);
 DECLARE_MTYPE(TRANSIT_VAL);
@@ -146,4 +155,6 @@ DECLARE_MTYPE(EVPN_REMOTE_IP);
 
 DECLARE_MTYPE(BGP_NOTIFICATION);
 
+DECLARE_MTYPE(BGP_RMAP_CACHE);
+
 #endif /* _QUAGGA_BGP_MEMORY_H */
@@ -270,6 +270,13 @@ void bgp_mp_list_add(struct list *mp_list, struct bgp_path_info *mpinfo)
 	listnode_add_sort(mp_list, mpinfo);
 }
 
+/* Multipath information lives in the path's extra block, when there's any */
+static inline struct bgp_path_info_mpath *
+bgp_path_mpath(const struct bgp_path_info *path)
+{
+	return path->extra ? path->extra->mpath : NULL;
+}
+
 /*
  * bgp_path_info_mpath_new
  *
@@ -311,14 +318,15 @@ bgp_path_info_mpath_get(struct bgp_path_info *path)
 	if (!path)
 		return NULL;
 
-	if (!path->mpath) {
+	mpath = bgp_path_mpath(path);
+	if (!mpath) {
 		mpath = bgp_path_info_mpath_new();
 		if (!mpath)
 			return NULL;
-		path->mpath = mpath;
+		bgp_path_info_extra_get(path)->mpath = mpath;
 		mpath->mp_info = path;
 	}
-	return path->mpath;
+	return mpath;
 }
 
 /*
@@ -353,7 +361,7 @@ static void bgp_path_info_mpath_enqueue(struct bgp_path_info *prev_info,
  */
 void bgp_path_info_mpath_dequeue(struct bgp_path_info *path)
 {
-	struct bgp_path_info_mpath *mpath = path->mpath;
+	struct bgp_path_info_mpath *mpath = bgp_path_mpath(path);
 	if (!mpath)
 		return;
 	if (mpath->mp_prev)
@@ -371,9 +379,11 @@ void bgp_path_info_mpath_dequeue(struct bgp_path_info *path)
  */
 struct bgp_path_info *bgp_path_info_mpath_next(struct bgp_path_info *path)
 {
-	if (!path->mpath || !path->mpath->mp_next)
+	struct bgp_path_info_mpath *mpath = bgp_path_mpath(path);
+
+	if (!mpath || !mpath->mp_next)
 		return NULL;
-	return path->mpath->mp_next->mp_info;
+	return mpath->mp_next->mp_info;
 }
 
 /*
@@ -393,9 +403,11 @@ struct bgp_path_info *bgp_path_info_mpath_first(struct bgp_path_info *path)
  */
 uint32_t bgp_path_info_mpath_count(struct bgp_path_info *path)
 {
-	if (!path->mpath)
+	struct bgp_path_info_mpath *mpath = bgp_path_mpath(path);
+
+	if (!mpath)
 		return 0;
-	return path->mpath->mp_count;
+	return mpath->mp_count;
 }
 
 /*
@@ -407,7 +419,7 @@ static void bgp_path_info_mpath_count_set(struct bgp_path_info *path,
 					  uint16_t count)
 {
 	struct bgp_path_info_mpath *mpath;
-	if (!count && !path->mpath)
+	if (!count && !bgp_path_mpath(path))
 		return;
 	mpath = bgp_path_info_mpath_get(path);
 	if (!mpath)
@@ -425,7 +437,7 @@ static void bgp_path_info_mpath_lb_update(struct bgp_path_info *path, bool set,
 {
 	struct bgp_path_info_mpath *mpath;
 
-	mpath = path->mpath;
+	mpath = bgp_path_mpath(path);
 	if (mpath == NULL) {
 		if (!set || (cum_bw == 0 && !all_paths_lb))
 			return;
@@ -458,9 +470,11 @@ static void bgp_path_info_mpath_lb_update(struct bgp_path_info *path, bool set,
  */
 struct attr *bgp_path_info_mpath_attr(struct bgp_path_info *path)
 {
-	if (!path->mpath)
+	struct bgp_path_info_mpath *mpath = bgp_path_mpath(path);
+
+	if (!mpath)
 		return NULL;
-	return path->mpath->mp_attr;
+	return mpath->mp_attr;
 }
 
 /*
@@ -471,8 +485,10 @@ struct attr *bgp_path_info_mpath_attr(struct bgp_path_info *path)
  */
 bool bgp_path_info_mpath_chkwtd(struct bgp *bgp, struct bgp_path_info *path)
 {
+	struct bgp_path_info_mpath *mpath = bgp_path_mpath(path);
+
 	/* Check if told to ignore weights or not multipath */
-	if (bgp->lb_handling == BGP_LINK_BW_IGNORE_BW || !path->mpath)
+	if (bgp->lb_handling == BGP_LINK_BW_IGNORE_BW || !mpath)
 		return false;
 
 	/* All paths in multipath should have associated weight (bandwidth)
@@ -480,10 +496,10 @@ bool bgp_path_info_mpath_chkwtd(struct bgp *bgp, struct bgp_path_info *path)
 	 */
 	if (bgp->lb_handling != BGP_LINK_BW_SKIP_MISSING &&
 	    bgp->lb_handling != BGP_LINK_BW_DEFWT_4_MISSING)
-		return (path->mpath->mp_flags & BGP_MP_LB_ALL);
+		return (mpath->mp_flags & BGP_MP_LB_ALL);
 
 	/* At least one path should have bandwidth. */
-	return (path->mpath->mp_flags & BGP_MP_LB_PRESENT);
+	return (mpath->mp_flags & BGP_MP_LB_PRESENT);
 }
 
 /*
@@ -494,9 +510,11 @@ bool bgp_path_info_mpath_chkwtd(struct bgp *bgp, struct bgp_path_info *path)
  */
 uint64_t bgp_path_info_mpath_cumbw(struct bgp_path_info *path)
 {
-	if (!path->mpath)
+	struct bgp_path_info_mpath *mpath = bgp_path_mpath(path);
+
+	if (!mpath)
 		return 0;
-	return path->mpath->cum_bw;
+	return mpath->cum_bw;
 }
 
 /*
@@ -508,7 +526,7 @@ static void bgp_path_info_mpath_attr_set(struct bgp_path_info *path,
 					 struct attr *attr)
 {
 	struct bgp_path_info_mpath *mpath;
-	if (!attr && !path->mpath)
+	if (!attr && !bgp_path_mpath(path))
 		return;
 	mpath = bgp_path_info_mpath_get(path);
 	if (!mpath)
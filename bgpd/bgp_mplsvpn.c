@@ -30,6 +30,8 @@
 #include "mpls.h"
 #include "json.h"
 #include "zclient.h"
+#include "jhash.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_debug.h"
@@ -689,18 +691,14 @@ static void sid_register(struct bgp *bgp, const struct in6_addr *sid,
 	func->sid = *sid;
 	snprintf(func->locator_name, sizeof(func->locator_name),
 		 "%s", locator_name);
-	listnode_add(bgp->srv6_functions, func);
+	bgp_srv6_functions_add(&bgp->srv6_functions, func);
 }
 
 static bool sid_exist(struct bgp *bgp, const struct in6_addr *sid)
 {
-	struct listnode *node;
-	struct bgp_srv6_function *func;
+	struct bgp_srv6_function ref = { .sid = *sid };
 
-	for (ALL_LIST_ELEMENTS_RO(bgp->srv6_functions, node, func))
-		if (sid_same(&func->sid, sid))
-			return true;
-	return false;
+	return !!bgp_srv6_functions_find(&bgp->srv6_functions, &ref);
 }
 
 /*
@@ -928,23 +926,163 @@ void transpose_sid(struct in6_addr *sid, uint32_t label, uint8_t offset,
 	}
 }
 
-static bool ecom_intersect(struct ecommunity *e1, struct ecommunity *e2)
+/*
+ * Instances importing each route target from VPN, so VPN routes are only
+ * leaked to VRFs that import them instead of trying every instance.  Built
+ * from the import RT lists on first use after they may have changed, see
+ * vpn_leak_import_rt_changed().
+ */
+DEFINE_MTYPE_STATIC(BGPD, BGP_VPN_IMPORT_RT, "BGP VPN import RT index");
+
+PREDECL_HASH(vpn_import_rt);
+
+struct vpn_import_rt {
+	struct vpn_import_rt_item item;
+
+	uint8_t unit_size;
+	uint8_t val[IPV6_ECOMMUNITY_SIZE];
+
+	/* struct bgp *, each once */
+	struct list *vrfs;
+};
+
+static int vpn_import_rt_cmp(const struct vpn_import_rt *a,
+			     const struct vpn_import_rt *b)
 {
-	uint32_t i, j;
+	if (a->unit_size != b->unit_size)
+		return numcmp(a->unit_size, b->unit_size);
+	return memcmp(a->val, b->val, a->unit_size);
+}
 
-	if (!e1 || !e2)
-		return false;
-	for (i = 0; i < e1->size; ++i) {
-		for (j = 0; j < e2->size; ++j) {
-			if (!memcmp(e1->val + (i * e1->unit_size),
-				    e2->val + (j * e2->unit_size),
-				    e1->unit_size)) {
+static uint32_t vpn_import_rt_hash(const struct vpn_import_rt *irt)
+{
+	return jhash(irt->val, irt->unit_size, irt->unit_size);
+}
+
+DECLARE_HASH(vpn_import_rt, struct vpn_import_rt, item, vpn_import_rt_cmp,
+	     vpn_import_rt_hash);
+
+static struct vpn_import_rt_head vpn_import_rts[AFI_MAX];
+static bool vpn_import_rts_valid;
+
+void vpn_leak_import_rt_changed(void)
+{
+	struct vpn_import_rt *irt;
+	afi_t afi;
 
-				return true;
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		while ((irt = vpn_import_rt_pop(&vpn_import_rts[afi]))) {
+			list_delete(&irt->vrfs);
+			XFREE(MTYPE_BGP_VPN_IMPORT_RT, irt);
+		}
+	}
+	vpn_import_rts_valid = false;
+}
+
+static void vpn_import_rt_build(void)
+{
+	struct vpn_import_rt key = {}, *irt;
+	struct ecommunity *ecom;
+	struct listnode *node, *tail;
+	struct bgp *bgp;
+	uint32_t i;
+	afi_t afi;
+
+	if (vpn_import_rts_valid)
+		return;
+	vpn_import_rts_valid = true;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+			ecom = bgp->vpn_policy[afi]
+				       .rtlist[BGP_VPN_POLICY_DIR_FROMVPN];
+			if (!ecom || ecom->unit_size > sizeof(key.val))
+				continue;
+
+			key.unit_size = ecom->unit_size;
+			for (i = 0; i < ecom->size; i++) {
+				memcpy(key.val, ecom->val + i * ecom->unit_size,
+				       ecom->unit_size);
+
+				irt = vpn_import_rt_find(&vpn_import_rts[afi],
+							 &key);
+				if (!irt) {
+					irt = XCALLOC(MTYPE_BGP_VPN_IMPORT_RT,
+						      sizeof(*irt));
+					irt->unit_size = key.unit_size;
+					memcpy(irt->val, key.val,
+					       sizeof(irt->val));
+					irt->vrfs = list_new();
+					vpn_import_rt_add(&vpn_import_rts[afi],
+							  irt);
+				}
+
+				/* instances are added one after the other */
+				tail = listtail(irt->vrfs);
+				if (!tail || listgetdata(tail) != bgp)
+					listnode_add(irt->vrfs, bgp);
 			}
 		}
 	}
-	return false;
+}
+
+static int vpn_import_rt_vrf_cmp(const void *a, const void *b)
+{
+	const struct bgp *const *bgp_a = a;
+	const struct bgp *const *bgp_b = b;
+
+	if (*bgp_a == *bgp_b)
+		return 0;
+	return *bgp_a < *bgp_b ? -1 : 1;
+}
+
+/*
+ * Instances importing any of the route targets in ecom from VPN, each
+ * once.  The returned array is MTYPE_TMP, NULL if there are none.
+ */
+static struct bgp **vpn_import_rt_vrfs(afi_t afi, struct ecommunity *ecom,
+				       unsigned int *count)
+{
+	struct vpn_import_rt key = {}, *irt;
+	struct bgp **vrfs = NULL;
+	struct listnode *node;
+	struct bgp *bgp;
+	unsigned int n = 0, matched = 0, j;
+	uint32_t i;
+
+	*count = 0;
+	if (!ecom || ecom->unit_size > sizeof(key.val) || afi >= AFI_MAX)
+		return NULL;
+
+	vpn_import_rt_build();
+
+	key.unit_size = ecom->unit_size;
+	for (i = 0; i < ecom->size; i++) {
+		memcpy(key.val, ecom->val + i * ecom->unit_size,
+		       ecom->unit_size);
+
+		irt = vpn_import_rt_find(&vpn_import_rts[afi], &key);
+		if (!irt)
+			continue;
+
+		matched++;
+		vrfs = XREALLOC(MTYPE_TMP, vrfs,
+				(n + listcount(irt->vrfs)) * sizeof(*vrfs));
+		for (ALL_LIST_ELEMENTS_RO(irt->vrfs, node, bgp))
+			vrfs[n++] = bgp;
+	}
+
+	/* VRFs importing more than one of the route's RTs */
+	if (matched > 1) {
+		qsort(vrfs, n, sizeof(*vrfs), vpn_import_rt_vrf_cmp);
+		for (i = 1, j = 1; i < n; i++)
+			if (vrfs[i] != vrfs[j - 1])
+				vrfs[j++] = vrfs[i];
+		n = j;
+	}
+
+	*count = n;
+	return vrfs;
 }
 
 static bool labels_same(struct bgp_path_info *bpi, mpls_label_t *label,
@@ -1093,7 +1231,7 @@ leak_update(struct bgp *to_bgp, struct bgp_dest *bn,
 	    struct attr *new_attr, /* already interned */
 	    afi_t afi, safi_t safi, struct bgp_path_info *source_bpi,
 	    mpls_label_t *label, uint32_t num_labels, struct bgp *bgp_orig,
-	    struct prefix *nexthop_orig, int nexthop_self_flag, int debug)
+	    int nexthop_self_flag, int debug)
 {
 	const struct prefix *p = bgp_dest_get_prefix(bn);
 	struct bgp_path_info *bpi;
@@ -1300,8 +1438,6 @@ leak_update(struct bgp *to_bgp, struct bgp_dest *bn,
 		(struct bgp_dest *)((struct bgp_path_info *)parent)->net);
 	if (bgp_orig)
 		new->extra->bgp_orig = bgp_lock(bgp_orig);
-	if (nexthop_orig)
-		new->extra->nexthop_orig = *nexthop_orig;
 
 	if (leak_update_nexthop_valid(to_bgp, bn, new_attr, afi, safi,
 				      source_bpi, new, bgp_orig, p, debug))
@@ -1688,7 +1824,7 @@ void vpn_leak_from_vrf_update(struct bgp *to_bgp,	     /* to */
 
 	new_info =
 		leak_update(to_bgp, bn, new_attr, afi, safi, path_vrf, &label,
-			    1, from_bgp, NULL, nexthop_self_flag, debug);
+			    1, from_bgp, nexthop_self_flag, debug);
 
 	/*
 	 * Routes actually installed in the vpn RIB must also be
@@ -1886,7 +2022,7 @@ vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,	     /* to */
 	}
 
 	/* Check for intersection of route targets */
-	if (!ecom_intersect(
+	if (!ecommunity_intersect(
 		    to_bgp->vpn_policy[afi].rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
 		    bgp_attr_get_ecommunity(path_vpn->attr))) {
 		if (debug)
@@ -1924,11 +2060,11 @@ vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,	     /* to */
 	}
 
 	/*
-	 * Nexthop: stash and clear
+	 * Nexthop: clear
 	 *
 	 * Nexthop is valid in context of VPN core, but not in destination vrf.
-	 * Stash it for later label resolution by vrf ingress path and then
-	 * overwrite with 0, i.e., "me", for the sake of vrf advertisement.
+	 * It can be found in the parent path when needed, overwrite it with
+	 * 0, i.e., "me", for the sake of vrf advertisement.
 	 */
 	uint8_t nhfamily = NEXTHOP_FAMILY(path_vpn->attr->mp_nexthop_len);
 
@@ -2056,16 +2192,18 @@ vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,	     /* to */
 		src_vrf = from_bgp;
 
 	leak_update(to_bgp, bn, new_attr, afi, safi, path_vpn, pLabels,
-		    num_labels, src_vrf, &nexthop_orig, nexthop_self_flag,
-		    debug);
+		    num_labels, src_vrf, nexthop_self_flag, debug);
 	return true;
 }
 
 bool vpn_leak_to_vrf_update(struct bgp *from_bgp,	   /* from */
 			    struct bgp_path_info *path_vpn) /* route */
 {
-	struct listnode *mnode, *mnnode;
+	const struct prefix *p = bgp_dest_get_prefix(path_vpn->net);
+	afi_t afi = family2afi(p->family);
+	struct bgp **vrfs;
 	struct bgp *bgp;
+	unsigned int count, i;
 	bool leak_success = false;
 
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
@@ -2073,8 +2211,11 @@ bool vpn_leak_to_vrf_update(struct bgp *from_bgp,	   /* from */
 	if (debug)
 		zlog_debug("%s: start (path_vpn=%p)", __func__, path_vpn);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
+	/* Loop over VRFs importing one of the route targets */
+	vrfs = vpn_import_rt_vrfs(afi, bgp_attr_get_ecommunity(path_vpn->attr),
+				  &count);
+	for (i = 0; i < count; i++) {
+		bgp = vrfs[i];
 
 		if (!path_vpn->extra
 		    || path_vpn->extra->bgp_orig != bgp) { /* no loop */
@@ -2082,6 +2223,8 @@ bool vpn_leak_to_vrf_update(struct bgp *from_bgp,	   /* from */
 				bgp, from_bgp, path_vpn);
 		}
 	}
+	XFREE(MTYPE_TMP, vrfs);
+
 	return leak_success;
 }
 
@@ -2092,7 +2235,8 @@ void vpn_leak_to_vrf_withdraw(struct bgp *from_bgp,	   /* from */
 	afi_t afi;
 	safi_t safi = SAFI_UNICAST;
 	struct bgp *bgp;
-	struct listnode *mnode, *mnnode;
+	struct bgp **vrfs;
+	unsigned int count, i;
 	struct bgp_dest *bn;
 	struct bgp_path_info *bpi;
 	const char *debugmsg;
@@ -2125,8 +2269,12 @@ void vpn_leak_to_vrf_withdraw(struct bgp *from_bgp,	   /* from */
 	p = bgp_dest_get_prefix(path_vpn->net);
 	afi = family2afi(p->family);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
+	/* Loop over VRFs importing one of the route targets */
+	vrfs = vpn_import_rt_vrfs(afi, bgp_attr_get_ecommunity(path_vpn->attr),
+				  &count);
+	for (i = 0; i < count; i++) {
+		bgp = vrfs[i];
+
 		if (!vpn_leak_from_vpn_active(bgp, afi, &debugmsg)) {
 			if (debug)
 				zlog_debug("%s: skipping: %s", __func__,
@@ -2135,9 +2283,10 @@ void vpn_leak_to_vrf_withdraw(struct bgp *from_bgp,	   /* from */
 		}
 
 		/* Check for intersection of route targets */
-		if (!ecom_intersect(bgp->vpn_policy[afi]
-					    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
-				    bgp_attr_get_ecommunity(path_vpn->attr))) {
+		if (!ecommunity_intersect(
+			    bgp->vpn_policy[afi]
+				    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
+			    bgp_attr_get_ecommunity(path_vpn->attr))) {
 
 			continue;
 		}
@@ -2167,6 +2316,7 @@ void vpn_leak_to_vrf_withdraw(struct bgp *from_bgp,	   /* from */
 		}
 		bgp_dest_unlock_node(bn);
 	}
+	XFREE(MTYPE_TMP, vrfs);
 }
 
 void vpn_leak_to_vrf_withdraw_all(struct bgp *to_bgp, afi_t afi)
@@ -2376,6 +2526,7 @@ void vpn_handle_router_id_update(struct bgp *bgp, bool withdraw,
 						.rtlist[idir],
 					(struct ecommunity_val *)ecom->val);
 			}
+			vpn_leak_import_rt_changed();
 		} else {
 			/* New router-id derive auto RD and RT and export
 			 * to VPN
@@ -2529,6 +2680,7 @@ void vrf_import_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp,
 					 .rtlist[idir], ecom);
 	else
 		to_bgp->vpn_policy[afi].rtlist[idir] = ecommunity_dup(ecom);
+	vpn_leak_import_rt_changed();
 	SET_FLAG(to_bgp->af_flags[afi][safi], BGP_CONFIG_VRF_TO_VRF_IMPORT);
 
 	if (debug) {
@@ -2619,6 +2771,7 @@ void vrf_unimport_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp,
 				   BGP_CONFIG_VRF_TO_VRF_IMPORT);
 		if (to_bgp->vpn_policy[afi].rtlist[idir])
 			ecommunity_free(&to_bgp->vpn_policy[afi].rtlist[idir]);
+		vpn_leak_import_rt_changed();
 	} else {
 		ecom = from_bgp->vpn_policy[afi].rtlist[edir];
 		if (ecom)
@@ -3316,7 +3469,7 @@ vrf_id_t get_first_vrf_for_redirect_with_rt(struct ecommunity *eckey)
 		if (ec && eckey->unit_size != ec->unit_size)
 			continue;
 
-		if (ecom_intersect(ec, eckey))
+		if (ecommunity_intersect(ec, eckey))
 			return bgp->vrf_id;
 	}
 	return VRF_UNKNOWN;
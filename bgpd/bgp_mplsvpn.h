@@ -75,6 +75,9 @@ extern bool vpn_leak_to_vrf_update(struct bgp *from_bgp,
 extern void vpn_leak_to_vrf_withdraw(struct bgp *from_bgp,
 				     struct bgp_path_info *path_vpn);
 
+/* Import RT lists or the set of instances changed */
+extern void vpn_leak_import_rt_changed(void);
+
 extern void vpn_leak_zebra_vrf_label_update(struct bgp *bgp, afi_t afi);
 extern void vpn_leak_zebra_vrf_label_withdraw(struct bgp *bgp, afi_t afi);
 extern void vpn_leak_zebra_vrf_sid_update(struct bgp *bgp, afi_t afi);
@@ -228,6 +231,9 @@ static inline void vpn_leak_postchange(enum vpn_policy_direction direction,
 				       afi_t afi, struct bgp *bgp_vpn,
 				       struct bgp *bgp_vrf)
 {
+	if (direction == BGP_VPN_POLICY_DIR_FROMVPN)
+		vpn_leak_import_rt_changed();
+
 	/* Detect when default bgp instance is not (yet) defined by config */
 	if (!bgp_vpn)
 		return;
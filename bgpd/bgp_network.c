@@ -325,8 +325,21 @@ static int bgp_get_instance_for_inc_conn(int sock, struct bgp **bgp_inst)
 #endif
 }
 
-static void bgp_socket_set_buffer_size(const int fd)
+static void bgp_socket_set_tcp_options(const int fd)
 {
+#ifdef TCP_NOTSENT_LOWAT
+	int lowat = BGP_SOCKET_NOTSENT_LOWAT;
+
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat,
+		       sizeof(lowat)) < 0)
+		zlog_warn("%s: setsockopt(%d, TCP_NOTSENT_LOWAT): %s",
+			  __func__, fd, safe_strerror(errno));
+#endif
+
+	/* 0 = leave the kernel's autotuning alone */
+	if (!bm->socket_buffer)
+		return;
+
 	if (getsockopt_so_sendbuf(fd) < (int)bm->socket_buffer)
 		setsockopt_so_sendbuf(fd, bm->socket_buffer);
 	if (getsockopt_so_recvbuf(fd) < (int)bm->socket_buffer)
@@ -413,7 +426,7 @@ static void bgp_accept(struct thread *thread)
 		return;
 	}
 
-	bgp_socket_set_buffer_size(bgp_sock);
+	bgp_socket_set_tcp_options(bgp_sock);
 
 	/* Check remote IP address */
 	peer1 = peer_lookup(bgp, &su);
@@ -716,7 +729,7 @@ int bgp_connect(struct peer *peer)
 	if (CHECK_FLAG(peer->flags, PEER_FLAG_TCP_MSS))
 		sockopt_tcp_mss_set(peer->fd, peer->tcp_mss);
 
-	bgp_socket_set_buffer_size(peer->fd);
+	bgp_socket_set_tcp_options(peer->fd);
 
 	if (bgp_set_socket_ttl(peer, peer->fd) < 0) {
 		peer->last_reset = PEER_DOWN_SOCKET_ERROR;
@@ -21,7 +21,19 @@
 #ifndef _QUAGGA_BGP_NETWORK_H
 #define _QUAGGA_BGP_NETWORK_H
 
+/* Linux autotunes socket buffers up to net.ipv4.tcp_wmem/tcp_rmem, setting
+ * SO_SNDBUF/SO_RCVBUF turns that off and caps the window on long-RTT links.
+ */
+#ifdef GNU_LINUX
+#define BGP_SOCKET_SNDBUF_SIZE 0
+#else
 #define BGP_SOCKET_SNDBUF_SIZE 65536
+#endif
+
+/* unsent data the kernel holds per session, the rest waits in the peer's
+ * output queue (and keepalives don't queue behind megabytes of UPDATEs)
+ */
+#define BGP_SOCKET_NOTSENT_LOWAT 131072
 
 struct bgp_listener {
 	int fd;
@@ -39,6 +39,7 @@
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_nht.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_damp.h"
@@ -102,6 +103,8 @@ bool bnc_existing_for_prefix(struct bgp_nexthop_cache *bnc)
 
 void bnc_free(struct bgp_nexthop_cache *bnc)
 {
+	bgp_nhg_bnc_free(bnc);
+	bgp_nht_eval_cancel(bnc);
 	bnc_nexthop_free(bnc);
 	bgp_nexthop_cache_del(bnc->tree, bnc);
 	XFREE(MTYPE_BGP_NEXTHOP_CACHE, bnc);
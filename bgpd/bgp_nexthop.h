@@ -38,6 +38,7 @@
 #define BGP_MP_NEXTHOP_FAMILY NEXTHOP_FAMILY
 
 PREDECL_RBTREE_UNIQ(bgp_nexthop_cache);
+PREDECL_DLIST(bgp_nht_eval);
 
 /* BGP nexthop cache value structure. */
 struct bgp_nexthop_cache {
@@ -106,6 +107,16 @@ struct bgp_nexthop_cache {
 	 * nexthop.
 	 */
 	bool is_evpn_gwip_nexthop;
+
+	/* Paths are evaluated in the background, see evaluate_paths():
+	 * eval_next is the next one, eval_change_flags the change_flags of
+	 * all updates since the evaluation (re)started.
+	 */
+	struct bgp_nht_eval_item eval_entry;
+	struct bgp_path_info *eval_next;
+	uint16_t eval_change_flags;
+	bool eval_queued;
+	bool eval_pic;
 };
 
 extern int bgp_nexthop_cache_compare(const struct bgp_nexthop_cache *a,
@@ -0,0 +1,327 @@
+/* BGP shared nexthop groups (prefix independent convergence)
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "jhash.h"
+#include "memory.h"
+#include "nexthop.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_nhg.h"
+#include "bgpd/bgp_zebra.h"
+
+extern struct zclient *zclient;
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_NHG, "BGP shared nexthop group");
+
+static int bgp_nhg_cmp(const struct bgp_nhg *a, const struct bgp_nhg *b)
+{
+	if (a->num != b->num)
+		return numcmp(a->num, b->num);
+	return memcmp(a->bnc, b->bnc, a->num * sizeof(a->bnc[0]));
+}
+
+static uint32_t bgp_nhg_hash(const struct bgp_nhg *nhg)
+{
+	return jhash(nhg->bnc, nhg->num * sizeof(nhg->bnc[0]), 0x6e68677);
+}
+
+DECLARE_HASH(bgp_nhg_cache, struct bgp_nhg, entry, bgp_nhg_cmp, bgp_nhg_hash);
+
+static int bgp_nhg_id_cmp(const struct bgp_nhg *a, const struct bgp_nhg *b)
+{
+	return numcmp(a->id, b->id);
+}
+
+static uint32_t bgp_nhg_id_hash(const struct bgp_nhg *nhg)
+{
+	return nhg->id;
+}
+
+DECLARE_HASH(bgp_nhg_ids, struct bgp_nhg, id_entry, bgp_nhg_id_cmp,
+	     bgp_nhg_id_hash);
+
+/* groups by BGP nexthops; orphans are only in the ID hash */
+static struct bgp_nhg_cache_head bgp_nhg_cache;
+static struct bgp_nhg_ids_head bgp_nhg_ids;
+
+void bgp_nhg_init(void)
+{
+	bgp_nhg_cache_init(&bgp_nhg_cache);
+	bgp_nhg_ids_init(&bgp_nhg_ids);
+}
+
+void bgp_nhg_finish(void)
+{
+	struct bgp_nhg *nhg;
+
+	bgp_nhg_cache_fini(&bgp_nhg_cache);
+
+	while ((nhg = bgp_nhg_ids_pop(&bgp_nhg_ids))) {
+		bgp_l3nhg_id_free(nhg->id);
+		XFREE(MTYPE_BGP_NHG, nhg);
+	}
+	bgp_nhg_ids_fini(&bgp_nhg_ids);
+}
+
+static int bgp_nhg_bnc_cmp(const void *a, const void *b)
+{
+	const struct bgp_nexthop_cache *const *bnc_a = a;
+	const struct bgp_nexthop_cache *const *bnc_b = b;
+
+	if (*bnc_a == *bnc_b)
+		return 0;
+	return *bnc_a < *bnc_b ? -1 : 1;
+}
+
+/*
+ * What the group's BGP nexthops resolve to.  Nexthops that are not valid
+ * are left out; that's what gives fast failover in the dataplane.  Zebra
+ * only accepts fully resolved nexthops (gateway and interface) in groups.
+ */
+static bool bgp_nhg_zapi(const struct bgp_nhg *nhg, struct zapi_nhg *api_nhg)
+{
+	struct bgp_nexthop_cache *bnc;
+	struct nexthop *nh, rnh;
+	struct zapi_nexthop *api_nh;
+	unsigned int i, j;
+
+	memset(api_nhg, 0, sizeof(*api_nhg));
+	api_nhg->id = nhg->id;
+
+	for (i = 0; i < nhg->num; i++) {
+		bnc = nhg->bnc[i];
+		if (!CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID))
+			continue;
+
+		for (nh = bnc->nexthop; nh; nh = nh->next) {
+			rnh = *nh;
+			rnh.next = rnh.prev = NULL;
+
+			switch (nh->type) {
+			case NEXTHOP_TYPE_IFINDEX:
+				/* connected, the BGP nexthop is the gateway */
+				if (bnc->prefix.family == AF_INET) {
+					rnh.type = NEXTHOP_TYPE_IPV4_IFINDEX;
+					rnh.gate.ipv4 = bnc->prefix.u.prefix4;
+				} else {
+					rnh.type = NEXTHOP_TYPE_IPV6_IFINDEX;
+					rnh.gate.ipv6 = bnc->prefix.u.prefix6;
+				}
+				break;
+			case NEXTHOP_TYPE_IPV4_IFINDEX:
+			case NEXTHOP_TYPE_IPV6_IFINDEX:
+				break;
+			case NEXTHOP_TYPE_IPV4:
+			case NEXTHOP_TYPE_IPV6:
+			case NEXTHOP_TYPE_BLACKHOLE:
+				return false;
+			}
+
+			if (!rnh.ifindex)
+				return false;
+
+			if (api_nhg->nexthop_num == MULTIPATH_NUM)
+				break;
+
+			api_nh = &api_nhg->nexthops[api_nhg->nexthop_num];
+			if (zapi_nexthop_from_nexthop(api_nh, &rnh) < 0)
+				return false;
+
+			/* BGP nexthops may share IGP nexthops */
+			for (j = 0; j < api_nhg->nexthop_num; j++)
+				if (!memcmp(&api_nhg->nexthops[j], api_nh,
+					    sizeof(*api_nh)))
+					break;
+			if (j == api_nhg->nexthop_num)
+				api_nhg->nexthop_num++;
+		}
+	}
+
+	return api_nhg->nexthop_num > 0;
+}
+
+/* Sends the group to zebra if its content changed */
+static bool bgp_nhg_install(struct bgp_nhg *nhg)
+{
+	struct zapi_nhg api_nhg;
+	uint32_t key;
+
+	if (!bgp_nhg_zapi(nhg, &api_nhg)) {
+		/* routes using it have to go back to their own nexthops */
+		UNSET_FLAG(nhg->flags, BGP_NHG_INSTALLED);
+		return false;
+	}
+
+	key = jhash(api_nhg.nexthops,
+		    api_nhg.nexthop_num * sizeof(api_nhg.nexthops[0]),
+		    api_nhg.nexthop_num);
+	if (CHECK_FLAG(nhg->flags, BGP_NHG_INSTALLED) && key == nhg->sent_key)
+		return true;
+
+	if (!zclient || zclient->sock < 0)
+		return false;
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("%s: nhg %u with %u nexthops to zebra", __func__,
+			   nhg->id, api_nhg.nexthop_num);
+
+	if (zclient_nhg_send(zclient, ZEBRA_NHG_ADD, &api_nhg)
+	    == ZCLIENT_SEND_FAILURE)
+		return false;
+
+	SET_FLAG(nhg->flags, BGP_NHG_INSTALLED);
+	nhg->sent_key = key;
+	return true;
+}
+
+static void bgp_nhg_free(struct bgp_nhg *nhg)
+{
+	struct zapi_nhg api_nhg = {};
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("%s: nhg %u", __func__, nhg->id);
+
+	if (CHECK_FLAG(nhg->flags, BGP_NHG_INSTALLED) && zclient
+	    && zclient->sock >= 0) {
+		api_nhg.id = nhg->id;
+		zclient_nhg_send(zclient, ZEBRA_NHG_DEL, &api_nhg);
+	}
+
+	if (!CHECK_FLAG(nhg->flags, BGP_NHG_ORPHAN))
+		bgp_nhg_cache_del(&bgp_nhg_cache, nhg);
+	bgp_nhg_ids_del(&bgp_nhg_ids, nhg);
+	bgp_l3nhg_id_free(nhg->id);
+	XFREE(MTYPE_BGP_NHG, nhg);
+}
+
+uint32_t bgp_nhg_get(struct bgp_nexthop_cache **bnc, unsigned int num)
+{
+	struct bgp_nhg key = {}, *nhg;
+	unsigned int i;
+
+	if (!num || num > MULTIPATH_NUM)
+		return 0;
+
+	/* the same set in any order, without duplicates */
+	qsort(bnc, num, sizeof(bnc[0]), bgp_nhg_bnc_cmp);
+	for (i = 0; i < num; i++)
+		if (!key.num || key.bnc[key.num - 1] != bnc[i])
+			key.bnc[key.num++] = bnc[i];
+
+	nhg = bgp_nhg_cache_find(&bgp_nhg_cache, &key);
+	if (!nhg) {
+		nhg = XCALLOC(MTYPE_BGP_NHG, sizeof(*nhg));
+		nhg->num = key.num;
+		memcpy(nhg->bnc, key.bnc, key.num * sizeof(key.bnc[0]));
+
+		nhg->id = bgp_l3nhg_id_alloc();
+		if (!nhg->id) {
+			XFREE(MTYPE_BGP_NHG, nhg);
+			return 0;
+		}
+
+		bgp_nhg_cache_add(&bgp_nhg_cache, nhg);
+		bgp_nhg_ids_add(&bgp_nhg_ids, nhg);
+	}
+
+	if (!bgp_nhg_install(nhg)) {
+		if (!nhg->refcnt)
+			bgp_nhg_free(nhg);
+		return 0;
+	}
+
+	nhg->refcnt++;
+	return nhg->id;
+}
+
+void bgp_nhg_release(uint32_t id)
+{
+	struct bgp_nhg key = {}, *nhg;
+
+	if (!id)
+		return;
+
+	key.id = id;
+	nhg = bgp_nhg_ids_find(&bgp_nhg_ids, &key);
+	if (!nhg)
+		return;
+
+	assert(nhg->refcnt);
+	if (--nhg->refcnt == 0)
+		bgp_nhg_free(nhg);
+}
+
+static bool bgp_nhg_has_bnc(const struct bgp_nhg *nhg,
+			    const struct bgp_nexthop_cache *bnc)
+{
+	unsigned int i;
+
+	for (i = 0; i < nhg->num; i++)
+		if (nhg->bnc[i] == bnc)
+			return true;
+
+	return false;
+}
+
+bool bgp_nhg_bnc_update(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_nhg *nhg;
+	bool found = false, ok = true;
+
+	frr_each (bgp_nhg_cache, &bgp_nhg_cache, nhg) {
+		if (!bgp_nhg_has_bnc(nhg, bnc))
+			continue;
+
+		found = true;
+		if (!bgp_nhg_install(nhg))
+			ok = false;
+	}
+
+	return found && ok;
+}
+
+void bgp_nhg_bnc_free(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_nhg *nhg;
+
+	frr_each_safe (bgp_nhg_cache, &bgp_nhg_cache, nhg) {
+		if (!bgp_nhg_has_bnc(nhg, bnc))
+			continue;
+
+		/* the ID stays taken while routes refer to it */
+		bgp_nhg_cache_del(&bgp_nhg_cache, nhg);
+		SET_FLAG(nhg->flags, BGP_NHG_ORPHAN);
+		nhg->num = 0;
+	}
+}
+
+void bgp_nhg_zebra_connected(void)
+{
+	struct bgp_nhg *nhg;
+
+	frr_each (bgp_nhg_ids, &bgp_nhg_ids, nhg)
+		UNSET_FLAG(nhg->flags, BGP_NHG_INSTALLED);
+}
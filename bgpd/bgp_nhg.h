@@ -0,0 +1,84 @@
+/* BGP shared nexthop groups (prefix independent convergence)
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_NHG_H
+#define _FRR_BGP_NHG_H
+
+#include "typesafe.h"
+
+/*
+ * With "bgp pic", routes are installed in zebra with the ID of a nexthop
+ * group shared by all routes using the same set of BGP nexthops.  The
+ * group holds what these BGP nexthops resolve to, so when that changes
+ * (IGP convergence, a BGP nexthop going away) only the group is updated,
+ * not every route using it.
+ *
+ * Group IDs come from the L3 NHG range, see bgp_l3nhg_id_alloc().
+ */
+PREDECL_HASH(bgp_nhg_cache);
+PREDECL_HASH(bgp_nhg_ids);
+
+struct bgp_nexthop_cache;
+
+struct bgp_nhg {
+	struct bgp_nhg_cache_item entry;
+	struct bgp_nhg_ids_item id_entry;
+
+	uint32_t id;
+	/* routes using the group */
+	unsigned int refcnt;
+
+	uint8_t flags;
+/* content has been sent to zebra */
+#define BGP_NHG_INSTALLED (1 << 0)
+/* one of the BGP nexthops is gone, only kept for routes still using it */
+#define BGP_NHG_ORPHAN (1 << 1)
+
+	/* hash of the nexthops last sent to zebra */
+	uint32_t sent_key;
+
+	/* BGP nexthops, sorted */
+	uint8_t num;
+	struct bgp_nexthop_cache *bnc[MULTIPATH_NUM];
+};
+
+extern void bgp_nhg_init(void);
+extern void bgp_nhg_finish(void);
+
+/*
+ * Returns the ID of the group for these BGP nexthops, with a reference
+ * held, or 0 if they can't be installed as a group.
+ */
+extern uint32_t bgp_nhg_get(struct bgp_nexthop_cache **bnc, unsigned int num);
+extern void bgp_nhg_release(uint32_t id);
+
+/*
+ * Updates the groups using bnc after its resolution changed.  Returns
+ * true if there are any and all of them could be updated, i.e. the routes
+ * using them don't need to be reinstalled for the change.
+ */
+extern bool bgp_nhg_bnc_update(struct bgp_nexthop_cache *bnc);
+/* bnc is about to be freed */
+extern void bgp_nhg_bnc_free(struct bgp_nexthop_cache *bnc);
+
+/* zebra (re)connected, groups have to be sent again */
+extern void bgp_nhg_zebra_connected(void);
+
+#endif /* _FRR_BGP_NHG_H */
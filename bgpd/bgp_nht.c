@@ -46,6 +46,7 @@
 #include "bgpd/bgp_flowspec_util.h"
 #include "bgpd/bgp_evpn.h"
 #include "bgpd/bgp_rd.h"
+#include "bgpd/bgp_nhg.h"
 
 extern struct zclient *zclient;
 
@@ -990,159 +991,248 @@ static void unregister_zebra_rnh(struct bgp_nexthop_cache *bnc)
 	sendmsg_zebra_rnh(bnc, ZEBRA_NEXTHOP_UNREGISTER);
 }
 
-/**
- * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
- * ARGUMENTS:
- *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
- * RETURNS:
- *   void.
+/*
+ * Evaluates one path of bnc for the changes in eval_change_flags.
  */
-void evaluate_paths(struct bgp_nexthop_cache *bnc)
+static void bgp_nht_eval_path(struct bgp_nexthop_cache *bnc,
+			      struct bgp_path_info *path)
 {
 	struct bgp_dest *dest;
-	struct bgp_path_info *path;
 	int afi;
-	struct peer *peer = (struct peer *)bnc->nht_info;
 	struct bgp_table *table;
 	safi_t safi;
 	struct bgp *bgp_path;
 	const struct prefix *p;
 
-	if (BGP_DEBUG(nht, NHT)) {
-		char bnc_buf[BNC_FLAG_DUMP_SIZE];
-		char chg_buf[BNC_FLAG_DUMP_SIZE];
+	if (!(path->type == ZEBRA_ROUTE_BGP
+	      && ((path->sub_type == BGP_ROUTE_NORMAL)
+		  || (path->sub_type == BGP_ROUTE_STATIC)
+		  || (path->sub_type == BGP_ROUTE_IMPORTED))))
+		return;
 
-		zlog_debug(
-			"NH update for %pFX(%d)(%u)(%s) - flags %s chgflags %s- evaluate paths",
-			&bnc->prefix, bnc->ifindex, bnc->srte_color,
-			bnc->bgp->name_pretty,
-			bgp_nexthop_dump_bnc_flags(bnc, bnc_buf,
-						   sizeof(bnc_buf)),
-			bgp_nexthop_dump_bnc_change_flags(bnc, chg_buf,
-							  sizeof(bnc_buf)));
+	dest = path->net;
+	assert(dest && bgp_dest_table(dest));
+	p = bgp_dest_get_prefix(dest);
+	afi = family2afi(p->family);
+	table = bgp_dest_table(dest);
+	safi = table->safi;
+
+	/*
+	 * handle routes from other VRFs (they can have a
+	 * nexthop in THIS VRF). bgp_path is the bgp instance
+	 * that owns the route referencing this nexthop.
+	 */
+	bgp_path = table->bgp;
+
+	/*
+	 * Path becomes valid/invalid depending on whether the nexthop
+	 * reachable/unreachable.
+	 *
+	 * In case of unicast routes that were imported from vpn
+	 * and that have labels, they are valid only if there are
+	 * nexthops with labels
+	 *
+	 * If the nexthop is EVPN gateway-IP,
+	 * do not check for a valid label.
+	 */
+
+	bool bnc_is_valid_nexthop = false;
+	bool path_valid = false;
+
+	if (safi == SAFI_UNICAST && path->sub_type == BGP_ROUTE_IMPORTED
+	    && path->extra && path->extra->num_labels
+	    && (path->attr->evpn_overlay.type
+		!= OVERLAY_INDEX_GATEWAY_IP)) {
+		bnc_is_valid_nexthop = bgp_isvalid_labeled_nexthop(bnc) ? true
+									: false;
+	} else {
+		if (bgp_update_martian_nexthop(bnc->bgp, afi, safi, path->type,
+					       path->sub_type, path->attr,
+					       dest)) {
+			if (BGP_DEBUG(nht, NHT))
+				zlog_debug(
+					"%s: prefix %pBD (vrf %s), ignoring path due to martian or self-next-hop",
+					__func__, dest, bgp_path->name);
+		} else
+			bnc_is_valid_nexthop =
+				bgp_isvalid_nexthop(bnc) ? true : false;
 	}
 
-	LIST_FOREACH (path, &(bnc->paths), nh_thread) {
-		if (!(path->type == ZEBRA_ROUTE_BGP
-		      && ((path->sub_type == BGP_ROUTE_NORMAL)
-			  || (path->sub_type == BGP_ROUTE_STATIC)
-			  || (path->sub_type == BGP_ROUTE_IMPORTED))))
-			continue;
+	if (BGP_DEBUG(nht, NHT)) {
+		char buf1[RD_ADDRSTRLEN];
 
-		dest = path->net;
-		assert(dest && bgp_dest_table(dest));
-		p = bgp_dest_get_prefix(dest);
-		afi = family2afi(p->family);
-		table = bgp_dest_table(dest);
-		safi = table->safi;
+		if (dest->pdest) {
+			prefix_rd2str((struct prefix_rd *)bgp_dest_get_prefix(dest->pdest),
+				buf1, sizeof(buf1));
+			zlog_debug(
+				"... eval path %d/%d %pBD RD %s %s flags 0x%x",
+				afi, safi, dest, buf1,
+				bgp_path->name_pretty, path->flags);
+		} else
+			zlog_debug(
+				"... eval path %d/%d %pBD %s flags 0x%x",
+				afi, safi, dest, bgp_path->name_pretty,
+				path->flags);
+	}
 
-		/*
-		 * handle routes from other VRFs (they can have a
-		 * nexthop in THIS VRF). bgp_path is the bgp instance
-		 * that owns the route referencing this nexthop.
-		 */
-		bgp_path = table->bgp;
+	/* Skip paths marked for removal or as history. */
+	if (CHECK_FLAG(path->flags, BGP_PATH_REMOVED)
+	    || CHECK_FLAG(path->flags, BGP_PATH_HISTORY))
+		return;
 
-		/*
-		 * Path becomes valid/invalid depending on whether the nexthop
-		 * reachable/unreachable.
-		 *
-		 * In case of unicast routes that were imported from vpn
-		 * and that have labels, they are valid only if there are
-		 * nexthops with labels
-		 *
-		 * If the nexthop is EVPN gateway-IP,
-		 * do not check for a valid label.
-		 */
+	/* Copy the metric to the path. Will be used for bestpath
+	 * computation */
+	if (bgp_isvalid_nexthop(bnc) && bnc->metric)
+		(bgp_path_info_extra_get(path))->igpmetric = bnc->metric;
+	else if (path->extra)
+		path->extra->igpmetric = 0;
 
-		bool bnc_is_valid_nexthop = false;
-		bool path_valid = false;
+	if (bnc->eval_pic && dest->nhg_id && path->attr->srte_color == 0
+	    && !!CHECK_FLAG(path->flags, BGP_PATH_VALID)
+		       == bnc_is_valid_nexthop)
+		return;
 
-		if (safi == SAFI_UNICAST && path->sub_type == BGP_ROUTE_IMPORTED
-		    && path->extra && path->extra->num_labels
-		    && (path->attr->evpn_overlay.type
-			!= OVERLAY_INDEX_GATEWAY_IP)) {
-			bnc_is_valid_nexthop =
-				bgp_isvalid_labeled_nexthop(bnc) ? true : false;
+	if (CHECK_FLAG(bnc->eval_change_flags, BGP_NEXTHOP_METRIC_CHANGED)
+	    || CHECK_FLAG(bnc->eval_change_flags, BGP_NEXTHOP_CHANGED)
+	    || path->attr->srte_color != 0)
+		SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
+
+	path_valid = CHECK_FLAG(path->flags, BGP_PATH_VALID);
+	if (path_valid != bnc_is_valid_nexthop) {
+		if (path_valid) {
+			/* No longer valid, clear flag; also for EVPN
+			 * routes, unimport from VRFs if needed.
+			 */
+			bgp_aggregate_decrement(bgp_path, p, path, afi, safi);
+			bgp_path_info_unset_flag(dest, path, BGP_PATH_VALID);
+			if (safi == SAFI_EVPN &&
+			    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
+				bgp_evpn_unimport_route(bgp_path,
+					afi, safi, bgp_dest_get_prefix(dest), path);
 		} else {
-			if (bgp_update_martian_nexthop(
-				    bnc->bgp, afi, safi, path->type,
-				    path->sub_type, path->attr, dest)) {
-				if (BGP_DEBUG(nht, NHT))
-					zlog_debug(
-						"%s: prefix %pBD (vrf %s), ignoring path due to martian or self-next-hop",
-						__func__, dest, bgp_path->name);
-			} else
-				bnc_is_valid_nexthop =
-					bgp_isvalid_nexthop(bnc) ? true : false;
+			/* Path becomes valid, set flag; also for EVPN
+			 * routes, import from VRFs if needed.
+			 */
+			bgp_path_info_set_flag(dest, path, BGP_PATH_VALID);
+			bgp_aggregate_increment(bgp_path, p, path, afi, safi);
+			if (safi == SAFI_EVPN &&
+			    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
+				bgp_evpn_import_route(bgp_path,
+					afi, safi, bgp_dest_get_prefix(dest), path);
 		}
+	}
 
-		if (BGP_DEBUG(nht, NHT)) {
-			char buf1[RD_ADDRSTRLEN];
+	bgp_process(bgp_path, dest, afi, safi);
+}
 
-			if (dest->pdest) {
-				prefix_rd2str((struct prefix_rd *)bgp_dest_get_prefix(dest->pdest),
-					buf1, sizeof(buf1));
-				zlog_debug(
-					"... eval path %d/%d %pBD RD %s %s flags 0x%x",
-					afi, safi, dest, buf1,
-					bgp_path->name_pretty, path->flags);
-			} else
-				zlog_debug(
-					"... eval path %d/%d %pBD %s flags 0x%x",
-					afi, safi, dest, bgp_path->name_pretty,
-					path->flags);
-		}
+/* Nexthops with paths left to evaluate, in the order of their updates */
+DECLARE_DLIST(bgp_nht_eval, struct bgp_nexthop_cache, eval_entry);
+
+static struct bgp_nht_eval_head bgp_nht_eval_queue =
+	INIT_DLIST(bgp_nht_eval_queue);
+static struct thread *t_bgp_nht_eval;
+
+/* Paths evaluated in one run of the background evaluation */
+#define BGP_NHT_EVAL_MAX_PATHS 10000
 
-		/* Skip paths marked for removal or as history. */
-		if (CHECK_FLAG(path->flags, BGP_PATH_REMOVED)
-		    || CHECK_FLAG(path->flags, BGP_PATH_HISTORY))
+static void bgp_nht_eval_done(struct bgp_nexthop_cache *bnc)
+{
+	bgp_nht_eval_del(&bgp_nht_eval_queue, bnc);
+	bnc->eval_queued = false;
+	bnc->eval_next = NULL;
+	bnc->eval_change_flags = 0;
+
+	if (!bgp_nht_eval_count(&bgp_nht_eval_queue))
+		THREAD_OFF(t_bgp_nht_eval);
+}
+
+static void bgp_nht_eval_task(struct thread *thread)
+{
+	struct bgp_nexthop_cache *bnc;
+	struct bgp_path_info *path;
+	unsigned int count = 0;
+
+	/* evaluating a path may free other paths, and bnc with its last
+	 * path; both are taken off the cursor and the queue then
+	 */
+	while ((bnc = bgp_nht_eval_first(&bgp_nht_eval_queue))) {
+		path = bnc->eval_next;
+		if (!path) {
+			if (BGP_DEBUG(nht, NHT))
+				zlog_debug("%s: %pFX(%d)(%u)(%s) done", __func__,
+					   &bnc->prefix, bnc->ifindex,
+					   bnc->srte_color,
+					   bnc->bgp->name_pretty);
+			bgp_nht_eval_done(bnc);
 			continue;
+		}
 
-		/* Copy the metric to the path. Will be used for bestpath
-		 * computation */
-		if (bgp_isvalid_nexthop(bnc) && bnc->metric)
-			(bgp_path_info_extra_get(path))->igpmetric =
-				bnc->metric;
-		else if (path->extra)
-			path->extra->igpmetric = 0;
-
-		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED)
-		    || CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED)
-		    || path->attr->srte_color != 0)
-			SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
-
-		path_valid = CHECK_FLAG(path->flags, BGP_PATH_VALID);
-		if (path_valid != bnc_is_valid_nexthop) {
-			if (path_valid) {
-				/* No longer valid, clear flag; also for EVPN
-				 * routes, unimport from VRFs if needed.
-				 */
-				bgp_aggregate_decrement(bgp_path, p, path, afi,
-							safi);
-				bgp_path_info_unset_flag(dest, path,
-							 BGP_PATH_VALID);
-				if (safi == SAFI_EVPN &&
-				    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
-					bgp_evpn_unimport_route(bgp_path,
-						afi, safi, bgp_dest_get_prefix(dest), path);
-			} else {
-				/* Path becomes valid, set flag; also for EVPN
-				 * routes, import from VRFs if needed.
-				 */
-				bgp_path_info_set_flag(dest, path,
-						       BGP_PATH_VALID);
-				bgp_aggregate_increment(bgp_path, p, path, afi,
-							safi);
-				if (safi == SAFI_EVPN &&
-				    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
-					bgp_evpn_import_route(bgp_path,
-						afi, safi, bgp_dest_get_prefix(dest), path);
-			}
+		if (count++ == BGP_NHT_EVAL_MAX_PATHS) {
+			thread_add_event(bm->master, bgp_nht_eval_task, NULL, 0,
+					 &t_bgp_nht_eval);
+			return;
 		}
 
-		bgp_process(bgp_path, dest, afi, safi);
+		bnc->eval_next = LIST_NEXT(path, nh_thread);
+		bgp_nht_eval_path(bnc, path);
 	}
+}
+
+void bgp_nht_eval_cancel(struct bgp_nexthop_cache *bnc)
+{
+	if (bnc->eval_queued)
+		bgp_nht_eval_done(bnc);
+}
+
+/**
+ * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
+ *  The paths are evaluated in the background, a few thousand at a time.
+ *  An update for a nexthop that is still being evaluated restarts its
+ *  evaluation, for all updates since the last complete one.
+ * ARGUMENTS:
+ *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
+ * RETURNS:
+ *   void.
+ */
+void evaluate_paths(struct bgp_nexthop_cache *bnc)
+{
+	struct peer *peer = (struct peer *)bnc->nht_info;
+
+	if (BGP_DEBUG(nht, NHT)) {
+		char bnc_buf[BNC_FLAG_DUMP_SIZE];
+		char chg_buf[BNC_FLAG_DUMP_SIZE];
+
+		zlog_debug(
+			"NH update for %pFX(%d)(%u)(%s) - flags %s chgflags %s- evaluate paths%s",
+			&bnc->prefix, bnc->ifindex, bnc->srte_color,
+			bnc->bgp->name_pretty,
+			bgp_nexthop_dump_bnc_flags(bnc, bnc_buf,
+						   sizeof(bnc_buf)),
+			bgp_nexthop_dump_bnc_change_flags(bnc, chg_buf,
+							  sizeof(bnc_buf)),
+			bnc->eval_queued ? " (restart)" : "");
+	}
+
+	bnc->eval_change_flags |= bnc->change_flags;
+
+	/*
+	 * If only what the nexthop resolves to changed, updating the shared
+	 * nexthop groups using it is all zebra needs for the routes
+	 * installed with them.
+	 */
+	bnc->eval_pic = bgp_nhg_bnc_update(bnc)
+			&& bnc->eval_change_flags == BGP_NEXTHOP_CHANGED;
+
+	bnc->eval_next = LIST_FIRST(&(bnc->paths));
+	if (bnc->eval_queued || bnc->eval_next) {
+		if (!bnc->eval_queued) {
+			bnc->eval_queued = true;
+			bgp_nht_eval_add_tail(&bgp_nht_eval_queue, bnc);
+		}
+		thread_add_event(bm->master, bgp_nht_eval_task, NULL, 0,
+				 &t_bgp_nht_eval);
+	} else
+		bnc->eval_change_flags = 0;
 
 	if (peer) {
 		int valid_nexthops = bgp_isvalid_nexthop(bnc);
@@ -1187,6 +1277,8 @@ void path_nh_map(struct bgp_path_info *path, struct bgp_nexthop_cache *bnc,
 		 bool make)
 {
 	if (path->nexthop) {
+		if (path->nexthop->eval_next == path)
+			path->nexthop->eval_next = LIST_NEXT(path, nh_thread);
 		LIST_REMOVE(path, nh_thread);
 		path->nexthop->path_count--;
 		path->nexthop = NULL;
@@ -64,6 +64,7 @@
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_trace.h"
+#include "bgpd/bgp_pipeline.h"
 
 DEFINE_HOOK(bgp_packet_dump,
 		(struct peer *peer, uint8_t type, bgp_size_t size,
@@ -75,6 +76,11 @@ DEFINE_HOOK(bgp_packet_send,
 			struct stream *s),
 		(peer, type, size, s));
 
+DEFINE_HOOK(bgp_update_send,
+		(struct peer *peer, afi_t afi, safi_t safi,
+			struct stream *head, struct stream *pkt),
+		(peer, afi, safi, head, pkt));
+
 /**
  * Sets marker and type fields for a BGP message.
  *
@@ -116,24 +122,65 @@ void bgp_packet_set_size(struct stream *s)
 	stream_putw_at(s, BGP_MARKER_SIZE, cp);
 }
 
+void bgp_obuf_shared_free(struct bgp_obuf_shared **sh)
+{
+	if (!*sh)
+		return;
+
+	bpacket_buf_put(&(*sh)->buf);
+	XFREE(MTYPE_BGP_OBUF_SHARED, *sh);
+}
+
 /*
- * Push a packet onto the beginning of the peer's output queue.
+ * Drop all shared packet remainders queued for output, to be used whenever
+ * peer->obuf is cleaned.
+ *
+ * Requires: peer->io_mtx
+ */
+void bgp_obuf_shared_flush(struct peer *peer)
+{
+	struct bgp_obuf_shared *sh;
+
+	while ((sh = bgp_obuf_shared_pop(&peer->obuf_shared)))
+		bgp_obuf_shared_free(&sh);
+}
+
+/*
+ * Push a packet onto the end of one of the peer's output queues, obuf or
+ * obuf_ctrl.  If 'pkt' is given, 's' is the start of it as returned by
+ * bpacket_reformat_for_peer() and the remainder is sent directly from the
+ * bpacket's buffer instead of being copied for each peer.
+ *
  * This function acquires the peer's write mutex before proceeding.
  */
-static void bgp_packet_add(struct peer *peer, struct stream *s)
+static void bgp_packet_queue(struct peer *peer, struct stream_fifo *fifo,
+			     struct stream *s, struct bpacket *pkt)
 {
+	struct bgp_obuf_shared *sh = NULL;
 	intmax_t delta;
 	uint32_t holdtime;
 
+	if (pkt && stream_get_endp(s) < stream_get_endp(pkt->buffer)) {
+		sh = XCALLOC(MTYPE_BGP_OBUF_SHARED, sizeof(*sh));
+		sh->head = s;
+		sh->buf = bpacket_buf_get(pkt);
+		sh->getp = stream_get_endp(s);
+	}
+
 	frr_with_mutex (&peer->io_mtx) {
 		/* if the queue is empty, reset the "last OK" timestamp to
 		 * now, otherwise if we write another packet immediately
 		 * after it'll get confused
 		 */
-		if (!stream_fifo_count_safe(peer->obuf))
+		if (!stream_fifo_head(peer->obuf)
+		    && !stream_fifo_head(peer->obuf_ctrl))
 			peer->last_sendq_ok = monotime(NULL);
+		if (!peer->pipe->tx_since)
+			peer->pipe->tx_since = bgp_pipe_now();
 
-		stream_fifo_push(peer->obuf, s);
+		stream_fifo_push(fifo, s);
+		if (sh)
+			bgp_obuf_shared_add_tail(&peer->obuf_shared, sh);
 
 		delta = monotime(NULL) - peer->last_sendq_ok;
 		holdtime = atomic_load_explicit(&peer->holdtime,
@@ -166,6 +213,26 @@ static void bgp_packet_add(struct peer *peer, struct stream *s)
 	}
 }
 
+static void bgp_packet_add_shared(struct peer *peer, struct stream *s,
+				  struct bpacket *pkt)
+{
+	bgp_packet_queue(peer, peer->obuf, s, pkt);
+}
+
+static void bgp_packet_add(struct peer *peer, struct stream *s)
+{
+	bgp_packet_queue(peer, peer->obuf, s, NULL);
+}
+
+/*
+ * For packets that don't have to stay in order with UPDATEs; bgp_write()
+ * moves them ahead of what waits on obuf at the next packet boundary.
+ */
+static void bgp_packet_add_ctrl(struct peer *peer, struct stream *s)
+{
+	bgp_packet_queue(peer, peer->obuf_ctrl, s, NULL);
+}
+
 static struct stream *bgp_update_packet_eor(struct peer *peer, afi_t afi,
 					    safi_t safi)
 {
@@ -420,6 +487,34 @@ static void bgp_write_proceed_actions(struct peer *peer)
 	}
 }
 
+/*
+ * Builds the subgroup's next packet.  WITHDRAWs go first, but after 'quanta'
+ * of them in a row announcements get a turn, so a steady stream of
+ * withdrawals can't hold them back indefinitely.  Returns false if the
+ * announcements are being built in the background instead.
+ */
+static bool bgp_subgrp_build_packet(struct update_subgroup *subgrp,
+				    uint32_t quanta)
+{
+	struct bpacket *pkt = NULL;
+
+	if (subgrp->withdraw_run < quanta)
+		pkt = subgroup_withdraw_packet(subgrp);
+	if (pkt && pkt->buffer) {
+		subgrp->withdraw_run++;
+		return true;
+	}
+
+	subgrp->withdraw_run = 0;
+	if (subgroup_update_packet_defer(subgrp))
+		return false;
+
+	/* nothing to announce after all */
+	if (!subgroup_update_packet(subgrp) && subgroup_withdraw_packet(subgrp))
+		subgrp->withdraw_run = 1;
+	return true;
+}
+
 /*
  * Generate advertisement information (withdraws, updates, EOR) from each
  * update group a peer belongs to, encode this information into packets, and
@@ -432,13 +527,14 @@ void bgp_generate_updgrp_packets(struct thread *thread)
 	struct stream *s;
 	struct peer_af *paf;
 	struct bpacket *next_pkt;
-	uint32_t wpq;
+	uint32_t wpq, wdq;
 	uint32_t generated = 0;
 	afi_t afi;
 	safi_t safi;
 
 	wpq = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 				   memory_order_relaxed);
+	wdq = peer->bgp->withdraw_quanta;
 
 	/*
 	 * The code beyond this part deals with update packets, proceed only
@@ -470,14 +566,12 @@ void bgp_generate_updgrp_packets(struct thread *thread)
 
 			/*
 			 * Try to generate a packet for the peer if we are at
-			 * the end of the list. Always try to push out
-			 * WITHDRAWs first.
+			 * the end of the list.
 			 */
 			if (!next_pkt || !next_pkt->buffer) {
-				next_pkt = subgroup_withdraw_packet(
-					PAF_SUBGRP(paf));
-				if (!next_pkt || !next_pkt->buffer)
-					subgroup_update_packet(PAF_SUBGRP(paf));
+				if (!bgp_subgrp_build_packet(PAF_SUBGRP(paf),
+							     wdq))
+					continue;
 				next_pkt = paf->next_pkt_to_send;
 			}
 
@@ -571,7 +665,11 @@ void bgp_generate_updgrp_packets(struct thread *thread)
 			 * packet with appropriate attributes from peer
 			 * and advance peer */
 			s = bpacket_reformat_for_peer(next_pkt, paf);
-			bgp_packet_add(peer, s);
+			if (s) {
+				hook_call(bgp_update_send, peer, afi, safi, s,
+					  next_pkt->buffer);
+				bgp_packet_add_shared(peer, s, next_pkt);
+			}
 			bpacket_queue_advance_peer(paf);
 		}
 	} while (s && (++generated < wpq));
@@ -582,6 +680,54 @@ void bgp_generate_updgrp_packets(struct thread *thread)
 	bgp_write_proceed_actions(peer);
 }
 
+/*
+ * Writes a KEEPALIVE straight to the socket if nothing else is waiting on
+ * obuf, so it doesn't wait for the I/O pthread.  What doesn't fit into the
+ * socket buffer goes on obuf.  Errors are left for the I/O pthread to find.
+ *
+ * Returns false if the packet still has to be queued.
+ */
+static bool bgp_keepalive_send_direct(struct peer *peer, struct stream *s)
+{
+	size_t len = stream_get_endp(s);
+	bool sent = false, queued = false;
+	ssize_t num;
+
+	frr_with_mutex (&peer->io_mtx) {
+		if (peer->fd < 0 || stream_fifo_head(peer->obuf)
+		    || stream_fifo_head(peer->obuf_ctrl))
+			num = -1;
+		else
+			num = write(peer->fd, STREAM_DATA(s), len);
+
+		if (num == (ssize_t)len)
+			sent = true;
+		else if (num > 0) {
+			stream_forward_getp(s, num);
+			if (!peer->pipe->tx_since)
+				peer->pipe->tx_since = bgp_pipe_now();
+			stream_fifo_push(peer->obuf, s);
+			queued = true;
+		}
+	}
+
+	if (sent) {
+		atomic_fetch_add_explicit(&peer->keepalive_out, 1,
+					  memory_order_relaxed);
+		atomic_store_explicit(&peer->last_write, monotime(NULL),
+				      memory_order_relaxed);
+		stream_free(s);
+		return true;
+	}
+
+	if (queued) {
+		bgp_writes_on(peer);
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * Creates a BGP Keepalive packet and appends it to the peer's output queue.
  */
@@ -603,8 +749,11 @@ void bgp_keepalive_send(struct peer *peer)
 	if (bgp_debug_keepalive(peer))
 		zlog_debug("%s sending KEEPALIVE", peer->host);
 
-	/* Add packet to the peer. */
-	bgp_packet_add(peer, s);
+	if (bgp_keepalive_send_direct(peer, s))
+		return;
+
+	/* Add packet to the peer, ahead of any UPDATEs. */
+	bgp_packet_add_ctrl(peer, s);
 
 	bgp_writes_on(peer);
 }
@@ -912,6 +1061,8 @@ void bgp_notify_send_with_data(struct peer *peer, uint8_t code,
 
 	/* wipe output buffer */
 	stream_fifo_clean(peer->obuf);
+	stream_fifo_clean(peer->obuf_ctrl);
+	bgp_obuf_shared_flush(peer);
 
 	/*
 	 * If possible, store last packet for debugging purposes. This check is
@@ -2028,9 +2179,6 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 
 	peer->update_time = monotime(NULL);
 
-	/* Notify BGP Conditional advertisement scanner process */
-	peer->advmap_table_change = true;
-
 	return Receive_UPDATE_message;
 }
 
@@ -2763,6 +2911,7 @@ void bgp_process_packet(struct thread *thread)
 	uint32_t rpkt_quanta_old; // how many packets to read
 	int fsm_update_result;    // return code of bgp_event_update()
 	int mprc;		  // message processing return code
+	int64_t rx_since, update_since;
 
 	peer = THREAD_ARG(thread);
 	rpkt_quanta_old = atomic_load_explicit(&peer->bgp->rpkt_quanta,
@@ -2782,7 +2931,14 @@ void bgp_process_packet(struct thread *thread)
 
 		frr_with_mutex (&peer->io_mtx) {
 			peer->curr = stream_fifo_pop(peer->ibuf);
+			if (peer->curr)
+				peer->curr_preparse =
+					bgp_attr_preparse_pop(peer, peer->curr);
+			rx_since = peer->pipe->rx_since;
+			peer->pipe->rx_since = 0;
 		}
+		bgp_pipe_record(peer, AFI_UNSPEC, SAFI_UNSPEC,
+				BGP_PIPE_RX_QUEUE, rx_since);
 
 		if (peer->curr == NULL) // no packets to process, hmm...
 			return;
@@ -2819,12 +2975,15 @@ void bgp_process_packet(struct thread *thread)
 			atomic_fetch_add_explicit(&peer->update_in, 1,
 						  memory_order_relaxed);
 			peer->readtime = monotime(NULL);
+			update_since = bgp_pipe_now();
 			mprc = bgp_update_receive(peer, size);
 			if (mprc == BGP_Stop)
 				flog_err(
 					EC_BGP_UPDATE_RCV,
 					"%s: BGP UPDATE receipt failed for peer: %s",
 					__func__, peer->host);
+			bgp_pipe_record(peer, AFI_UNSPEC, SAFI_UNSPEC,
+					BGP_PIPE_UPDATE, update_since);
 			break;
 		case BGP_MSG_NOTIFY:
 			frrtrace(2, frr_bgp, notification_process, peer, size);
@@ -2888,6 +3047,7 @@ void bgp_process_packet(struct thread *thread)
 		/* delete processed packet */
 		stream_free(peer->curr);
 		peer->curr = NULL;
+		bgp_attr_preparse_free(&peer->curr_preparse);
 		processed++;
 
 		/* Update FSM */
@@ -2909,10 +3069,13 @@ void bgp_process_packet(struct thread *thread)
 	    && fsm_update_result != FSM_PEER_STOPPED) {
 		frr_with_mutex (&peer->io_mtx) {
 			// more work to do, come back later
-			if (peer->ibuf->count > 0)
+			if (peer->ibuf->count > 0) {
+				if (!peer->pipe->rx_since)
+					peer->pipe->rx_since = bgp_pipe_now();
 				thread_add_event(
 					bm->master, bgp_process_packet, peer, 0,
 					&peer->t_process_packet);
+			}
 		}
 	}
 }
@@ -33,6 +33,14 @@ DECLARE_HOOK(bgp_packet_send,
 			struct stream *s),
 		(peer, type, size, s));
 
+/* an UPDATE queued for peer, made up of head and the rest of pkt (the
+ * update-group's packet) after it; pkt may be NULL if head is complete.
+ */
+DECLARE_HOOK(bgp_update_send,
+		(struct peer *peer, afi_t afi, safi_t safi,
+			struct stream *head, struct stream *pkt),
+		(peer, afi, safi, head, pkt));
+
 #define BGP_NLRI_LENGTH       1U
 #define BGP_TOTAL_ATTR_LEN    2U
 #define BGP_UNFEASIBLE_LEN    2U
@@ -41,6 +49,9 @@ DECLARE_HOOK(bgp_packet_send,
 #define REFRESH_IMMEDIATE 1
 #define REFRESH_DEFER     2
 
+/* WITHDRAW packets built in a row before announcements get a turn */
+#define BGP_WITHDRAW_QUANTA_DEFAULT 16U
+
 /* ORF Common part flag */
 #define ORF_COMMON_PART_ADD        0x00
 #define ORF_COMMON_PART_REMOVE     0x80
@@ -79,6 +90,10 @@ extern void bgp_check_update_delay(struct bgp *);
 extern int bgp_packet_set_marker(struct stream *s, uint8_t type);
 extern void bgp_packet_set_size(struct stream *s);
 
+struct bgp_obuf_shared;
+extern void bgp_obuf_shared_free(struct bgp_obuf_shared **sh);
+extern void bgp_obuf_shared_flush(struct peer *peer);
+
 extern void bgp_generate_updgrp_packets(struct thread *);
 extern void bgp_process_packet(struct thread *);
 
@@ -996,6 +996,9 @@ static void bgp_pbr_match_entry_free(void *arg)
 
 	bpme = (struct bgp_pbr_match_entry *)arg;
 
+	/* an add may still be queued, with a reference to it */
+	if (bpme->install_in_progress)
+		bgp_send_pbr_ipset_entry_flush();
 	if (bpme->installed) {
 		bgp_send_pbr_ipset_entry_match(bpme, false);
 		bpme->installed = false;
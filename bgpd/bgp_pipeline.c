@@ -0,0 +1,301 @@
+/* BGP per-peer pipeline latency statistics
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "json.h"
+#include "memory.h"
+#include "vty.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_pipeline.h"
+#include "bgpd/bgp_trace.h"
+#include "bgpd/bgp_vty.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_PIPE_STATS, "BGP pipeline statistics");
+
+int64_t bgp_pipe_process_since;
+
+static const struct {
+	const char *name;
+	const char *json;
+} bgp_pipe_stage_names[BGP_PIPE_STAGE_MAX] = {
+	[BGP_PIPE_RX_QUEUE] = {"rx-queue", "rxQueue"},
+	[BGP_PIPE_UPDATE] = {"update", "update"},
+	[BGP_PIPE_TX_QUEUE] = {"tx-queue", "txQueue"},
+	[BGP_PIPE_BESTPATH] = {"bestpath", "bestpath"},
+	[BGP_PIPE_ZEBRA] = {"zebra", "zebra"},
+	[BGP_PIPE_ADVERTISE] = {"advertise", "advertise"},
+};
+
+static unsigned int bgp_pipe_bucket(uint64_t usec)
+{
+	unsigned int e;
+
+	if (usec < BGP_PIPE_SUB)
+		return usec;
+	if (usec >> BGP_PIPE_MAX_BITS)
+		return BGP_PIPE_BUCKETS - 1;
+
+	e = 63 - __builtin_clzll(usec);
+	return (e - BGP_PIPE_SUB_BITS + 1) * BGP_PIPE_SUB
+	       + (usec >> (e - BGP_PIPE_SUB_BITS)) - BGP_PIPE_SUB;
+}
+
+/* highest value that goes into the bucket */
+static uint64_t bgp_pipe_bucket_top(unsigned int idx)
+{
+	unsigned int e, sub;
+
+	if (idx < BGP_PIPE_SUB)
+		return idx;
+
+	e = idx / BGP_PIPE_SUB + BGP_PIPE_SUB_BITS - 1;
+	sub = idx % BGP_PIPE_SUB;
+	return ((uint64_t)(BGP_PIPE_SUB + sub + 1) << (e - BGP_PIPE_SUB_BITS))
+	       - 1;
+}
+
+static void bgp_pipe_hist_add(struct bgp_pipe_hist *h, uint64_t usec)
+{
+	h->count++;
+	h->sum += usec;
+	if (usec > h->max)
+		h->max = usec;
+	h->bucket[bgp_pipe_bucket(usec)]++;
+}
+
+static uint64_t bgp_pipe_hist_pct(const struct bgp_pipe_hist *h,
+				  unsigned int pct)
+{
+	uint64_t want, seen = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+
+	want = (h->count * pct + 99) / 100;
+	for (i = 0; i < BGP_PIPE_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen >= want)
+			return MIN(bgp_pipe_bucket_top(i), h->max);
+	}
+	return h->max;
+}
+
+void bgp_pipe_peer_init(struct peer *peer)
+{
+	peer->pipe = XCALLOC(MTYPE_BGP_PIPE_STATS, sizeof(*peer->pipe));
+}
+
+void bgp_pipe_peer_free(struct peer *peer)
+{
+	afi_t afi;
+	safi_t safi;
+
+	if (!peer->pipe)
+		return;
+
+	for (afi = AFI_UNSPEC; afi < AFI_MAX; afi++)
+		for (safi = SAFI_UNSPEC; safi < SAFI_MAX; safi++)
+			XFREE(MTYPE_BGP_PIPE_STATS, peer->pipe->afi[afi][safi]);
+	XFREE(MTYPE_BGP_PIPE_STATS, peer->pipe);
+}
+
+void bgp_pipe_record(struct peer *peer, afi_t afi, safi_t safi,
+		     enum bgp_pipe_stage stage, int64_t since)
+{
+	struct bgp_pipe_stats *ps = peer->pipe;
+	struct bgp_pipe_hist *h;
+	int64_t usec;
+
+	if (!ps || !since)
+		return;
+
+	usec = bgp_pipe_now() - since;
+	if (usec < 0)
+		usec = 0;
+
+	if (stage < BGP_PIPE_AFI_STAGE) {
+		afi = AFI_UNSPEC;
+		safi = SAFI_UNSPEC;
+		h = &ps->peer[stage];
+	} else {
+		if (afi >= AFI_MAX || safi >= SAFI_MAX)
+			return;
+		if (!ps->afi[afi][safi])
+			ps->afi[afi][safi] = XCALLOC(
+				MTYPE_BGP_PIPE_STATS,
+				BGP_PIPE_AFI_STAGES * sizeof(struct bgp_pipe_hist));
+		h = &ps->afi[afi][safi][stage - BGP_PIPE_AFI_STAGE];
+	}
+
+	bgp_pipe_hist_add(h, usec);
+
+	frrtrace(5, frr_bgp, pipeline_latency, peer,
+		 bgp_pipe_stage_names[stage].name, afi, safi, usec);
+}
+
+static void bgp_pipe_show_hist(struct vty *vty, json_object *json,
+			       enum bgp_pipe_stage stage,
+			       const struct bgp_pipe_hist *h)
+{
+	uint64_t avg = h->count ? h->sum / h->count : 0;
+	json_object *json_stage;
+
+	if (json) {
+		json_stage = json_object_new_object();
+		json_object_int_add(json_stage, "count", h->count);
+		json_object_int_add(json_stage, "avgUsec", avg);
+		json_object_int_add(json_stage, "p50Usec",
+				    bgp_pipe_hist_pct(h, 50));
+		json_object_int_add(json_stage, "p90Usec",
+				    bgp_pipe_hist_pct(h, 90));
+		json_object_int_add(json_stage, "p99Usec",
+				    bgp_pipe_hist_pct(h, 99));
+		json_object_int_add(json_stage, "maxUsec", h->max);
+		json_object_object_add(json, bgp_pipe_stage_names[stage].json,
+				       json_stage);
+		return;
+	}
+
+	vty_out(vty, "  %-12s %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+		" %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+		bgp_pipe_stage_names[stage].name, h->count, avg,
+		bgp_pipe_hist_pct(h, 50), bgp_pipe_hist_pct(h, 90),
+		bgp_pipe_hist_pct(h, 99), h->max);
+}
+
+static void bgp_pipe_show_header(struct vty *vty, const char *title)
+{
+	vty_out(vty, "%s\n", title);
+	vty_out(vty, "  %-12s %10s %10s %10s %10s %10s %10s\n", "Stage",
+		"Count", "Avg", "p50", "p90", "p99", "Max");
+}
+
+static int bgp_pipe_show(struct vty *vty, struct peer *peer, bool uj)
+{
+	struct bgp_pipe_stats *ps = peer->pipe;
+	struct bgp_pipe_hist tx;
+	json_object *json = NULL, *json_afi;
+	enum bgp_pipe_stage stage;
+	afi_t afi;
+	safi_t safi;
+
+	if (uj) {
+		json = json_object_new_object();
+		json_object_string_add(json, "peer", peer->host);
+	} else
+		vty_out(vty, "BGP neighbor %s, latency in microseconds\n\n",
+			peer->host);
+
+	if (!ps) {
+		if (uj)
+			vty_json(vty, json);
+		return CMD_SUCCESS;
+	}
+
+	frr_with_mutex (&peer->io_mtx) {
+		tx = ps->peer[BGP_PIPE_TX_QUEUE];
+	}
+
+	if (!uj)
+		bgp_pipe_show_header(vty, "Packets:");
+	for (stage = 0; stage < BGP_PIPE_AFI_STAGE; stage++)
+		bgp_pipe_show_hist(vty, json, stage,
+				   stage == BGP_PIPE_TX_QUEUE
+					   ? &tx
+					   : &ps->peer[stage]);
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		if (!ps->afi[afi][safi])
+			continue;
+
+		if (uj) {
+			json_afi = json_object_new_object();
+			json_object_object_add(json,
+					       get_afi_safi_str(afi, safi,
+								true),
+					       json_afi);
+		} else {
+			json_afi = NULL;
+			vty_out(vty, "\n");
+			bgp_pipe_show_header(vty,
+					     get_afi_safi_str(afi, safi,
+							      false));
+		}
+
+		for (stage = BGP_PIPE_AFI_STAGE; stage < BGP_PIPE_STAGE_MAX;
+		     stage++)
+			bgp_pipe_show_hist(
+				vty, json_afi, stage,
+				&ps->afi[afi][safi][stage - BGP_PIPE_AFI_STAGE]);
+	}
+
+	if (uj)
+		vty_json(vty, json);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_bgp_neighbor_pipeline_stats, show_bgp_neighbor_pipeline_stats_cmd,
+      "show bgp [<view|vrf> VIEWVRFNAME] neighbors <A.B.C.D|X:X::X:X|WORD> pipeline-stats [json]",
+      SHOW_STR BGP_STR BGP_INSTANCE_HELP_STR
+      "Detailed information on TCP and BGP neighbor connections\n"
+      "Neighbor to display information about\n"
+      "Neighbor to display information about\n"
+      "Neighbor on BGP configured interface\n"
+      "Latency of the packet and route processing stages\n" JSON_STR)
+{
+	bool uj = use_json(argc, argv);
+	struct bgp *bgp = NULL;
+	struct peer *peer;
+	int idx = 0;
+
+	if (argv_find(argv, argc, "view", &idx)
+	    || argv_find(argv, argc, "vrf", &idx)) {
+		const char *name = argv[idx + 1]->arg;
+
+		if (strmatch(name, VRF_DEFAULT_NAME))
+			bgp = bgp_get_default();
+		else
+			bgp = bgp_lookup_by_name(name);
+		if (!bgp) {
+			if (uj)
+				vty_out(vty, "{}\n");
+			else
+				vty_out(vty, "%% No such BGP instance %s\n",
+					name);
+			return CMD_WARNING;
+		}
+	}
+
+	argv_find(argv, argc, "neighbors", &idx);
+	peer = peer_lookup_in_view(vty, bgp, argv[idx + 1]->arg, uj);
+	if (!peer)
+		return CMD_WARNING;
+
+	return bgp_pipe_show(vty, peer, uj);
+}
+
+void bgp_pipe_vty_init(void)
+{
+	install_element(VIEW_NODE, &show_bgp_neighbor_pipeline_stats_cmd);
+}
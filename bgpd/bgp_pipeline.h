@@ -0,0 +1,112 @@
+/* BGP per-peer pipeline latency statistics
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_PIPELINE_H
+#define _FRR_BGP_PIPELINE_H
+
+#include "monotime.h"
+
+/*
+ * Where the time goes between a packet arriving and its routes going out
+ * again.  Each stage has a latency histogram per peer; the route stages
+ * also per AFI/SAFI.  Route stages are counted for the peer of the best
+ * path (or of the path that was withdrawn).
+ */
+enum bgp_pipe_stage {
+	/* read by the I/O pthread, until processing starts */
+	BGP_PIPE_RX_QUEUE,
+	/* processing one UPDATE */
+	BGP_PIPE_UPDATE,
+	/* queued on obuf, until written to the socket */
+	BGP_PIPE_TX_QUEUE,
+
+	/* queued for best path selection, until done */
+	BGP_PIPE_BESTPATH,
+	/* queued for best path selection, until handed to zebra */
+	BGP_PIPE_ZEBRA,
+	/* queued on a subgroup, until in an UPDATE to the peer */
+	BGP_PIPE_ADVERTISE,
+
+	BGP_PIPE_STAGE_MAX,
+};
+
+/* stages before this one are per peer, the others per AFI/SAFI */
+#define BGP_PIPE_AFI_STAGE BGP_PIPE_BESTPATH
+#define BGP_PIPE_AFI_STAGES (BGP_PIPE_STAGE_MAX - BGP_PIPE_AFI_STAGE)
+
+/*
+ * Log-linear buckets in microseconds, HDR histogram style: 8 buckets per
+ * power of 2, so a bucket is within 12.5% of the values in it.  Values
+ * above 2^32 usec (71 minutes) go into the last bucket.
+ */
+#define BGP_PIPE_SUB_BITS 3
+#define BGP_PIPE_SUB (1 << BGP_PIPE_SUB_BITS)
+#define BGP_PIPE_MAX_BITS 32
+#define BGP_PIPE_BUCKETS                                                       \
+	((BGP_PIPE_MAX_BITS - BGP_PIPE_SUB_BITS + 1) * BGP_PIPE_SUB)
+
+struct bgp_pipe_hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint32_t bucket[BGP_PIPE_BUCKETS];
+};
+
+struct bgp_pipe_stats {
+	/* BGP_PIPE_TX_QUEUE is written by the I/O pthread, under io_mtx */
+	struct bgp_pipe_hist peer[BGP_PIPE_AFI_STAGE];
+	/* BGP_PIPE_AFI_STAGES each, allocated when first used */
+	struct bgp_pipe_hist *afi[AFI_MAX][SAFI_MAX];
+
+	/* since when the head of ibuf / obuf has been waiting (queued, or
+	 * the last write), 0 if there's nothing; both guarded by io_mtx
+	 */
+	int64_t rx_since;
+	int64_t tx_since;
+};
+
+/*
+ * Time the process queue item being worked on was created, 0 outside of
+ * the process queue.
+ */
+extern int64_t bgp_pipe_process_since;
+
+static inline int64_t bgp_pipe_now(void)
+{
+	struct timeval tv;
+
+	monotime(&tv);
+	return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+extern void bgp_pipe_peer_init(struct peer *peer);
+extern void bgp_pipe_peer_free(struct peer *peer);
+
+/*
+ * Accounts a stage that started at since (bgp_pipe_now() time).  afi and
+ * safi are ignored for the per-peer stages.  BGP_PIPE_TX_QUEUE is to be
+ * recorded with the peer's io_mtx held, the rest on the main pthread.
+ */
+extern void bgp_pipe_record(struct peer *peer, afi_t afi, safi_t safi,
+			    enum bgp_pipe_stage stage, int64_t since);
+
+extern void bgp_pipe_vty_init(void);
+
+#endif /* _FRR_BGP_PIPELINE_H */
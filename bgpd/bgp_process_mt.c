@@ -0,0 +1,93 @@
+/* BGP route processing worker pthreads.
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "taskpool.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_process_mt.h"
+
+/*
+ * Fork/join on a taskpool.  Only one job is ever in flight since the main
+ * pthread blocks in bgp_process_mt_run() until all shards are done.
+ */
+static struct bgp_process_mt {
+	/* runs shards 1..n-1, NULL for a single shard */
+	struct taskpool *pool;
+
+	/* current job; written before the shards are submitted */
+	bgp_process_mt_fn fn;
+	void *arg;
+	unsigned int nshards;
+} pmt;
+
+unsigned int bgp_process_mt_shards(void)
+{
+	return bm->process_threads ? bm->process_threads : 1;
+}
+
+static void bgp_process_mt_shard(void *arg)
+{
+	unsigned int shard = (uintptr_t)arg;
+
+	pmt.fn(pmt.arg, shard, pmt.nshards);
+}
+
+void bgp_process_mt_run(bgp_process_mt_fn fn, void *arg)
+{
+	unsigned int nshards = bgp_process_mt_shards();
+	struct taskpool_group grp;
+	unsigned int i;
+
+	if ((pmt.pool ? taskpool_nworkers(pmt.pool) : 0) != nshards - 1) {
+		taskpool_free(&pmt.pool);
+		if (nshards > 1)
+			pmt.pool = taskpool_new("bgpd_proc", nshards - 1);
+	}
+
+	nshards = pmt.pool ? taskpool_nworkers(pmt.pool) + 1 : 1;
+	if (nshards == 1) {
+		fn(arg, 0, 1);
+		return;
+	}
+
+	pmt.fn = fn;
+	pmt.arg = arg;
+	pmt.nshards = nshards;
+
+	taskpool_group_init(&grp);
+	for (i = 1; i < nshards; i++)
+		taskpool_submit(pmt.pool, &grp, bgp_process_mt_shard,
+				(void *)(uintptr_t)i);
+
+	fn(arg, 0, nshards);
+
+	taskpool_group_wait(pmt.pool, &grp);
+	taskpool_group_fini(&grp);
+
+	pmt.fn = NULL;
+	pmt.arg = NULL;
+}
+
+void bgp_process_mt_finish(void)
+{
+	taskpool_free(&pmt.pool);
+}
@@ -0,0 +1,66 @@
+/* BGP route processing worker pthreads.
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_PROCESS_MT_H
+#define _FRR_BGP_PROCESS_MT_H
+
+/* Default and maximum number of pthreads used for route processing.
+ * A value of 1 means everything runs on the main pthread.
+ */
+#define BGP_PROCESS_THREADS_DEF 1
+#define BGP_PROCESS_THREADS_MAX 64
+
+/* Smallest work queue batch that is worth spreading across pthreads. */
+#define BGP_PROCESS_MT_MIN_DESTS 256
+
+/*
+ * Callback run for one shard of a parallel job.  'shard' is in
+ * [0, nshards).  Shard 0 always runs on the calling (main) pthread.
+ *
+ * Shard callbacks must not modify any state shared with other shards and
+ * must not schedule tasks on the main thread_master; they should only read
+ * BGP state and write per-shard results.
+ */
+typedef void (*bgp_process_mt_fn)(void *arg, unsigned int shard,
+				  unsigned int nshards);
+
+/*
+ * Number of shards a parallel job is currently split into.  This is the
+ * configured "bgp process-threads" value.
+ */
+extern unsigned int bgp_process_mt_shards(void);
+
+/*
+ * Runs 'fn' once per shard, shards 1..n-1 on the worker pthreads and shard
+ * 0 on the calling pthread, and returns once all of them are done.
+ *
+ * The main pthread is blocked for the duration, so shard callbacks may
+ * safely read BGP data structures that are otherwise only modified by the
+ * main pthread.
+ *
+ * The worker taskpool is (re)started lazily here to match the configured
+ * thread count.
+ */
+extern void bgp_process_mt_run(bgp_process_mt_fn fn, void *arg);
+
+/* Stops and releases all worker pthreads. */
+extern void bgp_process_mt_finish(void);
+
+#endif /* _FRR_BGP_PROCESS_MT_H */
@@ -82,6 +82,59 @@ int bgp_regexec(regex_t *regex, struct aspath *aspath)
 	return regexec(regex, aspath->str, 0, NULL, 0);
 }
 
+static const char bgp_regex_delim[] = ",{}() ";
+
+bool bgp_regex_fast_compile(const char *str, struct bgp_regex_fast *fast)
+{
+	size_t len = strlen(str);
+
+	memset(fast, 0, sizeof(*fast));
+
+	if (len && (str[0] == '^' || str[0] == '_')) {
+		fast->before = str[0];
+		str++;
+		len--;
+	}
+	if (len && (str[len - 1] == '$' || str[len - 1] == '_')) {
+		fast->after = str[len - 1];
+		len--;
+	}
+
+	if (!len || len >= sizeof(fast->token)
+	    || strspn(str, "0123456789") < len)
+		return false;
+
+	memcpy(fast->token, str, len);
+	fast->len = len;
+	return true;
+}
+
+bool bgp_regex_fast_match(const struct bgp_regex_fast *fast, const char *str)
+{
+	const char *pos, *end;
+
+	for (pos = str; (pos = strstr(pos, fast->token)); pos++) {
+		/* '_' is (^|[,{}() ]|$), only ^ can come before a number */
+		if (fast->before == '^' && pos != str)
+			break;
+		if (fast->before == '_' && pos != str
+		    && !strchr(bgp_regex_delim, pos[-1]))
+			continue;
+
+		/* ... and only $ after it */
+		end = pos + fast->len;
+		if (fast->after == '$' && *end)
+			continue;
+		if (fast->after == '_' && *end
+		    && !strchr(bgp_regex_delim, *end))
+			continue;
+
+		return true;
+	}
+
+	return false;
+}
+
 void bgp_regex_free(regex_t *regex)
 {
 	regfree(regex);
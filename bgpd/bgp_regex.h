@@ -33,4 +33,22 @@ extern void bgp_regex_free(regex_t *regex);
 extern regex_t *bgp_regcomp(const char *str);
 extern int bgp_regexec(regex_t *regex, struct aspath *aspath);
 
+/*
+ * Most AS path filters are a single AS number, e.g. _65000_ or ^65000$.
+ * These are matched with a plain string scan instead of regexec(); the
+ * result is the same as for the regex from bgp_regcomp().
+ */
+struct bgp_regex_fast {
+	/* '^', '_' or 0 before, '$', '_' or 0 after the number */
+	char before, after;
+	/* 0 if the regex has to be used */
+	uint8_t len;
+	char token[11];
+};
+
+extern bool bgp_regex_fast_compile(const char *str,
+				   struct bgp_regex_fast *fast);
+extern bool bgp_regex_fast_match(const struct bgp_regex_fast *fast,
+				 const char *str);
+
 #endif /* _QUAGGA_BGP_REGEX_H */
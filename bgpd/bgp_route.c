@@ -74,6 +74,8 @@
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_rpki.h"
+#include "bgpd/bgp_process_mt.h"
+#include "bgpd/bgp_pipeline.h"
 
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/rfapi_backend.h"
@@ -88,6 +90,7 @@
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_flowspec_util.h"
 #include "bgpd/bgp_pbr.h"
+#include "bgpd/bgp_conditional_adv.h"
 
 #ifndef VTYSH_EXTRACT_PL
 #include "bgpd/bgp_route_clippy.c"
@@ -127,12 +130,19 @@ static const struct message bgp_pmsi_tnltype_str[] = {
 
 #define VRFID_NONE_STR "-"
 #define SOFT_RECONFIG_TASK_MAX_PREFIX 25000
+#define STALE_SWEEP_TASK_MAX_PREFIX 25000
 
 DEFINE_HOOK(bgp_process,
 	    (struct bgp * bgp, afi_t afi, safi_t safi, struct bgp_dest *bn,
 	     struct peer *peer, bool withdraw),
 	    (bgp, afi, safi, bn, peer, withdraw));
 
+DEFINE_HOOK(bgp_route_update,
+	    (struct bgp * bgp, afi_t afi, safi_t safi, struct bgp_dest *bn,
+	     struct bgp_path_info *old_route,
+	     struct bgp_path_info *new_route),
+	    (bgp, afi, safi, bn, old_route, new_route));
+
 /** Test if path is suppressed. */
 static bool bgp_path_suppressed(struct bgp_path_info *pi)
 {
@@ -205,8 +215,8 @@ struct bgp_dest *bgp_afi_node_lookup(struct bgp_table *table, afi_t afi,
 static struct bgp_path_info_extra *bgp_path_info_extra_new(void)
 {
 	struct bgp_path_info_extra *new;
-	new = XCALLOC(MTYPE_BGP_ROUTE_EXTRA,
-		      sizeof(struct bgp_path_info_extra));
+	new = XSLAB_CALLOC(MTYPE_BGP_ROUTE_EXTRA,
+			   sizeof(struct bgp_path_info_extra));
 	new->label[0] = MPLS_INVALID_LABEL;
 	new->num_labels = 0;
 	new->bgp_fs_pbr = NULL;
@@ -222,11 +232,6 @@ void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 		return;
 
 	e = *extra;
-	if (e->damp_info)
-		bgp_damp_info_free(e->damp_info, 0, e->damp_info->afi,
-				   e->damp_info->safi);
-
-	e->damp_info = NULL;
 	if (e->parent) {
 		struct bgp_path_info *bpi = (struct bgp_path_info *)e->parent;
 
@@ -261,11 +266,13 @@ void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 	if (e->mh_info)
 		bgp_evpn_path_mh_info_free(e->mh_info);
 
+	bgp_path_info_mpath_free(&e->mpath);
+
 	if ((*extra)->bgp_fs_iprule)
 		list_delete(&((*extra)->bgp_fs_iprule));
 	if ((*extra)->bgp_fs_pbr)
 		list_delete(&((*extra)->bgp_fs_pbr));
-	XFREE(MTYPE_BGP_ROUTE_EXTRA, *extra);
+	XSLAB_FREE(MTYPE_BGP_ROUTE_EXTRA, *extra);
 }
 
 /* Get bgp_path_info extra information for the given bgp_path_info, lazy
@@ -281,18 +288,24 @@ struct bgp_path_info_extra *bgp_path_info_extra_get(struct bgp_path_info *pi)
 /* Free bgp route information. */
 static void bgp_path_info_free(struct bgp_path_info *path)
 {
+	struct bgp_damp_info *bdi;
+
 	bgp_attr_unintern(&path->attr);
 
 	bgp_unlink_nexthop(path);
+
+	bdi = bgp_damp_info_get(path);
+	if (bdi)
+		bgp_damp_info_free(bdi, 0, bdi->afi, bdi->safi);
+
 	bgp_path_info_extra_free(&path->extra);
-	bgp_path_info_mpath_free(&path->mpath);
 	if (path->net)
 		bgp_addpath_free_info_data(&path->tx_addpath,
 					   &path->net->tx_addpath);
 
 	peer_unlock(path->peer); /* bgp_path_info peer reference */
 
-	XFREE(MTYPE_BGP_ROUTE, path);
+	XSLAB_FREE(MTYPE_BGP_ROUTE, path);
 }
 
 struct bgp_path_info *bgp_path_info_lock(struct bgp_path_info *path)
@@ -355,8 +368,7 @@ static int bgp_dest_set_defer_flag(struct bgp_dest *dest, bool delete)
 		/* Route selection is deferred if there is a stale path which
 		 * which indicates peer is in restart mode
 		 */
-		if (CHECK_FLAG(old_pi->flags, BGP_PATH_STALE)
-		    && (old_pi->sub_type == BGP_ROUTE_NORMAL)) {
+		if (bgp_path_info_stale(old_pi)) {
 			set_flag = true;
 		} else {
 			/* If the peer is graceful restart capable and peer is
@@ -512,6 +524,31 @@ void bgp_path_info_unset_flag(struct bgp_dest *dest, struct bgp_path_info *pi,
 	bgp_pcount_adjust(dest, pi);
 }
 
+/*
+ * Graceful restart and enhanced route refresh (RFC 7313) make all paths
+ * of a peer and AFI/SAFI stale at once.  Rather than flagging each of
+ * them, peer->stale_gen is incremented; paths record it when received, so
+ * the ones not received since are the stale ones.  Redistributed,
+ * aggregated or imported paths never are, and neither are damped or
+ * history paths, so that damping state survives a route refresh.
+ */
+static uint16_t bgp_path_info_stale_age(const struct bgp_path_info *pi)
+{
+	const struct bgp_table *table;
+
+	if (pi->sub_type != BGP_ROUTE_NORMAL || !pi->net
+	    || CHECK_FLAG(pi->flags, BGP_PATH_UNUSEABLE))
+		return 0;
+
+	table = bgp_dest_table(pi->net);
+	return pi->peer->stale_gen[table->afi][table->safi] - pi->stale_gen;
+}
+
+bool bgp_path_info_stale(const struct bgp_path_info *pi)
+{
+	return bgp_path_info_stale_age(pi) != 0;
+}
+
 /* Get MED value.  If MED value is missing and "bgp bestpath
    missing-as-worst" is specified, treat it as the worst value. */
 static uint32_t bgp_med_value(struct attr *attr, struct bgp *bgp)
@@ -1310,7 +1347,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 	/* Do this only if neither path is "stale" as stale paths do not have
 	 * valid peer information (as the connection may or may not be up).
 	 */
-	if (CHECK_FLAG(exist->flags, BGP_PATH_STALE)) {
+	if (bgp_path_info_stale(exist)) {
 		*reason = bgp_path_selection_stale;
 		if (debug)
 			zlog_debug(
@@ -1319,7 +1356,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 		return 1;
 	}
 
-	if (CHECK_FLAG(new->flags, BGP_PATH_STALE)) {
+	if (bgp_path_info_stale(new)) {
 		*reason = bgp_path_selection_stale;
 		if (debug)
 			zlog_debug(
@@ -1702,7 +1739,7 @@ static int bgp_output_modifier(struct peer *peer, const struct prefix *p,
 	SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_OUT);
 
 	/* Apply BGP route map to the attribute. */
-	ret = route_map_apply(rmap, p, &rmap_path);
+	ret = bgp_route_map_apply_cached(rmap, p, &rmap_path);
 
 	peer->rmap_type = rmap_type;
 
@@ -1842,24 +1879,6 @@ void bgp_attr_add_gshut_community(struct attr *attr)
 }
 
 
-/* Notify BGP Conditional advertisement scanner process. */
-void bgp_notify_conditional_adv_scanner(struct update_subgroup *subgrp)
-{
-	struct peer *peer = SUBGRP_PEER(subgrp);
-	afi_t afi = SUBGRP_AFI(subgrp);
-	safi_t safi = SUBGRP_SAFI(subgrp);
-	struct bgp_filter *filter = &peer->filter[afi][safi];
-
-	if (!ADVERTISE_MAP_NAME(filter))
-		return;
-
-	if (!CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE))
-		return;
-
-	peer->advmap_table_change = true;
-}
-
-
 void subgroup_announce_reset_nhop(uint8_t family, struct attr *attr)
 {
 	if (family == AF_INET) {
@@ -2269,8 +2288,8 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 			ret = route_map_apply(UNSUPPRESS_MAP(filter), p,
 					      &rmap_path);
 		else
-			ret = route_map_apply(ROUTE_MAP_OUT(filter), p,
-					      &rmap_path);
+			ret = bgp_route_map_apply_cached(ROUTE_MAP_OUT(filter),
+							 p, &rmap_path);
 
 		bgp_attr_flush(&dummy_attr);
 		peer->rmap_type = 0;
@@ -2496,10 +2515,65 @@ static void bgp_route_select_timer_expire(struct thread *thread)
 	bgp_best_path_select_defer(bgp, afi, safi);
 }
 
-void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
-			struct bgp_maxpaths_cfg *mpath_cfg,
-			struct bgp_path_info_pair *result, afi_t afi,
-			safi_t safi)
+/*
+ * Best path preselection result for one dest, computed by
+ * bgp_process_preselect() on the route processing pthreads.
+ */
+struct bgp_process_hint {
+	struct bgp_dest *dest;
+	struct bgp_path_info *best;
+	enum bgp_path_selection_reason reason;
+	unsigned int shard;
+	bool valid;
+};
+
+/*
+ * Read-only variant of the (non deterministic-med) path comparison loop in
+ * bgp_best_selection().  It does not touch any path or dest flags, so it is
+ * safe to run off the main pthread while the latter is blocked.  The reason
+ * starts from dest->reason, which bgp_process_parallel() resets first.
+ */
+static struct bgp_path_info *
+bgp_best_selection_candidate(struct bgp *bgp, struct bgp_dest *dest,
+			     struct bgp_maxpaths_cfg *mpath_cfg, afi_t afi,
+			     safi_t safi,
+			     enum bgp_path_selection_reason *reasonp)
+{
+	struct bgp_path_info *new_select = NULL;
+	struct bgp_path_info *pi;
+	enum bgp_path_selection_reason reason = dest->reason;
+	enum bgp_path_selection_reason prev;
+	char pfx_buf[PREFIX2STR_BUFFER] = {};
+	int paths_eq;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		if (BGP_PATH_HOLDDOWN(pi))
+			continue;
+
+		if (pi->peer && pi->peer != bgp->peer_self
+		    && !CHECK_FLAG(pi->peer->sflags, PEER_STATUS_NSF_WAIT)
+		    && !peer_established(pi->peer))
+			continue;
+
+		prev = reason;
+		if (bgp_path_info_cmp(bgp, pi, new_select, &paths_eq, mpath_cfg,
+				      0, pfx_buf, afi, safi, &reason)) {
+			if (new_select == NULL
+			    && prev != bgp_path_selection_none)
+				reason = prev;
+			new_select = pi;
+		}
+	}
+
+	*reasonp = reason;
+	return new_select;
+}
+
+static void bgp_best_selection_hint(struct bgp *bgp, struct bgp_dest *dest,
+				    struct bgp_maxpaths_cfg *mpath_cfg,
+				    struct bgp_path_info_pair *result,
+				    afi_t afi, safi_t safi,
+				    const struct bgp_process_hint *hint)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
@@ -2644,6 +2718,10 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 
 		bgp_path_info_unset_flag(dest, pi, BGP_PATH_DMED_CHECK);
 
+		/* comparison already done by bgp_process_preselect() */
+		if (hint)
+			continue;
+
 		reason = dest->reason;
 		if (bgp_path_info_cmp(bgp, pi, new_select, &paths_eq, mpath_cfg,
 				      debug, pfx_buf, afi, safi,
@@ -2655,6 +2733,11 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 		}
 	}
 
+	if (hint) {
+		new_select = hint->best;
+		dest->reason = hint->reason;
+	}
+
 	/* Now that we know which path is the bestpath see if any of the other
 	 * paths
 	 * qualify as multipaths
@@ -2733,6 +2816,14 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	return;
 }
 
+void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
+			struct bgp_maxpaths_cfg *mpath_cfg,
+			struct bgp_path_info_pair *result, afi_t afi,
+			safi_t safi)
+{
+	bgp_best_selection_hint(bgp, dest, mpath_cfg, result, afi, safi, NULL);
+}
+
 /*
  * A new route/change in bestpath of an existing route. Evaluate the path
  * for advertisement to the subgroup.
@@ -2856,6 +2947,8 @@ struct bgp_process_queue {
 #define BGP_PROCESS_QUEUE_EOIU_MARKER		(1 << 0)
 	unsigned int flags;
 	unsigned int queued;
+	/* bgp_pipe_now() at creation */
+	int64_t since;
 };
 
 static void bgp_process_evpn_route_injection(struct bgp *bgp, afi_t afi,
@@ -2948,7 +3041,8 @@ static bool bgp_lu_need_imp_null(const struct bgp_path_info *new_select)
  *     is being removed.
  */
 static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
-				 afi_t afi, safi_t safi)
+				 afi_t afi, safi_t safi,
+				 const struct bgp_process_hint *hint)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
@@ -2998,11 +3092,20 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 	}
 
 	/* Best path selection. */
-	bgp_best_selection(bgp, dest, &bgp->maxpaths[afi][safi], &old_and_new,
-			   afi, safi);
+	bgp_best_selection_hint(bgp, dest, &bgp->maxpaths[afi][safi],
+				&old_and_new, afi, safi, hint);
 	old_select = old_and_new.old;
 	new_select = old_and_new.new;
 
+	if (new_select || old_select)
+		bgp_pipe_record(new_select ? new_select->peer
+					   : old_select->peer,
+				afi, safi, BGP_PIPE_BESTPATH,
+				bgp_pipe_process_since);
+
+	if (bgp->condition_filter_count)
+		bgp_conditional_adv_process(bgp, afi, safi, dest);
+
 	/* Do we need to allocate or free labels?
 	 * Right now, since we only deal with per-prefix labels, it is not
 	 * necessary to do this upon changes to best path. Exceptions:
@@ -3088,6 +3191,8 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 		if (CHECK_FLAG(old_select->flags, BGP_PATH_ATTR_CHANGED)
 		    || CHECK_FLAG(old_select->flags, BGP_PATH_LINK_BW_CHG)
 		    || CHECK_FLAG(dest->flags, BGP_NODE_LABEL_CHANGED)) {
+			hook_call(bgp_route_update, bgp, afi, safi, dest,
+				  old_select, new_select);
 			group_announce_route(bgp, afi, safi, dest, new_select);
 
 			/* unicast routes must also be annouced to
@@ -3144,6 +3249,10 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest,
 		UNSET_FLAG(new_select->flags, BGP_PATH_LINK_BW_CHG);
 	}
 
+	if (old_select || new_select)
+		hook_call(bgp_route_update, bgp, afi, safi, dest, old_select,
+			  new_select);
+
 #ifdef ENABLE_BGP_VNC
 	if ((afi == AFI_IP || afi == AFI_IP6) && (safi == SAFI_UNICAST)) {
 		if (old_select != new_select) {
@@ -3247,7 +3356,7 @@ void bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
 
 		UNSET_FLAG(dest->flags, BGP_NODE_SELECT_DEFER);
 		bgp->gr_info[afi][safi].gr_deferred--;
-		bgp_process_main_one(bgp, dest, afi, safi);
+		bgp_process_main_one(bgp, dest, afi, safi, NULL);
 		cnt++;
 	}
 	/* If iteration stopped before the entire table was traversed then the
@@ -3281,32 +3390,151 @@ void bgp_best_path_select_defer(struct bgp *bgp, afi_t afi, safi_t safi)
 			&bgp->gr_info[afi][safi].t_route_select);
 }
 
+struct bgp_process_batch {
+	struct bgp *bgp;
+	struct bgp_process_hint *hints;
+	unsigned int count;
+};
+
+/* deferred and bestpath-debugged dests are always compared serially */
+static bool bgp_process_can_preselect(struct bgp_dest *dest)
+{
+	return !CHECK_FLAG(dest->flags, BGP_NODE_SELECT_DEFER)
+	       && !bgp_debug_bestpath(dest);
+}
+
+/*
+ * Runs on the route processing pthreads (see bgp_process_mt_run()) while
+ * the main pthread is blocked: compare the paths of every dest in this
+ * shard and record the winner.  Nothing is modified here, the outcome is
+ * applied by bgp_process_main_one() on the main pthread afterwards.
+ */
+static void bgp_process_preselect(void *arg, unsigned int shard,
+				  unsigned int nshards)
+{
+	struct bgp_process_batch *batch = arg;
+	struct bgp *bgp = batch->bgp;
+	struct bgp_process_hint *hint;
+	struct bgp_table *table;
+	unsigned int i;
+
+	for (i = 0; i < batch->count; i++) {
+		hint = &batch->hints[i];
+		if (hint->shard != shard)
+			continue;
+
+		if (!bgp_process_can_preselect(hint->dest))
+			continue;
+
+		table = bgp_dest_table(hint->dest);
+		hint->best = bgp_best_selection_candidate(
+			bgp, hint->dest, &bgp->maxpaths[table->afi][table->safi],
+			table->afi, table->safi, &hint->reason);
+		hint->valid = true;
+	}
+}
+
+/*
+ * Spread the best path comparisons for the dests queued on pqnode across
+ * the route processing pthreads, sharded by prefix hash.  Returns the
+ * per-dest results in queue order, or NULL if the batch is processed on
+ * the main pthread only.
+ */
+static struct bgp_process_hint *
+bgp_process_parallel(struct bgp_process_queue *pqnode, unsigned int *count)
+{
+	struct bgp *bgp = pqnode->bgp;
+	struct bgp_process_batch batch = {};
+	struct bgp_dest *dest;
+	unsigned int nshards = bgp_process_mt_shards();
+	unsigned int i;
+
+	*count = 0;
+
+	if (nshards <= 1 || pqnode->queued < BGP_PROCESS_MT_MIN_DESTS)
+		return NULL;
+
+	/* deterministic-med selection updates path flags while comparing */
+	if (CHECK_FLAG(bgp->flags, BGP_FLAG_DETERMINISTIC_MED))
+		return NULL;
+
+	batch.bgp = bgp;
+	batch.hints = XCALLOC(MTYPE_BGP_PROCESS_HINT,
+			      pqnode->queued * sizeof(*batch.hints));
+
+	i = 0;
+	STAILQ_FOREACH (dest, &pqnode->pqueue, pq) {
+		batch.hints[i].dest = dest;
+		batch.hints[i].shard =
+			prefix_hash_key(bgp_dest_get_prefix(dest)) % nshards;
+		/* bgp_best_selection() starts over from here as well */
+		if (bgp_process_can_preselect(dest))
+			dest->reason = bgp_path_selection_none;
+		i++;
+	}
+	batch.count = i;
+
+	bgp_process_mt_run(bgp_process_preselect, &batch);
+
+	/*
+	 * Any change to these dests from here on goes through bgp_process(),
+	 * which drops the flag again so the result isn't used.
+	 */
+	for (i = 0; i < batch.count; i++)
+		if (batch.hints[i].valid)
+			SET_FLAG(batch.hints[i].dest->flags,
+				 BGP_NODE_PROCESS_HINTED);
+
+	*count = batch.count;
+	return batch.hints;
+}
+
 static wq_item_status bgp_process_wq(struct work_queue *wq, void *data)
 {
 	struct bgp_process_queue *pqnode = data;
 	struct bgp *bgp = pqnode->bgp;
 	struct bgp_table *table;
 	struct bgp_dest *dest;
+	struct bgp_process_hint *hints, *hint;
+	unsigned int nhints, i = 0;
 
 	/* eoiu marker */
 	if (CHECK_FLAG(pqnode->flags, BGP_PROCESS_QUEUE_EOIU_MARKER)) {
-		bgp_process_main_one(bgp, NULL, 0, 0);
+		bgp_process_main_one(bgp, NULL, 0, 0, NULL);
 		/* should always have dedicated wq call */
 		assert(STAILQ_FIRST(&pqnode->pqueue) == NULL);
 		return WQ_SUCCESS;
 	}
 
+	hints = bgp_process_parallel(pqnode, &nhints);
+
+	bgp_pipe_process_since = pqnode->since;
+	bgp_zebra_batch_begin();
 	while (!STAILQ_EMPTY(&pqnode->pqueue)) {
 		dest = STAILQ_FIRST(&pqnode->pqueue);
 		STAILQ_REMOVE_HEAD(&pqnode->pqueue, pq);
 		STAILQ_NEXT(dest, pq) = NULL; /* complete unlink */
 		table = bgp_dest_table(dest);
+
+		/* dests appended during processing come after the hints */
+		hint = NULL;
+		if (i < nhints && hints[i].dest == dest) {
+			if (CHECK_FLAG(dest->flags, BGP_NODE_PROCESS_HINTED))
+				hint = &hints[i];
+			UNSET_FLAG(dest->flags, BGP_NODE_PROCESS_HINTED);
+			i++;
+		}
+
 		/* note, new DESTs may be added as part of processing */
-		bgp_process_main_one(bgp, dest, table->afi, table->safi);
+		bgp_process_main_one(bgp, dest, table->afi, table->safi, hint);
 
 		bgp_dest_unlock_node(dest);
 		bgp_table_unlock(table);
 	}
+	bgp_zebra_batch_commit();
+	bgp_pipe_process_since = 0;
+
+	XFREE(MTYPE_BGP_PROCESS_HINT, hints);
 
 	return WQ_SUCCESS;
 }
@@ -3347,6 +3575,7 @@ static struct bgp_process_queue *bgp_processq_alloc(struct bgp *bgp)
 	/* unlocked in bgp_processq_del */
 	pqnode->bgp = bgp_lock(bgp);
 	STAILQ_INIT(&pqnode->pqueue);
+	pqnode->since = bgp_pipe_now();
 
 	return pqnode;
 }
@@ -3359,8 +3588,11 @@ void bgp_process(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, safi_t safi)
 	int pqnode_reuse = 0;
 
 	/* already scheduled for processing? */
-	if (CHECK_FLAG(dest->flags, BGP_NODE_PROCESS_SCHEDULED))
+	if (CHECK_FLAG(dest->flags, BGP_NODE_PROCESS_SCHEDULED)) {
+		/* paths changed after parallel preselection, redo it */
+		UNSET_FLAG(dest->flags, BGP_NODE_PROCESS_HINTED);
 		return;
+	}
 
 	/* If the flag BGP_NODE_SELECT_DEFER is set, do not add route to
 	 * the workqueue
@@ -3666,7 +3898,7 @@ struct bgp_path_info *info_make(int type, int sub_type, unsigned short instance,
 	struct bgp_path_info *new;
 
 	/* Make new BGP info. */
-	new = XCALLOC(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
+	new = XSLAB_CALLOC(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
 	new->type = type;
 	new->instance = instance;
 	new->sub_type = sub_type;
@@ -4115,10 +4347,10 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 						peer, pfx_buf);
 				}
 
-				/* graceful restart STALE flag unset. */
-				if (CHECK_FLAG(pi->flags, BGP_PATH_STALE)) {
-					bgp_path_info_unset_flag(
-						dest, pi, BGP_PATH_STALE);
+				/* graceful restart stale path refreshed */
+				if (bgp_path_info_stale(pi)) {
+					pi->stale_gen =
+						peer->stale_gen[afi][safi];
 					bgp_dest_set_defer_flag(dest, false);
 					bgp_process(bgp, dest, afi, safi);
 				}
@@ -4162,9 +4394,9 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 			zlog_debug("%pBP rcvd %s", peer, pfx_buf);
 		}
 
-		/* graceful restart STALE flag unset. */
-		if (CHECK_FLAG(pi->flags, BGP_PATH_STALE)) {
-			bgp_path_info_unset_flag(dest, pi, BGP_PATH_STALE);
+		/* graceful restart stale path refreshed */
+		if (bgp_path_info_stale(pi)) {
+			pi->stale_gen = peer->stale_gen[afi][safi];
 			bgp_dest_set_defer_flag(dest, false);
 		}
 
@@ -4475,6 +4707,7 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 
 	/* Make new BGP info. */
 	new = info_make(type, sub_type, 0, peer, attr_new, dest);
+	new->stale_gen = peer->stale_gen[afi][safi];
 
 	/* Update MPLS label */
 	if (has_valid_label) {
@@ -4807,6 +5040,7 @@ static void bgp_announce_route_timer_expired(struct thread *t)
 
 	/* Notify BGP conditional advertisement scanner percess */
 	peer->advmap_config_change[paf->afi][paf->safi] = true;
+	bgp_conditional_adv_schedule(peer->bgp);
 }
 
 /*
@@ -4880,18 +5114,36 @@ static void bgp_soft_reconfig_table_flag(struct bgp_table *table, bool flag)
 	if (!table)
 		return;
 
+	table->soft_reconfig_done = 0;
+	table->soft_reconfig_total = 0;
+
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
 		for (ain = dest->adj_in; ain; ain = ain->next) {
 			if (ain->peer != NULL)
 				break;
 		}
-		if (flag && ain != NULL && ain->peer != NULL)
+		if (flag && ain != NULL && ain->peer != NULL) {
 			SET_FLAG(dest->flags, BGP_NODE_SOFT_RECONFIG);
-		else
+			table->soft_reconfig_total++;
+		} else
 			UNSET_FLAG(dest->flags, BGP_NODE_SOFT_RECONFIG);
 	}
 }
 
+bool bgp_soft_reconfig_in_progress(struct peer *peer, afi_t afi, safi_t safi,
+				   uint32_t *done, uint32_t *total)
+{
+	struct bgp_table *table = peer->bgp->rib[afi][safi];
+
+	if (!table || !table->soft_reconfig_peers
+	    || !listnode_lookup(table->soft_reconfig_peers, peer))
+		return false;
+
+	*done = table->soft_reconfig_done;
+	*total = table->soft_reconfig_total;
+	return true;
+}
+
 static int bgp_soft_reconfig_table_update(struct peer *peer,
 					  struct bgp_dest *dest,
 					  struct bgp_adj_in *ain, afi_t afi,
@@ -4985,6 +5237,7 @@ static void bgp_soft_reconfig_table_task(struct thread *thread)
 			continue;
 
 		UNSET_FLAG(dest->flags, BGP_NODE_SOFT_RECONFIG);
+		table->soft_reconfig_done++;
 
 		for (ain = dest->adj_in; ain; ain = ain->next) {
 			for (ALL_LIST_ELEMENTS(table->soft_reconfig_peers, node,
@@ -5159,11 +5412,242 @@ void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
 		}
 }
 
+/* Soft reconfig of the routes covered by p only, right away */
+void bgp_soft_reconfig_in_prefix(struct peer *peer, afi_t afi, safi_t safi,
+				 const struct prefix *p)
+{
+	struct bgp_dest *dest, *match;
+	struct bgp_adj_in *ain;
+	struct bgp_table *table;
+
+	if (!peer_established(peer))
+		return;
+
+	table = peer->bgp->rib[afi][safi];
+	if (!table)
+		return;
+
+	match = bgp_table_subtree_lookup(table, p);
+	for (dest = match; dest; dest = bgp_route_next_until(dest, match))
+		for (ain = dest->adj_in; ain; ain = ain->next) {
+			if (ain->peer != peer)
+				continue;
+
+			if (bgp_soft_reconfig_table_update(peer, dest, ain, afi,
+							   safi, NULL)
+			    < 0) {
+				bgp_dest_unlock_node(dest);
+				return;
+			}
+		}
+}
+
 
 struct bgp_clear_node_queue {
 	struct bgp_dest *dest;
 };
 
+/*
+ * Whether the peer's paths are kept as stale when the session goes down
+ * (or the AFI/SAFI is deactivated), rather than being removed.
+ */
+static bool bgp_clear_keeps_stale(struct peer *peer, afi_t afi, safi_t safi)
+{
+	return (CHECK_FLAG(peer->sflags, PEER_STATUS_NSF_WAIT)
+		&& peer->nsf[afi][safi])
+	       || CHECK_FLAG(peer->af_sflags[afi][safi],
+			     PEER_STATUS_ENHANCED_REFRESH);
+}
+
+/* Removes a path of the peer, and what was leaked or imported from it */
+static void bgp_clear_path(struct bgp *bgp, struct bgp_dest *dest,
+			   struct bgp_path_info *pi, struct peer *peer,
+			   afi_t afi, safi_t safi)
+{
+	/* If this is an EVPN route, process for un-import. */
+	if (safi == SAFI_EVPN)
+		bgp_evpn_unimport_route(bgp, afi, safi,
+					bgp_dest_get_prefix(dest), pi);
+	/* Handle withdraw for VRF route-leaking and L3VPN */
+	if (SAFI_UNICAST == safi
+	    && (bgp->inst_type == BGP_INSTANCE_TYPE_VRF ||
+		bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT)) {
+		vpn_leak_from_vrf_withdraw(bgp_get_default(), bgp, pi);
+	}
+	if (SAFI_MPLS_VPN == safi &&
+	    bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT) {
+		vpn_leak_to_vrf_withdraw(bgp, pi);
+	}
+
+	bgp_rib_remove(dest, pi, peer, afi, safi);
+}
+
+/*
+ * Stale paths are removed in the background, STALE_SWEEP_TASK_MAX_PREFIX
+ * destinations at a time, so sweeping a large table doesn't block
+ * everything else.
+ */
+struct bgp_stale_sweep {
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+
+	/* paths received before this peer->stale_gen are removed */
+	uint16_t gen;
+
+	/* the AFI/SAFI's table, and the current RD's for two-level ones */
+	bgp_table_iter_t iter;
+	bgp_table_iter_t rd_iter;
+	bool in_rd;
+
+	struct thread *t_sweep;
+};
+
+static void bgp_stale_sweep_dest(struct bgp_stale_sweep *sw,
+				 struct bgp_dest *dest)
+{
+	struct peer *peer = sw->peer;
+	struct bgp_path_info *pi, *next;
+	struct community *comm;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = next) {
+		next = pi->next;
+
+		if (pi->peer != peer || pi->sub_type != BGP_ROUTE_NORMAL
+		    || CHECK_FLAG(pi->flags, BGP_PATH_UNUSEABLE))
+			continue;
+
+		/* not stale when the sweep started */
+		if ((int16_t)(sw->gen - pi->stale_gen) <= 0)
+			continue;
+
+		/* If any of the routes from the peer have been marked with
+		 * the NO_LLGR community, either as sent by the peer, or as
+		 * the result of a configured policy, they MUST NOT be
+		 * retained, but MUST be removed as per the normal operation
+		 * of [RFC4271].
+		 */
+		comm = bgp_attr_get_community(pi->attr);
+		if (CHECK_FLAG(peer->af_sflags[sw->afi][sw->safi],
+			       PEER_STATUS_LLGR_WAIT)
+		    && comm && !community_include(comm, COMMUNITY_NO_LLGR))
+			continue;
+
+		bgp_clear_path(peer->bgp, dest, pi, peer, sw->afi, sw->safi);
+	}
+}
+
+static void bgp_stale_sweep_free(struct bgp_stale_sweep *sw)
+{
+	struct peer *peer = sw->peer;
+
+	THREAD_OFF(sw->t_sweep);
+	if (sw->in_rd)
+		bgp_table_iter_cleanup(&sw->rd_iter);
+	bgp_table_iter_cleanup(&sw->iter);
+
+	peer->stale_sweep[sw->afi][sw->safi] = NULL;
+	XFREE(MTYPE_BGP_STALE_SWEEP, sw);
+	peer_unlock(peer); /* bgp_clear_stale_route */
+}
+
+static void bgp_stale_sweep_task(struct thread *thread)
+{
+	struct bgp_stale_sweep *sw = THREAD_ARG(thread);
+	bool two_level = sw->safi == SAFI_MPLS_VPN || sw->safi == SAFI_ENCAP
+			 || sw->safi == SAFI_EVPN;
+	struct bgp_table *table;
+	struct bgp_dest *dest;
+	uint32_t iter = 0;
+
+	while (iter < STALE_SWEEP_TASK_MAX_PREFIX) {
+		if (sw->in_rd) {
+			dest = bgp_table_iter_next(&sw->rd_iter);
+			if (!dest) {
+				bgp_table_iter_cleanup(&sw->rd_iter);
+				sw->in_rd = false;
+				continue;
+			}
+		} else {
+			dest = bgp_table_iter_next(&sw->iter);
+			if (!dest)
+				break;
+
+			if (two_level) {
+				table = bgp_dest_get_bgp_table_info(dest);
+				if (table) {
+					bgp_table_iter_init(&sw->rd_iter,
+							    table);
+					sw->in_rd = true;
+				}
+				continue;
+			}
+		}
+
+		bgp_stale_sweep_dest(sw, dest);
+		iter++;
+	}
+
+	if (iter < STALE_SWEEP_TASK_MAX_PREFIX) {
+		if (bgp_debug_neighbor_events(sw->peer))
+			zlog_debug("%pBP stale paths for %s removed", sw->peer,
+				   get_afi_safi_str(sw->afi, sw->safi, false));
+		bgp_stale_sweep_free(sw);
+		return;
+	}
+
+	/* the tables may change until we get back to them */
+	if (sw->in_rd)
+		bgp_table_iter_pause(&sw->rd_iter);
+	bgp_table_iter_pause(&sw->iter);
+	thread_add_event(bm->master, bgp_stale_sweep_task, sw, 0,
+			 &sw->t_sweep);
+}
+
+static void bgp_stale_sweep_cancel(struct peer *peer, afi_t afi, safi_t safi)
+{
+	if (peer->stale_sweep[afi][safi])
+		bgp_stale_sweep_free(peer->stale_sweep[afi][safi]);
+}
+
+void bgp_clear_stale_route(struct peer *peer, afi_t afi, safi_t safi)
+{
+	struct bgp_table *table = peer->bgp->rib[afi][safi];
+	struct bgp_stale_sweep *sw;
+
+	if (!table)
+		return;
+
+	/* start over, for what is stale now */
+	bgp_stale_sweep_cancel(peer, afi, safi);
+
+	sw = XCALLOC(MTYPE_BGP_STALE_SWEEP, sizeof(*sw));
+	sw->peer = peer_lock(peer); /* bgp_stale_sweep_free */
+	sw->afi = afi;
+	sw->safi = safi;
+	sw->gen = peer->stale_gen[afi][safi];
+	bgp_table_iter_init(&sw->iter, table);
+	peer->stale_sweep[afi][safi] = sw;
+
+	thread_add_event(bm->master, bgp_stale_sweep_task, sw, 0,
+			 &sw->t_sweep);
+}
+
+/* Enhanced route refresh (BoRR), all paths of the peer become stale */
+void bgp_set_stale_route(struct peer *peer, afi_t afi, safi_t safi)
+{
+	if (!CHECK_FLAG(peer->af_sflags[afi][safi],
+			PEER_STATUS_ENHANCED_REFRESH))
+		return;
+
+	if (bgp_debug_neighbor_events(peer))
+		zlog_debug(
+			"%pBP route-refresh for %s/%s, marking prefixes as stale",
+			peer, afi2str(afi), safi2str(safi));
+
+	peer->stale_gen[afi][safi]++;
+}
+
 static wq_item_status bgp_clear_route_node(struct work_queue *wq, void *data)
 {
 	struct bgp_clear_node_queue *cnq = data;
@@ -5184,35 +5668,13 @@ static wq_item_status bgp_clear_route_node(struct work_queue *wq, void *data)
 		if (pi->peer != peer)
 			continue;
 
-		/* graceful restart STALE flag set. */
-		if (((CHECK_FLAG(peer->sflags, PEER_STATUS_NSF_WAIT)
-		      && peer->nsf[afi][safi])
-		     || CHECK_FLAG(peer->af_sflags[afi][safi],
-				   PEER_STATUS_ENHANCED_REFRESH))
-		    && !CHECK_FLAG(pi->flags, BGP_PATH_STALE)
+		/* graceful restart, stale since bgp_clear_route() */
+		if (bgp_clear_keeps_stale(peer, afi, safi)
+		    && bgp_path_info_stale_age(pi) == 1
 		    && !CHECK_FLAG(pi->flags, BGP_PATH_UNUSEABLE))
-			bgp_path_info_set_flag(dest, pi, BGP_PATH_STALE);
-		else {
-			/* If this is an EVPN route, process for
-			 * un-import. */
-			if (safi == SAFI_EVPN)
-				bgp_evpn_unimport_route(
-					bgp, afi, safi,
-					bgp_dest_get_prefix(dest), pi);
-			/* Handle withdraw for VRF route-leaking and L3VPN */
-			if (SAFI_UNICAST == safi
-			    && (bgp->inst_type == BGP_INSTANCE_TYPE_VRF ||
-				bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT)) {
-				vpn_leak_from_vrf_withdraw(bgp_get_default(),
-							   bgp, pi);
-			}
-			if (SAFI_MPLS_VPN == safi &&
-			    bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT) {
-				vpn_leak_to_vrf_withdraw(bgp, pi);
-			}
+			continue;
 
-			bgp_rib_remove(dest, pi, peer, afi, safi);
-		}
+		bgp_clear_path(bgp, dest, pi, peer, afi, safi);
 	}
 	return WQ_SUCCESS;
 }
@@ -5262,6 +5724,7 @@ static void bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
 {
 	struct bgp_dest *dest;
 	int force = peer->bgp->process_queue ? 0 : 1;
+	bool keep = !force && bgp_clear_keeps_stale(peer, afi, safi);
 
 	if (!table)
 		table = peer->bgp->rib[afi][safi];
@@ -5325,6 +5788,11 @@ static void bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
 			if (pi->peer != peer)
 				continue;
 
+			/* nothing to do for the ones that become stale */
+			if (keep && bgp_path_info_stale_age(pi) == 1
+			    && !CHECK_FLAG(pi->flags, BGP_PATH_UNUSEABLE))
+				continue;
+
 			if (force)
 				bgp_path_info_reap(dest, pi);
 			else {
@@ -5353,6 +5821,11 @@ void bgp_clear_route(struct peer *peer, afi_t afi, safi_t safi)
 	if (peer->clear_node_queue == NULL)
 		bgp_clear_node_queue_init(peer);
 
+	/* this removes what was stale before, and maybe the rest too */
+	bgp_stale_sweep_cancel(peer, afi, safi);
+	if (bgp_clear_keeps_stale(peer, afi, safi))
+		peer->stale_gen[afi][safi]++;
+
 	/* bgp_fsm.c keeps sessions in state Clearing, not transitioning to
 	 * Idle until it receives a Clearing_Completed event. This protects
 	 * against peers which flap faster than we can we clear, which could
@@ -5429,167 +5902,6 @@ void bgp_clear_adj_in(struct peer *peer, afi_t afi, safi_t safi)
 	}
 }
 
-/* If any of the routes from the peer have been marked with the NO_LLGR
- * community, either as sent by the peer, or as the result of a configured
- * policy, they MUST NOT be retained, but MUST be removed as per the normal
- * operation of [RFC4271].
- */
-void bgp_clear_stale_route(struct peer *peer, afi_t afi, safi_t safi)
-{
-	struct bgp_dest *dest;
-	struct bgp_path_info *pi;
-	struct bgp_table *table;
-
-	if (safi == SAFI_MPLS_VPN || safi == SAFI_ENCAP || safi == SAFI_EVPN) {
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest)) {
-			struct bgp_dest *rm;
-
-			/* look for neighbor in tables */
-			table = bgp_dest_get_bgp_table_info(dest);
-			if (!table)
-				continue;
-
-			for (rm = bgp_table_top(table); rm;
-			     rm = bgp_route_next(rm))
-				for (pi = bgp_dest_get_bgp_path_info(rm); pi;
-				     pi = pi->next) {
-					if (pi->peer != peer)
-						continue;
-					if (CHECK_FLAG(
-						    peer->af_sflags[afi][safi],
-						    PEER_STATUS_LLGR_WAIT) &&
-					    bgp_attr_get_community(pi->attr) &&
-					    !community_include(
-						    bgp_attr_get_community(
-							    pi->attr),
-						    COMMUNITY_NO_LLGR))
-						continue;
-					if (!CHECK_FLAG(pi->flags,
-							BGP_PATH_STALE))
-						continue;
-
-					/*
-					 * If this is VRF leaked route
-					 * process for withdraw.
-					 */
-					if (pi->sub_type ==
-						    BGP_ROUTE_IMPORTED &&
-					    peer->bgp->inst_type ==
-						    BGP_INSTANCE_TYPE_DEFAULT)
-						vpn_leak_to_vrf_withdraw(
-							peer->bgp, pi);
-
-					bgp_rib_remove(rm, pi, peer, afi, safi);
-					break;
-				}
-		}
-	} else {
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest))
-			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
-			     pi = pi->next) {
-				if (pi->peer != peer)
-					continue;
-				if (CHECK_FLAG(peer->af_sflags[afi][safi],
-					       PEER_STATUS_LLGR_WAIT) &&
-				    bgp_attr_get_community(pi->attr) &&
-				    !community_include(
-					    bgp_attr_get_community(pi->attr),
-					    COMMUNITY_NO_LLGR))
-					continue;
-				if (!CHECK_FLAG(pi->flags, BGP_PATH_STALE))
-					continue;
-				if (safi == SAFI_UNICAST &&
-				    (peer->bgp->inst_type ==
-					     BGP_INSTANCE_TYPE_VRF ||
-				     peer->bgp->inst_type ==
-					     BGP_INSTANCE_TYPE_DEFAULT))
-					vpn_leak_from_vrf_withdraw(
-						bgp_get_default(), peer->bgp,
-						pi);
-
-				bgp_rib_remove(dest, pi, peer, afi, safi);
-				break;
-			}
-	}
-}
-
-void bgp_set_stale_route(struct peer *peer, afi_t afi, safi_t safi)
-{
-	struct bgp_dest *dest, *ndest;
-	struct bgp_path_info *pi;
-	struct bgp_table *table;
-
-	if (safi == SAFI_MPLS_VPN || safi == SAFI_ENCAP || safi == SAFI_EVPN) {
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest)) {
-			table = bgp_dest_get_bgp_table_info(dest);
-			if (!table)
-				continue;
-
-			for (ndest = bgp_table_top(table); ndest;
-			     ndest = bgp_route_next(ndest)) {
-				for (pi = bgp_dest_get_bgp_path_info(ndest); pi;
-				     pi = pi->next) {
-					if (pi->peer != peer)
-						continue;
-
-					if ((CHECK_FLAG(
-						    peer->af_sflags[afi][safi],
-						    PEER_STATUS_ENHANCED_REFRESH))
-					    && !CHECK_FLAG(pi->flags,
-							   BGP_PATH_STALE)
-					    && !CHECK_FLAG(
-						       pi->flags,
-						       BGP_PATH_UNUSEABLE)) {
-						if (bgp_debug_neighbor_events(
-							    peer))
-							zlog_debug(
-								"%s: route-refresh for %s/%s, marking prefix %pFX as stale",
-								peer->host,
-								afi2str(afi),
-								safi2str(safi),
-								bgp_dest_get_prefix(
-									ndest));
-
-						bgp_path_info_set_flag(
-							ndest, pi,
-							BGP_PATH_STALE);
-					}
-				}
-			}
-		}
-	} else {
-		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
-		     dest = bgp_route_next(dest)) {
-			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
-			     pi = pi->next) {
-				if (pi->peer != peer)
-					continue;
-
-				if ((CHECK_FLAG(peer->af_sflags[afi][safi],
-						PEER_STATUS_ENHANCED_REFRESH))
-				    && !CHECK_FLAG(pi->flags, BGP_PATH_STALE)
-				    && !CHECK_FLAG(pi->flags,
-						   BGP_PATH_UNUSEABLE)) {
-					if (bgp_debug_neighbor_events(peer))
-						zlog_debug(
-							"%s: route-refresh for %s/%s, marking prefix %pFX as stale",
-							peer->host,
-							afi2str(afi),
-							safi2str(safi),
-							bgp_dest_get_prefix(
-								dest));
-
-					bgp_path_info_set_flag(dest, pi,
-							       BGP_PATH_STALE);
-				}
-			}
-		}
-	}
-}
-
 bool bgp_outbound_policy_exists(struct peer *peer, struct bgp_filter *filter)
 {
 	if (peer->sort == BGP_PEER_IBGP)
@@ -8754,7 +9066,7 @@ static void route_vty_short_status_out(struct vty *vty,
 		if (CHECK_FLAG(path->flags, BGP_PATH_REMOVED))
 			json_object_boolean_true_add(json_path, "removed");
 
-		if (CHECK_FLAG(path->flags, BGP_PATH_STALE))
+		if (bgp_path_info_stale(path))
 			json_object_boolean_true_add(json_path, "stale");
 
 		if (path->extra && bgp_path_suppressed(path))
@@ -8807,7 +9119,7 @@ static void route_vty_short_status_out(struct vty *vty,
 	/* Route status display. */
 	if (CHECK_FLAG(path->flags, BGP_PATH_REMOVED))
 		vty_out(vty, "R");
-	else if (CHECK_FLAG(path->flags, BGP_PATH_STALE))
+	else if (bgp_path_info_stale(path))
 		vty_out(vty, "S");
 	else if (bgp_path_suppressed(path))
 		vty_out(vty, "s");
@@ -9733,14 +10045,13 @@ static void flap_route_vty_out(struct vty *vty, const struct prefix *p,
 	int len;
 	json_object *json_path = NULL;
 
-	if (!path->extra)
+	bdi = bgp_damp_info_get(path);
+	if (!bdi)
 		return;
 
 	if (use_json)
 		json_path = json_object_new_object();
 
-	bdi = path->extra->damp_info;
-
 	/* short status lead text */
 	route_vty_short_status_out(vty, path, p, json_path);
 
@@ -10056,11 +10367,9 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 	/* Line1 display AS-path, Aggregator */
 	if (attr->aspath) {
 		if (json_paths) {
-			if (!attr->aspath->json)
-				aspath_str_update(attr->aspath, true);
-			json_object_lock(attr->aspath->json);
-			json_object_object_add(json_path, "aspath",
-					       attr->aspath->json);
+			json_object_object_add(
+				json_path, "aspath",
+				json_object_lock(aspath_json_get(attr->aspath)));
 		} else {
 			if (attr->aspath->segments)
 				aspath_print_vty(vty, "  %s", attr->aspath, "");
@@ -10076,7 +10385,7 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 			vty_out(vty, ", (removed)");
 	}
 
-	if (CHECK_FLAG(path->flags, BGP_PATH_STALE)) {
+	if (bgp_path_info_stale(path)) {
 		if (json_paths)
 			json_object_boolean_true_add(json_path, "stale");
 		else
@@ -10700,7 +11009,7 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 			vty_out(vty, "\n");
 	}
 
-	if (path->extra && path->extra->damp_info)
+	if (bgp_damp_info_get(path))
 		bgp_damp_info_vty(vty, path, afi, safi, json_path);
 
 	/* Remote Label */
@@ -10834,8 +11143,7 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 				str, label2vni(&attr->label));
 	}
 
-	if (path->peer->t_gr_restart &&
-	    CHECK_FLAG(path->flags, BGP_PATH_STALE)) {
+	if (path->peer->t_gr_restart && bgp_path_info_stale(path)) {
 		unsigned long gr_remaining =
 			thread_timer_remain_second(path->peer->t_gr_restart);
 
@@ -10913,12 +11221,58 @@ static int bgp_show_community(struct vty *vty, struct bgp *bgp,
 			      const char *comstr, int exact, afi_t afi,
 			      safi_t safi, uint16_t show_flags);
 
+/* prefixes shown per run of a paused "show bgp" */
+#define BGP_SHOW_BATCH 1000
+
+/* Where a "show bgp" paused between batches picks up again */
+struct bgp_show_cursor {
+	struct bgp *bgp;
+	safi_t safi;
+	enum bgp_show_type type;
+	uint16_t show_flags;
+	enum rpki_states rpki_target_state;
+
+	bgp_table_iter_t iter;
+	bool started, paused;
+
+	/* bgp_show_table() state between batches */
+	bool header;
+	unsigned long output_count;
+	unsigned long total_count;
+	unsigned long json_header_depth;
+	struct vty_json_stream js;
+};
+
+static struct bgp_dest *bgp_show_first(struct bgp_table *table,
+				       struct bgp_show_cursor *cur)
+{
+	if (!cur)
+		return bgp_table_top(table);
+	return bgp_table_iter_next(&cur->iter);
+}
+
+static struct bgp_dest *bgp_show_next(struct bgp_dest *dest,
+				      struct bgp_show_cursor *cur,
+				      unsigned int *batch)
+{
+	if (!cur)
+		return bgp_route_next(dest);
+
+	if (++*batch >= BGP_SHOW_BATCH) {
+		bgp_table_iter_pause(&cur->iter);
+		cur->paused = true;
+		return NULL;
+	}
+	return bgp_table_iter_next(&cur->iter);
+}
+
 static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 			  struct bgp_table *table, enum bgp_show_type type,
 			  void *output_arg, const char *rd, int is_last,
 			  unsigned long *output_cum, unsigned long *total_cum,
 			  unsigned long *json_header_depth, uint16_t show_flags,
-			  enum rpki_states rpki_target_state)
+			  enum rpki_states rpki_target_state,
+			  struct bgp_show_cursor *cur)
 {
 	struct bgp_path_info *pi;
 	struct bgp_dest *dest;
@@ -10929,13 +11283,20 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 	unsigned long total_count = 0;
 	struct prefix *p;
 	json_object *json_paths = NULL;
-	int first = 1;
+	struct vty_json_stream js;
+	char key[BGP_FLOWSPEC_STRING_DISPLAY_MAX + 8];
 	bool use_json = CHECK_FLAG(show_flags, BGP_SHOW_OPT_JSON);
 	bool wide = CHECK_FLAG(show_flags, BGP_SHOW_OPT_WIDE);
 	bool all = CHECK_FLAG(show_flags, BGP_SHOW_OPT_AFI_ALL);
+	unsigned int batch = 0;
 
 	if (output_cum && *output_cum != 0)
 		header = false;
+	if (cur && cur->started) {
+		header = cur->header;
+		output_count = cur->output_count;
+		total_count = cur->total_count;
+	}
 
 	if (use_json && !*json_header_depth) {
 		if (all)
@@ -10965,6 +11326,12 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 		vty_out(vty, " \"%s\" : { ", rd);
 	}
 
+	/* prefixes go out as they're found, each into the "routes" object */
+	if (cur && cur->started)
+		js = cur->js;
+	else
+		vty_json_stream_init(&js, vty);
+
 	/* Check for 'json detail', where we need header output once per dest */
 	if (use_json && CHECK_FLAG(show_flags, BGP_SHOW_OPT_DETAIL) &&
 	    type != bgp_show_type_dampend_paths &&
@@ -10974,7 +11341,8 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 		json_detail_header = true;
 
 	/* Start processing of routes. */
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+	for (dest = bgp_show_first(table, cur); dest;
+	     dest = bgp_show_next(dest, cur, &batch)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 		enum rpki_states rpki_curr_state = RPKI_NOT_BEING_USED;
 		bool json_detail = json_detail_header;
@@ -11065,7 +11433,7 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 			    || type == bgp_show_type_flap_neighbor
 			    || type == bgp_show_type_dampend_paths
 			    || type == bgp_show_type_damp_neighbor) {
-				if (!(pi->extra && pi->extra->damp_info))
+				if (!bgp_damp_info_get(pi))
 					continue;
 			}
 			if (type == bgp_show_type_regexp) {
@@ -11311,27 +11679,26 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 					retstr, NLRI_STRING_FORMAT_MIN, NULL,
 					family2afi(dest_p->u
 						   .prefix_flowspec.family));
-				if (first)
-					vty_out(vty, "\"%s/%d\": ", retstr,
-						dest_p->u.prefix_flowspec
-							.prefixlen);
-				else
-					vty_out(vty, ",\"%s/%d\": ", retstr,
-						dest_p->u.prefix_flowspec
-							.prefixlen);
-			} else {
-				if (first)
-					vty_out(vty, "\"%pFX\": ", dest_p);
-				else
-					vty_out(vty, ",\"%pFX\": ", dest_p);
-			}
-			vty_json(vty, json_paths);
+				snprintf(key, sizeof(key), "%s/%d", retstr,
+					 dest_p->u.prefix_flowspec.prefixlen);
+			} else
+				snprintfrr(key, sizeof(key), "%pFX", dest_p);
+			vty_json_stream_add(&js, key, json_paths);
 			json_paths = NULL;
-			first = 0;
 		} else
 			json_object_free(json_paths);
 	}
 
+	if (cur && cur->paused) {
+		cur->paused = false;
+		cur->started = true;
+		cur->header = header;
+		cur->output_count = output_count;
+		cur->total_count = total_count;
+		cur->js = js;
+		return CMD_SUSPEND;
+	}
+
 	if (output_cum) {
 		output_count += *output_cum;
 		*output_cum = output_count;
@@ -11403,7 +11770,7 @@ int bgp_show_table_rd(struct vty *vty, struct bgp *bgp, safi_t safi,
 			bgp_show_table(vty, bgp, safi, itable, type, output_arg,
 				       rd, next == NULL, &output_cum,
 				       &total_cum, &json_header_depth,
-				       show_flags, RPKI_NOT_BEING_USED);
+				       show_flags, RPKI_NOT_BEING_USED, NULL);
 			if (next == NULL)
 				show_msg = false;
 		}
@@ -11420,6 +11787,56 @@ int bgp_show_table_rd(struct vty *vty, struct bgp *bgp, safi_t safi,
 	return CMD_SUCCESS;
 }
 
+static int bgp_show_resume(struct vty *vty, void *arg)
+{
+	struct bgp_show_cursor *cur = arg;
+
+	return bgp_show_table(vty, cur->bgp, cur->safi, cur->iter.table,
+			      cur->type, NULL, NULL, 1, NULL, NULL,
+			      &cur->json_header_depth, cur->show_flags,
+			      cur->rpki_target_state, cur);
+}
+
+static void bgp_show_cursor_free(void *arg)
+{
+	struct bgp_show_cursor *cur = arg;
+
+	bgp_table_iter_cleanup(&cur->iter);
+	bgp_unlock(cur->bgp);
+	XFREE(MTYPE_TMP, cur);
+}
+
+/*
+ * Shows the table a batch of prefixes at a time, in between the daemon
+ * goes on with its other work.  The table and instance stay locked while
+ * the output is paused.
+ */
+static int bgp_show_paused(struct vty *vty, struct bgp *bgp, safi_t safi,
+			   struct bgp_table *table, enum bgp_show_type type,
+			   uint16_t show_flags,
+			   enum rpki_states rpki_target_state)
+{
+	struct bgp_show_cursor *cur;
+	int ret;
+
+	cur = XCALLOC(MTYPE_TMP, sizeof(*cur));
+	cur->bgp = bgp_lock(bgp);
+	cur->safi = safi;
+	cur->type = type;
+	cur->show_flags = show_flags;
+	cur->rpki_target_state = rpki_target_state;
+	bgp_table_iter_init(&cur->iter, table);
+
+	ret = bgp_show_resume(vty, cur);
+	if (ret != CMD_SUSPEND) {
+		bgp_show_cursor_free(cur);
+		return ret;
+	}
+
+	return vty_show_resume(vty, bgp_show_resume, cur,
+			       bgp_show_cursor_free);
+}
+
 static int bgp_show(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 		    enum bgp_show_type type, void *output_arg,
 		    uint16_t show_flags, enum rpki_states rpki_target_state)
@@ -11457,9 +11874,14 @@ static int bgp_show(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 					       1, NULL, NULL);
 	}
 
+	/* the output argument may not outlive the command */
+	if (CHECK_FLAG(show_flags, BGP_SHOW_OPT_RESUME) && !output_arg)
+		return bgp_show_paused(vty, bgp, safi, table, type, show_flags,
+				       rpki_target_state);
+
 	return bgp_show_table(vty, bgp, safi, table, type, output_arg, NULL, 1,
 			      NULL, NULL, &json_header_depth, show_flags,
-			      rpki_target_state);
+			      rpki_target_state, NULL);
 }
 
 static void bgp_show_all_instances_routes_vty(struct vty *vty, afi_t afi,
@@ -12574,7 +12996,8 @@ DEFPY(show_ip_bgp, show_ip_bgp_cmd,
 						  show_flags);
 		else
 			return bgp_show(vty, bgp, afi, safi, sh_type,
-					output_arg, show_flags,
+					output_arg,
+					show_flags | BGP_SHOW_OPT_RESUME,
 					rpki_target_state);
 	} else {
 		struct listnode *node;
@@ -13356,7 +13779,7 @@ static void bgp_peer_count_proc(struct bgp_dest *rn, struct peer_pcounts *pc)
 			pc->count[PCOUNT_HISTORY]++;
 		if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
 			pc->count[PCOUNT_REMOVED]++;
-		if (CHECK_FLAG(pi->flags, BGP_PATH_STALE))
+		if (bgp_path_info_stale(pi))
 			pc->count[PCOUNT_STALE]++;
 		if (CHECK_FLAG(pi->flags, BGP_PATH_VALID))
 			pc->count[PCOUNT_VALID]++;
@@ -13687,7 +14110,7 @@ show_adj_route(struct vty *vty, struct peer *peer, struct bgp_table *table,
 	       unsigned long *output_count, unsigned long *filtered_count)
 {
 	struct bgp_adj_in *ain;
-	struct bgp_adj_out *adj;
+	struct bgp_adj_out *adj, *compact;
 	struct bgp_dest *dest;
 	struct bgp *bgp;
 	struct attr attr;
@@ -13811,6 +14234,10 @@ show_adj_route(struct vty *vty, struct peer *peer, struct bgp_table *table,
 				(*output_count)++;
 			}
 		} else if (type == bgp_show_adj_route_advertised) {
+			compact = subgrp ? bgp_adj_out_compact_materialize(
+						   subgrp, dest)
+					 : NULL;
+
 			RB_FOREACH (adj, bgp_adj_out_rb, &dest->adj_out)
 				SUBGRP_FOREACH_PEER (adj->subgroup, paf) {
 					if (paf->peer != peer || !adj->attr)
@@ -13857,6 +14284,8 @@ show_adj_route(struct vty *vty, struct peer *peer, struct bgp_table *table,
 
 					bgp_attr_flush(&attr);
 				}
+
+			bgp_adj_out_compact_release(compact);
 		} else if (type == bgp_show_adj_route_bestpath) {
 			struct bgp_path_info *pi;
 
@@ -14912,6 +15341,7 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 	struct bgp_dest *rm;
 	struct bgp_path_info *pi;
 	struct bgp_path_info *pi_temp;
+	struct bgp_damp_info *bdi;
 	struct bgp *bgp;
 	struct bgp_table *table;
 
@@ -14961,11 +15391,11 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 			    || rm_p->prefixlen == match.prefixlen) {
 				pi = bgp_dest_get_bgp_path_info(rm);
 				while (pi) {
-					if (pi->extra && pi->extra->damp_info) {
+					bdi = bgp_damp_info_get(pi);
+					if (bdi) {
 						pi_temp = pi->next;
-						bgp_damp_info_free(
-							pi->extra->damp_info,
-							1, afi, safi);
+						bgp_damp_info_free(bdi, 1, afi,
+								   safi);
 						pi = pi_temp;
 					} else
 						pi = pi->next;
@@ -14983,11 +15413,11 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 			    || dest_p->prefixlen == match.prefixlen) {
 				pi = bgp_dest_get_bgp_path_info(dest);
 				while (pi) {
-					if (pi->extra && pi->extra->damp_info) {
+					bdi = bgp_damp_info_get(pi);
+					if (bdi) {
 						pi_temp = pi->next;
-						bgp_damp_info_free(
-							pi->extra->damp_info,
-							1, afi, safi);
+						bgp_damp_info_free(bdi, 1, afi,
+								   safi);
 						pi = pi_temp;
 					} else
 						pi = pi->next;
@@ -88,8 +88,10 @@ enum bgp_show_adj_route_type {
  */
 #define BGP_MAX_LABELS 2
 
-/* Maximum number of sids we can process or send with a prefix. */
-#define BGP_MAX_SIDS 6
+/* Maximum number of sids we can process or send with a prefix.  Only one
+ * is ever carried, and this is in every bgp_path_info_extra.
+ */
+#define BGP_MAX_SIDS 1
 
 /* Maximum buffer length for storing BGP best path selection reason */
 #define BGP_MAX_SELECTION_REASON_STR_BUF 32
@@ -164,12 +166,12 @@ struct bgp_sid_info {
  * and lazily allocated to save memory.
  */
 struct bgp_path_info_extra {
-	/* Pointer to dampening structure.  */
-	struct bgp_damp_info *damp_info;
-
 	/** List of aggregations that suppress this path. */
 	struct list *aggr_suppressors;
 
+	/* Multipath information */
+	struct bgp_path_info_mpath *mpath;
+
 	/* Nexthop reachability check.  */
 	uint32_t igpmetric;
 
@@ -215,6 +217,8 @@ struct bgp_path_info_extra {
 #endif
 
 	/* For imported routes into a VNI (or VRF), this points to the parent.
+	 * Such copies only keep what differs per VRF, anything else (e.g. the
+	 * nexthop in context of the original instance) is the parent's.
 	 */
 	void *parent;
 
@@ -235,12 +239,6 @@ struct bgp_path_info_extra {
 	 */
 	struct bgp *bgp_orig;
 
-	/*
-	 * Nexthop in context of original bgp instance. Needed
-	 * for label resolution of core mpls routes exported to a vrf.
-	 * Set nexthop_orig.family to 0 if not valid.
-	 */
-	struct prefix nexthop_orig;
 	/* presence of FS pbr firewall based entry */
 	struct list *bgp_fs_pbr;
 	/* presence of FS pbr iprule based entry */
@@ -269,13 +267,9 @@ struct bgp_path_info {
 	/* Attribute structure.  */
 	struct attr *attr;
 
-	/* Extra information */
+	/* Extra information, also holds the multipath information */
 	struct bgp_path_info_extra *extra;
 
-
-	/* Multipath information */
-	struct bgp_path_info_mpath *mpath;
-
 	/* Uptime.  */
 	time_t uptime;
 
@@ -292,7 +286,6 @@ struct bgp_path_info {
 #define BGP_PATH_ATTR_CHANGED (1 << 5)
 #define BGP_PATH_DMED_CHECK (1 << 6)
 #define BGP_PATH_DMED_SELECTED (1 << 7)
-#define BGP_PATH_STALE (1 << 8)
 #define BGP_PATH_REMOVED (1 << 9)
 #define BGP_PATH_COUNTED (1 << 10)
 #define BGP_PATH_MULTIPATH (1 << 11)
@@ -318,6 +311,9 @@ struct bgp_path_info {
 
 	unsigned short instance;
 
+	/* peer->stale_gen for the AFI/SAFI when last received */
+	uint16_t stale_gen;
+
 	/* Addpath identifiers */
 	uint32_t addpath_rx_id;
 	struct bgp_addpath_info_data tx_addpath;
@@ -579,7 +575,6 @@ static inline void prep_for_rmap_apply(struct bgp_path_info *dst_pi,
 	dst_pi->flags = src_pi->flags;
 	dst_pi->type = src_pi->type;
 	dst_pi->sub_type = src_pi->sub_type;
-	dst_pi->mpath = src_pi->mpath;
 	if (src_pi->extra) {
 		memcpy(dst_pie, src_pi->extra,
 		       sizeof(struct bgp_path_info_extra));
@@ -627,6 +622,13 @@ DECLARE_HOOK(bgp_process,
 	      struct peer *peer, bool withdraw),
 	     (bgp, afi, safi, bn, peer, withdraw));
 
+/* best path or its attributes changed, after the selected flags are set */
+DECLARE_HOOK(bgp_route_update,
+	     (struct bgp * bgp, afi_t afi, safi_t safi, struct bgp_dest *bn,
+	      struct bgp_path_info *old_route,
+	      struct bgp_path_info *new_route),
+	     (bgp, afi, safi, bn, old_route, new_route));
+
 /* BGP show options */
 #define BGP_SHOW_OPT_JSON (1 << 0)
 #define BGP_SHOW_OPT_WIDE (1 << 1)
@@ -637,6 +639,8 @@ DECLARE_HOOK(bgp_process,
 #define BGP_SHOW_OPT_FAILED (1 << 6)
 #define BGP_SHOW_OPT_DETAIL (1 << 7)
 #define BGP_SHOW_OPT_TERSE (1 << 8)
+/* output may be paused between batches, see vty_show_resume() */
+#define BGP_SHOW_OPT_RESUME (1 << 9)
 
 /* Prototypes. */
 extern void bgp_rib_remove(struct bgp_dest *dest, struct bgp_path_info *pi,
@@ -650,15 +654,22 @@ extern void bgp_announce_route(struct peer *peer, afi_t afi, safi_t safi,
 extern void bgp_stop_announce_route_timer(struct peer_af *paf);
 extern void bgp_announce_route_all(struct peer *);
 extern void bgp_default_originate(struct peer *, afi_t, safi_t, int);
+extern bool bgp_soft_reconfig_in_progress(struct peer *peer, afi_t afi,
+					  safi_t safi, uint32_t *done,
+					  uint32_t *total);
 extern void bgp_soft_reconfig_table_task_cancel(const struct bgp *bgp,
 						const struct bgp_table *table,
 						const struct peer *peer);
 extern void bgp_soft_reconfig_in(struct peer *, afi_t, safi_t);
+extern void bgp_soft_reconfig_in_prefix(struct peer *peer, afi_t afi,
+					safi_t safi, const struct prefix *p);
 extern void bgp_clear_route(struct peer *, afi_t, safi_t);
 extern void bgp_clear_route_all(struct peer *);
 extern void bgp_clear_adj_in(struct peer *, afi_t, safi_t);
+/* starts removing the stale paths, in the background */
 extern void bgp_clear_stale_route(struct peer *, afi_t, safi_t);
 extern void bgp_set_stale_route(struct peer *peer, afi_t afi, safi_t safi);
+extern bool bgp_path_info_stale(const struct bgp_path_info *pi);
 extern bool bgp_outbound_policy_exists(struct peer *, struct bgp_filter *);
 extern bool bgp_inbound_policy_exists(struct peer *, struct bgp_filter *);
 
@@ -781,7 +792,6 @@ extern void route_vty_out_overlay(struct vty *vty, const struct prefix *p,
 				  struct bgp_path_info *path, int display,
 				  json_object *json);
 
-extern void bgp_notify_conditional_adv_scanner(struct update_subgroup *subgrp);
 
 extern void subgroup_process_announce_selected(struct update_subgroup *subgrp,
 					       struct bgp_path_info *selected,
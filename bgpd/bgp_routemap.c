@@ -38,6 +38,7 @@
 #include "buffer.h"
 #include "sockunion.h"
 #include "hash.h"
+#include "jhash.h"
 #include "queue.h"
 #include "frrstr.h"
 #include "network.h"
@@ -69,6 +70,7 @@
 #include "bgpd/bgp_encap_types.h"
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_script.h"
+#include "bgpd/bgp_conditional_adv.h"
 
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
@@ -342,7 +344,9 @@ static const struct route_map_rule_cmd route_match_peer_cmd = {
 	"peer",
 	route_match_peer,
 	route_match_peer_compile,
-	route_match_peer_free
+	route_match_peer_free,
+	NULL,
+	RMAP_COST_LOW
 };
 
 #ifdef HAVE_SCRIPTING
@@ -366,16 +370,44 @@ enum frrlua_rm_status {
 	LUA_RM_MATCH_AND_CHANGE,
 };
 
+static const char *routematch_function = "route_match";
+
+/*
+ * The script is loaded once and kept with the compiled rule; it is only
+ * loaded again when the file changes.  Setting up a Lua state and parsing
+ * the script for every path made the match very slow on a full table.
+ */
+struct route_match_script {
+	char *name;
+	struct frrscript *fs;
+};
+
+static struct frrscript *route_match_script_get(struct route_match_script *rms)
+{
+	if (rms->fs && !frrscript_changed(rms->fs))
+		return rms->fs;
+
+	if (rms->fs)
+		frrscript_delete(rms->fs);
+
+	rms->fs = frrscript_new(rms->name);
+	if (frrscript_load(rms->fs, routematch_function, NULL)) {
+		frrscript_delete(rms->fs);
+		rms->fs = NULL;
+	}
+	return rms->fs;
+}
+
 static enum route_map_cmd_result_t
 route_match_script(void *rule, const struct prefix *prefix, void *object)
 {
-	const char *scriptname = rule;
-	const char *routematch_function = "route_match";
+	struct route_match_script *rms = rule;
+	const char *scriptname = rms->name;
 	struct bgp_path_info *path = (struct bgp_path_info *)object;
+	struct frrscript *fs;
 
-	struct frrscript *fs = frrscript_new(scriptname);
-
-	if (frrscript_load(fs, routematch_function, NULL)) {
+	fs = route_match_script_get(rms);
+	if (!fs) {
 		zlog_err(
 			"Issue loading script or function; defaulting to no match");
 		return RMAP_NOMATCH;
@@ -400,6 +432,9 @@ route_match_script(void *rule, const struct prefix *prefix, void *object)
 
 	int status = RMAP_NOMATCH;
 
+	if (!action)
+		return RMAP_NOMATCH;
+
 	switch (*action) {
 	case LUA_RM_FAILURE:
 		zlog_err(
@@ -433,30 +468,36 @@ route_match_script(void *rule, const struct prefix *prefix, void *object)
 
 	XFREE(MTYPE_SCRIPT_RES, action);
 
-	frrscript_delete(fs);
-
 	return status;
 }
 
 static void *route_match_script_compile(const char *arg)
 {
-	char *scriptname;
+	struct route_match_script *rms;
 
-	scriptname = XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+	rms = XCALLOC(MTYPE_ROUTE_MAP_COMPILED, sizeof(*rms));
+	rms->name = XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
 
-	return scriptname;
+	return rms;
 }
 
 static void route_match_script_free(void *rule)
 {
-	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
+	struct route_match_script *rms = rule;
+
+	if (rms->fs)
+		frrscript_delete(rms->fs);
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rms->name);
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rms);
 }
 
 static const struct route_map_rule_cmd route_match_script_cmd = {
 	"script",
 	route_match_script,
 	route_match_script_compile,
-	route_match_script_free
+	route_match_script_free,
+	NULL,
+	RMAP_COST_HIGH
 };
 
 #endif /* HAVE_SCRIPTING */
@@ -642,13 +683,43 @@ route_match_prefix_list_flowspec(afi_t afi, struct prefix_list *plist,
 	return RMAP_NOMATCH;
 }
 
+/* `match ip/ipv6 address prefix-list', resolved as of prefix_list_epoch() */
+struct rmap_plist {
+	char *name;
+	struct prefix_list *plist;
+	uint32_t epoch;
+};
+
+static void *route_match_address_prefix_list_compile(const char *arg)
+{
+	struct rmap_plist *rpl;
+
+	rpl = XCALLOC(MTYPE_ROUTE_MAP_COMPILED, sizeof(*rpl));
+	rpl->name = XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+	return rpl;
+}
+
+static void route_match_address_prefix_list_free(void *rule)
+{
+	struct rmap_plist *rpl = rule;
+
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rpl->name);
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rpl);
+}
+
 static enum route_map_cmd_result_t
 route_match_address_prefix_list(void *rule, afi_t afi,
 				const struct prefix *prefix, void *object)
 {
+	struct rmap_plist *rpl = rule;
 	struct prefix_list *plist;
 
-	plist = prefix_list_lookup(afi, (char *)rule);
+	if (rpl->epoch != prefix_list_epoch()) {
+		rpl->plist = prefix_list_lookup(afi, rpl->name);
+		rpl->epoch = prefix_list_epoch();
+	}
+
+	plist = rpl->plist;
 	if (plist == NULL)
 		return RMAP_NOMATCH;
 
@@ -666,22 +737,12 @@ route_match_ip_address_prefix_list(void *rule, const struct prefix *prefix,
 	return route_match_address_prefix_list(rule, AFI_IP, prefix, object);
 }
 
-static void *route_match_ip_address_prefix_list_compile(const char *arg)
-{
-	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
-}
-
-static void route_match_ip_address_prefix_list_free(void *rule)
-{
-	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
-}
-
 static const struct route_map_rule_cmd
 		route_match_ip_address_prefix_list_cmd = {
 	"ip address prefix-list",
 	route_match_ip_address_prefix_list,
-	route_match_ip_address_prefix_list_compile,
-	route_match_ip_address_prefix_list_free
+	route_match_address_prefix_list_compile,
+	route_match_address_prefix_list_free
 };
 
 /* `match ip next-hop prefix-list PREFIX_LIST' */
@@ -1298,7 +1359,8 @@ static void route_match_alias_free(void *rule)
 
 static const struct route_map_rule_cmd route_match_alias_cmd = {
 	"alias", route_match_alias, route_match_alias_compile,
-	route_match_alias_free};
+	route_match_alias_free, NULL, RMAP_COST_HIGH
+};
 
 /* `match local-preference LOCAL-PREF' */
 
@@ -1354,7 +1416,10 @@ static const struct route_map_rule_cmd route_match_local_pref_cmd = {
 	"local-preference",
 	route_match_local_pref,
 	route_match_local_pref_compile,
-	route_match_local_pref_free
+	route_match_local_pref_free,
+	NULL,
+	RMAP_COST_LOW,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `match metric METRIC' */
@@ -1377,19 +1442,34 @@ static const struct route_map_rule_cmd route_match_metric_cmd = {
 	route_match_metric,
 	route_value_compile,
 	route_value_free,
+	NULL,
+	RMAP_COST_LOW,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `match as-path ASPATH' */
+struct rmap_aslist {
+	char *name;
+
+	/* resolved as of as_list_epoch() == epoch */
+	struct as_list *as_list;
+	uint32_t epoch;
+};
 
 /* Match function for as-path match.  I assume given object is */
 static enum route_map_cmd_result_t
 route_match_aspath(void *rule, const struct prefix *prefix, void *object)
 {
-
+	struct rmap_aslist *ral = rule;
 	struct as_list *as_list;
 	struct bgp_path_info *path;
 
-	as_list = as_list_lookup((char *)rule);
+	if (ral->epoch != as_list_epoch()) {
+		ral->as_list = as_list_lookup(ral->name);
+		ral->epoch = as_list_epoch();
+	}
+
+	as_list = ral->as_list;
 	if (as_list == NULL)
 		return RMAP_NOMATCH;
 
@@ -1404,13 +1484,20 @@ route_match_aspath(void *rule, const struct prefix *prefix, void *object)
 /* Compile function for as-path match. */
 static void *route_match_aspath_compile(const char *arg)
 {
-	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+	struct rmap_aslist *ral;
+
+	ral = XCALLOC(MTYPE_ROUTE_MAP_COMPILED, sizeof(*ral));
+	ral->name = XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+	return ral;
 }
 
 /* Compile function for as-path match. */
 static void route_match_aspath_free(void *rule)
 {
-	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
+	struct rmap_aslist *ral = rule;
+
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, ral->name);
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, ral);
 }
 
 /* Route map commands for aspath matching. */
@@ -1418,7 +1505,10 @@ static const struct route_map_rule_cmd route_match_aspath_cmd = {
 	"as-path",
 	route_match_aspath,
 	route_match_aspath_compile,
-	route_match_aspath_free
+	route_match_aspath_free,
+	NULL,
+	RMAP_COST_HIGH,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `match community COMMUNIY' */
@@ -1426,8 +1516,23 @@ struct rmap_community {
 	char *name;
 	uint32_t name_hash;
 	int exact;
+
+	/* resolved as of community_list_epoch() == epoch */
+	struct community_list *list;
+	uint32_t epoch;
 };
 
+static struct community_list *rmap_community_list(struct rmap_community *rcom,
+						  int master)
+{
+	if (rcom->epoch != community_list_epoch()) {
+		rcom->list = community_list_lookup(bgp_clist, rcom->name,
+						   rcom->name_hash, master);
+		rcom->epoch = community_list_epoch();
+	}
+	return rcom->list;
+}
+
 /* Match function for community match. */
 static enum route_map_cmd_result_t
 route_match_community(void *rule, const struct prefix *prefix, void *object)
@@ -1439,8 +1544,7 @@ route_match_community(void *rule, const struct prefix *prefix, void *object)
 	path = object;
 	rcom = rule;
 
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     COMMUNITY_LIST_MASTER);
+	list = rmap_community_list(rcom, COMMUNITY_LIST_MASTER);
 	if (!list)
 		return RMAP_NOMATCH;
 
@@ -1512,7 +1616,9 @@ static const struct route_map_rule_cmd route_match_community_cmd = {
 	route_match_community,
 	route_match_community_compile,
 	route_match_community_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	RMAP_COST_HIGH,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* Match function for lcommunity match. */
@@ -1525,8 +1631,7 @@ route_match_lcommunity(void *rule, const struct prefix *prefix, void *object)
 
 	path = object;
 
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     LARGE_COMMUNITY_LIST_MASTER);
+	list = rmap_community_list(rcom, LARGE_COMMUNITY_LIST_MASTER);
 	if (!list)
 		return RMAP_NOMATCH;
 
@@ -1582,7 +1687,9 @@ static const struct route_map_rule_cmd route_match_lcommunity_cmd = {
 	route_match_lcommunity,
 	route_match_lcommunity_compile,
 	route_match_lcommunity_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	RMAP_COST_HIGH,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 
@@ -1596,8 +1703,7 @@ route_match_ecommunity(void *rule, const struct prefix *prefix, void *object)
 
 	path = object;
 
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     EXTCOMMUNITY_LIST_MASTER);
+	list = rmap_community_list(rcom, EXTCOMMUNITY_LIST_MASTER);
 	if (!list)
 		return RMAP_NOMATCH;
 
@@ -1633,7 +1739,10 @@ static const struct route_map_rule_cmd route_match_ecommunity_cmd = {
 	"extcommunity",
 	route_match_ecommunity,
 	route_match_ecommunity_compile,
-	route_match_ecommunity_free
+	route_match_ecommunity_free,
+	NULL,
+	RMAP_COST_HIGH,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `match nlri` and `set nlri` are replaced by `address-family ipv4`
@@ -1682,7 +1791,10 @@ static const struct route_map_rule_cmd route_match_origin_cmd = {
 	"origin",
 	route_match_origin,
 	route_match_origin_compile,
-	route_match_origin_free
+	route_match_origin_free,
+	NULL,
+	RMAP_COST_LOW,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* match probability  { */
@@ -1807,6 +1919,9 @@ static const struct route_map_rule_cmd route_match_tag_cmd = {
 	route_match_tag,
 	route_map_rule_tag_compile,
 	route_map_rule_tag_free,
+	NULL,
+	RMAP_COST_LOW,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 static enum route_map_cmd_result_t
@@ -2144,6 +2259,9 @@ static const struct route_map_rule_cmd route_set_aspath_prepend_cmd = {
 	route_set_aspath_prepend,
 	route_set_aspath_prepend_compile,
 	route_set_aspath_prepend_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set as-path exclude ASn' */
@@ -2176,6 +2294,9 @@ static const struct route_map_rule_cmd route_set_aspath_exclude_cmd = {
 	route_set_aspath_exclude,
 	route_aspath_compile,
 	route_aspath_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set as-path replace AS-PATH` */
@@ -2337,6 +2458,9 @@ static const struct route_map_rule_cmd route_set_community_cmd = {
 	route_set_community,
 	route_set_community_compile,
 	route_set_community_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set community COMMUNITY' */
@@ -2449,6 +2573,9 @@ static const struct route_map_rule_cmd route_set_lcommunity_cmd = {
 	route_set_lcommunity,
 	route_set_lcommunity_compile,
 	route_set_lcommunity_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set large-comm-list (<1-99>|<100-500>|WORD) delete' */
@@ -2468,8 +2595,7 @@ route_set_lcommunity_delete(void *rule, const struct prefix *pfx, void *object)
 		return RMAP_OKAY;
 
 	path = object;
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     LARGE_COMMUNITY_LIST_MASTER);
+	list = rmap_community_list(rcom, LARGE_COMMUNITY_LIST_MASTER);
 	old = bgp_attr_get_lcommunity(path->attr);
 
 	if (list && old) {
@@ -2531,6 +2657,9 @@ static const struct route_map_rule_cmd route_set_lcommunity_delete_cmd = {
 	route_set_lcommunity_delete,
 	route_set_lcommunity_delete_compile,
 	route_set_lcommunity_delete_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 
@@ -2552,8 +2681,7 @@ route_set_community_delete(void *rule, const struct prefix *prefix,
 		return RMAP_OKAY;
 
 	path = object;
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     COMMUNITY_LIST_MASTER);
+	list = rmap_community_list(rcom, COMMUNITY_LIST_MASTER);
 	old = bgp_attr_get_community(path->attr);
 
 	if (list && old) {
@@ -2615,6 +2743,9 @@ static const struct route_map_rule_cmd route_set_community_delete_cmd = {
 	route_set_community_delete,
 	route_set_community_delete_compile,
 	route_set_community_delete_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set extcommunity rt COMMUNITY' */
@@ -2715,6 +2846,9 @@ static const struct route_map_rule_cmd route_set_ecommunity_none_cmd = {
 	route_set_ecommunity,
 	route_set_ecommunity_none_compile,
 	route_set_ecommunity_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* Set community rule structure. */
@@ -2723,6 +2857,9 @@ static const struct route_map_rule_cmd route_set_ecommunity_rt_cmd = {
 	route_set_ecommunity,
 	route_set_ecommunity_rt_compile,
 	route_set_ecommunity_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set extcommunity soo COMMUNITY' */
@@ -2750,6 +2887,9 @@ static const struct route_map_rule_cmd route_set_ecommunity_soo_cmd = {
 	route_set_ecommunity,
 	route_set_ecommunity_soo_compile,
 	route_set_ecommunity_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set extcommunity bandwidth' */
@@ -2936,6 +3076,9 @@ static const struct route_map_rule_cmd route_set_origin_cmd = {
 	route_set_origin,
 	route_set_origin_compile,
 	route_set_origin_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set atomic-aggregate' */
@@ -2970,6 +3113,9 @@ static const struct route_map_rule_cmd route_set_atomic_aggregate_cmd = {
 	route_set_atomic_aggregate,
 	route_set_atomic_aggregate_compile,
 	route_set_atomic_aggregate_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* `set aggregator as AS A.B.C.D' */
@@ -3027,6 +3173,9 @@ static const struct route_map_rule_cmd route_set_aggregator_as_cmd = {
 	route_set_aggregator_as,
 	route_set_aggregator_as_compile,
 	route_set_aggregator_as_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* Set tag to object. object must be pointer to struct bgp_path_info */
@@ -3051,6 +3200,9 @@ static const struct route_map_rule_cmd route_set_tag_cmd = {
 	route_set_tag,
 	route_map_rule_tag_compile,
 	route_map_rule_tag_free,
+	NULL,
+	RMAP_COST_DEFAULT,
+	RMAP_RULE_PREFIX_INDEPENDENT
 };
 
 /* Set label-index to object. object must be pointer to struct bgp_path_info */
@@ -3273,22 +3425,12 @@ route_match_ipv6_address_prefix_list(void *rule, const struct prefix *prefix,
 	return route_match_address_prefix_list(rule, AFI_IP6, prefix, object);
 }
 
-static void *route_match_ipv6_address_prefix_list_compile(const char *arg)
-{
-	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
-}
-
-static void route_match_ipv6_address_prefix_list_free(void *rule)
-{
-	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
-}
-
 static const struct route_map_rule_cmd
 		route_match_ipv6_address_prefix_list_cmd = {
 	"ipv6 address prefix-list",
 	route_match_ipv6_address_prefix_list,
-	route_match_ipv6_address_prefix_list_compile,
-	route_match_ipv6_address_prefix_list_free
+	route_match_address_prefix_list_compile,
+	route_match_address_prefix_list_free
 };
 
 /* `match ipv6 next-hop type <TYPE>' */
@@ -3814,6 +3956,8 @@ static void bgp_route_map_process_peer(const char *rmap_name,
 
 	/* Notify BGP conditional advertisement scanner percess */
 	peer->advmap_config_change[afi][safi] = true;
+	if (filter->advmap.aname)
+		bgp_conditional_adv_schedule(peer->bgp);
 }
 
 static void bgp_route_map_update_peer_group(const char *rmap_name,
@@ -4130,8 +4274,149 @@ static void bgp_route_map_mark_update(const char *rmap_name)
 	}
 }
 
+/*
+ * Results of prefix independent route-maps, for (route-map, attributes).
+ * Outbound policy is applied to every prefix separately, but a lot of
+ * them usually share their attributes.  The attributes are compared in
+ * full, and only used as key if their parts are all interned, so both
+ * the input and the output can be referenced for as long as the entry
+ * exists.  Any route-map event, and any change in an as-path or
+ * community list, drops all of it.
+ */
+struct bgp_rmap_cache_entry {
+	struct route_map *map;
+	unsigned int hashval;
+
+	struct attr in;
+	struct attr *in_ref;
+
+	route_map_result_t ret;
+	struct attr out;
+	struct attr *out_ref;
+};
+
+#define BGP_RMAP_CACHE_MAX 4096
+
+static struct hash *bgp_rmap_cache;
+static uint32_t bgp_rmap_cache_gen, bgp_rmap_cache_rmap_gen;
+static uint32_t bgp_rmap_cache_aslist, bgp_rmap_cache_clist;
+
+static unsigned int bgp_rmap_cache_key(const void *arg)
+{
+	const struct bgp_rmap_cache_entry *e = arg;
+
+	return e->hashval;
+}
+
+static bool bgp_rmap_cache_cmp(const void *arg1, const void *arg2)
+{
+	const struct bgp_rmap_cache_entry *e1 = arg1, *e2 = arg2;
+
+	return e1->map == e2->map && !memcmp(&e1->in, &e2->in, sizeof(e1->in));
+}
+
+static void bgp_rmap_cache_entry_free(void *arg)
+{
+	struct bgp_rmap_cache_entry *e = arg;
+
+	bgp_attr_unintern(&e->in_ref);
+	if (e->out_ref)
+		bgp_attr_unintern(&e->out_ref);
+	XFREE(MTYPE_BGP_RMAP_CACHE, e);
+}
+
+static void bgp_rmap_cache_flush(void)
+{
+	if (bgp_rmap_cache)
+		hash_clean(bgp_rmap_cache, bgp_rmap_cache_entry_free);
+}
+
+/* all parts held by reference are interned */
+static bool bgp_rmap_cache_attr_ok(struct attr *attr)
+{
+#define INTERNED(x) (!(x) || (x)->refcnt)
+	return INTERNED(attr->aspath) && INTERNED(bgp_attr_get_community(attr))
+	       && INTERNED(bgp_attr_get_ecommunity(attr))
+	       && INTERNED(bgp_attr_get_ipv6_ecommunity(attr))
+	       && INTERNED(bgp_attr_get_lcommunity(attr))
+	       && INTERNED(bgp_attr_get_cluster(attr))
+	       && INTERNED(bgp_attr_get_transit(attr))
+	       && INTERNED(attr->encap_subtlvs) && INTERNED(attr->srv6_l3vpn)
+	       && INTERNED(attr->srv6_vpn)
+#ifdef ENABLE_BGP_VNC
+	       && INTERNED(bgp_attr_get_vnc_subtlvs(attr))
+#endif
+		;
+#undef INTERNED
+}
+
+route_map_result_t bgp_route_map_apply_cached(struct route_map *map,
+					      const struct prefix *p,
+					      struct bgp_path_info *path)
+{
+	struct bgp_rmap_cache_entry *e, key;
+	struct attr *attr = path->attr;
+	unsigned long refcnt;
+
+	if (!route_map_prefix_independent(map) || !bgp_rmap_cache_attr_ok(attr))
+		return route_map_apply(map, p, path);
+
+	if (bgp_rmap_cache_rmap_gen != bgp_rmap_cache_gen
+	    || bgp_rmap_cache_aslist != as_list_epoch()
+	    || bgp_rmap_cache_clist != community_list_epoch()) {
+		bgp_rmap_cache_flush();
+		bgp_rmap_cache_rmap_gen = bgp_rmap_cache_gen;
+		bgp_rmap_cache_aslist = as_list_epoch();
+		bgp_rmap_cache_clist = community_list_epoch();
+	}
+
+	if (!bgp_rmap_cache)
+		bgp_rmap_cache = hash_create_size(256, bgp_rmap_cache_key,
+						  bgp_rmap_cache_cmp,
+						  "BGP route-map results");
+
+	key.map = map;
+	memcpy(&key.in, attr, sizeof(key.in));
+	key.in.refcnt = 0;
+	key.hashval = jhash_1word(attrhash_key_make(attr),
+				  (uint32_t)(uintptr_t)map);
+
+	e = hash_lookup(bgp_rmap_cache, &key);
+	if (e) {
+		map->applied++;
+		if (e->ret != RMAP_DENYMATCH) {
+			refcnt = attr->refcnt;
+			memcpy(attr, &e->out, sizeof(*attr));
+			attr->refcnt = refcnt;
+		}
+		return e->ret;
+	}
+
+	if (bgp_rmap_cache->count >= BGP_RMAP_CACHE_MAX)
+		bgp_rmap_cache_flush();
+
+	e = XCALLOC(MTYPE_BGP_RMAP_CACHE, sizeof(*e));
+	e->map = map;
+	e->hashval = key.hashval;
+	memcpy(&e->in, &key.in, sizeof(e->in));
+	/* only takes references, the parts are interned */
+	e->in_ref = bgp_attr_intern(&e->in);
+
+	e->ret = route_map_apply(map, p, path);
+	if (e->ret != RMAP_DENYMATCH) {
+		/* the route-map's new parts become interned in place */
+		e->out_ref = bgp_attr_intern(attr);
+		memcpy(&e->out, attr, sizeof(e->out));
+		e->out.refcnt = 0;
+	}
+
+	(void)hash_get(bgp_rmap_cache, e, hash_alloc_intern);
+	return e->ret;
+}
+
 static void bgp_route_map_add(const char *rmap_name)
 {
+	bgp_rmap_cache_gen++;
 	if (route_map_mark_updated(rmap_name) == 0)
 		bgp_route_map_mark_update(rmap_name);
 
@@ -4140,6 +4425,7 @@ static void bgp_route_map_add(const char *rmap_name)
 
 static void bgp_route_map_delete(const char *rmap_name)
 {
+	bgp_rmap_cache_gen++;
 	if (route_map_mark_updated(rmap_name) == 0)
 		bgp_route_map_mark_update(rmap_name);
 
@@ -4148,6 +4434,7 @@ static void bgp_route_map_delete(const char *rmap_name)
 
 static void bgp_route_map_event(const char *rmap_name)
 {
+	bgp_rmap_cache_gen++;
 	if (route_map_mark_updated(rmap_name) == 0)
 		bgp_route_map_mark_update(rmap_name);
 
@@ -6973,6 +7260,12 @@ void bgp_route_map_init(void)
 
 void bgp_route_map_terminate(void)
 {
+	if (bgp_rmap_cache) {
+		bgp_rmap_cache_flush();
+		hash_free(bgp_rmap_cache);
+		bgp_rmap_cache = NULL;
+	}
+
 	/* ToDo: Cleanup all the used memory */
 	route_map_finish();
 }
@@ -40,6 +40,8 @@
 #include "memory.h"
 #include "thread.h"
 #include "filter.h"
+#include "jhash.h"
+#include "typesafe.h"
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
 #include "bgp_advertise.h"
@@ -66,12 +68,18 @@
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE, "BGP RPKI Cache server");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE_GROUP, "BGP RPKI Cache server group");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_RTRLIB, "BGP RPKI RTRLib");
+DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_VALIDITY, "BGP RPKI validity cache");
 
 #define POLLING_PERIOD_DEFAULT 3600
 #define EXPIRE_INTERVAL_DEFAULT 7200
 #define RETRY_INTERVAL_DEFAULT 600
 #define BGP_RPKI_CACHE_SERVER_SYNC_RETRY_TIMEOUT 3
 
+/* ROA changes handled per run of bgpd_sync_callback() */
+#define RPKI_SYNC_BATCH 256
+/* the validity cache is flushed when it gets this big */
+#define RPKI_VALIDITY_MAX (1 << 20)
+
 static struct thread *t_rpki_sync;
 
 #define RPKI_DEBUG(...)                                                        \
@@ -94,6 +102,40 @@ struct cache {
 
 enum return_values { SUCCESS = 0, ERROR = -1 };
 
+/*
+ * Results of rpki_validate_prefix() by (prefix, origin AS), so route-maps
+ * and "show bgp ... rpki" don't go into rtrlib for every path.  Flushed
+ * whenever ROAs change; the change records are only read after rtrlib
+ * updated its table, so nothing older than the last flush can be stale.
+ */
+PREDECL_HASH(rpki_validity);
+
+struct rpki_validity {
+	struct rpki_validity_item item;
+
+	struct prefix prefix;
+	as_t asn;
+	int state;
+};
+
+static int rpki_validity_cmp(const struct rpki_validity *a,
+			     const struct rpki_validity *b)
+{
+	if (a->asn != b->asn)
+		return numcmp(a->asn, b->asn);
+	return prefix_cmp(&a->prefix, &b->prefix);
+}
+
+static uint32_t rpki_validity_hash(const struct rpki_validity *v)
+{
+	return jhash_1word(v->asn, prefix_hash_key(&v->prefix));
+}
+
+DECLARE_HASH(rpki_validity, struct rpki_validity, item, rpki_validity_cmp,
+	     rpki_validity_hash);
+
+static struct rpki_validity_head rpki_validity;
+
 struct rpki_for_each_record_arg {
 	struct vty *vty;
 	unsigned int *prefix_amount;
@@ -375,10 +417,18 @@ inline bool is_stopping(void)
 	return rtr_is_stopping;
 }
 
-static struct prefix *pfx_record_to_prefix(struct pfx_record *record)
+static void rpki_validity_flush(void)
 {
-	struct prefix *prefix = prefix_new();
+	struct rpki_validity *v;
 
+	while ((v = rpki_validity_pop(&rpki_validity)))
+		XFREE(MTYPE_BGP_RPKI_VALIDITY, v);
+}
+
+static void pfx_record_to_prefix(const struct pfx_record *record,
+				 struct prefix *prefix)
+{
+	memset(prefix, 0, sizeof(*prefix));
 	prefix->prefixlen = record->min_len;
 
 	if (record->prefix.ver == LRTR_IPV4) {
@@ -389,40 +439,37 @@ static struct prefix *pfx_record_to_prefix(struct pfx_record *record)
 		ipv6_addr_to_network_byte_order(record->prefix.u.addr6.addr,
 						prefix->u.prefix6.s6_addr32);
 	}
-
-	return prefix;
 }
 
-static void bgpd_sync_callback(struct thread *thread)
+/*
+ * Adds p to the n prefixes whose routes need revalidation, unless one of
+ * them already covers it.  Returns the new count.
+ */
+static unsigned int rpki_changed_add(struct prefix *changed, unsigned int n,
+				     const struct prefix *p)
 {
-	struct bgp *bgp;
-	struct listnode *node;
-	struct prefix *prefix;
-	struct pfx_record rec;
+	unsigned int i;
 
-	thread_add_read(bm->master, bgpd_sync_callback, NULL,
-			rpki_sync_socket_bgpd, NULL);
-
-	if (atomic_load_explicit(&rtr_update_overflow, memory_order_seq_cst)) {
-		while (read(rpki_sync_socket_bgpd, &rec,
-			    sizeof(struct pfx_record)) != -1)
-			;
+	for (i = 0; i < n; i++)
+		if (prefix_match(&changed[i], p))
+			return n;
 
-		atomic_store_explicit(&rtr_update_overflow, 0,
-				      memory_order_seq_cst);
-		revalidate_all_routes();
-		return;
+	for (i = 0; i < n;) {
+		if (prefix_match(p, &changed[i]))
+			changed[i] = changed[--n];
+		else
+			i++;
 	}
 
-	int retval =
-		read(rpki_sync_socket_bgpd, &rec, sizeof(struct pfx_record));
-	if (retval != sizeof(struct pfx_record)) {
-		RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
-		return;
-	}
-	prefix = pfx_record_to_prefix(&rec);
+	changed[n++] = *p;
+	return n;
+}
 
-	afi_t afi = (rec.prefix.ver == LRTR_IPV4) ? AFI_IP : AFI_IP6;
+static void revalidate_prefix(const struct prefix *prefix)
+{
+	struct bgp *bgp;
+	struct listnode *node;
+	afi_t afi = family2afi(prefix->family);
 
 	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
 		safi_t safi;
@@ -447,8 +494,56 @@ static void bgpd_sync_callback(struct thread *thread)
 			}
 		}
 	}
+}
+
+static void bgpd_sync_callback(struct thread *thread)
+{
+	struct prefix changed[RPKI_SYNC_BATCH], prefix;
+	struct pfx_record rec;
+	unsigned int nrec = 0, nchanged = 0, i;
+
+	thread_add_read(bm->master, bgpd_sync_callback, NULL,
+			rpki_sync_socket_bgpd, NULL);
+
+	if (atomic_load_explicit(&rtr_update_overflow, memory_order_seq_cst)) {
+		while (read(rpki_sync_socket_bgpd, &rec,
+			    sizeof(struct pfx_record)) != -1)
+			;
+
+		atomic_store_explicit(&rtr_update_overflow, 0,
+				      memory_order_seq_cst);
+		rpki_validity_flush();
+		revalidate_all_routes();
+		return;
+	}
+
+	/*
+	 * ROAs usually change in bursts, take what's there and revalidate
+	 * every affected subtree once.  More is picked up on the next run.
+	 */
+	while (nrec < RPKI_SYNC_BATCH) {
+		int retval = read(rpki_sync_socket_bgpd, &rec,
+				  sizeof(struct pfx_record));
+
+		if (retval != sizeof(struct pfx_record)) {
+			if (!nrec)
+				RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
+			break;
+		}
+
+		nrec++;
+		pfx_record_to_prefix(&rec, &prefix);
+		nchanged = rpki_changed_add(changed, nchanged, &prefix);
+	}
+
+	if (!nrec)
+		return;
 
-	prefix_free(&prefix);
+	RPKI_DEBUG("%u ROA changes, revalidating %u prefixes", nrec, nchanged);
+
+	rpki_validity_flush();
+	for (i = 0; i < nchanged; i++)
+		revalidate_prefix(&changed[i]);
 }
 
 static void revalidate_bgp_node(struct bgp_dest *bgp_dest, afi_t afi,
@@ -562,6 +657,7 @@ static int bgp_rpki_init(struct thread_master *master)
 
 	cache_list = list_new();
 	cache_list->del = (void (*)(void *)) & free_cache;
+	rpki_validity_init(&rpki_validity);
 
 	polling_period = POLLING_PERIOD_DEFAULT;
 	expire_interval = EXPIRE_INTERVAL_DEFAULT;
@@ -575,6 +671,7 @@ static int bgp_rpki_fini(void)
 {
 	stop();
 	list_delete(&cache_list);
+	rpki_validity_fini(&rpki_validity);
 
 	close(rpki_sync_socket_rtr);
 	close(rpki_sync_socket_bgpd);
@@ -660,6 +757,7 @@ static void stop(void)
 		rtr_mgr_free(rtr_config);
 		rtr_is_running = false;
 	}
+	rpki_validity_flush();
 }
 
 static int reset(bool force)
@@ -792,6 +890,8 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 	as_t as_number = 0;
 	struct lrtr_ip_addr ip_addr_prefix;
 	enum pfxv_state result;
+	struct rpki_validity key, *v;
+	int state;
 
 	if (!is_synchronized())
 		return RPKI_NOT_BEING_USED;
@@ -837,6 +937,13 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 		return RPKI_NOT_BEING_USED;
 	}
 
+	memset(&key, 0, sizeof(key));
+	prefix_copy(&key.prefix, prefix);
+	key.asn = as_number;
+	v = rpki_validity_find(&rpki_validity, &key);
+	if (v)
+		return v->state;
+
 	// Do the actual validation
 	rtr_mgr_validate(rtr_config, as_number, &ip_addr_prefix,
 			 prefix->prefixlen, &result);
@@ -847,24 +954,36 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: VALID",
 			prefix, as_number);
-		return RPKI_VALID;
+		state = RPKI_VALID;
+		break;
 	case BGP_PFXV_STATE_NOT_FOUND:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: NOT FOUND",
 			prefix, as_number);
-		return RPKI_NOTFOUND;
+		state = RPKI_NOTFOUND;
+		break;
 	case BGP_PFXV_STATE_INVALID:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: INVALID",
 			prefix, as_number);
-		return RPKI_INVALID;
+		state = RPKI_INVALID;
+		break;
 	default:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: CANNOT VALIDATE",
 			prefix, as_number);
-		break;
+		return RPKI_NOT_BEING_USED;
 	}
-	return RPKI_NOT_BEING_USED;
+
+	if (rpki_validity_count(&rpki_validity) >= RPKI_VALIDITY_MAX)
+		rpki_validity_flush();
+
+	v = XCALLOC(MTYPE_BGP_RPKI_VALIDITY, sizeof(*v));
+	*v = key;
+	v->state = state;
+	rpki_validity_add(&rpki_validity, v);
+
+	return state;
 }
 
 static int add_cache(struct cache *cache)
@@ -30,6 +30,7 @@
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgp_addpath.h"
 #include "bgp_trace.h"
 
@@ -127,6 +128,8 @@ static void bgp_node_destroy(route_table_delegate_t *delegate,
 					 rt->afi, rt->safi);
 	}
 
+	bgp_nhg_release(bgp_node->nhg_id);
+
 	XFREE(MTYPE_BGP_NODE, bgp_node);
 }
 
@@ -134,8 +137,10 @@ static void bgp_node_destroy(route_table_delegate_t *delegate,
  * Function vector to customize the behavior of the route table
  * library for BGP route tables.
  */
-route_table_delegate_t bgp_table_delegate = {.create_node = bgp_node_create,
-					     .destroy_node = bgp_node_destroy};
+route_table_delegate_t bgp_table_delegate = {
+	.create_node = bgp_node_create,
+	.destroy_node = bgp_node_destroy,
+	.stride = ROUTE_TABLE_STRIDE_MAX};
 
 /*
  * bgp_table_init
@@ -48,6 +48,8 @@ struct bgp_table {
 
 	/* list of peers on which soft_reconfig_table has to run */
 	struct list *soft_reconfig_peers;
+	/* progress, in bgp_dest with some adj_in */
+	uint32_t soft_reconfig_done, soft_reconfig_total;
 
 	struct route_table *route_table;
 	uint64_t version;
@@ -113,10 +115,22 @@ struct bgp_node {
 #define BGP_NODE_FIB_INSTALLED          (1 << 6)
 #define BGP_NODE_LABEL_REQUESTED        (1 << 7)
 #define BGP_NODE_SOFT_RECONFIG (1 << 8)
+#define BGP_NODE_PROCESS_HINTED (1 << 9)
 
-	struct bgp_addpath_node_data tx_addpath;
+	/* addpath strategies the paths have their TX IDs for */
+	uint8_t addpath_ids;
+
+	/* allocated once the paths got addpath TX IDs */
+	struct bgp_addpath_node_data *tx_addpath;
 
 	enum bgp_path_selection_reason reason;
+
+	/* shared nexthop group the route is installed with, if any */
+	uint32_t nhg_id;
+
+	/* index into compact adj-out arrays, and how many have it set */
+	uint32_t adj_out_idx;
+	uint32_t adj_out_compact;
 };
 
 extern void bgp_delete_listnode(struct bgp_dest *dest);
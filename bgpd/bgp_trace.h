@@ -38,6 +38,7 @@
 #include "lib/stream.h"
 #include "bgpd/bgp_evpn_private.h"
 #include "bgpd/bgp_evpn_mh.h"
+#include "bgpd/bgp_updgrp.h"
 
 
 /* clang-format off */
@@ -94,6 +95,22 @@ TRACEPOINT_EVENT(
 
 TRACEPOINT_LOGLEVEL(frr_bgp, process_update, TRACE_INFO)
 
+TRACEPOINT_EVENT(
+	frr_bgp,
+	pipeline_latency,
+	TP_ARGS(struct peer *, peer, const char *, stage, afi_t, afi, safi_t,
+		safi, int64_t, usec),
+	TP_FIELDS(
+		ctf_string(peer, PEER_HOSTNAME(peer))
+		ctf_string(stage, stage)
+		ctf_integer(afi_t, afi, afi)
+		ctf_integer(safi_t, safi, safi)
+		ctf_integer(int64_t, usec, usec)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_bgp, pipeline_latency, TRACE_INFO)
+
 TRACEPOINT_EVENT(
 	frr_bgp,
 	input_filter,
@@ -475,6 +492,22 @@ TRACEPOINT_EVENT(
 	)
 )
 TRACEPOINT_LOGLEVEL(frr_bgp, evpn_local_l3vni_del_zrecv, TRACE_INFO)
+TRACEPOINT_EVENT(
+	frr_bgp,
+	update_packet_build,
+	TP_ARGS(struct update_subgroup *, subgrp, int, withdraw,
+		unsigned int, num_pfx, size_t, length),
+	TP_FIELDS(
+		ctf_integer(uint64_t, update_group, subgrp->update_group->id)
+		ctf_integer(uint64_t, subgroup, subgrp->id)
+		ctf_integer(int, afi, SUBGRP_AFI(subgrp))
+		ctf_integer(int, safi, SUBGRP_SAFI(subgrp))
+		ctf_integer(int, withdraw, withdraw)
+		ctf_integer(unsigned int, num_pfx, num_pfx)
+		ctf_integer(size_t, length, length)
+	)
+)
+TRACEPOINT_LOGLEVEL(frr_bgp, update_packet_build, TRACE_INFO)
 /* clang-format on */
 
 #include <lttng/tracepoint-event.h>
@@ -648,6 +648,12 @@ subgroup_total_packets_enqueued(struct update_subgroup *subgrp)
 	return pkt->ver - 1;
 }
 
+/* how well UPDATEs got packed */
+static double updgrp_nlri_average(uint64_t updates, uint64_t nlri)
+{
+	return updates ? (double)nlri / updates : 0.0;
+}
+
 static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 {
 	struct updwalk_context *ctx = arg;
@@ -729,14 +735,32 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 			subgrp->peer_refreshes_combined);
 		vty_out(vty, "    Merge checks triggered: %u\n",
 			subgrp->merge_checks_triggered);
+		vty_out(vty, "    Adj-out entries copied on split: %" PRIu64 "\n",
+			subgrp->split_adj_copied);
+		if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_COMPACT))
+			vty_out(vty, "    Compact adj-out: %u prefixes%s\n",
+				bgp_adj_out_compact_count(subgrp),
+				subgrp->adj_compact
+						&& subgrp->adj_compact->refcnt > 1
+					? " (shared)"
+					: "");
 		vty_out(vty, "    Coalesce Time: %u%s\n",
 			(UPDGRP_INST(subgrp->update_group))->coalesce_time,
 			subgrp->t_coalesce ? "(Running)" : "");
+		if ((UPDGRP_INST(subgrp->update_group))->batch_adaptive)
+			vty_out(vty, "    Batching window: %u ms%s\n",
+				subgrp->v_batch,
+				subgrp->t_batch ? "(Running)" : "");
 		vty_out(vty, "    Version: %" PRIu64 "\n", subgrp->version);
 		vty_out(vty, "    Packet queue length: %d\n",
 			bpacket_queue_length(SUBGRP_PKTQ(subgrp)));
 		vty_out(vty, "    Total packets enqueued: %u\n",
 			subgroup_total_packets_enqueued(subgrp));
+		vty_out(vty, "    NLRI per UPDATE: %.1f (%" PRIu64
+			" UPDATEs)\n",
+			updgrp_nlri_average(subgrp->updates_built,
+					    subgrp->updates_nlri),
+			subgrp->updates_built);
 		vty_out(vty, "    Packet queue high watermark: %d\n",
 			bpacket_queue_hwm_length(SUBGRP_PKTQ(subgrp)));
 		vty_out(vty, "    Adj-out list count: %u\n", subgrp->adj_count);
@@ -893,6 +917,11 @@ update_subgroup_create(struct update_group *updgrp)
 	bpacket_queue_init(SUBGRP_PKTQ(subgrp));
 	bpacket_queue_add(SUBGRP_PKTQ(subgrp), NULL, NULL);
 	TAILQ_INIT(&(subgrp->adjq));
+	if (CHECK_FLAG(UPDGRP_INST(updgrp)->flags, BGP_FLAG_ADJ_OUT_COMPACT)
+	    && UPDGRP_PEER(updgrp)->addpath_type[UPDGRP_AFI(updgrp)]
+						[UPDGRP_SAFI(updgrp)]
+		       == BGP_ADDPATH_NONE)
+		SET_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_COMPACT);
 	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
 		zlog_debug("create subgroup u%" PRIu64 ":s%" PRIu64, updgrp->id,
 			   subgrp->id);
@@ -914,6 +943,7 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 
 	THREAD_OFF(subgrp->t_merge_check);
 	THREAD_OFF(subgrp->t_coalesce);
+	THREAD_OFF(subgrp->t_batch);
 
 	bpacket_queue_cleanup(SUBGRP_PKTQ(subgrp));
 	subgroup_clear_table(subgrp);
@@ -1149,6 +1179,12 @@ static int update_subgroup_can_merge_into(struct update_subgroup *subgrp,
 	if (subgrp->adj_count != target->adj_count)
 		return 0;
 
+	if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_COMPACT)
+		    != CHECK_FLAG(target->sflags, SUBGRP_STATUS_ADJ_COMPACT)
+	    || bgp_adj_out_compact_count(subgrp)
+		       != bgp_adj_out_compact_count(target))
+		return 0;
+
 	return update_subgroup_ready_for_merge(target);
 }
 
@@ -1162,11 +1198,13 @@ static void update_subgroup_merge(struct update_subgroup *subgrp,
 				  const char *reason)
 {
 	struct peer_af *paf;
+	struct timeval start;
 	int result;
 	int peer_count;
 
 	assert(subgrp->adj_count == target->adj_count);
 
+	monotime(&start);
 	peer_count = subgrp->peer_count;
 
 	while (1) {
@@ -1186,6 +1224,7 @@ static void update_subgroup_merge(struct update_subgroup *subgrp,
 	}
 
 	SUBGRP_INCR_STAT(target, merge_events);
+	SUBGRP_INCR_STAT_BY(target, merge_usecs, monotime_since(&start, NULL));
 
 	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
 		zlog_debug("u%" PRIu64 ":s%" PRIu64" (%d peers) merged into u%" PRIu64 ":s%" PRIu64", trigger: %s",
@@ -1281,6 +1320,15 @@ static void update_subgroup_copy_adj_out(struct update_subgroup *source,
 					 struct update_subgroup *dest)
 {
 	struct bgp_adj_out *aout, *aout_copy;
+	uint32_t copied = 0;
+
+	/* the copy keeps the mode of the source */
+	if (CHECK_FLAG(source->sflags, SUBGRP_STATUS_ADJ_COMPACT)) {
+		bgp_adj_out_compact_copy(source, dest);
+		dest->scount = source->scount;
+		return;
+	}
+	UNSET_FLAG(dest->sflags, SUBGRP_STATUS_ADJ_COMPACT);
 
 	SUBGRP_FOREACH_ADJ (source, aout) {
 		/*
@@ -1290,8 +1338,10 @@ static void update_subgroup_copy_adj_out(struct update_subgroup *source,
 					      aout->addpath_tx_id);
 		aout_copy->attr =
 			aout->attr ? bgp_attr_intern(aout->attr) : NULL;
+		copied++;
 	}
 
+	SUBGRP_INCR_STAT_BY(dest, split_adj_copied, copied);
 	dest->scount = source->scount;
 }
 
@@ -1483,7 +1533,11 @@ static int updgrp_policy_update_walkcb(struct update_group *updgrp, void *arg)
 					"u%" PRIu64 ":s%" PRIu64" announcing routes upon policy %s (type %d) change",
 					updgrp->id, subgrp->id,
 					ctx->policy_name, ctx->policy_type);
-			subgroup_announce_route(subgrp);
+			if (ctx->policy_prefix)
+				subgroup_announce_prefix(subgrp,
+							 ctx->policy_prefix);
+			else
+				subgroup_announce_route(subgrp);
 		}
 		if (def_changed) {
 			if (bgp_debug_update(NULL, NULL, updgrp, 0))
@@ -1570,6 +1624,24 @@ void update_group_policy_update(struct bgp *bgp, enum bgp_policy_type ptype,
 	update_group_walk(bgp, updgrp_policy_update_walkcb, &ctx);
 }
 
+/*
+ * A single entry of prefix-list pname changed; only routes covered by p
+ * are announced again.
+ */
+void update_group_prefix_list_update(struct bgp *bgp, const char *pname,
+				     const struct prefix *p)
+{
+	struct updwalk_context ctx;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.policy_type = BGP_POLICY_PREFIX_LIST;
+	ctx.policy_name = pname;
+	ctx.policy_prefix = p;
+	ctx.policy_route_update = true;
+
+	update_group_walk(bgp, updgrp_policy_update_walkcb, &ctx);
+}
+
 /*
  * update_subgroup_split_peer
  *
@@ -1580,6 +1652,7 @@ void update_subgroup_split_peer(struct peer_af *paf,
 				struct update_group *updgrp)
 {
 	struct update_subgroup *old_subgrp, *subgrp;
+	struct timeval start;
 	uint64_t old_id;
 
 
@@ -1632,6 +1705,7 @@ void update_subgroup_split_peer(struct peer_af *paf,
 	 * Create a new subgroup under the specified update group, and copy
 	 * over relevant state to it.
 	 */
+	monotime(&start);
 	subgrp = update_subgroup_create(updgrp);
 	update_subgroup_inherit_info(subgrp, old_subgrp);
 
@@ -1643,6 +1717,7 @@ void update_subgroup_split_peer(struct peer_af *paf,
 	 */
 	update_subgroup_copy_adj_out(paf->subgroup, subgrp);
 	update_subgroup_copy_packets(subgrp, paf->next_pkt_to_send);
+	SUBGRP_INCR_STAT_BY(subgrp, split_usecs, monotime_since(&start, NULL));
 
 	if (BGP_DEBUG(update_groups, UPDATE_GROUPS))
 		zlog_debug("u%" PRIu64 ":s%" PRIu64" peer %s split and moved into u%" PRIu64":s%" PRIu64,
@@ -1726,6 +1801,23 @@ void update_group_show_stats(struct bgp *bgp, struct vty *vty)
 		bgp->update_group_stats.peer_refreshes_combined);
 	vty_out(vty, "Merge checks triggered: %u\n",
 		bgp->update_group_stats.merge_checks_triggered);
+	vty_out(vty, "Time spent in splits: %" PRIu64 " usecs\n",
+		bgp->update_group_stats.split_usecs);
+	vty_out(vty, "Time spent in merges: %" PRIu64 " usecs\n",
+		bgp->update_group_stats.merge_usecs);
+	vty_out(vty, "Adj-out entries copied on split: %" PRIu64 "\n",
+		bgp->update_group_stats.split_adj_copied);
+	vty_out(vty, "Compact adj-outs shared on split: %u\n",
+		bgp->update_group_stats.adj_share_events);
+	vty_out(vty, "Compact adj-outs copied on write: %u\n",
+		bgp->update_group_stats.adj_unshare_events);
+	vty_out(vty, "UPDATEs built: %" PRIu64 "\n",
+		bgp->update_group_stats.updates_built);
+	vty_out(vty, "NLRI in built UPDATEs: %" PRIu64 "\n",
+		bgp->update_group_stats.updates_nlri);
+	vty_out(vty, "Average NLRI per UPDATE: %.1f\n",
+		updgrp_nlri_average(bgp->update_group_stats.updates_built,
+				    bgp->update_group_stats.updates_nlri));
 }
 
 /*
@@ -51,6 +51,20 @@
 #define BGP_MAX_SUBGROUP_COALESCE_TIME 10000
 #define BGP_PEER_ADJUST_SUBGROUP_COALESCE_TIME 50
 
+/*
+ * With "update-batching adaptive", changes to a subgroup are held back for
+ * a window of v_batch ms before packets are built.  The window doubles
+ * (starting at BGP_BATCH_STEP) after one that saw at least
+ * BGP_BATCH_BUSY_CHANGES changes, or left at least BGP_BATCH_BUSY_PACKETS
+ * packets queued, and halves otherwise; it always stays within the
+ * configured bounds.
+ */
+#define BGP_BATCH_DEFAULT_MIN 0
+#define BGP_BATCH_DEFAULT_MAX 1000
+#define BGP_BATCH_STEP 10
+#define BGP_BATCH_BUSY_CHANGES 256
+#define BGP_BATCH_BUSY_PACKETS 32
+
 #define PEER_UPDGRP_FLAGS                                                      \
 	(PEER_FLAG_LOCAL_AS_NO_PREPEND | PEER_FLAG_LOCAL_AS_REPLACE_AS)
 
@@ -93,6 +107,35 @@ typedef struct bpacket_attr_vec_arr {
 	bpacket_attr_vec entries[BGP_ATTR_VEC_MAX];
 } bpacket_attr_vec_arr;
 
+/*
+ * Wire data of a bpacket, shared read-only by the output queues of the peers
+ * it is sent to.  This may outlive the bpacket itself, since peers drop the
+ * bpacket as soon as it is queued but the I/O pthread writes it out later.
+ */
+struct bpacket_buf {
+	_Atomic uint32_t refcnt;
+	struct stream *s;
+};
+
+/*
+ * An UPDATE on peer->obuf may only hold the per-peer part of the packet
+ * (header and possibly rewritten nexthop), in which case the rest of it is
+ * written straight from the shared bpacket buffer.  One entry per such
+ * stream, in the same order as peer->obuf.
+ */
+struct bgp_obuf_shared {
+	struct bgp_obuf_shared_item item;
+
+	/* stream on peer->obuf this is the remainder of */
+	const struct stream *head;
+
+	struct bpacket_buf *buf;
+	/* next byte of buf->s to write */
+	size_t getp;
+};
+
+DECLARE_LIST(bgp_obuf_shared, struct bgp_obuf_shared, item);
+
 struct bpacket {
 	/* for being part of an update subgroup's message list */
 	TAILQ_ENTRY(bpacket) pkt_train;
@@ -103,6 +146,9 @@ struct bpacket {
 	struct stream *buffer;
 	bpacket_attr_vec_arr arr;
 
+	/* set once buffer is referenced from peer output queues */
+	struct bpacket_buf *shared;
+
 	unsigned int ver;
 };
 
@@ -141,6 +187,14 @@ struct update_group {
 	uint32_t adj_count;
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
+	uint32_t adj_share_events;
+	uint32_t adj_unshare_events;
+	uint64_t split_adj_copied;
+	uint64_t split_usecs;
+	uint64_t merge_usecs;
+	/* UPDATEs built and the NLRI that went into them */
+	uint64_t updates_built;
+	uint64_t updates_nlri;
 
 	uint32_t subgrps_created;
 	uint32_t subgrps_deleted;
@@ -169,6 +223,19 @@ struct update_group {
  */
 #define UPDGRP_INCR_STAT(subgrp, stat) UPDGRP_INCR_STAT_BY(subgrp, stat, 1)
 
+/*
+ * Attribute hashes a compact subgroup has advertised, indexed by the
+ * prefix's adj_out_idx, 0 for nothing.  Shared copy-on-write between a
+ * subgroup and the ones split off it.
+ */
+struct bgp_adj_compact {
+	unsigned int refcnt;
+	/* prefixes with a hash set */
+	uint32_t count;
+	uint32_t size;
+	uint32_t hash[];
+};
+
 struct update_subgroup {
 	/* back pointer to the parent update group */
 	struct update_group *update_group;
@@ -189,6 +256,12 @@ struct update_subgroup {
 	 */
 	TAILQ_HEAD(adjout_queue, bgp_adj_out) adjq;
 
+	/*
+	 * With SUBGRP_STATUS_ADJ_COMPACT, adjq only has the prefixes with
+	 * pending advertisements.  What has been sent is in adj_compact.
+	 */
+	struct bgp_adj_compact *adj_compact;
+
 	/* packet buffer for update generation */
 	struct stream *work;
 
@@ -207,12 +280,20 @@ struct update_subgroup {
 	/* send prefix count prior to packet update */
 	uint32_t pscount;
 
+	/* WITHDRAW packets built since the last UPDATE with announcements */
+	uint32_t withdraw_run;
+
 	/* announcement attribute hash */
 	struct hash *hash;
 
 	struct thread *t_coalesce;
 	uint32_t v_coalesce;
 
+	/* adaptive batching window, and changes seen in the current one */
+	struct thread *t_batch;
+	uint32_t v_batch;
+	uint32_t batch_changes;
+
 	struct thread *t_merge_check;
 
 	/* table version that the subgroup has caught up to. */
@@ -245,6 +326,14 @@ struct update_subgroup {
 	uint32_t adj_count;
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
+	uint32_t adj_share_events;
+	uint32_t adj_unshare_events;
+	uint64_t split_adj_copied;
+	uint64_t split_usecs;
+	uint64_t merge_usecs;
+	/* UPDATEs built and the NLRI that went into them */
+	uint64_t updates_built;
+	uint64_t updates_nlri;
 
 	uint64_t id;
 
@@ -259,9 +348,12 @@ struct update_subgroup {
  * not during the update workflow.
  */
 #define SUBGRP_STATUS_PEER_DEFAULT_ORIGINATED (1 << 3)
+#define SUBGRP_STATUS_ADJ_COMPACT (1 << 4)
 
 	uint16_t flags;
 #define SUBGRP_FLAG_NEEDS_REFRESH (1 << 0)
+/* waiting for update_group_build_packets() */
+#define SUBGRP_FLAG_BUILD_PENDING (1 << 1)
 };
 
 /*
@@ -297,6 +389,8 @@ struct updwalk_context {
 	uint64_t subgrp_id;
 	enum bgp_policy_type policy_type;
 	const char *policy_name;
+	/* only routes covered by this can be affected, NULL for all */
+	const struct prefix *policy_prefix;
 	int policy_event_start_flag;
 	bool policy_route_update;
 	updgrp_walkcb cb;
@@ -379,6 +473,9 @@ extern void update_group_policy_update(struct bgp *bgp,
 				       enum bgp_policy_type ptype,
 				       const char *pname, bool route_update,
 				       int start_event);
+extern void update_group_prefix_list_update(struct bgp *bgp,
+					    const char *pname,
+					    const struct prefix *p);
 extern void update_group_af_walk(struct bgp *bgp, afi_t afi, safi_t safi,
 				 updgrp_walkcb cb, void *ctx);
 extern void update_group_walk(struct bgp *bgp, updgrp_walkcb cb, void *ctx);
@@ -412,9 +509,18 @@ unsigned int bpacket_queue_virtual_length(struct peer_af *paf);
 extern void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty);
 bool subgroup_packets_to_build(struct update_subgroup *subgrp);
 extern struct bpacket *subgroup_update_packet(struct update_subgroup *s);
+/*
+ * Instead of subgroup_update_packet(), queue the subgroup for building its
+ * UPDATEs on the route processing pthreads.  Returns false if that isn't
+ * enabled or there is nothing to build.
+ */
+extern bool subgroup_update_packet_defer(struct update_subgroup *subgrp);
+extern void update_group_build_packets(struct thread *thread);
 extern struct bpacket *subgroup_withdraw_packet(struct update_subgroup *s);
 extern struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 						struct peer_af *paf);
+extern struct bpacket_buf *bpacket_buf_get(struct bpacket *pkt);
+extern void bpacket_buf_put(struct bpacket_buf **buf);
 extern void bpacket_attr_vec_arr_reset(struct bpacket_attr_vec_arr *vecarr);
 extern void bpacket_attr_vec_arr_set_vec(struct bpacket_attr_vec_arr *vecarr,
 					 enum bpacket_attr_vec_type type,
@@ -437,6 +543,8 @@ extern void update_group_show_packet_queue(struct bgp *bgp, afi_t afi,
 					   safi_t safi, struct vty *vty,
 					   uint64_t id);
 extern void subgroup_announce_route(struct update_subgroup *subgrp);
+extern void subgroup_announce_prefix(struct update_subgroup *subgrp,
+				     const struct prefix *p);
 extern void subgroup_announce_all(struct update_subgroup *subgrp);
 
 extern void subgroup_default_originate(struct update_subgroup *subgrp,
@@ -461,6 +569,24 @@ extern void bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 extern void bgp_adj_out_unset_subgroup(struct bgp_dest *dest,
 				       struct update_subgroup *subgrp,
 				       char withdraw, uint32_t addpath_tx_id);
+extern bool bgp_adj_out_compact_advertised(struct update_subgroup *subgrp,
+					   struct bgp_dest *dest);
+extern struct bgp_advertise *
+bgp_adj_out_compact_sync(struct update_subgroup *subgrp,
+			 struct bgp_adj_out *adj);
+extern void bgp_adj_out_compact_copy(struct update_subgroup *source,
+				     struct update_subgroup *target);
+extern uint32_t bgp_adj_out_compact_count(struct update_subgroup *subgrp);
+/*
+ * Compact subgroups don't have the advertised attributes.  For show
+ * commands, this returns a temporary adj-out with them recomputed from
+ * the current best path, or NULL if dest has an adj-out already or
+ * nothing was advertised.  To be released before anything else runs.
+ */
+extern struct bgp_adj_out *
+bgp_adj_out_compact_materialize(struct update_subgroup *subgrp,
+				struct bgp_dest *dest);
+extern void bgp_adj_out_compact_release(struct bgp_adj_out *adj);
 void subgroup_announce_table(struct update_subgroup *subgrp,
 			     struct bgp_table *table);
 extern void subgroup_trigger_write(struct update_subgroup *subgrp);
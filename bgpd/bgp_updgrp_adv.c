@@ -36,6 +36,7 @@
 #include "queue.h"
 #include "routemap.h"
 #include "filter.h"
+#include "id_alloc.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -99,7 +100,190 @@ static void adj_free(struct bgp_adj_out *adj)
 	RB_REMOVE(bgp_adj_out_rb, &adj->dest->adj_out, adj);
 	bgp_dest_unlock_node(adj->dest);
 
-	XFREE(MTYPE_BGP_ADJ_OUT, adj);
+	XSLAB_FREE(MTYPE_BGP_ADJ_OUT, adj);
+}
+
+/*
+ * Compact adj-out ("bgp adj-out compact").  Once an update has been sent,
+ * a compact subgroup drops the adj-out and only remembers the hash of the
+ * attributes it sent, in an array indexed by the prefix's adj_out_idx.
+ * That's 4 bytes per prefix and subgroup instead of a full adj-out, and
+ * still enough to send withdraws and suppress duplicates.  adj-outs only
+ * exist while an advertisement is pending.  Addpath subgroups can't be
+ * compact, they may advertise several paths per prefix.
+ *
+ * A subgroup split off another one shares its array until either of them
+ * changes it, so splits don't copy anything.  Prefixes only get an index
+ * while some array has them set, and are locked for that time.
+ */
+static struct id_alloc *adj_out_idx_alloc;
+static struct bgp_dest **adj_out_idx_dests;
+static uint32_t adj_out_idx_size;
+
+static uint32_t adj_compact_idx(struct bgp_dest *dest)
+{
+	uint32_t idx = dest->adj_out_idx;
+	uint32_t size;
+
+	if (idx)
+		return idx;
+
+	if (!adj_out_idx_alloc)
+		adj_out_idx_alloc = idalloc_new("BGP adj-out index");
+	idx = idalloc_allocate(adj_out_idx_alloc);
+	if (idx == IDALLOC_INVALID)
+		return 0;
+
+	if (idx >= adj_out_idx_size) {
+		size = MAX(adj_out_idx_size * 2, 1024U);
+		while (size <= idx)
+			size *= 2;
+		adj_out_idx_dests =
+			XREALLOC(MTYPE_BGP_ADJ_OUT_IDX, adj_out_idx_dests,
+				 size * sizeof(adj_out_idx_dests[0]));
+		memset(&adj_out_idx_dests[adj_out_idx_size], 0,
+		       (size - adj_out_idx_size) * sizeof(adj_out_idx_dests[0]));
+		adj_out_idx_size = size;
+	}
+
+	adj_out_idx_dests[idx] = dest;
+	dest->adj_out_idx = idx;
+	return idx;
+}
+
+static void adj_compact_dest_ref(struct bgp_dest *dest)
+{
+	if (dest->adj_out_compact++ == 0)
+		bgp_dest_lock_node(dest);
+}
+
+static void adj_compact_dest_unref(struct bgp_dest *dest)
+{
+	assert(dest->adj_out_compact);
+	if (--dest->adj_out_compact)
+		return;
+
+	adj_out_idx_dests[dest->adj_out_idx] = NULL;
+	idalloc_free(adj_out_idx_alloc, dest->adj_out_idx);
+	dest->adj_out_idx = 0;
+	bgp_dest_unlock_node(dest);
+}
+
+/* Makes the subgroup's array its own and long enough for idx */
+static struct bgp_adj_compact *adj_compact_own(struct update_subgroup *subgrp,
+					       uint32_t idx)
+{
+	struct bgp_adj_compact *ac = subgrp->adj_compact, *copy;
+	uint32_t size, i;
+
+	if (ac && ac->refcnt == 1 && idx < ac->size)
+		return ac;
+
+	size = ac ? ac->size : 0;
+	if (idx >= size) {
+		size = MAX(size * 2, 1024U);
+		while (size <= idx)
+			size *= 2;
+	}
+
+	if (ac && ac->refcnt == 1) {
+		ac = XREALLOC(MTYPE_BGP_ADJ_COMPACT, ac,
+			      sizeof(*ac) + size * sizeof(ac->hash[0]));
+		memset(&ac->hash[ac->size], 0,
+		       (size - ac->size) * sizeof(ac->hash[0]));
+		ac->size = size;
+	} else {
+		copy = XCALLOC(MTYPE_BGP_ADJ_COMPACT,
+			       sizeof(*copy) + size * sizeof(copy->hash[0]));
+		copy->refcnt = 1;
+		copy->size = size;
+
+		if (ac) {
+			memcpy(copy->hash, ac->hash,
+			       ac->size * sizeof(ac->hash[0]));
+			copy->count = ac->count;
+			for (i = 1; i < ac->size; i++)
+				if (ac->hash[i])
+					adj_compact_dest_ref(
+						adj_out_idx_dests[i]);
+			ac->refcnt--;
+
+			SUBGRP_INCR_STAT(subgrp, adj_unshare_events);
+		}
+		ac = copy;
+	}
+
+	subgrp->adj_compact = ac;
+	return ac;
+}
+
+/* Hash of what was advertised for dest, 0 if nothing */
+static uint32_t adj_compact_hash(struct update_subgroup *subgrp,
+				 struct bgp_dest *dest)
+{
+	struct bgp_adj_compact *ac = subgrp->adj_compact;
+	uint32_t idx = dest->adj_out_idx;
+
+	if (!ac || !idx || idx >= ac->size)
+		return 0;
+
+	return ac->hash[idx];
+}
+
+static void adj_compact_set(struct update_subgroup *subgrp,
+			    struct bgp_dest *dest, uint32_t attr_hash)
+{
+	struct bgp_adj_compact *ac;
+	uint32_t idx;
+
+	/* 0 is for nothing advertised */
+	if (!attr_hash)
+		attr_hash = 1;
+
+	if (adj_compact_hash(subgrp, dest) == attr_hash)
+		return;
+
+	idx = adj_compact_idx(dest);
+	if (!idx)
+		return;
+
+	ac = adj_compact_own(subgrp, idx);
+	if (!ac->hash[idx]) {
+		adj_compact_dest_ref(dest);
+		ac->count++;
+	}
+	ac->hash[idx] = attr_hash;
+}
+
+static void adj_compact_clear(struct update_subgroup *subgrp,
+			      struct bgp_dest *dest)
+{
+	struct bgp_adj_compact *ac;
+	uint32_t idx = dest->adj_out_idx;
+
+	if (!adj_compact_hash(subgrp, dest))
+		return;
+
+	ac = adj_compact_own(subgrp, idx);
+	ac->hash[idx] = 0;
+	ac->count--;
+	adj_compact_dest_unref(dest);
+}
+
+/* Drops the subgroup's reference to its array */
+static void adj_compact_release(struct update_subgroup *subgrp)
+{
+	struct bgp_adj_compact *ac = subgrp->adj_compact;
+	uint32_t i;
+
+	subgrp->adj_compact = NULL;
+	if (!ac || --ac->refcnt)
+		return;
+
+	for (i = 1; i < ac->size; i++)
+		if (ac->hash[i])
+			adj_compact_dest_unref(adj_out_idx_dests[i]);
+	XFREE(MTYPE_BGP_ADJ_COMPACT, ac);
 }
 
 static void subgrp_withdraw_stale_addpath(struct updwalk_context *ctx,
@@ -215,12 +399,15 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 								adj->addpath_tx_id);
 						}
 					}
+					if (!adj_lookup(ctx->dest, subgrp, 0)
+					    && adj_compact_hash(subgrp,
+								ctx->dest))
+						subgroup_process_announce_selected(
+							subgrp, NULL, ctx->dest,
+							0);
 				}
 			}
 		}
-
-		/* Notify BGP Conditional advertisement */
-		bgp_notify_conditional_adv_scanner(subgrp);
 	}
 
 	return UPDWALK_CONTINUE;
@@ -230,7 +417,7 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 				 struct vty *vty, uint8_t flags)
 {
 	struct bgp_table *table;
-	struct bgp_adj_out *adj;
+	struct bgp_adj_out *adj, *compact;
 	unsigned long output_count;
 	struct bgp_dest *dest;
 	int header1 = 1;
@@ -248,6 +435,11 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 
+		compact = (flags & UPDWALK_FLAGS_ADVERTISED)
+				  ? bgp_adj_out_compact_materialize(subgrp,
+								    dest)
+				  : NULL;
+
 		RB_FOREACH (adj, bgp_adj_out_rb, &dest->adj_out) {
 			if (adj->subgroup != subgrp)
 				continue;
@@ -279,6 +471,8 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 				output_count++;
 			}
 		}
+
+		bgp_adj_out_compact_release(compact);
 	}
 	if (output_count != 0)
 		vty_out(vty, "\nTotal number of prefixes %ld\n", output_count);
@@ -313,6 +507,59 @@ static void updgrp_show_adj(struct bgp *bgp, afi_t afi, safi_t safi,
 	update_group_af_walk(bgp, afi, safi, updgrp_show_adj_walkcb, &ctx);
 }
 
+/*
+ * End of an adaptive batching window:  size the next one after what this
+ * one saw, then let the peers build packets for what was held back.
+ */
+static void subgroup_batch_timer(struct thread *thread)
+{
+	struct update_subgroup *subgrp = THREAD_ARG(thread);
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+	struct peer_af *paf;
+	uint32_t v = subgrp->v_batch;
+
+	if (subgrp->batch_changes >= BGP_BATCH_BUSY_CHANGES
+	    || bpacket_queue_length(SUBGRP_PKTQ(subgrp))
+		       >= BGP_BATCH_BUSY_PACKETS)
+		v = v ? v * 2 : BGP_BATCH_STEP;
+	else
+		v /= 2;
+	subgrp->v_batch = MIN(MAX(v, bgp->batch_min), bgp->batch_max);
+
+	if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64" batched %u changes, next window %u ms",
+			   subgrp->update_group->id, subgrp->id,
+			   subgrp->batch_changes, subgrp->v_batch);
+	subgrp->batch_changes = 0;
+
+	if (bgp_adv_fifo_count(&subgrp->sync->update))
+		SUBGRP_FOREACH_PEER (subgrp, paf)
+			bgp_adjust_routeadv(PAF_PEER(paf));
+	if (bgp_adv_fifo_count(&subgrp->sync->withdraw))
+		subgroup_trigger_write(subgrp);
+}
+
+/*
+ * Account for a change queued to the subgroup; true if packets should not
+ * be built for it yet, because an adaptive batching window is open.
+ */
+static bool subgroup_batch_hold(struct update_subgroup *subgrp)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+
+	if (!bgp->batch_adaptive)
+		return false;
+
+	subgrp->batch_changes++;
+	if (!subgrp->t_batch) {
+		subgrp->v_batch = MIN(MAX(subgrp->v_batch, bgp->batch_min),
+				      bgp->batch_max);
+		thread_add_timer_msec(bm->master, subgroup_batch_timer, subgrp,
+				      subgrp->v_batch, &subgrp->t_batch);
+	}
+	return true;
+}
+
 static void subgroup_coalesce_timer(struct thread *thread)
 {
 	struct update_subgroup *subgrp;
@@ -397,7 +644,7 @@ struct bgp_adj_out *bgp_adj_out_alloc(struct update_subgroup *subgrp,
 {
 	struct bgp_adj_out *adj;
 
-	adj = XCALLOC(MTYPE_BGP_ADJ_OUT, sizeof(struct bgp_adj_out));
+	adj = XSLAB_CALLOC(MTYPE_BGP_ADJ_OUT, sizeof(struct bgp_adj_out));
 	adj->subgroup = subgrp;
 	adj->addpath_tx_id = addpath_tx_id;
 
@@ -462,6 +709,7 @@ void bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 	struct peer_af *paf;
 	struct bgp *bgp;
 	uint32_t attr_hash = attrhash_key_make(attr);
+	uint32_t sent_hash;
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -480,6 +728,8 @@ void bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 		if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING))
 			subgrp->pscount++;
 	} else {
+		sent_hash = adj_compact_hash(subgrp, dest);
+
 		adj = bgp_adj_out_alloc(
 			subgrp, dest,
 			bgp_addpath_id_for_peer(peer, afi, safi,
@@ -487,7 +737,11 @@ void bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 		if (!adj)
 			return;
 
-		subgrp->pscount++;
+		if (!sent_hash
+		    || CHECK_FLAG(subgrp->sflags,
+				  SUBGRP_STATUS_TABLE_REPARSING))
+			subgrp->pscount++;
+		adj->attr_hash = sent_hash;
 	}
 
 	/* Check if we are sending the same route. This is needed to
@@ -507,6 +761,10 @@ void bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 			zlog_debug("%s suppress UPDATE w/ attr: %s", peer->host,
 				   attr_str);
 		}
+		/* compact adj-outs only exist while something is pending */
+		if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_COMPACT)
+		    && !adj->adv)
+			adj_free(adj);
 		return;
 	}
 
@@ -529,9 +787,11 @@ void bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 
 	/*
 	 * If the update adv list is empty, trigger the member peers'
-	 * mrai timers so the socket writes can happen.
+	 * mrai timers so the socket writes can happen, unless the
+	 * batching window does that later.
 	 */
-	if (!bgp_adv_fifo_count(&subgrp->sync->update)) {
+	if (!subgroup_batch_hold(subgrp)
+	    && !bgp_adv_fifo_count(&subgrp->sync->update)) {
 		SUBGRP_FOREACH_PEER (subgrp, paf) {
 			/* If there are no routes in the withdraw list, set
 			 * the flag PEER_STATUS_ADV_DELAY which will allow
@@ -567,12 +827,16 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest,
 	struct bgp_adj_out *adj;
 	struct bgp_advertise *adv;
 	bool trigger_write;
+	bool sent;
 
 	if (DISABLE_BGP_ANNOUNCE)
 		return;
 
 	/* Lookup existing adjacency */
 	adj = adj_lookup(dest, subgrp, addpath_tx_id);
+	sent = adj_compact_hash(subgrp, dest) != 0;
+	if (!adj && sent)
+		adj = bgp_adj_out_alloc(subgrp, dest, addpath_tx_id);
 	if (adj != NULL) {
 		/* Clean up previous advertisement.  */
 		if (adj->adv)
@@ -583,10 +847,13 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest,
 		 * the default route at the peer.
 		 */
 		if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_DEFAULT_ORIGINATE)
-		    && is_default_prefix(bgp_dest_get_prefix(dest)))
+		    && is_default_prefix(bgp_dest_get_prefix(dest))) {
+			if (sent)
+				adj_free(adj);
 			return;
+		}
 
-		if (adj->attr && withdraw) {
+		if ((adj->attr || sent) && withdraw) {
 			/* We need advertisement structure.  */
 			adj->adv = bgp_advertise_new();
 			adv = adj->adv;
@@ -601,10 +868,11 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest,
 			 * announcement.  */
 			bgp_adv_fifo_add_tail(&subgrp->sync->withdraw, adv);
 
-			if (trigger_write)
+			if (!subgroup_batch_hold(subgrp) && trigger_write)
 				subgroup_trigger_write(subgrp);
 		} else {
 			/* Free allocated information.  */
+			adj_compact_clear(subgrp, dest);
 			adj_free(adj);
 		}
 		if (!CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING))
@@ -623,6 +891,7 @@ void bgp_adj_out_remove_subgroup(struct bgp_dest *dest, struct bgp_adj_out *adj,
 	if (adj->adv)
 		bgp_advertise_clean_subgroup(subgrp, adj);
 
+	adj_compact_clear(subgrp, dest);
 	adj_free(adj);
 }
 
@@ -636,21 +905,101 @@ void subgroup_clear_table(struct update_subgroup *subgrp)
 
 	SUBGRP_FOREACH_ADJ_SAFE (subgrp, aout, taout)
 		bgp_adj_out_remove_subgroup(aout->dest, aout, subgrp);
+
+	adj_compact_release(subgrp);
+}
+
+bool bgp_adj_out_compact_advertised(struct update_subgroup *subgrp,
+				    struct bgp_dest *dest)
+{
+	return adj_compact_hash(subgrp, dest) != 0;
+}
+
+struct bgp_advertise *bgp_adj_out_compact_sync(struct update_subgroup *subgrp,
+					       struct bgp_adj_out *adj)
+{
+	struct bgp_dest *dest = adj->dest;
+	struct bgp_advertise *next;
+
+	if (!adj_compact_hash(subgrp, dest))
+		subgrp->scount++;
+	adj_compact_set(subgrp, dest, adj->attr_hash);
+
+	next = bgp_advertise_clean_subgroup(subgrp, adj);
+	adj_free(adj);
+
+	return next;
+}
+
+void bgp_adj_out_compact_copy(struct update_subgroup *source,
+			      struct update_subgroup *target)
+{
+	SET_FLAG(target->sflags, SUBGRP_STATUS_ADJ_COMPACT);
+
+	adj_compact_release(target);
+	target->adj_compact = source->adj_compact;
+	if (target->adj_compact) {
+		target->adj_compact->refcnt++;
+		SUBGRP_INCR_STAT(target, adj_share_events);
+	}
+}
+
+uint32_t bgp_adj_out_compact_count(struct update_subgroup *subgrp)
+{
+	return subgrp->adj_compact ? subgrp->adj_compact->count : 0;
+}
+
+struct bgp_adj_out *
+bgp_adj_out_compact_materialize(struct update_subgroup *subgrp,
+				struct bgp_dest *dest)
+{
+	struct bgp_path_info *pi;
+	struct bgp_adj_out *adj;
+	struct attr attr;
+
+	if (!adj_compact_hash(subgrp, dest) || adj_lookup(dest, subgrp, 0))
+		return NULL;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+			break;
+	if (!pi)
+		return NULL;
+
+	memset(&attr, 0, sizeof(attr));
+	if (!subgroup_announce_check(dest, pi, subgrp,
+				     bgp_dest_get_prefix(dest), &attr, NULL))
+		return NULL;
+
+	adj = bgp_adj_out_alloc(subgrp, dest, 0);
+	adj->attr = bgp_attr_intern(&attr);
+	bgp_attr_flush(&attr);
+
+	return adj;
+}
+
+void bgp_adj_out_compact_release(struct bgp_adj_out *adj)
+{
+	if (!adj)
+		return;
+
+	bgp_attr_unintern(&adj->attr);
+	adj_free(adj);
 }
 
 /*
  * subgroup_announce_table
  */
-void subgroup_announce_table(struct update_subgroup *subgrp,
-			     struct bgp_table *table)
+/* Re-run the outbound policy for one destination */
+static void subgroup_announce_dest(struct update_subgroup *subgrp,
+				   struct bgp_dest *dest, bool addpath_capable)
 {
-	struct bgp_dest *dest;
+	const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 	struct bgp_path_info *ri;
 	struct attr attr;
 	struct peer *peer;
 	afi_t afi;
 	safi_t safi;
-	bool addpath_capable;
 	struct bgp *bgp;
 	bool advertise;
 
@@ -658,6 +1007,67 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	afi = SUBGRP_AFI(subgrp);
 	safi = SUBGRP_SAFI(subgrp);
 	bgp = SUBGRP_INST(subgrp);
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	/* Check if the route can be advertised */
+	advertise = bgp_check_advertise(bgp, dest);
+
+	/* IDs of a strategy enabled since the prefix was last processed */
+	bgp_addpath_ensure_ids(bgp, dest);
+
+	for (ri = bgp_dest_get_bgp_path_info(dest); ri; ri = ri->next) {
+
+		if (!bgp_check_selected(ri, peer, addpath_capable, afi, safi))
+			continue;
+
+		if (subgroup_announce_check(dest, ri, subgrp, dest_p, &attr,
+					    NULL)) {
+			/* Check if route can be advertised */
+			if (advertise) {
+				if (!bgp_check_withdrawal(bgp, dest))
+					bgp_adj_out_set_subgroup(dest, subgrp,
+								 &attr, ri);
+				else
+					bgp_adj_out_unset_subgroup(
+						dest, subgrp, 1,
+						bgp_addpath_id_for_peer(
+							peer, afi, safi,
+							&ri->tx_addpath));
+			}
+		} else {
+			/* If default originate is enabled for
+			 * the peer, do not send explicit
+			 * withdraw. This will prevent deletion
+			 * of default route advertised through
+			 * default originate
+			 */
+			if (CHECK_FLAG(peer->af_flags[afi][safi],
+				       PEER_FLAG_DEFAULT_ORIGINATE)
+			    && is_default_prefix(dest_p))
+				break;
+
+			bgp_adj_out_unset_subgroup(
+				dest, subgrp, 1,
+				bgp_addpath_id_for_peer(peer, afi, safi,
+							&ri->tx_addpath));
+		}
+	}
+}
+
+void subgroup_announce_table(struct update_subgroup *subgrp,
+			     struct bgp_table *table)
+{
+	struct bgp_dest *dest;
+	struct peer *peer;
+	afi_t afi;
+	safi_t safi;
+	bool addpath_capable;
+
+	peer = SUBGRP_PEER(subgrp);
+	afi = SUBGRP_AFI(subgrp);
+	safi = SUBGRP_SAFI(subgrp);
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 
 	if (safi == SAFI_LABELED_UNICAST)
@@ -674,54 +1084,9 @@ void subgroup_announce_table(struct update_subgroup *subgrp,
 	subgrp->pscount = 0;
 	SET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		subgroup_announce_dest(subgrp, dest, addpath_capable);
 
-		/* Check if the route can be advertised */
-		advertise = bgp_check_advertise(bgp, dest);
-
-		for (ri = bgp_dest_get_bgp_path_info(dest); ri; ri = ri->next) {
-
-			if (!bgp_check_selected(ri, peer, addpath_capable, afi,
-						safi))
-				continue;
-
-			if (subgroup_announce_check(dest, ri, subgrp, dest_p,
-						    &attr, NULL)) {
-				/* Check if route can be advertised */
-				if (advertise) {
-					if (!bgp_check_withdrawal(bgp, dest))
-						bgp_adj_out_set_subgroup(
-							dest, subgrp, &attr,
-							ri);
-					else
-						bgp_adj_out_unset_subgroup(
-							dest, subgrp, 1,
-							bgp_addpath_id_for_peer(
-								peer, afi, safi,
-								&ri->tx_addpath));
-				}
-			} else {
-				/* If default originate is enabled for
-				 * the peer, do not send explicit
-				 * withdraw. This will prevent deletion
-				 * of default route advertised through
-				 * default originate
-				 */
-				if (CHECK_FLAG(peer->af_flags[afi][safi],
-					       PEER_FLAG_DEFAULT_ORIGINATE) &&
-				    is_default_prefix(
-					    bgp_dest_get_prefix(dest)))
-					break;
-
-				bgp_adj_out_unset_subgroup(
-					dest, subgrp, 1,
-					bgp_addpath_id_for_peer(
-						peer, afi, safi,
-						&ri->tx_addpath));
-			}
-		}
-	}
 	UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
 
 	/*
@@ -779,6 +1144,58 @@ void subgroup_announce_route(struct update_subgroup *subgrp)
 		}
 }
 
+/*
+ * subgroup_announce_prefix
+ *
+ * Refresh the routes covered by p out to a subgroup, for policy changes
+ * that can't affect anything else (a prefix-list entry).
+ */
+void subgroup_announce_prefix(struct update_subgroup *subgrp,
+			      const struct prefix *p)
+{
+	struct bgp_dest *dest, *match;
+	struct peer *peer, *onlypeer;
+	afi_t afi;
+	safi_t safi;
+	bool addpath_capable;
+
+	peer = SUBGRP_PEER(subgrp);
+	afi = SUBGRP_AFI(subgrp);
+	safi = SUBGRP_SAFI(subgrp);
+
+	if (family2afi(p->family) != afi)
+		return;
+
+	/* a pending refresh or a two-level table needs the full walk */
+	if (update_subgroup_needs_refresh(subgrp) || safi == SAFI_MPLS_VPN
+	    || safi == SAFI_ENCAP || safi == SAFI_EVPN) {
+		subgroup_announce_route(subgrp);
+		return;
+	}
+
+	/* First update is deferred until ORF or ROUTE-REFRESH is received */
+	onlypeer = ((SUBGRP_PCOUNT(subgrp) == 1) ? (SUBGRP_PFIRST(subgrp))->peer
+						 : NULL);
+	if (onlypeer
+	    && CHECK_FLAG(onlypeer->af_sflags[afi][safi],
+			  PEER_STATUS_ORF_WAIT_REFRESH))
+		return;
+
+	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	match = bgp_table_subtree_lookup(peer->bgp->rib[afi][safi], p);
+
+	SET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
+	for (dest = match; dest; dest = bgp_route_next_until(dest, match))
+		subgroup_announce_dest(subgrp, dest, addpath_capable);
+	UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
+
+	update_subgroup_trigger_merge_check(subgrp, 0);
+}
+
 void subgroup_default_originate(struct update_subgroup *subgrp, int withdraw)
 {
 	struct bgp *bgp;
@@ -952,6 +1369,7 @@ void subgroup_default_originate(struct update_subgroup *subgrp, int withdraw)
 					/* Free allocated information.  */
 					adj_free(adj);
 				}
+				adj_compact_clear(subgrp, dest);
 				bgp_dest_unlock_node(dest);
 			}
 
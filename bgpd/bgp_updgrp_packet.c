@@ -57,6 +57,9 @@
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_addpath.h"
+#include "bgpd/bgp_process_mt.h"
+#include "bgpd/bgp_pipeline.h"
+#include "bgpd/bgp_trace.h"
 
 /********************
  * PRIVATE FUNCTIONS
@@ -76,12 +79,51 @@ struct bpacket *bpacket_alloc(void)
 
 void bpacket_free(struct bpacket *pkt)
 {
+	if (pkt->shared) {
+		/* buffer is owned by the shared reference from here on */
+		pkt->buffer = NULL;
+		bpacket_buf_put(&pkt->shared);
+	}
 	if (pkt->buffer)
 		stream_free(pkt->buffer);
 	pkt->buffer = NULL;
 	XFREE(MTYPE_BGP_PACKET, pkt);
 }
 
+/*
+ * Get a reference to the wire data of a packet that can be handed to the
+ * I/O pthread.  The packet buffer must not be modified after this.
+ */
+struct bpacket_buf *bpacket_buf_get(struct bpacket *pkt)
+{
+	if (!pkt->shared) {
+		pkt->shared = XCALLOC(MTYPE_BGP_PACKET_BUF,
+				      sizeof(struct bpacket_buf));
+		pkt->shared->s = pkt->buffer;
+		/* reference held by the bpacket itself */
+		atomic_store_explicit(&pkt->shared->refcnt, 1,
+				      memory_order_relaxed);
+	}
+
+	atomic_fetch_add_explicit(&pkt->shared->refcnt, 1,
+				  memory_order_relaxed);
+	return pkt->shared;
+}
+
+/* Drop a reference, may be called from any pthread. */
+void bpacket_buf_put(struct bpacket_buf **buf)
+{
+	if (!*buf)
+		return;
+
+	if (atomic_fetch_sub_explicit(&(*buf)->refcnt, 1,
+				      memory_order_acq_rel) == 1) {
+		stream_free((*buf)->s);
+		XFREE(MTYPE_BGP_PACKET_BUF, *buf);
+	}
+	*buf = NULL;
+}
+
 void bpacket_queue_init(struct bpacket_queue *q)
 {
 	TAILQ_INIT(&(q->pkts));
@@ -344,6 +386,29 @@ void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty)
 	return;
 }
 
+/*
+ * Copy the first 'len' bytes of a packet, i.e. the part that may differ
+ * between peers.  The rest of it is written from the shared packet buffer,
+ * see bgp_packet_add_shared().
+ */
+static struct stream *bpacket_head_dup(struct stream *buf, size_t len)
+{
+	struct stream *s;
+
+	if (len > stream_get_endp(buf))
+		len = stream_get_endp(buf);
+
+	s = stream_new(len);
+	stream_put(s, STREAM_DATA(buf), len);
+
+	return s;
+}
+
+/*
+ * Returns the per-peer start of a packet, with the nexthop rewritten as
+ * needed.  This covers the header and the whole nexthop field, anything
+ * after that is identical for all peers of the subgroup.
+ */
 struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 					 struct peer_af *paf)
 {
@@ -352,19 +417,19 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 	struct peer *peer;
 	struct bgp_filter *filter;
 
-	s = stream_dup(pkt->buffer);
 	peer = PAF_PEER(paf);
 
 	vec = &pkt->arr.entries[BGP_ATTR_VEC_NH];
 
 	if (!CHECK_FLAG(vec->flags, BPKT_ATTRVEC_FLAGS_UPDATED))
-		return s;
+		return bpacket_head_dup(pkt->buffer, BGP_HEADER_SIZE);
 
 	uint8_t nhlen;
 	afi_t nhafi;
 	int route_map_sets_nh;
 
-	nhlen = stream_getc_from(s, vec->offset);
+	nhlen = stream_getc_from(pkt->buffer, vec->offset);
+	s = bpacket_head_dup(pkt->buffer, vec->offset + 1 + nhlen);
 	filter = &peer->filter[paf->afi][paf->safi];
 
 	if (peer_cap_enhe(peer, paf->afi, paf->safi))
@@ -648,17 +713,52 @@ bool subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return false;
 }
 
-/* Make BGP update packet.  */
-struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+/* One UPDATE encoded by subgroup_update_build() */
+struct bpacket_build {
+	struct stream *packet;
+	struct bpacket_attr_vec_arr vecarr;
+
+	/* advertisements covered, in the order they were encoded */
+	unsigned int nadv;
+	/* the attributes didn't fit, the advertisements are dropped */
+	bool flush;
+};
+
+/*
+ * Advertisements for the same attributes go into the same packet: after
+ * the first one, the rest of its baa list.  This is the order in which
+ * bgp_advertise_clean_subgroup() hands them out.
+ */
+static struct bgp_advertise *subgroup_update_build_next(
+	struct bgp_advertise *first, struct bgp_advertise *adv)
+{
+	adv = (adv == first) ? first->baa->adv : adv->next;
+	while (adv && adv->built)
+		adv = adv->next;
+
+	return adv;
+}
+
+/*
+ * Encode the next UPDATE for the subgroup, starting from the first update
+ * in the FIFO (at or after *cursor) that isn't in a packet yet.  Besides
+ * the subgroup's work streams and the built flag of its advertisements,
+ * this only reads BGP state, so it can run on the route processing
+ * pthreads.  subgroup_update_commit() then applies the result.
+ *
+ * Returns false if there's nothing to encode.
+ */
+static bool subgroup_update_build(struct update_subgroup *subgrp,
+				  struct bgp_advertise **cursor,
+				  struct bpacket_build *b)
 {
 	struct bpacket_attr_vec_arr vecarr;
-	struct bpacket *pkt;
 	struct peer *peer;
 	struct stream *s;
 	struct stream *snlri;
 	struct stream *packet;
 	struct bgp_adj_out *adj;
-	struct bgp_advertise *adv;
+	struct bgp_advertise *adv, *first;
 	struct bgp_dest *dest = NULL;
 	struct bgp_path_info *path = NULL;
 	bgp_size_t total_attr_len = 0;
@@ -679,11 +779,13 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	mpls_label_t label = MPLS_INVALID_LABEL, *label_pnt = NULL;
 	uint32_t num_labels = 0;
 
-	if (!subgrp)
-		return NULL;
+	first = *cursor ? *cursor : bgp_adv_fifo_first(&subgrp->sync->update);
+	while (first && first->built)
+		first = bgp_adv_fifo_next(&subgrp->sync->update, first);
+	*cursor = first;
 
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
+	if (!first)
+		return false;
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -698,7 +800,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
-	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+	adv = first;
 	while (adv) {
 		const struct prefix *dest_p;
 
@@ -770,11 +872,16 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 					"u%" PRIu64 ":s%" PRIu64" attributes too long, cannot send UPDATE",
 					subgrp->update_group->id, subgrp->id);
 
-				/* Flush the FIFO update queue */
-				while (adv)
-					adv = bgp_advertise_clean_subgroup(
-						subgrp, adj);
-				return NULL;
+				/* The whole baa list gets flushed */
+				while (adv) {
+					adv->built = true;
+					adv = subgroup_update_build_next(first,
+									 adv);
+				}
+				stream_reset(s);
+				stream_reset(snlri);
+				b->flush = true;
+				return true;
 			}
 
 			if (BGP_DEBUG(update, UPDATE_OUT)
@@ -854,6 +961,79 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
+		adv->built = true;
+		b->nadv++;
+		adv = subgroup_update_build_next(first, adv);
+	}
+
+	if (stream_empty(s))
+		return false;
+
+	if (!stream_empty(snlri)) {
+		bgp_packet_mpattr_end(snlri, mpattrlen_pos);
+		total_attr_len += stream_get_endp(snlri);
+	}
+
+	/* set the total attribute length correctly */
+	stream_putw_at(s, attrlen_pos, total_attr_len);
+
+	if (!stream_empty(snlri)) {
+		packet = stream_dupcat(s, snlri, mpattr_pos);
+		bpacket_attr_vec_arr_update(&vecarr, mpattr_pos);
+	} else
+		packet = stream_dup(s);
+	bgp_packet_set_size(packet);
+	if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " send UPDATE len %zd (max message len: %hu) numpfx %d",
+			   subgrp->update_group->id, subgrp->id,
+			   (stream_get_endp(packet) - stream_get_getp(packet)),
+			   peer->max_packet_size, num_pfx);
+	stream_reset(s);
+	stream_reset(snlri);
+
+	b->packet = packet;
+	b->vecarr = vecarr;
+	return true;
+}
+
+/*
+ * Main pthread part of building an UPDATE: sync the adj-outs of the
+ * advertisements that went into the packet and queue it.  These are at
+ * the front of the FIFO at this point.
+ */
+static struct bpacket *subgroup_update_commit(struct update_subgroup *subgrp,
+					      struct bpacket_build *b)
+{
+	struct bgp_advertise *adv;
+	struct bgp_adj_out *adj;
+	struct peer_af *paf;
+	unsigned int i;
+
+	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+
+	/* the oldest update in the packet */
+	if (adv && b->packet)
+		SUBGRP_FOREACH_PEER (subgrp, paf)
+			bgp_pipe_record(paf->peer, SUBGRP_AFI(subgrp),
+					SUBGRP_SAFI(subgrp),
+					BGP_PIPE_ADVERTISE, adv->since);
+
+	if (b->flush) {
+		/* Flush the FIFO update queue */
+		while (adv)
+			adv = bgp_advertise_clean_subgroup(subgrp, adv->adj);
+		return NULL;
+	}
+
+	for (i = 0; i < b->nadv && adv; i++) {
+		adj = adv->adj;
+
+		if (CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_ADJ_COMPACT)) {
+			adv = bgp_adj_out_compact_sync(subgrp, adj);
+			continue;
+		}
+
 		/* Synchnorize attribute.  */
 		if (adj->attr)
 			bgp_attr_unintern(&adj->attr);
@@ -864,35 +1044,177 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 		adv = bgp_advertise_clean_subgroup(subgrp, adj);
 	}
 
-	if (!stream_empty(s)) {
-		if (!stream_empty(snlri)) {
-			bgp_packet_mpattr_end(snlri, mpattrlen_pos);
-			total_attr_len += stream_get_endp(snlri);
+	if (!b->packet)
+		return NULL;
+
+	SUBGRP_INCR_STAT(subgrp, updates_built);
+	SUBGRP_INCR_STAT_BY(subgrp, updates_nlri, b->nadv);
+
+	frrtrace(4, frr_bgp, update_packet_build, subgrp, 0, b->nadv,
+		 stream_get_endp(b->packet));
+
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), b->packet, &b->vecarr);
+}
+
+/* Make BGP update packet.  */
+struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+{
+	struct bgp_advertise *cursor = NULL;
+	struct bpacket_build b = {};
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	if (!subgroup_update_build(subgrp, &cursor, &b))
+		return NULL;
+
+	return subgroup_update_commit(subgrp, &b);
+}
+
+/*
+ * Parallel UPDATE building.  With "bgp process-threads" above 1, a peer
+ * that runs out of packets doesn't build the next one for its subgroup
+ * right away.  It flags the subgroup and schedules
+ * update_group_build_packets(), which then fills the packet queues of all
+ * flagged subgroups of the instance at once: the encoding runs on the
+ * route processing pthreads, one subgroup per task, and the adj-out sync
+ * and queueing happen on the main pthread afterwards.  Withdraws are
+ * cheap and still built on demand.
+ */
+struct subgroup_build {
+	struct update_subgroup *subgrp;
+
+	struct bpacket_build *pkts;
+	unsigned int room;
+	unsigned int npkts;
+};
+
+struct update_group_build {
+	struct subgroup_build *subgrps;
+	unsigned int count;
+	unsigned int size;
+};
+
+bool subgroup_update_packet_defer(struct update_subgroup *subgrp)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+
+	if (bgp_process_mt_shards() <= 1)
+		return false;
+
+	/* keeps the debug output in order */
+	if (BGP_DEBUG(update, UPDATE_OUT) || BGP_DEBUG(update, UPDATE_PREFIX))
+		return false;
+
+	if (!bgp_adv_fifo_count(&subgrp->sync->update)
+	    || bpacket_queue_is_full(bgp, SUBGRP_PKTQ(subgrp)))
+		return false;
+
+	SET_FLAG(subgrp->flags, SUBGRP_FLAG_BUILD_PENDING);
+	thread_add_event(bm->master, update_group_build_packets, bgp, 0,
+			 &bgp->t_updgrp_build);
+	return true;
+}
+
+static int update_group_build_walkcb(struct update_group *updgrp, void *arg)
+{
+	struct update_group_build *build = arg;
+	struct update_subgroup *subgrp;
+	struct subgroup_build *sb;
+	struct bpacket_queue *q;
+	struct bgp *bgp;
+
+	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
+		if (!CHECK_FLAG(subgrp->flags, SUBGRP_FLAG_BUILD_PENDING))
+			continue;
+		UNSET_FLAG(subgrp->flags, SUBGRP_FLAG_BUILD_PENDING);
+
+		/* withdraws go first, the peers build those themselves */
+		if (bgp_adv_fifo_count(&subgrp->sync->withdraw)
+		    || !bgp_adv_fifo_count(&subgrp->sync->update))
+			continue;
+
+		bgp = SUBGRP_INST(subgrp);
+		q = SUBGRP_PKTQ(subgrp);
+		if (bpacket_queue_is_full(bgp, q))
+			continue;
+
+		if (build->count == build->size) {
+			build->size = MAX(build->size * 2, 16U);
+			build->subgrps = XREALLOC(
+				MTYPE_BGP_UPDGRP_BUILD, build->subgrps,
+				build->size * sizeof(build->subgrps[0]));
 		}
 
-		/* set the total attribute length correctly */
-		stream_putw_at(s, attrlen_pos, total_attr_len);
+		sb = &build->subgrps[build->count++];
+		sb->subgrp = subgrp;
+		sb->room = bgp->default_subgroup_pkt_queue_max - q->curr_count;
+		sb->pkts = XCALLOC(MTYPE_BGP_UPDGRP_BUILD,
+				   sb->room * sizeof(sb->pkts[0]));
+		sb->npkts = 0;
+	}
 
-		if (!stream_empty(snlri)) {
-			packet = stream_dupcat(s, snlri, mpattr_pos);
-			bpacket_attr_vec_arr_update(&vecarr, mpattr_pos);
-		} else
-			packet = stream_dup(s);
-		bgp_packet_set_size(packet);
-		if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
-			zlog_debug(
-				"u%" PRIu64 ":s%" PRIu64
-				" send UPDATE len %zd (max message len: %hu) numpfx %d",
-				subgrp->update_group->id, subgrp->id,
-				(stream_get_endp(packet)
-				 - stream_get_getp(packet)),
-				peer->max_packet_size, num_pfx);
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
-		stream_reset(s);
-		stream_reset(snlri);
-		return pkt;
+	return UPDWALK_CONTINUE;
+}
+
+/*
+ * Runs on the route processing pthreads while the main pthread waits.
+ * Subgroups share nothing that is modified here.
+ */
+static void update_group_build_shard(void *arg, unsigned int shard,
+				     unsigned int nshards)
+{
+	struct update_group_build *build = arg;
+	struct subgroup_build *sb;
+	struct bgp_advertise *cursor;
+	unsigned int i;
+
+	for (i = shard; i < build->count; i += nshards) {
+		sb = &build->subgrps[i];
+		cursor = NULL;
+
+		while (sb->npkts < sb->room
+		       && subgroup_update_build(sb->subgrp, &cursor,
+						&sb->pkts[sb->npkts]))
+			sb->npkts++;
 	}
-	return NULL;
+}
+
+void update_group_build_packets(struct thread *thread)
+{
+	struct bgp *bgp = THREAD_ARG(thread);
+	struct update_group_build build = {};
+	struct subgroup_build *sb;
+	unsigned int i, j;
+	afi_t afi;
+	safi_t safi;
+
+	FOREACH_AFI_SAFI (afi, safi)
+		update_group_af_walk(bgp, afi, safi, update_group_build_walkcb,
+				     &build);
+
+	if (!build.count)
+		return;
+
+	bgp_process_mt_run(update_group_build_shard, &build);
+
+	for (i = 0; i < build.count; i++) {
+		sb = &build.subgrps[i];
+
+		for (j = 0; j < sb->npkts; j++)
+			subgroup_update_commit(sb->subgrp, &sb->pkts[j]);
+
+		/* the peers that deferred to us are waiting for these */
+		if (sb->npkts)
+			subgroup_trigger_write(sb->subgrp);
+
+		XFREE(MTYPE_BGP_UPDGRP_BUILD, sb->pkts);
+	}
+
+	XFREE(MTYPE_BGP_UPDGRP_BUILD, build.subgrps);
 }
 
 /* Make BGP withdraw packet.  */
@@ -1048,6 +1370,8 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 				   subgrp->update_group->id, subgrp->id,
 				   (stream_get_endp(s) - stream_get_getp(s)),
 				   num_pfx);
+		frrtrace(4, frr_bgp, update_packet_build, subgrp, 1, num_pfx,
+			 stream_get_endp(s));
 		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), stream_dup(s),
 					NULL);
 		stream_reset(s);
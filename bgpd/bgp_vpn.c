@@ -49,6 +49,7 @@ int show_adj_route_vpn(struct vty *vty, struct peer *peer,
 	json_object *json_routes = NULL;
 	char rd_str[BUFSIZ];
 	unsigned long output_count = 0;
+	struct update_subgroup *subgrp;
 
 	bgp = bgp_get_default();
 	if (bgp == NULL) {
@@ -77,6 +78,8 @@ int show_adj_route_vpn(struct vty *vty, struct peer *peer,
 		json_object_string_add(json_ocode, "incomplete", "?");
 	}
 
+	subgrp = peer_subgroup(peer, afi, safi);
+
 	for (dest = bgp_table_top(bgp->rib[afi][safi]); dest;
 	     dest = bgp_route_next(dest)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
@@ -98,6 +101,7 @@ int show_adj_route_vpn(struct vty *vty, struct peer *peer,
 
 		for (rm = bgp_table_top(table); rm; rm = bgp_route_next(rm)) {
 			struct bgp_adj_out *adj = NULL;
+			struct bgp_adj_out *compact = NULL;
 			struct attr *attr = NULL;
 			struct peer_af *paf = NULL;
 
@@ -110,6 +114,13 @@ int show_adj_route_vpn(struct vty *vty, struct peer *peer,
 					break;
 			}
 
+			if (!attr && subgrp) {
+				compact = bgp_adj_out_compact_materialize(subgrp,
+									  rm);
+				if (compact)
+					attr = compact->attr;
+			}
+
 			if (bgp_dest_get_bgp_path_info(rm) == NULL)
 				continue;
 
@@ -229,6 +240,8 @@ int show_adj_route_vpn(struct vty *vty, struct peer *peer,
 					  attr, safi, use_json, json_routes,
 					  false);
 			output_count++;
+
+			bgp_adj_out_compact_release(compact);
 		}
 
 		if (use_json && json_routes)
@@ -74,6 +74,7 @@
 #include "bgpd/bgp_mac.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_conditional_adv.h"
+#include "bgpd/bgp_process_mt.h"
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
 #endif
@@ -312,10 +313,8 @@ static int bgp_srv6_locator_unset(struct bgp *bgp)
 	}
 
 	/* refresh functions */
-	for (ALL_LIST_ELEMENTS(bgp->srv6_functions, node, nnode, func)) {
-		listnode_delete(bgp->srv6_functions, func);
+	while ((func = bgp_srv6_functions_pop(&bgp->srv6_functions)))
 		XFREE(MTYPE_BGP_SRV6_FUNCTION, func);
-	}
 
 	/* refresh tovpn_sid */
 	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp_vrf)) {
@@ -1640,6 +1639,60 @@ DEFPY (no_bgp_session_dscp,
 	return CMD_SUCCESS;
 }
 
+/* bgp process-threads */
+
+DEFPY (bgp_process_threads,
+       bgp_process_threads_cmd,
+       "bgp process-threads (1-64)$threads",
+       BGP_STR
+       "Number of pthreads used for best path selection\n"
+       "Number of pthreads\n")
+{
+	bm->process_threads = threads;
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_process_threads,
+       no_bgp_process_threads_cmd,
+       "no bgp process-threads [(1-64)]",
+       NO_STR
+       BGP_STR
+       "Number of pthreads used for best path selection\n"
+       "Number of pthreads\n")
+{
+	bm->process_threads = BGP_PROCESS_THREADS_DEF;
+
+	return CMD_SUCCESS;
+}
+
+/* bgp session-start-rate */
+
+DEFPY (bgp_session_start_rate,
+       bgp_session_start_rate_cmd,
+       "bgp session-start-rate (1-10000)$rate",
+       BGP_STR
+       "Limit the rate at which BGP sessions are started\n"
+       "Sessions per second\n")
+{
+	bm->start_rate = rate;
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_session_start_rate,
+       no_bgp_session_start_rate_cmd,
+       "no bgp session-start-rate [(1-10000)]",
+       NO_STR
+       BGP_STR
+       "Limit the rate at which BGP sessions are started\n"
+       "Sessions per second\n")
+{
+	bm->start_rate = 0;
+
+	return CMD_SUCCESS;
+}
+
 /* BGP router-id.  */
 
 DEFPY (bgp_router_id,
@@ -2353,6 +2406,41 @@ DEFPY (bgp_rpkt_quanta,
 	return bgp_rpkt_quanta_config_vty(vty, quanta, !no);
 }
 
+DEFPY (bgp_withdraw_quanta,
+       bgp_withdraw_quanta_cmd,
+       "[no] withdraw-quanta (1-1024)$quanta",
+       NO_STR
+       "How many WITHDRAW packets to build ahead of each UPDATE with announcements\n"
+       "Number of packets\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	bgp->withdraw_quanta = no ? BGP_WITHDRAW_QUANTA_DEFAULT : quanta;
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_update_batching,
+       bgp_update_batching_cmd,
+       "[no] update-batching adaptive [(0-10000)$min (1-10000)$max]",
+       NO_STR
+       "Hold back UPDATE generation to batch changes\n"
+       "Size the window after the rate of changes\n"
+       "Smallest window (in ms)\n"
+       "Largest window (in ms)\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	if (!no && max_str && min > max) {
+		vty_out(vty, "%% Smallest window must not exceed the largest\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	bgp->batch_adaptive = !no;
+	bgp->batch_min = (!no && min_str) ? min : BGP_BATCH_DEFAULT_MIN;
+	bgp->batch_max = (!no && max_str) ? max : BGP_BATCH_DEFAULT_MAX;
+	return CMD_SUCCESS;
+}
+
 void bgp_config_write_coalesce_time(struct vty *vty, struct bgp *bgp)
 {
 	if (!bgp->heuristic_coalesce)
@@ -2682,6 +2770,64 @@ DEFUN(no_bgp_suppress_duplicates, no_bgp_suppress_duplicates_cmd,
 	return CMD_SUCCESS;
 }
 
+static void bgp_pic_set(struct bgp *bgp, bool set)
+{
+	if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_PIC) == set)
+		return;
+
+	if (set)
+		SET_FLAG(bgp->flags, BGP_FLAG_PIC);
+	else
+		UNSET_FLAG(bgp->flags, BGP_FLAG_PIC);
+
+	bgp_zebra_announce_table(bgp, AFI_IP, SAFI_UNICAST);
+	bgp_zebra_announce_table(bgp, AFI_IP6, SAFI_UNICAST);
+}
+
+DEFUN(bgp_pic, bgp_pic_cmd,
+      "bgp pic",
+      BGP_STR
+      "Install routes with nexthop groups shared per set of BGP nexthops\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	bgp_pic_set(bgp, true);
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_bgp_pic, no_bgp_pic_cmd,
+      "no bgp pic",
+      NO_STR
+      BGP_STR
+      "Install routes with nexthop groups shared per set of BGP nexthops\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	bgp_pic_set(bgp, false);
+	return CMD_SUCCESS;
+}
+
+DEFUN(bgp_adj_out_compact, bgp_adj_out_compact_cmd,
+      "bgp adj-out compact",
+      BGP_STR
+      "Advertised routes state\n"
+      "Keep only a hash of the advertised attributes\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	SET_FLAG(bgp->flags, BGP_FLAG_ADJ_OUT_COMPACT);
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_bgp_adj_out_compact, no_bgp_adj_out_compact_cmd,
+      "no bgp adj-out compact",
+      NO_STR
+      BGP_STR
+      "Advertised routes state\n"
+      "Keep only a hash of the advertised attributes\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	UNSET_FLAG(bgp->flags, BGP_FLAG_ADJ_OUT_COMPACT);
+	return CMD_SUCCESS;
+}
+
 DEFUN(bgp_reject_as_sets, bgp_reject_as_sets_cmd,
       "bgp reject-as-sets",
       BGP_STR
@@ -9693,7 +9839,7 @@ DEFPY (show_bgp_srv6,
 	}
 
 	vty_out(vty, "functions:\n");
-	for (ALL_LIST_ELEMENTS_RO(bgp->srv6_functions, node, func)) {
+	frr_each (bgp_srv6_functions, &bgp->srv6_functions, func) {
 		inet_ntop(AF_INET6, &func->sid, buf, sizeof(buf));
 		vty_out(vty, "- sid: %s\n", buf);
 		vty_out(vty, "  locator: %s\n", func->locator_name);
@@ -10244,6 +10390,13 @@ DEFUN (show_bgp_memory,
 	vty_out(vty, "%ld RIB nodes, using %s of memory\n", count,
 		mtype_memstr(memstrbuf, sizeof(memstrbuf),
 			     count * sizeof(struct bgp_dest)));
+	if ((count = mtype_stats_alloc(MTYPE_BGP_ADDPATH_NODE)))
+		vty_out(vty,
+			"%ld RIB node addpath ID pools, using %s of memory\n",
+			count,
+			mtype_memstr(
+				memstrbuf, sizeof(memstrbuf),
+				count * sizeof(struct bgp_addpath_node_data)));
 
 	count = mtype_stats_alloc(MTYPE_BGP_ROUTE);
 	vty_out(vty, "%ld BGP routes, using %s of memory\n", count,
@@ -10255,6 +10408,13 @@ DEFUN (show_bgp_memory,
 			mtype_memstr(
 				memstrbuf, sizeof(memstrbuf),
 				count * sizeof(struct bgp_path_info_extra)));
+	if ((count = mtype_stats_alloc(MTYPE_BGP_MPATH_INFO)))
+		vty_out(vty,
+			"%ld BGP route multipath entries, using %s of memory\n",
+			count,
+			mtype_memstr(
+				memstrbuf, sizeof(memstrbuf),
+				count * sizeof(struct bgp_path_info_mpath)));
 
 	if ((count = mtype_stats_alloc(MTYPE_BGP_STATIC)))
 		vty_out(vty, "%ld Static routes, using %s of memory\n", count,
@@ -11002,6 +11162,9 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 				outq_count = atomic_load_explicit(
 					&peer->obuf->count,
 					memory_order_relaxed);
+				outq_count += atomic_load_explicit(
+					&peer->obuf_ctrl->count,
+					memory_order_relaxed);
 				inq_count = atomic_load_explicit(
 					&peer->ibuf->count,
 					memory_order_relaxed);
@@ -11167,6 +11330,9 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 				outq_count = atomic_load_explicit(
 					&peer->obuf->count,
 					memory_order_relaxed);
+				outq_count += atomic_load_explicit(
+					&peer->obuf_ctrl->count,
+					memory_order_relaxed);
 				inq_count = atomic_load_explicit(
 					&peer->ibuf->count,
 					memory_order_relaxed);
@@ -11988,6 +12154,7 @@ static void bgp_show_peer_afi(struct vty *vty, struct peer *p, afi_t afi,
 	json_object *json_prefB = NULL;
 	json_object *json_addr = NULL;
 	json_object *json_advmap = NULL;
+	uint32_t sr_done, sr_total;
 
 	if (use_json) {
 		json_addr = json_object_new_object();
@@ -12097,6 +12264,15 @@ static void bgp_show_peer_afi(struct vty *vty, struct peer *p, afi_t afi,
 		if (CHECK_FLAG(p->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG))
 			json_object_boolean_true_add(json_addr,
 						     "inboundSoftConfigPermit");
+		if (bgp_soft_reconfig_in_progress(p, afi, safi, &sr_done,
+						  &sr_total)) {
+			json_object_int_add(json_addr,
+					    "inboundSoftReconfigPrefixesDone",
+					    sr_done);
+			json_object_int_add(json_addr,
+					    "inboundSoftReconfigPrefixesTotal",
+					    sr_total);
+		}
 
 		if (CHECK_FLAG(p->af_flags[afi][safi],
 			       PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE))
@@ -12412,6 +12588,11 @@ static void bgp_show_peer_afi(struct vty *vty, struct peer *p, afi_t afi,
 		if (CHECK_FLAG(p->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG))
 			vty_out(vty,
 				"  Inbound soft reconfiguration allowed\n");
+		if (bgp_soft_reconfig_in_progress(p, afi, safi, &sr_done,
+						  &sr_total))
+			vty_out(vty,
+				"  Inbound soft reconfiguration running, %u of %u prefixes done\n",
+				sr_done, sr_total);
 
 		if (CHECK_FLAG(p->af_flags[afi][safi],
 			       PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE))
@@ -13989,6 +14170,8 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 		atomic_size_t outq_count, inq_count;
 		outq_count = atomic_load_explicit(&p->obuf->count,
 						  memory_order_relaxed);
+		outq_count += atomic_load_explicit(&p->obuf_ctrl->count,
+						   memory_order_relaxed);
 		inq_count = atomic_load_explicit(&p->ibuf->count,
 						 memory_order_relaxed);
 
@@ -14042,6 +14225,8 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 			dynamic_cap_out, dynamic_cap_in;
 		outq_count = atomic_load_explicit(&p->obuf->count,
 						  memory_order_relaxed);
+		outq_count += atomic_load_explicit(&p->obuf_ctrl->count,
+						   memory_order_relaxed);
 		inq_count = atomic_load_explicit(&p->ibuf->count,
 						 memory_order_relaxed);
 		open_out = atomic_load_explicit(&p->open_out,
@@ -17529,6 +17714,12 @@ int bgp_config_write(struct vty *vty)
 	if (bm->tcp_dscp != IPTOS_PREC_INTERNETCONTROL)
 		vty_out(vty, "bgp session-dscp %u\n", bm->tcp_dscp >> 2);
 
+	if (bm->process_threads != BGP_PROCESS_THREADS_DEF)
+		vty_out(vty, "bgp process-threads %u\n", bm->process_threads);
+
+	if (bm->start_rate)
+		vty_out(vty, "bgp session-start-rate %u\n", bm->start_rate);
+
 	/* BGP configuration. */
 	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
 
@@ -17594,6 +17785,12 @@ int bgp_config_write(struct vty *vty)
 					? ""
 					: "no ");
 
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_PIC))
+			vty_out(vty, " bgp pic\n");
+
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_ADJ_OUT_COMPACT))
+			vty_out(vty, " bgp adj-out compact\n");
+
 		/* Send Hard Reset CEASE Notification for 'Administrative Reset'
 		 */
 		if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_HARD_ADMIN_RESET) !=
@@ -17708,10 +17905,24 @@ int bgp_config_write(struct vty *vty)
 		bgp_config_write_wpkt_quanta(vty, bgp);
 		/* read quanta */
 		bgp_config_write_rpkt_quanta(vty, bgp);
+		/* withdraw quanta */
+		if (bgp->withdraw_quanta != BGP_WITHDRAW_QUANTA_DEFAULT)
+			vty_out(vty, " withdraw-quanta %u\n",
+				bgp->withdraw_quanta);
 
 		/* coalesce time */
 		bgp_config_write_coalesce_time(vty, bgp);
 
+		/* adaptive update batching */
+		if (bgp->batch_adaptive) {
+			if (bgp->batch_min != BGP_BATCH_DEFAULT_MIN
+			    || bgp->batch_max != BGP_BATCH_DEFAULT_MAX)
+				vty_out(vty, " update-batching adaptive %u %u\n",
+					bgp->batch_min, bgp->batch_max);
+			else
+				vty_out(vty, " update-batching adaptive\n");
+		}
+
 		/* BGP per-instance graceful-shutdown */
 		/* BGP-wide settings and per-instance settings are mutually
 		 * exclusive.
@@ -18248,6 +18459,11 @@ void bgp_vty_init(void)
 	install_element(CONFIG_NODE, &bgp_session_dscp_cmd);
 	install_element(CONFIG_NODE, &no_bgp_session_dscp_cmd);
 
+	install_element(CONFIG_NODE, &bgp_process_threads_cmd);
+	install_element(CONFIG_NODE, &no_bgp_process_threads_cmd);
+	install_element(CONFIG_NODE, &bgp_session_start_rate_cmd);
+	install_element(CONFIG_NODE, &no_bgp_session_start_rate_cmd);
+
 	/* "bgp router-id" commands. */
 	install_element(BGP_NODE, &bgp_router_id_cmd);
 	install_element(BGP_NODE, &no_bgp_router_id_cmd);
@@ -18294,6 +18510,8 @@ void bgp_vty_init(void)
 	install_element(BGP_NODE, &no_bgp_update_delay_cmd);
 
 	install_element(BGP_NODE, &bgp_wpkt_quanta_cmd);
+	install_element(BGP_NODE, &bgp_withdraw_quanta_cmd);
+	install_element(BGP_NODE, &bgp_update_batching_cmd);
 	install_element(BGP_NODE, &bgp_rpkt_quanta_cmd);
 
 	install_element(BGP_NODE, &bgp_coalesce_time_cmd);
@@ -18356,6 +18574,14 @@ void bgp_vty_init(void)
 	install_element(BGP_NODE, &bgp_suppress_duplicates_cmd);
 	install_element(BGP_NODE, &no_bgp_suppress_duplicates_cmd);
 
+	/* bgp pic */
+	install_element(BGP_NODE, &bgp_pic_cmd);
+	install_element(BGP_NODE, &no_bgp_pic_cmd);
+
+	/* bgp adj-out compact */
+	install_element(BGP_NODE, &bgp_adj_out_compact_cmd);
+	install_element(BGP_NODE, &no_bgp_adj_out_compact_cmd);
+
 	/* bgp reject-as-sets */
 	install_element(BGP_NODE, &bgp_reject_as_sets_cmd);
 	install_element(BGP_NODE, &no_bgp_reject_as_sets_cmd);
@@ -51,6 +51,7 @@
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_bfd.h"
 #include "bgpd/bgp_label.h"
 #ifdef ENABLE_BGP_VNC
@@ -67,6 +68,7 @@
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_community.h"
 #include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_pipeline.h"
 
 /* All information about zebra. */
 struct zclient *zclient = NULL;
@@ -1243,6 +1245,56 @@ static bool bgp_zebra_use_nhop_weighted(struct bgp *bgp, struct attr *attr,
 	return true;
 }
 
+/*
+ * With "bgp pic", plain unicast routes are installed using a nexthop group
+ * shared with all other routes using the same BGP nexthops.  Anything that
+ * makes the nexthops specific to the route (labels, SIDs, weights, a table
+ * map, leaking, ...) means the route is installed with its own nexthops.
+ */
+static uint32_t bgp_zebra_pic_nhg(struct bgp *bgp, const struct prefix *p,
+				  struct bgp_path_info *info, afi_t afi,
+				  safi_t safi)
+{
+	struct bgp_nexthop_cache *bnc[MULTIPATH_NUM];
+	struct bgp_path_info *mpinfo;
+	unsigned int num = 0;
+
+	if (!CHECK_FLAG(bgp->flags, BGP_FLAG_PIC) || safi != SAFI_UNICAST)
+		return 0;
+
+	if (info->type != ZEBRA_ROUTE_BGP
+	    || info->sub_type != BGP_ROUTE_NORMAL)
+		return 0;
+
+	if (bgp->table_map[afi][safi].name
+	    || bgp_path_info_mpath_chkwtd(bgp, info)
+	    || CHECK_FLAG(info->attr->flag, ATTR_FLAG_BIT(BGP_ATTR_SRTE_COLOR)))
+		return 0;
+
+	for (mpinfo = info; mpinfo; mpinfo = bgp_path_info_mpath_next(mpinfo)) {
+		if (num >= multipath_num)
+			break;
+
+		if (!mpinfo->nexthop
+		    || !CHECK_FLAG(mpinfo->nexthop->flags, BGP_NEXTHOP_VALID)
+		    || mpinfo->nexthop->prefix.family != p->family)
+			return 0;
+
+		if (mpinfo->extra
+		    && (mpinfo->extra->bgp_orig
+			|| bgp_is_valid_label(&mpinfo->extra->label[0])
+			|| !sid_zero(&mpinfo->extra->sid[0].sid)))
+			return 0;
+
+		if (is_route_parent_evpn(mpinfo))
+			return 0;
+
+		bnc[num++] = mpinfo->nexthop;
+	}
+
+	return bgp_nhg_get(bnc, num);
+}
+
 void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 			struct bgp_path_info *info, struct bgp *bgp, afi_t afi,
 			safi_t safi)
@@ -1268,6 +1320,7 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 	bool do_wt_ecmp;
 	uint64_t cum_bw = 0;
 	uint32_t nhg_id = 0;
+	uint32_t pic_id = 0;
 	bool is_add;
 	uint32_t ttl = 0;
 	uint32_t bos = 0;
@@ -1348,6 +1401,11 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 		api.nhgid = nhg_id;
 		if (nhg_id)
 			SET_FLAG(api.message, ZAPI_MESSAGE_NHG);
+	} else if ((pic_id = bgp_zebra_pic_nhg(bgp, p, info, afi, safi))) {
+		mpinfo = NULL;
+		nhg_id = pic_id;
+		api.nhgid = pic_id;
+		SET_FLAG(api.message, ZAPI_MESSAGE_NHG);
 	} else {
 		mpinfo = info;
 	}
@@ -1642,6 +1700,24 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 	}
 	zclient_route_send(is_add ? ZEBRA_ROUTE_ADD : ZEBRA_ROUTE_DELETE,
 			   zclient, &api);
+	bgp_pipe_record(info->peer, afi, safi, BGP_PIPE_ZEBRA,
+			bgp_pipe_process_since);
+
+	/* the previous group is only released once zebra has the new one */
+	bgp_nhg_release(dest->nhg_id);
+	dest->nhg_id = pic_id;
+}
+
+void bgp_zebra_batch_begin(void)
+{
+	if (zclient)
+		zclient_route_batch_begin(zclient);
+}
+
+void bgp_zebra_batch_commit(void)
+{
+	if (zclient)
+		zclient_route_batch_commit(zclient);
 }
 
 /* Announce all routes of a table to zebra */
@@ -1661,6 +1737,7 @@ void bgp_zebra_announce_table(struct bgp *bgp, afi_t afi, safi_t safi)
 	if (!table)
 		return;
 
+	bgp_zebra_batch_begin();
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
 			if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED) &&
@@ -1672,6 +1749,7 @@ void bgp_zebra_announce_table(struct bgp *bgp, afi_t afi, safi_t safi)
 				bgp_zebra_announce(dest,
 						   bgp_dest_get_prefix(dest),
 						   pi, bgp, afi, safi);
+	bgp_zebra_batch_commit();
 }
 
 /* Announce routes of any bgp subtype of a table to zebra */
@@ -1689,6 +1767,7 @@ void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
 	if (!table)
 		return;
 
+	bgp_zebra_batch_begin();
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
 			if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED) &&
@@ -1696,6 +1775,7 @@ void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
 				bgp_zebra_announce(dest,
 						   bgp_dest_get_prefix(dest),
 						   pi, bgp, afi, safi);
+	bgp_zebra_batch_commit();
 }
 
 void bgp_zebra_withdraw(const struct prefix *p, struct bgp_path_info *info,
@@ -1732,6 +1812,11 @@ void bgp_zebra_withdraw(const struct prefix *p, struct bgp_path_info *info,
 			   &api.prefix);
 
 	zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+
+	if (info->net) {
+		bgp_nhg_release(info->net->nhg_id);
+		info->net->nhg_id = 0;
+	}
 }
 
 /* Withdraw all entries in a BGP instances RIB table from Zebra */
@@ -1748,6 +1833,7 @@ void bgp_zebra_withdraw_table_all_subtypes(struct bgp *bgp, afi_t afi, safi_t sa
 	if (!table)
 		return;
 
+	bgp_zebra_batch_begin();
 	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
 		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
 			if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED)
@@ -1756,6 +1842,7 @@ void bgp_zebra_withdraw_table_all_subtypes(struct bgp *bgp, afi_t afi, safi_t sa
 						   pi, bgp, safi);
 		}
 	}
+	bgp_zebra_batch_commit();
 }
 
 struct bgp_redist *bgp_redist_lookup(struct bgp *bgp, afi_t afi, uint8_t type,
@@ -2625,6 +2712,22 @@ static int bgp_zebra_route_notify_owner(int command, struct zclient *zclient,
  * - either for iptable/ipset using fwmark id
  * - or for sample ip rule cmd
  */
+/*
+ * ipset entries are sent to zebra in batches, up to this many in one
+ * message.  Anything else PBR sends the batch first, so that zebra sees
+ * everything in order (an ipset is created before its entries are added,
+ * and gets its entries removed before it's destroyed).
+ */
+#define BGP_PBR_ENTRY_BATCH 128
+
+static struct {
+	struct stream *s;
+	uint16_t command;
+	uint32_t count;
+	struct bgp_pbr_match_entry *entries[BGP_PBR_ENTRY_BATCH];
+	struct thread *t_flush;
+} bgp_pbr_entry_batch;
+
 static void bgp_encode_pbr_rule_action(struct stream *s,
 				       struct bgp_pbr_action *pbra,
 				       struct bgp_pbr_rule *pbr)
@@ -2767,6 +2870,9 @@ static void bgp_zebra_connected(struct zclient *zclient)
 	/* Send the client registration */
 	bfd_client_sendmsg(zclient, ZEBRA_BFD_CLIENT_REGISTER, VRF_DEFAULT);
 
+	/* shared nexthop groups are sent again with the routes */
+	bgp_nhg_zebra_connected();
+
 	/* At this point, we may or may not have BGP instances configured, but
 	 * we're only interested in the default VRF (others wouldn't have learnt
 	 * the VRF from Zebra yet.)
@@ -3224,13 +3330,13 @@ static int bgp_zebra_process_srv6_locator_delete(ZAPI_CALLBACK_ARGS)
 		}
 
 	// refresh functions
-	for (ALL_LIST_ELEMENTS(bgp->srv6_functions, node, nnode, func)) {
+	frr_each_safe (bgp_srv6_functions, &bgp->srv6_functions, func) {
 		tmp_prefi.family = AF_INET6;
 		tmp_prefi.prefixlen = 128;
 		tmp_prefi.prefix = func->sid;
 		if (prefix_match((struct prefix *)&loc.prefix,
 				 (struct prefix *)&tmp_prefi)) {
-			listnode_delete(bgp->srv6_functions, func);
+			bgp_srv6_functions_del(&bgp->srv6_functions, func);
 			XFREE(MTYPE_BGP_SRV6_FUNCTION, func);
 		}
 	}
@@ -3366,6 +3472,9 @@ void bgp_zebra_destroy(void)
 {
 	if (zclient == NULL)
 		return;
+	bgp_send_pbr_ipset_entry_flush();
+	stream_free(bgp_pbr_entry_batch.s);
+	bgp_pbr_entry_batch.s = NULL;
 	zclient_stop(zclient);
 	zclient_free(zclient);
 	zclient = NULL;
@@ -3376,6 +3485,42 @@ int bgp_zebra_num_connects(void)
 	return zclient_num_connects;
 }
 
+void bgp_send_pbr_ipset_entry_flush(void)
+{
+	uint32_t i;
+
+	if (!bgp_pbr_entry_batch.count)
+		return;
+
+	THREAD_OFF(bgp_pbr_entry_batch.t_flush);
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("%s: %u entries %s", __func__,
+			   bgp_pbr_entry_batch.count,
+			   bgp_pbr_entry_batch.command == ZEBRA_IPSET_ENTRY_ADD
+				   ? "add"
+				   : "delete");
+
+	stream_putl_at(bgp_pbr_entry_batch.s, ZEBRA_HEADER_SIZE,
+		       bgp_pbr_entry_batch.count);
+	stream_putw_at(bgp_pbr_entry_batch.s, 0,
+		       stream_get_endp(bgp_pbr_entry_batch.s));
+	stream_copy(zclient->obuf, bgp_pbr_entry_batch.s);
+
+	if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE
+	    && bgp_pbr_entry_batch.command == ZEBRA_IPSET_ENTRY_ADD)
+		for (i = 0; i < bgp_pbr_entry_batch.count; i++)
+			bgp_pbr_entry_batch.entries[i]->install_in_progress =
+				false;
+
+	bgp_pbr_entry_batch.count = 0;
+}
+
+static void bgp_pbr_entry_batch_timer(struct thread *thread)
+{
+	bgp_send_pbr_ipset_entry_flush();
+}
+
 void bgp_send_pbr_rule_action(struct bgp_pbr_action *pbra,
 			      struct bgp_pbr_rule *pbr,
 			      bool install)
@@ -3386,6 +3531,7 @@ void bgp_send_pbr_rule_action(struct bgp_pbr_action *pbra,
 		return;
 	if (pbr && pbr->install_in_progress)
 		return;
+	bgp_send_pbr_ipset_entry_flush();
 	if (BGP_DEBUG(zebra, ZEBRA)) {
 		if (pbr)
 			zlog_debug("%s: table %d (ip rule) %d", __func__,
@@ -3420,6 +3566,7 @@ void bgp_send_pbr_ipset_match(struct bgp_pbr_match *pbrim, bool install)
 
 	if (pbrim->install_in_progress)
 		return;
+	bgp_send_pbr_ipset_entry_flush();
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: name %s type %d %d, ID %u", __func__,
 			   pbrim->ipset_name, pbrim->type, install,
@@ -3441,9 +3588,14 @@ void bgp_send_pbr_ipset_match(struct bgp_pbr_match *pbrim, bool install)
 		pbrim->install_in_progress = true;
 }
 
+/* Queues the entry for the next batch, which is sent when full or at the
+ * latest once the current event is done.
+ */
 void bgp_send_pbr_ipset_entry_match(struct bgp_pbr_match_entry *pbrime,
 				    bool install)
 {
+	uint16_t command =
+		install ? ZEBRA_IPSET_ENTRY_ADD : ZEBRA_IPSET_ENTRY_DELETE;
 	struct stream *s;
 
 	if (pbrime->install_in_progress)
@@ -3452,21 +3604,31 @@ void bgp_send_pbr_ipset_entry_match(struct bgp_pbr_match_entry *pbrime,
 		zlog_debug("%s: name %s %d %d, ID %u", __func__,
 			   pbrime->backpointer->ipset_name, pbrime->unique,
 			   install, pbrime->unique);
-	s = zclient->obuf;
-	stream_reset(s);
 
-	zclient_create_header(s,
-			      install ? ZEBRA_IPSET_ENTRY_ADD :
-			      ZEBRA_IPSET_ENTRY_DELETE,
-			      VRF_DEFAULT);
+	if (bgp_pbr_entry_batch.count
+	    && bgp_pbr_entry_batch.command != command)
+		bgp_send_pbr_ipset_entry_flush();
 
-	stream_putl(s, 1); /* send one pbr action */
+	if (!bgp_pbr_entry_batch.s)
+		bgp_pbr_entry_batch.s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = bgp_pbr_entry_batch.s;
 
-	bgp_encode_pbr_ipset_entry_match(s, pbrime);
+	if (!bgp_pbr_entry_batch.count) {
+		stream_reset(s);
+		zclient_create_header(s, command, VRF_DEFAULT);
+		stream_putl(s, 0); /* number of entries, set when sent */
+		bgp_pbr_entry_batch.command = command;
+		thread_add_event(bm->master, bgp_pbr_entry_batch_timer, NULL, 0,
+				 &bgp_pbr_entry_batch.t_flush);
+	}
 
-	stream_putw_at(s, 0, stream_get_endp(s));
-	if ((zclient_send_message(zclient) != ZCLIENT_SEND_FAILURE) && install)
+	bgp_encode_pbr_ipset_entry_match(s, pbrime);
+	if (install)
 		pbrime->install_in_progress = true;
+	bgp_pbr_entry_batch.entries[bgp_pbr_entry_batch.count++] = pbrime;
+
+	if (bgp_pbr_entry_batch.count == BGP_PBR_ENTRY_BATCH)
+		bgp_send_pbr_ipset_entry_flush();
 }
 
 static void bgp_encode_pbr_interface_list(struct bgp *bgp, struct stream *s,
@@ -3520,6 +3682,7 @@ void bgp_send_pbr_iptable(struct bgp_pbr_action *pba,
 
 	if (pbm->install_iptable_in_progress)
 		return;
+	bgp_send_pbr_ipset_entry_flush();
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: name %s type %d mark %d %d, ID %u", __func__,
 			   pbm->ipset_name, pbm->type, pba->fwmark, install,
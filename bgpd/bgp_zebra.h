@@ -50,6 +50,10 @@ extern void bgp_zebra_withdraw(const struct prefix *p,
 			       struct bgp_path_info *path, struct bgp *bgp,
 			       safi_t safi);
 
+/* Collect route updates sent in between into batches for zebra */
+extern void bgp_zebra_batch_begin(void);
+extern void bgp_zebra_batch_commit(void);
+
 /* Announce routes of any bgp subtype of a table to zebra */
 extern void bgp_zebra_announce_table_all_subtypes(struct bgp *bgp, afi_t afi,
 						  safi_t safi);
@@ -119,6 +123,8 @@ extern void bgp_send_pbr_rule_action(struct bgp_pbr_action *pbra,
 				     bool install);
 extern void bgp_send_pbr_ipset_match(struct bgp_pbr_match *pbrim,
 				     bool install);
+/* Sends the ipset entries queued by bgp_send_pbr_ipset_entry_match() */
+extern void bgp_send_pbr_ipset_entry_flush(void);
 extern void bgp_send_pbr_ipset_entry_match(struct bgp_pbr_match_entry *pbrime,
 				    bool install);
 extern void bgp_send_pbr_iptable(struct bgp_pbr_action *pba,
@@ -78,6 +78,7 @@
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_bfd.h"
 #include "bgpd/bgp_memory.h"
@@ -92,6 +93,8 @@
 #include "bgpd/bgp_evpn_private.h"
 #include "bgpd/bgp_evpn_mh.h"
 #include "bgpd/bgp_mac.h"
+#include "bgpd/bgp_process_mt.h"
+#include "bgpd/bgp_pipeline.h"
 
 DEFINE_MTYPE_STATIC(BGPD, PEER_TX_SHUTDOWN_MSG, "Peer shutdown message (TX)");
 DEFINE_MTYPE_STATIC(BGPD, BGP_EVPN_INFO, "BGP EVPN instance information");
@@ -1112,6 +1115,7 @@ static void peer_free(struct peer *peer)
 	BGP_EVENT_FLUSH(peer);
 
 	pthread_mutex_destroy(&peer->io_mtx);
+	bgp_pipe_peer_free(peer);
 
 	/* Free connected nexthop, if present */
 	if (CHECK_FLAG(peer->flags, PEER_FLAG_CONFIG_NODE)
@@ -1307,20 +1311,35 @@ int bgp_peer_gr_init(struct peer *peer)
 	return BGP_GR_SUCCESS;
 }
 
+int bgp_srv6_function_cmp(const struct bgp_srv6_function *a,
+			  const struct bgp_srv6_function *b)
+{
+	return memcmp(&a->sid, &b->sid, sizeof(a->sid));
+}
+
+uint32_t bgp_srv6_function_hash(const struct bgp_srv6_function *func)
+{
+	return jhash(&func->sid, sizeof(func->sid), 0x5a1c0de6);
+}
+
 static void bgp_srv6_init(struct bgp *bgp)
 {
 	bgp->srv6_enabled = false;
 	memset(bgp->srv6_locator_name, 0, sizeof(bgp->srv6_locator_name));
 	bgp->srv6_locator_chunks = list_new();
-	bgp->srv6_functions = list_new();
+	bgp_srv6_functions_init(&bgp->srv6_functions);
 }
 
 static void bgp_srv6_cleanup(struct bgp *bgp)
 {
+	struct bgp_srv6_function *func;
+
 	if (bgp->srv6_locator_chunks)
 		list_delete(&bgp->srv6_locator_chunks);
-	if (bgp->srv6_functions)
-		list_delete(&bgp->srv6_functions);
+
+	while ((func = bgp_srv6_functions_pop(&bgp->srv6_functions)))
+		XFREE(MTYPE_BGP_SRV6_FUNCTION, func);
+	bgp_srv6_functions_fini(&bgp->srv6_functions);
 }
 
 /* Allocate new peer object, implicitely locked.  */
@@ -1380,7 +1399,11 @@ struct peer *peer_new(struct bgp *bgp)
 	/* Create buffers.  */
 	peer->ibuf = stream_fifo_new();
 	peer->obuf = stream_fifo_new();
+	peer->obuf_ctrl = stream_fifo_new();
 	pthread_mutex_init(&peer->io_mtx, NULL);
+	bgp_preparse_init(&peer->preparse);
+	bgp_obuf_shared_init(&peer->obuf_shared);
+	bgp_pipe_peer_init(peer);
 
 	/* We use a larger buffer for peer->obuf_work in the event that:
 	 * - We RX a BGP_UPDATE where the attributes alone are just
@@ -2490,11 +2513,22 @@ int peer_delete(struct peer *peer)
 		peer->ibuf = NULL;
 	}
 
+	bgp_attr_preparse_flush(peer);
+	bgp_preparse_fini(&peer->preparse);
+
 	if (peer->obuf) {
 		stream_fifo_free(peer->obuf);
 		peer->obuf = NULL;
 	}
 
+	if (peer->obuf_ctrl) {
+		stream_fifo_free(peer->obuf_ctrl);
+		peer->obuf_ctrl = NULL;
+	}
+
+	bgp_obuf_shared_flush(peer);
+	bgp_obuf_shared_fini(&peer->obuf_shared);
+
 	if (peer->ibuf_work) {
 		ringbuf_del(peer->ibuf_work);
 		peer->ibuf_work = NULL;
@@ -3247,6 +3281,9 @@ static struct bgp *bgp_create(as_t *as, const char *name,
 			      memory_order_relaxed);
 	atomic_store_explicit(&bgp->rpkt_quanta, BGP_READ_PACKET_MAX,
 			      memory_order_relaxed);
+	bgp->withdraw_quanta = BGP_WITHDRAW_QUANTA_DEFAULT;
+	bgp->batch_min = BGP_BATCH_DEFAULT_MIN;
+	bgp->batch_max = BGP_BATCH_DEFAULT_MAX;
 	bgp->coalesce_time = BGP_DEFAULT_SUBGROUP_COALESCE_TIME;
 	bgp->default_af[AFI_IP][SAFI_UNICAST] = true;
 
@@ -3471,6 +3508,7 @@ int bgp_get(struct bgp **bgp_val, as_t *as, const char *name,
 	 */
 	bgp_handle_socket(bgp, vrf, VRF_UNKNOWN, true);
 	listnode_add(bm->bgp, bgp);
+	vpn_leak_import_rt_changed();
 
 	if (IS_BGP_INST_KNOWN_TO_ZEBRA(bgp)) {
 		if (BGP_DEBUG(zebra, ZEBRA))
@@ -3660,6 +3698,7 @@ int bgp_delete(struct bgp *bgp)
 		bgp_unlock(bgp); /* TODO - This timer is started with a lock -
 				    why? */
 	}
+	THREAD_OFF(bgp->t_updgrp_build);
 
 	/* Inform peers we're going down. */
 	for (ALL_LIST_ELEMENTS(bgp->peer, node, next, peer)) {
@@ -3720,6 +3759,7 @@ int bgp_delete(struct bgp *bgp)
 	 * routes to be processed still referencing the struct bgp.
 	 */
 	listnode_delete(bm->bgp, bgp);
+	vpn_leak_import_rt_changed();
 
 	/* Free interfaces in this instance. */
 	bgp_if_finish(bgp);
@@ -6691,6 +6731,46 @@ int peer_prefix_list_unset(struct peer *peer, afi_t afi, safi_t safi,
 	return 0;
 }
 
+/*
+ * Prefixes the entries changed since the last add/delete hook cover,
+ * widened to a single covering prefix if there are several.  Only routes
+ * under it need to be looked at again.
+ */
+static struct {
+	struct prefix_list *plist;
+	bool all;
+	struct prefix prefix;
+} peer_plist_delta;
+
+static void peer_prefix_list_entry_update(struct prefix_list *plist,
+					  const struct prefix *prefix)
+{
+	int bits;
+
+	if (peer_plist_delta.plist != plist) {
+		peer_plist_delta.plist = plist;
+		peer_plist_delta.all = !prefix;
+		if (prefix)
+			prefix_copy(&peer_plist_delta.prefix, prefix);
+		return;
+	}
+
+	if (peer_plist_delta.all)
+		return;
+
+	if (!prefix || prefix->family != peer_plist_delta.prefix.family) {
+		peer_plist_delta.all = true;
+		return;
+	}
+
+	bits = prefix_common_bits(&peer_plist_delta.prefix, prefix);
+	bits = MIN(bits, prefix->prefixlen);
+	if (bits < peer_plist_delta.prefix.prefixlen) {
+		peer_plist_delta.prefix.prefixlen = bits;
+		apply_mask(&peer_plist_delta.prefix);
+	}
+}
+
 /* Update prefix-list list. */
 static void peer_prefix_list_update(struct prefix_list *plist)
 {
@@ -6700,18 +6780,33 @@ static void peer_prefix_list_update(struct prefix_list *plist)
 	struct peer *peer;
 	struct peer_group *group;
 	struct bgp_filter *filter;
+	struct prefix delta_prefix;
+	const struct prefix *delta = NULL;
 	afi_t afi;
 	safi_t safi;
 	int direct;
 
+	/* A default route entry covers everything, walk it all */
+	if (plist && peer_plist_delta.plist == plist && !peer_plist_delta.all
+	    && peer_plist_delta.prefix.prefixlen) {
+		prefix_copy(&delta_prefix, &peer_plist_delta.prefix);
+		delta = &delta_prefix;
+	}
+	memset(&peer_plist_delta, 0, sizeof(peer_plist_delta));
+
 	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
 
 		/*
 		 * Update the prefix-list on update groups.
 		 */
-		update_group_policy_update(
-			bgp, BGP_POLICY_PREFIX_LIST,
-			plist ? prefix_list_name(plist) : NULL, true, 0);
+		if (delta)
+			update_group_prefix_list_update(
+				bgp, prefix_list_name(plist), delta);
+		else
+			update_group_policy_update(
+				bgp, BGP_POLICY_PREFIX_LIST,
+				plist ? prefix_list_name(plist) : NULL, true,
+				0);
 
 		for (ALL_LIST_ELEMENTS(bgp->peer, node, nnode, peer)) {
 			FOREACH_AFI_SAFI (afi, safi) {
@@ -6730,11 +6825,31 @@ static void peer_prefix_list_update(struct prefix_list *plist)
 							NULL;
 				}
 
+				if (!peer->afc_nego[afi][safi])
+					continue;
+
 				/* If we touch prefix-list, we need to process
 				 * new updates. This is important for ORF to
 				 * work correctly as well.
+				 *
+				 * For a single entry only peers filtering on
+				 * it are affected, and with soft reconfig
+				 * only the routes the entry covers.
 				 */
-				if (peer->afc_nego[afi][safi])
+				if (!delta)
+					peer_on_policy_change(peer, afi, safi,
+							      0);
+				else if (filter->plist[FILTER_IN].plist != plist
+					 || family2afi(delta->family) != afi)
+					continue;
+				else if (CHECK_FLAG(peer->af_flags[afi][safi],
+						    PEER_FLAG_SOFT_RECONFIG)
+					 && safi != SAFI_MPLS_VPN
+					 && safi != SAFI_ENCAP
+					 && safi != SAFI_EVPN)
+					bgp_soft_reconfig_in_prefix(peer, afi,
+								    safi, delta);
+				else
 					peer_on_policy_change(peer, afi, safi,
 							      0);
 			}
@@ -7240,7 +7355,8 @@ static void peer_advertise_map_filter_update(struct peer *peer, afi_t afi,
 	if (!filter_exists) {
 		filter->advmap.update_type = UPDATE_TYPE_ADVERTISE;
 		bgp_conditional_adv_enable(peer, afi, safi);
-	}
+	} else
+		bgp_conditional_adv_schedule(peer->bgp);
 
 	/* Process peer route updates. */
 	peer_on_policy_change(peer, afi, safi, 1);
@@ -7997,6 +8113,7 @@ void bgp_master_init(struct thread_master *master, const int buffer_size,
 	bm->socket_buffer = buffer_size;
 	bm->wait_for_fib = false;
 	bm->tcp_dscp = IPTOS_PREC_INTERNETCONTROL;
+	bm->process_threads = BGP_PROCESS_THREADS_DEF;
 
 	bgp_mac_init();
 	/* init the rd id space.
@@ -8010,6 +8127,7 @@ void bgp_master_init(struct thread_master *master, const int buffer_size,
 	bgp_lp_init(bm->master, &bm->labelpool);
 
 	bgp_l3nhg_init();
+	bgp_nhg_init();
 	bgp_evpn_mh_init();
 	QOBJ_REG(bm, bgp_master);
 }
@@ -8083,7 +8201,6 @@ static const struct cmd_variable_handler bgp_viewvrf_var_handlers[] = {
 };
 
 struct frr_pthread *bgp_pth_io;
-struct frr_pthread *bgp_pth_ka;
 
 static void bgp_pthreads_init(void)
 {
@@ -8094,27 +8211,24 @@ static void bgp_pthreads_init(void)
 		.start = frr_pthread_attr_default.start,
 		.stop = frr_pthread_attr_default.stop,
 	};
-	struct frr_pthread_attr ka = {
-		.start = bgp_keepalives_start,
-		.stop = bgp_keepalives_stop,
-	};
 	bgp_pth_io = frr_pthread_new(&io, "BGP I/O thread", "bgpd_io");
-	bgp_pth_ka = frr_pthread_new(&ka, "BGP Keepalives thread", "bgpd_ka");
+	bgp_keepalives_init();
 }
 
 void bgp_pthreads_run(void)
 {
 	frr_pthread_run(bgp_pth_io, NULL);
-	frr_pthread_run(bgp_pth_ka, NULL);
+	bgp_keepalives_run();
 
 	/* Wait until threads are ready. */
 	frr_pthread_wait_running(bgp_pth_io);
-	frr_pthread_wait_running(bgp_pth_ka);
 }
 
 void bgp_pthreads_finish(void)
 {
+	bgp_process_mt_finish();
 	frr_pthread_stop_all();
+	bgp_keepalives_finish();
 }
 
 static int peer_unshut_after_cfg(struct bgp *bgp)
@@ -8190,6 +8304,7 @@ void bgp_init(unsigned short instance)
 	prefix_list_init();
 	prefix_list_add_hook(peer_prefix_list_update);
 	prefix_list_delete_hook(peer_prefix_list_update);
+	prefix_list_entry_hook(peer_prefix_list_entry_update);
 
 	/* Community list initialize. */
 	bgp_clist = community_list_init();
@@ -8198,6 +8313,7 @@ void bgp_init(unsigned short instance)
 	bgp_bfd_init(bm->master);
 
 	bgp_lp_vty_init();
+	bgp_pipe_vty_init();
 
 	cmd_variable_handler_register(bgp_viewvrf_var_handlers);
 }
@@ -54,8 +54,14 @@
 /* Default interval for IPv6 RAs when triggered by BGP unnumbered neighbor. */
 #define BGP_UNNUM_DEFAULT_RA_INTERVAL 10
 
+PREDECL_LIST(bgp_preparse);
+PREDECL_LIST(bgp_obuf_shared);
+
 struct update_subgroup;
 struct bpacket;
+struct bgp_attr_preparse;
+struct bgp_pipe_stats;
+struct bgp_stale_sweep;
 struct bgp_pbr_config;
 
 /*
@@ -175,6 +181,12 @@ struct bgp_master {
 	/* DSCP value for TCP sessions */
 	uint8_t tcp_dscp;
 
+	/* Number of pthreads used for best path selection */
+	uint8_t process_threads;
+
+	/* Max. sessions started per second, 0 = no limit */
+	uint16_t start_rate;
+
 	QOBJ_FIELDS;
 };
 DECLARE_QOBJ_TYPE(bgp_master);
@@ -329,11 +341,22 @@ struct bgp_snmp_stats {
 	uint32_t routes_deleted;
 };
 
+PREDECL_HASH(bgp_srv6_functions);
+
 struct bgp_srv6_function {
 	struct in6_addr sid;
 	char locator_name[SRV6_LOCNAME_SIZE];
+
+	struct bgp_srv6_functions_item itm;
 };
 
+extern int bgp_srv6_function_cmp(const struct bgp_srv6_function *a,
+				 const struct bgp_srv6_function *b);
+extern uint32_t bgp_srv6_function_hash(const struct bgp_srv6_function *func);
+
+DECLARE_HASH(bgp_srv6_functions, struct bgp_srv6_function, itm,
+	     bgp_srv6_function_cmp, bgp_srv6_function_hash);
+
 /* BGP instance structure.  */
 struct bgp {
 	/* AS number of this BGP instance.  */
@@ -380,6 +403,16 @@ struct bgp {
 		uint32_t peer_refreshes_combined;
 		uint32_t adj_count;
 		uint32_t merge_checks_triggered;
+		/* compact adj-out state shared by splits, and copied later */
+		uint32_t adj_share_events;
+		uint32_t adj_unshare_events;
+		/* adj-outs copied by splits, time spent splitting/merging */
+		uint64_t split_adj_copied;
+		uint64_t split_usecs;
+		uint64_t merge_usecs;
+		/* UPDATEs built and the NLRI that went into them */
+		uint64_t updates_built;
+		uint64_t updates_nlri;
 
 		uint32_t updgrps_created;
 		uint32_t updgrps_deleted;
@@ -491,11 +524,15 @@ struct bgp {
 #define BGP_FLAG_SHUTDOWN (1 << 25)
 #define BGP_FLAG_SUPPRESS_FIB_PENDING (1 << 26)
 #define BGP_FLAG_SUPPRESS_DUPLICATES (1 << 27)
+/* Install routes with shared nexthop groups, see bgp_nhg.h */
+#define BGP_FLAG_PIC (1 << 28)
 #define BGP_FLAG_PEERTYPE_MULTIPATH_RELAX (1 << 29)
 /* Indicate Graceful Restart support for BGP NOTIFICATION messages */
 #define BGP_FLAG_GRACEFUL_NOTIFICATION (1 << 30)
 /* Send Hard Reset CEASE Notification for 'Administrative Reset' */
 #define BGP_FLAG_HARD_ADMIN_RESET (1 << 31)
+/* Keep only the hash of advertised attributes, see bgp_updgrp_adv.c */
+#define BGP_FLAG_ADJ_OUT_COMPACT (1ULL << 32)
 
 	/* BGP default address-families.
 	 * New peers inherit enabled afi/safis from bgp instance.
@@ -590,6 +627,9 @@ struct bgp {
 	struct thread *t_rmap_def_originate_eval;
 #define RMAP_DEFAULT_ORIGINATE_EVAL_TIMER 5
 
+	/* parallel UPDATE building, see update_group_build_packets() */
+	struct thread *t_updgrp_build;
+
 	/* BGP distance configuration.  */
 	uint8_t distance_ebgp[AFI_MAX][SAFI_MAX];
 	uint8_t distance_ibgp[AFI_MAX][SAFI_MAX];
@@ -631,12 +671,19 @@ struct bgp {
 
 	_Atomic uint32_t wpkt_quanta; // max # packets to write per i/o cycle
 	_Atomic uint32_t rpkt_quanta; // max # packets to read per i/o cycle
+	/* WITHDRAW packets built ahead of announcements */
+	uint32_t withdraw_quanta;
 
 	/* Automatic coalesce adjust on/off */
 	bool heuristic_coalesce;
 	/* Actual coalesce time */
 	uint32_t coalesce_time;
 
+	/* Adaptive update batching window bounds (ms), if batch_adaptive */
+	bool batch_adaptive;
+	uint32_t batch_min;
+	uint32_t batch_max;
+
 	/* Auto-shutdown new peers */
 	bool autoshutdown;
 
@@ -769,7 +816,7 @@ struct bgp {
 	bool srv6_enabled;
 	char srv6_locator_name[SRV6_LOCNAME_SIZE];
 	struct list *srv6_locator_chunks;
-	struct list *srv6_functions;
+	struct bgp_srv6_functions_head srv6_functions;
 	uint32_t tovpn_sid_index; /* unset => set to 0 */
 	struct in6_addr *tovpn_sid;
 	struct in6_addr *tovpn_sid_locator;
@@ -915,6 +962,11 @@ struct bgp_filter {
 		struct route_map *cmap;
 
 		enum update_type update_type;
+
+		/* a prefix matched by cmap, family 0 if there's none; the
+		 * condition only has to be evaluated again when it changes
+		 */
+		struct prefix witness;
 	} advmap;
 };
 
@@ -1115,9 +1167,13 @@ struct peer {
 	struct in_addr local_id;
 
 	/* Packet receive and send buffer. */
-	pthread_mutex_t io_mtx;   // guards ibuf, obuf
+	pthread_mutex_t io_mtx;   // guards ibuf, obuf, obuf_ctrl
 	struct stream_fifo *ibuf; // packets waiting to be processed
 	struct stream_fifo *obuf; // packets waiting to be written
+	/* KEEPALIVEs to be written ahead of what is waiting on obuf */
+	struct stream_fifo *obuf_ctrl;
+	/* shared remainders of packets on obuf, guarded by io_mtx */
+	struct bgp_obuf_shared_head obuf_shared;
 
 	/* used as a block to deposit raw wire data to */
 	uint8_t ibuf_scratch[BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE
@@ -1127,6 +1183,13 @@ struct peer {
 
 	struct stream *curr; // the current packet being parsed
 
+	/* AS paths decoded by the I/O pthread, one entry per UPDATE on ibuf */
+	struct bgp_preparse_head preparse;  // guarded by io_mtx
+	struct bgp_attr_preparse *curr_preparse; // entry matching curr
+
+	/* latency histograms, see bgp_pipeline.h */
+	struct bgp_pipe_stats *pipe;
+
 	/* We use a separate stream to encode MP_REACH_NLRI for efficient
 	 * NLRI packing. peer->obuf_work stores all the other attributes. The
 	 * actual packet is then constructed by concatenating the two.
@@ -1375,6 +1438,13 @@ struct peer {
 
 	/* NSF mode (graceful restart) */
 	uint8_t nsf[AFI_MAX][SAFI_MAX];
+	/* Paths received before the last increment are stale; marking all
+	 * of them (restart, BoRR) is incrementing it.  See
+	 * bgp_path_info_stale().
+	 */
+	uint16_t stale_gen[AFI_MAX][SAFI_MAX];
+	/* removing the stale paths, in the background */
+	struct bgp_stale_sweep *stale_sweep[AFI_MAX][SAFI_MAX];
 	/* EOR Send time */
 	time_t eor_stime[AFI_MAX][SAFI_MAX];
 	/* Last update packet sent time */
@@ -1441,6 +1511,8 @@ struct peer {
 #define PEER_STATUS_NSF_WAIT          (1U << 6) /* wait comeback peer */
 /* received extended format encoding for OPEN message */
 #define PEER_STATUS_EXT_OPT_PARAMS_LENGTH (1U << 7)
+/* start timer re-armed for a "bgp session-start-rate" slot */
+#define PEER_STATUS_START_SLOT        (1U << 8)
 
 	/* Peer status af flags (reset in bgp_stop) */
 	uint16_t af_sflags[AFI_MAX][SAFI_MAX];
@@ -1493,6 +1565,9 @@ struct peer {
 	struct thread *t_process_packet;
 	struct thread *t_process_packet_error;
 	struct thread *t_refresh_stalepath;
+	/* on ka_pth's thread_master */
+	struct thread *t_keepalive;
+	struct frr_pthread *ka_pth;
 
 	/* Thread flags. */
 	_Atomic uint32_t thread_flags;
@@ -1722,7 +1797,7 @@ struct peer {
 
 	/* Conditional advertisement */
 	bool advmap_config_change[AFI_MAX][SAFI_MAX];
-	bool advmap_table_change;
+	bool advmap_table_change[AFI_MAX][SAFI_MAX];
 
 	/* set TCP max segment size */
 	uint32_t tcp_mss;
@@ -2109,6 +2184,10 @@ extern void bgp_init(unsigned short instance);
 extern void bgp_pthreads_run(void);
 extern void bgp_pthreads_finish(void);
 extern void bgp_route_map_init(void);
+/* route_map_apply() remembering the results of prefix independent maps */
+extern route_map_result_t bgp_route_map_apply_cached(struct route_map *map,
+						     const struct prefix *p,
+						     struct bgp_path_info *path);
 extern void bgp_session_reset(struct peer *);
 
 extern int bgp_option_set(int);
@@ -519,7 +519,7 @@ static void rfapiBgpInfoFree(struct bgp_path_info *goner)
 
 	if (goner->extra)
 		bgp_path_info_extra_free(&goner->extra);
-	XFREE(MTYPE_BGP_ROUTE, goner);
+	XSLAB_FREE(MTYPE_BGP_ROUTE, goner);
 }
 
 struct rfapi_import_table *rfapiMacImportTableGetNoAlloc(struct bgp *bgp,
@@ -916,6 +916,79 @@ static void rfapiImportTableFlush(struct rfapi_import_table *it)
 	}
 }
 
+/*
+ * RT index of h->imports, see struct rfapi.  An import table's RT list
+ * doesn't change while it is on h->imports (a changed NVE group list
+ * gets a different table), so it is indexed once when created and
+ * removed when freed.
+ */
+struct rfapi_import_rt {
+	struct ecommunity_val rt;
+	struct list *tables; /* struct rfapi_import_table */
+};
+
+static int rfapi_import_rt_cmp(const void *rt1, const void *rt2)
+{
+	return memcmp(rt1, rt2, ECOMMUNITY_SIZE);
+}
+
+static void rfapi_import_rt_free(void *arg)
+{
+	struct rfapi_import_rt *irt = arg;
+
+	list_delete(&irt->tables);
+	XFREE(MTYPE_RFAPI_IMPORT_RT, irt);
+}
+
+static void rfapiImportTableRtIndexAdd(struct rfapi *h,
+				       struct rfapi_import_table *it)
+{
+	struct rfapi_import_rt *irt;
+	uint8_t *val;
+	uint32_t i;
+
+	if (!it->rt_import_list)
+		return;
+
+	if (!h->import_rt)
+		h->import_rt = skiplist_new(0, rfapi_import_rt_cmp,
+					    rfapi_import_rt_free);
+
+	for (i = 0; i < it->rt_import_list->size; i++) {
+		val = it->rt_import_list->val + i * ECOMMUNITY_SIZE;
+
+		if (skiplist_search(h->import_rt, val, (void **)&irt)) {
+			irt = XCALLOC(MTYPE_RFAPI_IMPORT_RT, sizeof(*irt));
+			memcpy(irt->rt.val, val, ECOMMUNITY_SIZE);
+			irt->tables = list_new();
+			skiplist_insert(h->import_rt, &irt->rt, irt);
+		}
+		if (!listnode_lookup(irt->tables, it))
+			listnode_add(irt->tables, it);
+	}
+}
+
+static void rfapiImportTableRtIndexDel(struct rfapi *h,
+				       struct rfapi_import_table *it)
+{
+	struct rfapi_import_rt *irt;
+	uint8_t *val;
+	uint32_t i;
+
+	if (!it->rt_import_list || !h->import_rt)
+		return;
+
+	for (i = 0; i < it->rt_import_list->size; i++) {
+		val = it->rt_import_list->val + i * ECOMMUNITY_SIZE;
+
+		if (skiplist_search(h->import_rt, val, (void **)&irt))
+			continue;
+		listnode_delete(irt->tables, it);
+		if (!listcount(irt->tables))
+			skiplist_delete(h->import_rt, val, irt);
+	}
+}
+
 void rfapiImportTableRefDelByIt(struct bgp *bgp,
 				struct rfapi_import_table *it_target)
 {
@@ -944,6 +1017,7 @@ void rfapiImportTableRefDelByIt(struct bgp *bgp,
 		} else {
 			h->imports = it->next;
 		}
+		rfapiImportTableRtIndexDel(h, it);
 		rfapiImportTableFlush(it);
 		XFREE(MTYPE_RFAPI_IMPORTTABLE, it);
 	}
@@ -987,7 +1061,7 @@ int rfapiEcommunitiesIntersect(struct ecommunity *e1, struct ecommunity *e2)
 	if (!e1 || !e2)
 		return 0;
 
-	{
+	if (VNC_DEBUG(VERBOSE)) {
 		char *s1, *s2;
 		s1 = ecommunity_ecom2str(e1, ECOMMUNITY_FORMAT_DISPLAY, 0);
 		s2 = ecommunity_ecom2str(e2, ECOMMUNITY_FORMAT_DISPLAY, 0);
@@ -3843,6 +3917,11 @@ void rfapiProcessUpdate(struct peer *peer,
 	struct bgp *bgp;
 	struct rfapi *h;
 	struct rfapi_import_table *it;
+	struct rfapi_import_rt *irt;
+	struct ecommunity *ecom;
+	struct listnode *node;
+	static unsigned int gen;
+	uint32_t i;
 	int has_ip_route = 1;
 	uint32_t lni = 0;
 
@@ -3901,13 +3980,32 @@ void rfapiProcessUpdate(struct peer *peer,
 		return;
 
 	/*
-	 * Iterate over all import tables; do a filtered import
-	 * for the afi/safi combination
+	 * Do a filtered import for the afi/safi combination into each
+	 * import table sharing an RT with the route (the others would
+	 * just reject it for lack of RT intersection.)  Tables importing
+	 * several of the route's RTs are visited once.
 	 */
-	for (it = h->imports; it; it = it->next) {
-		(*rfapiBgpInfoFilteredImportFunction(safi))(
-			it, FIF_ACTION_UPDATE, peer, rfd, p, /* prefix */
-			NULL, afi, prd, attr, type, sub_type, label);
+	ecom = attr ? bgp_attr_get_ecommunity(attr) : NULL;
+	if (ecom && h->import_rt) {
+		gen++;
+		for (i = 0; i < ecom->size; i++) {
+			if (skiplist_search(h->import_rt,
+					    ecom->val + i * ECOMMUNITY_SIZE,
+					    (void **)&irt))
+				continue;
+
+			for (ALL_LIST_ELEMENTS_RO(irt->tables, node, it)) {
+				if (it->import_gen == gen)
+					continue;
+				it->import_gen = gen;
+
+				(*rfapiBgpInfoFilteredImportFunction(safi))(
+					it, FIF_ACTION_UPDATE, peer, rfd,
+					p, /* prefix */
+					NULL, afi, prd, attr, type, sub_type,
+					label);
+			}
+		}
 	}
 
 	if (safi == SAFI_MPLS_VPN) {
@@ -4286,6 +4384,11 @@ void bgp_rfapi_destroy(struct bgp *bgp, struct rfapi *h)
 		h->import_mac = NULL;
 	}
 
+	if (h->import_rt) {
+		skiplist_free(h->import_rt);
+		h->import_rt = NULL;
+	}
+
 	work_queue_free_and_null(&h->deferred_close_q);
 
 	if (h->rfp != NULL)
@@ -4325,6 +4428,7 @@ rfapiImportTableRefAdd(struct bgp *bgp, struct ecommunity *rt_import_list,
 
 		it->rt_import_list = ecommunity_dup(rt_import_list);
 		it->rfg = rfg;
+		rfapiImportTableRtIndexAdd(h, it);
 		it->monitor_exterior_orphans =
 			skiplist_new(0, NULL, prefix_free_lists);
 
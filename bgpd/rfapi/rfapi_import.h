@@ -49,6 +49,7 @@ struct rfapi_import_table {
 	int remote_count[AFI_MAX];
 	int holddown_count[AFI_MAX];
 	int imported_count[AFI_MAX];
+	unsigned int import_gen; /* rfapiProcessUpdate() visited */
 };
 
 #define RFAPI_LOCAL_BI(bpi)                                                    \
@@ -193,6 +193,15 @@ struct rfapi {
 	 */
 	struct skiplist *import_mac; /* L2 */
 
+	/*
+	 * Index of the "imports" tables by route target, so an update
+	 * only visits the tables whose RT list it intersects.
+	 *
+	 * The skiplist keys are 8-byte RT values. Values are pointers
+	 * to struct rfapi_import_rt.
+	 */
+	struct skiplist *import_rt;
+
 	/*
 	 * when exporting plain routes ("registered-nve" mode) to
 	 * bgp unicast or zebra, we need to keep track of information
@@ -380,6 +389,7 @@ DECLARE_MTYPE(RFAPI_RFP_GROUP_CFG);
 DECLARE_MTYPE(RFAPI);
 DECLARE_MTYPE(RFAPI_DESC);
 DECLARE_MTYPE(RFAPI_IMPORTTABLE);
+DECLARE_MTYPE(RFAPI_IMPORT_RT);
 DECLARE_MTYPE(RFAPI_MONITOR);
 DECLARE_MTYPE(RFAPI_MONITOR_ENCAP);
 DECLARE_MTYPE(RFAPI_NEXTHOP);
@@ -65,6 +65,7 @@ struct eigrp_neighbor *eigrp_nbr_new(struct eigrp_interface *ei)
 
 	/* Relate neighbor to the interface. */
 	nbr->ei = ei;
+	eigrp_nbr_rd_init(&nbr->route_descriptors);
 
 	/* Set default values. */
 	eigrp_nbr_state_set(nbr, EIGRP_NEIGHBOR_DOWN);
@@ -174,10 +175,17 @@ struct eigrp_neighbor *eigrp_nbr_lookup_by_addr_process(struct eigrp *eigrp,
 /* Delete specified EIGRP neighbor from interface. */
 void eigrp_nbr_delete(struct eigrp_neighbor *nbr)
 {
+	struct eigrp_route_descriptor *entry;
+
 	eigrp_nbr_state_set(nbr, EIGRP_NEIGHBOR_DOWN);
 	if (nbr->ei)
 		eigrp_topology_neighbor_down(nbr->ei->eigrp, nbr);
 
+	/* entries still around must not point to the list anymore */
+	while ((entry = eigrp_nbr_rd_pop(&nbr->route_descriptors)))
+		entry->nbr_list = NULL;
+	eigrp_nbr_rd_fini(&nbr->route_descriptors);
+
 	/* Cancel all events. */ /* Thread lookup cost would be negligible. */
 	thread_cancel_event(master, nbr);
 	eigrp_fifo_free(nbr->multicast_queue);
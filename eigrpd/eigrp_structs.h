@@ -33,6 +33,7 @@
 #define _ZEBRA_EIGRP_STRUCTS_H_
 
 #include "filter.h"
+#include "typesafe.h"
 
 #include "eigrpd/eigrp_const.h"
 #include "eigrpd/eigrp_macros.h"
@@ -222,6 +223,8 @@ enum Packet_part_type {
 };
 
 /* Neighbor Data Structure */
+PREDECL_DLIST(eigrp_nbr_rd);
+
 struct eigrp_neighbor {
 	/* This neighbor's parent eigrp interface. */
 	struct eigrp_interface *ei;
@@ -270,6 +273,9 @@ struct eigrp_neighbor {
 	struct list *nbr_gr_prefixes_send;
 	/* if packet is first or last during Graceful restart */
 	enum Packet_part_type nbr_gr_packet_type;
+
+	/* route descriptors advertised by this neighbor */
+	struct eigrp_nbr_rd_head route_descriptors;
 };
 
 //---------------------------------------------------------------------------------------------------------------------------------------------
@@ -484,8 +490,14 @@ struct eigrp_route_descriptor {
 	uint8_t flags;			   // used for marking successor and FS
 
 	struct eigrp_interface *ei; // pointer for case of connected entry
+
+	/* in adv_router's route_descriptors, or being walked, or NULL */
+	struct eigrp_nbr_rd_item nbr_item;
+	struct eigrp_nbr_rd_head *nbr_list;
 };
 
+DECLARE_DLIST(eigrp_nbr_rd, struct eigrp_route_descriptor, nbr_item);
+
 //---------------------------------------------------------------------------------------------------------------------------------------------
 typedef enum {
 	EIGRP_CONNECTED,
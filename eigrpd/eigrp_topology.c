@@ -147,6 +147,29 @@ void eigrp_prefix_descriptor_add(struct route_table *topology,
 	rn->info = pe;
 }
 
+/*
+ * Indexing topology entry by the neighbor it was learned from
+ */
+static void
+eigrp_route_descriptor_link_nbr(struct eigrp_route_descriptor *entry)
+{
+	if (entry->nbr_list || !entry->adv_router)
+		return;
+
+	entry->nbr_list = &entry->adv_router->route_descriptors;
+	eigrp_nbr_rd_add_tail(entry->nbr_list, entry);
+}
+
+static void
+eigrp_route_descriptor_unlink_nbr(struct eigrp_route_descriptor *entry)
+{
+	if (!entry->nbr_list)
+		return;
+
+	eigrp_nbr_rd_del(entry->nbr_list, entry);
+	entry->nbr_list = NULL;
+}
+
 /*
  * Adding topology entry to topology node
  */
@@ -161,6 +184,7 @@ void eigrp_route_descriptor_add(struct eigrp *eigrp,
 	if (listnode_lookup(node->entries, entry) == NULL) {
 		listnode_add_sort(node->entries, entry);
 		entry->prefix = node;
+		eigrp_route_descriptor_link_nbr(entry);
 
 		eigrp_zebra_route_add(eigrp, node->destination,
 				      l, node->fdistance);
@@ -215,6 +239,7 @@ void eigrp_route_descriptor_delete(struct eigrp *eigrp,
 {
 	if (listnode_lookup(node->entries, entry) != NULL) {
 		listnode_delete(node->entries, entry);
+		eigrp_route_descriptor_unlink_nbr(entry);
 		eigrp_zebra_route_delete(eigrp, node->destination);
 		XFREE(MTYPE_EIGRP_ROUTE_DESCRIPTOR, entry);
 	}
@@ -324,27 +349,14 @@ eigrp_route_descriptor_lookup(struct list *entries, struct eigrp_neighbor *nbr)
 struct list *eigrp_neighbor_prefixes_lookup(struct eigrp *eigrp,
 					    struct eigrp_neighbor *nbr)
 {
-	struct listnode *node2, *node22;
 	struct eigrp_route_descriptor *entry;
-	struct eigrp_prefix_descriptor *pe;
-	struct route_node *rn;
 
 	/* create new empty list for prefixes storage */
 	struct list *prefixes = list_new();
 
-	/* iterate over all prefixes in topology table */
-	for (rn = route_top(eigrp->topology_table); rn; rn = route_next(rn)) {
-		if (!rn->info)
-			continue;
-		pe = rn->info;
-		/* iterate over all neighbor entry in prefix */
-		for (ALL_LIST_ELEMENTS(pe->entries, node2, node22, entry)) {
-			/* if entry is from specified neighbor, add to list */
-			if (entry->adv_router == nbr) {
-				listnode_add(prefixes, pe);
-			}
-		}
-	}
+	/* a neighbor has at most one entry per prefix */
+	frr_each (eigrp_nbr_rd, &nbr->route_descriptors, entry)
+		listnode_add(prefixes, entry->prefix);
 
 	/* return list of prefixes from specified neighbor */
 	return prefixes;
@@ -413,6 +425,7 @@ distance_done:
 	 */
 	listnode_delete(prefix->entries, entry);
 	listnode_add_sort(prefix->entries, entry);
+	eigrp_route_descriptor_link_nbr(entry);
 
 	return change;
 }
@@ -493,34 +506,36 @@ void eigrp_update_routing_table(struct eigrp *eigrp,
 void eigrp_topology_neighbor_down(struct eigrp *eigrp,
 				  struct eigrp_neighbor *nbr)
 {
-	struct listnode *node2, *node22;
-	struct eigrp_prefix_descriptor *pe;
+	struct eigrp_nbr_rd_head todo;
 	struct eigrp_route_descriptor *entry;
-	struct route_node *rn;
 
-	for (rn = route_top(eigrp->topology_table); rn; rn = route_next(rn)) {
-		pe = rn->info;
-
-		if (!pe)
-			continue;
+	/*
+	 * The FSM events may delete any of the neighbor's entries, so the
+	 * ones still to do are kept on a list of their own.
+	 */
+	eigrp_nbr_rd_init(&todo);
+	while ((entry = eigrp_nbr_rd_pop(&nbr->route_descriptors))) {
+		entry->nbr_list = &todo;
+		eigrp_nbr_rd_add_tail(&todo, entry);
+	}
 
-		for (ALL_LIST_ELEMENTS(pe->entries, node2, node22, entry)) {
-			struct eigrp_fsm_action_message msg;
-
-			if (entry->adv_router != nbr)
-				continue;
-
-			memset(&msg, 0, sizeof(msg));
-			msg.metrics.delay = EIGRP_MAX_METRIC;
-			msg.packet_type = EIGRP_OPC_UPDATE;
-			msg.eigrp = eigrp;
-			msg.data_type = EIGRP_INT;
-			msg.adv_router = nbr;
-			msg.entry = entry;
-			msg.prefix = pe;
-			eigrp_fsm_event(&msg);
-		}
+	while ((entry = eigrp_nbr_rd_pop(&todo))) {
+		struct eigrp_fsm_action_message msg;
+
+		entry->nbr_list = &nbr->route_descriptors;
+		eigrp_nbr_rd_add_tail(entry->nbr_list, entry);
+
+		memset(&msg, 0, sizeof(msg));
+		msg.metrics.delay = EIGRP_MAX_METRIC;
+		msg.packet_type = EIGRP_OPC_UPDATE;
+		msg.eigrp = eigrp;
+		msg.data_type = EIGRP_INT;
+		msg.adv_router = nbr;
+		msg.entry = entry;
+		msg.prefix = entry->prefix;
+		eigrp_fsm_event(&msg);
 	}
+	eigrp_nbr_rd_fini(&todo);
 
 	eigrp_query_send_all(eigrp);
 	eigrp_update_send_all(eigrp, nbr->ei);
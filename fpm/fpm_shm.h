@@ -0,0 +1,127 @@
+/*
+ * Public definitions for the FPM shared memory transport.
+ *
+ * Permission is granted to use, copy, modify and/or distribute this
+ * software under either one of the licenses below.
+ *
+ * Note that if you use other files from the FRR tree directly or
+ * indirectly, then the licenses in those files still apply.
+ *
+ * Please retain both licenses below when modifying this code in the
+ * FRR tree.
+ *
+ * Copyright (C) 2022 FRRouting
+ */
+
+/*
+ * License Option 1: GPL
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * License Option 2: ISC License
+ *
+ * Permission to use, copy, modify, and/or distribute this software
+ * for any purpose with or without fee is hereby granted, provided
+ * that the above copyright notice and this permission notice appear
+ * in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _FPM_SHM_H
+#define _FPM_SHM_H
+
+#include <stdint.h>
+
+/*
+ * Instead of a TCP connection, the netlink FPM plugin (dplane_fpm_nl) can
+ * hand its messages to an FPM running on the same host through a ring in
+ * shared memory.  The messages are exactly the ones that would be sent on
+ * the TCP connection: an FPM header followed by a netlink message.
+ *
+ * Setup:
+ *
+ * The FPM listens on a unix stream socket.  zebra connects to it and
+ * sends a struct fpm_shm_hello, with three file descriptors attached as
+ * SCM_RIGHTS ancillary data:
+ *
+ *   0: the shared memory, hello.map_size bytes, to be mmap()ed read/write.
+ *      It starts with a struct fpm_shm_ring.
+ *   1: an eventfd zebra writes to when it added data while the FPM waits.
+ *   2: an eventfd the FPM writes to when it freed space while zebra waits.
+ *
+ * The unix socket stays open.  When either side closes it the ring is
+ * abandoned; zebra then reconnects with a new ring and sends a complete
+ * snapshot, as it does for TCP.
+ *
+ * Ring:
+ *
+ * 'head' and 'tail' are free-running byte counters, the offset into
+ * 'data' is the counter modulo 'size' (a power of 2).  zebra only writes
+ * 'head', the FPM only writes 'tail'; both are to be read with acquire
+ * and written with release semantics.  Messages may wrap around the end
+ * of 'data', and the FPM may consume any amount of bytes at once.
+ *
+ * Doorbells:
+ *
+ * Before blocking on eventfd 1, the FPM sets 'consumer_wait' to 1 and
+ * then checks 'head' again (both sequentially consistent, so zebra
+ * either sees the flag or the FPM sees the new head).  After moving
+ * 'head', zebra exchanges 'consumer_wait' with 0 and writes the eventfd
+ * if it was set.  'producer_wait' and eventfd 2 work the same way in the
+ * other direction, for when the ring is full.
+ */
+
+#define FPM_SHM_MAGIC 0x46504d52 /* "FPMR" */
+#define FPM_SHM_VERSION 1
+
+#define FPM_SHM_NFDS 3
+
+struct fpm_shm_hello {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t map_size;
+};
+
+struct fpm_shm_ring {
+	uint32_t magic;
+	uint32_t version;
+	/* Size of 'data', a power of 2. */
+	uint64_t size;
+	uint8_t pad0[48];
+
+	/* Written by zebra. */
+	uint64_t head;
+	uint32_t producer_wait;
+	uint8_t pad1[52];
+
+	/* Written by the FPM. */
+	uint64_t tail;
+	uint32_t consumer_wait;
+	uint8_t pad2[52];
+
+	uint8_t data[];
+};
+
+#endif /* _FPM_SHM_H */
@@ -20,6 +20,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
  */
 #include <zebra.h>
+#include "skiplist.h"
 #include "isisd/fabricd.h"
 #include "isisd/isisd.h"
 #include "isisd/isis_circuit.h"
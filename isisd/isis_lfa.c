@@ -26,6 +26,7 @@
 #include "table.h"
 #include "srcdest_table.h"
 #include "plist.h"
+#include "taskpool.h"
 #include "zclient.h"
 
 #include "isis_common.h"
@@ -46,6 +47,7 @@ DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_NODE, "ISIS SPF Node");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_LFA_TIEBREAKER, "ISIS LFA Tiebreaker");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_LFA_EXCL_IFACE, "ISIS LFA Excluded Interface");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_RLFA, "ISIS Remote LFA");
+DEFINE_MTYPE_STATIC(ISISD, ISIS_LFA_JOB, "ISIS LFA computation");
 DEFINE_MTYPE(ISISD, ISIS_NEXTHOP_LABELS, "ISIS nexthop MPLS labels");
 
 static inline int isis_spf_node_compare(const struct isis_spf_node *a,
@@ -579,7 +581,6 @@ static bool lfa_ext_p_space_check(const struct isis_spftree *spftree_pc,
 				  const struct isis_vertex *vertex_dest,
 				  const struct isis_vertex *vertex)
 {
-	struct isis_spftree *spftree_old = spftree_pc->lfa.old.spftree;
 	struct isis_vertex_adj *vadj;
 	struct listnode *node;
 
@@ -595,8 +596,8 @@ static bool lfa_ext_p_space_check(const struct isis_spftree *spftree_pc,
 		struct isis_spf_adj *sadj = vadj->sadj;
 		struct isis_spf_node *adj_node;
 
-		adj_node =
-			isis_spf_node_find(&spftree_old->adj_nodes, sadj->id);
+		adj_node = isis_spf_node_find(&spftree_pc->lfa.adj_p_space,
+					      sadj->id);
 		if (!adj_node)
 			continue;
 
@@ -1096,6 +1097,16 @@ static void lfa_calc_reach_nodes(struct isis_spftree *spftree,
 	}
 }
 
+/* Creates the tree for a reverse SPF on behalf of spftree's root. */
+static struct isis_spftree *
+lfa_reverse_new(const struct isis_spftree *spftree)
+{
+	return isis_spftree_new(spftree->area, spftree->lspdb, spftree->sysid,
+				spftree->level, spftree->tree_id,
+				SPF_TYPE_REVERSE,
+				F_SPFTREE_NO_ADJACENCIES | F_SPFTREE_NO_ROUTES);
+}
+
 /**
  * Helper function used to create an SPF tree structure and run reverse SPF on
  * it.
@@ -1108,10 +1119,7 @@ struct isis_spftree *isis_spf_reverse_run(const struct isis_spftree *spftree)
 {
 	struct isis_spftree *spftree_reverse;
 
-	spftree_reverse = isis_spftree_new(
-		spftree->area, spftree->lspdb, spftree->sysid, spftree->level,
-		spftree->tree_id, SPF_TYPE_REVERSE,
-		F_SPFTREE_NO_ADJACENCIES | F_SPFTREE_NO_ROUTES);
+	spftree_reverse = lfa_reverse_new(spftree);
 	isis_run_spf(spftree_reverse);
 
 	return spftree_reverse;
@@ -1149,7 +1157,7 @@ static void lfa_calc_pq_spaces(struct isis_spftree *spftree_pc,
 			/*
 			 * Compute the reverse SPF in the behalf of the node
 			 * adjacent to the failure, if we haven't done that
-			 * before
+			 * before (isis_spf_run_lfa() does it beforehand)
 			 */
 			if (!adj_node->lfa.spftree_reverse)
 				adj_node->lfa.spftree_reverse =
@@ -1161,16 +1169,84 @@ static void lfa_calc_pq_spaces(struct isis_spftree *spftree_pc,
 					     resource,
 					     &spftree_pc->lfa.q_space);
 		} else {
+			struct isis_spf_node *p_node;
+
 			if (IS_DEBUG_LFA)
 				zlog_debug("ISIS-LFA: computing P-space (%s)",
 					   print_sys_hostname(adj_node->sysid));
+
+			/* w.r.t. this failure, so kept in the tree for it */
+			p_node = isis_spf_node_new(&spftree_pc->lfa.adj_p_space,
+						   adj_node->sysid);
 			lfa_calc_reach_nodes(adj_node->lfa.spftree, spftree,
 					     adj_nodes, true, resource,
-					     &adj_node->lfa.p_space);
+					     &p_node->lfa.p_space);
 		}
 	}
 }
 
+/*
+ * Creates the post-convergence SPF tree for a protected resource.  The
+ * SPT is computed by lfa_pc_spt(), then routes are created from it with
+ * isis_run_spf_routes().
+ */
+static struct isis_spftree *
+lfa_pc_new(struct isis_area *area, struct isis_spftree *spftree,
+	   struct isis_spftree *spftree_reverse, enum spf_type type,
+	   const struct lfa_protected_resource *resource)
+{
+	struct isis_spftree *spftree_pc;
+	struct isis_spf_node *adj_node;
+
+	spftree_pc = isis_spftree_new(area, spftree->lspdb, spftree->sysid,
+				      spftree->level, spftree->tree_id, type,
+				      spftree->flags);
+	spftree_pc->lfa.old.spftree = spftree;
+	spftree_pc->lfa.old.spftree_reverse = spftree_reverse;
+	spftree_pc->lfa.protected_resource = *resource;
+	resource = &spftree_pc->lfa.protected_resource;
+
+	/* Populate list of nodes affected by node failure. */
+	if (type == SPF_TYPE_TI_LFA) {
+		isis_spf_node_list_init(&spftree_pc->lfa.protected_resource.nodes);
+		if (resource->type == LFA_NODE_PROTECTION)
+			RB_FOREACH (adj_node, isis_spf_nodes,
+				    &spftree->adj_nodes) {
+				if (spf_adj_node_is_affected(adj_node, resource,
+							     spftree->sysid))
+					isis_spf_node_new(
+						&spftree_pc->lfa
+							 .protected_resource
+							 .nodes,
+						adj_node->sysid);
+			}
+	}
+
+	return spftree_pc;
+}
+
+/*
+ * Computes the extended P-space and Q-space and the post-convergence SPT.
+ * This only writes to spftree_pc, so it can run on a worker pthread for
+ * several protected resources at once.
+ */
+static void lfa_pc_spt(void *arg)
+{
+	struct isis_spftree *spftree_pc = arg;
+	const struct lfa_protected_resource *resource =
+		&spftree_pc->lfa.protected_resource;
+
+	lfa_calc_pq_spaces(spftree_pc, resource);
+
+	if (IS_DEBUG_LFA)
+		zlog_debug(
+			"ISIS-LFA: computing the post convergence SPT w.r.t. %s",
+			lfa_protected_resource2str(resource));
+
+	/* Re-run SPF in the local node to find the post-convergence paths. */
+	isis_run_spf_spt(spftree_pc);
+}
+
 /**
  * Compute the TI-LFA backup paths for a given protected interface.
  *
@@ -1187,57 +1263,77 @@ struct isis_spftree *isis_tilfa_compute(struct isis_area *area,
 					struct lfa_protected_resource *resource)
 {
 	struct isis_spftree *spftree_pc;
-	struct isis_spf_node *adj_node;
 
 	if (IS_DEBUG_LFA)
 		zlog_debug("ISIS-LFA: computing TI-LFAs for %s",
 			   lfa_protected_resource2str(resource));
 
-	/* Populate list of nodes affected by link failure. */
-	if (resource->type == LFA_NODE_PROTECTION) {
-		isis_spf_node_list_init(&resource->nodes);
-		RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes) {
-			if (spf_adj_node_is_affected(adj_node, resource,
-						     spftree->sysid))
-				isis_spf_node_new(&resource->nodes,
-						  adj_node->sysid);
-		}
-	}
-
 	/* Create post-convergence SPF tree. */
-	spftree_pc = isis_spftree_new(area, spftree->lspdb, spftree->sysid,
-				      spftree->level, spftree->tree_id,
-				      SPF_TYPE_TI_LFA, spftree->flags);
-	spftree_pc->lfa.old.spftree = spftree;
-	spftree_pc->lfa.old.spftree_reverse = spftree_reverse;
-	spftree_pc->lfa.protected_resource = *resource;
+	spftree_pc = lfa_pc_new(area, spftree, spftree_reverse,
+				SPF_TYPE_TI_LFA, resource);
+	lfa_pc_spt(spftree_pc);
+	isis_run_spf_routes(spftree_pc);
 
-	/* Compute the extended P-space and Q-space. */
-	lfa_calc_pq_spaces(spftree_pc, resource);
+	return spftree_pc;
+}
 
-	if (IS_DEBUG_LFA)
-		zlog_debug(
-			"ISIS-LFA: computing the post convergence SPT w.r.t. %s",
-			lfa_protected_resource2str(resource));
+/* pthreads computing SPTs, the main pthread included */
+static unsigned int lfa_threads = 1;
+static struct taskpool *lfa_pool;
 
-	/* Re-run SPF in the local node to find the post-convergence paths. */
-	isis_run_spf(spftree_pc);
+void isis_lfa_threads_set(unsigned int threads)
+{
+	lfa_threads = threads;
+}
 
-	/* Clear list of nodes affeted by link failure. */
-	if (resource->type == LFA_NODE_PROTECTION)
-		isis_spf_node_list_clear(&resource->nodes);
+unsigned int isis_lfa_threads(void)
+{
+	return lfa_threads;
+}
 
-	return spftree_pc;
+void isis_lfa_finish(void)
+{
+	taskpool_free(&lfa_pool);
 }
 
-/**
- * Run forward SPF on all adjacent routers.
- *
- * @param spftree	IS-IS SPF tree
- *
- * @return		0 on success, -1 otherwise
+static void lfa_spt_run(void *arg)
+{
+	isis_run_spf(arg);
+}
+
+/*
+ * Runs fn on all SPF trees in the list, on the worker pool if there is
+ * one.  Debug logs use static buffers, so everything runs on the main
+ * pthread while they are on.
  */
-int isis_spf_run_neighbors(struct isis_spftree *spftree)
+static void lfa_run_parallel(struct list *trees, void (*fn)(void *arg))
+{
+	struct taskpool_group grp;
+	struct listnode *node;
+	void *tree;
+
+	if (lfa_threads > 1 && !lfa_pool)
+		lfa_pool = taskpool_new("isisd_lfa", lfa_threads - 1);
+
+	if (!lfa_pool || listcount(trees) < 2 || IS_DEBUG_LFA
+	    || IS_DEBUG_SPF_EVENTS) {
+		for (ALL_LIST_ELEMENTS_RO(trees, node, tree))
+			fn(tree);
+		return;
+	}
+
+	taskpool_group_init(&grp);
+	for (ALL_LIST_ELEMENTS_RO(trees, node, tree))
+		taskpool_submit(lfa_pool, &grp, fn, tree);
+	taskpool_group_wait(lfa_pool, &grp);
+	taskpool_group_fini(&grp);
+}
+
+/*
+ * Creates the SPF trees of all adjacent routers, adding them to spts to be
+ * run.
+ */
+static int lfa_neighbors_new(struct isis_spftree *spftree, struct list *spts)
 {
 	struct isis_lsp *lsp;
 	struct isis_spf_node *adj_node;
@@ -1256,12 +1352,58 @@ int isis_spf_run_neighbors(struct isis_spftree *spftree)
 			spftree->area, spftree->lspdb, adj_node->sysid,
 			spftree->level, spftree->tree_id, SPF_TYPE_FORWARD,
 			F_SPFTREE_NO_ADJACENCIES | F_SPFTREE_NO_ROUTES);
-		isis_run_spf(adj_node->lfa.spftree);
+		listnode_add(spts, adj_node->lfa.spftree);
 	}
 
 	return 0;
 }
 
+/**
+ * Run forward SPF on all adjacent routers.
+ *
+ * @param spftree	IS-IS SPF tree
+ *
+ * @return		0 on success, -1 otherwise
+ */
+/*
+ * Creates the reverse SPF trees of the adjacent routers affected by the
+ * failure spftree_pc is protecting against, unless they exist already.
+ * lfa_calc_pq_spaces() would create them otherwise, which is not safe to
+ * do from several pthreads at once.
+ */
+static void lfa_neighbors_reverse_new(struct isis_spftree *spftree_pc,
+				      struct list *spts)
+{
+	struct isis_spftree *spftree = spftree_pc->lfa.old.spftree;
+	struct isis_spf_node *adj_node;
+
+	RB_FOREACH (adj_node, isis_spf_nodes, &spftree->adj_nodes) {
+		if (adj_node->lfa.spftree_reverse || !adj_node->lfa.spftree)
+			continue;
+		if (!spf_adj_node_is_affected(adj_node,
+					      &spftree_pc->lfa.protected_resource,
+					      spftree->sysid))
+			continue;
+
+		adj_node->lfa.spftree_reverse =
+			lfa_reverse_new(adj_node->lfa.spftree);
+		listnode_add(spts, adj_node->lfa.spftree_reverse);
+	}
+}
+
+int isis_spf_run_neighbors(struct isis_spftree *spftree)
+{
+	struct list *spts;
+	int ret;
+
+	spts = list_new();
+	ret = lfa_neighbors_new(spftree, spts);
+	lfa_run_parallel(spts, lfa_spt_run);
+	list_delete(&spts);
+
+	return ret;
+}
+
 /* Find Router ID of PQ node. */
 static struct in_addr *rlfa_pq_node_rtr_id(struct isis_spftree *spftree,
 					   const struct isis_vertex *vertex_pq)
@@ -1733,24 +1875,11 @@ struct isis_spftree *isis_rlfa_compute(struct isis_area *area,
 			   lfa_protected_resource2str(resource));
 
 	/* Create post-convergence SPF tree. */
-	spftree_pc = isis_spftree_new(area, spftree->lspdb, spftree->sysid,
-				      spftree->level, spftree->tree_id,
-				      SPF_TYPE_RLFA, spftree->flags);
-	spftree_pc->lfa.old.spftree = spftree;
-	spftree_pc->lfa.old.spftree_reverse = spftree_reverse;
+	spftree_pc = lfa_pc_new(area, spftree, spftree_reverse, SPF_TYPE_RLFA,
+				resource);
 	spftree_pc->lfa.remote.max_metric = max_metric;
-	spftree_pc->lfa.protected_resource = *resource;
-
-	/* Compute the extended P-space and Q-space. */
-	lfa_calc_pq_spaces(spftree_pc, resource);
-
-	if (IS_DEBUG_LFA)
-		zlog_debug(
-			"ISIS-LFA: computing the post convergence SPT w.r.t. %s",
-			lfa_protected_resource2str(resource));
-
-	/* Re-run SPF in the local node to find the post-convergence paths. */
-	isis_run_spf(spftree_pc);
+	lfa_pc_spt(spftree_pc);
+	isis_run_spf_routes(spftree_pc);
 
 	return spftree_pc;
 }
@@ -2245,55 +2374,113 @@ void isis_lfa_compute(struct isis_area *area, struct isis_circuit *circuit,
 	}
 }
 
-static void isis_spf_run_tilfa(struct isis_area *area,
-			       struct isis_circuit *circuit,
-			       struct isis_spftree *spftree,
-			       struct isis_spftree *spftree_reverse,
-			       struct lfa_protected_resource *resource)
+/* Protected resource and its post-convergence trees. */
+struct lfa_job {
+	struct isis_circuit *circuit;
+	struct lfa_protected_resource resource;
+
+	/*
+	 * TI-LFA: node and link protecting trees (either may be NULL).
+	 * LFA: the remote LFA tree in [0] (if enabled).
+	 */
+	struct isis_spftree *spftree_pc[2];
+};
+
+static void lfa_job_free(void *arg)
+{
+	XFREE(MTYPE_ISIS_LFA_JOB, arg);
+}
+
+/*
+ * Creates the post-convergence trees needed to protect the circuit, adding
+ * them to pcs.
+ */
+static void lfa_job_trees_new(struct isis_area *area, struct lfa_job *job,
+			      struct isis_spftree *spftree,
+			      struct isis_spftree *spftree_reverse,
+			      struct list *pcs)
 {
-	struct isis_spftree *spftree_pc_link;
-	struct isis_spftree *spftree_pc_node;
+	struct isis_circuit *circuit = job->circuit;
+	int level = spftree->level;
+	unsigned int i;
 
-	/* Compute node protecting repair paths first (if necessary). */
-	if (circuit->tilfa_node_protection[spftree->level - 1]) {
-		resource->type = LFA_NODE_PROTECTION;
-		spftree_pc_node = isis_tilfa_compute(area, spftree,
-						     spftree_reverse, resource);
-		isis_spftree_del(spftree_pc_node);
+	if (circuit->lfa_protection[level - 1]) {
+		if (circuit->rlfa_protection[level - 1]) {
+			assert(spftree_reverse);
+			job->spftree_pc[0] = lfa_pc_new(area, spftree,
+							spftree_reverse,
+							SPF_TYPE_RLFA,
+							&job->resource);
+			job->spftree_pc[0]->lfa.remote.max_metric =
+				circuit->rlfa_max_metric[level - 1];
+		}
+	} else {
+		assert(spftree_reverse);
+
+		/* Node protecting repair paths go first (if necessary). */
+		if (circuit->tilfa_node_protection[level - 1]) {
+			job->resource.type = LFA_NODE_PROTECTION;
+			job->spftree_pc[0] = lfa_pc_new(area, spftree,
+							spftree_reverse,
+							SPF_TYPE_TI_LFA,
+							&job->resource);
+		}
 
-		/* don't do link protection unless link-fallback is configured
-		 */
-		if (!circuit->tilfa_link_fallback[spftree->level - 1])
-			return;
+		/* Link protection only as fallback with node protection. */
+		if (!circuit->tilfa_node_protection[level - 1]
+		    || circuit->tilfa_link_fallback[level - 1]) {
+			job->resource.type = LFA_LINK_PROTECTION;
+			job->spftree_pc[1] = lfa_pc_new(area, spftree,
+							spftree_reverse,
+							SPF_TYPE_TI_LFA,
+							&job->resource);
+		}
 	}
 
-	/* Compute link protecting repair paths. */
-	resource->type = LFA_LINK_PROTECTION;
-	spftree_pc_link =
-		isis_tilfa_compute(area, spftree, spftree_reverse, resource);
-	isis_spftree_del(spftree_pc_link);
+	for (i = 0; i < array_size(job->spftree_pc); i++)
+		if (job->spftree_pc[i])
+			listnode_add(pcs, job->spftree_pc[i]);
 }
 
 /**
  * Run the LFA/RLFA/TI-LFA algorithms for all protected interfaces.
  *
+ * The SPTs of the adjacent routers and the post-convergence SPTs of all
+ * protected interfaces are independent of each other, so with
+ * "--lfa-threads" they are computed on a worker pool.  Routes are then
+ * created from them on the main pthread, in the same order as before.
+ *
  * @param area		IS-IS area
  * @param spftree	IS-IS SPF tree
  */
 void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree)
 {
 	struct isis_spftree *spftree_reverse = NULL;
+	struct isis_spftree *spftree_pc;
 	struct isis_circuit *circuit;
+	struct lfa_job *job;
 	struct listnode *node;
+	struct list *jobs, *spts, *pcs;
+	struct timeval time_start;
 	int level = spftree->level;
+	unsigned int i;
+
+	monotime(&time_start);
 
-	/* Run reverse SPF locally. */
+	jobs = list_new();
+	jobs->del = lfa_job_free;
+	spts = list_new();
+	pcs = list_new();
+
+	/* Reverse SPF locally. */
 	if (area->rlfa_protected_links[level - 1] > 0
-	    || area->tilfa_protected_links[level - 1] > 0)
-		spftree_reverse = isis_spf_reverse_run(spftree);
+	    || area->tilfa_protected_links[level - 1] > 0) {
+		spftree_reverse = lfa_reverse_new(spftree);
+		listnode_add(spts, spftree_reverse);
+	}
 
-	/* Run forward SPF on all adjacent routers. */
-	isis_spf_run_neighbors(spftree);
+	/* Forward SPF on all adjacent routers. */
+	lfa_neighbors_new(spftree, spts);
 
 	/* Check which interfaces are protected. */
 	for (ALL_LIST_ELEMENTS_RO(area->circuit_list, node, circuit)) {
@@ -2335,32 +2522,57 @@ void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree)
 			continue;
 		}
 
+		job = XCALLOC(MTYPE_ISIS_LFA_JOB, sizeof(*job));
+		job->circuit = circuit;
+		job->resource = resource;
+		listnode_add(jobs, job);
+
+		lfa_job_trees_new(area, job, spftree, spftree_reverse, pcs);
+	}
+
+	/* Reverse SPF on the adjacent routers affected by the failures. */
+	for (ALL_LIST_ELEMENTS_RO(pcs, node, spftree_pc))
+		lfa_neighbors_reverse_new(spftree_pc, spts);
+
+	lfa_run_parallel(spts, lfa_spt_run);
+	lfa_run_parallel(pcs, lfa_pc_spt);
+
+	area->lfa_last_spts[level - 1] = listcount(spts) + listcount(pcs);
+
+	for (ALL_LIST_ELEMENTS_RO(jobs, node, job)) {
+		circuit = job->circuit;
+
 		if (circuit->lfa_protection[level - 1]) {
-			/* Run local LFA. */
-			isis_lfa_compute(area, circuit, spftree, &resource);
-
-			if (circuit->rlfa_protection[level - 1]) {
-				struct isis_spftree *spftree_pc;
-				uint32_t max_metric;
-
-				/* Run remote LFA. */
-				assert(spftree_reverse);
-				max_metric =
-					circuit->rlfa_max_metric[level - 1];
-				spftree_pc = isis_rlfa_compute(
-					area, spftree, spftree_reverse,
-					max_metric, &resource);
+			/* Local LFA. */
+			isis_lfa_compute(area, circuit, spftree,
+					 &job->resource);
+
+			/* Remote LFA. */
+			spftree_pc = job->spftree_pc[0];
+			if (spftree_pc) {
+				isis_run_spf_routes(spftree_pc);
 				listnode_add(spftree->lfa.remote.pc_spftrees,
 					     spftree_pc);
 			}
-		} else if (circuit->tilfa_protection[level - 1]) {
-			/* Run TI-LFA. */
-			assert(spftree_reverse);
-			isis_spf_run_tilfa(area, circuit, spftree,
-					   spftree_reverse, &resource);
+			continue;
+		}
+
+		/* TI-LFA. */
+		for (i = 0; i < array_size(job->spftree_pc); i++) {
+			spftree_pc = job->spftree_pc[i];
+			if (!spftree_pc)
+				continue;
+			isis_run_spf_routes(spftree_pc);
+			isis_spftree_del(spftree_pc);
 		}
 	}
 
+	list_delete(&pcs);
+	list_delete(&spts);
+	list_delete(&jobs);
+
 	if (spftree_reverse)
 		isis_spftree_del(spftree_reverse);
+
+	area->lfa_last_duration[level - 1] = monotime_since(&time_start, NULL);
 }
@@ -26,6 +26,8 @@
 
 DECLARE_MTYPE(ISIS_NEXTHOP_LABELS);
 
+#define ISIS_LFA_THREADS_MAX 64
+
 PREDECL_RBTREE_UNIQ(lfa_tiebreaker_tree);
 PREDECL_RBTREE_UNIQ(rlfa_tree);
 
@@ -176,6 +178,10 @@ void isis_lfa_compute(struct isis_area *area, struct isis_circuit *circuit,
 		      struct isis_spftree *spftree,
 		      struct lfa_protected_resource *resource);
 void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree);
+/* pthreads used by isis_spf_run_lfa(), including the main one */
+void isis_lfa_threads_set(unsigned int threads);
+unsigned int isis_lfa_threads(void);
+void isis_lfa_finish(void);
 int isis_tilfa_check(struct isis_spftree *spftree, struct isis_vertex *vertex);
 struct isis_spftree *
 isis_tilfa_compute(struct isis_area *area, struct isis_spftree *spftree,
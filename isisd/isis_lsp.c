@@ -33,6 +33,7 @@
 #include "prefix.h"
 #include "command.h"
 #include "hash.h"
+#include "jhash.h"
 #include "if.h"
 #include "checksum.h"
 #include "md5.h"
@@ -78,6 +79,11 @@ int lspdb_compare(const struct isis_lsp *a, const struct isis_lsp *b)
 	return memcmp(a->hdr.lsp_id, b->hdr.lsp_id, sizeof(a->hdr.lsp_id));
 }
 
+uint32_t lspdb_hash_key(const struct isis_lsp *lsp)
+{
+	return jhash(lsp->hdr.lsp_id, sizeof(lsp->hdr.lsp_id), 0x6c737064);
+}
+
 void lsp_db_init(struct lspdb_head *head)
 {
 	lspdb_init(head);
@@ -547,6 +553,8 @@ void lsp_update(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr,
 		struct isis_tlvs *tlvs, struct stream *stream,
 		struct isis_area *area, int level, bool confusion)
 {
+	bool topology = true;
+
 	if (lsp->own_lsp) {
 		flog_err(
 			EC_LIB_DEVELOPMENT,
@@ -559,6 +567,12 @@ void lsp_update(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr,
 	if (confusion) {
 		lsp_purge(lsp, level, NULL);
 	} else {
+		/* only reachability changed, the SPT can't have */
+		if (lsp->hdr.seqno && lsp->hdr.rem_lifetime
+		    && hdr->rem_lifetime && lsp->hdr.lsp_bits == hdr->lsp_bits
+		    && isis_tlvs_same_topology(lsp->tlvs, tlvs))
+			topology = false;
+
 		lsp_update_data(lsp, hdr, tlvs, stream, area, level);
 	}
 
@@ -574,7 +588,10 @@ void lsp_update(struct isis_lsp *lsp, struct isis_lsp_hdr *hdr,
 	}
 
 	if (lsp->hdr.seqno) {
-		isis_spf_schedule(lsp->area, lsp->level);
+		if (topology)
+			isis_spf_schedule(lsp->area, lsp->level);
+		else
+			isis_spf_schedule_prefixes(lsp->area, lsp->level);
 		isis_te_lsp_event(lsp, LSP_UPD);
 	}
 }
@@ -1418,15 +1435,58 @@ int lsp_generate(struct isis_area *area, int level)
 }
 
 /*
- * Search own LSPs, update holding time and flood
+ * Whether the freshly built lsp packs to what was sent last (old), under
+ * the same sequence number.  The lifetime isn't compared, it's what
+ * refreshes are for.
  */
-static int lsp_regenerate(struct isis_area *area, int level)
+static bool lsp_unchanged(struct isis_lsp *lsp, struct stream *old)
+{
+	lsp_pack_pdu(lsp);
+
+	if (stream_get_endp(lsp->pdu) != stream_get_endp(old))
+		return false;
+
+	return !memcmp(STREAM_DATA(lsp->pdu) + 12, STREAM_DATA(old) + 12,
+		       stream_get_endp(old) - 12);
+}
+
+/*
+ * Gives a rebuilt fragment the new lifetime and floods it, unless this is
+ * a triggered regeneration (old is what was sent last), the fragment
+ * didn't change and it lives until the next refresh anyway.
+ */
+static void lsp_regenerate_frag(struct isis_lsp *lsp, struct stream *old,
+				uint16_t rem_lifetime, uint16_t refresh_time)
+{
+	if (old && lsp->hdr.rem_lifetime > refresh_time + 300
+	    && lsp_unchanged(lsp, old)) {
+		lsp->area->lsp_unchanged_count[lsp->level - 1]++;
+		return;
+	}
+
+	/* Set the lifetime values of all the fragments to the same value,
+	 * so that no fragment expires before the lsp is refreshed.
+	 */
+	lsp->hdr.rem_lifetime = rem_lifetime;
+	lsp->age_out = ZERO_AGE_LIFETIME;
+	lsp_inc_seqno(lsp, 0);
+	lsp_flood(lsp, NULL);
+}
+
+/*
+ * Search own LSPs, update holding time and flood.  For a triggered
+ * regeneration (refresh false), only the fragments whose content changed
+ * get a new sequence number and are flooded.
+ */
+static int lsp_regenerate(struct isis_area *area, int level, bool refresh)
 {
 	struct lspdb_head *head;
 	struct isis_lsp *lsp, *frag;
 	struct listnode *node;
+	struct stream *old[256] = {};
 	uint8_t lspid[ISIS_SYS_ID_LEN + 2];
 	uint16_t rem_lifetime, refresh_time;
+	unsigned int i;
 
 	if ((area == NULL) || (area->is_type & level) != level)
 		return ISIS_ERROR;
@@ -1444,35 +1504,45 @@ static int lsp_regenerate(struct isis_area *area, int level)
 		return ISIS_ERROR;
 	}
 
+	/* what the fragments looked like, lsp_build() repacks them */
+	if (!refresh) {
+		if (lsp->tlvs)
+			old[0] = stream_dup(lsp->pdu);
+		for (ALL_LIST_ELEMENTS_RO(lsp->lspu.frags, node, frag))
+			if (frag->tlvs && frag->hdr.rem_lifetime)
+				old[LSP_FRAGMENT(frag->hdr.lsp_id)] =
+					stream_dup(frag->pdu);
+	}
+
 	lsp_clear_data(lsp);
 	lsp_build(lsp, area);
 	rem_lifetime = lsp_rem_lifetime(area, level);
-	lsp->hdr.rem_lifetime = rem_lifetime;
+	refresh_time = lsp_refresh_time(lsp, rem_lifetime);
 	lsp->last_generated = time(NULL);
-	lsp_flood(lsp, NULL);
 	area->lsp_gen_count[level - 1]++;
+
+	lsp_regenerate_frag(lsp, old[0], rem_lifetime, refresh_time);
 	for (ALL_LIST_ELEMENTS_RO(lsp->lspu.frags, node, frag)) {
 		if (!frag->tlvs) {
-			/* Updating and flooding should only affect fragments
-			 * carrying data
+			/* Purge should only be applied when the fragment has
+			 * non-zero remaining lifetime.
 			 */
+			if (frag->hdr.rem_lifetime)
+				lsp_purge(frag, level, NULL);
 			continue;
 		}
 
 		frag->hdr.lsp_bits =
 			lsp_bits_generate(level, area->overload_bit,
 					  area->attached_bit_send, area);
-		/* Set the lifetime values of all the fragments to the same
-		 * value,
-		 * so that no fragment expires before the lsp is refreshed.
-		 */
-		frag->hdr.rem_lifetime = rem_lifetime;
-		frag->age_out = ZERO_AGE_LIFETIME;
-		lsp_flood(frag, NULL);
+		lsp_regenerate_frag(frag, old[LSP_FRAGMENT(frag->hdr.lsp_id)],
+				    rem_lifetime, refresh_time);
 	}
-	lsp_seqno_update(lsp);
 
-	refresh_time = lsp_refresh_time(lsp, rem_lifetime);
+	for (i = 0; i < array_size(old); i++)
+		if (old[i])
+			stream_free(old[i]);
+
 	thread_add_timer(master, lsp_refresh,
 			 &area->lsp_refresh_arg[level - 1], refresh_time,
 			 &area->t_lsp_refresh[level - 1]);
@@ -1506,6 +1576,8 @@ static void lsp_refresh(struct thread *thread)
 	assert(area);
 
 	int level = arg->level;
+	/* pending means a change triggered it, not the refresh interval */
+	bool refresh = !area->lsp_regenerate_pending[level - 1];
 
 	area->t_lsp_refresh[level - 1] = NULL;
 	area->lsp_regenerate_pending[level - 1] = 0;
@@ -1530,7 +1602,7 @@ static void lsp_refresh(struct thread *thread)
 	sched_debug(
 		"ISIS (%s): LSP L%d refresh timer expired. Refreshing LSP...",
 		area->area_tag, level);
-	lsp_regenerate(area, level);
+	lsp_regenerate(area, level, refresh);
 }
 
 int _lsp_regenerate_schedule(struct isis_area *area, int level,
@@ -27,7 +27,18 @@
 #include "lib/typesafe.h"
 #include "isisd/isis_pdu.h"
 
-PREDECL_RBTREE_UNIQ(lspdb);
+/*
+ * The LSPDB is a tree sorted by LSP ID, for CSNP ranges and ordered walks,
+ * plus a hash for exact LSP ID lookups.  The lspdb_* functions below keep
+ * both in sync and are what the rest of isisd uses.
+ */
+PREDECL_RBTREE_UNIQ(lspdb_tree);
+PREDECL_HASH(lspdb_hash);
+
+struct lspdb_head {
+	struct lspdb_tree_head tree;
+	struct lspdb_hash_head hash;
+};
 
 struct isis;
 /* Structure for isis_lsp, this structure will only support the fixed
@@ -35,7 +46,8 @@ struct isis;
  * We will have to split the header into two parts, and for readability
  * sake it should better be avoided */
 struct isis_lsp {
-	struct lspdb_item dbe;
+	struct lspdb_tree_item dbe;
+	struct lspdb_hash_item dbh;
 
 	struct isis_lsp_hdr hdr;
 	struct stream *pdu; /* full pdu lsp */
@@ -61,7 +73,81 @@ struct isis_lsp {
 };
 
 extern int lspdb_compare(const struct isis_lsp *a, const struct isis_lsp *b);
-DECLARE_RBTREE_UNIQ(lspdb, struct isis_lsp, dbe, lspdb_compare);
+extern uint32_t lspdb_hash_key(const struct isis_lsp *lsp);
+DECLARE_RBTREE_UNIQ(lspdb_tree, struct isis_lsp, dbe, lspdb_compare);
+DECLARE_HASH(lspdb_hash, struct isis_lsp, dbh, lspdb_compare, lspdb_hash_key);
+
+static inline void lspdb_init(struct lspdb_head *head)
+{
+	lspdb_tree_init(&head->tree);
+	lspdb_hash_init(&head->hash);
+}
+
+static inline void lspdb_fini(struct lspdb_head *head)
+{
+	lspdb_hash_fini(&head->hash);
+	lspdb_tree_fini(&head->tree);
+}
+
+static inline struct isis_lsp *lspdb_add(struct lspdb_head *head,
+					 struct isis_lsp *lsp)
+{
+	struct isis_lsp *prev = lspdb_tree_add(&head->tree, lsp);
+
+	if (!prev)
+		lspdb_hash_add(&head->hash, lsp);
+	return prev;
+}
+
+static inline struct isis_lsp *lspdb_del(struct lspdb_head *head,
+					 struct isis_lsp *lsp)
+{
+	lspdb_hash_del(&head->hash, lsp);
+	return lspdb_tree_del(&head->tree, lsp);
+}
+
+static inline struct isis_lsp *lspdb_pop(struct lspdb_head *head)
+{
+	struct isis_lsp *lsp = lspdb_tree_pop(&head->tree);
+
+	if (lsp)
+		lspdb_hash_del(&head->hash, lsp);
+	return lsp;
+}
+
+static inline struct isis_lsp *lspdb_find(struct lspdb_head *head,
+					  const struct isis_lsp *lsp)
+{
+	return lspdb_hash_find(&head->hash, lsp);
+}
+
+static inline struct isis_lsp *lspdb_find_gteq(struct lspdb_head *head,
+					       const struct isis_lsp *lsp)
+{
+	return lspdb_tree_find_gteq(&head->tree, lsp);
+}
+
+static inline struct isis_lsp *lspdb_first(struct lspdb_head *head)
+{
+	return lspdb_tree_first(&head->tree);
+}
+
+static inline struct isis_lsp *lspdb_next(struct lspdb_head *head,
+					  struct isis_lsp *lsp)
+{
+	return lspdb_tree_next(&head->tree, lsp);
+}
+
+static inline struct isis_lsp *lspdb_next_safe(struct lspdb_head *head,
+					       struct isis_lsp *lsp)
+{
+	return lspdb_tree_next_safe(&head->tree, lsp);
+}
+
+static inline size_t lspdb_count(const struct lspdb_head *head)
+{
+	return lspdb_tree_count(&head->tree);
+}
 
 void lsp_db_init(struct lspdb_head *head);
 void lsp_db_fini(struct lspdb_head *head);
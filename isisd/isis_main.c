@@ -83,9 +83,12 @@ struct zebra_privs_t isisd_privs = {
 	.cap_num_p = array_size(_caps_p),
 	.cap_num_i = 0};
 
+#define OPTION_LFA_THREADS 2001
+
 /* isisd options */
 static const struct option longopts[] = {
 	{"int_num", required_argument, NULL, 'I'},
+	{"lfa-threads", required_argument, NULL, OPTION_LFA_THREADS},
 	{0}};
 
 /* Master of threads. */
@@ -103,6 +106,7 @@ void sigusr1(void);
 static __attribute__((__noreturn__)) void terminate(int i)
 {
 	isis_terminate();
+	isis_lfa_finish();
 	isis_sr_term();
 	isis_zebra_stop();
 	exit(i);
@@ -211,7 +215,8 @@ int main(int argc, char **argv, char **envp)
 #endif
 	frr_opt_add(
 		"I:", longopts,
-		"  -I, --int_num      Set instance number (label-manager)\n");
+		"  -I, --int_num      Set instance number (label-manager)\n"
+		"      --lfa-threads  Number of pthreads computing LFA/TI-LFA SPTs\n");
 
 	/* Command line argument treatment. */
 	while (1) {
@@ -229,6 +234,18 @@ int main(int argc, char **argv, char **envp)
 				zlog_err("Instance %i out of range (1..%u)",
 					 instance, (unsigned short)-1);
 			break;
+		case OPTION_LFA_THREADS: {
+			unsigned long threads = strtoul(optarg, NULL, 10);
+
+			if (threads == 0 || threads > ISIS_LFA_THREADS_MAX) {
+				fprintf(stderr,
+					"lfa-threads must be between 1 and %u\n",
+					ISIS_LFA_THREADS_MAX);
+				return 1;
+			}
+			isis_lfa_threads_set(threads);
+			break;
+		}
 		default:
 			frr_help_exit(1);
 		}
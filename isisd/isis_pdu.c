@@ -2333,6 +2333,9 @@ static int send_psnp(int level, struct isis_circuit *circuit)
 
 	uint16_t num_lsps =
 		get_max_lsp_count(STREAM_WRITEABLE(circuit->snd_stream));
+	struct lspdb_head *head = &circuit->area->lspdb[level - 1];
+	/* each PSNP picks up where the previous one stopped */
+	struct isis_lsp *next = lspdb_first(head);
 
 	while (1) {
 		struct isis_lsp *lsp;
@@ -2341,13 +2344,14 @@ static int send_psnp(int level, struct isis_circuit *circuit)
 		if (CHECK_FLAG(passwd->snp_auth, SNP_AUTH_SEND))
 			isis_tlvs_add_auth(tlvs, passwd);
 
-		frr_each (lspdb, &circuit->area->lspdb[level - 1], lsp) {
+		for (lsp = next; lsp; lsp = lspdb_next(head, lsp)) {
 			if (ISIS_CHECK_FLAG(lsp->SSNflags, circuit))
 				isis_tlvs_add_lsp_entry(tlvs, lsp);
 
 			if (tlvs->lsp_entries.count == num_lsps)
 				break;
 		}
+		next = lsp ? lspdb_next(head, lsp) : NULL;
 
 		if (!tlvs->lsp_entries.count) {
 			isis_free_tlvs(tlvs);
@@ -515,6 +515,7 @@ static void _isis_route_verify_table(struct isis_area *area,
 	char buff[SRCDEST2STR_BUFFER];
 #endif /* EXTREME_DEBUG */
 
+	isis_zebra_batch_begin();
 	for (rnode = route_top(table); rnode;
 	     rnode = srcdest_route_next(rnode)) {
 		if (rnode->info == NULL)
@@ -600,6 +601,7 @@ static void _isis_route_verify_table(struct isis_area *area,
 
 		isis_route_delete(area, rnode, table);
 	}
+	isis_zebra_batch_commit();
 }
 
 void isis_route_verify_table(struct isis_area *area, struct route_table *table,
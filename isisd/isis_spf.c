@@ -377,6 +377,7 @@ struct isis_spftree *isis_spftree_new(struct isis_area *area,
 	if (tree->type == SPF_TYPE_RLFA || tree->type == SPF_TYPE_TI_LFA) {
 		isis_spf_node_list_init(&tree->lfa.p_space);
 		isis_spf_node_list_init(&tree->lfa.q_space);
+		isis_spf_node_list_init(&tree->lfa.adj_p_space);
 	}
 
 	return tree;
@@ -393,7 +394,10 @@ void isis_spftree_del(struct isis_spftree *spftree)
 	    || spftree->type == SPF_TYPE_TI_LFA) {
 		isis_spf_node_list_clear(&spftree->lfa.q_space);
 		isis_spf_node_list_clear(&spftree->lfa.p_space);
+		isis_spf_node_list_clear(&spftree->lfa.adj_p_space);
 	}
+	if (spftree->type == SPF_TYPE_TI_LFA)
+		isis_spf_node_list_clear(&spftree->lfa.protected_resource.nodes);
 	isis_spf_node_list_clear(&spftree->adj_nodes);
 	list_delete(&spftree->sadj_list);
 	isis_vertex_queue_free(&spftree->tents);
@@ -804,7 +808,7 @@ static void process_N(struct isis_spftree *spftree, enum vertextype vtype,
 static int isis_spf_process_lsp(struct isis_spftree *spftree,
 				struct isis_lsp *lsp, uint32_t cost,
 				uint16_t depth, uint8_t *root_sysid,
-				struct isis_vertex *parent)
+				struct isis_vertex *parent, bool prefixes_only)
 {
 	bool pseudo_lsp = LSP_PSEUDO_ID(lsp->hdr.lsp_id);
 	struct listnode *fragnode = NULL;
@@ -854,7 +858,7 @@ lspfragloop:
 			   print_sys_hostname(lsp->hdr.lsp_id));
 #endif /* EXTREME_DEBUG */
 
-	if (no_overload) {
+	if (no_overload && !prefixes_only) {
 		if ((pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST)
 		    && spftree->area->oldmetric) {
 			struct isis_oldstyle_reach *r;
@@ -1196,22 +1200,31 @@ static int isis_spf_preload_tent_ip_reach_cb(const struct prefix *prefix,
 	return LSP_ITER_CONTINUE;
 }
 
+static void isis_spf_preload_tent_ip_reach(struct isis_spftree *spftree,
+					   struct isis_lsp *root_lsp,
+					   struct isis_vertex *parent)
+{
+	struct spf_preload_tent_ip_reach_args ip_reach_args;
+
+	if (CHECK_FLAG(spftree->flags, F_SPFTREE_HOPCOUNT_METRIC))
+		return;
+
+	ip_reach_args.spftree = spftree;
+	ip_reach_args.parent = parent;
+	isis_lsp_iterate_ip_reach(root_lsp, spftree->family, spftree->mtid,
+				  isis_spf_preload_tent_ip_reach_cb,
+				  &ip_reach_args);
+}
+
 static void isis_spf_preload_tent(struct isis_spftree *spftree,
 				  uint8_t *root_sysid,
 				  struct isis_lsp *root_lsp,
 				  struct isis_vertex *parent)
 {
-	struct spf_preload_tent_ip_reach_args ip_reach_args;
 	struct isis_spf_adj *sadj;
 	struct listnode *node;
 
-	if (!CHECK_FLAG(spftree->flags, F_SPFTREE_HOPCOUNT_METRIC)) {
-		ip_reach_args.spftree = spftree;
-		ip_reach_args.parent = parent;
-		isis_lsp_iterate_ip_reach(
-			root_lsp, spftree->family, spftree->mtid,
-			isis_spf_preload_tent_ip_reach_cb, &ip_reach_args);
-	}
+	isis_spf_preload_tent_ip_reach(spftree, root_lsp, parent);
 
 	/* Iterate over adjacencies. */
 	for (ALL_LIST_ELEMENTS_RO(spftree->sadj_list, node, sadj)) {
@@ -1244,7 +1257,7 @@ static void isis_spf_preload_tent(struct isis_spftree *spftree,
 					   parent);
 		} else if (sadj->lsp) {
 			isis_spf_process_lsp(spftree, sadj->lsp, metric, 0,
-					     spftree->sysid, parent);
+					     spftree->sysid, parent, false);
 		}
 	}
 }
@@ -1657,7 +1670,6 @@ static void isis_spf_loop(struct isis_spftree *spftree,
 {
 	struct isis_vertex *vertex;
 	struct isis_lsp *lsp;
-	struct listnode *node;
 
 	while (isis_vertex_queue_count(&spftree->tents)) {
 		vertex = isis_vertex_queue_pop(&spftree->tents);
@@ -1684,10 +1696,16 @@ static void isis_spf_loop(struct isis_spftree *spftree,
 		}
 
 		isis_spf_process_lsp(spftree, lsp, vertex->d_N, vertex->depth,
-				     root_sysid, vertex);
+				     root_sysid, vertex, false);
 	}
+}
+
+/* Generate routes once the SPT is formed. */
+static void isis_spf_process_paths(struct isis_spftree *spftree)
+{
+	struct isis_vertex *vertex;
+	struct listnode *node;
 
-	/* Generate routes once the SPT is formed. */
 	for (ALL_QUEUE_ELEMENTS_RO(&spftree->paths, node, vertex)) {
 		/* New-style TLVs take precedence over the old-style TLVs. */
 		switch (vertex->type) {
@@ -1738,16 +1756,16 @@ struct isis_spftree *isis_run_hopcount_spf(struct isis_area *area,
 	}
 
 	isis_spf_loop(spftree, sysid);
+	isis_spf_process_paths(spftree);
 
 	return spftree;
 }
 
-void isis_run_spf(struct isis_spftree *spftree)
+bool isis_run_spf_spt(struct isis_spftree *spftree)
 {
 	struct isis_lsp *root_lsp;
 	struct isis_vertex *root_vertex;
 	struct timeval time_start;
-	struct timeval time_end;
 	struct isis_mt_router_info *mt_router_info;
 	uint16_t mtid = 0;
 
@@ -1758,7 +1776,7 @@ void isis_run_spf(struct isis_spftree *spftree)
 	if (root_lsp == NULL) {
 		zlog_err("ISIS-SPF: could not find own l%d LSP!",
 			 spftree->level);
-		return;
+		return false;
 	}
 
 	/* Get Multi-Topology ID. */
@@ -1804,8 +1822,90 @@ void isis_run_spf(struct isis_spftree *spftree)
 	}
 
 	isis_spf_loop(spftree, spftree->sysid);
+	spftree->last_run_duration = monotime_since(&time_start, NULL);
+
+	return true;
+}
+
+void isis_run_spf_routes(struct isis_spftree *spftree)
+{
+	struct timeval time_start;
+
+	monotime(&time_start);
+
+	isis_spf_process_paths(spftree);
+
 	spftree->runcount++;
 	spftree->last_run_timestamp = time(NULL);
+	spftree->last_run_monotime = monotime(NULL);
+	spftree->last_run_duration += monotime_since(&time_start, NULL);
+}
+
+void isis_run_spf(struct isis_spftree *spftree)
+{
+	if (isis_run_spf_spt(spftree))
+		isis_run_spf_routes(spftree);
+}
+
+/*
+ * Partial route calculation, for when only the reachability TLVs of LSPs
+ * changed: the IS vertices of the last run are still the SPT, only the
+ * prefixes are attached to them again.
+ */
+static void isis_run_prc(struct isis_spftree *spftree)
+{
+	struct isis_lsp *root_lsp, *lsp;
+	struct isis_vertex *root_vertex, *vertex;
+	struct listnode *node, *nnode;
+	struct timeval time_start;
+	struct timeval time_end;
+
+	monotime(&time_start);
+
+	root_lsp = isis_root_system_lsp(spftree->lspdb, spftree->sysid);
+	if (root_lsp == NULL) {
+		zlog_err("ISIS-SPF: could not find own l%d LSP!",
+			 spftree->level);
+		return;
+	}
+
+	/* Drop the prefixes of the last run. */
+	hash_clean(spftree->prefix_sids, NULL);
+	for (ALL_LIST_ELEMENTS(spftree->paths.l.list, node, nnode, vertex)) {
+		if (VTYPE_IS(vertex->type))
+			continue;
+
+		hash_release(spftree->paths.hash, vertex);
+		list_delete_node(spftree->paths.l.list, node);
+		isis_vertex_del(vertex);
+	}
+	memset(&spftree->lfa.protection_counters, 0,
+	       sizeof(spftree->lfa.protection_counters));
+
+	/* The root comes first, then the IS vertices by distance. */
+	root_vertex = listnode_head(spftree->paths.l.list);
+	isis_spf_preload_tent_ip_reach(spftree, root_lsp, root_vertex);
+
+	for (ALL_QUEUE_ELEMENTS_RO(&spftree->paths, node, vertex)) {
+		if (vertex == root_vertex)
+			continue;
+
+		lsp = lsp_for_vertex(spftree, vertex);
+		if (!lsp)
+			continue;
+
+		isis_spf_process_lsp(spftree, lsp, vertex->d_N, vertex->depth,
+				     spftree->sysid, vertex, true);
+	}
+
+	/* Only prefixes are left in TENT. */
+	while ((vertex = isis_vertex_queue_pop(&spftree->tents)))
+		add_to_paths(spftree, vertex);
+
+	isis_spf_process_paths(spftree);
+
+	spftree->prc_runcount++;
+	spftree->last_run_timestamp = time(NULL);
 	spftree->last_run_monotime = monotime(&time_end);
 	spftree->last_run_duration =
 		((time_end.tv_sec - time_start.tv_sec) * 1000000)
@@ -1813,10 +1913,18 @@ void isis_run_spf(struct isis_spftree *spftree)
 }
 
 static void isis_run_spf_with_protection(struct isis_area *area,
-					 struct isis_spftree *spftree)
+					 struct isis_spftree *spftree,
+					 bool prc)
 {
-	/* Run forward SPF locally. */
 	memcpy(spftree->sysid, area->isis->sysid, ISIS_SYS_ID_LEN);
+
+	/* Without a tree from a full run, there's nothing to reuse. */
+	if (prc && spftree->runcount) {
+		isis_run_prc(spftree);
+		return;
+	}
+
+	/* Run forward SPF locally. */
 	isis_run_spf(spftree);
 
 	/* Run LFA protection if configured. */
@@ -1857,6 +1965,7 @@ static void isis_run_spf_cb(struct thread *thread)
 	struct isis_area *area = run->area;
 	int level = run->level;
 	int have_run = 0;
+	bool prc;
 
 	XFREE(MTYPE_ISIS_SPF_RUN, run);
 
@@ -1867,26 +1976,37 @@ static void isis_run_spf_cb(struct thread *thread)
 		return;
 	}
 
+	/*
+	 * The protection SPTs are based on the forward one being computed
+	 * from scratch, and fabricd uses its own.
+	 */
+	prc = !area->spf_topology_change[level - 1] && !fabricd
+	      && !area->lfa_protected_links[level - 1]
+	      && !area->rlfa_protected_links[level - 1]
+	      && !area->tilfa_protected_links[level - 1];
+	area->spf_topology_change[level - 1] = false;
+
 	isis_area_delete_backup_adj_sids(area, level);
 	isis_area_invalidate_routes(area, level);
 
 	if (IS_DEBUG_SPF_EVENTS)
-		zlog_debug("ISIS-SPF (%s) L%d SPF needed, periodic SPF",
-			   area->area_tag, level);
+		zlog_debug("ISIS-SPF (%s) L%d SPF needed, %s", area->area_tag,
+			   level,
+			   prc ? "partial route calculation" : "periodic SPF");
 
 	if (area->ip_circuits) {
 		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_IPV4][level - 1]);
+			area, area->spftree[SPFTREE_IPV4][level - 1], prc);
 		have_run = 1;
 	}
 	if (area->ipv6_circuits) {
 		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_IPV6][level - 1]);
+			area, area->spftree[SPFTREE_IPV6][level - 1], prc);
 		have_run = 1;
 	}
 	if (area->ipv6_circuits && isis_area_ipv6_dstsrc_enabled(area)) {
 		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_DSTSRC][level - 1]);
+			area, area->spftree[SPFTREE_DSTSRC][level - 1], prc);
 		have_run = 1;
 	}
 
@@ -1919,13 +2039,16 @@ void isis_spf_timer_free(void *run)
 	XFREE(MTYPE_ISIS_SPF_RUN, run);
 }
 
-int _isis_spf_schedule(struct isis_area *area, int level,
+int _isis_spf_schedule(struct isis_area *area, int level, bool topology,
 		       const char *func, const char *file, int line)
 {
 	struct isis_spftree *spftree = area->spftree[SPFTREE_IPV4][level - 1];
 	time_t now = monotime(NULL);
 	int diff = now - spftree->last_run_monotime;
 
+	if (topology)
+		area->spf_topology_change[level - 1] = true;
+
 	if (CHECK_FLAG(im->options, F_ISIS_UNIT_TEST))
 		return 0;
 
@@ -2701,6 +2824,7 @@ void isis_spf_print(struct isis_spftree *spftree, struct vty *vty)
 		(uint32_t)spftree->last_run_duration);
 
 	vty_out(vty, "      run count         : %u\n", spftree->runcount);
+	vty_out(vty, "      partial run count : %u\n", spftree->prc_runcount);
 }
 void isis_spf_print_json(struct isis_spftree *spftree, struct json_object *json)
 {
@@ -2713,4 +2837,6 @@ void isis_spf_print_json(struct isis_spftree *spftree, struct json_object *json)
 	json_object_int_add(json, "last-run-duration-usec",
 			    spftree->last_run_duration);
 	json_object_int_add(json, "last-run-count", spftree->runcount);
+	json_object_int_add(json, "last-run-count-partial",
+			    spftree->prc_runcount);
 }
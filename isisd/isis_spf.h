@@ -66,9 +66,13 @@ void spftree_area_del(struct isis_area *area);
 struct isis_lsp *isis_root_system_lsp(struct lspdb_head *lspdb,
 				      const uint8_t *sysid);
 #define isis_spf_schedule(area, level) \
-	_isis_spf_schedule((area), (level), __func__, \
+	_isis_spf_schedule((area), (level), true, __func__, \
 			   __FILE__, __LINE__)
-int _isis_spf_schedule(struct isis_area *area, int level,
+/* Only prefixes changed, the SPT is the same; see isis_run_prc(). */
+#define isis_spf_schedule_prefixes(area, level) \
+	_isis_spf_schedule((area), (level), false, __func__, \
+			   __FILE__, __LINE__)
+int _isis_spf_schedule(struct isis_area *area, int level, bool topology,
 		       const char *func, const char *file, int line);
 void isis_print_spftree(struct vty *vty, struct isis_spftree *spftree);
 void isis_print_routes(struct vty *vty, struct isis_spftree *spftree,
@@ -78,6 +82,15 @@ void isis_spf_print(struct isis_spftree *spftree, struct vty *vty);
 void isis_spf_print_json(struct isis_spftree *spftree,
 			 struct json_object *json);
 void isis_run_spf(struct isis_spftree *spftree);
+/*
+ * isis_run_spf() in two steps: building the SPT only reads the LSDB and
+ * whatever the tree refers to (pre-failure SPTs for the LFA ones), so it
+ * may run on a worker pthread.  Creating routes and backup Adj-SIDs from
+ * it has to be done on the main pthread.  Returns false if there is no
+ * SPT, and the routes step isn't to be run then.
+ */
+bool isis_run_spf_spt(struct isis_spftree *spftree);
+void isis_run_spf_routes(struct isis_spftree *spftree);
 struct isis_spftree *isis_run_hopcount_spf(struct isis_area *area,
 					   uint8_t *sysid,
 					   struct isis_spftree *spftree);
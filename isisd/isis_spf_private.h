@@ -25,7 +25,7 @@
 
 #include "hash.h"
 #include "jhash.h"
-#include "skiplist.h"
+#include "typesafe.h"
 #include "lib_errors.h"
 
 enum vertextype {
@@ -57,10 +57,13 @@ struct isis_vertex_adj {
 	uint32_t lfa_metric;
 };
 
+PREDECL_HEAP(isis_vertex_tents);
+
 /*
  * Triple <N, d(N), {Adj(N)}>
  */
 struct isis_vertex {
+	struct isis_vertex_tents_item tent_item;
 	enum vertextype type;
 	union {
 		uint8_t id[ISIS_SYS_ID_LEN + 1];
@@ -84,7 +87,7 @@ struct isis_vertex {
 
 struct isis_vertex_queue {
 	union {
-		struct skiplist *slist;
+		struct isis_vertex_tents_head heap;
 		struct list *list;
 	} l;
 	struct hash *hash;
@@ -158,11 +161,8 @@ __attribute__((__unused__)) static int isis_vertex_queue_tent_cmp(const void *a,
 	return 0;
 }
 
-__attribute__((__unused__))
-static struct skiplist *isis_vertex_queue_skiplist(void)
-{
-	return skiplist_new(0, isis_vertex_queue_tent_cmp, NULL);
-}
+DECLARE_HEAP(isis_vertex_tents, struct isis_vertex, tent_item,
+	     isis_vertex_queue_tent_cmp);
 
 __attribute__((__unused__))
 static void isis_vertex_queue_init(struct isis_vertex_queue *queue,
@@ -170,7 +170,7 @@ static void isis_vertex_queue_init(struct isis_vertex_queue *queue,
 {
 	if (ordered) {
 		queue->insert_counter = 1;
-		queue->l.slist = isis_vertex_queue_skiplist();
+		isis_vertex_tents_init(&queue->l.heap);
 	} else {
 		queue->insert_counter = 0;
 		queue->l.list = list_new();
@@ -197,11 +197,8 @@ static void isis_vertex_queue_clear(struct isis_vertex_queue *queue)
 
 	if (queue->insert_counter) {
 		struct isis_vertex *vertex;
-		while (0 == skiplist_first(queue->l.slist, NULL,
-					   (void **)&vertex)) {
+		while ((vertex = isis_vertex_tents_pop(&queue->l.heap)))
 			isis_vertex_del(vertex);
-			skiplist_delete_first(queue->l.slist);
-		}
 		queue->insert_counter = 1;
 	} else {
 		queue->l.list->del = (void (*)(void *))isis_vertex_del;
@@ -218,10 +215,9 @@ static void isis_vertex_queue_free(struct isis_vertex_queue *queue)
 	hash_free(queue->hash);
 	queue->hash = NULL;
 
-	if (queue->insert_counter) {
-		skiplist_free(queue->l.slist);
-		queue->l.slist = NULL;
-	} else
+	if (queue->insert_counter)
+		isis_vertex_tents_fini(&queue->l.heap);
+	else
 		list_delete(&queue->l.list);
 }
 
@@ -264,7 +260,7 @@ static void isis_vertex_queue_insert(struct isis_vertex_queue *queue,
 	vertex->insert_counter = queue->insert_counter++;
 	assert(queue->insert_counter != (uint64_t)-1);
 
-	skiplist_insert(queue->l.slist, vertex, vertex);
+	isis_vertex_tents_add(&queue->l.heap, vertex);
 
 	struct isis_vertex *inserted;
 	inserted = hash_get(queue->hash, vertex, hash_alloc_intern);
@@ -279,10 +275,10 @@ isis_vertex_queue_pop(struct isis_vertex_queue *queue)
 
 	struct isis_vertex *rv;
 
-	if (skiplist_first(queue->l.slist, NULL, (void **)&rv))
+	rv = isis_vertex_tents_pop(&queue->l.heap);
+	if (!rv)
 		return NULL;
 
-	skiplist_delete_first(queue->l.slist);
 	hash_release(queue->hash, rv);
 
 	return rv;
@@ -294,7 +290,7 @@ static void isis_vertex_queue_delete(struct isis_vertex_queue *queue,
 {
 	assert(queue->insert_counter);
 
-	skiplist_delete(queue->l.slist, vertex, vertex);
+	isis_vertex_tents_del(&queue->l.heap, vertex);
 	hash_release(queue->hash, vertex);
 }
 
@@ -314,6 +310,7 @@ struct isis_spftree {
 	struct isis_spf_nodes adj_nodes;
 	struct isis_area *area;    /* back pointer to area */
 	unsigned int runcount;     /* number of runs since uptime */
+	unsigned int prc_runcount; /* partial route calculations */
 	time_t last_run_timestamp; /* last run timestamp as wall time for display */
 	time_t last_run_monotime;  /* last run as monotime for scheduling */
 	time_t last_run_duration;  /* last run duration in msec */
@@ -338,6 +335,12 @@ struct isis_spftree {
 		struct isis_spf_nodes p_space;
 		struct isis_spf_nodes q_space;
 
+		/*
+		 * P-space of the adjacent routers unaffected by the failure,
+		 * in their p_space.
+		 */
+		struct isis_spf_nodes adj_p_space;
+
 		/* Remote LFA related information. */
 		struct {
 			/* List of RLFAs eligible to be installed. */
@@ -26,9 +26,7 @@
 #include <zebra.h>
 #include <json-c/json_object.h>
 
-#ifdef CRYPTO_INTERNAL
-#include "md5.h"
-#endif
+#include "hmac.h"
 #include "memory.h"
 #include "stream.h"
 #include "sbuf.h"
@@ -49,6 +47,55 @@
 DEFINE_MTYPE_STATIC(ISISD, ISIS_TLV, "ISIS TLVs");
 DEFINE_MTYPE(ISISD, ISIS_SUBTLV, "ISIS Sub-TLVs");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_MT_ITEM_LIST, "ISIS MT Item Lists");
+DEFINE_MTYPE_STATIC(ISISD, ISIS_TLV_ARENA, "ISIS TLV arena");
+
+/*
+ * Received TLVs are unpacked into an arena owned by their isis_tlvs, so
+ * an LSP costs a few allocations instead of one per item and sub-TLV, and
+ * isis_free_tlvs() drops it all at once.  Unpacked TLVs are only read and
+ * then freed as a whole, never modified item by item.
+ */
+struct isis_tlvs_arena {
+	struct isis_tlvs_arena *next;
+	size_t used;
+	size_t size;
+	max_align_t data[];
+};
+
+#define ISIS_TLVS_ARENA_MIN 4096
+#define ISIS_TLVS_ARENA_MAX 65536
+
+/* the TLVs being unpacked, NULL outside of isis_unpack_tlvs() */
+static struct isis_tlvs *unpack_tlvs_arena;
+
+static void *unpack_calloc(struct memtype *mt, size_t size)
+{
+	struct isis_tlvs_arena *arena;
+	size_t chunk;
+	void *rv;
+
+	if (!unpack_tlvs_arena)
+		return XCALLOC(mt, size);
+
+	size = (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+	arena = unpack_tlvs_arena->arena;
+	if (!arena || arena->size - arena->used < size) {
+		chunk = arena ? MIN(arena->size * 2, ISIS_TLVS_ARENA_MAX)
+			      : ISIS_TLVS_ARENA_MIN;
+		chunk = MAX(chunk, size);
+
+		arena = XMALLOC(MTYPE_ISIS_TLV_ARENA, sizeof(*arena) + chunk);
+		arena->next = unpack_tlvs_arena->arena;
+		arena->used = 0;
+		arena->size = chunk;
+		unpack_tlvs_arena->arena = arena;
+	}
+
+	rv = (char *)arena->data + arena->used;
+	arena->used += size;
+	memset(rv, 0, size);
+	return rv;
+}
 
 typedef int (*unpack_tlv_func)(enum isis_tlv_context context, uint8_t tlv_type,
 			       uint8_t tlv_len, struct stream *s,
@@ -132,7 +179,7 @@ struct isis_ext_subtlvs *isis_alloc_ext_subtlvs(void)
 {
 	struct isis_ext_subtlvs *ext;
 
-	ext = XCALLOC(MTYPE_ISIS_SUBTLV, sizeof(struct isis_ext_subtlvs));
+	ext = unpack_calloc(MTYPE_ISIS_SUBTLV, sizeof(struct isis_ext_subtlvs));
 	init_item_list(&ext->adj_sid);
 	init_item_list(&ext->lan_sid);
 
@@ -1049,8 +1096,9 @@ static int unpack_item_ext_subtlvs(uint16_t mtid, uint8_t len, struct stream *s,
 			} else {
 				struct isis_adj_sid *adj;
 
-				adj = XCALLOC(MTYPE_ISIS_SUBTLV,
-					      sizeof(struct isis_adj_sid));
+				adj = unpack_calloc(
+					MTYPE_ISIS_SUBTLV,
+					sizeof(struct isis_adj_sid));
 				adj->flags = stream_getc(s);
 				adj->weight = stream_getc(s);
 				if (adj->flags & EXT_SUBTLV_LINK_ADJ_SID_VFLG
@@ -1098,8 +1146,9 @@ static int unpack_item_ext_subtlvs(uint16_t mtid, uint8_t len, struct stream *s,
 			} else {
 				struct isis_lan_adj_sid *lan;
 
-				lan = XCALLOC(MTYPE_ISIS_SUBTLV,
-					      sizeof(struct isis_lan_adj_sid));
+				lan = unpack_calloc(
+					MTYPE_ISIS_SUBTLV,
+					sizeof(struct isis_lan_adj_sid));
 				lan->flags = stream_getc(s);
 				lan->weight = stream_getc(s);
 				stream_get(&(lan->neighbor_id), s,
@@ -1160,7 +1209,8 @@ static int unpack_item_ext_subtlvs(uint16_t mtid, uint8_t len, struct stream *s,
 static struct isis_item *copy_item_prefix_sid(struct isis_item *i)
 {
 	struct isis_prefix_sid *sid = (struct isis_prefix_sid *)i;
-	struct isis_prefix_sid *rv = XCALLOC(MTYPE_ISIS_SUBTLV, sizeof(*rv));
+	struct isis_prefix_sid *rv =
+		unpack_calloc(MTYPE_ISIS_SUBTLV, sizeof(*rv));
 
 	rv->flags = sid->flags;
 	rv->algorithm = sid->algorithm;
@@ -1402,7 +1452,7 @@ static int unpack_subtlv_ipv6_source_prefix(enum isis_tlv_context context,
 		return 0;
 	}
 
-	subtlvs->source_prefix = XCALLOC(MTYPE_ISIS_SUBTLV, sizeof(p));
+	subtlvs->source_prefix = unpack_calloc(MTYPE_ISIS_SUBTLV, sizeof(p));
 	memcpy(subtlvs->source_prefix, &p, sizeof(p));
 	return 0;
 }
@@ -1433,7 +1483,7 @@ static struct isis_subtlvs *isis_alloc_subtlvs(enum isis_tlv_context context)
 {
 	struct isis_subtlvs *result;
 
-	result = XCALLOC(MTYPE_ISIS_SUBTLV, sizeof(*result));
+	result = unpack_calloc(MTYPE_ISIS_SUBTLV, sizeof(*result));
 	result->context = context;
 
 	init_item_list(&result->prefix_sids);
@@ -1573,7 +1623,7 @@ static int unpack_item_area_address(uint16_t mtid, uint8_t len,
 		goto out;
 	}
 
-	rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	rv->len = stream_getc(s);
 
 	if (len < 1 + rv->len) {
@@ -1596,7 +1646,8 @@ static int unpack_item_area_address(uint16_t mtid, uint8_t len,
 	append_item(&tlvs->area_addresses, (struct isis_item *)rv);
 	return 0;
 out:
-	XFREE(MTYPE_ISIS_TLV, rv);
+	if (!unpack_tlvs_arena)
+		XFREE(MTYPE_ISIS_TLV, rv);
 	return 1;
 }
 
@@ -1668,7 +1719,8 @@ static int unpack_item_oldstyle_reach(uint16_t mtid, uint8_t len,
 		return 1;
 	}
 
-	struct isis_oldstyle_reach *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_oldstyle_reach *rv =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	rv->metric = stream_getc(s);
 	if ((rv->metric & 0x3f) != rv->metric) {
 		sbuf_push(log, indent, "Metric has unplausible format\n");
@@ -1742,7 +1794,8 @@ static int unpack_item_lan_neighbor(uint16_t mtid, uint8_t len,
 		return 1;
 	}
 
-	struct isis_lan_neighbor *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_lan_neighbor *rv =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	stream_get(rv->mac, s, 6);
 
 	format_item_lan_neighbor(mtid, (struct isis_item *)rv, log, NULL, indent + 2);
@@ -1825,7 +1878,7 @@ static int unpack_item_lsp_entry(uint16_t mtid, uint8_t len, struct stream *s,
 		return 1;
 	}
 
-	struct isis_lsp_entry *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_lsp_entry *rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	rv->rem_lifetime = stream_getw(s);
 	stream_get(rv->id, s, 8);
 	rv->seqno = stream_getl(s);
@@ -1947,7 +2000,7 @@ static int unpack_item_extended_reach(uint16_t mtid, uint8_t len,
 		goto out;
 	}
 
-	rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	stream_get(rv->id, s, 7);
 	rv->metric = stream_get3(s);
 	subtlv_len = stream_getc(s);
@@ -1974,7 +2027,7 @@ static int unpack_item_extended_reach(uint16_t mtid, uint8_t len,
 	append_item(items, (struct isis_item *)rv);
 	return 0;
 out:
-	if (rv)
+	if (rv && !unpack_tlvs_arena)
 		free_item_extended_reach((struct isis_item *)rv);
 
 	return 1;
@@ -2054,7 +2107,7 @@ static int unpack_item_oldstyle_ip_reach(uint16_t mtid, uint8_t len,
 	}
 
 	struct isis_oldstyle_ip_reach *rv =
-		XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	rv->metric = stream_getc(s);
 	if ((rv->metric & 0x7f) != rv->metric) {
 		sbuf_push(log, indent, "Metric has unplausible format\n");
@@ -2157,7 +2210,8 @@ static int unpack_tlv_protocols_supported(enum isis_tlv_context context,
 	}
 
 	tlvs->protocols_supported.count = tlv_len;
-	tlvs->protocols_supported.protocols = XCALLOC(MTYPE_ISIS_TLV, tlv_len);
+	tlvs->protocols_supported.protocols =
+		unpack_calloc(MTYPE_ISIS_TLV, tlv_len);
 	stream_get(tlvs->protocols_supported.protocols, s, tlv_len);
 
 	format_tlv_protocols_supported(&tlvs->protocols_supported, log, NULL,
@@ -2225,7 +2279,8 @@ static int unpack_item_ipv4_address(uint16_t mtid, uint8_t len,
 		return 1;
 	}
 
-	struct isis_ipv4_address *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_ipv4_address *rv =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	stream_get(&rv->addr, s, 4);
 
 	format_item_ipv4_address(mtid, (struct isis_item *)rv, log, NULL, indent + 2);
@@ -2293,7 +2348,8 @@ static int unpack_item_ipv6_address(uint16_t mtid, uint8_t len,
 		return 1;
 	}
 
-	struct isis_ipv6_address *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_ipv6_address *rv =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	stream_get(&rv->addr, s, IPV6_MAX_BYTELEN);
 
 	format_item_ipv6_address(mtid, (struct isis_item *)rv, log, NULL, indent + 2);
@@ -2363,7 +2419,8 @@ static int unpack_item_global_ipv6_address(uint16_t mtid, uint8_t len,
 		return 1;
 	}
 
-	struct isis_ipv6_address *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_ipv6_address *rv =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	stream_get(&rv->addr, s, IPV6_MAX_BYTELEN);
 
 	format_item_global_ipv6_address(mtid, (struct isis_item *)rv, log, NULL,
@@ -2446,7 +2503,8 @@ static int unpack_item_mt_router_info(uint16_t mtid, uint8_t len,
 		return 1;
 	}
 
-	struct isis_mt_router_info *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_mt_router_info *rv =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 
 	uint16_t entry = stream_getw(s);
 	rv->overload = entry & ISIS_MT_OL_MASK;
@@ -2524,7 +2582,7 @@ static int unpack_tlv_te_router_id(enum isis_tlv_context context,
 		return 0;
 	}
 
-	tlvs->te_router_id = XCALLOC(MTYPE_ISIS_TLV, 4);
+	tlvs->te_router_id = unpack_calloc(MTYPE_ISIS_TLV, 4);
 	stream_get(tlvs->te_router_id, s, 4);
 	format_tlv_te_router_id(tlvs->te_router_id, log, NULL, indent + 2);
 	return 0;
@@ -2655,7 +2713,7 @@ static int unpack_item_extended_ip_reach(uint16_t mtid, uint8_t len,
 		goto out;
 	}
 
-	rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 
 	rv->metric = stream_getl(s);
 	control = stream_getc(s);
@@ -2714,7 +2772,8 @@ static int unpack_item_extended_ip_reach(uint16_t mtid, uint8_t len,
 			goto out;
 		}
 		if (!unpacked_known_tlvs) {
-			isis_free_subtlvs(rv->subtlvs);
+			if (!unpack_tlvs_arena)
+				isis_free_subtlvs(rv->subtlvs);
 			rv->subtlvs = NULL;
 		}
 	}
@@ -2722,7 +2781,7 @@ static int unpack_item_extended_ip_reach(uint16_t mtid, uint8_t len,
 	append_item(items, (struct isis_item *)rv);
 	return 0;
 out:
-	if (rv)
+	if (rv && !unpack_tlvs_arena)
 		free_item_extended_ip_reach((struct isis_item *)rv);
 	return 1;
 }
@@ -2790,7 +2849,7 @@ static int unpack_tlv_dynamic_hostname(enum isis_tlv_context context,
 		return 0;
 	}
 
-	tlvs->hostname = XCALLOC(MTYPE_ISIS_TLV, tlv_len + 1);
+	tlvs->hostname = unpack_calloc(MTYPE_ISIS_TLV, tlv_len + 1);
 	stream_get(tlvs->hostname, s, tlv_len);
 	tlvs->hostname[tlv_len] = '\0';
 
@@ -2879,7 +2938,8 @@ static int unpack_tlv_te_router_id_ipv6(enum isis_tlv_context context,
 		return 0;
 	}
 
-	tlvs->te_router_id_ipv6 = XCALLOC(MTYPE_ISIS_TLV, IPV6_MAX_BYTELEN);
+	tlvs->te_router_id_ipv6 =
+		unpack_calloc(MTYPE_ISIS_TLV, IPV6_MAX_BYTELEN);
 	stream_get(tlvs->te_router_id_ipv6, s, IPV6_MAX_BYTELEN);
 	format_tlv_te_router_id_ipv6(tlvs->te_router_id_ipv6, log, NULL, indent + 2);
 	return 0;
@@ -3013,7 +3073,8 @@ static int unpack_tlv_spine_leaf(enum isis_tlv_context context,
 		return 0;
 	}
 
-	tlvs->spine_leaf = XCALLOC(MTYPE_ISIS_TLV, sizeof(*tlvs->spine_leaf));
+	tlvs->spine_leaf =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*tlvs->spine_leaf));
 
 	uint16_t spine_leaf_flags = stream_getw(s);
 
@@ -3149,7 +3210,8 @@ static int unpack_tlv_threeway_adj(enum isis_tlv_context context,
 		return 0;
 	}
 
-	tlvs->threeway_adj = XCALLOC(MTYPE_ISIS_TLV, sizeof(*tlvs->threeway_adj));
+	tlvs->threeway_adj =
+		unpack_calloc(MTYPE_ISIS_TLV, sizeof(*tlvs->threeway_adj));
 
 	tlvs->threeway_adj->state = stream_getc(s);
 	tlvs->threeway_adj->local_circuit_id = stream_getl(s);
@@ -3287,7 +3349,7 @@ static int unpack_item_ipv6_reach(uint16_t mtid, uint8_t len, struct stream *s,
 		goto out;
 	}
 
-	rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 
 	rv->metric = stream_getl(s);
 	control = stream_getc(s);
@@ -3348,7 +3410,8 @@ static int unpack_item_ipv6_reach(uint16_t mtid, uint8_t len, struct stream *s,
 			goto out;
 		}
 		if (!unpacked_known_tlvs) {
-			isis_free_subtlvs(rv->subtlvs);
+			if (!unpack_tlvs_arena)
+				isis_free_subtlvs(rv->subtlvs);
 			rv->subtlvs = NULL;
 		}
 	}
@@ -3356,7 +3419,7 @@ static int unpack_item_ipv6_reach(uint16_t mtid, uint8_t len, struct stream *s,
 	append_item(items, (struct isis_item *)rv);
 	return 0;
 out:
-	if (rv)
+	if (rv && !unpack_tlvs_arena)
 		free_item_ipv6_reach((struct isis_item *)rv);
 	return 1;
 }
@@ -3606,7 +3669,7 @@ static int unpack_tlv_router_cap(enum isis_tlv_context context,
 	}
 
 	/* Allocate router cap structure and initialize SR Algorithms */
-	rcap = XCALLOC(MTYPE_ISIS_TLV, sizeof(struct isis_router_cap));
+	rcap = unpack_calloc(MTYPE_ISIS_TLV, sizeof(struct isis_router_cap));
 	for (int i = 0; i < SR_ALGORITHM_COUNT; i++)
 		rcap->algo[i] = SR_ALGORITHM_UNSET;
 
@@ -3627,7 +3690,8 @@ static int unpack_tlv_router_cap(enum isis_tlv_context context,
 				log, indent,
 				"WARNING: Router Capability subTLV length too large compared to expected size\n");
 			stream_forward_getp(s, STREAM_READABLE(s));
-			XFREE(MTYPE_ISIS_TLV, rcap);
+			if (!unpack_tlvs_arena)
+				XFREE(MTYPE_ISIS_TLV, rcap);
 			return 0;
 		}
 
@@ -3882,7 +3946,7 @@ static int unpack_item_auth(uint16_t mtid, uint8_t len, struct stream *s,
 		return 1;
 	}
 
-	struct isis_auth *rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	struct isis_auth *rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 
 	rv->type = stream_getc(s);
 	rv->length = len - 1;
@@ -3892,7 +3956,8 @@ static int unpack_item_auth(uint16_t mtid, uint8_t len, struct stream *s,
 			log, indent,
 			"Unexpected auth length for HMAC-MD5 (expected 16, got %hhu)\n",
 			rv->length);
-		XFREE(MTYPE_ISIS_TLV, rv);
+		if (!unpack_tlvs_arena)
+			XFREE(MTYPE_ISIS_TLV, rv);
 		return 1;
 	}
 
@@ -3913,7 +3978,7 @@ static struct isis_purge_originator *copy_tlv_purge_originator(
 
 	struct isis_purge_originator *rv;
 
-	rv = XCALLOC(MTYPE_ISIS_TLV, sizeof(*rv));
+	rv = unpack_calloc(MTYPE_ISIS_TLV, sizeof(*rv));
 	rv->sender_set = poi->sender_set;
 	memcpy(rv->generator, poi->generator, sizeof(rv->generator));
 	if (poi->sender_set)
@@ -4381,7 +4446,7 @@ struct isis_item_list *isis_get_mt_items(struct isis_mt_item_list *m,
 
 	rv = isis_lookup_mt_items(m, mtid);
 	if (!rv) {
-		rv = XCALLOC(MTYPE_ISIS_MT_ITEM_LIST, sizeof(*rv));
+		rv = unpack_calloc(MTYPE_ISIS_MT_ITEM_LIST, sizeof(*rv));
 		init_item_list(rv);
 		rv->mtid = mtid;
 		RB_INSERT(isis_mt_item_list, m, rv);
@@ -4663,9 +4728,20 @@ const char *isis_format_tlvs(struct isis_tlvs *tlvs, struct json_object *json)
 
 void isis_free_tlvs(struct isis_tlvs *tlvs)
 {
+	struct isis_tlvs_arena *arena;
+
 	if (!tlvs)
 		return;
 
+	if (tlvs->arena) {
+		while ((arena = tlvs->arena)) {
+			tlvs->arena = arena->next;
+			XFREE(MTYPE_ISIS_TLV_ARENA, arena);
+		}
+		XFREE(MTYPE_ISIS_TLV, tlvs);
+		return;
+	}
+
 	free_items(ISIS_CONTEXT_LSP, ISIS_TLV_AUTH, &tlvs->isis_auth);
 	free_tlv_purge_originator(tlvs->purge_originator);
 	free_items(ISIS_CONTEXT_LSP, ISIS_TLV_AREA_ADDRESSES,
@@ -4748,6 +4824,16 @@ static void restore_auth_md5(struct stream *s, uint16_t checksum,
 	memcpy(STREAM_DATA(s) + LSP_CHECKSUM_OFF, &checksum, sizeof(checksum));
 }
 
+/* the key is nearly always the same, keep its pad states around */
+static struct hmac_key isis_hmac_key;
+
+static void isis_hmac_md5(const uint8_t *data, size_t len,
+			  const uint8_t *key, size_t keylen, uint8_t *digest)
+{
+	hmac_key_set(&isis_hmac_key, KEYCHAIN_ALGO_MD5, key, keylen);
+	hmac_compute(&isis_hmac_key, data, len, digest);
+}
+
 static void update_auth_hmac_md5(struct isis_auth *auth, struct stream *s,
 				 bool is_lsp)
 {
@@ -4758,16 +4844,8 @@ static void update_auth_hmac_md5(struct isis_auth *auth, struct stream *s,
 		safe_auth_md5(s, &checksum, &rem_lifetime);
 
 	memset(STREAM_DATA(s) + auth->offset, 0, 16);
-#ifdef CRYPTO_OPENSSL
-	uint8_t *result = (uint8_t *)HMAC(EVP_md5(), auth->passwd,
-					  auth->plength, STREAM_DATA(s),
-					  stream_get_endp(s), NULL, NULL);
-
-	memcpy(digest, result, 16);
-#elif CRYPTO_INTERNAL
-	hmac_md5(STREAM_DATA(s), stream_get_endp(s), auth->passwd,
-		 auth->plength, digest);
-#endif
+	isis_hmac_md5(STREAM_DATA(s), stream_get_endp(s), auth->passwd,
+		      auth->plength, digest);
 	memcpy(auth->value, digest, 16);
 	memcpy(STREAM_DATA(s) + auth->offset, digest, 16);
 
@@ -5081,8 +5159,10 @@ int isis_unpack_tlvs(size_t avail_len, struct stream *stream,
 	}
 
 	result = isis_alloc_tlvs();
+	unpack_tlvs_arena = result;
 	rv = unpack_tlvs(ISIS_CONTEXT_LSP, avail_len, stream, &logbuf, result,
 			 indent, NULL);
+	unpack_tlvs_arena = NULL;
 
 	*log = sbuf_buf(&logbuf);
 	*dest = result;
@@ -5347,16 +5427,8 @@ static bool auth_validator_hmac_md5(struct isis_passwd *passwd,
 		safe_auth_md5(stream, &checksum, &rem_lifetime);
 
 	memset(STREAM_DATA(stream) + auth->offset, 0, 16);
-#ifdef CRYPTO_OPENSSL
-	uint8_t *result = (uint8_t *)HMAC(EVP_md5(), passwd->passwd,
-					  passwd->len, STREAM_DATA(stream),
-					  stream_get_endp(stream), NULL, NULL);
-
-	memcpy(digest, result, 16);
-#elif CRYPTO_INTERNAL
-	hmac_md5(STREAM_DATA(stream), stream_get_endp(stream), passwd->passwd,
-		 passwd->len, digest);
-#endif
+	isis_hmac_md5(STREAM_DATA(stream), stream_get_endp(stream),
+		      passwd->passwd, passwd->len, digest);
 	memcpy(STREAM_DATA(stream) + auth->offset, auth->value, 16);
 
 	bool rv = !memcmp(digest, auth->value, 16);
@@ -5424,6 +5496,114 @@ bool isis_tlvs_area_addresses_match(struct isis_tlvs *tlvs,
 	return false;
 }
 
+static bool oldstyle_reach_same(struct isis_item_list *a,
+				struct isis_item_list *b)
+{
+	struct isis_oldstyle_reach *ra, *rb;
+
+	if (a->count != b->count)
+		return false;
+
+	for (ra = (struct isis_oldstyle_reach *)a->head,
+	    rb = (struct isis_oldstyle_reach *)b->head;
+	     ra && rb; ra = ra->next, rb = rb->next) {
+		if (ra->metric != rb->metric
+		    || memcmp(ra->id, rb->id, sizeof(ra->id)))
+			return false;
+	}
+
+	return true;
+}
+
+static bool extended_reach_same(struct isis_item_list *a,
+				struct isis_item_list *b)
+{
+	struct isis_extended_reach *ra, *rb;
+
+	if (!a || !b)
+		return (a ? a->count : 0) == (b ? b->count : 0);
+
+	if (a->count != b->count)
+		return false;
+
+	for (ra = (struct isis_extended_reach *)a->head,
+	    rb = (struct isis_extended_reach *)b->head;
+	     ra && rb; ra = ra->next, rb = rb->next) {
+		if (ra->metric != rb->metric
+		    || memcmp(ra->id, rb->id, sizeof(ra->id)))
+			return false;
+	}
+
+	return true;
+}
+
+static bool mt_reach_same(struct isis_mt_item_list *a,
+			  struct isis_mt_item_list *b)
+{
+	struct isis_item_list *la, *lb;
+
+	RB_FOREACH (la, isis_mt_item_list, a) {
+		lb = isis_lookup_mt_items(b, la->mtid);
+		if (!extended_reach_same(la, lb))
+			return false;
+	}
+	RB_FOREACH (lb, isis_mt_item_list, b) {
+		la = isis_lookup_mt_items(a, lb->mtid);
+		if (!la && lb->count)
+			return false;
+	}
+
+	return true;
+}
+
+static bool mt_router_info_same(struct isis_item_list *a,
+				struct isis_item_list *b)
+{
+	struct isis_mt_router_info *ia, *ib;
+
+	if (a->count != b->count)
+		return false;
+
+	for (ia = (struct isis_mt_router_info *)a->head,
+	    ib = (struct isis_mt_router_info *)b->head;
+	     ia && ib; ia = ia->next, ib = ib->next) {
+		if (ia->mtid != ib->mtid || ia->overload != ib->overload
+		    || ia->attached != ib->attached)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Whether the TLVs of two instances of an LSP describe the same topology
+ * for the SPF: the same neighbors with the same metrics, protocols and MT
+ * router information.  Reachability and the other TLVs may differ.
+ */
+bool isis_tlvs_same_topology(struct isis_tlvs *a, struct isis_tlvs *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	if (a->protocols_supported.count != b->protocols_supported.count
+	    || (a->protocols_supported.count
+		&& memcmp(a->protocols_supported.protocols,
+			  b->protocols_supported.protocols,
+			  a->protocols_supported.count)))
+		return false;
+
+	if (!mt_router_info_same(&a->mt_router_info, &b->mt_router_info))
+		return false;
+
+	if (!oldstyle_reach_same(&a->oldstyle_reach, &b->oldstyle_reach))
+		return false;
+
+	if (!extended_reach_same(&a->extended_reach, &b->extended_reach))
+		return false;
+
+	return mt_reach_same(&a->mt_reach, &b->mt_reach);
+}
+
 static void tlvs_area_addresses_to_adj(struct isis_tlvs *tlvs,
 				       struct isis_adjacency *adj,
 				       bool *changed)
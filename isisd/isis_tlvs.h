@@ -318,6 +318,9 @@ struct isis_tlvs {
 	struct isis_threeway_adj *threeway_adj;
 	struct isis_router_cap *router_cap;
 	struct isis_spine_leaf *spine_leaf;
+
+	/* everything above, when unpacked by isis_unpack_tlvs() */
+	struct isis_tlvs_arena *arena;
 };
 
 enum isis_tlv_context {
@@ -528,6 +531,7 @@ int isis_pack_tlvs(struct isis_tlvs *tlvs, struct stream *stream,
 		   size_t len_pointer, bool pad, bool is_lsp);
 void isis_free_tlvs(struct isis_tlvs *tlvs);
 struct isis_tlvs *isis_alloc_tlvs(void);
+/* the result is read only, modify an isis_copy_tlvs() of it instead */
 int isis_unpack_tlvs(size_t avail_len, struct stream *stream,
 		     struct isis_tlvs **dest, const char **error_log);
 const char *isis_format_tlvs(struct isis_tlvs *tlvs, struct json_object *json);
@@ -567,6 +571,7 @@ int isis_tlvs_auth_is_valid(struct isis_tlvs *tlvs, struct isis_passwd *passwd,
 			    struct stream *stream, bool is_lsp);
 bool isis_tlvs_area_addresses_match(struct isis_tlvs *tlvs,
 				    struct list *addresses);
+bool isis_tlvs_same_topology(struct isis_tlvs *a, struct isis_tlvs *b);
 struct isis_adjacency;
 void isis_tlvs_to_adj(struct isis_tlvs *tlvs, struct isis_adjacency *adj,
 		      bool *changed);
@@ -23,6 +23,8 @@
 
 #include "hash.h"
 #include "jhash.h"
+#include "monotime.h"
+#include "typesafe.h"
 
 #include "isisd/isisd.h"
 #include "isisd/isis_flags.h"
@@ -34,21 +36,42 @@
 DEFINE_MTYPE_STATIC(ISISD, TX_QUEUE, "ISIS TX Queue");
 DEFINE_MTYPE_STATIC(ISISD, TX_QUEUE_ENTRY, "ISIS TX Queue Entry");
 
+/* seconds until an unacknowledged LSP is sent again */
+#define TX_QUEUE_RETRY_INTERVAL 5
+/* LSPs sent per run of the queue, before other work gets a turn */
+#define TX_QUEUE_BURST 32
+
+PREDECL_DLIST(tx_queue_list);
+
+/*
+ * One thread per queue sends what is ready and then what is due for a
+ * retransmission, instead of an event and a timer per queued LSP.
+ */
 struct isis_tx_queue {
 	struct isis_circuit *circuit;
 	void (*send_event)(struct isis_circuit *circuit,
 			   struct isis_lsp *, enum isis_tx_type);
 	struct hash *hash;
+
+	/* to be sent, in the order they were queued */
+	struct tx_queue_list_head ready;
+	/* sent, in the order they are due to be sent again */
+	struct tx_queue_list_head sent;
+	struct thread *t_send;
 };
 
 struct isis_tx_queue_entry {
 	struct isis_lsp *lsp;
 	enum isis_tx_type type;
 	bool is_retry;
-	struct thread *retry;
+	struct timeval due;
+	struct tx_queue_list_item item;
+	struct tx_queue_list_head *list;
 	struct isis_tx_queue *queue;
 };
 
+DECLARE_DLIST(tx_queue_list, struct isis_tx_queue_entry, item);
+
 static unsigned tx_queue_hash_key(const void *p)
 {
 	const struct isis_tx_queue_entry *e = p;
@@ -85,22 +108,43 @@ struct isis_tx_queue *isis_tx_queue_new(
 	rv->send_event = send_event;
 
 	rv->hash = hash_create(tx_queue_hash_key, tx_queue_hash_cmp, NULL);
+	tx_queue_list_init(&rv->ready);
+	tx_queue_list_init(&rv->sent);
 	return rv;
 }
 
+static void tx_queue_unlink(struct isis_tx_queue_entry *e)
+{
+	if (!e->list)
+		return;
+
+	tx_queue_list_del(e->list, e);
+	e->list = NULL;
+}
+
+static void tx_queue_move(struct isis_tx_queue_entry *e,
+			  struct tx_queue_list_head *list)
+{
+	tx_queue_unlink(e);
+	tx_queue_list_add_tail(list, e);
+	e->list = list;
+}
+
 static void tx_queue_element_free(void *element)
 {
 	struct isis_tx_queue_entry *e = element;
 
-	THREAD_OFF(e->retry);
-
+	tx_queue_unlink(e);
 	XFREE(MTYPE_TX_QUEUE_ENTRY, e);
 }
 
 void isis_tx_queue_free(struct isis_tx_queue *queue)
 {
+	THREAD_OFF(queue->t_send);
 	hash_clean(queue->hash, tx_queue_element_free);
 	hash_free(queue->hash);
+	tx_queue_list_fini(&queue->ready);
+	tx_queue_list_fini(&queue->sent);
 	XFREE(MTYPE_TX_QUEUE, queue);
 }
 
@@ -114,20 +158,61 @@ static struct isis_tx_queue_entry *tx_queue_find(struct isis_tx_queue *queue,
 	return hash_lookup(queue->hash, &e);
 }
 
-static void tx_queue_send_event(struct thread *thread)
+static void tx_queue_run(struct thread *thread);
+
+static void tx_queue_schedule(struct isis_tx_queue *queue)
 {
-	struct isis_tx_queue_entry *e = THREAD_ARG(thread);
-	struct isis_tx_queue *queue = e->queue;
+	struct isis_tx_queue_entry *e;
+	int64_t msec;
+
+	THREAD_OFF(queue->t_send);
 
-	thread_add_timer(master, tx_queue_send_event, e, 5, &e->retry);
+	if (tx_queue_list_count(&queue->ready)) {
+		thread_add_event(master, tx_queue_run, queue, 0,
+				 &queue->t_send);
+		return;
+	}
 
-	if (e->is_retry)
-		queue->circuit->area->lsp_rxmt_count++;
-	else
-		e->is_retry = true;
+	e = tx_queue_list_first(&queue->sent);
+	if (!e)
+		return;
 
-	queue->send_event(queue->circuit, e->lsp, e->type);
-	/* Don't access e here anymore, send_event might have destroyed it */
+	msec = monotime_until(&e->due, NULL) / 1000;
+	thread_add_timer_msec(master, tx_queue_run, queue, MAX(msec, 0),
+			      &queue->t_send);
+}
+
+static void tx_queue_run(struct thread *thread)
+{
+	struct isis_tx_queue *queue = THREAD_ARG(thread);
+	struct isis_tx_queue_entry *e;
+	struct timeval now;
+	unsigned int count;
+
+	monotime(&now);
+
+	for (count = 0; count < TX_QUEUE_BURST; count++) {
+		e = tx_queue_list_first(&queue->ready);
+		if (!e) {
+			e = tx_queue_list_first(&queue->sent);
+			if (!e || timercmp(&e->due, &now, >))
+				break;
+		}
+
+		e->due = now;
+		e->due.tv_sec += TX_QUEUE_RETRY_INTERVAL;
+		tx_queue_move(e, &queue->sent);
+
+		if (e->is_retry)
+			queue->circuit->area->lsp_rxmt_count++;
+		else
+			e->is_retry = true;
+
+		queue->send_event(queue->circuit, e->lsp, e->type);
+		/* e may be gone now, send_event can destroy it */
+	}
+
+	tx_queue_schedule(queue);
 }
 
 void _isis_tx_queue_add(struct isis_tx_queue *queue,
@@ -160,11 +245,12 @@ void _isis_tx_queue_add(struct isis_tx_queue *queue,
 	}
 
 	e->type = type;
-
-	THREAD_OFF(e->retry);
-	thread_add_event(master, tx_queue_send_event, e, 0, &e->retry);
-
 	e->is_retry = false;
+
+	tx_queue_move(e, &queue->ready);
+	/* otherwise the queue is being worked on already */
+	if (tx_queue_list_count(&queue->ready) == 1)
+		tx_queue_schedule(queue);
 }
 
 void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
@@ -184,8 +270,7 @@ void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
 			   func, file, line);
 	}
 
-	THREAD_OFF(e->retry);
-
+	tx_queue_unlink(e);
 	hash_release(queue->hash, e);
 	XFREE(MTYPE_TX_QUEUE_ENTRY, e);
 }
@@ -200,5 +285,6 @@ unsigned long isis_tx_queue_len(struct isis_tx_queue *queue)
 
 void isis_tx_queue_clean(struct isis_tx_queue *queue)
 {
+	THREAD_OFF(queue->t_send);
 	hash_clean(queue->hash, tx_queue_element_free);
 }
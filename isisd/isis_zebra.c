@@ -256,6 +256,17 @@ static int isis_zebra_add_nexthops(struct isis *isis, struct list *nexthops,
 	return count;
 }
 
+/* Route updates in between are sent to zebra as batches. */
+void isis_zebra_batch_begin(void)
+{
+	zclient_route_batch_begin(zclient);
+}
+
+void isis_zebra_batch_commit(void)
+{
+	zclient_route_batch_commit(zclient);
+}
+
 void isis_zebra_route_add_route(struct isis *isis, struct prefix *prefix,
 				struct prefix_ipv6 *src_p,
 				struct isis_route_info *route_info)
@@ -39,6 +39,8 @@ void isis_zebra_stop(void);
 struct isis_route_info;
 struct sr_adjacency;
 
+void isis_zebra_batch_begin(void);
+void isis_zebra_batch_commit(void);
 void isis_zebra_route_add_route(struct isis *isis,
 				struct prefix *prefix,
 				struct prefix_ipv6 *src_p,
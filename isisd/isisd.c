@@ -2263,6 +2263,14 @@ static void isis_spf_ietf_common(struct vty *vty, struct isis *isis)
 			} else {
 				vty_out(vty, "    Using legacy backoff algo\n");
 			}
+
+			if (area->lfa_last_spts[level - 1])
+				vty_out(vty,
+					"    Last LFA computation: %u SPTs in %" PRIu64
+					" usec, %u threads\n",
+					area->lfa_last_spts[level - 1],
+					area->lfa_last_duration[level - 1],
+					isis_lfa_threads());
 		}
 	}
 }
@@ -2416,6 +2424,8 @@ static void common_isis_summary_json(struct json_object *json,
 			json_object_int_add(level_json, "id", level);
 			json_object_int_add(level_json, "lsp0-regenerated",
 					    area->lsp_gen_count[level - 1]);
+			json_object_int_add(level_json, "lsp-unchanged",
+					    area->lsp_unchanged_count[level - 1]);
 			json_object_int_add(level_json, "lsp-purged",
 					    area->lsp_purge_count[level - 1]);
 			if (area->spf_timer[level - 1])
@@ -2505,6 +2515,9 @@ static void common_isis_summary_vty(struct vty *vty, struct isis *isis)
 			vty_out(vty, "    LSP0 regenerated: %" PRIu64 "\n",
 				area->lsp_gen_count[level - 1]);
 
+			vty_out(vty, "      LSPs unchanged: %" PRIu64 "\n",
+				area->lsp_unchanged_count[level - 1]);
+
 			vty_out(vty, "         LSPs purged: %" PRIu64 "\n",
 				area->lsp_purge_count[level - 1]);
 
@@ -192,10 +192,14 @@ struct isis_area {
 	/* the percentage of LSP mtu size used, before generating a new frag */
 	int lsp_frag_threshold;
 	uint64_t lsp_gen_count[ISIS_LEVELS];
+	/* fragments left alone on regeneration, nothing in them changed */
+	uint64_t lsp_unchanged_count[ISIS_LEVELS];
 	uint64_t lsp_purge_count[ISIS_LEVELS];
 	uint32_t lsp_exceeded_max_counter;
 	uint32_t lsp_seqno_skipped_counter;
 	uint64_t spf_run_count[ISIS_LEVELS];
+	/* the next SPF run has to recompute the SPT, not only prefixes */
+	bool spf_topology_change[ISIS_LEVELS];
 	int ip_circuits;
 	/* logging adjacency changes? */
 	uint8_t log_adj_changes;
@@ -219,6 +223,9 @@ struct isis_area {
 	struct prefix_list *rlfa_plist[ISIS_LEVELS];
 	size_t rlfa_protected_links[ISIS_LEVELS];
 	size_t tilfa_protected_links[ISIS_LEVELS];
+	/* last LFA/RLFA/TI-LFA run: time (usec) and SPTs computed */
+	uint64_t lfa_last_duration[ISIS_LEVELS];
+	unsigned int lfa_last_spts[ISIS_LEVELS];
 	/* MPLS LDP-IGP Sync */
 	struct ldp_sync_info_cmd ldp_sync_cmd;
 	/* Counters */
@@ -366,7 +366,7 @@ l2vpn_pw_negotiate(struct lde_nbr *ln, struct fec_node *fn, struct map *map)
 			st.status_code = S_WRONG_CBIT;
 			st.msg_id = map->msg_id;
 			st.msg_type = htons(MSG_TYPE_LABELMAPPING);
-			lde_send_labelwithdraw(ln, fn, NULL, &st);
+			lde_send_labelwithdraw(ln, fn, NULL, &st, 1);
 
 			pw->flags &= ~F_PW_CWORD;
 			lde_send_labelmapping(ln, fn, 1);
@@ -560,7 +560,7 @@ l2vpn_pw_status_update(struct zapi_pw_status *zpw)
 			if (pw->local_status == PW_FORWARDING)
 				lde_send_labelmapping(ln, fn, 1);
 			else
-				lde_send_labelwithdraw(ln, fn, NULL, NULL);
+				lde_send_labelwithdraw(ln, fn, NULL, NULL, 1);
 		}
 	}
 
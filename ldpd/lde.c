@@ -1136,7 +1136,7 @@ lde_send_labelmapping(struct lde_nbr *ln, struct fec_node *fn, int single)
 
 void
 lde_send_labelwithdraw(struct lde_nbr *ln, struct fec_node *fn,
-    struct map *wcard, struct status_tlv *st)
+    struct map *wcard, struct status_tlv *st, int single)
 {
 	struct lde_wdraw	*lw;
 	struct map		 map;
@@ -1178,7 +1178,9 @@ lde_send_labelwithdraw(struct lde_nbr *ln, struct fec_node *fn,
 	/* SWd.1: send label withdraw. */
 	lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD, ln->peerid, 0,
  	    &map, sizeof(map));
-	lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END, ln->peerid, 0, NULL, 0);
+	if (single)
+		lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END, ln->peerid, 0,
+		    NULL, 0);
 
 	/* SWd.2: record label withdraw. */
 	if (fn) {
@@ -1212,7 +1214,7 @@ lde_send_labelwithdraw_wcard(struct lde_nbr *ln, uint32_t label)
 	memset(&wcard, 0, sizeof(wcard));
 	wcard.type = MAP_TYPE_WILDCARD;
 	wcard.label = label;
-	lde_send_labelwithdraw(ln, NULL, &wcard, NULL);
+	lde_send_labelwithdraw(ln, NULL, &wcard, NULL, 1);
 }
 
 void
@@ -1226,7 +1228,7 @@ lde_send_labelwithdraw_twcard_prefix(struct lde_nbr *ln, uint16_t af,
 	wcard.fec.twcard.type = MAP_TYPE_PREFIX;
 	wcard.fec.twcard.u.prefix_af = af;
 	wcard.label = label;
-	lde_send_labelwithdraw(ln, NULL, &wcard, NULL);
+	lde_send_labelwithdraw(ln, NULL, &wcard, NULL, 1);
 }
 
 void
@@ -1240,7 +1242,7 @@ lde_send_labelwithdraw_twcard_pwid(struct lde_nbr *ln, uint16_t pw_type,
 	wcard.fec.twcard.type = MAP_TYPE_PWID;
 	wcard.fec.twcard.u.pw_type = pw_type;
 	wcard.label = label;
-	lde_send_labelwithdraw(ln, NULL, &wcard, NULL);
+	lde_send_labelwithdraw(ln, NULL, &wcard, NULL, 1);
 }
 
 void
@@ -1255,7 +1257,7 @@ lde_send_labelwithdraw_pwid_wcard(struct lde_nbr *ln, uint16_t pw_type,
 	wcard.fec.pwid.group_id = group_id;
 	/* we can not append a Label TLV when using PWid group wildcards. */
 	wcard.label = NO_LABEL;
-	lde_send_labelwithdraw(ln, NULL, &wcard, NULL);
+	lde_send_labelwithdraw(ln, NULL, &wcard, NULL, 1);
 }
 
 void
@@ -1495,7 +1497,8 @@ lde_nbr_del(struct lde_nbr *ln)
 					RB_FOREACH(lnbr, nbr_tree, &lde_nbrs) {
 						if (ln->peerid == lnbr->peerid)
 							continue;
-						lde_send_labelwithdraw(lnbr, fn, NULL, NULL);
+						lde_send_labelwithdraw(lnbr, fn, NULL,
+						    NULL, 0);
 					}
 				}
 				break;
@@ -1516,6 +1519,10 @@ lde_nbr_del(struct lde_nbr *ln)
 			fnh->remote_label = NO_LABEL;
 		}
 	}
+	RB_FOREACH(lnbr, nbr_tree, &lde_nbrs)
+		if (ln->peerid != lnbr->peerid)
+			lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END,
+			    lnbr->peerid, 0, NULL, 0);
 
 	lde_address_list_free(ln);
 
@@ -1873,7 +1880,7 @@ lde_change_allocate_filter(int af)
 			if (new_label == NO_LABEL)
 				RB_FOREACH(ln, nbr_tree, &lde_nbrs)
 					lde_send_labelwithdraw(ln, fn,
-					    NULL, NULL);
+					    NULL, NULL, 0);
 
 			fn->local_label = new_label;
 			if (fn->local_label != NO_LABEL)
@@ -1881,9 +1888,12 @@ lde_change_allocate_filter(int af)
 					lde_send_labelmapping(ln, fn, 0);
 		}
 	}
-	RB_FOREACH(ln, nbr_tree, &lde_nbrs)
+	RB_FOREACH(ln, nbr_tree, &lde_nbrs) {
+		lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END, ln->peerid, 0,
+		    NULL, 0);
 		lde_imsg_compose_ldpe(IMSG_MAPPING_ADD_END, ln->peerid, 0,
 		    NULL, 0);
+	}
 }
 
 void
@@ -1947,11 +1957,13 @@ lde_change_advertise_filter(int af)
 					if (me)
 						/* fec filtered withdraw */
 						lde_send_labelwithdraw(ln, fn,
-						    NULL, NULL);
+						    NULL, NULL, 0);
 				} else
 					/* fec allowed send map */
 					lde_send_labelmapping(ln, fn, 0);
 			}
+			lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END,
+			    ln->peerid, 0, NULL, 0);
 			lde_imsg_compose_ldpe(IMSG_MAPPING_ADD_END,
 			    ln->peerid, 0, NULL, 0);
 		}
@@ -2482,7 +2494,7 @@ void lde_route_update_release(struct iface *iface, int af)
 
 			fnh->flags |= F_FEC_NH_NO_LDP;
 			RB_FOREACH(ln, nbr_tree, &lde_nbrs)
-				lde_send_labelwithdraw(ln, fn, NULL, NULL);
+				lde_send_labelwithdraw(ln, fn, NULL, NULL, 0);
 			lde_free_label(fn->local_label);
 			fn->local_label = NO_LABEL;
 			fn->local_label = lde_update_label(fn);
@@ -2492,9 +2504,12 @@ void lde_route_update_release(struct iface *iface, int af)
 			break;
 		}
 	}
-	RB_FOREACH(ln, nbr_tree, &lde_nbrs)
+	RB_FOREACH(ln, nbr_tree, &lde_nbrs) {
+		lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END, ln->peerid,
+		    0, NULL, 0);
 		lde_imsg_compose_ldpe(IMSG_MAPPING_ADD_END, ln->peerid,
 		    0, NULL, 0);
+	}
 }
 
 void lde_route_update_release_all(int af)
@@ -2525,11 +2540,14 @@ void lde_route_update_release_all(int af)
 		}
 
 		RB_FOREACH(ln, nbr_tree, &lde_nbrs)
-			lde_send_labelwithdraw(ln, fn, NULL, NULL);
+			lde_send_labelwithdraw(ln, fn, NULL, NULL, 0);
 
 		LIST_FOREACH(fnh, &fn->nexthops, entry) {
 			fnh->flags |= F_FEC_NH_NO_LDP;
 			lde_send_delete_klabel(fn, fnh);
 		}
 	}
+	RB_FOREACH(ln, nbr_tree, &lde_nbrs)
+		lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END, ln->peerid, 0,
+		    NULL, 0);
 }
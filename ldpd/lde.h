@@ -23,6 +23,7 @@
 
 #include "queue.h"
 #include "openbsd-tree.h"
+#include "typesafe.h"
 #include "if.h"
 
 enum fec_type {
@@ -117,8 +118,11 @@ struct fec_nh {
 #define F_FEC_NH_DEFER		0x04		/* running ordered control */
 #define F_FEC_NH_NO_LDP		0x08		/* no ldp on this interface */
 
+PREDECL_HASH(fec_hash);
+
 struct fec_node {
 	struct fec		 fec;
+	struct fec_hash_item	 hash_entry;	/* exact lookups in ft */
 
 	LIST_HEAD(, fec_nh)	 nexthops;	/* fib nexthops */
 	struct lde_map_head	 downstream;	/* recv mappings */
@@ -163,7 +167,7 @@ void		 lde_map2fec(struct map *, struct in_addr, struct fec *);
 void		 lde_send_labelmapping(struct lde_nbr *, struct fec_node *,
 		    int);
 void		 lde_send_labelwithdraw(struct lde_nbr *, struct fec_node *,
-		    struct map *, struct status_tlv *);
+		    struct map *, struct status_tlv *, int);
 void		 lde_send_labelwithdraw_wcard(struct lde_nbr *, uint32_t);
 void		 lde_send_labelwithdraw_twcard_prefix(struct lde_nbr *,
 		    uint16_t, uint32_t);
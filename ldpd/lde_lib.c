@@ -24,6 +24,7 @@
 #include "lde.h"
 #include "log.h"
 #include "rlfa.h"
+#include "jhash.h"
 
 #include "mpls.h"
 
@@ -38,7 +39,41 @@ static void		 fec_nh_del(struct fec_nh *);
 
 RB_GENERATE(fec_tree, fec, entry, fec_compare)
 
+static int
+fec_hash_cmp(const struct fec_node *a, const struct fec_node *b)
+{
+	return (fec_compare(&a->fec, &b->fec));
+}
+
+static uint32_t
+fec_hash_key(const struct fec_node *fn)
+{
+	const struct fec	*f = &fn->fec;
+
+	switch (f->type) {
+	case FEC_TYPE_IPV4:
+		return (jhash_2words(f->u.ipv4.prefix.s_addr,
+		    f->u.ipv4.prefixlen, f->type));
+	case FEC_TYPE_IPV6:
+		return (jhash(&f->u.ipv6.prefix, sizeof(struct in6_addr),
+		    f->u.ipv6.prefixlen));
+	case FEC_TYPE_PWID:
+		return (jhash_3words(f->u.pwid.type, f->u.pwid.pwid,
+		    f->u.pwid.lsr_id.s_addr, f->type));
+	}
+
+	return (0);
+}
+
+DECLARE_HASH(fec_hash, struct fec_node, hash_entry, fec_hash_cmp,
+    fec_hash_key);
+
 struct fec_tree		 ft = RB_INITIALIZER(&ft);
+/*
+ * Index of ft for exact lookups, done for every label message received.
+ * The tree is still needed for ordered walks.
+ */
+static struct fec_hash_head	 ft_hash = INIT_HASH(ft_hash);
 struct thread		*gc_timer;
 
 /* FEC tree functions */
@@ -105,6 +140,13 @@ fec_compare(const struct fec *a, const struct fec *b)
 struct fec *
 fec_find(struct fec_tree *fh, struct fec *f)
 {
+	struct fec_node		 key;
+
+	if (fh == &ft) {
+		key.fec = *f;
+		return ((struct fec *)fec_hash_find(&ft_hash, &key));
+	}
+
 	return (RB_FIND(fec_tree, fh, f));
 }
 
@@ -113,6 +155,9 @@ fec_insert(struct fec_tree *fh, struct fec *f)
 {
 	if (RB_INSERT(fec_tree, fh, f) != NULL)
 		return (-1);
+	/* ft only holds fec nodes */
+	if (fh == &ft)
+		fec_hash_add(&ft_hash, (struct fec_node *)f);
 	return (0);
 }
 
@@ -123,6 +168,8 @@ fec_remove(struct fec_tree *fh, struct fec *f)
 		log_warnx("%s failed for %s", __func__, log_fec(f));
 		return (-1);
 	}
+	if (fh == &ft)
+		fec_hash_del(&ft_hash, (struct fec_node *)f);
 	return (0);
 }
 
@@ -423,7 +470,7 @@ lde_kernel_update(struct fec *fec)
 
 	if (LIST_EMPTY(&fn->nexthops)) {
 		RB_FOREACH(ln, nbr_tree, &lde_nbrs)
-			lde_send_labelwithdraw(ln, fn, NULL, NULL);
+			lde_send_labelwithdraw(ln, fn, NULL, NULL, 1);
 		fn->data = NULL;
 
 		/*
@@ -895,7 +942,8 @@ lde_check_withdraw(struct map *map, struct lde_nbr *ln)
 			 */
 			if (me && lde_nbr_is_nexthop(fn, lnbr))
 				/* LWd.11: send label withdraw */
-				lde_send_labelwithdraw(lnbr, fn, NULL, NULL);
+				lde_send_labelwithdraw(lnbr, fn, NULL, NULL,
+				    1);
 		}
 	}
 
@@ -985,10 +1033,14 @@ lde_check_withdraw_wcard(struct map *map, struct lde_nbr *ln)
 				if (me && lde_nbr_is_nexthop(fn, lnbr))
 					/* LWd.11: send label withdraw */
 					lde_send_labelwithdraw(lnbr, fn, NULL,
-					    NULL);
+					    NULL, 0);
 			}
 		}
 	}
+	RB_FOREACH(lnbr, nbr_tree, &lde_nbrs)
+		if (ln->peerid != lnbr->peerid)
+			lde_imsg_compose_ldpe(IMSG_WITHDRAW_ADD_END,
+			    lnbr->peerid, 0, NULL, 0);
 }
 
 int
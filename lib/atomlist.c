@@ -21,6 +21,10 @@
 #include <assert.h>
 
 #include "atomlist.h"
+#include "frrcu.h"
+#include "memory.h"
+
+DEFINE_MTYPE_STATIC(LIB, RCUHASH, "RCU hash table");
 
 void atomlist_add_head(struct atomlist_head *h, struct atomlist_item *item)
 {
@@ -348,3 +352,197 @@ struct atomsort_item *atomsort_pop(struct atomsort_head *h)
 	atomsort_del_core(h, item, &h->first, next);
 	return item;
 }
+
+/* RCU hash:  open addressing with linear probing.  Deleted slots get the
+ * tombstone below (so readers keep probing past them) until the next
+ * rebuild.  Tables are rebuilt (and the old one RCU-freed) when over half
+ * the slots are in use or when under 1/8 of them hold items.
+ */
+struct rcuhash_table {
+	struct rcu_head rcu_head;
+
+	uint32_t size;
+	/* items + tombstones */
+	uint32_t used;
+
+	atomic_atomptr_t slots[0];
+};
+
+#define RCUHASH_MINSIZE 8
+
+static struct rcuhash_item rcuhash_dead;
+
+static struct rcuhash_table *rcuhash_tab(const struct rcuhash_head *h)
+{
+	return atomptr_p(atomic_load_explicit(
+		&((struct rcuhash_head *)h)->tab, memory_order_acquire));
+}
+
+static struct rcuhash_item *rcuhash_slot(struct rcuhash_table *tab,
+					 uint32_t i)
+{
+	return atomptr_p(
+		atomic_load_explicit(&tab->slots[i], memory_order_acquire));
+}
+
+static void rcuhash_put(struct rcuhash_table *tab, struct rcuhash_item *item)
+{
+	uint32_t mask = tab->size - 1, i = item->hashval & mask;
+	struct rcuhash_item *cur;
+
+	while ((cur = rcuhash_slot(tab, i)) && cur != &rcuhash_dead)
+		i = (i + 1) & mask;
+
+	if (!cur)
+		tab->used++;
+	atomic_store_explicit(&tab->slots[i], atomptr_i(item),
+			      memory_order_release);
+}
+
+static struct rcuhash_table *rcuhash_rebuild(struct rcuhash_head *h,
+					     struct rcuhash_table *old,
+					     size_t count)
+{
+	struct rcuhash_table *tab;
+	struct rcuhash_item *item;
+	uint32_t size = RCUHASH_MINSIZE, i;
+
+	while (size < count * 4)
+		size <<= 1;
+
+	tab = XCALLOC(MTYPE_RCUHASH, sizeof(*tab) + size * sizeof(tab->slots[0]));
+	tab->size = size;
+
+	if (old)
+		for (i = 0; i < old->size; i++) {
+			item = rcuhash_slot(old, i);
+			if (item && item != &rcuhash_dead)
+				rcuhash_put(tab, item);
+		}
+
+	atomic_store_explicit(&h->tab, atomptr_i(tab), memory_order_release);
+	if (old)
+		rcu_free(MTYPE_RCUHASH, old, rcu_head);
+	return tab;
+}
+
+static const struct rcuhash_item *
+rcuhash_lookup(struct rcuhash_table *tab, uint32_t hashval,
+	       const struct rcuhash_item *ref, rcuhash_cmpfn cmpfn)
+{
+	uint32_t mask = tab->size - 1, i = hashval & mask;
+	struct rcuhash_item *cur;
+
+	for (; (cur = rcuhash_slot(tab, i)); i = (i + 1) & mask)
+		if (cur != &rcuhash_dead && cur->hashval == hashval
+		    && !cmpfn(cur, ref))
+			return cur;
+	return NULL;
+}
+
+/* slot holding item, or -1 */
+static int64_t rcuhash_index(struct rcuhash_table *tab,
+			     const struct rcuhash_item *item)
+{
+	uint32_t mask = tab->size - 1, i = item->hashval & mask;
+	struct rcuhash_item *cur;
+
+	for (; (cur = rcuhash_slot(tab, i)); i = (i + 1) & mask)
+		if (cur == item)
+			return i;
+	return -1;
+}
+
+struct rcuhash_item *rcuhash_add(struct rcuhash_head *h,
+				 struct rcuhash_item *item,
+				 rcuhash_cmpfn cmpfn)
+{
+	struct rcuhash_table *tab = rcuhash_tab(h);
+	const struct rcuhash_item *prev;
+	size_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+
+	if (tab) {
+		prev = rcuhash_lookup(tab, item->hashval, item, cmpfn);
+		if (prev)
+			return (struct rcuhash_item *)prev;
+	}
+
+	if (!tab || (tab->used + 1) * 2 > tab->size)
+		tab = rcuhash_rebuild(h, tab, count + 1);
+
+	rcuhash_put(tab, item);
+	atomic_store_explicit(&h->count, count + 1, memory_order_relaxed);
+	return NULL;
+}
+
+const struct rcuhash_item *rcuhash_find(const struct rcuhash_head *h,
+					uint32_t hashval,
+					const struct rcuhash_item *ref,
+					rcuhash_cmpfn cmpfn)
+{
+	struct rcuhash_table *tab = rcuhash_tab(h);
+
+	if (!tab)
+		return NULL;
+	return rcuhash_lookup(tab, hashval, ref, cmpfn);
+}
+
+struct rcuhash_item *rcuhash_del(struct rcuhash_head *h,
+				 struct rcuhash_item *item)
+{
+	struct rcuhash_table *tab = rcuhash_tab(h);
+	size_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+	int64_t i;
+
+	if (!tab)
+		return NULL;
+
+	i = rcuhash_index(tab, item);
+	if (i < 0)
+		return NULL;
+
+	atomic_store_explicit(&tab->slots[i], atomptr_i(&rcuhash_dead),
+			      memory_order_release);
+	atomic_store_explicit(&h->count, --count, memory_order_relaxed);
+
+	if (tab->size > RCUHASH_MINSIZE && count * 8 < tab->size)
+		rcuhash_rebuild(h, tab, count);
+	return item;
+}
+
+const struct rcuhash_item *rcuhash_next(const struct rcuhash_head *h,
+					const struct rcuhash_item *prev)
+{
+	struct rcuhash_table *tab = rcuhash_tab(h);
+	struct rcuhash_item *cur;
+	uint32_t i = 0;
+	int64_t idx;
+
+	if (!tab)
+		return NULL;
+
+	if (prev) {
+		/* prev may have been deleted or moved to another table in the
+		 * meantime;  continue from where it would have been then.
+		 */
+		idx = rcuhash_index(tab, prev);
+		i = (idx < 0 ? prev->hashval & (tab->size - 1) : idx) + 1;
+	}
+
+	for (; i < tab->size; i++) {
+		cur = rcuhash_slot(tab, i);
+		if (cur && cur != &rcuhash_dead)
+			return cur;
+	}
+	return NULL;
+}
+
+void rcuhash_fini(struct rcuhash_head *h)
+{
+	struct rcuhash_table *tab = rcuhash_tab(h);
+
+	assert(atomic_load_explicit(&h->count, memory_order_relaxed) == 0);
+
+	atomic_store_explicit(&h->tab, ATOMPTR_NULL, memory_order_relaxed);
+	XFREE(MTYPE_RCUHASH, tab);
+}
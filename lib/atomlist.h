@@ -367,6 +367,125 @@ void atomsort_del_hint(struct atomsort_head *h,
 
 struct atomsort_item *atomsort_pop(struct atomsort_head *h);
 
+
+/* hash table for lookups through RCU, e.g. from other pthreads
+ *
+ * - find(), first() and next() may be called from any number of threads
+ *   concurrently without locking, as long as they hold rcu_read_lock()
+ *   (which the main pthread always does outside of thread_fetch().)  An item
+ *   returned from find() remains valid until rcu_read_unlock().
+ * - add(), del() and pop() must not run concurrently with each other;  run
+ *   them only on one pthread or under a lock.  They update the table in
+ *   place where that is atomic for readers and otherwise publish a new table
+ *   and free the old one through RCU.
+ * - items readers might still be looking at must be freed through RCU too,
+ *   i.e. with rcu_free() after del().
+ * - iterating while the table changes may miss items or see them twice.
+ * - fini() requires the table to be empty and no readers left.
+ */
+
+/* don't use these structs directly */
+struct rcuhash_item {
+	uint32_t hashval;
+};
+
+struct rcuhash_head {
+	/* struct rcuhash_table * */
+	atomic_atomptr_t tab;
+	atomic_size_t count;
+};
+
+typedef int (*rcuhash_cmpfn)(const struct rcuhash_item *,
+			     const struct rcuhash_item *);
+
+extern struct rcuhash_item *rcuhash_add(struct rcuhash_head *h,
+					struct rcuhash_item *item,
+					rcuhash_cmpfn cmpfn);
+extern const struct rcuhash_item *
+rcuhash_find(const struct rcuhash_head *h, uint32_t hashval,
+	     const struct rcuhash_item *ref, rcuhash_cmpfn cmpfn);
+extern struct rcuhash_item *rcuhash_del(struct rcuhash_head *h,
+					struct rcuhash_item *item);
+extern const struct rcuhash_item *
+rcuhash_next(const struct rcuhash_head *h, const struct rcuhash_item *prev);
+extern void rcuhash_fini(struct rcuhash_head *h);
+
+#define PREDECL_RCUHASH(prefix)                                                \
+struct prefix ## _head { struct rcuhash_head rh; };                            \
+struct prefix ## _item { struct rcuhash_item ri; };                            \
+MACRO_REQUIRE_SEMICOLON() /* end */
+
+#define INIT_RCUHASH(var) { }
+
+#define DECLARE_RCUHASH(prefix, type, field, cmpfn, hashfn)                    \
+                                                                               \
+macro_inline int prefix ## __cmp(const struct rcuhash_item *a,                 \
+		const struct rcuhash_item *b)                                  \
+{                                                                              \
+	return cmpfn(container_of(a, type, field.ri),                          \
+			container_of(b, type, field.ri));                      \
+}                                                                              \
+macro_inline void prefix ## _init(struct prefix##_head *h)                     \
+{                                                                              \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline void prefix ## _fini(struct prefix##_head *h)                     \
+{                                                                              \
+	rcuhash_fini(&h->rh);                                                  \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline type *prefix ## _add(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	struct rcuhash_item *p;                                                \
+	item->field.ri.hashval = hashfn(item);                                 \
+	p = rcuhash_add(&h->rh, &item->field.ri, prefix ## __cmp);             \
+	return container_of_null(p, type, field.ri);                           \
+}                                                                              \
+macro_inline const type *prefix ## _const_find(const struct prefix##_head *h,  \
+					       const type *item)               \
+{                                                                              \
+	const struct rcuhash_item *p;                                          \
+	p = rcuhash_find(&h->rh, hashfn(item), &item->field.ri,                \
+			 prefix ## __cmp);                                     \
+	return container_of_null(p, type, field.ri);                           \
+}                                                                              \
+TYPESAFE_FIND(prefix, type)                                                    \
+macro_inline type *prefix ## _del(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	struct rcuhash_item *p = rcuhash_del(&h->rh, &item->field.ri);         \
+	return container_of_null(p, type, field.ri);                           \
+}                                                                              \
+macro_pure const type *prefix ## _const_first(const struct prefix##_head *h)   \
+{                                                                              \
+	const struct rcuhash_item *p = rcuhash_next(&h->rh, NULL);             \
+	return container_of_null(p, type, field.ri);                           \
+}                                                                              \
+macro_pure const type *prefix ## _const_next(const struct prefix##_head *h,    \
+					     const type *item)                 \
+{                                                                              \
+	const struct rcuhash_item *p = rcuhash_next(&h->rh, &item->field.ri);  \
+	return container_of_null(p, type, field.ri);                           \
+}                                                                              \
+TYPESAFE_FIRST_NEXT(prefix, type)                                              \
+macro_pure type *prefix ## _next_safe(struct prefix##_head *h, type *item)     \
+{                                                                              \
+	if (!item)                                                             \
+		return NULL;                                                   \
+	return prefix ## _next(h, item);                                       \
+}                                                                              \
+macro_inline type *prefix ## _pop(struct prefix##_head *h)                     \
+{                                                                              \
+	type *item = prefix ## _first(h);                                      \
+	if (item)                                                              \
+		prefix ## _del(h, item);                                       \
+	return item;                                                           \
+}                                                                              \
+macro_pure size_t prefix ## _count(const struct prefix##_head *h)              \
+{                                                                              \
+	return atomic_load_explicit(&h->rh.count, memory_order_relaxed);       \
+}                                                                              \
+MACRO_REQUIRE_SEMICOLON() /* end */
+
 #ifdef __cplusplus
 }
 #endif
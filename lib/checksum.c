@@ -9,18 +9,10 @@
 #include <zebra.h>
 #include "checksum.h"
 
-#define add_carry(dst, add)                                                    \
-	do {                                                                   \
-		typeof(dst) _add = (add);                                      \
-		dst += _add;                                                   \
-		if (dst < _add)                                                \
-			dst++;                                                 \
-	} while (0)
-
 uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 {
 	const struct iovec *iov_end;
-	uint32_t sum = 0;
+	uint64_t sum = 0;
 
 	union {
 		uint8_t bytes[2];
@@ -29,9 +21,13 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 	bool have_oddbyte = false;
 
 	/*
-	 * Our algorithm is simple, using a 32-bit accumulator (sum),
-	 * we add sequential 16-bit words to it, and at the end, fold back
-	 * all the carry bits from the top 16 bits into the lower 16 bits.
+	 * Our algorithm is simple, using a 64-bit accumulator (sum),
+	 * we add sequential 32-bit words to it, and at the end, fold back
+	 * all the carry bits from the top into the lower 16 bits.  The
+	 * ones' complement sum doesn't care about the word size, and with
+	 * 64 bits the accumulator can't overflow here, so the adds are
+	 * independent of each other and there is no carry handling in the
+	 * loop.
 	 */
 
 	for (iov_end = iov + iov_len; iov < iov_end; iov++) {
@@ -46,17 +42,24 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 			have_oddbyte = false;
 			wordbuf.bytes[1] = *ptr++;
 
-			add_carry(sum, wordbuf.word);
+			sum += wordbuf.word;
+		}
+
+		while (ptr + 16 <= end) {
+			sum += *(const uint32_t *)(ptr + 0);
+			sum += *(const uint32_t *)(ptr + 4);
+			sum += *(const uint32_t *)(ptr + 8);
+			sum += *(const uint32_t *)(ptr + 12);
+			ptr += 16;
 		}
 
-		while (ptr + 8 <= end) {
-			add_carry(sum, *(const uint32_t *)(ptr + 0));
-			add_carry(sum, *(const uint32_t *)(ptr + 4));
-			ptr += 8;
+		while (ptr + 4 <= end) {
+			sum += *(const uint32_t *)ptr;
+			ptr += 4;
 		}
 
 		while (ptr + 2 <= end) {
-			add_carry(sum, *(const uint16_t *)ptr);
+			sum += *(const uint16_t *)ptr;
 			ptr += 2;
 		}
 
@@ -69,21 +72,38 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 	/* mop up an odd byte, if necessary */
 	if (have_oddbyte) {
 		wordbuf.bytes[1] = 0;
-		add_carry(sum, wordbuf.word);
+		sum += wordbuf.word;
 	}
 
 	/*
 	 * Add back carry outs from top 16 bits to low 16 bits.
 	 */
 
-	sum = (sum >> 16) + (sum & 0xffff); /* add high-16 to low-16 */
-	sum += (sum >> 16);		    /* add carry */
+	sum = (sum >> 32) + (sum & 0xffffffff); /* add high-32 to low-32 */
+	sum = (sum >> 32) + (sum & 0xffffffff); /* add carry */
+	sum = (sum >> 16) + (sum & 0xffff);	/* add high-16 to low-16 */
+	sum = (sum >> 16) + (sum & 0xffff);	/* add carry */
 	return ~sum;
 }
 
 /* Fletcher Checksum -- Refer to RFC1008. */
 #define MODX                 4102U   /* 5802 should be fine */
 
+/*
+ * Bytes processed side by side in fletcher_checksum().  The plain loop
+ * (c0 += byte; c1 += c0) is one long dependency chain.  Instead, each of
+ * FLETCHER_LANES columns sums up its own bytes (a[]) and the running totals
+ * of those (pa[]), which works out to the same c0 and c1 at the end of a
+ * run of rows:
+ *
+ *   c0 += sum(a)
+ *   c1 += rows * LANES * c0 + LANES * sum(pa) + sum((LANES - i) * a[i])
+ *
+ * The columns are independent adds that the compiler can vectorize.  All
+ * of this stays below 2^32 within MODX bytes.
+ */
+#define FLETCHER_LANES       16
+
 /* To be consistent, offset is 0-based index, rather than the 1-based
    index required in the specification ISO 8473, Annex C.1 */
 /* calling with offset == FLETCHER_CHECKSUM_VALIDATE will validate the checksum
@@ -92,7 +112,8 @@ uint16_t fletcher_checksum(uint8_t *buffer, const size_t len,
 			   const uint16_t offset)
 {
 	uint8_t *p;
-	int x, y, c0, c1;
+	int x, y;
+	uint32_t c0, c1;
 	uint16_t checksum = 0;
 	uint16_t *csum;
 	size_t partial_len, i, left = len;
@@ -112,6 +133,29 @@ uint16_t fletcher_checksum(uint8_t *buffer, const size_t len,
 
 	while (left != 0) {
 		partial_len = MIN(left, MODX);
+		left -= partial_len;
+
+		if (partial_len >= FLETCHER_LANES) {
+			uint32_t a[FLETCHER_LANES] = {}, pa[FLETCHER_LANES] = {};
+			uint32_t rows = 0, sum_a = 0, sum_pa = 0, sum_w = 0;
+
+			for (; partial_len >= FLETCHER_LANES;
+			     partial_len -= FLETCHER_LANES,
+			     p += FLETCHER_LANES, rows++)
+				for (i = 0; i < FLETCHER_LANES; i++) {
+					pa[i] += a[i];
+					a[i] += p[i];
+				}
+
+			for (i = 0; i < FLETCHER_LANES; i++) {
+				sum_a += a[i];
+				sum_pa += pa[i];
+				sum_w += (FLETCHER_LANES - i) * a[i];
+			}
+			c1 += rows * FLETCHER_LANES * c0
+			      + FLETCHER_LANES * sum_pa + sum_w;
+			c0 += sum_a;
+		}
 
 		for (i = 0; i < partial_len; i++) {
 			c0 = c0 + *(p++);
@@ -120,8 +164,6 @@ uint16_t fletcher_checksum(uint8_t *buffer, const size_t len,
 
 		c0 = c0 % 255;
 		c1 = c1 % 255;
-
-		left -= partial_len;
 	}
 
 	/* The cast is important, to ensure the mod is taken as a signed value.
@@ -333,6 +333,7 @@ void _install_element(enum node_type ntype, const struct cmd_element *cmd)
 		cmd_graph_names(graph);
 		cmd_graph_merge(cnode->cmdgraph, graph, +1);
 		graph_delete_graph(graph);
+		command_match_cache_flush();
 
 		cnode->graph_built = true;
 	}
@@ -357,6 +358,7 @@ static void cmd_finalize_iter(struct hash_bucket *hb, void *arg)
 	cmd_graph_names(graph);
 	cmd_graph_merge(cnode->cmdgraph, graph, +1);
 	graph_delete_graph(graph);
+	command_match_cache_flush();
 }
 
 void cmd_finalize_node(struct cmd_node *cnode)
@@ -412,6 +414,7 @@ void uninstall_element(enum node_type ntype, const struct cmd_element *cmd)
 		cmd_graph_names(graph);
 		cmd_graph_merge(cnode->cmdgraph, graph, -1);
 		graph_delete_graph(graph);
+		command_match_cache_flush();
 	}
 
 	if (ntype == VIEW_NODE)
@@ -515,6 +518,12 @@ static int config_write_host(struct vty *vty)
 			vty_out(vty, "service walltime-warning %lu\n",
 				walltime_threshold);
 
+		if (!lag_threshold)
+			vty_out(vty, "no service starvation-warning\n");
+		else if (lag_threshold != 4000000)
+			vty_out(vty, "service starvation-warning %lu\n",
+				lag_threshold / 1000);
+
 		if (host.advanced)
 			vty_out(vty, "service advanced-vty\n");
 
@@ -2595,6 +2604,8 @@ void cmd_terminate(void)
 	hook_unregister(cmd_execute, handle_pipe_action);
 	hook_unregister(cmd_execute_done, handle_pipe_action_done);
 
+	command_match_cache_flush();
+
 	if (cmdvec) {
 		for (unsigned int i = 0; i < vector_active(cmdvec); i++)
 			if ((cmd_node = vector_slot(cmdvec, i)) != NULL) {
@@ -31,6 +31,7 @@ DEFINE_MTYPE_STATIC(LIB, CMD_DESC, "Command Token Text");
 DEFINE_MTYPE_STATIC(LIB, CMD_TEXT, "Command Token Help");
 DEFINE_MTYPE(LIB, CMD_ARG, "Command Argument");
 DEFINE_MTYPE_STATIC(LIB, CMD_VAR, "Command Argument Name");
+DEFINE_MTYPE(LIB, CMD_MATCHNEXT, "Command Match Index");
 
 struct cmd_token *cmd_token_new(enum cmd_token_type type, uint8_t attr,
 				const char *text, const char *desc)
@@ -58,6 +59,8 @@ void cmd_token_del(struct cmd_token *token)
 	XFREE(MTYPE_CMD_DESC, token->desc);
 	XFREE(MTYPE_CMD_ARG, token->arg);
 	XFREE(MTYPE_CMD_VAR, token->varname);
+	XFREE(MTYPE_CMD_MATCHNEXT, token->matchnext[0]);
+	XFREE(MTYPE_CMD_MATCHNEXT, token->matchnext[1]);
 
 	XFREE(MTYPE_CMD_TOKENS, token);
 }
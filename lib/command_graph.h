@@ -38,6 +38,7 @@ extern "C" {
 #endif
 
 DECLARE_MTYPE(CMD_ARG);
+DECLARE_MTYPE(CMD_MATCHNEXT);
 
 struct vty;
 
@@ -87,6 +88,8 @@ enum varname_src {
 	VARNAME_EXPLICIT,
 };
 
+struct cmd_match_next;
+
 /* Command token struct. */
 struct cmd_token {
 	enum cmd_token_type type; // token type
@@ -102,6 +105,10 @@ struct cmd_token {
 	char *varname;
 
 	struct graph_node *forkjoin; // paired FORK/JOIN for JOIN/FORK
+
+	// matcher index of following nodes, [1] for "no ..." input
+	struct cmd_match_next *matchnext[2];
+	uint32_t matchgen;
 };
 
 /* Structure of command element. */
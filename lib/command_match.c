@@ -25,8 +25,11 @@
 
 #include "command_match.h"
 #include "memory.h"
+#include "typesafe.h"
+#include "jhash.h"
 
 DEFINE_MTYPE_STATIC(LIB, CMD_MATCHSTACK, "Command Match Stack");
+DEFINE_MTYPE_STATIC(LIB, CMD_MATCHCACHE, "Command Match Cache");
 
 #ifdef TRACE_MATCHER
 #define TM 1
@@ -44,9 +47,12 @@ DEFINE_MTYPE_STATIC(LIB, CMD_MATCHSTACK, "Command Match Stack");
 static int add_nexthops(struct list *, struct graph_node *,
 			struct graph_node **, size_t, bool);
 
+struct cmd_match_trace;
+
 static enum matcher_rv command_match_r(struct graph_node *, vector,
 				       unsigned int, struct graph_node **,
-				       struct list **);
+				       struct list **,
+				       struct cmd_match_trace *);
 
 static int score_precedence(enum cmd_token_type);
 
@@ -86,13 +92,415 @@ static bool is_neg(vector vline, size_t idx)
 	return !strcmp(vector_slot(vline, idx), "no");
 }
 
+
+/*
+ * Cache of matched command "shapes".
+ *
+ * Large configs consist mostly of lines that differ only in numbers and
+ * addresses ("ip prefix-list X seq 5 permit 10.0.0.0/8", and so on).  The
+ * shape of a line is the line with each word that starts with a digit
+ * replaced by the set of address types (IPV4_TKN, IPV6_PREFIX_TKN, ...)
+ * it is valid for;  all other words are kept as they are.
+ *
+ * For any given shape, all tokens except RANGE_TKN and keywords starting
+ * with a digit match the same way, so a full graph walk would take the same
+ * path up to the effect of those two.  When caching the result of a walk,
+ * make sure that the only such tokens tried at any replaced position are
+ * the ones on the matched path;  on a cache hit, the path's tokens at the
+ * replaced positions are then checked against the new words, and if they
+ * still match the result is the same as the full walk's.
+ */
+#define CMD_MATCH_CACHE_MAX	2048
+#define CMD_MATCH_KEY_MAX	1024
+#define CMD_MATCH_TRACE_MAX	16
+
+struct cmd_match_trace {
+	/* indexes into vvline, i.e. including the dummy start word */
+	bool replaced[CMD_ARGC_MAX];
+
+	unsigned int count;
+	bool overflow;
+	struct {
+		unsigned int n;
+		struct cmd_token *token;
+	} rec[CMD_MATCH_TRACE_MAX];
+};
+
+PREDECL_HASH(cmd_match_cache);
+
+struct cmd_match_shape {
+	struct cmd_match_cache_item itm;
+
+	const struct graph *graph;
+	char *key;
+	uint32_t hash;
+
+	/* NULL if this shape can't be served from the cache */
+	const struct cmd_element *el;
+	unsigned int argc;
+	struct cmd_token **tokens;
+};
+
+static int cmd_match_shape_cmp(const struct cmd_match_shape *a,
+			       const struct cmd_match_shape *b)
+{
+	if (a->graph != b->graph)
+		return a->graph < b->graph ? -1 : 1;
+	return strcmp(a->key, b->key);
+}
+
+static uint32_t cmd_match_shape_hash(const struct cmd_match_shape *shape)
+{
+	return shape->hash;
+}
+
+DECLARE_HASH(cmd_match_cache, struct cmd_match_shape, itm,
+	     cmd_match_shape_cmp, cmd_match_shape_hash);
+
+static struct cmd_match_cache_head cmd_match_cache[1] = {
+	INIT_HASH(cmd_match_cache[0]),
+};
+
+static void cmd_match_shape_clear(struct cmd_match_shape *shape)
+{
+	for (unsigned int i = 0; i < shape->argc; i++)
+		cmd_token_del(shape->tokens[i]);
+	XFREE(MTYPE_CMD_MATCHCACHE, shape->tokens);
+	shape->argc = 0;
+	shape->el = NULL;
+}
+
+/*
+ * Per-node index of the nodes that can follow it, i.e. what add_nexthops()
+ * returns.  Keywords are kept sorted so that only those the next input word
+ * is a prefix of need to be tried;  END_TKN nodes are only relevant at the
+ * end of input.  Built on first use, rebuilt after the graph changes and
+ * freed along with the token.
+ */
+struct cmd_match_next {
+	unsigned int nends, nwords, nothers;
+
+	struct graph_node **ends;
+	/* WORD_TKN, sorted by text */
+	struct graph_node **words;
+	/* all other types */
+	struct graph_node **others;
+
+	struct graph_node *nodes[0];
+};
+
+static uint32_t cmd_match_generation = 1;
+
+static int cmd_match_word_cmp(const void *a, const void *b)
+{
+	const struct graph_node *const *ga = a, *const *gb = b;
+	const struct cmd_token *ta = (*ga)->data, *tb = (*gb)->data;
+
+	return strcmp(ta->text, tb->text);
+}
+
+static struct cmd_match_next *cmd_match_next_get(struct graph_node *node,
+						 bool neg)
+{
+	struct cmd_token *token = node->data, *tok;
+	struct cmd_match_next *next;
+	struct list *list;
+	struct listnode *ln;
+	struct graph_node *gn;
+
+	if (token->matchgen != cmd_match_generation) {
+		XFREE(MTYPE_CMD_MATCHNEXT, token->matchnext[0]);
+		XFREE(MTYPE_CMD_MATCHNEXT, token->matchnext[1]);
+		token->matchgen = cmd_match_generation;
+	}
+
+	if (token->matchnext[neg])
+		return token->matchnext[neg];
+
+	list = list_new();
+	add_nexthops(list, node, NULL, 0, neg);
+
+	next = XCALLOC(MTYPE_CMD_MATCHNEXT,
+		       sizeof(*next) + list->count * sizeof(next->nodes[0]));
+	for (ALL_LIST_ELEMENTS_RO(list, ln, gn)) {
+		tok = gn->data;
+		if (tok->type == END_TKN)
+			next->nends++;
+		else if (tok->type == WORD_TKN)
+			next->nwords++;
+		else
+			next->nothers++;
+	}
+	next->ends = next->nodes;
+	next->words = next->ends + next->nends;
+	next->others = next->words + next->nwords;
+
+	next->nends = next->nwords = next->nothers = 0;
+	for (ALL_LIST_ELEMENTS_RO(list, ln, gn)) {
+		tok = gn->data;
+		if (tok->type == END_TKN)
+			next->ends[next->nends++] = gn;
+		else if (tok->type == WORD_TKN)
+			next->words[next->nwords++] = gn;
+		else
+			next->others[next->nothers++] = gn;
+	}
+	list_delete(&list);
+
+	qsort(next->words, next->nwords, sizeof(next->words[0]),
+	      cmd_match_word_cmp);
+
+	token->matchnext[neg] = next;
+	return next;
+}
+
+/* range of keywords in next->words that input may (partially) match */
+static void cmd_match_next_words(struct cmd_match_next *next,
+				 const char *input, unsigned int *startp,
+				 unsigned int *endp)
+{
+	const char *from = input, *to = NULL;
+	unsigned int lo, hi, mid, start;
+	const struct cmd_token *tok;
+	size_t len;
+
+	if (!input) {
+		*startp = 0;
+		*endp = next->nwords;
+		return;
+	}
+
+	/* match tracing wants to see all keywords starting with a digit */
+	if (isdigit((unsigned char)input[0])) {
+		from = "0";
+		to = ":";
+	}
+
+	lo = 0;
+	hi = next->nwords;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		tok = next->words[mid]->data;
+		if (strcmp(tok->text, from) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	start = lo;
+
+	if (to) {
+		hi = next->nwords;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			tok = next->words[mid]->data;
+			if (strcmp(tok->text, to) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+	} else {
+		len = strlen(from);
+		while (lo < next->nwords) {
+			tok = next->words[lo]->data;
+			if (strncmp(tok->text, from, len))
+				break;
+			lo++;
+		}
+	}
+
+	*startp = start;
+	*endp = lo;
+}
+
+void command_match_cache_flush(void)
+{
+	struct cmd_match_shape *shape;
+
+	cmd_match_generation++;
+
+	while ((shape = cmd_match_cache_pop(cmd_match_cache))) {
+		cmd_match_shape_clear(shape);
+		XFREE(MTYPE_CMD_MATCHCACHE, shape->key);
+		XFREE(MTYPE_CMD_MATCHCACHE, shape);
+	}
+}
+
+static bool cmd_match_shape_key(vector vline, char *key,
+				struct cmd_match_trace *trace)
+{
+	size_t pos = 0, len;
+	unsigned int i;
+	char *word;
+	uint8_t types;
+
+	if (vector_active(vline) + 1 >= CMD_ARGC_MAX)
+		return false;
+	trace->replaced[0] = false;
+
+	for (i = 0; i < vector_active(vline); i++) {
+		word = vector_slot(vline, i);
+		if (!word || word[0] == '\0')
+			return false;
+
+		if (!isdigit((unsigned char)word[0])) {
+			len = strlen(word);
+			if (pos + len + 2 > CMD_MATCH_KEY_MAX)
+				return false;
+			memcpy(key + pos, word, len);
+			pos += len;
+			key[pos++] = ' ';
+			trace->replaced[i + 1] = false;
+			continue;
+		}
+
+		types = 0;
+		if (match_ipv4(word) == exact_match)
+			types |= 1 << 0;
+		if (match_ipv4_prefix(word) == exact_match)
+			types |= 1 << 1;
+		if (match_ipv6_prefix(word, false) == exact_match)
+			types |= 1 << 2;
+		if (match_ipv6_prefix(word, true) == exact_match)
+			types |= 1 << 3;
+		if (match_mac(word, false) == exact_match)
+			types |= 1 << 4;
+		if (match_mac(word, true) == exact_match)
+			types |= 1 << 5;
+
+		if (pos + 3 > CMD_MATCH_KEY_MAX)
+			return false;
+		key[pos++] = '\001';
+		key[pos++] = '@' | types;
+		key[pos++] = ' ';
+		trace->replaced[i + 1] = true;
+	}
+	key[pos] = '\0';
+	return true;
+}
+
+/* tokens for which words of the same shape may match differently */
+static bool cmd_match_token_varies(const struct cmd_token *token)
+{
+	return token->type == RANGE_TKN
+	       || (token->type == WORD_TKN
+		   && isdigit((unsigned char)token->text[0]));
+}
+
+static void cmd_match_trace_add(struct cmd_match_trace *trace,
+				unsigned int n, struct cmd_token *token)
+{
+	for (unsigned int i = 0; i < trace->count; i++)
+		if (trace->rec[i].n == n && trace->rec[i].token == token)
+			return;
+
+	if (trace->count == CMD_MATCH_TRACE_MAX) {
+		trace->overflow = true;
+		return;
+	}
+	trace->rec[trace->count].n = n;
+	trace->rec[trace->count].token = token;
+	trace->count++;
+}
+
+static bool cmd_match_token_same(const struct cmd_token *a,
+				 const struct cmd_token *b)
+{
+	return a->type == b->type && a->min == b->min && a->max == b->max
+	       && !strcmp(a->text, b->text);
+}
+
+/* argv as returned by command_match(), i.e. without the dummy token */
+static void cmd_match_shape_set(struct cmd_match_shape *shape,
+				struct cmd_match_trace *trace,
+				struct list *argv,
+				const struct cmd_element *el)
+{
+	struct listnode *ln;
+	struct cmd_token *token;
+	unsigned int i = 0;
+
+	cmd_match_shape_clear(shape);
+	if (trace->overflow)
+		return;
+
+	shape->tokens = XCALLOC(MTYPE_CMD_MATCHCACHE,
+				argv->count * sizeof(shape->tokens[0]));
+	for (ALL_LIST_ELEMENTS_RO(argv, ln, token)) {
+		shape->tokens[i] = cmd_token_dup(token);
+		XFREE(MTYPE_CMD_ARG, shape->tokens[i]->arg);
+		i++;
+	}
+	shape->argc = i;
+
+	for (i = 0; i < trace->count; i++) {
+		unsigned int n = trace->rec[i].n;
+
+		if (n < 1 || n > shape->argc
+		    || !cmd_match_token_same(trace->rec[i].token,
+					     shape->tokens[n - 1])) {
+			cmd_match_shape_clear(shape);
+			return;
+		}
+	}
+	shape->el = el;
+}
+
+static bool cmd_match_shape_use(struct cmd_match_shape *shape, vector vline,
+				struct cmd_match_trace *trace,
+				struct list **argv)
+{
+	struct cmd_token *token, *copy;
+	unsigned int i;
+
+	if (shape->argc != vector_active(vline))
+		return false;
+
+	for (i = 0; i < shape->argc; i++) {
+		token = shape->tokens[i];
+		if (trace->replaced[i + 1]
+		    && match_token(token, vector_slot(vline, i))
+			       < min_match_level(token->type))
+			return false;
+	}
+
+	*argv = list_new();
+	(*argv)->del = (void (*)(void *))cmd_token_del;
+	for (i = 0; i < shape->argc; i++) {
+		copy = cmd_token_dup(shape->tokens[i]);
+		copy->arg = XSTRDUP(MTYPE_CMD_ARG, vector_slot(vline, i));
+		listnode_add(*argv, copy);
+	}
+	return true;
+}
+
 enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 			      struct list **argv, const struct cmd_element **el)
 {
 	struct graph_node *stack[CMD_ARGC_MAX];
 	enum matcher_rv status;
+	struct cmd_match_trace trace, *tracep = NULL;
+	struct cmd_match_shape ref = {}, *shape = NULL;
+	char key[CMD_MATCH_KEY_MAX];
 	*argv = NULL;
 
+	trace.count = 0;
+	trace.overflow = false;
+	if (cmd_match_shape_key(vline, key, &trace)) {
+		ref.graph = cmdgraph;
+		ref.key = key;
+		ref.hash = jhash(key, strlen(key), (uintptr_t)cmdgraph);
+		shape = cmd_match_cache_find(cmd_match_cache, &ref);
+
+		if (shape && shape->el
+		    && cmd_match_shape_use(shape, vline, &trace, argv)) {
+			*el = shape->el;
+			return MATCHER_OK;
+		}
+		/* known not to be cacheable, don't bother tracing again */
+		if (!shape || shape->el)
+			tracep = &trace;
+	}
+
 	// prepend a dummy token to match that pesky start node
 	vector vvline = vector_init(vline->alloced + 1);
 	vector_set_index(vvline, 0, XSTRDUP(MTYPE_TMP, "dummy"));
@@ -101,7 +509,7 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 	vvline->active = vline->active + 1;
 
 	struct graph_node *start = vector_slot(cmdgraph->nodes, 0);
-	status = command_match_r(start, vvline, 0, stack, argv);
+	status = command_match_r(start, vvline, 0, stack, argv, tracep);
 	if (status == MATCHER_OK) { // successful match
 		struct listnode *head = listhead(*argv);
 		struct listnode *tail = listtail(*argv);
@@ -121,6 +529,22 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 		// input, with each cmd_token->arg holding the corresponding
 		// input
 		assert(*el);
+
+		if (tracep) {
+			if (!shape) {
+				if (cmd_match_cache_count(cmd_match_cache)
+				    >= CMD_MATCH_CACHE_MAX)
+					command_match_cache_flush();
+
+				shape = XCALLOC(MTYPE_CMD_MATCHCACHE,
+						sizeof(*shape));
+				shape->graph = cmdgraph;
+				shape->key = XSTRDUP(MTYPE_CMD_MATCHCACHE, key);
+				shape->hash = ref.hash;
+				cmd_match_cache_add(cmd_match_cache, shape);
+			}
+			cmd_match_shape_set(shape, tracep, *argv, *el);
+		}
 	} else if (*argv) {
 		del_arglist(*argv);
 		*argv = NULL;
@@ -195,7 +619,8 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 				       unsigned int n,
 				       struct graph_node **stack,
-				       struct list **currbest)
+				       struct list **currbest,
+				       struct cmd_match_trace *trace)
 {
 	assert(n < vector_active(vline));
 
@@ -243,58 +668,69 @@ static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 	fprintf(stdout, "\n");
 #endif
 
+	if (trace && trace->replaced[n] && cmd_match_token_varies(token))
+		cmd_match_trace_add(trace, n, token);
+
 	// if we don't match this node, die
 	if (match_token(token, input_token) < minmatch)
 		return MATCHER_NO_MATCH;
 
 	stack[n] = start;
 
-	// pointers for iterating linklist
-	struct listnode *ln;
 	struct graph_node *gn;
+	unsigned int i, ncand, wstart = 0, wend = 0;
 
 	// get all possible nexthops
-	struct list *next = list_new();
-	add_nexthops(next, start, NULL, 0, is_neg(vline, 1));
+	struct cmd_match_next *next =
+		cmd_match_next_get(start, is_neg(vline, 1));
+
+	if (n + 1 == vector_active(vline))
+		ncand = next->nends;
+	else {
+		cmd_match_next_words(next, vector_slot(vline, n + 1), &wstart,
+				     &wend);
+		ncand = next->nothers + wend - wstart;
+	}
 
 	// determine the best match
-	for (ALL_LIST_ELEMENTS_RO(next, ln, gn)) {
+	for (i = 0; i < ncand; i++) {
 		// if we've matched all input we're looking for END_TKN
 		if (n + 1 == vector_active(vline)) {
-			struct cmd_token *tok = gn->data;
-			if (tok->type == END_TKN) {
-				// if more than one END_TKN in the follow set
-				if (*currbest) {
-					status = MATCHER_AMBIGUOUS;
-					break;
-				} else {
-					status = MATCHER_OK;
-				}
-				*currbest = list_new();
-				// node should have one child node with the
-				// element
-				struct graph_node *leaf =
-					vector_slot(gn->to, 0);
-				// last node in the list will hold the
-				// cmd_element; this is important because
-				// list_delete() expects that all nodes have
-				// the same data type, so when deleting this
-				// list the last node must be manually deleted
-				struct cmd_element *el = leaf->data;
-				listnode_add(*currbest, el);
-				(*currbest)->del =
-					(void (*)(void *)) & cmd_token_del;
-				// do not break immediately; continue walking
-				// through the follow set to ensure that there
-				// is exactly one END_TKN
+			gn = next->ends[i];
+			// if more than one END_TKN in the follow set
+			if (*currbest) {
+				status = MATCHER_AMBIGUOUS;
+				break;
+			} else {
+				status = MATCHER_OK;
 			}
+			*currbest = list_new();
+			// node should have one child node with the
+			// element
+			struct graph_node *leaf =
+				vector_slot(gn->to, 0);
+			// last node in the list will hold the
+			// cmd_element; this is important because
+			// list_delete() expects that all nodes have
+			// the same data type, so when deleting this
+			// list the last node must be manually deleted
+			struct cmd_element *el = leaf->data;
+			listnode_add(*currbest, el);
+			(*currbest)->del =
+				(void (*)(void *)) & cmd_token_del;
+			// do not break immediately; continue walking
+			// through the follow set to ensure that there
+			// is exactly one END_TKN
 			continue;
 		}
 
 		// else recurse on candidate child node
+		gn = i < next->nothers ? next->others[i]
+				       : next->words[wstart + i - next->nothers];
+
 		struct list *result = NULL;
-		enum matcher_rv rstat =
-			command_match_r(gn, vline, n + 1, stack, &result);
+		enum matcher_rv rstat = command_match_r(gn, vline, n + 1, stack,
+							&result, trace);
 
 		// save the best match
 		if (result && *currbest) {
@@ -340,9 +776,6 @@ static enum matcher_rv command_match_r(struct graph_node *start, vector vline,
 	} else if (n + 1 == vector_active(vline) && status == MATCHER_NO_MATCH)
 		status = MATCHER_INCOMPLETE;
 
-	// cleanup
-	list_delete(&next);
-
 	return status;
 }
 
@@ -102,6 +102,9 @@ enum matcher_rv command_match(struct graph *cmdgraph, vector vline,
 enum matcher_rv command_complete(struct graph *cmdgraph, vector vline,
 				 struct list **completions);
 
+/* drop cached match results, needed whenever a command graph changes */
+void command_match_cache_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
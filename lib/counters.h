@@ -0,0 +1,120 @@
+/*
+ * Single-writer counters with consistent snapshots
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_COUNTERS_H
+#define _FRR_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sched.h>
+
+#include "frratomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A group of statistics counters that only one pthread ever writes, but any
+ * pthread may read.  The writer uses plain (relaxed) loads and stores, so
+ * there are no locked instructions on the write side at all;  a sequence
+ * counter around each batch of updates lets readers get a snapshot where
+ * all the counters in the group belong together.
+ *
+ * The counters themselves must be _Atomic (for the memory model's sake, it
+ * compiles to normal loads and stores) and only be accessed with the
+ * counter_*() macros below.
+ *
+ * writer:
+ *	counters_write_begin(&stats->seq);
+ *	counter_add(stats->calls, 1);
+ *	counter_max(stats->max, val);
+ *	counters_write_end(&stats->seq);
+ *
+ * reader:
+ *	do {
+ *		seq = counters_read_begin(&stats->seq);
+ *		calls = counter_get(stats->calls);
+ *		max = counter_get(stats->max);
+ *	} while (counters_read_retry(&stats->seq, seq));
+ *
+ * Having 2 pthreads write the same group is a bug;  readers can spin
+ * forever if the sequence number ends up odd.
+ */
+
+struct counters_seq {
+	_Atomic uint32_t seq;
+};
+
+#define counter_get(ctr) atomic_load_explicit(&(ctr), memory_order_relaxed)
+
+#define counter_set(ctr, val)                                                  \
+	atomic_store_explicit(&(ctr), (val), memory_order_relaxed)
+
+#define counter_add(ctr, val) counter_set(ctr, counter_get(ctr) + (val))
+
+#define counter_or(ctr, val) counter_set(ctr, counter_get(ctr) | (val))
+
+#define counter_max(ctr, val)                                                  \
+	do {                                                                   \
+		typeof(val) _counter_val = (val);                              \
+		if (counter_get(ctr) < _counter_val)                           \
+			counter_set(ctr, _counter_val);                        \
+	} while (0)
+
+static inline void counters_write_begin(struct counters_seq *cs)
+{
+	uint32_t seq = atomic_load_explicit(&cs->seq, memory_order_relaxed);
+
+	atomic_store_explicit(&cs->seq, seq + 1, memory_order_relaxed);
+	/* counter stores must not become visible before the odd seq */
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void counters_write_end(struct counters_seq *cs)
+{
+	uint32_t seq = atomic_load_explicit(&cs->seq, memory_order_relaxed);
+
+	atomic_store_explicit(&cs->seq, seq + 1, memory_order_release);
+}
+
+static inline uint32_t counters_read_begin(struct counters_seq *cs)
+{
+	uint32_t seq;
+
+	while ((seq = atomic_load_explicit(&cs->seq, memory_order_acquire))
+	       & 1)
+		sched_yield();
+	return seq;
+}
+
+/* true if the writer got in between and the values must be read again */
+static inline bool counters_read_retry(struct counters_seq *cs, uint32_t seq)
+{
+	/* counter loads must be done before checking seq again */
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&cs->seq, memory_order_relaxed) != seq;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_COUNTERS_H */
@@ -475,10 +475,8 @@ static bool prune_edge(const struct c_path *path, const struct ls_edge *edge,
  *
  * @param algo	CSPF structure
  * @param edge	Next Edge to be added to the current computed path
- *
- * @return	True if current path reach destination, false otherwise
  */
-static bool relax_constraints(struct cspf *algo, struct ls_edge *edge)
+static void relax_constraints(struct cspf *algo, struct ls_edge *edge)
 {
 
 	struct c_path pkey = {};
@@ -488,12 +486,12 @@ static bool relax_constraints(struct cspf *algo, struct ls_edge *edge)
 
 	/* Verify that we have a current computed path */
 	if (!algo->path)
-		return false;
+		return;
 
 	/* Verify if we have not visited the next Vertex to avoid loop */
 	vnode.key = edge->destination->key;
 	if (visited_member(&algo->visited, &vnode)) {
-		return false;
+		return;
 	}
 
 	/*
@@ -530,73 +528,40 @@ static bool relax_constraints(struct cspf *algo, struct ls_edge *edge)
 	}
 	if (total_cost < next_path->weight) {
 		/*
-		 * It is not possible to directly update the q_path in the
-		 * Priority Queue. Indeed, if we modify the path weight, the
-		 * Priority Queue must be re-ordered. So, we need fist to remove
-		 * the q_path if it is present in the Priority Queue, then,
-		 * update the Path, in particular the Weight, and finally
-		 * (re-)insert it in the Priority Queue.
+		 * next_path is the one for this destination in the Priority
+		 * Queue if it is still there; it has to be re-ordered after
+		 * its Weight changed.
 		 */
-		struct c_path *path;
-		frr_each_safe (pqueue, &algo->pqueue, path) {
-			if (path->dst == pkey.dst) {
-				pqueue_del(&algo->pqueue, path);
-				break;
-			}
-		}
 		next_path->weight = total_cost;
 		cpath_replace(next_path, algo->path);
 		listnode_add(next_path->edges, edge);
-		pqueue_add(&algo->pqueue, next_path);
+		if (pqueue_member(&algo->pqueue, next_path))
+			pqueue_update(&algo->pqueue, next_path);
+		else
+			pqueue_add(&algo->pqueue, next_path);
 	}
-
-	/* Return True if we reach the destination */
-	return (next_path->dst == algo->pdst->dst);
 }
 
-struct c_path *compute_p2p_path(struct cspf *algo, struct ls_ted *ted)
+/**
+ * Run the path computation from the source over the whole graph. Once done,
+ * the Processed Path tree holds the shortest constrained path to each vertex
+ * that could be reached (i.e. a path with at least one edge).
+ *
+ * @param algo	CSPF structure
+ * @param ted	Traffic Engineering Database
+ */
+static void cspf_run(struct cspf *algo, struct ls_ted *ted)
 {
 	struct listnode *node;
 	struct ls_vertex *vertex;
 	struct ls_edge *edge;
-	struct c_path *optim_path;
 	struct v_node *vnode;
-	uint32_t cur_cost;
-
-	optim_path = cpath_new(0xFFFFFFFFFFFFFFFF);
-	optim_path->status = FAILED;
-
-	/* Check that all is correctly initialized */
-	if (!algo)
-		return optim_path;
-
-	if (!algo->csts.ctype)
-		return optim_path;
-
-	if (!algo->pdst) {
-		optim_path->status = NO_DESTINATION;
-		return optim_path;
-	}
-
-	if (!algo->path) {
-		optim_path->status = NO_SOURCE;
-		return optim_path;
-	}
-
-	if (algo->pdst->dst == algo->path->dst) {
-		optim_path->status = SAME_SRC_DST;
-		return optim_path;
-	}
-
-	optim_path->dst = algo->pdst->dst;
-	optim_path->status = IN_PROGRESS;
 
 	/*
 	 * Process all Connected Vertex until priority queue becomes empty.
 	 * Connected Vertices are added into the priority queue when
 	 * processing the next Connected Vertex: see relax_constraints()
 	 */
-	cur_cost = MAX_COST;
 	while (pqueue_count(&algo->pqueue) != 0) {
 		/* Got shortest current Path from the Priority Queue */
 		algo->path = pqueue_pop(&algo->pqueue);
@@ -619,28 +584,112 @@ struct c_path *compute_p2p_path(struct cspf *algo, struct ls_ted *ted)
 				continue;
 
 			/*
-			 * Relax constraints and check if we got a shorter
-			 * candidate path
+			 * Relax constraints to get a shorter candidate path,
+			 * if any
 			 */
-			if (relax_constraints(algo, edge) &&
-			    algo->pdst->weight < cur_cost) {
-				cur_cost = algo->pdst->weight;
-				cpath_copy(optim_path, algo->pdst);
-				optim_path->status = SUCCESS;
-			}
+			relax_constraints(algo, edge);
 		}
 	}
+}
+
+struct c_path *compute_p2p_path(struct cspf *algo, struct ls_ted *ted)
+{
+	struct c_path *optim_path;
+
+	optim_path = cpath_new(0xFFFFFFFFFFFFFFFF);
+	optim_path->status = FAILED;
+
+	/* Check that all is correctly initialized */
+	if (!algo)
+		return optim_path;
+
+	if (!algo->csts.ctype)
+		return optim_path;
+
+	if (!algo->pdst) {
+		optim_path->status = NO_DESTINATION;
+		return optim_path;
+	}
+
+	if (!algo->path) {
+		optim_path->status = NO_SOURCE;
+		return optim_path;
+	}
+
+	if (algo->pdst->dst == algo->path->dst) {
+		optim_path->status = SAME_SRC_DST;
+		return optim_path;
+	}
+
+	optim_path->dst = algo->pdst->dst;
+
+	cspf_run(algo, ted);
 
 	/*
-	 * The priority queue is empty => all the possible (vertex, path)
-	 * elements have been explored. The optim_path contains the optimal
-	 * path if it exists. Otherwise an empty path with status failed is
-	 * returned.
+	 * All the possible (vertex, path) elements have been explored. The
+	 * destination path holds the optimal path if it exists. Otherwise an
+	 * empty path with status failed is returned.
 	 */
-	if (optim_path->status == IN_PROGRESS ||
-	    listcount(optim_path->edges) == 0)
-		optim_path->status = FAILED;
+	if (listcount(algo->pdst->edges) != 0) {
+		cpath_copy(optim_path, algo->pdst);
+		optim_path->status = SUCCESS;
+	}
 	cspf_clean(algo);
 
 	return optim_path;
 }
+
+unsigned int compute_p2mp_paths(struct cspf *algo, struct ls_ted *ted,
+				struct ls_vertex *const *dst,
+				unsigned int count, struct c_path **paths)
+{
+	struct c_path pkey = {};
+	struct c_path *path;
+	enum path_status status = FAILED;
+	uint64_t src = 0;
+	unsigned int i, found = 0;
+
+	/* Check that all is correctly initialized */
+	if (algo && algo->csts.ctype) {
+		if (algo->path) {
+			src = algo->path->dst;
+			status = IN_PROGRESS;
+			cspf_run(algo, ted);
+		} else
+			status = NO_SOURCE;
+	}
+
+	for (i = 0; i < count; i++) {
+		paths[i] = cpath_new(0xFFFFFFFFFFFFFFFF);
+		paths[i]->status = status;
+		if (status != IN_PROGRESS)
+			continue;
+
+		if (!dst[i]) {
+			paths[i]->status = NO_DESTINATION;
+			continue;
+		}
+		paths[i]->dst = dst[i]->key;
+		if (dst[i]->key == src) {
+			paths[i]->status = SAME_SRC_DST;
+			continue;
+		}
+
+		pkey.dst = dst[i]->key;
+		path = processed_find(&algo->processed, &pkey);
+		if (path && listcount(path->edges) != 0) {
+			cpath_copy(paths[i], path);
+			paths[i]->status = SUCCESS;
+			found++;
+		} else
+			paths[i]->status = FAILED;
+	}
+	cspf_clean(algo);
+
+	return found;
+}
+
+void cspf_path_del(struct c_path *path)
+{
+	cpath_del(path);
+}
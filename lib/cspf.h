@@ -66,7 +66,7 @@ struct constraints {
 };
 
 /* Priority Queue for Constrained Path Computation */
-PREDECL_RBTREE_NONUNIQ(pqueue);
+PREDECL_RADIXHEAP(pqueue);
 
 /* Processed Path for Constrained Path Computation */
 PREDECL_RBTREE_UNIQ(processed);
@@ -81,11 +81,11 @@ struct c_path {
 	enum path_status status;     /* status of the computed path */
 };
 
-macro_inline int q_cmp(const struct c_path *p1, const struct c_path *p2)
+macro_inline uint64_t q_key(const struct c_path *path)
 {
-	return numcmp(p1->weight, p2->weight);
+	return path->weight;
 }
-DECLARE_RBTREE_NONUNIQ(pqueue, struct c_path, q_itm, q_cmp);
+DECLARE_RADIXHEAP(pqueue, struct c_path, q_itm, q_key);
 
 macro_inline int p_cmp(const struct c_path *p1, const struct c_path *p2)
 {
@@ -204,6 +204,37 @@ extern void cspf_del(struct cspf *algo);
  */
 extern struct c_path *compute_p2p_path(struct cspf *algo, struct ls_ted *ted);
 
+/**
+ * Compute constrained paths from one source to several destinations with the
+ * same constraints, in one run over the graph. cspf_init() function must be
+ * call prior to call this function, the destination given to it is ignored.
+ * This is the way to go when many paths share a source and constraints, as
+ * e.g. on re-optimization: each edge is pruned once and the TED walked once
+ * for all of them rather than once per path.
+ *
+ * @param algo	CSPF structure
+ * @param ted	Traffic Engineering Database
+ * @param dst	Destination vertices of the requested paths
+ * @param count	Number of destination vertices
+ * @param paths	Filled with count Constrained Paths, one per destination with
+ *		status to indicate computation success. They must be freed
+ *		with cspf_path_del()
+ *
+ * @return	Number of paths successfully computed
+ */
+extern unsigned int compute_p2mp_paths(struct cspf *algo, struct ls_ted *ted,
+				       struct ls_vertex *const *dst,
+				       unsigned int count,
+				       struct c_path **paths);
+
+/**
+ * Delete a Constrained Path returned by compute_p2p_path() or
+ * compute_p2mp_paths().
+ *
+ * @param path	Constrained Path structure to be deleted
+ */
+extern void cspf_path_del(struct c_path *path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,101 @@
+/*
+ * Fast non-cryptographic hashing
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "fhash.h"
+
+/* memcpy() compiles to a single (unaligned) load on anything relevant */
+static inline uint64_t fhash_r8(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t fhash_r4(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* 1..3 bytes, reads first, middle and last without branching on len */
+static inline uint64_t fhash_r3(const uint8_t *p, size_t len)
+{
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8)
+	       | p[len - 1];
+}
+
+uint64_t fhash64(const void *key, size_t len, uint64_t h)
+{
+	const uint8_t *p = key;
+	uint64_t a, b;
+
+	h ^= fhash_mix(h ^ FHASH_P0, FHASH_P1);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			/* 2 overlapping 4-byte reads at each end */
+			size_t mid = (len >> 3) << 2;
+
+			a = (fhash_r4(p) << 32) | fhash_r4(p + mid);
+			b = (fhash_r4(p + len - 4) << 32)
+			    | fhash_r4(p + len - 4 - mid);
+		} else if (len > 0) {
+			a = fhash_r3(p, len);
+			b = 0;
+		} else
+			a = b = 0;
+	} else {
+		size_t i = len;
+
+		if (i > 48) {
+			uint64_t h1 = h, h2 = h;
+
+			do {
+				h = fhash_mix(fhash_r8(p) ^ FHASH_P1,
+					      fhash_r8(p + 8) ^ h);
+				h1 = fhash_mix(fhash_r8(p + 16) ^ FHASH_P2,
+					       fhash_r8(p + 24) ^ h1);
+				h2 = fhash_mix(fhash_r8(p + 32) ^ FHASH_P3,
+					       fhash_r8(p + 40) ^ h2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			h ^= h1 ^ h2;
+		}
+		while (i > 16) {
+			h = fhash_mix(fhash_r8(p) ^ FHASH_P1, fhash_r8(p + 8) ^ h);
+			p += 16;
+			i -= 16;
+		}
+		/* last 16 bytes, overlapping with the previous round */
+		a = fhash_r8(p + i - 16);
+		b = fhash_r8(p + i - 8);
+	}
+
+	a ^= FHASH_P1;
+	b ^= h;
+	fhash_mum(&a, &b);
+	return fhash_mix(a ^ FHASH_P0 ^ len, b ^ FHASH_P1);
+}
@@ -0,0 +1,114 @@
+/*
+ * Fast non-cryptographic hashing
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_FHASH_H
+#define _FRR_FHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Multiply-and-fold hashing in the style of wyhash.  Each 16 bytes of input
+ * cost one 64x64->128 multiplication, as opposed to jhash's 12 byte rounds
+ * of ~36 dependent ALU operations.  Inputs of more than 48 bytes are run
+ * through 3 independent lanes so the multiplications can overlap.
+ *
+ * Results depend on host byte order and are meant for in-memory hash
+ * tables, never put them on the wire or on disk.
+ *
+ * For hash functions that combine a bunch of struct fields, use the
+ * incremental helpers rather than packing the fields into a buffer:
+ *
+ *	uint64_t h = fhash_init(seed);
+ *
+ *	h = fhash_add(h, attr->origin, attr->med);
+ *	h = fhash_add(h, ((uint64_t)a << 32) | b, c);
+ *	h = fhash64(&attr->mp_nexthop_global, 16, h);
+ *	return fhash_final(h);
+ */
+
+#define FHASH_P0 0xa0761d6478bd642fULL
+#define FHASH_P1 0xe7037ed1a0b428dbULL
+#define FHASH_P2 0x8ebc6af09c88c6e3ULL
+#define FHASH_P3 0x589965cc75374cc3ULL
+
+/* 128-bit product of *a and *b, low half in *a, high half in *b */
+static inline void fhash_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = (__uint128_t)*a * *b;
+
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32;
+	uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), lo, c;
+
+	c = t < rl;
+	lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t fhash_mix(uint64_t a, uint64_t b)
+{
+	fhash_mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t fhash_init(uint64_t seed)
+{
+	return seed ^ fhash_mix(seed ^ FHASH_P0, FHASH_P1);
+}
+
+/* fold 2 words of fixed-size data into the state */
+static inline uint64_t fhash_add(uint64_t h, uint64_t a, uint64_t b)
+{
+	return fhash_mix(a ^ FHASH_P1, b ^ h);
+}
+
+/* arbitrary bytes, h need not come from fhash_init() */
+extern uint64_t fhash64(const void *key, size_t len, uint64_t h);
+
+static inline uint32_t fhash_final(uint64_t h)
+{
+	h = fhash_mix(h ^ FHASH_P0, FHASH_P1);
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+/* one-shot drop-in for jhash() */
+static inline uint32_t fhash(const void *key, size_t len, uint32_t seed)
+{
+	return fhash_final(fhash64(key, len, seed));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_FHASH_H */
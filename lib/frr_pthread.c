@@ -55,6 +55,9 @@ static struct list *frr_pthread_list;
 
 void frr_pthread_init(void)
 {
+	/* called on the main pthread */
+	qmem_thread_name("main");
+
 	frr_with_mutex (&frr_pthread_list_mtx) {
 		frr_pthread_list = list_new();
 	}
@@ -155,6 +158,7 @@ static void *frr_pthread_inner(void *arg)
 	struct frr_pthread *fpt = arg;
 
 	rcu_thread_start(fpt->rcu_thread);
+	qmem_thread_name(fpt->name);
 	return fpt->attr.start(fpt);
 }
 
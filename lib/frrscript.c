@@ -28,6 +28,7 @@
 #include "memory.h"
 #include "hash.h"
 #include "log.h"
+#include "monotime.h"
 
 
 DEFINE_MTYPE_STATIC(LIB, SCRIPT, "Scripting");
@@ -353,6 +354,47 @@ struct frrscript *frrscript_new(const char *name)
 	return fs;
 }
 
+static int frrscript_path(struct frrscript *fs, char *path, size_t size)
+{
+	if (snprintf(path, size, "%s/%s.lua", scriptdir, fs->name)
+	    >= (int)size) {
+		zlog_err("frrscript: path to script %s/%s.lua is too long",
+			 scriptdir, fs->name);
+		return -1;
+	}
+	return 0;
+}
+
+static void frrscript_stat(const char *path, time_t *mtime, off_t *size)
+{
+	struct stat st;
+
+	if (stat(path, &st) == 0) {
+		*mtime = st.st_mtime;
+		*size = st.st_size;
+	} else {
+		*mtime = 0;
+		*size = 0;
+	}
+}
+
+bool frrscript_changed(struct frrscript *fs)
+{
+	char script_name[MAXPATHLEN];
+	time_t mtime, now = monotime(NULL);
+	off_t size;
+
+	if (fs->checked == now)
+		return false;
+	fs->checked = now;
+
+	if (frrscript_path(fs, script_name, sizeof(script_name)))
+		return false;
+
+	frrscript_stat(script_name, &mtime, &size);
+	return mtime != fs->mtime || size != fs->size;
+}
+
 int frrscript_load(struct frrscript *fs, const char *function_name,
 		   int (*load_cb)(struct frrscript *))
 {
@@ -364,13 +406,12 @@ int frrscript_load(struct frrscript *fs, const char *function_name,
 
 	char script_name[MAXPATHLEN];
 
-	if (snprintf(script_name, sizeof(script_name), "%s/%s.lua", scriptdir,
-		     fs->name)
-	    >= (int)sizeof(script_name)) {
-		zlog_err("frrscript: path to script %s/%s.lua is too long",
-			 scriptdir, fs->name);
+	if (frrscript_path(fs, script_name, sizeof(script_name)))
 		goto fail;
-	}
+
+	/* before loading, so a change while loading is seen next time */
+	frrscript_stat(script_name, &fs->mtime, &fs->size);
+	fs->checked = monotime(NULL);
 
 	if (luaL_dofile(L, script_name) != 0) {
 		zlog_err("frrscript: failed loading script '%s': error: %s",
@@ -410,6 +451,7 @@ fail:
 void frrscript_delete(struct frrscript *fs)
 {
 	hash_iterate(fs->lua_function_hash, lua_function_free, NULL);
+	hash_free(fs->lua_function_hash);
 	XFREE(MTYPE_SCRIPT, fs->name);
 	XFREE(MTYPE_SCRIPT, fs);
 }
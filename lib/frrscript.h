@@ -90,6 +90,13 @@ struct frrscript {
 
 	/* Hash of Lua function name to Lua function state */
 	struct hash *lua_function_hash;
+
+	/* Script file modification time and size when last loaded, and when
+	 * that was last checked; see frrscript_changed()
+	 */
+	time_t mtime;
+	off_t size;
+	time_t checked;
 };
 
 
@@ -134,6 +141,14 @@ int frrscript_load(struct frrscript *fs, const char *function_name,
  */
 void frrscript_delete(struct frrscript *fs);
 
+/*
+ * For users that keep a loaded script around rather than loading it for
+ * each call: true if the script file was modified since it was loaded, so
+ * the caller should load it again.  Looks at the file at most once per
+ * second.
+ */
+bool frrscript_changed(struct frrscript *fs);
+
 /*
  * Register a Lua codec for a type.
  *
@@ -82,6 +82,7 @@ DEFUN (grammar_test,
 
 	cmd_graph_parse(graph, cmd);
 	cmd_graph_merge(nodegraph, graph, +1);
+	command_match_cache_flush();
 
 	return CMD_SUCCESS;
 }
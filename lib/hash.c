@@ -93,6 +93,93 @@ void *hash_alloc_intern(void *arg)
 						  memory_order_relaxed);       \
 	} while (0)
 
+/* Move all elements of one bucket of old_index to the current index. */
+static void hash_migrate_bucket(struct hash *hash, unsigned int i)
+{
+	struct hash_bucket *hb, *hbnext;
+
+	for (hb = hash->old_index[i]; hb; hb = hbnext) {
+		unsigned int h = hb->key & (hash->size - 1);
+
+		hbnext = hb->next;
+		hb->next = hash->index[h];
+
+		int oldlen = hb->next ? hb->next->len : 0;
+		int newlen = oldlen + 1;
+
+		if (newlen == 1)
+			hash->stats.empty--;
+		else
+			hb->next->len = 0;
+
+		hb->len = newlen;
+
+		hash_update_ssq(hash, oldlen, newlen);
+
+		hash->index[h] = hb;
+	}
+
+	hash->old_index[i] = NULL;
+}
+
+/* Move up to 'steps' buckets of an ongoing incremental resize. */
+static void hash_migrate(struct hash *hash, unsigned int steps)
+{
+	if (!hash->old_index)
+		return;
+
+	while (steps-- && hash->migrate_pos < hash->old_size)
+		hash_migrate_bucket(hash, hash->migrate_pos++);
+
+	if (hash->migrate_pos == hash->old_size) {
+		XFREE(MTYPE_HASH_INDEX, hash->old_index);
+		hash->old_size = 0;
+		hash->migrate_pos = 0;
+	}
+}
+
+/*
+ * Make sure the element for 'key' is not left behind in old_index, so the
+ * caller only needs to look at the current index, and make some progress on
+ * the rest of the resize.
+ */
+static void hash_migrate_key(struct hash *hash, unsigned int key)
+{
+	if (!hash->old_index)
+		return;
+
+	hash_migrate_bucket(hash, key & (hash->old_size - 1));
+	hash_migrate(hash, HASH_MIGRATE_STEP);
+}
+
+void hash_set_incremental(struct hash *hash, bool incremental)
+{
+	if (!incremental)
+		hash_migrate(hash, UINT_MAX);
+
+	hash->incremental = incremental;
+}
+
+/* Start an incremental resize; elements are moved by hash_migrate(). */
+static void hash_expand_incremental(struct hash *hash, unsigned int new_size)
+{
+	/* can't have two resizes in flight */
+	hash_migrate(hash, UINT_MAX);
+
+	hash->old_index = hash->index;
+	hash->old_size = hash->size;
+	hash->migrate_pos = 0;
+
+	hash->index = XCALLOC(MTYPE_HASH_INDEX,
+			      sizeof(struct hash_bucket *) * new_size);
+	hash->size = new_size;
+
+	/* statistics only cover elements that made it to the new index */
+	hash->stats.empty = new_size;
+	hash->stats.ssq = 0;
+	hash->resizes++;
+}
+
 /* Expand hash if the chain length exceeds the threshold. */
 static void hash_expand(struct hash *hash)
 {
@@ -104,6 +191,11 @@ static void hash_expand(struct hash *hash)
 	if (hash->max_size && new_size > hash->max_size)
 		return;
 
+	if (hash->incremental) {
+		hash_expand_incremental(hash, new_size);
+		return;
+	}
+
 	new_index = XCALLOC(MTYPE_HASH_INDEX,
 			    sizeof(struct hash_bucket *) * new_size);
 
@@ -135,6 +227,7 @@ static void hash_expand(struct hash *hash)
 	XFREE(MTYPE_HASH_INDEX, hash->index);
 	hash->size = new_size;
 	hash->index = new_index;
+	hash->resizes++;
 }
 
 void *hash_get(struct hash *hash, void *data, void *(*alloc_func)(void *))
@@ -150,6 +243,7 @@ void *hash_get(struct hash *hash, void *data, void *(*alloc_func)(void *))
 		return NULL;
 
 	key = (*hash->hash_key)(data);
+	hash_migrate_key(hash, key);
 	index = key & (hash->size - 1);
 
 	for (bucket = hash->index[index]; bucket != NULL;
@@ -218,6 +312,7 @@ void *hash_release(struct hash *hash, void *data)
 	struct hash_bucket *pp;
 
 	key = (*hash->hash_key)(data);
+	hash_migrate_key(hash, key);
 	index = key & (hash->size - 1);
 
 	for (bucket = pp = hash->index[index]; bucket; bucket = bucket->next) {
@@ -258,6 +353,8 @@ void hash_iterate(struct hash *hash, void (*func)(struct hash_bucket *, void *),
 	struct hash_bucket *hb;
 	struct hash_bucket *hbnext;
 
+	hash_migrate(hash, UINT_MAX);
+
 	for (i = 0; i < hash->size; i++)
 		for (hb = hash->index[i]; hb; hb = hbnext) {
 			/* get pointer to next hash bucket here, in case (*func)
@@ -276,6 +373,8 @@ void hash_walk(struct hash *hash, int (*func)(struct hash_bucket *, void *),
 	struct hash_bucket *hbnext;
 	int ret = HASHWALK_CONTINUE;
 
+	hash_migrate(hash, UINT_MAX);
+
 	for (i = 0; i < hash->size; i++) {
 		for (hb = hash->index[i]; hb; hb = hbnext) {
 			/* get pointer to next hash bucket here, in case (*func)
@@ -295,6 +394,8 @@ void hash_clean(struct hash *hash, void (*free_func)(void *))
 	struct hash_bucket *hb;
 	struct hash_bucket *next;
 
+	hash_migrate(hash, UINT_MAX);
+
 	for (i = 0; i < hash->size; i++) {
 		for (hb = hash->index[i]; hb; hb = next) {
 			next = hb->next;
@@ -340,6 +441,7 @@ void hash_free(struct hash *hash)
 
 	XFREE(MTYPE_HASH, hash->name);
 
+	XFREE(MTYPE_HASH_INDEX, hash->old_index);
 	XFREE(MTYPE_HASH_INDEX, hash->index);
 	XFREE(MTYPE_HASH, hash);
 }
@@ -359,7 +461,8 @@ DEFUN_NOSH(show_hash_stats,
 	struct listnode *ln;
 	struct ttable *tt = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
 
-	ttable_add_row(tt, "Hash table|Buckets|Entries|Empty|LF|SD|FLF|SD");
+	ttable_add_row(tt,
+		       "Hash table|Buckets|Entries|Empty|LF|SD|FLF|SD|Resizes|Migrating");
 	tt->style.cell.lpad = 2;
 	tt->style.cell.rpad = 1;
 	tt->style.corner = '+';
@@ -388,6 +491,12 @@ DEFUN_NOSH(show_hash_stats,
 	 *   As a rule of thumb this number should be less than 2, and ideally
 	 *   <= 1 for optimal performance. A number larger than 3 generally
 	 *   indicates a poor hash function.
+	 *
+	 * - Resizes: how many times the table has been expanded.
+	 *
+	 * - Migrating: for tables using incremental resizing, how many of the
+	 *   old buckets have been moved so far if a resize is in progress.
+	 *   Empty, SD and FLF only account for elements already moved.
 	 */
 
 	double lf;    // load factor
@@ -401,6 +510,7 @@ DEFUN_NOSH(show_hash_stats,
 	long double ldc;  // (long double) h->count
 	long double full; // h->size - h->stats.empty
 	long double ssq;  // ssq casted to long double
+	char migrating[32];
 
 	pthread_mutex_lock(&_hashes_mtx);
 	if (!_hashes) {
@@ -427,10 +537,18 @@ DEFUN_NOSH(show_hash_stats,
 		stdv = sqrt(var);
 		fstdv = sqrt(fvar);
 
-		ttable_add_row(tt, "%s|%d|%ld|%.0f%%|%.2lf|%.2lf|%.2lf|%.2lf",
+		if (h->old_index)
+			snprintf(migrating, sizeof(migrating), "%u/%u",
+				 h->migrate_pos, h->old_size);
+		else
+			strlcpy(migrating, h->incremental ? "no" : "-",
+				sizeof(migrating));
+
+		ttable_add_row(tt,
+			       "%s|%d|%ld|%.0f%%|%.2lf|%.2lf|%.2lf|%.2lf|%u|%s",
 			       h->name, h->size, h->count,
 			       (h->stats.empty / (double)h->size) * 100, lf,
-			       stdv, flf, fstdv);
+			       stdv, flf, fstdv, h->resizes, migrating);
 	}
 	pthread_mutex_unlock(&_hashes_mtx);
 
@@ -32,6 +32,8 @@ extern "C" {
 #define HASH_INITIAL_SIZE 256
 /* Expansion threshold */
 #define HASH_THRESHOLD(used, size) ((used) > (size))
+/* Old buckets moved per operation while an incremental resize is running */
+#define HASH_MIGRATE_STEP 8
 
 #define HASHWALK_CONTINUE 0
 #define HASHWALK_ABORT -1
@@ -81,6 +83,19 @@ struct hash {
 
 	struct hashstats stats;
 
+	/*
+	 * Incremental resizing; see hash_set_incremental().  While a resize
+	 * is in progress, buckets of old_index below migrate_pos have been
+	 * moved to index already.
+	 */
+	bool incremental;
+	struct hash_bucket **old_index;
+	unsigned int old_size;
+	unsigned int migrate_pos;
+
+	/* number of times the table was expanded */
+	unsigned int resizes;
+
 	/* hash name */
 	char *name;
 };
@@ -154,6 +169,27 @@ hash_create_size(unsigned int size, unsigned int (*hash_key)(const void *),
 		 bool (*hash_cmp)(const void *, const void *),
 		 const char *name);
 
+/*
+ * Make a hash table grow incrementally.
+ *
+ * By default, when a hash table grows past its threshold all elements are
+ * moved to a new, larger bucket array in one go, which takes a noticeable
+ * amount of time for tables with millions of entries.  In incremental mode
+ * the new bucket array is allocated right away, but elements are moved over
+ * a few buckets at a time, on each subsequent hash_get(), hash_lookup() or
+ * hash_release() call.
+ *
+ * Iterating over the table finishes any pending migration first.  Code that
+ * accesses hash->index directly must not use this mode.
+ *
+ * hash
+ *    hash table to operate on
+ *
+ * incremental
+ *    whether to enable incremental resizing
+ */
+extern void hash_set_incremental(struct hash *hash, bool incremental);
+
 /*
  * Retrieve or insert data from / into a hash table.
  *
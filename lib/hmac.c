@@ -0,0 +1,246 @@
+/*
+ * HMAC with precomputed key state
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "hmac.h"
+
+/* SHA-384 and SHA-512 */
+#define HMAC_MAX_BLOCK		128
+
+#ifdef CRYPTO_OPENSSL
+static const EVP_MD *hmac_evp(enum keychain_hash_algo algo)
+{
+	switch (algo) {
+	case KEYCHAIN_ALGO_MD5:
+		return EVP_md5();
+	case KEYCHAIN_ALGO_HMAC_SHA1:
+		return EVP_sha1();
+	case KEYCHAIN_ALGO_HMAC_SHA256:
+		return EVP_sha256();
+	case KEYCHAIN_ALGO_HMAC_SHA384:
+		return EVP_sha384();
+	case KEYCHAIN_ALGO_HMAC_SHA512:
+		return EVP_sha512();
+	case KEYCHAIN_ALGO_NULL:
+	case KEYCHAIN_ALGO_MAX:
+		break;
+	}
+	return NULL;
+}
+
+bool hmac_algo_supported(enum keychain_hash_algo algo)
+{
+	return hmac_evp(algo) != NULL;
+}
+
+bool hmac_hash(enum keychain_hash_algo algo, const void *data, size_t len,
+	       uint8_t *out)
+{
+	const EVP_MD *md = hmac_evp(algo);
+
+	if (!md)
+		return false;
+	return EVP_Digest(data, len, out, NULL, md, NULL) == 1;
+}
+
+static void hmac_pads(struct hmac_key *hk, const uint8_t *ipad,
+		      const uint8_t *opad, size_t block)
+{
+	const EVP_MD *md = hmac_evp(hk->algo);
+
+	if (!hk->inner) {
+		hk->inner = EVP_MD_CTX_new();
+		hk->outer = EVP_MD_CTX_new();
+		hk->work = EVP_MD_CTX_new();
+	}
+
+	EVP_DigestInit_ex(hk->inner, md, NULL);
+	EVP_DigestUpdate(hk->inner, ipad, block);
+	EVP_DigestInit_ex(hk->outer, md, NULL);
+	EVP_DigestUpdate(hk->outer, opad, block);
+}
+
+void hmac_key_fini(struct hmac_key *hk)
+{
+	EVP_MD_CTX_free(hk->inner);
+	EVP_MD_CTX_free(hk->outer);
+	EVP_MD_CTX_free(hk->work);
+	memset(hk, 0, sizeof(*hk));
+}
+
+void hmac_begin(struct hmac_key *hk)
+{
+	EVP_MD_CTX_copy_ex(hk->work, hk->inner);
+}
+
+void hmac_update(struct hmac_key *hk, const void *data, size_t len)
+{
+	EVP_DigestUpdate(hk->work, data, len);
+}
+
+void hmac_final(struct hmac_key *hk, uint8_t *digest)
+{
+	uint8_t ihash[EVP_MAX_MD_SIZE];
+	unsigned int size;
+
+	EVP_DigestFinal_ex(hk->work, ihash, &size);
+	EVP_MD_CTX_copy_ex(hk->work, hk->outer);
+	EVP_DigestUpdate(hk->work, ihash, size);
+	EVP_DigestFinal_ex(hk->work, digest, &size);
+}
+
+#else /* !CRYPTO_OPENSSL */
+
+bool hmac_algo_supported(enum keychain_hash_algo algo)
+{
+	return algo == KEYCHAIN_ALGO_MD5 || algo == KEYCHAIN_ALGO_HMAC_SHA256;
+}
+
+static void hmac_md_init(enum keychain_hash_algo algo, union hmac_md_ctx *c)
+{
+	memset(c, 0, sizeof(*c));
+	if (algo == KEYCHAIN_ALGO_MD5)
+		MD5Init(&c->md5);
+	else
+		SHA256_Init(&c->sha256);
+}
+
+static void hmac_md_update(enum keychain_hash_algo algo,
+			   union hmac_md_ctx *c, const void *data, size_t len)
+{
+	if (algo == KEYCHAIN_ALGO_MD5)
+		MD5Update(&c->md5, data, len);
+	else
+		SHA256_Update(&c->sha256, data, len);
+}
+
+static void hmac_md_final(enum keychain_hash_algo algo, union hmac_md_ctx *c,
+			  uint8_t *out)
+{
+	if (algo == KEYCHAIN_ALGO_MD5)
+		MD5Final(out, &c->md5);
+	else
+		SHA256_Final(out, &c->sha256);
+}
+
+bool hmac_hash(enum keychain_hash_algo algo, const void *data, size_t len,
+	       uint8_t *out)
+{
+	union hmac_md_ctx c;
+
+	if (!hmac_algo_supported(algo))
+		return false;
+
+	hmac_md_init(algo, &c);
+	hmac_md_update(algo, &c, data, len);
+	hmac_md_final(algo, &c, out);
+	return true;
+}
+
+static void hmac_pads(struct hmac_key *hk, const uint8_t *ipad,
+		      const uint8_t *opad, size_t block)
+{
+	hmac_md_init(hk->algo, &hk->inner);
+	hmac_md_update(hk->algo, &hk->inner, ipad, block);
+	hmac_md_init(hk->algo, &hk->outer);
+	hmac_md_update(hk->algo, &hk->outer, opad, block);
+}
+
+void hmac_key_fini(struct hmac_key *hk)
+{
+	memset(hk, 0, sizeof(*hk));
+}
+
+void hmac_begin(struct hmac_key *hk)
+{
+	hk->work = hk->inner;
+}
+
+void hmac_update(struct hmac_key *hk, const void *data, size_t len)
+{
+	hmac_md_update(hk->algo, &hk->work, data, len);
+}
+
+void hmac_final(struct hmac_key *hk, uint8_t *digest)
+{
+	uint8_t ihash[KEYCHAIN_HMAC_SHA256_HASH_SIZE];
+
+	hmac_md_final(hk->algo, &hk->work, ihash);
+	hk->work = hk->outer;
+	hmac_md_update(hk->algo, &hk->work, ihash, hk->hash_len);
+	hmac_md_final(hk->algo, &hk->work, digest);
+}
+
+#endif /* !CRYPTO_OPENSSL */
+
+bool hmac_key_set_prehash(struct hmac_key *hk, enum keychain_hash_algo algo,
+			  const void *key, size_t keylen, size_t prehash_over)
+{
+	uint8_t ipad[HMAC_MAX_BLOCK], opad[HMAC_MAX_BLOCK];
+	size_t block, i;
+
+	if (!hmac_algo_supported(algo))
+		return false;
+
+	if (hk->valid && hk->algo == algo && hk->keylen == keylen
+	    && hk->prehash_over == prehash_over
+	    && keylen <= sizeof(hk->key) && !memcmp(hk->key, key, keylen))
+		return true;
+
+	block = keychain_get_block_size(algo);
+	assert(block <= HMAC_MAX_BLOCK && prehash_over <= block);
+
+	hk->algo = algo;
+	hk->hash_len = keychain_get_hash_len(algo);
+
+	memset(ipad, 0, sizeof(ipad));
+	if (keylen > prehash_over)
+		hmac_hash(algo, key, keylen, ipad);
+	else
+		memcpy(ipad, key, keylen);
+
+	for (i = 0; i < block; i++) {
+		opad[i] = ipad[i] ^ 0x5c;
+		ipad[i] ^= 0x36;
+	}
+
+	hmac_pads(hk, ipad, opad, block);
+	memset(ipad, 0, sizeof(ipad));
+	memset(opad, 0, sizeof(opad));
+
+	/* too long to remember, set up again next time */
+	hk->valid = keylen <= sizeof(hk->key);
+	hk->keylen = keylen;
+	hk->prehash_over = prehash_over;
+	if (hk->valid)
+		memcpy(hk->key, key, keylen);
+	return true;
+}
+
+bool hmac_key_set(struct hmac_key *hk, enum keychain_hash_algo algo,
+		  const void *key, size_t keylen)
+{
+	if (!hmac_algo_supported(algo))
+		return false;
+
+	return hmac_key_set_prehash(hk, algo, key, keylen,
+				    keychain_get_block_size(algo));
+}
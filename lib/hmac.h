@@ -0,0 +1,114 @@
+/*
+ * HMAC with precomputed key state
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_HMAC_H
+#define _FRR_HMAC_H
+
+#include "keychain.h"
+#include "md5.h"
+#include "sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * HMAC (RFC 2104) for per-packet authentication.  The hash states after
+ * the inner and outer pad blocks only depend on the key, so they are
+ * computed once in hmac_key_set() and copied for each message, which saves
+ * two compression rounds and the key setup per packet.
+ *
+ * hmac_key_set() remembers the key it was given and returns immediately if
+ * called again with the same one, so it can be called for each packet with
+ * the currently configured key.
+ *
+ * With --with-crypto=openssl, libcrypto does the hashing (and uses whatever
+ * CPU acceleration it has);  the internal implementation only has MD5 and
+ * SHA-256.
+ *
+ * A struct hmac_key must not be used from several pthreads at once.
+ */
+
+/* keys up to this length are remembered, longer ones are set up again */
+#define HMAC_KEY_CACHE_LEN	256
+
+union hmac_md_ctx {
+	MD5_CTX md5;
+	SHA256_CTX sha256;
+};
+
+struct hmac_key {
+	enum keychain_hash_algo algo;
+	uint16_t hash_len;
+
+	bool valid;
+	size_t keylen;
+	size_t prehash_over;
+	uint8_t key[HMAC_KEY_CACHE_LEN];
+
+#ifdef CRYPTO_OPENSSL
+	EVP_MD_CTX *inner, *outer, *work;
+#else
+	union hmac_md_ctx inner, outer, work;
+#endif
+};
+
+/* true if algo can be used in this build */
+extern bool hmac_algo_supported(enum keychain_hash_algo algo);
+
+/* plain hash of data, i.e. what the HMAC is built on;  out must have room
+ * for keychain_get_hash_len(algo) bytes.  Returns false if unsupported.
+ */
+extern bool hmac_hash(enum keychain_hash_algo algo, const void *data,
+		      size_t len, uint8_t *out);
+
+/* RFC 2104: keys longer than the block size are hashed first */
+extern bool hmac_key_set(struct hmac_key *hk, enum keychain_hash_algo algo,
+			 const void *key, size_t keylen);
+
+/* same, but keys longer than prehash_over are hashed first (RFC 7166 uses
+ * the hash length here.)  prehash_over must not exceed the block size.
+ */
+extern bool hmac_key_set_prehash(struct hmac_key *hk,
+				 enum keychain_hash_algo algo, const void *key,
+				 size_t keylen, size_t prehash_over);
+
+/* release resources, hk can be set up again afterwards */
+extern void hmac_key_fini(struct hmac_key *hk);
+
+extern void hmac_begin(struct hmac_key *hk);
+extern void hmac_update(struct hmac_key *hk, const void *data, size_t len);
+/* writes hk->hash_len bytes */
+extern void hmac_final(struct hmac_key *hk, uint8_t *digest);
+
+/* all of the above at once */
+static inline void hmac_compute(struct hmac_key *hk, const void *data,
+				size_t len, uint8_t *digest)
+{
+	hmac_begin(hk);
+	hmac_update(hk, data, len);
+	hmac_final(hk, digest);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_HMAC_H */
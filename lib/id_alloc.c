@@ -105,6 +105,7 @@ static struct id_alloc_page *find_or_create_page(struct id_alloc *alloc,
 
 		alloc->capacity += 1 << FRR_ID_PAGE_SHIFT;
 		page->next_has_free = alloc->has_free;
+		page->on_free_list = true;
 		alloc->has_free = page;
 	} else if (page != NULL && create) {
 		flog_err(
@@ -122,20 +123,11 @@ static struct id_alloc_page *find_or_create_page(struct id_alloc *alloc,
  * memory will not be freed. If this is the first free ID in the page, the page
  * will be added to the allocator's list of pages with free IDs.
  */
-void idalloc_free(struct id_alloc *alloc, uint32_t id)
+static void free_bit(struct id_alloc *alloc, struct id_alloc_page *page,
+		     uint32_t id)
 {
-	struct id_alloc_page *page = NULL;
-
 	int word, offset;
-	uint32_t old_word, old_word_mask;
-
-	page = find_or_create_page(alloc, id, 0);
-	if (!page) {
-		flog_err(EC_LIB_ID_CONSISTENCY,
-			"ID Allocator %s cannot free #%u. ID Block does not exist.",
-			alloc->name, id);
-		return;
-	}
+	uint32_t old_word;
 
 	word = ID_WORD(id);
 	offset = ID_OFFSET(id);
@@ -154,19 +146,57 @@ void idalloc_free(struct id_alloc *alloc, uint32_t id)
 	if (old_word == UINT32_MAX) {
 		/* first bit in this block of 32 to be freed.*/
 
-		old_word_mask = page->full_word_mask;
 		page->full_word_mask &= ~(((uint32_t)1) << word);
 
-		if (old_word_mask == UINT32_MAX) {
+		if (!page->on_free_list) {
 			/* first bit in page freed, add this to the allocator's
 			 * list of pages with free space
 			 */
 			page->next_has_free = alloc->has_free;
+			page->on_free_list = true;
 			alloc->has_free = page;
 		}
 	}
 }
 
+void idalloc_free(struct id_alloc *alloc, uint32_t id)
+{
+	struct id_alloc_page *page = NULL;
+
+	page = find_or_create_page(alloc, id, 0);
+	if (!page) {
+		flog_err(EC_LIB_ID_CONSISTENCY,
+			"ID Allocator %s cannot free #%u. ID Block does not exist.",
+			alloc->name, id);
+		return;
+	}
+
+	free_bit(alloc, page, id);
+}
+
+/* IDs freed together tend to be close, so keep the page looked up */
+void idalloc_free_bulk(struct id_alloc *alloc, const uint32_t *ids,
+		       uint32_t count)
+{
+	struct id_alloc_page *page = NULL;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!page
+		    || (ids[i] >> FRR_ID_PAGE_SHIFT)
+			       != (page->base_value >> FRR_ID_PAGE_SHIFT))
+			page = find_or_create_page(alloc, ids[i], 0);
+		if (!page) {
+			flog_err(EC_LIB_ID_CONSISTENCY,
+				"ID Allocator %s cannot free #%u. ID Block does not exist.",
+				alloc->name, ids[i]);
+			continue;
+		}
+
+		free_bit(alloc, page, ids[i]);
+	}
+}
+
 /*
  * Add a allocation page to the end of the allocator's current range.
  * Returns null if the allocator has had all possible pages allocated already.
@@ -180,46 +210,56 @@ static struct id_alloc_page *create_next_page(struct id_alloc *alloc)
 }
 
 /*
- * Marks an ID within an allocator page as in use.
- * If the ID was the last free ID in the page, the page is removed from the
- * allocator's list of free IDs. In the typical allocation case, this page is
- * the first page in the list, and removing the page is fast. If instead an ID
- * is being reserved by number, this may end up scanning the whole single linked
- * list of pages in order to remove it.
+ * Marks IDs within a word of an allocator page as in use.
+ * If these were the last free IDs in the page, and the page is the first in
+ * the allocator's list of pages with free IDs (the typical allocation case),
+ * it is removed from the list.  Reserving an ID by number can fill up a page
+ * anywhere in the list though;  rather than scanning the single linked list
+ * for it, such a page is left in place and dropped when it gets to the head,
+ * see first_free_page().
  */
-static void reserve_bit(struct id_alloc *alloc, struct id_alloc_page *page,
-			int word, int offset)
+static void reserve_bits(struct id_alloc *alloc, struct id_alloc_page *page,
+			 int word, uint32_t mask)
 {
-	struct id_alloc_page *itr;
-
-	page->allocated_mask[word] |= ((uint32_t)1) << offset;
-	alloc->allocated += 1;
+	page->allocated_mask[word] |= mask;
+	alloc->allocated += __builtin_popcount(mask);
 
 	if (page->allocated_mask[word] == UINT32_MAX) {
 		page->full_word_mask |= ((uint32_t)1) << word;
-		if (page->full_word_mask == UINT32_MAX) {
-			if (alloc->has_free == page) {
-				/* allocate always pulls from alloc->has_free */
-				alloc->has_free = page->next_has_free;
-			} else {
-				/* reserve could pull from any page with free
-				 * bits
-				 */
-				itr = alloc->has_free;
-				while (itr) {
-					if (itr->next_has_free == page) {
-						itr->next_has_free =
-							page->next_has_free;
-						return;
-					}
-
-					itr = itr->next_has_free;
-				}
-			}
+		if (page->full_word_mask == UINT32_MAX
+		    && alloc->has_free == page) {
+			alloc->has_free = page->next_has_free;
+			page->on_free_list = false;
 		}
 	}
 }
 
+static void reserve_bit(struct id_alloc *alloc, struct id_alloc_page *page,
+			int word, int offset)
+{
+	reserve_bits(alloc, page, word, ((uint32_t)1) << offset);
+}
+
+/*
+ * First page with a free ID, dropping pages that filled up while not at the
+ * head of the list, and adding a page if there is none.
+ */
+static struct id_alloc_page *first_free_page(struct id_alloc *alloc)
+{
+	struct id_alloc_page *page;
+
+	while ((page = alloc->has_free)
+	       && page->full_word_mask == UINT32_MAX) {
+		alloc->has_free = page->next_has_free;
+		page->on_free_list = false;
+	}
+
+	if (alloc->has_free == NULL)
+		create_next_page(alloc);
+
+	return alloc->has_free;
+}
+
 /*
  * Reserve an ID number from the allocator. Returns IDALLOC_INVALID (0) if the
  * allocator has no more IDs available.
@@ -230,16 +270,13 @@ uint32_t idalloc_allocate(struct id_alloc *alloc)
 	int word, offset;
 	uint32_t return_value;
 
-	if (alloc->has_free == NULL)
-		create_next_page(alloc);
-
-	if (alloc->has_free == NULL) {
+	page = first_free_page(alloc);
+	if (page == NULL) {
 		flog_err(EC_LIB_ID_EXHAUST,
 			"ID Allocator %s has run out of IDs.", alloc->name);
 		return IDALLOC_INVALID;
 	}
 
-	page = alloc->has_free;
 	word = FFS32(~(page->full_word_mask)) - 1;
 
 	if (word < 0 || word >= 32) {
@@ -263,6 +300,45 @@ uint32_t idalloc_allocate(struct id_alloc *alloc)
 	return return_value;
 }
 
+uint32_t idalloc_allocate_bulk(struct id_alloc *alloc, uint32_t *ids,
+			       uint32_t count)
+{
+	struct id_alloc_page *page;
+	uint32_t n = 0, free_bits, taken;
+	int word, offset;
+
+	while (n < count) {
+		page = first_free_page(alloc);
+		if (page == NULL) {
+			flog_err(EC_LIB_ID_EXHAUST,
+				"ID Allocator %s has run out of IDs.",
+				alloc->name);
+			break;
+		}
+
+		word = FFS32(~(page->full_word_mask)) - 1;
+		if (word < 0 || word >= 32) {
+			flog_err(EC_LIB_ID_CONSISTENCY,
+				"ID Allocator %s internal error. Page starting at %d is inconsistent.",
+				alloc->name, page->base_value);
+			break;
+		}
+
+		free_bits = ~(page->allocated_mask[word]);
+		taken = 0;
+		while (free_bits && n < count) {
+			offset = FFS32(free_bits) - 1;
+			taken |= ((uint32_t)1) << offset;
+			free_bits &= free_bits - 1;
+			ids[n++] = page->base_value + word * 32 + offset;
+		}
+
+		reserve_bits(alloc, page, word, taken);
+	}
+
+	return n;
+}
+
 /*
  * Tries to allocate a specific ID from the allocator. Returns IDALLOC_INVALID
  * when the ID being "reserved" has allready been assigned/reserved. This should
@@ -22,6 +22,7 @@
 
 #include <strings.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -55,6 +56,11 @@ struct id_alloc_page {
 
 	struct id_alloc_page
 		*next_has_free; /* Next page with at least one bit open */
+
+	/* On the has_free list.  Pages that fill up anywhere but at the head
+	 * of the list stay on it until they get to the head.
+	 */
+	bool on_free_list;
 };
 
 struct id_alloc_subdir {
@@ -85,6 +91,13 @@ void idalloc_free_to_pool(struct id_alloc_pool **pool_ptr, uint32_t id);
 void idalloc_drain_pool(struct id_alloc *alloc,
 			struct id_alloc_pool **pool_ptr);
 uint32_t idalloc_allocate(struct id_alloc *alloc);
+/* Allocate up to count IDs into ids, returns how many it got (fewer only if
+ * the allocator runs out.)  Takes free IDs a 32-bit word at a time.
+ */
+uint32_t idalloc_allocate_bulk(struct id_alloc *alloc, uint32_t *ids,
+			       uint32_t count);
+void idalloc_free_bulk(struct id_alloc *alloc, const uint32_t *ids,
+		       uint32_t count);
 uint32_t idalloc_allocate_prefer_pool(struct id_alloc *alloc,
 				      struct id_alloc_pool **pool_ptr);
 uint32_t idalloc_reserve(struct id_alloc *alloc, uint32_t id);
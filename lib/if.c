@@ -34,6 +34,7 @@
 #include "table.h"
 #include "buffer.h"
 #include "log.h"
+#include "jhash.h"
 #include "northbound_cli.h"
 #ifndef VTYSH_EXTRACT_PL
 #include "lib/if_clippy.c"
@@ -55,6 +56,64 @@ static int if_cmp_index_func(const struct interface *ifp1,
 RB_GENERATE(if_name_head, interface, name_entry, if_cmp_func);
 RB_GENERATE(if_index_head, interface, index_entry, if_cmp_index_func);
 
+/*
+ * All interfaces with an ifindex, regardless of VRF, hashed on the ifindex
+ * so that lookups from netlink handlers don't need a tree walk per VRF.
+ * With the netns VRF backend the same ifindex can exist in several VRFs;
+ * only the first one is hashed then and if_index_all_dups counts the
+ * others, which are found through the per-VRF trees.
+ */
+static int if_index_all_cmp(const struct interface *a,
+			    const struct interface *b)
+{
+	return numcmp(a->ifindex, b->ifindex);
+}
+
+static uint32_t if_index_all_hash(const struct interface *ifp)
+{
+	return jhash_1word(ifp->ifindex, 0);
+}
+
+DECLARE_HASH(if_index_all, struct interface, index_all_entry,
+	     if_index_all_cmp, if_index_all_hash);
+
+static struct if_index_all_head if_index_all_head;
+static unsigned int if_index_all_dups;
+
+static struct interface *if_index_link(struct vrf *vrf, struct interface *ifp)
+{
+	struct interface *dup;
+
+	dup = IFINDEX_RB_INSERT(vrf, ifp);
+	if (dup)
+		return dup;
+
+	if (if_index_all_add(&if_index_all_head, ifp))
+		if_index_all_dups++;
+	else
+		ifp->index_all_linked = true;
+	return NULL;
+}
+
+static void if_index_unlink(struct vrf *vrf, struct interface *ifp)
+{
+	IFINDEX_RB_REMOVE(vrf, ifp);
+
+	if (ifp->index_all_linked) {
+		if_index_all_del(&if_index_all_head, ifp);
+		ifp->index_all_linked = false;
+	} else if (if_index_all_dups)
+		if_index_all_dups--;
+}
+
+static struct interface *if_lookup_index_all(ifindex_t ifindex)
+{
+	struct interface ref;
+
+	ref.ifindex = ifindex;
+	return if_index_all_find(&if_index_all_head, &ref);
+}
+
 DEFINE_QOBJ_TYPE(interface);
 
 DEFINE_HOOK(if_add, (struct interface * ifp), (ifp));
@@ -247,7 +306,7 @@ void if_update_to_new_vrf(struct interface *ifp, vrf_id_t vrf_id)
 		IFNAME_RB_REMOVE(old_vrf, ifp);
 
 	if (ifp->ifindex != IFINDEX_INTERNAL)
-		IFINDEX_RB_REMOVE(old_vrf, ifp);
+		if_index_unlink(old_vrf, ifp);
 
 	vrf = vrf_get(vrf_id, NULL);
 	ifp->vrf = vrf;
@@ -256,7 +315,7 @@ void if_update_to_new_vrf(struct interface *ifp, vrf_id_t vrf_id)
 		IFNAME_RB_INSERT(vrf, ifp);
 
 	if (ifp->ifindex != IFINDEX_INTERNAL)
-		IFINDEX_RB_INSERT(vrf, ifp);
+		if_index_link(vrf, ifp);
 }
 
 
@@ -281,7 +340,7 @@ void if_delete(struct interface **ifp)
 
 	IFNAME_RB_REMOVE(vrf, ptr);
 	if (ptr->ifindex != IFINDEX_INTERNAL)
-		IFINDEX_RB_REMOVE(vrf, ptr);
+		if_index_unlink(vrf, ptr);
 
 	if_delete_retain(ptr);
 
@@ -301,7 +360,13 @@ static struct interface *if_lookup_by_ifindex(ifindex_t ifindex,
 					      vrf_id_t vrf_id)
 {
 	struct vrf *vrf;
-	struct interface if_tmp;
+	struct interface if_tmp, *ifp;
+
+	ifp = if_lookup_index_all(ifindex);
+	if (ifp && ifp->vrf->vrf_id == vrf_id)
+		return ifp;
+	if (!if_index_all_dups)
+		return NULL;
 
 	vrf = vrf_lookup_by_id(vrf_id);
 	if (!vrf)
@@ -426,6 +491,10 @@ static struct interface *if_lookup_by_index_all_vrf(ifindex_t ifindex)
 	if (ifindex == IFINDEX_INTERNAL)
 		return NULL;
 
+	ifp = if_lookup_index_all(ifindex);
+	if (ifp || !if_index_all_dups)
+		return ifp;
+
 	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id) {
 		ifp = if_lookup_by_ifindex(ifindex, vrf->vrf_id);
 		if (ifp)
@@ -628,7 +697,7 @@ int if_set_index(struct interface *ifp, ifindex_t ifindex)
 		return -1;
 
 	if (ifp->ifindex != IFINDEX_INTERNAL)
-		IFINDEX_RB_REMOVE(ifp->vrf, ifp);
+		if_index_unlink(ifp->vrf, ifp);
 
 	ifp->ifindex = ifindex;
 
@@ -638,7 +707,7 @@ int if_set_index(struct interface *ifp, ifindex_t ifindex)
 		 * already an interface with the desired ifindex at the top of
 		 * the function. Nevertheless.
 		 */
-		if (IFINDEX_RB_INSERT(ifp->vrf, ifp))
+		if (if_index_link(ifp->vrf, ifp))
 			return -1;
 	}
 
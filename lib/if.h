@@ -26,6 +26,7 @@
 #include "memory.h"
 #include "qobj.h"
 #include "hook.h"
+#include "typesafe.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -203,9 +204,15 @@ struct if_link_params {
 #define HAS_LINK_PARAMS(ifp)  ((ifp)->link_params != NULL)
 
 /* Interface structure */
+PREDECL_HASH(if_index_all);
+
 struct interface {
 	RB_ENTRY(interface) name_entry, index_entry;
 
+	/* ifindex hash across all VRFs, see if_lookup_by_index() */
+	struct if_index_all_item index_all_entry;
+	bool index_all_linked;
+
 	/* Interface name.  This should probably never be changed after the
 	   interface is created, because the configuration info for this
 	   interface
@@ -43,6 +43,7 @@
 #include "vector.h"
 #include "vty.h"
 #include "command.h"
+#include "stream.h"
 
 #if defined(HAVE_MALLINFO2) || defined(HAVE_MALLINFO)
 static int show_memory_mallinfo(struct vty *vty)
@@ -78,9 +79,37 @@ static int show_memory_mallinfo(struct vty *vty)
 }
 #endif /* HAVE_MALLINFO */
 
-static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
+struct qmem_walk_vty {
+	struct vty *vty;
+	bool per_thread;
+};
+
+static void qmem_thread_walker(void *arg, const char *name, ssize_t n_alloc,
+			       ssize_t total)
 {
 	struct vty *vty = arg;
+
+	if (!n_alloc && !total)
+		return;
+
+	vty_out(vty, "  %-28s: %8zd         "
+#ifdef HAVE_MALLOC_USABLE_SIZE
+		" %9zd"
+#endif
+		"\n",
+		name, n_alloc
+#ifdef HAVE_MALLOC_USABLE_SIZE
+		, total
+#endif
+		);
+}
+
+static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
+{
+	struct qmem_walk_vty *qw = arg;
+	struct vty *vty = qw->vty;
+	struct memtype_stats st;
+
 	if (!mt) {
 		vty_out(vty, "--- qmem %s ---\n", mg->name);
 		vty_out(vty, "%-30s: %8s %-8s%s %8s %9s\n",
@@ -98,13 +127,16 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 #endif
 			);
 	} else {
-		if (mt->n_max != 0) {
+		mtype_stats(mt, &st);
+		if (st.n_max != 0) {
 			char size[32];
-			snprintf(size, sizeof(size), "%6zu", mt->size);
+			struct memslab_stats slab;
+
+			snprintf(size, sizeof(size), "%6zu", st.size);
 #ifdef HAVE_MALLOC_USABLE_SIZE
 #define TSTR " %9zu"
-#define TARG , mt->total
-#define TARG2 , mt->max_size
+#define TARG , st.total
+#define TARG2 , st.max_size
 #else
 #define TSTR ""
 #define TARG
@@ -112,31 +144,66 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 #endif
 			vty_out(vty, "%-30s: %8zu %-8s"TSTR" %8zu"TSTR"\n",
 				mt->name,
-				mt->n_alloc,
-				mt->size == 0 ? ""
-					      : mt->size == SIZE_VAR
-							? "variable"
-							: size
+				st.n_alloc,
+				st.size == 0 ? ""
+					     : st.size == SIZE_VAR
+						       ? "variable"
+						       : size
 				TARG,
-				mt->n_max
+				st.n_max
 				TARG2);
+
+			if (mtype_stats_slab(mt, &slab))
+				vty_out(vty,
+					"%-30s  slab: %zu chunks, %zu of %zu objects used (%zu%%)\n",
+					"", slab.chunks, slab.used,
+					slab.capacity,
+					slab.capacity ? slab.used * 100
+								/ slab.capacity
+						      : 0);
+
+			if (qw->per_thread)
+				mtype_stats_threads(mt, qmem_thread_walker,
+						    vty);
 		}
 	}
 	return 0;
 }
 
 
+static void show_memory_stream_pools(struct vty *vty)
+{
+	struct stream_pool_stats st[STREAM_POOL_CLASSES];
+	unsigned int i;
+
+	stream_pool_stats(st);
+
+	vty_out(vty, "--- stream pools ---\n");
+	vty_out(vty, "%-10s %12s %12s %10s %12s\n", "Size", "Hits", "Misses",
+		"Cached", "Dropped");
+	for (i = 0; i < STREAM_POOL_CLASSES; i++)
+		vty_out(vty, "%-10zu %12zu %12zu %10zu %12zu\n", st[i].size,
+			st[i].hits, st[i].misses, st[i].cached, st[i].dropped);
+}
+
 DEFUN_NOSH (show_memory,
 	    show_memory_cmd,
-	    "show memory",
+	    "show memory [per-thread]",
 	    "Show running system information\n"
-	    "Memory statistics\n")
+	    "Memory statistics\n"
+	    "Break down allocations by pthread\n")
 {
+	struct qmem_walk_vty qw = {
+		.vty = vty,
+		.per_thread = argc > 2,
+	};
+
 #ifdef HAVE_MALLINFO
 	show_memory_mallinfo(vty);
 #endif /* HAVE_MALLINFO */
 
-	qmem_walk(qmem_walker, vty);
+	qmem_walk(qmem_walker, &qw);
+	show_memory_stream_pools(vty);
 	return CMD_SUCCESS;
 }
 
@@ -232,7 +299,7 @@ DEFUN_HIDDEN (start_config,
 {
 	callback.readin_time = monotime(NULL);
 
-	vty->pending_allowed = 1;
+	nb_cli_bulk_begin(vty);
 
 	if (callback.start_config)
 		(*callback.start_config)();
@@ -255,8 +322,7 @@ DEFUN_HIDDEN (end_config,
 	frrtime_to_interval(readin_time, readin_time_str,
 			    sizeof(readin_time_str));
 
-	vty->pending_allowed = 0;
-	ret = nb_cli_pending_commit_check(vty);
+	ret = nb_cli_bulk_end(vty);
 
 	zlog_info("Configuration Read in Took: %s", readin_time_str);
 
@@ -109,6 +109,8 @@ static void opt_extend(const struct optspec *os)
 #define OPTION_LOGGING   1007
 #define OPTION_LIMIT_FDS 1008
 #define OPTION_SCRIPTDIR 1009
+#define OPTION_IO_BACKEND 1010
+#define OPTION_TIMER_BACKEND 1011
 
 static const struct option lo_always[] = {
 	{"help", no_argument, NULL, 'h'},
@@ -125,6 +127,8 @@ static const struct option lo_always[] = {
 	{"log-level", required_argument, NULL, OPTION_LOGLEVEL},
 	{"command-log-always", no_argument, NULL, OPTION_LOGGING},
 	{"limit-fds", required_argument, NULL, OPTION_LIMIT_FDS},
+	{"io-backend", required_argument, NULL, OPTION_IO_BACKEND},
+	{"timer-backend", required_argument, NULL, OPTION_TIMER_BACKEND},
 	{NULL}};
 static const struct optspec os_always = {
 	"hvdM:F:N:o:",
@@ -140,7 +144,9 @@ static const struct optspec os_always = {
 	"      --scriptdir    Override scripts directory\n"
 	"      --log          Set Logging to stdout, syslog, or file:<name>\n"
 	"      --log-level    Set Logging Level to use, debug, info, warn, etc\n"
-	"      --limit-fds    Limit number of fds supported\n",
+	"      --limit-fds    Limit number of fds supported\n"
+	"      --io-backend   Select I/O event backend (poll, epoll)\n"
+	"      --timer-backend  Select timer data structure (heap, wheel)\n",
 	lo_always};
 
 
@@ -631,6 +637,33 @@ static int frr_opt(int opt)
 	case OPTION_LIMIT_FDS:
 		di->limit_fds = strtoul(optarg, &err, 0);
 		break;
+	case OPTION_IO_BACKEND:
+		if (!strcmp(optarg, "poll"))
+			thread_io_backend_set(THREAD_IO_POLL);
+		else if (!strcmp(optarg, "epoll")) {
+			if (!thread_io_backend_set(THREAD_IO_EPOLL)) {
+				fprintf(stderr,
+					"epoll I/O backend is not available on this system\n");
+				errors++;
+			}
+		} else {
+			fprintf(stderr, "invalid --io-backend value \"%s\"\n",
+				optarg);
+			errors++;
+		}
+		break;
+	case OPTION_TIMER_BACKEND:
+		if (!strcmp(optarg, "heap"))
+			thread_timer_backend_set(THREAD_TIMER_HEAP);
+		else if (!strcmp(optarg, "wheel"))
+			thread_timer_backend_set(THREAD_TIMER_WHEEL);
+		else {
+			fprintf(stderr,
+				"invalid --timer-backend value \"%s\"\n",
+				optarg);
+			errors++;
+		}
+		break;
 	default:
 		return 1;
 	}
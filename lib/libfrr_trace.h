@@ -38,6 +38,7 @@
 #include "memory.h"
 #include "linklist.h"
 #include "table.h"
+#include "stream.h"
 
 /* clang-format off */
 
@@ -120,6 +121,23 @@ THREAD_OPERATION_TRACEPOINT_INSTANCE(thread_cancel)
 THREAD_OPERATION_TRACEPOINT_INSTANCE(thread_cancel_async)
 THREAD_OPERATION_TRACEPOINT_INSTANCE(thread_call)
 
+TRACEPOINT_EVENT(
+	frr_libfrr,
+	thread_call_done,
+	TP_ARGS(struct thread_master *, master, const char *, funcname,
+		unsigned long, walltime, unsigned long, cputime,
+		unsigned long, delay),
+	TP_FIELDS(
+		ctf_string(threadmaster_name, master->name)
+		ctf_string(function_name, funcname ? funcname : "(unknown function)")
+		ctf_integer(unsigned long, walltime_usec, walltime)
+		ctf_integer(unsigned long, cputime_usec, cputime)
+		ctf_integer(unsigned long, delay_usec, delay)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_libfrr, thread_call_done, TRACE_INFO)
+
 TRACEPOINT_EVENT(
 	frr_libfrr,
 	frr_pthread_run,
@@ -230,6 +248,52 @@ TRACEPOINT_EVENT(
 	)
 )
 
+TRACEPOINT_EVENT(
+	frr_libfrr,
+	stream_new,
+	TP_ARGS(
+		struct stream *, s, size_t, size
+	),
+	TP_FIELDS(
+		ctf_integer_hex(intptr_t, stream, s)
+		ctf_integer(size_t, size, size)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_libfrr, stream_new, TRACE_DEBUG)
+
+TRACEPOINT_EVENT(
+	frr_libfrr,
+	zapi_send,
+	TP_ARGS(
+		int, sock, uint16_t, command, size_t, length
+	),
+	TP_FIELDS(
+		ctf_integer(int, sock, sock)
+		ctf_integer(uint16_t, command, command)
+		ctf_integer(size_t, length, length)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_libfrr, zapi_send, TRACE_INFO)
+
+TRACEPOINT_EVENT(
+	frr_libfrr,
+	zapi_recv,
+	TP_ARGS(
+		int, sock, uint16_t, command, uint16_t, length,
+		uint32_t, vrf_id
+	),
+	TP_FIELDS(
+		ctf_integer(int, sock, sock)
+		ctf_integer(uint16_t, command, command)
+		ctf_integer(uint16_t, length, length)
+		ctf_integer(uint32_t, vrf_id, vrf_id)
+	)
+)
+
+TRACEPOINT_LOGLEVEL(frr_libfrr, zapi_recv, TRACE_INFO)
+
 /* clang-format on */
 
 #include <lttng/tracepoint-event.h>
@@ -1582,22 +1582,11 @@ static int ls_format_msg(struct stream *s, struct ls_message *msg)
 	return -1;
 }
 
-int ls_send_msg(struct zclient *zclient, struct ls_message *msg,
-		struct zapi_opaque_reg_info *dst)
+static void ls_create_msg_header(struct stream *s,
+				 struct zapi_opaque_reg_info *dst)
 {
-	struct stream *s;
 	uint16_t flags = 0;
 
-	/* Check if we have a valid message */
-	if (msg->event == LS_MSG_EVENT_UNDEF)
-		return -1;
-
-	/* Check buffer size */
-	if (STREAM_SIZE(zclient->obuf) <
-	    (ZEBRA_HEADER_SIZE + sizeof(uint32_t) + sizeof(msg)))
-		return -1;
-
-	s = zclient->obuf;
 	stream_reset(s);
 
 	zclient_create_header(s, ZEBRA_OPAQUE_MESSAGE, VRF_DEFAULT);
@@ -1614,6 +1603,24 @@ int ls_send_msg(struct zclient *zclient, struct ls_message *msg,
 	} else {
 		stream_putw(s, flags);
 	}
+}
+
+int ls_send_msg(struct zclient *zclient, struct ls_message *msg,
+		struct zapi_opaque_reg_info *dst)
+{
+	struct stream *s;
+
+	/* Check if we have a valid message */
+	if (msg->event == LS_MSG_EVENT_UNDEF)
+		return -1;
+
+	/* Check buffer size */
+	if (STREAM_SIZE(zclient->obuf) <
+	    (ZEBRA_HEADER_SIZE + sizeof(uint32_t) + sizeof(msg)))
+		return -1;
+
+	s = zclient->obuf;
+	ls_create_msg_header(s, dst);
 
 	/* Format Link State message */
 	if (ls_format_msg(s, msg) < 0) {
@@ -1891,6 +1898,33 @@ void ls_delete_msg(struct ls_message *msg)
 	XFREE(MTYPE_LS_DB, msg);
 }
 
+/*
+ * Appends a message to the batch being built in zclient->obuf, sending the
+ * batch first if the message doesn't fit anymore.  buf is scratch space.
+ */
+static int ls_sync_add(struct zclient *zclient, struct stream *buf,
+		       struct ls_message *msg, struct zapi_opaque_reg_info *dst)
+{
+	struct stream *s = zclient->obuf;
+
+	if (msg->event == LS_MSG_EVENT_UNDEF)
+		return 0;
+
+	stream_reset(buf);
+	if (ls_format_msg(buf, msg) < 0)
+		return -1;
+
+	if (STREAM_WRITEABLE(s) < stream_get_endp(buf)) {
+		stream_putw_at(s, 0, stream_get_endp(s));
+		if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE)
+			return -1;
+		ls_create_msg_header(s, dst);
+	}
+
+	stream_put(s, STREAM_DATA(buf), stream_get_endp(buf));
+	return 0;
+}
+
 int ls_sync_ted(struct ls_ted *ted, struct zclient *zclient,
 		struct zapi_opaque_reg_info *dst)
 {
@@ -1898,21 +1932,48 @@ int ls_sync_ted(struct ls_ted *ted, struct zclient *zclient,
 	struct ls_edge *edge;
 	struct ls_subnet *subnet;
 	struct ls_message msg;
+	struct stream *s = zclient->obuf, *buf;
+	size_t hdr_len;
+	int rc = 0;
+
+	/*
+	 * Pack as many elements as fit into each message: a consumer like
+	 * pathd then handles the whole batch in one go rather than one
+	 * element per message.
+	 */
+	buf = stream_new(STREAM_SIZE(s));
+	ls_create_msg_header(s, dst);
+	hdr_len = stream_get_endp(s);
 
 	/* Loop TED, start sending Node, then Attributes and finally Prefix */
 	frr_each(vertices, &ted->vertices, vertex) {
 		ls_vertex2msg(&msg, vertex);
-		ls_send_msg(zclient, &msg, dst);
+		if (ls_sync_add(zclient, buf, &msg, dst) < 0)
+			goto out;
 	}
 	frr_each(edges, &ted->edges, edge) {
 		ls_edge2msg(&msg, edge);
-		ls_send_msg(zclient, &msg, dst);
+		if (ls_sync_add(zclient, buf, &msg, dst) < 0)
+			goto out;
 	}
 	frr_each(subnets, &ted->subnets, subnet) {
 		ls_subnet2msg(&msg, subnet);
-		ls_send_msg(zclient, &msg, dst);
+		if (ls_sync_add(zclient, buf, &msg, dst) < 0)
+			goto out;
 	}
-	return 0;
+
+	if (stream_get_endp(s) > hdr_len) {
+		stream_putw_at(s, 0, stream_get_endp(s));
+		if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE)
+			rc = -1;
+	}
+	stream_free(buf);
+	return rc;
+
+out:
+	stream_reset(s);
+	stream_free(buf);
+	return -1;
 }
 
 /**
@@ -1019,7 +1019,8 @@ extern struct ls_element *ls_stream2ted(struct ls_ted *ted, struct stream *s,
  * Send all the content of the Link State Data Base to the given destination.
  * Link State content is sent is this order: Vertices, Edges, Subnet.
  * This function must be used when a daemon request a Link State Data Base
- * Synchronization.
+ * Synchronization. Several Link State messages are packed in each ZAPI
+ * message, receivers must parse the stream until it is empty.
  *
  * @param ted		Link State Data Base. Must not be NULL
  * @param zclient	Zebra Client. Must not be NULL
@@ -25,6 +25,7 @@
 #include "lib/log.h"
 #include "lib/zlog_targets.h"
 #include "lib/zlog_5424.h"
+#include "lib/zlog_events.h"
 #include "lib/lib_errors.h"
 #include "lib/printfrr.h"
 #include "lib/systemd.h"
@@ -39,6 +40,7 @@ DEFINE_HOOK(zlog_rotate, (), ());
 DEFINE_HOOK(zlog_cli_show, (struct vty * vty), (vty));
 
 static unsigned logmsgs_with_persist_bt;
+static unsigned logmsgs_sampled;
 
 static const int log_default_lvl = LOG_DEBUG;
 
@@ -230,6 +232,22 @@ DEFUN_NOSH (show_logging,
 	vty_out(vty, "Record priority: %s\n",
 		(zt_file.record_priority ? "enabled" : "disabled"));
 	vty_out(vty, "Timestamp precision: %d\n", zt_file.ts_subsec);
+	if (zlog_events_prio_min != ZLOG_DISABLED)
+		vty_out(vty, "Event ring: level %s, %zu kB\n",
+			zlog_priority[zlog_events_prio_min],
+			zlog_events_get_size() / 1024);
+	else
+		vty_out(vty, "Event ring: disabled\n");
+
+	if (zt_file.async) {
+		size_t queued, dropped;
+
+		zlog_file_async_stats(&queued, &dropped);
+		vty_out(vty,
+			"Asynchronous writes: enabled, %zu bytes queued, %zu messages dropped\n",
+			queued, dropped);
+	} else
+		vty_out(vty, "Asynchronous writes: disabled\n");
 
 	hook_call(zlog_cli_show, vty);
 	return CMD_SUCCESS;
@@ -343,6 +361,112 @@ DEFPY_NOSH (debug_uid_backtrace,
 	return CMD_SUCCESS;
 }
 
+DEFPY_NOSH (debug_uid_sample,
+	    debug_uid_sample_cmd,
+	    "[no] debug unique-id UID sample [(2-1000000)$every]",
+	    NO_STR
+	    DEBUG_STR
+	    "Options per individual log message, by unique ID\n"
+	    "Log message unique ID (XXXXX-XXXXX)\n"
+	    "Only log some of the occurrences of this message\n"
+	    "Log one in this many\n")
+{
+	struct xrefdata search, *xrd;
+	struct xrefdata_logmsg *xrdl;
+
+	if (!no && !every) {
+		vty_out(vty, "%% sampling rate required\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	strlcpy(search.uid, uid, sizeof(search.uid));
+	xrd = xrefdata_uid_find(&xrefdata_uid, &search);
+
+	if (!xrd)
+		return CMD_ERR_NOTHING_TODO;
+
+	if (xrd->xref->type != XREFT_LOGMSG) {
+		vty_out(vty, "%% ID \"%s\" is not a log message\n", uid);
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+	xrdl = container_of(xrd, struct xrefdata_logmsg, xrefdata);
+
+	if (!xrdl->sample != !!no)
+		logmsgs_sampled += no ? -1 : 1;
+	xrdl->sample = no ? 0 : every;
+	return CMD_SUCCESS;
+}
+
+DEFPY (log_ratelimit,
+       log_ratelimit_cmd,
+       "log ratelimit (1-1000000)$rate [burst (1-1000000)$burst]",
+       "Logging control\n"
+       "Limit debug messages from each individual call site\n"
+       "Messages per second\n"
+       "Allow short bursts above the rate\n"
+       "Number of messages\n")
+{
+	zlog_set_ratelimit(rate, burst_str ? burst : rate);
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_log_ratelimit,
+       no_log_ratelimit_cmd,
+       "no log ratelimit [(1-1000000) [burst (1-1000000)]]",
+       NO_STR
+       "Logging control\n"
+       "Limit debug messages from each individual call site\n"
+       "Messages per second\n"
+       "Allow short bursts above the rate\n"
+       "Number of messages\n")
+{
+	zlog_set_ratelimit(0, 0);
+	return CMD_SUCCESS;
+}
+
+DEFPY (show_logging_suppressed,
+       show_logging_suppressed_cmd,
+       "show logging suppressed [all$all]",
+       SHOW_STR
+       "Show current logging configuration\n"
+       "Messages not logged due to sampling or rate limits\n"
+       "Include messages with nothing suppressed\n")
+{
+	struct xrefdata *xrd;
+	struct xrefdata_logmsg *xrdl;
+	const struct xref_logmsg *xrl;
+	unsigned int rate, burst;
+	size_t nsupp;
+
+	zlog_get_ratelimit(&rate, &burst);
+	if (rate)
+		vty_out(vty, "Rate limit: %u/s, burst %u\n", rate, burst);
+	else
+		vty_out(vty, "Rate limit: disabled\n");
+
+	vty_out(vty, "%-11s %10s %7s  %s\n", "Unique ID", "Suppressed",
+		"Sample", "Location");
+
+	frr_each (xrefdata_uid, &xrefdata_uid, xrd) {
+		if (xrd->xref->type != XREFT_LOGMSG)
+			continue;
+
+		xrdl = container_of(xrd, struct xrefdata_logmsg, xrefdata);
+		nsupp = atomic_load_explicit(&xrdl->suppressed,
+						  memory_order_relaxed);
+		if (!nsupp && !xrdl->sample && !all)
+			continue;
+
+		xrl = container_of(xrd->xref, struct xref_logmsg, xref);
+		vty_out(vty, "%-11s %10zu %7u  %s:%d %s()\n", xrd->uid,
+			nsupp, xrdl->sample, xrl->xref.file,
+			xrl->xref.line, xrl->xref.func);
+		vty_out(vty, "%-11s %10s %7s  \"%s\"\n", "", "", "",
+			xrl->fmtstring);
+	}
+	return CMD_SUCCESS;
+}
+
 static int set_log_file(struct zlog_cfg_file *target, struct vty *vty,
 			const char *fname, int loglevel)
 {
@@ -756,6 +880,64 @@ DEFPY (show_log_filter,
 	return CMD_SUCCESS;
 }
 
+DEFPY (config_log_event_ring,
+       config_log_event_ring_cmd,
+       "log event-ring [<emergencies|alerts|critical|errors|warnings|notifications|informational|debugging>$levelarg] [size (64-1048576)$kbytes]",
+       "Logging control\n"
+       "Record unformatted messages in a ring for external collection\n"
+       LOG_LEVEL_DESC
+       "Ring size\n"
+       "Size in kilobytes\n")
+{
+	int level;
+
+	if (levelarg) {
+		level = log_level_match(levelarg);
+		if (level == ZLOG_DISABLED)
+			return CMD_ERR_NO_MATCH;
+	} else
+		level = log_default_lvl;
+
+	if (!zlog_events_set(level, (kbytes_str ? kbytes : 1024) * 1024)) {
+		vty_out(vty, "%% failed to set up event ring: %s\n",
+			safe_strerror(errno));
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_config_log_event_ring,
+       no_config_log_event_ring_cmd,
+       "no log event-ring [<emergencies|alerts|critical|errors|warnings|notifications|informational|debugging>] [size (64-1048576)]",
+       NO_STR
+       "Logging control\n"
+       "Record unformatted messages in a ring for external collection\n"
+       LOG_LEVEL_DESC
+       "Ring size\n"
+       "Size in kilobytes\n")
+{
+	zlog_events_set(ZLOG_DISABLED, 0);
+	return CMD_SUCCESS;
+}
+
+DEFPY (log_async_write,
+       log_async_write_cmd,
+       "[no] log async-write",
+       NO_STR
+       "Logging control\n"
+       "Write log files and stdout from a separate thread\n")
+{
+	zt_file.async = !no;
+	zlog_file_set_other(&zt_file);
+	if (!stdout_journald_in_use) {
+		zt_stdout_file.async = !no;
+		zlog_file_set_other(&zt_stdout_file);
+	}
+	zt_filterfile.parent.async = !no;
+	zlog_file_set_other(&zt_filterfile.parent);
+	return CMD_SUCCESS;
+}
+
 /* Enable/disable 'immediate' mode, with no output buffering */
 DEFPY (log_immediate_mode,
        log_immediate_mode_cmd,
@@ -771,6 +953,8 @@ DEFPY (log_immediate_mode,
 void log_config_write(struct vty *vty)
 {
 	bool show_cmdline_hint = false;
+	unsigned int rl_rate, rl_burst;
+	bool header = false;
 
 	if (zt_file.prio_min != ZLOG_DISABLED && zt_file.filename) {
 		vty_out(vty, "log file %s", zt_file.filename);
@@ -843,26 +1027,53 @@ void log_config_write(struct vty *vty)
 		vty_out(vty, "log timestamp precision %d\n",
 			zt_file.ts_subsec);
 
+	if (zt_file.async)
+		vty_out(vty, "log async-write\n");
+
+	if (zlog_events_prio_min != ZLOG_DISABLED) {
+		vty_out(vty, "log event-ring");
+		if (zlog_events_prio_min != log_default_lvl)
+			vty_out(vty, " %s", zlog_priority[zlog_events_prio_min]);
+		if (zlog_events_get_size() != 1024 * 1024)
+			vty_out(vty, " size %zu", zlog_events_get_size() / 1024);
+		vty_out(vty, "\n");
+	}
+
+	zlog_get_ratelimit(&rl_rate, &rl_burst);
+	if (rl_rate && rl_burst != rl_rate)
+		vty_out(vty, "log ratelimit %u burst %u\n", rl_rate, rl_burst);
+	else if (rl_rate)
+		vty_out(vty, "log ratelimit %u\n", rl_rate);
+
 	if (!zlog_get_prefix_ec())
 		vty_out(vty, "no log error-category\n");
 	if (!zlog_get_prefix_xid())
 		vty_out(vty, "no log unique-id\n");
 
-	if (logmsgs_with_persist_bt) {
+	if (logmsgs_with_persist_bt || logmsgs_sampled) {
 		struct xrefdata *xrd;
 		struct xrefdata_logmsg *xrdl;
 
-		vty_out(vty, "!\n");
-
 		frr_each (xrefdata_uid, &xrefdata_uid, xrd) {
 			if (xrd->xref->type != XREFT_LOGMSG)
 				continue;
 
 			xrdl = container_of(xrd, struct xrefdata_logmsg,
 					    xrefdata);
+			if (!(xrdl->fl_print_bt & LOGMSG_FLAG_PERSISTENT)
+			    && !xrdl->sample)
+				continue;
+
+			if (!header)
+				vty_out(vty, "!\n");
+			header = true;
+
 			if (xrdl->fl_print_bt & LOGMSG_FLAG_PERSISTENT)
 				vty_out(vty, "debug unique-id %s backtrace\n",
 					xrd->uid);
+			if (xrdl->sample)
+				vty_out(vty, "debug unique-id %s sample %u\n",
+					xrd->uid, xrdl->sample);
 		}
 	}
 }
@@ -920,6 +1131,13 @@ void log_cmd_init(void)
 	install_element(CONFIG_NODE, &config_log_filterfile_cmd);
 	install_element(CONFIG_NODE, &no_config_log_filterfile_cmd);
 	install_element(CONFIG_NODE, &log_immediate_mode_cmd);
+	install_element(CONFIG_NODE, &log_async_write_cmd);
+	install_element(CONFIG_NODE, &config_log_event_ring_cmd);
+	install_element(CONFIG_NODE, &no_config_log_event_ring_cmd);
+	install_element(CONFIG_NODE, &log_ratelimit_cmd);
+	install_element(CONFIG_NODE, &no_log_ratelimit_cmd);
+	install_element(CONFIG_NODE, &debug_uid_sample_cmd);
+	install_element(VIEW_NODE, &show_logging_suppressed_cmd);
 
 	install_element(ENABLE_NODE, &debug_uid_backtrace_cmd);
 	install_element(CONFIG_NODE, &debug_uid_backtrace_cmd);
@@ -17,6 +17,7 @@
 #include <zebra.h>
 
 #include <stdlib.h>
+#include <pthread.h>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
 #endif
@@ -38,11 +39,191 @@ DEFINE_MGROUP(LIB, "libfrr");
 DEFINE_MTYPE(LIB, TMP, "Temporary memory");
 DEFINE_MTYPE(LIB, BITFIELD, "Bitfield memory");
 
-static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
+/* Allocation counters are kept per pthread where possible, so that
+ * allocations from different pthreads don't fight over the memtype's cache
+ * line.  n_alloc and total are plain sums and are added up over all shards
+ * when read; the memtype's own counters are used when no shard is available.
+ * The maximums can't be merged exactly, they are updated when stats are read
+ * from the merged value and each shard's own peak.  This is exact for
+ * memtypes that are only used from one pthread (i.e. most of them.)
+ */
+#ifndef __OpenBSD__
+#define MEMSHARD
+#endif
+
+unsigned int mt_next_idx;
+
+#ifdef MEMSHARD
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+#define MEMSHARD_BLOCK 64
+#define MEMSHARD_BLOCKS 64
+#define MEMSHARD_MAX (MEMSHARD_BLOCK * MEMSHARD_BLOCKS)
+
+struct memshard_cnt {
+	/* net for this pthread, may go "below zero" (wrap) if it frees
+	 * memory that was allocated on another one
+	 */
+	atomic_size_t n_alloc, n_peak;
+	atomic_size_t total, t_peak;
+};
+
+struct memshard {
+	struct memshard *next;
+	char name[32];
+
+	/* struct memshard_cnt[MEMSHARD_BLOCK], allocated on first use.  Only
+	 * written by the owning pthread.
+	 */
+	atomic_uintptr_t blocks[MEMSHARD_BLOCKS];
+};
+
+/* memshard_list holds shards of running pthreads, memshard_exited the sum
+ * of all that have exited.  Requires: memshard_mtx
+ */
+static pthread_mutex_t memshard_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct memshard *memshard_list;
+static struct memshard memshard_exited = {.name = "(exited)"};
+static pthread_key_t memshard_key;
+
+static thread_local struct memshard *mt_shard
+	__attribute__((tls_model("initial-exec")));
+static thread_local bool mt_shard_exited
+	__attribute__((tls_model("initial-exec")));
+
+static struct memshard_cnt *memshard_cnt(struct memshard *sh,
+					 unsigned int idx, bool create)
+{
+	atomic_uintptr_t *blkp = &sh->blocks[idx / MEMSHARD_BLOCK];
+	struct memshard_cnt *blk;
+
+	blk = (struct memshard_cnt *)atomic_load_explicit(blkp,
+							  memory_order_acquire);
+	if (!blk && create) {
+		blk = calloc(MEMSHARD_BLOCK, sizeof(*blk));
+		if (!blk)
+			return NULL;
+		atomic_store_explicit(blkp, (uintptr_t)blk,
+				      memory_order_release);
+	}
+	return blk ? &blk[idx % MEMSHARD_BLOCK] : NULL;
+}
+
+static void memshard_exit(void *arg)
+{
+	struct memshard *sh = arg, **pp;
+	struct memshard_cnt *blk, *dst;
+	unsigned int i, j;
+
+	/* anything freed from here on (other TLS destructors) is counted on
+	 * the memtype itself
+	 */
+	mt_shard_exited = true;
+	mt_shard = NULL;
+
+	pthread_mutex_lock(&memshard_mtx);
+	for (pp = &memshard_list; *pp; pp = &(*pp)->next)
+		if (*pp == sh) {
+			*pp = sh->next;
+			break;
+		}
+
+	for (i = 0; i < MEMSHARD_BLOCKS; i++) {
+		blk = (struct memshard_cnt *)sh->blocks[i];
+		if (!blk)
+			continue;
+
+		for (j = 0; j < MEMSHARD_BLOCK; j++) {
+			dst = memshard_cnt(&memshard_exited,
+					   i * MEMSHARD_BLOCK + j, true);
+			if (!dst)
+				continue;
+			dst->n_alloc += blk[j].n_alloc;
+			dst->total += blk[j].total;
+		}
+		free(blk);
+	}
+	pthread_mutex_unlock(&memshard_mtx);
+
+	free(sh);
+}
+
+static void memshard_key_init(void) __attribute__((_CONSTRUCTOR(500)));
+static void memshard_key_init(void)
+{
+	pthread_key_create(&memshard_key, memshard_exit);
+}
+
+static struct memshard *memshard_get(void)
+{
+	struct memshard *sh = mt_shard;
+
+	if (__builtin_expect(sh != NULL, 1) || mt_shard_exited)
+		return sh;
+
+	sh = calloc(1, sizeof(*sh));
+	if (!sh)
+		return NULL;
+
+	pthread_mutex_lock(&memshard_mtx);
+	sh->next = memshard_list;
+	memshard_list = sh;
+	pthread_mutex_unlock(&memshard_mtx);
+
+	pthread_setspecific(memshard_key, sh);
+	mt_shard = sh;
+	return sh;
+}
+
+static inline struct memshard_cnt *mt_shard_cnt(struct memtype *mt)
+{
+	struct memshard *sh;
+
+	if (mt->idx >= MEMSHARD_MAX)
+		return NULL;
+
+	sh = memshard_get();
+	return sh ? memshard_cnt(sh, mt->idx, true) : NULL;
+}
+
+/* only the owning pthread writes, so no atomic RMW needed */
+static inline void memshard_add(atomic_size_t *val, atomic_size_t *peak,
+				size_t n)
+{
+	size_t cur = atomic_load_explicit(val, memory_order_relaxed) + n;
+
+	atomic_store_explicit(val, cur, memory_order_relaxed);
+	if (peak && (ssize_t)cur
+			    > (ssize_t)atomic_load_explicit(
+				    peak, memory_order_relaxed))
+		atomic_store_explicit(peak, cur, memory_order_relaxed);
+}
+#endif /* MEMSHARD */
+
+static inline void mt_count_obj(struct memtype *mt, size_t size)
 {
 	size_t current;
 	size_t oldsize;
 
+	oldsize = atomic_load_explicit(&mt->size, memory_order_relaxed);
+	if (oldsize == 0)
+		oldsize = atomic_exchange_explicit(&mt->size, size,
+						   memory_order_relaxed);
+	if (oldsize != 0 && oldsize != size && oldsize != SIZE_VAR)
+		atomic_store_explicit(&mt->size, SIZE_VAR,
+				      memory_order_relaxed);
+
+#ifdef MEMSHARD
+	struct memshard_cnt *cnt = mt_shard_cnt(mt);
+
+	if (cnt) {
+		memshard_add(&cnt->n_alloc, &cnt->n_peak, 1);
+		return;
+	}
+#endif
+
 	current = 1 + atomic_fetch_add_explicit(&mt->n_alloc, 1,
 						memory_order_relaxed);
 
@@ -53,17 +234,38 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 						      current,
 						      memory_order_relaxed,
 						      memory_order_relaxed);
+}
 
-	oldsize = atomic_load_explicit(&mt->size, memory_order_relaxed);
-	if (oldsize == 0)
-		oldsize = atomic_exchange_explicit(&mt->size, size,
-						   memory_order_relaxed);
-	if (oldsize != 0 && oldsize != size && oldsize != SIZE_VAR)
-		atomic_store_explicit(&mt->size, SIZE_VAR,
-				      memory_order_relaxed);
+static inline void mt_count_obj_free(struct memtype *mt)
+{
+#ifdef MEMSHARD
+	struct memshard_cnt *cnt = mt_shard_cnt(mt);
+
+	if (cnt) {
+		memshard_add(&cnt->n_alloc, NULL, -1);
+		return;
+	}
+#else
+	/* with shards, the memtype's counter alone may well be zero */
+	assert(mt->n_alloc);
+#endif
+	atomic_fetch_sub_explicit(&mt->n_alloc, 1, memory_order_relaxed);
+}
 
+static inline void mt_count_bytes(struct memtype *mt, size_t mallocsz)
+{
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t current;
+	size_t oldsize;
+
+#ifdef MEMSHARD
+	struct memshard_cnt *cnt = mt_shard_cnt(mt);
+
+	if (cnt) {
+		memshard_add(&cnt->total, &cnt->t_peak, mallocsz);
+		return;
+	}
+#endif
 
 	current = mallocsz + atomic_fetch_add_explicit(&mt->total, mallocsz,
 						       memory_order_relaxed);
@@ -77,17 +279,36 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 #endif
 }
 
-static inline void mt_count_free(struct memtype *mt, void *ptr)
+static inline void mt_count_bytes_free(struct memtype *mt, size_t mallocsz)
 {
-	frrtrace(2, frr_libfrr, memfree, mt, ptr);
+#ifdef HAVE_MALLOC_USABLE_SIZE
+#ifdef MEMSHARD
+	struct memshard_cnt *cnt = mt_shard_cnt(mt);
 
-	assert(mt->n_alloc);
-	atomic_fetch_sub_explicit(&mt->n_alloc, 1, memory_order_relaxed);
+	if (cnt) {
+		memshard_add(&cnt->total, NULL, -mallocsz);
+		return;
+	}
+#endif
+	atomic_fetch_sub_explicit(&mt->total, mallocsz, memory_order_relaxed);
+#endif
+}
 
+static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
+{
+	mt_count_obj(mt, size);
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	mt_count_bytes(mt, malloc_usable_size(ptr));
+#endif
+}
 
-	atomic_fetch_sub_explicit(&mt->total, mallocsz, memory_order_relaxed);
+static inline void mt_count_free(struct memtype *mt, void *ptr)
+{
+	frrtrace(2, frr_libfrr, memfree, mt, ptr);
+
+	mt_count_obj_free(mt);
+#ifdef HAVE_MALLOC_USABLE_SIZE
+	mt_count_bytes_free(mt, malloc_usable_size(ptr));
 #endif
 }
 
@@ -141,6 +362,379 @@ void qfree(struct memtype *mt, void *ptr)
 	free(ptr);
 }
 
+#if defined(__SANITIZE_ADDRESS__)
+#define MEMSLAB_DISABLED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEMSLAB_DISABLED
+#endif
+#endif
+
+#ifndef MEMSLAB_DISABLED
+#define MEMSLAB_CHUNK_SIZE (64 * 1024)
+#define MEMSLAB_ALIGN 16
+#define MEMSLAB_ROUNDUP(x) (((x) + MEMSLAB_ALIGN - 1) & ~(MEMSLAB_ALIGN - 1))
+
+/* chunks are MEMSLAB_CHUNK_SIZE aligned, so the chunk can be found from the
+ * object pointer.  Objects start MEMSLAB_HDR bytes into the chunk.
+ */
+struct memslab_chunk {
+	/* on memslab->partial while not full */
+	struct memslab_chunk *prev, *next;
+
+	/* freed objects, linked through their first word */
+	void *free;
+	/* objects in use, and objects ever carved off the chunk */
+	unsigned int used, carved;
+};
+
+#define MEMSLAB_HDR MEMSLAB_ROUNDUP(sizeof(struct memslab_chunk))
+
+struct memslab {
+	pthread_mutex_t mtx;
+
+	size_t objsize;
+	unsigned int per_chunk;
+
+	/* chunks with at least one free object.  Requires: mtx */
+	struct memslab_chunk *partial;
+	/* one empty chunk is kept so that alloc/free at a chunk boundary
+	 * doesn't go back to the system every time.  Requires: mtx
+	 */
+	struct memslab_chunk *spare;
+
+	/* Requires: mtx */
+	size_t chunks;
+	size_t used;
+};
+
+static pthread_mutex_t memslab_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static struct memslab *memslab_get(struct memtype *mt, size_t size)
+{
+	struct memslab *slab;
+
+	slab = (struct memslab *)atomic_load_explicit(&mt->slab,
+						      memory_order_acquire);
+	if (slab)
+		return slab;
+
+	pthread_mutex_lock(&memslab_mtx);
+	slab = (struct memslab *)atomic_load_explicit(&mt->slab,
+						      memory_order_relaxed);
+	if (!slab) {
+		slab = calloc(1, sizeof(*slab));
+		if (!slab)
+			memory_oom(sizeof(*slab), mt->name);
+
+		pthread_mutex_init(&slab->mtx, NULL);
+		slab->objsize = MEMSLAB_ROUNDUP(size);
+		slab->per_chunk =
+			(MEMSLAB_CHUNK_SIZE - MEMSLAB_HDR) / slab->objsize;
+		assert(slab->per_chunk > 1);
+
+		atomic_store_explicit(&mt->slab, (uintptr_t)slab,
+				      memory_order_release);
+	}
+	pthread_mutex_unlock(&memslab_mtx);
+	return slab;
+}
+
+static void memslab_partial_add(struct memslab *slab, struct memslab_chunk *c)
+{
+	c->prev = NULL;
+	c->next = slab->partial;
+	if (c->next)
+		c->next->prev = c;
+	slab->partial = c;
+}
+
+static void memslab_partial_del(struct memslab *slab, struct memslab_chunk *c)
+{
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		slab->partial = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	c->prev = c->next = NULL;
+}
+
+static struct memslab_chunk *memslab_chunk_new(struct memtype *mt,
+					       struct memslab *slab)
+{
+	void *mem;
+	struct memslab_chunk *c;
+
+	if (posix_memalign(&mem, MEMSLAB_CHUNK_SIZE, MEMSLAB_CHUNK_SIZE))
+		memory_oom(MEMSLAB_CHUNK_SIZE, mt->name);
+
+	c = mem;
+	memset(c, 0, sizeof(*c));
+	slab->chunks++;
+	mt_count_bytes(mt, MEMSLAB_CHUNK_SIZE);
+	return c;
+}
+
+void *qslab_alloc(struct memtype *mt, size_t size)
+{
+	struct memslab *slab = memslab_get(mt, size);
+	struct memslab_chunk *c;
+	void *ptr;
+
+	assert(size <= slab->objsize);
+
+	pthread_mutex_lock(&slab->mtx);
+	c = slab->partial;
+	if (!c) {
+		c = slab->spare ? slab->spare : memslab_chunk_new(mt, slab);
+		slab->spare = NULL;
+		memslab_partial_add(slab, c);
+	}
+
+	if (c->free) {
+		ptr = c->free;
+		c->free = *(void **)ptr;
+	} else
+		ptr = (char *)c + MEMSLAB_HDR + c->carved++ * slab->objsize;
+
+	slab->used++;
+	if (++c->used == slab->per_chunk)
+		memslab_partial_del(slab, c);
+	pthread_mutex_unlock(&slab->mtx);
+
+	frrtrace(3, frr_libfrr, memalloc, mt, ptr, size);
+	mt_count_obj(mt, size);
+
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void qslab_free(struct memtype *mt, void *ptr)
+{
+	struct memslab *slab;
+	struct memslab_chunk *c, *dead = NULL;
+
+	if (!ptr)
+		return;
+
+	slab = (struct memslab *)atomic_load_explicit(&mt->slab,
+						      memory_order_acquire);
+	assert(slab);
+	c = (struct memslab_chunk *)((uintptr_t)ptr
+				     & ~(uintptr_t)(MEMSLAB_CHUNK_SIZE - 1));
+
+	frrtrace(2, frr_libfrr, memfree, mt, ptr);
+	mt_count_obj_free(mt);
+
+	pthread_mutex_lock(&slab->mtx);
+	*(void **)ptr = c->free;
+	c->free = ptr;
+
+	slab->used--;
+	if (c->used-- == slab->per_chunk)
+		memslab_partial_add(slab, c);
+
+	if (c->used == 0) {
+		memslab_partial_del(slab, c);
+
+		if (!slab->spare) {
+			c->free = NULL;
+			c->carved = 0;
+			slab->spare = c;
+		} else {
+			slab->chunks--;
+			dead = c;
+		}
+	}
+	pthread_mutex_unlock(&slab->mtx);
+
+	if (dead) {
+		mt_count_bytes_free(mt, MEMSLAB_CHUNK_SIZE);
+		free(dead);
+	}
+}
+
+bool mtype_stats_slab(struct memtype *mt, struct memslab_stats *st)
+{
+	struct memslab *slab;
+
+	slab = (struct memslab *)atomic_load_explicit(&mt->slab,
+						      memory_order_acquire);
+	if (!slab)
+		return false;
+
+	pthread_mutex_lock(&slab->mtx);
+	st->objsize = slab->objsize;
+	st->chunks = slab->chunks;
+	st->used = slab->used;
+	st->capacity = slab->chunks * slab->per_chunk;
+	pthread_mutex_unlock(&slab->mtx);
+	return true;
+}
+#else /* MEMSLAB_DISABLED */
+void *qslab_alloc(struct memtype *mt, size_t size)
+{
+	return qcalloc(mt, size);
+}
+
+void qslab_free(struct memtype *mt, void *ptr)
+{
+	qfree(mt, ptr);
+}
+
+bool mtype_stats_slab(struct memtype *mt, struct memslab_stats *st)
+{
+	return false;
+}
+#endif /* MEMSLAB_DISABLED */
+
+static inline void mt_stats_max(atomic_size_t *max, size_t val)
+{
+	/* shards aren't read atomically as a whole, the sum can be
+	 * transiently "negative" when memory moves between pthreads
+	 */
+	if ((ssize_t)val < 0)
+		return;
+	if (val > atomic_load_explicit(max, memory_order_relaxed))
+		atomic_store_explicit(max, val, memory_order_relaxed);
+}
+
+void mtype_stats(struct memtype *mt, struct memtype_stats *st)
+{
+	size_t n_alloc, total = 0;
+
+	n_alloc = atomic_load_explicit(&mt->n_alloc, memory_order_relaxed);
+#ifdef HAVE_MALLOC_USABLE_SIZE
+	total = atomic_load_explicit(&mt->total, memory_order_relaxed);
+#endif
+
+#ifdef MEMSHARD
+	struct memshard *sh;
+	struct memshard_cnt *cnt;
+
+	pthread_mutex_lock(&memshard_mtx);
+	if (mt->idx < MEMSHARD_MAX) {
+		cnt = memshard_cnt(&memshard_exited, mt->idx, false);
+		if (cnt) {
+			n_alloc += cnt->n_alloc;
+			total += cnt->total;
+		}
+
+		for (sh = memshard_list; sh; sh = sh->next) {
+			cnt = memshard_cnt(sh, mt->idx, false);
+			if (!cnt)
+				continue;
+			n_alloc += atomic_load_explicit(&cnt->n_alloc,
+							memory_order_relaxed);
+			total += atomic_load_explicit(&cnt->total,
+						      memory_order_relaxed);
+		}
+
+		/* peak of each pthread, others unchanged */
+		for (sh = memshard_list; sh; sh = sh->next) {
+			cnt = memshard_cnt(sh, mt->idx, false);
+			if (!cnt)
+				continue;
+			mt_stats_max(&mt->n_max,
+				     n_alloc - cnt->n_alloc + cnt->n_peak);
+#ifdef HAVE_MALLOC_USABLE_SIZE
+			mt_stats_max(&mt->max_size,
+				     total - cnt->total + cnt->t_peak);
+#endif
+		}
+	}
+	pthread_mutex_unlock(&memshard_mtx);
+#endif
+
+	if ((ssize_t)n_alloc < 0)
+		n_alloc = 0;
+	if ((ssize_t)total < 0)
+		total = 0;
+
+	mt_stats_max(&mt->n_max, n_alloc);
+	st->n_alloc = n_alloc;
+	st->n_max = atomic_load_explicit(&mt->n_max, memory_order_relaxed);
+	st->size = atomic_load_explicit(&mt->size, memory_order_relaxed);
+#ifdef HAVE_MALLOC_USABLE_SIZE
+	mt_stats_max(&mt->max_size, total);
+	st->total = total;
+	st->max_size = atomic_load_explicit(&mt->max_size,
+					    memory_order_relaxed);
+#else
+	st->total = st->max_size = 0;
+#endif
+}
+
+size_t mtype_stats_alloc(struct memtype *mt)
+{
+	struct memtype_stats st;
+
+	mtype_stats(mt, &st);
+	return st.n_alloc;
+}
+
+void mtype_stats_threads(struct memtype *mt, qmem_thread_fn *func, void *arg)
+{
+#ifdef MEMSHARD
+	struct memshard *sh;
+	struct memshard_cnt *cnt;
+	struct {
+		char name[32];
+		size_t n_alloc, total;
+	} *items = NULL;
+	size_t i, n = 0, alloc = 0;
+
+	if (mt->idx >= MEMSHARD_MAX)
+		return;
+
+	/* copy out, func may well allocate memory itself */
+	pthread_mutex_lock(&memshard_mtx);
+	for (sh = memshard_list; sh; sh = sh->next)
+		alloc++;
+	items = calloc(alloc + 1, sizeof(*items));
+
+	for (sh = items ? memshard_list : NULL; sh; sh = sh->next) {
+		cnt = memshard_cnt(sh, mt->idx, false);
+		if (!cnt)
+			continue;
+		strlcpy(items[n].name, sh->name[0] ? sh->name : "(unnamed)",
+			sizeof(items[n].name));
+		items[n].n_alloc = cnt->n_alloc;
+		items[n].total = cnt->total;
+		n++;
+	}
+	cnt = items ? memshard_cnt(&memshard_exited, mt->idx, false) : NULL;
+	if (cnt) {
+		strlcpy(items[n].name, memshard_exited.name,
+			sizeof(items[n].name));
+		items[n].n_alloc = cnt->n_alloc;
+		items[n].total = cnt->total;
+		n++;
+	}
+	pthread_mutex_unlock(&memshard_mtx);
+
+	for (i = 0; i < n; i++)
+		func(arg, items[i].name, (ssize_t)items[i].n_alloc,
+		     (ssize_t)items[i].total);
+	free(items);
+#endif
+}
+
+void qmem_thread_name(const char *name)
+{
+#ifdef MEMSHARD
+	struct memshard *sh = memshard_get();
+
+	if (!sh)
+		return;
+
+	pthread_mutex_lock(&memshard_mtx);
+	strlcpy(sh->name, name, sizeof(sh->name));
+	pthread_mutex_unlock(&memshard_mtx);
+#endif
+}
+
 int qmem_walk(qmem_walk_fn *func, void *arg)
 {
 	struct memgroup *mg;
@@ -166,20 +760,24 @@ struct exit_dump_args {
 static int qmem_exit_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 {
 	struct exit_dump_args *eda = arg;
+	struct memtype_stats st;
 
 	if (!mt) {
 		fprintf(eda->fp,
 			"%s: showing active allocations in memory group %s\n",
 			eda->prefix, mg->name);
+		return 0;
+	}
 
-	} else if (mt->n_alloc) {
+	mtype_stats(mt, &st);
+	if (st.n_alloc) {
 		char size[32];
 		if (!mg->active_at_exit)
 			eda->error++;
-		snprintf(size, sizeof(size), "%10zu", mt->size);
+		snprintf(size, sizeof(size), "%10zu", st.size);
 		fprintf(eda->fp, "%s: memstats:  %-30s: %6zu * %s\n",
-			eda->prefix, mt->name, mt->n_alloc,
-			mt->size == SIZE_VAR ? "(variably sized)" : size);
+			eda->prefix, mt->name, st.n_alloc,
+			st.size == SIZE_VAR ? "(variably sized)" : size);
 	}
 	return 0;
 }
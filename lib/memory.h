@@ -20,6 +20,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/types.h>
 #include <frratomic.h>
 #include "compiler.h"
 
@@ -33,9 +34,14 @@ extern "C" {
 #endif
 
 #define SIZE_VAR ~0UL
+struct memslab;
+
 struct memtype {
 	struct memtype *next, **ref;
 	const char *name;
+	/* slot in the per-pthread counters, see mtype_stats() */
+	unsigned int idx;
+	/* don't read these directly, use mtype_stats() */
 	atomic_size_t n_alloc;
 	atomic_size_t n_max;
 	atomic_size_t size;
@@ -43,6 +49,8 @@ struct memtype {
 	atomic_size_t total;
 	atomic_size_t max_size;
 #endif
+	/* struct memslab *, set on first XSLAB_CALLOC() for this type */
+	atomic_uintptr_t slab;
 };
 
 struct memgroup {
@@ -129,6 +137,8 @@ struct memgroup {
 	{                                                                      \
 		if (_mg_##group.insert == NULL)                                \
 			_mg_##group.insert = &_mg_##group.types;               \
+		extern unsigned int mt_next_idx;                               \
+		MTYPE_##mname->idx = mt_next_idx++;                            \
 		MTYPE_##mname->ref = _mg_##group.insert;                       \
 		*_mg_##group.insert = MTYPE_##mname;                           \
 		_mg_##group.insert = &MTYPE_##mname->next;                      \
@@ -177,10 +187,63 @@ extern void qfree(struct memtype *mt, void *ptr) __attribute__((nonnull(1)));
 		ptr = NULL;                                                    \
 	} while (0)
 
-static inline size_t mtype_stats_alloc(struct memtype *mt)
-{
-	return mt->n_alloc;
-}
+/* Slab allocation, for fixed-size objects that exist in very large numbers.
+ * Objects are carved out of 64KiB chunks kept by the memtype, and a chunk is
+ * given back to the system once all objects in it are freed.  All objects
+ * allocated for one memtype must have the same size and must be released
+ * with XSLAB_FREE().  "Total" in "show memory" counts whole chunks for
+ * these types.
+ *
+ * With AddressSanitizer, these are plain XCALLOC()/XFREE() so that
+ * use-after-free is still caught.
+ */
+extern void *qslab_alloc(struct memtype *mt, size_t size)
+	__attribute__((malloc, _ALLOC_SIZE(2), nonnull(1) _RET_NONNULL));
+extern void qslab_free(struct memtype *mt, void *ptr)
+	__attribute__((nonnull(1)));
+
+#define XSLAB_CALLOC(mtype, size)	qslab_alloc(mtype, size)
+#define XSLAB_FREE(mtype, ptr)                                                 \
+	do {                                                                   \
+		qslab_free(mtype, ptr);                                        \
+		ptr = NULL;                                                    \
+	} while (0)
+
+struct memslab_stats {
+	size_t objsize;
+	size_t chunks;
+	/* objects in use / objects that fit in all chunks */
+	size_t used;
+	size_t capacity;
+};
+
+/* returns false if mt has no slab */
+extern bool mtype_stats_slab(struct memtype *mt, struct memslab_stats *st);
+
+/* Allocation counters are kept per pthread and merged here. */
+struct memtype_stats {
+	size_t n_alloc;
+	size_t n_max;
+	size_t size;
+	size_t total;
+	size_t max_size;
+};
+
+extern void mtype_stats(struct memtype *mt, struct memtype_stats *st);
+extern size_t mtype_stats_alloc(struct memtype *mt);
+
+/* Calls func once for each pthread's share of mt.  These are net values
+ * (allocations minus frees on that pthread), memory allocated on one pthread
+ * and freed on another shows up as positive on the former and negative on
+ * the latter.  Pthreads that have exited are summed up in one entry.
+ */
+typedef void qmem_thread_fn(void *arg, const char *name, ssize_t n_alloc,
+			    ssize_t total);
+extern void mtype_stats_threads(struct memtype *mt, qmem_thread_fn *func,
+				void *arg);
+
+/* name shown for the calling pthread in the above */
+extern void qmem_thread_name(const char *name);
 
 /* NB: calls are ordered by memgroup; and there is a call with mt == NULL for
  * each memgroup (so that a header can be printed, and empty memgroups show)
@@ -68,6 +68,11 @@ enum nh_encap_type {
 
 /* Nexthop structure. */
 struct nexthop {
+	/*
+	 * The fields used when walking, comparing and hashing nexthop
+	 * groups are kept in the first 64 bytes;  the rest is only looked at
+	 * for some nexthops.  Please keep it that way when adding fields.
+	 */
 	struct nexthop *next;
 	struct nexthop *prev;
 
@@ -102,13 +107,19 @@ struct nexthop {
 	(CHECK_FLAG(flags, NEXTHOP_FLAG_ACTIVE)                                \
 	 && !CHECK_FLAG(flags, NEXTHOP_FLAG_DUPLICATE))
 
+	/* Weight of the nexthop ( for unequal cost ECMP ) */
+	uint8_t weight;
+
+	/* Count of corresponding backup nexthop(s) in a backup list;
+	 * only meaningful if the HAS_BACKUP flag is set.
+	 */
+	uint8_t backup_num;
+
 	/* Nexthop address */
 	union {
 		union g_addr gate;
 		enum blackhole_type bh_type;
 	};
-	union g_addr src;
-	union g_addr rmap_src; /* Src is set via routemap */
 
 	/* Nexthops obtained by recursive resolution.
 	 *
@@ -117,24 +128,18 @@ struct nexthop {
 	 * obtained by recursive resolution will be added to `resolved'.
 	 */
 	struct nexthop *resolved;
-	/* Recursive parent */
-	struct nexthop *rparent;
-
-	/* Type of label(s), if any */
-	enum lsp_types_t nh_label_type;
 
 	/* Label(s) associated with this nexthop. */
 	struct mpls_label_stack *nh_label;
 
-	/* Weight of the nexthop ( for unequal cost ECMP ) */
-	uint8_t weight;
+	/* end of commonly used fields */
 
-	/* Count and index of corresponding backup nexthop(s) in a backup list;
-	 * only meaningful if the HAS_BACKUP flag is set.
-	 */
-	uint8_t backup_num;
+	/* Index of corresponding backup nexthop(s), see backup_num */
 	uint8_t backup_idx[NEXTHOP_MAX_BACKUPS];
 
+	/* Type of label(s), if any */
+	enum lsp_types_t nh_label_type;
+
 	/* Encapsulation information. */
 	enum nh_encap_type nh_encap_type;
 	union {
@@ -144,6 +149,12 @@ struct nexthop {
 	/* SR-TE color used for matching SR-TE policies */
 	uint32_t srte_color;
 
+	union g_addr src;
+	union g_addr rmap_src; /* Src is set via routemap */
+
+	/* Recursive parent */
+	struct nexthop *rparent;
+
 	/* SRv6 information */
 	struct nexthop_srv6 *nh_srv6;
 };
@@ -198,74 +198,50 @@ static struct nexthop *nhg_nh_find(const struct nexthop_group *nhg,
 	return NULL;
 }
 
+/*
+ * The walks below stop at the first difference, including one list being
+ * longer than the other, so there is no need to count the nexthops first.
+ */
 static bool
 nexthop_group_equal_common(const struct nexthop_group *nhg1,
 			   const struct nexthop_group *nhg2,
-			   uint8_t (*nexthop_group_nexthop_num_func)(
-				   const struct nexthop_group *nhg))
+			   struct nexthop *(*next_func)(const struct nexthop *))
 {
-	if (nhg1 && !nhg2)
-		return false;
-
-	if (!nhg1 && nhg2)
-		return false;
+	const struct nexthop *nh1, *nh2;
 
 	if (nhg1 == nhg2)
 		return true;
 
-	if (nexthop_group_nexthop_num_func(nhg1)
-	    != nexthop_group_nexthop_num_func(nhg2))
+	if (!nhg1 || !nhg2)
 		return false;
 
-	return true;
+	for (nh1 = nhg1->nexthop, nh2 = nhg2->nexthop; nh1 && nh2;
+	     nh1 = next_func(nh1), nh2 = next_func(nh2)) {
+		if (!nexthop_same(nh1, nh2))
+			return false;
+	}
+
+	return nh1 == nh2;
+}
+
+static struct nexthop *nexthop_next_no_recurse(const struct nexthop *nh)
+{
+	return nh->next;
 }
 
-/* This assumes ordered */
 bool nexthop_group_equal_no_recurse(const struct nexthop_group *nhg1,
 				    const struct nexthop_group *nhg2)
 {
-	struct nexthop *nh1 = NULL;
-	struct nexthop *nh2 = NULL;
-
-	if (!nexthop_group_equal_common(nhg1, nhg2,
-					&nexthop_group_nexthop_num_no_recurse))
-		return false;
-
-	for (nh1 = nhg1->nexthop, nh2 = nhg2->nexthop; nh1 || nh2;
-	     nh1 = nh1->next, nh2 = nh2->next) {
-		if (nh1 && !nh2)
-			return false;
-		if (!nh1 && nh2)
-			return false;
-		if (!nexthop_same(nh1, nh2))
-			return false;
-	}
-
-	return true;
+	return nexthop_group_equal_common(nhg1, nhg2, nexthop_next_no_recurse);
 }
 
 /* This assumes ordered */
 bool nexthop_group_equal(const struct nexthop_group *nhg1,
 			 const struct nexthop_group *nhg2)
 {
-	struct nexthop *nh1 = NULL;
-	struct nexthop *nh2 = NULL;
-
-	if (!nexthop_group_equal_common(nhg1, nhg2, &nexthop_group_nexthop_num))
-		return false;
-
-	for (nh1 = nhg1->nexthop, nh2 = nhg2->nexthop; nh1 || nh2;
-	     nh1 = nexthop_next(nh1), nh2 = nexthop_next(nh2)) {
-		if (nh1 && !nh2)
-			return false;
-		if (!nh1 && nh2)
-			return false;
-		if (!nexthop_same(nh1, nh2))
-			return false;
-	}
-
-	return true;
+	return nexthop_group_equal_common(nhg1, nhg2, nexthop_next);
 }
+
 struct nexthop_group *nexthop_group_new(void)
 {
 	return XCALLOC(MTYPE_NEXTHOP_GROUP, sizeof(struct nexthop_group));
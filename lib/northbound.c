@@ -35,6 +35,8 @@
 DEFINE_MTYPE_STATIC(LIB, NB_NODE, "Northbound Node");
 DEFINE_MTYPE_STATIC(LIB, NB_CONFIG, "Northbound Configuration");
 DEFINE_MTYPE_STATIC(LIB, NB_CONFIG_ENTRY, "Northbound Configuration Entry");
+DEFINE_MTYPE_STATIC(LIB, NB_CONFIG_EDIT, "Northbound Configuration Edit");
+DEFINE_MTYPE_STATIC(LIB, NB_OPER_CURSOR, "Northbound Operational Cursor");
 
 /* Running configuration - shouldn't be modified directly. */
 struct nb_config *running_config;
@@ -57,6 +59,49 @@ static struct {
 	const void *owner_user;
 } running_config_mgmt_lock;
 
+/*
+ * Changes made to a configuration since it was copied from running_config,
+ * as the paths of the topmost nodes created, modified or deleted.  Past
+ * NB_CONFIG_EDITS_MAX of them a full diff is no more expensive than going
+ * through them one by one, so tracking just stops.
+ */
+#define NB_CONFIG_EDITS_MAX 4096
+
+PREDECL_DLIST(nb_edits);
+PREDECL_HASH(nb_edits_hash);
+
+struct nb_config_edit {
+	struct nb_edits_item itm;
+	struct nb_edits_hash_item hitm;
+
+	/* from lyd_path(), canonical */
+	char *xpath;
+};
+
+static int nb_config_edit_cmp(const struct nb_config_edit *a,
+			      const struct nb_config_edit *b)
+{
+	return strcmp(a->xpath, b->xpath);
+}
+
+static uint32_t nb_config_edit_hash(const struct nb_config_edit *edit)
+{
+	return string_hash_make(edit->xpath);
+}
+
+DECLARE_DLIST(nb_edits, struct nb_config_edit, itm);
+DECLARE_HASH(nb_edits_hash, struct nb_config_edit, hitm, nb_config_edit_cmp,
+	     nb_config_edit_hash);
+
+struct nb_config_edits {
+	/* running_config->version this was copied from */
+	uint32_t base_version;
+
+	/* in order of the edits, for the order of callbacks */
+	struct nb_edits_head list;
+	struct nb_edits_hash_head hash;
+};
+
 /* Knob to record config transaction */
 static bool nb_db_enabled;
 /*
@@ -88,15 +133,32 @@ static int nb_oper_data_iter_node(const struct lysc_node *snode,
 				  const struct yang_list_keys *list_keys,
 				  struct yang_translator *translator,
 				  bool first, uint32_t flags,
+				  struct nb_oper_cursor *cursor,
 				  nb_oper_data_cb cb, void *arg);
 
+/*
+ * Containers and lists start out as config-only;  each state node then clears
+ * the flag on itself and its ancestors.  The walk up stops at the first node
+ * that already had it cleared, since everything above that was cleared along
+ * with it, so this is linear in the schema size rather than rescanning the
+ * subtree below every container and list.
+ */
 static int nb_node_check_config_only(const struct lysc_node *snode, void *arg)
 {
-	bool *config_only = arg;
+	const struct lysc_node *sparent;
+	struct nb_node *nb_node;
+
+	if (!CHECK_FLAG(snode->flags, LYS_CONFIG_R))
+		return YANG_ITER_CONTINUE;
 
-	if (CHECK_FLAG(snode->flags, LYS_CONFIG_R)) {
-		*config_only = false;
-		return YANG_ITER_STOP;
+	for (sparent = snode; sparent; sparent = sparent->parent) {
+		nb_node = sparent->priv;
+		if (!nb_node
+		    || !CHECK_FLAG(sparent->nodetype, LYS_CONTAINER | LYS_LIST))
+			continue;
+		if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY))
+			break;
+		UNSET_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY);
 	}
 
 	return YANG_ITER_CONTINUE;
@@ -118,16 +180,9 @@ static int nb_node_new_cb(const struct lysc_node *snode, void *arg)
 	if (sparent_list)
 		nb_node->parent_list = sparent_list->priv;
 
-	/* Set flags. */
-	if (CHECK_FLAG(snode->nodetype, LYS_CONTAINER | LYS_LIST)) {
-		bool config_only = true;
-
-		(void)yang_snodes_iterate_subtree(snode, NULL,
-						  nb_node_check_config_only, 0,
-						  &config_only);
-		if (config_only)
-			SET_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY);
-	}
+	/* Set flags;  nb_node_check_config_only() fixes up CONFIG_ONLY. */
+	if (CHECK_FLAG(snode->nodetype, LYS_CONTAINER | LYS_LIST))
+		SET_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY);
 	if (CHECK_FLAG(snode->nodetype, LYS_LIST)) {
 		if (yang_snode_num_keys(snode) == 0)
 			SET_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST);
@@ -160,6 +215,7 @@ static int nb_node_del_cb(const struct lysc_node *snode, void *arg)
 void nb_nodes_create(void)
 {
 	yang_snodes_iterate(NULL, nb_node_new_cb, 0, NULL);
+	yang_snodes_iterate(NULL, nb_node_check_config_only, 0, NULL);
 }
 
 void nb_nodes_delete(void)
@@ -313,10 +369,98 @@ struct nb_config *nb_config_new(struct lyd_node *dnode)
 	return config;
 }
 
+static void nb_config_edits_free(struct nb_config *config)
+{
+	struct nb_config_edits *edits = config->edits;
+	struct nb_config_edit *edit;
+
+	if (!edits)
+		return;
+
+	config->edits = NULL;
+	while ((edit = nb_edits_pop(&edits->list))) {
+		nb_edits_hash_del(&edits->hash, edit);
+		free(edit->xpath);
+		XFREE(MTYPE_NB_CONFIG_EDIT, edit);
+	}
+	nb_edits_hash_fini(&edits->hash);
+	nb_edits_fini(&edits->list);
+	XFREE(MTYPE_NB_CONFIG_EDIT, edits);
+}
+
+/* config is (again) identical to running_config, start recording edits. */
+static void nb_config_edits_start(struct nb_config *config)
+{
+	nb_config_edits_free(config);
+
+	config->edits = XCALLOC(MTYPE_NB_CONFIG_EDIT, sizeof(*config->edits));
+	config->edits->base_version = running_config->version;
+	nb_edits_init(&config->edits->list);
+	nb_edits_hash_init(&config->edits->hash);
+}
+
+static void nb_config_edits_add(struct nb_config *config,
+				const struct lyd_node *dnode)
+{
+	struct nb_config_edits *edits = config->edits;
+	struct nb_config_edit *edit, ref;
+
+	if (!edits)
+		return;
+
+	if (nb_edits_count(&edits->list) >= NB_CONFIG_EDITS_MAX) {
+		nb_config_edits_free(config);
+		return;
+	}
+
+	ref.xpath = lyd_path(dnode, LYD_PATH_STD, NULL, 0);
+	if (!ref.xpath) {
+		nb_config_edits_free(config);
+		return;
+	}
+	if (nb_edits_hash_find(&edits->hash, &ref)) {
+		free(ref.xpath);
+		return;
+	}
+
+	edit = XCALLOC(MTYPE_NB_CONFIG_EDIT, sizeof(*edit));
+	edit->xpath = ref.xpath;
+	nb_edits_add_tail(&edits->list, edit);
+	nb_edits_hash_add(&edits->hash, edit);
+}
+
+/* Can config be diffed/validated against running_config by its edits? */
+static bool nb_config_edits_usable(const struct nb_config *config)
+{
+	return config->edits
+	       && config->edits->base_version == running_config->version;
+}
+
+/* Is some parent of dnode recorded as edited itself? */
+static bool nb_config_edits_covered(const struct nb_config_edits *edits,
+				    const struct lyd_node *dnode)
+{
+	const struct lyd_node *parent;
+	struct nb_config_edit ref;
+	bool found;
+
+	for (parent = lyd_parent(dnode); parent; parent = lyd_parent(parent)) {
+		ref.xpath = lyd_path(parent, LYD_PATH_STD, NULL, 0);
+		if (!ref.xpath)
+			continue;
+		found = !!nb_edits_hash_const_find(&edits->hash, &ref);
+		free(ref.xpath);
+		if (found)
+			return true;
+	}
+	return false;
+}
+
 void nb_config_free(struct nb_config *config)
 {
 	if (config->dnode)
 		yang_dnode_free(config->dnode);
+	nb_config_edits_free(config);
 	XFREE(MTYPE_NB_CONFIG, config);
 }
 
@@ -327,6 +471,8 @@ struct nb_config *nb_config_dup(const struct nb_config *config)
 	dup = XCALLOC(MTYPE_NB_CONFIG, sizeof(*dup));
 	dup->dnode = yang_dnode_dup(config->dnode);
 	dup->version = config->version;
+	if (config == running_config)
+		nb_config_edits_start(dup);
 
 	return dup;
 }
@@ -339,6 +485,7 @@ int nb_config_merge(struct nb_config *config_dst, struct nb_config *config_src,
 	ret = lyd_merge_siblings(&config_dst->dnode, config_src->dnode, 0);
 	if (ret != 0)
 		flog_warn(EC_LIB_LIBYANG, "%s: lyd_merge() failed", __func__);
+	nb_config_edits_free(config_dst);
 
 	if (!preserve_source)
 		nb_config_free(config_src);
@@ -356,6 +503,10 @@ void nb_config_replace(struct nb_config *config_dst,
 	/* Update dnode. */
 	if (config_dst->dnode)
 		yang_dnode_free(config_dst->dnode);
+	if (config_src == running_config)
+		nb_config_edits_start(config_dst);
+	else
+		nb_config_edits_free(config_dst);
 	if (preserve_source) {
 		config_dst->dnode = yang_dnode_dup(config_src->dnode);
 	} else {
@@ -538,51 +689,20 @@ static inline void nb_config_diff_dnode_log(const char *context,
 }
 #endif
 
-/* Calculate the delta between two different configurations. */
-static void nb_config_diff(const struct nb_config *config1,
-			   const struct nb_config *config2,
-			   struct nb_config_cbs *changes)
+/*
+ * Turn a libyang diff between config1 and config2 into northbound
+ * callbacks.
+ */
+static void nb_config_diff_walk(const struct lyd_node *diff,
+				const struct nb_config *config1,
+				const struct nb_config *config2, uint32_t *seq,
+				struct nb_config_cbs *changes)
 {
-	struct lyd_node *diff = NULL;
 	const struct lyd_node *root, *dnode;
 	struct lyd_node *target;
 	int op;
-	LY_ERR err;
 	char *path;
 
-#if 0 /* Useful (noisy) when debugging diff code, and for improving later */
-	if (DEBUG_MODE_CHECK(&nb_dbg_cbs_config, DEBUG_MODE_ALL)) {
-		LY_LIST_FOR(config1->dnode, root) {
-			LYD_TREE_DFS_BEGIN(root, dnode) {
-				nb_config_diff_dnode_log("from", dnode);
-				LYD_TREE_DFS_END(root, dnode);
-			}
-		}
-		LY_LIST_FOR(config2->dnode, root) {
-			LYD_TREE_DFS_BEGIN(root, dnode) {
-				nb_config_diff_dnode_log("to", dnode);
-				LYD_TREE_DFS_END(root, dnode);
-			}
-		}
-	}
-#endif
-
-	err = lyd_diff_siblings(config1->dnode, config2->dnode,
-				LYD_DIFF_DEFAULTS, &diff);
-	assert(!err);
-
-	if (diff && DEBUG_MODE_CHECK(&nb_dbg_cbs_config, DEBUG_MODE_ALL)) {
-		char *s;
-
-		if (!lyd_print_mem(&s, diff, LYD_JSON,
-				   LYD_PRINT_WITHSIBLINGS | LYD_PRINT_WD_ALL)) {
-			zlog_debug("%s: %s", __func__, s);
-			free(s);
-		}
-	}
-
-	uint32_t seq = 0;
-
 	LY_LIST_FOR (diff, root) {
 		LYD_TREE_DFS_BEGIN (root, dnode) {
 			op = nb_lyd_diff_get_op(dnode);
@@ -608,7 +728,7 @@ static void nb_config_diff(const struct nb_config *config1,
 				   */
 				target = yang_dnode_get(config2->dnode, path);
 				assert(target);
-				nb_config_diff_created(target, &seq, changes);
+				nb_config_diff_created(target, seq, changes);
 
 				/* Skip rest of sub-tree, move to next sibling
 				 */
@@ -617,7 +737,7 @@ static void nb_config_diff(const struct nb_config *config1,
 			case 'd': /* delete */
 				target = yang_dnode_get(config1->dnode, path);
 				assert(target);
-				nb_config_diff_deleted(target, &seq, changes);
+				nb_config_diff_deleted(target, seq, changes);
 
 				/* Skip rest of sub-tree, move to next sibling
 				 */
@@ -628,7 +748,7 @@ static void nb_config_diff(const struct nb_config *config1,
 				target = yang_dnode_get(config2->dnode, path);
 				assert(target);
 				nb_config_diff_add_change(changes, NB_OP_MODIFY,
-							  &seq, target);
+							  seq, target);
 				break;
 			case 'n': /* none */
 			default:
@@ -638,10 +758,97 @@ static void nb_config_diff(const struct nb_config *config1,
 			LYD_TREE_DFS_END(root, dnode);
 		}
 	}
+}
+
+/* Calculate the delta between two different configurations. */
+static void nb_config_diff(const struct nb_config *config1,
+			   const struct nb_config *config2,
+			   struct nb_config_cbs *changes)
+{
+	struct lyd_node *diff = NULL;
+	uint32_t seq = 0;
+	LY_ERR err;
+
+#if 0 /* Useful (noisy) when debugging diff code, and for improving later */
+	const struct lyd_node *root, *dnode;
+
+	if (DEBUG_MODE_CHECK(&nb_dbg_cbs_config, DEBUG_MODE_ALL)) {
+		LY_LIST_FOR(config1->dnode, root) {
+			LYD_TREE_DFS_BEGIN(root, dnode) {
+				nb_config_diff_dnode_log("from", dnode);
+				LYD_TREE_DFS_END(root, dnode);
+			}
+		}
+		LY_LIST_FOR(config2->dnode, root) {
+			LYD_TREE_DFS_BEGIN(root, dnode) {
+				nb_config_diff_dnode_log("to", dnode);
+				LYD_TREE_DFS_END(root, dnode);
+			}
+		}
+	}
+#endif
+
+	err = lyd_diff_siblings(config1->dnode, config2->dnode,
+				LYD_DIFF_DEFAULTS, &diff);
+	assert(!err);
+
+	if (diff && DEBUG_MODE_CHECK(&nb_dbg_cbs_config, DEBUG_MODE_ALL)) {
+		char *s;
+
+		if (!lyd_print_mem(&s, diff, LYD_JSON,
+				   LYD_PRINT_WITHSIBLINGS | LYD_PRINT_WD_ALL)) {
+			zlog_debug("%s: %s", __func__, s);
+			free(s);
+		}
+	}
 
+	nb_config_diff_walk(diff, config1, config2, &seq, changes);
 	lyd_free_all(diff);
 }
 
+/*
+ * Same as nb_config_diff(), but only looking at the subtrees recorded by
+ * nb_candidate_edit() in config2 (see nb_config_edits_usable()).
+ */
+static void nb_config_diff_edits(const struct nb_config *config1,
+				 const struct nb_config *config2,
+				 struct nb_config_cbs *changes)
+{
+	const struct nb_config_edits *edits = config2->edits;
+	const struct nb_config_edit *edit;
+	const struct lyd_node *dnode1, *dnode2;
+	struct lyd_node *diff;
+	uint32_t seq = 0;
+	LY_ERR err;
+
+	frr_each (nb_edits_const, &edits->list, edit) {
+		dnode1 = yang_dnode_get(config1->dnode, edit->xpath);
+		dnode2 = yang_dnode_get(config2->dnode, edit->xpath);
+
+		/* created and deleted again, or part of a larger edit */
+		if (!dnode1 && !dnode2)
+			continue;
+		if (nb_config_edits_covered(edits, dnode2 ? dnode2 : dnode1))
+			continue;
+
+		if (!dnode1) {
+			nb_config_diff_created(dnode2, &seq, changes);
+			continue;
+		}
+		if (!dnode2) {
+			nb_config_diff_deleted(dnode1, &seq, changes);
+			continue;
+		}
+
+		diff = NULL;
+		err = lyd_diff_tree(dnode1, dnode2, LYD_DIFF_DEFAULTS, &diff);
+		assert(!err);
+
+		nb_config_diff_walk(diff, config1, config2, &seq, changes);
+		lyd_free_all(diff);
+	}
+}
+
 int nb_candidate_edit(struct nb_config *candidate,
 		      const struct nb_node *nb_node,
 		      enum nb_operation operation, const char *xpath,
@@ -672,6 +879,8 @@ int nb_candidate_edit(struct nb_config *candidate,
 				  xpath_edit, err);
 			return NB_ERR;
 		} else if (dnode) {
+			nb_config_edits_add(candidate, dnode);
+
 			/* Create default nodes */
 			LY_ERR err = lyd_new_implicit_tree(
 				dnode, LYD_IMPLICIT_NO_STATE, NULL);
@@ -707,6 +916,9 @@ int nb_candidate_edit(struct nb_config *candidate,
 						__func__, dep_xpath, err);
 					return NB_ERR;
 				}
+				if (dep_dnode)
+					nb_config_edits_add(candidate,
+							    dep_dnode);
 			}
 		}
 		break;
@@ -723,9 +935,12 @@ int nb_candidate_edit(struct nb_config *candidate,
 			nb_node->dep_cbs.get_dependant_xpath(dnode, dep_xpath);
 
 			dep_dnode = yang_dnode_get(candidate->dnode, dep_xpath);
-			if (dep_dnode)
+			if (dep_dnode) {
+				nb_config_edits_add(candidate, dep_dnode);
 				lyd_free_tree(dep_dnode);
+			}
 		}
+		nb_config_edits_add(candidate, dnode);
 		lyd_free_tree(dnode);
 		break;
 	case NB_OP_MOVE:
@@ -762,6 +977,134 @@ int nb_candidate_update(struct nb_config *candidate)
 	return NB_OK;
 }
 
+/* Modules whose data a commit needs to validate. */
+#define NB_VALIDATE_MODULES_MAX 64
+
+struct nb_validate_modules {
+	size_t count;
+	const struct lys_module *modules[NB_VALIDATE_MODULES_MAX];
+};
+
+static bool nb_validate_modules_has(const struct nb_validate_modules *vm,
+				    const struct lys_module *module)
+{
+	for (size_t i = 0; i < vm->count; i++)
+		if (vm->modules[i] == module)
+			return true;
+	return false;
+}
+
+static bool nb_validate_modules_add(struct nb_validate_modules *vm,
+				    const struct lys_module *module)
+{
+	if (nb_validate_modules_has(vm, module))
+		return true;
+	if (vm->count == array_size(vm->modules))
+		return false;
+	vm->modules[vm->count++] = module;
+	return true;
+}
+
+/* Modules of dnode, its parents and everything below it. */
+static bool nb_validate_modules_add_tree(struct nb_validate_modules *vm,
+					 const struct lyd_node *dnode)
+{
+	const struct lyd_node *parent, *child;
+
+	if (!dnode)
+		return true;
+
+	for (parent = lyd_parent(dnode); parent; parent = lyd_parent(parent))
+		if (!nb_validate_modules_add(vm, parent->schema->module))
+			return false;
+
+	LYD_TREE_DFS_BEGIN (dnode, child) {
+		if (!nb_validate_modules_add(vm, child->schema->module))
+			return false;
+		LYD_TREE_DFS_END(dnode, child);
+	}
+	return true;
+}
+
+/*
+ * must/when/leafref expressions can only refer to nodes of modules that are
+ * imported, so any module that neither owns changed nodes nor imports a
+ * module that does is unaffected by the change.
+ */
+static bool nb_validate_module_affected(const struct nb_validate_modules *vm,
+					const struct lys_module *module)
+{
+	const struct lysp_module *pmod = module->parsed;
+	const struct lysp_submodule *submod;
+	LY_ARRAY_COUNT_TYPE i, j;
+
+	if (nb_validate_modules_has(vm, module) || !pmod)
+		return true;
+
+	for (i = 0; i < LY_ARRAY_COUNT(pmod->imports); i++)
+		if (nb_validate_modules_has(vm, pmod->imports[i].module))
+			return true;
+	for (i = 0; i < LY_ARRAY_COUNT(pmod->includes); i++) {
+		submod = pmod->includes[i].submodule;
+		if (!submod)
+			continue;
+		for (j = 0; j < LY_ARRAY_COUNT(submod->imports); j++)
+			if (nb_validate_modules_has(vm,
+						    submod->imports[j].module))
+				return true;
+	}
+	return false;
+}
+
+/*
+ * Validate only the data of modules affected by the edits recorded for
+ * candidate.  Returns false if the whole tree needs to be validated instead,
+ * either because the edits touch too many modules or because validation
+ * itself changed the tree (defaults, when conditions) in ways the recorded
+ * edits don't cover.
+ */
+static bool nb_candidate_validate_yang_edits(struct nb_config *candidate,
+					     int *ret)
+{
+	struct nb_validate_modules vm = {};
+	const struct nb_config_edit *edit;
+	const struct lys_module *module;
+	struct lyd_node *diff = NULL;
+	uint32_t idx = 0;
+
+	frr_each (nb_edits_const, &candidate->edits->list, edit) {
+		if (!nb_validate_modules_add_tree(
+			    &vm, yang_dnode_get(running_config->dnode,
+						edit->xpath))
+		    || !nb_validate_modules_add_tree(
+			    &vm, yang_dnode_get(candidate->dnode,
+						edit->xpath)))
+			return false;
+	}
+
+	while ((module = ly_ctx_get_module_iter(ly_native_ctx, &idx))) {
+		if (!module->implemented
+		    || !nb_validate_module_affected(&vm, module))
+			continue;
+
+		if (lyd_validate_module(&candidate->dnode, module,
+					LYD_VALIDATE_NO_STATE, &diff)
+		    != LY_SUCCESS) {
+			lyd_free_all(diff);
+			*ret = NB_ERR_VALIDATION;
+			return true;
+		}
+		if (diff) {
+			lyd_free_all(diff);
+			nb_config_edits_free(candidate);
+			return false;
+		}
+	}
+
+	*ret = NB_OK;
+	return true;
+}
+
 /*
  * Perform YANG syntactic and semantic validation.
  *
@@ -771,6 +1114,15 @@ int nb_candidate_update(struct nb_config *candidate)
 static int nb_candidate_validate_yang(struct nb_config *candidate, char *errmsg,
 				      size_t errmsg_len)
 {
+	int ret;
+
+	if (nb_config_edits_usable(candidate)
+	    && nb_candidate_validate_yang_edits(candidate, &ret)) {
+		if (ret != NB_OK)
+			yang_print_errors(ly_native_ctx, errmsg, errmsg_len);
+		return ret;
+	}
+
 	if (lyd_validate_all(&candidate->dnode, ly_native_ctx,
 			     LYD_VALIDATE_NO_STATE, NULL)
 	    != 0) {
@@ -834,7 +1186,10 @@ int nb_candidate_validate(struct nb_context *context,
 		return NB_ERR_VALIDATION;
 
 	RB_INIT(nb_config_cbs, &changes);
-	nb_config_diff(running_config, candidate, &changes);
+	if (nb_config_edits_usable(candidate))
+		nb_config_diff_edits(running_config, candidate, &changes);
+	else
+		nb_config_diff(running_config, candidate, &changes);
 	ret = nb_candidate_validate_code(context, candidate, &changes, errmsg,
 					 errmsg_len);
 	nb_config_diff_del_changes(&changes);
@@ -859,7 +1214,10 @@ int nb_candidate_commit_prepare(struct nb_context *context,
 	}
 
 	RB_INIT(nb_config_cbs, &changes);
-	nb_config_diff(running_config, candidate, &changes);
+	if (nb_config_edits_usable(candidate))
+		nb_config_diff_edits(running_config, candidate, &changes);
+	else
+		nb_config_diff(running_config, candidate, &changes);
 	if (RB_EMPTY(nb_config_cbs, &changes)) {
 		snprintf(
 			errmsg, errmsg_len,
@@ -910,6 +1268,7 @@ void nb_candidate_commit_apply(struct nb_transaction *transaction,
 	/* Replace running by candidate. */
 	transaction->config->version++;
 	nb_config_replace(running_config, transaction->config, true);
+	nb_config_edits_start(transaction->config);
 
 	/* Record transaction. */
 	if (save_transaction && nb_db_enabled
@@ -1596,11 +1955,70 @@ static void nb_transaction_apply_finish(struct nb_transaction *transaction,
 	}
 }
 
+/*
+ * Position of a paginated operational data iteration (see
+ * nb_oper_data_iterate_page()).  While iterating, levels[] holds the list
+ * entries currently being descended into, outermost first.  When the page
+ * is full, the first 'resume' of them are where the next call continues:
+ * the innermost one was completed, the ones above it are re-entered.
+ */
+#define NB_OPER_CURSOR_MAXDEPTH 8
+
+struct nb_oper_cursor {
+	/* list entries left for this page */
+	uint32_t budget;
+
+	/* levels to resume from, 0 once there */
+	unsigned int resume;
+	/* current list nesting */
+	unsigned int depth;
+
+	struct nb_oper_cursor_level {
+		const struct nb_node *nb_node;
+		struct yang_list_keys keys;
+		/* keyless lists */
+		uint32_t position;
+	} levels[NB_OPER_CURSOR_MAXDEPTH];
+};
+
+void nb_oper_cursor_free(struct nb_oper_cursor **cursor)
+{
+	XFREE(MTYPE_NB_OPER_CURSOR, *cursor);
+}
+
+/* Can the list entries in the first depth levels be found again later? */
+static bool nb_oper_cursor_can_resume(const struct nb_oper_cursor *cursor,
+				      unsigned int depth)
+{
+	for (unsigned int i = 0; i < depth; i++) {
+		const struct nb_node *nb_node = cursor->levels[i].nb_node;
+
+		if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST)
+		    && !nb_node->cbs.lookup_entry)
+			return false;
+	}
+	return true;
+}
+
+/* Does snode (a child being iterated over) lead to the list to resume? */
+static bool nb_oper_cursor_resumes_at(const struct nb_oper_cursor *cursor,
+				      const struct lysc_node *snode)
+{
+	const struct lysc_node *target;
+
+	target = cursor->levels[cursor->depth].nb_node->snode;
+	for (; target; target = target->parent)
+		if (target == snode)
+			return true;
+	return false;
+}
+
 static int nb_oper_data_iter_children(const struct lysc_node *snode,
 				      const char *xpath, const void *list_entry,
 				      const struct yang_list_keys *list_keys,
 				      struct yang_translator *translator,
 				      bool first, uint32_t flags,
+				      struct nb_oper_cursor *cursor,
 				      nb_oper_data_cb cb, void *arg)
 {
 	const struct lysc_node *child;
@@ -1608,9 +2026,14 @@ static int nb_oper_data_iter_children(const struct lysc_node *snode,
 	LY_LIST_FOR (lysc_node_child(snode), child) {
 		int ret;
 
+		/* Skip what the previous page already covered. */
+		if (cursor && cursor->resume
+		    && !nb_oper_cursor_resumes_at(cursor, child))
+			continue;
+
 		ret = nb_oper_data_iter_node(child, xpath, list_entry,
 					     list_keys, translator, false,
-					     flags, cb, arg);
+					     flags, cursor, cb, arg);
 		if (ret != NB_OK)
 			return ret;
 	}
@@ -1646,16 +2069,17 @@ static int nb_oper_data_iter_container(const struct nb_node *nb_node,
 				       const void *list_entry,
 				       const struct yang_list_keys *list_keys,
 				       struct yang_translator *translator,
-				       uint32_t flags, nb_oper_data_cb cb,
-				       void *arg)
+				       uint32_t flags,
+				       struct nb_oper_cursor *cursor,
+				       nb_oper_data_cb cb, void *arg)
 {
 	const struct lysc_node *snode = nb_node->snode;
 
 	if (CHECK_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY))
 		return NB_OK;
 
-	/* Read-only presence containers. */
-	if (nb_node->cbs.get_elem) {
+	/* Read-only presence containers (already sent when resuming). */
+	if (nb_node->cbs.get_elem && !(cursor && cursor->resume)) {
 		struct yang_data *data;
 		int ret;
 
@@ -1681,7 +2105,8 @@ static int nb_oper_data_iter_container(const struct nb_node *nb_node,
 
 	/* Iterate over the child nodes. */
 	return nb_oper_data_iter_children(snode, xpath, list_entry, list_keys,
-					  translator, false, flags, cb, arg);
+					  translator, false, flags, cursor, cb,
+					  arg);
 }
 
 static int
@@ -1718,20 +2143,76 @@ nb_oper_data_iter_leaflist(const struct nb_node *nb_node, const char *xpath,
 	return NB_OK;
 }
 
+/*
+ * When resuming, find the list entry the previous page stopped at again.
+ * Returns NULL if it went away in the meantime.
+ */
+static const void *
+nb_oper_data_iter_list_resume(const struct nb_node *nb_node,
+			      const void *parent_list_entry,
+			      struct nb_oper_cursor_level *level)
+{
+	const void *list_entry = NULL;
+
+	if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST))
+		return nb_callback_lookup_entry(nb_node, parent_list_entry,
+						&level->keys);
+
+	for (uint32_t i = 0; i < level->position; i++) {
+		list_entry = nb_callback_get_next(nb_node, parent_list_entry,
+						  list_entry);
+		if (!list_entry)
+			break;
+	}
+	return list_entry;
+}
+
 static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 				  const char *xpath_list,
 				  const void *parent_list_entry,
 				  const struct yang_list_keys *parent_list_keys,
 				  struct yang_translator *translator,
-				  uint32_t flags, nb_oper_data_cb cb, void *arg)
+				  uint32_t flags, struct nb_oper_cursor *cursor,
+				  nb_oper_data_cb cb, void *arg)
 {
 	const struct lysc_node *snode = nb_node->snode;
+	struct nb_oper_cursor_level *level = NULL;
 	const void *list_entry = NULL;
 	uint32_t position = 1;
+	bool reenter = false;
 
 	if (CHECK_FLAG(nb_node->flags, F_NB_NODE_CONFIG_ONLY))
 		return NB_OK;
 
+	if (cursor && cursor->depth < NB_OPER_CURSOR_MAXDEPTH)
+		level = &cursor->levels[cursor->depth];
+
+	if (cursor && cursor->resume) {
+		if (!level || level->nb_node != nb_node) {
+			flog_warn(EC_LIB_NB_OPERATIONAL_DATA,
+				  "%s: cursor doesn't match [xpath %s]",
+				  __func__, xpath_list);
+			return NB_ERR;
+		}
+
+		list_entry = nb_oper_data_iter_list_resume(
+			nb_node, parent_list_entry, level);
+		if (!list_entry) {
+			flog_warn(EC_LIB_NB_OPERATIONAL_DATA,
+				  "%s: list entry to continue from is gone [xpath %s]",
+				  __func__, xpath_list);
+			return NB_ERR_NOT_FOUND;
+		}
+		position = level->position;
+
+		/* The innermost entry was done, continue after it. */
+		if (cursor->depth + 1 == cursor->resume) {
+			cursor->resume = 0;
+			position++;
+		} else
+			reenter = true;
+	}
+
 	/* Iterate over all list entries. */
 	do {
 		const struct lysc_node_leaf *skey;
@@ -1740,11 +2221,14 @@ static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 		int ret;
 
 		/* Obtain list entry. */
-		list_entry = nb_callback_get_next(nb_node, parent_list_entry,
-						  list_entry);
-		if (!list_entry)
-			/* End of the list. */
-			break;
+		if (!reenter) {
+			list_entry = nb_callback_get_next(
+				nb_node, parent_list_entry, list_entry);
+			if (!list_entry)
+				/* End of the list. */
+				break;
+		}
+		reenter = false;
 
 		if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST)) {
 			/* Obtain the list entry keys. */
@@ -1775,15 +2259,38 @@ static int nb_oper_data_iter_list(const struct nb_node *nb_node,
 			 */
 			snprintf(xpath, sizeof(xpath), "%s[%u]", xpath_list,
 				 position);
-			position++;
 		}
 
+		if (level) {
+			level->nb_node = nb_node;
+			if (!CHECK_FLAG(nb_node->flags, F_NB_NODE_KEYLESS_LIST))
+				level->keys = list_keys;
+			level->position = position;
+		}
+		position++;
+
 		/* Iterate over the child nodes. */
+		if (cursor)
+			cursor->depth++;
 		ret = nb_oper_data_iter_children(
 			nb_node->snode, xpath, list_entry, &list_keys,
-			translator, false, flags, cb, arg);
+			translator, false, flags, cursor, cb, arg);
+		if (cursor)
+			cursor->depth--;
 		if (ret != NB_OK)
 			return ret;
+
+		/* Page full?  Stop after this entry. */
+		if (level) {
+			if (cursor->budget)
+				cursor->budget--;
+			if (!cursor->budget
+			    && nb_oper_cursor_can_resume(cursor,
+							 cursor->depth + 1)) {
+				cursor->resume = cursor->depth + 1;
+				return NB_YIELD;
+			}
+		}
 	} while (list_entry);
 
 	return NB_OK;
@@ -1795,6 +2302,7 @@ static int nb_oper_data_iter_node(const struct lysc_node *snode,
 				  const struct yang_list_keys *list_keys,
 				  struct yang_translator *translator,
 				  bool first, uint32_t flags,
+				  struct nb_oper_cursor *cursor,
 				  nb_oper_data_cb cb, void *arg)
 {
 	struct nb_node *nb_node;
@@ -1832,7 +2340,7 @@ static int nb_oper_data_iter_node(const struct lysc_node *snode,
 	case LYS_CONTAINER:
 		ret = nb_oper_data_iter_container(nb_node, xpath, list_entry,
 						  list_keys, translator, flags,
-						  cb, arg);
+						  cursor, cb, arg);
 		break;
 	case LYS_LEAF:
 		ret = nb_oper_data_iter_leaf(nb_node, xpath, list_entry,
@@ -1846,13 +2354,13 @@ static int nb_oper_data_iter_node(const struct lysc_node *snode,
 		break;
 	case LYS_LIST:
 		ret = nb_oper_data_iter_list(nb_node, xpath, list_entry,
-					     list_keys, translator, flags, cb,
-					     arg);
+					     list_keys, translator, flags,
+					     cursor, cb, arg);
 		break;
 	case LYS_USES:
 		ret = nb_oper_data_iter_children(snode, xpath, list_entry,
 						 list_keys, translator, false,
-						 flags, cb, arg);
+						 flags, cursor, cb, arg);
 		break;
 	default:
 		break;
@@ -1861,8 +2369,11 @@ static int nb_oper_data_iter_node(const struct lysc_node *snode,
 	return ret;
 }
 
-int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
-			 uint32_t flags, nb_oper_data_cb cb, void *arg)
+static int nb_oper_data_iterate_internal(const char *xpath,
+					 struct yang_translator *translator,
+					 uint32_t flags,
+					 struct nb_oper_cursor *cursor,
+					 nb_oper_data_cb cb, void *arg)
 {
 	struct nb_node *nb_node;
 	const void *list_entry = NULL;
@@ -1963,11 +2474,11 @@ int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
 	if (dnode->schema->nodetype == LYS_LIST && lyd_child(dnode))
 		ret = nb_oper_data_iter_children(
 			nb_node->snode, xpath, list_entry, &list_keys,
-			translator, true, flags, cb, arg);
+			translator, true, flags, cursor, cb, arg);
 	else
 		ret = nb_oper_data_iter_node(nb_node->snode, xpath, list_entry,
 					     &list_keys, translator, true,
-					     flags, cb, arg);
+					     flags, cursor, cb, arg);
 
 	list_delete(&list_dnodes);
 	yang_dnode_free(dnode);
@@ -1975,6 +2486,35 @@ int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
 	return ret;
 }
 
+int nb_oper_data_iterate(const char *xpath, struct yang_translator *translator,
+			 uint32_t flags, nb_oper_data_cb cb, void *arg)
+{
+	return nb_oper_data_iterate_internal(xpath, translator, flags, NULL, cb,
+					     arg);
+}
+
+int nb_oper_data_iterate_page(const char *xpath,
+			      struct yang_translator *translator,
+			      uint32_t flags, uint32_t max_entries,
+			      struct nb_oper_cursor **cursor,
+			      nb_oper_data_cb cb, void *arg)
+{
+	int ret;
+
+	if (!*cursor)
+		*cursor = XCALLOC(MTYPE_NB_OPER_CURSOR, sizeof(**cursor));
+	(*cursor)->budget = MAX(max_entries, 1U);
+	(*cursor)->depth = 0;
+
+	ret = nb_oper_data_iterate_internal(xpath, translator, flags, *cursor,
+					    cb, arg);
+	if (ret == NB_YIELD)
+		return NB_OK;
+
+	nb_oper_cursor_free(cursor);
+	return ret;
+}
+
 bool nb_operation_is_valid(enum nb_operation operation,
 			   const struct lysc_node *snode)
 {
@@ -2373,6 +2913,8 @@ const char *nb_err_name(enum nb_error error)
 		return "failed to allocate resource";
 	case NB_ERR_INCONSISTENCY:
 		return "internal inconsistency";
+	case NB_YIELD:
+		return "yield";
 	default:
 		return "unknown";
 	}
@@ -2467,11 +3009,16 @@ void nb_init(struct thread_master *tm,
 	if (explicit_compile)
 		yang_init_loading_complete();
 
-	/* Initialize the compiled nodes with northbound data */
-	for (size_t i = 0; i < nmodules; i++) {
+	/*
+	 * Initialize the compiled nodes with northbound data.  The config-only
+	 * pass runs once all modules have their nodes, since a module loaded
+	 * later may augment state nodes into an earlier one.
+	 */
+	for (size_t i = 0; i < nmodules; i++)
 		yang_snodes_iterate(loaded[i]->info, nb_node_new_cb, 0, NULL);
+	yang_snodes_iterate(NULL, nb_node_check_config_only, 0, NULL);
+	for (size_t i = 0; i < nmodules; i++)
 		nb_load_callbacks(modules[i]);
-	}
 
 	/* Validate northbound callbacks. */
 	nb_validate_callbacks();
@@ -610,6 +610,8 @@ enum nb_error {
 	NB_ERR_VALIDATION,
 	NB_ERR_RESOURCE,
 	NB_ERR_INCONSISTENCY,
+	/* Stopped early, to be continued later (not an error). */
+	NB_YIELD,
 };
 
 /* Default priority. */
@@ -653,10 +655,19 @@ struct nb_context {
 #endif
 };
 
+struct nb_config_edits;
+
 /* Northbound configuration. */
 struct nb_config {
 	struct lyd_node *dnode;
 	uint32_t version;
+
+	/*
+	 * Subtrees changed by nb_candidate_edit() since this configuration
+	 * was last a copy of running_config.  Lets a commit validate and diff
+	 * just those instead of the whole tree; NULL when not tracked.
+	 */
+	struct nb_config_edits *edits;
 };
 
 /* Northbound configuration callback. */
@@ -693,6 +704,9 @@ typedef int (*nb_oper_data_cb)(const struct lysc_node *snode,
 /* Iterate over direct child nodes only. */
 #define NB_OPER_DATA_ITER_NORECURSE 0x0001
 
+/* Where nb_oper_data_iterate_page() stopped. */
+struct nb_oper_cursor;
+
 /* Hooks. */
 DECLARE_HOOK(nb_notification_send, (const char *xpath, struct list *arguments),
 	     (xpath, arguments));
@@ -1103,6 +1117,34 @@ extern int nb_oper_data_iterate(const char *xpath,
 				struct yang_translator *translator,
 				uint32_t flags, nb_oper_data_cb cb, void *arg);
 
+/*
+ * Same as nb_oper_data_iterate(), but stop after about max_entries list
+ * entries (at any depth) so large state like the RIB can be produced in
+ * chunks of bounded size.
+ *
+ * cursor
+ *    Must point to NULL on the first call.  When the iteration stopped
+ *    early, it is set to the position to continue from; call again with the
+ *    same xpath, translator and flags for the next chunk.  NULL once the
+ *    iteration is complete, or on error.  A cursor no longer needed is freed
+ *    with nb_oper_cursor_free().
+ *
+ *    Continuing needs the list entries the previous chunk stopped in to be
+ *    found again, through the 'lookup_entry' callback (or by position for
+ *    keyless lists).  Lists without 'lookup_entry' are never split up, and
+ *    NB_ERR_NOT_FOUND is returned if an entry went away in the meantime.
+ *
+ * Returns:
+ *    NB_OK on success, NB_ERR_NOT_FOUND or NB_ERR otherwise.
+ */
+extern int nb_oper_data_iterate_page(const char *xpath,
+				     struct yang_translator *translator,
+				     uint32_t flags, uint32_t max_entries,
+				     struct nb_oper_cursor **cursor,
+				     nb_oper_data_cb cb, void *arg);
+
+extern void nb_oper_cursor_free(struct nb_oper_cursor **cursor);
+
 /*
  * Validate if the northbound operation is valid for the given node.
  *
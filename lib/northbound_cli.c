@@ -107,6 +107,17 @@ int nb_cli_pending_commit_check(struct vty *vty)
 	return ret;
 }
 
+void nb_cli_bulk_begin(struct vty *vty)
+{
+	vty->pending_allowed = true;
+}
+
+int nb_cli_bulk_end(struct vty *vty)
+{
+	vty->pending_allowed = false;
+	return nb_cli_pending_commit_check(vty);
+}
+
 static int nb_cli_schedule_command(struct vty *vty)
 {
 	/* Append command to dynamically sized buffer of scheduled commands. */
@@ -143,6 +143,31 @@ extern void nb_cli_show_dnode_cmds(struct vty *vty,
  */
 extern int nb_cli_pending_commit_check(struct vty *vty);
 
+/*
+ * Start grouping all following configuration commands on this vty into a
+ * single transaction, instead of committing after each of them (classic CLI
+ * mode only).  Commands not converted to the northbound still flush the
+ * changes collected until then, for them to see a consistent running
+ * configuration.
+ *
+ * vty
+ *    The vty context.
+ */
+extern void nb_cli_bulk_begin(struct vty *vty);
+
+/*
+ * Commit everything collected since nb_cli_bulk_begin() and go back to
+ * committing each command by itself.
+ *
+ * vty
+ *    The vty context.
+ *
+ * Returns
+ *    CMD_SUCCESS on success (or nothing to commit),
+ *    CMD_WARNING_CONFIG_FAILED otherwise.
+ */
+extern int nb_cli_bulk_end(struct vty *vty);
+
 /* Prototypes of internal functions. */
 extern void nb_cli_show_config_prepare(struct nb_config *config,
 				       bool with_defaults);
@@ -36,9 +36,14 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <deque>
+#include <list>
 
 #define GRPC_DEFAULT_PORT 50051
 
+// List entries of operational data sent in one Get response.
+#define GRPC_GET_CHUNK_ENTRIES 1000
+
 
 // ------------------------------------------------------
 //                 File Local Variables
@@ -140,21 +145,28 @@ class RpcStateBase
 
 	virtual ~RpcStateBase() = default;
 
-	CallState get_state() const
-	{
-		return state;
-	}
-
 	bool is_initial_process() const
 	{
 		/* Will always be true for Unary */
 		return entered_state == CREATE;
 	}
 
-	// Returns "more" status, if false caller can delete
-	bool run(frr::Northbound::AsyncService *service,
-		 grpc::ServerCompletionQueue *cq)
+	/*
+	 * Called on the grpc-io-thread when an operation on this RPC
+	 * completed.  Returns false when the RPC is done and the caller can
+	 * delete it.
+	 */
+	virtual bool run(frr::Northbound::AsyncService *service,
+			 grpc::ServerCompletionQueue *cq)
 	{
+		pthread_mutex_lock(&this->cmux);
+		wait_mainthread();
+
+		if (this->state == FINISH) {
+			pthread_mutex_unlock(&this->cmux);
+			return false;
+		}
+
 		/*
 		 * We enter in either CREATE or MORE state, and transition to
 		 * PROCESS state.
@@ -164,38 +176,51 @@ class RpcStateBase
 		grpc_debug("%s RPC: %s -> %s on grpc-io-thread", name,
 			   call_states[this->entered_state],
 			   call_states[this->state]);
+		pthread_mutex_unlock(&this->cmux);
+
+		/*
+		 * Be ready for the next request of this type right away, so
+		 * several of them can be in progress at the same time.
+		 */
+		if (this->entered_state == CREATE)
+			this->do_request(service, cq, false);
+
 		/*
-		 * We schedule the callback on the main pthread, and wait for
-		 * the state to transition out of the PROCESS state. The new
-		 * state will either be MORE or FINISH. It will always be FINISH
-		 * for Unary RPCs.
+		 * We schedule the callback on the main pthread without waiting
+		 * for it, so this thread can go on with other RPCs meanwhile.
+		 * The new state will either be MORE or FINISH. It will always
+		 * be FINISH for Unary RPCs.
 		 */
 		thread_add_event(main_master, c_callback, (void *)this, 0,
 				 NULL);
+		return true;
+	}
 
+	/*
+	 * An operation on this RPC failed, i.e. the client went away or the
+	 * server is shutting down.  Called on the grpc-io-thread.
+	 */
+	virtual void failed(void)
+	{
 		pthread_mutex_lock(&this->cmux);
-		while (this->state == PROCESS)
-			pthread_cond_wait(&this->cond, &this->cmux);
+		wait_mainthread();
 		pthread_mutex_unlock(&this->cmux);
-
-		grpc_debug("%s RPC in %s on grpc-io-thread", name,
-			   call_states[this->state]);
-
-		if (this->state == FINISH) {
-			/*
-			 * Server is done (FINISH) so prep to receive a new
-			 * request of this type. We could do this earlier but
-			 * that would mean we could be handling multiple same
-			 * type requests in parallel without limit.
-			 */
-			this->do_request(service, cq, false);
-		}
-		return true;
+		delete this;
 	}
 
       protected:
 	virtual CallState run_mainthread(struct thread *thread) = 0;
 
+	/*
+	 * The main thread may still be finishing up a callback that already
+	 * issued the operation that just completed.  cmux must be held.
+	 */
+	void wait_mainthread(void)
+	{
+		while (this->state == PROCESS)
+			pthread_cond_wait(&this->cond, &this->cmux);
+	}
+
 	static void c_callback(struct thread *thread)
 	{
 		auto _tag = static_cast<RpcStateBase *>(THREAD_ARG(thread));
@@ -452,10 +477,13 @@ static int get_oper_data_cb(const struct lysc_node *snode,
 	return (ret == 0) ? NB_OK : NB_ERR;
 }
 
-static struct lyd_node *get_dnode_state(const std::string &path)
+static struct lyd_node *get_dnode_state(const std::string &path,
+					struct nb_oper_cursor **cursor)
 {
 	struct lyd_node *dnode = yang_dnode_new(ly_native_ctx, false);
-	if (nb_oper_data_iterate(path.c_str(), NULL, 0, get_oper_data_cb, dnode)
+	if (nb_oper_data_iterate_page(path.c_str(), NULL, 0,
+				      GRPC_GET_CHUNK_ENTRIES, cursor,
+				      get_oper_data_cb, dnode)
 	    != NB_OK) {
 		yang_dnode_free(dnode);
 		return NULL;
@@ -464,14 +492,21 @@ static struct lyd_node *get_dnode_state(const std::string &path)
 	return dnode;
 }
 
+/*
+ * Operational data is sent in chunks: *cursor is left non-NULL while there's
+ * more to come, and only the first chunk carries the configuration data.
+ */
 static grpc::Status get_path(frr::DataTree *dt, const std::string &path,
 			     int type, LYD_FORMAT lyd_format,
-			     bool with_defaults)
+			     bool with_defaults, struct nb_oper_cursor **cursor)
 {
 	struct lyd_node *dnode_config = NULL;
 	struct lyd_node *dnode_state = NULL;
 	struct lyd_node *dnode_final;
 
+	if (*cursor)
+		type = frr::GetRequest_DataType_STATE;
+
 	// Configuration data.
 	if (type == frr::GetRequest_DataType_ALL
 	    || type == frr::GetRequest_DataType_CONFIG) {
@@ -484,7 +519,7 @@ static grpc::Status get_path(frr::DataTree *dt, const std::string &path,
 	// Operational data.
 	if (type == frr::GetRequest_DataType_ALL
 	    || type == frr::GetRequest_DataType_STATE) {
-		dnode_state = get_dnode_state(path);
+		dnode_state = get_dnode_state(path, cursor);
 		if (!dnode_state) {
 			if (dnode_config)
 				yang_dnode_free(dnode_config);
@@ -583,14 +618,23 @@ grpc::Status HandleUnaryGetCapabilities(
 }
 
 // Define the context variable type for this streaming handler
-typedef std::list<std::string> GetContextType;
+struct GetContextType {
+	std::list<std::string> paths;
+	// position in the operational data of paths.back()
+	struct nb_oper_cursor *cursor = NULL;
+
+	~GetContextType()
+	{
+		nb_oper_cursor_free(&cursor);
+	}
+};
 
 bool HandleStreamingGet(
 	StreamRpcState<frr::GetRequest, frr::GetResponse, GetContextType> *tag)
 {
 	grpc_debug("%s: entered", __func__);
 
-	auto mypathps = &tag->context;
+	auto mypathps = &tag->context.paths;
 	if (tag->is_initial_process()) {
 		// Fill our context container first time through
 		grpc_debug("%s: initialize streaming state", __func__);
@@ -622,7 +666,8 @@ bool HandleStreamingGet(
 	auto *data = response.mutable_data();
 	data->set_encoding(tag->request.encoding());
 	status = get_path(data, mypathps->back().c_str(), type,
-			  encoding2lyd_format(encoding), with_defaults);
+			  encoding2lyd_format(encoding), with_defaults,
+			  &tag->context.cursor);
 
 	if (!status.ok()) {
 		tag->async_responder.WriteAndFinish(
@@ -630,7 +675,9 @@ bool HandleStreamingGet(
 		return false;
 	}
 
-	mypathps->pop_back();
+	// More operational data for this path goes into the next response.
+	if (!tag->context.cursor)
+		mypathps->pop_back();
 	if (mypathps->empty()) {
 		tag->async_responder.WriteAndFinish(
 			response, grpc::WriteOptions(), grpc::Status::OK, tag);
@@ -1097,6 +1144,314 @@ grpc::Status HandleUnaryExecute(
 	return grpc::Status::OK;
 }
 
+// ------------------------------------------------------
+//            Subscriptions: notifications, sampling
+// ------------------------------------------------------
+
+// Minimum and default interval for sampled subscriptions, milliseconds.
+#define GRPC_SAMPLE_INTERVAL_MIN 100
+#define GRPC_SAMPLE_INTERVAL_DFLT 10000
+
+// Responses queued for a client that doesn't keep up, before dropping.
+#define GRPC_SUBSCRIBE_QUEUE_MAX 256
+
+/*
+ * A Subscribe RPC doesn't follow the request -> callback -> write cycle of
+ * the others: responses are produced on the main thread whenever there is a
+ * notification or a sample is due, and queued here for the grpc-io-thread
+ * to write out one at a time.
+ */
+class SubscribeRpcState : public RpcStateBase
+{
+      public:
+	SubscribeRpcState() : RpcStateBase("Subscribe"), async_responder(&ctx)
+	{
+	}
+
+	void do_request(::frr::Northbound::AsyncService *service,
+			::grpc::ServerCompletionQueue *cq,
+			bool no_copy) override
+	{
+		grpc_debug("%s, posting a request for: %s", __func__, name);
+		auto copy = no_copy ? this : new SubscribeRpcState();
+		service->RequestSubscribe(&copy->ctx, &copy->request,
+					  &copy->async_responder, cq, cq, copy);
+	}
+
+	bool run(frr::Northbound::AsyncService *service,
+		 grpc::ServerCompletionQueue *cq) override
+	{
+		pthread_mutex_lock(&this->cmux);
+		wait_mainthread();
+
+		switch (this->state) {
+		case CREATE:
+			// New subscription, set it up on the main thread.
+			this->entered_state = CREATE;
+			this->state = PROCESS;
+			pthread_mutex_unlock(&this->cmux);
+
+			this->do_request(service, cq, false);
+			thread_add_event(main_master, c_callback, (void *)this,
+					 0, NULL);
+			return true;
+		case FINISH:
+			pthread_mutex_unlock(&this->cmux);
+			return false;
+		default:
+			break;
+		}
+
+		// A write completed, go on with the next one.
+		if (!this->queue.empty()) {
+			this->async_responder.Write(this->queue.front(), this);
+			this->queue.pop_front();
+		} else
+			this->writing = false;
+		pthread_mutex_unlock(&this->cmux);
+		return true;
+	}
+
+	void failed(void) override
+	{
+		pthread_mutex_lock(&this->cmux);
+		wait_mainthread();
+		if (this->state != MORE) {
+			pthread_mutex_unlock(&this->cmux);
+			delete this;
+			return;
+		}
+
+		// The main thread still knows about us, it does the cleanup.
+		this->cancelled = true;
+		this->writing = false;
+		this->queue.clear();
+		pthread_mutex_unlock(&this->cmux);
+
+		thread_add_event(main_master, c_cancel, (void *)this, 0, NULL);
+	}
+
+	// Main thread.
+	void send(frr::SubscribeResponse &response)
+	{
+		pthread_mutex_lock(&this->cmux);
+		if (this->cancelled) {
+			pthread_mutex_unlock(&this->cmux);
+			return;
+		}
+
+		response.set_dropped(this->dropped);
+		if (!this->writing) {
+			this->writing = true;
+			this->async_responder.Write(response, this);
+		} else if (this->queue.size() < GRPC_SUBSCRIBE_QUEUE_MAX)
+			this->queue.push_back(response);
+		else
+			this->dropped++;
+		pthread_mutex_unlock(&this->cmux);
+	}
+
+	// Main thread; sampled data is skipped while the client is behind.
+	bool busy(void)
+	{
+		pthread_mutex_lock(&this->cmux);
+		bool ret = !this->queue.empty();
+		pthread_mutex_unlock(&this->cmux);
+		return ret;
+	}
+
+	frr::SubscribeRequest request;
+	grpc::ServerAsyncWriter<frr::SubscribeResponse> async_responder;
+
+	LYD_FORMAT lyd_format;
+	struct thread *t_sample = NULL;
+
+      protected:
+	CallState run_mainthread(struct thread *thread) override;
+
+	static void c_cancel(struct thread *thread);
+
+      private:
+	// protected by cmux
+	std::deque<frr::SubscribeResponse> queue;
+	bool writing = false;
+	bool cancelled = false;
+	uint64_t dropped = 0;
+};
+
+// Active subscriptions, main thread only.
+static std::list<SubscribeRpcState *> subscriptions;
+
+static void subscription_sample(struct thread *thread)
+{
+	auto sub = static_cast<SubscribeRpcState *>(THREAD_ARG(thread));
+
+	thread_add_timer_msec(main_master, subscription_sample, sub,
+			      sub->request.sample_interval(), &sub->t_sample);
+
+	if (sub->busy())
+		return;
+
+	for (const std::string &path : sub->request.path()) {
+		struct nb_oper_cursor *cursor = NULL;
+
+		do {
+			frr::SubscribeResponse response;
+
+			response.set_timestamp(time(NULL));
+			response.set_path(path);
+			auto *data = response.mutable_data();
+			data->set_encoding(sub->request.encoding());
+
+			grpc::Status status =
+				get_path(data, path,
+					 frr::GetRequest_DataType_STATE,
+					 sub->lyd_format, false, &cursor);
+			if (!status.ok()) {
+				grpc_debug("%s: failed to sample %s", __func__,
+					   path.c_str());
+				break;
+			}
+			sub->send(response);
+		} while (cursor);
+	}
+}
+
+CallState SubscribeRpcState::run_mainthread(struct thread *thread)
+{
+	grpc_debug("%s: entered", __func__);
+
+	grpc::Status status = grpc::Status::OK;
+	uint32_t interval = request.sample_interval();
+
+	lyd_format = encoding2lyd_format(request.encoding());
+
+	if (request.path().empty())
+		status = grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+				      "No paths given");
+
+	switch (request.mode()) {
+	case frr::SubscribeRequest_Mode_ON_CHANGE:
+		break;
+	case frr::SubscribeRequest_Mode_SAMPLE:
+		if (!interval)
+			interval = GRPC_SAMPLE_INTERVAL_DFLT;
+		if (interval < GRPC_SAMPLE_INTERVAL_MIN)
+			status = grpc::Status(
+				grpc::StatusCode::INVALID_ARGUMENT,
+				"Sample interval too short");
+		request.set_sample_interval(interval);
+
+		for (const std::string &path : request.path())
+			if (!nb_node_find(path.c_str()))
+				status = grpc::Status(
+					grpc::StatusCode::INVALID_ARGUMENT,
+					"Unknown data path");
+		break;
+	default:
+		status = grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+				      "Unknown subscription mode");
+		break;
+	}
+
+	if (!status.ok()) {
+		async_responder.Finish(status, this);
+		return FINISH;
+	}
+
+	subscriptions.push_back(this);
+	if (request.mode() == frr::SubscribeRequest_Mode_SAMPLE)
+		thread_add_event(main_master, subscription_sample, this, 0,
+				 &t_sample);
+	return MORE;
+}
+
+void SubscribeRpcState::c_cancel(struct thread *thread)
+{
+	auto sub = static_cast<SubscribeRpcState *>(THREAD_ARG(thread));
+
+	grpc_debug("%s: subscription gone", __func__);
+
+	subscriptions.remove(sub);
+	THREAD_OFF(sub->t_sample);
+	delete sub;
+}
+
+static bool subscription_matches(const SubscribeRpcState *sub,
+				 const char *xpath)
+{
+	for (const std::string &path : sub->request.path())
+		if (path == "/"
+		    || !strncmp(xpath, path.c_str(), path.length()))
+			return true;
+	return false;
+}
+
+static int subscription_notification_send(const char *xpath,
+					  struct list *arguments)
+{
+	std::string encoded[2];
+	bool done[2] = {false, false};
+	struct lyd_node *dnode = NULL;
+
+	for (auto *sub : subscriptions) {
+		if (sub->request.mode() != frr::SubscribeRequest_Mode_ON_CHANGE
+		    || !subscription_matches(sub, xpath))
+			continue;
+
+		if (!dnode) {
+			struct yang_data *data;
+			struct listnode *node;
+
+			if (lyd_new_path(NULL, ly_native_ctx, xpath, NULL, 0,
+					 &dnode)
+			    != LY_SUCCESS) {
+				flog_warn(EC_LIB_LIBYANG,
+					  "%s: lyd_new_path(%s) failed: %s",
+					  __func__, xpath,
+					  ly_errmsg(ly_native_ctx));
+				return NB_ERR;
+			}
+			if (arguments)
+				for (ALL_LIST_ELEMENTS_RO(arguments, node,
+							  data))
+					yang_dnode_edit(dnode, data->xpath,
+							data->value);
+		}
+
+		// Encode once per encoding, not once per subscriber.
+		int enc = sub->request.encoding() == frr::XML;
+		if (!done[enc]) {
+			frr::DataTree dt;
+
+			if (data_tree_from_dnode(&dt, dnode, sub->lyd_format,
+						 false)
+			    == LY_SUCCESS)
+				encoded[enc] = dt.data();
+			done[enc] = true;
+		}
+
+		frr::SubscribeResponse response;
+		response.set_timestamp(time(NULL));
+		response.set_path(xpath);
+		auto *data = response.mutable_data();
+		data->set_encoding(sub->request.encoding());
+		data->set_data(encoded[enc]);
+		sub->send(response);
+	}
+
+	if (dnode)
+		yang_dnode_free(dnode);
+	return NB_OK;
+}
+
+static void subscriptions_finish(void)
+{
+	for (auto *sub : subscriptions)
+		THREAD_OFF(sub->t_sample);
+	subscriptions.clear();
+}
+
 // ------------------------------------------------------
 //        Thread Initialization and Run Functions
 // ------------------------------------------------------
@@ -1173,6 +1528,7 @@ static void *grpc_pthread_start(void *arg)
 	/* Schedule streaming RPC handlers */
 	REQUEST_NEWRPC_STREAMING(Get);
 	REQUEST_NEWRPC_STREAMING(ListTransactions);
+	(new SubscribeRpcState())->do_request(&service, cq.get(), true);
 
 	zlog_notice("gRPC server listening on %s",
 		    server_address.str().c_str());
@@ -1189,15 +1545,19 @@ static void *grpc_pthread_start(void *arg)
 		grpc_debug("%s: got next from CQ tag: %p ok: %d", __func__, tag,
 			   ok);
 
+		RpcStateBase *rpc = static_cast<RpcStateBase *>(tag);
 		if (!ok) {
-			delete static_cast<RpcStateBase *>(tag);
-			break;
+			rpc->failed();
+
+			pthread_mutex_lock(&s_server_lock);
+			bool running = grpc_running;
+			pthread_mutex_unlock(&s_server_lock);
+			if (!running)
+				break;
+			continue;
 		}
 
-		RpcStateBase *rpc = static_cast<RpcStateBase *>(tag);
-		if (rpc->get_state() != FINISH)
-			rpc->run(&service, cq.get());
-		else {
+		if (!rpc->run(&service, cq.get())) {
 			grpc_debug("%s RPC FINISH -> [delete]", rpc->name);
 			delete rpc;
 		}
@@ -1256,6 +1616,8 @@ static int frr_grpc_finish(void)
 	if (!fpt)
 		return 0;
 
+	subscriptions_finish();
+
 	/*
 	 * Shut the server down here in main thread. This will cause the wait on
 	 * the completion queue (cq.Next()) to exit and cleanup everything else.
@@ -1315,6 +1677,7 @@ static int frr_grpc_module_late_init(struct thread_master *tm)
 {
 	main_master = tm;
 	hook_register(frr_fini, frr_grpc_finish);
+	hook_register(nb_notification_send, subscription_notification_send);
 	thread_add_event(tm, frr_grpc_module_very_late_init, NULL, 0, NULL);
 	return 0;
 }
@@ -32,38 +32,42 @@
 
 #define pos (*posx)
 
+/* "00" .. "99", so two digits are one load */
+static const char dec2[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
 static inline void putbyte(uint8_t bytex, char **posx)
 	__attribute__((always_inline)) OPTIMIZE;
 
 static inline void putbyte(uint8_t bytex, char **posx)
 {
-	bool zero = false;
-	int byte = bytex, tmp, a, b;
+	unsigned int byte = bytex;
 
-	tmp = byte - 200;
-	if (tmp >= 0) {
+	if (byte >= 200) {
 		*pos++ = '2';
-		zero = true;
-		byte = tmp;
-	} else {
-		tmp = byte - 100;
-		if (tmp >= 0) {
-			*pos++ = '1';
-			zero = true;
-			byte = tmp;
-		}
+		byte -= 200;
+	} else if (byte >= 100) {
+		*pos++ = '1';
+		byte -= 100;
+	} else if (byte < 10) {
+		*pos++ = '0' + byte;
+		return;
 	}
 
 	/* make sure the compiler knows the value range of "byte" */
-	assume(byte < 100 && byte >= 0);
-
-	b = byte % 10;
-	a = byte / 10;
-	if (a || zero) {
-		*pos++ = '0' + a;
-		*pos++ = '0' + b;
-	} else
-		*pos++ = '0' + b;
+	assume(byte < 100);
+
+	memcpy(pos, &dec2[byte * 2], 2);
+	pos += 2;
 }
 
 static inline void puthex(uint16_t word, char **posx)
@@ -83,21 +87,13 @@ static inline void puthex(uint16_t word, char **posx)
 
 #undef pos
 
-const char *frr_inet_ntop(int af, const void * restrict src,
-			  char * restrict dst, socklen_t size)
-	__attribute__((flatten)) OPTIMIZE;
+/* writes the address to o without NUL, returns the end */
+static inline char *ntop_raw(int af, const uint8_t *b, char *o)
+	__attribute__((always_inline)) OPTIMIZE;
 
-const char *frr_inet_ntop(int af, const void * restrict src,
-			  char * restrict dst, socklen_t size)
+static inline char *ntop_raw(int af, const uint8_t *b, char *o)
 {
-	const uint8_t *b = src;
-	/* 8 * "abcd:" for IPv6
-	 * note: the IPv4-embedded IPv6 syntax is only used for ::A.B.C.D,
-	 * which isn't longer than 40 chars either.  even with ::ffff:A.B.C.D
-	 * it's shorter.
-	 */
-	char buf[8 * 5], *o = buf;
-	size_t best = 0, bestlen = 0, curlen = 0, i;
+	unsigned int zero = 0, m, run, best = 0, bestlen = 0, i;
 
 	switch (af) {
 	case AF_INET:
@@ -109,23 +105,22 @@ inet4:
 		putbyte(b[2], &o);
 		*o++ = '.';
 		putbyte(b[3], &o);
-		*o++ = '\0';
-		break;
+		return o;
 	case AF_INET6:
-		for (i = 0; i < 8; i++) {
-			if (b[i * 2] || b[i * 2 + 1]) {
-				if (curlen && curlen > bestlen) {
-					best = i - curlen;
-					bestlen = curlen;
-				}
-				curlen = 0;
-				continue;
+		/* bit i set = word i is zero; no branches, so the compiler
+		 * can vectorize this
+		 */
+		for (i = 0; i < 8; i++)
+			zero |= (unsigned int)!(b[i * 2] | b[i * 2 + 1]) << i;
+
+		/* longest run of zero words, the first one if tied */
+		for (m = zero; m; m &= ~(((1U << run) - 1) << i)) {
+			i = __builtin_ctz(m);
+			run = __builtin_ctz(~(m >> i));
+			if (run > bestlen) {
+				best = i;
+				bestlen = run;
 			}
-			curlen++;
-		}
-		if (curlen && curlen > bestlen) {
-			best = i - curlen;
-			bestlen = curlen;
 		}
 		/* do we want ::ffff:A.B.C.D? */
 		if (best == 0 && bestlen == 6) {
@@ -142,9 +137,7 @@ inet4:
 				if (i == 0)
 					*o++ = ':';
 				*o++ = ':';
-				continue;
-			}
-			if (i > best && i < best + bestlen) {
+				i += bestlen - 1;
 				continue;
 			}
 			puthex((b[i * 2] << 8) | b[i * 2 + 1], &o);
@@ -152,11 +145,40 @@ inet4:
 			if (i < 7)
 				*o++ = ':';
 		}
-		*o++ = '\0';
-		break;
+		return o;
 	default:
 		return NULL;
 	}
+}
+
+char *frr_inet_ntop_raw(int af, const void * restrict src,
+			char * restrict dst) __attribute__((flatten)) OPTIMIZE;
+
+char *frr_inet_ntop_raw(int af, const void * restrict src,
+			char * restrict dst)
+{
+	return ntop_raw(af, src, dst);
+}
+
+const char *frr_inet_ntop(int af, const void * restrict src,
+			  char * restrict dst, socklen_t size)
+	__attribute__((flatten)) OPTIMIZE;
+
+const char *frr_inet_ntop(int af, const void * restrict src,
+			  char * restrict dst, socklen_t size)
+{
+	/* 8 * "abcd:" for IPv6
+	 * note: the IPv4-embedded IPv6 syntax is only used for ::A.B.C.D,
+	 * which isn't longer than 40 chars either.  even with ::ffff:A.B.C.D
+	 * it's shorter.
+	 */
+	char buf[8 * 5], *o;
+	size_t i;
+
+	o = ntop_raw(af, src, buf);
+	if (!o)
+		return NULL;
+	*o++ = '\0';
 
 	i = o - buf;
 	if (i > size)
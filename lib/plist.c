@@ -38,6 +38,7 @@ DEFINE_MTYPE_STATIC(LIB, PREFIX_LIST, "Prefix List");
 DEFINE_MTYPE_STATIC(LIB, MPREFIX_LIST_STR, "Prefix List Str");
 DEFINE_MTYPE_STATIC(LIB, PREFIX_LIST_ENTRY, "Prefix List Entry");
 DEFINE_MTYPE_STATIC(LIB, PREFIX_LIST_TRIE, "Prefix List Trie Table");
+DEFINE_MTYPE_STATIC(LIB, PREFIX_LIST_LPM, "Prefix List LPM index");
 
 /* not currently changeable, code assumes bytes further down */
 #define PLC_BITS	8
@@ -59,6 +60,35 @@ struct pltrie_table {
 	struct pltrie_entry entries[PLC_LEN];
 };
 
+/*
+ * The trie stops at /24 resp. /48, so large lists of longer prefixes or
+ * with wide ge/le ranges end up in long chains that are walked linearly.
+ * Large lists get an additional index instead: entries hashed by their
+ * prefix, plus the set of prefix lengths in use.  An entry can only match
+ * p if its prefix covers p, so a lookup takes one probe per length in use
+ * up to p's length, plus the entries on the same prefix.
+ */
+PREDECL_HASH(plist_lpm);
+
+struct plist_lpm_node {
+	struct plist_lpm_item item;
+	struct prefix prefix;
+
+	/* entries with this prefix, in sequence order */
+	struct prefix_list_entry **entries;
+	unsigned int num;
+};
+
+struct plist_lpm {
+	struct plist_lpm_head nodes;
+	uint64_t version;
+
+	/* bit n set if there are entries for /n */
+	uint64_t lens[IPV6_MAX_BITLEN / 64 + 1];
+};
+
+unsigned int prefix_list_lpm_min = 256;
+
 /* Master structure of prefix_list. */
 struct prefix_master {
 	/* The latest update. */
@@ -70,6 +100,11 @@ struct prefix_master {
 	/* Hook function which is executed when prefix_list is deleted. */
 	void (*delete_hook)(struct prefix_list *);
 
+	/* Hook function which is executed before add_hook/delete_hook with
+	 * the prefix of each entry that changed, NULL for the whole list.
+	 */
+	void (*entry_hook)(struct prefix_list *, const struct prefix *);
+
 	/* number of bytes that have a trie level */
 	size_t trie_depth;
 
@@ -82,22 +117,22 @@ DECLARE_RBTREE_UNIQ(plist, struct prefix_list, plist_item,
 
 /* Static structure of IPv4 prefix_list's master. */
 static struct prefix_master prefix_master_ipv4 = {
-	NULL, NULL, NULL, PLC_MAXLEVELV4,
+	NULL, NULL, NULL, NULL, PLC_MAXLEVELV4,
 };
 
 /* Static structure of IPv6 prefix-list's master. */
 static struct prefix_master prefix_master_ipv6 = {
-	NULL, NULL, NULL, PLC_MAXLEVELV6,
+	NULL, NULL, NULL, NULL, PLC_MAXLEVELV6,
 };
 
 /* Static structure of BGP ORF prefix_list's master. */
 static struct prefix_master prefix_master_orf_v4 = {
-	NULL, NULL, NULL, PLC_MAXLEVELV4,
+	NULL, NULL, NULL, NULL, PLC_MAXLEVELV4,
 };
 
 /* Static structure of BGP ORF prefix_list's master. */
 static struct prefix_master prefix_master_orf_v6 = {
-	NULL, NULL, NULL, PLC_MAXLEVELV6,
+	NULL, NULL, NULL, NULL, PLC_MAXLEVELV6,
 };
 
 static struct prefix_master *prefix_master_get(afi_t afi, int orf)
@@ -158,17 +193,27 @@ struct prefix_list *prefix_bgp_orf_lookup(afi_t afi, const char *name)
 	return prefix_list_lookup_do(afi, 1, name);
 }
 
+/* changes whenever a prefix-list is created or freed */
+static uint32_t plist_epoch = 1;
+
 static struct prefix_list *prefix_list_new(void)
 {
 	struct prefix_list *new;
 
 	new = XCALLOC(MTYPE_PREFIX_LIST, sizeof(struct prefix_list));
+	plist_epoch++;
 	return new;
 }
 
 static void prefix_list_free(struct prefix_list *plist)
 {
 	XFREE(MTYPE_PREFIX_LIST, plist);
+	plist_epoch++;
+}
+
+uint32_t prefix_list_epoch(void)
+{
+	return plist_epoch;
 }
 
 struct prefix_list_entry *prefix_list_entry_new(void)
@@ -222,6 +267,7 @@ struct prefix_list *prefix_list_get(afi_t afi, int orf, const char *name)
 
 static void prefix_list_trie_del(struct prefix_list *plist,
 				 struct prefix_list_entry *pentry);
+static void plist_lpm_free(struct plist_lpm **lpmp);
 
 /* Delete prefix-list from prefix_list_master and free it. */
 void prefix_list_delete(struct prefix_list *plist)
@@ -252,12 +298,15 @@ void prefix_list_delete(struct prefix_list *plist)
 
 	route_map_notify_dependencies(plist->name, RMAP_EVENT_PLIST_DELETED);
 
+	if (master->entry_hook)
+		(*master->entry_hook)(plist, NULL);
 	if (master->delete_hook)
 		(*master->delete_hook)(plist);
 
 	XFREE(MTYPE_MPREFIX_LIST_STR, plist->name);
 
 	XFREE(MTYPE_PREFIX_LIST_TRIE, plist->trie);
+	plist_lpm_free(&plist->lpm);
 
 	prefix_list_free(plist);
 }
@@ -296,6 +345,14 @@ void prefix_list_delete_hook(void (*func)(struct prefix_list *plist))
 	prefix_master_ipv6.delete_hook = func;
 }
 
+/* Entry change hook function. */
+void prefix_list_entry_hook(void (*func)(struct prefix_list *plist,
+					 const struct prefix *prefix))
+{
+	prefix_master_ipv4.entry_hook = func;
+	prefix_master_ipv6.entry_hook = func;
+}
+
 /* Calculate new sequential number. */
 int64_t prefix_new_seq_get(struct prefix_list *plist)
 {
@@ -397,6 +454,8 @@ static void prefix_list_trie_del(struct prefix_list *plist,
 	size_t validbits = pentry->prefix.prefixlen;
 	struct pltrie_table *table, **tables[PLC_MAXLEVEL];
 
+	plist->version++;
+
 	table = plist->trie;
 	for (depth = 0; validbits > PLC_BITS && depth < maxdepth - 1; depth++) {
 		uint8_t byte = bytes[depth];
@@ -438,6 +497,8 @@ void prefix_list_entry_delete(struct prefix_list *plist,
 
 	route_map_notify_pentry_dependencies(plist->name, pentry,
 					     RMAP_EVENT_PLIST_DELETED);
+	if (plist->master->entry_hook)
+		(*plist->master->entry_hook)(plist, &pentry->prefix);
 	prefix_list_entry_free(pentry);
 
 	plist->count--;
@@ -486,6 +547,8 @@ static void prefix_list_trie_add(struct prefix_list *plist,
 	size_t validbits = pentry->prefix.prefixlen;
 	struct pltrie_table *table;
 
+	plist->version++;
+
 	table = plist->trie;
 	while (validbits > PLC_BITS && depth > 1) {
 		if (!table->entries[*bytes].next_table)
@@ -555,6 +618,8 @@ static void prefix_list_entry_add(struct prefix_list *plist,
 					     RMAP_EVENT_PLIST_ADDED);
 
 	/* Run hook function. */
+	if (plist->master->entry_hook)
+		(*plist->master->entry_hook)(plist, &pentry->prefix);
 	if (plist->master->add_hook)
 		(*plist->master->add_hook)(plist);
 
@@ -594,6 +659,8 @@ void prefix_list_entry_update_start(struct prefix_list_entry *ple)
 	pl->count--;
 
 	route_map_notify_dependencies(pl->name, RMAP_EVENT_PLIST_DELETED);
+	if (pl->master->entry_hook)
+		(*pl->master->entry_hook)(pl, &ple->prefix);
 	if (pl->master->delete_hook)
 		(*pl->master->delete_hook)(pl);
 
@@ -666,6 +733,8 @@ void prefix_list_entry_update_finish(struct prefix_list_entry *ple)
 					     RMAP_EVENT_PLIST_ADDED);
 
 	/* Run hook function. */
+	if (pl->master->entry_hook)
+		(*pl->master->entry_hook)(pl, &ple->prefix);
 	if (pl->master->add_hook)
 		(*pl->master->add_hook)(pl);
 
@@ -734,6 +803,113 @@ static int prefix_list_entry_match(struct prefix_list_entry *pentry,
 	return 1;
 }
 
+static int plist_lpm_cmp(const struct plist_lpm_node *a,
+			 const struct plist_lpm_node *b)
+{
+	return prefix_cmp(&a->prefix, &b->prefix);
+}
+
+static uint32_t plist_lpm_hash(const struct plist_lpm_node *node)
+{
+	return prefix_hash_key(&node->prefix);
+}
+
+DECLARE_HASH(plist_lpm, struct plist_lpm_node, item, plist_lpm_cmp,
+	     plist_lpm_hash);
+
+static void plist_lpm_free(struct plist_lpm **lpmp)
+{
+	struct plist_lpm *lpm = *lpmp;
+	struct plist_lpm_node *node;
+
+	if (!lpm)
+		return;
+
+	while ((node = plist_lpm_pop(&lpm->nodes))) {
+		XFREE(MTYPE_PREFIX_LIST_LPM, node->entries);
+		XFREE(MTYPE_PREFIX_LIST_LPM, node);
+	}
+	plist_lpm_fini(&lpm->nodes);
+	XFREE(MTYPE_PREFIX_LIST_LPM, *lpmp);
+}
+
+static struct plist_lpm *plist_lpm_build(struct prefix_list *plist)
+{
+	struct plist_lpm *lpm;
+	struct plist_lpm_node key, *node;
+	struct prefix_list_entry *pentry;
+	uint8_t len;
+
+	lpm = XCALLOC(MTYPE_PREFIX_LIST_LPM, sizeof(*lpm));
+	plist_lpm_init(&lpm->nodes);
+	lpm->version = plist->version;
+
+	/* hashed and compared as a whole, unused bytes must be zero */
+	memset(&key, 0, sizeof(key));
+
+	for (pentry = plist->head; pentry; pentry = pentry->next) {
+		prefix_copy(&key.prefix, &pentry->prefix);
+		apply_mask(&key.prefix);
+
+		node = plist_lpm_find(&lpm->nodes, &key);
+		if (!node) {
+			node = XCALLOC(MTYPE_PREFIX_LIST_LPM, sizeof(*node));
+			node->prefix = key.prefix;
+			plist_lpm_add(&lpm->nodes, node);
+
+			len = key.prefix.prefixlen;
+			lpm->lens[len / 64] |= 1ULL << (len % 64);
+		}
+
+		node->entries = XREALLOC(MTYPE_PREFIX_LIST_LPM, node->entries,
+					 (node->num + 1)
+						 * sizeof(node->entries[0]));
+		node->entries[node->num++] = pentry;
+	}
+
+	return lpm;
+}
+
+static struct prefix_list_entry *
+plist_lpm_lookup(struct plist_lpm *lpm, const struct prefix *p,
+		 bool address_mode, uint64_t *compares)
+{
+	struct prefix_list_entry *pentry, *pbest = NULL;
+	struct plist_lpm_node key, *node;
+	unsigned int i;
+	int len;
+
+	memset(&key, 0, sizeof(key));
+	prefix_copy(&key.prefix, p);
+
+	for (len = p->prefixlen; len >= 0; len--) {
+		if (!(lpm->lens[len / 64] & (1ULL << (len % 64))))
+			continue;
+
+		key.prefix.prefixlen = len;
+		apply_mask(&key.prefix);
+
+		node = plist_lpm_find(&lpm->nodes, &key);
+		if (!node)
+			continue;
+
+		/* first match on this prefix is the only candidate here */
+		for (i = 0; i < node->num; i++) {
+			pentry = node->entries[i];
+			if (pbest && pbest->seq < pentry->seq)
+				break;
+
+			(*compares)++;
+			if (prefix_list_entry_match(pentry, p, address_mode)) {
+				pbest = pentry;
+				break;
+			}
+		}
+	}
+
+	return pbest;
+}
+
 enum prefix_list_type prefix_list_apply_ext(
 	struct prefix_list *plist,
 	const struct prefix_list_entry **which,
@@ -760,6 +936,20 @@ enum prefix_list_type prefix_list_apply_ext(
 		return PREFIX_PERMIT;
 	}
 
+	plist->lookups++;
+
+	if ((unsigned int)plist->count >= prefix_list_lpm_min
+	    && (p->family == AF_INET || p->family == AF_INET6)) {
+		if (!plist->lpm || plist->lpm->version != plist->version) {
+			plist_lpm_free(&plist->lpm);
+			plist->lpm = plist_lpm_build(plist);
+		}
+
+		pbest = plist_lpm_lookup(plist->lpm, p, address_mode,
+					 &plist->compares);
+		goto done;
+	}
+
 	depth = plist->master->trie_depth;
 	table = plist->trie;
 	while (1) {
@@ -767,6 +957,7 @@ enum prefix_list_type prefix_list_apply_ext(
 		     pentry = pentry->next_best) {
 			if (pbest && pbest->seq < pentry->seq)
 				continue;
+			plist->compares++;
 			if (prefix_list_entry_match(pentry, p, address_mode))
 				pbest = pentry;
 		}
@@ -788,12 +979,14 @@ enum prefix_list_type prefix_list_apply_ext(
 		     pentry = pentry->next_best) {
 			if (pbest && pbest->seq < pentry->seq)
 				continue;
+			plist->compares++;
 			if (prefix_list_entry_match(pentry, p, address_mode))
 				pbest = pentry;
 		}
 		break;
 	}
 
+done:
 	if (which) {
 		if (pbest)
 			*which = pbest;
@@ -931,6 +1124,17 @@ static void vty_show_prefix_entry(struct vty *vty, json_object *json, afi_t afi,
 					    plist->head ? plist->head->seq : 0);
 			json_object_int_add(json_pl, "sequenceEnd",
 					    plist->tail ? plist->tail->seq : 0);
+			if (dtype == detail_display) {
+				json_object_int_add(json_pl, "lookups",
+						    plist->lookups);
+				json_object_int_add(json_pl, "entriesCompared",
+						    plist->compares);
+				json_object_int_add(
+					json_pl, "indexPrefixes",
+					plist->lpm ? plist_lpm_count(
+							     &plist->lpm->nodes)
+						   : 0);
+			}
 		} else {
 			vty_out(vty, "ip%s prefix-list %s:\n",
 				afi == AFI_IP ? "" : "v6", plist->name);
@@ -945,6 +1149,22 @@ static void vty_show_prefix_entry(struct vty *vty, json_object *json, afi_t afi,
 				plist->count, plist->rangecount,
 				plist->head ? plist->head->seq : 0,
 				plist->tail ? plist->tail->seq : 0);
+
+			if (dtype == detail_display) {
+				vty_out(vty,
+					"   lookups: %" PRIu64
+					", entries compared: %" PRIu64
+					" (%.1f per lookup)\n",
+					plist->lookups, plist->compares,
+					plist->lookups ? (double)plist->compares
+								 / plist->lookups
+						       : 0.0);
+				if (plist->lpm)
+					vty_out(vty,
+						"   indexed: %zu prefixes\n",
+						plist_lpm_count(
+							&plist->lpm->nodes));
+			}
 		}
 	}
 
@@ -1162,10 +1382,12 @@ static int vty_clear_prefix_list(struct vty *vty, afi_t afi, const char *name,
 		return CMD_WARNING;
 
 	if (name == NULL && prefix == NULL) {
-		frr_each (plist, &master->str, plist)
+		frr_each (plist, &master->str, plist) {
+			plist->lookups = plist->compares = 0;
 			for (pentry = plist->head; pentry;
 			     pentry = pentry->next)
 				pentry->hitcnt = 0;
+		}
 	} else {
 		plist = prefix_list_lookup(afi, name);
 		if (!plist) {
@@ -1181,6 +1403,9 @@ static int vty_clear_prefix_list(struct vty *vty, afi_t afi, const char *name,
 			}
 		}
 
+		if (!prefix)
+			plist->lookups = plist->compares = 0;
+
 		for (pentry = plist->head; pentry; pentry = pentry->next) {
 			if (prefix) {
 				if (pentry->prefix.family == p.family
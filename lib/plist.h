@@ -51,10 +51,23 @@ extern void prefix_list_init(void);
 extern void prefix_list_reset(void);
 extern void prefix_list_add_hook(void (*func)(struct prefix_list *));
 extern void prefix_list_delete_hook(void (*func)(struct prefix_list *));
+/*
+ * Called before the add/delete hook with the prefix of each entry that was
+ * added or removed, or with NULL if the list changed as a whole.  Only
+ * prefixes covered by an entry's prefix can match differently after the
+ * change, which lets users re-evaluate just those.
+ */
+extern void prefix_list_entry_hook(void (*func)(struct prefix_list *,
+						const struct prefix *));
 
 extern const char *prefix_list_name(struct prefix_list *);
 extern afi_t prefix_list_afi(struct prefix_list *);
 extern struct prefix_list *prefix_list_lookup(afi_t, const char *);
+/*
+ * Changes whenever a prefix-list is created or deleted, so a pointer from
+ * prefix_list_lookup() can be kept until then.  Never 0.
+ */
+extern uint32_t prefix_list_epoch(void);
 
 /*
  * prefix_list_apply_which_prefix
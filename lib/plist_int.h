@@ -27,6 +27,7 @@ extern "C" {
 #endif
 
 struct pltrie_table;
+struct plist_lpm;
 
 PREDECL_RBTREE_UNIQ(plist);
 
@@ -45,8 +46,19 @@ struct prefix_list {
 	struct prefix_list_entry *tail;
 
 	struct pltrie_table *trie;
+
+	/* bumped on every entry change, the LPM index is rebuilt lazily */
+	uint64_t version;
+	struct plist_lpm *lpm;
+
+	/* lookup cost, for "show ... prefix-list detail" */
+	uint64_t lookups;
+	uint64_t compares;
 };
 
+/* lists with at least this many entries are looked up through an index */
+extern unsigned int prefix_list_lpm_min;
+
 /* Each prefix-list's entry. */
 struct prefix_list_entry {
 	int64_t seq;
@@ -1033,33 +1033,65 @@ static const char *prefixevpn2str(const struct prefix_evpn *p, char *str,
 	return str;
 }
 
+/* IPv4/IPv6 address, and "/len" if plen >= 0, written to o without NUL */
+static char *prefix_inet2str(int af, const void *addr, int plen, char *o)
+{
+	o = frr_inet_ntop_raw(af, addr, o);
+	if (plen < 0)
+		return o;
+
+	*o++ = '/';
+	if (plen >= 100) {
+		*o++ = '1';
+		plen -= 100;
+		*o++ = '0' + plen / 10;
+	} else if (plen >= 10)
+		*o++ = '0' + plen / 10;
+	*o++ = '0' + plen % 10;
+	return o;
+}
+
+/* same, into a printfrr buffer; directly if there is enough space left */
+static ssize_t bputinet(struct fbuf *fbuf, int af, const void *addr, int plen)
+{
+	char buf[PREFIX2STR_BUFFER], *o;
+	size_t len, ncopy;
+
+	if (fbuf && (size_t)(fbuf->buf + fbuf->len - fbuf->pos)
+			    >= sizeof(buf)) {
+		o = prefix_inet2str(af, addr, plen, fbuf->pos);
+		len = o - fbuf->pos;
+		fbuf->pos = o;
+		return len;
+	}
+
+	o = prefix_inet2str(af, addr, plen, buf);
+	len = o - buf;
+	if (fbuf) {
+		ncopy = MIN(len, (size_t)(fbuf->buf + fbuf->len - fbuf->pos));
+		memcpy(fbuf->pos, buf, ncopy);
+		fbuf->pos += ncopy;
+	}
+	return len;
+}
+
 const char *prefix2str(union prefixconstptr pu, char *str, int size)
 {
 	const struct prefix *p = pu.p;
-	char buf[PREFIX2STR_BUFFER];
-	int byte, tmp, a, b;
-	bool z = false;
-	size_t l;
+	char buf[PREFIX2STR_BUFFER], *o;
 
 	switch (p->family) {
 	case AF_INET:
 	case AF_INET6:
-		inet_ntop(p->family, &p->u.prefix, buf, sizeof(buf));
-		l = strlen(buf);
-		buf[l++] = '/';
-		byte = p->prefixlen;
-		tmp = p->prefixlen - 100;
-		if (tmp >= 0) {
-			buf[l++] = '1';
-			z = true;
-			byte = tmp;
+		if (size >= (int)sizeof(buf)) {
+			o = prefix_inet2str(p->family, &p->u.prefix,
+					    p->prefixlen, str);
+			*o = '\0';
+			break;
 		}
-		b = byte % 10;
-		a = byte / 10;
-		if (a || z)
-			buf[l++] = '0' + a;
-		buf[l++] = '0' + b;
-		buf[l] = '\0';
+		o = prefix_inet2str(p->family, &p->u.prefix, p->prefixlen,
+				    buf);
+		*o = '\0';
 		strlcpy(str, buf, size);
 		break;
 
@@ -1093,8 +1125,7 @@ static ssize_t prefixhost2str(struct fbuf *fbuf, union prefixconstptr pu)
 	switch (p->family) {
 	case AF_INET:
 	case AF_INET6:
-		inet_ntop(p->family, &p->u.prefix, buf, sizeof(buf));
-		return bputs(fbuf, buf);
+		return bputinet(fbuf, p->family, &p->u.prefix, -1);
 
 	case AF_ETHERNET:
 		prefix_mac2str(&p->u.prefix_eth, buf, sizeof(buf));
@@ -1463,7 +1494,6 @@ printfrr_ext_autoreg_p("I4", printfrr_i4);
 static ssize_t printfrr_i4(struct fbuf *buf, struct printfrr_eargs *ea,
 			   const void *ptr)
 {
-	char cbuf[INET_ADDRSTRLEN];
 	bool use_star = false;
 	struct in_addr zero = {};
 
@@ -1478,15 +1508,13 @@ static ssize_t printfrr_i4(struct fbuf *buf, struct printfrr_eargs *ea,
 	if (use_star && !memcmp(ptr, &zero, sizeof(zero)))
 		return bputch(buf, '*');
 
-	inet_ntop(AF_INET, ptr, cbuf, sizeof(cbuf));
-	return bputs(buf, cbuf);
+	return bputinet(buf, AF_INET, ptr, -1);
 }
 
 printfrr_ext_autoreg_p("I6", printfrr_i6);
 static ssize_t printfrr_i6(struct fbuf *buf, struct printfrr_eargs *ea,
 			   const void *ptr)
 {
-	char cbuf[INET6_ADDRSTRLEN];
 	bool use_star = false;
 	struct in6_addr zero = {};
 
@@ -1501,14 +1529,14 @@ static ssize_t printfrr_i6(struct fbuf *buf, struct printfrr_eargs *ea,
 	if (use_star && !memcmp(ptr, &zero, sizeof(zero)))
 		return bputch(buf, '*');
 
-	inet_ntop(AF_INET6, ptr, cbuf, sizeof(cbuf));
-	return bputs(buf, cbuf);
+	return bputinet(buf, AF_INET6, ptr, -1);
 }
 
 printfrr_ext_autoreg_p("FX", printfrr_pfx);
 static ssize_t printfrr_pfx(struct fbuf *buf, struct printfrr_eargs *ea,
 			    const void *ptr)
 {
+	const struct prefix *p = ptr;
 	bool host_only = false;
 
 	if (ea->fmt[0] == 'h') {
@@ -1521,6 +1549,8 @@ static ssize_t printfrr_pfx(struct fbuf *buf, struct printfrr_eargs *ea,
 
 	if (host_only)
 		return prefixhost2str(buf, (struct prefix *)ptr);
+	else if (p->family == AF_INET || p->family == AF_INET6)
+		return bputinet(buf, p->family, &p->u.prefix, p->prefixlen);
 	else {
 		char cbuf[PREFIX_STRLEN];
 
@@ -443,6 +443,12 @@ extern int str2prefix(const char *, struct prefix *);
 
 #define PREFIX2STR_BUFFER  PREFIX_STRLEN
 
+/* lib/ntop.c: AF_INET/AF_INET6 address to text, without NUL terminator or
+ * length check (dst needs INET6_ADDRSTRLEN.)  Returns the end of the output,
+ * NULL for other address families.
+ */
+extern char *frr_inet_ntop_raw(int af, const void *src, char *dst);
+
 extern void prefix_mcast_inet4_dump(const char *onfail, struct in_addr addr,
 				char *buf, int buf_size);
 extern const char *prefix_sg2str(const struct prefix_sg *sg, char *str);
@@ -27,6 +27,9 @@
 #define PULLWR_THRESH	16384	/* size at which we start to call write() */
 #define PULLWR_MAXSPIN	2500	/* max µs to spend grabbing more data */
 
+/* max streams per writev() */
+#define PULLWR_IOV	64
+
 struct pullwr {
 	int fd;
 	struct thread_master *tm;
@@ -37,19 +40,19 @@ struct pullwr {
 	void (*fill)(void *, struct pullwr *);
 	void (*err)(void *, struct pullwr *, bool);
 
-	/* ring buffer (although it's "un-ringed" on resizing, it WILL wrap
-	 * around if data is trickling in while keeping it at a constant size)
+	/* queued data, the head stream is written out up to its getp.
+	 * pullwr_write() appends to the tail stream while it has room.
 	 */
-	size_t bufsz, valid, pos;
+	struct stream_fifo queue;
+	size_t valid;
+	size_t depth, depth_max;
 	uint64_t total_written;
-	char *buffer;
 
 	size_t thresh;		/* PULLWR_THRESH */
 	int64_t maxspin;	/* PULLWR_MAXSPIN */
 };
 
 DEFINE_MTYPE_STATIC(LIB, PULLWR_HEAD, "pull-driven write controller");
-DEFINE_MTYPE_STATIC(LIB, PULLWR_BUF,  "pull-driven write buffer");
 
 static void pullwr_run(struct thread *t);
 
@@ -66,6 +69,7 @@ struct pullwr *_pullwr_new(struct thread_master *tm, int fd,
 	pullwr->arg = arg;
 	pullwr->fill = fill;
 	pullwr->err = err;
+	stream_fifo_init(&pullwr->queue);
 
 	pullwr->thresh = PULLWR_THRESH;
 	pullwr->maxspin = PULLWR_MAXSPIN;
@@ -77,7 +81,7 @@ void pullwr_del(struct pullwr *pullwr)
 {
 	THREAD_OFF(pullwr->writer);
 
-	XFREE(MTYPE_PULLWR_BUF, pullwr->buffer);
+	stream_fifo_deinit(&pullwr->queue);
 	XFREE(MTYPE_PULLWR_HEAD, pullwr);
 }
 
@@ -96,103 +100,81 @@ void pullwr_bump(struct pullwr *pullwr)
 	thread_add_timer(pullwr->tm, pullwr_run, pullwr, 0, &pullwr->writer);
 }
 
-static size_t pullwr_iov(struct pullwr *pullwr, struct iovec *iov)
+static void pullwr_enqueue(struct pullwr *pullwr, struct stream *s)
 {
-	size_t len1;
+	stream_fifo_push(&pullwr->queue, s);
+	pullwr->depth++;
+	pullwr->depth_max = MAX(pullwr->depth_max, pullwr->depth);
+}
 
-	if (pullwr->valid == 0)
-		return 0;
+void pullwr_write(struct pullwr *pullwr, const void *data, size_t len)
+{
+	struct stream *s = pullwr->queue.tail;
 
-	if (pullwr->pos + pullwr->valid <= pullwr->bufsz) {
-		iov[0].iov_base = pullwr->buffer + pullwr->pos;
-		iov[0].iov_len = pullwr->valid;
-		return 1;
+	/* small writes from fill() are collected in thresh sized streams,
+	 * larger ones get a stream of their own
+	 */
+	if (len && (!s || STREAM_WRITEABLE(s) < len)) {
+		s = stream_new_pooled(MAX(len, pullwr->thresh));
+		pullwr_enqueue(pullwr, s);
 	}
+	if (len)
+		stream_put(s, data, len);
+	pullwr->valid += len;
 
-	len1 = pullwr->bufsz - pullwr->pos;
-
-	iov[0].iov_base = pullwr->buffer + pullwr->pos;
-	iov[0].iov_len = len1;
-	iov[1].iov_base = pullwr->buffer;
-	iov[1].iov_len = pullwr->valid - len1;
-	return 2;
+	pullwr_bump(pullwr);
 }
 
-static void pullwr_resize(struct pullwr *pullwr, size_t need)
+void pullwr_write_stream_take(struct pullwr *pullwr, struct stream *s)
 {
-	struct iovec iov[2];
-	size_t niov, newsize;
-	char *newbuf;
-
-	/* the buffer is maintained at pullwr->thresh * 2 since we'll be
-	 * trying to fill it as long as it's anywhere below pullwr->thresh.
-	 * That means we frequently end up a little short of it and then write
-	 * something that goes over the threshold.  So, just use double.
-	 */
-	if (need) {
-		/* resize up */
-		if (pullwr->bufsz - pullwr->valid >= need)
-			return;
-
-		newsize = MAX((pullwr->valid + need) * 2, pullwr->thresh * 2);
-		newbuf = XMALLOC(MTYPE_PULLWR_BUF, newsize);
-	} else if (!pullwr->valid) {
-		/* resize down, buffer empty */
-		newsize = 0;
-		newbuf = NULL;
-	} else {
-		/* resize down */
-		if (pullwr->bufsz - pullwr->valid < pullwr->thresh)
-			return;
-		newsize = MAX(pullwr->valid, pullwr->thresh * 2);
-		newbuf = XMALLOC(MTYPE_PULLWR_BUF, newsize);
-	}
+	size_t len = STREAM_READABLE(s);
 
-	niov = pullwr_iov(pullwr, iov);
-	if (niov >= 1) {
-		memcpy(newbuf, iov[0].iov_base, iov[0].iov_len);
-		if (niov >= 2)
-			memcpy(newbuf + iov[0].iov_len,
-				iov[1].iov_base, iov[1].iov_len);
-	}
+	if (len)
+		pullwr_enqueue(pullwr, s);
+	else
+		stream_free(s);
+	pullwr->valid += len;
 
-	XFREE(MTYPE_PULLWR_BUF, pullwr->buffer);
-	pullwr->buffer = newbuf;
-	pullwr->bufsz = newsize;
-	pullwr->pos = 0;
+	pullwr_bump(pullwr);
 }
 
-void pullwr_write(struct pullwr *pullwr, const void *data, size_t len)
+static size_t pullwr_iov(struct pullwr *pullwr, struct iovec *iov)
 {
-	pullwr_resize(pullwr, len);
+	struct stream *s;
+	size_t niov = 0;
 
-	if (pullwr->pos + pullwr->valid > pullwr->bufsz) {
-		size_t pos;
+	for (s = pullwr->queue.head; s && niov < PULLWR_IOV; s = s->next) {
+		iov[niov].iov_base = s->data + s->getp;
+		iov[niov].iov_len = STREAM_READABLE(s);
+		niov++;
+	}
+	return niov;
+}
 
-		pos = (pullwr->pos + pullwr->valid) % pullwr->bufsz;
-		memcpy(pullwr->buffer + pos, data, len);
-	} else {
-		size_t max1, len1;
-		max1 = pullwr->bufsz - (pullwr->pos + pullwr->valid);
-		max1 = MIN(max1, len);
+static void pullwr_consume(struct pullwr *pullwr, size_t nwr)
+{
+	struct stream *s;
 
-		memcpy(pullwr->buffer + pullwr->pos + pullwr->valid,
-				data, max1);
-		len1 = len - max1;
+	pullwr->total_written += nwr;
+	pullwr->valid -= nwr;
 
-		if (len1)
-			memcpy(pullwr->buffer, (char *)data + max1, len1);
+	while (nwr) {
+		s = stream_fifo_head(&pullwr->queue);
+		if (nwr < STREAM_READABLE(s)) {
+			s->getp += nwr;
+			return;
+		}
 
+		nwr -= STREAM_READABLE(s);
+		stream_free(stream_fifo_pop(&pullwr->queue));
+		pullwr->depth--;
 	}
-	pullwr->valid += len;
-
-	pullwr_bump(pullwr);
 }
 
 static void pullwr_run(struct thread *t)
 {
 	struct pullwr *pullwr = THREAD_ARG(t);
-	struct iovec iov[2];
+	struct iovec iov[PULLWR_IOV];
 	size_t niov, lastvalid;
 	ssize_t nwr;
 	struct timeval t0;
@@ -221,7 +203,6 @@ static void pullwr_run(struct thread *t)
 			 * data in, and we have nothing more queued, so we go
 			 * into idle, i.e. no calling thread_add_write()
 			 */
-			pullwr_resize(pullwr, 0);
 			return;
 		}
 
@@ -241,23 +222,15 @@ static void pullwr_run(struct thread *t)
 			return;
 		}
 
-		pullwr->total_written += nwr;
-		pullwr->valid -= nwr;
-		pullwr->pos += nwr;
-		pullwr->pos %= pullwr->bufsz;
+		pullwr_consume(pullwr, nwr);
 	} while (pullwr->valid == 0 && !maxspun);
-	/* pullwr->valid != 0 implies we did an incomplete write, i.e. socket
-	 * is full and we go wait until it's available for writing again.
+	/* pullwr->valid != 0 implies we did an incomplete write (or ran out
+	 * of iovecs), i.e. socket is full and we go wait until it's available
+	 * for writing again.
 	 */
 
 	thread_add_write(pullwr->tm, pullwr_run, pullwr, pullwr->fd,
 			&pullwr->writer);
-
-	/* if we hit the time limit, just keep the buffer, we'll probably need
-	 * it anyway & another run is already coming up.
-	 */
-	if (!maxspun)
-		pullwr_resize(pullwr, 0);
 }
 
 void pullwr_stats(struct pullwr *pullwr, uint64_t *total_written,
@@ -272,3 +245,10 @@ void pullwr_stats(struct pullwr *pullwr, uint64_t *total_written,
 		tmp = 0;
 	*kernel_pending = tmp;
 }
+
+void pullwr_queue_stats(struct pullwr *pullwr, size_t *depth,
+			size_t *depth_max)
+{
+	*depth = pullwr->depth;
+	*depth_max = pullwr->depth_max;
+}
@@ -108,8 +108,21 @@ static inline void pullwr_write_stream(struct pullwr *pullwr,
 	pullwr_write(pullwr, s->data, stream_get_endp(s));
 }
 
+/* queue the readable part of s without copying it; the pullwr takes
+ * ownership and frees s once it has been written out.  Data from
+ * pullwr_write() and from queued streams goes out in the order it came in,
+ * with up to 64 queued chunks per writev().
+ */
+extern void pullwr_write_stream_take(struct pullwr *pullwr, struct stream *s);
+
+/* pending is data queued in the pullwr, kernel_pending data written to the
+ * socket but not sent (or acked) yet.
+ */
 extern void pullwr_stats(struct pullwr *pullwr, uint64_t *total_written,
 			 size_t *pending, size_t *kernel_pending);
+/* number of chunks (streams) queued, now and at most */
+extern void pullwr_queue_stats(struct pullwr *pullwr, size_t *depth,
+			       size_t *depth_max);
 
 #ifdef __cplusplus
 }
@@ -42,6 +42,7 @@ DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_INDEX, "Route map index");
 DEFINE_MTYPE(LIB, ROUTE_MAP_RULE, "Route map rule");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_RULE_STR, "Route map rule str");
 DEFINE_MTYPE(LIB, ROUTE_MAP_COMPILED, "Route map compiled");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_OPS, "Route map compiled rules");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP, "Route map dependency");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP_DATA, "Route map dependency data");
 
@@ -101,6 +102,7 @@ static void route_map_del_plist_entries(afi_t afi,
 
 static struct hash *route_map_get_dep_hash(route_map_event_t event);
 static void route_map_free_map(struct route_map *map);
+static void route_map_calls_update(void);
 
 struct route_map_match_set_hooks rmap_match_set_hook;
 
@@ -681,6 +683,8 @@ static struct route_map *route_map_add(const char *name)
 	if (!map->ipv6_prefix_table)
 		map->ipv6_prefix_table = route_table_init();
 
+	route_map_calls_update();
+
 	if (rmap_debug)
 		zlog_debug("Add route-map %s", name);
 	return map;
@@ -721,6 +725,8 @@ static void route_map_free_map(struct route_map *map)
 	hash_release(route_map_master_hash, map);
 	XFREE(MTYPE_ROUTE_MAP_NAME, map->name);
 	XFREE(MTYPE_ROUTE_MAP, map);
+
+	route_map_calls_update();
 }
 
 /* Route map delete from list. */
@@ -738,6 +744,8 @@ void route_map_delete(struct route_map *map)
 	/* Clear all dependencies */
 	route_map_clear_all_references(name);
 	map->deleted = true;
+	route_map_calls_update();
+
 	/* Execute deletion hook. */
 	if (route_map_master.delete_hook) {
 		(*route_map_master.delete_hook)(name);
@@ -1124,6 +1132,7 @@ static struct route_map_index *route_map_index_new(void)
 
 	new = XCALLOC(MTYPE_ROUTE_MAP_INDEX, sizeof(struct route_map_index));
 	new->exitpolicy = RMAP_EXIT; /* Default to Cisco-style */
+	new->prefix_independent = true;
 	TAILQ_INIT(&new->rhclist);
 	QOBJ_REG(new, route_map_index);
 	return new;
@@ -1178,6 +1187,8 @@ void route_map_index_delete(struct route_map_index *index, int notify)
 
 	/* Free 'char *nextrm' if not NULL */
 	XFREE(MTYPE_ROUTE_MAP_NAME, index->nextrm);
+	XFREE(MTYPE_ROUTE_MAP_OPS, index->match_ops);
+	XFREE(MTYPE_ROUTE_MAP_OPS, index->set_ops);
 
 	route_map_pfx_tbl_update(RMAP_EVENT_INDEX_DELETED, index, 0, NULL);
 
@@ -1353,6 +1364,109 @@ static void route_map_rule_delete(struct route_map_rule_list *list,
 	XFREE(MTYPE_ROUTE_MAP_RULE, rule);
 }
 
+static unsigned int route_map_rule_count(const struct route_map_rule_list *list)
+{
+	const struct route_map_rule *rule;
+	unsigned int n = 0;
+
+	for (rule = list->head; rule; rule = rule->next)
+		n++;
+	return n;
+}
+
+/*
+ * Flattens the rules of an index into what route_map_apply() runs.  The
+ * result of the matches doesn't depend on their order, so they are sorted
+ * by cost, keeping configuration order for the same cost.  Sets run in
+ * configuration order.
+ */
+static void route_map_index_compile(struct route_map_index *index)
+{
+	struct route_map_rule *rule;
+	struct route_map_op op;
+	unsigned int i;
+
+	XFREE(MTYPE_ROUTE_MAP_OPS, index->match_ops);
+	XFREE(MTYPE_ROUTE_MAP_OPS, index->set_ops);
+	index->prefix_independent = true;
+
+	index->match_ops_num = route_map_rule_count(&index->match_list);
+	if (index->match_ops_num)
+		index->match_ops =
+			XCALLOC(MTYPE_ROUTE_MAP_OPS,
+				index->match_ops_num * sizeof(op));
+
+	i = 0;
+	for (rule = index->match_list.head; rule; rule = rule->next) {
+		unsigned int j;
+
+		op.func_apply = rule->cmd->func_apply;
+		op.value = rule->value;
+		op.cost = rule->cmd->cost ? rule->cmd->cost
+					  : RMAP_COST_DEFAULT;
+		if (!CHECK_FLAG(rule->cmd->flags, RMAP_RULE_PREFIX_INDEPENDENT))
+			index->prefix_independent = false;
+
+		for (j = i; j > 0 && index->match_ops[j - 1].cost > op.cost;
+		     j--)
+			index->match_ops[j] = index->match_ops[j - 1];
+		index->match_ops[j] = op;
+		i++;
+	}
+
+	index->set_ops_num = route_map_rule_count(&index->set_list);
+	if (index->set_ops_num)
+		index->set_ops = XCALLOC(MTYPE_ROUTE_MAP_OPS,
+					 index->set_ops_num * sizeof(op));
+
+	i = 0;
+	for (rule = index->set_list.head; rule; rule = rule->next) {
+		index->set_ops[i].func_apply = rule->cmd->func_apply;
+		index->set_ops[i].value = rule->value;
+		if (!CHECK_FLAG(rule->cmd->flags, RMAP_RULE_PREFIX_INDEPENDENT))
+			index->prefix_independent = false;
+		i++;
+	}
+}
+
+bool route_map_prefix_independent(const struct route_map *map)
+{
+	const struct route_map_index *index;
+
+	for (index = map->head; index; index = index->next)
+		if (!index->prefix_independent || index->nextrm)
+			return false;
+	return true;
+}
+
+/* entries with a "call", as of the last route_map_resolve_calls() */
+static unsigned int route_map_ncalls;
+
+void route_map_resolve_calls(void)
+{
+	struct route_map *map;
+	struct route_map_index *index;
+
+	route_map_ncalls = 0;
+	for (map = route_map_master.head; map; map = map->next)
+		for (index = map->head; index; index = index->next) {
+			if (!index->nextrm) {
+				index->nextrm_map = NULL;
+				continue;
+			}
+			index->nextrm_map =
+				route_map_lookup_by_name(index->nextrm);
+			route_map_ncalls++;
+		}
+}
+
+/* a route-map came or went, call targets may have changed */
+static void route_map_calls_update(void)
+{
+	if (route_map_ncalls)
+		route_map_resolve_calls();
+}
+
 /* strcmp wrapper function which don't crush even argument is NULL. */
 static int rulecmp(const char *dst, const char *src)
 {
@@ -1529,6 +1643,7 @@ enum rmap_compile_rets route_map_add_match(struct route_map_index *index,
 
 	/* Add new route match rule to linked list. */
 	route_map_rule_add(&index->match_list, rule);
+	route_map_index_compile(index);
 
 	/* If IPv4 or IPv6 prefix-list match criteria
 	 * has been added to the route-map index, update
@@ -1589,6 +1704,7 @@ enum rmap_compile_rets route_map_delete_match(struct route_map_index *index,
 						index->map->name);
 
 			route_map_rule_delete(&index->match_list, rule);
+			route_map_index_compile(index);
 
 			/* If IPv4 or IPv6 prefix-list match criteria
 			 * has been delete from the route-map index, update
@@ -1652,6 +1768,7 @@ enum rmap_compile_rets route_map_add_set(struct route_map_index *index,
 
 	/* Add new route match rule to linked list. */
 	route_map_rule_add(&index->set_list, rule);
+	route_map_index_compile(index);
 
 	/* Execute event hook. */
 	if (route_map_master.event_hook) {
@@ -1678,6 +1795,8 @@ enum rmap_compile_rets route_map_delete_set(struct route_map_index *index,
 		if ((rule->cmd == cmd) && (rulecmp(rule->rule_str, set_arg) == 0
 					   || set_arg == NULL)) {
 			route_map_rule_delete(&index->set_list, rule);
+			route_map_index_compile(index);
+
 			/* Execute event hook. */
 			if (route_map_master.event_hook) {
 				(*route_map_master.event_hook)(index->map->name);
@@ -1692,20 +1811,21 @@ enum rmap_compile_rets route_map_delete_set(struct route_map_index *index,
 }
 
 static enum route_map_cmd_result_t
-route_map_apply_match(struct route_map_rule_list *match_list,
+route_map_apply_match(const struct route_map_index *index,
 		      const struct prefix *prefix, void *object)
 {
 	enum route_map_cmd_result_t ret = RMAP_NOMATCH;
-	struct route_map_rule *match;
+	const struct route_map_op *match;
 	bool is_matched = false;
 
 
 	/* Check all match rule and if there is no match rule, go to the
 	   set statement. */
-	if (!match_list->head)
+	if (!index->match_ops_num)
 		ret = RMAP_MATCH;
 	else {
-		for (match = match_list->head; match; match = match->next) {
+		for (match = index->match_ops;
+		     match < index->match_ops + index->match_ops_num; match++) {
 			/*
 			 * Try each match statement. If any match does not
 			 * return RMAP_MATCH or RMAP_NOOP, return.
@@ -1716,8 +1836,8 @@ route_map_apply_match(struct route_map_rule_list *match_list,
 			 * MATCH/NOOP, then also end-result is a match)
 			 * If all result in NOOP, end-result is NOOP.
 			 */
-			ret = (*match->cmd->func_apply)(match->value, prefix,
-							object);
+			ret = (*match->func_apply)(match->value, prefix,
+						   object);
 
 			/*
 			 * If the consolidated result of func_apply is:
@@ -1856,8 +1976,7 @@ route_map_get_index(struct route_map *map, const struct prefix *prefix,
 			if (best_index && (best_index->pref < index->pref))
 				break;
 
-			ret = route_map_apply_match(&index->match_list, prefix,
-						    object);
+			ret = route_map_apply_match(index, prefix, object);
 
 			if (ret == RMAP_MATCH) {
 				*match_ret = ret;
@@ -2547,7 +2666,7 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 	enum route_map_cmd_result_t match_ret = RMAP_NOMATCH;
 	route_map_result_t ret = RMAP_PERMITMATCH;
 	struct route_map_index *index = NULL;
-	struct route_map_rule *set = NULL;
+	const struct route_map_op *set = NULL;
 	bool skip_match_clause = false;
 
 	if (recursion > RMAP_RECURSION_LIMIT) {
@@ -2602,8 +2721,8 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 		if (!skip_match_clause) {
 			index->applied++;
 			/* Apply this index. */
-			match_ret = route_map_apply_match(&index->match_list,
-							  prefix, match_object);
+			match_ret = route_map_apply_match(index, prefix,
+							  match_object);
 			if (rmap_debug) {
 				zlog_debug(
 					"Route-map: %s, sequence: %d, prefix: %pFX, result: %s",
@@ -2653,22 +2772,22 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 				ret = RMAP_PERMITMATCH;
 
 				/* permit+match must execute sets */
-				for (set = index->set_list.head; set;
-				     set = set->next)
+				for (set = index->set_ops;
+				     set < index->set_ops + index->set_ops_num;
+				     set++)
 					/*
 					 * set cmds return RMAP_OKAY or
 					 * RMAP_ERROR. We do not care if
 					 * set succeeded or not. So, ignore
 					 * return code.
 					 */
-					(void)(*set->cmd->func_apply)(
+					(void)(*set->func_apply)(
 						set->value, prefix, set_object);
 
 				/* Call another route-map if available */
 				if (index->nextrm) {
 					struct route_map *nextrm =
-						route_map_lookup_by_name(
-							index->nextrm);
+						index->nextrm_map;
 
 					if (nextrm) /* Target route-map found,
 						       jump to it */
@@ -117,8 +117,28 @@ struct route_map_rule_cmd {
 
 	/** To get the rule key after Compilation **/
 	void *(*func_get_rmap_rule_key)(void *val);
+
+	/* Relative cost of func_apply; the matches of an entry are tried
+	 * cheapest first, so the first one not matching saves the others.
+	 * 0 is RMAP_COST_DEFAULT.
+	 */
+	uint8_t cost;
+
+	/* RMAP_RULE_* */
+	uint8_t flags;
 };
 
+/* func_apply only looks at and changes the object's attributes, never the
+ * prefix or anything else, so applying a route-map made of such rules to
+ * equal attributes always gives the same result, see
+ * route_map_prefix_independent().
+ */
+#define RMAP_RULE_PREFIX_INDEPENDENT 0x01
+
+#define RMAP_COST_LOW 1
+#define RMAP_COST_DEFAULT 4
+#define RMAP_COST_HIGH 8
+
 /* Route map apply error. */
 enum rmap_compile_rets {
 	RMAP_COMPILE_SUCCESS,
@@ -153,6 +173,15 @@ struct route_map_rule_list {
 	struct route_map_rule *tail;
 };
 
+/* Compiled rule, what route_map_apply() runs */
+struct route_map_op {
+	enum route_map_cmd_result_t (*func_apply)(void *rule,
+						  const struct prefix *prefix,
+						  void *object);
+	void *value;
+	uint8_t cost;
+};
+
 /* Forward struct declaration: the complete can be found later this file. */
 struct routemap_hook_context;
 
@@ -180,6 +209,19 @@ struct route_map_index {
 	struct route_map_rule_list match_list;
 	struct route_map_rule_list set_list;
 
+	/* The rules above as flat arrays, matches cheapest first, rebuilt
+	 * whenever they change.  nextrm_map is the "call" target, kept
+	 * resolved as route-maps come and go.
+	 */
+	struct route_map_op *match_ops;
+	struct route_map_op *set_ops;
+	unsigned int match_ops_num;
+	unsigned int set_ops_num;
+	struct route_map *nextrm_map;
+
+	/* all rules are RMAP_RULE_PREFIX_INDEPENDENT */
+	bool prefix_independent;
+
 	/* Make linked list. */
 	struct route_map_index *next;
 	struct route_map_index *prev;
@@ -486,6 +528,12 @@ extern route_map_result_t route_map_apply_ext(struct route_map *map,
 #define route_map_apply(map, prefix, object)                                   \
 	route_map_apply_ext(map, prefix, object, object, NULL)
 
+/* True if all entries of map consist of RMAP_RULE_PREFIX_INDEPENDENT rules
+ * and none calls another route-map, i.e. the result only depends on the
+ * attributes map is applied to:  users may remember it for them.
+ */
+extern bool route_map_prefix_independent(const struct route_map *map);
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
@@ -499,6 +547,9 @@ extern void route_map_delete_hook(void (*func)(const char *));
 extern void route_map_event_hook(void (*func)(const char *name));
 extern int route_map_mark_updated(const char *name);
 extern void route_map_walk_update_list(void (*update_fn)(char *name));
+/* Re-resolve "call" targets after nextrm of an entry changed */
+extern void route_map_resolve_calls(void);
+
 extern void route_map_upd8_dependency(route_map_event_t type, const char *arg,
 				      const char *rmap_name);
 extern void route_map_notify_dependencies(const char *affected_name,
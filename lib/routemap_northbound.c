@@ -332,6 +332,7 @@ static int lib_route_map_entry_call_modify(struct nb_cb_modify_args *args)
 		rmi->nextrm = args->resource->ptr;
 		route_map_upd8_dependency(RMAP_EVENT_CALL_ADDED, rmi->nextrm,
 					  rmi->map->name);
+		route_map_resolve_calls();
 		break;
 	}
 
@@ -354,6 +355,7 @@ static int lib_route_map_entry_call_destroy(struct nb_cb_destroy_args *args)
 					  rmi->map->name);
 		XFREE(MTYPE_ROUTE_MAP_NAME, rmi->nextrm);
 		rmi->nextrm = NULL;
+		route_map_resolve_calls();
 		break;
 	}
 
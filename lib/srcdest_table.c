@@ -80,7 +80,8 @@ static void srcdest_rnode_destroy(route_table_delegate_t *delegate,
 
 route_table_delegate_t _srcdest_dstnode_delegate = {
 	.create_node = srcdest_rnode_create,
-	.destroy_node = srcdest_rnode_destroy};
+	.destroy_node = srcdest_rnode_destroy,
+	.stride = ROUTE_TABLE_STRIDE_MAX};
 
 /* ----- functions to manage rnodes _in_ srcdest table ----- */
 
@@ -265,6 +266,51 @@ struct route_node *srcdest_rnode_lookup(struct route_table *table,
 	return srn;
 }
 
+struct route_node *srcdest_rnode_match(struct route_table *table,
+				       union prefixconstptr dst_pu,
+				       const struct prefix_ipv6 *src_p)
+{
+	const struct prefix *dst_p = dst_pu.p;
+	struct route_node *node, *deepest = NULL;
+	struct srcdest_rnode *srn;
+	struct route_node *match;
+	bool has_src = src_p && src_p->prefixlen;
+
+	/* Find the deepest covering destination node that has any route;
+	 * all other candidates are its parents.  route_node_match() gets
+	 * there quickly for plain routes, but skips nodes that only have
+	 * srcdest routes, so continue the descent below it for those.
+	 */
+	deepest = route_node_match(table, dst_p);
+	if (deepest)
+		route_unlock_node(deepest);
+
+	node = deepest ? deepest : table->top;
+	while (node && node->p.prefixlen <= dst_p->prefixlen
+	       && prefix_match(&node->p, dst_p)) {
+		srn = srcdest_rnode_from_rnode(node);
+		if (node->info || (has_src && srn->src_table))
+			deepest = node;
+		if (node->p.prefixlen == dst_p->prefixlen)
+			break;
+		node = node->link[prefix_bit(&dst_p->u.prefix,
+					     node->p.prefixlen)];
+	}
+
+	for (node = deepest; node; node = node->parent) {
+		srn = srcdest_rnode_from_rnode(node);
+		if (has_src && srn->src_table) {
+			match = route_node_match(srn->src_table,
+						 (const struct prefix *)src_p);
+			if (match)
+				return match;
+		}
+		if (node->info)
+			return route_lock_node(node);
+	}
+	return NULL;
+}
+
 void srcdest_rnode_prefixes(const struct route_node *rn,
 			    const struct prefix **p,
 			    const struct prefix **src_p)
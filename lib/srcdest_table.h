@@ -65,6 +65,15 @@ extern struct route_node *srcdest_rnode_get(struct route_table *table,
 extern struct route_node *srcdest_rnode_lookup(struct route_table *table,
 					       union prefixconstptr dst_pu,
 					       const struct prefix_ipv6 *src_p);
+/* Longest match on (dst_p, src_p), the way the kernel forwards: the most
+ * specific destination that has a route for this source, where a plain
+ * (non-srcdest) route on the destination matches any source.  Returns a
+ * locked node with info set, or NULL.  src_p may be NULL or ::/0 to only
+ * match plain routes.
+ */
+extern struct route_node *srcdest_rnode_match(struct route_table *table,
+					      union prefixconstptr dst_pu,
+					      const struct prefix_ipv6 *src_p);
 extern void srcdest_rnode_prefixes(const struct route_node *rn,
 				   const struct prefix **p,
 				   const struct prefix **src_p);
@@ -30,10 +30,112 @@
 #include "log.h"
 #include "frr_pthread.h"
 #include "lib_errors.h"
+#include "libfrr_trace.h"
 
 DEFINE_MTYPE_STATIC(LIB, STREAM, "Stream");
 DEFINE_MTYPE_STATIC(LIB, STREAM_FIFO, "Stream FIFO");
 
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+/* Stream pools: each pthread keeps a list of freed pooled streams per size
+ * class, up to STREAM_POOL_KEEP bytes per class.  Streams are often freed on
+ * another pthread than the one that made them (zserv and bgp_io hand them
+ * over through fifos), so a pthread with a full cache moves half of it to a
+ * shared depot, and one with an empty cache refills from there.  Cached
+ * streams are still MTYPE_STREAM allocations, so they show up as such in
+ * "show memory".
+ */
+static const size_t stream_pool_size[STREAM_POOL_CLASSES] = {
+	512, 4096, 16384, 65536,
+};
+
+#define STREAM_POOL_KEEP (1024 * 1024)
+/* the depot holds up to this many per-pthread caches' worth */
+#define STREAM_POOL_DEPOT 8
+
+struct stream_pool {
+	struct stream *free[STREAM_POOL_CLASSES];
+	size_t count[STREAM_POOL_CLASSES];
+};
+
+static pthread_mutex_t stream_depot_mtx = PTHREAD_MUTEX_INITIALIZER;
+/* Requires: stream_depot_mtx */
+static struct stream_pool stream_depot;
+
+static size_t stream_pool_keep(unsigned int i)
+{
+	return MAX(STREAM_POOL_KEEP / stream_pool_size[i], 4U);
+}
+
+/* move up to n streams from the head of one list to another */
+static void stream_pool_move(struct stream_pool *dst, struct stream_pool *src,
+			     unsigned int i, size_t n)
+{
+	struct stream *s;
+
+	while (n-- && (s = src->free[i])) {
+		src->free[i] = s->next;
+		src->count[i]--;
+		s->next = dst->free[i];
+		dst->free[i] = s;
+		dst->count[i]++;
+	}
+}
+
+static struct stream_pool_counters {
+	atomic_size_t hits, misses, cached, dropped;
+} stream_pool_ctr[STREAM_POOL_CLASSES];
+
+static pthread_key_t stream_pool_key;
+static thread_local struct stream_pool *stream_pool_tls
+	__attribute__((tls_model("initial-exec")));
+static thread_local bool stream_pool_exited
+	__attribute__((tls_model("initial-exec")));
+
+static void stream_pool_exit(void *arg)
+{
+	struct stream_pool *pool = arg;
+	struct stream *s;
+	unsigned int i;
+
+	stream_pool_exited = true;
+	stream_pool_tls = NULL;
+
+	for (i = 0; i < STREAM_POOL_CLASSES; i++) {
+		while ((s = pool->free[i])) {
+			pool->free[i] = s->next;
+			XFREE(MTYPE_STREAM, s);
+		}
+		atomic_fetch_sub_explicit(&stream_pool_ctr[i].cached,
+					  pool->count[i], memory_order_relaxed);
+	}
+	free(pool);
+}
+
+static void stream_pool_key_init(void) __attribute__((_CONSTRUCTOR(500)));
+static void stream_pool_key_init(void)
+{
+	pthread_key_create(&stream_pool_key, stream_pool_exit);
+}
+
+static struct stream_pool *stream_pool_get(void)
+{
+	struct stream_pool *pool = stream_pool_tls;
+
+	if (__builtin_expect(pool != NULL, 1) || stream_pool_exited)
+		return pool;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pthread_setspecific(stream_pool_key, pool);
+	stream_pool_tls = pool;
+	return pool;
+}
+
 /* Tests whether a position is valid */
 #define GETP_VALID(S, G) ((G) <= (S)->endp)
 #define PUT_AT_VALID(S,G) GETP_VALID(S,G)
@@ -112,15 +214,107 @@ struct stream *stream_new(size_t size)
 	s->getp = s->endp = 0;
 	s->next = NULL;
 	s->size = size;
+	s->pool = 0;
+
+	frrtrace(2, frr_libfrr, stream_new, s, size);
+	return s;
+}
+
+struct stream *stream_new_pooled(size_t size)
+{
+	struct stream_pool *pool;
+	struct stream *s;
+	unsigned int i;
+
+	assert(size > 0);
+
+	for (i = 0; i < STREAM_POOL_CLASSES; i++)
+		if (size <= stream_pool_size[i])
+			break;
+	if (i == STREAM_POOL_CLASSES)
+		return stream_new(size);
+
+	pool = stream_pool_get();
+	if (pool && !pool->free[i] && stream_depot.count[i]) {
+		frr_with_mutex (&stream_depot_mtx) {
+			stream_pool_move(pool, &stream_depot, i,
+					 stream_pool_keep(i) / 2);
+		}
+	}
+	if (pool && pool->free[i]) {
+		s = pool->free[i];
+		pool->free[i] = s->next;
+		pool->count[i]--;
+		atomic_fetch_add_explicit(&stream_pool_ctr[i].hits, 1,
+					  memory_order_relaxed);
+		atomic_fetch_sub_explicit(&stream_pool_ctr[i].cached, 1,
+					  memory_order_relaxed);
+	} else {
+		s = XMALLOC(MTYPE_STREAM,
+			    sizeof(struct stream) + stream_pool_size[i]);
+		atomic_fetch_add_explicit(&stream_pool_ctr[i].misses, 1,
+					  memory_order_relaxed);
+	}
+
+	s->getp = s->endp = 0;
+	s->next = NULL;
+	s->size = size;
+	s->pool = i + 1;
+
+	frrtrace(2, frr_libfrr, stream_new, s, size);
 	return s;
 }
 
+void stream_pool_stats(struct stream_pool_stats st[STREAM_POOL_CLASSES])
+{
+	unsigned int i;
+
+	for (i = 0; i < STREAM_POOL_CLASSES; i++) {
+		st[i].size = stream_pool_size[i];
+		st[i].hits = atomic_load_explicit(&stream_pool_ctr[i].hits,
+						  memory_order_relaxed);
+		st[i].misses = atomic_load_explicit(&stream_pool_ctr[i].misses,
+						    memory_order_relaxed);
+		st[i].cached = atomic_load_explicit(&stream_pool_ctr[i].cached,
+						    memory_order_relaxed);
+		st[i].dropped = atomic_load_explicit(
+			&stream_pool_ctr[i].dropped, memory_order_relaxed);
+	}
+}
+
 /* Free it now. */
 void stream_free(struct stream *s)
 {
+	struct stream_pool *pool;
+	unsigned int i;
+
 	if (!s)
 		return;
 
+	if (s->pool) {
+		i = s->pool - 1;
+		pool = stream_pool_get();
+		if (pool && pool->count[i] >= stream_pool_keep(i)) {
+			frr_with_mutex (&stream_depot_mtx) {
+				if (stream_depot.count[i]
+				    < STREAM_POOL_DEPOT * stream_pool_keep(i))
+					stream_pool_move(&stream_depot, pool, i,
+							 stream_pool_keep(i)
+								 / 2);
+			}
+		}
+		if (pool && pool->count[i] < stream_pool_keep(i)) {
+			s->next = pool->free[i];
+			pool->free[i] = s;
+			pool->count[i]++;
+			atomic_fetch_add_explicit(&stream_pool_ctr[i].cached, 1,
+						  memory_order_relaxed);
+			return;
+		}
+		atomic_fetch_add_explicit(&stream_pool_ctr[i].dropped, 1,
+					  memory_order_relaxed);
+	}
+
 	XFREE(MTYPE_STREAM, s);
 }
 
@@ -177,7 +371,9 @@ size_t stream_resize_inplace(struct stream **sptr, size_t newsize)
 
 	orig = XREALLOC(MTYPE_STREAM, orig, sizeof(struct stream) + newsize);
 
+	/* no longer the size of its class, if it had one */
 	orig->size = newsize;
+	orig->pool = 0;
 
 	if (orig->endp > orig->size)
 		orig->endp = orig->size;
@@ -1319,6 +1515,44 @@ struct stream *stream_fifo_pop_safe(struct stream_fifo *fifo)
 	return ret;
 }
 
+void stream_fifo_splice(struct stream_fifo *fifo, struct stream *after,
+			struct stream_fifo *from)
+{
+	size_t n;
+#if defined DEV_BUILD
+	size_t max, curmax;
+#endif
+
+	if (!from->head)
+		return;
+
+	if (after) {
+		from->tail->next = after->next;
+		after->next = from->head;
+		if (fifo->tail == after)
+			fifo->tail = from->tail;
+	} else {
+		from->tail->next = fifo->head;
+		fifo->head = from->head;
+		if (!fifo->tail)
+			fifo->tail = from->tail;
+	}
+
+	n = atomic_load_explicit(&from->count, memory_order_relaxed);
+	from->head = from->tail = NULL;
+	atomic_store_explicit(&from->count, 0, memory_order_release);
+#if !defined DEV_BUILD
+	atomic_fetch_add_explicit(&fifo->count, n, memory_order_release);
+#else
+	max = atomic_fetch_add_explicit(&fifo->count, n, memory_order_release)
+	      + n;
+	curmax = atomic_load_explicit(&fifo->max_count, memory_order_relaxed);
+	if (max > curmax)
+		atomic_store_explicit(&fifo->max_count, max,
+				      memory_order_relaxed);
+#endif
+}
+
 struct stream *stream_fifo_head(struct stream_fifo *fifo)
 {
 	return fifo->head;
@@ -1387,3 +1621,277 @@ void stream_pulldown(struct stream *s)
 	s->getp = 0;
 	s->endp = rlen;
 }
+
+/* Stream chains */
+
+/* iovecs per writev() in stream_chain_flush() */
+#define STREAM_CHAIN_IOV 16
+
+void stream_chain_init(struct stream_chain *c, size_t seg_size)
+{
+	memset(c, 0, sizeof(*c));
+	c->seg_size = seg_size;
+}
+
+void stream_chain_reset(struct stream_chain *c)
+{
+	struct stream *s;
+
+	while ((s = c->head)) {
+		c->head = s->next;
+		stream_free(s);
+	}
+	c->tail = NULL;
+	c->len = 0;
+}
+
+void stream_chain_append(struct stream_chain *c, struct stream *s)
+{
+	STREAM_VERIFY_SANE(s);
+
+	s->next = NULL;
+	if (c->tail)
+		c->tail->next = s;
+	else
+		c->head = s;
+	c->tail = s;
+	c->len += STREAM_READABLE(s);
+}
+
+void stream_chain_prepend(struct stream_chain *c, struct stream *s)
+{
+	STREAM_VERIFY_SANE(s);
+
+	s->next = c->head;
+	c->head = s;
+	if (!c->tail)
+		c->tail = s;
+	c->len += STREAM_READABLE(s);
+}
+
+void stream_chain_put(struct stream_chain *c, const void *src, size_t size)
+{
+	const uint8_t *pnt = src;
+	struct stream *s;
+	size_t n;
+
+	while (size) {
+		s = c->tail;
+		if (!s || !STREAM_WRITEABLE(s)) {
+			s = stream_new_pooled(MAX(c->seg_size, size));
+			stream_chain_append(c, s);
+		}
+
+		n = MIN(size, STREAM_WRITEABLE(s));
+		memcpy(s->data + s->endp, pnt, n);
+		s->endp += n;
+		c->len += n;
+		pnt += n;
+		size -= n;
+	}
+}
+
+void stream_chain_putc(struct stream_chain *c, uint8_t val)
+{
+	stream_chain_put(c, &val, sizeof(val));
+}
+
+void stream_chain_putw(struct stream_chain *c, uint16_t val)
+{
+	val = htons(val);
+	stream_chain_put(c, &val, sizeof(val));
+}
+
+void stream_chain_putl(struct stream_chain *c, uint32_t val)
+{
+	val = htonl(val);
+	stream_chain_put(c, &val, sizeof(val));
+}
+
+void stream_chain_putq(struct stream_chain *c, uint64_t val)
+{
+	stream_chain_putl(c, (uint32_t)(val >> 32));
+	stream_chain_putl(c, (uint32_t)val);
+}
+
+bool stream_chain_put_at(struct stream_chain *c, size_t pos, const void *src,
+			 size_t size)
+{
+	const uint8_t *pnt = src;
+	struct stream *s;
+	size_t n;
+
+	if (pos + size > c->len)
+		return false;
+
+	for (s = c->head; size; s = s->next) {
+		n = STREAM_READABLE(s);
+		if (pos >= n) {
+			pos -= n;
+			continue;
+		}
+		n = MIN(n - pos, size);
+		memcpy(s->data + s->getp + pos, pnt, n);
+		pnt += n;
+		size -= n;
+		pos = 0;
+	}
+	return true;
+}
+
+bool stream_chain_putw_at(struct stream_chain *c, size_t pos, uint16_t val)
+{
+	val = htons(val);
+	return stream_chain_put_at(c, pos, &val, sizeof(val));
+}
+
+bool stream_chain_putl_at(struct stream_chain *c, size_t pos, uint32_t val)
+{
+	val = htonl(val);
+	return stream_chain_put_at(c, pos, &val, sizeof(val));
+}
+
+unsigned int stream_chain_iov(const struct stream_chain *c, size_t pos,
+			      struct iovec *iov, unsigned int max)
+{
+	const struct stream *s;
+	unsigned int n = 0;
+	size_t len;
+
+	for (s = c->head; s && n < max; s = s->next) {
+		len = STREAM_READABLE(s);
+		if (pos >= len) {
+			pos -= len;
+			continue;
+		}
+		iov[n].iov_base = (void *)(s->data + s->getp + pos);
+		iov[n].iov_len = len - pos;
+		pos = 0;
+		n++;
+	}
+	return n;
+}
+
+void stream_chain_consume(struct stream_chain *c, size_t size)
+{
+	struct stream *s;
+	size_t n;
+
+	assert(size <= c->len);
+	c->len -= size;
+
+	while (size) {
+		s = c->head;
+		n = STREAM_READABLE(s);
+		if (size < n) {
+			s->getp += size;
+			break;
+		}
+		size -= n;
+		c->head = s->next;
+		if (!c->head)
+			c->tail = NULL;
+		stream_free(s);
+	}
+
+	/* empty segments at the front are of no use either */
+	while ((s = c->head) && !STREAM_READABLE(s) && s != c->tail) {
+		c->head = s->next;
+		stream_free(s);
+	}
+}
+
+ssize_t stream_chain_flush(struct stream_chain *c, int fd)
+{
+	struct iovec iov[STREAM_CHAIN_IOV];
+	unsigned int n;
+	ssize_t nwr;
+
+	n = stream_chain_iov(c, 0, iov, array_size(iov));
+	if (!n)
+		return 0;
+
+	nwr = writev(fd, iov, n);
+	if (nwr > 0)
+		stream_chain_consume(c, nwr);
+	return nwr;
+}
+
+struct stream *stream_chain_flatten(const struct stream_chain *c)
+{
+	const struct stream *seg;
+	struct stream *s;
+
+	s = stream_new(MAX(c->len, 1U));
+	for (seg = c->head; seg; seg = seg->next)
+		stream_put(s, seg->data + seg->getp, STREAM_READABLE(seg));
+	return s;
+}
+
+void stream_chain_cursor_init(struct stream_chain_cursor *cur,
+			      const struct stream_chain *c)
+{
+	cur->s = c->head;
+	cur->pos = c->head ? c->head->getp : 0;
+}
+
+bool stream_chain_get(struct stream_chain_cursor *cur, void *dst, size_t size)
+{
+	struct stream_chain_cursor tmp = *cur;
+	uint8_t *pnt = dst;
+	size_t n;
+
+	while (size) {
+		if (!tmp.s)
+			return false;
+
+		n = tmp.s->endp - tmp.pos;
+		if (!n) {
+			tmp.s = tmp.s->next;
+			tmp.pos = tmp.s ? tmp.s->getp : 0;
+			continue;
+		}
+		n = MIN(n, size);
+		memcpy(pnt, tmp.s->data + tmp.pos, n);
+		tmp.pos += n;
+		pnt += n;
+		size -= n;
+	}
+
+	*cur = tmp;
+	return true;
+}
+
+bool stream_chain_getc(struct stream_chain_cursor *cur, uint8_t *val)
+{
+	return stream_chain_get(cur, val, sizeof(*val));
+}
+
+bool stream_chain_getw(struct stream_chain_cursor *cur, uint16_t *val)
+{
+	if (!stream_chain_get(cur, val, sizeof(*val)))
+		return false;
+	*val = ntohs(*val);
+	return true;
+}
+
+bool stream_chain_getl(struct stream_chain_cursor *cur, uint32_t *val)
+{
+	if (!stream_chain_get(cur, val, sizeof(*val)))
+		return false;
+	*val = ntohl(*val);
+	return true;
+}
+
+bool stream_chain_getq(struct stream_chain_cursor *cur, uint64_t *val)
+{
+	uint8_t buf[8];
+	unsigned int i;
+
+	if (!stream_chain_get(cur, buf, sizeof(buf)))
+		return false;
+	*val = 0;
+	for (i = 0; i < sizeof(buf); i++)
+		*val = (*val << 8) | buf[i];
+	return true;
+}
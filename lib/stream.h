@@ -110,6 +110,7 @@ struct stream {
 	size_t getp;	       /* next get position */
 	size_t endp;	       /* last valid data position */
 	size_t size;	       /* size of data segment */
+	uint8_t pool;	       /* pool size class + 1, 0 if not pooled */
 	unsigned char data[];  /* data pointer */
 };
 
@@ -150,6 +151,28 @@ struct stream_fifo {
  */
 extern struct stream *stream_new(size_t);
 extern void stream_free(struct stream *);
+
+/*
+ * Like stream_new(), but the buffer comes from a per-pthread cache of
+ * recently freed streams of the same size class, and goes back there on
+ * stream_free().  For streams created and freed per packet or message.
+ * Sizes above the largest class fall back to stream_new().
+ */
+extern struct stream *stream_new_pooled(size_t size);
+
+#define STREAM_POOL_CLASSES 4
+
+struct stream_pool_stats {
+	size_t size;
+	/* allocations served from a cache / from malloc */
+	size_t hits, misses;
+	/* streams sitting in caches now */
+	size_t cached;
+	/* frees that went to malloc because the cache was full */
+	size_t dropped;
+};
+
+extern void stream_pool_stats(struct stream_pool_stats st[STREAM_POOL_CLASSES]);
 /* Copy 'src' into 'dest', returns 'dest' */
 extern struct stream *stream_copy(struct stream *dest,
 				  const struct stream *src);
@@ -334,6 +357,21 @@ extern void stream_fifo_push_safe(struct stream_fifo *fifo, struct stream *s);
 extern struct stream *stream_fifo_pop(struct stream_fifo *fifo);
 extern struct stream *stream_fifo_pop_safe(struct stream_fifo *fifo);
 
+/*
+ * Move all streams of one stream_fifo into another, keeping their order.
+ *
+ * fifo
+ *    the stream_fifo to insert into
+ *
+ * after
+ *    the stream on fifo to insert behind, or NULL to insert at the head
+ *
+ * from
+ *    the stream_fifo to take the streams from, empty afterwards
+ */
+extern void stream_fifo_splice(struct stream_fifo *fifo, struct stream *after,
+			       struct stream_fifo *from);
+
 /*
  * Retrieve the next stream from a stream_fifo without popping it.
  *
@@ -376,6 +414,85 @@ extern size_t stream_fifo_count_safe(struct stream_fifo *fifo);
  */
 extern void stream_fifo_free(struct stream_fifo *fifo);
 
+/*
+ * Stream chains: a message held as a list of streams (segments) instead of
+ * one buffer, so it can grow without being copied, have a header put in
+ * front once its length is known, and be written out with writev().
+ *
+ * Each segment's data is its getp..endp range.  Puts fill the last segment
+ * and add pooled segments of seg_size as needed; whole streams can be added
+ * at either end without copying.  The chain owns its segments (they are
+ * linked through their next pointers and can't be on a fifo.)
+ */
+struct stream_chain {
+	struct stream *head, *tail;
+	size_t seg_size;
+	size_t len;
+};
+
+extern void stream_chain_init(struct stream_chain *c, size_t seg_size);
+/* frees all segments, the chain can be used again */
+extern void stream_chain_reset(struct stream_chain *c);
+
+static inline size_t stream_chain_len(const struct stream_chain *c)
+{
+	return c->len;
+}
+
+/* take ownership of s; its readable data becomes the end / start of c */
+extern void stream_chain_append(struct stream_chain *c, struct stream *s);
+extern void stream_chain_prepend(struct stream_chain *c, struct stream *s);
+
+extern void stream_chain_put(struct stream_chain *c, const void *src,
+			     size_t size);
+extern void stream_chain_putc(struct stream_chain *c, uint8_t val);
+extern void stream_chain_putw(struct stream_chain *c, uint16_t val);
+extern void stream_chain_putl(struct stream_chain *c, uint32_t val);
+extern void stream_chain_putq(struct stream_chain *c, uint64_t val);
+
+/* overwrite already put data at offset pos, e.g. a length field.  Returns
+ * false if that's past the end.
+ */
+extern bool stream_chain_put_at(struct stream_chain *c, size_t pos,
+				const void *src, size_t size);
+extern bool stream_chain_putw_at(struct stream_chain *c, size_t pos,
+				 uint16_t val);
+extern bool stream_chain_putl_at(struct stream_chain *c, size_t pos,
+				 uint32_t val);
+
+/* fill up to max iovecs with the data from offset pos on; returns the
+ * number used.  Stops short if max isn't enough.
+ */
+extern unsigned int stream_chain_iov(const struct stream_chain *c, size_t pos,
+				     struct iovec *iov, unsigned int max);
+
+/* drop size bytes from the front, freeing segments as they empty */
+extern void stream_chain_consume(struct stream_chain *c, size_t size);
+
+/* writev() as much as possible to fd and consume what was written.
+ * Returns writev()'s result.
+ */
+extern ssize_t stream_chain_flush(struct stream_chain *c, int fd);
+
+/* a copy of the whole chain in one new stream, for contiguous-only users */
+extern struct stream *stream_chain_flatten(const struct stream_chain *c);
+
+/* reading a chain, across segments */
+struct stream_chain_cursor {
+	const struct stream *s;
+	size_t pos;
+};
+
+extern void stream_chain_cursor_init(struct stream_chain_cursor *cur,
+				     const struct stream_chain *c);
+/* all return false (and leave the cursor alone) if not enough data left */
+extern bool stream_chain_get(struct stream_chain_cursor *cur, void *dst,
+			     size_t size);
+extern bool stream_chain_getc(struct stream_chain_cursor *cur, uint8_t *val);
+extern bool stream_chain_getw(struct stream_chain_cursor *cur, uint16_t *val);
+extern bool stream_chain_getl(struct stream_chain_cursor *cur, uint32_t *val);
+extern bool stream_chain_getq(struct stream_chain_cursor *cur, uint64_t *val);
+
 /* This is here because "<< 24" is particularly problematic in C.
  * This is because the left operand of << is integer-promoted, which means
  * an uint8_t gets converted into a *signed* int.  Shifting into the sign
@@ -31,6 +31,7 @@
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE, "Route table");
 DEFINE_MTYPE(LIB, ROUTE_NODE, "Route node");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE_INDEX, "Route table index");
 
 static void route_table_free(struct route_table *);
 
@@ -137,6 +138,7 @@ static void route_table_free(struct route_table *rt)
 
 	assert(rt->count == 0);
 
+	XFREE(MTYPE_ROUTE_TABLE_INDEX, rt->index);
 	rn_hash_node_fini(&rt->hash);
 	XFREE(MTYPE_ROUTE_TABLE, rt);
 	return;
@@ -192,6 +194,90 @@ static void set_link(struct route_node *node, struct route_node *new)
 	new->parent = node;
 }
 
+/*
+ * First-level index.  Nodes with prefixlen <= stride covering a given
+ * index slot are all on one path through the tree, so the slot only needs
+ * to remember the deepest of them; everything a walk would have visited
+ * above it are its parents.
+ */
+static inline uint32_t route_index_slot(const struct route_table *table,
+					const struct prefix *p)
+{
+	const uint8_t *pnt = &p->u.prefix;
+
+	return ((pnt[0] << 8) | pnt[1]) >> (16 - table->delegate->stride);
+}
+
+static inline struct route_node *route_index_start(struct route_table *table,
+						   const struct prefix *p)
+{
+	if (!table->index || p->prefixlen < table->delegate->stride)
+		return NULL;
+
+	return table->index[route_index_slot(table, p)];
+}
+
+static void route_index_add(struct route_table *table, struct route_node *node)
+{
+	uint8_t stride = table->delegate->stride;
+	uint32_t slot, n;
+
+	if (!table->index || node->p.prefixlen > stride)
+		return;
+
+	n = 1U << (stride - node->p.prefixlen);
+	slot = route_index_slot(table, &node->p) & ~(n - 1);
+
+	for (; n; n--, slot++)
+		if (!table->index[slot]
+		    || table->index[slot]->p.prefixlen < node->p.prefixlen)
+			table->index[slot] = node;
+}
+
+static void route_index_del(struct route_table *table, struct route_node *node)
+{
+	uint8_t stride = table->delegate->stride;
+	uint32_t slot, n;
+
+	if (!table->index || node->p.prefixlen > stride)
+		return;
+
+	n = 1U << (stride - node->p.prefixlen);
+	slot = route_index_slot(table, &node->p) & ~(n - 1);
+
+	for (; n; n--, slot++)
+		if (table->index[slot] == node)
+			table->index[slot] = node->parent;
+}
+
+static void route_index_fill(struct route_table *table, struct route_node *node)
+{
+	if (!node || node->p.prefixlen > table->delegate->stride)
+		return;
+
+	route_index_add(table, node);
+	route_index_fill(table, node->l_left);
+	route_index_fill(table, node->l_right);
+}
+
+/* Build the index once the table is large enough for it to pay off.  It is
+ * kept until the table is freed, large tables tend to stay large.
+ */
+static void route_index_check(struct route_table *table)
+{
+	uint8_t stride = table->delegate->stride;
+
+	if (!stride || table->index || table->count < (1UL << stride)
+	    || table->top->p.family == AF_FLOWSPEC)
+		return;
+
+	assert(stride <= ROUTE_TABLE_STRIDE_MAX);
+
+	table->index = XCALLOC(MTYPE_ROUTE_TABLE_INDEX,
+			       sizeof(*table->index) << stride);
+	route_index_fill(table, table->top);
+}
+
 /* Find matched prefix. */
 struct route_node *route_node_match(struct route_table *table,
 				    union prefixconstptr pu)
@@ -199,9 +285,11 @@ struct route_node *route_node_match(struct route_table *table,
 	const struct prefix *p = pu.p;
 	struct route_node *node;
 	struct route_node *matched;
+	struct route_node *start;
 
 	matched = NULL;
-	node = table->top;
+	start = route_index_start(table, p);
+	node = start ? start : table->top;
 
 	/* Walk down tree.  If there is matched route then store it to
 	   matched. */
@@ -216,6 +304,15 @@ struct route_node *route_node_match(struct route_table *table,
 		node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
 	}
 
+	/* Nodes skipped over by the index are the parents of start. */
+	if (!matched && start) {
+		for (node = start->parent; node; node = node->parent)
+			if (node->info) {
+				matched = node;
+				break;
+			}
+	}
+
 	/* If matched route found, return it. */
 	if (matched)
 		return route_lock_node(matched);
@@ -299,8 +396,13 @@ struct route_node *route_node_get(struct route_table *table,
 	if (node && node->info)
 		return route_lock_node(node);
 
-	match = NULL;
-	node = table->top;
+	node = route_index_start(table, p);
+	if (node)
+		match = node->parent;
+	else {
+		match = NULL;
+		node = table->top;
+	}
 	while (node && node->p.prefixlen <= prefixlen
 	       && prefix_match(&node->p, p)) {
 		if (node->p.prefixlen == prefixlen)
@@ -312,6 +414,7 @@ struct route_node *route_node_get(struct route_table *table,
 
 	if (node == NULL) {
 		new = route_node_set(table, p);
+		route_index_add(table, new);
 		if (match)
 			set_link(match, new);
 		else
@@ -323,6 +426,7 @@ struct route_node *route_node_get(struct route_table *table,
 		new->table = table;
 		set_link(new, node);
 		rn_hash_node_add(&table->hash, new);
+		route_index_add(table, new);
 
 		if (match)
 			set_link(match, new);
@@ -332,11 +436,13 @@ struct route_node *route_node_get(struct route_table *table,
 		if (new->p.prefixlen != p->prefixlen) {
 			match = new;
 			new = route_node_set(table, p);
+			route_index_add(table, new);
 			set_link(match, new);
 			table->count++;
 		}
 	}
 	table->count++;
+	route_index_check(table);
 	route_lock_node(new);
 
 	return new;
@@ -374,6 +480,7 @@ void route_node_delete(struct route_node *node)
 
 	node->table->count--;
 
+	route_index_del(node->table, node);
 	rn_hash_node_del(&node->table->hash, node);
 
 	/* WARNING: FRAGILE CODE!
@@ -406,6 +513,17 @@ struct route_node *route_top(struct route_table *table)
 	return table->top;
 }
 
+/* Full table walks spend most of their time waiting for nodes to be loaded;
+ * start loading the ones the next step is going to look at, along with the
+ * info the caller is about to use.
+ */
+static inline void route_next_prefetch(const struct route_node *node)
+{
+	__builtin_prefetch(node->l_left);
+	__builtin_prefetch(node->l_right);
+	__builtin_prefetch(node->info);
+}
+
 /* Unlock current node and lock next node then return it. */
 struct route_node *route_next(struct route_node *node)
 {
@@ -418,12 +536,14 @@ struct route_node *route_next(struct route_node *node)
 	if (node->l_left) {
 		next = node->l_left;
 		route_lock_node(next);
+		route_next_prefetch(next);
 		route_unlock_node(node);
 		return next;
 	}
 	if (node->l_right) {
 		next = node->l_right;
 		route_lock_node(next);
+		route_next_prefetch(next);
 		route_unlock_node(node);
 		return next;
 	}
@@ -433,6 +553,7 @@ struct route_node *route_next(struct route_node *node)
 		if (node->parent->l_left == node && node->parent->l_right) {
 			next = node->parent->l_right;
 			route_lock_node(next);
+			route_next_prefetch(next);
 			route_unlock_node(start);
 			return next;
 		}
@@ -455,12 +576,14 @@ struct route_node *route_next_until(struct route_node *node,
 	if (node->l_left) {
 		next = node->l_left;
 		route_lock_node(next);
+		route_next_prefetch(next);
 		route_unlock_node(node);
 		return next;
 	}
 	if (node->l_right) {
 		next = node->l_right;
 		route_lock_node(next);
+		route_next_prefetch(next);
 		route_unlock_node(node);
 		return next;
 	}
@@ -470,6 +593,7 @@ struct route_node *route_next_until(struct route_node *node,
 		if (node->parent->l_left == node && node->parent->l_right) {
 			next = node->parent->l_right;
 			route_lock_node(next);
+			route_next_prefetch(next);
 			route_unlock_node(start);
 			return next;
 		}
@@ -513,7 +637,8 @@ void route_node_destroy(route_table_delegate_t *delegate,
  */
 static route_table_delegate_t default_delegate = {
 	.create_node = route_node_create,
-	.destroy_node = route_node_destroy};
+	.destroy_node = route_node_destroy,
+	.stride = ROUTE_TABLE_STRIDE_MAX};
 
 route_table_delegate_t *route_table_get_default_delegate(void)
 {
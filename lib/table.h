@@ -57,8 +57,21 @@ typedef void (*route_table_destroy_node_func_t)(route_table_delegate_t *,
 struct route_table_delegate_t_ {
 	route_table_create_node_func_t create_node;
 	route_table_destroy_node_func_t destroy_node;
+
+	/*
+	 * If non-zero, tables using this delegate build an array of
+	 * 2^stride node pointers, indexed by the first 'stride' bits of the
+	 * prefix, once they hold that many nodes.  route_node_match() and
+	 * route_node_get() then start walking at the deepest node covering
+	 * those bits rather than at the top of the tree.
+	 *
+	 * At most ROUTE_TABLE_STRIDE_MAX.  Not usable for AF_FLOWSPEC.
+	 */
+	uint8_t stride;
 };
 
+#define ROUTE_TABLE_STRIDE_MAX 16
+
 PREDECL_HASH(rn_hash_node);
 
 /* Routing table top structure. */
@@ -74,6 +87,13 @@ struct route_table {
 
 	unsigned long count;
 
+	/*
+	 * First-level index, see route_table_delegate_t->stride.  Entry i
+	 * is the deepest node with prefixlen <= stride covering the prefix
+	 * whose top bits are i, or NULL.
+	 */
+	struct route_node **index;
+
 	/*
 	 * User data.
 	 */
@@ -0,0 +1,377 @@
+/*
+ * Work-stealing task pool.
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "frratomic.h"
+#include "frr_pthread.h"
+#include "log.h"
+#include "memory.h"
+#include "typesafe.h"
+#include "taskpool.h"
+
+DEFINE_MTYPE_STATIC(LIB, TASKPOOL, "Task pool");
+DEFINE_MTYPE_STATIC(LIB, TASKPOOL_TASK, "Task pool task");
+
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+PREDECL_DLIST(taskpool_tasks);
+
+struct taskpool_task {
+	struct taskpool_tasks_item item;
+
+	void (*fn)(void *arg);
+	void *arg;
+	struct taskpool_group *grp;
+};
+
+DECLARE_DLIST(taskpool_tasks, struct taskpool_task, item);
+
+struct taskpool_worker {
+	struct taskpool *pool;
+	struct frr_pthread *fpt;
+
+	pthread_mutex_t mtx;
+	/* Requires: mtx */
+	struct taskpool_tasks_head deque;
+};
+
+struct taskpool {
+	char *name;
+
+	struct taskpool_worker *workers;
+	unsigned int nworkers;
+
+	/* number of tasks on all deques together. Idle workers sleep on
+	 * cond until this is nonzero; updates to it are followed by taking
+	 * mtx before signalling to avoid lost wakeups.
+	 */
+	atomic_uint queued;
+	atomic_uint next;
+	atomic_bool stopping;
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+};
+
+/* worker the current pthread is, if any */
+static thread_local struct taskpool_worker *tp_self;
+
+static void taskpool_group_done(struct taskpool_group *grp)
+{
+	struct thread_master *master = NULL;
+	void (*done)(struct thread *) = NULL;
+	void *arg = NULL;
+
+	frr_with_mutex (&grp->mtx) {
+		assert(grp->pending);
+		if (--grp->pending == 0) {
+			master = grp->master;
+			done = grp->done;
+			arg = grp->arg;
+			pthread_cond_broadcast(&grp->cond);
+		}
+	}
+
+	/* grp may be gone as soon as the mutex is released */
+	if (master)
+		thread_add_event(master, done, arg, 0, NULL);
+}
+
+static void taskpool_task_run(struct taskpool_task *task)
+{
+	struct taskpool_group *grp = task->grp;
+
+	task->fn(task->arg);
+	XFREE(MTYPE_TASKPOOL_TASK, task);
+
+	if (grp)
+		taskpool_group_done(grp);
+}
+
+/* own deque from the back, everyone else's from the front */
+static struct taskpool_task *taskpool_take(struct taskpool *pool)
+{
+	struct taskpool_worker *self = NULL;
+	struct taskpool_task *task = NULL;
+	unsigned int start = 0;
+
+	if (!atomic_load_explicit(&pool->queued, memory_order_acquire))
+		return NULL;
+
+	if (tp_self && tp_self->pool == pool) {
+		self = tp_self;
+		frr_with_mutex (&self->mtx) {
+			task = taskpool_tasks_last(&self->deque);
+			if (task)
+				taskpool_tasks_del(&self->deque, task);
+		}
+		start = self - pool->workers + 1;
+	}
+
+	for (unsigned int i = 0; !task && i < pool->nworkers; i++) {
+		struct taskpool_worker *w;
+
+		w = &pool->workers[(start + i) % pool->nworkers];
+		if (w == self)
+			continue;
+
+		frr_with_mutex (&w->mtx) {
+			task = taskpool_tasks_pop(&w->deque);
+		}
+	}
+
+	if (task)
+		atomic_fetch_sub_explicit(&pool->queued, 1,
+					  memory_order_relaxed);
+	return task;
+}
+
+static void *taskpool_worker_start(void *arg)
+{
+	struct frr_pthread *fpt = arg;
+	struct taskpool_worker *w = fpt->data;
+	struct taskpool *pool = w->pool;
+	struct taskpool_task *task;
+
+	frr_pthread_set_name(fpt);
+	tp_self = w;
+	frr_pthread_notify_running(fpt);
+
+	while (true) {
+		task = taskpool_take(pool);
+		if (task) {
+			taskpool_task_run(task);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->mtx);
+		while (!atomic_load_explicit(&pool->queued,
+					     memory_order_acquire)
+		       && !atomic_load_explicit(&pool->stopping,
+						memory_order_relaxed))
+			pthread_cond_wait(&pool->cond, &pool->mtx);
+		pthread_mutex_unlock(&pool->mtx);
+
+		/* queued tasks are still run when stopping */
+		if (atomic_load_explicit(&pool->stopping, memory_order_relaxed)
+		    && !atomic_load_explicit(&pool->queued,
+					     memory_order_acquire))
+			break;
+	}
+
+	tp_self = NULL;
+	return NULL;
+}
+
+static int taskpool_worker_stop(struct frr_pthread *fpt, void **result)
+{
+	struct taskpool_worker *w = fpt->data;
+
+	atomic_store_explicit(&fpt->running, false, memory_order_relaxed);
+
+	frr_with_mutex (&w->pool->mtx) {
+		atomic_store_explicit(&w->pool->stopping, true,
+				      memory_order_relaxed);
+		pthread_cond_broadcast(&w->pool->cond);
+	}
+
+	pthread_join(fpt->thread, result);
+	return 0;
+}
+
+struct taskpool *taskpool_new(const char *name, unsigned int nworkers)
+{
+	struct frr_pthread_attr attr = {
+		.start = taskpool_worker_start,
+		.stop = taskpool_worker_stop,
+	};
+	struct taskpool *pool;
+	unsigned int i;
+
+	pool = XCALLOC(MTYPE_TASKPOOL, sizeof(*pool));
+	pool->name = XSTRDUP(MTYPE_TASKPOOL, name);
+	pthread_mutex_init(&pool->mtx, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+
+	if (nworkers)
+		pool->workers = XCALLOC(MTYPE_TASKPOOL,
+					nworkers * sizeof(*pool->workers));
+
+	for (i = 0; i < nworkers; i++) {
+		struct taskpool_worker *w = &pool->workers[i];
+		char tname[64];
+		/* 10 chars of name and the number, frr_pthread_new() cuts
+		 * that down to what the OS takes
+		 */
+		char os_name[10 + sizeof("4294967295")];
+
+		w->pool = pool;
+		pthread_mutex_init(&w->mtx, NULL);
+		taskpool_tasks_init(&w->deque);
+
+		snprintf(tname, sizeof(tname), "%s worker %u", name, i + 1);
+		snprintf(os_name, sizeof(os_name), "%.10s%u", name, i + 1);
+
+		w->fpt = frr_pthread_new(&attr, tname, os_name);
+		w->fpt->data = w;
+		if (frr_pthread_run(w->fpt, NULL) < 0) {
+			zlog_warn("%s: failed to start %s, using %u workers",
+				  __func__, tname, i);
+			frr_pthread_destroy(w->fpt);
+			pthread_mutex_destroy(&w->mtx);
+			taskpool_tasks_fini(&w->deque);
+			break;
+		}
+		frr_pthread_wait_running(w->fpt);
+		pool->nworkers++;
+	}
+
+	return pool;
+}
+
+void taskpool_free(struct taskpool **poolp)
+{
+	struct taskpool *pool = *poolp;
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	for (i = 0; i < pool->nworkers; i++)
+		frr_pthread_stop(pool->workers[i].fpt, NULL);
+
+	for (i = 0; i < pool->nworkers; i++) {
+		struct taskpool_worker *w = &pool->workers[i];
+
+		assert(!taskpool_tasks_count(&w->deque));
+		frr_pthread_destroy(w->fpt);
+		pthread_mutex_destroy(&w->mtx);
+		taskpool_tasks_fini(&w->deque);
+	}
+
+	pthread_mutex_destroy(&pool->mtx);
+	pthread_cond_destroy(&pool->cond);
+	XFREE(MTYPE_TASKPOOL, pool->workers);
+	XFREE(MTYPE_TASKPOOL, pool->name);
+	XFREE(MTYPE_TASKPOOL, *poolp);
+}
+
+unsigned int taskpool_nworkers(const struct taskpool *pool)
+{
+	return pool->nworkers;
+}
+
+void taskpool_group_init(struct taskpool_group *grp)
+{
+	memset(grp, 0, sizeof(*grp));
+	pthread_mutex_init(&grp->mtx, NULL);
+	pthread_cond_init(&grp->cond, NULL);
+}
+
+void taskpool_group_fini(struct taskpool_group *grp)
+{
+	assert(!grp->pending);
+	pthread_mutex_destroy(&grp->mtx);
+	pthread_cond_destroy(&grp->cond);
+}
+
+void taskpool_submit(struct taskpool *pool, struct taskpool_group *grp,
+		     void (*fn)(void *arg), void *arg)
+{
+	struct taskpool_task *task;
+	struct taskpool_worker *w;
+
+	if (grp) {
+		frr_with_mutex (&grp->mtx) {
+			grp->pending++;
+		}
+	}
+
+	task = XCALLOC(MTYPE_TASKPOOL_TASK, sizeof(*task));
+	task->fn = fn;
+	task->arg = arg;
+	task->grp = grp;
+
+	if (!pool->nworkers) {
+		taskpool_task_run(task);
+		return;
+	}
+
+	if (tp_self && tp_self->pool == pool)
+		w = tp_self;
+	else
+		w = &pool->workers[atomic_fetch_add_explicit(
+					   &pool->next, 1, memory_order_relaxed)
+				   % pool->nworkers];
+
+	frr_with_mutex (&w->mtx) {
+		taskpool_tasks_add_tail(&w->deque, task);
+	}
+	atomic_fetch_add_explicit(&pool->queued, 1, memory_order_release);
+
+	frr_with_mutex (&pool->mtx) {
+		pthread_cond_signal(&pool->cond);
+	}
+}
+
+void taskpool_group_wait(struct taskpool *pool, struct taskpool_group *grp)
+{
+	struct taskpool_task *task;
+	unsigned int pending;
+
+	while (true) {
+		frr_with_mutex (&grp->mtx) {
+			if (grp->pending
+			    && !atomic_load_explicit(&pool->queued,
+						     memory_order_acquire))
+				pthread_cond_wait(&grp->cond, &grp->mtx);
+			pending = grp->pending;
+		}
+
+		if (!pending)
+			break;
+
+		task = taskpool_take(pool);
+		if (task)
+			taskpool_task_run(task);
+	}
+}
+
+void taskpool_group_notify(struct taskpool_group *grp,
+			   struct thread_master *master,
+			   void (*done)(struct thread *), void *arg)
+{
+	bool now = false;
+
+	frr_with_mutex (&grp->mtx) {
+		if (grp->pending) {
+			grp->master = master;
+			grp->done = done;
+			grp->arg = arg;
+		} else
+			now = true;
+	}
+
+	if (now)
+		thread_add_event(master, done, arg, 0, NULL);
+}
@@ -0,0 +1,102 @@
+/*
+ * Work-stealing task pool.
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_TASKPOOL_H
+#define _FRR_TASKPOOL_H
+
+#include <pthread.h>
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A taskpool is a set of worker pthreads executing plain function calls
+ * ("tasks".)  Unlike frr_pthread, workers don't have an event loop, and
+ * unlike work_queue, tasks really run in parallel.
+ *
+ * Each worker has its own deque.  Tasks submitted from a worker go on its
+ * own deque and are run LIFO; idle workers steal from the other end of
+ * other workers' deques.  Tasks submitted from outside the pool are
+ * distributed round-robin.
+ *
+ * Tasks run without any locks held and must not touch thread_master
+ * state other than through the thread-safe thread_add_*() functions.
+ *
+ * Completion is tracked with a taskpool_group, which can either be waited
+ * for (fork/join), or deliver an event to a thread_master once all of its
+ * tasks are done.
+ */
+struct taskpool;
+
+struct taskpool_group {
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+
+	/* Requires: mtx */
+	unsigned int pending;
+	struct thread_master *master;
+	void (*done)(struct thread *);
+	void *arg;
+};
+
+/*
+ * Starts a new pool with 'nworkers' pthreads.  With 0 workers, tasks are
+ * run synchronously from taskpool_submit().
+ */
+extern struct taskpool *taskpool_new(const char *name, unsigned int nworkers);
+
+/* Runs all queued tasks, then stops the workers and frees the pool. */
+extern void taskpool_free(struct taskpool **poolp);
+
+extern unsigned int taskpool_nworkers(const struct taskpool *pool);
+
+extern void taskpool_group_init(struct taskpool_group *grp);
+/* group must not have any pending tasks */
+extern void taskpool_group_fini(struct taskpool_group *grp);
+
+/* Queues fn(arg) on the pool, accounted to 'grp' (which may be NULL.) */
+extern void taskpool_submit(struct taskpool *pool, struct taskpool_group *grp,
+			    void (*fn)(void *arg), void *arg);
+
+/*
+ * Blocks until all tasks in 'grp' are done.  The calling pthread runs
+ * queued tasks (from any group) itself while waiting.
+ */
+extern void taskpool_group_wait(struct taskpool *pool,
+				struct taskpool_group *grp);
+
+/*
+ * Schedules done() as an event on 'master', with 'arg', once all tasks in
+ * 'grp' are done (immediately if there are none.)  The group is not
+ * touched anymore after that, so done() may free or reuse it.
+ *
+ * Once this is called, only tasks that are part of 'grp' themselves may
+ * add more tasks to it.
+ */
+extern void taskpool_group_notify(struct taskpool_group *grp,
+				  struct thread_master *master,
+				  void (*done)(struct thread *), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_TASKPOOL_H */
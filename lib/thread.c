@@ -22,6 +22,9 @@
 
 #include <zebra.h>
 #include <sys/resource.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include "thread.h"
 #include "memory.h"
@@ -37,6 +40,7 @@
 #include "lib_errors.h"
 #include "libfrr_trace.h"
 #include "libfrr.h"
+#include "json.h"
 
 DEFINE_MTYPE_STATIC(LIB, THREAD, "Thread");
 DEFINE_MTYPE_STATIC(LIB, THREAD_MASTER, "Thread master");
@@ -69,6 +73,41 @@ static int thread_timer_cmp(const struct thread *a, const struct thread *b)
 }
 
 DECLARE_HEAP(thread_timer_list, struct thread, timeritem, thread_timer_cmp);
+DECLARE_DLIST(thread_wheel_list, struct thread, wheelitem);
+
+/* timer wheel parameters, see "Timer backends" below */
+#define TIMER_WHEEL_BITS	6
+#define TIMER_WHEEL_SLOTS	(1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS	5
+/* slot index of the overflow list */
+#define TIMER_WHEEL_OVERFLOW	(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+/* timerpos when staged on m->timer instead */
+#define TIMER_WHEEL_HEAP	(TIMER_WHEEL_OVERFLOW + 1)
+
+struct thread_timer_wheel {
+	struct timeval base;
+	/* next tick that has not been processed yet */
+	uint64_t clk;
+	size_t count;
+
+	uint64_t occupied[TIMER_WHEEL_LEVELS];
+	struct thread_wheel_list_head slots[TIMER_WHEEL_OVERFLOW + 1];
+};
+
+/* Iterate over the timers on the wheel (if any) in no particular order;
+ * removing 'thread' from the wheel is safe.
+ */
+#define frr_each_wheel_safe(m, i, thread)                                      \
+	for (i = 0; i <= ((m)->wheel ? (int)TIMER_WHEEL_OVERFLOW : -1); i++)   \
+		frr_each_safe (thread_wheel_list, &(m)->wheel->slots[i],       \
+			       thread)
+
+static size_t thread_timer_count(struct thread_master *m)
+{
+	return thread_timer_list_count(&m->timer)
+	       + (m->wheel ? m->wheel->count : 0);
+}
 
 #if defined(__APPLE__)
 #include <mach/mach.h>
@@ -89,6 +128,9 @@ static pthread_mutex_t masters_mtx = PTHREAD_MUTEX_INITIALIZER;
 static struct list *masters;
 
 static void thread_free(struct thread_master *master, struct thread *thread);
+static int thread_process_io_helper(struct thread_master *m,
+				    struct thread *thread, short state,
+				    short actual_state, int pos);
 
 #ifndef EXCLUDE_CPU_TIME
 #define EXCLUDE_CPU_TIME 0
@@ -96,10 +138,13 @@ static void thread_free(struct thread_master *master, struct thread *thread);
 #ifndef CONSUMED_TIME_CHECK
 #define CONSUMED_TIME_CHECK 0
 #endif
+/* timers used to be flagged when popping more than 4s late */
+#define STARVED_TIME_CHECK 4000000
 
 bool cputime_enabled = !EXCLUDE_CPU_TIME;
 unsigned long cputime_threshold = CONSUMED_TIME_CHECK;
 unsigned long walltime_threshold = CONSUMED_TIME_CHECK;
+unsigned long lag_threshold = STARVED_TIME_CHECK;
 
 /* CLI start ---------------------------------------------------------------- */
 #ifndef VTYSH_EXTRACT_PL
@@ -160,25 +205,23 @@ static void cpu_record_hash_print(struct hash_bucket *bucket, void *args[])
 	uint8_t *filter = args[2];
 
 	struct cpu_thread_history *a = bucket->data;
+	uint32_t seq;
 
+	/* total_active is maintained outside of thread_call(), not in seq */
 	copy.total_active =
-		atomic_load_explicit(&a->total_active, memory_order_seq_cst);
-	copy.total_calls =
-		atomic_load_explicit(&a->total_calls, memory_order_seq_cst);
-	copy.total_cpu_warn =
-		atomic_load_explicit(&a->total_cpu_warn, memory_order_seq_cst);
-	copy.total_wall_warn =
-		atomic_load_explicit(&a->total_wall_warn, memory_order_seq_cst);
-	copy.total_starv_warn = atomic_load_explicit(&a->total_starv_warn,
-						     memory_order_seq_cst);
-	copy.cpu.total =
-		atomic_load_explicit(&a->cpu.total, memory_order_seq_cst);
-	copy.cpu.max = atomic_load_explicit(&a->cpu.max, memory_order_seq_cst);
-	copy.real.total =
-		atomic_load_explicit(&a->real.total, memory_order_seq_cst);
-	copy.real.max =
-		atomic_load_explicit(&a->real.max, memory_order_seq_cst);
-	copy.types = atomic_load_explicit(&a->types, memory_order_seq_cst);
+		atomic_load_explicit(&a->total_active, memory_order_relaxed);
+	do {
+		seq = counters_read_begin(&a->seq);
+		copy.total_calls = counter_get(a->total_calls);
+		copy.total_cpu_warn = counter_get(a->total_cpu_warn);
+		copy.total_wall_warn = counter_get(a->total_wall_warn);
+		copy.total_starv_warn = counter_get(a->total_starv_warn);
+		copy.cpu.total = counter_get(a->cpu.total);
+		copy.cpu.max = counter_get(a->cpu.max);
+		copy.real.total = counter_get(a->real.total);
+		copy.real.max = counter_get(a->real.max);
+		copy.types = counter_get(a->types);
+	} while (counters_read_retry(&a->seq, seq));
 	copy.funcname = a->funcname;
 
 	if (!(copy.types & *filter))
@@ -277,15 +320,279 @@ static void cpu_record_hash_clear(struct hash_bucket *bucket, void *args[])
 	hash_release(cpu_record, bucket->data);
 }
 
+/* histograms count from here, "clear thread cpu" starts a new window */
+static struct timeval thread_hist_since;
+
+static const char *const thread_hist_type_names[THREAD_HIST_TYPES] = {
+	[THREAD_READ] = "read",
+	[THREAD_WRITE] = "write",
+	[THREAD_TIMER] = "timer",
+	[THREAD_EVENT] = "event",
+	[THREAD_EXECUTE] = "execute",
+};
+
+/* largest time that goes in bucket i */
+static unsigned long thread_hist_bound(unsigned int i)
+{
+	return i ? (1UL << i) - 1 : 0;
+}
+
+static size_t thread_hist_load(const struct thread_hist *h,
+			       size_t bucket[THREAD_HIST_BUCKETS])
+{
+	size_t total = 0;
+	unsigned int i;
+
+	for (i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		bucket[i] = atomic_load_explicit(&h->bucket[i],
+						 memory_order_relaxed);
+		total += bucket[i];
+	}
+	return total;
+}
+
+/* upper bound of the bucket holding the given permille of samples */
+static unsigned long thread_hist_pct(const size_t bucket[THREAD_HIST_BUCKETS],
+				     size_t total, unsigned int permille)
+{
+	size_t want = (total * permille + 999) / 1000, sum = 0;
+	unsigned int i;
+
+	if (!total)
+		return 0;
+	for (i = 0; i < THREAD_HIST_BUCKETS - 1; i++) {
+		sum += bucket[i];
+		if (sum >= want)
+			break;
+	}
+	return thread_hist_bound(i);
+}
+
+static unsigned long thread_hist_top(const size_t bucket[THREAD_HIST_BUCKETS])
+{
+	unsigned int i;
+
+	for (i = THREAD_HIST_BUCKETS; i > 0; i--)
+		if (bucket[i - 1])
+			return thread_hist_bound(i - 1);
+	return 0;
+}
+
+static void vty_out_thread_hist(struct vty *vty, const struct thread_hist *h,
+				unsigned long max)
+{
+	size_t bucket[THREAD_HIST_BUCKETS], total;
+
+	total = thread_hist_load(h, bucket);
+	if (!max)
+		max = thread_hist_top(bucket);
+	vty_out(vty, " %7lu %7lu %7lu %8lu", thread_hist_pct(bucket, total, 500),
+		thread_hist_pct(bucket, total, 990),
+		thread_hist_pct(bucket, total, 999), max);
+}
+
+static struct json_object *json_thread_hist(const struct thread_hist *h,
+					    unsigned long max)
+{
+	size_t bucket[THREAD_HIST_BUCKETS], total;
+	struct json_object *json, *json_buckets, *json_bucket;
+	unsigned int i;
+
+	total = thread_hist_load(h, bucket);
+	if (!max)
+		max = thread_hist_top(bucket);
+
+	json = json_object_new_object();
+	json_object_int_add(json, "p50", thread_hist_pct(bucket, total, 500));
+	json_object_int_add(json, "p99", thread_hist_pct(bucket, total, 990));
+	json_object_int_add(json, "p999", thread_hist_pct(bucket, total, 999));
+	json_object_int_add(json, "max", max);
+
+	/* [upper bound in usec, count], empty buckets left out */
+	json_buckets = json_object_new_array();
+	for (i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		if (!bucket[i])
+			continue;
+		json_bucket = json_object_new_array();
+		json_object_array_add(json_bucket,
+				      json_object_new_int64(
+					      thread_hist_bound(i)));
+		json_object_array_add(json_bucket,
+				      json_object_new_int64(bucket[i]));
+		json_object_array_add(json_buckets, json_bucket);
+	}
+	json_object_object_add(json, "buckets", json_buckets);
+	return json;
+}
+
+static void cpu_record_hash_hist(struct hash_bucket *bucket, void *args[])
+{
+	struct vty *vty = args[0];
+	uint8_t *filter = args[1];
+	struct json_object *json = args[2];
+	struct cpu_thread_history *a = bucket->data;
+	struct json_object *json_cb;
+	unsigned long cpu_max;
+	uint32_t types;
+	size_t calls;
+
+	types = atomic_load_explicit(&a->types, memory_order_seq_cst);
+	if (!(types & *filter))
+		return;
+
+	calls = atomic_load_explicit(&a->total_calls, memory_order_seq_cst);
+	cpu_max = atomic_load_explicit(&a->cpu.max, memory_order_seq_cst);
+
+	if (json) {
+		json_cb = json_object_new_object();
+		json_object_string_add(json_cb, "function", a->funcname);
+		json_object_int_add(json_cb, "calls", calls);
+		json_object_object_add(
+			json_cb, "wall",
+			json_thread_hist(&a->real_hist,
+					 atomic_load_explicit(
+						 &a->real.max,
+						 memory_order_seq_cst)));
+		if (cpu_max)
+			json_object_object_add(
+				json_cb, "cpu",
+				json_thread_hist(&a->cpu_hist, cpu_max));
+		json_object_object_add(json_cb, "delay",
+				       json_thread_hist(&a->delay_hist, 0));
+		json_object_array_add(json, json_cb);
+		return;
+	}
+
+	vty_out(vty, "%9zu", calls);
+	vty_out_thread_hist(vty, &a->real_hist,
+			    atomic_load_explicit(&a->real.max,
+						 memory_order_seq_cst));
+	vty_out_thread_hist(vty, &a->cpu_hist, cpu_max);
+	vty_out_thread_hist(vty, &a->delay_hist, 0);
+	vty_out(vty, "  %s\n", a->funcname);
+}
+
+static void cpu_record_hist_print(struct vty *vty, uint8_t filter,
+				  struct json_object *json)
+{
+	struct json_object *json_m = NULL, *json_types = NULL, *json_cbs = NULL;
+	struct json_object *json_type;
+	struct thread_master *m;
+	struct listnode *ln;
+	unsigned int i;
+	void *args[3] = {vty, &filter, NULL};
+
+	if (json)
+		json_object_int_add(json, "since",
+				    monotime_since(&thread_hist_since, NULL)
+					    / TIMER_SECOND_MICRO);
+	else
+		vty_out(vty, "Times in microseconds, over the last %" PRId64
+			"s.  Percentiles are bucket upper bounds.\n",
+			monotime_since(&thread_hist_since, NULL)
+				/ TIMER_SECOND_MICRO);
+
+	frr_with_mutex (&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, ln, m)) {
+			const char *name = m->name ? m->name : "main";
+
+			if (json) {
+				json_m = json_object_new_object();
+				json_types = json_object_new_object();
+				json_cbs = json_object_new_array();
+				json_object_object_add(json_m, "types",
+						       json_types);
+				json_object_object_add(json_m, "callbacks",
+						       json_cbs);
+				json_object_object_add(json, name, json_m);
+			} else {
+				vty_out(vty, "\nShowing histograms for pthread %s\n",
+					name);
+				vty_out(vty, "%9s %-32s %-32s %-32s\n", "",
+					" Real (wall-clock):",
+					" CPU (user+system):",
+					" Delay (ready to run):");
+				vty_out(vty, "  Invoked");
+				for (i = 0; i < 3; i++)
+					vty_out(vty, " %7s %7s %7s %8s", "p50",
+						"p99", "p99.9", "Max");
+				vty_out(vty, "  %s\n", "Thread");
+			}
+
+			for (i = 0; i < THREAD_HIST_TYPES; i++) {
+				if (!thread_hist_type_names[i]
+				    || !(filter & (1 << i)))
+					continue;
+
+				if (json) {
+					json_type = json_object_new_object();
+					json_object_object_add(
+						json_type, "wall",
+						json_thread_hist(
+							&m->type_real[i], 0));
+					json_object_object_add(
+						json_type, "delay",
+						json_thread_hist(
+							&m->type_delay[i], 0));
+					json_object_object_add(
+						json_types,
+						thread_hist_type_names[i],
+						json_type);
+					continue;
+				}
+
+				vty_out(vty, "%9s", "");
+				vty_out_thread_hist(vty, &m->type_real[i], 0);
+				vty_out(vty, " %32s", "");
+				vty_out_thread_hist(vty, &m->type_delay[i], 0);
+				vty_out(vty, "  (all %s)\n",
+					thread_hist_type_names[i]);
+			}
+
+			args[2] = json_cbs;
+			hash_iterate(m->cpu_record,
+				     (void (*)(struct hash_bucket *,
+					       void *))cpu_record_hash_hist,
+				     args);
+		}
+	}
+}
+
 static void cpu_record_clear(uint8_t filter)
 {
 	uint8_t *tmp = &filter;
 	struct thread_master *m;
 	struct listnode *ln;
 
+	monotime(&thread_hist_since);
+
 	frr_with_mutex (&masters_mtx) {
 		for (ALL_LIST_ELEMENTS_RO(masters, ln, m)) {
 			frr_with_mutex (&m->mtx) {
+				unsigned int i;
+
+				if (filter == (uint8_t)-1U) {
+					atomic_store_explicit(
+						&m->lag.tasks, 0,
+						memory_order_relaxed);
+					atomic_store_explicit(
+						&m->lag.late, 0,
+						memory_order_relaxed);
+					atomic_store_explicit(
+						&m->lag.max, 0,
+						memory_order_relaxed);
+					m->lag.worst = NULL;
+				}
+
+				for (i = 0; i < THREAD_HIST_TYPES; i++) {
+					if (!(filter & (1 << i)))
+						continue;
+					memset(&m->type_real[i], 0,
+					       sizeof(m->type_real[i]));
+					memset(&m->type_delay[i], 0,
+					       sizeof(m->type_delay[i]));
+				}
+
 				void *args[2] = {tmp, m->cpu_record};
 				hash_iterate(
 					m->cpu_record,
@@ -357,6 +664,39 @@ DEFUN_NOSH (show_thread_cpu,
 	return CMD_SUCCESS;
 }
 
+DEFPY_NOSH (show_thread_cpu_histogram,
+	    show_thread_cpu_histogram_cmd,
+	    "show thread cpu histogram [FILTER$filterstr] [json$json]",
+	    SHOW_STR
+	    "Thread information\n"
+	    "Thread CPU usage\n"
+	    "Run time and scheduling delay distributions\n"
+	    "Display filter (rwtex)\n"
+	    JSON_STR)
+{
+	uint8_t filter = (uint8_t)-1U;
+	struct json_object *json_obj = NULL;
+
+	if (filterstr) {
+		filter = parse_filter(filterstr);
+		if (!filter) {
+			vty_out(vty,
+				"Invalid filter \"%s\" specified; must contain at leastone of 'RWTEXB'\n",
+				filterstr);
+			return CMD_WARNING;
+		}
+	}
+
+	if (json) {
+		json_obj = json_object_new_object();
+		cpu_record_hist_print(vty, filter, json_obj);
+		return vty_json(vty, json_obj);
+	}
+
+	cpu_record_hist_print(vty, filter, NULL);
+	return CMD_SUCCESS;
+}
+
 DEFPY (service_cputime_stats,
        service_cputime_stats_cmd,
        "[no] service cputime-stats",
@@ -412,6 +752,95 @@ ALIAS (service_walltime_warning,
        "Set up miscellaneous service\n"
        "Warn for tasks exceeding total wallclock threshold\n")
 
+DEFPY (service_starvation_warning,
+       service_starvation_warning_cmd,
+       "[no] service starvation-warning (1-4294967295)",
+       NO_STR
+       "Set up miscellaneous service\n"
+       "Warn for tasks running late (event loop starved)\n"
+       "Warning threshold in milliseconds\n")
+{
+	if (no)
+		lag_threshold = 0;
+	else
+		lag_threshold = starvation_warning * 1000;
+	return CMD_SUCCESS;
+}
+
+ALIAS (service_starvation_warning,
+       no_service_starvation_warning_cmd,
+       "no service starvation-warning",
+       NO_STR
+       "Set up miscellaneous service\n"
+       "Warn for tasks running late (event loop starved)\n")
+
+DEFPY_NOSH (show_thread_lag,
+	    show_thread_lag_cmd,
+	    "show thread lag [json$json]",
+	    SHOW_STR
+	    "Thread information\n"
+	    "How late tasks ran compared to when they were due\n"
+	    JSON_STR)
+{
+	struct json_object *json_obj = NULL, *json_m;
+	const struct xref_threadsched *worst;
+	struct thread_master *m;
+	struct listnode *ln;
+	size_t tasks, late, max;
+
+	if (json)
+		json_obj = json_object_new_object();
+	else
+		vty_out(vty, "%-20s %12s %10s %12s  %s\n", "Pthread", "Tasks",
+			"Late", "Max lag(us)", "Worst");
+
+	frr_with_mutex (&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, ln, m)) {
+			const char *name = m->name ? m->name : "main";
+
+			tasks = atomic_load_explicit(&m->lag.tasks,
+						     memory_order_relaxed);
+			late = atomic_load_explicit(&m->lag.late,
+						    memory_order_relaxed);
+			max = atomic_load_explicit(&m->lag.max,
+						   memory_order_relaxed);
+			worst = m->lag.worst;
+
+			if (!json_obj) {
+				vty_out(vty, "%-20s %12zu %10zu %12zu  %s\n",
+					name, tasks, late, max,
+					worst ? worst->funcname : "-");
+				continue;
+			}
+
+			json_m = json_object_new_object();
+			json_object_int_add(json_m, "tasks", tasks);
+			json_object_int_add(json_m, "late", late);
+			json_object_int_add(json_m, "maxLagUsec", max);
+			if (worst) {
+				json_object_string_add(json_m, "worstFunction",
+						       worst->funcname);
+				json_object_string_addf(
+					json_m, "worstLocation", "%s:%d",
+					worst->xref.file, worst->xref.line);
+			}
+			json_object_object_add(json_obj, name, json_m);
+		}
+	}
+
+	if (json_obj) {
+		json_object_int_add(json_obj, "thresholdMsec",
+				    lag_threshold / 1000);
+		return vty_json(vty, json_obj);
+	}
+	if (lag_threshold)
+		vty_out(vty, "\nTasks over %lums late are logged.\n",
+			lag_threshold / 1000);
+	else
+		vty_out(vty, "\nStarvation warnings are disabled.\n");
+	return CMD_SUCCESS;
+}
+
 static void show_thread_poll_helper(struct vty *vty, struct thread_master *m)
 {
 	const char *name = m->name ? m->name : "main";
@@ -424,6 +853,7 @@ static void show_thread_poll_helper(struct vty *vty, struct thread_master *m)
 
 	vty_out(vty, "\nShowing poll FD's for %s\n", name);
 	vty_out(vty, "----------------------%s\n", underline);
+	vty_out(vty, "Backend: %s\n", m->handler.epfd >= 0 ? "epoll" : "poll");
 	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
 		m->fd_limit);
 	for (i = 0; i < m->handler.pfdcount; i++) {
@@ -503,16 +933,22 @@ static void show_thread_timers_helper(struct vty *vty, struct thread_master *m)
 	const char *name = m->name ? m->name : "main";
 	char underline[strlen(name) + 1];
 	struct thread *thread;
+	int slot;
 
 	memset(underline, '-', sizeof(underline));
 	underline[sizeof(underline) - 1] = '\0';
 
 	vty_out(vty, "\nShowing timers for %s\n", name);
 	vty_out(vty, "-------------------%s\n", underline);
+	vty_out(vty, "Backend: %s\n", m->wheel ? "wheel" : "heap");
+	vty_out(vty, "Count: %zu\n", thread_timer_count(m));
 
 	frr_each (thread_timer_list, &m->timer, thread) {
 		vty_out(vty, "  %-50s%pTH\n", thread->hist->funcname, thread);
 	}
+	frr_each_wheel_safe (m, slot, thread) {
+		vty_out(vty, "  %-50s%pTH\n", thread->hist->funcname, thread);
+	}
 }
 
 DEFPY_NOSH (show_thread_timers,
@@ -535,7 +971,10 @@ DEFPY_NOSH (show_thread_timers,
 
 void thread_cmd_init(void)
 {
+	monotime(&thread_hist_since);
+
 	install_element(VIEW_NODE, &show_thread_cpu_cmd);
+	install_element(VIEW_NODE, &show_thread_cpu_histogram_cmd);
 	install_element(VIEW_NODE, &show_thread_poll_cmd);
 	install_element(ENABLE_NODE, &clear_thread_cpu_cmd);
 
@@ -544,8 +983,11 @@ void thread_cmd_init(void)
 	install_element(CONFIG_NODE, &no_service_cputime_warning_cmd);
 	install_element(CONFIG_NODE, &service_walltime_warning_cmd);
 	install_element(CONFIG_NODE, &no_service_walltime_warning_cmd);
+	install_element(CONFIG_NODE, &service_starvation_warning_cmd);
+	install_element(CONFIG_NODE, &no_service_starvation_warning_cmd);
 
 	install_element(VIEW_NODE, &show_thread_timers_cmd);
+	install_element(VIEW_NODE, &show_thread_lag_cmd);
 }
 /* CLI end ------------------------------------------------------------------ */
 
@@ -561,6 +1003,303 @@ static void initializer(void)
 	pthread_key_create(&thread_current, NULL);
 }
 
+/* I/O backends ------------------------------------------------------------ */
+
+static enum thread_io_backend io_backend = THREAD_IO_POLL;
+
+bool thread_io_backend_set(enum thread_io_backend backend)
+{
+#ifndef HAVE_EPOLL
+	if (backend == THREAD_IO_EPOLL)
+		return false;
+#endif
+	io_backend = backend;
+	return true;
+}
+
+/* Timer backends ---------------------------------------------------------- */
+
+static enum thread_timer_backend timer_backend = THREAD_TIMER_HEAP;
+
+void thread_timer_backend_set(enum thread_timer_backend backend)
+{
+	timer_backend = backend;
+}
+
+/*
+ * Hierarchical timer wheel.  Time is counted in 1ms ticks since the wheel
+ * was created.  Level L has 64 slots of 64^L ticks each; a timer goes on
+ * the lowest level where its expiry shares all higher digits with the
+ * current tick, i.e. level 0 holds the next 64ms, level 1 the next 4s and
+ * so on up to ~12 days.  Timers further out than that wait on the overflow
+ * slot.
+ *
+ * When the clock reaches a slot on a higher level, its timers are
+ * "cascaded" by re-inserting them; each timer is touched at most once per
+ * level.  Occupancy bitmaps make finding the next slot to process O(1), so
+ * idle periods are skipped over rather than stepped through.
+ *
+ * Timers are rounded up to the next tick, they never run early.  Those due
+ * are moved into m->timer (otherwise unused with the wheel) which runs them
+ * in exact expiry order, same as the heap backend does.
+ */
+static uint64_t timer_wheel_tick(struct thread_timer_wheel *w,
+				 const struct timeval *tv, bool roundup)
+{
+	struct timeval d;
+
+	if (timercmp(tv, &w->base, <))
+		return 0;
+
+	timersub(tv, &w->base, &d);
+	return (uint64_t)d.tv_sec * 1000
+	       + (d.tv_usec + (roundup ? 999 : 0)) / 1000;
+}
+
+static struct thread_timer_wheel *timer_wheel_new(void)
+{
+	struct thread_timer_wheel *w;
+
+	w = XCALLOC(MTYPE_THREAD_MASTER, sizeof(*w));
+	monotime(&w->base);
+	for (size_t i = 0; i < array_size(w->slots); i++)
+		thread_wheel_list_init(&w->slots[i]);
+	return w;
+}
+
+static void timer_wheel_insert(struct thread_timer_wheel *w,
+			       struct thread *thread)
+{
+	uint64_t exp = timer_wheel_tick(w, &thread->u.sands, true);
+	unsigned int level, slot;
+
+	if (exp < w->clk)
+		exp = w->clk;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+		if (!((exp ^ w->clk) >> (TIMER_WHEEL_BITS * (level + 1))))
+			break;
+
+	if (level == TIMER_WHEEL_LEVELS)
+		slot = TIMER_WHEEL_OVERFLOW;
+	else {
+		slot = (exp >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+		w->occupied[level] |= 1ULL << slot;
+		slot += level * TIMER_WHEEL_SLOTS;
+	}
+
+	thread->timerpos = slot;
+	thread_wheel_list_add_tail(&w->slots[slot], thread);
+}
+
+static void timer_wheel_unlink(struct thread_timer_wheel *w,
+			       struct thread *thread)
+{
+	unsigned int slot = thread->timerpos;
+
+	thread_wheel_list_del(&w->slots[slot], thread);
+	if (slot < TIMER_WHEEL_OVERFLOW
+	    && !thread_wheel_list_count(&w->slots[slot]))
+		w->occupied[slot / TIMER_WHEEL_SLOTS] &=
+			~(1ULL << (slot % TIMER_WHEEL_SLOTS));
+}
+
+/*
+ * Find the next tick at which some slot needs processing, either because
+ * its timers expire (level 0) or need cascading.  Returns the slot index,
+ * -1 if the wheel is empty.
+ */
+static int timer_wheel_next(struct thread_timer_wheel *w, uint64_t *tick)
+{
+	int best = -1;
+
+	/* walk top-down so that on a tie, cascading happens first */
+	if (thread_wheel_list_count(&w->slots[TIMER_WHEEL_OVERFLOW])) {
+		unsigned int shift = TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS;
+
+		*tick = ((w->clk >> shift) + 1) << shift;
+		best = TIMER_WHEEL_OVERFLOW;
+	}
+
+	for (int level = TIMER_WHEEL_LEVELS - 1; level >= 0; level--) {
+		unsigned int shift = TIMER_WHEEL_BITS * level;
+		unsigned int cur = (w->clk >> shift) & TIMER_WHEEL_MASK;
+		uint64_t bits = w->occupied[level] & (~0ULL << cur);
+		uint64_t at;
+		unsigned int slot;
+
+		if (!bits)
+			continue;
+
+		slot = __builtin_ctzll(bits);
+		at = (w->clk >> (shift + TIMER_WHEEL_BITS))
+		     << (shift + TIMER_WHEEL_BITS);
+		at += (uint64_t)slot << shift;
+		if (at < w->clk)
+			at = w->clk;
+
+		if (best < 0 || at < *tick) {
+			*tick = at;
+			best = level * TIMER_WHEEL_SLOTS + slot;
+		}
+	}
+	return best;
+}
+
+/* Move everything due at 'now' onto m->timer */
+static void timer_wheel_advance(struct thread_master *m,
+				const struct timeval *now)
+{
+	struct thread_timer_wheel *w = m->wheel;
+	uint64_t until = timer_wheel_tick(w, now, false);
+	uint64_t tick;
+	struct thread *thread;
+	int slot;
+
+	while ((slot = timer_wheel_next(w, &tick)) >= 0 && tick <= until) {
+		w->clk = tick;
+
+		while ((thread = thread_wheel_list_first(&w->slots[slot]))) {
+			timer_wheel_unlink(w, thread);
+			if (slot < (int)TIMER_WHEEL_SLOTS) {
+				w->count--;
+				thread->timerpos = TIMER_WHEEL_HEAP;
+				thread_timer_list_add(&m->timer, thread);
+			} else
+				timer_wheel_insert(w, thread);
+		}
+	}
+
+	if (w->clk <= until)
+		w->clk = until + 1;
+}
+
+/* Returns true if this is now the first timer to expire */
+static bool thread_timer_add(struct thread_master *m, struct thread *thread)
+{
+	struct thread_timer_wheel *w = m->wheel;
+	uint64_t tick;
+
+	if (!w) {
+		thread_timer_list_add(&m->timer, thread);
+		return thread_timer_list_first(&m->timer) == thread;
+	}
+
+	bool first = timer_wheel_next(w, &tick) < 0
+		     || timer_wheel_tick(w, &thread->u.sands, true) < tick;
+
+	timer_wheel_insert(w, thread);
+	w->count++;
+	return first;
+}
+
+static void thread_timer_del(struct thread_master *m, struct thread *thread)
+{
+	if (!m->wheel || thread->timerpos == TIMER_WHEEL_HEAP) {
+		thread_timer_list_del(&m->timer, thread);
+		return;
+	}
+
+	timer_wheel_unlink(m->wheel, thread);
+	m->wheel->count--;
+}
+
+#ifdef HAVE_EPOLL
+/*
+ * With epoll, file descriptors are registered EPOLLONESHOT.  This matches
+ * the one-shot nature of I/O tasks: a registration is disarmed when it
+ * fires, and re-armed by the next thread_add_read/write() on it.
+ *
+ * File descriptors that get closed without cancelling their task first
+ * drop out of the epoll set by themselves.  If the fd is still open
+ * elsewhere (dup, fork), the stale registration may report one spurious
+ * event on a reused fd number before being disarmed.
+ */
+#define THREAD_EPOLL_EVENTS 256
+
+static void thread_epoll_init(struct thread_master *m)
+{
+	struct fd_handler *h = &m->handler;
+	struct epoll_event ev = {};
+
+	h->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (h->epfd < 0) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "epoll_create1() failed, using poll(): %s",
+			     safe_strerror(errno));
+		return;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = m->io_pipe[0];
+	if (epoll_ctl(h->epfd, EPOLL_CTL_ADD, m->io_pipe[0], &ev)) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "epoll_ctl() failed, using poll(): %s",
+			     safe_strerror(errno));
+		close(h->epfd);
+		h->epfd = -1;
+		return;
+	}
+
+	h->pfdpos = XMALLOC(MTYPE_THREAD_MASTER, sizeof(int) * m->fd_limit);
+	memset(h->pfdpos, 0xff, sizeof(int) * m->fd_limit);
+	h->epsize = THREAD_EPOLL_EVENTS;
+	h->epevents = XCALLOC(MTYPE_THREAD_MASTER,
+			      sizeof(struct epoll_event) * h->epsize);
+}
+
+/* Set the kernel's interest for fd to 'events' (POLLIN / POLLOUT) */
+static bool thread_epoll_update(struct thread_master *m, int fd, short events)
+{
+	struct epoll_event ev = {};
+
+	if (!events) {
+		/* fails harmlessly if fd was already closed */
+		epoll_ctl(m->handler.epfd, EPOLL_CTL_DEL, fd, &ev);
+		return true;
+	}
+
+	ev.events = EPOLLONESHOT;
+	if (events & POLLIN)
+		ev.events |= EPOLLIN;
+	if (events & POLLOUT)
+		ev.events |= EPOLLOUT;
+	ev.data.fd = fd;
+
+	if (!epoll_ctl(m->handler.epfd, EPOLL_CTL_MOD, fd, &ev))
+		return true;
+	if (errno == ENOENT
+	    && !epoll_ctl(m->handler.epfd, EPOLL_CTL_ADD, fd, &ev))
+		return true;
+	return false;
+}
+
+/* pfds isn't ordered for epoll, so remove by moving the last entry in */
+static void thread_epoll_pfd_del(struct thread_master *m, nfds_t i)
+{
+	struct fd_handler *h = &m->handler;
+
+	h->pfdpos[h->pfds[i].fd] = -1;
+	h->pfdcount--;
+	if (i != h->pfdcount) {
+		h->pfds[i] = h->pfds[h->pfdcount];
+		h->pfdpos[h->pfds[i].fd] = i;
+	}
+	h->pfds[h->pfdcount].fd = 0;
+	h->pfds[h->pfdcount].events = 0;
+}
+#else /* !HAVE_EPOLL */
+static inline bool thread_epoll_update(struct thread_master *m, int fd,
+				       short events)
+{
+	return false;
+}
+
+static inline void thread_epoll_pfd_del(struct thread_master *m, nfds_t i)
+{
+}
+#endif /* HAVE_EPOLL */
+
 struct thread_master *thread_master_create(const char *name)
 {
 	struct thread_master *rv;
@@ -605,6 +1344,8 @@ struct thread_master *thread_master_create(const char *name)
 	thread_list_init(&rv->ready);
 	thread_list_init(&rv->unuse);
 	thread_timer_list_init(&rv->timer);
+	if (timer_backend == THREAD_TIMER_WHEEL)
+		rv->wheel = timer_wheel_new();
 
 	/* Initialize thread_fetch() settings */
 	rv->spin = true;
@@ -626,8 +1367,15 @@ struct thread_master *thread_master_create(const char *name)
 	rv->handler.pfdcount = 0;
 	rv->handler.pfds = XCALLOC(MTYPE_THREAD_MASTER,
 				   sizeof(struct pollfd) * rv->handler.pfdsize);
-	rv->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
+	rv->handler.epfd = -1;
+#ifdef HAVE_EPOLL
+	if (io_backend == THREAD_IO_EPOLL)
+		thread_epoll_init(rv);
+#endif
+	if (rv->handler.epfd < 0)
+		rv->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
+					   sizeof(struct pollfd)
+						   * rv->handler.pfdsize);
 
 	/* add to list of threadmasters */
 	frr_with_mutex (&masters_mtx) {
@@ -719,6 +1467,7 @@ void thread_master_free_unused(struct thread_master *m)
 void thread_master_free(struct thread_master *m)
 {
 	struct thread *t;
+	int i;
 
 	frr_with_mutex (&masters_mtx) {
 		listnode_delete(masters, m);
@@ -731,6 +1480,11 @@ void thread_master_free(struct thread_master *m)
 	thread_array_free(m, m->write);
 	while ((t = thread_timer_list_pop(&m->timer)))
 		thread_free(m, t);
+	frr_each_wheel_safe (m, i, t) {
+		thread_timer_del(m, t);
+		thread_free(m, t);
+	}
+	XFREE(MTYPE_THREAD_MASTER, m->wheel);
 	thread_list_free(m, &m->event);
 	thread_list_free(m, &m->ready);
 	thread_list_free(m, &m->unuse);
@@ -748,6 +1502,10 @@ void thread_master_free(struct thread_master *m)
 	XFREE(MTYPE_THREAD_MASTER, m->name);
 	XFREE(MTYPE_THREAD_MASTER, m->handler.pfds);
 	XFREE(MTYPE_THREAD_MASTER, m->handler.copy);
+	if (m->handler.epfd >= 0)
+		close(m->handler.epfd);
+	XFREE(MTYPE_THREAD_MASTER, m->handler.pfdpos);
+	XFREE(MTYPE_THREAD_MASTER, m->handler.epevents);
 	XFREE(MTYPE_THREAD_MASTER, m);
 }
 
@@ -906,11 +1664,13 @@ static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 	rcu_read_unlock();
 	rcu_assert_read_unlocked();
 
-	/* add poll pipe poker */
-	assert(count + 1 < m->handler.pfdsize);
-	m->handler.copy[count].fd = m->io_pipe[0];
-	m->handler.copy[count].events = POLLIN;
-	m->handler.copy[count].revents = 0x00;
+	/* add poll pipe poker (epoll has it registered permanently) */
+	if (m->handler.epfd < 0) {
+		assert(count + 1 < m->handler.pfdsize);
+		m->handler.copy[count].fd = m->io_pipe[0];
+		m->handler.copy[count].events = POLLIN;
+		m->handler.copy[count].revents = 0x00;
+	}
 
 	/* We need to deal with a signal-handling race here: we
 	 * don't want to miss a crucial signal, such as SIGTERM or SIGINT,
@@ -935,6 +1695,15 @@ static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 		pthread_sigmask(SIG_SETMASK, NULL, &origsigs);
 	}
 
+#ifdef HAVE_EPOLL
+	if (m->handler.epfd >= 0) {
+		num = epoll_pwait(m->handler.epfd, m->handler.epevents,
+				  m->handler.epsize, timeout, &origsigs);
+		pthread_sigmask(SIG_SETMASK, &origsigs, NULL);
+		goto done;
+	}
+#endif
+
 #if defined(HAVE_PPOLL)
 	struct timespec ts, *tsp;
 
@@ -958,6 +1727,26 @@ done:
 	if (num < 0 && errno == EINTR)
 		*eintr_p = true;
 
+#ifdef HAVE_EPOLL
+	if (m->handler.epfd >= 0) {
+		struct epoll_event *ev = m->handler.epevents;
+
+		/* drain the pipe and drop its event from the result set */
+		for (int i = 0; i < num; i++) {
+			if (ev[i].data.fd != m->io_pipe[0])
+				continue;
+
+			while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
+				;
+			ev[i] = ev[--num];
+			break;
+		}
+
+		rcu_read_lock();
+		return num;
+	}
+#endif
+
 	if (num > 0 && m->handler.copy[count].revents != 0 && num--)
 		while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
 			;
@@ -1005,20 +1794,25 @@ void _thread_add_read_write(const struct xref_threadsched *xref,
 
 		/* if we already have a pollfd for our file descriptor, find and
 		 * use it */
-		for (nfds_t i = 0; i < m->handler.pfdcount; i++)
-			if (m->handler.pfds[i].fd == fd) {
-				queuepos = i;
+		if (m->handler.epfd >= 0) {
+			if (m->handler.pfdpos[fd] >= 0)
+				queuepos = m->handler.pfdpos[fd];
+		} else {
+			for (nfds_t i = 0; i < m->handler.pfdcount; i++)
+				if (m->handler.pfds[i].fd == fd) {
+					queuepos = i;
+					break;
+				}
+		}
 
 #ifdef DEV_BUILD
-				/*
-				 * What happens if we have a thread already
-				 * created for this event?
-				 */
-				if (thread_array[fd])
-					assert(!"Thread already scheduled for file descriptor");
+		/*
+		 * What happens if we have a thread already
+		 * created for this event?
+		 */
+		if (queuepos < m->handler.pfdcount && thread_array[fd])
+			assert(!"Thread already scheduled for file descriptor");
 #endif
-				break;
-			}
 
 		/* make sure we have room for this fd + pipe poker fd */
 		assert(queuepos + 1 < m->handler.pfdsize);
@@ -1029,8 +1823,11 @@ void _thread_add_read_write(const struct xref_threadsched *xref,
 		m->handler.pfds[queuepos].events |=
 			(dir == THREAD_READ ? POLLIN : POLLOUT);
 
-		if (queuepos == m->handler.pfdcount)
+		if (queuepos == m->handler.pfdcount) {
 			m->handler.pfdcount++;
+			if (m->handler.epfd >= 0)
+				m->handler.pfdpos[fd] = queuepos;
+		}
 
 		if (thread) {
 			frr_with_mutex (&thread->mtx) {
@@ -1044,6 +1841,21 @@ void _thread_add_read_write(const struct xref_threadsched *xref,
 			}
 		}
 
+		/* epoll refuses some fds that poll() takes (e.g. regular
+		 * files, which poll() always reports ready), so run the task
+		 * right away for those
+		 */
+		if (m->handler.epfd >= 0
+		    && !thread_epoll_update(m, fd,
+					    m->handler.pfds[queuepos].events)) {
+			thread_process_io_helper(m, thread,
+						 dir == THREAD_READ ? POLLIN
+								    : POLLOUT,
+						 0, queuepos);
+			if (m->handler.pfds[queuepos].events == 0)
+				thread_epoll_pfd_del(m, queuepos);
+		}
+
 		AWAKEN(m);
 	}
 }
@@ -1056,6 +1868,7 @@ static void _thread_add_timer_timeval(const struct xref_threadsched *xref,
 {
 	struct thread *thread;
 	struct timeval t;
+	bool first;
 
 	assert(m != NULL);
 
@@ -1078,18 +1891,17 @@ static void _thread_add_timer_timeval(const struct xref_threadsched *xref,
 
 		frr_with_mutex (&thread->mtx) {
 			thread->u.sands = t;
-			thread_timer_list_add(&m->timer, thread);
+			first = thread_timer_add(m, thread);
 			if (t_ptr) {
 				*t_ptr = thread;
 				thread->ref = t_ptr;
 			}
 		}
 
-		/* The timer list is sorted - if this new timer
-		 * might change the time we'll wait for, give the pthread
-		 * a chance to re-compute.
+		/* If this new timer might change the time we'll wait for,
+		 * give the pthread a chance to re-compute.
 		 */
-		if (thread_timer_list_first(&m->timer) == thread)
+		if (first)
 			AWAKEN(m);
 	}
 #define ONEYEAR2SEC (60 * 60 * 24 * 365)
@@ -1141,6 +1953,39 @@ void _thread_add_timer_tv(const struct xref_threadsched *xref,
 	_thread_add_timer_timeval(xref, m, func, arg, tv, t_ptr);
 }
 
+void thread_timer_reschedule_msec(struct thread *thread, long msec)
+{
+	struct thread_master *m = thread->master;
+	struct timeval t, trel;
+	bool first;
+
+	assert(thread->add_type == THREAD_TIMER);
+
+	trel.tv_sec = msec / 1000;
+	trel.tv_usec = 1000 * (msec % 1000);
+
+	monotime(&t);
+	timeradd(&t, &trel, &t);
+
+	frr_with_mutex (&m->mtx) {
+		if (thread->type == THREAD_READY)
+			thread_list_del(&m->ready, thread);
+		else {
+			assert(thread->type == THREAD_TIMER);
+			thread_timer_del(m, thread);
+		}
+
+		frr_with_mutex (&thread->mtx) {
+			thread->type = THREAD_TIMER;
+			thread->u.sands = t;
+			first = thread_timer_add(m, thread);
+		}
+
+		if (first)
+			AWAKEN(m);
+	}
+}
+
 /* Add simple event thread. */
 void _thread_add_event(const struct xref_threadsched *xref,
 		       struct thread_master *m, void (*func)(struct thread *),
@@ -1162,6 +2007,7 @@ void _thread_add_event(const struct xref_threadsched *xref,
 		thread = thread_get(m, THREAD_EVENT, func, arg, xref);
 		frr_with_mutex (&thread->mtx) {
 			thread->u.val = val;
+			monotime(&thread->queued);
 			thread_list_add_tail(&m->event, thread);
 		}
 
@@ -1205,6 +2051,9 @@ static void thread_cancel_rw(struct thread_master *master, int fd, short state,
 	if (idx_hint >= 0) {
 		i = idx_hint;
 		found = true;
+	} else if (master->handler.epfd >= 0) {
+		found = master->handler.pfdpos[fd] >= 0;
+		i = master->handler.pfdpos[fd];
 	} else {
 		/* Have to look for the fd in the pfd array */
 		for (i = 0; i < master->handler.pfdcount; i++)
@@ -1225,6 +2074,13 @@ static void thread_cancel_rw(struct thread_master *master, int fd, short state,
 	/* NOT out event. */
 	master->handler.pfds[i].events &= ~(state);
 
+	if (master->handler.epfd >= 0) {
+		thread_epoll_update(master, fd, master->handler.pfds[i].events);
+		if (master->handler.pfds[i].events == 0)
+			thread_epoll_pfd_del(master, i);
+		return;
+	}
+
 	/* If all events are canceled, delete / resize the pollfd array. */
 	if (master->handler.pfds[i].events == 0) {
 		memmove(master->handler.pfds + i, master->handler.pfds + i + 1,
@@ -1261,7 +2117,7 @@ static void cancel_arg_helper(struct thread_master *master,
 {
 	struct thread *t;
 	nfds_t i;
-	int fd;
+	int fd, slot;
 	struct pollfd *pfd;
 
 	/* We're only processing arg-based cancellations here. */
@@ -1339,6 +2195,15 @@ static void cancel_arg_helper(struct thread_master *master,
 
 		t = t_next;
 	}
+
+	frr_each_wheel_safe (master, slot, t) {
+		if (t->arg == cr->eventobj) {
+			thread_timer_del(master, t);
+			if (t->ref)
+				*t->ref = NULL;
+			thread_add_unuse(master, t);
+		}
+	}
 }
 
 /**
@@ -1390,7 +2255,7 @@ static void do_thread_cancel(struct thread_master *master)
 			thread_array = master->write;
 			break;
 		case THREAD_TIMER:
-			thread_timer_list_del(&master->timer, thread);
+			thread_timer_del(master, thread);
 			break;
 		case THREAD_EVENT:
 			list = &master->event;
@@ -1576,13 +2441,25 @@ void thread_cancel_async(struct thread_master *master, struct thread **thread,
 }
 /* ------------------------------------------------------------------------- */
 
-static struct timeval *thread_timer_wait(struct thread_timer_list_head *timers,
+static struct timeval *thread_timer_wait(struct thread_master *m,
 					 struct timeval *timer_val)
 {
-	if (!thread_timer_list_count(timers))
+	struct thread_timer_wheel *w = m->wheel;
+	struct timeval next;
+	uint64_t tick;
+
+	if (w && timer_wheel_next(w, &tick) >= 0) {
+		next.tv_sec = tick / 1000;
+		next.tv_usec = (tick % 1000) * 1000;
+		timeradd(&w->base, &next, &next);
+		monotime_until(&next, timer_val);
+		return timer_val;
+	}
+
+	if (!thread_timer_list_count(&m->timer))
 		return NULL;
 
-	struct thread *next_timer = thread_timer_list_first(timers);
+	struct thread *next_timer = thread_timer_list_first(&m->timer);
 	monotime_until(&next_timer->u.sands, timer_val);
 	return timer_val;
 }
@@ -1628,6 +2505,7 @@ static int thread_process_io_helper(struct thread_master *m,
 		thread_array = m->write;
 
 	thread_array[thread->u.fd] = NULL;
+	monotime(&thread->queued);
 	thread_list_add_tail(&m->ready, thread);
 	thread->type = THREAD_READY;
 
@@ -1700,38 +2578,79 @@ static void thread_process_io(struct thread_master *m, unsigned int num)
 	}
 }
 
+#ifdef HAVE_EPOLL
+/**
+ * Process I/O events returned by epoll_pwait().
+ *
+ * The pipe poker has already been removed from the event list by fd_poll().
+ * m->handler.pfds is authoritative here; there is no copy to keep in sync.
+ *
+ * @param m the thread master
+ * @param num the number of entries in m->handler.epevents
+ */
+static void thread_process_io_epoll(struct thread_master *m, int num)
+{
+	struct epoll_event *ev = m->handler.epevents;
+
+	for (int i = 0; i < num; i++) {
+		int fd = ev[i].data.fd;
+		short revents = 0;
+		int pos;
+
+		if (fd < 0 || fd >= m->fd_limit)
+			continue;
+
+		/* cancelled while we were waiting */
+		pos = m->handler.pfdpos[fd];
+		if (pos < 0)
+			continue;
+
+		if (ev[i].events & EPOLLIN)
+			revents |= POLLIN;
+		if (ev[i].events & EPOLLOUT)
+			revents |= POLLOUT;
+		if (ev[i].events & EPOLLERR)
+			revents |= POLLERR;
+		if (ev[i].events & EPOLLHUP)
+			revents |= POLLHUP;
+
+		/* same as thread_process_io(): errors go to the reader */
+		if (revents & (POLLIN | POLLHUP | POLLERR))
+			thread_process_io_helper(m, m->read[fd], POLLIN,
+						 revents, pos);
+		if (revents & POLLOUT)
+			thread_process_io_helper(m, m->write[fd], POLLOUT,
+						 revents, pos);
+
+		/* the one-shot registration is now disarmed; re-arm it for
+		 * whatever direction is still waiting, or forget about fd
+		 */
+		if (m->handler.pfds[pos].events == 0)
+			thread_epoll_pfd_del(m, pos);
+		else
+			thread_epoll_update(m, fd, m->handler.pfds[pos].events);
+	}
+}
+#else
+static inline void thread_process_io_epoll(struct thread_master *m, int num)
+{
+}
+#endif /* HAVE_EPOLL */
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int thread_process_timers(struct thread_master *m,
 					  struct timeval *timenow)
 {
-	struct timeval prev = *timenow;
-	bool displayed = false;
 	struct thread *thread;
 	unsigned int ready = 0;
 
+	if (m->wheel)
+		timer_wheel_advance(m, timenow);
+
+	/* how late these run is looked at in thread_call() */
 	while ((thread = thread_timer_list_first(&m->timer))) {
 		if (timercmp(timenow, &thread->u.sands, <))
 			break;
-		prev = thread->u.sands;
-		prev.tv_sec += 4;
-		/*
-		 * If the timer would have popped 4 seconds in the
-		 * past then we are in a situation where we are
-		 * really getting behind on handling of events.
-		 * Let's log it and do the right thing with it.
-		 */
-		if (timercmp(timenow, &prev, >)) {
-			atomic_fetch_add_explicit(
-				&thread->hist->total_starv_warn, 1,
-				memory_order_seq_cst);
-			if (!displayed && !thread->ignore_timer_late) {
-				flog_warn(
-					EC_LIB_STARVE_THREAD,
-					"Thread Starvation: %pTHD was scheduled to pop greater than 4s ago",
-					thread);
-				displayed = true;
-			}
-		}
 
 		thread_timer_list_pop(&m->timer);
 		thread->type = THREAD_READY;
@@ -1819,7 +2738,7 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 		 * once per loop to avoid starvation by events
 		 */
 		if (!thread_list_count(&m->ready))
-			tw = thread_timer_wait(&m->timer, &tv);
+			tw = thread_timer_wait(m, &tv);
 
 		if (thread_list_count(&m->ready) ||
 				(tw && !timercmp(tw, &zerotime, >)))
@@ -1835,9 +2754,11 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 		 * Copy pollfd array + # active pollfds in it. Not necessary to
 		 * copy the array size as this is fixed.
 		 */
-		m->handler.copycount = m->handler.pfdcount;
-		memcpy(m->handler.copy, m->handler.pfds,
-		       m->handler.copycount * sizeof(struct pollfd));
+		if (m->handler.epfd < 0) {
+			m->handler.copycount = m->handler.pfdcount;
+			memcpy(m->handler.copy, m->handler.pfds,
+			       m->handler.copycount * sizeof(struct pollfd));
+		}
 
 		pthread_mutex_unlock(&m->mtx);
 		{
@@ -1867,7 +2788,9 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 		thread_process_timers(m, &now);
 
 		/* Post I/O to ready queue. */
-		if (num > 0)
+		if (num > 0 && m->handler.epfd >= 0)
+			thread_process_io_epoll(m, num);
+		else if (num > 0)
 			thread_process_io(m, num);
 
 		pthread_mutex_unlock(&m->mtx);
@@ -1883,6 +2806,15 @@ static unsigned long timeval_elapsed(struct timeval a, struct timeval b)
 		+ (a.tv_usec - b.tv_usec));
 }
 
+static void thread_hist_add(struct thread_hist *h, unsigned long usec)
+{
+	unsigned int i = 0;
+
+	if (usec)
+		i = MIN(64 - __builtin_clzll(usec), THREAD_HIST_BUCKETS - 1);
+	counter_add(h->bucket[i], 1);
+}
+
 unsigned long thread_consumed_time(RUSAGE_T *now, RUSAGE_T *start,
 				   unsigned long *cputime)
 {
@@ -1945,6 +2877,17 @@ void thread_set_yield_time(struct thread *thread, unsigned long yield_time)
 	}
 }
 
+unsigned int thread_master_pending(struct thread_master *m)
+{
+	unsigned int pending;
+
+	frr_with_mutex (&m->mtx) {
+		pending = thread_list_count(&m->ready)
+			  + thread_list_count(&m->event);
+	}
+	return pending;
+}
+
 void thread_getrusage(RUSAGE_T *r)
 {
 	monotime(&r->real);
@@ -1968,20 +2911,56 @@ void thread_getrusage(RUSAGE_T *r)
 #endif
 }
 
+/*
+ * Lag watchdog: if a timer ran well after it was due, or an I/O or event task
+ * sat on the ready list that long, the loop is starved.  Whatever ran before
+ * it is to blame, but the victim is what the protocol sees (BFD, hellos...),
+ * so name it.  Warnings are limited to one per second per pthread.
+ */
+static void thread_lag_check(struct thread *thread, unsigned long lag)
+{
+	struct thread_lag *tl = &thread->master->lag;
+	size_t exp;
+
+	counter_add(tl->tasks, 1);
+	exp = counter_get(tl->max);
+	if (exp < lag) {
+		counter_set(tl->max, lag);
+		tl->worst = thread->xref;
+	}
+
+	if (!lag_threshold || lag <= lag_threshold)
+		return;
+
+	counter_add(tl->late, 1);
+	counter_add(thread->hist->total_starv_warn, 1);
+
+	if (thread->ignore_timer_late
+	    || monotime_since(&tl->last_warn, NULL) < TIMER_SECOND_MICRO)
+		return;
+	monotime(&tl->last_warn);
+
+	flog_warn(EC_LIB_STARVE_THREAD,
+		  "Thread Starvation: %s %s() from %s:%d ran %lums late",
+		  thread->add_type == THREAD_TIMER ? "timer" : "task",
+		  thread->xref->funcname, thread->xref->xref.file,
+		  thread->xref->xref.line, lag / 1000);
+}
+
 /*
  * Call a thread.
  *
- * This function will atomically update the thread's usage history. At present
- * this is the only spot where usage history is written. Nevertheless the code
- * has been written such that the introduction of writers in the future should
- * not need to update it provided the writers atomically perform only the
- * operations done here, i.e. updating the total and maximum times. In
- * particular, the maximum real and cpu times must be monotonically increasing
- * or this code is not correct.
+ * This function updates the thread's usage history, which is the only spot
+ * where it is written.  The statistics belong to the master, so normally
+ * only the master's pthread writes them and no locked instructions are
+ * needed (see counters.h.)  thread_execute() on another pthread's master
+ * still works, but doesn't bump the sequence number:  readers can't get
+ * stuck on it, at worst a racing update is lost.
  */
 void thread_call(struct thread *thread)
 {
 	RUSAGE_T before, after;
+	bool own = pthread_equal(thread->master->owner, pthread_self());
 
 	/* if the thread being called is the CLI, it may change cputime_enabled
 	 * ("service cputime-stats" command), which can result in nonsensical
@@ -2008,64 +2987,87 @@ void thread_call(struct thread *thread)
 	GETRUSAGE(&after);
 	thread->master->last_getrusage = after;
 
-	unsigned long walltime, cputime;
-	unsigned long exp;
+	unsigned long walltime, cputime, delaytime;
+	struct timeval delay;
+	bool cpu_hog, wall_hog;
 
 	walltime = thread_consumed_time(&after, &before, &cputime);
 
+	if (own)
+		counters_write_begin(&thread->hist->seq);
+
 	/* update walltime */
-	atomic_fetch_add_explicit(&thread->hist->real.total, walltime,
-				  memory_order_seq_cst);
-	exp = atomic_load_explicit(&thread->hist->real.max,
-				   memory_order_seq_cst);
-	while (exp < walltime
-	       && !atomic_compare_exchange_weak_explicit(
-		       &thread->hist->real.max, &exp, walltime,
-		       memory_order_seq_cst, memory_order_seq_cst))
-		;
+	counter_add(thread->hist->real.total, walltime);
+	counter_max(thread->hist->real.max, walltime);
 
 	if (cputime_enabled_here && cputime_enabled) {
 		/* update cputime */
-		atomic_fetch_add_explicit(&thread->hist->cpu.total, cputime,
-					  memory_order_seq_cst);
-		exp = atomic_load_explicit(&thread->hist->cpu.max,
-					   memory_order_seq_cst);
-		while (exp < cputime
-		       && !atomic_compare_exchange_weak_explicit(
-			       &thread->hist->cpu.max, &exp, cputime,
-			       memory_order_seq_cst, memory_order_seq_cst))
-			;
+		counter_add(thread->hist->cpu.total, cputime);
+		counter_max(thread->hist->cpu.max, cputime);
+	}
+
+	/* how long it waited past its timer, or since it became ready */
+	if (thread->add_type == THREAD_TIMER)
+		delay = thread->u.sands;
+	else
+		delay = thread->queued;
+	if (thread->add_type != THREAD_EXECUTE
+	    && timercmp(&before.real, &delay, >))
+		delaytime = timeval_elapsed(before.real, delay);
+	else
+		delaytime = 0;
+
+	thread_hist_add(&thread->hist->real_hist, walltime);
+	if (cputime_enabled_here && cputime_enabled)
+		thread_hist_add(&thread->hist->cpu_hist, cputime);
+	thread_hist_add(&thread->hist->delay_hist, delaytime);
+	if (thread->add_type < THREAD_HIST_TYPES) {
+		thread_hist_add(&thread->master->type_real[thread->add_type],
+				walltime);
+		thread_hist_add(&thread->master->type_delay[thread->add_type],
+				delaytime);
 	}
 
-	atomic_fetch_add_explicit(&thread->hist->total_calls, 1,
-				  memory_order_seq_cst);
-	atomic_fetch_or_explicit(&thread->hist->types, 1 << thread->add_type,
-				 memory_order_seq_cst);
+	if (thread->add_type != THREAD_EXECUTE)
+		thread_lag_check(thread, delaytime);
+
+	frrtrace(5, frr_libfrr, thread_call_done, thread->master,
+		 thread->xref->funcname, walltime, cputime, delaytime);
+
+	cpu_hog = cputime_enabled_here && cputime_enabled && cputime_threshold
+		  && cputime > cputime_threshold;
+	wall_hog = !cpu_hog && walltime_threshold
+		   && walltime > walltime_threshold;
+
+	counter_add(thread->hist->total_calls, 1);
+	counter_or(thread->hist->types, 1 << thread->add_type);
+	if (cpu_hog)
+		counter_add(thread->hist->total_cpu_warn, 1);
+	else if (wall_hog)
+		counter_add(thread->hist->total_wall_warn, 1);
+
+	if (own)
+		counters_write_end(&thread->hist->seq);
 
-	if (cputime_enabled_here && cputime_enabled && cputime_threshold
-	    && cputime > cputime_threshold) {
+	if (cpu_hog) {
 		/*
 		 * We have a CPU Hog on our hands.  The time FRR has spent
 		 * doing actual work (not sleeping) is greater than 5 seconds.
 		 * Whinge about it now, so we're aware this is yet another task
 		 * to fix.
 		 */
-		atomic_fetch_add_explicit(&thread->hist->total_cpu_warn,
-					  1, memory_order_seq_cst);
 		flog_warn(
 			EC_LIB_SLOW_THREAD_CPU,
 			"CPU HOG: task %s (%lx) ran for %lums (cpu time %lums)",
 			thread->xref->funcname, (unsigned long)thread->func,
 			walltime / 1000, cputime / 1000);
 
-	} else if (walltime_threshold && walltime > walltime_threshold) {
+	} else if (wall_hog) {
 		/*
 		 * The runtime for a task is greater than 5 seconds, but the
 		 * cpu time is under 5 seconds.  Let's whine about this because
 		 * this could imply some sort of scheduling issue.
 		 */
-		atomic_fetch_add_explicit(&thread->hist->total_wall_warn,
-					  1, memory_order_seq_cst);
 		flog_warn(
 			EC_LIB_SLOW_THREAD_WALL,
 			"STARVATION: task %s (%lx) ran for %lums (cpu time %lums)",
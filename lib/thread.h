@@ -26,6 +26,7 @@
 #include <poll.h>
 #include "monotime.h"
 #include "frratomic.h"
+#include "counters.h"
 #include "typesafe.h"
 #include "xref.h"
 
@@ -39,6 +40,8 @@ extern unsigned long cputime_threshold;
  * hardware TSC w/o syscalls)
  */
 extern unsigned long walltime_threshold;
+/* tasks running later than this (usec) after they were due get logged */
+extern unsigned long lag_threshold;
 
 struct rusage_t {
 #ifdef HAVE_CLOCK_THREAD_CPUTIME_ID
@@ -54,6 +57,9 @@ struct rusage_t {
 
 PREDECL_LIST(thread_list);
 PREDECL_HEAP(thread_timer_list);
+PREDECL_DLIST(thread_wheel_list);
+
+struct epoll_event;
 
 struct fd_handler {
 	/* number of pfd that fit in the allocated space of pfds. This is a
@@ -70,6 +76,56 @@ struct fd_handler {
 	struct pollfd *copy;
 	/* number of pollfds stored in copy */
 	nfds_t copycount;
+
+	/* epoll backend, epfd is -1 when using poll().  pfds is still kept
+	 * up to date, but unordered and without copy; pfdpos maps each fd to
+	 * its index in pfds (-1 if none.)
+	 */
+	int epfd;
+	int *pfdpos;
+	struct epoll_event *epevents;
+	int epsize;
+};
+
+/* Backend used to wait for I/O in thread_fetch().  THREAD_IO_EPOLL is only
+ * available on Linux.
+ */
+enum thread_io_backend {
+	THREAD_IO_POLL = 0,
+	THREAD_IO_EPOLL,
+};
+
+/* Data structure holding the timers of a thread_master.  The heap is exact
+ * and O(log n) per operation, the hierarchical timer wheel is O(1) per
+ * operation and has 1ms resolution.
+ */
+enum thread_timer_backend {
+	THREAD_TIMER_HEAP = 0,
+	THREAD_TIMER_WHEEL,
+};
+
+struct thread_timer_wheel;
+
+/*
+ * Log2 histogram of times in microseconds: bucket 0 is below 1us, bucket i
+ * below 2^i us, the last one takes everything above.
+ */
+#define THREAD_HIST_BUCKETS 32
+/* THREAD_READ to THREAD_EXECUTE */
+#define THREAD_HIST_TYPES 7
+
+struct thread_hist {
+	atomic_size_t bucket[THREAD_HIST_BUCKETS];
+};
+
+/* how late tasks ran compared to when they were due, see thread_call() */
+struct thread_lag {
+	atomic_size_t tasks;
+	atomic_size_t late;
+	atomic_size_t max;
+	/* the task that was max late */
+	const struct xref_threadsched *worst;
+	struct timeval last_warn;
 };
 
 struct xref_threadsched {
@@ -87,6 +143,7 @@ struct thread_master {
 	struct thread **read;
 	struct thread **write;
 	struct thread_timer_list_head timer;
+	struct thread_timer_wheel *wheel;
 	struct thread_list_head event, ready, unuse;
 	struct list *cancel_req;
 	bool canceled;
@@ -104,14 +161,23 @@ struct thread_master {
 
 	bool ready_run_loop;
 	RUSAGE_T last_getrusage;
+
+	/* run and scheduling delay times of all tasks, by add_type */
+	struct thread_hist type_real[THREAD_HIST_TYPES];
+	struct thread_hist type_delay[THREAD_HIST_TYPES];
+	struct thread_lag lag;
 };
 
 /* Thread itself. */
 struct thread {
 	uint8_t type;		  /* thread type */
 	uint8_t add_type;	  /* thread type */
+	uint16_t timerpos;	  /* timer wheel slot, if any */
 	struct thread_list_item threaditem;
-	struct thread_timer_list_item timeritem;
+	union {
+		struct thread_timer_list_item timeritem;
+		struct thread_wheel_list_item wheelitem;
+	};
 	struct thread **ref;	  /* external reference (if given) */
 	struct thread_master *master; /* pointer to the struct thread_master */
 	void (*func)(struct thread *); /* event function */
@@ -122,6 +188,7 @@ struct thread {
 		struct timeval sands; /* rest of time sands value. */
 	} u;
 	struct timeval real;
+	struct timeval queued; /* when it became ready, if not a timer */
 	struct cpu_thread_history *hist; /* cache pointer to cpu_history */
 	unsigned long yield;		 /* yield time in microseconds */
 	const struct xref_threadsched *xref;   /* origin location */
@@ -135,6 +202,8 @@ struct thread {
 
 struct cpu_thread_history {
 	void (*func)(struct thread *);
+	/* written only by the master's own pthread, in thread_call() */
+	struct counters_seq seq;
 	atomic_size_t total_cpu_warn;
 	atomic_size_t total_wall_warn;
 	atomic_size_t total_starv_warn;
@@ -144,6 +213,10 @@ struct cpu_thread_history {
 		atomic_size_t total, max;
 	} real;
 	struct time_stats cpu;
+	/* wall and CPU time of each call, and how late it ran */
+	struct thread_hist real_hist;
+	struct thread_hist cpu_hist;
+	struct thread_hist delay_hist;
 	atomic_uint_fast32_t types;
 	const char *funcname;
 };
@@ -221,6 +294,9 @@ struct cpu_thread_history {
 
 /* Prototypes. */
 extern struct thread_master *thread_master_create(const char *);
+/* applies to thread_masters created afterwards, false if unavailable */
+extern bool thread_io_backend_set(enum thread_io_backend backend);
+extern void thread_timer_backend_set(enum thread_timer_backend backend);
 void thread_master_set_name(struct thread_master *master, const char *name);
 extern void thread_master_free(struct thread_master *);
 extern void thread_master_free_unused(struct thread_master *);
@@ -263,12 +339,20 @@ extern void thread_cancel_event_ready(struct thread_master *m, void *arg);
 extern void thread_cancel_event(struct thread_master *m, void *arg);
 extern struct thread *thread_fetch(struct thread_master *, struct thread *);
 extern void thread_call(struct thread *);
+/* Moves the expiry of a scheduled timer to 'msec' from now, reusing the
+ * task.  This also works if the timer has expired but not run yet.
+ */
+extern void thread_timer_reschedule_msec(struct thread *thread, long msec);
 extern unsigned long thread_timer_remain_second(struct thread *);
 extern struct timeval thread_timer_remain(struct thread *);
 extern unsigned long thread_timer_remain_msec(struct thread *);
 extern int thread_should_yield(struct thread *);
 /* set yield time for thread */
 extern void thread_set_yield_time(struct thread *, unsigned long);
+/* Number of tasks (I/O, expired timers and events) that are ready to run
+ * on 'm' but waiting for the current task to finish.
+ */
+extern unsigned int thread_master_pending(struct thread_master *m);
 
 /* Internal libfrr exports */
 extern void thread_getrusage(RUSAGE_T *);
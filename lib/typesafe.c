@@ -27,6 +27,7 @@
 #include "network.h"
 
 DEFINE_MTYPE_STATIC(LIB, TYPEDHASH_BUCKET, "Typed-hash bucket");
+DEFINE_MTYPE_STATIC(LIB, TYPEDHASH_FLAT, "Typed-hash flat table");
 DEFINE_MTYPE_STATIC(LIB, SKIPLIST_OFLOW, "Skiplist overflow");
 DEFINE_MTYPE_STATIC(LIB, HEAP_ARRAY, "Typed-heap array");
 
@@ -197,6 +198,250 @@ void typesafe_hash_shrink(struct thash_head *head)
 	hash_consistency_check(head);
 }
 
+/* smallest table, and the load above which the table is grown */
+#define FLATHASH_MINSHIFT	3
+#define FLATHASH_MAXLOAD(shift)	((1U << (shift)) - (1U << (shift)) / 4)
+/* spare slots after the end when (re)building the table */
+#define FLATHASH_SPARE(shift)	((1U << (shift)) / 16 + 4)
+
+#define FLATHASH_NONE		UINT32_MAX
+
+#if 0
+static void flathash_consistency_check(struct tflathash_head *head)
+{
+	uint32_t i, count = 0;
+	const struct tflathash_slot *prev = NULL;
+
+	for (i = 0; i < head->tabmax; i++) {
+		const struct tflathash_slot *slot = &head->entries[i];
+
+		if (!slot->fitem) {
+			prev = NULL;
+			continue;
+		}
+		assert(head->first <= i);
+		assert(FLATHASH_HOME(*head, slot->hashval) <= i);
+		assert(slot->hashval == slot->fitem->hashval);
+		assert(!prev || prev->hashval <= slot->hashval);
+		/* Robin Hood: a cluster never starts after its home slot */
+		if (!prev)
+			assert(FLATHASH_HOME(*head, slot->hashval) == i);
+		prev = slot;
+		count++;
+	}
+	assert(count == head->count);
+}
+#else
+#define flathash_consistency_check(x)
+#endif
+
+static void flathash_extend(struct tflathash_head *head)
+{
+	uint32_t newmax = head->tabmax + head->tabmax / 8 + 4;
+
+	head->entries = XREALLOC(MTYPE_TYPEDHASH_FLAT, head->entries,
+				 sizeof(head->entries[0]) * newmax);
+	memset(head->entries + head->tabmax, 0,
+	       sizeof(head->entries[0]) * (newmax - head->tabmax));
+	head->tabmax = newmax;
+}
+
+/* rebuild the table at a size fitting count items.  Walking the old table
+ * in order visits the items sorted by hash value, so each one goes either
+ * into its home slot or right after the previous one.
+ */
+static void flathash_resize(struct tflathash_head *head, uint32_t count)
+{
+	struct tflathash_slot *old = head->entries;
+	uint32_t oldmax = head->tabmax, i, pos = 0;
+	uint8_t newshift = FLATHASH_MINSHIFT;
+
+	if (!count) {
+		XFREE(MTYPE_TYPEDHASH_FLAT, head->entries);
+		head->tabmax = 0;
+		head->tabshift = 0;
+		head->first = 0;
+		return;
+	}
+
+	while (count > FLATHASH_MAXLOAD(newshift))
+		newshift++;
+	if (newshift == head->tabshift)
+		return;
+
+	head->tabshift = newshift;
+	head->tabmax = (1U << newshift) + FLATHASH_SPARE(newshift);
+	head->entries = XCALLOC(MTYPE_TYPEDHASH_FLAT,
+				sizeof(head->entries[0]) * head->tabmax);
+	head->first = head->tabmax;
+
+	for (i = 0; i < oldmax; i++) {
+		uint32_t home;
+
+		if (!old[i].fitem)
+			continue;
+
+		home = FLATHASH_HOME(*head, old[i].hashval);
+		if (pos < home)
+			pos = home;
+		if (pos == head->tabmax)
+			flathash_extend(head);
+		if (pos < head->first)
+			head->first = pos;
+		head->entries[pos++] = old[i];
+	}
+	XFREE(MTYPE_TYPEDHASH_FLAT, old);
+
+	flathash_consistency_check(head);
+}
+
+static uint32_t flathash_pos(const struct tflathash_head *head,
+			     const struct tflathash_item *item)
+{
+	uint32_t hval = item->hashval, pos;
+
+	if (!head->count)
+		return FLATHASH_NONE;
+
+	for (pos = FLATHASH_HOME(*head, hval); pos < head->tabmax; pos++) {
+		const struct tflathash_slot *slot = &head->entries[pos];
+
+		if (!slot->fitem || slot->hashval > hval)
+			break;
+		if (slot->fitem == item)
+			return pos;
+	}
+	return FLATHASH_NONE;
+}
+
+void typesafe_flathash_add(struct tflathash_head *head,
+			   struct tflathash_item *item)
+{
+	uint32_t hval = item->hashval, pos, end;
+
+	if (head->count >= (head->tabshift ? FLATHASH_MAXLOAD(head->tabshift)
+					   : 0))
+		flathash_resize(head, head->count + 1);
+
+	/* after any items with the same hash value */
+	pos = FLATHASH_HOME(*head, hval);
+	while (pos < head->tabmax && head->entries[pos].fitem
+	       && head->entries[pos].hashval <= hval)
+		pos++;
+
+	for (end = pos; end < head->tabmax; end++)
+		if (!head->entries[end].fitem)
+			break;
+	if (end == head->tabmax)
+		flathash_extend(head);
+
+	memmove(&head->entries[pos + 1], &head->entries[pos],
+		sizeof(head->entries[0]) * (end - pos));
+	head->entries[pos].hashval = hval;
+	head->entries[pos].fitem = item;
+	head->count++;
+	if (pos < head->first)
+		head->first = pos;
+
+	flathash_consistency_check(head);
+}
+
+static void flathash_del_pos(struct tflathash_head *head, uint32_t pos)
+{
+	uint32_t next;
+
+	/* pull back the following items as long as they aren't in their
+	 * home slot already;  this keeps the clusters gapless without any
+	 * tombstones
+	 */
+	for (next = pos + 1; next < head->tabmax; next++) {
+		const struct tflathash_slot *slot = &head->entries[next];
+
+		if (!slot->fitem || FLATHASH_HOME(*head, slot->hashval) == next)
+			break;
+	}
+	memmove(&head->entries[pos], &head->entries[pos + 1],
+		sizeof(head->entries[0]) * (next - pos - 1));
+	head->entries[next - 1].fitem = NULL;
+	head->count--;
+
+	/* no shrinking until empty;  deletes and pops tend to go in table
+	 * order, which would leave only high hash values and heap them all
+	 * into the end of a smaller table
+	 */
+	if (!head->count)
+		flathash_resize(head, 0);
+
+	flathash_consistency_check(head);
+}
+
+bool typesafe_flathash_del(struct tflathash_head *head,
+			   struct tflathash_item *item)
+{
+	uint32_t pos = flathash_pos(head, item);
+
+	if (pos == FLATHASH_NONE)
+		return false;
+	flathash_del_pos(head, pos);
+	return true;
+}
+
+struct tflathash_item *typesafe_flathash_pop(struct tflathash_head *head)
+{
+	struct tflathash_item *item;
+	uint32_t pos;
+
+	if (!head->count)
+		return NULL;
+
+	for (pos = head->first; !head->entries[pos].fitem; pos++)
+		;
+	head->first = pos;
+	item = head->entries[pos].fitem;
+	flathash_del_pos(head, pos);
+	return item;
+}
+
+bool typesafe_flathash_member(const struct tflathash_head *head,
+			      const struct tflathash_item *item)
+{
+	return flathash_pos(head, item) != FLATHASH_NONE;
+}
+
+static const struct tflathash_item *
+flathash_from(const struct tflathash_head *head, uint32_t pos)
+{
+	for (; pos < head->tabmax; pos++)
+		if (head->entries[pos].fitem)
+			return head->entries[pos].fitem;
+	return NULL;
+}
+
+const struct tflathash_item *
+typesafe_flathash_first(const struct tflathash_head *head)
+{
+	if (!head->count)
+		return NULL;
+	return flathash_from(head, head->first);
+}
+
+const struct tflathash_item *
+typesafe_flathash_next(const struct tflathash_head *head,
+		       const struct tflathash_item *item)
+{
+	uint32_t pos = flathash_pos(head, item);
+
+	if (pos == FLATHASH_NONE)
+		return NULL;
+	return flathash_from(head, pos + 1);
+}
+
+void typesafe_flathash_fini(struct tflathash_head *head)
+{
+	XFREE(MTYPE_TYPEDHASH_FLAT, head->entries);
+	memset(head, 0, sizeof(*head));
+}
+
 /* skiplist */
 
 static inline struct sskip_item *sl_level_get(const struct sskip_item *item,
@@ -609,3 +854,140 @@ void typesafe_heap_pullup(struct heap_head *head, uint32_t pos,
 
 	heap_consistency_check(head, cmpfn, 0);
 }
+
+/* radix heap */
+
+/* bucket 0 holds items with the last popped key, bucket n those whose key
+ * differs from it first in bit n-1.
+ */
+static inline uint32_t radixheap_bucket(const struct radixheap_head *head,
+					uint64_t key)
+{
+	if (key <= head->last)
+		return 0;
+	return 64 - __builtin_clzll(key ^ head->last);
+}
+
+static void radixheap_link(struct radixheap_head *head,
+			   struct radixheap_item *item, uint32_t bucket)
+{
+	struct radixheap_bucket *b = &head->buckets[bucket];
+
+	item->bucket = bucket;
+	item->next = NULL;
+	item->prev = b->last;
+	if (b->last)
+		b->last->next = item;
+	else
+		b->first = item;
+	b->last = item;
+
+	if (bucket)
+		head->used |= 1ULL << (bucket - 1);
+}
+
+void typesafe_radixheap_add(struct radixheap_head *head,
+			    struct radixheap_item *item, uint64_t key)
+{
+	item->key = key;
+	radixheap_link(head, item, radixheap_bucket(head, key));
+	head->count++;
+}
+
+void typesafe_radixheap_del(struct radixheap_head *head,
+			    struct radixheap_item *item)
+{
+	struct radixheap_bucket *b = &head->buckets[item->bucket];
+
+	assert(typesafe_radixheap_member(head, item));
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		b->first = item->next;
+	if (item->next)
+		item->next->prev = item->prev;
+	else
+		b->last = item->prev;
+
+	if (!b->first && item->bucket)
+		head->used &= ~(1ULL << (item->bucket - 1));
+
+	item->next = item->prev = NULL;
+	head->count--;
+}
+
+struct radixheap_item *typesafe_radixheap_pop(struct radixheap_head *head)
+{
+	struct radixheap_bucket *b = &head->buckets[0];
+	struct radixheap_item *item, *next;
+	uint32_t bucket;
+	uint64_t min;
+
+	if (!b->first) {
+		if (!head->used)
+			return NULL;
+
+		/* everything in the lowest used bucket goes into lower ones
+		 * once its minimum is the last key; order is kept for items
+		 * with the same key
+		 */
+		bucket = __builtin_ctzll(head->used) + 1;
+		item = head->buckets[bucket].first;
+		min = item->key;
+		for (; item; item = item->next)
+			if (item->key < min)
+				min = item->key;
+
+		item = head->buckets[bucket].first;
+		head->buckets[bucket].first = head->buckets[bucket].last = NULL;
+		head->used &= ~(1ULL << (bucket - 1));
+		head->last = min;
+
+		for (; item; item = next) {
+			next = item->next;
+			radixheap_link(head, item,
+				       radixheap_bucket(head, item->key));
+		}
+	}
+
+	item = b->first;
+	b->first = item->next;
+	if (b->first)
+		b->first->prev = NULL;
+	else
+		b->last = NULL;
+
+	item->next = item->prev = NULL;
+	head->count--;
+	return item;
+}
+
+const struct radixheap_item *
+typesafe_radixheap_next(const struct radixheap_head *head,
+			const struct radixheap_item *item)
+{
+	uint32_t bucket;
+
+	if (item) {
+		if (item->next)
+			return item->next;
+		bucket = item->bucket + 1;
+	} else
+		bucket = 0;
+
+	for (; bucket < RADIXHEAP_BUCKETS; bucket++)
+		if (head->buckets[bucket].first)
+			return head->buckets[bucket].first;
+	return NULL;
+}
+
+bool typesafe_radixheap_member(const struct radixheap_head *head,
+			       const struct radixheap_item *item)
+{
+	if (item->bucket >= RADIXHEAP_BUCKETS)
+		return false;
+	if (item->prev)
+		return item->prev->next == item;
+	return head->buckets[item->bucket].first == item;
+}
@@ -568,6 +568,15 @@ macro_inline type *prefix ## _pop(struct prefix##_head *h)                     \
 		typesafe_heap_resize(&h->hh, false);                           \
 	return container_of(hitem, type, field.hi);                            \
 }                                                                              \
+/* item's position needs to be fixed after its sort key changed */           \
+macro_inline void prefix ## _update(struct prefix##_head *h, type *item)       \
+{                                                                              \
+	uint32_t index = item->field.hi.index;                                 \
+	assert(h->hh.array[index] == &item->field.hi);                         \
+	typesafe_heap_pullup(&h->hh, index, &item->field.hi, prefix ## __cmp); \
+	typesafe_heap_pushdown(&h->hh, item->field.hi.index, &item->field.hi,  \
+			       prefix ## __cmp);                               \
+}                                                                              \
 TYPESAFE_SWAP_ALL_SIMPLE(prefix)                                               \
 macro_pure const type *prefix ## _const_first(const struct prefix##_head *h)   \
 {                                                                              \
@@ -614,6 +623,123 @@ extern void typesafe_heap_pullup(struct heap_head *head, uint32_t index,
 		int (*cmpfn)(const struct heap_item *a,
 			     const struct heap_item *b));
 
+/* radix heap, monotone priority queue with unsigned 64-bit integer keys.
+ *
+ * "monotone" means the key of an item added (or updated) must not be lower
+ * than the key of the item popped last; that is the case for Dijkstra's
+ * algorithm with non-negative link costs.  Items with lower keys are
+ * treated as if they had the last popped key.  Items with the same key
+ * are popped in the order they were added.
+ *
+ * add/del/update are O(1), pop is O(log maxkey) amortized.  Iteration is
+ * not in key order.
+ */
+#define RADIXHEAP_BUCKETS 65
+
+struct radixheap_item {
+	struct radixheap_item *next, *prev;
+	uint64_t key;
+	uint32_t bucket;
+};
+
+struct radixheap_bucket {
+	struct radixheap_item *first, *last;
+};
+
+struct radixheap_head {
+	struct radixheap_bucket buckets[RADIXHEAP_BUCKETS];
+	/* bit n-1 set if bucket n (n >= 1) is not empty */
+	uint64_t used;
+	/* key of the item popped last */
+	uint64_t last;
+	size_t count;
+};
+
+#define PREDECL_RADIXHEAP(prefix)                                              \
+struct prefix ## _head { struct radixheap_head rh; };                          \
+struct prefix ## _item { struct radixheap_item ri; };                          \
+MACRO_REQUIRE_SEMICOLON() /* end */
+
+#define INIT_RADIXHEAP(var)	{ }
+
+#define DECLARE_RADIXHEAP(prefix, type, field, keyfn)                          \
+                                                                               \
+macro_inline void prefix ## _init(struct prefix##_head *h)                     \
+{                                                                              \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline void prefix ## _fini(struct prefix##_head *h)                     \
+{                                                                              \
+	assert(h->rh.count == 0);                                              \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline type *prefix ## _add(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	typesafe_radixheap_add(&h->rh, &item->field.ri, keyfn(item));          \
+	return NULL;                                                           \
+}                                                                              \
+macro_inline type *prefix ## _del(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	typesafe_radixheap_del(&h->rh, &item->field.ri);                       \
+	return item;                                                           \
+}                                                                              \
+macro_inline type *prefix ## _pop(struct prefix##_head *h)                     \
+{                                                                              \
+	struct radixheap_item *ritem = typesafe_radixheap_pop(&h->rh);         \
+	if (!ritem)                                                            \
+		return NULL;                                                   \
+	return container_of(ritem, type, field.ri);                            \
+}                                                                              \
+/* item's key changed */                                                       \
+macro_inline void prefix ## _update(struct prefix##_head *h, type *item)       \
+{                                                                              \
+	typesafe_radixheap_del(&h->rh, &item->field.ri);                       \
+	typesafe_radixheap_add(&h->rh, &item->field.ri, keyfn(item));          \
+}                                                                              \
+TYPESAFE_SWAP_ALL_SIMPLE(prefix)                                               \
+macro_pure const type *prefix ## _const_first(const struct prefix##_head *h)   \
+{                                                                              \
+	const struct radixheap_item *ritem;                                    \
+	ritem = typesafe_radixheap_next(&h->rh, NULL);                         \
+	return container_of_null(ritem, type, field.ri);                       \
+}                                                                              \
+macro_pure const type *prefix ## _const_next(const struct prefix##_head *h,    \
+					     const type *item)                 \
+{                                                                              \
+	const struct radixheap_item *ritem;                                    \
+	ritem = typesafe_radixheap_next(&h->rh, &item->field.ri);              \
+	return container_of_null(ritem, type, field.ri);                       \
+}                                                                              \
+TYPESAFE_FIRST_NEXT(prefix, type)                                              \
+macro_pure type *prefix ## _next_safe(struct prefix##_head *h, type *item)     \
+{                                                                              \
+	if (!item)                                                             \
+		return NULL;                                                   \
+	return prefix ## _next(h, item);                                       \
+}                                                                              \
+macro_pure size_t prefix ## _count(const struct prefix##_head *h)              \
+{                                                                              \
+	return h->rh.count;                                                    \
+}                                                                              \
+macro_pure bool prefix ## _member(const struct prefix##_head *h,               \
+				  const type *item)                            \
+{                                                                              \
+	return typesafe_radixheap_member(&h->rh, &item->field.ri);             \
+}                                                                              \
+MACRO_REQUIRE_SEMICOLON() /* end */
+
+extern void typesafe_radixheap_add(struct radixheap_head *head,
+				   struct radixheap_item *item, uint64_t key);
+extern void typesafe_radixheap_del(struct radixheap_head *head,
+				   struct radixheap_item *item);
+extern struct radixheap_item *
+typesafe_radixheap_pop(struct radixheap_head *head);
+extern const struct radixheap_item *
+typesafe_radixheap_next(const struct radixheap_head *head,
+			const struct radixheap_item *item);
+extern bool typesafe_radixheap_member(const struct radixheap_head *head,
+				      const struct radixheap_item *item);
+
 /* single-linked list, sorted.
  * can be used as priority queue with add / pop
  */
@@ -956,6 +1082,153 @@ macro_pure bool prefix ## _member(const struct prefix##_head *h,               \
 }                                                                              \
 MACRO_REQUIRE_SEMICOLON() /* end */
 
+/* open addressing hash, also "sorted" by hash value
+ *
+ * The table is an array of (hash value, item pointer) slots with linear
+ * probing in Robin Hood order, i.e. the occupied slots are sorted by hash
+ * value.  Lookups compare the hash values stored in the slots and only
+ * touch items whose hash matches, so a miss usually costs a single cache
+ * line.  Items never wrap around the end of the table;  there are a few
+ * spare slots after the end instead, and more are added as needed.
+ */
+
+/* don't use these structs directly */
+struct tflathash_item {
+	uint32_t hashval;
+};
+
+struct tflathash_slot {
+	uint32_t hashval;
+	struct tflathash_item *fitem;
+};
+
+struct tflathash_head {
+	struct tflathash_slot *entries;
+	uint32_t count;
+	/* number of slots in entries, 1 << tabshift plus spare */
+	uint32_t tabmax;
+	/* no items before this slot, makes _pop() and _first() cheap */
+	uint32_t first;
+
+	uint8_t tabshift;
+};
+
+#define FLATHASH_HOME(head, val) \
+	((val) >> (32 - (head).tabshift))
+
+extern void typesafe_flathash_add(struct tflathash_head *head,
+				  struct tflathash_item *item);
+extern bool typesafe_flathash_del(struct tflathash_head *head,
+				  struct tflathash_item *item);
+extern struct tflathash_item *typesafe_flathash_pop(
+		struct tflathash_head *head);
+extern bool typesafe_flathash_member(const struct tflathash_head *head,
+				     const struct tflathash_item *item);
+extern const struct tflathash_item *typesafe_flathash_first(
+		const struct tflathash_head *head);
+extern const struct tflathash_item *typesafe_flathash_next(
+		const struct tflathash_head *head,
+		const struct tflathash_item *item);
+extern void typesafe_flathash_fini(struct tflathash_head *head);
+
+/* use as:
+ *
+ * PREDECL_FLATHASH(namelist)
+ * struct name {
+ *   struct namelist_item nlitem;
+ * }
+ * DECLARE_FLATHASH(namelist, struct name, nlitem, cmpfunc, hashfunc)
+ */
+#define PREDECL_FLATHASH(prefix)                                               \
+struct prefix ## _head { struct tflathash_head fh; };                          \
+struct prefix ## _item { struct tflathash_item fi; };                          \
+MACRO_REQUIRE_SEMICOLON() /* end */
+
+#define INIT_FLATHASH(var)	{ }
+
+#define DECLARE_FLATHASH(prefix, type, field, cmpfn, hashfn)                   \
+                                                                               \
+macro_inline void prefix ## _init(struct prefix##_head *h)                     \
+{                                                                              \
+	memset(h, 0, sizeof(*h));                                              \
+}                                                                              \
+macro_inline void prefix ## _fini(struct prefix##_head *h)                     \
+{                                                                              \
+	assert(h->fh.count == 0);                                              \
+	typesafe_flathash_fini(&h->fh);                                        \
+}                                                                              \
+macro_inline const type *_ ## prefix ## _find_hval(                            \
+		const struct prefix##_head *h, const type *item, uint32_t hval)\
+{                                                                              \
+	if (!h->fh.count)                                                      \
+		return NULL;                                                   \
+	const struct tflathash_slot *slot, *end;                               \
+	end = h->fh.entries + h->fh.tabmax;                                    \
+	slot = h->fh.entries + FLATHASH_HOME(h->fh, hval);                     \
+	for (; slot < end && slot->fitem && slot->hashval <= hval; slot++)     \
+		if (slot->hashval == hval                                      \
+		    && !cmpfn(container_of(slot->fitem, type, field.fi), item)) \
+			return container_of(slot->fitem, type, field.fi);      \
+	return NULL;                                                           \
+}                                                                              \
+macro_inline type *prefix ## _add(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	uint32_t hval = hashfn(item);                                          \
+	const type *prev = _ ## prefix ## _find_hval(h, item, hval);           \
+	if (prev)                                                              \
+		return (type *)prev;                                           \
+	item->field.fi.hashval = hval;                                         \
+	typesafe_flathash_add(&h->fh, &item->field.fi);                        \
+	return NULL;                                                           \
+}                                                                              \
+macro_inline const type *prefix ## _const_find(const struct prefix##_head *h,  \
+					       const type *item)               \
+{                                                                              \
+	return _ ## prefix ## _find_hval(h, item, hashfn(item));               \
+}                                                                              \
+TYPESAFE_FIND(prefix, type)                                                    \
+macro_inline type *prefix ## _del(struct prefix##_head *h, type *item)         \
+{                                                                              \
+	if (!typesafe_flathash_del(&h->fh, &item->field.fi))                   \
+		return NULL;                                                   \
+	return item;                                                           \
+}                                                                              \
+macro_inline type *prefix ## _pop(struct prefix##_head *h)                     \
+{                                                                              \
+	return container_of_null(typesafe_flathash_pop(&h->fh), type,          \
+				 field.fi);                                    \
+}                                                                              \
+TYPESAFE_SWAP_ALL_SIMPLE(prefix)                                               \
+macro_pure const type *prefix ## _const_first(const struct prefix##_head *h)   \
+{                                                                              \
+	return container_of_null(typesafe_flathash_first(&h->fh), type,        \
+				 field.fi);                                    \
+}                                                                              \
+macro_pure const type *prefix ## _const_next(const struct prefix##_head *h,    \
+                                             const type *item)                 \
+{                                                                              \
+	return container_of_null(typesafe_flathash_next(&h->fh,                \
+							&item->field.fi),      \
+				 type, field.fi);                              \
+}                                                                              \
+TYPESAFE_FIRST_NEXT(prefix, type)                                              \
+macro_pure type *prefix ## _next_safe(struct prefix##_head *h, type *item)     \
+{                                                                              \
+	if (!item)                                                             \
+		return NULL;                                                   \
+	return prefix ## _next(h, item);                                       \
+}                                                                              \
+macro_pure size_t prefix ## _count(const struct prefix##_head *h)              \
+{                                                                              \
+	return h->fh.count;                                                    \
+}                                                                              \
+macro_pure bool prefix ## _member(const struct prefix##_head *h,               \
+				  const type *item)                            \
+{                                                                              \
+	return typesafe_flathash_member(&h->fh, &item->field.fi);              \
+}                                                                              \
+MACRO_REQUIRE_SEMICOLON() /* end */
+
 /* skiplist, sorted.
  * can be used as priority queue with add / pop
  */
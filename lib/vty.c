@@ -70,6 +70,7 @@ enum vty_event {
 	VTY_READ,
 	VTY_WRITE,
 	VTY_TIMEOUT_RESET,
+	VTY_RESUME,
 #ifdef VTYSH
 	VTYSH_SERV,
 	VTYSH_READ,
@@ -296,6 +297,134 @@ int vty_json(struct vty *vty, struct json_object *json)
 	return CMD_SUCCESS;
 }
 
+/* bytes written to a JSON stream between drains of the vty output */
+#define VTY_JSON_STREAM_CHUNK (1024 * 1024)
+/* give up waiting for a client that doesn't read, and keep buffering */
+#define VTY_JSON_STREAM_WAIT_MS 5000
+
+/*
+ * Write out what's queued for the vty.  Only for clients reading without
+ * a pager, i.e. vtysh and terminals with "terminal length 0".
+ */
+static void vty_json_stream_drain(struct vty_json_stream *js)
+{
+	struct vty *vty = js->vty;
+	struct pollfd pfd = {};
+
+	js->unflushed = 0;
+
+	if (vty->type != VTY_SHELL_SERV
+	    && (vty->type != VTY_TERM || vty->lines != 0))
+		return;
+	if (vty->wfd < 0)
+		return;
+
+	pfd.fd = vty->wfd;
+	pfd.events = POLLOUT;
+	while (buffer_flush_available(vty->obuf, vty->wfd) == BUFFER_PENDING)
+		if (poll(&pfd, 1, VTY_JSON_STREAM_WAIT_MS) <= 0)
+			break;
+}
+
+static void vty_json_stream_put(struct vty_json_stream *js, const char *str)
+{
+	js->unflushed += vty_out(js->vty, "%s", str);
+}
+
+static void vty_json_stream_key(struct vty_json_stream *js, const char *key)
+{
+	uint32_t bit = 1U << js->depth;
+	char buf[256], *pos = buf;
+	const char *k;
+
+	vty_json_stream_put(js, CHECK_FLAG(js->members, bit) ? ",\n" : "\n");
+	SET_FLAG(js->members, bit);
+
+	if (!key)
+		return;
+
+	*pos++ = '"';
+	for (k = key; *k; k++) {
+		/* worst case \u00XX plus the closing quote and colon */
+		if (pos + 10 >= buf + sizeof(buf)) {
+			*pos = '\0';
+			vty_json_stream_put(js, buf);
+			pos = buf;
+		}
+		if (*k == '"' || *k == '\\') {
+			*pos++ = '\\';
+			*pos++ = *k;
+		} else if ((unsigned char)*k < 0x20)
+			pos += snprintf(pos, buf + sizeof(buf) - pos,
+					"\\u%04x", (unsigned char)*k);
+		else
+			*pos++ = *k;
+	}
+	*pos++ = '"';
+	*pos++ = ':';
+	*pos++ = ' ';
+	*pos = '\0';
+	vty_json_stream_put(js, buf);
+}
+
+void vty_json_stream_init(struct vty_json_stream *js, struct vty *vty)
+{
+	memset(js, 0, sizeof(*js));
+	js->vty = vty;
+}
+
+void vty_json_stream_open(struct vty_json_stream *js, const char *key,
+			  bool array)
+{
+	assert(js->depth + 1 < VTY_JSON_STREAM_DEPTH);
+
+	if (js->depth || key || CHECK_FLAG(js->members, 1))
+		vty_json_stream_key(js, key);
+	else
+		SET_FLAG(js->members, 1);
+	vty_json_stream_put(js, array ? "[" : "{");
+
+	js->depth++;
+	UNSET_FLAG(js->members, 1U << js->depth);
+	if (array)
+		SET_FLAG(js->arrays, 1U << js->depth);
+	else
+		UNSET_FLAG(js->arrays, 1U << js->depth);
+}
+
+void vty_json_stream_close(struct vty_json_stream *js)
+{
+	uint32_t bit = 1U << js->depth;
+
+	assert(js->depth);
+
+	if (CHECK_FLAG(js->members, bit))
+		vty_json_stream_put(js, "\n");
+	vty_json_stream_put(js, CHECK_FLAG(js->arrays, bit) ? "]" : "}");
+	js->depth--;
+}
+
+void vty_json_stream_add(struct vty_json_stream *js, const char *key,
+			 struct json_object *val)
+{
+	vty_json_stream_key(js, key);
+	vty_json_stream_put(js, json_object_to_json_string_ext(
+					val, JSON_C_TO_STRING_PRETTY
+						     | JSON_C_TO_STRING_NOSLASHESCAPE));
+	json_object_free(val);
+
+	if (js->unflushed >= VTY_JSON_STREAM_CHUNK)
+		vty_json_stream_drain(js);
+}
+
+void vty_json_stream_end(struct vty_json_stream *js)
+{
+	while (js->depth)
+		vty_json_stream_close(js);
+	vty_json_stream_put(js, "\n");
+	vty_json_stream_drain(js);
+}
+
 /* Output current time to the vty. */
 void vty_time_print(struct vty *vty, int cr)
 {
@@ -1252,7 +1381,7 @@ static int vty_execute(struct vty *vty)
 	vty->cp = vty->length = 0;
 	vty_clear_buf(vty);
 
-	if (vty->status != VTY_CLOSE)
+	if (vty->status != VTY_CLOSE && !vty->resume_fn)
 		vty_prompt(vty);
 
 	return ret;
@@ -1496,7 +1625,9 @@ static void vty_read(struct thread *thread)
 		vty_close(vty);
 	else {
 		vty_event(VTY_WRITE, vty);
-		vty_event(VTY_READ, vty);
+		/* input waits for a paused command to finish */
+		if (!vty->resume_fn)
+			vty_event(VTY_READ, vty);
 	}
 }
 
@@ -1535,6 +1666,8 @@ static void vty_flush(struct thread *thread)
 	case BUFFER_EMPTY:
 		if (vty->status == VTY_CLOSE)
 			vty_close(vty);
+		else if (vty->resume_fn)
+			vty_event(VTY_RESUME, vty);
 		else {
 			vty->status = VTY_NORMAL;
 			if (vty->lines == 0)
@@ -2081,6 +2214,8 @@ static int vtysh_flush(struct vty *vty)
 		vty_close(vty);
 		return -1;
 	case BUFFER_EMPTY:
+		if (vty->resume_fn)
+			vty_event(VTY_RESUME, vty);
 		break;
 	}
 	return 0;
@@ -2171,6 +2306,15 @@ static void vtysh_read(struct thread *thread)
 					return;
 				}
 
+				/* paused show command, the result is sent
+				 * and input read again when it's done
+				 */
+				if (ret == CMD_SUSPEND && vty->resume_fn) {
+					if (!vty->t_write)
+						vtysh_flush(vty);
+					return;
+				}
+
 				/* hack for asynchronous "write integrated"
 				 * - other commands in "buf" will be ditched
 				 * - input during pending config-write is
@@ -2206,6 +2350,73 @@ static void vtysh_write(struct thread *thread)
 
 #endif /* VTYSH */
 
+static void vty_show_resume_stop(struct vty *vty)
+{
+	THREAD_OFF(vty->t_resume);
+	if (vty->resume_free)
+		vty->resume_free(vty->resume_arg);
+	vty->resume_fn = NULL;
+	vty->resume_free = NULL;
+	vty->resume_arg = NULL;
+}
+
+int vty_show_resume(struct vty *vty, int (*fn)(struct vty *vty, void *arg),
+		    void *arg, void (*free_fn)(void *arg))
+{
+	int ret;
+
+	assert(!vty->resume_fn);
+
+	if (vty->filter
+	    || (vty->type != VTY_SHELL_SERV
+		&& (vty->type != VTY_TERM || vty->lines != 0))) {
+		while ((ret = fn(vty, arg)) == CMD_SUSPEND)
+			;
+		if (free_fn)
+			free_fn(arg);
+		return ret;
+	}
+
+	vty->resume_fn = fn;
+	vty->resume_free = free_fn;
+	vty->resume_arg = arg;
+	return CMD_SUSPEND;
+}
+
+/* The previous batch has been written out, on to the next */
+static void vty_show_resume_run(struct thread *thread)
+{
+	struct vty *vty = THREAD_ARG(thread);
+	int ret;
+
+	ret = vty->resume_fn(vty, vty->resume_arg);
+	if (ret != CMD_SUSPEND)
+		vty_show_resume_stop(vty);
+
+	switch (vty->type) {
+#ifdef VTYSH
+	case VTY_SHELL_SERV:
+		if (ret != CMD_SUSPEND) {
+			uint8_t header[4] = {0, 0, 0, ret};
+
+			buffer_put(vty->obuf, header, 4);
+		}
+		if (!vty->t_write && vtysh_flush(vty) < 0)
+			return;
+		if (ret != CMD_SUSPEND)
+			vty_event(VTYSH_READ, vty);
+		break;
+#endif /* VTYSH */
+	default:
+		if (ret != CMD_SUSPEND) {
+			vty_prompt(vty);
+			vty_event(VTY_READ, vty);
+		}
+		vty_event(VTY_WRITE, vty);
+		break;
+	}
+}
+
 /* Determine address family to bind. */
 void vty_serv_sock(const char *addr, unsigned short port, const char *path)
 {
@@ -2241,6 +2452,7 @@ void vty_close(struct vty *vty)
 	THREAD_OFF(vty->t_read);
 	THREAD_OFF(vty->t_write);
 	THREAD_OFF(vty->t_timeout);
+	vty_show_resume_stop(vty);
 
 	if (vty->pass_fd != -1) {
 		close(vty->pass_fd);
@@ -2343,8 +2555,13 @@ static void vty_read_file(struct nb_config *config, FILE *confp)
 		vty->candidate_config = nb_config_new(NULL);
 	}
 
-	/* Execute configuration file */
+	/*
+	 * Execute configuration file, as one transaction rather than one per
+	 * line.
+	 */
+	nb_cli_bulk_begin(vty);
 	ret = config_from_file(vty, confp, &line_num);
+	(void)nb_cli_bulk_end(vty);
 
 	/* Flush any previous errors before printing messages below */
 	buffer_flush_all(vty->obuf, vty->wfd);
@@ -2735,6 +2952,10 @@ static void vty_event(enum vty_event event, struct vty *vty)
 			thread_add_timer(vty_master, vty_timeout, vty,
 					 vty->v_timeout, &vty->t_timeout);
 		break;
+	case VTY_RESUME:
+		thread_add_event(vty_master, vty_show_resume_run, vty, 0,
+				 &vty->t_resume);
+		break;
 	default:
 		assert(!"vty_event() called incorrectly");
 	}
@@ -210,6 +210,12 @@ struct vty {
 	unsigned long v_timeout;
 	struct thread *t_timeout;
 
+	/* Paused show command, see vty_show_resume(). */
+	int (*resume_fn)(struct vty *vty, void *arg);
+	void (*resume_free)(void *arg);
+	void *resume_arg;
+	struct thread *t_resume;
+
 	/* What address is this vty comming from. */
 	char address[SU_ADDRSTRLEN];
 
@@ -351,6 +357,54 @@ extern bool vty_set_include(struct vty *vty, const char *regexp);
  */
 extern int vty_json(struct vty *vty, struct json_object *json);
 
+/*
+ * Streaming JSON output, for tables too big to be built as one json-c tree.
+ * Containers are opened and closed on the stream; members are written out
+ * as soon as they are added, and the vty is drained to the client every
+ * VTY_JSON_STREAM_CHUNK bytes, waiting for it to read if needed.  Memory
+ * use then only depends on the largest member, not on the whole output.
+ *
+ * Level 0 is whatever the caller is in: nothing, or a container it wrote
+ * itself.  Keys are NULL for array elements and at the top level.
+ */
+#define VTY_JSON_STREAM_DEPTH 16
+
+struct vty_json_stream {
+	struct vty *vty;
+	size_t unflushed;
+
+	uint8_t depth;
+	/* bit n: level n has members / is an array */
+	uint32_t members;
+	uint32_t arrays;
+};
+
+extern void vty_json_stream_init(struct vty_json_stream *js, struct vty *vty);
+extern void vty_json_stream_open(struct vty_json_stream *js, const char *key,
+				 bool array);
+extern void vty_json_stream_close(struct vty_json_stream *js);
+/* writes val and frees it */
+extern void vty_json_stream_add(struct vty_json_stream *js, const char *key,
+				struct json_object *val);
+/* closes everything still open, ends the line */
+extern void vty_json_stream_end(struct vty_json_stream *js);
+
+/*
+ * For show commands with a lot of output.  Instead of printing everything
+ * at once, the command prints a batch and returns vty_show_resume(); fn is
+ * called for the next batch once the client has read the previous one, so
+ * the daemon keeps running its other events in between.  fn returns
+ * CMD_SUSPEND while there is more to come and the command's result when
+ * it's done.  arg is freed with free_fn when fn is done, or when the vty
+ * is closed before that.
+ *
+ * Where output can't be resumed (config files, pagers, "| include"), fn is
+ * called right away until it's done.
+ */
+extern int vty_show_resume(struct vty *vty,
+			   int (*fn)(struct vty *vty, void *arg), void *arg,
+			   void (*free_fn)(void *arg));
+
 /* post fd to be passed to the vtysh client
  * fd is owned by the VTY code after this and will be closed when done
  */
@@ -41,6 +41,15 @@ static struct list *work_queues = &_work_queues;
 
 #define WORK_QUEUE_MIN_GRANULARITY 1
 
+/* adaptive mode: with nothing else waiting on the thread_master, a run may
+ * take this many times spec.yield; otherwise spec.yield is split between
+ * the queue and the waiting tasks, but never below WQ_ADAPTIVE_MIN_BUDGET.
+ */
+#define WQ_ADAPTIVE_IDLE_FACTOR 2
+#define WQ_ADAPTIVE_MIN_BUDGET 1000 /* us */
+/* time is checked (and the budget re-evaluated) this often per budget */
+#define WQ_ADAPTIVE_CHECKS 4
+
 static struct work_queue_item *work_queue_item_new(struct work_queue *wq)
 {
 	struct work_queue_item *item;
@@ -174,6 +183,43 @@ static void work_queue_item_requeue(struct work_queue *wq,
 	work_queue_item_enqueue(wq, item);
 }
 
+static unsigned long work_queue_budget(struct work_queue *wq)
+{
+	unsigned int pending = thread_master_pending(wq->master);
+
+	if (!pending)
+		return wq->spec.yield * WQ_ADAPTIVE_IDLE_FACTOR;
+
+	return MIN(wq->spec.yield,
+		   MAX(wq->spec.yield / (1 + pending), WQ_ADAPTIVE_MIN_BUDGET));
+}
+
+/* number of items that should fit into 'budget' us, given the per-item
+ * cost (in ns) so far
+ */
+static unsigned int work_queue_batch(uint64_t item_nsec, unsigned long budget)
+{
+	uint64_t n;
+
+	if (!item_nsec)
+		return WORK_QUEUE_MIN_GRANULARITY;
+
+	n = (uint64_t)budget * 1000 / WQ_ADAPTIVE_CHECKS / item_nsec;
+	return MAX(MIN(n, UINT_MAX), WORK_QUEUE_MIN_GRANULARITY);
+}
+
+static void work_queue_runtime_add(struct work_queue *wq, int64_t usec)
+{
+	unsigned long msec = usec / 1000;
+	unsigned int bucket = 0;
+
+	while (msec && bucket < WQ_RUNTIME_BUCKETS - 1) {
+		msec >>= 1;
+		bucket++;
+	}
+	wq->runtime[bucket]++;
+}
+
 DEFUN (show_work_queues,
        show_work_queues_cmd,
        "show work-queues",
@@ -200,6 +246,26 @@ DEFUN (show_work_queues,
 			wq->name);
 	}
 
+	vty_out(vty, "\n%-16s %7s %9s  %s\n", "", "Budget", "Cost",
+		"Run time histogram (ms)");
+	vty_out(vty, "%-16s %7s %9s %6s %6s %6s %6s %6s %6s %6s %6s %6s %6s\n",
+		"Name", "(us)", "(ns/item)", "<1", "<2", "<4", "<8", "<16",
+		"<32", "<64", "<128", "<256", ">=256");
+
+	for (ALL_LIST_ELEMENTS_RO(work_queues, node, wq)) {
+		unsigned int i;
+
+		if (wq->spec.adaptive)
+			vty_out(vty, "%-16s %7lu %9" PRIu64, wq->name,
+				wq->adaptive.budget, wq->adaptive.item_nsec);
+		else
+			vty_out(vty, "%-16s %7s %9s", wq->name, "-", "-");
+
+		for (i = 0; i < WQ_RUNTIME_BUCKETS; i++)
+			vty_out(vty, " %6lu", wq->runtime[i]);
+		vty_out(vty, "\n");
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -239,12 +305,22 @@ void work_queue_run(struct thread *thread)
 	struct work_queue_item *item, *titem;
 	wq_item_status ret = WQ_SUCCESS;
 	unsigned int cycles = 0;
+	unsigned int next_check = 0;
 	char yielded = 0;
+	struct timeval start;
+	int64_t elapsed;
 
 	wq = THREAD_ARG(thread);
 
 	assert(wq);
 
+	monotime(&start);
+	if (wq->spec.adaptive) {
+		wq->adaptive.budget = work_queue_budget(wq);
+		next_check = work_queue_batch(wq->adaptive.item_nsec,
+					      wq->adaptive.budget);
+	}
+
 	/* calculate cycle granularity:
 	 * list iteration == 1 run
 	 * listnode processing == 1 cycle
@@ -333,14 +409,50 @@ void work_queue_run(struct thread *thread)
 		cycles++;
 
 		/* test if we should yield */
-		if (!(cycles % wq->cycles.granularity)
-		    && thread_should_yield(thread)) {
+		if (wq->spec.adaptive) {
+			uint64_t item_nsec;
+
+			if (cycles < next_check)
+				continue;
+
+			/* other tasks may have become ready in the meantime,
+			 * which shrinks the budget
+			 */
+			elapsed = monotime_since(&start, NULL);
+			wq->adaptive.budget = work_queue_budget(wq);
+			if (elapsed >= (int64_t)wq->adaptive.budget) {
+				yielded = 1;
+				goto stats;
+			}
+
+			item_nsec = wq->adaptive.item_nsec;
+			if (!item_nsec)
+				item_nsec = MAX(elapsed * 1000 / cycles, 1);
+			next_check = cycles
+				     + work_queue_batch(item_nsec,
+							wq->adaptive.budget
+								- elapsed);
+		} else if (!(cycles % wq->cycles.granularity)
+			   && thread_should_yield(thread)) {
 			yielded = 1;
 			goto stats;
 		}
 	}
 
 stats:
+	elapsed = monotime_since(&start, NULL);
+	work_queue_runtime_add(wq, elapsed);
+
+	if (wq->spec.adaptive && cycles) {
+		uint64_t sample = MAX(elapsed * 1000 / cycles, 1);
+
+		/* EWMA, 1/8 weight for the new sample */
+		if (wq->adaptive.item_nsec)
+			wq->adaptive.item_nsec =
+				(wq->adaptive.item_nsec * 7 + sample) / 8;
+		else
+			wq->adaptive.item_nsec = sample;
+	}
 
 #define WQ_HYSTERESIS_FACTOR 4
 
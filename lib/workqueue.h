@@ -100,6 +100,12 @@ struct work_queue {
 			yield; /* yield time in us for associated thread */
 
 		uint32_t retry; /* Optional retry timeout if queue is blocked */
+
+		/* size batches from the measured per-item cost and the
+		 * number of tasks waiting on the thread_master, rather than
+		 * running for a fixed 'yield' time slot
+		 */
+		bool adaptive;
 	} spec;
 
 	/* remaining fields should be opaque to users */
@@ -115,6 +121,15 @@ struct work_queue {
 		unsigned long total;
 	} cycles; /* cycle counts */
 
+	struct {
+		uint64_t item_nsec; /* moving average of per-item cost */
+		unsigned long budget; /* last run's time budget, in us */
+	} adaptive;
+
+	/* histogram of run times: <1ms, <2ms, <4ms, ... >=256ms */
+#define WQ_RUNTIME_BUCKETS 10
+	unsigned long runtime[WQ_RUNTIME_BUCKETS];
+
 	/* private state */
 	uint16_t flags; /* user set flag */
 };
@@ -42,6 +42,7 @@
 #include "srte.h"
 #include "printfrr.h"
 #include "srv6.h"
+#include "libfrr_trace.h"
 
 DEFINE_MTYPE_STATIC(LIB, ZCLIENT, "Zclient");
 DEFINE_MTYPE_STATIC(LIB, REDIST_INST, "Redistribution instance IDs");
@@ -100,6 +101,8 @@ void zclient_free(struct zclient *zclient)
 		stream_free(zclient->ibuf);
 	if (zclient->obuf)
 		stream_free(zclient->obuf);
+	if (zclient->batch)
+		stream_free(zclient->batch);
 	if (zclient->wb)
 		buffer_free(zclient->wb);
 
@@ -181,6 +184,7 @@ void zclient_stop(struct zclient *zclient)
 	/* Reset streams. */
 	stream_reset(zclient->ibuf);
 	stream_reset(zclient->obuf);
+	zclient->batch_count = 0;
 
 	/* Empty the write buffer. */
 	buffer_reset(zclient->wb);
@@ -290,19 +294,19 @@ static void zclient_flush_data(struct thread *thread)
 	}
 }
 
-/*
- * Returns:
- * ZCLIENT_SEND_FAILED   - is a failure
- * ZCLIENT_SEND_SUCCESS  - means we sent data to zebra
- * ZCLIENT_SEND_BUFFERED - means we are buffering
- */
-enum zclient_send_status zclient_send_message(struct zclient *zclient)
+static enum zclient_send_status zclient_send_stream(struct zclient *zclient,
+						    struct stream *s)
 {
 	if (zclient->sock < 0)
 		return ZCLIENT_SEND_FAILURE;
-	switch (buffer_write(zclient->wb, zclient->sock,
-			     STREAM_DATA(zclient->obuf),
-			     stream_get_endp(zclient->obuf))) {
+
+	/* a route batch shows up as its first message's command */
+	frrtrace(3, frr_libfrr, zapi_send, zclient->sock,
+		 stream_getw_from(s, ZEBRA_HEADER_SIZE - 2),
+		 stream_get_endp(s));
+
+	switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+			     stream_get_endp(s))) {
 	case BUFFER_ERROR:
 		flog_err(EC_LIB_ZAPI_SOCKET,
 			 "%s: buffer_write failed to zclient fd %d, closing",
@@ -321,6 +325,37 @@ enum zclient_send_status zclient_send_message(struct zclient *zclient)
 	return ZCLIENT_SEND_SUCCESS;
 }
 
+static enum zclient_send_status
+zclient_route_batch_flush(struct zclient *zclient)
+{
+	struct stream *s = zclient->batch;
+
+	if (!zclient->batch_count)
+		return ZCLIENT_SEND_SUCCESS;
+
+	stream_putw_at(s, 0, stream_get_endp(s));
+	stream_putw_at(s, ZEBRA_HEADER_SIZE, zclient->batch_count);
+	zclient->batch_count = 0;
+
+	return zclient_send_stream(zclient, s);
+}
+
+/*
+ * Returns:
+ * ZCLIENT_SEND_FAILED   - is a failure
+ * ZCLIENT_SEND_SUCCESS  - means we sent data to zebra
+ * ZCLIENT_SEND_BUFFERED - means we are buffering
+ */
+enum zclient_send_status zclient_send_message(struct zclient *zclient)
+{
+	/* Routes batched up so far go ahead of whatever is sent now */
+	if (zclient->batch_count
+	    && zclient_route_batch_flush(zclient) == ZCLIENT_SEND_FAILURE)
+		return ZCLIENT_SEND_FAILURE;
+
+	return zclient_send_stream(zclient, zclient->obuf);
+}
+
 /*
  * If we add more data to this structure please ensure that
  * struct zmsghdr in lib/zclient.h is updated as appropriate.
@@ -806,6 +841,48 @@ enum zclient_send_status zclient_send_rnh(struct zclient *zclient, int command,
 	return zclient_send_message(zclient);
 }
 
+/*
+ * Moves the route just encoded into obuf over to the batch.  A batch
+ * carries routes for one VRF only; it is sent when a route for another
+ * VRF comes along or when it is full.
+ */
+static enum zclient_send_status
+zclient_route_batch_add(struct zclient *zclient, uint8_t cmd, vrf_id_t vrf_id)
+{
+	struct stream *s = zclient->batch;
+	size_t len = stream_get_endp(zclient->obuf) - ZEBRA_HEADER_SIZE;
+
+	if (zclient->sock < 0)
+		return ZCLIENT_SEND_FAILURE;
+
+	/* Too big to ever fit, send it on its own */
+	if (ZEBRA_HEADER_SIZE + 2 + 3 + len > STREAM_SIZE(s))
+		return zclient_send_message(zclient);
+
+	if (zclient->batch_count
+	    && (vrf_id != zclient->batch_vrf_id
+		|| zclient->batch_count == UINT16_MAX
+		|| STREAM_WRITEABLE(s) < 3 + len)) {
+		if (zclient_route_batch_flush(zclient) == ZCLIENT_SEND_FAILURE)
+			return ZCLIENT_SEND_FAILURE;
+	}
+
+	if (!zclient->batch_count) {
+		stream_reset(s);
+		zclient_create_header(s, ZEBRA_ROUTE_BATCH, vrf_id);
+		/* count, filled in when the batch is sent */
+		stream_putw(s, 0);
+		zclient->batch_vrf_id = vrf_id;
+	}
+
+	stream_putc(s, cmd);
+	stream_putw(s, len);
+	stream_put(s, STREAM_DATA(zclient->obuf) + ZEBRA_HEADER_SIZE, len);
+	zclient->batch_count++;
+
+	return ZCLIENT_SEND_BUFFERED;
+}
+
 /*
  * "xdr_encode"-like interface that allows daemon (client) to send
  * a message to zebra server for a route that needs to be
@@ -833,9 +910,27 @@ zclient_route_send(uint8_t cmd, struct zclient *zclient, struct zapi_route *api)
 {
 	if (zapi_route_encode(cmd, zclient->obuf, api) < 0)
 		return ZCLIENT_SEND_FAILURE;
+	if (zclient->batch_depth)
+		return zclient_route_batch_add(zclient, cmd, api->vrf_id);
 	return zclient_send_message(zclient);
 }
 
+void zclient_route_batch_begin(struct zclient *zclient)
+{
+	if (!zclient->batch)
+		zclient->batch = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	zclient->batch_depth++;
+}
+
+enum zclient_send_status zclient_route_batch_commit(struct zclient *zclient)
+{
+	assert(zclient->batch_depth);
+
+	if (--zclient->batch_depth)
+		return ZCLIENT_SEND_SUCCESS;
+	return zclient_route_batch_flush(zclient);
+}
+
 static int zapi_nexthop_labels_cmp(const struct zapi_nexthop *next1,
 				   const struct zapi_nexthop *next2)
 {
@@ -1464,7 +1559,20 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 	struct zapi_nexthop *api_nh;
 	int i;
 
-	memset(api, 0, sizeof(*api));
+	/* struct zapi_route is about 20kB with all the nexthop slots and the
+	 * opaque buffer, but a typical route only uses a few hundred bytes of
+	 * it.  Only clear the fixed fields here;  nexthop slots are cleared
+	 * as they are decoded and opaque data is only valid up to its length.
+	 * Nexthop entries beyond nexthop_num / backup_nexthop_num are not
+	 * initialized, except for the first one which the redistribution
+	 * handlers look at unconditionally.
+	 */
+	memset(api, 0, offsetof(struct zapi_route, nexthops));
+	memset(&api->nexthops[0], 0, sizeof(api->nexthops[0]));
+	api->backup_nexthop_num = 0;
+	memset(&api->nhgid, 0,
+	       offsetof(struct zapi_route, opaque.data)
+		       - offsetof(struct zapi_route, nhgid));
 
 	/* Type, flags, message. */
 	STREAM_GETC(s, api->type);
@@ -1554,6 +1662,7 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 
 		for (i = 0; i < api->nexthop_num; i++) {
 			api_nh = &api->nexthops[i];
+			memset(api_nh, 0, sizeof(*api_nh));
 
 			if (zapi_nexthop_decode(s, api_nh, api->flags,
 						api->message)
@@ -1574,6 +1683,7 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 
 		for (i = 0; i < api->backup_nexthop_num; i++) {
 			api_nh = &api->backup_nexthops[i];
+			memset(api_nh, 0, sizeof(*api_nh));
 
 			if (zapi_nexthop_decode(s, api_nh, api->flags,
 						api->message)
@@ -4010,6 +4120,9 @@ static void zclient_read(struct thread *thread)
 
 	length -= ZEBRA_HEADER_SIZE;
 
+	frrtrace(4, frr_libfrr, zapi_recv, zclient->sock, command, length,
+		 vrf_id);
+
 	if (zclient_debug)
 		zlog_debug("zclient %p command %s VRF %u", zclient,
 			   zserv_command_string(command), vrf_id);
@@ -239,6 +239,7 @@ typedef enum {
 	ZEBRA_GRE_GET,
 	ZEBRA_GRE_UPDATE,
 	ZEBRA_GRE_SOURCE_SET,
+	ZEBRA_ROUTE_BATCH,
 } zebra_message_types_t;
 
 enum zebra_error_types {
@@ -365,6 +366,12 @@ struct zclient {
 
 	zclient_handler *const *handlers;
 	size_t n_handlers;
+
+	/* ZEBRA_ROUTE_BATCH being built, see zclient_route_batch_begin() */
+	struct stream *batch;
+	unsigned int batch_depth;
+	uint16_t batch_count;
+	vrf_id_t batch_vrf_id;
 };
 
 /* lib handlers added in bfd.c */
@@ -1073,6 +1080,22 @@ extern int zebra_read_pw_status_update(ZAPI_CALLBACK_ARGS,
 
 extern enum zclient_send_status zclient_route_send(uint8_t, struct zclient *,
 						   struct zapi_route *);
+
+/*
+ * Between zclient_route_batch_begin() and zclient_route_batch_commit(),
+ * zclient_route_send() doesn't send every route as a message of its own,
+ * but collects them into ZEBRA_ROUTE_BATCH messages of up to
+ * ZEBRA_MAX_PACKET_SIZ, which zebra handles in one go.  Routes that are
+ * still pending are sent on commit, or as soon as any other message is
+ * sent to zebra, so the order of messages stays the same.
+ *
+ * Calls may be nested; only the outermost commit sends the batch.  While
+ * batching, zclient_route_send() returns ZCLIENT_SEND_BUFFERED for routes
+ * that were queued.
+ */
+extern void zclient_route_batch_begin(struct zclient *zclient);
+extern enum zclient_send_status
+zclient_route_batch_commit(struct zclient *zclient);
 extern enum zclient_send_status
 zclient_send_rnh(struct zclient *zclient, int command, const struct prefix *p,
 		 safi_t safi, bool connected, bool resolve_via_default,
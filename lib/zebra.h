@@ -254,6 +254,26 @@ static inline int sendmmsg(int fd, struct mmsghdr *mmh, unsigned int len,
 }
 #endif
 
+#if !defined(HAVE_STRUCT_MMSGHDR_MSG_HDR) || !defined(HAVE_RECVMMSG)
+#define recvmmsg frr_recvmmsg
+
+#ifndef MSG_WAITFORONE
+#define MSG_WAITFORONE 0x10000
+#endif
+
+/* one at a time, callers read again for the rest */
+static inline int recvmmsg(int fd, struct mmsghdr *mmh, unsigned int len,
+			   int flags, struct timespec *timeout)
+{
+	int rv = recvmsg(fd, &mmh->msg_hdr, flags & ~MSG_WAITFORONE);
+
+	if (rv < 0)
+		return rv;
+	mmh->msg_len = rv;
+	return 1;
+}
+#endif
+
 /*
  * RFC 3542 defines several macros for using struct cmsghdr.
  * Here, we define those that are not present
@@ -58,6 +58,7 @@
 #include "printfrr.h"
 #include "frrcu.h"
 #include "zlog.h"
+#include "zlog_events.h"
 #include "libfrr_trace.h"
 #include "thread.h"
 
@@ -596,10 +597,73 @@ static void zlog_backtrace_msg(const struct xref_logmsg *xref, int prio)
 		     tc->xref->xref.line);
 }
 
+/* "log ratelimit", interval 0 = off */
+static int64_t zlog_rl_interval;
+static int64_t zlog_rl_burst;
+
+void zlog_set_ratelimit(unsigned int rate, unsigned int burst)
+{
+	zlog_rl_interval = rate ? 1000000 / rate : 0;
+	zlog_rl_burst = MAX(burst, 1U);
+}
+
+void zlog_get_ratelimit(unsigned int *rate, unsigned int *burst)
+{
+	*rate = zlog_rl_interval ? 1000000 / zlog_rl_interval : 0;
+	*burst = zlog_rl_burst;
+}
+
+/* sampling and rate limiting, false if the message shouldn't be logged */
+static bool zlog_xref_pass(struct xrefdata_logmsg *xrdl, int prio)
+{
+	int64_t interval = zlog_rl_interval, now, tat, next;
+	struct timeval tv;
+
+	if (xrdl->sample > 1
+	    && atomic_fetch_add_explicit(&xrdl->sample_ctr, 1,
+					 memory_order_relaxed)
+			       % xrdl->sample)
+		goto suppress;
+
+	if (!interval || prio < LOG_DEBUG)
+		return true;
+
+	monotime(&tv);
+	now = tv.tv_sec * 1000000LL + tv.tv_usec;
+
+	/* generic cell rate algorithm, i.e. a token bucket that only needs
+	 * one timestamp to be updated atomically
+	 */
+	tat = atomic_load_explicit(&xrdl->rl_tat, memory_order_relaxed);
+	do {
+		next = MAX(tat, now) + interval;
+		if (next - now > interval * zlog_rl_burst)
+			goto suppress;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&xrdl->rl_tat, &tat, next, memory_order_relaxed,
+		memory_order_relaxed));
+	return true;
+
+suppress:
+	atomic_fetch_add_explicit(&xrdl->suppressed, 1, memory_order_relaxed);
+	return false;
+}
+
 void vzlogx(const struct xref_logmsg *xref, int prio,
 	    const char *fmt, va_list ap)
 {
 	struct zlog_tls *zlog_tls = zlog_tls_get();
+	struct xrefdata_logmsg *xrdl = NULL;
+
+	if (xref) {
+		xrdl = container_of(xref->xref.xrefdata, struct xrefdata_logmsg,
+				    xrefdata);
+		if (!zlog_xref_pass(xrdl, prio))
+			return;
+	}
+
+	if (zlog_events_want(prio))
+		zlog_events_add(xref, prio, fmt, ap);
 
 #ifdef HAVE_LTTNG
 	va_list copy;
@@ -634,14 +698,8 @@ void vzlogx(const struct xref_logmsg *xref, int prio,
 	else
 		vzlog_notls(xref, prio, fmt, ap);
 
-	if (xref) {
-		struct xrefdata_logmsg *xrdl;
-
-		xrdl = container_of(xref->xref.xrefdata, struct xrefdata_logmsg,
-				    xrefdata);
-		if (xrdl->fl_print_bt)
-			zlog_backtrace_msg(xref, prio);
-	}
+	if (xrdl && xrdl->fl_print_bt)
+		zlog_backtrace_msg(xref, prio);
 }
 
 void zlog_sigsafe(const char *text, size_t len)
@@ -62,6 +62,16 @@ struct xrefdata_logmsg {
 	struct xrefdata xrefdata;
 
 	uint8_t fl_print_bt;
+
+	/* only log every Nth message from this callsite (0/1 = all) */
+	uint32_t sample;
+	atomic_uint_fast32_t sample_ctr;
+
+	/* "log ratelimit" state, GCRA theoretical arrival time in usec */
+	_Atomic int64_t rl_tat;
+
+	/* messages not logged due to the above */
+	atomic_size_t suppressed;
 };
 
 /* These functions are set up to write to stdout/stderr without explicit
@@ -288,6 +298,12 @@ extern void zlog_tls_buffer_fini(void);
 /* Enable or disable 'immediate' output - default is to buffer messages. */
 extern void zlog_set_immediate(bool set_p);
 
+/* Limit debug messages to rate per second (burst at once) per callsite,
+ * 0 to disable.
+ */
+extern void zlog_set_ratelimit(unsigned int rate, unsigned int burst);
+extern void zlog_get_ratelimit(unsigned int *rate, unsigned int *burst);
+
 extern const char *zlog_priority_str(int priority);
 
 #ifdef __cplusplus
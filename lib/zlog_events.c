@@ -0,0 +1,504 @@
+/*
+ * Binary log event ring
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "zebra.h"
+
+#include <sys/mman.h>
+#include <wchar.h>
+
+#include "frr_pthread.h"
+#include "printfrr.h"
+#include "printf/printflocal.h"
+#include "zlog.h"
+#include "zlog_events.h"
+
+#define ZLOG_EVENTS_FILE "events"
+
+int zlog_events_prio_min = ZLOG_DISABLED;
+
+/* writers serialize on this; it also keeps the ring from being unmapped
+ * while in use
+ */
+static pthread_mutex_t zlog_events_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct zlog_events_ring *zlog_events_ring;
+static size_t zlog_events_mapsize;
+
+struct zlog_event_buf {
+	union {
+		struct zlog_event ev;
+		uint8_t raw[ZLOG_EVENT_MAX];
+	};
+	size_t pos;
+};
+
+static inline bool ev_put(struct zlog_event_buf *eb, uint8_t type,
+			  const void *val, size_t len)
+{
+	if (eb->pos + 1 + len > sizeof(eb->raw) || eb->ev.nargs == UINT8_MAX)
+		return false;
+
+	eb->raw[eb->pos++] = type;
+	memcpy(eb->raw + eb->pos, val, len);
+	eb->pos += len;
+	eb->ev.nargs++;
+	return true;
+}
+
+static inline bool ev_put_i32(struct zlog_event_buf *eb, int32_t val)
+{
+	return ev_put(eb, ZLOG_EVA_I32, &val, sizeof(val));
+}
+
+static inline bool ev_put_i64(struct zlog_event_buf *eb, int64_t val)
+{
+	return ev_put(eb, ZLOG_EVA_I64, &val, sizeof(val));
+}
+
+static bool ev_put_str(struct zlog_event_buf *eb, const char *str, size_t len)
+{
+	uint16_t len16;
+
+	len = MIN(len, UINT16_MAX);
+	if (eb->pos + 3 + len > sizeof(eb->raw) || eb->ev.nargs == UINT8_MAX)
+		return false;
+
+	len16 = len;
+	eb->raw[eb->pos++] = ZLOG_EVA_STR;
+	memcpy(eb->raw + eb->pos, &len16, sizeof(len16));
+	memcpy(eb->raw + eb->pos + 2, str, len);
+	eb->pos += 2 + len;
+	eb->ev.nargs++;
+	return true;
+}
+
+/* printfrr extension, formatted straight into the record */
+static bool ev_put_ext(struct zlog_event_buf *eb, const char **fmtp,
+		       struct printfrr_eargs *ea, const void *ptr,
+		       uintmax_t num, bool is_ptr)
+{
+	struct fbuf fb;
+	ssize_t len;
+	uint16_t len16;
+
+	if (eb->pos + 3 >= sizeof(eb->raw) || eb->ev.nargs == UINT8_MAX)
+		return false;
+
+	fb.buf = fb.pos = (char *)eb->raw + eb->pos + 3;
+	fb.len = sizeof(eb->raw) - eb->pos - 3;
+	fb.outpos = NULL;
+	fb.outpos_n = fb.outpos_i = 0;
+
+	ea->fmt = *fmtp;
+	len = is_ptr ? printfrr_extp(&fb, ea, ptr) : printfrr_exti(&fb, ea, num);
+	if (len < 0)
+		return false;
+
+	len16 = fb.pos - fb.buf;
+	eb->raw[eb->pos] = ZLOG_EVA_STR;
+	memcpy(eb->raw + eb->pos + 1, &len16, sizeof(len16));
+	eb->pos += 3 + len16;
+	eb->ev.nargs++;
+
+	*fmtp = ea->fmt;
+	return true;
+}
+
+enum ev_len {
+	EVL_INT = 0,
+	EVL_LONG,
+	EVL_LLONG,
+	EVL_INTMAX,
+	EVL_SIZE,
+	EVL_PTRDIFF,
+	EVL_LDOUBLE,
+};
+
+/* walk the format string and record each argument.  false for anything
+ * that can't be represented (positional args, wide chars, long double);
+ * the message is then formatted instead.
+ */
+static bool zlog_events_encode(struct zlog_event_buf *eb, const char *fmt,
+			       va_list ap)
+{
+	struct printfrr_eargs ea;
+	enum ev_len lm;
+	int width, prec;
+	bool leftadj, alt;
+	const char *str;
+	double dval;
+	uintmax_t num;
+	void *ptr;
+
+	while ((fmt = strchr(fmt, '%'))) {
+		fmt++;
+		if (*fmt == '%') {
+			fmt++;
+			continue;
+		}
+
+		leftadj = alt = false;
+		for (; *fmt && strchr("-+ #0'", *fmt); fmt++) {
+			if (*fmt == '-')
+				leftadj = true;
+			else if (*fmt == '#')
+				alt = true;
+		}
+
+		width = 0;
+		if (*fmt == '*') {
+			width = va_arg(ap, int);
+			if (!ev_put_i32(eb, width))
+				return false;
+			if (width < 0) {
+				leftadj = true;
+				width = -width;
+			}
+			fmt++;
+		} else {
+			for (; isdigit((unsigned char)*fmt); fmt++)
+				width = width * 10 + *fmt - '0';
+			if (*fmt == '$')
+				return false;
+		}
+
+		prec = -1;
+		if (*fmt == '.') {
+			fmt++;
+			prec = 0;
+			if (*fmt == '*') {
+				prec = va_arg(ap, int);
+				if (!ev_put_i32(eb, prec))
+					return false;
+				fmt++;
+			} else
+				for (; isdigit((unsigned char)*fmt); fmt++)
+					prec = prec * 10 + *fmt - '0';
+		}
+
+		lm = EVL_INT;
+		switch (*fmt) {
+		case 'h':
+			fmt += (fmt[1] == 'h') ? 2 : 1;
+			break;
+		case 'l':
+			if (fmt[1] == 'l') {
+				lm = EVL_LLONG;
+				fmt++;
+			} else
+				lm = EVL_LONG;
+			fmt++;
+			break;
+		case 'q':
+			lm = EVL_LLONG;
+			fmt++;
+			break;
+		case 'j':
+			lm = EVL_INTMAX;
+			fmt++;
+			break;
+		case 'z':
+			lm = EVL_SIZE;
+			fmt++;
+			break;
+		case 't':
+			lm = EVL_PTRDIFF;
+			fmt++;
+			break;
+		case 'L':
+			lm = EVL_LDOUBLE;
+			fmt++;
+			break;
+		}
+
+		memset(&ea, 0, sizeof(ea));
+		ea.precision = prec;
+		ea.width = width;
+		ea.alt_repr = alt;
+		ea.leftadj = leftadj;
+
+		switch (*fmt++) {
+		case 'd':
+		case 'i':
+		case 'o':
+		case 'u':
+		case 'x':
+		case 'X':
+			switch (lm) {
+			case EVL_LONG:
+				num = va_arg(ap, long);
+				break;
+			case EVL_LLONG:
+				num = va_arg(ap, long long);
+				break;
+			case EVL_INTMAX:
+				num = va_arg(ap, intmax_t);
+				break;
+			case EVL_SIZE:
+				num = va_arg(ap, size_t);
+				break;
+			case EVL_PTRDIFF:
+				num = va_arg(ap, ptrdiff_t);
+				break;
+			case EVL_INT:
+				num = (unsigned int)va_arg(ap, int);
+				if (fmt[-1] == 'd' && printfrr_ext_char(fmt[0])
+				    && ev_put_ext(eb, &fmt, &ea, NULL, num,
+						  false))
+					continue;
+				if (!ev_put_i32(eb, num))
+					return false;
+				continue;
+			default:
+				return false;
+			}
+			if (fmt[-1] == 'd' && printfrr_ext_char(fmt[0])
+			    && ev_put_ext(eb, &fmt, &ea, NULL, num, false))
+				continue;
+			if (!ev_put_i64(eb, num))
+				return false;
+			break;
+
+		case 'c':
+			if (lm != EVL_INT || !ev_put_i32(eb, va_arg(ap, int)))
+				return false;
+			break;
+
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if (lm == EVL_LDOUBLE)
+				return false;
+			dval = va_arg(ap, double);
+			if (!ev_put(eb, ZLOG_EVA_DBL, &dval, sizeof(dval)))
+				return false;
+			break;
+
+		case 's':
+			if (lm != EVL_INT)
+				return false;
+			str = va_arg(ap, const char *);
+			if (!str)
+				str = "(null)";
+			if (!ev_put_str(eb, str,
+					prec >= 0 ? strnlen(str, prec)
+						  : strlen(str)))
+				return false;
+			break;
+
+		case 'p':
+			ptr = va_arg(ap, void *);
+			if (printfrr_ext_char(fmt[0])
+			    && ev_put_ext(eb, &fmt, &ea, ptr, 0, true))
+				continue;
+			if (!ev_put_i64(eb, (intptr_t)ptr))
+				return false;
+			break;
+
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+static void zlog_events_write(struct zlog_event_buf *eb)
+{
+	struct zlog_events_ring *ring;
+	struct zlog_event *pad;
+	uint64_t head;
+	size_t off, len;
+	uint8_t *data;
+
+	len = (eb->pos + 7) & ~(size_t)7;
+	memset(eb->raw + eb->pos, 0, len - eb->pos);
+	eb->ev.len = len;
+
+	frr_with_mutex (&zlog_events_mtx) {
+		ring = zlog_events_ring;
+		if (!ring)
+			continue;
+
+		data = (uint8_t *)ring + ring->dataoff;
+		head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		off = head % ring->size;
+
+		if (off + len > ring->size) {
+			pad = (struct zlog_event *)(data + off);
+			pad->len = ring->size - off;
+			pad->type = ZLOG_EV_PAD;
+			head += ring->size - off;
+			off = 0;
+		}
+
+		memcpy(data + off, eb->raw, len);
+		atomic_store_explicit(&ring->head, head + len,
+				      memory_order_release);
+	}
+}
+
+void zlog_events_add(const struct xref_logmsg *xref, int prio,
+		     const char *fmt, va_list ap)
+{
+	struct zlog_event_buf eb;
+	struct timespec ts;
+	intmax_t pid, tid;
+	va_list copy;
+	bool ok = false;
+	ssize_t len;
+	uint16_t len16;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	/* doesn't actually look at the message */
+	zlog_msg_pid(NULL, &pid, &tid);
+
+	memset(&eb.ev, 0, sizeof(eb.ev));
+	eb.ev.prio = prio & LOG_PRIMASK;
+	eb.ev.ts_sec = ts.tv_sec;
+	eb.ev.ts_nsec = ts.tv_nsec;
+	eb.ev.tid = tid;
+
+	if (xref) {
+		eb.ev.type = ZLOG_EV_ARGS;
+		eb.ev.ec = xref->ec;
+		if (xref->xref.xrefdata)
+			strlcpy(eb.ev.uid, xref->xref.xrefdata->uid,
+				sizeof(eb.ev.uid));
+		eb.pos = sizeof(eb.ev);
+
+		va_copy(copy, ap);
+		ok = zlog_events_encode(&eb, fmt, copy);
+		va_end(copy);
+	}
+
+	if (!ok) {
+		/* no xref to find the format string with, or arguments that
+		 * can't be encoded - format it here
+		 */
+		eb.ev.type = ZLOG_EV_TEXT;
+		eb.ev.nargs = 1;
+		eb.pos = sizeof(eb.ev);
+
+		va_copy(copy, ap);
+		len = vsnprintfrr((char *)eb.raw + eb.pos + 3,
+				  sizeof(eb.raw) - eb.pos - 3, fmt, copy);
+		va_end(copy);
+
+		/* vsnprintfrr() returns the untruncated length */
+		len16 = MAX(MIN(len, (ssize_t)(sizeof(eb.raw) - eb.pos - 4)),
+			    0);
+		eb.raw[eb.pos] = ZLOG_EVA_STR;
+		memcpy(eb.raw + eb.pos + 1, &len16, sizeof(len16));
+		eb.pos += 3 + len16;
+	}
+
+	zlog_events_write(&eb);
+}
+
+static void zlog_events_unmap(void)
+{
+	if (!zlog_events_ring)
+		return;
+
+	munmap(zlog_events_ring, zlog_events_mapsize);
+	zlog_events_ring = NULL;
+	zlog_events_mapsize = 0;
+
+	if (zlog_tmpdirfd >= 0)
+		unlinkat(zlog_tmpdirfd, ZLOG_EVENTS_FILE, 0);
+}
+
+bool zlog_events_set(int prio_min, size_t size)
+{
+	struct zlog_events_ring *ring;
+	size_t mapsize;
+	int fd;
+
+	size &= ~(size_t)7;
+	mapsize = sizeof(*ring) + size;
+
+	if (prio_min == ZLOG_DISABLED) {
+		zlog_events_prio_min = ZLOG_DISABLED;
+		frr_with_mutex (&zlog_events_mtx) {
+			zlog_events_unmap();
+		}
+		return true;
+	}
+
+	if (zlog_events_ring && zlog_events_mapsize == mapsize) {
+		zlog_events_prio_min = prio_min;
+		return true;
+	}
+
+	if (zlog_tmpdirfd < 0 || size < 4 * ZLOG_EVENT_MAX)
+		return false;
+
+	fd = openat(zlog_tmpdirfd, ZLOG_EVENTS_FILE ".new",
+		    O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+	if (fd < 0)
+		return false;
+
+	if (ftruncate(fd, mapsize) < 0) {
+		close(fd);
+		unlinkat(zlog_tmpdirfd, ZLOG_EVENTS_FILE ".new", 0);
+		return false;
+	}
+
+	ring = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED) {
+		unlinkat(zlog_tmpdirfd, ZLOG_EVENTS_FILE ".new", 0);
+		return false;
+	}
+
+	ring->version = ZLOG_EVENTS_VERSION;
+	ring->dataoff = sizeof(*ring);
+	ring->maxrec = ZLOG_EVENT_MAX;
+	ring->size = size;
+	ring->pid = getpid();
+	/* magic last, so a reader doesn't pick up a half set up ring */
+	atomic_thread_fence(memory_order_release);
+	ring->magic = ZLOG_EVENTS_MAGIC;
+
+	frr_with_mutex (&zlog_events_mtx) {
+		zlog_events_unmap();
+		renameat(zlog_tmpdirfd, ZLOG_EVENTS_FILE ".new", zlog_tmpdirfd,
+			 ZLOG_EVENTS_FILE);
+		zlog_events_ring = ring;
+		zlog_events_mapsize = mapsize;
+	}
+	zlog_events_prio_min = prio_min;
+	return true;
+}
+
+size_t zlog_events_get_size(void)
+{
+	size_t size = 0;
+
+	frr_with_mutex (&zlog_events_mtx) {
+		if (zlog_events_ring)
+			size = zlog_events_ring->size;
+	}
+	return size;
+}
@@ -0,0 +1,134 @@
+/*
+ * Binary log event ring
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_ZLOG_EVENTS_H
+#define _FRR_ZLOG_EVENTS_H
+
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "zlog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Log messages recorded without formatting them:  the unique ID, priority,
+ * timestamp and the raw printf arguments go into a ring in a shared file
+ * ("events" in the daemon's /var/tmp/frr/ directory), for an external
+ * collector to mmap() and read.  The collector finds the format string for
+ * each unique ID in the daemon's xref data (as dumped by xrelfo) and does
+ * the formatting itself.  Only printfrr extensions (%pFX and the like) are
+ * still formatted in the daemon since their pointers are meaningless
+ * elsewhere; those come out as ZLOG_EVA_STR.
+ *
+ * Reading:  keep a position pos (starting at head), and read records from
+ * data[pos % size] while pos < head.  A record's len is always a multiple
+ * of 8 and records never wrap around the end; ZLOG_EV_PAD fills the gap.
+ * The writer may be up to 2 * maxrec bytes ahead of head, so a record just
+ * read is only valid if, reading head again afterwards,
+ * head - pos <= size - 2 * maxrec.  Otherwise the reader was overrun and
+ * should resume at head.
+ */
+
+#define ZLOG_EVENTS_MAGIC	0x46525645 /* "FRVE" */
+#define ZLOG_EVENTS_VERSION	1
+
+/* largest single record */
+#define ZLOG_EVENT_MAX		4096
+
+struct zlog_events_ring {
+	uint32_t magic;
+	uint32_t version;
+
+	/* start of record area, from the start of the file */
+	uint32_t dataoff;
+	uint32_t maxrec;
+	/* record area size */
+	uint64_t size;
+
+	int64_t pid;
+
+	/* total bytes written, updated (release) after each record */
+	_Atomic uint64_t head;
+};
+
+enum zlog_event_type {
+	ZLOG_EV_PAD = 0,
+	/* uid set, arguments follow */
+	ZLOG_EV_ARGS = 1,
+	/* message formatted in the daemon, a single ZLOG_EVA_STR follows */
+	ZLOG_EV_TEXT = 2,
+};
+
+struct zlog_event {
+	uint32_t len;
+	uint16_t type;
+	uint8_t prio;
+	uint8_t nargs;
+
+	/* CLOCK_REALTIME */
+	uint64_t ts_sec;
+	uint32_t ts_nsec;
+	uint32_t ec;
+
+	int64_t tid;
+
+	/* xref unique identifier, "XXXXX-XXXXX\0" */
+	char uid[12];
+	uint32_t reserved;
+
+	/* nargs times a type byte and the value, unaligned, host order
+	 * (width/precision given as '*' are arguments too, as in va_list)
+	 */
+	uint8_t args[0];
+};
+
+enum zlog_event_argtype {
+	/* int, char, short: 4 bytes */
+	ZLOG_EVA_I32 = 'i',
+	/* long, long long, intmax_t, size_t, ptrdiff_t, plain %p: 8 bytes */
+	ZLOG_EVA_I64 = 'l',
+	/* double: 8 bytes */
+	ZLOG_EVA_DBL = 'd',
+	/* %s and printfrr extensions: uint16_t length, then text without NUL */
+	ZLOG_EVA_STR = 's',
+};
+
+extern int zlog_events_prio_min;
+
+static inline bool zlog_events_want(int prio)
+{
+	return prio <= zlog_events_prio_min;
+}
+
+extern void zlog_events_add(const struct xref_logmsg *xref, int prio,
+			    const char *fmt, va_list ap);
+
+/* prio_min ZLOG_DISABLED to disable; size in bytes */
+extern bool zlog_events_set(int prio_min, size_t size);
+extern size_t zlog_events_get_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_ZLOG_EVENTS_H */
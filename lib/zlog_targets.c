@@ -18,9 +18,11 @@
 
 #include <sys/un.h>
 #include <syslog.h>
+#include <sched.h>
 
 #include "memory.h"
 #include "frrcu.h"
+#include "atomlist.h"
 #include "frr_pthread.h"
 #include "printfrr.h"
 #include "zlog.h"
@@ -37,6 +39,7 @@ DEFINE_MTYPE_STATIC(LOG, LOG_FD,        "log file target");
 DEFINE_MTYPE_STATIC(LOG, LOG_FD_NAME,   "log file name");
 DEFINE_MTYPE_STATIC(LOG, LOG_FD_ROTATE, "log file rotate helper");
 DEFINE_MTYPE_STATIC(LOG, LOG_SYSL,      "syslog target");
+DEFINE_MTYPE_STATIC(LOG, LOG_ASYNC,     "log async write buffer");
 
 struct zlt_fd {
 	struct zlog_target zt;
@@ -45,10 +48,241 @@ struct zlt_fd {
 
 	char ts_subsec;
 	bool record_priority;
+	bool async;
+
+	/* messages not queued since the writer was too far behind */
+	atomic_size_t dropped;
 
 	struct rcu_head_close head_close;
 };
 
+/* asynchronous writes
+ *
+ * Messages are formatted by the logging thread as usual, but rather than
+ * doing the writev() there, the text is copied into a chunk and queued for
+ * a separate writer pthread.  The queue is bounded by ZLT_ASYNC_MAX bytes;
+ * beyond that messages are dropped and counted instead of blocking the
+ * daemon or using up memory.  Crash/signal logging still writes directly.
+ */
+#define ZLT_ASYNC_MAX (4 * 1024 * 1024)
+
+PREDECL_ATOMLIST(zlt_async_queue);
+
+struct zlt_async_chunk {
+	struct zlt_async_queue_item qitem;
+
+	struct zlt_fd *zte;
+	/* len == 0 is queued when zte is no longer in use, to close and free
+	 * it after anything still pending for it has been written
+	 */
+	size_t len;
+	char text[];
+};
+
+DECLARE_ATOMLIST(zlt_async_queue, struct zlt_async_chunk, qitem);
+
+static struct zlt_async_queue_head zlt_async_queue;
+/* bytes queued, the writer sleeps on this being 0 */
+static atomic_size_t zlt_async_bytes;
+static atomic_size_t zlt_async_dropped;
+static atomic_bool zlt_async_running;
+
+static pthread_t zlt_async_thread;
+static pthread_mutex_t zlt_async_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zlt_async_cond = PTHREAD_COND_INITIALIZER;
+static bool zlt_async_stop;
+
+static void zlt_async_push(struct zlt_async_chunk *chunk, size_t prev)
+{
+	zlt_async_queue_add_tail(&zlt_async_queue, chunk);
+
+	if (prev)
+		return;
+	frr_with_mutex (&zlt_async_mtx) {
+		pthread_cond_signal(&zlt_async_cond);
+	}
+}
+
+static void zlt_async_write(struct zlt_fd *zte, const struct iovec *iov,
+			    size_t iovcnt, size_t nmsgs)
+{
+	struct zlt_async_chunk *chunk;
+	size_t i, len = 0, prev;
+	char *pos;
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+
+	prev = atomic_fetch_add_explicit(&zlt_async_bytes, len,
+					 memory_order_relaxed);
+	if (prev && prev + len > ZLT_ASYNC_MAX) {
+		atomic_fetch_sub_explicit(&zlt_async_bytes, len,
+					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&zte->dropped, nmsgs,
+					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&zlt_async_dropped, nmsgs,
+					  memory_order_relaxed);
+		return;
+	}
+
+	chunk = XMALLOC(MTYPE_LOG_ASYNC, sizeof(*chunk) + len);
+	chunk->zte = zte;
+	chunk->len = len;
+
+	pos = chunk->text;
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+
+	zlt_async_push(chunk, prev);
+}
+
+static void zlt_async_chunk_run(struct zlt_async_chunk *chunk)
+{
+	struct zlt_fd *zte = chunk->zte;
+	size_t dropped;
+	char buf[80];
+	int fd, len;
+
+	if (!chunk->len) {
+		close(zte->fd);
+		XFREE(MTYPE_LOG_FD, zte);
+		return;
+	}
+
+	/* zlog_file_rotate() replaces the fd and closes the old one only
+	 * after an RCU grace period
+	 */
+	rcu_read_lock();
+	fd = atomic_load_explicit(&zte->fd, memory_order_relaxed);
+
+	dropped = atomic_exchange_explicit(&zte->dropped, 0,
+					   memory_order_relaxed);
+	if (dropped) {
+		len = snprintfrr(buf, sizeof(buf),
+				 "%zu log messages dropped, log file writes too slow\n",
+				 dropped);
+		write(fd, buf, MIN(len, (int)sizeof(buf) - 1));
+	}
+	write(fd, chunk->text, chunk->len);
+	rcu_read_unlock();
+}
+
+static void *zlt_async_run(void *arg)
+{
+	struct zlt_async_chunk *chunk;
+	size_t len;
+
+	rcu_thread_start(arg);
+	rcu_read_unlock();
+
+	while (true) {
+		frr_with_mutex (&zlt_async_mtx) {
+			while (!atomic_load_explicit(&zlt_async_bytes,
+						     memory_order_relaxed)
+			       && !zlt_async_stop)
+				pthread_cond_wait(&zlt_async_cond,
+						  &zlt_async_mtx);
+		}
+
+		chunk = zlt_async_queue_pop(&zlt_async_queue);
+		if (!chunk) {
+			if (!atomic_load_explicit(&zlt_async_bytes,
+						  memory_order_relaxed))
+				break;
+			/* counted, but the add_tail isn't done yet */
+			sched_yield();
+			continue;
+		}
+
+		len = MAX(chunk->len, 1U);
+		zlt_async_chunk_run(chunk);
+		XFREE(MTYPE_LOG_ASYNC, chunk);
+
+		atomic_fetch_sub_explicit(&zlt_async_bytes, len,
+					  memory_order_relaxed);
+	}
+	return NULL;
+}
+
+static void zlt_async_start(void)
+{
+	struct rcu_thread *rcu;
+	sigset_t oldsigs, blocksigs;
+
+	if (atomic_load_explicit(&zlt_async_running, memory_order_relaxed))
+		return;
+
+	/* signals stay with the main thread */
+	sigfillset(&blocksigs);
+	pthread_sigmask(SIG_BLOCK, &blocksigs, &oldsigs);
+
+	rcu = rcu_thread_prepare();
+	if (pthread_create(&zlt_async_thread, NULL, zlt_async_run, rcu)) {
+		rcu_thread_unprepare(rcu);
+		rcu = NULL;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+	if (rcu)
+		atomic_store_explicit(&zlt_async_running, true,
+				      memory_order_relaxed);
+}
+
+static void zlt_async_fini(void)
+{
+	if (!atomic_load_explicit(&zlt_async_running, memory_order_relaxed))
+		return;
+
+	/* anything logged from here on is written directly */
+	atomic_store_explicit(&zlt_async_running, false, memory_order_relaxed);
+
+	frr_with_mutex (&zlt_async_mtx) {
+		zlt_async_stop = true;
+		pthread_cond_signal(&zlt_async_cond);
+	}
+	pthread_join(zlt_async_thread, NULL);
+}
+
+/* runs after an RCU grace period, no logging thread can be using zte */
+static void zlt_async_target_free(struct zlt_fd *zte)
+{
+	struct zlt_async_chunk *chunk;
+	size_t prev;
+
+	if (!atomic_load_explicit(&zlt_async_running, memory_order_relaxed)) {
+		close(zte->fd);
+		XFREE(MTYPE_LOG_FD, zte);
+		return;
+	}
+
+	chunk = XCALLOC(MTYPE_LOG_ASYNC, sizeof(*chunk));
+	chunk->zte = zte;
+
+	prev = atomic_fetch_add_explicit(&zlt_async_bytes, 1,
+					 memory_order_relaxed);
+	zlt_async_push(chunk, prev);
+}
+
+void zlog_file_async_stats(size_t *queued, size_t *dropped)
+{
+	*queued = atomic_load_explicit(&zlt_async_bytes, memory_order_relaxed);
+	*dropped = atomic_load_explicit(&zlt_async_dropped,
+					memory_order_relaxed);
+}
+
+static void zlog_fd_write(struct zlt_fd *zte, int fd, struct iovec *iov,
+			  size_t iovcnt, size_t nmsgs)
+{
+	if (zte->async
+	    && atomic_load_explicit(&zlt_async_running, memory_order_relaxed))
+		zlt_async_write(zte, iov, iovcnt, nmsgs);
+	else
+		writev(fd, iov, iovcnt);
+}
+
 static const char * const prionames[] = {
 	[LOG_EMERG] =	"emergencies: ",
 	[LOG_ALERT] =	"alerts: ",
@@ -64,7 +298,7 @@ void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[], size_t nmsgs)
 {
 	struct zlt_fd *zte = container_of(zt, struct zlt_fd, zt);
 	int fd;
-	size_t i, textlen, iovpos = 0;
+	size_t i, textlen, iovpos = 0, nbatch = 0;
 	size_t niov = MIN(4 * nmsgs + 1, IOV_MAX);
 	struct iovec iov[niov];
 	/* "\nYYYY-MM-DD HH:MM:SS.NNNNNNNNN+ZZ:ZZ " = 37 chars */
@@ -113,6 +347,7 @@ void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[], size_t nmsgs)
 			iov[iovpos].iov_len = textlen + 1;
 
 			iovpos++;
+			nbatch++;
 		}
 
 		/* conditions that trigger writing:
@@ -123,9 +358,10 @@ void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[], size_t nmsgs)
 		if (iovpos > 0 && (ts_buf + sizeof(ts_buf) - ts_pos < TS_LEN
 				   || i + 1 == nmsgs
 				   || array_size(iov) - iovpos < 5)) {
-			writev(fd, iov, iovpos);
+			zlog_fd_write(zte, fd, iov, iovpos, nbatch);
 
 			iovpos = 0;
+			nbatch = 0;
 			ts_pos = ts_buf;
 		}
 	}
@@ -174,6 +410,11 @@ static void zlog_file_target_free(struct zlt_fd *zlt)
 	if (!zlt)
 		return;
 
+	if (zlt->async) {
+		rcu_call(zlt_async_target_free, zlt, zt.rcu_head);
+		return;
+	}
+
 	rcu_close(&zlt->head_close, zlt->fd);
 	rcu_free(MTYPE_LOG_FD, zlt, zt.rcu_head);
 }
@@ -225,6 +466,10 @@ static bool zlog_file_cycle(struct zlog_cfg_file *zcf)
 		zlt->fd = fd;
 		zlt->record_priority = zcf->record_priority;
 		zlt->ts_subsec = zcf->ts_subsec;
+		zlt->async = zcf->async;
+
+		if (zlt->async)
+			zlt_async_start();
 
 		zlt->zt.prio_min = zcf->prio_min;
 		zlt->zt.logfn = zcf->zlog_wrap ? zcf->zlog_wrap : zlog_fd;
@@ -385,6 +630,7 @@ static int zlt_init(const char *progname, const char *protoname,
 
 static int zlt_fini(void)
 {
+	zlt_async_fini();
 	closelog();
 	return 0;
 }
@@ -38,6 +38,8 @@ struct zlog_cfg_file {
 	int prio_min;
 	char ts_subsec;
 	bool record_priority;
+	/* hand writes to a separate pthread */
+	bool async;
 
 	/* call zlog_file_set_filename/fd() to change this */
 	char *filename;
@@ -58,6 +60,9 @@ extern bool zlog_file_rotate(struct zlog_cfg_file *zcf);
 extern void zlog_fd(struct zlog_target *zt, struct zlog_msg *msgs[],
 		    size_t nmsgs);
 
+/* bytes waiting for the async writer, total messages dropped */
+extern void zlog_file_async_stats(size_t *queued, size_t *dropped);
+
 /* syslog is always limited to one target */
 
 extern void zlog_syslog_set_facility(int facility);
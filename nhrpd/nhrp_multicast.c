@@ -71,9 +71,10 @@ static void nhrp_multicast_forward_cache(struct nhrp_cache *c, void *pctx)
 {
 	struct mcast_ctx *ctx = (struct mcast_ctx *)pctx;
 
-	if (c->cur.type == NHRP_CACHE_DYNAMIC && c->cur.peer)
-		nhrp_multicast_forward_nbma(&c->cur.peer->vc->remote.nbma,
-					    ctx->ifp, ctx->pkt);
+	/* the entry holds its peer, no need to look it up again */
+	if (c->cur.type == NHRP_CACHE_DYNAMIC && c->cur.peer
+	    && c->cur.peer->online)
+		nhrp_multicast_send(c->cur.peer, ctx->pkt);
 }
 
 static void nhrp_multicast_forward(struct nhrp_multicast *mcast, void *pctx)
@@ -151,12 +151,33 @@ static void ospf6_area_lsdb_hook_remove(struct ospf6_lsa *lsa)
 	}
 }
 
+/* Intra-Area-Prefix LSAs only have their changed prefixes processed */
+static void ospf6_area_lsdb_hook_replace(struct ospf6_lsa *old,
+					 struct ospf6_lsa *lsa)
+{
+	if (ntohs(lsa->header->type) == OSPF6_LSTYPE_INTRA_PREFIX) {
+		ospf6_intra_prefix_lsa_replace(old, lsa);
+		return;
+	}
+
+	ospf6_area_lsdb_hook_remove(old);
+	ospf6_area_lsdb_hook_add(lsa);
+}
+
 static void ospf6_area_route_hook_add(struct ospf6_route *route)
 {
 	struct ospf6_area *oa = route->table->scope;
 	struct ospf6 *ospf6 = oa->ospf6;
 	struct ospf6_route *copy;
 
+	/* nothing changed for the global table (and zebra) */
+	copy = ospf6_route_lookup_identical(route, ospf6->route_table);
+	if (copy && ospf6_route_is_same_origin(copy, route)
+	    && copy->path.tag == route->path.tag
+	    && copy->prefix_options == route->prefix_options
+	    && listcount(copy->paths) == listcount(route->paths))
+		return;
+
 	copy = ospf6_route_copy(route);
 	ospf6_route_add(copy, ospf6->route_table);
 }
@@ -294,6 +315,7 @@ struct ospf6_area *ospf6_area_create(uint32_t area_id, struct ospf6 *o, int df)
 	oa->lsdb = ospf6_lsdb_create(oa);
 	oa->lsdb->hook_add = ospf6_area_lsdb_hook_add;
 	oa->lsdb->hook_remove = ospf6_area_lsdb_hook_remove;
+	oa->lsdb->hook_replace = ospf6_area_lsdb_hook_replace;
 	oa->lsdb_self = ospf6_lsdb_create(oa);
 	oa->temp_router_lsa_lsdb = ospf6_lsdb_create(oa);
 
@@ -1274,24 +1274,19 @@ void ospf6_asbr_status_update(struct ospf6 *ospf6, int status)
 	struct listnode *lnode, *lnnode;
 	struct ospf6_area *oa;
 
-	zlog_info("ASBR[%s:Status:%d]: Update", ospf6->name, status);
-
+	/* called for every redistributed route, only log transitions */
 	if (status) {
-		if (IS_OSPF6_ASBR(ospf6)) {
-			zlog_info("ASBR[%s:Status:%d]: Already ASBR",
-				  ospf6->name, status);
+		if (IS_OSPF6_ASBR(ospf6))
 			return;
-		}
 		SET_FLAG(ospf6->flag, OSPF6_FLAG_ASBR);
 	} else {
-		if (!IS_OSPF6_ASBR(ospf6)) {
-			zlog_info("ASBR[%s:Status:%d]: Already non ASBR",
-				  ospf6->name, status);
+		if (!IS_OSPF6_ASBR(ospf6))
 			return;
-		}
 		UNSET_FLAG(ospf6->flag, OSPF6_FLAG_ASBR);
 	}
 
+	zlog_info("ASBR[%s:Status:%d]: Update", ospf6->name, status);
+
 	/* Transition from/to status ASBR, schedule timer. */
 	ospf6_spf_schedule(ospf6, OSPF6_SPF_FLAGS_ASBR_STATUS_CHANGE);
 
@@ -1394,6 +1389,68 @@ ospf6_external_aggr_match(struct ospf6 *ospf6, struct prefix *p)
 	return node->info;
 }
 
+static void ospf6_asbr_ext_pending_run(struct thread *thread)
+{
+	struct ospf6 *ospf6 = THREAD_ARG(thread);
+	struct ospf6_external_info *info;
+	unsigned int count = 0;
+
+	while (count < ospf6->ext_pacing_burst
+	       && (info = ospf6_ext_pending_pop(&ospf6->ext_pending))) {
+		ospf6_handle_external_lsa_origination(ospf6, info->route,
+						      &info->route->prefix);
+		count++;
+	}
+
+	if (IS_OSPF6_DEBUG_ASBR)
+		zlog_debug("%s: originated %u external LSAs, %zu pending",
+			   __func__, count,
+			   ospf6_ext_pending_count(&ospf6->ext_pending));
+
+	if (ospf6_ext_pending_count(&ospf6->ext_pending))
+		thread_add_timer_msec(master, ospf6_asbr_ext_pending_run, ospf6,
+				      ospf6->ext_pacing_interval,
+				      &ospf6->t_ext_pending);
+}
+
+/*
+ * Originates the AS-External-LSA for a redistributed route, right away or,
+ * with pacing configured, from a queue worked through at most
+ * ext_pacing_burst LSAs at a time.  That keeps a large redistribution
+ * (a full table from BGP) from hogging the thread and flooding neighbors
+ * in one go, and routes changing again while still queued cost nothing.
+ */
+static void ospf6_asbr_external_originate(struct ospf6 *ospf6,
+					  struct ospf6_route *route)
+{
+	struct ospf6_external_info *info = route->route_option;
+
+	if (!ospf6->ext_pacing_burst) {
+		ospf6_handle_external_lsa_origination(ospf6, route,
+						      &route->prefix);
+		return;
+	}
+
+	info->route = route;
+	if (ospf6_ext_pending_anywhere(info))
+		return;
+
+	ospf6_ext_pending_add_tail(&ospf6->ext_pending, info);
+	/* the first batch goes out right away */
+	thread_add_event(master, ospf6_asbr_ext_pending_run, ospf6, 0,
+			 &ospf6->t_ext_pending);
+}
+
+void ospf6_asbr_ext_pending_flush(struct ospf6 *ospf6)
+{
+	struct ospf6_external_info *info;
+
+	THREAD_OFF(ospf6->t_ext_pending);
+	while ((info = ospf6_ext_pending_pop(&ospf6->ext_pending)))
+		ospf6_handle_external_lsa_origination(ospf6, info->route,
+						      &info->route->prefix);
+}
+
 void ospf6_asbr_redistribute_add(int type, ifindex_t ifindex,
 				 struct prefix *prefix,
 				 unsigned int nexthop_num,
@@ -1492,7 +1549,7 @@ void ospf6_asbr_redistribute_add(int type, ifindex_t ifindex,
 			ospf6_route_add_nexthop(match, ifindex, NULL);
 
 		match->path.origin.id = htonl(info->id);
-		ospf6_handle_external_lsa_origination(ospf6, match, prefix);
+		ospf6_asbr_external_originate(ospf6, match);
 
 		ospf6_asbr_status_update(ospf6, ospf6->redistribute);
 
@@ -1538,7 +1595,7 @@ void ospf6_asbr_redistribute_add(int type, ifindex_t ifindex,
 		ospf6_route_add_nexthop(route, ifindex, NULL);
 
 	route = ospf6_route_add(route, ospf6->external_table);
-	ospf6_handle_external_lsa_origination(ospf6, route, prefix);
+	ospf6_asbr_external_originate(ospf6, route);
 
 	ospf6_asbr_status_update(ospf6, ospf6->redistribute);
 
@@ -1653,6 +1710,9 @@ void ospf6_asbr_redistribute_remove(int type, ifindex_t ifindex,
 		zlog_debug("Removing route from external table %pFX",
 			   prefix);
 
+	if (ospf6_ext_pending_anywhere(info))
+		ospf6_ext_pending_del(&ospf6->ext_pending, info);
+
 	ospf6_route_remove(match, ospf6->external_table);
 	XFREE(MTYPE_OSPF6_EXTERNAL_INFO, info);
 
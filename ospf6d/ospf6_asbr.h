@@ -27,6 +27,8 @@
 #include "ospf6_lsa.h"
 /* for struct ospf6_route */
 #include "ospf6_route.h"
+/* for the ospf6_ext_pending list */
+#include "ospf6_top.h"
 
 /* Debug option */
 extern unsigned char conf_debug_ospf6_asbr;
@@ -47,8 +49,13 @@ struct ospf6_external_info {
 
 	ifindex_t ifindex;
 
+	/* on ospf6->ext_pending, waiting to be originated */
+	struct ospf6_ext_pending_item pending;
+	struct ospf6_route *route;
 };
 
+DECLARE_DLIST(ospf6_ext_pending, struct ospf6_external_info, pending);
+
 /* OSPF6 ASBR Summarisation */
 typedef enum {
 	OSPF6_ROUTE_AGGR_NONE = 0,
@@ -178,6 +185,8 @@ int ospf6_external_aggr_config_unset(struct ospf6 *ospf6,
 void ospf6_handle_external_lsa_origination(struct ospf6 *ospf6,
 					       struct ospf6_route *rt,
 					       struct prefix *p);
+/* originates whatever is still waiting for origination pacing */
+void ospf6_asbr_ext_pending_flush(struct ospf6 *ospf6);
 void ospf6_external_aggregator_free(struct ospf6_external_aggr_rt *aggr);
 void ospf6_unset_all_aggr_flag(struct ospf6 *ospf6);
 void ospf6_fill_aggr_route_details(struct ospf6 *ospf6,
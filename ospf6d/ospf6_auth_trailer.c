@@ -24,8 +24,7 @@
 #include "ospf6d.h"
 #include "vty.h"
 #include "command.h"
-#include "md5.h"
-#include "sha256.h"
+#include "hmac.h"
 #include "lib/zlog.h"
 #include "ospf6_message.h"
 #include "ospf6_interface.h"
@@ -39,7 +38,6 @@
 #include "lib/keychain.h"
 
 unsigned char conf_debug_ospf6_auth[2];
-DEFINE_MTYPE_STATIC(OSPF6D, OSPF6_AUTH_HASH_XOR, "OSPF6 auth hash xor");
 
 /*Apad is the hexadecimal value 0x878FE1F3. */
 const uint8_t ospf6_hash_apad_max[KEYCHAIN_MAX_HASH_SIZE] = {
@@ -51,34 +49,6 @@ const uint8_t ospf6_hash_apad_max[KEYCHAIN_MAX_HASH_SIZE] = {
 	0xf3, 0x87, 0x8f, 0xe1, 0xf3, 0x87, 0x8f, 0xe1, 0xf3,
 };
 
-const uint8_t ospf6_hash_ipad_max[KEYCHAIN_ALGO_MAX_INTERNAL_BLK_SIZE] = {
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-	0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36, 0x36,
-};
-
-const uint8_t ospf6_hash_opad_max[KEYCHAIN_ALGO_MAX_INTERNAL_BLK_SIZE] = {
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-	0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c, 0x5c,
-};
-
 void ospf6_auth_hdr_dump_send(struct ospf6_header *ospfh, uint16_t length)
 {
 	struct ospf6_auth_hdr *ospf6_at_hdr;
@@ -142,147 +112,6 @@ void ospf6_auth_hdr_dump_recv(struct ospf6_header *ospfh, uint16_t length,
 	}
 }
 
-unsigned char *ospf6_hash_message_xor(unsigned char *mes1,
-				      unsigned char *mes2,
-				      uint32_t len)
-{
-	unsigned char *result;
-	uint32_t i;
-
-	result = XCALLOC(MTYPE_OSPF6_AUTH_HASH_XOR, len);
-
-	for (i = 0; i < len; i++)
-		result[i] = mes1[i] ^ mes2[i];
-
-	return result;
-}
-
-static void md5_digest(unsigned char *mes, uint32_t len,
-		       unsigned char *digest)
-{
-#ifdef CRYPTO_OPENSSL
-	unsigned int size = KEYCHAIN_MD5_HASH_SIZE;
-	EVP_MD_CTX *ctx;
-#elif CRYPTO_INTERNAL
-	MD5_CTX ctx;
-#endif
-
-#ifdef CRYPTO_OPENSSL
-	ctx = EVP_MD_CTX_new();
-	EVP_DigestInit(ctx, EVP_md5());
-	EVP_DigestUpdate(ctx, mes, len);
-	EVP_DigestFinal(ctx, digest, &size);
-	EVP_MD_CTX_free(ctx);
-#elif CRYPTO_INTERNAL
-	memset(&ctx, 0, sizeof(ctx));
-	MD5Init(&ctx);
-	MD5Update(&ctx, mes, len);
-	MD5Final(digest, &ctx);
-#endif
-}
-
-static void sha256_digest(unsigned char *mes, uint32_t len,
-			  unsigned char *digest)
-{
-#ifdef CRYPTO_OPENSSL
-	unsigned int size = KEYCHAIN_HMAC_SHA256_HASH_SIZE;
-	EVP_MD_CTX *ctx;
-#elif CRYPTO_INTERNAL
-	SHA256_CTX ctx;
-#endif
-
-#ifdef CRYPTO_OPENSSL
-	ctx = EVP_MD_CTX_new();
-	EVP_DigestInit(ctx, EVP_sha256());
-	EVP_DigestUpdate(ctx, mes, len);
-	EVP_DigestFinal(ctx, digest, &size);
-	EVP_MD_CTX_free(ctx);
-#elif CRYPTO_INTERNAL
-	memset(&ctx, 0, sizeof(ctx));
-	SHA256_Init(&ctx);
-	SHA256_Update(&ctx, mes, len);
-	SHA256_Final(digest, &ctx);
-#endif
-}
-
-#ifdef CRYPTO_OPENSSL
-static void sha1_digest(unsigned char *mes, uint32_t len,
-			unsigned char *digest)
-{
-	EVP_MD_CTX *ctx;
-	unsigned int size = KEYCHAIN_HMAC_SHA1_HASH_SIZE;
-
-	ctx = EVP_MD_CTX_new();
-	EVP_DigestInit(ctx, EVP_sha1());
-	EVP_DigestUpdate(ctx, mes, len);
-	EVP_DigestFinal(ctx, digest, &size);
-	EVP_MD_CTX_free(ctx);
-}
-
-static void sha384_digest(unsigned char *mes, uint32_t len,
-			  unsigned char *digest)
-{
-	EVP_MD_CTX *ctx;
-	unsigned int size = KEYCHAIN_HMAC_SHA384_HASH_SIZE;
-
-	ctx = EVP_MD_CTX_new();
-	EVP_DigestInit(ctx, EVP_sha384());
-	EVP_DigestUpdate(ctx, mes, len);
-	EVP_DigestFinal(ctx, digest, &size);
-	EVP_MD_CTX_free(ctx);
-}
-
-static void sha512_digest(unsigned char *mes, uint32_t len,
-			  unsigned char *digest)
-{
-	EVP_MD_CTX *ctx;
-	unsigned int size = KEYCHAIN_HMAC_SHA512_HASH_SIZE;
-
-	ctx = EVP_MD_CTX_new();
-	EVP_DigestInit(ctx, EVP_sha512());
-	EVP_DigestUpdate(ctx, mes, len);
-	EVP_DigestFinal(ctx, digest, &size);
-	EVP_MD_CTX_free(ctx);
-}
-#endif /* CRYPTO_OPENSSL */
-
-static void ospf6_hash_hmac_sha_digest(enum keychain_hash_algo key,
-				       unsigned char *mes, uint32_t len,
-				       unsigned char *digest)
-{
-	if ((key < KEYCHAIN_ALGO_NULL) || (key > KEYCHAIN_ALGO_MAX))
-		return;
-
-	switch (key) {
-	case KEYCHAIN_ALGO_MD5:
-		md5_digest(mes, len, digest);
-		break;
-	case KEYCHAIN_ALGO_HMAC_SHA1:
-#ifdef CRYPTO_OPENSSL
-		sha1_digest(mes, len, digest);
-#endif
-		break;
-	case KEYCHAIN_ALGO_HMAC_SHA256:
-		sha256_digest(mes, len, digest);
-		break;
-	case KEYCHAIN_ALGO_HMAC_SHA384:
-#ifdef CRYPTO_OPENSSL
-		sha384_digest(mes, len, digest);
-#endif
-		break;
-	case KEYCHAIN_ALGO_HMAC_SHA512:
-#ifdef CRYPTO_OPENSSL
-		sha512_digest(mes, len, digest);
-#endif
-		break;
-	case KEYCHAIN_ALGO_NULL:
-	case KEYCHAIN_ALGO_MAX:
-	default:
-		/* no action */
-		break;
-	}
-}
-
 uint16_t ospf6_auth_len_get(struct ospf6_interface *oi)
 {
 	uint16_t at_len = 0;
@@ -682,49 +511,23 @@ void ospf6_auth_update_digest(struct ospf6_interface *oi,
 {
 	static const uint16_t cpid = 1;
 	uint32_t hash_len = keychain_get_hash_len(algo);
-	uint32_t block_s = keychain_get_block_size(algo);
 	uint32_t k_len = strlen(auth_str);
 	uint32_t ks_len = strlen(auth_str) + sizeof(cpid);
-	unsigned char ipad[block_s];
-	unsigned char opad[block_s];
-	unsigned char ko[block_s], ks[ks_len], tmp[hash_len];
-	unsigned char *first = NULL;
-	unsigned char *second = NULL;
-	unsigned char first_mes[block_s + pkt_len];
-	unsigned char second_mes[block_s + pkt_len];
-	unsigned char first_hash[hash_len];
-	unsigned char second_hash[hash_len];
-
-	memset(ko, 0, sizeof(ko));
+	unsigned char ks[ks_len];
+
+	/* RFC 7166 4.1: Ks is the key with the Cryptographic Protocol ID
+	 * appended, hashed if it is longer than the hash.  The pad states
+	 * are kept on the interface as long as the key doesn't change.
+	 */
 	memcpy(ks, auth_str, k_len);
 	memcpy(ks + k_len, &cpid, sizeof(cpid));
-	if (ks_len > hash_len) {
-		ospf6_hash_hmac_sha_digest(algo, ks, ks_len, tmp);
-		memcpy(ko, tmp, hash_len);
-	} else
-		memcpy(ko, ks, ks_len);
-
-	memcpy(ipad, ospf6_hash_ipad_max, block_s);
-	memcpy(opad, ospf6_hash_opad_max, block_s);
-
-	first = ospf6_hash_message_xor((unsigned char *)&ipad, ko, block_s);
-	second = ospf6_hash_message_xor((unsigned char *)&opad, ko, block_s);
-
-	memcpy(first_mes, first, block_s);
-	memcpy(first_mes + block_s, oh, pkt_len);
-
-	ospf6_hash_hmac_sha_digest(algo, first_mes, (block_s + pkt_len),
-				   first_hash);
-
-	memcpy(second_mes, second, block_s);
-	memcpy(second_mes + block_s, first_hash, hash_len);
-
-	ospf6_hash_hmac_sha_digest(algo, second_mes, (block_s + hash_len),
-				   second_hash);
+	if (!hmac_key_set_prehash(&oi->at_data.hmac, algo, ks, ks_len,
+				  hash_len)) {
+		memset(ospf6_auth->data, 0, hash_len);
+		return;
+	}
 
-	memcpy(ospf6_auth->data, second_hash, hash_len);
-	XFREE(MTYPE_OSPF6_AUTH_HASH_XOR, first);
-	XFREE(MTYPE_OSPF6_AUTH_HASH_XOR, second);
+	hmac_compute(&oi->at_data.hmac, oh, pkt_len, ospf6_auth->data);
 }
 
 DEFUN (debug_ospf6_auth,
@@ -292,6 +292,8 @@ void ospf6_interface_delete(struct ospf6_interface *oi)
 
 	ospf6_route_table_delete(oi->route_connected);
 
+	hmac_key_fini(&oi->at_data.hmac);
+
 	/* cut link */
 	oi->interface->info = NULL;
 
@@ -24,6 +24,7 @@
 #include "qobj.h"
 #include "hook.h"
 #include "if.h"
+#include "hmac.h"
 #include "ospf6d.h"
 
 DECLARE_MTYPE(OSPF6_AUTH_MANUAL_KEY);
@@ -43,6 +44,7 @@ struct ospf6_auth_data {
 
 	/* operational data */
 	uint8_t flags; /* Flags related to auth config */
+	struct hmac_key hmac; /* pad states for the key in use */
 
 	/* Counters and Statistics */
 	uint32_t tx_drop; /* Pkt drop due to auth fail while sending */
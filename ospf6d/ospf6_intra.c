@@ -1976,7 +1976,51 @@ static void ospf6_intra_prefix_lsa_remove_update_route(struct ospf6_lsa *lsa,
 
 }
 
-void ospf6_intra_prefix_lsa_remove(struct ospf6_lsa *lsa)
+/* Whether the LSA has the prefix, and it is to be used */
+static bool ospf6_intra_prefix_lsa_has(struct ospf6_lsa *lsa,
+				       const struct prefix *p)
+{
+	struct ospf6_intra_prefix_lsa *intra_prefix_lsa;
+	struct prefix prefix;
+	int prefix_num;
+	struct ospf6_prefix *op;
+	char *start, *current, *end;
+
+	intra_prefix_lsa =
+		(struct ospf6_intra_prefix_lsa *)OSPF6_LSA_HEADER_END(
+			lsa->header);
+
+	prefix_num = ntohs(intra_prefix_lsa->prefix_num);
+	start = (caddr_t)intra_prefix_lsa
+		+ sizeof(struct ospf6_intra_prefix_lsa);
+	end = OSPF6_LSA_END(lsa->header);
+	for (current = start; current < end; current += OSPF6_PREFIX_SIZE(op)) {
+		op = (struct ospf6_prefix *)current;
+		if (prefix_num == 0)
+			break;
+		if (end < current + OSPF6_PREFIX_SIZE(op))
+			break;
+		prefix_num--;
+
+		if (CHECK_FLAG(op->prefix_options, OSPF6_PREFIX_OPTION_NU))
+			continue;
+		if (op->prefix_length != p->prefixlen)
+			continue;
+
+		memset(&prefix, 0, sizeof(prefix));
+		prefix.family = AF_INET6;
+		prefix.prefixlen = op->prefix_length;
+		ospf6_prefix_in6_addr(&prefix.u.prefix6, intra_prefix_lsa, op);
+		if (prefix_same(&prefix, p))
+			return true;
+	}
+
+	return false;
+}
+
+/* Removes the routes of the LSA's prefixes, except of the ones keep has */
+static void ospf6_intra_prefix_lsa_remove_prefixes(struct ospf6_lsa *lsa,
+						   struct ospf6_lsa *keep)
 {
 	struct ospf6_area *oa;
 	struct ospf6_intra_prefix_lsa *intra_prefix_lsa;
@@ -1987,9 +2031,6 @@ void ospf6_intra_prefix_lsa_remove(struct ospf6_lsa *lsa)
 	char *start, *current, *end;
 	char buf[PREFIX2STR_BUFFER];
 
-	if (IS_OSPF6_DEBUG_EXAMIN(INTRA_PREFIX))
-		zlog_debug("%s: %s disappearing", __func__, lsa->name);
-
 	oa = OSPF6_AREA(lsa->lsdb->data);
 
 	intra_prefix_lsa =
@@ -2013,6 +2054,9 @@ void ospf6_intra_prefix_lsa_remove(struct ospf6_lsa *lsa)
 		prefix.prefixlen = op->prefix_length;
 		ospf6_prefix_in6_addr(&prefix.u.prefix6, intra_prefix_lsa, op);
 
+		if (keep && ospf6_intra_prefix_lsa_has(keep, &prefix))
+			continue;
+
 		route = ospf6_route_lookup(&prefix, oa->route_table);
 		if (route == NULL)
 			continue;
@@ -2063,6 +2107,44 @@ void ospf6_intra_prefix_lsa_remove(struct ospf6_lsa *lsa)
 		zlog_debug("Trailing garbage ignored");
 }
 
+void ospf6_intra_prefix_lsa_remove(struct ospf6_lsa *lsa)
+{
+	if (IS_OSPF6_DEBUG_EXAMIN(INTRA_PREFIX))
+		zlog_debug("%s: %s disappearing", __func__, lsa->name);
+
+	ospf6_intra_prefix_lsa_remove_prefixes(lsa, NULL);
+}
+
+/*
+ * A new instance of an LSA: routes for prefixes that are gone are removed,
+ * the others are updated in place.  Routes that end up the same are not
+ * sent to the global table and zebra again.
+ */
+void ospf6_intra_prefix_lsa_replace(struct ospf6_lsa *old,
+				    struct ospf6_lsa *lsa)
+{
+	struct ospf6_intra_prefix_lsa *old_ipl, *ipl;
+
+	old_ipl = (struct ospf6_intra_prefix_lsa *)OSPF6_LSA_HEADER_END(
+		old->header);
+	ipl = (struct ospf6_intra_prefix_lsa *)OSPF6_LSA_HEADER_END(
+		lsa->header);
+
+	if (IS_OSPF6_DEBUG_EXAMIN(INTRA_PREFIX))
+		zlog_debug("%s: %s replaced", __func__, lsa->name);
+
+	if (old_ipl->ref_type != ipl->ref_type
+	    || old_ipl->ref_id != ipl->ref_id
+	    || old_ipl->ref_adv_router != ipl->ref_adv_router) {
+		ospf6_intra_prefix_lsa_remove(old);
+		ospf6_intra_prefix_lsa_add(lsa);
+		return;
+	}
+
+	ospf6_intra_prefix_lsa_remove_prefixes(old, lsa);
+	ospf6_intra_prefix_lsa_add(lsa);
+}
+
 void ospf6_intra_route_calculation(struct ospf6_area *oa)
 {
 	struct ospf6_route *route, *nroute;
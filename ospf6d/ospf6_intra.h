@@ -242,6 +242,8 @@ extern void ospf6_intra_prefix_lsa_originate_transit(struct thread *thread);
 extern void ospf6_intra_prefix_lsa_originate_stub(struct thread *thread);
 extern void ospf6_intra_prefix_lsa_add(struct ospf6_lsa *lsa);
 extern void ospf6_intra_prefix_lsa_remove(struct ospf6_lsa *lsa);
+extern void ospf6_intra_prefix_lsa_replace(struct ospf6_lsa *old,
+					   struct ospf6_lsa *lsa);
 extern void ospf6_orig_as_external_lsa(struct thread *thread);
 extern void ospf6_intra_route_calculation(struct ospf6_area *oa);
 extern void ospf6_intra_brouter_calculation(struct ospf6_area *oa);
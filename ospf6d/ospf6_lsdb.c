@@ -143,6 +143,8 @@ void ospf6_lsdb_add(struct ospf6_lsa *lsa, struct ospf6_lsdb *lsdb)
 			} else if (OSPF6_LSA_IS_MAXAGE(old)) {
 				if (lsdb->hook_add)
 					(*lsdb->hook_add)(lsa);
+			} else if (lsdb->hook_replace) {
+				(*lsdb->hook_replace)(old, lsa);
 			} else {
 				if (lsdb->hook_remove)
 					(*lsdb->hook_remove)(old);
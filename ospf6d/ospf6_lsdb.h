@@ -32,6 +32,8 @@ struct ospf6_lsdb {
 	uint32_t stats[OSPF6_LSTYPE_SIZE];
 	void (*hook_add)(struct ospf6_lsa *);
 	void (*hook_remove)(struct ospf6_lsa *);
+	/* a changed instance replaces old, instead of remove + add if set */
+	void (*hook_replace)(struct ospf6_lsa *old, struct ospf6_lsa *lsa);
 };
 
 /* Function Prototypes */
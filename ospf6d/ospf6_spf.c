@@ -80,18 +80,12 @@ static unsigned int ospf6_spf_get_ifindex_from_nh(struct ospf6_vertex *v)
 	return 0;
 }
 
-static int ospf6_vertex_cmp(const struct ospf6_vertex *va,
-		const struct ospf6_vertex *vb)
+/* ascending order by cost, then hops */
+static uint64_t ospf6_vertex_key(const struct ospf6_vertex *v)
 {
-	/* ascending order */
-	if (va->cost != vb->cost)
-		return (va->cost - vb->cost);
-	if (va->hops != vb->hops)
-		return (va->hops - vb->hops);
-	return 0;
+	return ((uint64_t)v->cost << 32) | v->hops;
 }
-DECLARE_SKIPLIST_NONUNIQ(vertex_pqueue, struct ospf6_vertex, pqi,
-		ospf6_vertex_cmp);
+DECLARE_RADIXHEAP(vertex_pqueue, struct ospf6_vertex, pqi, ospf6_vertex_key);
 
 static int ospf6_vertex_id_cmp(void *a, void *b)
 {
@@ -424,6 +424,9 @@ static struct ospf6 *ospf6_create(const char *name)
 	 * 1::1, this happened because of LS ID 0.
 	 */
 	o->external_id = OSPF6_EXT_INIT_LS_ID;
+	ospf6_ext_pending_init(&o->ext_pending);
+	o->ext_pacing_burst = OSPF6_EXT_PACING_BURST_DEFAULT;
+	o->ext_pacing_interval = OSPF6_EXT_PACING_INTERVAL_DEFAULT;
 
 	o->write_oi_count = OSPF6_WRITE_INTERFACE_COUNT_DEFAULT;
 	o->ref_bandwidth = OSPF6_REFERENCE_BANDWIDTH;
@@ -526,6 +529,7 @@ void ospf6_delete(struct ospf6 *o)
 	ospf6_route_table_delete(o->brouter_table);
 
 	ospf6_route_table_delete(o->external_table);
+	ospf6_ext_pending_fini(&o->ext_pending);
 
 	ospf6_distance_reset(o);
 	route_table_finish(o->distance_table);
@@ -571,6 +575,9 @@ static void ospf6_disable(struct ospf6 *o)
 		THREAD_OFF(o->t_distribute_update);
 		THREAD_OFF(o->t_ospf6_receive);
 		THREAD_OFF(o->t_external_aggr);
+		THREAD_OFF(o->t_ext_pending);
+		while (ospf6_ext_pending_pop(&o->ext_pending))
+			;
 		THREAD_OFF(o->gr_info.t_grace_period);
 		THREAD_OFF(o->t_write);
 		THREAD_OFF(o->t_abr_task);
@@ -973,6 +980,32 @@ DEFUN (no_ospf6_timers_lsa,
 }
 
 
+DEFPY (ospf6_timers_lsa_external_pacing,
+       ospf6_timers_lsa_external_pacing_cmd,
+       "[no] timers lsa external-pacing ![(1-100000)$burst (1-60000)$interval]",
+       NO_STR
+       "Adjust routing timers\n"
+       "OSPF6 LSA timers\n"
+       "Pace origination of AS-External-LSAs for redistributed routes\n"
+       "Number of LSAs originated at a time\n"
+       "Interval between batches in milliseconds\n")
+{
+	VTY_DECLVAR_CONTEXT(ospf6, ospf6);
+
+	if (no) {
+		ospf6->ext_pacing_burst = OSPF6_EXT_PACING_BURST_DEFAULT;
+		ospf6->ext_pacing_interval = OSPF6_EXT_PACING_INTERVAL_DEFAULT;
+		/* nothing is left waiting for a run that won't come */
+		ospf6_asbr_ext_pending_flush(ospf6);
+	} else {
+		ospf6->ext_pacing_burst = burst;
+		ospf6->ext_pacing_interval = interval;
+	}
+
+	return CMD_SUCCESS;
+}
+
+
 DEFUN (ospf6_distance,
        ospf6_distance_cmd,
        "distance (1-255)",
@@ -1335,6 +1368,12 @@ static void ospf6_show(struct vty *vty, struct ospf6 *o, json_object *json,
 		/* XXX */
 		json_object_int_add(json, "lsaMinimumArrivalMsecs",
 				    o->lsa_minarrival);
+		json_object_int_add(json, "externalLsaPacingBurst",
+				    o->ext_pacing_burst);
+		json_object_int_add(json, "externalLsaPacingIntervalMsecs",
+				    o->ext_pacing_interval);
+		json_object_int_add(json, "externalLsaPending",
+				    ospf6_ext_pending_count(&o->ext_pending));
 
 		/* Show SPF parameters */
 		json_object_int_add(json, "spfScheduleDelayMsecs",
@@ -1433,6 +1472,11 @@ static void ospf6_show(struct vty *vty, struct ospf6 *o, json_object *json,
 		/* XXX */
 		vty_out(vty, " LSA minimum arrival %d msecs\n",
 			o->lsa_minarrival);
+		if (o->ext_pacing_burst)
+			vty_out(vty,
+				" External LSA origination paced, %u per %u msecs, %zu pending\n",
+				o->ext_pacing_burst, o->ext_pacing_interval,
+				ospf6_ext_pending_count(&o->ext_pending));
 
 		vty_out(vty, " Maximum-paths %u\n", o->max_multipath);
 		vty_out(vty, " Administrative distance %u\n",
@@ -2305,6 +2349,10 @@ static int config_write_ospf6(struct vty *vty)
 		if (ospf6->lsa_minarrival != OSPF_MIN_LS_ARRIVAL)
 			vty_out(vty, " timers lsa min-arrival %d\n",
 				ospf6->lsa_minarrival);
+		if (ospf6->ext_pacing_burst)
+			vty_out(vty, " timers lsa external-pacing %u %u\n",
+				ospf6->ext_pacing_burst,
+				ospf6->ext_pacing_interval);
 
 		/* ECMP max path config */
 		if (ospf6->max_multipath != MULTIPATH_NUM)
@@ -2370,6 +2418,7 @@ void ospf6_top_init(void)
 	/* LSA timers commands */
 	install_element(OSPF6_NODE, &ospf6_timers_lsa_cmd);
 	install_element(OSPF6_NODE, &no_ospf6_timers_lsa_cmd);
+	install_element(OSPF6_NODE, &ospf6_timers_lsa_external_pacing_cmd);
 
 	install_element(OSPF6_NODE, &ospf6_interface_area_cmd);
 	install_element(OSPF6_NODE, &no_ospf6_interface_area_cmd);
@@ -23,6 +23,10 @@
 
 #include "qobj.h"
 #include "routemap.h"
+#include "typesafe.h"
+
+PREDECL_DLIST(ospf6_ext_pending);
+
 struct ospf6_master {
 
 	/* OSPFv3 instance. */
@@ -139,6 +143,17 @@ struct ospf6 {
 #define OSPF6_EXT_INIT_LS_ID 1
 	uint32_t external_id;
 
+	/* Redistributed routes waiting for their AS-External-LSA, when
+	 * origination is paced (ext_pacing_burst != 0).  A route updated
+	 * again while queued is originated only once.
+	 */
+	struct ospf6_ext_pending_head ext_pending;
+	struct thread *t_ext_pending;
+#define OSPF6_EXT_PACING_BURST_DEFAULT 0
+#define OSPF6_EXT_PACING_INTERVAL_DEFAULT 100
+	unsigned int ext_pacing_burst;	  /* LSAs per run, 0 = not paced */
+	unsigned int ext_pacing_interval; /* between runs, in milliseconds */
+
 	/* OSPF6 redistribute configuration */
 	struct list *redist[ZEBRA_ROUTE_MAX + 1];
 
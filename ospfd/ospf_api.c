@@ -415,6 +415,31 @@ struct msg *msg_read(int fd)
 	return msg;
 }
 
+unsigned int msg_fifo_frame(struct msg_fifo *fifo, struct stream *s)
+{
+	struct msg *msg;
+	unsigned int n = 0;
+	uint16_t l;
+
+	while ((msg = msg_fifo_head(fifo))) {
+		l = ntohs(msg->hdr.msglen);
+		if (l > OSPF_MAX_LSA_SIZE) {
+			zlog_warn("%s: wrong LSA size %d", __func__, l);
+			msg_free(msg_fifo_pop(fifo));
+			continue;
+		}
+
+		if (STREAM_WRITEABLE(s) < sizeof(struct apimsghdr) + l)
+			break;
+
+		stream_put(s, &msg->hdr, sizeof(struct apimsghdr));
+		stream_put(s, STREAM_DATA(msg->s), l);
+		msg_free(msg_fifo_pop(fifo));
+		n++;
+	}
+	return n;
+}
+
 int msg_write(int fd, struct msg *msg)
 {
 	uint8_t buf[OSPF_API_MAX_MSG_SIZE];
@@ -103,6 +103,9 @@ extern struct msg *msg_fifo_pop(struct msg_fifo *fifo);
 extern struct msg *msg_fifo_head(struct msg_fifo *fifo);
 extern void msg_fifo_flush(struct msg_fifo *fifo);
 extern void msg_fifo_free(struct msg_fifo *fifo);
+/* Frame as many messages from the head of fifo into s as fit, removing and
+ * freeing them.  Returns the number of messages framed. */
+extern unsigned int msg_fifo_frame(struct msg_fifo *fifo, struct stream *s);
 
 /* -----------------------------------------------------------
  * Specific message type and format definitions
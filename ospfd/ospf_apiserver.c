@@ -60,6 +60,12 @@
 #include "ospfd/ospf_api.h"
 #include "ospfd/ospf_apiserver.h"
 
+/* LSDB sync LSAs queued ahead of the async socket */
+#define OSPF_APISERVER_SYNC_BATCH 64
+
+/* async messages written per write() */
+#define OSPF_APISERVER_ASYNC_WBUF 65536
+
 /* This is an implementation of an API to the OSPF daemon that allows
  * external applications to access the OSPF daemon through socket
  * connections. The application can use this API to inject its own
@@ -272,6 +278,10 @@ struct ospf_apiserver *ospf_apiserver_new(int fd_sync, int fd_async)
 	new->t_sync_write = NULL;
 	new->t_async_write = NULL;
 
+	new->sync_lsas = NULL;
+	new->sync_pos = new->sync_count = new->sync_alloc = 0;
+	new->out_async_buf = stream_new(OSPF_APISERVER_ASYNC_WBUF);
+
 	new->filter->typemask = 0; /* filter all LSAs */
 	new->filter->origin = ANY_ORIGIN;
 	new->filter->num_areas = 0;
@@ -347,6 +357,11 @@ void ospf_apiserver_free(struct ospf_apiserver *apiserv)
 	/* Free fifos */
 	msg_fifo_free(apiserv->out_sync_fifo);
 	msg_fifo_free(apiserv->out_async_fifo);
+	stream_free(apiserv->out_async_buf);
+
+	while (apiserv->sync_pos < apiserv->sync_count)
+		ospf_lsa_unlock(&apiserv->sync_lsas[apiserv->sync_pos++].lsa);
+	XFREE(MTYPE_OSPF_APISERVER, apiserv->sync_lsas);
 
 	/* Clear temporary strage for LSA instances to be refreshed. */
 	ospf_lsdb_delete_all(&apiserv->reserve);
@@ -482,10 +497,43 @@ out:
 }
 
 
+/* Queue LSAs of pending LSDB syncs while the async fifo is short. */
+static void ospf_apiserver_sync_fill(struct ospf_apiserver *apiserv)
+{
+	struct apiserver_sync_lsa *sl;
+	struct msg *msg;
+
+	while (apiserv->sync_pos < apiserv->sync_count
+	       && apiserv->out_async_fifo->count < OSPF_APISERVER_SYNC_BATCH) {
+		sl = &apiserv->sync_lsas[apiserv->sync_pos++];
+
+		/* replaced or flushed since, the client has been told */
+		if (!CHECK_FLAG(sl->lsa->flags, OSPF_LSA_DISCARD)) {
+			msg = new_msg_lsa_change_notify(
+				MSG_LSA_UPDATE_NOTIFY, sl->seqnum, sl->ifaddr,
+				sl->area_id, sl->lsa->flags & OSPF_LSA_SELF,
+				sl->lsa->data);
+			if (msg)
+				msg_fifo_push(apiserv->out_async_fifo, msg);
+			else
+				zlog_warn("%s: new_msg_update failed",
+					  __func__);
+		}
+		ospf_lsa_unlock(&sl->lsa);
+	}
+
+	if (apiserv->sync_pos == apiserv->sync_count) {
+		XFREE(MTYPE_OSPF_APISERVER, apiserv->sync_lsas);
+		apiserv->sync_pos = apiserv->sync_count = 0;
+		apiserv->sync_alloc = 0;
+	}
+}
+
 void ospf_apiserver_async_write(struct thread *thread)
 {
 	struct ospf_apiserver *apiserv;
-	struct msg *msg;
+	struct stream *s;
+	ssize_t nwr;
 	int fd;
 	int rc = -1;
 
@@ -506,29 +554,34 @@ void ospf_apiserver_async_write(struct thread *thread)
 			   &apiserv->peer_async.sin_addr,
 			   ntohs(apiserv->peer_async.sin_port));
 
-	/* Check whether there is really a message in the fifo. */
-	msg = msg_fifo_pop(apiserv->out_async_fifo);
-	if (!msg) {
-		zlog_warn("API: %s: No message in Async-FIFO?", __func__);
-		return;
+	/* Write out a batch of messages at a time; the socket is non-blocking
+	 * so a slow client only holds up its own queue.
+	 */
+	s = apiserv->out_async_buf;
+	if (!STREAM_READABLE(s)) {
+		stream_reset(s);
+		ospf_apiserver_sync_fill(apiserv);
+		msg_fifo_frame(apiserv->out_async_fifo, s);
 	}
 
-	if (IS_DEBUG_OSPF_EVENT)
-		msg_print(msg);
-
-	rc = msg_write(fd, msg);
-
-	/* Once a message is dequeued, it should be freed anyway. */
-	msg_free(msg);
+	rc = 0;
+	if (!STREAM_READABLE(s))
+		goto out;
 
-	if (rc < 0) {
-		zlog_warn("%s: write failed on fd=%d", __func__, fd);
+	nwr = write(fd, stream_pnt(s), STREAM_READABLE(s));
+	if (nwr < 0 && ERRNO_IO_RETRY(errno))
+		nwr = 0;
+	else if (nwr <= 0) {
+		zlog_warn("%s: write failed on fd=%d: %s", __func__, fd,
+			  nwr ? safe_strerror(errno) : "connection closed");
+		rc = -1;
 		goto out;
 	}
+	stream_forward_getp(s, nwr);
 
-
-	/* If more messages are in async message fifo, schedule write thread. */
-	if (msg_fifo_head(apiserv->out_async_fifo)) {
+	/* More data buffered, queued or still to sync: schedule write thread */
+	if (STREAM_READABLE(s) || msg_fifo_head(apiserv->out_async_fifo)
+	    || apiserv->sync_pos < apiserv->sync_count) {
 		ospf_apiserver_event(OSPF_APISERVER_ASYNC_WRITE,
 				     apiserv->fd_async, apiserv);
 	}
@@ -668,6 +721,8 @@ void ospf_apiserver_accept(struct thread *thread)
 	}
 #endif /* USE_ASYNC_READ */
 
+	set_nonblocking(new_async_sock);
+
 	/* Allocate new server-side connection structure */
 	apiserv = ospf_apiserver_new(new_sync_sock, new_async_sock);
 
@@ -1183,13 +1238,12 @@ static int apiserver_sync_callback(struct ospf_lsa *lsa, void *p_arg,
 				   int int_arg)
 {
 	struct ospf_apiserver *apiserv;
+	struct apiserver_sync_lsa *sl;
 	int seqnum;
-	struct msg *msg;
 	struct param_t {
 		struct ospf_apiserver *apiserv;
 		struct lsa_filter_type *filter;
 	} * param;
-	int rc = -1;
 
 	/* Sanity check */
 	assert(lsa->data);
@@ -1216,28 +1270,23 @@ static int apiserver_sync_callback(struct ospf_lsa *lsa, void *p_arg,
 			ifaddr = lsa->oi->address->u.prefix4;
 		}
 
-		msg = new_msg_lsa_change_notify(
-			MSG_LSA_UPDATE_NOTIFY, seqnum, ifaddr, area_id,
-			lsa->flags & OSPF_LSA_SELF, lsa->data);
-		if (!msg) {
-			zlog_warn("%s: new_msg_update failed", __func__);
-#ifdef NOTYET
-			/* Cannot allocate new message. What should we do? */
-			/*        ospf_apiserver_free (apiserv);*/ /* Do nothing
-								      here XXX
-								      */
-#endif
-			goto out;
+		/* Queue LSA, it is sent as the async socket drains */
+		if (apiserv->sync_count == apiserv->sync_alloc) {
+			apiserv->sync_alloc = MAX(apiserv->sync_alloc * 2,
+						  OSPF_APISERVER_SYNC_BATCH);
+			apiserv->sync_lsas = XREALLOC(
+				MTYPE_OSPF_APISERVER, apiserv->sync_lsas,
+				apiserv->sync_alloc * sizeof(*sl));
 		}
 
-		/* Send LSA */
-		ospf_apiserver_send_msg(apiserv, msg);
-		msg_free(msg);
+		sl = &apiserv->sync_lsas[apiserv->sync_count++];
+		sl->lsa = ospf_lsa_lock(lsa);
+		sl->seqnum = seqnum;
+		sl->area_id = area_id;
+		sl->ifaddr = ifaddr;
 	}
-	rc = 0;
 
-out:
-	return rc;
+	return 0;
 }
 
 int ospf_apiserver_handle_sync_lsdb(struct ospf_apiserver *apiserv,
@@ -1338,6 +1387,11 @@ int ospf_apiserver_handle_sync_lsdb(struct ospf_apiserver *apiserv,
 							seqnum);
 	}
 
+	/* Start sending the LSAs */
+	if (apiserv->sync_pos < apiserv->sync_count)
+		ospf_apiserver_event(OSPF_APISERVER_ASYNC_WRITE,
+				     apiserv->fd_async, apiserv);
+
 	/* Send a reply back to client with return code */
 	rc = ospf_apiserver_send_reply(apiserv, seqnum, rc);
 	return rc;
@@ -38,6 +38,14 @@ struct registered_opaque_type {
 
 
 /* Server instance for each accepted client connection. */
+/* LSA still to be sent to a client for an LSDB sync request */
+struct apiserver_sync_lsa {
+	struct ospf_lsa *lsa; /* locked */
+	uint32_t seqnum;
+	struct in_addr area_id;
+	struct in_addr ifaddr;
+};
+
 struct ospf_apiserver {
 	/* Socket connections for synchronous commands and asynchronous
 	   notifications */
@@ -73,6 +81,15 @@ struct ospf_apiserver {
 #endif /* USE_ASYNC_READ */
 	struct thread *t_sync_write;
 	struct thread *t_async_write;
+
+	/* LSAs for LSDB sync requests, fed into out_async_fifo as it drains
+	   so a large LSDB doesn't have to be queued up at once. */
+	struct apiserver_sync_lsa *sync_lsas;
+	size_t sync_pos, sync_count, sync_alloc;
+
+	/* Async messages framed for the (non-blocking) socket, partially
+	   written up to getp. */
+	struct stream *out_async_buf;
 };
 
 enum ospf_apiserver_event {
@@ -541,6 +541,8 @@ static int ospf_ase_compare_tables(struct ospf *ospf,
 	struct route_node *rn, *new_rn;
 	struct ospf_route * or ;
 
+	ospf_zebra_batch_begin();
+
 	/* Remove deleted routes */
 	for (rn = route_top(old_external_route); rn; rn = route_next(rn))
 		if ((or = rn->info)) {
@@ -561,6 +563,8 @@ static int ospf_ase_compare_tables(struct ospf *ospf,
 				ospf_zebra_add(
 					ospf, (struct prefix_ipv4 *)&rn->p, or);
 
+	ospf_zebra_batch_commit();
+
 	return 0;
 }
 
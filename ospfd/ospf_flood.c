@@ -22,6 +22,7 @@
 #include <zebra.h>
 
 #include "monotime.h"
+#include "jhash.h"
 #include "linklist.h"
 #include "prefix.h"
 #include "if.h"
@@ -48,6 +49,8 @@
 #include "ospfd/ospf_zebra.h"
 #include "ospfd/ospf_dump.h"
 
+DEFINE_MTYPE_STATIC(OSPFD, OSPF_LS_RXMT, "OSPF LS retransmit entry");
+
 extern struct zclient *zclient;
 
 /* Do the LSA acking specified in table 19, Section 13.5, row 2
@@ -887,91 +890,132 @@ struct ospf_lsa *ospf_ls_request_new(struct lsa_header *lsah)
 
 
 /* Management functions for neighbor's ls-retransmit list. */
-unsigned long ospf_ls_retransmit_count(struct ospf_neighbor *nbr)
+static int ospf_ls_rxmt_cmp(const struct ospf_ls_rxmt *a,
+			    const struct ospf_ls_rxmt *b)
+{
+	const struct lsa_header *ha = a->lsa->data, *hb = b->lsa->data;
+
+	if (ha->type != hb->type)
+		return numcmp(ha->type, hb->type);
+	if (ha->id.s_addr != hb->id.s_addr)
+		return numcmp(ntohl(ha->id.s_addr), ntohl(hb->id.s_addr));
+	return numcmp(ntohl(ha->adv_router.s_addr),
+		      ntohl(hb->adv_router.s_addr));
+}
+
+static uint32_t ospf_ls_rxmt_hash(const struct ospf_ls_rxmt *rxmt)
+{
+	const struct lsa_header *h = rxmt->lsa->data;
+
+	return jhash_3words(h->type, h->id.s_addr, h->adv_router.s_addr,
+			    0x72786d74);
+}
+
+DECLARE_HASH(ospf_ls_rxmt_hash, struct ospf_ls_rxmt, hash_item,
+	     ospf_ls_rxmt_cmp, ospf_ls_rxmt_hash);
+
+void ospf_ls_retransmit_init(struct ospf_neighbor *nbr)
+{
+	ospf_ls_rxmt_hash_init(&nbr->ls_rxmt);
+	ospf_ls_rxmt_queue_init(&nbr->ls_rxmt_queue);
+}
+
+void ospf_ls_retransmit_fini(struct ospf_neighbor *nbr)
+{
+	assert(ospf_ls_rxmt_queue_count(&nbr->ls_rxmt_queue) == 0);
+
+	ospf_ls_rxmt_hash_fini(&nbr->ls_rxmt);
+	ospf_ls_rxmt_queue_fini(&nbr->ls_rxmt_queue);
+}
+
+static struct ospf_ls_rxmt *ospf_ls_rxmt_find(struct ospf_neighbor *nbr,
+					      struct ospf_lsa *lsa)
+{
+	struct ospf_ls_rxmt key = {.lsa = lsa};
+
+	return ospf_ls_rxmt_hash_find(&nbr->ls_rxmt, &key);
+}
+
+static void ospf_ls_rxmt_free(struct ospf_neighbor *nbr,
+			      struct ospf_ls_rxmt *rxmt)
 {
-	return ospf_lsdb_count_all(&nbr->ls_rxmt);
+	ospf_ls_rxmt_hash_del(&nbr->ls_rxmt, rxmt);
+	ospf_ls_rxmt_queue_del(&nbr->ls_rxmt_queue, rxmt);
+	rxmt->lsa->retransmit_counter--;
+	ospf_lsa_unlock(&rxmt->lsa);
+	XFREE(MTYPE_OSPF_LS_RXMT, rxmt);
 }
 
-unsigned long ospf_ls_retransmit_count_self(struct ospf_neighbor *nbr,
-					    int lsa_type)
+unsigned long ospf_ls_retransmit_count(struct ospf_neighbor *nbr)
 {
-	return ospf_lsdb_count_self(&nbr->ls_rxmt, lsa_type);
+	return ospf_ls_rxmt_queue_count(&nbr->ls_rxmt_queue);
 }
 
 int ospf_ls_retransmit_isempty(struct ospf_neighbor *nbr)
 {
-	return ospf_lsdb_isempty(&nbr->ls_rxmt);
+	return ospf_ls_retransmit_count(nbr) == 0;
 }
 
 /* Add LSA to be retransmitted to neighbor's ls-retransmit list. */
 void ospf_ls_retransmit_add(struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
+	struct ospf_ls_rxmt *rxmt;
 	struct ospf_lsa *old;
 
-	old = ospf_ls_retransmit_lookup(nbr, lsa);
+	rxmt = ospf_ls_rxmt_find(nbr, lsa);
+	old = rxmt ? rxmt->lsa : NULL;
 
 	if (ospf_lsa_more_recent(old, lsa) < 0) {
 		if (old) {
-			old->retransmit_counter--;
 			if (IS_DEBUG_OSPF(lsa, LSA_FLOODING))
 				zlog_debug("RXmtL(%lu)--, NBR(%pI4(%s)), LSA[%s]",
-					   ospf_ls_retransmit_count(nbr),
+					   ospf_ls_retransmit_count(nbr) - 1,
 					   &nbr->router_id,
 					   ospf_get_name(nbr->oi->ospf),
 					   dump_lsa_key(old));
-			ospf_lsdb_delete(&nbr->ls_rxmt, old);
+			ospf_ls_rxmt_free(nbr, rxmt);
 		}
+
+		rxmt = XCALLOC(MTYPE_OSPF_LS_RXMT, sizeof(*rxmt));
+		rxmt->lsa = ospf_lsa_lock(lsa);
+		monotime(&rxmt->sent);
 		lsa->retransmit_counter++;
-		/*
-		 * We cannot make use of the newly introduced callback function
-		 * "lsdb->new_lsa_hook" to replace debug output below, just
-		 * because
-		 * it seems no simple and smart way to pass neighbor information
-		 * to
-		 * the common function "ospf_lsdb_add()" -- endo.
-		 */
+		ospf_ls_rxmt_hash_add(&nbr->ls_rxmt, rxmt);
+		ospf_ls_rxmt_queue_add_tail(&nbr->ls_rxmt_queue, rxmt);
+
 		if (IS_DEBUG_OSPF(lsa, LSA_FLOODING))
 			zlog_debug("RXmtL(%lu)++, NBR(%pI4(%s)), LSA[%s]",
 				   ospf_ls_retransmit_count(nbr),
 				   &nbr->router_id,
 				   ospf_get_name(nbr->oi->ospf),
 				   dump_lsa_key(lsa));
-		ospf_lsdb_add(&nbr->ls_rxmt, lsa);
 	}
 }
 
 /* Remove LSA from neibghbor's ls-retransmit list. */
 void ospf_ls_retransmit_delete(struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
-	if (ospf_ls_retransmit_lookup(nbr, lsa)) {
-		lsa->retransmit_counter--;
+	struct ospf_ls_rxmt *rxmt;
+
+	rxmt = ospf_ls_rxmt_find(nbr, lsa);
+	if (rxmt && rxmt->lsa == lsa) {
 		if (IS_DEBUG_OSPF(lsa, LSA_FLOODING)) /* -- endo. */
 			zlog_debug("RXmtL(%lu)--, NBR(%pI4(%s)), LSA[%s]",
-				   ospf_ls_retransmit_count(nbr),
+				   ospf_ls_retransmit_count(nbr) - 1,
 				   &nbr->router_id,
 				   ospf_get_name(nbr->oi->ospf),
 				   dump_lsa_key(lsa));
-		ospf_lsdb_delete(&nbr->ls_rxmt, lsa);
+		ospf_ls_rxmt_free(nbr, rxmt);
 	}
 }
 
 /* Clear neighbor's ls-retransmit list. */
 void ospf_ls_retransmit_clear(struct ospf_neighbor *nbr)
 {
-	struct ospf_lsdb *lsdb;
-	int i;
-
-	lsdb = &nbr->ls_rxmt;
+	struct ospf_ls_rxmt *rxmt;
 
-	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++) {
-		struct route_table *table = lsdb->type[i].db;
-		struct route_node *rn;
-		struct ospf_lsa *lsa;
-
-		for (rn = route_top(table); rn; rn = route_next(rn))
-			if ((lsa = rn->info) != NULL)
-				ospf_ls_retransmit_delete(nbr, lsa);
-	}
+	while ((rxmt = ospf_ls_rxmt_queue_first(&nbr->ls_rxmt_queue)))
+		ospf_ls_retransmit_delete(nbr, rxmt->lsa);
 
 	ospf_lsa_unlock(&nbr->ls_req_last);
 	nbr->ls_req_last = NULL;
@@ -981,7 +1025,36 @@ void ospf_ls_retransmit_clear(struct ospf_neighbor *nbr)
 struct ospf_lsa *ospf_ls_retransmit_lookup(struct ospf_neighbor *nbr,
 					   struct ospf_lsa *lsa)
 {
-	return ospf_lsdb_lookup(&nbr->ls_rxmt, lsa);
+	struct ospf_ls_rxmt *rxmt;
+
+	rxmt = ospf_ls_rxmt_find(nbr, lsa);
+	return rxmt ? rxmt->lsa : NULL;
+}
+
+/*
+ * LSAs sent at least interval seconds ago, these are moved to the tail of
+ * the queue as if they have been sent now.
+ */
+void ospf_ls_retransmit_due(struct ospf_neighbor *nbr, int interval,
+			    struct list *update)
+{
+	struct ospf_ls_rxmt *rxmt;
+	struct timeval now, age;
+	unsigned long count = ospf_ls_retransmit_count(nbr);
+
+	monotime(&now);
+
+	while (count--) {
+		rxmt = ospf_ls_rxmt_queue_first(&nbr->ls_rxmt_queue);
+		timersub(&now, &rxmt->sent, &age);
+		if (age.tv_sec < interval)
+			break;
+
+		listnode_add(update, rxmt->lsa);
+		rxmt->sent = now;
+		ospf_ls_rxmt_queue_del(&nbr->ls_rxmt_queue, rxmt);
+		ospf_ls_rxmt_queue_add_tail(&nbr->ls_rxmt_queue, rxmt);
+	}
 }
 
 static void ospf_ls_retransmit_delete_nbr_if(struct ospf_interface *oi,
@@ -2613,9 +2613,71 @@ struct ospf_lsa *ospf_external_lsa_refresh(struct ospf *ospf,
 
 /* LSA installation functions. */
 
+/* Next link of a router-LSA that is not a stub link, or NULL. */
+static struct router_lsa_link *ospf_router_lsa_next_transit(uint8_t **p,
+							   uint8_t *lim)
+{
+	struct router_lsa_link *l;
+
+	while (*p + OSPF_ROUTER_LSA_LINK_SIZE <= lim) {
+		l = (struct router_lsa_link *)*p;
+		*p += OSPF_ROUTER_LSA_LINK_SIZE
+		      + l->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE;
+
+		if (l->m[0].type != LSA_LINK_TYPE_STUB)
+			return l;
+	}
+
+	return NULL;
+}
+
+/*
+ * Whether two instances of a router-LSA differ in their stub links only,
+ * in which case the shortest-path tree stays the same and a partial route
+ * calculation is enough.
+ */
+static bool ospf_router_lsa_stubs_only_different(struct ospf_lsa *l1,
+						 struct ospf_lsa *l2)
+{
+	struct router_lsa *rl1 = (struct router_lsa *)l1->data;
+	struct router_lsa *rl2 = (struct router_lsa *)l2->data;
+	struct router_lsa_link *link1, *link2;
+	uint8_t *p1, *p2, *lim1, *lim2;
+
+	if (IS_LSA_MAXAGE(l1) || IS_LSA_MAXAGE(l2))
+		return false;
+
+	if (rl1->header.options != rl2->header.options
+	    || rl1->flags != rl2->flags)
+		return false;
+
+	if (CHECK_FLAG((l1->flags ^ l2->flags), OSPF_LSA_RECEIVED))
+		return false;
+
+	p1 = ((uint8_t *)rl1) + OSPF_LSA_HEADER_SIZE + 4;
+	lim1 = ((uint8_t *)rl1) + ntohs(rl1->header.length);
+	p2 = ((uint8_t *)rl2) + OSPF_LSA_HEADER_SIZE + 4;
+	lim2 = ((uint8_t *)rl2) + ntohs(rl2->header.length);
+
+	for (;;) {
+		link1 = ospf_router_lsa_next_transit(&p1, lim1);
+		link2 = ospf_router_lsa_next_transit(&p2, lim2);
+		if (!link1 || !link2)
+			return link1 == link2;
+
+		if (link1->m[0].tos_count != link2->m[0].tos_count
+		    || memcmp(link1, link2,
+			      OSPF_ROUTER_LSA_LINK_SIZE
+				      + link1->m[0].tos_count
+						* OSPF_ROUTER_LSA_TOS_SIZE))
+			return false;
+	}
+}
+
 /* Install router-LSA to an area. */
 static struct ospf_lsa *
-ospf_router_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc)
+ospf_router_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc,
+			bool stubs_only)
 {
 	struct ospf_area *area = new->area;
 
@@ -2641,7 +2703,9 @@ ospf_router_lsa_install(struct ospf *ospf, struct ospf_lsa *new, int rt_recalc)
 		ospf_refresher_register_lsa(ospf, new);
 	}
 	if (rt_recalc)
-		ospf_spf_calculate_schedule(ospf, SPF_FLAG_ROUTER_LSA_INSTALL);
+		ospf_spf_calculate_schedule(
+			ospf, stubs_only ? SPF_FLAG_ROUTER_LSA_STUB_CHANGE
+					 : SPF_FLAG_ROUTER_LSA_INSTALL);
 	return new;
 }
 
@@ -2807,6 +2871,7 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 	struct ospf_lsa *old = NULL;
 	struct ospf_lsdb *lsdb = NULL;
 	int rt_recalc;
+	bool stubs_only = false;
 
 	/* Set LSDB. */
 	switch (lsa->data->type) {
@@ -2871,6 +2936,12 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 			ospf_helper_handle_topo_chg(ospf, lsa);
 
 		rt_recalc = 1;
+
+		/* Others' stub links aren't part of the shortest-path tree */
+		if (old && lsa->data->type == OSPF_ROUTER_LSA
+		    && !ospf_lsa_is_self_originated(ospf, lsa))
+			stubs_only =
+				ospf_router_lsa_stubs_only_different(old, lsa);
 	}
 
 	/*
@@ -2924,7 +2995,8 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 	/* Do LSA specific installation process. */
 	switch (lsa->data->type) {
 	case OSPF_ROUTER_LSA:
-		new = ospf_router_lsa_install(ospf, lsa, rt_recalc);
+		new = ospf_router_lsa_install(ospf, lsa, rt_recalc,
+					      stubs_only);
 		break;
 	case OSPF_NETWORK_LSA:
 		assert(oi);
@@ -3267,40 +3339,39 @@ static int ospf_lsa_maxage_walker_remover(struct ospf *ospf,
 	return 0;
 }
 
+static void ospf_lsa_maxage_walk(struct ospf *ospf, struct ospf_lsdb *lsdb,
+				 uint8_t type)
+{
+	struct ospf_lsa *lsa;
+	unsigned long i;
+
+	LSDB_SCAN (lsdb, type, i, lsa)
+		ospf_lsa_maxage_walker_remover(ospf, lsa);
+}
+
 /* Periodical check of MaxAge LSA. */
 void ospf_lsa_maxage_walker(struct thread *thread)
 {
 	struct ospf *ospf = THREAD_ARG(thread);
-	struct route_node *rn;
-	struct ospf_lsa *lsa;
 	struct ospf_area *area;
 	struct listnode *node, *nnode;
 
 	ospf->t_maxage_walker = NULL;
 
 	for (ALL_LIST_ELEMENTS(ospf->areas, node, nnode, area)) {
-		LSDB_LOOP (ROUTER_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (NETWORK_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (SUMMARY_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (ASBR_SUMMARY_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (OPAQUE_AREA_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (OPAQUE_LINK_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (NSSA_LSDB(area), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_ROUTER_LSA);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_NETWORK_LSA);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_SUMMARY_LSA);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_ASBR_SUMMARY_LSA);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_OPAQUE_AREA_LSA);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_OPAQUE_LINK_LSA);
+		ospf_lsa_maxage_walk(ospf, area->lsdb, OSPF_AS_NSSA_LSA);
 	}
 
 	/* for AS-external-LSAs. */
 	if (ospf->lsdb) {
-		LSDB_LOOP (EXTERNAL_LSDB(ospf), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
-		LSDB_LOOP (OPAQUE_AS_LSDB(ospf), rn, lsa)
-			ospf_lsa_maxage_walker_remover(ospf, lsa);
+		ospf_lsa_maxage_walk(ospf, ospf->lsdb, OSPF_AS_EXTERNAL_LSA);
+		ospf_lsa_maxage_walk(ospf, ospf->lsdb, OSPF_OPAQUE_AS_LSA);
 	}
 
 	OSPF_TIMER_ON(ospf->t_maxage_walker, ospf_lsa_maxage_walker,
@@ -31,6 +31,38 @@
 #include "ospfd/ospf_lsa.h"
 #include "ospfd/ospf_lsdb.h"
 
+DEFINE_MTYPE_STATIC(OSPFD, OSPF_LSDB_NODE, "OSPF LSDB node");
+DEFINE_MTYPE_STATIC(OSPFD, OSPF_LSDB_ARRAY, "OSPF LSDB array");
+
+/* route node with the position of its LSA in the per-type array */
+struct ospf_lsdb_node {
+	ROUTE_NODE_FIELDS
+
+	unsigned long idx;
+};
+
+static struct route_node *
+ospf_lsdb_node_create(route_table_delegate_t *delegate,
+		      struct route_table *table)
+{
+	struct ospf_lsdb_node *node;
+
+	node = XCALLOC(MTYPE_OSPF_LSDB_NODE, sizeof(*node));
+	return (struct route_node *)node;
+}
+
+static void ospf_lsdb_node_destroy(route_table_delegate_t *delegate,
+				   struct route_table *table,
+				   struct route_node *rn)
+{
+	XFREE(MTYPE_OSPF_LSDB_NODE, rn);
+}
+
+static route_table_delegate_t ospf_lsdb_delegate = {
+	.create_node = ospf_lsdb_node_create,
+	.destroy_node = ospf_lsdb_node_destroy,
+	.stride = ROUTE_TABLE_STRIDE_MAX};
+
 struct ospf_lsdb *ospf_lsdb_new(void)
 {
 	struct ospf_lsdb *new;
@@ -46,7 +78,8 @@ void ospf_lsdb_init(struct ospf_lsdb *lsdb)
 	int i;
 
 	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
-		lsdb->type[i].db = route_table_init();
+		lsdb->type[i].db =
+			route_table_init_with_delegate(&ospf_lsdb_delegate);
 }
 
 void ospf_lsdb_free(struct ospf_lsdb *lsdb)
@@ -63,8 +96,11 @@ void ospf_lsdb_cleanup(struct ospf_lsdb *lsdb)
 
 	ospf_lsdb_delete_all(lsdb);
 
-	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
+	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++) {
 		route_table_finish(lsdb->type[i].db);
+		XFREE(MTYPE_OSPF_LSDB_ARRAY, lsdb->type[i].array);
+		lsdb->type[i].array_size = 0;
+	}
 }
 
 void ls_prefix_set(struct prefix_ls *lp, struct ospf_lsa *lsa)
@@ -77,6 +113,51 @@ void ls_prefix_set(struct prefix_ls *lp, struct ospf_lsa *lsa)
 	}
 }
 
+static void ospf_lsdb_array_add(struct ospf_lsdb *lsdb, struct route_node *rn,
+				struct ospf_lsa *lsa)
+{
+	struct ospf_lsdb_node *node = (struct ospf_lsdb_node *)rn;
+	uint8_t type = lsa->data->type;
+
+	if (lsdb->type[type].count == lsdb->type[type].array_size) {
+		lsdb->type[type].array_size =
+			MAX(lsdb->type[type].array_size * 2, 16);
+		lsdb->type[type].array =
+			XREALLOC(MTYPE_OSPF_LSDB_ARRAY, lsdb->type[type].array,
+				 lsdb->type[type].array_size
+					 * sizeof(struct ospf_lsa *));
+	}
+
+	node->idx = lsdb->type[type].count;
+	lsdb->type[type].array[node->idx] = lsa;
+}
+
+/* the last LSA takes the place of the deleted one */
+static void ospf_lsdb_array_del(struct ospf_lsdb *lsdb, struct route_node *rn,
+				struct ospf_lsa *lsa)
+{
+	struct ospf_lsdb_node *node = (struct ospf_lsdb_node *)rn;
+	struct ospf_lsdb_node *last_node;
+	struct ospf_lsa *last;
+	struct prefix_ls lp;
+	uint8_t type = lsa->data->type;
+	unsigned long last_idx = lsdb->type[type].count - 1;
+
+	assert(lsdb->type[type].array[node->idx] == lsa);
+
+	if (node->idx != last_idx) {
+		last = lsdb->type[type].array[last_idx];
+		ls_prefix_set(&lp, last);
+		last_node = (struct ospf_lsdb_node *)route_node_lookup(
+			rn->table, (struct prefix *)&lp);
+		assert(last_node);
+		last_node->idx = node->idx;
+		lsdb->type[type].array[node->idx] = last;
+		route_unlock_node((struct route_node *)last_node);
+	}
+	lsdb->type[type].array[last_idx] = NULL;
+}
+
 static void ospf_lsdb_delete_entry(struct ospf_lsdb *lsdb,
 				   struct route_node *rn)
 {
@@ -87,6 +168,7 @@ static void ospf_lsdb_delete_entry(struct ospf_lsdb *lsdb,
 
 	assert(rn->table == lsdb->type[lsa->data->type].db);
 
+	ospf_lsdb_array_del(lsdb, rn, lsa);
 	if (IS_LSA_SELF(lsa))
 		lsdb->type[lsa->data->type].count_self--;
 	lsdb->type[lsa->data->type].count--;
@@ -123,6 +205,7 @@ void ospf_lsdb_add(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 	if (rn->info)
 		ospf_lsdb_delete_entry(lsdb, rn);
 
+	ospf_lsdb_array_add(lsdb, rn, lsa);
 	if (IS_LSA_SELF(lsa))
 		lsdb->type[lsa->data->type].count_self++;
 	lsdb->type[lsa->data->type].count++;
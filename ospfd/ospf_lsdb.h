@@ -29,6 +29,11 @@ struct ospf_lsdb {
 		unsigned long count_self;
 		unsigned int checksum;
 		struct route_table *db;
+		/* the same LSAs, unordered, for walks that don't need the
+		 * order (count entries used)
+		 */
+		struct ospf_lsa **array;
+		unsigned long array_size;
 	} type[OSPF_MAX_LSA];
 	unsigned long total;
 #define MONITOR_LSDB_CHANGE 1 /* XXX */
@@ -45,6 +50,16 @@ struct ospf_lsdb {
 		for ((N) = route_top((T)); ((N)); ((N)) = route_next((N)))     \
 			if (((L) = (N)->info))
 
+/*
+ * All LSAs of type T, in no particular order, without locking route nodes.
+ * The body may delete the current LSA, adding or deleting others means
+ * some may be skipped or seen twice.
+ */
+#define LSDB_SCAN(D, T, I, L)                                                  \
+	for ((I) = (D)->type[(T)].count; (I)-- > 0;)                           \
+		if ((I) < (D)->type[(T)].count                                 \
+		    && ((L) = (D)->type[(T)].array[(I)]))
+
 #define ROUTER_LSDB(A)       ((A)->lsdb->type[OSPF_ROUTER_LSA].db)
 #define NETWORK_LSDB(A)	     ((A)->lsdb->type[OSPF_NETWORK_LSA].db)
 #define SUMMARY_LSDB(A)      ((A)->lsdb->type[OSPF_SUMMARY_LSA].db)
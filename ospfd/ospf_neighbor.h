@@ -25,6 +25,26 @@
 #include <ospfd/ospf_gr.h>
 #include <ospfd/ospf_packet.h>
 
+#include "typesafe.h"
+
+PREDECL_HASH(ospf_ls_rxmt_hash);
+PREDECL_DLIST(ospf_ls_rxmt_queue);
+
+/*
+ * LSA on a neighbor's retransmit list.  The LSA itself is shared, with a
+ * lock held.  Entries are queued in the order they were last sent, so the
+ * ones due for retransmission are at the head.
+ */
+struct ospf_ls_rxmt {
+	struct ospf_ls_rxmt_hash_item hash_item;
+	struct ospf_ls_rxmt_queue_item queue_item;
+
+	struct ospf_lsa *lsa;
+	struct timeval sent;
+};
+
+DECLARE_DLIST(ospf_ls_rxmt_queue, struct ospf_ls_rxmt, queue_item);
+
 /* Neighbor Data Structure */
 struct ospf_neighbor {
 	/* This neighbor's parent ospf interface. */
@@ -58,7 +78,8 @@ struct ospf_neighbor {
 	} last_recv;
 
 	/* LSA data. */
-	struct ospf_lsdb ls_rxmt;
+	struct ospf_ls_rxmt_hash_head ls_rxmt;
+	struct ospf_ls_rxmt_queue_head ls_rxmt_queue;
 	struct ospf_lsdb db_sum;
 	struct ospf_lsdb ls_req;
 	struct ospf_lsa *ls_req_last;
@@ -482,43 +482,18 @@ void ospf_ls_upd_timer(struct thread *thread)
 	/* Send Link State Update. */
 	if (ospf_ls_retransmit_count(nbr) > 0) {
 		struct list *update;
-		struct ospf_lsdb *lsdb;
-		int i;
 		int retransmit_interval;
 
 		retransmit_interval =
 			OSPF_IF_PARAM(nbr->oi, retransmit_interval);
 
-		lsdb = &nbr->ls_rxmt;
+		/* Only LSAs that have been sent (or received, for the
+		 * ones flooded after receiving them) at least RxmtInterval
+		 * seconds ago, giving the neighbour a chance to acknowledge
+		 * them before the timer fires.
+		 */
 		update = list_new();
-
-		for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++) {
-			struct route_table *table = lsdb->type[i].db;
-			struct route_node *rn;
-
-			for (rn = route_top(table); rn; rn = route_next(rn)) {
-				struct ospf_lsa *lsa;
-
-				if ((lsa = rn->info) != NULL) {
-					/* Don't retransmit an LSA if we
-					  received it within
-					  the last RxmtInterval seconds - this
-					  is to allow the
-					  neighbour a chance to acknowledge the
-					  LSA as it may
-					  have ben just received before the
-					  retransmit timer
-					  fired.  This is a small tweak to what
-					  is in the RFC,
-					  but it will cut out out a lot of
-					  retransmit traffic
-					  - MAG */
-					if (monotime_since(&lsa->tv_recv, NULL)
-					    >= retransmit_interval * 1000000LL)
-						listnode_add(update, rn->info);
-				}
-			}
-		}
+		ospf_ls_retransmit_due(nbr, retransmit_interval, update);
 
 		if (listcount(update) > 0)
 			ospf_ls_upd_send(nbr, update, OSPF_SEND_PACKET_DIRECT,
@@ -2286,33 +2261,18 @@ static void ospf_ls_ack(struct ip *iph, struct ospf_header *ospfh,
 	return;
 }
 
+/* Checks a packet read into ibuf, ret bytes, with msgh */
 static struct stream *ospf_recv_packet(struct ospf *ospf, int fd,
 				       struct interface **ifp,
-				       struct stream *ibuf)
+				       struct stream *ibuf,
+				       struct msghdr *msgh, int ret)
 {
-	int ret;
 	struct ip *iph;
 	uint16_t ip_len;
 	ifindex_t ifindex = 0;
-	struct iovec iov;
-	/* Header and data both require alignment. */
-	char buff[CMSG_SPACE(SOPT_SIZE_CMSG_IFINDEX_IPV4())];
-	struct msghdr msgh;
 
-	memset(&msgh, 0, sizeof(msgh));
-	msgh.msg_iov = &iov;
-	msgh.msg_iovlen = 1;
-	msgh.msg_control = (caddr_t)buff;
-	msgh.msg_controllen = sizeof(buff);
+	stream_set_endp(ibuf, ret);
 
-	ret = stream_recvmsg(ibuf, fd, &msgh, MSG_DONTWAIT,
-			     OSPF_MAX_PACKET_SIZE + 1);
-	if (ret < 0) {
-		if (errno != EAGAIN && errno != EWOULDBLOCK)
-			flog_warn(EC_OSPF_PACKET, "stream_recvmsg failed: %s",
-				  safe_strerror(errno));
-		return NULL;
-	}
 	if ((unsigned int)ret < sizeof(struct ip)) {
 		flog_warn(
 			EC_OSPF_PACKET,
@@ -2355,7 +2315,7 @@ static struct stream *ospf_recv_packet(struct ospf *ospf, int fd,
 	ip_len = ntohs(iph->ip_len) + (iph->ip_hl << 2);
 #endif
 
-	ifindex = getsockopt_ifindex(AF_INET, &msgh);
+	ifindex = getsockopt_ifindex(AF_INET, msgh);
 
 	*ifp = if_lookup_by_index(ifindex, ospf->vrf_id);
 
@@ -2945,21 +2905,16 @@ enum ospf_read_return_enum {
 	OSPF_READ_CONTINUE,
 };
 
-static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
+static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf,
+						   struct stream *ibuf,
+						   struct interface *ifp)
 {
 	int ret;
-	struct stream *ibuf;
 	struct ospf_interface *oi;
 	struct ip *iph;
 	struct ospf_header *ospfh;
 	uint16_t length;
 	struct connected *c;
-	struct interface *ifp = NULL;
-
-	stream_reset(ospf->ibuf);
-	ibuf = ospf_recv_packet(ospf, ospf->fd, &ifp, ospf->ibuf);
-	if (ibuf == NULL)
-		return OSPF_READ_ERROR;
 
 	/*
 	 * This raw packet is known to be at least as big as its
@@ -3195,12 +3150,22 @@ static enum ospf_read_return_enum ospf_read_helper(struct ospf *ospf)
 	return OSPF_READ_CONTINUE;
 }
 
-/* Starting point of packet process function. */
+/*
+ * Starting point of packet process function.  Reads up to write_oi_count
+ * packets, OSPF_READ_BATCH at a time with recvmmsg() into the instance's
+ * receive streams, and processes them where they are.
+ */
 void ospf_read(struct thread *thread)
 {
 	struct ospf *ospf;
 	int32_t count = 0;
-	enum ospf_read_return_enum ret;
+	struct mmsghdr msgs[OSPF_READ_BATCH];
+	struct iovec iov[OSPF_READ_BATCH];
+	/* Header and data both require alignment. */
+	char cmsg[OSPF_READ_BATCH][CMSG_SPACE(SOPT_SIZE_CMSG_IFINDEX_IPV4())];
+	struct interface *ifp;
+	struct stream *ibuf;
+	int i, n, want;
 
 	/* first of all get interface pointer. */
 	ospf = THREAD_ARG(thread);
@@ -3209,14 +3174,41 @@ void ospf_read(struct thread *thread)
 	thread_add_read(master, ospf_read, ospf, ospf->fd, &ospf->t_read);
 
 	while (count < ospf->write_oi_count) {
-		count++;
-		ret = ospf_read_helper(ospf);
-		switch (ret) {
-		case OSPF_READ_ERROR:
+		want = MIN(OSPF_READ_BATCH, ospf->write_oi_count - count);
+
+		memset(msgs, 0, want * sizeof(msgs[0]));
+		for (i = 0; i < want; i++) {
+			stream_reset(ospf->ibuf[i]);
+			iov[i].iov_base = STREAM_DATA(ospf->ibuf[i]);
+			iov[i].iov_len = OSPF_MAX_PACKET_SIZE + 1;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = (caddr_t)cmsg[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(cmsg[i]);
+		}
+
+		n = recvmmsg(ospf->fd, msgs, want, MSG_DONTWAIT, NULL);
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				flog_warn(EC_OSPF_PACKET, "recvmmsg failed: %s",
+					  safe_strerror(errno));
 			return;
-		case OSPF_READ_CONTINUE:
-			break;
 		}
+
+		for (i = 0; i < n; i++) {
+			ifp = NULL;
+			ibuf = ospf_recv_packet(ospf, ospf->fd, &ifp,
+						ospf->ibuf[i],
+						&msgs[i].msg_hdr,
+						msgs[i].msg_len);
+			if (ibuf)
+				ospf_read_helper(ospf, ibuf, ifp);
+		}
+
+		count += n;
+		/* socket is drained */
+		if (n < want)
+			return;
 	}
 }
 
@@ -4086,45 +4078,70 @@ static void ospf_ls_upd_queue_send(struct ospf_interface *oi,
 	}
 }
 
+static void ospf_ls_upd_send_queue_event(struct thread *thread);
+
+static void ospf_ls_upd_queue_schedule(struct ospf_interface *oi,
+				       unsigned int delay)
+{
+	if (delay)
+		thread_add_timer_msec(master, ospf_ls_upd_send_queue_event, oi,
+				      delay, &oi->t_ls_upd_event);
+	else
+		thread_add_event(master, ospf_ls_upd_send_queue_event, oi, 0,
+				 &oi->t_ls_upd_event);
+}
+
 static void ospf_ls_upd_send_queue_event(struct thread *thread)
 {
 	struct ospf_interface *oi = THREAD_ARG(thread);
 	struct route_node *rn;
 	struct route_node *rnext;
 	struct list *update;
-	char again = 0;
+	unsigned int burst = oi->ospf->flood_burst;
+	unsigned int sent = 0;
+	char again;
 
 	oi->t_ls_upd_event = NULL;
 
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug("%s start", __func__);
 
-	for (rn = route_top(oi->ls_upd_queue); rn; rn = rnext) {
-		rnext = route_next(rn);
+	/* one packet per destination and run, or up to the burst when paced */
+	do {
+		again = 0;
+		for (rn = route_top(oi->ls_upd_queue); rn; rn = rnext) {
+			if (burst && sent >= burst) {
+				route_unlock_node(rn);
+				again = 1;
+				break;
+			}
 
-		if (rn->info == NULL)
-			continue;
+			rnext = route_next(rn);
+
+			if (rn->info == NULL)
+				continue;
 
-		update = (struct list *)rn->info;
+			update = (struct list *)rn->info;
 
-		ospf_ls_upd_queue_send(oi, update, rn->p.u.prefix4, 0);
+			ospf_ls_upd_queue_send(oi, update, rn->p.u.prefix4, 0);
+			sent++;
 
-		/* list might not be empty. */
-		if (listcount(update) == 0) {
-			list_delete((struct list **)&rn->info);
-			route_unlock_node(rn);
-		} else
-			again = 1;
-	}
+			/* list might not be empty. */
+			if (listcount(update) == 0) {
+				list_delete((struct list **)&rn->info);
+				route_unlock_node(rn);
+			} else
+				again = 1;
+		}
+	} while (again && burst && sent < burst);
 
 	if (again != 0) {
 		if (IS_DEBUG_OSPF_EVENT)
 			zlog_debug(
-				"%s: update lists not cleared, %d nodes to try again, raising new event",
-				__func__, again);
-		oi->t_ls_upd_event = NULL;
-		thread_add_event(master, ospf_ls_upd_send_queue_event, oi, 0,
-				 &oi->t_ls_upd_event);
+				"%s: update lists not cleared, %u packets sent, raising new event",
+				__func__, sent);
+		ospf_ls_upd_queue_schedule(oi,
+					   burst ? oi->ospf->flood_interval : 0);
 	}
 
 	if (IS_DEBUG_OSPF_EVENT)
@@ -4195,8 +4212,7 @@ void ospf_ls_upd_send(struct ospf_neighbor *nbr, struct list *update, int flag,
 					       rn->p.u.prefix4, 1);
 		}
 	} else
-		thread_add_event(master, ospf_ls_upd_send_queue_event, oi, 0,
-				 &oi->t_ls_upd_event);
+		ospf_ls_upd_queue_schedule(oi, oi->ospf->flood_delay);
 }
 
 static void ospf_ls_ack_send_list(struct ospf_interface *oi, struct list *ack,
@@ -334,6 +334,8 @@ void ospf_route_install(struct ospf *ospf, struct route_table *rt)
 	ospf->old_table = ospf->new_table;
 	ospf->new_table = rt;
 
+	ospf_zebra_batch_begin();
+
 	/* Delete old routes. */
 	if (ospf->old_table)
 		ospf_route_delete_uniq(ospf, ospf->old_table, rt);
@@ -359,6 +361,8 @@ void ospf_route_install(struct ospf *ospf, struct route_table *rt)
 						ospf,
 						(struct prefix_ipv4 *)&rn->p);
 		}
+
+	ospf_zebra_batch_commit();
 }
 
 /* RFC2328 16.1. (4). For "router". */
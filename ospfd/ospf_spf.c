@@ -72,25 +72,14 @@ static void ospf_spf_set_reason(ospf_spf_reason_t reason)
 static void ospf_vertex_free(void *);
 
 /*
- * Heap related functions, for the managment of the candidates, to
- * be used with pqueue.
+ * Candidate list key: by distance, networks before routers at the same
+ * distance.
  */
-static int vertex_cmp(const struct vertex *v1, const struct vertex *v2)
+static uint64_t vertex_key(const struct vertex *v)
 {
-	if (v1->distance != v2->distance)
-		return v1->distance - v2->distance;
-
-	if (v1->type != v2->type) {
-		switch (v1->type) {
-		case OSPF_VERTEX_NETWORK:
-			return -1;
-		case OSPF_VERTEX_ROUTER:
-			return 1;
-		}
-	}
-	return 0;
+	return (uint64_t)v->distance * 2 + (v->type == OSPF_VERTEX_ROUTER);
 }
-DECLARE_SKIPLIST_NONUNIQ(vertex_pqueue, struct vertex, pqi, vertex_cmp);
+DECLARE_RADIXHEAP(vertex_pqueue, struct vertex, pqi, vertex_key);
 
 static void lsdb_clean_stat(struct ospf_lsdb *lsdb)
 {
@@ -197,6 +186,7 @@ static struct vertex *ospf_vertex_new(struct ospf_area *area,
 	new->flags = 0;
 	new->type = lsa->data->type;
 	new->id = lsa->data->id;
+	new->adv_router = lsa->data->adv_router;
 	new->lsa = lsa->data;
 	new->children = list_new();
 	new->parents = list_new();
@@ -224,7 +214,7 @@ static void ospf_vertex_free(void *data)
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug("%s: Free %s vertex %pI4", __func__,
 			   v->type == OSPF_VERTEX_ROUTER ? "Router" : "Network",
-			   &v->lsa->id);
+			   &v->id);
 
 	if (v->children)
 		list_delete(&v->children);
@@ -334,155 +324,18 @@ struct vertex *ospf_spf_vertex_by_nexthop(struct vertex *root,
 	return NULL;
 }
 
-/* Create a deep copy of a SPF vertex without children and parents */
-static struct vertex *ospf_spf_vertex_copy(struct vertex *vertex)
-{
-	struct vertex *copy;
-
-	copy = XCALLOC(MTYPE_OSPF_VERTEX, sizeof(struct vertex));
-
-	memcpy(copy, vertex, sizeof(struct vertex));
-	copy->parents = list_new();
-	copy->parents->del = vertex_parent_free;
-	copy->parents->cmp = vertex_parent_cmp;
-	copy->children = list_new();
-
-	return copy;
-}
-
-/* Create a deep copy of a SPF vertex_parent */
-static struct vertex_parent *
-ospf_spf_vertex_parent_copy(struct vertex_parent *vertex_parent)
-{
-	struct vertex_parent *vertex_parent_copy;
-	struct vertex_nexthop *nexthop_copy, *local_nexthop_copy;
-
-	vertex_parent_copy =
-		XCALLOC(MTYPE_OSPF_VERTEX, sizeof(struct vertex_parent));
-
-	nexthop_copy = vertex_nexthop_new();
-	local_nexthop_copy = vertex_nexthop_new();
-
-	memcpy(vertex_parent_copy, vertex_parent, sizeof(struct vertex_parent));
-	memcpy(nexthop_copy, vertex_parent->nexthop,
-	       sizeof(struct vertex_nexthop));
-	memcpy(local_nexthop_copy, vertex_parent->local_nexthop,
-	       sizeof(struct vertex_nexthop));
-
-	vertex_parent_copy->nexthop = nexthop_copy;
-	vertex_parent_copy->local_nexthop = local_nexthop_copy;
-
-	return vertex_parent_copy;
-}
-
-/* Create a deep copy of a SPF tree */
-void ospf_spf_copy(struct vertex *vertex, struct list *vertex_list)
-{
-	struct listnode *node;
-	struct vertex *vertex_copy, *child, *child_copy, *parent_copy;
-	struct vertex_parent *vertex_parent, *vertex_parent_copy;
-
-	/* First check if the node is already in the vertex list */
-	vertex_copy = ospf_spf_vertex_find(vertex->id, vertex_list);
-	if (!vertex_copy) {
-		vertex_copy = ospf_spf_vertex_copy(vertex);
-		listnode_add(vertex_list, vertex_copy);
-	}
-
-	/* Copy all parents, create parent nodes if necessary */
-	for (ALL_LIST_ELEMENTS_RO(vertex->parents, node, vertex_parent)) {
-		parent_copy = ospf_spf_vertex_find(vertex_parent->parent->id,
-						   vertex_list);
-		if (!parent_copy) {
-			parent_copy =
-				ospf_spf_vertex_copy(vertex_parent->parent);
-			listnode_add(vertex_list, parent_copy);
-		}
-		vertex_parent_copy = ospf_spf_vertex_parent_copy(vertex_parent);
-		vertex_parent_copy->parent = parent_copy;
-		listnode_add(vertex_copy->parents, vertex_parent_copy);
-	}
-
-	/* Copy all children, create child nodes if necessary */
-	for (ALL_LIST_ELEMENTS_RO(vertex->children, node, child)) {
-		child_copy = ospf_spf_vertex_find(child->id, vertex_list);
-		if (!child_copy) {
-			child_copy = ospf_spf_vertex_copy(child);
-			listnode_add(vertex_list, child_copy);
-		}
-		listnode_add(vertex_copy->children, child_copy);
-	}
-
-	/* Finally continue copying with child nodes */
-	for (ALL_LIST_ELEMENTS_RO(vertex->children, node, child))
-		ospf_spf_copy(child, vertex_list);
-}
-
-static void ospf_spf_remove_branch(struct vertex_parent *vertex_parent,
-				   struct vertex *child,
-				   struct list *vertex_list)
-{
-	struct listnode *node, *nnode, *inner_node, *inner_nnode;
-	struct vertex *grandchild;
-	struct vertex_parent *vertex_parent_found;
-	bool has_more_links = false;
-
-	/*
-	 * First check if there are more nexthops for that parent to that child
-	 */
-	for (ALL_LIST_ELEMENTS_RO(child->parents, node, vertex_parent_found)) {
-		if (vertex_parent_found->parent->id.s_addr
-			    == vertex_parent->parent->id.s_addr
-		    && vertex_parent_found->nexthop->router.s_addr
-			       != vertex_parent->nexthop->router.s_addr)
-			has_more_links = true;
-	}
-
-	/*
-	 * No more links from that parent? Then delete the child from its
-	 * children list.
-	 */
-	if (!has_more_links)
-		listnode_delete(vertex_parent->parent->children, child);
-
-	/*
-	 * Delete the vertex_parent from the child parents list, this needs to
-	 * be done anyway.
-	 */
-	listnode_delete(child->parents, vertex_parent);
-
-	/*
-	 * Are there actually more parents left? If not, then delete the child!
-	 * This is done by recursively removing the links to the grandchildren,
-	 * such that finally the child can be removed without leaving unused
-	 * partial branches.
-	 */
-	if (child->parents->count == 0) {
-		for (ALL_LIST_ELEMENTS(child->children, node, nnode,
-				       grandchild)) {
-			for (ALL_LIST_ELEMENTS(grandchild->parents, inner_node,
-					       inner_nnode,
-					       vertex_parent_found)) {
-				ospf_spf_remove_branch(vertex_parent_found,
-						       grandchild, vertex_list);
-			}
-		}
-		listnode_delete(vertex_list, child);
-		ospf_vertex_free(child);
-	}
-}
-
-static int ospf_spf_remove_link(struct vertex *vertex, struct list *vertex_list,
-				struct router_lsa_link *link)
+/*
+ * Find the first link (in depth first order) from a vertex to a child which
+ * is on the subnet of the given router LSA link.
+ */
+static struct vertex_parent *ospf_spf_find_link(struct vertex *vertex,
+						struct router_lsa_link *link,
+						struct vertex **childp)
 {
 	struct listnode *node, *inner_node;
 	struct vertex *child;
 	struct vertex_parent *vertex_parent;
 
-	/*
-	 * Identify the node who shares a subnet (given by the link) with a
-	 * child and remove the branch of this particular child.
-	 */
 	for (ALL_LIST_ELEMENTS_RO(vertex->children, node, child)) {
 		for (ALL_LIST_ELEMENTS_RO(child->parents, inner_node,
 					  vertex_parent)) {
@@ -490,54 +343,76 @@ static int ospf_spf_remove_link(struct vertex *vertex, struct list *vertex_list,
 			     & link->link_data.s_addr)
 			    == (link->link_id.s_addr
 				& link->link_data.s_addr)) {
-				ospf_spf_remove_branch(vertex_parent, child,
-						       vertex_list);
-				return 0;
+				*childp = child;
+				return vertex_parent;
 			}
 		}
 	}
 
 	/* No link found yet, move on recursively */
 	for (ALL_LIST_ELEMENTS_RO(vertex->children, node, child)) {
-		if (ospf_spf_remove_link(child, vertex_list, link) == 0)
-			return 0;
+		vertex_parent = ospf_spf_find_link(child, link, childp);
+		if (vertex_parent)
+			return vertex_parent;
 	}
 
-	/* link was not removed yet */
-	return 1;
+	return NULL;
 }
 
-void ospf_spf_remove_resource(struct vertex *vertex, struct list *vertex_list,
-			      struct protected_resource *resource)
+static void ospf_spf_mark_cut(struct vertex *vertex)
 {
-	struct listnode *node, *nnode;
-	struct vertex *found;
-	struct vertex_parent *vertex_parent;
+	struct listnode *node;
+	struct vertex *child;
+
+	if (CHECK_FLAG(vertex->flags, OSPF_VERTEX_CUT))
+		return;
+
+	SET_FLAG(vertex->flags, OSPF_VERTEX_CUT);
+	for (ALL_LIST_ELEMENTS_RO(vertex->children, node, child))
+		ospf_spf_mark_cut(child);
+}
+
+struct vertex_parent *ospf_spf_resource_view(struct vertex *root,
+					     struct list *vertex_list,
+					     struct protected_resource *resource,
+					     struct list *view)
+{
+	struct listnode *node;
+	struct vertex *cut = NULL, *vertex;
+	struct vertex_parent *cut_link = NULL;
 
 	switch (resource->type) {
 	case OSPF_TI_LFA_LINK_PROTECTION:
-		ospf_spf_remove_link(vertex, vertex_list, resource->link);
-		break;
-	case OSPF_TI_LFA_NODE_PROTECTION:
-		found = ospf_spf_vertex_find(resource->router_id, vertex_list);
-		if (!found)
-			break;
-
 		/*
-		 * Remove the node by removing all links from its parents. Note
-		 * that the child is automatically removed here with the last
-		 * link from a parent, hence no explicit removal of the node.
+		 * The child is only gone with the link if it has no other
+		 * parent link.
 		 */
-		for (ALL_LIST_ELEMENTS(found->parents, node, nnode,
-				       vertex_parent))
-			ospf_spf_remove_branch(vertex_parent, found,
-					       vertex_list);
-
+		cut_link = ospf_spf_find_link(root, resource->link, &vertex);
+		if (cut_link && listcount(vertex->parents) == 1)
+			cut = vertex;
+		break;
+	case OSPF_TI_LFA_NODE_PROTECTION:
+		vertex = ospf_spf_vertex_find(resource->router_id, vertex_list);
+		if (vertex && listcount(vertex->parents))
+			cut = vertex;
 		break;
 	default:
 		/* do nothing */
 		break;
 	}
+
+	/* Everything below a vertex that is cut out goes as well. */
+	if (cut)
+		ospf_spf_mark_cut(cut);
+
+	for (ALL_LIST_ELEMENTS_RO(vertex_list, node, vertex)) {
+		if (CHECK_FLAG(vertex->flags, OSPF_VERTEX_CUT))
+			UNSET_FLAG(vertex->flags, OSPF_VERTEX_CUT);
+		else
+			listnode_add(view, vertex);
+	}
+
+	return cut_link;
 }
 
 static void ospf_spf_init(struct ospf_area *area, struct ospf_lsa *root_lsa,
@@ -1493,10 +1368,9 @@ static void ospf_spf_next(struct vertex *v, struct ospf_area *area,
 				 * spf_add_parents, which will flush the old
 				 * parents.
 				 */
-				vertex_pqueue_del(candidate, w);
 				ospf_nexthop_calculation(area, v, w, l,
 							 distance, lsa_pos);
-				vertex_pqueue_add(candidate, w);
+				vertex_pqueue_update(candidate, w);
 			}
 		} /* end W is already on the candidate list */
 	}	 /* end loop over the links in V's LSA */
@@ -1779,22 +1653,33 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 			   mtype_stats_alloc(MTYPE_OSPF_VERTEX));
 }
 
+void ospf_spf_tree_free(struct ospf_area *area)
+{
+	ospf_spf_cleanup(area->spf, area->spf_vertex_list);
+
+	area->spf = NULL;
+	area->spf_vertex_list = NULL;
+}
+
 void ospf_spf_calculate_area(struct ospf *ospf, struct ospf_area *area,
 			     struct route_table *new_table,
 			     struct route_table *all_rtrs,
 			     struct route_table *new_rtrs)
 {
+	ospf_spf_tree_free(area);
+
 	ospf_spf_calculate(area, area->router_lsa_self, new_table, all_rtrs,
 			   new_rtrs, false, true);
 
-	if (ospf->ti_lfa_enabled)
+	/*
+	 * The tree is kept for partial route calculation, except with TI-LFA
+	 * where the routes also depend on the trees computed for protection.
+	 */
+	if (ospf->ti_lfa_enabled) {
 		ospf_ti_lfa_compute(area, new_table,
 				    ospf->ti_lfa_protection_type);
-
-	ospf_spf_cleanup(area->spf, area->spf_vertex_list);
-
-	area->spf = NULL;
-	area->spf_vertex_list = NULL;
+		ospf_spf_tree_free(area);
+	}
 }
 
 void ospf_spf_calculate_areas(struct ospf *ospf, struct route_table *new_table,
@@ -1821,6 +1706,126 @@ void ospf_spf_calculate_areas(struct ospf *ospf, struct route_table *new_table,
 					all_rtrs, new_rtrs);
 }
 
+/*
+ * Partial route calculation, RFC 2328 16.5: as long as only summary-LSAs
+ * or the stub links of other routers changed, the shortest-path trees are
+ * the same as in the last run and Dijkstra can be skipped.  The intra-area
+ * routes are derived from the kept trees again, everything after that is
+ * done as for a full SPF.
+ */
+#define OSPF_SPF_PRC_REASONS                                                   \
+	((1 << SPF_FLAG_SUMMARY_LSA_INSTALL)                                   \
+	 | (1 << SPF_FLAG_ASBR_SUMMARY_LSA_INSTALL)                            \
+	 | (1 << SPF_FLAG_ROUTER_LSA_STUB_CHANGE))
+
+/*
+ * Points the vertices of the tree kept from the last run at the current
+ * instances of their LSAs.  Fails if one of them is gone.
+ */
+static bool ospf_spf_tree_refresh(struct ospf *ospf, struct ospf_area *area)
+{
+	struct listnode *node;
+	struct vertex *v;
+	struct ospf_lsa *lsa;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		lsa = ospf_lsa_lookup(ospf, area, v->type, v->id,
+				      v->adv_router);
+		if (!lsa || IS_LSA_MAXAGE(lsa))
+			return false;
+
+		v->lsa_p = lsa;
+		v->lsa = lsa->data;
+		UNSET_FLAG(v->flags, OSPF_VERTEX_PROCESSED);
+	}
+
+	return true;
+}
+
+static bool ospf_spf_prc_possible(struct ospf *ospf, unsigned int reasons)
+{
+	struct ospf_area *area;
+	struct listnode *node;
+
+	if (!reasons || (reasons & ~OSPF_SPF_PRC_REASONS))
+		return false;
+
+	if (ospf->ti_lfa_enabled)
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area)) {
+		/* no tree only if there was no root for it */
+		if (!area->spf) {
+			if (area->router_lsa_self)
+				return false;
+			continue;
+		}
+
+		if (!ospf_spf_tree_refresh(ospf, area))
+			return false;
+	}
+
+	return true;
+}
+
+/* RFC2328 16.1. (4) and the second stage, on the kept tree. */
+static void ospf_spf_prc_area(struct ospf_area *area,
+			      struct route_table *new_table,
+			      struct route_table *all_rtrs,
+			      struct route_table *new_rtrs)
+{
+	struct listnode *node;
+	struct vertex *v;
+
+	if (!area->spf)
+		return;
+
+	area->abr_count = 0;
+	area->asbr_count = 0;
+	area->shortcut_capability = 1;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		if (v == area->spf)
+			continue;
+
+		if (v->type != OSPF_VERTEX_ROUTER)
+			ospf_intra_add_transit(new_table, v, area);
+		else {
+			ospf_intra_add_router(new_rtrs, v, area, false);
+			if (all_rtrs)
+				ospf_intra_add_router(all_rtrs, v, area, true);
+		}
+	}
+
+	ospf_spf_process_stubs(area, area->spf, new_table, 0);
+
+	area->prc_calculation++;
+
+	monotime(&area->ospf->ts_spf);
+	area->ts_spf = area->ospf->ts_spf;
+}
+
+static void ospf_spf_prc_areas(struct ospf *ospf,
+			       struct route_table *new_table,
+			       struct route_table *all_rtrs,
+			       struct route_table *new_rtrs)
+{
+	struct ospf_area *area;
+	struct listnode *node;
+
+	/* Same order as ospf_spf_calculate_areas, backbone last. */
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area)) {
+		if (ospf->backbone && ospf->backbone == area)
+			continue;
+
+		ospf_spf_prc_area(area, new_table, all_rtrs, new_rtrs);
+	}
+
+	if (ospf->backbone)
+		ospf_spf_prc_area(ospf->backbone, new_table, all_rtrs,
+				  new_rtrs);
+}
+
 /* Worker for SPF calculation scheduler. */
 static void ospf_spf_calculate_schedule_worker(struct thread *thread)
 {
@@ -1830,13 +1835,18 @@ static void ospf_spf_calculate_schedule_worker(struct thread *thread)
 	struct timeval start_time, spf_start_time;
 	unsigned long ia_time, prune_time, rt_time;
 	unsigned long abr_time, total_spf_time, spf_time;
-	char rbuf[32]; /* reason_buf */
+	unsigned int reasons;
+	bool prc;
+	char rbuf[40]; /* reason_buf */
 
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug("SPF: Timer (SPF calculation expire)");
 
 	ospf->t_spf_calc = NULL;
 
+	reasons = ospf->spf_reasons;
+	ospf->spf_reasons = 0;
+
 	ospf_vl_unapprove(ospf);
 
 	/* Execute SPF for each area including backbone, see RFC 2328 16.1. */
@@ -1848,7 +1858,11 @@ static void ospf_spf_calculate_schedule_worker(struct thread *thread)
 	if (CHECK_FLAG(ospf->opaque, OPAQUE_OPERATION_READY_BIT))
 		all_rtrs = route_table_init();
 
-	ospf_spf_calculate_areas(ospf, new_table, all_rtrs, new_rtrs);
+	prc = ospf_spf_prc_possible(ospf, reasons);
+	if (prc)
+		ospf_spf_prc_areas(ospf, new_table, all_rtrs, new_rtrs);
+	else
+		ospf_spf_calculate_areas(ospf, new_table, all_rtrs, new_rtrs);
 	spf_time = monotime_since(&spf_start_time, NULL);
 
 	ospf_vl_shut_unapproved(ospf);
@@ -1925,6 +1939,8 @@ static void ospf_spf_calculate_schedule_worker(struct thread *thread)
 	if (spf_reason_flags) {
 		if (spf_reason_flags & (1 << SPF_FLAG_ROUTER_LSA_INSTALL))
 			strlcat(rbuf, "R, ", sizeof(rbuf));
+		if (spf_reason_flags & (1 << SPF_FLAG_ROUTER_LSA_STUB_CHANGE))
+			strlcat(rbuf, "RS, ", sizeof(rbuf));
 		if (spf_reason_flags & (1 << SPF_FLAG_NETWORK_LSA_INSTALL))
 			strlcat(rbuf, "N, ", sizeof(rbuf));
 		if (spf_reason_flags & (1 << SPF_FLAG_SUMMARY_LSA_INSTALL))
@@ -1949,7 +1965,8 @@ static void ospf_spf_calculate_schedule_worker(struct thread *thread)
 
 	if (IS_DEBUG_OSPF_EVENT) {
 		zlog_info("SPF Processing Time(usecs): %ld", total_spf_time);
-		zlog_info("            SPF Time: %ld", spf_time);
+		zlog_info("            SPF Time: %ld%s", spf_time,
+			  prc ? " (partial)" : "");
 		zlog_info("           InterArea: %ld", ia_time);
 		zlog_info("               Prune: %ld", prune_time);
 		zlog_info("        RouteInstall: %ld", rt_time);
@@ -1978,6 +1995,7 @@ void ospf_spf_calculate_schedule(struct ospf *ospf, ospf_spf_reason_t reason)
 		return;
 
 	ospf_spf_set_reason(reason);
+	ospf->spf_reasons |= 1 << reason;
 
 	/* SPF calculation timer is already scheduled. */
 	if (ospf->t_spf_calc) {
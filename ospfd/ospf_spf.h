@@ -30,16 +30,19 @@
 
 /* values for vertex->flags */
 #define OSPF_VERTEX_PROCESSED      0x01
+/* temporarily, see ospf_spf_resource_view() */
+#define OSPF_VERTEX_CUT            0x02
 
 /* The "root" is the node running the SPF calculation */
 
-PREDECL_SKIPLIST_NONUNIQ(vertex_pqueue);
+PREDECL_RADIXHEAP(vertex_pqueue);
 /* A router or network in an area */
 struct vertex {
 	struct vertex_pqueue_item pqi;
 	uint8_t flags;
 	uint8_t type;		/* copied from LSA header */
 	struct in_addr id;      /* copied from LSA header */
+	struct in_addr adv_router; /* copied from LSA header */
 	struct ospf_lsa *lsa_p;
 	struct lsa_header *lsa; /* Router or Network LSA */
 	uint32_t distance;      /* from root to this vertex */
@@ -70,6 +73,7 @@ typedef enum {
 	SPF_FLAG_ASBR_STATUS_CHANGE,
 	SPF_FLAG_CONFIG_CHANGE,
 	SPF_FLAG_GR_FINISH,
+	SPF_FLAG_ROUTER_LSA_STUB_CHANGE,
 } ospf_spf_reason_t;
 
 extern void ospf_spf_calculate_schedule(struct ospf *, ospf_spf_reason_t);
@@ -88,11 +92,17 @@ extern void ospf_spf_calculate_areas(struct ospf *ospf,
 				     struct route_table *all_rtrs,
 				     struct route_table *new_rtrs);
 extern void ospf_rtrs_free(struct route_table *);
+extern void ospf_spf_tree_free(struct ospf_area *area);
 extern void ospf_spf_cleanup(struct vertex *spf, struct list *vertex_list);
-extern void ospf_spf_copy(struct vertex *vertex, struct list *vertex_list);
-extern void ospf_spf_remove_resource(struct vertex *vertex,
-				     struct list *vertex_list,
-				     struct protected_resource *resource);
+/*
+ * The SPF tree as it is without a protected resource, without changing or
+ * copying it: the vertices that are left are added to 'view'.  Returns the
+ * parent link that is cut out for link protection, if any; other parent
+ * links of the vertices that are left stay.
+ */
+extern struct vertex_parent *
+ospf_spf_resource_view(struct vertex *root, struct list *vertex_list,
+		       struct protected_resource *resource, struct list *view);
 extern struct vertex *ospf_spf_vertex_find(struct in_addr id,
 					   struct list *vertex_list);
 extern struct vertex *ospf_spf_vertex_by_nexthop(struct vertex *root,
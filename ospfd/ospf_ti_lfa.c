@@ -22,6 +22,7 @@
 
 #include <zebra.h>
 
+#include "jhash.h"
 #include "prefix.h"
 #include "table.h"
 #include "printfrr.h"
@@ -41,10 +42,26 @@ DECLARE_RBTREE_UNIQ(p_spaces, struct p_space, p_spaces_item,
 DECLARE_RBTREE_UNIQ(q_spaces, struct q_space, q_spaces_item,
 		    q_spaces_compare_func);
 
+static int reverse_spfs_cmp(const struct reverse_spf *a,
+			    const struct reverse_spf *b)
+{
+	return numcmp((uintptr_t)a->root_lsa, (uintptr_t)b->root_lsa);
+}
+
+static uint32_t reverse_spfs_hash(const struct reverse_spf *rspf)
+{
+	return jhash_1word(rspf->root_lsa->data->id.s_addr,
+			   rspf->root_lsa->data->type);
+}
+
+DECLARE_HASH(reverse_spfs, struct reverse_spf, reverse_spfs_item,
+	     reverse_spfs_cmp, reverse_spfs_hash);
+
 static void
 ospf_ti_lfa_generate_p_space(struct ospf_area *area, struct vertex *child,
 			     struct protected_resource *protected_resource,
 			     bool recursive, struct list *pc_path);
+static void ospf_ti_lfa_p_spaces_free(struct ospf_area *area);
 
 void ospf_print_protected_resource(
 	struct protected_resource *protected_resource, char *buf)
@@ -70,6 +87,51 @@ void ospf_print_protected_resource(
 	}
 }
 
+/* Like ospf_spf_vertex_parent_find(), for a vertex of the P space */
+static struct vertex_parent *
+ospf_ti_lfa_p_space_parent_find(struct p_space *p_space, struct in_addr id,
+				struct vertex *vertex)
+{
+	struct listnode *node;
+	struct vertex_parent *vertex_parent;
+
+	for (ALL_LIST_ELEMENTS_RO(vertex->parents, node, vertex_parent)) {
+		if (vertex_parent != p_space->cut_link
+		    && vertex_parent->parent->id.s_addr == id.s_addr)
+			return vertex_parent;
+	}
+
+	return NULL;
+}
+
+/* Find a child of a vertex in the Q space by its id */
+static struct vertex *ospf_ti_lfa_q_space_child(struct q_space *q_space,
+						struct vertex *q_node,
+						struct in_addr id)
+{
+	struct listnode *node;
+	struct vertex *child;
+	struct vertex_parent *cut_link = q_space->cut_link, *vertex_parent;
+
+	child = ospf_spf_vertex_find(id, q_node->children);
+	if (!child || !listnode_lookup(q_space->vertex_list, child))
+		return NULL;
+
+	if (!cut_link || cut_link->parent != q_node
+	    || !listnode_lookup(child->parents, cut_link))
+		return child;
+
+	/* The cut out link to the child might not be the only one. */
+	for (ALL_LIST_ELEMENTS_RO(child->parents, node, vertex_parent)) {
+		if (vertex_parent->parent == q_node
+		    && vertex_parent->nexthop->router.s_addr
+			       != cut_link->nexthop->router.s_addr)
+			return child;
+	}
+
+	return NULL;
+}
+
 static enum ospf_ti_lfa_p_q_space_adjacency
 ospf_ti_lfa_find_p_node(struct vertex *pc_node, struct p_space *p_space,
 			struct q_space *q_space)
@@ -146,7 +208,7 @@ static void ospf_ti_lfa_find_q_node(struct vertex *pc_node,
 	 * SPF. Hence compare PC SPF parent to Q space children.
 	 */
 	q_space_parent =
-		ospf_spf_vertex_find(pc_node_parent->id, q_node->children);
+		ospf_ti_lfa_q_space_child(q_space, q_node, pc_node_parent->id);
 
 	/*
 	 * If the Q space parent doesn't exist we 'hit' the border to the P
@@ -377,7 +439,7 @@ static void ospf_ti_lfa_generate_inner_label_stack(
 	}
 
 	/* Cleanup */
-	ospf_ti_lfa_free_p_spaces(area);
+	ospf_ti_lfa_p_spaces_free(area);
 	ospf_spf_cleanup(area->spf, area->spf_vertex_list);
 
 	/* ... and copy the current state back. */
@@ -480,8 +542,8 @@ static void ospf_ti_lfa_generate_label_stack(struct ospf_area *area,
 		 * instead of the prefix SID. For the Q node always take the
 		 * adjacency SID.
 		 */
-		if (ospf_spf_vertex_parent_find(p_space->root->id,
-						q_space->p_node_info->node))
+		if (ospf_ti_lfa_p_space_parent_find(p_space, p_space->root->id,
+						    q_space->p_node_info->node))
 			labels[0] = ospf_sr_get_adj_sid_by_id(
 				&p_space->root->id,
 				&q_space->p_node_info->node->id);
@@ -538,8 +600,8 @@ static void ospf_ti_lfa_generate_label_stack(struct ospf_area *area,
 				q_space->nexthop = inner_backup_path_info
 							   .q_node_info.nexthop;
 
-		} else if (ospf_spf_vertex_parent_find(
-				   p_space->root->id,
+		} else if (ospf_ti_lfa_p_space_parent_find(
+				   p_space, p_space->root->id,
 				   q_space->p_node_info->node)) {
 			/*
 			 * It can happen that the outer P node is a child of
@@ -630,6 +692,46 @@ ospf_ti_lfa_generate_post_convergence_path(struct list *pc_vertex_list,
 	return pc_path;
 }
 
+/*
+ * The reverse SPF tree for a Q space root doesn't depend on the protected
+ * resource (it is cut out afterwards), so it is only computed once for all
+ * P spaces.
+ */
+static struct reverse_spf *ospf_ti_lfa_reverse_spf(struct ospf_area *area,
+						   struct ospf_lsa *root_lsa)
+{
+	struct route_table *new_table, *new_rtrs;
+	struct reverse_spf *rspf, rspf_search;
+
+	rspf_search.root_lsa = root_lsa;
+	rspf = reverse_spfs_find(area->reverse_spfs, &rspf_search);
+	if (rspf)
+		return rspf;
+
+	new_table = route_table_init();
+	/* XXX do these get  freed?? */
+	new_rtrs = route_table_init();
+
+	/*
+	 * Generate a new (reversed!) SPF tree for this vertex,
+	 * dry run true, root node false
+	 */
+	area->spf_reversed = true;
+	ospf_spf_calculate(area, root_lsa, new_table, NULL, new_rtrs, true,
+			   false);
+
+	/* Reset the flag for reverse SPF */
+	area->spf_reversed = false;
+
+	rspf = XCALLOC(MTYPE_OSPF_Q_SPACE, sizeof(struct reverse_spf));
+	rspf->root_lsa = root_lsa;
+	rspf->spf = area->spf;
+	rspf->vertex_list = area->spf_vertex_list;
+	reverse_spfs_add(area->reverse_spfs, rspf);
+
+	return rspf;
+}
+
 static void ospf_ti_lfa_generate_q_spaces(struct ospf_area *area,
 					  struct p_space *p_space,
 					  struct vertex *dest, bool recursive,
@@ -637,7 +739,7 @@ static void ospf_ti_lfa_generate_q_spaces(struct ospf_area *area,
 {
 	struct listnode *node;
 	struct vertex *child;
-	struct route_table *new_table, *new_rtrs;
+	struct reverse_spf *rspf;
 	struct q_space *q_space, q_space_search;
 	char label_buf[MPLS_LABEL_STRLEN];
 	char res_buf[PROTECTED_RESOURCE_STRLEN];
@@ -675,23 +777,8 @@ static void ospf_ti_lfa_generate_q_spaces(struct ospf_area *area,
 	q_space->q_node_info = XCALLOC(MTYPE_OSPF_Q_SPACE,
 				       sizeof(struct ospf_ti_lfa_node_info));
 
-	new_table = route_table_init();
-	/* XXX do these get  freed?? */
-	new_rtrs = route_table_init();
-
-	/*
-	 * Generate a new (reversed!) SPF tree for this vertex,
-	 * dry run true, root node false
-	 */
-	area->spf_reversed = true;
-	ospf_spf_calculate(area, dest->lsa_p, new_table, NULL, new_rtrs, true,
-			   false);
-
-	/* Reset the flag for reverse SPF */
-	area->spf_reversed = false;
-
-	q_space->root = area->spf;
-	q_space->vertex_list = area->spf_vertex_list;
+	rspf = ospf_ti_lfa_reverse_spf(area, dest->lsa_p);
+	q_space->root = rspf->spf;
 	q_space->label_stack = NULL;
 
 	if (pc_path)
@@ -710,9 +797,11 @@ static void ospf_ti_lfa_generate_q_spaces(struct ospf_area *area,
 		return;
 	}
 
-	/* 'Cut' the protected resource out of the new SPF tree */
-	ospf_spf_remove_resource(q_space->root, q_space->vertex_list,
-				 p_space->protected_resource);
+	/* 'Cut' the protected resource out of the reverse SPF tree */
+	q_space->vertex_list = list_new();
+	q_space->cut_link = ospf_spf_resource_view(
+		q_space->root, rspf->vertex_list, p_space->protected_resource,
+		q_space->vertex_list);
 
 	/*
 	 * Generate the smallest possible label stack from the root of the P
@@ -787,16 +876,12 @@ ospf_ti_lfa_generate_p_space(struct ospf_area *area, struct vertex *child,
 			     bool recursive, struct list *pc_path)
 {
 	struct vertex *spf_orig;
-	struct list *vertex_list, *vertex_list_orig;
+	struct list *vertex_list_orig;
 	struct p_space *p_space;
 
 	p_space = XCALLOC(MTYPE_OSPF_P_SPACE, sizeof(struct p_space));
-	vertex_list = list_new();
-
-	/* The P-space will get its own SPF tree, so copy the old one */
-	ospf_spf_copy(area->spf, vertex_list);
-	p_space->root = listnode_head(vertex_list);
-	p_space->vertex_list = vertex_list;
+	p_space->root = area->spf;
+	p_space->vertex_list = list_new();
 	p_space->protected_resource = protected_resource;
 
 	/* Initialize the Q spaces for this P space and protected resource */
@@ -804,9 +889,10 @@ ospf_ti_lfa_generate_p_space(struct ospf_area *area, struct vertex *child,
 		XCALLOC(MTYPE_OSPF_Q_SPACE, sizeof(struct q_spaces_head));
 	q_spaces_init(p_space->q_spaces);
 
-	/* 'Cut' the protected resource out of the new SPF tree */
-	ospf_spf_remove_resource(p_space->root, p_space->vertex_list,
-				 p_space->protected_resource);
+	/* 'Cut' the protected resource out of the SPF tree */
+	p_space->cut_link = ospf_spf_resource_view(
+		area->spf, area->spf_vertex_list, p_space->protected_resource,
+		p_space->vertex_list);
 
 	/*
 	 * Since we are going to calculate more SPF trees for Q spaces, keep the
@@ -843,6 +929,9 @@ void ospf_ti_lfa_generate_p_spaces(struct ospf_area *area,
 	area->p_spaces =
 		XCALLOC(MTYPE_OSPF_P_SPACE, sizeof(struct p_spaces_head));
 	p_spaces_init(area->p_spaces);
+	area->reverse_spfs =
+		XCALLOC(MTYPE_OSPF_Q_SPACE, sizeof(struct reverse_spfs_head));
+	reverse_spfs_init(area->reverse_spfs);
 
 	root = area->spf;
 
@@ -1069,14 +1158,15 @@ void ospf_ti_lfa_insert_backup_paths(struct ospf_area *area,
 	}
 }
 
-void ospf_ti_lfa_free_p_spaces(struct ospf_area *area)
+static void ospf_ti_lfa_p_spaces_free(struct ospf_area *area)
 {
 	struct p_space *p_space;
 	struct q_space *q_space;
 
 	while ((p_space = p_spaces_pop(area->p_spaces))) {
 		while ((q_space = q_spaces_pop(p_space->q_spaces))) {
-			ospf_spf_cleanup(q_space->root, q_space->vertex_list);
+			if (q_space->vertex_list)
+				list_delete(&q_space->vertex_list);
 
 			if (q_space->pc_path)
 				list_delete(&q_space->pc_path);
@@ -1087,7 +1177,7 @@ void ospf_ti_lfa_free_p_spaces(struct ospf_area *area)
 			XFREE(MTYPE_OSPF_Q_SPACE, q_space);
 		}
 
-		ospf_spf_cleanup(p_space->root, p_space->vertex_list);
+		list_delete(&p_space->vertex_list);
 		ospf_spf_cleanup(p_space->pc_spf, p_space->pc_vertex_list);
 		XFREE(MTYPE_OSPF_P_SPACE, p_space->protected_resource);
 
@@ -1099,6 +1189,21 @@ void ospf_ti_lfa_free_p_spaces(struct ospf_area *area)
 	XFREE(MTYPE_OSPF_P_SPACE, area->p_spaces);
 }
 
+void ospf_ti_lfa_free_p_spaces(struct ospf_area *area)
+{
+	struct reverse_spf *rspf;
+
+	ospf_ti_lfa_p_spaces_free(area);
+
+	while ((rspf = reverse_spfs_pop(area->reverse_spfs))) {
+		ospf_spf_cleanup(rspf->spf, rspf->vertex_list);
+		XFREE(MTYPE_OSPF_Q_SPACE, rspf);
+	}
+
+	reverse_spfs_fini(area->reverse_spfs);
+	XFREE(MTYPE_OSPF_Q_SPACE, area->reverse_spfs);
+}
+
 void ospf_ti_lfa_compute(struct ospf_area *area, struct route_table *new_table,
 			 enum protection_type protection_type)
 {
@@ -2383,6 +2383,43 @@ DEFUN (no_ospf_timers_lsa_min_arrival,
 	return CMD_SUCCESS;
 }
 
+DEFPY (ospf_timers_lsa_flood_delay,
+       ospf_timers_lsa_flood_delay_cmd,
+       "[no] timers lsa flood-delay ![(0-1000)$delay]",
+       NO_STR
+       "Adjust routing timers\n"
+       "OSPF LSA timers\n"
+       "Time LSAs to flood wait to be sent in the same LS Update\n"
+       "Delay in milliseconds\n")
+{
+	VTY_DECLVAR_INSTANCE_CONTEXT(ospf, ospf);
+
+	ospf->flood_delay = no ? OSPF_FLOOD_DELAY_DEFAULT : delay;
+	return CMD_SUCCESS;
+}
+
+DEFPY (ospf_timers_lsa_flood_pacing,
+       ospf_timers_lsa_flood_pacing_cmd,
+       "[no] timers lsa flood-pacing ![(1-10000)$burst (1-60000)$interval]",
+       NO_STR
+       "Adjust routing timers\n"
+       "OSPF LSA timers\n"
+       "Limit the rate of LS Updates sent on an interface\n"
+       "Number of LS Updates sent at once\n"
+       "Interval between these in milliseconds\n")
+{
+	VTY_DECLVAR_INSTANCE_CONTEXT(ospf, ospf);
+
+	if (no) {
+		ospf->flood_burst = OSPF_FLOOD_BURST_DEFAULT;
+		ospf->flood_interval = 0;
+	} else {
+		ospf->flood_burst = burst;
+		ospf->flood_interval = interval;
+	}
+	return CMD_SUCCESS;
+}
+
 DEFUN (ospf_neighbor,
        ospf_neighbor_cmd,
        "neighbor A.B.C.D [priority (0-255) [poll-interval (1-65535)]]",
@@ -2953,6 +2990,8 @@ static void show_ip_ospf_area(struct vty *vty, struct ospf_area *area,
 		/* Show SPF calculation times. */
 		json_object_int_add(json_area, "spfExecutedCounter",
 				    area->spf_calculation);
+		json_object_int_add(json_area, "prcExecutedCounter",
+				    area->prc_calculation);
 		json_object_int_add(json_area, "lsaNumber", area->lsdb->total);
 		json_object_int_add(
 			json_area, "lsaRouterNumber",
@@ -3007,6 +3046,9 @@ static void show_ip_ospf_area(struct vty *vty, struct ospf_area *area,
 		/* Show SPF calculation times. */
 		vty_out(vty, "   SPF algorithm executed %d times\n",
 			area->spf_calculation);
+		vty_out(vty,
+			"   Partial route calculation executed %d times\n",
+			area->prc_calculation);
 
 		/* Show number of LSA. */
 		vty_out(vty, "   Number of LSA %ld\n", area->lsdb->total);
@@ -3245,6 +3287,14 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 				    ospf->min_ls_interval);
 		json_object_int_add(json_vrf, "lsaMinArrivalMsecs",
 				    ospf->min_ls_arrival);
+		json_object_int_add(json_vrf, "lsaFloodDelayMsecs",
+				    ospf->flood_delay);
+		if (ospf->flood_burst) {
+			json_object_int_add(json_vrf, "lsaFloodPacingPackets",
+					    ospf->flood_burst);
+			json_object_int_add(json_vrf, "lsaFloodPacingMsecs",
+					    ospf->flood_interval);
+		}
 		/* Show write multiplier values */
 		json_object_int_add(json_vrf, "writeMultiplier",
 				    ospf->write_oi_count);
@@ -3271,6 +3321,11 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 			ospf->min_ls_interval);
 		vty_out(vty, " LSA minimum arrival %d msecs\n",
 			ospf->min_ls_arrival);
+		vty_out(vty, " LSA flood delay %u msecs\n", ospf->flood_delay);
+		if (ospf->flood_burst)
+			vty_out(vty,
+				" LSA flood pacing %u LS Updates per %u msecs\n",
+				ospf->flood_burst, ospf->flood_interval);
 
 		/* Show write multiplier values */
 		vty_out(vty, " Write Multiplier set to %d \n",
@@ -12588,6 +12643,11 @@ static int ospf_config_write_one(struct vty *vty, struct ospf *ospf)
 	if (ospf->min_ls_arrival != OSPF_MIN_LS_ARRIVAL)
 		vty_out(vty, " timers lsa min-arrival %d\n",
 			ospf->min_ls_arrival);
+	if (ospf->flood_delay != OSPF_FLOOD_DELAY_DEFAULT)
+		vty_out(vty, " timers lsa flood-delay %u\n", ospf->flood_delay);
+	if (ospf->flood_burst != OSPF_FLOOD_BURST_DEFAULT)
+		vty_out(vty, " timers lsa flood-pacing %u %u\n",
+			ospf->flood_burst, ospf->flood_interval);
 
 	/* Write multiplier print. */
 	if (ospf->write_oi_count != OSPF_WRITE_INTERFACE_COUNT_DEFAULT)
@@ -13066,6 +13126,8 @@ void ospf_vty_init(void)
 	install_element(OSPF_NODE, &no_ospf_timers_min_ls_interval_cmd);
 	install_element(OSPF_NODE, &ospf_timers_lsa_min_arrival_cmd);
 	install_element(OSPF_NODE, &no_ospf_timers_lsa_min_arrival_cmd);
+	install_element(OSPF_NODE, &ospf_timers_lsa_flood_delay_cmd);
+	install_element(OSPF_NODE, &ospf_timers_lsa_flood_pacing_cmd);
 
 	/* refresh timer commands */
 	install_element(OSPF_NODE, &ospf_refresh_timer_cmd);
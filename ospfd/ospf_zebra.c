@@ -288,6 +288,16 @@ static void ospf_zebra_append_opaque_attr(struct ospf_route *or,
 	memcpy(api->opaque.data, &ospf_opaque, api->opaque.length);
 }
 
+void ospf_zebra_batch_begin(void)
+{
+	zclient_route_batch_begin(zclient);
+}
+
+void ospf_zebra_batch_commit(void)
+{
+	zclient_route_batch_commit(zclient);
+}
+
 void ospf_zebra_add(struct ospf *ospf, struct prefix_ipv4 *p,
 		    struct ospf_route * or)
 {
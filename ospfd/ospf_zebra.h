@@ -50,6 +50,10 @@ extern void ospf_zebra_delete(struct ospf *ospf, struct prefix_ipv4 *,
 extern void ospf_zebra_add_discard(struct ospf *ospf, struct prefix_ipv4 *);
 extern void ospf_zebra_delete_discard(struct ospf *ospf, struct prefix_ipv4 *);
 
+/* Send route updates in between as batches */
+extern void ospf_zebra_batch_begin(void);
+extern void ospf_zebra_batch_commit(void);
+
 extern int ospf_redistribute_check(struct ospf *, struct external_info *,
 				   int *);
 extern int ospf_distribute_check_connected(struct ospf *,
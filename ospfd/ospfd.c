@@ -370,6 +370,8 @@ struct ospf *ospf_new_alloc(unsigned short instance, const char *name)
 	/* LSA timers */
 	new->min_ls_interval = OSPF_MIN_LS_INTERVAL;
 	new->min_ls_arrival = OSPF_MIN_LS_ARRIVAL;
+	new->flood_delay = OSPF_FLOOD_DELAY_DEFAULT;
+	new->flood_burst = OSPF_FLOOD_BURST_DEFAULT;
 
 	/* SPF timer value init. */
 	new->spf_delay = OSPF_SPF_DELAY_DEFAULT;
@@ -397,7 +399,8 @@ struct ospf *ospf_new_alloc(unsigned short instance, const char *name)
 			 new->lsa_refresh_interval, &new->t_lsa_refresher);
 	new->lsa_refresher_started = monotime(NULL);
 
-	new->ibuf = stream_new(OSPF_MAX_PACKET_SIZE + 1);
+	for (i = 0; i < OSPF_READ_BATCH; i++)
+		new->ibuf[i] = stream_new(OSPF_MAX_PACKET_SIZE + 1);
 
 	new->t_read = NULL;
 	new->oi_write_q = list_new();
@@ -900,7 +903,8 @@ static void ospf_finish_final(struct ospf *ospf)
 	ospf_gr_helper_instance_stop(ospf);
 
 	close(ospf->fd);
-	stream_free(ospf->ibuf);
+	for (i = 0; i < OSPF_READ_BATCH; i++)
+		stream_free(ospf->ibuf[i]);
 	ospf->fd = -1;
 	ospf->max_multipath = MULTIPATH_NUM;
 	ospf_delete(ospf);
@@ -975,6 +979,8 @@ static void ospf_area_free(struct ospf_area *area)
 {
 	ospf_opaque_type10_lsa_term(area);
 
+	ospf_spf_tree_free(area);
+
 	/* Free LSDBs. */
 	ospf_area_lsdb_discard_delete(area);
 
@@ -201,12 +201,22 @@ struct ospf {
 	unsigned int min_ls_arrival;  /* minimum interarrival time between LSAs
 					 (in msec) */
 
+	/* LS Update flooding: how long LSAs wait to share packets, and how
+	 * many LS Updates an interface sends per interval (0: no limit)
+	 */
+	unsigned int flood_delay;    /* msec */
+	unsigned int flood_burst;
+	unsigned int flood_interval; /* msec */
+#define OSPF_FLOOD_DELAY_DEFAULT 0
+#define OSPF_FLOOD_BURST_DEFAULT 0
+
 	/* SPF parameters */
 	unsigned int spf_delay;	/* SPF delay time. */
 	unsigned int spf_holdtime;     /* SPF hold time. */
 	unsigned int spf_max_holdtime; /* SPF maximum-holdtime */
 	unsigned int
 		spf_hold_multiplier; /* Adaptive multiplier for hold time */
+	unsigned int spf_reasons; /* ospf_spf_reason_t bits of the next SPF */
 
 	int default_originate;	/* Default information originate. */
 #define DEFAULT_ORIGINATE_NONE		0
@@ -279,7 +289,9 @@ struct ospf {
 	int write_oi_count; /* Num of packets sent per thread invocation */
 	struct thread *t_read;
 	int fd;
-	struct stream *ibuf;
+	/* packets are read up to this many at once, see ospf_read() */
+#define OSPF_READ_BATCH 8
+	struct stream *ibuf[OSPF_READ_BATCH];
 	struct list *oi_write_q;
 
 	/* Distribute lists out of other route sources. */
@@ -445,8 +457,11 @@ struct protected_resource {
 
 PREDECL_RBTREE_UNIQ(q_spaces);
 struct q_space {
+	/* reverse SPF tree, shared with other P spaces */
 	struct vertex *root;
+	/* vertices of the tree left without the protected resource */
 	struct list *vertex_list;
+	struct vertex_parent *cut_link;
 	struct mpls_label_stack *label_stack;
 	struct in_addr nexthop;
 	struct list *pc_path;
@@ -457,15 +472,27 @@ struct q_space {
 
 PREDECL_RBTREE_UNIQ(p_spaces);
 struct p_space {
+	/* SPF tree of the area, shared with other P spaces */
 	struct vertex *root;
 	struct protected_resource *protected_resource;
 	struct q_spaces_head *q_spaces;
+	/* vertices of the tree left without the protected resource */
 	struct list *vertex_list;
+	struct vertex_parent *cut_link;
 	struct vertex *pc_spf;
 	struct list *pc_vertex_list;
 	struct p_spaces_item p_spaces_item;
 };
 
+/* Reverse SPF trees for Q spaces, by root, the same for all P spaces */
+PREDECL_HASH(reverse_spfs);
+struct reverse_spf {
+	struct ospf_lsa *root_lsa;
+	struct vertex *spf;
+	struct list *vertex_list;
+	struct reverse_spfs_item reverse_spfs_item;
+};
+
 /* OSPF area structure. */
 struct ospf_area {
 	/* OSPF instance. */
@@ -554,7 +581,7 @@ struct ospf_area {
 #define PREFIX_LIST_OUT(A)  (A)->plist_out.list
 #define PREFIX_NAME_OUT(A)  (A)->plist_out.name
 
-	/* Shortest Path Tree. */
+	/* Shortest Path Tree, kept for partial route calculation. */
 	struct vertex *spf;
 	struct list *spf_vertex_list;
 
@@ -568,6 +595,7 @@ struct ospf_area {
 
 	/* P/Q spaces for TI-LFA */
 	struct p_spaces_head *p_spaces;
+	struct reverse_spfs_head *reverse_spfs;
 
 	/* Threads. */
 	struct thread *t_stub_router;     /* Stub-router timer */
@@ -575,6 +603,7 @@ struct ospf_area {
 
 	/* Statistics field. */
 	uint32_t spf_calculation; /* SPF Calculation Count. */
+	uint32_t prc_calculation; /* Partial Route Calculation Count. */
 
 	/* reverse SPF (used for TI-LFA Q spaces) */
 	bool spf_reversed;
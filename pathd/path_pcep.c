@@ -270,13 +270,51 @@ int pcep_main_event_initiate_candidate(struct path *path)
 	return ret;
 }
 
+/* A candidate path update, to be reported once applied */
+struct pcep_update {
+	struct path *path;
+	bool not_changed;
+};
+
+static void pcep_update_free(void *arg)
+{
+	struct pcep_update *update = arg;
+
+	XFREE(MTYPE_PCEP, update);
+}
+
+static void pcep_apply_updates(struct thread *thread)
+{
+	struct pcep_update *update;
+
+	srte_apply_changes();
+
+	while ((update = listnode_head(pcep_g->updates))) {
+		listnode_delete(pcep_g->updates, update);
+		notify_status(update->path, update->not_changed);
+		pcep_update_free(update);
+	}
+}
+
+/*
+ * A PCE may push thousands of updates at once, each of them coming as its
+ * own event: they are applied together once everything queued so far has
+ * been processed, srte_apply_changes() walking all the policies.
+ */
 int pcep_main_event_update_candidate(struct path *path)
 {
+	struct pcep_update *update;
 	int ret = 0;
 
 	ret = path_pcep_config_update_path(path);
-	if (ret != PATH_NB_ERR && path->srp_id != 0)
-		notify_status(path, ret == PATH_NB_NO_CHANGE);
+	if (ret != PATH_NB_ERR && path->srp_id != 0) {
+		update = XCALLOC(MTYPE_PCEP, sizeof(*update));
+		update->path = path;
+		update->not_changed = ret == PATH_NB_NO_CHANGE;
+		listnode_add(pcep_g->updates, update);
+	}
+	thread_add_event(pcep_g->master, pcep_apply_updates, NULL, 0,
+			 &pcep_g->t_apply_updates);
 	return ret;
 }
 
@@ -337,6 +375,8 @@ static int pcep_module_config_pre(struct thread_master *tm)
 		return 1;
 
 	pcep_g->master = tm;
+	pcep_g->updates = list_new();
+	pcep_g->updates->del = pcep_update_free;
 	pcep_g->fpt = fpt;
 
 	return 0;
@@ -358,6 +398,10 @@ static int pcep_module_late_init(struct thread_master *tm)
 
 int pcep_module_finish(void)
 {
+	THREAD_OFF(pcep_g->t_apply_updates);
+	if (pcep_g->updates)
+		list_delete(&pcep_g->updates);
+
 	pcep_ctrl_finalize(&pcep_g->fpt);
 	pcep_lib_finalize();
 
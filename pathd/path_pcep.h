@@ -313,6 +313,9 @@ struct pcep_glob {
 	struct pce_opts_cli *pce_opts_cli[MAX_PCE];
 	uint8_t num_config_group_opts;
 	struct pcep_config_group_opts *config_group_opts[MAX_PCE];
+	/* candidate path updates waiting for srte_apply_changes() */
+	struct list *updates;
+	struct thread *t_apply_updates;
 };
 
 extern struct pcep_glob *pcep_g;
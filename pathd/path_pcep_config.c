@@ -282,6 +282,7 @@ int path_pcep_config_initiate_path(struct path *path)
 {
 	struct srte_policy *policy;
 	struct srte_candidate *candidate;
+	int ret;
 
 	if (path->do_remove) {
 		zlog_warn("PCE %s tried to REMOVE pce-initiate a path ",
@@ -361,7 +362,9 @@ int path_pcep_config_initiate_path(struct path *path)
 				return 1;
 			}
 		}
-		return path_pcep_config_update_path(path);
+		ret = path_pcep_config_update_path(path);
+		srte_apply_changes();
+		return ret;
 	}
 	return 0;
 }
@@ -452,11 +455,10 @@ int path_pcep_config_update_path(struct path *path)
 		candidate->lsp->objfun = path->pce_objfun;
 	}
 
+	/* TED queries don't match PCE: srte_apply_changes() skips it */
 	if (number_of_sid_clashed)
 		SET_FLAG(segment->segment_list->flags,
 			 F_SEGMENT_LIST_SID_CONFLICT);
-	else
-		srte_apply_changes();
 
 	return 0;
 }
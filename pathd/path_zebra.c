@@ -289,25 +289,29 @@ static int path_zebra_opaque_msg_handler(ZAPI_CALLBACK_ARGS)
 		/* Start receiving ls data so cancel request sync timer */
 		path_ted_timer_sync_cancel();
 
-		struct ls_message *msg = ls_parse_msg(s);
-
-		if (msg) {
-			zlog_debug("%s: [rcv ted] ls (%s) msg (%s)-(%s) !",
-				   __func__,
-				   info.type == LINK_STATE_UPDATE
-					   ? "LINK_STATE_UPDATE"
-					   : "LINK_STATE_SYNC",
-				   LS_MSG_TYPE_PRINT(msg->type),
-				   LS_MSG_EVENT_PRINT(msg->event));
-		} else {
-			zlog_err(
-				"%s: [rcv ted] Could not parse LinkState stream message.",
-				__func__);
-			return -1;
+		/* Synchronization packs several elements in one message */
+		while (STREAM_READABLE(s)) {
+			struct ls_message *msg = ls_parse_msg(s);
+
+			if (msg) {
+				zlog_debug("%s: [rcv ted] ls (%s) msg (%s)-(%s) !",
+					   __func__,
+					   info.type == LINK_STATE_UPDATE
+						   ? "LINK_STATE_UPDATE"
+						   : "LINK_STATE_SYNC",
+					   LS_MSG_TYPE_PRINT(msg->type),
+					   LS_MSG_EVENT_PRINT(msg->event));
+			} else {
+				zlog_err(
+					"%s: [rcv ted] Could not parse LinkState stream message.",
+					__func__);
+				ret = -1;
+				break;
+			}
+
+			ret = path_ted_rcvd_message(msg);
+			ls_delete_msg(msg);
 		}
-
-		ret = path_ted_rcvd_message(msg);
-		ls_delete_msg(msg);
 		/* Update local configuration after process update. */
 		path_ted_segment_list_refresh();
 		break;
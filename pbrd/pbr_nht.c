@@ -36,6 +36,7 @@
 #include "pbrd/pbr_debug.h"
 
 DEFINE_MTYPE_STATIC(PBRD, PBR_NHG, "PBR Nexthop Groups");
+DEFINE_MTYPE_STATIC(PBRD, PBR_NHT_GW, "PBR Nexthop Gateway");
 
 struct hash *pbr_nhg_hash;
 static struct hash *pbr_nhrc_hash;
@@ -62,6 +63,101 @@ struct nhrc {
 	unsigned int refcount;
 };
 
+/*
+ * Nexthop tracking updates are for a gateway address.  Rather than asking
+ * every nexthop group whether it has a nexthop with that address, keep the
+ * nexthop cache entries for each gateway on a list, so that an update only
+ * visits the groups that actually use it.
+ */
+PREDECL_HASH(pbr_nht_gws);
+
+struct pbr_nht_gw {
+	struct pbr_nht_gws_item itm;
+
+	uint8_t family;
+	union g_addr gate;
+
+	struct pbr_nhc_gw_list_head nhcs;
+};
+
+DECLARE_DLIST(pbr_nhc_gw_list, struct pbr_nexthop_cache, gw_item);
+
+static size_t pbr_nht_gw_addrlen(uint8_t family)
+{
+	return family == AF_INET ? sizeof(struct in_addr)
+				 : sizeof(struct in6_addr);
+}
+
+static int pbr_nht_gw_cmp(const struct pbr_nht_gw *a,
+			  const struct pbr_nht_gw *b)
+{
+	if (a->family != b->family)
+		return numcmp(a->family, b->family);
+	return memcmp(&a->gate, &b->gate, pbr_nht_gw_addrlen(a->family));
+}
+
+static uint32_t pbr_nht_gw_hash(const struct pbr_nht_gw *gw)
+{
+	return jhash(&gw->gate, pbr_nht_gw_addrlen(gw->family), gw->family);
+}
+
+DECLARE_HASH(pbr_nht_gws, struct pbr_nht_gw, itm, pbr_nht_gw_cmp,
+	     pbr_nht_gw_hash);
+
+static struct pbr_nht_gws_head pbr_nht_gw_head;
+
+static void pbr_nht_gw_link(struct pbr_nexthop_cache *pnhc)
+{
+	struct pbr_nht_gw ref = {}, *gw;
+
+	switch (pnhc->nexthop.type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		ref.family = AF_INET;
+		ref.gate.ipv4 = pnhc->nexthop.gate.ipv4;
+		break;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		ref.family = AF_INET6;
+		ref.gate.ipv6 = pnhc->nexthop.gate.ipv6;
+		break;
+	case NEXTHOP_TYPE_IFINDEX:
+	case NEXTHOP_TYPE_BLACKHOLE:
+		/* not affected by nexthop tracking updates */
+		return;
+	}
+
+	gw = pbr_nht_gws_find(&pbr_nht_gw_head, &ref);
+	if (!gw) {
+		gw = XCALLOC(MTYPE_PBR_NHT_GW, sizeof(*gw));
+		gw->family = ref.family;
+		gw->gate = ref.gate;
+		pbr_nhc_gw_list_init(&gw->nhcs);
+		pbr_nht_gws_add(&pbr_nht_gw_head, gw);
+	}
+
+	pnhc->gw = gw;
+	pbr_nhc_gw_list_add_tail(&gw->nhcs, pnhc);
+}
+
+static void pbr_nht_gw_unlink(struct pbr_nexthop_cache *pnhc)
+{
+	struct pbr_nht_gw *gw = pnhc->gw;
+
+	if (!gw)
+		return;
+
+	pbr_nhc_gw_list_del(&gw->nhcs, pnhc);
+	pnhc->gw = NULL;
+
+	if (pbr_nhc_gw_list_count(&gw->nhcs))
+		return;
+
+	pbr_nhc_gw_list_fini(&gw->nhcs);
+	pbr_nht_gws_del(&pbr_nht_gw_head, gw);
+	XFREE(MTYPE_PBR_NHT_GW, gw);
+}
+
 /* Hash functions for pbr_nhrc_hash ---------------------------------------- */
 
 static void *pbr_nhrc_hash_alloc(void *p)
@@ -103,6 +199,7 @@ static void *pbr_nh_alloc(void *p)
 	pbr_send_rnh(&new->nexthop, true);
 
 	new->valid = false;
+	pbr_nht_gw_link(new);
 	return new;
 }
 
@@ -124,6 +221,7 @@ static void pbr_nh_delete(struct pbr_nexthop_cache **pnhc)
 		XFREE(MTYPE_PBR_NHG, nhrc);
 	}
 
+	pbr_nht_gw_unlink(*pnhc);
 	XFREE(MTYPE_PBR_NHG, *pnhc);
 }
 
@@ -944,16 +1042,17 @@ pbr_nexthop_group_cache_to_nexthop_group(struct nexthop_group *nhg,
 	hash_iterate(pnhgc->nhh, pbr_nexthop_group_cache_iterate_to_group, nhg);
 }
 
-static void pbr_nht_nexthop_update_lookup(struct hash_bucket *b, void *data)
+static void
+pbr_nht_nexthop_update_group(struct pbr_nexthop_group_cache *pnhgc,
+			     struct zapi_route *nhr)
 {
-	struct pbr_nexthop_group_cache *pnhgc = b->data;
 	struct pbr_nht_individual pnhi = {};
 	struct nexthop_group nhg = {};
 	bool old_valid;
 
 	old_valid = pnhgc->valid;
 
-	pnhi.nhr = (struct zapi_route *)data;
+	pnhi.nhr = nhr;
 	pnhi.valid = false;
 	pnhi.nhr_matched = false;
 	hash_iterate(pnhgc->nhh, pbr_nht_individual_nexthop_update_lookup,
@@ -983,7 +1082,48 @@ static void pbr_nht_nexthop_update_lookup(struct hash_bucket *b, void *data)
 
 void pbr_nht_nexthop_update(struct zapi_route *nhr)
 {
-	hash_iterate(pbr_nhg_hash, pbr_nht_nexthop_update_lookup, nhr);
+	static uint32_t gen;
+	struct pbr_nht_gw ref = {}, *gw;
+	struct pbr_nexthop_cache *pnhc;
+	struct pbr_nexthop_group_cache **groups;
+	size_t n = 0, i;
+
+	switch (nhr->prefix.family) {
+	case AF_INET:
+		ref.family = AF_INET;
+		ref.gate.ipv4 = nhr->prefix.u.prefix4;
+		break;
+	case AF_INET6:
+		ref.family = AF_INET6;
+		ref.gate.ipv6 = nhr->prefix.u.prefix6;
+		break;
+	default:
+		return;
+	}
+
+	gw = pbr_nht_gws_find(&pbr_nht_gw_head, &ref);
+	if (!gw)
+		return;
+
+	/* Re-validating a group can change pbr-map state, so collect the
+	 * groups first rather than doing it while walking the list.
+	 */
+	groups = XMALLOC(MTYPE_TMP,
+			 sizeof(*groups) * pbr_nhc_gw_list_count(&gw->nhcs));
+	gen++;
+
+	frr_each (pbr_nhc_gw_list, &gw->nhcs, pnhc) {
+		if (!pnhc->parent || pnhc->parent->nht_gen == gen)
+			continue;
+
+		pnhc->parent->nht_gen = gen;
+		groups[n++] = pnhc->parent;
+	}
+
+	for (i = 0; i < n; i++)
+		pbr_nht_nexthop_update_group(groups[i], nhr);
+
+	XFREE(MTYPE_TMP, groups);
 }
 
 struct nhrc_vrf_info {
@@ -1477,6 +1617,7 @@ void pbr_nht_init(void)
 	pbr_nhg_allocated_id_hash = hash_create_size(
 		16, pbr_nhg_allocated_id_hash_key,
 		pbr_nhg_allocated_id_hash_equal, "PBR Allocated Table Hash");
+	pbr_nht_gws_init(&pbr_nht_gw_head);
 
 	pbr_nhg_low_table = PBR_NHT_DEFAULT_LOW_TABLEID;
 	pbr_nhg_high_table = PBR_NHT_DEFAULT_HIGH_TABLEID;
@@ -30,6 +30,9 @@
 
 extern struct hash *pbr_nhg_hash;
 
+/* nexthop cache entries with the same gateway address */
+PREDECL_DLIST(pbr_nhc_gw_list);
+
 struct pbr_nexthop_group_cache {
 	char name[PBR_NHC_NAMELEN];
 
@@ -43,6 +46,9 @@ struct pbr_nexthop_group_cache {
 	bool valid;
 
 	bool installed;
+
+	/* to visit each group once per nexthop tracking update */
+	uint32_t nht_gen;
 };
 
 struct pbr_nexthop_cache {
@@ -56,6 +62,10 @@ struct pbr_nexthop_cache {
 	bool looked_at;
 	bool valid;
 	bool nhr_matched;
+
+	/* reverse index from the gateway to this entry, see pbr_nht_gw */
+	struct pbr_nht_gw *gw;
+	struct pbr_nhc_gw_list_item gw_item;
 };
 
 extern void pbr_nht_write_table_range(struct vty *vty);
@@ -999,6 +999,10 @@ void igmp_startup_mode_on(struct gm_sock *igmp)
 
 static void igmp_group_free(struct gm_group *group)
 {
+	/* the sources are freed with the list */
+	while (gm_source_hash_pop(&group->group_source_hash))
+		;
+	gm_source_hash_fini(&group->group_source_hash);
 	list_delete(&group->group_source_list);
 
 	XFREE(MTYPE_PIM_IGMP_GROUP, group);
@@ -1437,6 +1441,7 @@ struct gm_group *igmp_add_group_by_addr(struct gm_sock *igmp,
 
 	group->group_source_list = list_new();
 	group->group_source_list->del = (void (*)(void *))igmp_source_free;
+	gm_source_hash_init(&group->group_source_hash);
 
 	group->t_group_timer = NULL;
 	group->t_group_query_retransmit_timer = NULL;
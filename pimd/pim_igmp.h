@@ -25,6 +25,7 @@
 #include <zebra.h>
 #include "vty.h"
 #include "linklist.h"
+#include "typesafe.h"
 #include "pim_igmp_stats.h"
 #include "pim_str.h"
 
@@ -167,7 +168,10 @@ static inline void pim_igmp_other_querier_timer_off(struct gm_sock *igmp)
 #define IGMP_SOURCE_DONT_DELETE(flags)     ((flags) &= ~IGMP_SOURCE_MASK_DELETE)
 #define IGMP_SOURCE_DONT_SEND(flags)       ((flags) &= ~IGMP_SOURCE_MASK_SEND)
 
+PREDECL_HASH(gm_source_hash);
+
 struct gm_source {
+	struct gm_source_hash_item source_hash_item;
 	pim_addr source_addr;
 	struct thread *t_source_timer;
 	struct gm_group *source_group; /* back pointer */
@@ -182,6 +186,20 @@ struct gm_source {
 	int source_query_retransmit_count;
 };
 
+static inline int gm_source_hash_cmp(const struct gm_source *a,
+				     const struct gm_source *b)
+{
+	return pim_addr_cmp(a->source_addr, b->source_addr);
+}
+
+static inline uint32_t gm_source_hash_key(const struct gm_source *src)
+{
+	return jhash(&src->source_addr, sizeof(src->source_addr), 0);
+}
+
+DECLARE_HASH(gm_source_hash, struct gm_source, source_hash_item,
+	     gm_source_hash_cmp, gm_source_hash_key);
+
 struct gm_group {
 	/*
 	  RFC 3376: 6.2.2. Definition of Group Timers
@@ -206,6 +224,8 @@ struct gm_group {
 	pim_addr group_addr;
 	int group_filtermode_isexcl;    /* 0=INCLUDE, 1=EXCLUDE */
 	struct list *group_source_list; /* list of struct gm_source */
+	/* sources by address, same entries as group_source_list */
+	struct gm_source_hash_head group_source_hash;
 	time_t group_creation;
 	struct interface *interface;
 	int64_t last_igmp_v1_report_dsec;
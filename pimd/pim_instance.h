@@ -150,6 +150,7 @@ struct pim_instance {
 
 	// Upstream vrf specific information
 	struct rb_pim_upstream_head upstream_head;
+	struct pim_upstream_hash_head upstream_hash;
 	struct timer_wheel *upstream_sg_wheel;
 
 	/*
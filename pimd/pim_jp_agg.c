@@ -28,6 +28,7 @@
 #include "pim_instance.h"
 #include "pim_msg.h"
 #include "pim_jp_agg.h"
+#include "pim_neighbor.h"
 #include "pim_join.h"
 #include "pim_iface.h"
 
@@ -333,12 +334,56 @@ void pim_jp_agg_switch_interface(struct pim_rpf *orpf, struct pim_rpf *nrpf,
 }
 
 
+void pim_jp_agg_trig_cancel(struct pim_upstream *up)
+{
+	if (!up->jp_trig_nbr)
+		return;
+
+	pim_jp_agg_remove_group(up->jp_trig_nbr->upstream_jp_trig, up, NULL);
+	up->jp_trig_nbr = NULL;
+}
+
+void pim_jp_agg_trig_clear(struct pim_neighbor *nbr)
+{
+	struct listnode *gnode, *snode;
+	struct pim_jp_agg_group *jag;
+	struct pim_jp_sources *js;
+
+	for (ALL_LIST_ELEMENTS_RO(nbr->upstream_jp_trig, gnode, jag))
+		for (ALL_LIST_ELEMENTS_RO(jag->sources, snode, js))
+			js->up->jp_trig_nbr = NULL;
+
+	pim_jp_agg_clear_group(nbr->upstream_jp_trig);
+}
+
+static void pim_jp_agg_trig_send(struct thread *t)
+{
+	struct pim_neighbor *nbr = THREAD_ARG(t);
+	struct pim_rpf rpf;
+
+	if (PIM_DEBUG_PIM_TRACE)
+		zlog_debug("%s: Sending triggered joins to %pPA on %s with %d groups",
+			   __func__, &nbr->source_addr, nbr->interface->name,
+			   nbr->upstream_jp_trig->count);
+
+	rpf.source_nexthop.interface = nbr->interface;
+	rpf.rpf_addr = nbr->source_addr;
+	pim_joinprune_send(&rpf, nbr->upstream_jp_trig);
+
+	pim_jp_agg_trig_clear(nbr);
+}
+
 void pim_jp_agg_single_upstream_send(struct pim_rpf *rpf,
 				     struct pim_upstream *up, bool is_join)
 {
 	struct list groups, sources;
 	struct pim_jp_agg_group jag;
 	struct pim_jp_sources js;
+	struct pim_neighbor *nbr;
+
+	/* whatever is sent now supersedes a join still queued */
+	if (up)
+		pim_jp_agg_trig_cancel(up);
 
 	/* skip JP upstream messages if source is directly connected */
 	if (!up || !rpf->source_nexthop.interface ||
@@ -347,6 +392,19 @@ void pim_jp_agg_single_upstream_send(struct pim_rpf *rpf,
 		if_is_loopback(rpf->source_nexthop.interface))
 		return;
 
+	if (is_join) {
+		nbr = pim_neighbor_find(rpf->source_nexthop.interface,
+					rpf->rpf_addr);
+		if (nbr) {
+			pim_jp_agg_add_group(nbr->upstream_jp_trig, up, true,
+					     NULL);
+			up->jp_trig_nbr = nbr;
+			thread_add_event(router->master, pim_jp_agg_trig_send,
+					 nbr, 0, &nbr->t_jp_trig);
+			return;
+		}
+	}
+
 	memset(&groups, 0, sizeof(groups));
 	memset(&sources, 0, sizeof(sources));
 	jag.sources = &sources;
@@ -48,6 +48,15 @@ void pim_jp_agg_add_group(struct list *group, struct pim_upstream *up,
 void pim_jp_agg_switch_interface(struct pim_rpf *orpf, struct pim_rpf *nrpf,
 				 struct pim_upstream *up);
 
+/*
+ * Joins to a known neighbor are queued and sent in as few packets as
+ * possible once the current event is done; prunes go out right away.
+ */
 void pim_jp_agg_single_upstream_send(struct pim_rpf *rpf,
 				     struct pim_upstream *up, bool is_join);
+
+/* drops the queued triggered join for up, if any */
+void pim_jp_agg_trig_cancel(struct pim_upstream *up);
+/* drops all triggered joins queued for the neighbor */
+void pim_jp_agg_trig_clear(struct pim_neighbor *nbr);
 #endif
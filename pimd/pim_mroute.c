@@ -1282,7 +1282,7 @@ int pim_mroute_del(struct channel_oil *c_oil, const char *name)
 	return 0;
 }
 
-void pim_mroute_update_counters(struct channel_oil *c_oil)
+static void pim_mroute_counters(struct channel_oil *c_oil, bool lastused)
 {
 	struct pim_instance *pim = c_oil->pim;
 	pim_sioc_sg_req sgreq;
@@ -1307,7 +1307,8 @@ void pim_mroute_update_counters(struct channel_oil *c_oil)
 
 	memset(&sgreq, 0, sizeof(sgreq));
 
-	pim_zlookup_sg_statistics(c_oil);
+	if (lastused)
+		pim_zlookup_sg_statistics(c_oil);
 
 #if PIM_IPV == 4
 	sgreq.src = *oil_origin(c_oil);
@@ -1334,3 +1335,13 @@ void pim_mroute_update_counters(struct channel_oil *c_oil)
 	c_oil->cc.wrong_if = sgreq.wrong_if;
 	return;
 }
+
+void pim_mroute_update_counters(struct channel_oil *c_oil)
+{
+	pim_mroute_counters(c_oil, true);
+}
+
+void pim_mroute_update_pktcnt(struct channel_oil *c_oil)
+{
+	pim_mroute_counters(c_oil, false);
+}
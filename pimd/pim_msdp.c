@@ -282,8 +282,38 @@ static struct pim_msdp_sa *pim_msdp_sa_add(struct pim_instance *pim,
 	return pim_msdp_sa_new(pim, sg, rp);
 }
 
+static void pim_msdp_sa_tx_event(struct thread *t)
+{
+	struct pim_instance *pim = THREAD_ARG(t);
+
+	pim_msdp_pkt_sa_tx_pending(pim);
+}
+
+static void pim_msdp_sa_tx_queue(struct pim_msdp_sa *sa)
+{
+	struct pim_instance *pim = sa->pim;
+
+	if (!(sa->flags & PIM_MSDP_SAF_TX_PENDING)) {
+		sa->flags |= PIM_MSDP_SAF_TX_PENDING;
+		++pim->msdp.tx_pending_cnt;
+	}
+	thread_add_event(pim->msdp.master, pim_msdp_sa_tx_event, pim, 0,
+			 &pim->msdp.sa_tx_event);
+}
+
+static void pim_msdp_sa_tx_unqueue(struct pim_msdp_sa *sa)
+{
+	if (!(sa->flags & PIM_MSDP_SAF_TX_PENDING))
+		return;
+
+	sa->flags &= ~PIM_MSDP_SAF_TX_PENDING;
+	--sa->pim->msdp.tx_pending_cnt;
+}
+
 static void pim_msdp_sa_del(struct pim_msdp_sa *sa)
 {
+	pim_msdp_sa_tx_unqueue(sa);
+
 	/* this is somewhat redundant - still want to be careful not to leave
 	 * stale upstream references */
 	pim_msdp_sa_upstream_del(sa);
@@ -352,6 +382,7 @@ static void pim_msdp_sa_deref(struct pim_msdp_sa *sa,
 			}
 			if (sa->pim->msdp.local_cnt)
 				--sa->pim->msdp.local_cnt;
+			pim_msdp_sa_tx_unqueue(sa);
 		}
 	}
 
@@ -418,9 +449,10 @@ void pim_msdp_sa_ref(struct pim_instance *pim, struct pim_msdp_peer *mp,
 				zlog_debug("MSDP SA %s added locally",
 					   sa->sg_str);
 			}
-			/* send an immediate SA update to peers */
+			/* send an SA update to peers, batched with the other
+			 * new local SAs */
 			sa->rp = pim->msdp.originator_id;
-			pim_msdp_pkt_sa_tx_one(sa);
+			pim_msdp_sa_tx_queue(sa);
 		}
 		sa->flags &= ~PIM_MSDP_SAF_STALE;
 	}
@@ -1375,6 +1407,7 @@ void pim_msdp_exit(struct pim_instance *pim)
 	struct pim_msdp_mg *mg;
 
 	pim_msdp_sa_adv_timer_setup(pim, false);
+	THREAD_OFF(pim->msdp.sa_tx_event);
 
 	/* Stop listener and delete all peer sessions */
 	while ((mg = SLIST_FIRST(&pim->msdp.mglist)) != NULL)
@@ -72,7 +72,9 @@ enum pim_msdp_sa_flags {
 	PIM_MSDP_SAF_REF = (PIM_MSDP_SAF_LOCAL | PIM_MSDP_SAF_PEER),
 	PIM_MSDP_SAF_STALE = (1 << 2), /* local entries can get kicked out on
 					* misc pim events such as RP change */
-	PIM_MSDP_SAF_UP_DEL_IN_PROG = (1 << 3)
+	PIM_MSDP_SAF_UP_DEL_IN_PROG = (1 << 3),
+	/* new local SA, to be sent with the next batch */
+	PIM_MSDP_SAF_TX_PENDING = (1 << 4)
 };
 
 struct pim_msdp_sa {
@@ -199,6 +201,9 @@ struct pim_msdp {
 	struct hash *sa_hash;
 	struct list *sa_list;
 	uint32_t local_cnt;
+	/* new local SAs are sent together once the current event is done */
+	struct thread *sa_tx_event;
+	uint32_t tx_pending_cnt;
 
 	/* keep a scratch pad for building SA TLVs */
 	struct stream *work_obuf;
@@ -370,13 +370,18 @@ static void pim_msdp_pkt_sa_fill_one(struct pim_msdp_sa *sa)
 	stream_put_ipv4(sa->pim->msdp.work_obuf, sa->sg.src.s_addr);
 }
 
+/*
+ * Sends the SAs with flag set, cnt is how many have it.  Only local SAs
+ * are sent; sending the ones pending also takes them off the queue.
+ */
 static void pim_msdp_pkt_sa_gen(struct pim_instance *pim,
-				struct pim_msdp_peer *mp)
+				struct pim_msdp_peer *mp,
+				enum pim_msdp_sa_flags flag, int cnt)
 {
 	struct listnode *sanode;
 	struct pim_msdp_sa *sa;
 	int sa_count;
-	int local_cnt = pim->msdp.local_cnt;
+	int local_cnt = cnt;
 
 	sa_count = 0;
 	if (PIM_DEBUG_MSDP_INTERNAL) {
@@ -394,6 +399,12 @@ static void pim_msdp_pkt_sa_gen(struct pim_instance *pim,
 			 * peers */
 			continue;
 		}
+		if (!(sa->flags & flag))
+			continue;
+		if (flag == PIM_MSDP_SAF_TX_PENDING) {
+			sa->flags &= ~PIM_MSDP_SAF_TX_PENDING;
+			--pim->msdp.tx_pending_cnt;
+		}
 		/* add sa into scratch pad */
 		pim_msdp_pkt_sa_fill_one(sa);
 		++sa_count;
@@ -433,7 +444,18 @@ static void pim_msdp_pkt_sa_tx_done(struct pim_instance *pim)
 
 void pim_msdp_pkt_sa_tx(struct pim_instance *pim)
 {
-	pim_msdp_pkt_sa_gen(pim, NULL /* mp */);
+	pim_msdp_pkt_sa_gen(pim, NULL /* mp */, PIM_MSDP_SAF_LOCAL,
+			    pim->msdp.local_cnt);
+	pim_msdp_pkt_sa_tx_done(pim);
+}
+
+void pim_msdp_pkt_sa_tx_pending(struct pim_instance *pim)
+{
+	if (!pim->msdp.tx_pending_cnt)
+		return;
+
+	pim_msdp_pkt_sa_gen(pim, NULL /* mp */, PIM_MSDP_SAF_TX_PENDING,
+			    pim->msdp.tx_pending_cnt);
 	pim_msdp_pkt_sa_tx_done(pim);
 }
 
@@ -448,7 +470,8 @@ void pim_msdp_pkt_sa_tx_one(struct pim_msdp_sa *sa)
 /* when a connection is first established we push all SAs immediately */
 void pim_msdp_pkt_sa_tx_to_one_peer(struct pim_msdp_peer *mp)
 {
-	pim_msdp_pkt_sa_gen(mp->pim, mp);
+	pim_msdp_pkt_sa_gen(mp->pim, mp, PIM_MSDP_SAF_LOCAL,
+			    mp->pim->msdp.local_cnt);
 	pim_msdp_pkt_sa_tx_done(mp->pim);
 }
 
@@ -66,6 +66,8 @@
 void pim_msdp_pkt_ka_tx(struct pim_msdp_peer *mp);
 void pim_msdp_read(struct thread *thread);
 void pim_msdp_pkt_sa_tx(struct pim_instance *pim);
+/* sends the new local SAs queued since the last call */
+void pim_msdp_pkt_sa_tx_pending(struct pim_instance *pim);
 void pim_msdp_pkt_sa_tx_one(struct pim_msdp_sa *sa);
 void pim_msdp_pkt_sa_tx_to_one_peer(struct pim_msdp_peer *mp);
 void pim_msdp_pkt_sa_tx_one_to_one_peer(struct pim_msdp_peer *mp,
@@ -308,6 +308,8 @@ pim_neighbor_new(struct interface *ifp, pim_addr source_addr,
 	neigh->upstream_jp_agg->cmp = pim_jp_agg_group_list_cmp;
 	neigh->upstream_jp_agg->del =
 		(void (*)(void *))pim_jp_agg_group_list_free;
+	neigh->upstream_jp_trig = list_new();
+	neigh->upstream_jp_trig->cmp = pim_jp_agg_group_list_cmp;
 	pim_neighbor_start_jp_timer(neigh);
 
 	pim_neighbor_timer_reset(neigh, holdtime);
@@ -389,6 +391,9 @@ void pim_neighbor_free(struct pim_neighbor *neigh)
 
 	list_delete(&neigh->upstream_jp_agg);
 	THREAD_OFF(neigh->jp_timer);
+	pim_jp_agg_trig_clear(neigh);
+	list_delete(&neigh->upstream_jp_trig);
+	THREAD_OFF(neigh->t_jp_trig);
 
 	bfd_sess_free(&neigh->bfd_session);
 
@@ -45,6 +45,9 @@ struct pim_neighbor {
 
 	struct thread *jp_timer;
 	struct list *upstream_jp_agg;
+	/* triggered joins, sent together once the current event is done */
+	struct thread *t_jp_trig;
+	struct list *upstream_jp_trig;
 	struct bfd_session_params *bfd_session;
 };
 
@@ -228,6 +228,7 @@ struct pim_upstream *pim_upstream_del(struct pim_instance *pim,
 	}
 
 	join_timer_stop(up);
+	pim_jp_agg_trig_cancel(up);
 	pim_jp_agg_upstream_verification(up, false);
 	up->rpf.source_nexthop.interface = NULL;
 
@@ -253,6 +254,7 @@ struct pim_upstream *pim_upstream_del(struct pim_instance *pim,
 	up->parent = NULL;
 
 	rb_pim_upstream_del(&pim->upstream_head, up);
+	pim_upstream_hash_del(&pim->upstream_hash, up);
 
 	if (notify_msdp) {
 		pim_msdp_up_del(pim, &up->sg);
@@ -849,6 +851,7 @@ static struct pim_upstream *pim_upstream_new(struct pim_instance *pim,
 		ch->upstream = up;
 
 	rb_pim_upstream_add(&pim->upstream_head, up);
+	pim_upstream_hash_add(&pim->upstream_hash, up);
 	/* Set up->upstream_addr as INADDR_ANY, if RP is not
 	 * configured and retain the upstream data structure
 	 */
@@ -994,7 +997,7 @@ struct pim_upstream *pim_upstream_find(struct pim_instance *pim, pim_sgaddr *sg)
 	struct pim_upstream *up = NULL;
 
 	lookup.sg = *sg;
-	up = rb_pim_upstream_find(&pim->upstream_head, &lookup);
+	up = pim_upstream_hash_find(&pim->upstream_hash, &lookup);
 	return up;
 }
 
@@ -1943,6 +1946,7 @@ void pim_upstream_terminate(struct pim_instance *pim)
 	}
 
 	rb_pim_upstream_fini(&pim->upstream_head);
+	pim_upstream_hash_fini(&pim->upstream_hash);
 
 	if (pim->upstream_sg_wheel)
 		wheel_delete(pim->upstream_sg_wheel);
@@ -2010,9 +2014,12 @@ static bool pim_upstream_sg_running_proc(struct pim_upstream *up)
 	if (!up->channel_oil->installed)
 		return rv;
 
-	pim_mroute_update_counters(up->channel_oil);
+	pim_mroute_update_pktcnt(up->channel_oil);
+
+	// Have we seen packets?  If not, ask zebra when the mroute was used.
+	if (up->channel_oil->cc.oldpktcnt >= up->channel_oil->cc.pktcnt)
+		pim_zlookup_sg_statistics(up->channel_oil);
 
-	// Have we seen packets?
 	if ((up->channel_oil->cc.oldpktcnt >= up->channel_oil->cc.pktcnt)
 	    && (up->channel_oil->cc.lastused / 100 > 30)) {
 		if (PIM_DEBUG_PIM_TRACE) {
@@ -2174,4 +2181,5 @@ void pim_upstream_init(struct pim_instance *pim)
 			   pim_upstream_sg_running, name);
 
 	rb_pim_upstream_init(&pim->upstream_head);
+	pim_upstream_hash_init(&pim->upstream_hash);
 }
@@ -198,6 +198,7 @@ struct pim_up_mlag {
 };
 
 PREDECL_RBTREE_UNIQ(rb_pim_upstream);
+PREDECL_FLATHASH(pim_upstream_hash);
 /*
   Upstream (S,G) channel in Joined state
   (S,G) in the "Not Joined" state is not represented
@@ -228,6 +229,8 @@ PREDECL_RBTREE_UNIQ(rb_pim_upstream);
 struct pim_upstream {
 	struct pim_instance *pim;
 	struct rb_pim_upstream_item upstream_rb;
+	/* (S,G) lookups, the tree is for walks in order */
+	struct pim_upstream_hash_item upstream_hash;
 	struct pim_upstream *parent;
 	pim_addr upstream_addr;		  /* Who we are talking to */
 	pim_addr upstream_register;       /*Who we received a register from*/
@@ -251,6 +254,8 @@ struct pim_upstream {
 	struct pim_up_mlag mlag;
 
 	struct thread *t_join_timer;
+	/* neighbor with a triggered join for this upstream queued */
+	struct pim_neighbor *jp_trig_nbr;
 
 	/*
 	 * RST(S,G)
@@ -375,6 +380,14 @@ int pim_upstream_compare(const struct pim_upstream *up1,
 DECLARE_RBTREE_UNIQ(rb_pim_upstream, struct pim_upstream, upstream_rb,
 		    pim_upstream_compare);
 
+static inline uint32_t pim_upstream_sg_hash(const struct pim_upstream *up)
+{
+	return pim_sgaddr_hash(up->sg, 0);
+}
+
+DECLARE_FLATHASH(pim_upstream_hash, struct pim_upstream, upstream_hash,
+		 pim_upstream_compare, pim_upstream_sg_hash);
+
 void pim_upstream_register_reevaluate(struct pim_instance *pim);
 
 void pim_upstream_add_lhr_star_pimreg(struct pim_instance *pim);
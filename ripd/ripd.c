@@ -2120,6 +2120,15 @@ void rip_output_process(struct connected *ifc, struct sockaddr_in *to,
 			continue;
 
 		rinfo = listgetdata(listhead(list));
+
+		/*
+		 * Changed route only output.  Checked first, a triggered
+		 * update has no business running the filters on every route.
+		 */
+		if (route_type == rip_changed_route &&
+		    (!(rinfo->flags & RIP_RTF_CHANGED)))
+			continue;
+
 		/*
 		 * For RIPv1, if we are subnetted, output subnets in our
 		 * network that have the same mask as the output "interface".
@@ -2160,11 +2169,6 @@ void rip_output_process(struct connected *ifc, struct sockaddr_in *to,
 		if (ret < 0)
 			continue;
 
-		/* Changed route only output. */
-		if (route_type == rip_changed_route &&
-		    (!(rinfo->flags & RIP_RTF_CHANGED)))
-			continue;
-
 		/* Split horizon. */
 		if (ri->split_horizon == RIP_SPLIT_HORIZON) {
 			/*
@@ -26,6 +26,19 @@
 
 DECLARE_MGROUP(SHARPD);
 
+/* Results of the last complete route install, latencies in usec */
+struct sharp_install_stats {
+	uint32_t routes;
+	uint32_t nhgid;
+	uint64_t usec;
+
+	/* from sending a route until zebra says it is installed */
+	uint32_t p50;
+	uint32_t p99;
+	uint32_t p999;
+	uint32_t max;
+};
+
 struct sharp_routes {
 	/* The original prefix for route installation */
 	struct prefix orig_prefix;
@@ -51,6 +64,17 @@ struct sharp_routes {
 	struct timeval t_start;
 	struct timeval t_end;
 
+	/*
+	 * When each route being installed was sent, by position after
+	 * orig_prefix (0 once acked), and the ack latencies so far.
+	 */
+	int64_t *ack_sent;
+	uint32_t *ack_usec;
+	uint32_t ack_num;
+	uint32_t ack_alloc;
+
+	struct sharp_install_stats stats;
+
 	char opaque[ZAPI_MESSAGE_OPAQUE_LENGTH];
 };
 
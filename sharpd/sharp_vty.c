@@ -173,17 +173,56 @@ DEFPY(sharp_nht_data_dump,
 
 DEFPY (install_routes_data_dump,
        install_routes_data_dump_cmd,
-       "sharp data route",
+       "sharp data route [json$json]",
        "Sharp routing Protocol\n"
        "Data about what is going on\n"
-       "Route Install/Removal Information\n")
+       "Route Install/Removal Information\n"
+       JSON_STR)
 {
+	struct sharp_install_stats *st = &sg.r.stats;
+	uint64_t rate = st->usec ? st->routes * 1000000ULL / st->usec : 0;
+	json_object *jo, *jo_inst;
 	struct timeval r;
 
 	timersub(&sg.r.t_end, &sg.r.t_start, &r);
+
+	if (json) {
+		jo = json_object_new_object();
+		json_object_string_addf(jo, "prefix", "%pFX",
+					&sg.r.orig_prefix);
+		json_object_int_add(jo, "totalRoutes", sg.r.total_routes);
+		json_object_int_add(jo, "installedRoutes",
+				    sg.r.installed_routes);
+		json_object_int_add(jo, "removedRoutes", sg.r.removed_routes);
+		json_object_int_add(jo, "timeUsec",
+				    (int64_t)r.tv_sec * 1000000 + r.tv_usec);
+
+		if (st->routes) {
+			jo_inst = json_object_new_object();
+			json_object_int_add(jo_inst, "routes", st->routes);
+			json_object_int_add(jo_inst, "nexthopGroupId",
+					    st->nhgid);
+			json_object_int_add(jo_inst, "timeUsec", st->usec);
+			json_object_int_add(jo_inst, "routesPerSec", rate);
+			json_object_int_add(jo_inst, "p50Usec", st->p50);
+			json_object_int_add(jo_inst, "p99Usec", st->p99);
+			json_object_int_add(jo_inst, "p999Usec", st->p999);
+			json_object_int_add(jo_inst, "maxUsec", st->max);
+			json_object_object_add(jo, "lastInstall", jo_inst);
+		}
+
+		vty_json(vty, jo);
+		return CMD_SUCCESS;
+	}
+
 	vty_out(vty, "Prefix: %pFX Total: %u %u %u Time: %jd.%ld\n",
 		&sg.r.orig_prefix, sg.r.total_routes, sg.r.installed_routes,
 		sg.r.removed_routes, (intmax_t)r.tv_sec, (long)r.tv_usec);
+	if (st->routes)
+		vty_out(vty,
+			"Last install: %u routes, %" PRIu64
+			" routes/sec, latency usec p50 %u p99 %u p99.9 %u max %u\n",
+			st->routes, rate, st->p50, st->p99, st->p999, st->max);
 
 	return CMD_SUCCESS;
 }
@@ -1253,6 +1292,7 @@ DEFPY (show_sharp_cspf,
 	}
 	if (path->status != SUCCESS) {
 		vty_out(vty, "Path computation failed: %d\n", path->status);
+		cspf_path_del(path);
 		return CMD_SUCCESS;
 	}
 
@@ -1268,6 +1308,7 @@ DEFPY (show_sharp_cspf,
 				&edge->attributes->standard.remote6);
 	}
 	vty_out(vty, "\n");
+	cspf_path_del(path);
 
 	return CMD_SUCCESS;
 }
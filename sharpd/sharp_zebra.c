@@ -46,6 +46,7 @@ extern struct thread_master *master;
 extern struct zebra_privs_t sharp_privs;
 
 DEFINE_MTYPE_STATIC(SHARPD, ZC, "Test zclients");
+DEFINE_MTYPE_STATIC(SHARPD, ROUTE_ACK, "Route install latencies");
 
 /* Struct to hold list of test zclients */
 struct sharp_zclient {
@@ -333,6 +334,102 @@ static bool route_delete(struct prefix *p, vrf_id_t vrf_id, uint8_t instance)
 		return false;
 }
 
+static int64_t sharp_now_usec(void)
+{
+	struct timeval tv;
+
+	monotime(&tv);
+	return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* Position of p in the routes generated from orig_prefix, or -1 */
+static int64_t sharp_route_idx(const struct prefix *p)
+{
+	const struct prefix *orig = &sg.r.orig_prefix;
+	uint32_t idx;
+
+	if (p->family != orig->family || p->prefixlen != orig->prefixlen)
+		return -1;
+
+	if (p->family == AF_INET)
+		idx = ntohl(p->u.prefix4.s_addr) - ntohl(orig->u.prefix4.s_addr);
+	else {
+		/* only the last 32 bits are counted up */
+		if (memcmp(&p->u.prefix6, &orig->u.prefix6, 12))
+			return -1;
+		idx = ntohl(p->u.val32[3]) - ntohl(orig->u.val32[3]);
+	}
+
+	if (idx >= sg.r.total_routes || idx >= sg.r.ack_alloc)
+		return -1;
+	return idx;
+}
+
+static void sharp_ack_start(uint32_t routes)
+{
+	if (sg.r.ack_alloc < routes) {
+		sg.r.ack_sent = XREALLOC(MTYPE_ROUTE_ACK, sg.r.ack_sent,
+					 routes * sizeof(sg.r.ack_sent[0]));
+		sg.r.ack_usec = XREALLOC(MTYPE_ROUTE_ACK, sg.r.ack_usec,
+					 routes * sizeof(sg.r.ack_usec[0]));
+		sg.r.ack_alloc = routes;
+	}
+
+	memset(sg.r.ack_sent, 0, routes * sizeof(sg.r.ack_sent[0]));
+	sg.r.ack_num = 0;
+}
+
+static void sharp_ack_route(const struct prefix *p)
+{
+	int64_t idx = sharp_route_idx(p);
+	int64_t usec;
+
+	/* not ours, or installed again after a change */
+	if (idx < 0 || !sg.r.ack_sent[idx])
+		return;
+
+	usec = sharp_now_usec() - sg.r.ack_sent[idx];
+	sg.r.ack_sent[idx] = 0;
+	sg.r.ack_usec[sg.r.ack_num++] = MIN(MAX(usec, 0), UINT32_MAX);
+}
+
+static int sharp_ack_cmp(const void *a, const void *b)
+{
+	const uint32_t *usec_a = a, *usec_b = b;
+
+	return numcmp(*usec_a, *usec_b);
+}
+
+static uint32_t sharp_ack_pct(unsigned int permille)
+{
+	uint64_t n = ((uint64_t)sg.r.ack_num * permille + 999) / 1000;
+
+	return sg.r.ack_usec[n ? n - 1 : 0];
+}
+
+static void sharp_ack_done(const struct timeval *r)
+{
+	struct sharp_install_stats *st = &sg.r.stats;
+
+	memset(st, 0, sizeof(*st));
+	st->routes = sg.r.total_routes;
+	st->nhgid = sg.r.nhgid;
+	st->usec = (uint64_t)r->tv_sec * 1000000 + r->tv_usec;
+
+	if (!sg.r.ack_num)
+		return;
+
+	qsort(sg.r.ack_usec, sg.r.ack_num, sizeof(sg.r.ack_usec[0]),
+	      sharp_ack_cmp);
+	st->p50 = sharp_ack_pct(500);
+	st->p99 = sharp_ack_pct(990);
+	st->p999 = sharp_ack_pct(999);
+	st->max = sg.r.ack_usec[sg.r.ack_num - 1];
+
+	zlog_debug("Install latency usec p50 %u p99 %u p99.9 %u max %u",
+		   st->p50, st->p99, st->p999, st->max);
+}
+
 static void sharp_install_routes_restart(struct prefix *p, uint32_t count,
 					 vrf_id_t vrf_id, uint8_t instance,
 					 uint32_t nhgid,
@@ -351,8 +448,13 @@ static void sharp_install_routes_restart(struct prefix *p, uint32_t count,
 		temp = ntohl(p->u.val32[3]);
 
 	for (i = count; i < routes; i++) {
-		bool buffered = route_add(p, vrf_id, (uint8_t)instance, nhgid,
-					  nhg, backup_nhg, flags, opaque);
+		bool buffered;
+
+		if (i < sg.r.ack_alloc)
+			sg.r.ack_sent[i] = sharp_now_usec();
+
+		buffered = route_add(p, vrf_id, (uint8_t)instance, nhgid, nhg,
+				     backup_nhg, flags, opaque);
 		if (v4)
 			p->u.prefix4.s_addr = htonl(++temp);
 		else
@@ -388,6 +490,7 @@ void sharp_install_routes_helper(struct prefix *p, vrf_id_t vrf_id,
 	if (backup_nhg && (backup_nhg->nexthop == NULL))
 		backup_nhg = NULL;
 
+	sharp_ack_start(routes);
 	monotime(&sg.r.t_start);
 	sharp_install_routes_restart(p, 0, vrf_id, instance, nhgid, nhg,
 				     backup_nhg, routes, flags, opaque);
@@ -491,11 +594,13 @@ static int route_notify_owner(ZAPI_CALLBACK_ARGS)
 	switch (note) {
 	case ZAPI_ROUTE_INSTALLED:
 		sg.r.installed_routes++;
+		sharp_ack_route(&p);
 		if (sg.r.total_routes == sg.r.installed_routes) {
 			monotime(&sg.r.t_end);
 			timersub(&sg.r.t_end, &sg.r.t_start, &r);
 			zlog_debug("Installed All Items %jd.%ld",
 				   (intmax_t)r.tv_sec, (long)r.tv_usec);
+			sharp_ack_done(&r);
 			handle_repeated(true);
 		}
 		break;
@@ -799,18 +904,20 @@ static int sharp_opaque_handler(ZAPI_CALLBACK_ARGS)
 	zlog_debug("%s: [%u] received opaque type %u", __func__,
 		   zclient->session_id, info.type);
 
-	if (info.type == LINK_STATE_UPDATE) {
+	/* Synchronization packs several elements in one message */
+	while (info.type == LINK_STATE_UPDATE && STREAM_READABLE(s)) {
 		lse = ls_stream2ted(sg.ted, s, false);
 		if (lse) {
 			zlog_debug(" |- Got %s %s from Link State Database",
 				   status2txt[lse->status],
 				   type2txt[lse->type]);
 			lse->status = SYNC;
-		}
-		else
+		} else {
 			zlog_debug(
 				"%s: Error to convert Stream into Link State",
 				__func__);
+			break;
+		}
 	}
 
 	return 0;
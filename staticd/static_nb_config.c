@@ -31,6 +31,7 @@
 #include "static_vrf.h"
 #include "static_routes.h"
 #include "static_nb.h"
+#include "static_zebra.h"
 
 
 static int static_path_list_create(struct nb_cb_create_args *args)
@@ -413,6 +414,7 @@ void routing_control_plane_protocols_control_plane_protocol_staticd_route_list_p
 
 	nh = nb_running_get_entry(args->dnode, NULL, true);
 
+	static_zebra_batch_defer();
 	static_install_nexthop(nh);
 }
 
@@ -423,6 +425,7 @@ void routing_control_plane_protocols_control_plane_protocol_staticd_route_list_s
 
 	nh = nb_running_get_entry(args->dnode, NULL, true);
 
+	static_zebra_batch_defer();
 	static_install_nexthop(nh);
 }
 
@@ -572,6 +572,7 @@ void static_fixup_vrf_ids(struct static_vrf *enable_svrf)
 	afi_t afi;
 	safi_t safi;
 
+	static_zebra_batch_begin();
 	RB_FOREACH (vrf, vrf_name_head, &vrfs_by_name) {
 		struct static_vrf *svrf;
 
@@ -588,6 +589,7 @@ void static_fixup_vrf_ids(struct static_vrf *enable_svrf)
 				static_enable_vrf(svrf, stable, afi, safi);
 		}
 	}
+	static_zebra_batch_commit();
 }
 
 /*
@@ -667,6 +669,7 @@ void static_cleanup_vrf_ids(struct static_vrf *disable_svrf)
 	afi_t afi;
 	safi_t safi;
 
+	static_zebra_batch_begin();
 	RB_FOREACH (vrf, vrf_name_head, &vrfs_by_name) {
 		struct static_vrf *svrf;
 
@@ -686,6 +689,7 @@ void static_cleanup_vrf_ids(struct static_vrf *disable_svrf)
 				static_disable_vrf(stable, afi, safi);
 		}
 	}
+	static_zebra_batch_commit();
 }
 
 /*
@@ -735,6 +739,7 @@ void static_install_intf_nh(struct interface *ifp)
 	afi_t afi;
 	safi_t safi;
 
+	static_zebra_batch_begin();
 	RB_FOREACH(vrf, vrf_name_head, &vrfs_by_name) {
 		struct static_vrf *svrf = vrf->info;
 
@@ -751,6 +756,7 @@ void static_install_intf_nh(struct interface *ifp)
 			static_fixup_intf_nh(stable, ifp, afi, safi);
 		}
 	}
+	static_zebra_batch_commit();
 }
 
 /* called from if_{add,delete}_update, i.e. when ifindex becomes [in]valid */
@@ -89,6 +89,9 @@ static struct static_nht_hash_head static_nht_hash[1];
 
 /* Zebra structure to hold current status. */
 struct zclient *zclient;
+
+/* commits the batch opened by static_zebra_batch_defer() */
+static struct thread *t_batch;
 uint32_t zebra_ecmp_count = MULTIPATH_NUM;
 
 /* Interface addition message from zebra. */
@@ -235,8 +238,6 @@ static int static_zebra_nexthop_update(ZAPI_CALLBACK_ARGS)
 	if (nhtd) {
 		nhtd->nh_num = nhr.nexthop_num;
 
-		static_nht_reset_start(&matched, afi, nhr.safi,
-				       nhtd->nh_vrf_id);
 		static_nht_update(NULL, &matched, nhr.nexthop_num, afi,
 				  nhr.safi, nhtd->nh_vrf_id);
 	} else
@@ -399,6 +400,32 @@ void static_zebra_nht_register(struct static_nexthop *nh, bool reg)
 		nhtd->registered = true;
 }
 
+void static_zebra_batch_begin(void)
+{
+	if (zclient)
+		zclient_route_batch_begin(zclient);
+}
+
+void static_zebra_batch_commit(void)
+{
+	if (zclient)
+		zclient_route_batch_commit(zclient);
+}
+
+static void static_zebra_batch_flush(struct thread *thread)
+{
+	static_zebra_batch_commit();
+}
+
+void static_zebra_batch_defer(void)
+{
+	if (t_batch)
+		return;
+
+	static_zebra_batch_begin();
+	thread_add_event(master, static_zebra_batch_flush, NULL, 0, &t_batch);
+}
+
 extern void static_zebra_route_add(struct static_path *pn, bool install)
 {
 	struct route_node *rn = pn->rn;
@@ -705,6 +732,10 @@ void static_zebra_stop(void)
 
 	if (!zclient)
 		return;
+	if (t_batch) {
+		THREAD_OFF(t_batch);
+		static_zebra_batch_commit();
+	}
 	zclient_stop(zclient);
 	zclient_free(zclient);
 	zclient = NULL;
@@ -30,6 +30,14 @@ extern struct thread_master *master;
 extern void static_zebra_nht_register(struct static_nexthop *nh, bool reg);
 
 extern void static_zebra_route_add(struct static_path *pn, bool install);
+/* Collect the route updates in between into batches */
+extern void static_zebra_batch_begin(void);
+extern void static_zebra_batch_commit(void);
+/*
+ * Batches the route updates until the current event is done, so that
+ * e.g. all routes of a configuration commit go out together.
+ */
+extern void static_zebra_batch_defer(void);
 extern void static_zebra_init(void);
 /* static_zebra_stop used by tests/lib/test_grpc.cpp */
 extern void static_zebra_stop(void);
@@ -0,0 +1,216 @@
+/*
+ * Micro-benchmark harness
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <math.h>
+
+#include "bench.h"
+
+volatile uintptr_t bench_sink;
+
+struct bench {
+	uint64_t ns_start, ns;
+	uint64_t tsc_start, tsc;
+	bool running;
+};
+
+struct bench_stat {
+	double min, median, mean, stddev;
+};
+
+static uint64_t bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_HAVE_TSC 1
+static uint64_t bench_tsc(void)
+{
+	return __builtin_ia32_rdtsc();
+}
+#else
+#define BENCH_HAVE_TSC 0
+static uint64_t bench_tsc(void)
+{
+	return 0;
+}
+#endif
+
+void bench_start(struct bench *b)
+{
+	assert(!b->running);
+	b->running = true;
+	b->ns_start = bench_ns();
+	b->tsc_start = bench_tsc();
+}
+
+void bench_stop(struct bench *b)
+{
+	uint64_t tsc = bench_tsc(), ns = bench_ns();
+
+	assert(b->running);
+	b->running = false;
+	b->ns += ns - b->ns_start;
+	b->tsc += tsc - b->tsc_start;
+}
+
+static int bench_dbl_cmp(const void *a, const void *b)
+{
+	const double *da = a, *db = b;
+
+	if (*da == *db)
+		return 0;
+	return *da < *db ? -1 : 1;
+}
+
+static void bench_stat(struct bench_stat *st, double *val, unsigned int num)
+{
+	double sum = 0, sq = 0;
+	unsigned int i;
+
+	qsort(val, num, sizeof(val[0]), bench_dbl_cmp);
+	for (i = 0; i < num; i++)
+		sum += val[i];
+	st->mean = sum / num;
+	for (i = 0; i < num; i++)
+		sq += (val[i] - st->mean) * (val[i] - st->mean);
+
+	st->min = val[0];
+	st->median = num % 2 ? val[num / 2]
+			     : (val[num / 2 - 1] + val[num / 2]) / 2;
+	st->stddev = num > 1 ? sqrt(sq / (num - 1)) : 0;
+}
+
+static bool bench_selected(const char *name, int argc, char **argv)
+{
+	int i;
+
+	if (!argc)
+		return true;
+	for (i = 0; i < argc; i++)
+		if (!strncmp(name, argv[i], strlen(argv[i])))
+			return true;
+	return false;
+}
+
+static void bench_usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-r ROUNDS] [-w ROUNDS] [-s SCALE] [-j] [NAME...]\n",
+		prog);
+	exit(1);
+}
+
+int bench_main(int argc, char **argv, const struct bench_def *defs,
+	       size_t ndefs)
+{
+	unsigned int rounds = 10, warmup = 2, scale = 1, r;
+	struct bench_stat st_ns, st_tsc;
+	double *ns, *tsc;
+	bool json = false, first = true;
+	struct bench b;
+	size_t i, n;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:w:s:j")) != -1) {
+		switch (opt) {
+		case 'r':
+			rounds = strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			warmup = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			scale = strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			json = true;
+			break;
+		default:
+			bench_usage(argv[0]);
+		}
+	}
+	if (!rounds || !scale)
+		bench_usage(argv[0]);
+
+	ns = calloc(rounds, sizeof(ns[0]));
+	tsc = calloc(rounds, sizeof(tsc[0]));
+
+	if (json)
+		printf("{\"benchmarks\":[");
+	else
+		printf("%-28s %10s %10s %10s %10s %10s %10s\n", "benchmark",
+		       "ops", "min ns", "median ns", "mean ns", "stddev",
+		       BENCH_HAVE_TSC ? "med cycles" : "");
+
+	for (i = 0; i < ndefs; i++) {
+		if (!bench_selected(defs[i].name, argc - optind,
+				    argv + optind))
+			continue;
+
+		n = defs[i].n * scale;
+		for (r = 0; r < warmup + rounds; r++) {
+			memset(&b, 0, sizeof(b));
+			defs[i].fn(&b, n);
+			assert(!b.running);
+
+			if (r < warmup)
+				continue;
+			ns[r - warmup] = (double)b.ns / n;
+			tsc[r - warmup] = (double)b.tsc / n;
+		}
+
+		bench_stat(&st_ns, ns, rounds);
+		bench_stat(&st_tsc, tsc, rounds);
+
+		if (json) {
+			printf("%s\n{\"name\":\"%s\",\"ops\":%zu,\"rounds\":%u,"
+			       "\"minNs\":%.3f,\"medianNs\":%.3f,"
+			       "\"meanNs\":%.3f,\"stddevNs\":%.3f",
+			       first ? "" : ",", defs[i].name, n, rounds,
+			       st_ns.min, st_ns.median, st_ns.mean,
+			       st_ns.stddev);
+			if (BENCH_HAVE_TSC)
+				printf(",\"medianCycles\":%.1f", st_tsc.median);
+			printf("}");
+		} else {
+			printf("%-28s %10zu %10.2f %10.2f %10.2f %10.2f",
+			       defs[i].name, n, st_ns.min, st_ns.median,
+			       st_ns.mean, st_ns.stddev);
+			if (BENCH_HAVE_TSC)
+				printf(" %10.1f", st_tsc.median);
+			printf("\n");
+		}
+		first = false;
+		fflush(stdout);
+	}
+
+	if (json)
+		printf("\n]}\n");
+
+	free(ns);
+	free(tsc);
+	return 0;
+}
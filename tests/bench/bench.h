@@ -0,0 +1,60 @@
+/*
+ * Micro-benchmark harness
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BENCH_H
+#define _FRR_BENCH_H
+
+/*
+ * A benchmark is a function doing n operations of some kind.  It can do
+ * any setup first, then brackets the part to be measured with
+ * bench_start() and bench_stop().  The harness calls it a few times to
+ * warm up, then for a number of rounds, and prints per-operation times
+ * (and TSC cycles where there is a TSC) as min / median / mean / stddev
+ * over the rounds.
+ *
+ * The programs take:
+ *   -r ROUNDS   rounds measured (default 10)
+ *   -w ROUNDS   warmup rounds (default 2)
+ *   -s SCALE    multiplies each benchmark's n (default 1)
+ *   -j          JSON output
+ *   NAME...     only run benchmarks whose name starts with one of these
+ */
+
+struct bench;
+
+typedef void (*bench_fn)(struct bench *b, size_t n);
+
+struct bench_def {
+	const char *name;
+	bench_fn fn;
+	/* operations per round */
+	size_t n;
+};
+
+extern void bench_start(struct bench *b);
+extern void bench_stop(struct bench *b);
+
+/* keeps the compiler from optimizing away a result */
+extern volatile uintptr_t bench_sink;
+
+extern int bench_main(int argc, char **argv, const struct bench_def *defs,
+		      size_t ndefs);
+
+#endif /* _FRR_BENCH_H */
@@ -0,0 +1,521 @@
+/*
+ * BGP ingest and best path benchmark, replaying MRT files
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "qobj.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "workqueue.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_dump.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_table.h"
+
+/*
+ * Reads the UPDATEs out of an MRT file, then for each number of peers
+ * asked for, sets up a bgpd instance in a child process with that many
+ * established iBGP peers.  Every peer gets all the UPDATEs, in that
+ * order, through the same bgp_process_packet() path that received
+ * packets take; then the best path work queue is run until it's empty.
+ *
+ * MRT input can be:
+ *  - BGP4MP(_ET) MESSAGE / MESSAGE_AS4, as written by "dump bgp updates":
+ *    the UPDATEs are replayed as they are
+ *  - TABLE_DUMP_V2 IPv4/IPv6 unicast RIBs, as written by
+ *    "dump bgp routes-mrt": the first entry of each prefix is turned into
+ *    an UPDATE for that prefix
+ *
+ * Without zebra all nexthops count as reachable, and nothing is sent to
+ * zebra or to the peers, so this is about what bgpd does with incoming
+ * routes.
+ *
+ * usage: bench_bgp [-p PEERS[,PEERS...]] [-c|-j] FILE.mrt
+ */
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+static as_t asn = 65000;
+
+#define MRT_HEADER_SIZE 12
+#define MRT_TABLE_DUMP_V2 13
+
+struct msg {
+	uint8_t *data;
+	size_t len;
+};
+
+static struct msg *msgs;
+static size_t nmsgs, allocmsgs;
+/* AS_PATHs are 4-byte ASNs */
+static bool as4 = true;
+static unsigned long skipped;
+
+struct result {
+	unsigned int peers;
+	uint64_t updates;
+	uint64_t ingest_usec;
+	uint64_t bestpath_usec;
+	unsigned long prefixes[AFI_MAX];
+};
+
+static uint64_t now_usec(void)
+{
+	struct timeval tv;
+
+	monotime(&tv);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void msg_add(const uint8_t *data, size_t len)
+{
+	if (nmsgs == allocmsgs) {
+		allocmsgs = allocmsgs ? allocmsgs * 2 : 1024;
+		msgs = realloc(msgs, allocmsgs * sizeof(msgs[0]));
+	}
+	msgs[nmsgs].data = malloc(len);
+	memcpy(msgs[nmsgs].data, data, len);
+	msgs[nmsgs].len = len;
+	nmsgs++;
+}
+
+/* BGP4MP MESSAGE: peer/local AS, ifindex, AFI, peer/local IP, message */
+static void mrt_bgp4mp(const uint8_t *p, size_t len, uint16_t subtype)
+{
+	size_t aslen, iplen, off;
+	uint16_t afi, msglen;
+
+	switch (subtype) {
+	case BGP4MP_MESSAGE:
+		aslen = 2;
+		as4 = false;
+		break;
+	case BGP4MP_MESSAGE_AS4:
+		aslen = 4;
+		break;
+	default:
+		return;
+	}
+
+	off = 2 * aslen + 2;
+	if (len < off + 2)
+		goto bad;
+	afi = (p[off] << 8) | p[off + 1];
+	iplen = afi == IANA_AFI_IPV6 ? IPV6_MAX_BYTELEN : IPV4_MAX_BYTELEN;
+	off += 2 + 2 * iplen;
+
+	if (len < off + BGP_HEADER_SIZE)
+		goto bad;
+	msglen = (p[off + BGP_MARKER_SIZE] << 8) | p[off + BGP_MARKER_SIZE + 1];
+	if (msglen < BGP_HEADER_SIZE || off + msglen > len)
+		goto bad;
+
+	if (p[off + BGP_MARKER_SIZE + 2] == BGP_MSG_UPDATE)
+		msg_add(p + off, msglen);
+	return;
+bad:
+	skipped++;
+}
+
+/*
+ * An UPDATE for one prefix from a TABLE_DUMP_V2 RIB entry.  The entry's
+ * MP_REACH_NLRI only has the nexthop (RFC 6396 4.3.4), so for IPv6 that
+ * is rebuilt with AFI, SAFI and the prefix.
+ */
+static void mrt_rib_entry(afi_t afi, uint8_t plen, const uint8_t *pfx,
+			  const uint8_t *attr, size_t attrlen)
+{
+	struct stream *s = stream_new(BGP_MAX_PACKET_SIZE);
+	size_t attrstart, off = 0, alen, hlen;
+	uint8_t flags, type;
+	bool mp = false;
+
+	stream_put(s, NULL, BGP_MARKER_SIZE);
+	memset(STREAM_DATA(s), 0xff, BGP_MARKER_SIZE);
+	stream_putw(s, 0);
+	stream_putc(s, BGP_MSG_UPDATE);
+	stream_putw(s, 0);
+	attrstart = stream_get_endp(s);
+	stream_putw(s, 0);
+
+	while (off + 3 <= attrlen) {
+		flags = attr[off];
+		type = attr[off + 1];
+		if (flags & BGP_ATTR_FLAG_EXTLEN) {
+			if (off + 4 > attrlen)
+				goto bad;
+			alen = (attr[off + 2] << 8) | attr[off + 3];
+			hlen = 4;
+		} else {
+			alen = attr[off + 2];
+			hlen = 3;
+		}
+		if (off + hlen + alen > attrlen)
+			goto bad;
+
+		if (type != BGP_ATTR_MP_REACH_NLRI) {
+			stream_put(s, attr + off, hlen + alen);
+		} else if (afi == AFI_IP6 && alen >= 1
+			   && attr[off + hlen] + 1u <= alen) {
+			uint8_t nhlen = attr[off + hlen];
+
+			stream_putc(s, BGP_ATTR_FLAG_OPTIONAL
+					       | BGP_ATTR_FLAG_EXTLEN);
+			stream_putc(s, BGP_ATTR_MP_REACH_NLRI);
+			stream_putw(s, 2 + 1 + 1 + nhlen + 1 + 1 + PSIZE(plen));
+			stream_putw(s, IANA_AFI_IPV6);
+			stream_putc(s, IANA_SAFI_UNICAST);
+			stream_put(s, attr + off + hlen, 1 + nhlen);
+			stream_putc(s, 0);
+			stream_putc(s, plen);
+			stream_put(s, pfx, PSIZE(plen));
+			mp = true;
+		}
+		off += hlen + alen;
+	}
+
+	if (afi == AFI_IP6 && !mp)
+		goto bad;
+
+	stream_putw_at(s, attrstart, stream_get_endp(s) - attrstart - 2);
+	if (afi == AFI_IP) {
+		stream_putc(s, plen);
+		stream_put(s, pfx, PSIZE(plen));
+	}
+	stream_putw_at(s, BGP_MARKER_SIZE, stream_get_endp(s));
+
+	msg_add(STREAM_DATA(s), stream_get_endp(s));
+	stream_free(s);
+	return;
+bad:
+	skipped++;
+	stream_free(s);
+}
+
+/* sequence, prefix, entry count, then entries: peer, time, attributes */
+static void mrt_rib(const uint8_t *p, size_t len, uint16_t subtype)
+{
+	afi_t afi;
+	uint8_t plen;
+	size_t off, psize, attrlen;
+
+	switch (subtype) {
+	case TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+		afi = AFI_IP;
+		break;
+	case TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+		afi = AFI_IP6;
+		break;
+	default:
+		return;
+	}
+
+	if (len < 5)
+		goto bad;
+	plen = p[4];
+	if (plen > (afi == AFI_IP ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN))
+		goto bad;
+	psize = PSIZE(plen);
+	off = 5 + psize;
+	if (len < off + 2 + 8)
+		goto bad;
+
+	/* first entry only */
+	off += 2 + 2 + 4;
+	attrlen = (p[off] << 8) | p[off + 1];
+	off += 2;
+	if (off + attrlen > len)
+		goto bad;
+
+	mrt_rib_entry(afi, plen, p + 5, p + off, attrlen);
+	return;
+bad:
+	skipped++;
+}
+
+static int mrt_read(const char *path)
+{
+	uint8_t hdr[MRT_HEADER_SIZE], *buf = NULL;
+	size_t bufsize = 0, skip;
+	uint16_t type, subtype;
+	uint32_t len;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	while (fread(hdr, sizeof(hdr), 1, f) == 1) {
+		type = (hdr[4] << 8) | hdr[5];
+		subtype = (hdr[6] << 8) | hdr[7];
+		len = ((uint32_t)hdr[8] << 24) | (hdr[9] << 16) | (hdr[10] << 8)
+		      | hdr[11];
+
+		if (len > bufsize) {
+			bufsize = len;
+			buf = realloc(buf, bufsize);
+		}
+		if (len && fread(buf, len, 1, f) != 1) {
+			fprintf(stderr, "%s: truncated record\n", path);
+			break;
+		}
+
+		switch (type) {
+		case MSG_PROTOCOL_BGP4MP_ET:
+			/* microseconds timestamp */
+			skip = 4;
+			if (len < skip)
+				break;
+			mrt_bgp4mp(buf + skip, len - skip, subtype);
+			break;
+		case MSG_PROTOCOL_BGP4MP:
+			mrt_bgp4mp(buf, len, subtype);
+			break;
+		case MRT_TABLE_DUMP_V2:
+			mrt_rib(buf, len, subtype);
+			break;
+		}
+	}
+
+	free(buf);
+	fclose(f);
+	return 0;
+}
+
+static struct peer *bench_peer(struct bgp *bgp, unsigned int i)
+{
+	struct peer *peer;
+	char host[32];
+
+	peer = peer_create_accept(bgp);
+	snprintf(host, sizeof(host), "10.%u.%u.%u", (i >> 16) & 0xff,
+		 (i >> 8) & 0xff, i & 0xff);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, host);
+	peer->su.sin.sin_family = AF_INET;
+	inet_pton(AF_INET, host, &peer->su.sin.sin_addr);
+	peer->remote_id = peer->su.sin.sin_addr;
+	peer->as = peer->local_as = asn;
+	peer->sort = BGP_PEER_IBGP;
+	peer->status = Established;
+
+	if (as4) {
+		SET_FLAG(peer->cap, PEER_CAP_AS4_RCV);
+		SET_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+	}
+	peer->afc[AFI_IP][SAFI_UNICAST] = peer->afc_nego[AFI_IP][SAFI_UNICAST] =
+		1;
+	peer->afc[AFI_IP6][SAFI_UNICAST] =
+		peer->afc_nego[AFI_IP6][SAFI_UNICAST] = 1;
+	return peer;
+}
+
+static void bench_run(unsigned int npeers, struct result *res)
+{
+	struct bgp *bgp = NULL;
+	struct peer **peers;
+	struct thread t = {};
+	struct stream *s;
+	uint64_t start;
+	unsigned int i;
+	size_t m;
+
+	qobj_init();
+	master = thread_master_create("bench bgp");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT) < 0) {
+		fprintf(stderr, "bgp_get failed\n");
+		exit(1);
+	}
+
+	peers = calloc(npeers, sizeof(peers[0]));
+	for (i = 0; i < npeers; i++)
+		peers[i] = bench_peer(bgp, i);
+
+	memset(res, 0, sizeof(*res));
+	res->peers = npeers;
+
+	start = now_usec();
+	for (i = 0; i < npeers; i++) {
+		t.arg = peers[i];
+		for (m = 0; m < nmsgs; m++) {
+			s = stream_new(msgs[m].len);
+			stream_put(s, msgs[m].data, msgs[m].len);
+			frr_with_mutex (&peers[i]->io_mtx) {
+				stream_fifo_push(peers[i]->ibuf, s);
+			}
+			/* one at a time, the FIFO is not meant to hold a RIB */
+			bgp_process_packet(&t);
+			res->updates++;
+		}
+	}
+	res->ingest_usec = now_usec() - start;
+
+	start = now_usec();
+	t.arg = bgp->process_queue;
+	while (!work_queue_empty(bgp->process_queue))
+		work_queue_run(&t);
+	res->bestpath_usec = now_usec() - start;
+
+	res->prefixes[AFI_IP] = bgp_table_count(bgp->rib[AFI_IP][SAFI_UNICAST]);
+	res->prefixes[AFI_IP6] =
+		bgp_table_count(bgp->rib[AFI_IP6][SAFI_UNICAST]);
+}
+
+static void result_print(const struct result *res, bool csv, bool json,
+			 bool first)
+{
+	uint64_t total = res->ingest_usec + res->bestpath_usec;
+	uint64_t rate = res->ingest_usec
+				? res->updates * 1000000 / res->ingest_usec
+				: 0;
+
+	if (csv) {
+		if (first)
+			printf("peers,updates,ingest_usec,updates_per_sec,"
+			       "bestpath_usec,convergence_usec,prefixes_ipv4,"
+			       "prefixes_ipv6\n");
+		printf("%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+		       ",%" PRIu64 ",%lu,%lu\n",
+		       res->peers, res->updates, res->ingest_usec, rate,
+		       res->bestpath_usec, total, res->prefixes[AFI_IP],
+		       res->prefixes[AFI_IP6]);
+	} else if (json) {
+		printf("%s\n{\"peers\":%u,\"updates\":%" PRIu64
+		       ",\"ingestUsec\":%" PRIu64 ",\"updatesPerSec\":%" PRIu64
+		       ",\"bestpathUsec\":%" PRIu64
+		       ",\"convergenceUsec\":%" PRIu64
+		       ",\"prefixesIpv4\":%lu,\"prefixesIpv6\":%lu}",
+		       first ? "" : ",", res->peers, res->updates,
+		       res->ingest_usec, rate, res->bestpath_usec, total,
+		       res->prefixes[AFI_IP], res->prefixes[AFI_IP6]);
+	} else {
+		printf("%u peers: %" PRIu64 " updates in %" PRIu64
+		       " usec (%" PRIu64 "/s), best path %" PRIu64
+		       " usec, converged after %" PRIu64
+		       " usec; %lu IPv4 / %lu IPv6 prefixes\n",
+		       res->peers, res->updates, res->ingest_usec, rate,
+		       res->bestpath_usec, total, res->prefixes[AFI_IP],
+		       res->prefixes[AFI_IP6]);
+	}
+	fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-p PEERS[,PEERS...]] [-c|-j] FILE.mrt\n",
+		prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *peerlist = "1";
+	bool csv = false, json = false, first = true;
+	struct result *res;
+	char *list, *tok, *save;
+	unsigned long npeers;
+	int opt, status;
+	pid_t pid;
+
+	while ((opt = getopt(argc, argv, "p:cj")) != -1) {
+		switch (opt) {
+		case 'p':
+			peerlist = optarg;
+			break;
+		case 'c':
+			csv = true;
+			break;
+		case 'j':
+			json = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || (csv && json))
+		usage(argv[0]);
+
+	if (mrt_read(argv[optind]) < 0)
+		return 1;
+	if (!nmsgs) {
+		fprintf(stderr, "%s: no UPDATEs found\n", argv[optind]);
+		return 1;
+	}
+	if (!csv && !json)
+		printf("%zu UPDATEs, %lu MRT records skipped\n", nmsgs,
+		       skipped);
+
+	/* shared with the children, who each start with a clean bgpd */
+	res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	if (json)
+		printf("{\"results\":[");
+
+	list = strdup(peerlist);
+	for (tok = strtok_r(list, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		npeers = strtoul(tok, NULL, 10);
+		if (!npeers || npeers > 0xffffff)
+			usage(argv[0]);
+
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0) {
+			bench_run(npeers, res);
+			_exit(0);
+		}
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)
+		    || WEXITSTATUS(status)) {
+			fprintf(stderr, "run with %lu peers failed\n", npeers);
+			return 1;
+		}
+
+		result_print(res, csv, json, first);
+		first = false;
+	}
+	free(list);
+
+	if (json)
+		printf("\n]}\n");
+	return 0;
+}
@@ -0,0 +1,707 @@
+/*
+ * Micro-benchmarks for lib data structures
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "checksum.h"
+#include "command.h"
+#include "command_graph.h"
+#include "command_match.h"
+#include "fhash.h"
+#include "hash.h"
+#include "id_alloc.h"
+#include "jhash.h"
+#include "memory.h"
+#include "prefix.h"
+#include "printfrr.h"
+#include "srcdest_table.h"
+#include "stream.h"
+#include "table.h"
+#include "typesafe.h"
+#include "prng.h"
+
+#include "bench.h"
+
+/* random keys and IPv4 prefixes, the same for every round */
+static uint32_t *keys;
+static struct prefix *pfx;
+static size_t nkeys;
+
+static void bench_keys(size_t n)
+{
+	struct prng *prng;
+	size_t i;
+
+	if (n <= nkeys)
+		return;
+
+	keys = realloc(keys, n * sizeof(keys[0]));
+	pfx = realloc(pfx, n * sizeof(pfx[0]));
+
+	prng = prng_new(0);
+	for (i = 0; i < n; i++) {
+		keys[i] = prng_rand(prng);
+
+		memset(&pfx[i], 0, sizeof(pfx[i]));
+		pfx[i].family = AF_INET;
+		pfx[i].prefixlen = 8 + prng_rand(prng) % 25;
+		pfx[i].u.prefix4.s_addr = prng_rand(prng);
+		apply_mask(&pfx[i]);
+	}
+	prng_free(prng);
+	nkeys = n;
+}
+
+/* lib/hash.c */
+
+struct hitem {
+	uint32_t key;
+};
+
+static unsigned int hitem_key(const void *arg)
+{
+	const struct hitem *h = arg;
+
+	return h->key;
+}
+
+static bool hitem_eq(const void *a, const void *b)
+{
+	const struct hitem *ha = a, *hb = b;
+
+	return ha->key == hb->key;
+}
+
+static void *hitem_alloc(void *arg)
+{
+	return arg;
+}
+
+static void bench_hash(struct bench *b, size_t n, int phase)
+{
+	struct hitem *items = calloc(n, sizeof(*items));
+	struct hash *hash;
+	size_t i;
+
+	bench_keys(n);
+	hash = hash_create(hitem_key, hitem_eq, "bench");
+	for (i = 0; i < n; i++)
+		items[i].key = keys[i];
+
+	if (phase == 0)
+		bench_start(b);
+	for (i = 0; i < n; i++)
+		hash_get(hash, &items[i], hitem_alloc);
+	if (phase == 0)
+		bench_stop(b);
+
+	if (phase == 1) {
+		bench_start(b);
+		for (i = 0; i < n; i++)
+			bench_sink += (uintptr_t)hash_lookup(hash, &items[i]);
+		bench_stop(b);
+	}
+
+	if (phase == 2)
+		bench_start(b);
+	for (i = 0; i < n; i++)
+		hash_release(hash, &items[i]);
+	if (phase == 2)
+		bench_stop(b);
+
+	hash_free(hash);
+	free(items);
+}
+
+static void bench_hash_insert(struct bench *b, size_t n)
+{
+	bench_hash(b, n, 0);
+}
+
+static void bench_hash_lookup(struct bench *b, size_t n)
+{
+	bench_hash(b, n, 1);
+}
+
+static void bench_hash_release(struct bench *b, size_t n)
+{
+	bench_hash(b, n, 2);
+}
+
+/* lib/table.c, lib/srcdest_table.c */
+
+static void bench_table(struct bench *b, size_t n, bool match)
+{
+	struct route_table *table = route_table_init();
+	struct route_node *rn;
+	struct prefix host;
+	size_t i;
+
+	bench_keys(n);
+
+	if (!match)
+		bench_start(b);
+	for (i = 0; i < n; i++) {
+		rn = route_node_get(table, &pfx[i]);
+		/* nodes without info are removed when unlocked */
+		rn->info = rn;
+		route_unlock_node(rn);
+	}
+	if (!match)
+		bench_stop(b);
+
+	if (match) {
+		memset(&host, 0, sizeof(host));
+		host.family = AF_INET;
+		host.prefixlen = IPV4_MAX_BITLEN;
+
+		bench_start(b);
+		for (i = 0; i < n; i++) {
+			host.u.prefix4.s_addr = keys[i];
+			rn = route_node_match(table, &host);
+			if (rn) {
+				bench_sink += (uintptr_t)rn->info;
+				route_unlock_node(rn);
+			}
+		}
+		bench_stop(b);
+	}
+
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		rn->info = NULL;
+	route_table_finish(table);
+}
+
+static void bench_table_get(struct bench *b, size_t n)
+{
+	bench_table(b, n, false);
+}
+
+static void bench_table_match(struct bench *b, size_t n)
+{
+	bench_table(b, n, true);
+}
+
+static void bench_table_walk(struct bench *b, size_t n)
+{
+	struct route_table *table = route_table_init();
+	struct route_node *rn;
+	size_t i;
+
+	bench_keys(n);
+	for (i = 0; i < n; i++) {
+		rn = route_node_get(table, &pfx[i]);
+		rn->info = rn;
+		route_unlock_node(rn);
+	}
+
+	bench_start(b);
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		bench_sink += (uintptr_t)rn->info;
+	bench_stop(b);
+
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		rn->info = NULL;
+	route_table_finish(table);
+}
+
+static void bench_srcdest_get(struct bench *b, size_t n)
+{
+	struct route_table *table = srcdest_table_init();
+	struct prefix_ipv6 src, dst;
+	struct route_node *rn;
+	size_t i;
+
+	bench_keys(n);
+	memset(&src, 0, sizeof(src));
+	memset(&dst, 0, sizeof(dst));
+	src.family = dst.family = AF_INET6;
+	src.prefixlen = 64;
+	dst.prefixlen = 48;
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		dst.prefix.s6_addr32[0] = htonl(0x20010000 | (keys[i] >> 16));
+		dst.prefix.s6_addr32[1] = htonl(keys[i] & 0xffff0000);
+		src.prefix.s6_addr32[1] = htonl(keys[i] & 0x7);
+		rn = srcdest_rnode_get(table, (struct prefix *)&dst, &src);
+		rn->info = rn;
+		route_unlock_node(rn);
+	}
+	bench_stop(b);
+
+	for (rn = route_top(table); rn; rn = srcdest_route_next(rn))
+		rn->info = NULL;
+	route_table_finish(table);
+}
+
+/* typesafe.h containers */
+
+PREDECL_RBTREE_UNIQ(ts_rb);
+PREDECL_SKIPLIST_UNIQ(ts_skip);
+PREDECL_HEAP(ts_heap);
+PREDECL_HASH(ts_hash);
+PREDECL_FLATHASH(ts_flat);
+
+struct titem {
+	struct ts_rb_item rb;
+	struct ts_skip_item skip;
+	struct ts_heap_item heap;
+	struct ts_hash_item hash;
+	struct ts_flat_item flat;
+	uint32_t key;
+	uint32_t idx;
+};
+
+static int titem_cmp(const struct titem *a, const struct titem *b)
+{
+	if (a->key != b->key)
+		return numcmp(a->key, b->key);
+	return numcmp(a->idx, b->idx);
+}
+
+static uint32_t titem_hash(const struct titem *t)
+{
+	return jhash_2words(t->key, t->idx, 0);
+}
+
+DECLARE_RBTREE_UNIQ(ts_rb, struct titem, rb, titem_cmp);
+DECLARE_SKIPLIST_UNIQ(ts_skip, struct titem, skip, titem_cmp);
+DECLARE_HEAP(ts_heap, struct titem, heap, titem_cmp);
+DECLARE_HASH(ts_hash, struct titem, hash, titem_cmp, titem_hash);
+DECLARE_FLATHASH(ts_flat, struct titem, flat, titem_cmp, titem_hash);
+
+static struct titem *titems(size_t n)
+{
+	struct titem *items = calloc(n, sizeof(*items));
+	size_t i;
+
+	bench_keys(n);
+	for (i = 0; i < n; i++) {
+		items[i].key = keys[i];
+		items[i].idx = i;
+	}
+	return items;
+}
+
+/* add all, find all (if the type can), pop all */
+#define BENCH_TYPESAFE(prefix, find)                                           \
+static void bench_##prefix(struct bench *b, size_t n)                          \
+{                                                                              \
+	struct titem *items = titems(n);                                       \
+	struct prefix##_head head;                                             \
+	size_t i;                                                              \
+                                                                               \
+	prefix##_init(&head);                                                  \
+	bench_start(b);                                                        \
+	for (i = 0; i < n; i++)                                                \
+		prefix##_add(&head, &items[i]);                                \
+	if (find)                                                              \
+		for (i = 0; i < n; i++)                                        \
+			bench_sink += (uintptr_t)prefix##_member(&head,        \
+								 &items[i]);   \
+	while (prefix##_pop(&head))                                            \
+		;                                                              \
+	bench_stop(b);                                                         \
+	prefix##_fini(&head);                                                  \
+	free(items);                                                           \
+}                                                                              \
+/* end */
+
+BENCH_TYPESAFE(ts_rb, true)
+BENCH_TYPESAFE(ts_skip, true)
+BENCH_TYPESAFE(ts_heap, false)
+BENCH_TYPESAFE(ts_hash, true)
+BENCH_TYPESAFE(ts_flat, true)
+
+/* lib/stream.c */
+
+static void bench_stream(struct bench *b, size_t n)
+{
+	struct stream *s = stream_new(n * (4 + 1 + IPV4_MAX_BYTELEN));
+	struct prefix p;
+	size_t i;
+
+	bench_keys(n);
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		stream_putl(s, keys[i]);
+		stream_put_prefix(s, &pfx[i]);
+	}
+	for (i = 0; i < n; i++) {
+		bench_sink += stream_getl(s);
+		p.prefixlen = stream_getc(s);
+		stream_get(&p.u.prefix4, s, PSIZE(p.prefixlen));
+		bench_sink += p.u.prefix4.s_addr;
+	}
+	bench_stop(b);
+
+	stream_free(s);
+}
+
+/* prefix2str, printfrr */
+
+static void bench_prefix2str(struct bench *b, size_t n)
+{
+	char buf[PREFIX_STRLEN];
+	size_t i;
+
+	bench_keys(n);
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		prefix2str(&pfx[i], buf, sizeof(buf));
+		bench_sink += buf[0];
+	}
+	bench_stop(b);
+}
+
+static void bench_prefix2str_v6(struct bench *b, size_t n)
+{
+	char buf[PREFIX_STRLEN];
+	struct prefix_ipv6 p6;
+	size_t i;
+
+	bench_keys(n);
+	memset(&p6, 0, sizeof(p6));
+	p6.family = AF_INET6;
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		p6.prefixlen = 32 + keys[i] % 97;
+		p6.prefix.s6_addr32[0] = htonl(0x20010db8);
+		p6.prefix.s6_addr32[1] = keys[i] & 0xffff00ff;
+		p6.prefix.s6_addr32[3] = keys[i] >> (i & 31);
+		prefix2str(&p6, buf, sizeof(buf));
+		bench_sink += buf[0];
+	}
+	bench_stop(b);
+}
+
+static void bench_printfrr(struct bench *b, size_t n)
+{
+	char buf[128];
+	size_t i;
+
+	bench_keys(n);
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		snprintfrr(buf, sizeof(buf), "%pFX via %pI4 metric %u", &pfx[i],
+			   &pfx[i].u.prefix4, keys[i]);
+		bench_sink += buf[0];
+	}
+	bench_stop(b);
+}
+
+/* lib/jhash.c */
+
+static void bench_jhash(struct bench *b, size_t n, size_t len, bool fast)
+{
+	uint8_t *data;
+	size_t i;
+
+	bench_keys(n);
+	data = calloc(n, len);
+	for (i = 0; i < n; i++)
+		memcpy(data + i * len, &keys[i], sizeof(keys[i]));
+
+	bench_start(b);
+	if (fast)
+		for (i = 0; i < n; i++)
+			bench_sink += fhash(data + i * len, len, 0);
+	else
+		for (i = 0; i < n; i++)
+			bench_sink += jhash(data + i * len, len, 0);
+	bench_stop(b);
+
+	free(data);
+}
+
+static void bench_jhash_16(struct bench *b, size_t n)
+{
+	bench_jhash(b, n, 16, false);
+}
+
+static void bench_jhash_64(struct bench *b, size_t n)
+{
+	bench_jhash(b, n, 64, false);
+}
+
+static void bench_jhash_256(struct bench *b, size_t n)
+{
+	bench_jhash(b, n, 256, false);
+}
+
+static void bench_jhash_3words(struct bench *b, size_t n)
+{
+	size_t i;
+
+	bench_keys(n);
+
+	bench_start(b);
+	for (i = 0; i < n; i++)
+		bench_sink += jhash_3words(keys[i], i, n, 0);
+	bench_stop(b);
+}
+
+/* lib/fhash.c */
+
+static void bench_fhash_16(struct bench *b, size_t n)
+{
+	bench_jhash(b, n, 16, true);
+}
+
+static void bench_fhash_64(struct bench *b, size_t n)
+{
+	bench_jhash(b, n, 64, true);
+}
+
+static void bench_fhash_256(struct bench *b, size_t n)
+{
+	bench_jhash(b, n, 256, true);
+}
+
+static void bench_fhash_fields(struct bench *b, size_t n)
+{
+	size_t i;
+
+	bench_keys(n);
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		uint64_t h = fhash_init(0);
+
+		h = fhash_add(h, keys[i], ((uint64_t)i << 32) | n);
+		bench_sink += fhash_final(h);
+	}
+	bench_stop(b);
+}
+
+/* lib/id_alloc.c, allocate n IDs then free them in random order */
+
+static void bench_idalloc(struct bench *b, size_t n, bool bulk)
+{
+	struct id_alloc *alloc = idalloc_new("bench");
+	uint32_t *ids = calloc(n, sizeof(ids[0]));
+	uint32_t tmp;
+	size_t i, j;
+
+	bench_keys(n);
+
+	bench_start(b);
+	if (bulk)
+		idalloc_allocate_bulk(alloc, ids, n);
+	else
+		for (i = 0; i < n; i++)
+			ids[i] = idalloc_allocate(alloc);
+	bench_stop(b);
+
+	for (i = n - 1; i > 0; i--) {
+		j = keys[i] % (i + 1);
+		tmp = ids[i];
+		ids[i] = ids[j];
+		ids[j] = tmp;
+	}
+
+	bench_start(b);
+	if (bulk)
+		idalloc_free_bulk(alloc, ids, n);
+	else
+		for (i = 0; i < n; i++)
+			idalloc_free(alloc, ids[i]);
+	bench_stop(b);
+
+	free(ids);
+	idalloc_destroy(alloc);
+}
+
+static void bench_idalloc_single(struct bench *b, size_t n)
+{
+	bench_idalloc(b, n, false);
+}
+
+static void bench_idalloc_bulk(struct bench *b, size_t n)
+{
+	bench_idalloc(b, n, true);
+}
+
+/* lib/command_match.c */
+
+static const char *const bench_cmds[] = {
+	"ip prefix-list WORD [seq (1-4294967295)] <deny|permit> <any|A.B.C.D/M>",
+	"ip prefix-list WORD [seq (1-4294967295)] <deny|permit> A.B.C.D/M le (0-32)",
+	"ipv6 prefix-list WORD [seq (1-4294967295)] <deny|permit> <any|X:X::X:X/M>",
+	"bgp community-list <(1-99)|standard WORD> <deny|permit> LINE...",
+	"route-map WORD <deny|permit> (1-65535)",
+	"match ip address prefix-list WORD",
+	"set local-preference (0-4294967295)",
+	"ip route A.B.C.D/M <A.B.C.D|WORD> [(1-255)]",
+	"interface WORD [vrf NAME]",
+	"router bgp [ASNUM] [vrf NAME]",
+	"neighbor <A.B.C.D|X:X::X:X|WORD> remote-as <ASNUM|internal|external>",
+	"show ip route [vrf NAME] [A.B.C.D/M] [json]",
+};
+
+static struct graph *bench_cmd_graph(void)
+{
+	static struct cmd_element els[array_size(bench_cmds)];
+	struct graph *graph = graph_new(), *g;
+	struct cmd_token *token;
+	size_t i;
+
+	token = cmd_token_new(START_TKN, CMD_ATTR_NORMAL, NULL, NULL);
+	graph_new_node(graph, token, (void (*)(void *))&cmd_token_del);
+
+	for (i = 0; i < array_size(bench_cmds); i++) {
+		els[i].string = bench_cmds[i];
+
+		g = graph_new();
+		token = cmd_token_new(START_TKN, CMD_ATTR_NORMAL, NULL, NULL);
+		graph_new_node(g, token, (void (*)(void *))&cmd_token_del);
+		cmd_graph_parse(g, &els[i]);
+		cmd_graph_merge(graph, g, +1);
+		graph_delete_graph(g);
+	}
+	command_match_cache_flush();
+	return graph;
+}
+
+static void bench_cmd_match(struct bench *b, size_t n, bool uniq)
+{
+	struct graph *graph = bench_cmd_graph();
+	const struct cmd_element *el;
+	struct list *argv;
+	vector *vlines;
+	char line[128];
+	size_t i;
+
+	bench_keys(n);
+	vlines = calloc(n, sizeof(vlines[0]));
+	for (i = 0; i < n; i++) {
+		snprintfrr(line, sizeof(line),
+			   "ip prefix-list PL%zu seq %zu permit %pFX",
+			   uniq ? i : 0, i + 1, &pfx[i]);
+		vlines[i] = cmd_make_strvec(line);
+	}
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		el = NULL;
+		if (command_match(graph, vlines[i], &argv, &el) == MATCHER_OK)
+			list_delete(&argv);
+		bench_sink += (uintptr_t)el;
+	}
+	bench_stop(b);
+
+	for (i = 0; i < n; i++)
+		cmd_free_strvec(vlines[i]);
+	free(vlines);
+	command_match_cache_flush();
+	graph_delete_graph(graph);
+}
+
+static void bench_cmd_match_shape(struct bench *b, size_t n)
+{
+	bench_cmd_match(b, n, false);
+}
+
+static void bench_cmd_match_uniq(struct bench *b, size_t n)
+{
+	bench_cmd_match(b, n, true);
+}
+
+/* lib/checksum.c, n packets of an LSA/LSP-ish size */
+
+#define BENCH_CKSUM_LEN 1400
+
+static void bench_checksum(struct bench *b, size_t n, bool fletcher)
+{
+	uint8_t *data;
+	size_t i;
+
+	bench_keys(n);
+	data = calloc(1, BENCH_CKSUM_LEN + 64);
+	for (i = 0; i < BENCH_CKSUM_LEN + 64; i++)
+		data[i] = keys[i % n];
+
+	bench_start(b);
+	for (i = 0; i < n; i++) {
+		uint8_t *pkt = data + (i & 63);
+
+		if (fletcher)
+			bench_sink += fletcher_checksum(pkt, BENCH_CKSUM_LEN,
+							16);
+		else
+			bench_sink += in_cksum(pkt, BENCH_CKSUM_LEN);
+	}
+	bench_stop(b);
+
+	free(data);
+}
+
+static void bench_in_cksum(struct bench *b, size_t n)
+{
+	bench_checksum(b, n, false);
+}
+
+static void bench_fletcher(struct bench *b, size_t n)
+{
+	bench_checksum(b, n, true);
+}
+
+static const struct bench_def benchmarks[] = {
+	{ "hash/insert", bench_hash_insert, 100000 },
+	{ "hash/lookup", bench_hash_lookup, 100000 },
+	{ "hash/release", bench_hash_release, 100000 },
+	{ "table/get", bench_table_get, 100000 },
+	{ "table/match", bench_table_match, 100000 },
+	{ "table/walk", bench_table_walk, 1000000 },
+	{ "srcdest/get", bench_srcdest_get, 100000 },
+	{ "typesafe/rbtree", bench_ts_rb, 100000 },
+	{ "typesafe/skiplist", bench_ts_skip, 100000 },
+	{ "typesafe/heap", bench_ts_heap, 100000 },
+	{ "typesafe/hash", bench_ts_hash, 100000 },
+	{ "typesafe/flathash", bench_ts_flat, 100000 },
+	{ "stream/putget", bench_stream, 100000 },
+	{ "prefix2str", bench_prefix2str, 100000 },
+	{ "prefix2str/v6", bench_prefix2str_v6, 100000 },
+	{ "printfrr/pFX", bench_printfrr, 100000 },
+	{ "jhash/16", bench_jhash_16, 1000000 },
+	{ "jhash/64", bench_jhash_64, 1000000 },
+	{ "jhash/3words", bench_jhash_3words, 1000000 },
+	{ "jhash/256", bench_jhash_256, 1000000 },
+	{ "fhash/16", bench_fhash_16, 1000000 },
+	{ "fhash/64", bench_fhash_64, 1000000 },
+	{ "fhash/256", bench_fhash_256, 1000000 },
+	{ "fhash/fields", bench_fhash_fields, 1000000 },
+	{ "idalloc/single", bench_idalloc_single, 1000000 },
+	{ "idalloc/bulk", bench_idalloc_bulk, 1000000 },
+	{ "cli/match", bench_cmd_match_shape, 100000 },
+	{ "cli/match/uniq", bench_cmd_match_uniq, 100000 },
+	{ "checksum/inet", bench_in_cksum, 100000 },
+	{ "checksum/fletcher", bench_fletcher, 100000 },
+};
+
+int main(int argc, char **argv)
+{
+	return bench_main(argc, argv, benchmarks, array_size(benchmarks));
+}
@@ -31,6 +31,7 @@
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_regex.h"
 
 #define VT100_RESET "\x1b[0m"
 #define VT100_RED "\x1b[31m"
@@ -888,6 +889,27 @@ static struct aspath *make_aspath(const uint8_t *data, size_t len, int use32bit)
 	return as;
 }
 
+/* same as make_aspath, but decode and intern in separate steps */
+static struct aspath *make_aspath_decoded(const uint8_t *data, size_t len,
+					  int use32bit)
+{
+	struct stream *s = NULL;
+	struct aspath *as;
+
+	if (len) {
+		s = stream_new(len);
+		stream_put(s, data, len);
+	}
+	as = aspath_decode(s, len, use32bit);
+	if (as)
+		as = aspath_intern(as);
+
+	if (s)
+		stream_free(s);
+
+	return as;
+}
+
 static void printbytes(const uint8_t *bytes, int len)
 {
 	int i = 0;
@@ -1047,15 +1069,17 @@ static void empty_get_test(void)
 /* basic parsing test */
 static void parse_test(struct test_segment *t)
 {
-	struct aspath *asp;
+	struct aspath *asp, *dec;
 
 	printf("%s: %s\n", t->name, t->desc);
 
 	asp = make_aspath(t->asdata, t->len, 0);
+	dec = make_aspath_decoded(t->asdata, t->len, 0);
 
 	printf("aspath: %s\nvalidating...:\n", aspath_print(asp));
 
-	if (!validate(asp, &t->sp))
+	/* decoding and interning separately must give the same path */
+	if (!validate(asp, &t->sp) && dec == asp)
 		printf(OK "\n");
 	else
 		printf(FAILED "\n");
@@ -1063,6 +1087,8 @@ static void parse_test(struct test_segment *t)
 	printf("\n");
 
 	aspath_unintern(&asp);
+	if (dec)
+		aspath_unintern(&dec);
 }
 
 /* prepend testing */
@@ -1215,6 +1241,59 @@ static void cmp_test(void)
 	}
 }
 
+/* the string fast path has to agree with the regex it replaces */
+static void regex_test(void)
+{
+	static const char *const paths[] = {
+		"", "100", "1000", "100 200", "200 100", "2100 1001",
+		"300 100 400", "{100,200}", "(100 200) 300", "[100 200]",
+		"300 {400,100}", "10 50",
+	};
+	static const char *const regs[] = {
+		"_100_", "^100$", "^100_", "_100$", "100", "^100",
+		"100$", "_10", "0_", "^[0-9]+$", "_100_200_",
+	};
+	struct bgp_regex_fast fast;
+	struct aspath *asp;
+	regex_t *regex;
+	bool ok = true;
+	size_t i, j;
+
+	printf("regex test: ");
+
+	for (j = 0; j < array_size(regs); j++) {
+		regex = bgp_regcomp(regs[j]);
+		assert(regex);
+		if (!bgp_regex_fast_compile(regs[j], &fast))
+			fast.len = 0;
+
+		for (i = 0; i < array_size(paths); i++) {
+			bool exp, got;
+
+			asp = aspath_str2aspath(paths[i]);
+			assert(asp);
+
+			exp = bgp_regexec(regex, asp) != REG_NOMATCH;
+			got = fast.len ? bgp_regex_fast_match(&fast, asp->str)
+				       : exp;
+			if (exp != got) {
+				printf("\"%s\" ~ %s: %d, expected %d\n",
+				       asp->str, regs[j], got, exp);
+				ok = false;
+			}
+			aspath_free(asp);
+		}
+		bgp_regex_free(regex);
+	}
+
+	if (ok)
+		printf(OK "\n");
+	else {
+		failed++;
+		printf(FAILED "\n");
+	}
+}
+
 static int handle_attr_test(struct aspath_tests *t)
 {
 	struct bgp bgp = {0};
@@ -1329,6 +1408,8 @@ int main(void)
 
 	empty_get_test();
 
+	regex_test();
+
 	i = 0;
 
 	frr_pthread_init();
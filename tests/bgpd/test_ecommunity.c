@@ -134,6 +134,55 @@ static void parse_test(struct test_segment *t)
 	ecommunity_unintern(&ecom);
 }
 
+/* intersection with configured values, via the RT index of the interned
+ * ecommunity and without
+ */
+static void intersect_test(void)
+{
+	static const uint8_t data[] = {
+		ECOMMUNITY_ENCODE_AS, ECOMMUNITY_ROUTE_TARGET, 0x00, 0x64,
+		0x00, 0x00, 0x00, 0x02,
+		ECOMMUNITY_ENCODE_IP, ECOMMUNITY_SITE_ORIGIN, 0x1, 0x2,
+		0x3, 0x4, 0x1, 0x1,
+		ECOMMUNITY_ENCODE_AS, ECOMMUNITY_ROUTE_TARGET, 0x00, 0x64,
+		0x00, 0x00, 0x00, 0x01,
+	};
+	static const struct {
+		const char *str;
+		bool result;
+	} cfg[] = {
+		{ "rt 100:1", true },
+		{ "rt 100:3 rt 100:2", true },
+		{ "rt 100:3", false },
+		{ "soo 1.2.3.4:257", true },
+		{ "soo 1.2.3.4:258 rt 200:1", false },
+	};
+	struct ecommunity *ecom, *conf;
+	int fails = 0;
+	size_t i;
+
+	printf("intersect: ecommunity_intersect\n");
+
+	ecom = ecommunity_parse((uint8_t *)data, sizeof(data), 0);
+	if (!ecom || ecom->rt_count != 2) {
+		printf("RT index: %u\n", ecom ? ecom->rt_count : 0);
+		fails++;
+	}
+
+	for (i = 0; ecom && i < array_size(cfg); i++) {
+		conf = ecommunity_str2com(cfg[i].str, 0, 1);
+		if (ecommunity_intersect(conf, ecom) != cfg[i].result
+		    || ecommunity_intersect(ecom, conf) != cfg[i].result) {
+			printf("%s: expected %d\n", cfg[i].str, cfg[i].result);
+			fails++;
+		}
+		ecommunity_free(&conf);
+	}
+	ecommunity_unintern(&ecom);
+
+	failed += fails;
+	printf("%s\n\n", fails ? "failed" : "OK");
+}
 
 int main(void)
 {
@@ -141,6 +190,7 @@ int main(void)
 	ecommunity_init();
 	while (test_segments[i].name)
 		parse_test(&test_segments[i++]);
+	intersect_test();
 
 	printf("failures: %d\n", failed);
 	// printf ("aspath count: %ld\n", aspath_count());
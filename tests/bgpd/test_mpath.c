@@ -375,12 +375,88 @@ testcase_t test_bgp_path_info_mpath_update = {
 	.cleanup = cleanup_bgp_path_info_mpath_update,
 };
 
+/*=========================================================
+ * Testcase for bgp_path_info_stale
+ */
+
+struct peer test_stale_peer = {.local_as = 1, .as = 2};
+struct bgp_path_info test_stale_info[] = {
+	{.peer = &test_stale_peer, .sub_type = BGP_ROUTE_NORMAL},
+	{.peer = &test_stale_peer, .sub_type = BGP_ROUTE_NORMAL,
+	 .flags = BGP_PATH_DAMPED},
+	{.peer = &test_stale_peer, .sub_type = BGP_ROUTE_NORMAL,
+	 .flags = BGP_PATH_HISTORY},
+	{.peer = &test_stale_peer, .sub_type = BGP_ROUTE_AGGREGATE},
+};
+int test_stale_info_count = array_size(test_stale_info);
+struct bgp_dest *test_stale_dest;
+
+static int setup_bgp_path_info_stale(testcase_t *t)
+{
+	int i;
+	struct bgp *bgp;
+	struct prefix p;
+	as_t asn = 1;
+
+	t->tmp_data = bgp_create_fake(&asn, NULL);
+	if (!t->tmp_data)
+		return -1;
+
+	bgp = t->tmp_data;
+	str2prefix("42.2.2.0/24", &p);
+	test_stale_dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	for (i = 0; i < test_stale_info_count; i++)
+		test_stale_info[i].net = test_stale_dest;
+	return 0;
+}
+
+static int run_bgp_path_info_stale(testcase_t *t)
+{
+	int i;
+	int test_result = TEST_PASSED;
+
+	/* everything was received in the current generation */
+	for (i = 0; i < test_stale_info_count; i++)
+		EXPECT_TRUE(!bgp_path_info_stale(&test_stale_info[i]),
+			    test_result);
+
+	/* route refresh or session down: only the normal path goes stale,
+	 * damped and history paths keep their damping state
+	 */
+	test_stale_peer.stale_gen[AFI_IP][SAFI_UNICAST]++;
+	EXPECT_TRUE(bgp_path_info_stale(&test_stale_info[0]), test_result);
+	EXPECT_TRUE(!bgp_path_info_stale(&test_stale_info[1]), test_result);
+	EXPECT_TRUE(!bgp_path_info_stale(&test_stale_info[2]), test_result);
+	EXPECT_TRUE(!bgp_path_info_stale(&test_stale_info[3]), test_result);
+
+	/* the path is received again */
+	test_stale_info[0].stale_gen =
+		test_stale_peer.stale_gen[AFI_IP][SAFI_UNICAST];
+	EXPECT_TRUE(!bgp_path_info_stale(&test_stale_info[0]), test_result);
+
+	return test_result;
+}
+
+static int cleanup_bgp_path_info_stale(testcase_t *t)
+{
+	bgp_dest_unlock_node(test_stale_dest);
+
+	return bgp_delete((struct bgp *)t->tmp_data);
+}
+
+testcase_t test_bgp_path_info_stale = {
+	.desc = "Test bgp_path_info_stale",
+	.setup = setup_bgp_path_info_stale,
+	.run = run_bgp_path_info_stale,
+	.cleanup = cleanup_bgp_path_info_stale,
+};
+
 /*=========================================================
  * Set up testcase vector
  */
 testcase_t *all_tests[] = {
 	&test_bgp_cfg_maximum_paths, &test_bgp_mp_list,
-	&test_bgp_path_info_mpath_update,
+	&test_bgp_path_info_mpath_update, &test_bgp_path_info_stale,
 };
 
 int all_tests_count = array_size(all_tests);
@@ -8,3 +8,4 @@ class TestMpath(frrtest.TestMultiOut):
 TestMpath.okfail("bgp maximum-paths config")
 TestMpath.okfail("bgp_mp_list")
 TestMpath.okfail("bgp_path_info_mpath_update")
+TestMpath.okfail("bgp_path_info_stale")
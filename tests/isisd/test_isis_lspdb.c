@@ -70,6 +70,17 @@ static void test_lsp_build_list_nonzero_ht(void)
 	assert(listgetdata(listhead(list)) == lsp1);
 	assert(listgetdata(listtail(list)) == lsp2);
 	list_delete_all_node(list);
+
+	/* exact lookups go through the hash, which has to follow the tree */
+	assert(lsp_search(lspdb, lsp1->hdr.lsp_id) == lsp1);
+	assert(lsp_search(lspdb, lsp2->hdr.lsp_id) == lsp2);
+	lsp_id2[5] = 0x03;
+	assert(lsp_search(lspdb, lsp_id2) == NULL);
+
+	lspdb_del(lspdb, lsp1);
+	assert(lsp_search(lspdb, lsp1->hdr.lsp_id) == NULL);
+	assert(lspdb_count(lspdb) == 1);
+	assert(lspdb_first(lspdb) == lsp2);
 }
 
 int main(int argc, char **argv)
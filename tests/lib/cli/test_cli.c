@@ -42,6 +42,8 @@ DUMMY_DEFUN(cmd14,
 	    "pat g {  foo A.B.C.D$foo|foo|bar   X:X::X:X$bar| baz } [final]");
 DUMMY_DEFUN(cmd15, "no pat g ![ WORD ]");
 DUMMY_DEFUN(cmd16, "[no] pat h {foo ![A.B.C.D$foo]|bar X:X::X:X$bar} final");
+DUMMY_DEFUN(cmd17, "alt r (1-10)");
+DUMMY_DEFUN(cmd18, "alt r (5-20)");
 
 #include "tests/lib/cli/test_cli_clippy.c"
 
@@ -85,5 +87,7 @@ void test_init(int argc, char **argv)
 	install_element(ENABLE_NODE, &cmd14_cmd);
 	install_element(ENABLE_NODE, &cmd15_cmd);
 	install_element(ENABLE_NODE, &cmd16_cmd);
+	install_element(ENABLE_NODE, &cmd17_cmd);
+	install_element(ENABLE_NODE, &cmd18_cmd);
 	install_element(ENABLE_NODE, &magic_test_cmd);
 }
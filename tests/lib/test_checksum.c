@@ -467,10 +467,14 @@ int main(int argc, char **argv)
 #define MAXDATALEN 60017
 #define BUFSIZE MAXDATALEN + sizeof(uint16_t)
 	uint8_t buffer[BUFSIZE];
+	/* all 0xff gives the largest intermediate sums */
+	static uint8_t ones[BUFSIZE];
 	int exercise = 0;
 #define EXERCISESTEP 257
 	struct prng *prng = prng_new(0);
 
+	memset(ones, 0xff, sizeof(ones));
+
 	while (1) {
 		uint16_t ospfd, isisd, lib, in_csum, in_csum_res, in_csum_rfc;
 		int i;
@@ -490,6 +494,19 @@ int main(int argc, char **argv)
 			printf("\nverify: in_chksum failed in_csum:%x, in_csum_res:%x,in_csum_rfc %x, len:%d\n",
 			       in_csum, in_csum_res, in_csum_rfc, exercise);
 
+		/* odd start address */
+		if (exercise > 1
+		    && in_cksum(buffer + 1, exercise - 1)
+			       != (uint16_t)in_cksum_rfc(buffer + 1,
+							 exercise - 1))
+			printf("\nverify: in_chksum failed unaligned, len:%d\n",
+			       exercise - 1);
+
+		if (in_cksum(ones, exercise)
+		    != (uint16_t)in_cksum_rfc(ones, exercise))
+			printf("\nverify: in_chksum failed on 0xff, len:%d\n",
+			       exercise);
+
 		struct iovec iov[3];
 		uint16_t in_csum_iov;
 
@@ -549,6 +566,14 @@ int main(int argc, char **argv)
 		if (verify(buffer, exercise + sizeof(uint16_t)))
 			printf("\nverify: lib failed\n");
 
+		if (fletcher_checksum(ones, exercise + sizeof(uint16_t),
+				      exercise)
+		    != ospfd_checksum(ones, exercise + sizeof(uint16_t),
+				      exercise))
+			printf("\nverify: lib failed on 0xff, len:%d\n",
+			       exercise);
+		memset(ones + exercise, 0xff, sizeof(uint16_t));
+
 		if (ospfd != lib) {
 			printf("\nMismatch in values at size %d\n"
 			       "ospfd: 0x%04x\tc0: %d\tc1: %d\tx: %d\ty: %d\n"
@@ -0,0 +1,100 @@
+/*
+ * single-writer counter snapshot tests
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "frratomic.h"
+#include "counters.h"
+
+#define NWRITES 2000000
+#define NREADERS 3
+
+/* the writer keeps total == calls * 3 and max == calls at all times */
+static struct {
+	struct counters_seq seq;
+	atomic_size_t calls;
+	atomic_size_t total;
+	atomic_size_t max;
+} stats;
+
+static atomic_bool done;
+
+static void *writer(void *arg)
+{
+	size_t i;
+
+	for (i = 1; i <= NWRITES; i++) {
+		counters_write_begin(&stats.seq);
+		counter_add(stats.calls, 1);
+		counter_add(stats.total, 3);
+		counter_max(stats.max, i);
+		counters_write_end(&stats.seq);
+	}
+
+	atomic_store_explicit(&done, true, memory_order_release);
+	return NULL;
+}
+
+static void *reader(void *arg)
+{
+	size_t calls, total, max, snaps = 0;
+	uint32_t seq;
+
+	while (!atomic_load_explicit(&done, memory_order_acquire)) {
+		do {
+			seq = counters_read_begin(&stats.seq);
+			calls = counter_get(stats.calls);
+			total = counter_get(stats.total);
+			max = counter_get(stats.max);
+		} while (counters_read_retry(&stats.seq, seq));
+
+		assert(total == calls * 3);
+		assert(max == calls);
+		snaps++;
+	}
+
+	return (void *)snaps;
+}
+
+static void test_snapshot(void)
+{
+	pthread_t wr, rd[NREADERS];
+	unsigned int i;
+
+	pthread_create(&wr, NULL, writer, NULL);
+	for (i = 0; i < NREADERS; i++)
+		pthread_create(&rd[i], NULL, reader, NULL);
+
+	pthread_join(wr, NULL);
+	for (i = 0; i < NREADERS; i++)
+		pthread_join(rd[i], NULL);
+
+	assert(counter_get(stats.calls) == NWRITES);
+	assert(counter_get(stats.total) == NWRITES * 3);
+	assert((atomic_load(&stats.seq.seq) & 1) == 0);
+
+	printf("snapshots with %u readers OK\n", NREADERS);
+}
+
+int main(int argc, char **argv)
+{
+	test_snapshot();
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestCounters(frrtest.TestMultiOut):
+    program = "./test_counters"
+
+
+TestCounters.onesimple("snapshots with 3 readers OK")
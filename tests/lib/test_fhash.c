@@ -0,0 +1,119 @@
+/*
+ * fhash tests
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "fhash.h"
+
+struct thread_master *master;
+
+#define MAXLEN 200
+
+static uint8_t buf[MAXLEN + 16];
+
+/* every byte of the input must make a difference, at any alignment */
+static void test_bytes(void)
+{
+	uint8_t data[MAXLEN];
+	size_t len, off, i;
+	uint64_t ref;
+
+	for (i = 0; i < MAXLEN; i++)
+		data[i] = i * 37 + 11;
+
+	for (len = 0; len <= MAXLEN; len++) {
+		ref = fhash64(data, len, 0);
+
+		for (off = 1; off < 16; off++) {
+			memcpy(buf + off, data, len);
+			assert(fhash64(buf + off, len, 0) == ref);
+		}
+
+		for (i = 0; i < len; i++) {
+			data[i] ^= 0x10;
+			assert(fhash64(data, len, 0) != ref);
+			data[i] ^= 0x10;
+		}
+
+		assert(fhash64(data, len, 1) != ref);
+		if (len)
+			assert(fhash64(data, len - 1, 0) != ref);
+	}
+}
+
+/* the 128-bit multiply fallback must agree with the compiler's */
+static void test_mum(void)
+{
+#ifdef __SIZEOF_INT128__
+	uint64_t a = 1, b = 0x9e3779b97f4a7c15ULL;
+	unsigned int i;
+
+	for (i = 0; i < 100000; i++) {
+		uint64_t ha = a >> 32, hb = b >> 32;
+		uint64_t la = (uint32_t)a, lb = (uint32_t)b;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la;
+		uint64_t rl = la * lb, t = rl + (rm0 << 32), lo, hi, c;
+		uint64_t ma = a, mb = b;
+
+		c = t < rl;
+		lo = t + (rm1 << 32);
+		c += lo < t;
+		hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+
+		fhash_mum(&ma, &mb);
+		assert(ma == lo && mb == hi);
+
+		a = a * 6364136223846793005ULL + 1442695040888963407ULL;
+		b ^= a >> 7;
+	}
+#endif
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t va = *(const uint32_t *)a, vb = *(const uint32_t *)b;
+
+	return (va > vb) - (va < vb);
+}
+
+/* field-wise hashing of small integers shouldn't collide */
+static void test_fields(void)
+{
+	static uint32_t seen[256 * 256];
+	uint32_t a, b;
+	size_t n = 0, i;
+
+	for (a = 0; a < 256; a++)
+		for (b = 0; b < 256; b++)
+			seen[n++] = fhash_final(fhash_add(fhash_init(0), a, b));
+
+	qsort(seen, n, sizeof(seen[0]), cmp_u32);
+	for (i = 1; i < n; i++)
+		assert(seen[i] != seen[i - 1]);
+}
+
+int main(int argc, char **argv)
+{
+	test_bytes();
+	test_mum();
+	test_fields();
+
+	printf("fhash OK\n");
+	return 0;
+}
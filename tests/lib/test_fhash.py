@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestFHash(frrtest.TestMultiOut):
+    program = "./test_fhash"
+
+
+TestFHash.onesimple("fhash OK")
@@ -0,0 +1,121 @@
+/*
+ * Hash table tests.
+ * Copyright (C) 2022  FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <zebra.h>
+
+#include "hash.h"
+#include "memory.h"
+
+DEFINE_MTYPE_STATIC(LIB, TMP_ITEM, "test item");
+
+#define NITEMS 100000
+
+struct item {
+	unsigned int val;
+};
+
+static unsigned int item_key(const void *arg)
+{
+	const struct item *item = arg;
+
+	return item->val * 2654435761U;
+}
+
+static bool item_cmp(const void *a, const void *b)
+{
+	return ((const struct item *)a)->val == ((const struct item *)b)->val;
+}
+
+static void item_count(struct hash_bucket *bucket, void *arg)
+{
+	unsigned long *count = arg;
+
+	(*count)++;
+}
+
+static struct item *item_lookup(struct hash *hash, unsigned int val)
+{
+	struct item ref = {.val = val};
+
+	return hash_lookup(hash, &ref);
+}
+
+static void run(bool incremental)
+{
+	struct hash *hash;
+	struct item *items, *found;
+	unsigned long count = 0;
+	bool migrated = false;
+	unsigned int i;
+
+	printf("%s resize\n", incremental ? "incremental" : "full");
+
+	items = XCALLOC(MTYPE_TMP_ITEM, sizeof(*items) * NITEMS);
+	hash = hash_create_size(4, item_key, item_cmp, NULL);
+	hash_set_incremental(hash, incremental);
+
+	for (i = 0; i < NITEMS; i++) {
+		items[i].val = i;
+		found = hash_get(hash, &items[i], hash_alloc_intern);
+		assert(found == &items[i]);
+
+		/* everything inserted so far must still be there */
+		assert(item_lookup(hash, i / 2) == &items[i / 2]);
+		assert(item_lookup(hash, i) == &items[i]);
+		assert(!item_lookup(hash, i + 1));
+
+		if (hash->old_index)
+			migrated = true;
+	}
+
+	assert(hash->count == NITEMS);
+	assert(hash->resizes > 0);
+	assert(migrated == incremental);
+
+	/* remove every other item, some of them may still be in old_index */
+	for (i = 0; i < NITEMS; i += 2)
+		assert(hash_release(hash, &items[i]) == &items[i]);
+
+	for (i = 0; i < NITEMS; i++)
+		assert(item_lookup(hash, i) == ((i % 2) ? &items[i] : NULL));
+
+	hash_iterate(hash, item_count, &count);
+	assert(count == NITEMS / 2);
+	assert(!hash->old_index);
+
+	/* statistics must match the final layout */
+	for (i = 0, count = 0; i < hash->size; i++)
+		if (!hash->index[i])
+			count++;
+	assert(hash->stats.empty == count);
+
+	hash_clean(hash, NULL);
+	assert(hash->count == 0);
+	hash_free(hash);
+
+	XFREE(MTYPE_TMP_ITEM, items);
+}
+
+int main(int argc, char **argv)
+{
+	run(false);
+	run(true);
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestHash(frrtest.TestMultiOut):
+    program = "./test_hash"
+
+
+TestHash.exit_cleanly()
@@ -0,0 +1,96 @@
+/*
+ * HMAC tests, RFC 2202 and RFC 4231 test vectors
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "hmac.h"
+
+struct thread_master *master;
+
+struct hmac_vector {
+	enum keychain_hash_algo algo;
+	uint8_t keybyte;
+	size_t keylen;
+	const char *data;
+	const char *result;
+};
+
+static const struct hmac_vector vectors[] = {
+	/* RFC 2202 2. test case 1 */
+	{ KEYCHAIN_ALGO_MD5, 0x0b, 16, "Hi There",
+	  "9294727a3638bb1c13f48ef8158bfc9d" },
+	/* RFC 2202 2. test case 6, key longer than a block */
+	{ KEYCHAIN_ALGO_MD5, 0xaa, 80,
+	  "Test Using Larger Than Block-Size Key - Hash Key First",
+	  "6b1ab7fe4bd7bf8f0b62e6ce61b9d0cd" },
+	/* RFC 4231 4.2. test case 1 */
+	{ KEYCHAIN_ALGO_HMAC_SHA256, 0x0b, 20, "Hi There",
+	  "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7" },
+	/* RFC 4231 4.7. test case 6 */
+	{ KEYCHAIN_ALGO_HMAC_SHA256, 0xaa, 131,
+	  "Test Using Larger Than Block-Size Key - Hash Key First",
+	  "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54" },
+};
+
+static void hexstr(char *out, const uint8_t *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		snprintf(out + 2 * i, 3, "%02x", data[i]);
+}
+
+static void test_vector(struct hmac_key *hk, const struct hmac_vector *v)
+{
+	uint8_t key[256], digest[64];
+	char hex[129];
+	size_t len = strlen(v->data);
+
+	memset(key, v->keybyte, v->keylen);
+	assert(hmac_key_set(hk, v->algo, key, v->keylen));
+
+	hmac_compute(hk, v->data, len, digest);
+	hexstr(hex, digest, hk->hash_len);
+	assert(!strcmp(hex, v->result));
+
+	/* same key again along with the data in pieces */
+	assert(hmac_key_set(hk, v->algo, key, v->keylen));
+	hmac_begin(hk);
+	hmac_update(hk, v->data, 3);
+	hmac_update(hk, v->data + 3, len - 3);
+	hmac_final(hk, digest);
+	hexstr(hex, digest, hk->hash_len);
+	assert(!strcmp(hex, v->result));
+}
+
+int main(int argc, char **argv)
+{
+	struct hmac_key hk = {};
+	size_t i;
+
+	/* one key object switching between keys and algorithms */
+	for (i = 0; i < array_size(vectors); i++)
+		test_vector(&hk, &vectors[i]);
+	for (i = array_size(vectors); i > 0; i--)
+		test_vector(&hk, &vectors[i - 1]);
+	hmac_key_fini(&hk);
+
+	printf("HMAC test vectors OK\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestHMAC(frrtest.TestMultiOut):
+    program = "./test_hmac"
+
+
+TestHMAC.onesimple("HMAC test vectors OK")
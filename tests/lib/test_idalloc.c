@@ -11,6 +11,7 @@
 
 #define IDS_PER_PAGE (1<<(IDALLOC_OFFSET_BITS + IDALLOC_WORD_BITS))
 char allocated_markers[IDS_PER_PAGE*3];
+uint32_t bulk_ids[IDS_PER_PAGE*3];
 
 int main(int argc, char **argv)
 {
@@ -192,6 +193,64 @@ int main(int argc, char **argv)
 	}
 	idalloc_destroy(a);
 
+	/* 6. Bulk allocation and freeing, mixed with the single ID calls.
+	 * Reserving out of a page that is not first in the list of pages with
+	 * free IDs leaves a full page on that list; make sure bulk allocation
+	 * steps over it.
+	 */
+	memset(allocated_markers, 0, sizeof(allocated_markers));
+	allocated_markers[IDALLOC_INVALID] = 1;
+
+	a = idalloc_new("Bulk");
+
+	assert(idalloc_allocate_bulk(a, bulk_ids, 2 * IDS_PER_PAGE - 1) ==
+	       2 * IDS_PER_PAGE - 1);
+	for (i = 0; i < 2 * IDS_PER_PAGE - 1; i++) {
+		assert(bulk_ids[i] < 2 * IDS_PER_PAGE);
+		assert(allocated_markers[bulk_ids[i]] == 0);
+		allocated_markers[bulk_ids[i]] = 1;
+	}
+	assert(a->capacity == 2 * IDS_PER_PAGE);
+	assert(a->allocated == 2 * IDS_PER_PAGE);
+
+	/* every third ID of both pages, unsorted */
+	for (i = 0, val = 0; i < 2 * IDS_PER_PAGE - 1; i += 3) {
+		bulk_ids[val++] = (i * 7 + 1) % (2 * IDS_PER_PAGE - 1) + 1;
+		allocated_markers[bulk_ids[val - 1]] = 0;
+	}
+	idalloc_free_bulk(a, bulk_ids, val);
+	for (i = 1, pg = 0; i < 2 * IDS_PER_PAGE; i++)
+		pg += !allocated_markers[i];
+	assert(a->allocated == 2 * IDS_PER_PAGE - pg);
+
+	/* fill up the second page by reserving, it's not first in the list */
+	for (i = IDS_PER_PAGE; i < 2 * IDS_PER_PAGE; i++)
+		if (!allocated_markers[i]) {
+			assert(idalloc_reserve(a, i) == (uint32_t)i);
+			allocated_markers[i] = 1;
+			pg--;
+		}
+
+	assert(idalloc_allocate_bulk(a, bulk_ids, pg + 100) == pg + 100);
+	for (i = 0; i < (int)pg + 100; i++) {
+		assert(bulk_ids[i] < 3 * IDS_PER_PAGE);
+		assert(allocated_markers[bulk_ids[i]] == 0);
+		allocated_markers[bulk_ids[i]] = 1;
+	}
+	assert(a->capacity == 3 * IDS_PER_PAGE);
+	assert(a->allocated == 2 * IDS_PER_PAGE + 100);
+
+	/* and everything back out again */
+	for (i = 1, val = 0; i < 3 * IDS_PER_PAGE; i++)
+		if (allocated_markers[i])
+			bulk_ids[val++] = i;
+	idalloc_free_bulk(a, bulk_ids, val);
+	assert(a->allocated == 1);
+	val = idalloc_allocate(a);
+	assert(val != 0 && val < 3 * IDS_PER_PAGE);
+	assert(a->capacity == 3 * IDS_PER_PAGE);
+	idalloc_destroy(a);
+
 	puts("ID Allocator test successful.\n");
 	return 0;
 }
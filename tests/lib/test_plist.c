@@ -22,7 +22,10 @@
 #include <zebra.h>
 
 #include "lib/plist.h"
+#include "lib/plist_int.h"
 #include "lib/filter.h"
+#include "lib/monotime.h"
+#include "lib/network.h"
 #include "tests/lib/cli/common_cli.h"
 
 static const struct frr_yang_module_info *const my_yang_modules[] = {
@@ -36,13 +39,115 @@ static void test_yang_modules_set(void)
 	test_yang_modules = my_yang_modules;
 }
 
+#define BENCH_LOOKUPS 1000000
+
+/* looks up the same prefixes with and without the LPM index */
+static int64_t bench_run(struct prefix_list *plist, struct prefix *lookups,
+			 const struct prefix_list_entry **res, bool lpm)
+{
+	unsigned int saved = prefix_list_lpm_min;
+	struct timeval start;
+	int64_t elapsed;
+	unsigned int i;
+
+	if (!lpm)
+		prefix_list_lpm_min = UINT_MAX;
+
+	plist->lookups = plist->compares = 0;
+	monotime(&start);
+	for (i = 0; i < BENCH_LOOKUPS; i++)
+		prefix_list_apply_ext(plist, &res[i], &lookups[i], false);
+	elapsed = monotime_since(&start, NULL);
+
+	prefix_list_lpm_min = saved;
+	return elapsed;
+}
+
+DEFUN (benchmark_prefix_list,
+       benchmark_prefix_list_cmd,
+       "benchmark prefix-list (1-1000000)",
+       "Run a benchmark\n"
+       "Prefix-list lookups\n"
+       "Number of entries\n")
+{
+	unsigned int i, n = strtoul(argv[2]->arg, NULL, 10);
+	const struct prefix_list_entry **res_trie, **res_lpm;
+	struct prefix_list *plist;
+	struct prefix *lookups;
+	struct orf_prefix orfp;
+	char name[] = "bench";
+	int64_t t_trie, t_lpm;
+	uint64_t c_trie;
+
+	srandom(n);
+	prefix_bgp_orf_remove_all(AFI_IP, name);
+
+	/* /16 to /32 in 10/8, a third of them with a ge/le range */
+	for (i = 0; i < n; i++) {
+		memset(&orfp, 0, sizeof(orfp));
+		orfp.seq = (i + 1) * 5;
+		orfp.p.family = AF_INET;
+		orfp.p.prefixlen = 16 + frr_weak_random() % 17;
+		orfp.p.u.prefix4.s_addr =
+			htonl(0x0a000000 | (frr_weak_random() & 0xffffff));
+		if (i % 3 == 0 && orfp.p.prefixlen < 32) {
+			orfp.ge = orfp.p.prefixlen + 1;
+			orfp.le = 32;
+		}
+		prefix_bgp_orf_set(name, AFI_IP, &orfp, i % 2, 1);
+	}
+
+	plist = prefix_bgp_orf_lookup(AFI_IP, name);
+	if (!plist) {
+		vty_out(vty, "%% no entries could be added\n");
+		return CMD_WARNING;
+	}
+
+	lookups = XCALLOC(MTYPE_TMP, BENCH_LOOKUPS * sizeof(*lookups));
+	res_trie = XCALLOC(MTYPE_TMP, BENCH_LOOKUPS * sizeof(*res_trie));
+	res_lpm = XCALLOC(MTYPE_TMP, BENCH_LOOKUPS * sizeof(*res_lpm));
+
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		lookups[i].family = AF_INET;
+		lookups[i].prefixlen = 16 + frr_weak_random() % 17;
+		lookups[i].u.prefix4.s_addr =
+			htonl(0x0a000000 | (frr_weak_random() & 0xffffff));
+		apply_mask(&lookups[i]);
+	}
+
+	t_trie = bench_run(plist, lookups, res_trie, false);
+	c_trie = plist->compares;
+	t_lpm = bench_run(plist, lookups, res_lpm, true);
+
+	for (i = 0; i < BENCH_LOOKUPS; i++)
+		if (res_trie[i] != res_lpm[i]) {
+			vty_out(vty, "%% result mismatch for %pFX\n",
+				&lookups[i]);
+			break;
+		}
+
+	vty_out(vty, "%u entries, %u lookups:\n", plist->count, BENCH_LOOKUPS);
+	vty_out(vty, "  trie:  %" PRId64 " us, %.1f entries compared/lookup\n",
+		t_trie, (double)c_trie / BENCH_LOOKUPS);
+	vty_out(vty, "  index: %" PRId64 " us, %.1f entries compared/lookup\n",
+		t_lpm, (double)plist->compares / BENCH_LOOKUPS);
+
+	XFREE(MTYPE_TMP, lookups);
+	XFREE(MTYPE_TMP, res_trie);
+	XFREE(MTYPE_TMP, res_lpm);
+	prefix_bgp_orf_remove_all(AFI_IP, name);
+
+	return i == BENCH_LOOKUPS ? CMD_SUCCESS : CMD_WARNING;
+}
+
 void test_init(int argc, char **argv)
 {
 	prefix_list_init();
 	filter_cli_init();
 
-	/* nothing else to do here, giving stand-alone access to the prefix
-	 * list code's "debug prefix-list ..." command is the only purpose of
-	 * this "test".
+	/* apart from the micro-benchmark below, giving stand-alone access to
+	 * the prefix list code's "debug prefix-list ..." command is the only
+	 * purpose of this "test".
 	 */
+	install_element(ENABLE_NODE, &benchmark_prefix_list_cmd);
 }
@@ -217,6 +217,19 @@ int main(int argc, char **argv)
 	printchk("2001:db8::1234/64", "%pFX", &pfx);
 	printchk("2001:db8::1234", "%pFXh", &pfx);
 
+	str2prefix("2001:db8:0:1:0:0:1:0/128", &pfx);
+	printchk("2001:db8:0:1::1:0/128", "%pFX", &pfx);
+	printchk("  2001:db8:0:1::1:0/128", "%23pFX", &pfx);
+	printchk("2001:db8:0:1::1:0", "%pI6", &pfx.u.prefix6);
+
+	str2prefix("::/0", &pfx);
+	printchk("::/0", "%pFX", &pfx);
+	printchk("::", "%pI6", &pfx.u.prefix6);
+	printchk("*", "%pI6s", &pfx.u.prefix6);
+
+	str2prefix("::10.0.0.1/104", &pfx);
+	printchk("::10.0.0.1/104", "%pFX", &pfx);
+
 	pfx.family = AF_UNIX;
 	printchk("UNK prefix", "%pFX", &pfx);
 	printchk("{prefix.af=AF_UNIX}", "%pFXh", &pfx);
@@ -0,0 +1,197 @@
+/*
+ * RCUHASH concurrency test:  one writer, several RCU-protected readers
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "atomlist.h"
+#include "frrcu.h"
+#include "memory.h"
+#include "jhash.h"
+#include "printfrr.h"
+
+#include "tests/helpers/c/prng.h"
+
+/* the writer (main pthread) adds and deletes items with add() and del() and
+ * releases them with rcu_free();  the readers look them up with find() and
+ * walk the table with first()/next().  Anything a reader gets back must be
+ * an intact item with the key it asked for.
+ */
+
+#define ITEM_MAGIC	0x52435548U
+
+PREDECL_RCUHASH(rhash);
+struct item {
+	/* first, so a premature free() clobbers it */
+	uint32_t magic;
+	uint32_t val;
+
+	struct rhash_item hitem;
+	struct rcu_head rcu_head;
+};
+
+static int icmp(const struct item *a, const struct item *b)
+{
+	return numcmp(a->val, b->val);
+}
+
+static uint32_t ihash(const struct item *a)
+{
+	return jhash_1word(a->val, 0xdeadbeef);
+}
+
+DECLARE_RCUHASH(rhash, struct item, hitem, icmp, ihash);
+
+#define NKEYS		1000
+#define NOPS		200000
+#define NTHREADS	4
+/* readers drop and retake rcu_read_lock() this often */
+#define RELOCK_EVERY	64
+
+static struct rhash_head head = INIT_RCUHASH(head);
+static struct item *present[NKEYS];
+static atomic_bool stop;
+
+static struct testthread {
+	pthread_t pt;
+	struct rcu_thread *rcu_thread;
+	size_t lookups, hits, walked;
+} thr[NTHREADS];
+
+static void check_item(const struct item *item)
+{
+	assert(item->magic == ITEM_MAGIC);
+	assert(item->val < NKEYS);
+}
+
+static void *reader(void *arg)
+{
+	struct testthread *p = arg;
+	struct prng *prng;
+	struct item ref, *item;
+	size_t i = 0;
+
+	rcu_thread_start(p->rcu_thread);
+	prng = prng_new(p - &thr[0] + 1);
+
+	while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+		memset(&ref, 0, sizeof(ref));
+		ref.val = prng_rand(prng) % NKEYS;
+
+		item = rhash_find(&head, &ref);
+		p->lookups++;
+		if (item) {
+			check_item(item);
+			assert(item->val == ref.val);
+			p->hits++;
+		}
+
+		if (++i % RELOCK_EVERY)
+			continue;
+
+		if (!(i % (RELOCK_EVERY * 64))) {
+			frr_each (rhash, &head, item) {
+				check_item(item);
+				p->walked++;
+			}
+		}
+
+		rcu_read_unlock();
+		rcu_read_lock();
+	}
+
+	prng_free(prng);
+	return NULL;
+}
+
+static void writer(void)
+{
+	struct prng *prng = prng_new(0);
+	struct item *item, ref;
+	size_t adds = 0, dels = 0, i, j, count = 0;
+
+	for (i = 0; i < NOPS; i++) {
+		j = prng_rand(prng) % NKEYS;
+		memset(&ref, 0, sizeof(ref));
+		ref.val = j;
+
+		if (present[j]) {
+			assert(rhash_find(&head, &ref) == present[j]);
+			assert(rhash_del(&head, present[j]) == present[j]);
+			rcu_free(MTYPE_TMP, present[j], rcu_head);
+			present[j] = NULL;
+			count--;
+			dels++;
+		} else {
+			assert(rhash_find(&head, &ref) == NULL);
+			item = XCALLOC(MTYPE_TMP, sizeof(*item));
+			item->magic = ITEM_MAGIC;
+			item->val = j;
+			assert(rhash_add(&head, item) == NULL);
+			present[j] = item;
+			count++;
+			adds++;
+		}
+		assert(rhash_count(&head) == count);
+
+		if (!(i % RELOCK_EVERY)) {
+			rcu_read_unlock();
+			rcu_read_lock();
+		}
+	}
+
+	printfrr("writer: %zu adds, %zu dels, %zu left\n", adds, dels, count);
+	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	struct item *item;
+	size_t i;
+
+	for (i = 0; i < NTHREADS; i++) {
+		thr[i].rcu_thread = rcu_thread_prepare();
+		assert(!pthread_create(&thr[i].pt, NULL, reader, &thr[i]));
+	}
+
+	writer();
+
+	atomic_store_explicit(&stop, true, memory_order_relaxed);
+	for (i = 0; i < NTHREADS; i++) {
+		pthread_join(thr[i].pt, NULL);
+		printfrr("reader %zu: %zu lookups, %zu hits, %zu walked\n", i,
+			 thr[i].lookups, thr[i].hits, thr[i].walked);
+	}
+
+	while ((item = rhash_pop(&head))) {
+		assert(present[item->val] == item);
+		present[item->val] = NULL;
+		rcu_free(MTYPE_TMP, item, rcu_head);
+	}
+	rhash_fini(&head);
+
+	rcu_shutdown();
+	log_memstats_stderr("test: ");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestRcuhash(frrtest.TestMultiOut):
+    program = "./test_rcuhash"
+
+
+TestRcuhash.exit_cleanly()
@@ -0,0 +1,250 @@
+/*
+ * SPF candidate list priority queues: correctness and performance
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "monotime.h"
+#include "typesafe.h"
+#include "prng.h"
+
+/*
+ * Runs Dijkstra on random graphs with the candidate list in a skiplist (as
+ * the SPF code used to), a d-ary heap and a radix heap, checking they all
+ * give the same distances.
+ */
+
+#define NODES 5000
+#define DEGREE 8
+#define RUNS 20
+
+PREDECL_SKIPLIST_NONUNIQ(pq_skip);
+PREDECL_HEAP(pq_heap);
+PREDECL_RADIXHEAP(pq_radix);
+
+struct node {
+	struct pq_skip_item skip_item;
+	struct pq_heap_item heap_item;
+	struct pq_radix_item radix_item;
+
+	uint32_t id;
+	uint32_t dist;
+	bool queued, done;
+
+	unsigned int nlinks;
+	struct link {
+		uint32_t to;
+		uint32_t cost;
+	} links[DEGREE];
+};
+
+static int node_cmp(const struct node *a, const struct node *b)
+{
+	if (a->dist != b->dist)
+		return numcmp(a->dist, b->dist);
+	return numcmp(a->id, b->id);
+}
+
+static uint64_t node_key(const struct node *n)
+{
+	return n->dist;
+}
+
+DECLARE_SKIPLIST_NONUNIQ(pq_skip, struct node, skip_item, node_cmp);
+DECLARE_HEAP(pq_heap, struct node, heap_item, node_cmp);
+DECLARE_RADIXHEAP(pq_radix, struct node, radix_item, node_key);
+
+static struct node nodes[NODES];
+static uint32_t result[NODES];
+
+static void graph_make(struct prng *prng, uint32_t maxcost)
+{
+	unsigned int i, j;
+
+	memset(nodes, 0, sizeof(nodes));
+	for (i = 0; i < NODES; i++) {
+		nodes[i].id = i;
+		nodes[i].nlinks = 1 + prng_rand(prng) % DEGREE;
+		for (j = 0; j < nodes[i].nlinks; j++) {
+			nodes[i].links[j].to = prng_rand(prng) % NODES;
+			nodes[i].links[j].cost = 1 + prng_rand(prng) % maxcost;
+		}
+	}
+}
+
+static void graph_reset(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < NODES; i++) {
+		nodes[i].dist = UINT32_MAX;
+		nodes[i].queued = nodes[i].done = false;
+	}
+	nodes[0].dist = 0;
+	nodes[0].queued = true;
+}
+
+/* decrease is how the queue is told about a lower distance */
+#define DIJKSTRA(prefix, decrease)                                             \
+static void dijkstra_##prefix(void)                                            \
+{                                                                              \
+	struct prefix##_head head;                                             \
+	struct node *v, *w;                                                    \
+	uint32_t last = 0, dist;                                               \
+	unsigned int i;                                                        \
+                                                                               \
+	graph_reset();                                                         \
+	prefix##_init(&head);                                                  \
+	prefix##_add(&head, &nodes[0]);                                        \
+                                                                               \
+	while ((v = prefix##_pop(&head))) {                                    \
+		assert(v->dist >= last);                                       \
+		last = v->dist;                                                \
+		v->queued = false;                                             \
+		v->done = true;                                                \
+                                                                               \
+		for (i = 0; i < v->nlinks; i++) {                              \
+			w = &nodes[v->links[i].to];                            \
+			dist = v->dist + v->links[i].cost;                     \
+			if (w->done || dist >= w->dist)                        \
+				continue;                                      \
+			if (w->queued) {                                       \
+				decrease;                                      \
+			} else {                                               \
+				w->dist = dist;                                \
+				w->queued = true;                              \
+				prefix##_add(&head, w);                        \
+			}                                                      \
+		}                                                              \
+	}                                                                      \
+	prefix##_fini(&head);                                                  \
+}                                                                              \
+/* end */
+
+DIJKSTRA(pq_skip, {
+	pq_skip_del(&head, w);
+	w->dist = dist;
+	pq_skip_add(&head, w);
+});
+DIJKSTRA(pq_heap, {
+	w->dist = dist;
+	pq_heap_update(&head, w);
+});
+DIJKSTRA(pq_radix, {
+	w->dist = dist;
+	pq_radix_update(&head, w);
+});
+
+static void check(const char *name, bool first)
+{
+	unsigned int i;
+
+	for (i = 0; i < NODES; i++) {
+		if (first)
+			result[i] = nodes[i].dist;
+		else if (result[i] != nodes[i].dist) {
+			printf("%s: node %u distance %u, expected %u\n", name,
+			       i, nodes[i].dist, result[i]);
+			assert(0);
+		}
+	}
+}
+
+static void run(struct prng *prng, uint32_t maxcost)
+{
+	int64_t t_skip = 0, t_heap = 0, t_radix = 0;
+	struct timeval tv;
+	unsigned int r;
+
+	for (r = 0; r < RUNS; r++) {
+		graph_make(prng, maxcost);
+
+		monotime(&tv);
+		dijkstra_pq_skip();
+		t_skip += monotime_since(&tv, NULL);
+		check("skiplist", true);
+
+		monotime(&tv);
+		dijkstra_pq_heap();
+		t_heap += monotime_since(&tv, NULL);
+		check("heap", false);
+
+		monotime(&tv);
+		dijkstra_pq_radix();
+		t_radix += monotime_since(&tv, NULL);
+		check("radixheap", false);
+	}
+
+	printf("%u nodes, costs 1-%u, %u runs:\n", NODES, maxcost, RUNS);
+	printf("  skiplist:  %8" PRId64 "us\n", t_skip);
+	printf("  heap:      %8" PRId64 "us\n", t_heap);
+	printf("  radixheap: %8" PRId64 "us\n", t_radix);
+}
+
+/*
+ * Radix heap on its own:  same keys in FIFO order, and keys below the
+ * last popped one coming out next.
+ */
+static void test_radix_order(void)
+{
+	struct pq_radix_head head;
+	unsigned int i;
+
+	pq_radix_init(&head);
+	for (i = 0; i < 16; i++) {
+		nodes[i].id = i;
+		nodes[i].dist = 100 + i / 4;
+		pq_radix_add(&head, &nodes[i]);
+	}
+	for (i = 0; i < 4; i++)
+		assert(pq_radix_pop(&head) == &nodes[i]);
+
+	nodes[15].dist = 50;
+	pq_radix_update(&head, &nodes[15]);
+	assert(pq_radix_member(&head, &nodes[15]));
+	assert(pq_radix_pop(&head) == &nodes[15]);
+	assert(!pq_radix_member(&head, &nodes[15]));
+
+	pq_radix_del(&head, &nodes[5]);
+	assert(pq_radix_count(&head) == 10);
+	for (i = 4; i < 15; i++) {
+		if (i == 5)
+			continue;
+		assert(pq_radix_pop(&head) == &nodes[i]);
+	}
+	assert(pq_radix_pop(&head) == NULL);
+	pq_radix_fini(&head);
+
+	printf("radixheap order end\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct prng *prng;
+
+	prng = prng_new(0);
+
+	test_radix_order();
+	run(prng, 64);
+	run(prng, 16777215);
+	printf("dijkstra end\n");
+
+	prng_free(prng);
+	return 0;
+}
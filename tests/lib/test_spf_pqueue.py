@@ -0,0 +1,9 @@
+import frrtest
+
+
+class TestSpfPqueue(frrtest.TestMultiOut):
+    program = "./test_spf_pqueue"
+
+
+TestSpfPqueue.onesimple("radixheap order end")
+TestSpfPqueue.onesimple("dijkstra end")
@@ -428,9 +428,107 @@ static void run_prng_test(void)
 	test_state_free(test);
 }
 
+struct match_query {
+	struct prefix_ipv6 dst_p;
+	struct prefix_ipv6 src_p;
+	const struct prefix *best;
+};
+
+/* srcdest_rnode_match() done the slow way */
+static void match_log(struct hash_bucket *bucket, void *arg)
+{
+	struct match_query *q = arg;
+	const struct prefix *hash_entry = bucket->data;
+
+	if (!prefix_match(&hash_entry[0], (struct prefix *)&q->dst_p))
+		return;
+	if (hash_entry[1].prefixlen
+	    && !prefix_match(&hash_entry[1], (struct prefix *)&q->src_p))
+		return;
+
+	if (q->best) {
+		if (q->best[0].prefixlen > hash_entry[0].prefixlen)
+			return;
+		if (q->best[0].prefixlen == hash_entry[0].prefixlen
+		    && q->best[1].prefixlen >= hash_entry[1].prefixlen)
+			return;
+	}
+	q->best = hash_entry;
+}
+
+static void test_match(struct test_state *test, struct prefix_ipv6 *dst_p,
+		       struct prefix_ipv6 *src_p)
+{
+	struct match_query q = {};
+	const struct prefix *rn_dst_p, *rn_src_p;
+	struct route_node *rn;
+
+	q.dst_p = *dst_p;
+	q.dst_p.prefixlen = IPV6_MAX_BITLEN;
+	q.src_p = *src_p;
+	q.src_p.family = AF_INET6;
+	q.src_p.prefixlen = IPV6_MAX_BITLEN;
+	hash_iterate(test->log, match_log, &q);
+
+	rn = srcdest_rnode_match(test->table, &q.dst_p, &q.src_p);
+	if (!q.best) {
+		if (rn)
+			test_failed(test, "Unexpected match", &q.dst_p,
+				    &q.src_p);
+		return;
+	}
+	if (!rn)
+		test_failed(test, "Missing match", &q.dst_p, &q.src_p);
+
+	assert(rn->info == (void *)0xdeadbeef);
+	srcdest_rnode_prefixes(rn, &rn_dst_p, &rn_src_p);
+	if (prefix_cmp(rn_dst_p, &q.best[0])
+	    || (rn_src_p ? prefix_cmp(rn_src_p, &q.best[1])
+			 : q.best[1].prefixlen != 0))
+		test_failed(test, "Wrong match", &q.dst_p, &q.src_p);
+	route_unlock_node(rn);
+}
+
+static void test_match_log(struct hash_bucket *bucket, void *arg)
+{
+	struct test_state *test = arg;
+	struct prefix *hash_entry = bucket->data;
+
+	/* hit each route with its own addresses, that also checks the more
+	 * specific routes below it and the backtracking to shorter ones
+	 */
+	test_match(test, (struct prefix_ipv6 *)&hash_entry[0],
+		   (struct prefix_ipv6 *)&hash_entry[1]);
+}
+
+static void run_match_test(void)
+{
+	struct test_state *test = test_state_new();
+	struct prng *prng = prng_new(0);
+	struct prefix_ipv6 dst_p, src_p;
+	size_t i;
+
+	for (i = 0; i < 1000; i++)
+		test_state_add_rand_route(test, prng);
+	for (i = 0; i < 300; i++)
+		test_state_del_one_route(test, prng);
+
+	hash_iterate(test->log, test_match_log, test);
+	for (i = 0; i < 1000; i++) {
+		get_rand_prefix(prng, &dst_p);
+		get_rand_prefix(prng, &src_p);
+		test_match(test, &dst_p, &src_p);
+	}
+
+	prng_free(prng);
+	test_state_free(test);
+}
+
 int main(int argc, char *argv[])
 {
 	run_prng_test();
 	printf("PRNG Test successful.\n");
+	run_match_test();
+	printf("Match Test successful.\n");
 	return 0;
 }
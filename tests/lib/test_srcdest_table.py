@@ -6,3 +6,4 @@ class TestSrcdestTable(frrtest.TestMultiOut):
 
 
 TestSrcdestTable.onesimple("PRNG Test successful.")
+TestSrcdestTable.onesimple("Match Test successful.")
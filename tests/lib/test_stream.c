@@ -46,6 +46,143 @@ static void print_stream(struct stream *s)
 	stream_set_getp(s, getp);
 }
 
+static void print_fifo(const char *name, struct stream_fifo *fifo)
+{
+	struct stream *s;
+
+	printfrr("%s (%zu):", name, stream_fifo_count_safe(fifo));
+	for (s = stream_fifo_head(fifo); s; s = s->next)
+		printfrr(" %u", *STREAM_DATA(s));
+	printfrr("\n");
+}
+
+static void fifo_put(struct stream_fifo *fifo, uint8_t first, uint8_t last)
+{
+	struct stream *s;
+
+	for (; first <= last; first++) {
+		s = stream_new(1);
+		stream_putc(s, first);
+		stream_fifo_push(fifo, s);
+	}
+}
+
+static void test_fifo_splice(void)
+{
+	struct stream_fifo *fifo = stream_fifo_new();
+	struct stream_fifo *from = stream_fifo_new();
+
+	/* into an empty fifo */
+	fifo_put(from, 1, 2);
+	stream_fifo_splice(fifo, NULL, from);
+	print_fifo("empty", fifo);
+	print_fifo("from", from);
+
+	/* at the head, and behind the head */
+	fifo_put(from, 3, 4);
+	stream_fifo_splice(fifo, NULL, from);
+	print_fifo("head", fifo);
+	fifo_put(from, 5, 5);
+	stream_fifo_splice(fifo, stream_fifo_head(fifo), from);
+	print_fifo("after", fifo);
+
+	/* behind the tail, the tail has to move */
+	fifo_put(from, 6, 7);
+	stream_fifo_splice(fifo, fifo->tail, from);
+	fifo_put(fifo, 8, 8);
+	print_fifo("tail", fifo);
+
+	/* nothing to move */
+	stream_fifo_splice(fifo, NULL, from);
+	print_fifo("none", fifo);
+
+	stream_fifo_free(fifo);
+	stream_fifo_free(from);
+}
+
+static void print_pool(const char *name)
+{
+	struct stream_pool_stats st[STREAM_POOL_CLASSES];
+
+	stream_pool_stats(st);
+	printfrr("%s: %zu hits=%zu misses=%zu cached=%zu\n", name, st[0].size,
+		 st[0].hits, st[0].misses, st[0].cached);
+}
+
+static void test_pool(void)
+{
+	struct stream *s, *again;
+
+	s = stream_new_pooled(100);
+	assert(STREAM_SIZE(s) == 100 && STREAM_WRITEABLE(s) == 100);
+	stream_putl(s, ham);
+	stream_free(s);
+	print_pool("freed");
+
+	/* the same buffer comes back, reset */
+	again = stream_new_pooled(200);
+	assert(again == s);
+	assert(STREAM_SIZE(again) == 200 && !STREAM_READABLE(again));
+	print_pool("reused");
+
+	/* resizing takes it out of its class */
+	stream_resize_inplace(&again, 1000);
+	stream_free(again);
+	print_pool("resized");
+}
+
+static void test_chain(void)
+{
+	struct stream_chain c;
+	struct stream_chain_cursor cur;
+	struct stream *s, *flat;
+	struct iovec iov[8];
+	unsigned int n, i;
+	uint64_t q;
+	uint32_t l;
+	uint16_t w;
+	uint8_t b;
+
+	/* small segments, so everything straddles */
+	stream_chain_init(&c, 3);
+	stream_chain_putl(&c, 0);
+	stream_chain_putq(&c, ham);
+	stream_chain_putw(&c, 0xcafe);
+
+	/* a header in front without moving anything */
+	s = stream_new(4);
+	stream_putw(s, 0x1234);
+	stream_chain_prepend(&c, s);
+	assert(stream_chain_putl_at(&c, 2, stream_chain_len(&c)));
+	assert(!stream_chain_putw_at(&c, stream_chain_len(&c) - 1, 0));
+
+	n = stream_chain_iov(&c, 0, iov, array_size(iov));
+	printfrr("chain: %zu bytes in %u iovs:", stream_chain_len(&c), n);
+	for (i = 0; i < n; i++)
+		printfrr(" %zu", iov[i].iov_len);
+	printfrr("\n");
+
+	stream_chain_cursor_init(&cur, &c);
+	assert(stream_chain_getw(&cur, &w));
+	assert(stream_chain_getl(&cur, &l));
+	assert(stream_chain_getq(&cur, &q));
+	printfrr("w: 0x%hx l: %u q: 0x%" PRIx64 "\n", w, l, q);
+	assert(stream_chain_getw(&cur, &w) && w == 0xcafe);
+	assert(!stream_chain_getc(&cur, &b));
+
+	/* partially written */
+	stream_chain_consume(&c, 7);
+	n = stream_chain_iov(&c, 0, iov, array_size(iov));
+	printfrr("consumed: %zu bytes in %u iovs\n", stream_chain_len(&c), n);
+
+	flat = stream_chain_flatten(&c);
+	print_stream(flat);
+	stream_free(flat);
+
+	stream_chain_reset(&c);
+	assert(stream_chain_len(&c) == 0 && !c.head && !c.tail);
+}
+
 int main(void)
 {
 	struct stream *s;
@@ -68,5 +205,9 @@ int main(void)
 	printfrr("l: 0x%x\n", stream_getl(s));
 	printfrr("q: 0x%" PRIx64 "\n", stream_getq(s));
 
+	test_fifo_splice();
+	test_pool();
+	test_chain();
+
 	return 0;
 }
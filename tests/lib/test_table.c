@@ -490,6 +490,115 @@ static void test_iter_pause(void)
 	route_table_finish(table);
 }
 
+/*
+ * test_match_index
+ *
+ * Fills a table that uses the first-level index and one that doesn't with
+ * the same random prefixes, and checks that longest-prefix matches agree.
+ */
+static route_table_delegate_t plain_delegate = {
+	.create_node = route_node_create,
+	.destroy_node = route_node_destroy,
+};
+
+static route_table_delegate_t index_delegate = {
+	.create_node = route_node_create,
+	.destroy_node = route_node_destroy,
+	.stride = 8,
+};
+
+static void random_prefix(struct prefix_ipv4 *p, uint8_t plen)
+{
+	memset(p, 0, sizeof(*p));
+	p->family = AF_INET;
+	p->prefixlen = plen;
+	p->prefix.s_addr = htonl(((uint32_t)random() << 16) ^ random());
+	apply_mask_ipv4(p);
+}
+
+static void verify_match_index(struct route_table *plain,
+			       struct route_table *indexed)
+{
+	struct route_node *rn1, *rn2;
+	struct prefix_ipv4 p;
+	int i;
+
+	for (i = 0; i < 20000; i++) {
+		random_prefix(&p, random() % (IPV4_MAX_BITLEN + 1));
+
+		rn1 = route_node_match(plain, &p);
+		rn2 = route_node_match(indexed, &p);
+
+		assert(!rn1 == !rn2);
+		if (!rn1)
+			continue;
+
+		assert(prefix_same(&rn1->p, &rn2->p));
+		route_unlock_node(rn1);
+		route_unlock_node(rn2);
+	}
+}
+
+static void test_match_index(void)
+{
+	struct route_table *plain, *indexed, *table;
+	struct prefix_ipv4 prefixes[2000];
+	struct route_node *rn;
+	int i, j;
+
+	printf("\n\nTesting route_node_match() with a first-level index\n");
+	plain = route_table_init_with_delegate(&plain_delegate);
+	indexed = route_table_init_with_delegate(&index_delegate);
+
+	srandom(1);
+	for (i = 0; i < (int)array_size(prefixes); i++) {
+		/* mostly long prefixes, some at or above the stride */
+		random_prefix(&prefixes[i], (i % 10) ? 10 + random() % 23
+						     : random() % 9);
+
+		for (j = 0; j < 2; j++) {
+			table = j ? indexed : plain;
+			rn = route_node_get(table, &prefixes[i]);
+			if (rn->info)
+				route_unlock_node(rn);
+			rn->info = table;
+		}
+	}
+
+	assert(indexed->index);
+	verify_match_index(plain, indexed);
+
+	/* drop every other prefix, the index must follow */
+	for (i = 0; i < (int)array_size(prefixes); i += 2) {
+		for (j = 0; j < 2; j++) {
+			table = j ? indexed : plain;
+			rn = route_node_lookup(table, &prefixes[i]);
+			if (!rn)
+				continue;
+
+			rn->info = NULL;
+			route_unlock_node(rn);
+			route_unlock_node(rn);
+		}
+	}
+
+	verify_match_index(plain, indexed);
+
+	for (j = 0; j < 2; j++) {
+		table = j ? indexed : plain;
+		for (rn = route_top(table); rn; rn = route_next(rn)) {
+			if (!rn->info)
+				continue;
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+		assert(table->top == NULL);
+		route_table_finish(table);
+	}
+
+	printf("Verified indexed match\n");
+}
+
 /*
  * run_tests
  */
@@ -498,6 +607,7 @@ static void run_tests(void)
 	test_prefix_iter_cmp();
 	test_get_next();
 	test_iter_pause();
+	test_match_index();
 }
 
 /*
@@ -0,0 +1,144 @@
+/*
+ * taskpool tests
+ * Copyright (C) 2022 FRRouting
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "frratomic.h"
+#include "frr_pthread.h"
+#include "taskpool.h"
+#include "thread.h"
+
+#define NTASKS 10000
+#define TREE_DEPTH 12
+
+struct thread_master *master;
+
+static struct taskpool *pool;
+static atomic_uint counter;
+
+static void count_task(void *arg)
+{
+	atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
+}
+
+/* each node spawns two children into the same group */
+static struct taskpool_group tree_grp;
+
+static void tree_task(void *arg)
+{
+	uintptr_t depth = (uintptr_t)arg;
+
+	atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
+	if (depth == 0)
+		return;
+
+	taskpool_submit(pool, &tree_grp, tree_task, (void *)(depth - 1));
+	taskpool_submit(pool, &tree_grp, tree_task, (void *)(depth - 1));
+}
+
+static void test_join(unsigned int nworkers)
+{
+	struct taskpool_group grp;
+	unsigned int i;
+
+	pool = taskpool_new("test", nworkers);
+	assert(taskpool_nworkers(pool) == nworkers);
+
+	atomic_store(&counter, 0);
+	taskpool_group_init(&grp);
+	for (i = 0; i < NTASKS; i++)
+		taskpool_submit(pool, &grp, count_task, NULL);
+	taskpool_group_wait(pool, &grp);
+	taskpool_group_fini(&grp);
+	assert(atomic_load(&counter) == NTASKS);
+
+	atomic_store(&counter, 0);
+	taskpool_group_init(&tree_grp);
+	taskpool_submit(pool, &tree_grp, tree_task, (void *)TREE_DEPTH);
+	taskpool_group_wait(pool, &tree_grp);
+	taskpool_group_fini(&tree_grp);
+	assert(atomic_load(&counter) == (2U << TREE_DEPTH) - 1);
+
+	taskpool_free(&pool);
+	assert(pool == NULL);
+
+	printf("fork/join with %u workers OK\n", nworkers);
+}
+
+static bool notified;
+static struct thread *t_keepalive;
+
+static void keepalive(struct thread *thread)
+{
+}
+
+static void notify_done(struct thread *thread)
+{
+	struct taskpool_group *grp = THREAD_ARG(thread);
+
+	assert(atomic_load(&counter) == NTASKS);
+	taskpool_group_fini(grp);
+	notified = true;
+}
+
+static void test_notify(void)
+{
+	struct taskpool_group grp;
+	struct thread t;
+	unsigned int i;
+
+	pool = taskpool_new("test", 4);
+
+	atomic_store(&counter, 0);
+	taskpool_group_init(&grp);
+	for (i = 0; i < NTASKS; i++)
+		taskpool_submit(pool, &grp, count_task, NULL);
+	taskpool_group_notify(&grp, master, notify_done, &grp);
+
+	/* keep thread_fetch() from returning while nothing is scheduled */
+	thread_add_timer(master, keepalive, NULL, 60, &t_keepalive);
+	while (!notified && thread_fetch(master, &t))
+		thread_call(&t);
+	assert(notified);
+	THREAD_OFF(t_keepalive);
+
+	/* tasks queued at free time still run */
+	atomic_store(&counter, 0);
+	for (i = 0; i < NTASKS; i++)
+		taskpool_submit(pool, NULL, count_task, NULL);
+	taskpool_free(&pool);
+	assert(atomic_load(&counter) == NTASKS);
+
+	printf("completion event OK\n");
+}
+
+int main(int argc, char **argv)
+{
+	frr_pthread_init();
+	master = thread_master_create(NULL);
+
+	test_join(0);
+	test_join(1);
+	test_join(4);
+	test_notify();
+
+	thread_master_free(master);
+	frr_pthread_finish();
+	return 0;
+}
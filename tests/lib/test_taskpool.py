@@ -0,0 +1,11 @@
+import frrtest
+
+
+class TestTaskpool(frrtest.TestMultiOut):
+    program = "./test_taskpool"
+
+
+TestTaskpool.onesimple("fork/join with 0 workers OK")
+TestTaskpool.onesimple("fork/join with 1 workers OK")
+TestTaskpool.onesimple("fork/join with 4 workers OK")
+TestTaskpool.onesimple("completion event OK")
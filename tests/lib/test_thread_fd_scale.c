@@ -0,0 +1,138 @@
+/*
+ * Test program which measures the cost of dispatching I/O events with a
+ * large number of idle file descriptors, for each available I/O backend.
+ *
+ * Copyright (C) 2022 FRRouting
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "thread.h"
+#include "prng.h"
+#include "network.h"
+
+#define MAX_PIPES   4000
+#define ROUNDS     10000
+#define ACTIVE         4
+
+struct thread_master *master;
+
+static int npipes;
+static int (*pipes)[2];
+static struct thread **readers;
+static unsigned int handled;
+
+static void pipe_read(struct thread *thread)
+{
+	int(*p)[2] = THREAD_ARG(thread);
+	char buf[16];
+
+	if (read((*p)[0], buf, sizeof(buf)) > 0)
+		handled++;
+	thread_add_read(master, pipe_read, p, (*p)[0], &readers[p - pipes]);
+}
+
+static void run(enum thread_io_backend backend, const char *name)
+{
+	struct prng *prng;
+	struct thread thread;
+	struct timeval tv_start, tv_stop;
+	unsigned long elapsed;
+	int i, r;
+
+	if (!thread_io_backend_set(backend)) {
+		printf("%s: not available\n", name);
+		return;
+	}
+
+	master = thread_master_create(NULL);
+	prng = prng_new(0);
+
+	for (i = 0; i < npipes; i++)
+		thread_add_read(master, pipe_read, &pipes[i], pipes[i][0],
+				&readers[i]);
+
+	monotime(&tv_start);
+
+	for (r = 0; r < ROUNDS; r++) {
+		int base = prng_rand(prng) % npipes;
+
+		/* wake up ACTIVE distinct pipes, spread over the fd range */
+		handled = 0;
+		for (i = 0; i < ACTIVE; i++) {
+			int n = (base + i * (npipes / ACTIVE)) % npipes;
+
+			if (write(pipes[n][1], "x", 1) != 1)
+				abort();
+		}
+
+		while (handled < ACTIVE)
+			if (thread_fetch(master, &thread))
+				thread_call(&thread);
+	}
+
+	monotime(&tv_stop);
+
+	elapsed = 1000 * (tv_stop.tv_sec - tv_start.tv_sec);
+	elapsed += (tv_stop.tv_usec - tv_start.tv_usec) / 1000;
+
+	printf("%s: %d rounds with %d idle fds took %lu.%03lu seconds.\n",
+	       name, ROUNDS, npipes, elapsed / 1000, elapsed % 1000);
+	fflush(stdout);
+
+	for (i = 0; i < npipes; i++)
+		thread_cancel(&readers[i]);
+	thread_master_free(master);
+	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	struct rlimit rl;
+	int i;
+
+	/* use as many fds as we're allowed to, up to MAX_PIPES pipes */
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+		getrlimit(RLIMIT_NOFILE, &rl);
+	}
+	npipes = MIN(MAX_PIPES, ((long)rl.rlim_cur - 64) / 2);
+
+	pipes = calloc(npipes, sizeof(*pipes));
+	readers = calloc(npipes, sizeof(*readers));
+	for (i = 0; i < npipes; i++)
+		if (pipe(pipes[i]) || set_nonblocking(pipes[i][0]))
+			abort();
+
+	run(THREAD_IO_POLL, "poll");
+	run(THREAD_IO_EPOLL, "epoll");
+
+	for (i = 0; i < npipes; i++) {
+		close(pipes[i][0]);
+		close(pipes[i][1]);
+	}
+	free(pipes);
+	free(readers);
+	return 0;
+}
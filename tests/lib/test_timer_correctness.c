@@ -31,8 +31,9 @@
 #include "prng.h"
 #include "thread.h"
 
-#define SCHEDULE_TIMERS 800
-#define REMOVE_TIMERS   200
+#define SCHEDULE_TIMERS   800
+#define REMOVE_TIMERS     200
+#define RESCHEDULE_TIMERS 200
 
 #define TIMESTR_LEN strlen("4294967296.999999")
 
@@ -52,28 +53,17 @@ static struct thread **timers;
 
 static int timers_pending;
 
-static void terminate_test(void)
+static int check_output(const char *name)
 {
-	int exit_code;
-
 	if (strcmp(log_buf, expected_buf)) {
 		fprintf(stderr,
-			"Expected output and received output differ.\n");
+			"%s: Expected output and received output differ.\n",
+			name);
 		fprintf(stderr, "---Expected output: ---\n%s", expected_buf);
 		fprintf(stderr, "---Actual output: ---\n%s", log_buf);
-		exit_code = 1;
-	} else {
-		printf("Expected output and actual output match.\n");
-		exit_code = 0;
+		return 1;
 	}
-
-	thread_master_free(master);
-	XFREE(MTYPE_TMP, log_buf);
-	XFREE(MTYPE_TMP, expected_buf);
-	prng_free(prng);
-	XFREE(MTYPE_TMP, timers);
-
-	exit(exit_code);
+	return 0;
 }
 
 static void timer_func(struct thread *thread)
@@ -88,8 +78,17 @@ static void timer_func(struct thread *thread)
 	XFREE(MTYPE_TMP, thread->arg);
 
 	timers_pending--;
-	if (!timers_pending)
-		terminate_test();
+}
+
+static void timer_arg_update(int i)
+{
+	int ret;
+
+	ret = snprintf(timers[i]->arg, TIMESTR_LEN + 1, "%lld.%06lld",
+		       (long long)timers[i]->u.sands.tv_sec,
+		       (long long)timers[i]->u.sands.tv_usec);
+	assert(ret > 0);
+	assert((size_t)ret < TIMESTR_LEN + 1);
 }
 
 static int cmp_timeval(const void *a, const void *b)
@@ -104,12 +103,13 @@ static int cmp_timeval(const void *a, const void *b)
 	return 0;
 }
 
-int main(int argc, char **argv)
+static int run_test(enum thread_timer_backend backend, const char *name)
 {
-	int i, j;
+	int i, j, rv;
 	struct thread t;
 	struct timeval **alarms;
 
+	thread_timer_backend_set(backend);
 	master = thread_master_create(NULL);
 
 	log_buf_len = SCHEDULE_TIMERS * (TIMESTR_LEN + 1) + 1;
@@ -126,19 +126,13 @@ int main(int argc, char **argv)
 
 	for (i = 0; i < SCHEDULE_TIMERS; i++) {
 		long interval_msec;
-		int ret;
-		char *arg;
 
 		/* Schedule timers to expire in 0..5 seconds */
 		interval_msec = prng_rand(prng) % 5000;
-		arg = XMALLOC(MTYPE_TMP, TIMESTR_LEN + 1);
-		thread_add_timer_msec(master, timer_func, arg, interval_msec,
-				      &timers[i]);
-		ret = snprintf(arg, TIMESTR_LEN + 1, "%lld.%06lld",
-			       (long long)timers[i]->u.sands.tv_sec,
-			       (long long)timers[i]->u.sands.tv_usec);
-		assert(ret > 0);
-		assert((size_t)ret < TIMESTR_LEN + 1);
+		thread_add_timer_msec(master, timer_func,
+				      XMALLOC(MTYPE_TMP, TIMESTR_LEN + 1),
+				      interval_msec, &timers[i]);
+		timer_arg_update(i);
 		timers_pending++;
 	}
 
@@ -154,6 +148,18 @@ int main(int argc, char **argv)
 		timers_pending--;
 	}
 
+	for (i = 0; i < RESCHEDULE_TIMERS; i++) {
+		int index;
+
+		index = prng_rand(prng) % SCHEDULE_TIMERS;
+		if (!timers[index])
+			continue;
+
+		thread_timer_reschedule_msec(timers[index],
+					     prng_rand(prng) % 5000);
+		timer_arg_update(index);
+	}
+
 	/* We create an array of pointers to the alarm times and sort
 	 * that array. That sorted array is used to generate a string
 	 * representing the expected "output" of the timers when they
@@ -179,8 +185,27 @@ int main(int argc, char **argv)
 	}
 	XFREE(MTYPE_TMP, alarms);
 
-	while (thread_fetch(master, &t))
+	while (timers_pending && thread_fetch(master, &t))
 		thread_call(&t);
 
-	return 0;
+	rv = check_output(name);
+
+	thread_master_free(master);
+	XFREE(MTYPE_TMP, log_buf);
+	XFREE(MTYPE_TMP, expected_buf);
+	prng_free(prng);
+	XFREE(MTYPE_TMP, timers);
+	return rv;
+}
+
+int main(int argc, char **argv)
+{
+	int rv = 0;
+
+	rv |= run_test(THREAD_TIMER_HEAP, "heap");
+	rv |= run_test(THREAD_TIMER_WHEEL, "wheel");
+
+	if (!rv)
+		printf("Expected output and actual output match.\n");
+	return rv;
 }
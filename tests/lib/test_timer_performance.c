@@ -30,8 +30,9 @@
 #include "thread.h"
 #include "prng.h"
 
-#define SCHEDULE_TIMERS 1000000
-#define REMOVE_TIMERS    500000
+#define SCHEDULE_TIMERS   1000000
+#define RESCHEDULE_TIMERS 1000000
+#define REMOVE_TIMERS      500000
 
 struct thread_master *master;
 
@@ -39,14 +40,15 @@ static void dummy_func(struct thread *thread)
 {
 }
 
-int main(int argc, char **argv)
+static void run(enum thread_timer_backend backend, const char *name)
 {
 	struct prng *prng;
 	int i;
 	struct thread **timers;
-	struct timeval tv_start, tv_lap, tv_stop;
-	unsigned long t_schedule, t_remove;
+	struct timeval tv_start, tv_lap, tv_resched, tv_stop;
+	unsigned long t_schedule, t_resched, t_remove;
 
+	thread_timer_backend_set(backend);
 	master = thread_master_create(NULL);
 	prng = prng_new(0);
 	timers = calloc(SCHEDULE_TIMERS, sizeof(*timers));
@@ -71,6 +73,17 @@ int main(int argc, char **argv)
 
 	monotime(&tv_lap);
 
+	for (i = 0; i < RESCHEDULE_TIMERS; i++) {
+		int index;
+
+		index = prng_rand(prng) % SCHEDULE_TIMERS;
+		thread_timer_reschedule_msec(timers[index],
+					     prng_rand(prng)
+						     % (100 * SCHEDULE_TIMERS));
+	}
+
+	monotime(&tv_resched);
+
 	for (i = 0; i < REMOVE_TIMERS; i++) {
 		int index;
 
@@ -83,17 +96,28 @@ int main(int argc, char **argv)
 	t_schedule = 1000 * (tv_lap.tv_sec - tv_start.tv_sec);
 	t_schedule += (tv_lap.tv_usec - tv_start.tv_usec) / 1000;
 
-	t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
-	t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
+	t_resched = 1000 * (tv_resched.tv_sec - tv_lap.tv_sec);
+	t_resched += (tv_resched.tv_usec - tv_lap.tv_usec) / 1000;
+
+	t_remove = 1000 * (tv_stop.tv_sec - tv_resched.tv_sec);
+	t_remove += (tv_stop.tv_usec - tv_resched.tv_usec) / 1000;
 
-	printf("Scheduling %d random timers took %lu.%03lu seconds.\n",
-	       SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
-	printf("Removing %d random timers took %lu.%03lu seconds.\n",
-	       REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
+	printf("%s: Scheduling %d random timers took %lu.%03lu seconds.\n",
+	       name, SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
+	printf("%s: Rescheduling %d random timers took %lu.%03lu seconds.\n",
+	       name, RESCHEDULE_TIMERS, t_resched / 1000, t_resched % 1000);
+	printf("%s: Removing %d random timers took %lu.%03lu seconds.\n",
+	       name, REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
 	fflush(stdout);
 
 	free(timers);
 	thread_master_free(master);
 	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	run(THREAD_TIMER_HEAP, "heap");
+	run(THREAD_TIMER_WHEEL, "wheel");
 	return 0;
 }
@@ -67,12 +67,14 @@
 #define _T_SORTLIST_UNIQ	(T_SORTED | T_UNIQ)
 #define _T_SORTLIST_NONUNIQ	(T_SORTED)
 #define _T_HASH			(T_SORTED | T_UNIQ | T_HASH)
+#define _T_FLATHASH		(T_SORTED | T_UNIQ | T_HASH)
 #define _T_SKIPLIST_UNIQ	(T_SORTED | T_UNIQ)
 #define _T_SKIPLIST_NONUNIQ	(T_SORTED)
 #define _T_RBTREE_UNIQ		(T_SORTED | T_UNIQ | T_REVERSE)
 #define _T_RBTREE_NONUNIQ	(T_SORTED          | T_REVERSE)
 #define _T_ATOMSORT_UNIQ	(T_SORTED | T_UNIQ | T_ATOMIC)
 #define _T_ATOMSORT_NONUNIQ	(T_SORTED          | T_ATOMIC)
+#define _T_RCUHASH		(T_SORTED | T_UNIQ | T_HASH | T_ATOMIC)
 
 #define _T_TYPE(type)		_T_##type
 #define IS_SORTED(type)		(_T_TYPE(type) & T_SORTED)
@@ -130,6 +132,15 @@ static void ts_end(void)
 #include "test_typelist.h"
 #undef SHITTY_HASH
 
+#define TYPE FLATHASH
+#include "test_typelist.h"
+
+#define TYPE FLATHASH_collisions
+#define REALTYPE FLATHASH
+#define SHITTY_HASH
+#include "test_typelist.h"
+#undef SHITTY_HASH
+
 #define TYPE SKIPLIST_UNIQ
 #include "test_typelist.h"
 
@@ -148,6 +159,15 @@ static void ts_end(void)
 #define TYPE ATOMSORT_NONUNIQ
 #include "test_typelist.h"
 
+#define TYPE RCUHASH
+#include "test_typelist.h"
+
+#define TYPE RCUHASH_collisions
+#define REALTYPE RCUHASH
+#define SHITTY_HASH
+#include "test_typelist.h"
+#undef SHITTY_HASH
+
 int main(int argc, char **argv)
 {
 	srandom(1);
@@ -160,12 +180,16 @@ int main(int argc, char **argv)
 	test_SORTLIST_NONUNIQ();
 	test_HASH();
 	test_HASH_collisions();
+	test_FLATHASH();
+	test_FLATHASH_collisions();
 	test_SKIPLIST_UNIQ();
 	test_SKIPLIST_NONUNIQ();
 	test_RBTREE_UNIQ();
 	test_RBTREE_NONUNIQ();
 	test_ATOMSORT_UNIQ();
 	test_ATOMSORT_NONUNIQ();
+	test_RCUHASH();
+	test_RCUHASH_collisions();
 
 	log_memstats_stderr("test: ");
 	return 0;
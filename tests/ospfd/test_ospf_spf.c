@@ -48,6 +48,18 @@ static struct ospf *test_init(struct ospf_test_node *root)
 	return ospf;
 }
 
+/* P and Q spaces are vertices of SPF trees shared between them */
+static void print_vertex_list(struct vty *vty, struct list *vertex_list)
+{
+	struct listnode *node;
+	struct vertex *vertex;
+
+	for (ALL_LIST_ELEMENTS_RO(vertex_list, node, vertex))
+		vty_out(vty, " %s %pI4\n",
+			vertex->type == OSPF_VERTEX_ROUTER ? "[R]" : "[N]",
+			&vertex->id);
+}
+
 static void test_run_spf(struct vty *vty, struct ospf *ospf,
 			 enum protection_type protection_type, bool verbose)
 {
@@ -94,13 +106,13 @@ static void test_run_spf(struct vty *vty, struct ospf *ospf,
 				p_space->protected_resource, res_buf);
 			vty_out(vty, "\nP Space for root %pI4 and %s\n",
 				&p_space->root->id, res_buf);
-			ospf_spf_print(vty, p_space->root, 0);
+			print_vertex_list(vty, p_space->vertex_list);
 
 			frr_each (q_spaces, p_space->q_spaces, q_space) {
 				vty_out(vty,
 					"\nQ Space for destination %pI4:\n",
 					&q_space->root->id);
-				ospf_spf_print(vty, q_space->root, 0);
+				print_vertex_list(vty, q_space->vertex_list);
 				if (q_space->label_stack) {
 					mpls_label2str(
 						q_space->label_stack
@@ -0,0 +1,148 @@
+#!/usr/bin/env python
+
+#
+# test_bgp_process_threads.py
+#
+# Copyright (c) 2022 by
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+Check that best path selection with `bgp process-threads N` converges to
+the same result as the single-threaded code, and log how long convergence
+after a session reset takes for each N.
+"""
+
+import os
+import sys
+import json
+import time
+import pytest
+import functools
+
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+# pylint: disable=C0413
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+from lib.topolog import logger
+
+pytestmark = [pytest.mark.bgpd, pytest.mark.sharpd]
+
+ROUTE_COUNT = 20000
+
+
+def build_topo(tgen):
+    for routern in range(1, 3):
+        tgen.add_router("r{}".format(routern))
+
+    switch = tgen.add_switch("s1")
+    switch.add_link(tgen.gears["r1"])
+    switch.add_link(tgen.gears["r2"])
+
+
+def setup_module(mod):
+    tgen = Topogen(build_topo, mod.__name__)
+    tgen.start_topology()
+
+    router_list = tgen.routers()
+
+    for rname, router in router_list.items():
+        router.load_config(
+            TopoRouter.RD_ZEBRA, os.path.join(CWD, "{}/zebra.conf".format(rname))
+        )
+        router.load_config(
+            TopoRouter.RD_BGP, os.path.join(CWD, "{}/bgpd.conf".format(rname))
+        )
+        if rname == "r1":
+            router.load_config(TopoRouter.RD_SHARP)
+
+    tgen.start_router()
+
+
+def teardown_module(mod):
+    tgen = get_topogen()
+    tgen.stop_topology()
+
+
+def _bgp_prefixes_received(router, count):
+    output = json.loads(router.vtysh_cmd("show bgp ipv4 unicast summary json"))
+    expected = {
+        "peers": {"192.168.1.1": {"state": "Established", "pfxRcd": count}}
+    }
+    return topotest.json_cmp(output, expected)
+
+
+def test_bgp_process_threads_converge():
+    tgen = get_topogen()
+
+    if tgen.routers_have_failure():
+        pytest.skip(tgen.errors)
+
+    r1 = tgen.gears["r1"]
+    r2 = tgen.gears["r2"]
+
+    r1.vtysh_cmd(
+        "sharp install routes 10.0.0.0 nexthop 192.168.1.1 {}".format(ROUTE_COUNT)
+    )
+
+    timings = {}
+    for threads in [1, 2, 4]:
+        r2.vtysh_cmd(
+            """
+            configure terminal
+             bgp process-threads {}
+            """.format(
+                threads
+            )
+        )
+        r2.vtysh_cmd("clear bgp *")
+
+        start = time.time()
+        test_func = functools.partial(_bgp_prefixes_received, r2, ROUTE_COUNT)
+        _, result = topotest.run_and_expect(test_func, None, count=120, wait=0.5)
+        assert result is None, "r2 did not converge with {} process threads".format(
+            threads
+        )
+        timings[threads] = time.time() - start
+
+        output = json.loads(r2.vtysh_cmd("show bgp ipv4 unicast summary json"))
+        assert output["ribCount"] == ROUTE_COUNT
+
+    for threads, elapsed in timings.items():
+        logger.info(
+            "{} routes converged in {:.2f}s with {} process threads".format(
+                ROUTE_COUNT, elapsed, threads
+            )
+        )
+
+    running = r2.vtysh_cmd("show running-config")
+    assert "bgp process-threads 4" in running
+
+
+def test_memory_leak():
+    "Run the memory leak test and report results."
+    tgen = get_topogen()
+    if not tgen.is_memleak_enabled():
+        pytest.skip("Memory leak test/report is disabled")
+
+    tgen.report_memory_leaks()
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -0,0 +1,115 @@
+#!/usr/bin/env python
+
+#
+# test_zebra_route_batch.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+test_zebra_route_batch.py: Feed zebra short and truncated ZEBRA_ROUTE_BATCH
+messages and make sure it survives them.
+"""
+
+# pylint: disable=C0413
+import os
+import re
+import sys
+
+import pytest
+
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+from lib.topogen import Topogen, TopoRouter
+from lib.topolog import logger
+
+
+def zapi_command(name):
+    "Look up the value of a ZAPI command in lib/zclient.h"
+
+    with open(os.path.join(CWD, "../../../lib/zclient.h")) as f:
+        text = f.read()
+
+    body = re.search(r"typedef enum \{(.*?)\} zebra_message_types_t;", text, re.S)
+    commands = re.findall(r"^\s*(ZEBRA_\w+),", body.group(1), re.M)
+    return commands.index(name)
+
+
+@pytest.fixture(scope="module")
+def tgen(request):
+    "Sets up the pytest environment"
+
+    topodef = {"s1": ("r1",)}
+    tgen = Topogen(topodef, request.module.__name__)
+    tgen.start_topology()
+
+    router_list = tgen.routers()
+    for rname, router in router_list.items():
+        router.load_config(
+            TopoRouter.RD_ZEBRA, os.path.join(CWD, "{}/zebra.conf".format(rname))
+        )
+
+    tgen.start_router()
+    yield tgen
+    tgen.stop_topology()
+
+
+@pytest.fixture(autouse=True)
+def skip_on_failure(tgen):
+    if tgen.routers_have_failure():
+        pytest.skip("skipped because of previous test failure")
+
+
+def test_zebra_route_batch_truncated(tgen):
+    "Send route batches that end early or hold a bad route"
+    logger.info("Sending short and truncated ZEBRA_ROUTE_BATCH messages")
+
+    r1 = tgen.gears["r1"]
+    batch = zapi_command("ZEBRA_ROUTE_BATCH")
+    add = zapi_command("ZEBRA_ROUTE_ADD")
+
+    bodies = [
+        # too short to hold the route count
+        "",
+        "00",
+        # route count, but no routes
+        "0002",
+        # route command, but no length
+        "0001{:02x}".format(add),
+        # route length beyond the end of the message
+        "0001{:02x}00c8".format(add) + "00" * 8,
+        # route that fails to decode within its length, then nothing
+        "0002{:02x}0003".format(add) + "ffffff",
+    ]
+
+    output = r1.cmd(
+        "python3 {} /var/run/frr/zserv.api {} {}".format(
+            os.path.join(CWD, "zapi_send.py"),
+            batch,
+            " ".join("'{}'".format(body) for body in bodies),
+        )
+    )
+    logger.info(output)
+
+    assert r1.check_router_running() == "", "zebra died on a bad route batch"
+
+    output = r1.vtysh_cmd("show zebra client summary")
+    assert "Name" in output, "zebra is not answering anymore"
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+
+#
+# zapi_send.py
+#
+# Permission to use, copy, modify, and/or distribute this software
+# for any purpose with or without fee is hereby granted, provided
+# that the above copyright notice and this permission notice appear
+# in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND NETDEF DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL NETDEF BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY
+# DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS
+# ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+"""
+zapi_send.py: send raw ZAPI messages to zebra
+
+Usage: zapi_send.py SOCKET COMMAND [HEXBODY ...]
+
+Each HEXBODY (possibly empty) is sent as one message with the given
+command number in VRF 0, wrapped in a valid ZAPI header.
+"""
+
+import socket
+import struct
+import sys
+import time
+
+ZEBRA_HEADER_MARKER = 254
+ZSERV_VERSION = 6
+ZEBRA_HEADER_SIZE = 10
+
+
+def main():
+    path = sys.argv[1]
+    command = int(sys.argv[2])
+
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(path)
+
+    for hexbody in sys.argv[3:]:
+        body = bytes.fromhex(hexbody)
+        hdr = struct.pack(
+            "!HBBIH",
+            ZEBRA_HEADER_SIZE + len(body),
+            ZEBRA_HEADER_MARKER,
+            ZSERV_VERSION,
+            0,
+            command,
+        )
+        sock.sendall(hdr + body)
+
+    # give zebra a chance to process everything before the client goes away
+    time.sleep(1)
+    sock.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -1047,6 +1047,55 @@ done:
 		thread_add_read(master, vrrp_read, r, r->sock_rx, &r->t_read);
 }
 
+/*
+ * Makes the kernel drop advertisements for other virtual routers before
+ * they are queued on the Rx socket.  All virtual routers on an interface
+ * receive every advertisement sent on it, and checking the VRID only after
+ * reading them costs a wakeup per advertisement per virtual router.
+ *
+ * IPv4 raw sockets see the IP header, IPv6 ones only the VRRP packet.  Not
+ * being able to attach the filter is not fatal, the VRID is still checked
+ * on receipt.
+ */
+static void vrrp_socket_filter(struct vrrp_router *r)
+{
+	struct sock_filter v4[] = {
+		/* X = IP header length */
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+		BPF_STMT(BPF_LD | BPF_B | BPF_IND, 1),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, r->vr->vrid, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, UINT32_MAX),
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+	struct sock_filter v6[] = {
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 1),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, r->vr->vrid, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, UINT32_MAX),
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+	struct sock_fprog prog;
+
+	if (r->family == AF_INET) {
+		prog.filter = v4;
+		prog.len = array_size(v4);
+	} else {
+		prog.filter = v6;
+		prog.len = array_size(v6);
+	}
+
+	if (setsockopt(r->sock_rx, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+		       sizeof(prog)) < 0)
+		zlog_warn(VRRP_LOGPFX VRRP_LOGPFX_VRID VRRP_LOGPFX_FAM
+			  "Failed to attach VRID filter to Rx socket: %s",
+			  r->vr->vrid, family2str(r->family),
+			  safe_strerror(errno));
+	else
+		DEBUGD(&vrrp_dbg_sock,
+		       VRRP_LOGPFX VRRP_LOGPFX_VRID VRRP_LOGPFX_FAM
+		       "Attached VRID filter to Rx socket",
+		       r->vr->vrid, family2str(r->family));
+}
+
 /*
  * Creates and configures VRRP router sockets.
  *
@@ -1323,6 +1372,8 @@ static int vrrp_socket(struct vrrp_router *r)
 		       r->vr->vrid, family2str(r->family), r->mvl_ifp->name);
 	}
 
+	vrrp_socket_filter(r);
+
 done:
 	ret = 0;
 	if (failed) {
@@ -25,6 +25,7 @@
 #include <sys/wait.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <poll.h>
 
 /* readline carries some ancient definitions around */
 #pragma GCC diagnostic push
@@ -54,6 +55,7 @@
 #include "bgpd/bgp_vty.h"
 
 DEFINE_MTYPE_STATIC(MVTYSH, VTYSH_CMD, "Vtysh cmd copy");
+DEFINE_MTYPE_STATIC(MVTYSH, VTYSH_FANOUT, "Vtysh daemon reply buffer");
 
 /* Struct VTY. */
 struct vty *vty;
@@ -481,6 +483,244 @@ static int vtysh_client_execute(struct vtysh_client *head_client,
 	return vtysh_client_run_all(head_client, line, 0, NULL, NULL);
 }
 
+/*
+ * Fan-out: send the same command to several daemons at once and read the
+ * replies as they come in, instead of waiting for each daemon in turn.
+ * Output is only passed on (to vty->of and the line callback) once all
+ * replies are complete, and then in the order the daemons were given, so
+ * the result is the same as running them one after another.
+ */
+struct vtysh_fanout {
+	struct vtysh_client *vclient;
+
+	char *buf;
+	size_t len, size;
+	/* offset of the terminator, -1 until seen */
+	ssize_t end;
+
+	bool done;
+	int err;
+	int ret;
+};
+
+static void vtysh_fanout_send(struct vtysh_fanout *fo, const char *line)
+{
+	struct vtysh_client *vclient = fo->vclient;
+
+	fo->end = -1;
+	fo->ret = CMD_SUCCESS;
+	fo->done = true;
+
+	/* vclient was previously active, try to reconnect */
+	if (vclient->fd == VTYSH_WAS_ACTIVE && vtysh_reconnect(vclient) < 0) {
+		vclient_close(vclient);
+		return;
+	}
+	if (vclient->fd < 0)
+		return;
+
+	if (write(vclient->fd, line, strlen(line) + 1) <= 0) {
+		/* close connection and try to reconnect */
+		vclient_close(vclient);
+		if (vtysh_reconnect(vclient) < 0
+		    || write(vclient->fd, line, strlen(line) + 1) <= 0) {
+			vclient_close(vclient);
+			return;
+		}
+	}
+	fo->done = false;
+}
+
+static void vtysh_fanout_read(struct vtysh_fanout *fo)
+{
+	ssize_t nread;
+	char *term;
+
+	if (fo->size - fo->len < 4096) {
+		fo->size = fo->size ? fo->size * 2 : 16384;
+		fo->buf = XREALLOC(MTYPE_VTYSH_FANOUT, fo->buf, fo->size);
+	}
+
+	nread = vtysh_client_receive(fo->vclient, fo->buf + fo->len,
+				     fo->size - fo->len - 1, NULL);
+	if (nread < 0 && (errno == EINTR || errno == EAGAIN))
+		return;
+	if (nread <= 0) {
+		/* reported in order by vtysh_fanout_emit() */
+		fo->err = nread < 0 ? errno : ECONNRESET;
+		fo->done = true;
+		return;
+	}
+
+	/* daemons send text, so the first NUL starts the terminator */
+	if (fo->end < 0) {
+		term = memchr(fo->buf + fo->len, '\0', nread);
+		if (term)
+			fo->end = term - fo->buf;
+	}
+	fo->len += nread;
+
+	if (fo->end >= 0 && fo->len >= (size_t)fo->end + 4) {
+		fo->ret = fo->buf[fo->end + 3];
+		fo->done = true;
+	}
+}
+
+static void vtysh_fanout_emit(struct vtysh_fanout *fo,
+			      void (*callback)(void *, const char *),
+			      void *cbarg)
+{
+	char *text = fo->buf, *eol;
+
+	if (text) {
+		text[fo->end >= 0 ? (size_t)fo->end : fo->len] = '\0';
+
+		if (!callback) {
+			if (vty->of)
+				vty_out(vty, "%s", text);
+		} else
+			while (*text) {
+				eol = strchr(text, '\n');
+				if (eol)
+					*eol++ = '\0';
+				else
+					eol = text + strlen(text);
+
+				if (vty->of)
+					vty_out(vty, "%s\n", text);
+				callback(cbarg, text);
+				text = eol;
+			}
+	}
+
+	if (fo->err) {
+		if (vty->of)
+			vty_out(vty, "vtysh: error reading from %s: %s (%d)",
+				fo->vclient->name, safe_strerror(fo->err),
+				fo->err);
+		vclient_close(fo->vclient);
+	}
+}
+
+/*
+ * Run a command on all instances of several daemons concurrently.
+ *
+ * heads, nheads
+ *    the daemons to run the command on, output is produced in this order
+ *
+ * headline
+ *    if non-null, printed (with the daemon name) before each daemon's output
+ *
+ * The other arguments are as for vtysh_client_run_all().
+ *
+ * Returns:
+ *    the status code for the last daemon, as a loop calling
+ *    vtysh_client_run_all() for each of them would
+ */
+static int vtysh_client_run_parallel(struct vtysh_client **heads,
+				     size_t nheads, const char *line,
+				     int continue_on_err,
+				     void (*callback)(void *, const char *),
+				     void *cbarg, const char *headline)
+{
+	struct vtysh_client *client;
+	struct vtysh_fanout *fos, *fo;
+	struct pollfd *pfds;
+	size_t *pidx;
+	size_t i, nfo = 0, npfd;
+	int rc_all = CMD_SUCCESS;
+
+	for (i = 0; i < nheads; i++)
+		for (client = heads[i]; client; client = client->next)
+			nfo++;
+	if (!nfo)
+		return CMD_SUCCESS;
+
+	fos = XCALLOC(MTYPE_VTYSH_FANOUT, nfo * sizeof(*fos));
+	pfds = XCALLOC(MTYPE_VTYSH_FANOUT, nfo * sizeof(*pfds));
+	pidx = XCALLOC(MTYPE_VTYSH_FANOUT, nfo * sizeof(*pidx));
+
+	fo = fos;
+	for (i = 0; i < nheads; i++)
+		for (client = heads[i]; client; client = client->next) {
+			fo->vclient = client;
+			vtysh_fanout_send(fo++, line);
+		}
+
+	while (true) {
+		npfd = 0;
+		for (i = 0; i < nfo; i++) {
+			if (fos[i].done)
+				continue;
+			pfds[npfd].fd = fos[i].vclient->fd;
+			pfds[npfd].events = POLLIN;
+			pfds[npfd].revents = 0;
+			pidx[npfd++] = i;
+		}
+		if (!npfd)
+			break;
+
+		if (poll(pfds, npfd, -1) < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			for (i = 0; i < npfd; i++) {
+				fos[pidx[i]].err = errno;
+				fos[pidx[i]].done = true;
+			}
+			break;
+		}
+
+		for (i = 0; i < npfd; i++)
+			if (pfds[i].revents)
+				vtysh_fanout_read(&fos[pidx[i]]);
+	}
+
+	fo = fos;
+	for (i = 0; i < nheads; i++) {
+		int correct_instance = 0, wrong_instance = 0;
+		bool stop = false;
+
+		rc_all = CMD_SUCCESS;
+		if (headline)
+			vty_out(vty, headline, heads[i]->name);
+
+		for (client = heads[i]; client; client = client->next, fo++) {
+			/* a serial run would not have got to these */
+			if (stop)
+				continue;
+
+			vtysh_fanout_emit(fo, callback, cbarg);
+
+			if (fo->ret == CMD_NOT_MY_INSTANCE) {
+				wrong_instance++;
+				continue;
+			}
+			if (client->fd > 0)
+				correct_instance++;
+			if (fo->ret != CMD_SUCCESS) {
+				rc_all = fo->ret;
+				stop = !continue_on_err;
+			}
+		}
+		if (wrong_instance && !correct_instance && vty->of) {
+			vty_out(vty,
+				"%% [%s]: command ignored as it targets an instance that is not running\n",
+				heads[i]->name);
+			rc_all = CMD_WARNING_CONFIG_FAILED;
+		}
+
+		if (headline)
+			vty_out(vty, "\n");
+	}
+
+	for (i = 0; i < nfo; i++)
+		XFREE(MTYPE_VTYSH_FANOUT, fos[i].buf);
+	XFREE(MTYPE_VTYSH_FANOUT, pidx);
+	XFREE(MTYPE_VTYSH_FANOUT, pfds);
+	XFREE(MTYPE_VTYSH_FANOUT, fos);
+	return rc_all;
+}
+
 /* Execute by name */
 static int vtysh_client_execute_name(const char *name, const char *line)
 {
@@ -500,28 +740,34 @@ static int vtysh_client_execute_name(const char *name, const char *line)
 
 /*
  * Retrieve all running config from daemons and parse it with the vtysh config
- * parser. Returned output is not displayed to the user.
+ * parser. Returned output is not displayed to the user.  The daemons are
+ * queried concurrently, but their config is parsed in the order given.
  *
- * head_client
- *    where to start walking in the daemon list
+ * heads, nheads
+ *    the daemons to retrieve the config from
  *
  * line
  *    the specific command to execute
  */
-static void vtysh_client_config(struct vtysh_client *head_client, char *line)
+static void vtysh_client_config(struct vtysh_client **heads, size_t nheads,
+				char *line)
 {
+	struct vtysh_client *sel[array_size(vtysh_client)];
+	size_t i, nsel = 0;
+
 	/* watchfrr currently doesn't load any config, and has some hardcoded
 	 * settings that show up in "show run".  skip it here (for now at
 	 * least) so we don't get that mangled up in config-write.
 	 */
-	if (head_client->flag == VTYSH_WATCHFRR)
-		return;
+	for (i = 0; i < nheads && nsel < array_size(sel); i++)
+		if (heads[i]->flag != VTYSH_WATCHFRR)
+			sel[nsel++] = heads[i];
 
 	/* suppress output to user */
 	vty->of_saved = vty->of;
 	vty->of = NULL;
-	vtysh_client_run_all(head_client, line, 1, vtysh_config_parse_line,
-			     NULL);
+	vtysh_client_run_parallel(sel, nsel, line, 1, vtysh_config_parse_line,
+				  NULL, NULL);
 	vty->of = vty->of_saved;
 }
 
@@ -2921,16 +3167,17 @@ static char *do_prepend(struct vty *vty, struct cmd_token **argv, int argc)
 static int show_per_daemon(struct vty *vty, struct cmd_token **argv, int argc,
 			   const char *headline)
 {
-	unsigned int i;
-	int ret = CMD_SUCCESS;
+	struct vtysh_client *heads[array_size(vtysh_client)];
+	unsigned int i, nheads = 0;
+	int ret;
 	char *line = do_prepend(vty, argv, argc);
 
 	for (i = 0; i < array_size(vtysh_client); i++)
-		if (vtysh_client[i].fd >= 0 || vtysh_client[i].next) {
-			vty_out(vty, headline, vtysh_client[i].name);
-			ret = vtysh_client_execute(&vtysh_client[i], line);
-			vty_out(vty, "\n");
-		}
+		if (vtysh_client[i].fd >= 0 || vtysh_client[i].next)
+			heads[nheads++] = &vtysh_client[i];
+
+	ret = vtysh_client_run_parallel(heads, nheads, line, 0, NULL, NULL,
+					headline);
 
 	XFREE(MTYPE_TMP, line);
 
@@ -3232,6 +3479,21 @@ DEFUN (vtysh_show_memory,
 	return show_per_daemon(vty, argv, argc, "Memory statistics for %s:\n");
 }
 
+DEFUN (vtysh_show_memory_per_thread,
+       vtysh_show_memory_per_thread_cmd,
+       "show memory per-thread [" DAEMONS_LIST "]",
+       SHOW_STR
+       "Memory statistics\n"
+       "Break down allocations by pthread\n"
+       DAEMONS_STR)
+{
+	if (argc == 4)
+		return show_one_daemon(vty, argv, argc - 1,
+				       argv[argc - 1]->text);
+
+	return show_per_daemon(vty, argv, argc, "Memory statistics for %s:\n");
+}
+
 DEFUN (vtysh_show_modules,
        vtysh_show_modules_cmd,
        "show modules",
@@ -3261,29 +3523,11 @@ DEFUNSH(VTYSH_ALL, vtysh_debug_memstats,
 	return CMD_SUCCESS;
 }
 
-DEFUN(vtysh_debug_uid_backtrace,
-      vtysh_debug_uid_backtrace_cmd,
-      "[no] debug unique-id UID backtrace",
-      NO_STR
-      DEBUG_STR
-      "Options per individual log message, by unique ID\n"
-      "Log message unique ID (XXXXX-XXXXX)\n"
-      "Add backtrace to log when message is printed\n")
+/* per-UID options go to whichever daemon(s) know the UID */
+static int vtysh_debug_uid(struct vty *vty, const char *uid, const char *line)
 {
 	unsigned int i, ok = 0;
 	int err = CMD_SUCCESS, ret;
-	const char *uid;
-	char line[64];
-
-	if (!strcmp(argv[0]->text, "no")) {
-		uid = argv[3]->arg;
-		snprintfrr(line, sizeof(line),
-			   "no debug unique-id %s backtrace", uid);
-	} else {
-		uid = argv[2]->arg;
-		snprintfrr(line, sizeof(line), "debug unique-id %s backtrace",
-			   uid);
-	}
 
 	for (i = 0; i < array_size(vtysh_client); i++)
 		if (vtysh_client[i].fd >= 0 || vtysh_client[i].next) {
@@ -3315,6 +3559,55 @@ DEFUN(vtysh_debug_uid_backtrace,
 	return err;
 }
 
+DEFUN(vtysh_debug_uid_backtrace,
+      vtysh_debug_uid_backtrace_cmd,
+      "[no] debug unique-id UID backtrace",
+      NO_STR
+      DEBUG_STR
+      "Options per individual log message, by unique ID\n"
+      "Log message unique ID (XXXXX-XXXXX)\n"
+      "Add backtrace to log when message is printed\n")
+{
+	const char *uid;
+	char line[64];
+
+	if (!strcmp(argv[0]->text, "no")) {
+		uid = argv[3]->arg;
+		snprintfrr(line, sizeof(line),
+			   "no debug unique-id %s backtrace", uid);
+	} else {
+		uid = argv[2]->arg;
+		snprintfrr(line, sizeof(line), "debug unique-id %s backtrace",
+			   uid);
+	}
+	return vtysh_debug_uid(vty, uid, line);
+}
+
+DEFPY(vtysh_debug_uid_sample,
+      vtysh_debug_uid_sample_cmd,
+      "[no] debug unique-id UID sample [(2-1000000)$every]",
+      NO_STR
+      DEBUG_STR
+      "Options per individual log message, by unique ID\n"
+      "Log message unique ID (XXXXX-XXXXX)\n"
+      "Only log some of the occurrences of this message\n"
+      "Log one in this many\n")
+{
+	char line[64];
+
+	if (no)
+		snprintfrr(line, sizeof(line), "no debug unique-id %s sample",
+			   uid);
+	else if (every)
+		snprintfrr(line, sizeof(line),
+			   "debug unique-id %s sample %ld", uid, every);
+	else {
+		vty_out(vty, "%% sampling rate required\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+	return vtysh_debug_uid(vty, uid, line);
+}
+
 DEFUNSH(VTYSH_ALL, vtysh_allow_reserved_ranges, vtysh_allow_reserved_ranges_cmd,
 	"allow-reserved-ranges",
 	"Allow using IPv4 (Class E) reserved IP space\n")
@@ -3392,6 +3685,8 @@ DEFUN (vtysh_write_terminal,
        DAEMONS_STR
        "Skip \"Building configuration...\" header\n")
 {
+	struct vtysh_client *heads[array_size(vtysh_client)];
+	size_t nheads = 0;
 	unsigned int i;
 	char line[] = "do write terminal";
 
@@ -3406,7 +3701,8 @@ DEFUN (vtysh_write_terminal,
 	for (i = 0; i < array_size(vtysh_client); i++)
 		if ((argc < 3)
 		    || (strmatch(vtysh_client[i].name, argv[2]->text)))
-			vtysh_client_config(&vtysh_client[i], line);
+			heads[nheads++] = &vtysh_client[i];
+	vtysh_client_config(heads, nheads, line);
 
 	/* Integrate vtysh specific configuration. */
 	vty_open_pager(vty);
@@ -3471,6 +3767,7 @@ static void backup_config_file(const char *fbackup)
 
 int vtysh_write_config_integrated(void)
 {
+	struct vtysh_client *heads[array_size(vtysh_client)];
 	unsigned int i;
 	char line[] = "do write terminal";
 	FILE *fp;
@@ -3499,7 +3796,8 @@ int vtysh_write_config_integrated(void)
 	fd = fileno(fp);
 
 	for (i = 0; i < array_size(vtysh_client); i++)
-		vtysh_client_config(&vtysh_client[i], line);
+		heads[i] = &vtysh_client[i];
+	vtysh_client_config(heads, array_size(vtysh_client), line);
 
 	vtysh_config_write();
 	vty->of_saved = vty->of;
@@ -3596,6 +3894,7 @@ DEFUN (vtysh_write_memory,
        "Write configuration to the file (same as write file)\n"
        "Write configuration to the file (same as write memory)\n")
 {
+	struct vtysh_client *heads[array_size(vtysh_client)];
 	int ret = CMD_SUCCESS;
 	char line[] = "do write memory";
 	unsigned int i;
@@ -3632,7 +3931,9 @@ DEFUN (vtysh_write_memory,
 	vty_out(vty, "Building Configuration...\n");
 
 	for (i = 0; i < array_size(vtysh_client); i++)
-		ret = vtysh_client_execute(&vtysh_client[i], line);
+		heads[i] = &vtysh_client[i];
+	ret = vtysh_client_run_parallel(heads, array_size(vtysh_client), line,
+					0, NULL, NULL, NULL);
 
 	return ret;
 }
@@ -5116,6 +5417,7 @@ void vtysh_init_vty(void)
 	install_element(CONFIG_NODE, &vtysh_debug_memstats_cmd);
 	install_element(ENABLE_NODE, &vtysh_debug_uid_backtrace_cmd);
 	install_element(CONFIG_NODE, &vtysh_debug_uid_backtrace_cmd);
+	install_element(CONFIG_NODE, &vtysh_debug_uid_sample_cmd);
 
 	/* northbound */
 	install_element(ENABLE_NODE, &show_config_running_cmd);
@@ -5128,6 +5430,7 @@ void vtysh_init_vty(void)
 	/* misc lib show commands */
 	install_element(VIEW_NODE, &vtysh_show_history_cmd);
 	install_element(VIEW_NODE, &vtysh_show_memory_cmd);
+	install_element(VIEW_NODE, &vtysh_show_memory_per_thread_cmd);
 	install_element(VIEW_NODE, &vtysh_show_modules_cmd);
 	install_element(VIEW_NODE, &vtysh_show_work_queues_cmd);
 	install_element(VIEW_NODE, &vtysh_show_work_queues_daemon_cmd);
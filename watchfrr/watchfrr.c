@@ -55,6 +55,8 @@
 #define DEFAULT_MIN_RESTART	60
 #define DEFAULT_MAX_RESTART	600
 #define DEFAULT_OPERATIONAL_TIMEOUT 60
+/* echo answered later than this means the daemon's event loop is starved */
+#define SLOW_ECHO_SEC		1
 
 #define DEFAULT_RESTART_CMD	WATCHFRR_SH_PATH " restart %s"
 #define DEFAULT_START_CMD	WATCHFRR_SH_PATH " start %s"
@@ -160,6 +162,14 @@ struct daemon {
 	enum daemon_state state;
 	int fd;
 	struct timeval echo_sent;
+	/* echo response times, as seen from here */
+	unsigned long echo_replies;
+	unsigned long echo_slow;
+	struct timeval echo_max;
+	/* smoothed response time and variation (msec), see echo_timeout() */
+	long echo_srtt;
+	long echo_rttvar;
+	long echo_timeout;
 	unsigned int connect_tries;
 	struct thread *t_wakeup;
 	struct thread *t_read;
@@ -620,6 +630,35 @@ static void daemon_down(struct daemon *dmn, const char *why)
 	phase_check();
 }
 
+/*
+ * A daemon that is busy (e.g. bgpd walking a large table) answers echoes late
+ * without being hung.  Extend the unresponsiveness timeout by what its recent
+ * response times suggest, the same way TCP sizes its RTO, but never to more
+ * than twice -t so a daemon that really is stuck still gets restarted.
+ */
+static void echo_rtt_update(struct daemon *dmn, const struct timeval *delay)
+{
+	long rtt = delay->tv_sec * 1000 + delay->tv_usec / 1000;
+
+	if (dmn->echo_replies == 1) {
+		dmn->echo_srtt = rtt;
+		dmn->echo_rttvar = rtt / 2;
+		return;
+	}
+	dmn->echo_rttvar = (3 * dmn->echo_rttvar + labs(dmn->echo_srtt - rtt))
+			   / 4;
+	dmn->echo_srtt = (7 * dmn->echo_srtt + rtt) / 8;
+}
+
+static long echo_timeout(struct daemon *dmn)
+{
+	long grace = 0;
+
+	if (dmn->echo_replies)
+		grace = dmn->echo_srtt + 4 * dmn->echo_rttvar;
+	return gs.timeout * 1000 + MIN(grace, gs.timeout * 1000);
+}
+
 static void handle_read(struct thread *t_read)
 {
 	struct daemon *dmn = THREAD_ARG(t_read);
@@ -669,8 +708,16 @@ static void handle_read(struct thread *t_read)
 
 	time_elapsed(&delay, &dmn->echo_sent);
 	dmn->echo_sent.tv_sec = 0;
+	dmn->echo_replies++;
+	echo_rtt_update(dmn, &delay);
+	if (timercmp(&delay, &dmn->echo_max, >))
+		dmn->echo_max = delay;
+	if (delay.tv_sec >= SLOW_ECHO_SEC)
+		dmn->echo_slow++;
+
 	if (dmn->state == DAEMON_UNRESPONSIVE) {
-		if (delay.tv_sec < gs.timeout) {
+		if (delay.tv_sec * 1000 + delay.tv_usec / 1000
+		    < dmn->echo_timeout) {
 			dmn->state = DAEMON_UP;
 			zlog_warn(
 				"%s state -> up : echo response received after %ld.%06ld seconds",
@@ -681,7 +728,11 @@ static void handle_read(struct thread *t_read)
 				"%s: slow echo response finally received after %ld.%06ld seconds",
 				dmn->name, (long)delay.tv_sec,
 				(long)delay.tv_usec);
-	} else if (gs.loglevel > LOG_DEBUG + 1)
+	} else if (delay.tv_sec >= SLOW_ECHO_SEC)
+		zlog_warn(
+			"%s: slow echo response received after %ld.%06ld seconds, event loop starved?",
+			dmn->name, (long)delay.tv_sec, (long)delay.tv_usec);
+	else if (gs.loglevel > LOG_DEBUG + 1)
 		zlog_debug("%s: echo response received after %ld.%06ld seconds",
 			   dmn->name, (long)delay.tv_sec, (long)delay.tv_usec);
 
@@ -1010,8 +1061,9 @@ static void wakeup_no_answer(struct thread *t_wakeup)
 	if (dmn->ignore_timeout)
 		return;
 	flog_err(EC_WATCHFRR_CONNECTION,
-		 "%s state -> unresponsive : no response yet to ping sent %ld seconds ago",
-		 dmn->name, gs.timeout);
+		 "%s state -> unresponsive : no response yet to ping sent %ld.%03ld seconds ago",
+		 dmn->name, dmn->echo_timeout / 1000,
+		 dmn->echo_timeout % 1000);
 	SET_WAKEUP_UNRESPONSIVE(dmn);
 	try_restart(dmn);
 }
@@ -1032,8 +1084,9 @@ static void wakeup_send_echo(struct thread *t_wakeup)
 		daemon_down(dmn, why);
 	} else {
 		gettimeofday(&dmn->echo_sent, NULL);
-		thread_add_timer(master, wakeup_no_answer, dmn, gs.timeout,
-				 &dmn->t_wakeup);
+		dmn->echo_timeout = echo_timeout(dmn);
+		thread_add_timer_msec(master, wakeup_no_answer, dmn,
+				      dmn->echo_timeout, &dmn->t_wakeup);
 	}
 }
 
@@ -1076,6 +1129,13 @@ void watchfrr_status(struct vty *vty)
 				(intmax_t)dmn->restart.interval
 					- (intmax_t)delay.tv_sec,
 				(intmax_t)dmn->restart.interval);
+		if (dmn->echo_replies)
+			vty_out(vty,
+				"      echo: %lu replies, %lu slow (>=%ds), max %ld.%06lds, avg %ldms, timeout %ldms\n",
+				dmn->echo_replies, dmn->echo_slow,
+				SLOW_ECHO_SEC, (long)dmn->echo_max.tv_sec,
+				(long)dmn->echo_max.tv_usec, dmn->echo_srtt,
+				echo_timeout(dmn));
 	}
 }
 
@@ -44,21 +44,27 @@ DEFINE_MTYPE_STATIC(ZEBRA, DPDK_PORTS, "ZD DPDK port database");
 
 void zd_dpdk_stat_show(struct vty *vty)
 {
-	uint32_t tmp_cnt;
+	uint32_t rule_adds, rule_dels, ignored, batches, batch_max;
+	uint32_t seq;
+
+	/* the dplane pthread updates these while we read them */
+	do {
+		seq = counters_read_begin(&dpdk_stat->seq);
+		rule_adds = counter_get(dpdk_stat->rule_adds);
+		rule_dels = counter_get(dpdk_stat->rule_dels);
+		ignored = counter_get(dpdk_stat->ignored_updates);
+		batches = counter_get(dpdk_stat->batches);
+		batch_max = counter_get(dpdk_stat->batch_max);
+	} while (counters_read_retry(&dpdk_stat->seq, seq));
 
 	vty_out(vty, "%30s\n%30s\n", "Dataplane DPDK counters",
 		"=======================");
 
-#define ZD_DPDK_SHOW_COUNTER(label, counter)                                   \
-	do {                                                                   \
-		tmp_cnt =                                                      \
-			atomic_load_explicit(&counter, memory_order_relaxed);  \
-		vty_out(vty, "%28s: %u\n", (label), (tmp_cnt));                \
-	} while (0)
-
-	ZD_DPDK_SHOW_COUNTER("PBR rule adds", dpdk_stat->rule_adds);
-	ZD_DPDK_SHOW_COUNTER("PBR rule dels", dpdk_stat->rule_dels);
-	ZD_DPDK_SHOW_COUNTER("Ignored updates", dpdk_stat->ignored_updates);
+	vty_out(vty, "%28s: %u\n", "PBR rule adds", rule_adds);
+	vty_out(vty, "%28s: %u\n", "PBR rule dels", rule_dels);
+	vty_out(vty, "%28s: %u\n", "Ignored updates", ignored);
+	vty_out(vty, "%28s: %u\n", "Batches", batches);
+	vty_out(vty, "%28s: %u\n", "Largest batch", batch_max);
 }
 
 
@@ -351,15 +357,13 @@ static void zd_dpdk_rule_update(struct zebra_dplane_ctx *ctx)
 	op = dplane_ctx_get_op(ctx);
 	switch (op) {
 	case DPLANE_OP_RULE_ADD:
-		atomic_fetch_add_explicit(&dpdk_stat->rule_adds, 1,
-					  memory_order_relaxed);
+		counter_add(dpdk_stat->rule_adds, 1);
 		zd_dpdk_rule_add(ctx);
 		break;
 
 	case DPLANE_OP_RULE_UPDATE:
 		/* delete old rule and install new one */
-		atomic_fetch_add_explicit(&dpdk_stat->rule_adds, 1,
-					  memory_order_relaxed);
+		counter_add(dpdk_stat->rule_adds, 1);
 		in_ifindex = dplane_ctx_get_ifindex(ctx);
 		dp_flow_ptr = dplane_ctx_rule_get_old_dp_flow_ptr(ctx);
 		zd_dpdk_rule_del(ctx, dplane_ctx_rule_get_ifname(ctx),
@@ -368,8 +372,7 @@ static void zd_dpdk_rule_update(struct zebra_dplane_ctx *ctx)
 		break;
 
 	case DPLANE_OP_RULE_DELETE:
-		atomic_fetch_add_explicit(&dpdk_stat->rule_dels, 1,
-					  memory_order_relaxed);
+		counter_add(dpdk_stat->rule_dels, 1);
 		in_ifindex = dplane_ctx_get_ifindex(ctx);
 		dp_flow_ptr = dplane_ctx_rule_get_dp_flow_ptr(ctx);
 		zd_dpdk_rule_del(ctx, dplane_ctx_rule_get_ifname(ctx),
@@ -478,33 +481,46 @@ static void zd_dpdk_process_update(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_INTF_INSTALL:
 	case DPLANE_OP_INTF_UPDATE:
 	case DPLANE_OP_INTF_DELETE:
-		atomic_fetch_add_explicit(&dpdk_stat->ignored_updates, 1,
-					  memory_order_relaxed);
+		counter_add(dpdk_stat->ignored_updates, 1);
 
 		break;
 	}
 }
 
 
+/*
+ * Take a whole batch off the provider's queue and hand it back in one go,
+ * so the provider lock is taken twice per batch rather than per context.
+ */
 static int zd_dpdk_process(struct zebra_dplane_provider *prov)
 {
+	struct dplane_ctx_q work, done;
 	struct zebra_dplane_ctx *ctx;
-	int counter, limit;
+	int count;
 
 	if (IS_ZEBRA_DEBUG_DPLANE_DPDK_DETAIL)
 		zlog_debug("processing %s", dplane_provider_get_name(prov));
 
-	limit = dplane_provider_get_work_limit(prov);
-	for (counter = 0; counter < limit; counter++) {
-		ctx = dplane_provider_dequeue_in_ctx(prov);
-		if (!ctx)
-			break;
+	TAILQ_INIT(&work);
+	TAILQ_INIT(&done);
 
+	count = dplane_provider_dequeue_in_list(prov, &work);
+	if (count == 0)
+		return 0;
+
+	counters_write_begin(&dpdk_stat->seq);
+
+	while ((ctx = dplane_ctx_dequeue(&work))) {
 		zd_dpdk_process_update(ctx);
 		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
-		dplane_provider_enqueue_out_ctx(prov, ctx);
+		dplane_ctx_enqueue_tail(&done, ctx);
 	}
 
+	counter_add(dpdk_stat->batches, 1);
+	counter_max(dpdk_stat->batch_max, (uint32_t)count);
+	counters_write_end(&dpdk_stat->seq);
+
+	dplane_provider_enqueue_out_list(prov, &done);
 	return 0;
 }
 
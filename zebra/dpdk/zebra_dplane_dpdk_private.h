@@ -26,6 +26,7 @@
 
 #include <rte_ethdev.h>
 
+#include "lib/counters.h"
 #include "zebra_dplane_dpdk.h"
 
 /* match on eth, sip, dip, udp */
@@ -44,11 +45,17 @@ struct zd_dpdk_port {
 #define ZD_DPDK_PORT_FLAG_INITED (1 << 1)
 };
 
+/* only the dplane pthread writes these, see lib/counters.h */
 struct zd_dpdk_stat {
+	struct counters_seq seq;
+
 	_Atomic uint32_t ignored_updates;
 
 	_Atomic uint32_t rule_adds;
 	_Atomic uint32_t rule_dels;
+
+	_Atomic uint32_t batches;
+	_Atomic uint32_t batch_max;
 };
 
 struct zd_dpdk_ctx {
@@ -27,6 +27,11 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#ifdef HAVE_MEMFD_CREATE
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#endif /* HAVE_MEMFD_CREATE */
 
 #include <errno.h>
 #include <string.h>
@@ -51,6 +56,7 @@
 #include "zebra/kernel_netlink.h"
 #include "zebra/rt_netlink.h"
 #include "zebra/debug.h"
+#include "fpm/fpm_shm.h"
 
 #define SOUTHBOUND_DEFAULT_ADDR INADDR_LOOPBACK
 #define SOUTHBOUND_DEFAULT_PORT 2620
@@ -68,6 +74,17 @@
  */
 #define FPM_HEADER_SIZE 4
 
+/*
+ * Snapshot replay pacing: walks stop once the output buffer is filled past
+ * FPM_REPLAY_OBUF_HIGH (in 1/8ths of its size), leaving the rest for live
+ * updates, and resume FPM_REPLAY_WAIT_MS later from where they stopped.
+ */
+#define FPM_REPLAY_OBUF_HIGH 4
+#define FPM_REPLAY_WAIT_MS 10
+
+/* Shared memory ring data size, in MiB. */
+#define FPM_SHM_DEFAULT_SIZE 16
+
 static const char *prov_name = "dplane_fpm_nl";
 
 struct fpm_nl_ctx {
@@ -78,6 +95,30 @@ struct fpm_nl_ctx {
 	bool use_nhg;
 	struct sockaddr_storage addr;
 
+	/*
+	 * Shared memory transport, used when 'addr' is a unix socket (see
+	 * fpm/fpm_shm.h.)  Set up once connected, torn down on reconnect.
+	 */
+	uint32_t shm_size;
+	struct fpm_shm_ring *ring;
+	size_t ring_map_size;
+	int ring_data_fd;
+	int ring_space_fd;
+
+	/* Snapshot replay: objects per second, 0 for no limit. */
+	uint32_t replay_rate;
+	struct timeval replay_start;
+
+	/*
+	 * RIB walk position: the table being walked and the destination
+	 * prefix to continue with.  Only used by the zebra main pthread.
+	 */
+	struct {
+		bool valid;
+		rib_tables_iter_t iter;
+		struct prefix p;
+	} rib_cursor;
+
 	/* data plane buffers. */
 	struct stream *ibuf;
 	struct stream *obuf;
@@ -99,6 +140,7 @@ struct fpm_nl_ctx {
 	struct thread *t_write;
 	struct thread *t_event;
 	struct thread *t_dequeue;
+	struct thread *t_ring_space;
 
 	/* zebra events. */
 	struct thread *t_lspreset;
@@ -140,6 +182,13 @@ struct fpm_nl_ctx {
 
 		/* Amount of buffer full events. */
 		_Atomic uint32_t buffer_full;
+
+		/* Amount of bytes queued by the current/last snapshot. */
+		_Atomic uint32_t replay_bytes;
+		/* Duration of the last complete snapshot, in milliseconds. */
+		_Atomic uint32_t replay_msec;
+		/* Amount of complete snapshots. */
+		_Atomic uint32_t replays;
 	} counters;
 } *gfnc;
 
@@ -192,6 +241,8 @@ static void fpm_rmac_reset(struct thread *t);
  */
 #define FPM_STR "Forwarding Plane Manager configuration\n"
 
+#include "zebra/dplane_fpm_nl_clippy.c"
+
 DEFUN(fpm_set_address, fpm_set_address_cmd,
       "fpm address <A.B.C.D|X:X::X:X> [port (1-65535)]",
       FPM_STR
@@ -246,6 +297,40 @@ ask_reconnect:
 	return CMD_SUCCESS;
 }
 
+DEFPY(fpm_set_shm, fpm_set_shm_cmd,
+      "fpm address shm PATH$path [ring-size (1-1024)$size]",
+      FPM_STR
+      "FPM remote listening server address\n"
+      "Shared memory transport\n"
+      "FPM unix socket to hand the shared memory to\n"
+      "Shared memory ring size\n"
+      "Size in MiB (rounded up to a power of 2)\n")
+{
+#ifdef HAVE_MEMFD_CREATE
+	struct sockaddr_un *sun = (struct sockaddr_un *)&gfnc->addr;
+
+	if (strlen(path) >= sizeof(sun->sun_path)) {
+		vty_out(vty, "%% Socket path too long: %s\n", path);
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	memset(sun, 0, sizeof(*sun));
+	sun->sun_family = AF_UNIX;
+	strlcpy(sun->sun_path, path, sizeof(sun->sun_path));
+#ifdef HAVE_STRUCT_SOCKADDR_UN_SUN_LEN
+	sun->sun_len = SUN_LEN(sun);
+#endif /* HAVE_STRUCT_SOCKADDR_UN_SUN_LEN */
+	gfnc->shm_size = size ? size : FPM_SHM_DEFAULT_SIZE;
+
+	thread_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+			 FNE_RECONNECT, &gfnc->t_event);
+	return CMD_SUCCESS;
+#else
+	vty_out(vty, "%% Shared memory transport not supported on this system\n");
+	return CMD_WARNING_CONFIG_FAILED;
+#endif /* HAVE_MEMFD_CREATE */
+}
+
 DEFUN(no_fpm_set_address, no_fpm_set_address_cmd,
       "no fpm address [<A.B.C.D|X:X::X:X> [port <1-65535>]]",
       NO_STR
@@ -292,6 +377,17 @@ DEFUN(no_fpm_use_nhg, no_fpm_use_nhg_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFPY(fpm_replay_rate, fpm_replay_rate_cmd,
+      "[no] fpm replay-rate ![(1-10000000)$rate]",
+      NO_STR
+      FPM_STR
+      "Limit the pace of the table snapshot sent on connection\n"
+      "Objects per second\n")
+{
+	gfnc->replay_rate = no ? 0 : rate;
+	return CMD_SUCCESS;
+}
+
 DEFUN(fpm_reset_counters, fpm_reset_counters_cmd,
       "clear fpm counters",
       CLEAR_STR
@@ -329,6 +425,9 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
 	SHOW_COUNTER("Buffer full hits", gfnc->counters.buffer_full);
 	SHOW_COUNTER("User FPM configurations", gfnc->counters.user_configures);
 	SHOW_COUNTER("User FPM disable requests", gfnc->counters.user_disables);
+	SHOW_COUNTER("Snapshot replays", gfnc->counters.replays);
+	SHOW_COUNTER("Snapshot bytes queued", gfnc->counters.replay_bytes);
+	SHOW_COUNTER("Snapshot replay time (ms)", gfnc->counters.replay_msec);
 
 #undef SHOW_COUNTER
 
@@ -363,6 +462,9 @@ DEFUN(fpm_show_counters_json, fpm_show_counters_json_cmd,
 	json_object_int_add(jo, "user-configures",
 			    gfnc->counters.user_configures);
 	json_object_int_add(jo, "user-disables", gfnc->counters.user_disables);
+	json_object_int_add(jo, "replays", gfnc->counters.replays);
+	json_object_int_add(jo, "replay-bytes", gfnc->counters.replay_bytes);
+	json_object_int_add(jo, "replay-msec", gfnc->counters.replay_msec);
 	vty_json(vty, jo);
 
 	return CMD_SUCCESS;
@@ -396,6 +498,15 @@ static int fpm_write_config(struct vty *vty)
 
 		vty_out(vty, "\n");
 		break;
+	case AF_UNIX:
+		written = 1;
+		vty_out(vty, "fpm address shm %s",
+			((struct sockaddr_un *)&gfnc->addr)->sun_path);
+		if (gfnc->shm_size != FPM_SHM_DEFAULT_SIZE)
+			vty_out(vty, " ring-size %u", gfnc->shm_size);
+
+		vty_out(vty, "\n");
+		break;
 
 	default:
 		break;
@@ -406,6 +517,11 @@ static int fpm_write_config(struct vty *vty)
 		written = 1;
 	}
 
+	if (gfnc->replay_rate) {
+		vty_out(vty, "fpm replay-rate %u\n", gfnc->replay_rate);
+		written = 1;
+	}
+
 	return written;
 }
 
@@ -420,6 +536,217 @@ static struct cmd_node fpm_node = {
  * FPM functions.
  */
 static void fpm_connect(struct thread *t);
+static void fpm_write(struct thread *t);
+
+/*
+ * Shared memory transport.
+ */
+#ifdef HAVE_MEMFD_CREATE
+static void fpm_ring_free(struct fpm_nl_ctx *fnc)
+{
+	THREAD_OFF(fnc->t_ring_space);
+
+	if (fnc->ring) {
+		munmap(fnc->ring, fnc->ring_map_size);
+		fnc->ring = NULL;
+	}
+	if (fnc->ring_data_fd != -1) {
+		close(fnc->ring_data_fd);
+		fnc->ring_data_fd = -1;
+	}
+	if (fnc->ring_space_fd != -1) {
+		close(fnc->ring_space_fd);
+		fnc->ring_space_fd = -1;
+	}
+}
+
+/* Creates the ring and hands it to the FPM connected on 'sock'. */
+static int fpm_ring_new(struct fpm_nl_ctx *fnc, int sock)
+{
+	struct fpm_shm_hello hello = {};
+	struct iovec iov = {
+		.iov_base = &hello,
+		.iov_len = sizeof(hello),
+	};
+	union {
+		uint8_t buf[CMSG_SPACE(FPM_SHM_NFDS * sizeof(int))];
+		struct cmsghdr align;
+	} u;
+	struct msghdr mh = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = u.buf,
+		.msg_controllen = sizeof(u.buf),
+	};
+	struct cmsghdr *cmh;
+	int fds[FPM_SHM_NFDS];
+	uint64_t size = 1ULL << 20;
+	int memfd;
+	ssize_t rv;
+
+	while (size < (uint64_t)fnc->shm_size << 20)
+		size <<= 1;
+	fnc->ring_map_size = sizeof(*fnc->ring) + size;
+
+	memfd = memfd_create("frr-fpm", MFD_CLOEXEC);
+	if (memfd == -1) {
+		zlog_err("%s: memfd_create failed: %s", __func__,
+			 safe_strerror(errno));
+		return -1;
+	}
+	if (ftruncate(memfd, fnc->ring_map_size) == -1) {
+		zlog_err("%s: ftruncate failed: %s", __func__,
+			 safe_strerror(errno));
+		goto fail;
+	}
+
+	fnc->ring = mmap(NULL, fnc->ring_map_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, memfd, 0);
+	if (fnc->ring == MAP_FAILED) {
+		zlog_err("%s: mmap failed: %s", __func__,
+			 safe_strerror(errno));
+		fnc->ring = NULL;
+		goto fail;
+	}
+	fnc->ring->magic = FPM_SHM_MAGIC;
+	fnc->ring->version = FPM_SHM_VERSION;
+	fnc->ring->size = size;
+
+	fnc->ring_data_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	fnc->ring_space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fnc->ring_data_fd == -1 || fnc->ring_space_fd == -1) {
+		zlog_err("%s: eventfd failed: %s", __func__,
+			 safe_strerror(errno));
+		goto fail;
+	}
+
+	hello.magic = FPM_SHM_MAGIC;
+	hello.version = FPM_SHM_VERSION;
+	hello.map_size = fnc->ring_map_size;
+
+	fds[0] = memfd;
+	fds[1] = fnc->ring_data_fd;
+	fds[2] = fnc->ring_space_fd;
+
+	memset(&u.buf, 0, sizeof(u.buf));
+	cmh = CMSG_FIRSTHDR(&mh);
+	cmh->cmsg_level = SOL_SOCKET;
+	cmh->cmsg_type = SCM_RIGHTS;
+	cmh->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmh), fds, sizeof(fds));
+
+	/* Fresh socket, this fits in the socket buffer. */
+	rv = sendmsg(sock, &mh, 0);
+	if (rv != (ssize_t)sizeof(hello)) {
+		zlog_warn("%s: sending the ring failed: %s", __func__,
+			  rv == -1 ? safe_strerror(errno) : "short write");
+		goto fail;
+	}
+
+	/* The mapping and the FPM's copy keep the memory around. */
+	close(memfd);
+	return 0;
+
+fail:
+	close(memfd);
+	fpm_ring_free(fnc);
+	return -1;
+}
+
+static void fpm_ring_space(struct thread *t)
+{
+	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
+	uint64_t count;
+
+	/* Just clear the doorbell, fpm_write() looks at the ring itself. */
+	if (read(fnc->ring_space_fd, &count, sizeof(count)) == -1
+	    && !ERRNO_IO_RETRY(errno))
+		zlog_warn("%s: eventfd read failed: %s", __func__,
+			  safe_strerror(errno));
+
+	thread_add_write(fnc->fthread->master, fpm_write, fnc, fnc->socket,
+			 &fnc->t_write);
+}
+
+/*
+ * Moves as much of the output buffer as fits to the ring.  Needs
+ * obuf_mutex.
+ */
+static void fpm_ring_write(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_shm_ring *ring = fnc->ring;
+	_Atomic uint64_t *headp = (_Atomic uint64_t *)&ring->head;
+	_Atomic uint64_t *tailp = (_Atomic uint64_t *)&ring->tail;
+	_Atomic uint32_t *cwaitp = (_Atomic uint32_t *)&ring->consumer_wait;
+	_Atomic uint32_t *pwaitp = (_Atomic uint32_t *)&ring->producer_wait;
+	uint64_t head, tail, mask = ring->size - 1;
+	static const uint64_t one = 1;
+	size_t len, offset, chunk;
+
+	head = atomic_load_explicit(headp, memory_order_relaxed);
+
+	while (STREAM_READABLE(fnc->obuf)) {
+		tail = atomic_load_explicit(tailp, memory_order_acquire);
+		len = MIN(STREAM_READABLE(fnc->obuf),
+			  ring->size - (head - tail));
+
+		if (len == 0) {
+			/* Full: ask for a doorbell, unless it just drained */
+			atomic_store_explicit(pwaitp, 1, memory_order_seq_cst);
+			if (atomic_load_explicit(tailp, memory_order_seq_cst)
+			    != tail) {
+				atomic_store_explicit(pwaitp, 0,
+						      memory_order_relaxed);
+				continue;
+			}
+
+			thread_add_read(fnc->fthread->master, fpm_ring_space,
+					fnc, fnc->ring_space_fd,
+					&fnc->t_ring_space);
+			break;
+		}
+
+		offset = head & mask;
+		chunk = MIN(len, ring->size - offset);
+		memcpy(&ring->data[offset], stream_pnt(fnc->obuf), chunk);
+		memcpy(&ring->data[0], stream_pnt(fnc->obuf) + chunk,
+		       len - chunk);
+
+		head += len;
+		atomic_store_explicit(headp, head, memory_order_seq_cst);
+
+		atomic_fetch_add_explicit(&fnc->counters.bytes_sent, len,
+					  memory_order_relaxed);
+		atomic_fetch_sub_explicit(&fnc->counters.obuf_bytes, len,
+					  memory_order_relaxed);
+		stream_forward_getp(fnc->obuf, len);
+	}
+
+	if (atomic_exchange_explicit(cwaitp, 0, memory_order_seq_cst)
+	    && write(fnc->ring_data_fd, &one, sizeof(one)) == -1
+	    && !ERRNO_IO_RETRY(errno))
+		zlog_warn("%s: eventfd write failed: %s", __func__,
+			  safe_strerror(errno));
+
+	if (STREAM_READABLE(fnc->obuf))
+		stream_pulldown(fnc->obuf);
+	else
+		stream_reset(fnc->obuf);
+}
+#else
+static void fpm_ring_free(struct fpm_nl_ctx *fnc)
+{
+}
+
+static int fpm_ring_new(struct fpm_nl_ctx *fnc, int sock)
+{
+	return -1;
+}
+
+static void fpm_ring_write(struct fpm_nl_ctx *fnc)
+{
+}
+#endif /* HAVE_MEMFD_CREATE */
 
 static void fpm_reconnect(struct fpm_nl_ctx *fnc)
 {
@@ -444,6 +771,7 @@ static void fpm_reconnect(struct fpm_nl_ctx *fnc)
 		close(fnc->socket);
 		fnc->socket = -1;
 	}
+	fpm_ring_free(fnc);
 
 	stream_reset(fnc->ibuf);
 	stream_reset(fnc->obuf);
@@ -547,6 +875,12 @@ static void fpm_write(struct thread *t)
 
 	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
 
+	/* Shared memory transport. */
+	if (fnc->ring) {
+		fpm_ring_write(fnc);
+		return;
+	}
+
 	while (true) {
 		/* Stream is empty: reset pointers and return. */
 		if (STREAM_READABLE(fnc->obuf) == 0) {
@@ -610,6 +944,7 @@ static void fpm_connect(struct thread *t)
 	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
 	struct sockaddr_in *sin = (struct sockaddr_in *)&fnc->addr;
 	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&fnc->addr;
+	struct sockaddr_un *sun = (struct sockaddr_un *)&fnc->addr;
 	socklen_t slen;
 	int rv, sock;
 	char addrstr[INET6_ADDRSTRLEN];
@@ -625,7 +960,12 @@ static void fpm_connect(struct thread *t)
 
 	set_nonblocking(sock);
 
-	if (fnc->addr.ss_family == AF_INET) {
+	if (fnc->addr.ss_family == AF_UNIX) {
+		slen = sizeof(*sun);
+		if (IS_ZEBRA_DEBUG_FPM)
+			zlog_debug("%s: attempting to connect to %s", __func__,
+				   sun->sun_path);
+	} else if (fnc->addr.ss_family == AF_INET) {
 		inet_ntop(AF_INET, &sin->sin_addr, addrstr, sizeof(addrstr));
 		slen = sizeof(*sin);
 	} else {
@@ -633,7 +973,7 @@ static void fpm_connect(struct thread *t)
 		slen = sizeof(*sin6);
 	}
 
-	if (IS_ZEBRA_DEBUG_FPM)
+	if (IS_ZEBRA_DEBUG_FPM && fnc->addr.ss_family != AF_UNIX)
 		zlog_debug("%s: attempting to connect to %s:%d", __func__,
 			   addrstr, ntohs(sin->sin_port));
 
@@ -649,6 +989,16 @@ static void fpm_connect(struct thread *t)
 		return;
 	}
 
+	/* Unix sockets connect right away, hand over the ring now. */
+	if (fnc->addr.ss_family == AF_UNIX && fpm_ring_new(fnc, sock) == -1) {
+		atomic_fetch_add_explicit(&fnc->counters.connection_errors, 1,
+					  memory_order_relaxed);
+		close(sock);
+		thread_add_timer(fnc->fthread->master, fpm_connect, fnc, 3,
+				 &fnc->t_connect);
+		return;
+	}
+
 	fnc->connecting = (errno == EINPROGRESS);
 	fnc->socket = sock;
 	if (!fnc->connecting)
@@ -674,7 +1024,8 @@ static void fpm_connect(struct thread *t)
  *
  * @param fnc the netlink FPM context.
  * @param ctx the data plane operation context data.
- * @return 0 on success or -1 on not enough space.
+ * @return amount of bytes enqueued (0 if nothing to send) or -1 on not
+ * enough space.
  */
 static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 {
@@ -682,6 +1033,7 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	size_t nl_buf_len;
 	ssize_t rv;
 	uint64_t obytes, obytes_peak;
+	bool was_empty;
 	enum dplane_op_e op = dplane_ctx_get_op(ctx);
 
 	/*
@@ -845,6 +1197,8 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 		return -1;
 	}
 
+	was_empty = STREAM_READABLE(fnc->obuf) == 0;
+
 	/*
 	 * Fill in the FPM header information.
 	 *
@@ -869,11 +1223,56 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 		atomic_store_explicit(&fnc->counters.obuf_peak, obytes,
 				      memory_order_relaxed);
 
-	/* Tell the thread to start writing. */
-	thread_add_write(fnc->fthread->master, fpm_write, fnc, fnc->socket,
-			 &fnc->t_write);
+	/*
+	 * Tell the thread to start writing.  If there already was data
+	 * waiting, fpm_write() is either scheduled or waiting for the socket
+	 * or the ring to have room again, and reschedules itself.
+	 */
+	if (was_empty)
+		thread_add_write(fnc->fthread->master, fpm_write, fnc,
+				 fnc->socket, &fnc->t_write);
 
-	return 0;
+	return nl_buf_len + FPM_HEADER_SIZE;
+}
+
+/*
+ * Snapshot replay helpers, used by the walks below.
+ *
+ * fpm_replay_budget() returns how many objects a walk may send now and
+ * how long to wait before the next run, according to the configured rate.
+ */
+static uint32_t fpm_replay_budget(const struct fpm_nl_ctx *fnc, long *wait)
+{
+	*wait = FPM_REPLAY_WAIT_MS;
+
+	if (fnc->replay_rate == 0)
+		return UINT32_MAX;
+
+	if (fnc->replay_rate >= 1000 / FPM_REPLAY_WAIT_MS)
+		return fnc->replay_rate / (1000 / FPM_REPLAY_WAIT_MS);
+
+	*wait = 1000 / fnc->replay_rate;
+	return 1;
+}
+
+/* Whether the output buffer is too full to queue more snapshot data. */
+static bool fpm_replay_obuf_full(struct fpm_nl_ctx *fnc)
+{
+	uint32_t obytes = atomic_load_explicit(&fnc->counters.obuf_bytes,
+					       memory_order_relaxed);
+
+	return obytes >= STREAM_SIZE(fnc->obuf) / 8 * FPM_REPLAY_OBUF_HIGH;
+}
+
+static int fpm_replay_enqueue(struct fpm_nl_ctx *fnc,
+			      struct zebra_dplane_ctx *ctx)
+{
+	int rv = fpm_nl_enqueue(fnc, ctx);
+
+	if (rv > 0)
+		atomic_fetch_add_explicit(&fnc->counters.replay_bytes, rv,
+					  memory_order_relaxed);
+	return rv;
 }
 
 /*
@@ -897,7 +1296,7 @@ static int fpm_lsp_send_cb(struct hash_bucket *bucket, void *arg)
 	dplane_ctx_reset(fla->ctx);
 	dplane_ctx_lsp_init(fla->ctx, DPLANE_OP_LSP_INSTALL, lsp);
 
-	if (fpm_nl_enqueue(fla->fnc, fla->ctx) == -1) {
+	if (fpm_replay_enqueue(fla->fnc, fla->ctx) == -1) {
 		fla->complete = false;
 		return HASHWALK_ABORT;
 	}
@@ -940,6 +1339,7 @@ static void fpm_lsp_send(struct thread *t)
 struct fpm_nhg_arg {
 	struct zebra_dplane_ctx *ctx;
 	struct fpm_nl_ctx *fnc;
+	uint32_t budget;
 	bool complete;
 };
 
@@ -952,10 +1352,16 @@ static int fpm_nhg_send_cb(struct hash_bucket *bucket, void *arg)
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_FPM))
 		return HASHWALK_CONTINUE;
 
+	/* Sent enough for now, continue on the next run. */
+	if (fna->budget == 0 || fpm_replay_obuf_full(fna->fnc)) {
+		fna->complete = false;
+		return HASHWALK_ABORT;
+	}
+
 	/* Reset ctx to reuse allocated memory, take a snapshot and send it. */
 	dplane_ctx_reset(fna->ctx);
 	dplane_ctx_nexthop_init(fna->ctx, DPLANE_OP_NH_INSTALL, nhe);
-	if (fpm_nl_enqueue(fna->fnc, fna->ctx) == -1) {
+	if (fpm_replay_enqueue(fna->fnc, fna->ctx) == -1) {
 		/* Our buffers are full, lets give it some cycles. */
 		fna->complete = false;
 		return HASHWALK_ABORT;
@@ -963,6 +1369,7 @@ static int fpm_nhg_send_cb(struct hash_bucket *bucket, void *arg)
 
 	/* Mark group as sent, so it doesn't get sent again. */
 	SET_FLAG(nhe->flags, NEXTHOP_GROUP_FPM);
+	fna->budget--;
 
 	return HASHWALK_CONTINUE;
 }
@@ -971,9 +1378,11 @@ static void fpm_nhg_send(struct thread *t)
 {
 	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
 	struct fpm_nhg_arg fna;
+	long wait;
 
 	fna.fnc = fnc;
 	fna.ctx = dplane_ctx_alloc();
+	fna.budget = fpm_replay_budget(fnc, &wait);
 	fna.complete = true;
 
 	/* Send next hops. */
@@ -989,12 +1398,74 @@ static void fpm_nhg_send(struct thread *t)
 		thread_add_timer(zrouter.master, fpm_rib_reset, fnc, 0,
 				 &fnc->t_ribreset);
 	} else /* Otherwise reschedule next hop group again. */
-		thread_add_timer(zrouter.master, fpm_nhg_send, fnc, 0,
-				 &fnc->t_nhgwalk);
+		thread_add_timer_msec(zrouter.master, fpm_nhg_send, fnc, wait,
+				      &fnc->t_nhgwalk);
+}
+
+/*
+ * Remember where the RIB walk stopped: the table and the destination
+ * prefix of 'rn', which hasn't been sent yet.  Nothing is kept locked, the
+ * walk is looked up again by prefix when it continues.
+ */
+static void fpm_rib_cursor_save(struct fpm_nl_ctx *fnc,
+				const rib_tables_iter_t *iter,
+				struct route_node *rn)
+{
+	const struct prefix *p, *src_p;
+
+	srcdest_rnode_prefixes(rn, &p, &src_p);
+
+	fnc->rib_cursor.valid = true;
+	fnc->rib_cursor.iter = *iter;
+	prefix_copy(&fnc->rib_cursor.p, p);
+
+	route_unlock_node(rn);
+}
+
+/*
+ * Continue a RIB walk: returns the table it stopped in and sets '*rnp' to
+ * the node to continue with.  If that table is gone, the walk continues
+ * at the top of the next one.
+ */
+static struct route_table *fpm_rib_cursor_restore(struct fpm_nl_ctx *fnc,
+						  rib_tables_iter_t *iter,
+						  struct route_node **rnp)
+{
+	struct route_table *rt;
+
+	*rnp = NULL;
+
+	if (!fnc->rib_cursor.valid) {
+		iter->state = RIB_TABLES_ITER_S_INIT;
+		return rib_tables_iter_next(iter);
+	}
+
+	fnc->rib_cursor.valid = false;
+
+	/* Look the same table up again */
+	*iter = fnc->rib_cursor.iter;
+	iter->afi_safi_ix--;
+	rt = rib_tables_iter_next(iter);
+	if (rt == NULL || iter->vrf_id != fnc->rib_cursor.iter.vrf_id
+	    || iter->afi_safi_ix != fnc->rib_cursor.iter.afi_safi_ix)
+		return rt;
+
+	*rnp = srcdest_rnode_lookup(rt, &fnc->rib_cursor.p, NULL);
+	if (*rnp == NULL)
+		*rnp = route_table_get_next(rt, &fnc->rib_cursor.p);
+
+	/* Past the end of the table */
+	if (*rnp == NULL)
+		rt = rib_tables_iter_next(iter);
+
+	return rt;
 }
 
 /**
  * Send all RIB installed routes to the connected data plane.
+ *
+ * Only as much as the configured rate and the output buffer allow is sent
+ * at once; the walk then continues on a later run from where it stopped.
  */
 static void fpm_rib_send(struct thread *t)
 {
@@ -1004,13 +1475,18 @@ static void fpm_rib_send(struct thread *t)
 	struct route_table *rt;
 	struct zebra_dplane_ctx *ctx;
 	rib_tables_iter_t rt_iter;
+	uint32_t budget;
+	long wait;
+
+	budget = fpm_replay_budget(fnc, &wait);
 
 	/* Allocate temporary context for all transactions. */
 	ctx = dplane_ctx_alloc();
 
-	rt_iter.state = RIB_TABLES_ITER_S_INIT;
-	while ((rt = rib_tables_iter_next(&rt_iter))) {
-		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
+	for (rt = fpm_rib_cursor_restore(fnc, &rt_iter, &rn); rt;
+	     rt = rib_tables_iter_next(&rt_iter), rn = NULL) {
+		for (rn = rn ? rn : route_top(rt); rn;
+		     rn = srcdest_route_next(rn)) {
 			dest = rib_dest_from_rnode(rn);
 			/* Skip bad route entries. */
 			if (dest == NULL || dest->selected_fib == NULL)
@@ -1020,21 +1496,20 @@ static void fpm_rib_send(struct thread *t)
 			if (CHECK_FLAG(dest->flags, RIB_DEST_UPDATE_FPM))
 				continue;
 
+			/* Sent enough for now, continue on the next run. */
+			if (budget == 0 || fpm_replay_obuf_full(fnc))
+				goto resched;
+
 			/* Enqueue route install. */
 			dplane_ctx_reset(ctx);
 			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
 					      dest->selected_fib);
-			if (fpm_nl_enqueue(fnc, ctx) == -1) {
-				/* Free the temporary allocated context. */
-				dplane_ctx_fini(&ctx);
-
-				thread_add_timer(zrouter.master, fpm_rib_send,
-						 fnc, 1, &fnc->t_ribwalk);
-				return;
-			}
+			if (fpm_replay_enqueue(fnc, ctx) == -1)
+				goto resched;
 
 			/* Mark as sent. */
 			SET_FLAG(dest->flags, RIB_DEST_UPDATE_FPM);
+			budget--;
 		}
 	}
 
@@ -1047,6 +1522,16 @@ static void fpm_rib_send(struct thread *t)
 	/* Schedule next event: RMAC reset. */
 	thread_add_event(zrouter.master, fpm_rmac_reset, fnc, 0,
 			 &fnc->t_rmacreset);
+	return;
+
+resched:
+	fpm_rib_cursor_save(fnc, &rt_iter, rn);
+
+	/* Free the temporary allocated context. */
+	dplane_ctx_fini(&ctx);
+
+	thread_add_timer_msec(zrouter.master, fpm_rib_send, fnc, wait,
+			      &fnc->t_ribwalk);
 }
 
 /*
@@ -1084,7 +1569,7 @@ static void fpm_enqueue_rmac_table(struct hash_bucket *bucket, void *arg)
 			zif->brslave_info.br_if, vid,
 			&zrmac->macaddr, zrmac->fwd_info.r_vtep_ip, sticky,
 			0 /*nhg*/, 0 /*update_flags*/);
-	if (fpm_nl_enqueue(fra->fnc, fra->ctx) == -1) {
+	if (fpm_replay_enqueue(fra->fnc, fra->ctx) == -1) {
 		thread_add_timer(zrouter.master, fpm_rmac_send,
 				 fra->fnc, 1, &fra->fnc->t_rmacwalk);
 		fra->complete = false;
@@ -1151,6 +1636,11 @@ static void fpm_lsp_reset(struct thread *t)
 	struct fpm_nl_ctx *fnc = THREAD_ARG(t);
 	struct zebra_vrf *zvrf = vrf_info_lookup(VRF_DEFAULT);
 
+	/* This is the first step of a snapshot replay. */
+	monotime(&fnc->replay_start);
+	atomic_store_explicit(&fnc->counters.replay_bytes, 0,
+			      memory_order_relaxed);
+
 	hash_iterate(zvrf->lsp_table, fpm_lsp_reset_cb, NULL);
 
 	/* Schedule next step: send LSPs */
@@ -1168,6 +1658,9 @@ static void fpm_rib_reset(struct thread *t)
 	struct route_table *rt;
 	rib_tables_iter_t rt_iter;
 
+	/* Start the walk over at the beginning. */
+	fnc->rib_cursor.valid = false;
+
 	rt_iter.state = RIB_TABLES_ITER_S_INIT;
 	while ((rt = rib_tables_iter_next(&rt_iter))) {
 		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
@@ -1324,6 +1817,14 @@ static void fpm_process_event(struct thread *t)
 	case FNE_RMAC_FINISHED:
 		if (IS_ZEBRA_DEBUG_FPM)
 			zlog_debug("%s: RMAC walk finished", __func__);
+
+		/* That was the last step of the snapshot. */
+		atomic_store_explicit(&fnc->counters.replay_msec,
+				      monotime_since(&fnc->replay_start, NULL)
+					      / 1000,
+				      memory_order_relaxed);
+		atomic_fetch_add_explicit(&fnc->counters.replays, 1,
+					  memory_order_relaxed);
 		break;
 	case FNE_LSP_FINISHED:
 		if (IS_ZEBRA_DEBUG_FPM)
@@ -1351,6 +1852,8 @@ static int fpm_nl_start(struct zebra_dplane_provider *prov)
 	fnc->obuf = stream_new(NL_PKT_BUF_SIZE * 128);
 	pthread_mutex_init(&fnc->obuf_mutex, NULL);
 	fnc->socket = -1;
+	fnc->ring_data_fd = -1;
+	fnc->ring_space_fd = -1;
 	fnc->disabled = true;
 	fnc->prov = prov;
 	TAILQ_INIT(&fnc->ctxqueue);
@@ -1376,6 +1879,7 @@ static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 	thread_cancel_async(fnc->fthread->master, &fnc->t_read, NULL);
 	thread_cancel_async(fnc->fthread->master, &fnc->t_write, NULL);
 	thread_cancel_async(fnc->fthread->master, &fnc->t_connect, NULL);
+	thread_cancel_async(fnc->fthread->master, &fnc->t_ring_space, NULL);
 
 	if (fnc->socket != -1) {
 		close(fnc->socket);
@@ -1390,6 +1894,8 @@ static int fpm_nl_finish_late(struct fpm_nl_ctx *fnc)
 	/* Stop the running thread. */
 	frr_pthread_stop(fnc->fthread, NULL);
 
+	fpm_ring_free(fnc);
+
 	/* Free all allocated resources. */
 	pthread_mutex_destroy(&fnc->obuf_mutex);
 	pthread_mutex_destroy(&fnc->ctxqueue_mutex);
@@ -1493,9 +1999,11 @@ static int fpm_nl_new(struct thread_master *tm)
 	install_element(ENABLE_NODE, &fpm_show_counters_json_cmd);
 	install_element(ENABLE_NODE, &fpm_reset_counters_cmd);
 	install_element(CONFIG_NODE, &fpm_set_address_cmd);
+	install_element(CONFIG_NODE, &fpm_set_shm_cmd);
 	install_element(CONFIG_NODE, &no_fpm_set_address_cmd);
 	install_element(CONFIG_NODE, &fpm_use_nhg_cmd);
 	install_element(CONFIG_NODE, &no_fpm_use_nhg_cmd);
+	install_element(CONFIG_NODE, &fpm_replay_rate_cmd);
 
 	return 0;
 }
@@ -47,6 +47,7 @@
 #include "zebra/zebra_ptm.h"
 #include "zebra/rt_netlink.h"
 #include "zebra/if_netlink.h"
+#include "zebra/kernel_netlink.h"
 #include "zebra/interface.h"
 #include "zebra/zebra_vxlan.h"
 #include "zebra/zebra_errors.h"
@@ -61,6 +62,12 @@ DEFINE_HOOK(zebra_if_extra_info, (struct vty * vty, struct interface *ifp),
 DEFINE_HOOK(zebra_if_config_wr, (struct vty * vty, struct interface *ifp),
 	    (vty, ifp));
 
+/* interfaces with oper state changes to apply, see if_oper_up() */
+DECLARE_DLIST(if_oper_pending, struct zebra_if, oper_item);
+
+static struct if_oper_pending_head if_oper_pending =
+	INIT_DLIST(if_oper_pending);
+static struct thread *t_if_oper_pending;
 
 static void if_down_del_nbr_connected(struct interface *ifp);
 
@@ -237,6 +244,9 @@ static int if_zebra_delete_hook(struct interface *ifp)
 
 		THREAD_OFF(zebra_if->speed_update);
 
+		if (CHECK_FLAG(zebra_if->oper_pending, IF_OPER_PENDING))
+			if_oper_pending_del(&if_oper_pending, zebra_if);
+
 		XFREE(MTYPE_ZINFO, zebra_if);
 	}
 
@@ -583,6 +593,10 @@ void if_add_update(struct interface *ifp)
 	if_data = ifp->info;
 	assert(if_data);
 
+#ifdef HAVE_NETLINK
+	netlink_ignore_interface_update(ifp);
+#endif
+
 	if (if_data->multicast == IF_ZEBRA_DATA_ON)
 		if_set_flags(ifp, IFF_MULTICAST);
 	else if (if_data->multicast == IF_ZEBRA_DATA_OFF)
@@ -757,6 +771,8 @@ void if_delete_update(struct interface **pifp)
 	struct zebra_if *zif;
 	struct interface *ifp = *pifp;
 
+	if_oper_flush(ifp);
+
 	if (if_is_up(ifp)) {
 		flog_err(
 			EC_LIB_INTERFACE,
@@ -785,6 +801,10 @@ void if_delete_update(struct interface **pifp)
 
 	if_unlink_per_ns(ifp);
 
+#ifdef HAVE_NETLINK
+	netlink_ignore_interface_update(ifp);
+#endif
+
 	/* Update ifindex after distributing the delete message.  This is in
 	   case any client needs to have the old value of ifindex available
 	   while processing the deletion.  Each client daemon is responsible
@@ -827,6 +847,8 @@ void if_handle_vrf_change(struct interface *ifp, vrf_id_t vrf_id)
 {
 	vrf_id_t old_vrf_id;
 
+	if_oper_flush(ifp);
+
 	old_vrf_id = ifp->vrf->vrf_id;
 
 	/* Uninstall connected routes. */
@@ -1106,6 +1128,106 @@ void if_down(struct interface *ifp)
 	if_down_del_nbr_connected(ifp);
 }
 
+/*
+ * A burst of link changes, e.g. all subinterfaces of a port flapping,
+ * is handled in one go once the window passes.  However often an
+ * interface flapped in between, it goes down and up at most once; down
+ * still has to be seen as the kernel flushed routes using it.
+ *
+ * L2 masters are left alone, their state changes are tied into the
+ * bridge and VxLAN updates done right after.
+ */
+static void if_oper_pending_run(struct thread *thread)
+{
+	if_oper_flush_all();
+}
+
+static bool if_oper_coalesce(struct interface *ifp)
+{
+	struct zebra_if *zif = ifp->info;
+
+	if (!zrouter.if_coalesce_time || IS_ZEBRA_IF_BRIDGE(ifp)
+	    || IS_ZEBRA_IF_VXLAN(ifp))
+		return false;
+
+	if (!CHECK_FLAG(zif->oper_pending, IF_OPER_PENDING)) {
+		zif->oper_pending = IF_OPER_PENDING;
+		if_oper_pending_add_tail(&if_oper_pending, zif);
+		thread_add_timer_msec(zrouter.master, if_oper_pending_run, NULL,
+				      zrouter.if_coalesce_time,
+				      &t_if_oper_pending);
+	}
+
+	return true;
+}
+
+void if_oper_up(struct interface *ifp, bool install_connected)
+{
+	struct zebra_if *zif = ifp->info;
+
+	if (!if_oper_coalesce(ifp)) {
+		if_up(ifp, install_connected);
+		return;
+	}
+
+	SET_FLAG(zif->oper_pending, IF_OPER_PENDING_UP);
+	if (install_connected)
+		SET_FLAG(zif->oper_pending, IF_OPER_PENDING_INSTALL);
+}
+
+void if_oper_down(struct interface *ifp)
+{
+	struct zebra_if *zif = ifp->info;
+
+	if (!if_oper_coalesce(ifp)) {
+		if_down(ifp);
+		rib_update(RIB_UPDATE_KERNEL);
+		return;
+	}
+
+	UNSET_FLAG(zif->oper_pending,
+		   IF_OPER_PENDING_UP | IF_OPER_PENDING_INSTALL);
+	SET_FLAG(zif->oper_pending, IF_OPER_PENDING_DOWN);
+}
+
+void if_oper_flush(struct interface *ifp)
+{
+	struct zebra_if *zif = ifp->info;
+	uint8_t pending;
+
+	if (!zif || !CHECK_FLAG(zif->oper_pending, IF_OPER_PENDING))
+		return;
+
+	pending = zif->oper_pending;
+	zif->oper_pending = 0;
+	if_oper_pending_del(&if_oper_pending, zif);
+
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug("Intf %s(%u) coalesced changes:%s%s", ifp->name,
+			   ifp->ifindex,
+			   CHECK_FLAG(pending, IF_OPER_PENDING_DOWN) ? " down"
+								     : "",
+			   CHECK_FLAG(pending, IF_OPER_PENDING_UP) ? " up" : "");
+
+	if (CHECK_FLAG(pending, IF_OPER_PENDING_DOWN)) {
+		if_down(ifp);
+		rib_update(RIB_UPDATE_KERNEL);
+	}
+	if (CHECK_FLAG(pending, IF_OPER_PENDING_UP))
+		if_up(ifp, CHECK_FLAG(pending, IF_OPER_PENDING_DOWN)
+				   || CHECK_FLAG(pending,
+						 IF_OPER_PENDING_INSTALL));
+}
+
+void if_oper_flush_all(void)
+{
+	struct zebra_if *zif;
+
+	THREAD_OFF(t_if_oper_pending);
+	while ((zif = if_oper_pending_first(&if_oper_pending)))
+		if_oper_flush(zif->ifp);
+}
+
 void if_refresh(struct interface *ifp)
 {
 #ifndef GNU_LINUX
@@ -36,6 +36,8 @@
 extern "C" {
 #endif
 
+PREDECL_DLIST(if_oper_pending);
+
 /* For interface configuration. */
 #define IF_ZEBRA_DATA_UNSPEC 0
 #define IF_ZEBRA_DATA_ON 1
@@ -212,6 +214,16 @@ struct zebra_if {
 	uint8_t speed_update_count;
 	struct thread *speed_update;
 
+	/* Oper state changes waiting out the coalescing window */
+	struct if_oper_pending_item oper_item;
+	uint8_t oper_pending;
+#define IF_OPER_PENDING (1 << 0)
+/* went down at least once */
+#define IF_OPER_PENDING_DOWN (1 << 1)
+/* and is up in the end */
+#define IF_OPER_PENDING_UP (1 << 2)
+#define IF_OPER_PENDING_INSTALL (1 << 3)
+
 	/*
 	 * Does this interface have a v6 to v4 ll neighbor entry
 	 * for bgp unnumbered?
@@ -285,6 +297,16 @@ extern void if_delete_update(struct interface **ifp);
 extern void if_add_update(struct interface *ifp);
 extern void if_up(struct interface *ifp, bool install_connected);
 extern void if_down(struct interface *);
+/*
+ * Same as if_up()/if_down(), for changes reported by the kernel.  With
+ * "zebra interface coalesce-time" these are applied after the window,
+ * once for all changes in between.
+ */
+extern void if_oper_up(struct interface *ifp, bool install_connected);
+extern void if_oper_down(struct interface *ifp);
+/* Apply the pending change now */
+extern void if_oper_flush(struct interface *ifp);
+extern void if_oper_flush_all(void);
 extern void if_refresh(struct interface *);
 extern void if_flags_update(struct interface *, uint64_t);
 extern int if_subnet_add(struct interface *, struct connected *);
@@ -51,11 +51,21 @@
 #include "zebra/tc_netlink.h"
 #include "zebra/netconf_netlink.h"
 #include "zebra/zebra_errors.h"
+#include "zebra/interface.h"
+#include "zebra/zebra_trace.h"
 
 #ifndef SO_RCVBUFFORCE
 #define SO_RCVBUFFORCE  (33)
 #endif
 
+#ifndef SO_SNDBUFFORCE
+#define SO_SNDBUFFORCE  (32)
+#endif
+
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
 /* Hack for GNU libc version 2. */
 #ifndef MSG_TRUNC
 #define MSG_TRUNC      0x20
@@ -82,6 +92,30 @@
 
 #define NL_DEFAULT_BATCH_BUFSIZE (16 * NL_PKT_BUF_SIZE)
 
+/*
+ * netlink_parse_info() reads up to this many datagrams with one recvmmsg(),
+ * each into a slot of NL_RCV_BATCH_SLOTLEN.  Only the first datagram's size
+ * is known beforehand, and whatever doesn't fit into a slot is lost for
+ * good, so the slots have to be large enough for any kernel message.  Kernel
+ * dumps fill datagrams of 32k unless one entry needs more, and messages are
+ * built from attributes of at most 64k each, so 1M is plenty.  Most of the
+ * slot memory is never touched and so never actually backed by pages.
+ */
+#define NL_RCV_BATCH 16
+#define NL_RCV_BATCH_SLOTLEN (1024 * 1024)
+
+struct nl_rcv_batch {
+	uint8_t *buf;
+
+	struct mmsghdr msgs[NL_RCV_BATCH];
+	struct iovec iov[NL_RCV_BATCH];
+	struct sockaddr_nl snl[NL_RCV_BATCH];
+
+	/* datagrams read, and the next one to hand out */
+	unsigned int count;
+	unsigned int next;
+};
+
 /*
  * We limit the batch's size to a number smaller than the length of the
  * underlying buffer since the last message that wouldn't fit the batch would go
@@ -92,6 +126,14 @@
  */
 #define NL_DEFAULT_BATCH_SEND_THRESHOLD (15 * NL_PKT_BUF_SIZE)
 
+/*
+ * In adaptive mode the batch buffer is sized for all contexts handed to
+ * kernel_update_multi(), based on the average message size seen so far,
+ * up to this limit.  The socket send buffer is raised to match.
+ */
+#define NL_BATCH_ADAPTIVE_MAX_BUFSIZE (4 * 1024 * 1024)
+#define NL_BATCH_ADAPTIVE_INIT_MSGLEN 256
+
 static const struct message nlmsg_str[] = {{RTM_NEWROUTE, "RTM_NEWROUTE"},
 					   {RTM_DELROUTE, "RTM_DELROUTE"},
 					   {RTM_GETROUTE, "RTM_GETROUTE"},
@@ -174,6 +216,7 @@ extern struct thread_master *master;
 extern struct zebra_privs_t zserv_privs;
 
 DEFINE_MTYPE_STATIC(ZEBRA, NL_BUF, "Zebra Netlink buffers");
+DEFINE_MTYPE_STATIC(ZEBRA, NL_SOCK, "Zebra Netlink sockets");
 
 /* Hashtable and mutex to allow lookup of nlsock structs by socket/fd value.
  * We have both the main and dplane pthreads using these structs, so we have
@@ -186,22 +229,65 @@ pthread_mutex_t nlsock_mutex;
 #define NLSOCK_LOCK() pthread_mutex_lock(&nlsock_mutex)
 #define NLSOCK_UNLOCK() pthread_mutex_unlock(&nlsock_mutex)
 
-size_t nl_batch_tx_bufsize;
-char *nl_batch_tx_buf;
+/* batch state is per pthread, since each kernel provider instance runs
+ * its own batches
+ */
+static thread_local size_t nl_batch_tx_bufsize;
+static thread_local char *nl_batch_tx_buf;
 
 _Atomic uint32_t nl_batch_bufsize = NL_DEFAULT_BATCH_BUFSIZE;
 _Atomic uint32_t nl_batch_send_threshold = NL_DEFAULT_BATCH_SEND_THRESHOLD;
+_Atomic bool nl_batch_adaptive;
+
+/*
+ * Kernel routes and neighbors zebra is configured to ignore.  They are
+ * dropped by the socket filter, so zebra isn't even woken up for them.
+ * Only used by the main pthread.
+ */
+#define NL_FILTER_MAX_ENTRIES 32
+
+static struct {
+	uint32_t tables[NL_FILTER_MAX_ENTRIES];
+	unsigned int ntables;
+	uint8_t protos[NL_FILTER_MAX_ENTRIES];
+	unsigned int nprotos;
+	char ifnames[NL_FILTER_MAX_ENTRIES][INTERFACE_NAMSIZ];
+	unsigned int nifnames;
+} nl_ignore;
+
+/* average encoded message length */
+static thread_local size_t nl_batch_msglen = NL_BATCH_ADAPTIVE_INIT_MSGLEN;
+
+/*
+ * Index of the sequence numbers in a batch, so that responses can be
+ * matched to their context with a binary search.  Entries are normally
+ * added in ascending order; if not, the index is sorted before use.
+ */
+struct nl_batch_seq {
+	uint32_t seq;
+	bool ignore_res;
+	struct zebra_dplane_ctx *ctx;
+};
+
+static thread_local struct nl_batch_seq *nl_batch_seqs;
+static thread_local size_t nl_batch_seqsize;
 
 struct nl_batch {
 	void *buf;
 	size_t bufsiz;
 	size_t limit;
+	bool adaptive;
 
 	void *buf_head;
 	size_t curlen;
 	size_t msgcnt;
 
 	const struct zebra_dplane_info *zns;
+	struct nlsock *nl;
+
+	struct nl_batch_seq *seqs;
+	size_t seqcnt;
+	bool seqs_sorted;
 
 	struct dplane_ctx_q ctx_list;
 
@@ -218,12 +304,27 @@ int netlink_config_write_helper(struct vty *vty)
 		atomic_load_explicit(&nl_batch_bufsize, memory_order_relaxed);
 	uint32_t threshold = atomic_load_explicit(&nl_batch_send_threshold,
 						  memory_order_relaxed);
+	unsigned int i;
 
 	if (size != NL_DEFAULT_BATCH_BUFSIZE
 	    || threshold != NL_DEFAULT_BATCH_SEND_THRESHOLD)
 		vty_out(vty, "zebra kernel netlink batch-tx-buf %u %u\n", size,
 			threshold);
 
+	if (atomic_load_explicit(&nl_batch_adaptive, memory_order_relaxed))
+		vty_out(vty, "zebra kernel netlink batch-tx-buf adaptive\n");
+
+	for (i = 0; i < nl_ignore.ntables; i++)
+		vty_out(vty, "zebra kernel netlink ignore route table %u\n",
+			nl_ignore.tables[i]);
+	for (i = 0; i < nl_ignore.nprotos; i++)
+		vty_out(vty, "zebra kernel netlink ignore route protocol %u\n",
+			nl_ignore.protos[i]);
+	for (i = 0; i < nl_ignore.nifnames; i++)
+		vty_out(vty,
+			"zebra kernel netlink ignore neighbor interface %s\n",
+			nl_ignore.ifnames[i]);
+
 	if (if_netlink_frr_protodown_r_bit_is_set())
 		vty_out(vty, "zebra protodown reason-bit %u\n",
 			if_netlink_get_frr_protodown_r_bit());
@@ -243,6 +344,16 @@ void netlink_set_batch_buffer_size(uint32_t size, uint32_t threshold, bool set)
 			      memory_order_relaxed);
 }
 
+void netlink_set_batch_adaptive(bool set)
+{
+	atomic_store_explicit(&nl_batch_adaptive, set, memory_order_relaxed);
+}
+
+bool netlink_batch_is_adaptive(void)
+{
+	return atomic_load_explicit(&nl_batch_adaptive, memory_order_relaxed);
+}
+
 int netlink_talk_filter(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 {
 	/*
@@ -301,6 +412,48 @@ static int netlink_recvbuf(struct nlsock *nl, uint32_t newsize)
 	return 0;
 }
 
+/*
+ * Make sure a single sendmsg() of 'size' bytes fits the socket's send
+ * buffer.  Returns the largest message size the socket will take.
+ */
+static size_t netlink_sndbuf(struct nlsock *nl, size_t size)
+{
+	uint32_t newsize = size;
+	uint32_t cursize;
+	socklen_t len = sizeof(cursize);
+	int ret;
+
+	if (nl->sndbufsize >= size)
+		return nl->sndbufsize;
+
+	frr_with_privs(&zserv_privs) {
+		ret = setsockopt(nl->sock, SOL_SOCKET, SO_SNDBUFFORCE, &newsize,
+				 sizeof(newsize));
+	}
+	if (ret < 0)
+		ret = setsockopt(nl->sock, SOL_SOCKET, SO_SNDBUF, &newsize,
+				 sizeof(newsize));
+	if (ret < 0)
+		flog_err_sys(EC_LIB_SOCKET,
+			     "Can't set %s send buffer size to %u: %s",
+			     nl->name, newsize, safe_strerror(errno));
+
+	/* Linux doubles the value for bookkeeping overhead */
+	ret = getsockopt(nl->sock, SOL_SOCKET, SO_SNDBUF, &cursize, &len);
+	if (ret < 0) {
+		flog_err_sys(EC_LIB_SOCKET, "Can't get %s send buffer size: %s",
+			     nl->name, safe_strerror(errno));
+		return NL_DEFAULT_BATCH_BUFSIZE;
+	}
+
+	nl->sndbufsize = MIN(cursize / 2, MAX(size, NL_PKT_BUF_SIZE));
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug("%s: %s send buffer %u, batches up to %zu bytes",
+			   __func__, nl->name, cursize, nl->sndbufsize);
+
+	return nl->sndbufsize;
+}
+
 static const char *group2str(uint32_t group)
 {
 	switch (group) {
@@ -573,6 +726,107 @@ int kernel_dplane_read(struct zebra_dplane_info *info)
 	return 0;
 }
 
+/* pids of zebra's own sockets filtered from inbound sockets */
+#define NL_FILTER_MAX_PIDS (2 + DPLANE_MAX_PROVIDER_INSTANCES)
+
+/*
+ * The filter program is emitted with symbolic jump targets, which are
+ * resolved to offsets at the end.
+ */
+enum nl_filter_label {
+	NLF_NEXT = -1,
+	NLF_TYPES,
+	NLF_CONTENT,
+	NLF_ROUTE,
+	NLF_ROUTE_BYTE,
+	NLF_ROUTE_PROTO,
+	NLF_NEIGH,
+	NLF_NEIGH_IF,
+	NLF_KEEP,
+	NLF_DROP,
+	NLF_LABELS,
+};
+
+#define NL_FILTER_MAX_INSNS                                                    \
+	(1 + NL_FILTER_MAX_PIDS + 32 + 3 * NL_FILTER_MAX_ENTRIES)
+
+struct nl_filter {
+	struct sock_filter insn[NL_FILTER_MAX_INSNS];
+	unsigned int n;
+
+	unsigned int label[NLF_LABELS];
+	int8_t jt[NL_FILTER_MAX_INSNS], jf[NL_FILTER_MAX_INSNS];
+};
+
+static void nlf_stmt(struct nl_filter *f, uint16_t code, uint32_t k)
+{
+	assert(f->n < NL_FILTER_MAX_INSNS);
+	f->insn[f->n] = (struct sock_filter)BPF_STMT(code, k);
+	f->jt[f->n] = f->jf[f->n] = NLF_NEXT;
+	f->n++;
+}
+
+static void nlf_jump(struct nl_filter *f, uint16_t op, uint32_t k, int jt,
+		     int jf)
+{
+	assert(f->n < NL_FILTER_MAX_INSNS);
+	f->insn[f->n] = (struct sock_filter)BPF_JUMP(BPF_JMP | op | BPF_K, k,
+						     0, 0);
+	f->jt[f->n] = jt;
+	f->jf[f->n] = jf;
+	f->n++;
+}
+
+static void nlf_jeq(struct nl_filter *f, uint32_t k, int jt, int jf)
+{
+	nlf_jump(f, BPF_JEQ, k, jt, jf);
+}
+
+/* unconditional, the offset is in k */
+static void nlf_ja(struct nl_filter *f, int label)
+{
+	nlf_stmt(f, BPF_JMP | BPF_JA, 0);
+	f->jt[f->n - 1] = label;
+}
+
+static void nlf_label(struct nl_filter *f, int label)
+{
+	f->label[label] = f->n;
+}
+
+/*
+ * BPF_JUMP instructions and where you jump to are based upon
+ * 0 as being the next statement, and only go forward.
+ */
+static unsigned int nlf_offset(const struct nl_filter *f, unsigned int i,
+			       int label)
+{
+	if (label == NLF_NEXT)
+		return 0;
+
+	assert(f->label[label] > i && f->label[label] - (i + 1) <= UINT8_MAX);
+	return f->label[label] - (i + 1);
+}
+
+static void nlf_resolve(struct nl_filter *f)
+{
+	unsigned int i;
+
+	for (i = 0; i < f->n; i++) {
+		struct sock_filter *insn = &f->insn[i];
+
+		if (BPF_CLASS(insn->code) != BPF_JMP)
+			continue;
+
+		if (BPF_OP(insn->code) == BPF_JA) {
+			insn->k = nlf_offset(f, i, f->jt[i]);
+			continue;
+		}
+		insn->jt = nlf_offset(f, i, f->jt[i]);
+		insn->jf = nlf_offset(f, i, f->jf[i]);
+	}
+}
+
 /*
  * Filter out messages from self that occur on listener socket,
  * caused by our actions on the command socket(s)
@@ -585,79 +839,131 @@ int kernel_dplane_read(struct zebra_dplane_info *info)
  * ( I'm looking at you Interface based netlink messages )
  * so that we only have to write one way to handle incoming
  * address add/delete and xxxNETCONF changes.
+ *
+ * Routes in ignored tables or from ignored protocols and neighbors on
+ * ignored interfaces are filtered out as well.
  */
-static void netlink_install_filter(int sock, uint32_t pid, uint32_t dplane_pid)
+static void netlink_install_filter(int sock, const uint32_t *pids,
+				   unsigned int npids,
+				   const ifindex_t *ifindexes,
+				   unsigned int nifindexes)
 {
+	struct nl_filter f = {};
+	struct sock_fprog prog = {.filter = f.insn};
+	const unsigned int rta =
+		NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct rtmsg));
+	unsigned int i;
+
+	assert(npids && npids <= NL_FILTER_MAX_PIDS);
+
 	/*
-	 * BPF_JUMP instructions and where you jump to are based upon
-	 * 0 as being the next statement.  So count from 0.  Writing
-	 * this down because every time I look at this I have to
-	 * re-remember it.
+	 * Logic:
+	 *   if (nlmsg_pid == pids[0] || ... || nlmsg_pid == pids[npids - 1]) {
+	 *       if (the incoming nlmsg_type ==
+	 *           RTM_NEWADDR || RTM_DELADDR || RTM_NEWNETCONF ||
+	 *           RTM_DELNETCONF)
+	 *           keep this message
+	 *       else
+	 *           skip this message
+	 *   } else if (route in an ignored table or of an ignored protocol)
+	 *       skip this message
+	 *   else if (neighbor on an ignored interface)
+	 *       skip this message
+	 *   else
+	 *       keep this netlink message
+	 *
+	 * Loads convert from network byte order, netlink is in host byte
+	 * order, hence the htonl()/htons() on the values compared to.
 	 */
-	struct sock_filter filter[] = {
-		/*
-		 * Logic:
-		 *   if (nlmsg_pid == pid ||
-		 *       nlmsg_pid == dplane_pid) {
-		 *       if (the incoming nlmsg_type ==
-		 *           RTM_NEWADDR || RTM_DELADDR || RTM_NEWNETCONF ||
-		 *           RTM_DELNETCONF)
-		 *           keep this message
-		 *       else
-		 *           skip this message
-		 *   } else
-		 *       keep this netlink message
-		 */
-		/*
-		 * 0: Load the nlmsg_pid into the BPF register
-		 */
-		BPF_STMT(BPF_LD | BPF_ABS | BPF_W,
-			 offsetof(struct nlmsghdr, nlmsg_pid)),
-		/*
-		 * 1: Compare to pid
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(pid), 1, 0),
-		/*
-		 * 2: Compare to dplane pid
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(dplane_pid), 0, 6),
-		/*
-		 * 3: Load the nlmsg_type into BPF register
-		 */
-		BPF_STMT(BPF_LD | BPF_ABS | BPF_H,
-			 offsetof(struct nlmsghdr, nlmsg_type)),
-		/*
-		 * 4: Compare to RTM_NEWADDR
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWADDR), 4, 0),
-		/*
-		 * 5: Compare to RTM_DELADDR
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELADDR), 3, 0),
-		/*
-		 * 6: Compare to RTM_NEWNETCONF
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWNETCONF), 2,
-			 0),
-		/*
-		 * 7: Compare to RTM_DELNETCONF
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELNETCONF), 1,
-			 0),
+
+	/* Load the nlmsg_pid into the BPF register */
+	nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_W,
+		 offsetof(struct nlmsghdr, nlmsg_pid));
+	for (i = 0; i < npids; i++)
+		nlf_jeq(&f, htonl(pids[i]), NLF_TYPES,
+			i == npids - 1 ? NLF_CONTENT : NLF_NEXT);
+
+	nlf_label(&f, NLF_TYPES);
+	nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_H,
+		 offsetof(struct nlmsghdr, nlmsg_type));
+	nlf_jeq(&f, htons(RTM_NEWADDR), NLF_KEEP, NLF_NEXT);
+	nlf_jeq(&f, htons(RTM_DELADDR), NLF_KEEP, NLF_NEXT);
+	nlf_jeq(&f, htons(RTM_NEWNETCONF), NLF_KEEP, NLF_NEXT);
+	nlf_jeq(&f, htons(RTM_DELNETCONF), NLF_KEEP, NLF_DROP);
+
+	nlf_label(&f, NLF_CONTENT);
+	if (nl_ignore.ntables || nl_ignore.nprotos) {
+		nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_H,
+			 offsetof(struct nlmsghdr, nlmsg_type));
+		nlf_jeq(&f, htons(RTM_NEWROUTE), NLF_ROUTE, NLF_NEXT);
+		nlf_jeq(&f, htons(RTM_DELROUTE), NLF_ROUTE, NLF_NEIGH);
+		nlf_label(&f, NLF_ROUTE);
+
 		/*
-		 * 8: This is the end state of we want to skip the
-		 *    message
+		 * The kernel puts RTA_TABLE first, otherwise fall back to
+		 * rtm_table, which is RT_TABLE_COMPAT for IDs above 255.
+		 * Loads past the end of the message would drop it, so
+		 * check there is an attribute to look at.
 		 */
-		BPF_STMT(BPF_RET | BPF_K, 0),
-		/* 9: This is the end state of we want to keep
-		 *     the message
-		 */
-		BPF_STMT(BPF_RET | BPF_K, 0xffff),
-	};
+		if (nl_ignore.ntables) {
+			nlf_stmt(&f, BPF_LD | BPF_LEN, 0);
+			nlf_jump(&f, BPF_JGE, rta + RTA_LENGTH(sizeof(uint32_t)),
+				 NLF_NEXT, NLF_ROUTE_BYTE);
+			nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_H,
+				 rta + offsetof(struct rtattr, rta_type));
+			nlf_jeq(&f, htons(RTA_TABLE), NLF_NEXT, NLF_ROUTE_BYTE);
+			nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_W,
+				 rta + RTA_LENGTH(0));
+			for (i = 0; i < nl_ignore.ntables; i++)
+				nlf_jeq(&f, htonl(nl_ignore.tables[i]), NLF_DROP,
+					NLF_NEXT);
+			nlf_ja(&f, NLF_ROUTE_PROTO);
+
+			nlf_label(&f, NLF_ROUTE_BYTE);
+			nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_B,
+				 NLMSG_HDRLEN
+					 + offsetof(struct rtmsg, rtm_table));
+			for (i = 0; i < nl_ignore.ntables; i++)
+				if (nl_ignore.tables[i] < RT_TABLE_COMPAT)
+					nlf_jeq(&f, nl_ignore.tables[i],
+						NLF_DROP, NLF_NEXT);
+		}
+
+		nlf_label(&f, NLF_ROUTE_PROTO);
+		if (nl_ignore.nprotos) {
+			nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_B,
+				 NLMSG_HDRLEN
+					 + offsetof(struct rtmsg, rtm_protocol));
+			for (i = 0; i < nl_ignore.nprotos; i++)
+				nlf_jeq(&f, nl_ignore.protos[i], NLF_DROP,
+					NLF_NEXT);
+		}
+		nlf_ja(&f, NLF_KEEP);
+	}
 
-	struct sock_fprog prog = {
-		.len = array_size(filter), .filter = filter,
-	};
+	/* Neighbors, which includes bridge FDB entries */
+	nlf_label(&f, NLF_NEIGH);
+	if (nifindexes) {
+		nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_H,
+			 offsetof(struct nlmsghdr, nlmsg_type));
+		nlf_jeq(&f, htons(RTM_NEWNEIGH), NLF_NEIGH_IF, NLF_NEXT);
+		nlf_jeq(&f, htons(RTM_DELNEIGH), NLF_NEIGH_IF, NLF_KEEP);
+		nlf_label(&f, NLF_NEIGH_IF);
+		nlf_stmt(&f, BPF_LD | BPF_ABS | BPF_W,
+			 NLMSG_HDRLEN + offsetof(struct ndmsg, ndm_ifindex));
+		for (i = 0; i < nifindexes; i++)
+			nlf_jeq(&f, htonl(ifindexes[i]), NLF_DROP, NLF_NEXT);
+	}
+
+	/* This is the end state of we want to keep the message */
+	nlf_label(&f, NLF_KEEP);
+	nlf_stmt(&f, BPF_RET | BPF_K, 0xffff);
+	/* This is the end state of we want to skip the message */
+	nlf_label(&f, NLF_DROP);
+	nlf_stmt(&f, BPF_RET | BPF_K, 0);
+
+	nlf_resolve(&f);
+	prog.len = f.n;
 
 	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog))
 	    < 0)
@@ -665,6 +971,135 @@ static void netlink_install_filter(int sock, uint32_t pid, uint32_t dplane_pid)
 			     safe_strerror(errno));
 }
 
+/* Filters of the namespace's listener sockets, for the current config */
+static void netlink_install_filters(struct zebra_ns *zns)
+{
+	uint32_t pids[NL_FILTER_MAX_PIDS];
+	ifindex_t ifindexes[NL_FILTER_MAX_ENTRIES];
+	unsigned int i, npids = 0, nifindexes = 0;
+	struct interface *ifp;
+
+	pids[npids++] = zns->netlink_cmd.snl.nl_pid;
+	pids[npids++] = zns->netlink_dplane_out.snl.nl_pid;
+	for (i = 0; i < zns->netlink_dplane_out.ninstances; i++)
+		pids[npids++] = zns->netlink_dplane_out.instances[i].snl.nl_pid;
+
+	for (i = 0; i < nl_ignore.nifnames; i++) {
+		ifp = if_lookup_by_name_per_ns(zns, nl_ignore.ifnames[i]);
+		if (ifp && ifp->ifindex != IFINDEX_INTERNAL)
+			ifindexes[nifindexes++] = ifp->ifindex;
+	}
+
+	netlink_install_filter(zns->netlink.sock, pids, npids, ifindexes,
+			       nifindexes);
+	netlink_install_filter(zns->netlink_dplane_in.sock, pids, npids,
+			       ifindexes, nifindexes);
+}
+
+static int netlink_install_filters_ns(struct ns *ns, void *arg, void **result)
+{
+	struct zebra_ns *zns = ns->info;
+
+	if (zns && zns->netlink.sock >= 0)
+		netlink_install_filters(zns);
+
+	return NS_WALK_CONTINUE;
+}
+
+static void netlink_ignore_changed(void)
+{
+	ns_walk_func(netlink_install_filters_ns, NULL, NULL);
+}
+
+int netlink_ignore_table(uint32_t table, bool set)
+{
+	unsigned int i;
+
+	for (i = 0; i < nl_ignore.ntables; i++)
+		if (nl_ignore.tables[i] == table)
+			break;
+
+	if (set) {
+		if (i < nl_ignore.ntables)
+			return 0;
+		if (nl_ignore.ntables == NL_FILTER_MAX_ENTRIES)
+			return -1;
+		nl_ignore.tables[nl_ignore.ntables++] = table;
+	} else {
+		if (i == nl_ignore.ntables)
+			return 0;
+		nl_ignore.tables[i] = nl_ignore.tables[--nl_ignore.ntables];
+	}
+
+	netlink_ignore_changed();
+	return 0;
+}
+
+int netlink_ignore_protocol(uint8_t proto, bool set)
+{
+	unsigned int i;
+
+	for (i = 0; i < nl_ignore.nprotos; i++)
+		if (nl_ignore.protos[i] == proto)
+			break;
+
+	if (set) {
+		if (i < nl_ignore.nprotos)
+			return 0;
+		if (nl_ignore.nprotos == NL_FILTER_MAX_ENTRIES)
+			return -1;
+		nl_ignore.protos[nl_ignore.nprotos++] = proto;
+	} else {
+		if (i == nl_ignore.nprotos)
+			return 0;
+		nl_ignore.protos[i] = nl_ignore.protos[--nl_ignore.nprotos];
+	}
+
+	netlink_ignore_changed();
+	return 0;
+}
+
+static int netlink_ignore_ifname_idx(const char *ifname)
+{
+	unsigned int i;
+
+	for (i = 0; i < nl_ignore.nifnames; i++)
+		if (strmatch(nl_ignore.ifnames[i], ifname))
+			return i;
+
+	return -1;
+}
+
+int netlink_ignore_interface(const char *ifname, bool set)
+{
+	int i = netlink_ignore_ifname_idx(ifname);
+
+	if (set) {
+		if (i >= 0)
+			return 0;
+		if (nl_ignore.nifnames == NL_FILTER_MAX_ENTRIES)
+			return -1;
+		strlcpy(nl_ignore.ifnames[nl_ignore.nifnames++], ifname,
+			sizeof(nl_ignore.ifnames[0]));
+	} else {
+		if (i < 0)
+			return 0;
+		if ((unsigned int)i != --nl_ignore.nifnames)
+			memcpy(nl_ignore.ifnames[i],
+			       nl_ignore.ifnames[nl_ignore.nifnames],
+			       sizeof(nl_ignore.ifnames[0]));
+	}
+
+	netlink_ignore_changed();
+	return 0;
+}
+
+void netlink_ignore_interface_update(struct interface *ifp)
+{
+	if (netlink_ignore_ifname_idx(ifp->name) >= 0)
+		netlink_ignore_changed();
+}
+
 void netlink_parse_rtattr_flags(struct rtattr **tb, int max, struct rtattr *rta,
 				int len, unsigned short flags)
 {
@@ -992,6 +1427,16 @@ static ssize_t netlink_send_msg(const struct nlsock *nl, void *buf,
 	return status;
 }
 
+static void netlink_recv_dump(const uint8_t *buf, int len)
+{
+	zlog_debug("%s: << netlink message dump [recv]", __func__);
+#ifdef NETLINK_DEBUG
+	nl_dump((void *)buf, len);
+#else
+	zlog_hexdump(buf, len);
+#endif /* NETLINK_DEBUG */
+}
+
 /*
  * netlink_recv_msg - receive a netlink message.
  *
@@ -1046,18 +1491,127 @@ static int netlink_recv_msg(struct nlsock *nl, struct msghdr *msg)
 		return -1;
 	}
 
-	if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV) {
-		zlog_debug("%s: << netlink message dump [recv]", __func__);
-#ifdef NETLINK_DEBUG
-		nl_dump(nl->buf, status);
-#else
-		zlog_hexdump(nl->buf, status);
-#endif /* NETLINK_DEBUG */
-	}
+	if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV)
+		netlink_recv_dump(nl->buf, status);
 
 	return status;
 }
 
+/*
+ * netlink_recv_batch - receive up to max datagrams into nl's batch slots.
+ *
+ * Returns -1 on error, 0 if read would block, else the number of
+ * datagrams received.
+ */
+static int netlink_recv_batch(struct nlsock *nl, unsigned int max)
+{
+	struct nl_rcv_batch *rb = nl->rcv;
+	unsigned int i;
+	int n;
+
+	for (i = 0; i < max; i++) {
+		struct msghdr *msg = &rb->msgs[i].msg_hdr;
+
+		rb->iov[i].iov_base = rb->buf + i * NL_RCV_BATCH_SLOTLEN;
+		rb->iov[i].iov_len = NL_RCV_BATCH_SLOTLEN;
+
+		memset(msg, 0, sizeof(*msg));
+		msg->msg_name = &rb->snl[i];
+		msg->msg_namelen = sizeof(rb->snl[i]);
+		msg->msg_iov = &rb->iov[i];
+		msg->msg_iovlen = 1;
+	}
+
+	do {
+		n = recvmmsg(nl->sock, rb->msgs, max, MSG_WAITFORONE, NULL);
+	} while (n == -1 && errno == EINTR);
+
+	if (n == -1) {
+		if (errno == EWOULDBLOCK || errno == EAGAIN)
+			return 0;
+		flog_err(EC_ZEBRA_RECVMSG_OVERRUN, "%s recvmsg overrun: %s",
+			 nl->name, safe_strerror(errno));
+		/* Same as in netlink_recv_msg(), no way to recover */
+		exit(-1);
+	}
+
+	for (i = 0; i < (unsigned int)n; i++) {
+		struct msghdr *msg = &rb->msgs[i].msg_hdr;
+
+		if (rb->msgs[i].msg_len == 0) {
+			flog_err_sys(EC_LIB_SOCKET, "%s EOF", nl->name);
+			return -1;
+		}
+
+		if (msg->msg_namelen != sizeof(struct sockaddr_nl)) {
+			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+				 "%s sender address length error: length %d",
+				 nl->name, msg->msg_namelen);
+			return -1;
+		}
+
+		if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV)
+			netlink_recv_dump(rb->iov[i].iov_base,
+					  rb->msgs[i].msg_len);
+	}
+
+	rb->count = n;
+	rb->next = 0;
+	return n;
+}
+
+/*
+ * netlink_recv_next - next datagram for netlink_parse_info().
+ *
+ * Datagrams are read ahead in batches of up to max, the ones not handed
+ * out yet are kept for the next call on nl.  A datagram larger than the
+ * batch slots is read on its own into nl->buf instead.
+ *
+ * Returns -1 on error, 0 if read would block or the number of bytes at
+ * *buf, with the sender's pid and the message flags in *pid and *flags.
+ */
+static int netlink_recv_next(struct nlsock *nl, unsigned int max,
+			     uint8_t **buf, uint32_t *pid, int *flags)
+{
+	struct nl_rcv_batch *rb = nl->rcv;
+	int bytes, status;
+
+	if (!rb) {
+		rb = nl->rcv = XCALLOC(MTYPE_NL_BUF, sizeof(*rb));
+		rb->buf = XMALLOC(MTYPE_NL_BUF,
+				  NL_RCV_BATCH * NL_RCV_BATCH_SLOTLEN);
+	}
+
+	if (rb->next == rb->count) {
+		do {
+			bytes = recv(nl->sock, NULL, 0, MSG_PEEK | MSG_TRUNC);
+		} while (bytes == -1 && errno == EINTR);
+
+		if (bytes >= 0 && (size_t)bytes > NL_RCV_BATCH_SLOTLEN) {
+			struct sockaddr_nl snl;
+			struct msghdr msg = {.msg_name = (void *)&snl,
+					     .msg_namelen = sizeof(snl)};
+
+			status = netlink_recv_msg(nl, &msg);
+			if (status > 0) {
+				*buf = nl->buf;
+				*pid = snl.nl_pid;
+				*flags = msg.msg_flags;
+			}
+			return status;
+		}
+
+		status = netlink_recv_batch(nl, MIN(max, NL_RCV_BATCH));
+		if (status <= 0)
+			return status;
+	}
+
+	*buf = rb->iov[rb->next].iov_base;
+	*pid = rb->snl[rb->next].nl_pid;
+	*flags = rb->msgs[rb->next].msg_hdr.msg_flags;
+	return rb->msgs[rb->next++].msg_len;
+}
+
 /*
  * netlink_parse_error - parse a netlink error message
  *
@@ -1163,22 +1717,25 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 	int read_in = 0;
 
 	while (1) {
-		struct sockaddr_nl snl;
-		struct msghdr msg = {.msg_name = (void *)&snl,
-				     .msg_namelen = sizeof(snl)};
 		struct nlmsghdr *h;
+		uint8_t *buf;
+		uint32_t pid;
+		int flags;
 
 		if (count && read_in >= count)
 			return 0;
 
-		status = netlink_recv_msg(nl, &msg);
+		status = netlink_recv_next(nl,
+					   count ? count - read_in
+						 : NL_RCV_BATCH,
+					   &buf, &pid, &flags);
 		if (status == -1)
 			return -1;
 		else if (status == 0)
 			break;
 
 		read_in++;
-		for (h = (struct nlmsghdr *)nl->buf;
+		for (h = (struct nlmsghdr *)buf;
 		     (status >= 0 && NLMSG_OK(h, (unsigned int)status));
 		     h = NLMSG_NEXT(h, status)) {
 			/* Finish of reading. */
@@ -1224,9 +1781,8 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 			 * Ignore messages that maybe sent from
 			 * other actors besides the kernel
 			 */
-			if (snl.nl_pid != 0) {
-				zlog_debug("Ignoring message from pid %u",
-					   snl.nl_pid);
+			if (pid != 0) {
+				zlog_debug("Ignoring message from pid %u", pid);
 				continue;
 			}
 
@@ -1239,7 +1795,7 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 		}
 
 		/* After error care. */
-		if (msg.msg_flags & MSG_TRUNC) {
+		if (flags & MSG_TRUNC) {
 			flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
 				 "%s error: message truncated", nl->name);
 			continue;
@@ -1366,118 +1922,95 @@ int netlink_request(struct nlsock *nl, void *req)
 	return 0;
 }
 
+static int nl_batch_seq_cmp(const void *a, const void *b)
+{
+	const struct nl_batch_seq *sa = a, *sb = b;
+
+	/* sequence numbers may wrap around within a batch */
+	return (int32_t)(sa->seq - sb->seq);
+}
+
+static void nl_batch_seq_add(struct nl_batch *bth, uint32_t seq,
+			     struct zebra_dplane_ctx *ctx, bool ignore_res)
+{
+	struct nl_batch_seq *e;
+
+	if (bth->seqcnt == nl_batch_seqsize) {
+		nl_batch_seqsize = MAX(nl_batch_seqsize * 2, 64);
+		nl_batch_seqs = XREALLOC(MTYPE_NL_BUF, nl_batch_seqs,
+					 nl_batch_seqsize
+						 * sizeof(*nl_batch_seqs));
+		bth->seqs = nl_batch_seqs;
+	}
+
+	if (bth->seqcnt
+	    && (int32_t)(seq - bth->seqs[bth->seqcnt - 1].seq) <= 0)
+		bth->seqs_sorted = false;
+
+	e = &bth->seqs[bth->seqcnt++];
+	e->seq = seq;
+	e->ctx = ctx;
+	e->ignore_res = ignore_res;
+}
+
+static struct nl_batch_seq *nl_batch_seq_find(struct nl_batch *bth,
+					      uint32_t seq)
+{
+	struct nl_batch_seq key = {.seq = seq};
+
+	if (!bth->seqcnt)
+		return NULL;
+
+	if (!bth->seqs_sorted) {
+		qsort(bth->seqs, bth->seqcnt, sizeof(*bth->seqs),
+		      nl_batch_seq_cmp);
+		bth->seqs_sorted = true;
+	}
+
+	return bsearch(&key, bth->seqs, bth->seqcnt, sizeof(*bth->seqs),
+		       nl_batch_seq_cmp);
+}
+
 static int nl_batch_read_resp(struct nl_batch *bth)
 {
 	struct nlmsghdr *h;
 	struct sockaddr_nl snl;
 	struct msghdr msg = {};
-	int status, seq;
+	int status;
 	struct nlsock *nl;
-	struct zebra_dplane_ctx *ctx;
-	bool ignore_msg;
+	struct nl_batch_seq *e;
 
-	nl = kernel_netlink_nlsock_lookup(bth->zns->sock);
+	nl = bth->nl;
 
 	msg.msg_name = (void *)&snl;
 	msg.msg_namelen = sizeof(snl);
 
 	/*
 	 * The responses are not batched, so we need to read and process one
-	 * message at a time.
+	 * message at a time.  Messages are sent without NLM_F_ACK, so only
+	 * failed requests get a response; every context without one has
+	 * succeeded.
 	 */
 	while (true) {
 		status = netlink_recv_msg(nl, &msg);
 		/*
 		 * status == -1 is a full on failure somewhere
 		 * since we don't know where the problem happened
-		 * we must mark all as failed
-		 *
-		 * Else we mark everything as worked
-		 *
+		 * the caller must mark all as failed
 		 */
-		if (status == -1 || status == 0) {
-			while ((ctx = dplane_ctx_dequeue(&(bth->ctx_list))) !=
-			       NULL) {
-				if (status == -1)
-					dplane_ctx_set_status(
-						ctx,
-						ZEBRA_DPLANE_REQUEST_FAILURE);
-				dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
-			}
+		if (status == -1 || status == 0)
 			return status;
-		}
 
 		h = (struct nlmsghdr *)nl->buf;
-		ignore_msg = false;
-		seq = h->nlmsg_seq;
-		/*
-		 * Find the corresponding context object. Received responses are
-		 * in the same order as requests we sent, so we can simply
-		 * iterate over the context list and match responses with
-		 * requests at same time.
-		 */
-		while (true) {
-			ctx = dplane_ctx_get_head(&(bth->ctx_list));
-			if (ctx == NULL) {
-				/*
-				 * This is a situation where we have gotten
-				 * into a bad spot.  We need to know that
-				 * this happens( does it? )
-				 */
-				zlog_err(
-					"%s:WARNING Received netlink Response for an error and no Contexts to associate with it",
-					__func__);
-				break;
-			}
-
-			/*
-			 * 'update' context objects take two consecutive
-			 * sequence numbers.
-			 */
-			if (dplane_ctx_is_update(ctx) &&
-			    dplane_ctx_get_ns(ctx)->seq + 1 == seq) {
-				/*
-				 * This is the situation where we get a response
-				 * to a message that should be ignored.
-				 */
-				ignore_msg = true;
-				break;
-			}
-
-			ctx = dplane_ctx_dequeue(&(bth->ctx_list));
-			dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
-
-			/* We have found corresponding context object. */
-			if (dplane_ctx_get_ns(ctx)->seq == seq)
-				break;
-
-			if (dplane_ctx_get_ns(ctx)->seq > seq)
-				zlog_warn(
-					"%s:WARNING Received %u is less than any context on the queue ctx->seq %u",
-					__func__, seq,
-					dplane_ctx_get_ns(ctx)->seq);
-		}
-
-		if (ignore_msg) {
-			/*
-			 * If we ignore the message due to an update
-			 * above we should still fricking decode the
-			 * message for our operator to understand
-			 * what is going on
-			 */
-			int err = netlink_parse_error(nl, h, bth->zns->is_cmd,
-						      false);
 
-			zlog_debug("%s: netlink error message seq=%d %d",
-				   __func__, h->nlmsg_seq, err);
-			continue;
-		}
+		/* Find the corresponding context object. */
+		e = nl_batch_seq_find(bth, h->nlmsg_seq);
 
 		/*
 		 * We received a message with the sequence number that isn't
 		 * associated with any dplane context object.
 		 */
-		if (ctx == NULL) {
+		if (e == NULL) {
 			if (IS_ZEBRA_DEBUG_KERNEL)
 				zlog_debug(
 					"%s: skipping unassociated response, seq number %d NS %u",
@@ -1486,13 +2019,27 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 			continue;
 		}
 
+		if (e->ignore_res) {
+			/*
+			 * This is a response to a message that should be
+			 * ignored; we should still decode the message for
+			 * our operator to understand what is going on
+			 */
+			int err = netlink_parse_error(nl, h, bth->zns->is_cmd,
+						      false);
+
+			zlog_debug("%s: netlink error message seq=%d %d",
+				   __func__, h->nlmsg_seq, err);
+			continue;
+		}
+
 		if (h->nlmsg_type == NLMSG_ERROR) {
 			int err = netlink_parse_error(nl, h, bth->zns->is_cmd,
 						      false);
 
 			if (err == -1)
 				dplane_ctx_set_status(
-					ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
+					e->ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
 
 			if (IS_ZEBRA_DEBUG_KERNEL)
 				zlog_debug("%s: netlink error message seq=%d ",
@@ -1515,17 +2062,36 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 	return 0;
 }
 
+/*
+ * Socket to send a batch on: kernel provider instances other than the
+ * first each have their own socket next to the namespace's dplane socket.
+ */
+static struct nlsock *nl_batch_nlsock(int sock)
+{
+	struct nlsock *nl = kernel_netlink_nlsock_lookup(sock);
+	unsigned int inst = dplane_provider_get_instance();
+
+	if (inst && nl && inst <= nl->ninstances)
+		nl = &nl->instances[inst - 1];
+
+	return nl;
+}
+
 static void nl_batch_reset(struct nl_batch *bth)
 {
 	bth->buf_head = bth->buf;
 	bth->curlen = 0;
 	bth->msgcnt = 0;
 	bth->zns = NULL;
+	bth->nl = NULL;
+	bth->seqcnt = 0;
+	bth->seqs_sorted = true;
 
 	TAILQ_INIT(&(bth->ctx_list));
 }
 
-static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
+static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q,
+			  size_t ctxcnt)
 {
 	/*
 	 * If the size of the buffer has changed, free and then allocate a new
@@ -1533,6 +2099,23 @@ static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
 	 */
 	size_t bufsize =
 		atomic_load_explicit(&nl_batch_bufsize, memory_order_relaxed);
+	size_t limit = atomic_load_explicit(&nl_batch_send_threshold,
+					    memory_order_relaxed);
+
+	bth->adaptive = netlink_batch_is_adaptive();
+	if (bth->adaptive) {
+		size_t want = ctxcnt * nl_batch_msglen + NL_PKT_BUF_SIZE;
+
+		/* round up to limit reallocations */
+		while (bufsize < want && bufsize < NL_BATCH_ADAPTIVE_MAX_BUFSIZE)
+			bufsize *= 2;
+		bufsize = MIN(bufsize, NL_BATCH_ADAPTIVE_MAX_BUFSIZE);
+
+		/* don't shrink the buffer again on every small batch */
+		bufsize = MAX(bufsize, nl_batch_tx_bufsize);
+		limit = bufsize - NL_PKT_BUF_SIZE;
+	}
+
 	if (bufsize != nl_batch_tx_bufsize) {
 		if (nl_batch_tx_buf)
 			XFREE(MTYPE_NL_BUF, nl_batch_tx_buf);
@@ -1543,22 +2126,36 @@ static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
 
 	bth->buf = nl_batch_tx_buf;
 	bth->bufsiz = bufsize;
-	bth->limit = atomic_load_explicit(&nl_batch_send_threshold,
-					  memory_order_relaxed);
+	bth->limit = limit;
+	bth->seqs = nl_batch_seqs;
 
 	bth->ctx_out_q = ctx_out_q;
 
 	nl_batch_reset(bth);
 }
 
+/*
+ * Adaptive mode: limit the batch to what the socket takes in a single
+ * sendmsg(), raising its send buffer as needed.
+ */
+static void nl_batch_fit_sndbuf(struct nl_batch *bth, struct nlsock *nl)
+{
+	size_t maxlen = netlink_sndbuf(nl, bth->bufsiz);
+
+	if (maxlen < bth->bufsiz) {
+		bth->bufsiz = maxlen;
+		bth->limit = MIN(bth->limit, maxlen - MIN(maxlen / 2,
+							  NL_PKT_BUF_SIZE));
+	}
+}
+
 static void nl_batch_send(struct nl_batch *bth)
 {
 	struct zebra_dplane_ctx *ctx;
 	bool err = false;
 
 	if (bth->curlen != 0 && bth->zns != NULL) {
-		struct nlsock *nl =
-			kernel_netlink_nlsock_lookup(bth->zns->sock);
+		struct nlsock *nl = bth->nl;
 
 		if (IS_ZEBRA_DEBUG_KERNEL)
 			zlog_debug("%s: %s, batch size=%zu, msg cnt=%zu",
@@ -1572,6 +2169,15 @@ static void nl_batch_send(struct nl_batch *bth)
 			if (nl_batch_read_resp(bth) == -1)
 				err = true;
 		}
+
+		frrtrace(4, frr_zebra, netlink_batch_flush, nl->name,
+			 bth->curlen, bth->msgcnt, err);
+
+		/* EWMA, 1/8 weight for the new sample */
+		if (bth->adaptive && bth->msgcnt)
+			nl_batch_msglen = (nl_batch_msglen * 7
+					   + bth->curlen / bth->msgcnt)
+					  / 8;
 	}
 
 	/* Move remaining contexts to the outbound queue. */
@@ -1600,6 +2206,11 @@ enum netlink_msg_status netlink_batch_add_msg(
 	struct nlmsghdr *msgh;
 	struct nlsock *nl;
 
+	nl = nl_batch_nlsock(dplane_ctx_get_ns_sock(ctx));
+
+	if (bth->adaptive && bth->curlen == 0)
+		nl_batch_fit_sndbuf(bth, nl);
+
 	size = (*msg_encoder)(ctx, bth->buf_head, bth->bufsiz - bth->curlen);
 
 	/*
@@ -1615,6 +2226,8 @@ enum netlink_msg_status netlink_batch_add_msg(
 	 */
 	if (size == 0) {
 		nl_batch_send(bth);
+		if (bth->adaptive)
+			nl_batch_fit_sndbuf(bth, nl);
 		size = (*msg_encoder)(ctx, bth->buf_head,
 				      bth->bufsiz - bth->curlen);
 		/*
@@ -1626,7 +2239,6 @@ enum netlink_msg_status netlink_batch_add_msg(
 	}
 
 	seq = dplane_ctx_get_ns(ctx)->seq;
-	nl = kernel_netlink_nlsock_lookup(dplane_ctx_get_ns_sock(ctx));
 
 	if (ignore_res)
 		seq++;
@@ -1635,7 +2247,10 @@ enum netlink_msg_status netlink_batch_add_msg(
 	msgh->nlmsg_seq = seq;
 	msgh->nlmsg_pid = nl->snl.nl_pid;
 
+	nl_batch_seq_add(bth, seq, ctx, ignore_res);
+
 	bth->zns = dplane_ctx_get_ns(ctx);
+	bth->nl = nl;
 	bth->buf_head = ((char *)bth->buf_head) + size;
 	bth->curlen += size;
 	bth->msgcnt++;
@@ -1745,7 +2360,7 @@ void kernel_update_multi(struct dplane_ctx_q *ctx_list)
 	enum netlink_msg_status res;
 
 	TAILQ_INIT(&handled_list);
-	nl_batch_init(&batch, &handled_list);
+	nl_batch_init(&batch, &handled_list, dplane_ctx_queue_count(ctx_list));
 
 	while (true) {
 		ctx = dplane_ctx_dequeue(ctx_list);
@@ -1828,6 +2443,58 @@ static bool kernel_netlink_nlsock_hash_equal(const void *arg1, const void *arg2)
 
 /* Exported interface function.  This function simply calls
    netlink_socket (). */
+/*
+ * Outbound dplane sockets for kernel provider instances other than the
+ * first, set up like the namespace's main dplane socket.
+ */
+static void kernel_dplane_instances_init(struct zebra_ns *zns)
+{
+	struct nlsock *dp = &zns->netlink_dplane_out;
+	unsigned int i, n = dplane_get_provider_instances() - 1;
+	struct nlsock *nls;
+#if defined SOL_NETLINK
+	int one = 1;
+#endif
+
+	if (n == 0)
+		return;
+
+	dp->instances = XCALLOC(MTYPE_NL_SOCK, n * sizeof(*dp->instances));
+
+	for (i = 0; i < n; i++) {
+		nls = &dp->instances[i];
+
+		snprintf(nls->name, sizeof(nls->name), "netlink-dp%u (NS %u)",
+			 i + 1, zns->ns_id);
+		nls->sock = -1;
+		if (netlink_socket(nls, 0, 0, 0, zns->ns_id) < 0) {
+			zlog_err("Failure to create %s socket", nls->name);
+			exit(-1);
+		}
+
+		kernel_netlink_nlsock_insert(nls);
+
+#if defined SOL_NETLINK
+		if (setsockopt(nls->sock, SOL_NETLINK, NETLINK_EXT_ACK, &one,
+			       sizeof(one))
+		    < 0)
+			zlog_notice("Registration for extended dp ACK failed : %d %s",
+				    errno, safe_strerror(errno));
+		setsockopt(nls->sock, SOL_NETLINK, NETLINK_CAP_ACK, &one,
+			   sizeof(one));
+#endif
+
+		if (fcntl(nls->sock, F_SETFL, O_NONBLOCK) < 0)
+			zlog_err("Can't set %s socket error: %s(%d)",
+				 nls->name, safe_strerror(errno), errno);
+
+		if (rcvbufsize)
+			netlink_recvbuf(nls, rcvbufsize);
+
+		dp->ninstances++;
+	}
+}
+
 void kernel_init(struct zebra_ns *zns)
 {
 	uint32_t groups, dplane_groups, ext_groups;
@@ -2006,15 +2673,12 @@ void kernel_init(struct zebra_ns *zns)
 		netlink_recvbuf(&zns->ge_netlink_cmd, rcvbufsize);
 	}
 
+	kernel_dplane_instances_init(zns);
+
 	/* Set filter for inbound sockets, to exclude events we've generated
-	 * ourselves.
+	 * ourselves and ones we are told to ignore.
 	 */
-	netlink_install_filter(zns->netlink.sock, zns->netlink_cmd.snl.nl_pid,
-			       zns->netlink_dplane_out.snl.nl_pid);
-
-	netlink_install_filter(zns->netlink_dplane_in.sock,
-			       zns->netlink_cmd.snl.nl_pid,
-			       zns->netlink_dplane_out.snl.nl_pid);
+	netlink_install_filters(zns);
 
 	zns->t_netlink = NULL;
 
@@ -2033,6 +2697,10 @@ static void kernel_nlsock_fini(struct nlsock *nls)
 		nls->sock = -1;
 		XFREE(MTYPE_NL_BUF, nls->buf);
 		nls->buflen = 0;
+		if (nls->rcv) {
+			XFREE(MTYPE_NL_BUF, nls->rcv->buf);
+			XFREE(MTYPE_NL_BUF, nls->rcv);
+		}
 	}
 }
 
@@ -2049,8 +2717,17 @@ void kernel_terminate(struct zebra_ns *zns, bool complete)
 	/* During zebra shutdown, we need to leave the dataplane socket
 	 * around until all work is done.
 	 */
-	if (complete)
-		kernel_nlsock_fini(&zns->netlink_dplane_out);
+	if (complete) {
+		struct nlsock *dp = &zns->netlink_dplane_out;
+		unsigned int i;
+
+		for (i = 0; i < dp->ninstances; i++)
+			kernel_nlsock_fini(&dp->instances[i]);
+		XFREE(MTYPE_NL_SOCK, dp->instances);
+		dp->ninstances = 0;
+
+		kernel_nlsock_fini(dp);
+	}
 
 	kernel_nlsock_fini(&zns->ge_netlink_cmd);
 }
@@ -185,6 +185,24 @@ extern int netlink_config_write_helper(struct vty *vty);
 extern void netlink_set_batch_buffer_size(uint32_t size, uint32_t threshold,
 					  bool set);
 
+/*
+ * Adaptive batching: size each batch for all pending contexts instead of
+ * the fixed buffer size, and grow the socket send buffer to match.
+ */
+extern void netlink_set_batch_adaptive(bool set);
+extern bool netlink_batch_is_adaptive(void);
+
+/*
+ * Routes in these tables or of these protocols, and neighbors on these
+ * interfaces, are filtered out on the netlink listener sockets.  Return
+ * -1 if there are too many already.
+ */
+extern int netlink_ignore_table(uint32_t table, bool set);
+extern int netlink_ignore_protocol(uint8_t proto, bool set);
+extern int netlink_ignore_interface(const char *ifname, bool set);
+/* ifp was added or removed, its ifindex may have to be filtered */
+extern void netlink_ignore_interface_update(struct interface *ifp);
+
 extern struct nlsock *kernel_netlink_nlsock_lookup(int sock);
 #endif /* HAVE_NETLINK */
 
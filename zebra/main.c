@@ -85,6 +85,9 @@ uint32_t rcvbufsize = 128 * 1024;
 
 #define OPTION_V6_RR_SEMANTICS 2000
 #define OPTION_ASIC_OFFLOAD    2001
+#define OPTION_DPLANE_THREADS  2002
+#define OPTION_RIB_THREADS     2003
+#define OPTION_NETLINK_READERS 2004
 
 /* Command line options. */
 const struct option longopts[] = {
@@ -95,10 +98,13 @@ const struct option longopts[] = {
 	{"retain", no_argument, NULL, 'r'},
 	{"graceful_restart", required_argument, NULL, 'K'},
 	{"asic-offload", optional_argument, NULL, OPTION_ASIC_OFFLOAD},
+	{"rib-threads", required_argument, NULL, OPTION_RIB_THREADS},
 #ifdef HAVE_NETLINK
 	{"vrfwnetns", no_argument, NULL, 'n'},
 	{"nl-bufsize", required_argument, NULL, 's'},
 	{"v6-rr-semantics", no_argument, NULL, OPTION_V6_RR_SEMANTICS},
+	{"dplane-threads", required_argument, NULL, OPTION_DPLANE_THREADS},
+	{"netlink-readers", required_argument, NULL, OPTION_NETLINK_READERS},
 #endif /* HAVE_NETLINK */
 	{0}};
 
@@ -311,10 +317,13 @@ int main(int argc, char **argv)
 		"  -r, --retain             When program terminates, retain added route by zebra.\n"
 		"  -K, --graceful_restart   Graceful restart at the kernel level, timer in seconds for expiration\n"
 		"  -A, --asic-offload       FRR is interacting with an asic underneath the linux kernel\n"
+		"      --rib-threads        Number of pthreads resolving nexthops\n"
 #ifdef HAVE_NETLINK
 		"  -s, --nl-bufsize         Set netlink receive buffer size\n"
 		"  -n, --vrfwnetns          Use NetNS as VRF backend\n"
 		"      --v6-rr-semantics    Use v6 RR semantics\n"
+		"      --dplane-threads     Number of pthreads programming the kernel\n"
+		"      --netlink-readers    Number of pthreads reading kernel events\n"
 #else
 		"  -s,                      Set kernel socket receive buffer size\n"
 #endif /* HAVE_NETLINK */
@@ -379,6 +388,43 @@ int main(int argc, char **argv)
 		case OPTION_V6_RR_SEMANTICS:
 			v6_rr_semantics = true;
 			break;
+		case OPTION_DPLANE_THREADS: {
+			unsigned long threads = strtoul(optarg, NULL, 10);
+
+			if (threads == 0
+			    || threads > DPLANE_MAX_PROVIDER_INSTANCES) {
+				fprintf(stderr,
+					"dplane-threads must be between 1 and %u\n",
+					DPLANE_MAX_PROVIDER_INSTANCES);
+				return 1;
+			}
+			dplane_set_provider_instances(threads);
+			break;
+		}
+		case OPTION_NETLINK_READERS: {
+			unsigned long readers = strtoul(optarg, NULL, 10);
+
+			if (readers > DPLANE_MAX_NETLINK_READERS) {
+				fprintf(stderr,
+					"netlink-readers must be between 0 and %u\n",
+					DPLANE_MAX_NETLINK_READERS);
+				return 1;
+			}
+			dplane_set_netlink_readers(readers);
+			break;
+		}
+		case OPTION_RIB_THREADS: {
+			unsigned long threads = strtoul(optarg, NULL, 10);
+
+			if (threads == 0 || threads > ZEBRA_RIB_THREADS_MAX) {
+				fprintf(stderr,
+					"rib-threads must be between 1 and %u\n",
+					ZEBRA_RIB_THREADS_MAX);
+				return 1;
+			}
+			zrouter.rib_threads = threads;
+			break;
+		}
 		case OPTION_ASIC_OFFLOAD:
 			if (!strcmp(optarg, "notify_on_offload"))
 				notify_on_ack = false;
@@ -101,6 +101,32 @@ static void zebra_redistribute_default(struct zserv *client, vrf_id_t vrf_id)
 	}
 }
 
+static void zebra_redistribute_re(struct zserv *client, int type,
+				  unsigned short instance, vrf_id_t vrf_id,
+				  struct route_node *rn,
+				  struct route_entry *newre)
+{
+	if (IS_ZEBRA_DEBUG_RIB)
+		zlog_debug(
+			"%s: client %s %pRN(%u:%u) checking: selected=%d, type=%d, distance=%d, metric=%d zebra_check_addr=%d",
+			__func__, zebra_route_string(client->proto), rn,
+			vrf_id, newre->instance,
+			!!CHECK_FLAG(newre->flags, ZEBRA_FLAG_SELECTED),
+			newre->type, newre->distance, newre->metric,
+			zebra_check_addr(&rn->p));
+
+	if (!CHECK_FLAG(newre->flags, ZEBRA_FLAG_SELECTED))
+		return;
+	if ((type != ZEBRA_ROUTE_ALL
+	     && (newre->type != type || newre->instance != instance)))
+		return;
+	if (!zebra_check_addr(&rn->p))
+		return;
+
+	zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_ADD, client, rn,
+				 newre);
+}
+
 /* Redistribute routes. */
 static void zebra_redistribute(struct zserv *client, int type,
 			       unsigned short instance, vrf_id_t vrf_id,
@@ -114,32 +140,20 @@ static void zebra_redistribute(struct zserv *client, int type,
 	if (!table)
 		return;
 
-	for (rn = route_top(table); rn; rn = srcdest_route_next(rn))
-		RNODE_FOREACH_RE (rn, newre) {
-			if (IS_ZEBRA_DEBUG_RIB)
-				zlog_debug(
-					"%s: client %s %pRN(%u:%u) checking: selected=%d, type=%d, distance=%d, metric=%d zebra_check_addr=%d",
-					__func__,
-					zebra_route_string(client->proto), rn,
-					vrf_id, newre->instance,
-					!!CHECK_FLAG(newre->flags,
-						     ZEBRA_FLAG_SELECTED),
-					newre->type, newre->distance,
-					newre->metric,
-					zebra_check_addr(&rn->p));
-
-			if (!CHECK_FLAG(newre->flags, ZEBRA_FLAG_SELECTED))
-				continue;
-			if ((type != ZEBRA_ROUTE_ALL
-			     && (newre->type != type
-				 || newre->instance != instance)))
-				continue;
-			if (!zebra_check_addr(&rn->p))
-				continue;
+	/* a single type only needs to look at that type's routes */
+	if (type != ZEBRA_ROUTE_ALL) {
+		struct rib_table_info *info = rib_table_info(table);
 
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_ADD,
-						 client, rn, newre);
-		}
+		frr_each (re_owner_list, &info->owners[type], newre)
+			zebra_redistribute_re(client, type, instance, vrf_id,
+					      newre->rn, newre);
+		return;
+	}
+
+	for (rn = route_top(table); rn; rn = srcdest_route_next(rn))
+		RNODE_FOREACH_RE (rn, newre)
+			zebra_redistribute_re(client, type, instance, vrf_id,
+					      rn, newre);
 }
 
 /*
@@ -198,6 +212,7 @@ void redistribute_update(const struct route_node *rn,
 {
 	struct listnode *node, *nnode;
 	struct zserv *client;
+	struct stream *add_msg = NULL, *del_msg = NULL;
 
 	if (IS_ZEBRA_DEBUG_RIB)
 		zlog_debug(
@@ -223,12 +238,17 @@ void redistribute_update(const struct route_node *rn,
 					re->vrf_id, re->table, re->type,
 					re->distance, re->metric);
 			}
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_ADD,
-						 client, rn, re);
+			zsend_redistribute_route_msg(
+				ZEBRA_REDISTRIBUTE_ROUTE_ADD, client, rn, re,
+				&add_msg);
 		} else if (zebra_redistribute_check(rn, prev_re, client))
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_DEL,
-						 client, rn, prev_re);
+			zsend_redistribute_route_msg(
+				ZEBRA_REDISTRIBUTE_ROUTE_DEL, client, rn,
+				prev_re, &del_msg);
 	}
+
+	stream_free(add_msg);
+	stream_free(del_msg);
 }
 
 /*
@@ -245,6 +265,7 @@ void redistribute_delete(const struct route_node *rn,
 {
 	struct listnode *node, *nnode;
 	struct zserv *client;
+	struct stream *del_msg = NULL;
 	vrf_id_t vrfid;
 
 	if (old_re)
@@ -300,9 +321,12 @@ void redistribute_delete(const struct route_node *rn,
 
 		/* Send a delete for the 'old' re to any subscribed client. */
 		if (zebra_redistribute_check(rn, old_re, client))
-			zsend_redistribute_route(ZEBRA_REDISTRIBUTE_ROUTE_DEL,
-						 client, rn, old_re);
+			zsend_redistribute_route_msg(
+				ZEBRA_REDISTRIBUTE_ROUTE_DEL, client, rn,
+				old_re, &del_msg);
 	}
+
+	stream_free(del_msg);
 }
 
 
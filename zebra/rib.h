@@ -47,6 +47,7 @@ DECLARE_MGROUP(ZEBRA);
 DECLARE_MTYPE(RE);
 
 PREDECL_LIST(rnh_list);
+PREDECL_DLIST(rnh_notify_list);
 
 /* Nexthop structure. */
 struct rnh {
@@ -55,6 +56,7 @@ struct rnh {
 #define ZEBRA_NHT_CONNECTED 0x1
 #define ZEBRA_NHT_DELETED 0x2
 #define ZEBRA_NHT_RESOLVE_VIA_DEFAULT 0x4
+#define ZEBRA_NHT_NOTIFY_PENDING 0x8
 
 	/* VRF identifier. */
 	vrf_id_t vrf_id;
@@ -79,12 +81,16 @@ struct rnh {
 	int filtered[ZEBRA_ROUTE_MAX];
 
 	struct rnh_list_item rnh_list_item;
+
+	/* on the list of rnhs with client notifications pending */
+	struct rnh_notify_list_item notify_item;
 };
 
 #define DISTANCE_INFINITY  255
 #define ZEBRA_KERNEL_TABLE_MAX 252 /* support for no more than this rt tables */
 
 PREDECL_LIST(re_list);
+PREDECL_DLIST(re_owner_list);
 
 struct re_opaque {
 	uint16_t length;
@@ -95,6 +101,10 @@ struct route_entry {
 	/* Link list. */
 	struct re_list_item next;
 
+	/* Routes of the same type in the table, see rib_table_info */
+	struct re_owner_list_item owner_item;
+	struct route_node *rn;
+
 	/* Nexthop group, shared/refcounted, based on the nexthop(s)
 	 * provided by the owner of the route
 	 */
@@ -158,6 +168,8 @@ struct route_entry {
  * differs from the rib/normal set of nexthops.
  */
 #define ROUTE_ENTRY_USE_FIB_NHG      0x40
+/* A graceful restart stale sweep will resume at this route */
+#define ROUTE_ENTRY_GR_CURSOR        0x80
 
 	/* Sequence value incremented for each dataplane operation */
 	uint32_t dplane_sequence;
@@ -234,7 +246,9 @@ typedef struct rib_dest_t_ {
 } rib_dest_t;
 
 DECLARE_LIST(rnh_list, struct rnh, rnh_list_item);
+DECLARE_DLIST(rnh_notify_list, struct rnh, notify_item);
 DECLARE_LIST(re_list, struct route_entry, next);
+DECLARE_DLIST(re_owner_list, struct route_entry, owner_item);
 
 #define RIB_ROUTE_QUEUED(x)	(1 << (x))
 // If MQ_SIZE is modified this value needs to be updated.
@@ -305,6 +319,12 @@ struct rib_table_info {
 	afi_t afi;
 	safi_t safi;
 	uint32_t table_id;
+
+	/*
+	 * All routes in the table by type, so that everything a client
+	 * owns can be found without walking the whole table.
+	 */
+	struct re_owner_list_head owners[ZEBRA_ROUTE_MAX];
 };
 
 enum rib_tables_iter_state {
@@ -269,7 +269,7 @@ static ssize_t netlink_tclass_msg_encode(int cmd, struct zebra_dplane_ctx *ctx,
 	memset(req, 0, sizeof(*req));
 
 	req->n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
-	req->n.nlmsg_flags = NLM_F_CREATE | NLM_F_REQUEST;
+	req->n.nlmsg_flags = NLM_F_REQUEST;
 
 	req->n.nlmsg_type = cmd;
 
@@ -280,6 +280,13 @@ static ssize_t netlink_tclass_msg_encode(int cmd, struct zebra_dplane_ctx *ctx,
 	req->t.tcm_handle = tc_get_handle(ctx, 1);
 	req->t.tcm_parent = tc_get_handle(ctx, 0);
 
+	if (cmd == RTM_DELTCLASS)
+		return NLMSG_ALIGN(req->n.nlmsg_len);
+
+	req->n.nlmsg_flags |= NLM_F_CREATE;
+	if (dplane_ctx_get_op(ctx) == DPLANE_OP_TC_UPDATE)
+		req->n.nlmsg_flags |= NLM_F_REPLACE;
+
 	rate = dplane_ctx_tc_get_rate(ctx);
 	ceil = dplane_ctx_tc_get_ceil(ctx);
 
@@ -353,9 +360,16 @@ static ssize_t netlink_tfilter_msg_encode(int cmd, struct zebra_dplane_ctx *ctx,
 	memset(req, 0, sizeof(*req));
 
 	req->n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
-	req->n.nlmsg_flags = NLM_F_CREATE | NLM_F_REQUEST;
-
-	req->n.nlmsg_flags |= NLM_F_EXCL;
+	req->n.nlmsg_flags = NLM_F_REQUEST;
+
+	/* an update changes the filter in place rather than adding one */
+	if (cmd == RTM_NEWTFILTER) {
+		req->n.nlmsg_flags |= NLM_F_CREATE;
+		if (dplane_ctx_get_op(ctx) == DPLANE_OP_TC_UPDATE)
+			req->n.nlmsg_flags |= NLM_F_REPLACE;
+		else
+			req->n.nlmsg_flags |= NLM_F_EXCL;
+	}
 
 	req->n.nlmsg_type = cmd;
 
@@ -376,6 +390,11 @@ static ssize_t netlink_tfilter_msg_encode(int cmd, struct zebra_dplane_ctx *ctx,
 	req->t.tcm_parent = tc_get_handle(ctx, 0);
 
 	nl_attr_put(&req->n, datalen, TCA_KIND, kind, strlen(kind) + 1);
+
+	/* handle, priority and protocol identify the filter */
+	if (cmd == RTM_DELTFILTER)
+		return NLMSG_ALIGN(req->n.nlmsg_len);
+
 	nest = nl_attr_nest(&req->n, datalen, TCA_OPTIONS);
 
 	nl_attr_put(&req->n, datalen, TCA_FLOWER_CLASSID, &classid,
@@ -454,15 +473,57 @@ static ssize_t netlink_newtfilter_msg_encoder(struct zebra_dplane_ctx *ctx,
 	return netlink_tfilter_msg_encode(RTM_NEWTFILTER, ctx, buf, buflen);
 }
 
+static ssize_t netlink_deltclass_msg_encoder(struct zebra_dplane_ctx *ctx,
+					     void *buf, size_t buflen)
+{
+	return netlink_tclass_msg_encode(RTM_DELTCLASS, ctx, buf, buflen);
+}
+
+static ssize_t netlink_deltfilter_msg_encoder(struct zebra_dplane_ctx *ctx,
+					      void *buf, size_t buflen)
+{
+	return netlink_tfilter_msg_encode(RTM_DELTFILTER, ctx, buf, buflen);
+}
+
+/*
+ * All messages go into the same netlink batch, so installing many filters
+ * costs one sendmsg per batch rather than one round-trip each.  Only an
+ * install touches the qdisc;  updates change the class and filter in place
+ * and deletes remove just those, leaving the qdisc and the other classes
+ * hanging off it alone.
+ */
 enum netlink_msg_status netlink_put_tc_update_msg(struct nl_batch *bth,
 						  struct zebra_dplane_ctx *ctx)
 {
-	/* TODO: error handling and other actions (delete, replace, ...) */
+	enum netlink_msg_status ret;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_TC_INSTALL:
+		ret = netlink_batch_add_msg(bth, ctx,
+					    netlink_newqdisc_msg_encoder, false);
+		if (ret == FRR_NETLINK_ERROR)
+			return ret;
+		/* fallthrough */
+	case DPLANE_OP_TC_UPDATE:
+		ret = netlink_batch_add_msg(bth, ctx,
+					    netlink_newtclass_msg_encoder, false);
+		if (ret == FRR_NETLINK_ERROR)
+			return ret;
+		return netlink_batch_add_msg(bth, ctx,
+					     netlink_newtfilter_msg_encoder,
+					     false);
+	case DPLANE_OP_TC_DELETE:
+		ret = netlink_batch_add_msg(bth, ctx,
+					    netlink_deltfilter_msg_encoder, false);
+		if (ret == FRR_NETLINK_ERROR)
+			return ret;
+		return netlink_batch_add_msg(bth, ctx,
+					     netlink_deltclass_msg_encoder, false);
+	default:
+		break;
+	}
 
-	netlink_batch_add_msg(bth, ctx, netlink_newqdisc_msg_encoder, false);
-	netlink_batch_add_msg(bth, ctx, netlink_newtclass_msg_encoder, false);
-	return netlink_batch_add_msg(bth, ctx, netlink_newtfilter_msg_encoder,
-				     false);
+	return FRR_NETLINK_ERROR;
 }
 
 #endif /* HAVE_NETLINK */
@@ -61,6 +61,7 @@
 #include "zebra/zebra_opaque.h"
 #include "zebra/zebra_srte.h"
 #include "zebra/zebra_srv6.h"
+#include "zebra/zebra_trace.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, RE_OPAQUE, "Route Opaque Data");
 
@@ -183,7 +184,7 @@ static void zserv_encode_error(struct stream *s, enum zebra_error_types error)
  */
 int zsend_interface_add(struct zserv *client, struct interface *ifp)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_INTERFACE_ADD, ifp->vrf->vrf_id);
 	zserv_encode_interface(s, ifp);
@@ -195,7 +196,7 @@ int zsend_interface_add(struct zserv *client, struct interface *ifp)
 /* Interface deletion from zebra daemon. */
 int zsend_interface_delete(struct zserv *client, struct interface *ifp)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_INTERFACE_DELETE, ifp->vrf->vrf_id);
 	zserv_encode_interface(s, ifp);
@@ -206,7 +207,7 @@ int zsend_interface_delete(struct zserv *client, struct interface *ifp)
 
 int zsend_vrf_add(struct zserv *client, struct zebra_vrf *zvrf)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_VRF_ADD, zvrf_id(zvrf));
 	zserv_encode_vrf(s, zvrf);
@@ -219,7 +220,7 @@ int zsend_vrf_add(struct zserv *client, struct zebra_vrf *zvrf)
 int zsend_vrf_delete(struct zserv *client, struct zebra_vrf *zvrf)
 
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_VRF_DELETE, zvrf_id(zvrf));
 	zserv_encode_vrf(s, zvrf);
@@ -230,7 +231,7 @@ int zsend_vrf_delete(struct zserv *client, struct zebra_vrf *zvrf)
 
 int zsend_interface_link_params(struct zserv *client, struct interface *ifp)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	if (!ifp->link_params) {
 		stream_free(s);
@@ -297,7 +298,7 @@ int zsend_interface_address(int cmd, struct zserv *client,
 {
 	int blen;
 	struct prefix *p;
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, cmd, ifp->vrf->vrf_id);
 	stream_putl(s, ifp->ifindex);
@@ -338,7 +339,7 @@ static int zsend_interface_nbr_address(int cmd, struct zserv *client,
 				       struct nbr_connected *ifc)
 {
 	int blen;
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 	struct prefix *p;
 
 	zclient_create_header(s, cmd, ifp->vrf->vrf_id);
@@ -457,7 +458,7 @@ int zsend_interface_addresses(struct zserv *client, struct interface *ifp)
 int zsend_interface_vrf_update(struct zserv *client, struct interface *ifp,
 			       vrf_id_t vrf_id)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_INTERFACE_VRF_UPDATE, ifp->vrf->vrf_id);
 
@@ -532,7 +533,7 @@ void nbr_connected_delete_ipv6(struct interface *ifp, struct in6_addr *address)
  */
 int zsend_interface_update(int cmd, struct zserv *client, struct interface *ifp)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, cmd, ifp->vrf->vrf_id);
 	zserv_encode_interface(s, ifp);
@@ -545,29 +546,10 @@ int zsend_interface_update(int cmd, struct zserv *client, struct interface *ifp)
 	return zserv_send_message(client, s);
 }
 
-int zsend_redistribute_route(int cmd, struct zserv *client,
-			     const struct route_node *rn,
-			     const struct route_entry *re)
+static void zsend_redistribute_count(int cmd, struct zserv *client,
+				     const struct route_node *rn)
 {
-	struct zapi_route api;
-	struct zapi_nexthop *api_nh;
-	struct nexthop *nexthop;
-	const struct prefix *p, *src_p;
-	uint8_t count = 0;
-	afi_t afi;
-	size_t stream_size =
-		MAX(ZEBRA_MAX_PACKET_SIZ, sizeof(struct zapi_route));
-
-	srcdest_rnode_prefixes(rn, &p, &src_p);
-	memset(&api, 0, sizeof(api));
-	api.vrf_id = re->vrf_id;
-	api.type = re->type;
-	api.safi = SAFI_UNICAST;
-	api.instance = re->instance;
-	api.flags = re->flags;
-
-	afi = family2afi(p->family);
-	switch (afi) {
+	switch (family2afi(rn->p.family)) {
 	case AFI_IP:
 		if (cmd == ZEBRA_REDISTRIBUTE_ROUTE_ADD)
 			client->redist_v4_add_cnt++;
@@ -583,6 +565,28 @@ int zsend_redistribute_route(int cmd, struct zserv *client,
 	default:
 		break;
 	}
+}
+
+/* The message does not depend on the client it is sent to */
+static struct stream *zsend_redistribute_encode(int cmd,
+						const struct route_node *rn,
+						const struct route_entry *re)
+{
+	struct zapi_route api;
+	struct zapi_nexthop *api_nh;
+	struct nexthop *nexthop;
+	const struct prefix *p, *src_p;
+	uint8_t count = 0;
+	size_t stream_size =
+		MAX(ZEBRA_MAX_PACKET_SIZ, sizeof(struct zapi_route));
+
+	srcdest_rnode_prefixes(rn, &p, &src_p);
+	memset(&api, 0, sizeof(api));
+	api.vrf_id = re->vrf_id;
+	api.type = re->type;
+	api.safi = SAFI_UNICAST;
+	api.instance = re->instance;
+	api.flags = re->flags;
 
 	/* Prefix. */
 	api.prefix = *p;
@@ -640,21 +644,62 @@ int zsend_redistribute_route(int cmd, struct zserv *client,
 
 	struct stream *s = stream_new(stream_size);
 
-	/* Encode route and send. */
+	/* Encode route. */
 	if (zapi_route_encode(cmd, s, &api) < 0) {
 		stream_free(s);
-		return -1;
+		return NULL;
 	}
+	return s;
+}
+
+static void zsend_redistribute_debug(int cmd, struct zserv *client,
+				     const struct route_node *rn,
+				     const struct route_entry *re)
+{
+	const struct prefix *p, *src_p;
+
+	srcdest_rnode_prefixes(rn, &p, &src_p);
+	zlog_debug("%s: %s to client %s: type %s, vrf_id %d, p %pFX",
+		   __func__, zserv_command_string(cmd),
+		   zebra_route_string(client->proto),
+		   zebra_route_string(re->type), re->vrf_id, p);
+}
+
+int zsend_redistribute_route(int cmd, struct zserv *client,
+			     const struct route_node *rn,
+			     const struct route_entry *re)
+{
+	struct stream *s;
+
+	zsend_redistribute_count(cmd, client, rn);
+
+	s = zsend_redistribute_encode(cmd, rn, re);
+	if (!s)
+		return -1;
 
 	if (IS_ZEBRA_DEBUG_SEND)
-		zlog_debug("%s: %s to client %s: type %s, vrf_id %d, p %pFX",
-			   __func__, zserv_command_string(cmd),
-			   zebra_route_string(client->proto),
-			   zebra_route_string(api.type), api.vrf_id,
-			   &api.prefix);
+		zsend_redistribute_debug(cmd, client, rn, re);
 	return zserv_send_message(client, s);
 }
 
+int zsend_redistribute_route_msg(int cmd, struct zserv *client,
+				 const struct route_node *rn,
+				 const struct route_entry *re,
+				 struct stream **msg)
+{
+	zsend_redistribute_count(cmd, client, rn);
+
+	if (!*msg) {
+		*msg = zsend_redistribute_encode(cmd, rn, re);
+		if (!*msg)
+			return -1;
+	}
+
+	if (IS_ZEBRA_DEBUG_SEND)
+		zsend_redistribute_debug(cmd, client, rn, re);
+	return zserv_send_message(client, stream_dup(*msg));
+}
+
 /*
  * Modified version of zsend_ipv4_nexthop_lookup(): Query unicast rib if
  * nexthop is not found on mrib. Returns both route metric and protocol
@@ -678,7 +723,7 @@ static int zsend_nexthop_lookup_mrib(struct zserv *client, struct ipaddr *addr,
 	struct nexthop *nexthop;
 
 	/* Get output stream. */
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 	stream_reset(s);
 
 	/* Fill in result. */
@@ -733,7 +778,7 @@ int zsend_nhg_notify(uint16_t type, uint16_t instance, uint32_t session_id,
 		zlog_debug("%s: type %d, id %d, note %s",
 			   __func__, type, id, zapi_nhg_notify_owner2str(note));
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 	stream_reset(s);
 
 	zclient_create_header(s, ZEBRA_NHG_NOTIFY_OWNER, VRF_DEFAULT);
@@ -854,7 +899,7 @@ void zsend_rule_notify_owner(const struct zebra_dplane_ctx *ctx,
 	if (!client)
 		return;
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_RULE_NOTIFY_OWNER, VRF_DEFAULT);
 	stream_put(s, &note, sizeof(note));
@@ -906,7 +951,7 @@ void zsend_iptable_notify_owner(const struct zebra_dplane_ctx *ctx,
 	if (!client)
 		return;
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, cmd, VRF_DEFAULT);
 	stream_putw(s, note);
@@ -940,7 +985,7 @@ void zsend_ipset_notify_owner(const struct zebra_dplane_ctx *ctx,
 	if (!client)
 		return;
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, cmd, VRF_DEFAULT);
 	stream_putw(s, note);
@@ -976,7 +1021,7 @@ void zsend_ipset_entry_notify_owner(const struct zebra_dplane_ctx *ctx,
 	if (!client)
 		return;
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, cmd, VRF_DEFAULT);
 	stream_putw(s, note);
@@ -1010,7 +1055,7 @@ void zsend_nhrp_neighbor_notify(int cmd, struct interface *ifp,
 				      ifp->vrf->vrf_id))
 			continue;
 
-		s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+		s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 		zclient_neigh_ip_encode(s, cmd, &ip, link_layer_ipv4, ifp,
 					ndm_state);
 		stream_putw_at(s, 0, stream_get_endp(s));
@@ -1030,7 +1075,7 @@ int zsend_router_id_update(struct zserv *client, afi_t afi, struct prefix *p,
 	if (!vrf_bitmap_check(client->ridinfo[afi], vrf_id))
 		return 0;
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	/* Message type. */
 	zclient_create_header(s, ZEBRA_ROUTER_ID_UPDATE, vrf_id);
@@ -1052,7 +1097,7 @@ int zsend_router_id_update(struct zserv *client, afi_t afi, struct prefix *p,
  */
 int zsend_pw_update(struct zserv *client, struct zebra_pw *pw)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_PW_STATUS_UPDATE, pw->vrf_id);
 	stream_write(s, pw->ifname, INTERFACE_NAMSIZ);
@@ -1069,7 +1114,7 @@ int zsend_pw_update(struct zserv *client, struct zebra_pw *pw)
 int zsend_assign_label_chunk_response(struct zserv *client, vrf_id_t vrf_id,
 				      struct label_manager_chunk *lmc)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_GET_LABEL_CHUNK, vrf_id);
 	/* proto */
@@ -1095,7 +1140,7 @@ int zsend_assign_label_chunk_response(struct zserv *client, vrf_id_t vrf_id,
 int zsend_label_manager_connect_response(struct zserv *client, vrf_id_t vrf_id,
 					 unsigned short result)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_LABEL_MANAGER_CONNECT, vrf_id);
 
@@ -1119,7 +1164,7 @@ static int zsend_assign_table_chunk_response(struct zserv *client,
 					     vrf_id_t vrf_id,
 					     struct table_manager_chunk *tmc)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_GET_TABLE_CHUNK, vrf_id);
 
@@ -1139,7 +1184,7 @@ static int zsend_table_manager_connect_response(struct zserv *client,
 						vrf_id_t vrf_id,
 						uint16_t result)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_TABLE_MANAGER_CONNECT, vrf_id);
 
@@ -1154,7 +1199,7 @@ static int zsend_table_manager_connect_response(struct zserv *client,
 /* SRv6 locator add notification from zebra daemon. */
 int zsend_zebra_srv6_locator_add(struct zserv *client, struct srv6_locator *loc)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_SRV6_LOCATOR_ADD, VRF_DEFAULT);
 	zapi_srv6_locator_encode(s, loc);
@@ -1167,7 +1212,7 @@ int zsend_zebra_srv6_locator_add(struct zserv *client, struct srv6_locator *loc)
 int zsend_zebra_srv6_locator_delete(struct zserv *client,
 				    struct srv6_locator *loc)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_SRV6_LOCATOR_DELETE, VRF_DEFAULT);
 	zapi_srv6_locator_encode(s, loc);
@@ -2028,10 +2073,9 @@ static void zread_nhg_add(ZAPI_HANDLER_ARGS)
 
 }
 
-static void zread_route_add(ZAPI_HANDLER_ARGS)
+static void zapi_route_add(struct zserv *client, struct zebra_vrf *zvrf,
+			   struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
 	struct route_entry *re;
@@ -2039,36 +2083,28 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	struct nhg_backup_info *bnhg = NULL;
 	int ret;
 	vrf_id_t vrf_id;
-	struct nhg_hash_entry nhe, *n = NULL;
-
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0) {
-		if (IS_ZEBRA_DEBUG_RECV)
-			zlog_debug("%s: Unable to decode zapi_route sent",
-				   __func__);
-		return;
-	}
+	struct nhg_hash_entry *n = NULL;
 
 	vrf_id = zvrf_id(zvrf);
 
 	if (IS_ZEBRA_DEBUG_RECV)
 		zlog_debug("%s: p=(%u:%u)%pFX, msg flags=0x%x, flags=0x%x",
-			   __func__, vrf_id, api.tableid, &api.prefix,
-			   (int)api.message, api.flags);
+			   __func__, vrf_id, api->tableid, &api->prefix,
+			   (int)api->message, api->flags);
 
 	/* Allocate new route. */
 	re = zebra_rib_route_entry_new(
-		vrf_id, api.type, api.instance, api.flags, api.nhgid,
-		api.tableid ? api.tableid : zvrf->table_id, api.metric, api.mtu,
-		api.distance, api.tag);
+		vrf_id, api->type, api->instance, api->flags, api->nhgid,
+		api->tableid ? api->tableid : zvrf->table_id, api->metric,
+		api->mtu, api->distance, api->tag);
 
-	if (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NHG)
-	    && (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP)
-		|| api.nexthop_num == 0)) {
+	if (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG)
+	    && (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP)
+		|| api->nexthop_num == 0)) {
 		flog_warn(
 			EC_ZEBRA_RX_ROUTE_NO_NEXTHOPS,
 			"%s: received a route without nexthops for prefix %pFX from client %s",
-			__func__, &api.prefix,
+			__func__, &api->prefix,
 			zebra_route_string(client->proto));
 
 		XFREE(MTYPE_RE, re);
@@ -2076,23 +2112,24 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 
 	/* Report misuse of the backup flag */
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_BACKUP_NEXTHOPS)
-	    && api.backup_nexthop_num == 0) {
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_BACKUP_NEXTHOPS)
+	    && api->backup_nexthop_num == 0) {
 		if (IS_ZEBRA_DEBUG_RECV || IS_ZEBRA_DEBUG_EVENT)
 			zlog_debug(
 				"%s: client %s: BACKUP flag set but no backup nexthops, prefix %pFX",
 				__func__, zebra_route_string(client->proto),
-				&api.prefix);
+				&api->prefix);
 	}
 
 	if (!re->nhe_id
-	    && (!zapi_read_nexthops(client, &api.prefix, api.nexthops,
-				    api.flags, api.message, api.nexthop_num,
-				    api.backup_nexthop_num, &ng, NULL)
-		|| !zapi_read_nexthops(client, &api.prefix, api.backup_nexthops,
-				       api.flags, api.message,
-				       api.backup_nexthop_num,
-				       api.backup_nexthop_num, NULL, &bnhg))) {
+	    && (!zapi_read_nexthops(client, &api->prefix, api->nexthops,
+				    api->flags, api->message, api->nexthop_num,
+				    api->backup_nexthop_num, &ng, NULL)
+		|| !zapi_read_nexthops(client, &api->prefix,
+				       api->backup_nexthops, api->flags,
+				       api->message,
+				       api->backup_nexthop_num,
+				       api->backup_nexthop_num, NULL, &bnhg))) {
 
 		nexthop_group_delete(&ng);
 		zebra_nhg_backup_free(&bnhg);
@@ -2100,16 +2137,16 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		return;
 	}
 
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_OPAQUE)) {
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE)) {
 		re->opaque =
 			XMALLOC(MTYPE_RE_OPAQUE,
-				sizeof(struct re_opaque) + api.opaque.length);
-		re->opaque->length = api.opaque.length;
-		memcpy(re->opaque->data, api.opaque.data, re->opaque->length);
+				sizeof(struct re_opaque) + api->opaque.length);
+		re->opaque->length = api->opaque.length;
+		memcpy(re->opaque->data, api->opaque.data, re->opaque->length);
 	}
 
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received SRC Prefix but afi is not v6",
 			  __func__);
@@ -2119,13 +2156,13 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		XFREE(MTYPE_RE, re);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	if (api.safi != SAFI_UNICAST && api.safi != SAFI_MULTICAST) {
+	if (api->safi != SAFI_UNICAST && api->safi != SAFI_MULTICAST) {
 		flog_warn(EC_LIB_ZAPI_MISSMATCH,
 			  "%s: Received safi: %d but we can only accept UNICAST or MULTICAST",
-			  __func__, api.safi);
+			  __func__, api->safi);
 		nexthop_group_delete(&ng);
 		zebra_nhg_backup_free(&bnhg);
 		XFREE(MTYPE_RE_OPAQUE, re->opaque);
@@ -2139,17 +2176,22 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	 *
 	 * Havent figured out how to handle backup NHs with this yet, so lets
 	 * keep that separate.
-	 * Include backup info with the route. We use a temporary nhe here;
-	 * if this is a new/unknown nhe, a new copy will be allocated
-	 * and stored.
+	 * Include backup info with the route. The nhe handed to the rib
+	 * takes over the nexthops and backup info decoded above rather than
+	 * copying them; if it matches a known nhe, it is released again, and
+	 * if it is new, the hash table makes its own copy.
 	 */
 	if (!re->nhe_id) {
-		zebra_nhe_init(&nhe, afi, ng->nexthop);
-		nhe.nhg.nexthop = ng->nexthop;
-		nhe.backup_info = bnhg;
-		n = zebra_nhe_copy(&nhe, 0);
+		n = zebra_nhg_alloc();
+		zebra_nhe_init(n, afi, ng->nexthop);
+		n->dplane_ref = zebra_router_get_next_sequence();
+
+		n->nhg.nexthop = ng->nexthop;
+		ng->nexthop = NULL;
+		n->backup_info = bnhg;
+		bnhg = NULL;
 	}
-	ret = rib_add_multipath_nhe(afi, api.safi, &api.prefix, src_p, re, n,
+	ret = rib_add_multipath_nhe(afi, api->safi, &api->prefix, src_p, re, n,
 				    false);
 
 	/*
@@ -2171,7 +2213,7 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		zebra_nhg_backup_free(&bnhg);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		if (ret == 0)
 			client->v4_route_add_cnt++;
@@ -2187,49 +2229,58 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_add(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+
+	if (zapi_route_decode(msg, &api) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __func__);
+		return;
+	}
+
+	zapi_route_add(client, zvrf, &api);
+}
+
 void zapi_re_opaque_free(struct re_opaque *opaque)
 {
 	XFREE(MTYPE_RE_OPAQUE, opaque);
 }
 
-static void zread_route_del(ZAPI_HANDLER_ARGS)
+static void zapi_route_del(struct zserv *client, struct zebra_vrf *zvrf,
+			   struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
 	uint32_t table_id;
 
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0)
-		return;
-
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received a src prefix while afi is not v6",
 			  __func__);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	if (api.tableid)
-		table_id = api.tableid;
+	if (api->tableid)
+		table_id = api->tableid;
 	else
 		table_id = zvrf->table_id;
 
 	if (IS_ZEBRA_DEBUG_RECV)
 		zlog_debug("%s: p=(%u:%u)%pFX, msg flags=0x%x, flags=0x%x",
-			   __func__, zvrf_id(zvrf), table_id, &api.prefix,
-			   (int)api.message, api.flags);
+			   __func__, zvrf_id(zvrf), table_id, &api->prefix,
+			   (int)api->message, api->flags);
 
-	rib_delete(afi, api.safi, zvrf_id(zvrf), api.type, api.instance,
-		   api.flags, &api.prefix, src_p, NULL, 0, table_id, api.metric,
-		   api.distance, false);
+	rib_delete(afi, api->safi, zvrf_id(zvrf), api->type, api->instance,
+		   api->flags, &api->prefix, src_p, NULL, 0, table_id, api->metric,
+		   api->distance, false);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		client->v4_route_del_cnt++;
 		break;
@@ -2239,6 +2290,85 @@ static void zread_route_del(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_del(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+
+	if (zapi_route_decode(msg, &api) < 0)
+		return;
+
+	zapi_route_del(client, zvrf, &api);
+}
+
+/*
+ * Several route updates in one message, for the same VRF: a count, then
+ * for each route the command (ZEBRA_ROUTE_ADD or ZEBRA_ROUTE_DELETE), the
+ * length of the route and the route itself, encoded as in the single route
+ * messages.  Routes that fail to decode are skipped.
+ */
+static void zread_route_batch(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+	uint16_t count, len, i;
+	uint8_t cmd;
+	size_t endp, next;
+	int ret;
+
+	endp = stream_get_endp(msg);
+
+	STREAM_GETW(msg, count);
+
+	if (IS_ZEBRA_DEBUG_RECV)
+		zlog_debug("%s: %u routes from client %s", __func__, count,
+			   zebra_route_string(client->proto));
+
+	for (i = 0; i < count; i++) {
+		STREAM_GETC(msg, cmd);
+		STREAM_GETW(msg, len);
+		if (len > STREAM_READABLE(msg))
+			goto stream_failure;
+
+		/* Don't let a bad route eat into the next one */
+		next = stream_get_getp(msg) + len;
+		stream_set_endp(msg, next);
+		ret = zapi_route_decode(msg, &api);
+		stream_set_endp(msg, endp);
+		stream_set_getp(msg, next);
+
+		if (ret < 0) {
+			if (IS_ZEBRA_DEBUG_RECV)
+				zlog_debug("%s: Unable to decode zapi_route %u",
+					   __func__, i);
+			client->error_cnt++;
+			continue;
+		}
+
+		switch (cmd) {
+		case ZEBRA_ROUTE_ADD:
+			zapi_route_add(client, zvrf, &api);
+			break;
+		case ZEBRA_ROUTE_DELETE:
+			zapi_route_del(client, zvrf, &api);
+			break;
+		default:
+			flog_warn(EC_LIB_ZAPI_MISSMATCH,
+				  "%s: unexpected command %u in route batch from client %s",
+				  __func__, cmd,
+				  zebra_route_string(client->proto));
+			client->error_cnt++;
+			break;
+		}
+	}
+
+	return;
+
+stream_failure:
+	stream_set_endp(msg, endp);
+	if (IS_ZEBRA_DEBUG_RECV)
+		zlog_debug("%s: truncated route batch from client %s",
+			   __func__, zebra_route_string(client->proto));
+}
+
 /* MRIB Nexthop lookup for IPv4. */
 static void zread_nexthop_lookup_mrib(ZAPI_HANDLER_ARGS)
 {
@@ -2328,7 +2458,7 @@ stream_failure:
 
 static void zsend_capabilities(struct zserv *client, struct zebra_vrf *zvrf)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_CAPABILITIES, zvrf->vrf->vrf_id);
 	stream_putl(s, vrf_get_backend());
@@ -2386,9 +2516,7 @@ static void zread_hello(ZAPI_HANDLER_ARGS)
 		if (instance)
 			zlog_notice("client protocol instance %d", instance);
 
-		client->proto = proto;
-		client->instance = instance;
-		client->session_id = session_id;
+		zserv_client_set_id(client, proto, instance, session_id);
 
 		/* Graceful restart processing for client connect */
 		zebra_gr_client_reconnect(client);
@@ -2668,7 +2796,7 @@ int zsend_sr_policy_notify_status(uint32_t color, struct ipaddr *endpoint,
 			" to %d",
 			name, status);
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 	stream_reset(s);
 
 	zclient_create_header(s, ZEBRA_SR_POLICY_NOTIFY_STATUS, VRF_DEFAULT);
@@ -2685,7 +2813,7 @@ int zsend_sr_policy_notify_status(uint32_t color, struct ipaddr *endpoint,
 /* Send client close notify to client */
 int zsend_client_close_notify(struct zserv *client, struct zserv *closed_client)
 {
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_CLIENT_CLOSE_NOTIFY, VRF_DEFAULT);
 
@@ -2703,7 +2831,7 @@ int zsend_srv6_manager_get_locator_chunk_response(struct zserv *client,
 						  struct srv6_locator *loc)
 {
 	struct srv6_locator_chunk chunk = {};
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	strlcpy(chunk.locator_name, loc->name, sizeof(chunk.locator_name));
 	chunk.prefix = loc->prefix;
@@ -2748,8 +2876,7 @@ static void zread_table_manager_connect(struct zserv *client,
 	zlog_notice("client %d with vrf %s(%u) instance %u connected as %s",
 		    client->sock, VRF_LOGNAME(vrf), vrf_id, instance,
 		    zebra_route_string(proto));
-	client->proto = proto;
-	client->instance = instance;
+	zserv_client_set_id(client, proto, instance, client->session_id);
 
 	/*
 	 * Release previous labels of same protocol and instance.
@@ -2788,8 +2915,7 @@ static void zread_label_manager_connect(struct zserv *client,
 	}
 
 	/* recall proto and instance in this socket */
-	client->proto = proto;
-	client->instance = instance;
+	zserv_client_set_id(client, proto, instance, client->session_id);
 
 	/* call hook for connection using wrapper */
 	lm_client_connect_call(client, vrf_id);
@@ -3307,12 +3433,21 @@ static inline void zread_ipset_entry(ZAPI_HANDLER_ARGS)
 {
 	struct zebra_pbr_ipset_entry zpi;
 	struct zebra_pbr_ipset ipset;
+	struct zebra_pbr_ipset *backpointer = NULL;
+	char last_name[ZEBRA_IPSET_NAME_SIZE] = "";
+	bool held = false;
 	struct stream *s;
 	uint32_t total, i;
 
 	s = msg;
 	STREAM_GETL(s, total);
 
+	/* Entries in one message (bgpd sends up to 128) are passed to the
+	 * dataplane together.
+	 */
+	dplane_enqueue_hold();
+	held = true;
+
 	for (i = 0; i < total; i++) {
 		memset(&zpi, 0, sizeof(zpi));
 		memset(&ipset, 0, sizeof(ipset));
@@ -3364,9 +3499,18 @@ static inline void zread_ipset_entry(ZAPI_HANDLER_ARGS)
 			goto stream_failure;
 		}
 
-		/* calculate backpointer */
-		zpi.backpointer =
-			zebra_pbr_lookup_ipset_pername(ipset.ipset_name);
+		/* calculate backpointer;  the name lookup walks all ipsets,
+		 * but entries in a batch mostly belong to the same one.
+		 */
+		if (!backpointer
+		    || strncmp(last_name, ipset.ipset_name,
+			       ZEBRA_IPSET_NAME_SIZE)) {
+			backpointer = zebra_pbr_lookup_ipset_pername(
+				ipset.ipset_name);
+			strlcpy(last_name, ipset.ipset_name,
+				sizeof(last_name));
+		}
+		zpi.backpointer = backpointer;
 
 		if (!zpi.backpointer) {
 			zlog_warn("ipset name specified: %s does not exist",
@@ -3381,7 +3525,8 @@ static inline void zread_ipset_entry(ZAPI_HANDLER_ARGS)
 	}
 
 stream_failure:
-	return;
+	if (held)
+		dplane_enqueue_release();
 }
 
 
@@ -3435,7 +3580,7 @@ static inline void zebra_gre_get(ZAPI_HANDLER_ARGS)
 	if (ifp)
 		zebra_if = ifp->info;
 
-	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_GRE_UPDATE, vrf_id);
 
@@ -3661,7 +3806,7 @@ static void zsend_error_msg(struct zserv *client, enum zebra_error_types error,
 			    struct zmsghdr *bad_hdr)
 {
 
-	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	struct stream *s = stream_new_pooled(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_ERROR, bad_hdr->vrf_id);
 
@@ -3695,6 +3840,7 @@ void (*const zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_INTERFACE_SET_PROTODOWN] = zread_interface_set_protodown,
 	[ZEBRA_ROUTE_ADD] = zread_route_add,
 	[ZEBRA_ROUTE_DELETE] = zread_route_del,
+	[ZEBRA_ROUTE_BATCH] = zread_route_batch,
 	[ZEBRA_REDISTRIBUTE_ADD] = zebra_redistribute_add,
 	[ZEBRA_REDISTRIBUTE_DELETE] = zebra_redistribute_delete,
 	[ZEBRA_REDISTRIBUTE_DEFAULT_ADD] = zebra_redistribute_default_add,
@@ -3802,6 +3948,9 @@ void zserv_handle_commands(struct zserv *client, struct stream_fifo *fifo)
 
 		zapi_parse_header(msg, &hdr);
 
+		frrtrace(4, frr_zebra, zserv_recv, client->proto, hdr.command,
+			 hdr.length, hdr.vrf_id);
+
 		if (IS_ZEBRA_DEBUG_PACKET && IS_ZEBRA_DEBUG_RECV
 		    && IS_ZEBRA_DEBUG_DETAIL)
 			zserv_log_message(NULL, msg, &hdr);
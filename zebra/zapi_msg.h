@@ -67,6 +67,13 @@ extern int zsend_interface_update(int cmd, struct zserv *client,
 extern int zsend_redistribute_route(int cmd, struct zserv *zclient,
 				    const struct route_node *rn,
 				    const struct route_entry *re);
+/* Same, but the message is encoded into *msg on first use and copied for
+ * each client after that;  the caller frees *msg when done.
+ */
+extern int zsend_redistribute_route_msg(int cmd, struct zserv *zclient,
+					const struct route_node *rn,
+					const struct route_entry *re,
+					struct stream **msg);
 
 extern int zsend_router_id_update(struct zserv *zclient, afi_t afi,
 				  struct prefix *p, vrf_id_t vrf_id);
@@ -25,6 +25,7 @@
 #include "lib/debug.h"
 #include "lib/frratomic.h"
 #include "lib/frr_pthread.h"
+#include "lib/jhash.h"
 #include "lib/memory.h"
 #include "lib/queue.h"
 #include "lib/zebra.h"
@@ -34,10 +35,12 @@
 #include "zebra/zebra_vxlan_private.h"
 #include "zebra/zebra_mpls.h"
 #include "zebra/rt.h"
+#include "zebra/kernel_netlink.h"
 #include "zebra/debug.h"
 #include "zebra/zebra_pbr.h"
 #include "zebra/zebra_neigh.h"
 #include "printfrr.h"
+#include "zebra/zebra_trace.h"
 
 /* Memory types */
 DEFINE_MTYPE_STATIC(ZEBRA, DP_CTX, "Zebra DPlane Ctx");
@@ -45,11 +48,17 @@ DEFINE_MTYPE_STATIC(ZEBRA, DP_INTF, "Zebra DPlane Intf");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_PROV, "Zebra DPlane Provider");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_NETFILTER, "Zebra Netfilter Internal Object");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_NS, "DPlane NSes");
+DEFINE_MTYPE_STATIC(ZEBRA, DP_PROV_INST, "Zebra DPlane Provider Instance");
+DEFINE_MTYPE_STATIC(ZEBRA, DP_CTX_CACHE, "Zebra DPlane Ctx Cache");
 
 #ifndef AOK
 #  define AOK 0
 #endif
 
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
 /* Control for collection of extra interface info with route updates; a plugin
  * can enable the extra info via a dplane api.
  */
@@ -58,9 +67,25 @@ static bool dplane_collect_extra_intf_info;
 /* Enable test dataplane provider */
 /*#define DPLANE_TEST_PROVIDER 1 */
 
+/* Instances of multi-instance providers; set at startup, before the
+ * globals below are initialised.
+ */
+static unsigned int dplane_provider_instances = 1;
+
+/* Pthreads reading incoming netlink events, 0 to read them in the
+ * dataplane pthread; set at startup like the above.
+ */
+static unsigned int dplane_netlink_readers;
+
+/* Provider instance the current pthread runs, if any */
+static thread_local struct dplane_prov_instance *dplane_instance_self;
+
 /* Default value for max queued incoming updates */
 const uint32_t DPLANE_DEFAULT_MAX_QUEUED = 200;
 
+/* Max free contexts kept around by each pthread */
+#define DPLANE_CTX_CACHE_MAX 1024
+
 /* Default value for new work per cycle */
 const uint32_t DPLANE_DEFAULT_NEW_WORK = 100;
 
@@ -411,6 +436,22 @@ struct zebra_dplane_ctx {
 #define DPLANE_CTX_FLAG_NO_KERNEL 0x01
 
 
+/*
+ * One instance of a multi-instance provider: a pthread with its own
+ * inbound queue, filled by the dataplane pthread.
+ */
+struct dplane_prov_instance {
+	struct zebra_dplane_provider *prov;
+	unsigned int idx;
+
+	struct frr_pthread *fpt;
+	struct thread *t_work;
+
+	pthread_mutex_t mtx;
+	/* Requires: mtx */
+	struct dplane_ctx_q in_q;
+};
+
 /*
  * Registration block for one dataplane provider.
  */
@@ -455,6 +496,19 @@ struct zebra_dplane_provider {
 	 */
 	struct dplane_ctx_q dp_ctx_out_q;
 
+	/* Instances of a multi-instance provider, if it runs with more
+	 * than one.  dp_ctx_in_q then holds contexts waiting to be
+	 * dispatched to an instance.
+	 */
+	struct dplane_prov_instance *dp_instances;
+	unsigned int dp_ninstances;
+
+	/* Contexts dispatched to instances and not completed yet, and
+	 * whether those were sharded, or all sent to instance 0.
+	 */
+	_Atomic uint32_t dp_inflight;
+	bool dp_inflight_sharded;
+
 	/* Embedded list linkage for provider objects */
 	TAILQ_ENTRY(zebra_dplane_provider) dp_prov_link;
 };
@@ -471,6 +525,9 @@ struct dplane_zns_info {
 	/* Read event */
 	struct thread *t_read;
 
+	/* Netlink reader pthread this zns is read in, if there are any */
+	unsigned int reader;
+
 	/* List linkage */
 	struct zns_info_list_item link;
 };
@@ -500,6 +557,9 @@ static struct zebra_dplane_globals {
 	/* List of info about each zns */
 	struct zns_info_list_head dg_zns_list;
 
+	/* zns are spread across the netlink readers round-robin */
+	unsigned int dg_zns_next_reader;
+
 	/* Counter used to assign internal ids to providers */
 	uint32_t dg_provider_id;
 
@@ -577,6 +637,9 @@ static struct zebra_dplane_globals {
 	/* Event-delivery context 'master' for the dplane */
 	struct thread_master *dg_master;
 
+	/* Netlink reader pthreads, see dplane_set_netlink_readers() */
+	struct frr_pthread *dg_readers[DPLANE_MAX_NETLINK_READERS];
+
 	/* Event/'thread' pointer for queued updates */
 	struct thread *dg_t_update;
 
@@ -603,6 +666,7 @@ DECLARE_DLIST(zns_info_list, struct dplane_zns_info, link);
 
 /* Prototypes */
 static void dplane_thread_loop(struct thread *event);
+static void dplane_netlink_readers_stop(void);
 static enum zebra_dplane_result lsp_update_internal(struct zebra_lsp *lsp,
 						    enum dplane_op_e op);
 static enum zebra_dplane_result pw_update_internal(struct zebra_pw *pw,
@@ -632,16 +696,110 @@ struct thread_master *dplane_get_thread_master(void)
 	return zdplane_info.dg_master;
 }
 
+/*
+ * Per-pthread cache of free context blocks.  Contexts are mostly allocated
+ * and freed in the zebra main pthread, so a private list per pthread needs
+ * no locking at all; the caches are only linked together so they can be
+ * shown and drained at shutdown.  Counters are written by the owning
+ * pthread only.
+ */
+struct dplane_ctx_cache {
+	struct dplane_ctx_q free_q;
+	uint32_t count;
+
+	_Atomic uint64_t hits;
+	_Atomic uint64_t misses;
+
+	struct dplane_ctx_cache *next;
+};
+
+static thread_local struct dplane_ctx_cache *dplane_ctx_cache_self;
+
+static pthread_mutex_t dplane_ctx_caches_mtx = PTHREAD_MUTEX_INITIALIZER;
+/* Requires: dplane_ctx_caches_mtx */
+static struct dplane_ctx_cache *dplane_ctx_caches;
+/* Set once the caches are gone, during shutdown */
+static atomic_bool dplane_ctx_caches_done;
+
+static struct dplane_ctx_cache *dplane_ctx_cache_get(void)
+{
+	struct dplane_ctx_cache *cache = dplane_ctx_cache_self;
+
+	if (cache
+	    || atomic_load_explicit(&dplane_ctx_caches_done,
+				    memory_order_acquire))
+		return cache;
+
+	cache = XCALLOC(MTYPE_DP_CTX_CACHE, sizeof(*cache));
+	TAILQ_INIT(&cache->free_q);
+
+	frr_with_mutex (&dplane_ctx_caches_mtx) {
+		cache->next = dplane_ctx_caches;
+		dplane_ctx_caches = cache;
+	}
+
+	dplane_ctx_cache_self = cache;
+	return cache;
+}
+
+static void dplane_ctx_cache_inc(_Atomic uint64_t *counter)
+{
+	atomic_store_explicit(counter,
+			      atomic_load_explicit(counter,
+						   memory_order_relaxed) + 1,
+			      memory_order_relaxed);
+}
+
+/*
+ * Free all cached contexts.  Only safe once no other pthread uses the
+ * dplane anymore.
+ */
+static void dplane_ctx_caches_fini(void)
+{
+	struct dplane_ctx_cache *cache;
+	struct zebra_dplane_ctx *ctx;
+
+	frr_with_mutex (&dplane_ctx_caches_mtx) {
+		while ((cache = dplane_ctx_caches) != NULL) {
+			dplane_ctx_caches = cache->next;
+
+			while ((ctx = TAILQ_FIRST(&cache->free_q)) != NULL) {
+				TAILQ_REMOVE(&cache->free_q, ctx,
+					     zd_q_entries);
+				XFREE(MTYPE_DP_CTX, ctx);
+			}
+			XFREE(MTYPE_DP_CTX_CACHE, cache);
+		}
+		atomic_store_explicit(&dplane_ctx_caches_done, true,
+				      memory_order_release);
+	}
+
+	dplane_ctx_cache_self = NULL;
+}
+
 /*
  * Allocate a dataplane update context
  */
 struct zebra_dplane_ctx *dplane_ctx_alloc(void)
 {
+	struct dplane_ctx_cache *cache = dplane_ctx_cache_get();
 	struct zebra_dplane_ctx *p;
 
-	/* TODO -- just alloc'ing memory, but would like to maintain
-	 * a pool
-	 */
+	if (!cache)
+		return XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+
+	p = TAILQ_FIRST(&cache->free_q);
+	if (p) {
+		TAILQ_REMOVE(&cache->free_q, p, zd_q_entries);
+		cache->count--;
+		dplane_ctx_cache_inc(&cache->hits);
+
+		/* Internal allocations were released when it was freed */
+		memset(p, 0, sizeof(*p));
+		return p;
+	}
+
+	dplane_ctx_cache_inc(&cache->misses);
 	p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
 
 	return p;
@@ -847,20 +1005,27 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
  */
 static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 {
+	struct dplane_ctx_cache *cache;
+
 	if (pctx == NULL)
 		return;
 
 	DPLANE_CTX_VALID(*pctx);
 
-	/* TODO -- just freeing memory, but would like to maintain
-	 * a pool
-	 */
-
 	/* Some internal allocations may need to be freed, depending on
 	 * the type of info captured in the ctx.
 	 */
 	dplane_ctx_free_internal(*pctx);
 
+	/* Keep the block itself for reuse by this pthread */
+	cache = dplane_ctx_cache_get();
+	if (cache && cache->count < DPLANE_CTX_CACHE_MAX) {
+		TAILQ_INSERT_HEAD(&cache->free_q, *pctx, zd_q_entries);
+		cache->count++;
+		*pctx = NULL;
+		return;
+	}
+
 	XFREE(MTYPE_DP_CTX, *pctx);
 }
 
@@ -879,7 +1044,6 @@ void dplane_ctx_reset(struct zebra_dplane_ctx *ctx)
  */
 void dplane_ctx_fini(struct zebra_dplane_ctx **pctx)
 {
-	/* TODO -- maintain pool; for now, just free */
 	dplane_ctx_free(pctx);
 }
 
@@ -909,6 +1073,17 @@ struct zebra_dplane_ctx *dplane_ctx_get_head(struct dplane_ctx_q *q)
 	return ctx;
 }
 
+size_t dplane_ctx_queue_count(const struct dplane_ctx_q *q)
+{
+	const struct zebra_dplane_ctx *ctx;
+	size_t count = 0;
+
+	TAILQ_FOREACH (ctx, q, zd_q_entries)
+		count++;
+
+	return count;
+}
+
 /* Dequeue a context block from the head of a list */
 struct zebra_dplane_ctx *dplane_ctx_dequeue(struct dplane_ctx_q *q)
 {
@@ -2758,7 +2933,7 @@ int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 	{
 		struct nhg_hash_entry *nhe = zebra_nhg_resolve(re->nhe);
 
-		ctx->u.rinfo.nhe.id = nhe->id;
+		ctx->u.rinfo.nhe.id = zebra_nhg_kernel_id(nhe);
 		ctx->u.rinfo.nhe.old_id = 0;
 		/*
 		 * Check if the nhe is installed/queued before doing anything
@@ -2776,7 +2951,7 @@ int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 			goto done;
 		}
 
-		re->nhe_installed_id = nhe->id;
+		re->nhe_installed_id = ctx->u.rinfo.nhe.id;
 	}
 #endif /* HAVE_NETLINK */
 
@@ -3379,6 +3554,38 @@ dplane_ctx_ipset_entry_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 }
 
 
+/*
+ * Updates held back by the calling pthread, see dplane_enqueue_hold().
+ * Only the pthread itself touches these.
+ */
+static thread_local struct dplane_ctx_q dplane_held_q;
+static thread_local unsigned int dplane_hold_depth;
+
+void dplane_enqueue_hold(void)
+{
+	if (dplane_hold_depth++ == 0)
+		TAILQ_INIT(&dplane_held_q);
+}
+
+void dplane_enqueue_release(void)
+{
+	assert(dplane_hold_depth);
+	if (--dplane_hold_depth)
+		return;
+
+	if (TAILQ_EMPTY(&dplane_held_q))
+		return;
+
+	DPLANE_LOCK();
+	{
+		TAILQ_CONCAT(&zdplane_info.dg_update_ctx_q, &dplane_held_q,
+			     zd_q_entries);
+	}
+	DPLANE_UNLOCK();
+
+	dplane_provider_work_ready();
+}
+
 /*
  * Enqueue a new update,
  * and ensure an event is active for the dataplane pthread.
@@ -3389,12 +3596,16 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 	uint32_t high, curr;
 
 	/* Enqueue for processing by the dataplane pthread */
-	DPLANE_LOCK();
-	{
-		TAILQ_INSERT_TAIL(&zdplane_info.dg_update_ctx_q, ctx,
-				  zd_q_entries);
+	if (dplane_hold_depth) {
+		TAILQ_INSERT_TAIL(&dplane_held_q, ctx, zd_q_entries);
+	} else {
+		DPLANE_LOCK();
+		{
+			TAILQ_INSERT_TAIL(&zdplane_info.dg_update_ctx_q, ctx,
+					  zd_q_entries);
+		}
+		DPLANE_UNLOCK();
 	}
-	DPLANE_UNLOCK();
 
 	curr = atomic_fetch_add_explicit(
 		&(zdplane_info.dg_routes_queued),
@@ -3402,6 +3613,8 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 
 	curr++;	/* We got the pre-incremented value */
 
+	frrtrace(2, frr_zebra, dplane_enqueue, ctx->zd_op, curr);
+
 	/* Maybe update high-water counter also */
 	high = atomic_load_explicit(&zdplane_info.dg_routes_queued_max,
 				    memory_order_seq_cst);
@@ -3415,7 +3628,10 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 	}
 
 	/* Ensure that an event for the dataplane thread is active */
-	ret = dplane_provider_work_ready();
+	if (dplane_hold_depth)
+		ret = AOK;
+	else
+		ret = dplane_provider_work_ready();
 
 	return ret;
 }
@@ -5224,6 +5440,24 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 				    memory_order_relaxed);
 	vty_out(vty, "GRE set updates:       %"PRIu64"\n", incoming);
 	vty_out(vty, "GRE set errors:        %"PRIu64"\n", errs);
+
+	if (detailed) {
+		struct dplane_ctx_cache *cache;
+		uint64_t hits = 0, misses = 0;
+
+		frr_with_mutex (&dplane_ctx_caches_mtx) {
+			for (cache = dplane_ctx_caches; cache;
+			     cache = cache->next) {
+				hits += atomic_load_explicit(
+					&cache->hits, memory_order_relaxed);
+				misses += atomic_load_explicit(
+					&cache->misses, memory_order_relaxed);
+			}
+		}
+
+		vty_out(vty, "Ctx cache hits:           %" PRIu64 "\n", hits);
+		vty_out(vty, "Ctx cache misses:         %" PRIu64 "\n", misses);
+	}
 	return CMD_SUCCESS;
 }
 
@@ -5261,6 +5495,12 @@ int dplane_show_provs_helper(struct vty *vty, bool detailed)
 			prov->dp_name, prov->dp_id, in, in_q, in_max,
 			out, out_q, out_max);
 
+		if (prov->dp_ninstances)
+			vty_out(vty, "  instances: %u, in flight: %u\n",
+				prov->dp_ninstances,
+				atomic_load_explicit(&prov->dp_inflight,
+						     memory_order_relaxed));
+
 		DPLANE_LOCK();
 		prov = TAILQ_NEXT(prov, dp_prov_link);
 		DPLANE_UNLOCK();
@@ -5381,6 +5621,41 @@ int dplane_provider_get_work_limit(const struct zebra_dplane_provider *prov)
 	return zdplane_info.dg_updates_per_cycle;
 }
 
+void dplane_set_netlink_readers(unsigned int readers)
+{
+	dplane_netlink_readers = MIN(readers, DPLANE_MAX_NETLINK_READERS);
+}
+
+unsigned int dplane_get_netlink_readers(void)
+{
+	return dplane_netlink_readers;
+}
+
+void dplane_set_provider_instances(unsigned int instances)
+{
+	dplane_provider_instances =
+		MAX(1U, MIN(instances, DPLANE_MAX_PROVIDER_INSTANCES));
+}
+
+unsigned int dplane_get_provider_instances(void)
+{
+	return dplane_provider_instances;
+}
+
+unsigned int dplane_provider_get_instance(void)
+{
+	return dplane_instance_self ? dplane_instance_self->idx : 0;
+}
+
+/* Instance of 'prov' the current pthread runs, if any */
+static struct dplane_prov_instance *
+dplane_provider_self(const struct zebra_dplane_provider *prov)
+{
+	if (dplane_instance_self && dplane_instance_self->prov == prov)
+		return dplane_instance_self;
+	return NULL;
+}
+
 /* Lock/unlock a provider's mutex - iff the provider was registered with
  * the THREADED flag.
  */
@@ -5403,18 +5678,29 @@ struct zebra_dplane_ctx *dplane_provider_dequeue_in_ctx(
 	struct zebra_dplane_provider *prov)
 {
 	struct zebra_dplane_ctx *ctx = NULL;
+	struct dplane_prov_instance *inst = dplane_provider_self(prov);
+	struct dplane_ctx_q *q;
 
-	dplane_provider_lock(prov);
+	if (inst) {
+		pthread_mutex_lock(&inst->mtx);
+		q = &inst->in_q;
+	} else {
+		dplane_provider_lock(prov);
+		q = &prov->dp_ctx_in_q;
+	}
 
-	ctx = TAILQ_FIRST(&(prov->dp_ctx_in_q));
+	ctx = TAILQ_FIRST(q);
 	if (ctx) {
-		TAILQ_REMOVE(&(prov->dp_ctx_in_q), ctx, zd_q_entries);
+		TAILQ_REMOVE(q, ctx, zd_q_entries);
 
 		atomic_fetch_sub_explicit(&prov->dp_in_queued, 1,
 					  memory_order_relaxed);
 	}
 
-	dplane_provider_unlock(prov);
+	if (inst)
+		pthread_mutex_unlock(&inst->mtx);
+	else
+		dplane_provider_unlock(prov);
 
 	return ctx;
 }
@@ -5427,15 +5713,23 @@ int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
 {
 	int limit, ret;
 	struct zebra_dplane_ctx *ctx;
+	struct dplane_prov_instance *inst = dplane_provider_self(prov);
+	struct dplane_ctx_q *q;
 
 	limit = zdplane_info.dg_updates_per_cycle;
 
-	dplane_provider_lock(prov);
+	if (inst) {
+		pthread_mutex_lock(&inst->mtx);
+		q = &inst->in_q;
+	} else {
+		dplane_provider_lock(prov);
+		q = &prov->dp_ctx_in_q;
+	}
 
 	for (ret = 0; ret < limit; ret++) {
-		ctx = TAILQ_FIRST(&(prov->dp_ctx_in_q));
+		ctx = TAILQ_FIRST(q);
 		if (ctx) {
-			TAILQ_REMOVE(&(prov->dp_ctx_in_q), ctx, zd_q_entries);
+			TAILQ_REMOVE(q, ctx, zd_q_entries);
 
 			TAILQ_INSERT_TAIL(listp, ctx, zd_q_entries);
 		} else {
@@ -5447,7 +5741,10 @@ int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
 		atomic_fetch_sub_explicit(&prov->dp_in_queued, ret,
 					  memory_order_relaxed);
 
-	dplane_provider_unlock(prov);
+	if (inst)
+		pthread_mutex_unlock(&inst->mtx);
+	else
+		dplane_provider_unlock(prov);
 
 	return ret;
 }
@@ -5486,6 +5783,48 @@ void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
 
 	atomic_fetch_add_explicit(&(prov->dp_out_counter), 1,
 				  memory_order_relaxed);
+
+	if (dplane_provider_self(prov))
+		atomic_fetch_sub_explicit(&prov->dp_inflight, 1,
+					  memory_order_release);
+}
+
+/*
+ * Enqueue a list of completed contexts under one lock, listp is empty
+ * afterwards.
+ */
+void dplane_provider_enqueue_out_list(struct zebra_dplane_provider *prov,
+				      struct dplane_ctx_q *listp)
+{
+	struct zebra_dplane_ctx *ctx;
+	uint64_t curr, high;
+	uint32_t count = 0;
+
+	dplane_provider_lock(prov);
+
+	while ((ctx = TAILQ_FIRST(listp))) {
+		TAILQ_REMOVE(listp, ctx, zd_q_entries);
+		TAILQ_INSERT_TAIL(&(prov->dp_ctx_out_q), ctx, zd_q_entries);
+		count++;
+	}
+
+	/* Maintain out-queue counters */
+	curr = atomic_fetch_add_explicit(&(prov->dp_out_queued), count,
+					 memory_order_relaxed)
+	       + count;
+	high = atomic_load_explicit(&prov->dp_out_max, memory_order_relaxed);
+	if (curr > high)
+		atomic_store_explicit(&prov->dp_out_max, curr,
+				      memory_order_relaxed);
+
+	dplane_provider_unlock(prov);
+
+	atomic_fetch_add_explicit(&(prov->dp_out_counter), count,
+				  memory_order_relaxed);
+
+	if (dplane_provider_self(prov))
+		atomic_fetch_sub_explicit(&prov->dp_inflight, count,
+					  memory_order_release);
 }
 
 /*
@@ -5493,13 +5832,31 @@ void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
  */
 bool dplane_provider_is_threaded(const struct zebra_dplane_provider *prov)
 {
-	return (prov->dp_flags & DPLANE_PROV_FLAG_THREADED);
+	return (prov->dp_flags & DPLANE_PROV_FLAG_THREADED)
+	       || prov->dp_ninstances > 0;
+}
+
+/*
+ * Event loop that reads a zns' incoming events: its netlink reader
+ * pthread if there are any, the dplane pthread otherwise.  NULL before
+ * the dplane is started.
+ */
+static struct thread_master *dplane_zns_master(const struct dplane_zns_info *zi)
+{
+	struct frr_pthread *fpt;
+
+	if (dplane_netlink_readers == 0)
+		return zdplane_info.dg_master;
+
+	fpt = zdplane_info.dg_readers[zi->reader];
+	return fpt ? fpt->master : NULL;
 }
 
 #ifdef HAVE_NETLINK
 /*
  * Callback when an OS (netlink) incoming event read is ready. This runs
- * in the dplane pthread.
+ * in the dplane pthread, or in the zns' netlink reader pthread.  Parsed
+ * events reach zebra main as contexts, through the results callback.
  */
 static void dplane_incoming_read(struct thread *event)
 {
@@ -5508,7 +5865,7 @@ static void dplane_incoming_read(struct thread *event)
 	kernel_dplane_read(&zi->info);
 
 	/* Re-start read task */
-	thread_add_read(zdplane_info.dg_master, dplane_incoming_read, zi,
+	thread_add_read(event->master, dplane_incoming_read, zi,
 			zi->info.sock, &zi->t_read);
 }
 
@@ -5521,7 +5878,7 @@ static void dplane_incoming_request(struct thread *event)
 	struct dplane_zns_info *zi = THREAD_ARG(event);
 
 	/* Start read task */
-	thread_add_read(zdplane_info.dg_master, dplane_incoming_read, zi,
+	thread_add_read(event->master, dplane_incoming_read, zi,
 			zi->info.sock, &zi->t_read);
 
 	/* Send requests */
@@ -5531,17 +5888,18 @@ static void dplane_incoming_request(struct thread *event)
 /*
  * Initiate requests for existing info from the OS. This is called by the
  * main pthread, but we want all activity on the dplane netlink socket to
- * take place on the dplane pthread, so we schedule an event to accomplish
- * that.
+ * take place on the pthread reading it, so we schedule an event to
+ * accomplish that.
  */
 static void dplane_kernel_info_request(struct dplane_zns_info *zi)
 {
+	struct thread_master *master = dplane_zns_master(zi);
+
 	/* If we happen to encounter an enabled zns before the dplane
 	 * pthread is running, we'll initiate this later on.
 	 */
-	if (zdplane_info.dg_master)
-		thread_add_event(zdplane_info.dg_master,
-				 dplane_incoming_request, zi, 0,
+	if (master)
+		thread_add_event(master, dplane_incoming_request, zi, 0,
 				 &zi->t_request);
 }
 
@@ -5558,6 +5916,7 @@ static void dplane_kernel_info_request(struct dplane_zns_info *zi)
 void zebra_dplane_ns_enable(struct zebra_ns *zns, bool enabled)
 {
 	struct dplane_zns_info *zi;
+	struct thread_master *master;
 
 	if (IS_ZEBRA_DEBUG_DPLANE)
 		zlog_debug("%s: %s for nsid %u", __func__,
@@ -5575,6 +5934,9 @@ void zebra_dplane_ns_enable(struct zebra_ns *zns, bool enabled)
 			zi = XCALLOC(MTYPE_DP_NS, sizeof(*zi));
 
 			zi->info.ns_id = zns->ns_id;
+			if (dplane_netlink_readers)
+				zi->reader = zdplane_info.dg_zns_next_reader++
+					     % dplane_netlink_readers;
 
 			zns_info_list_add_tail(&zdplane_info.dg_zns_list, zi);
 
@@ -5602,12 +5964,10 @@ void zebra_dplane_ns_enable(struct zebra_ns *zns, bool enabled)
 		zns_info_list_del(&zdplane_info.dg_zns_list, zi);
 
 		/* Stop any outstanding tasks */
-		if (zdplane_info.dg_master) {
-			thread_cancel_async(zdplane_info.dg_master,
-					    &zi->t_request, NULL);
-
-			thread_cancel_async(zdplane_info.dg_master, &zi->t_read,
-					    NULL);
+		master = dplane_zns_master(zi);
+		if (master) {
+			thread_cancel_async(master, &zi->t_request, NULL);
+			thread_cancel_async(master, &zi->t_read, NULL);
 		}
 
 		XFREE(MTYPE_DP_NS, zi);
@@ -6033,6 +6393,16 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 
 	limit = dplane_provider_get_work_limit(prov);
 
+#if defined(HAVE_NETLINK)
+	/* With adaptive batching, hand everything that is queued to the
+	 * kernel in one go; the dplane queue limit still bounds this.
+	 */
+	if (netlink_batch_is_adaptive())
+		limit = MAX(limit, (int)atomic_load_explicit(
+					   &prov->dp_in_queued,
+					   memory_order_relaxed));
+#endif
+
 	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
 		zlog_debug("dplane provider '%s': processing",
 			   dplane_provider_get_name(prov));
@@ -6155,10 +6525,16 @@ static int test_dplane_shutdown_func(struct zebra_dplane_provider *prov,
 static void dplane_provider_init(void)
 {
 	int ret;
+	int flags = DPLANE_PROV_FLAGS_DEFAULT;
+
+#if defined(HAVE_NETLINK)
+	/* Each instance uses its own netlink socket */
+	flags |= DPLANE_PROV_FLAG_MULTI_INSTANCE;
+#endif
 
 	ret = dplane_provider_register("Kernel",
 				       DPLANE_PRIO_KERNEL,
-				       DPLANE_PROV_FLAGS_DEFAULT, NULL,
+				       flags, NULL,
 				       kernel_dplane_process_func,
 				       NULL,
 				       NULL, NULL);
@@ -6304,6 +6680,13 @@ static bool dplane_work_pending(void)
 		if (ctx != NULL)
 			break;
 
+		/* Work handed to instances */
+		if (atomic_load_explicit(&prov->dp_inflight,
+					 memory_order_relaxed)) {
+			ret = true;
+			goto done;
+		}
+
 		DPLANE_LOCK();
 		prov = TAILQ_NEXT(prov, dp_prov_link);
 		DPLANE_UNLOCK();
@@ -6326,6 +6709,7 @@ done:
 static void dplane_check_shutdown_status(struct thread *event)
 {
 	struct dplane_zns_info *zi;
+	struct thread_master *master;
 
 	if (IS_ZEBRA_DEBUG_DPLANE)
 		zlog_debug("Zebra dataplane shutdown status check called");
@@ -6334,7 +6718,11 @@ static void dplane_check_shutdown_status(struct thread *event)
 	frr_each_safe (zns_info_list, &zdplane_info.dg_zns_list, zi) {
 		zns_info_list_del(&zdplane_info.dg_zns_list, zi);
 
-		if (zdplane_info.dg_master) {
+		if (dplane_netlink_readers) {
+			master = dplane_zns_master(zi);
+			thread_cancel_async(master, &zi->t_read, NULL);
+			thread_cancel_async(master, &zi->t_request, NULL);
+		} else if (zdplane_info.dg_master) {
 			THREAD_OFF(zi->t_read);
 			THREAD_OFF(zi->t_request);
 		}
@@ -6379,6 +6767,154 @@ void zebra_dplane_finish(void)
 			 &zdplane_info.dg_t_shutdown_check);
 }
 
+/*
+ * Instance of a multi-instance provider to handle 'ctx' with: route
+ * updates are sharded by table and prefix, anything else returns -1 and
+ * goes to instance 0 in order with everything that isn't sharded.
+ */
+static int dplane_ctx_shard(const struct zebra_dplane_ctx *ctx,
+			    unsigned int ninstances)
+{
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+	case DPLANE_OP_ROUTE_DELETE:
+		return jhash_2words(dplane_ctx_get_table(ctx),
+				    prefix_hash_key(dplane_ctx_get_dest(ctx)),
+				    0)
+		       % ninstances;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Runs a multi-instance provider's callback in one of its instances.
+ * This runs in the instance's pthread.
+ */
+static void dplane_instance_work(struct thread *event)
+{
+	struct dplane_prov_instance *inst = THREAD_ARG(event);
+	bool more;
+
+	dplane_instance_self = inst;
+
+	(*inst->prov->dp_fp)(inst->prov);
+
+	frr_with_mutex (&inst->mtx) {
+		more = !TAILQ_EMPTY(&inst->in_q);
+	}
+	if (more)
+		thread_add_event(inst->fpt->master, dplane_instance_work, inst,
+				 0, &inst->t_work);
+
+	/* Have the dplane pthread collect the results */
+	dplane_provider_work_ready();
+}
+
+/*
+ * Moves a multi-instance provider's new work to its instances, in order,
+ * until a switch between sharded and unsharded work has to wait for the
+ * work in flight.  This runs in the dplane pthread.
+ */
+static void dplane_provider_dispatch(struct zebra_dplane_provider *prov)
+{
+	bool wake[DPLANE_MAX_PROVIDER_INSTANCES] = {};
+	struct dplane_prov_instance *inst;
+	struct zebra_dplane_ctx *ctx;
+	unsigned int i;
+	int shard;
+
+	dplane_provider_lock(prov);
+
+	while ((ctx = TAILQ_FIRST(&(prov->dp_ctx_in_q)))) {
+		shard = dplane_ctx_shard(ctx, prov->dp_ninstances);
+
+		if ((shard >= 0) != prov->dp_inflight_sharded) {
+			if (atomic_load_explicit(&prov->dp_inflight,
+						 memory_order_acquire))
+				break;
+			prov->dp_inflight_sharded = (shard >= 0);
+		}
+
+		if (shard < 0)
+			shard = 0;
+
+		TAILQ_REMOVE(&(prov->dp_ctx_in_q), ctx, zd_q_entries);
+		atomic_fetch_add_explicit(&prov->dp_inflight, 1,
+					  memory_order_relaxed);
+
+		inst = &prov->dp_instances[shard];
+		frr_with_mutex (&inst->mtx) {
+			TAILQ_INSERT_TAIL(&inst->in_q, ctx, zd_q_entries);
+		}
+		wake[shard] = true;
+	}
+
+	dplane_provider_unlock(prov);
+
+	for (i = 0; i < prov->dp_ninstances; i++) {
+		inst = &prov->dp_instances[i];
+		if (wake[i])
+			thread_add_event(inst->fpt->master,
+					 dplane_instance_work, inst, 0,
+					 &inst->t_work);
+	}
+}
+
+/*
+ * Starts the pthreads of a multi-instance provider; called in the zebra
+ * main pthread from zebra_dplane_start().
+ */
+static void dplane_provider_instances_start(struct zebra_dplane_provider *prov)
+{
+	struct dplane_prov_instance *inst;
+	unsigned int i, n = dplane_provider_instances;
+	/* room for the full provider name and instance number */
+	char name[DPLANE_PROVIDER_NAMELEN + 32];
+	char os_name[OS_THREAD_NAMELEN];
+
+	prov->dp_instances = XCALLOC(MTYPE_DP_PROV_INST,
+				     n * sizeof(*prov->dp_instances));
+
+	for (i = 0; i < n; i++) {
+		inst = &prov->dp_instances[i];
+		inst->prov = prov;
+		inst->idx = i;
+		pthread_mutex_init(&inst->mtx, NULL);
+		TAILQ_INIT(&inst->in_q);
+
+		snprintf(name, sizeof(name), "Zebra dplane %s %u",
+			 prov->dp_name, i);
+		snprintf(os_name, sizeof(os_name), "zebra_dp%u",
+			 MIN(i, DPLANE_MAX_PROVIDER_INSTANCES));
+		inst->fpt = frr_pthread_new(NULL, name, os_name);
+		frr_pthread_run(inst->fpt, NULL);
+	}
+
+	/* The provider's lock is used from here on */
+	prov->dp_ninstances = n;
+
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("dplane: started %u instances of provider '%s'", n,
+			   prov->dp_name);
+}
+
+static void dplane_provider_instances_stop(struct zebra_dplane_provider *prov)
+{
+	struct dplane_prov_instance *inst;
+	unsigned int i;
+
+	for (i = 0; i < prov->dp_ninstances; i++) {
+		inst = &prov->dp_instances[i];
+
+		thread_cancel_async(inst->fpt->master, &inst->t_work, NULL);
+		frr_pthread_stop(inst->fpt, NULL);
+		frr_pthread_destroy(inst->fpt);
+		inst->fpt = NULL;
+	}
+}
+
 /*
  * Main dataplane pthread event loop. The thread takes new incoming work
  * and offers it to the first provider. It then iterates through the
@@ -6440,6 +6976,8 @@ static void dplane_thread_loop(struct thread *event)
 	atomic_fetch_sub_explicit(&zdplane_info.dg_routes_queued, counter,
 				  memory_order_relaxed);
 
+	frrtrace(1, frr_zebra, dplane_dequeue, counter);
+
 	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
 		zlog_debug("dplane: incoming new work counter: %d", counter);
 
@@ -6509,9 +7047,13 @@ static void dplane_thread_loop(struct thread *event)
 
 		/* Call into the provider code. Note that this is
 		 * unconditional: we offer to do work even if we don't enqueue
-		 * any _new_ work.
+		 * any _new_ work.  Multi-instance providers are called in
+		 * their instances' pthreads instead.
 		 */
-		(*prov->dp_fp)(prov);
+		if (prov->dp_ninstances)
+			dplane_provider_dispatch(prov);
+		else
+			(*prov->dp_fp)(prov);
 
 		/* Check for zebra shutdown */
 		if (!zdplane_info.dg_run)
@@ -6589,6 +7131,9 @@ void zebra_dplane_shutdown(void)
 	if (IS_ZEBRA_DEBUG_DPLANE)
 		zlog_debug("Zebra dataplane shutdown called");
 
+	/* Stop the netlink readers; their zns are gone already */
+	dplane_netlink_readers_stop();
+
 	/* Stop dplane thread, if it's running */
 
 	zdplane_info.dg_run = false;
@@ -6604,6 +7149,9 @@ void zebra_dplane_shutdown(void)
 	zdplane_info.dg_pthread = NULL;
 	zdplane_info.dg_master = NULL;
 
+	TAILQ_FOREACH(dp, &zdplane_info.dg_providers_q, dp_prov_link)
+		dplane_provider_instances_stop(dp);
+
 	/* Notify provider(s) of final shutdown.
 	 * Note that this call is in the main pthread, so providers must
 	 * be prepared for that.
@@ -6615,6 +7163,8 @@ void zebra_dplane_shutdown(void)
 		dp->dp_fini(dp, false);
 	}
 
+	dplane_ctx_caches_fini();
+
 	/* TODO -- Clean-up provider objects */
 
 	/* TODO -- Clean queue(s), free memory */
@@ -6641,6 +7191,39 @@ static void zebra_dplane_init_internal(void)
 	dplane_provider_init();
 }
 
+static void dplane_netlink_readers_start(void)
+{
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop
+	};
+	char name[64], os_name[16];
+	unsigned int i;
+
+	for (i = 0; i < dplane_netlink_readers; i++) {
+		snprintf(name, sizeof(name), "Zebra netlink reader %u", i);
+		snprintf(os_name, sizeof(os_name), "zebra_nlread%u", i);
+
+		zdplane_info.dg_readers[i] = frr_pthread_new(&pattr, name,
+							     os_name);
+		frr_pthread_run(zdplane_info.dg_readers[i], NULL);
+	}
+}
+
+static void dplane_netlink_readers_stop(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < dplane_netlink_readers; i++) {
+		if (!zdplane_info.dg_readers[i])
+			continue;
+
+		frr_pthread_stop(zdplane_info.dg_readers[i], NULL);
+		frr_pthread_destroy(zdplane_info.dg_readers[i]);
+		zdplane_info.dg_readers[i] = NULL;
+	}
+}
+
 /*
  * Start the dataplane pthread. This step needs to be run later than the
  * 'init' step, in case zebra has fork-ed.
@@ -6667,10 +7250,12 @@ void zebra_dplane_start(void)
 	thread_add_event(zdplane_info.dg_master, dplane_thread_loop, NULL, 0,
 			 &zdplane_info.dg_t_update);
 
+	dplane_netlink_readers_start();
+
 	/* Enqueue requests and reads if necessary */
 	frr_each (zns_info_list, &zdplane_info.dg_zns_list, zi) {
 #if defined(HAVE_NETLINK)
-		thread_add_read(zdplane_info.dg_master, dplane_incoming_read,
+		thread_add_read(dplane_zns_master(zi), dplane_incoming_read,
 				zi, zi->info.sock, &zi->t_read);
 		dplane_kernel_info_request(zi);
 #endif
@@ -6684,6 +7269,10 @@ void zebra_dplane_start(void)
 
 	while (prov) {
 
+		if ((prov->dp_flags & DPLANE_PROV_FLAG_MULTI_INSTANCE)
+		    && dplane_provider_instances > 1)
+			dplane_provider_instances_start(prov);
+
 		if (prov->dp_start)
 			(prov->dp_start)(prov);
 
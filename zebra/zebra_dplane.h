@@ -311,6 +311,8 @@ void dplane_ctx_list_append(struct dplane_ctx_q *to_list,
 /* Dequeue a context block from the head of caller's tailq */
 struct zebra_dplane_ctx *dplane_ctx_dequeue(struct dplane_ctx_q *q);
 struct zebra_dplane_ctx *dplane_ctx_get_head(struct dplane_ctx_q *q);
+/* Number of context blocks on a tailq, walks the list */
+size_t dplane_ctx_queue_count(const struct dplane_ctx_q *q);
 
 /*
  * Accessors for information from the context object
@@ -897,6 +899,16 @@ void dplane_set_in_queue_limit(uint32_t limit, bool set);
 /* Retrieve the current queue depth of incoming, unprocessed updates */
 uint32_t dplane_get_in_queue_len(void);
 
+/*
+ * Hold back updates enqueued by the calling pthread until the matching
+ * release, and hand them to the dataplane pthread all at once.  This
+ * saves taking the queue lock and waking the dataplane for each of them,
+ * and lets the kernel provider put many of them into one netlink batch.
+ * Calls nest.
+ */
+void dplane_enqueue_hold(void);
+void dplane_enqueue_release(void);
+
 /*
  * Vty/cli apis
  */
@@ -933,6 +945,20 @@ enum dplane_provider_prio {
 /* Provider will be spawning its own worker thread */
 #define DPLANE_PROV_FLAG_THREADED  0x1
 
+/* Provider can run as several instances in parallel, see
+ * dplane_set_provider_instances().  Route updates are sharded across the
+ * instances by prefix, so that updates to one prefix are still handled in
+ * order; all other updates are handled by instance 0, and the dplane
+ * waits for in-flight work to complete whenever it switches between the
+ * two, so e.g. a nexthop group is installed before the routes using it.
+ * The provider's callback runs on each instance's pthread, and must only
+ * use the dplane_provider_* apis to access its queues.
+ */
+#define DPLANE_PROV_FLAG_MULTI_INSTANCE 0x2
+
+/* Maximum number of instances of a multi-instance provider */
+#define DPLANE_MAX_PROVIDER_INSTANCES 16
+
 /* Provider registration: ordering or priority value, callbacks, and optional
  * opaque data value. If 'prov_p', return the newly-allocated provider object
  * on success.
@@ -981,6 +1007,30 @@ void dplane_provider_unlock(struct zebra_dplane_provider *prov);
 /* Obtain thread_master for dataplane thread */
 struct thread_master *dplane_get_thread_master(void);
 
+/* Number of instances that multi-instance providers run with; must be set
+ * before zebra_dplane_init().  The default is 1, which runs all providers
+ * in the dataplane pthread.
+ */
+void dplane_set_provider_instances(unsigned int instances);
+unsigned int dplane_get_provider_instances(void);
+
+/* Maximum number of netlink reader pthreads */
+#define DPLANE_MAX_NETLINK_READERS 8
+
+/* Read incoming netlink events on this many pthreads of their own, with
+ * the namespaces spread across them, rather than on the dataplane
+ * pthread; must be set before zebra_dplane_start().  Events are parsed
+ * into contexts there and handed to zebra main with the dplane results.
+ * The default is 0.
+ */
+void dplane_set_netlink_readers(unsigned int readers);
+unsigned int dplane_get_netlink_readers(void);
+
+/* Index of the provider instance the caller is running in; 0 if it isn't
+ * running in a multi-instance provider's pthread.
+ */
+unsigned int dplane_provider_get_instance(void);
+
 /* Providers should (generally) limit number of updates per work cycle */
 int dplane_provider_get_work_limit(const struct zebra_dplane_provider *prov);
 
@@ -1004,6 +1054,10 @@ uint32_t dplane_provider_out_ctx_queue_len(struct zebra_dplane_provider *prov);
 void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
 				     struct zebra_dplane_ctx *ctx);
 
+/* Same for a whole list of contexts, taking the lock only once */
+void dplane_provider_enqueue_out_list(struct zebra_dplane_provider *prov,
+				      struct dplane_ctx_q *listp);
+
 /* Enqueue a context directly to zebra main. */
 void dplane_provider_enqueue_to_zebra(struct zebra_dplane_ctx *ctx);
 
@@ -47,48 +47,44 @@ DEFINE_MTYPE_STATIC(ZEBRA, MAC, "EVPN MAC");
  * Return number of valid MACs in an EVPN's MAC hash table - all
  * remote MACs and non-internal (auto) local MACs count.
  */
+static void num_valid_macs_hash(struct hash_bucket *bucket, void *arg)
+{
+	struct zebra_mac *mac = bucket->data;
+	uint32_t *num_macs = arg;
+
+	if (CHECK_FLAG(mac->flags, ZEBRA_MAC_REMOTE)
+	    || CHECK_FLAG(mac->flags, ZEBRA_MAC_LOCAL)
+	    || !CHECK_FLAG(mac->flags, ZEBRA_MAC_AUTO))
+		(*num_macs)++;
+}
+
 uint32_t num_valid_macs(struct zebra_evpn *zevpn)
 {
-	unsigned int i;
 	uint32_t num_macs = 0;
-	struct hash *hash;
-	struct hash_bucket *hb;
-	struct zebra_mac *mac;
 
-	hash = zevpn->mac_table;
-	if (!hash)
-		return num_macs;
-	for (i = 0; i < hash->size; i++) {
-		for (hb = hash->index[i]; hb; hb = hb->next) {
-			mac = (struct zebra_mac *)hb->data;
-			if (CHECK_FLAG(mac->flags, ZEBRA_MAC_REMOTE)
-			    || CHECK_FLAG(mac->flags, ZEBRA_MAC_LOCAL)
-			    || !CHECK_FLAG(mac->flags, ZEBRA_MAC_AUTO))
-				num_macs++;
-		}
-	}
+	/* the MAC table resizes incrementally, don't look at its index */
+	if (zevpn->mac_table)
+		hash_iterate(zevpn->mac_table, num_valid_macs_hash, &num_macs);
 
 	return num_macs;
 }
 
+static void num_dup_detected_macs_hash(struct hash_bucket *bucket, void *arg)
+{
+	struct zebra_mac *mac = bucket->data;
+	uint32_t *num_macs = arg;
+
+	if (CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
+		(*num_macs)++;
+}
+
 uint32_t num_dup_detected_macs(struct zebra_evpn *zevpn)
 {
-	unsigned int i;
 	uint32_t num_macs = 0;
-	struct hash *hash;
-	struct hash_bucket *hb;
-	struct zebra_mac *mac;
 
-	hash = zevpn->mac_table;
-	if (!hash)
-		return num_macs;
-	for (i = 0; i < hash->size; i++) {
-		for (hb = hash->index[i]; hb; hb = hb->next) {
-			mac = (struct zebra_mac *)hb->data;
-			if (CHECK_FLAG(mac->flags, ZEBRA_MAC_DUPLICATE))
-				num_macs++;
-		}
-	}
+	if (zevpn->mac_table)
+		hash_iterate(zevpn->mac_table, num_dup_detected_macs_hash,
+			     &num_macs);
 
 	return num_macs;
 }
@@ -1335,7 +1331,12 @@ int zebra_evpn_mac_send_del_to_client(vni_t vni, const struct ethaddr *macaddr,
  */
 struct hash *zebra_mac_db_create(const char *desc)
 {
-	return hash_create_size(8, mac_hash_keymake, mac_cmp, desc);
+	struct hash *mac_table;
+
+	mac_table = hash_create_size(8, mac_hash_keymake, mac_cmp, desc);
+	hash_set_incremental(mac_table, true);
+
+	return mac_table;
 }
 
 /* program sync mac flags in the dataplane  */
@@ -127,8 +127,6 @@ static void zebra_gr_client_info_delte(struct zserv *client,
 
 	THREAD_OFF(info->t_stale_removal);
 
-	XFREE(MTYPE_TMP, info->current_prefix);
-
 	LOG_GR("%s: Instance info is being deleted for client %s", __func__,
 	       zebra_route_string(client->proto));
 
@@ -222,7 +220,7 @@ static void zebra_gr_delete_stale_client(struct client_gr_info *info)
 	TAILQ_INIT(&(s_client->gr_info_queue));
 	listnode_delete(zrouter.stale_client_list, s_client);
 	if (info->stale_client)
-		XFREE(MTYPE_TMP, s_client);
+		rcu_free(MTYPE_TMP, s_client, rcu_head);
 	XFREE(MTYPE_TMP, info);
 }
 
@@ -288,7 +286,7 @@ void zebra_gr_client_reconnect(struct zserv *client)
 	/* Delete the stale client */
 	listnode_delete(zrouter.stale_client_list, old_client);
 	/* Delete old client */
-	XFREE(MTYPE_TMP, old_client);
+	rcu_free(MTYPE_TMP, old_client, rcu_head);
 }
 
 /*
@@ -474,7 +472,7 @@ static void zebra_gr_route_stale_delete_timer_expiry(struct thread *thread)
 		LOG_GR("%s: Client %s all stale routes processed", __func__,
 		       zebra_route_string(client->proto));
 
-		XFREE(MTYPE_TMP, info->current_prefix);
+		info->current_re = NULL;
 		info->current_afi = 0;
 		zebra_gr_delete_stale_client(info);
 	}
@@ -503,19 +501,18 @@ static void zebra_gr_process_route_entry(struct zserv *client,
 }
 
 /*
- * This function walks through the route table for all vrf and deletes
- * the stale routes for the restarted client specified by the protocol
- * type
+ * This function walks through the routes of the restarted client (as kept
+ * in the tables' per type lists) and deletes the stale ones.  Routes of
+ * other protocols are not visited at all.
  */
 static int32_t zebra_gr_delete_stale_route(struct client_gr_info *info,
 					   struct zebra_vrf *zvrf)
 {
-	struct route_node *rn, *curr;
-	struct route_entry *re;
-	struct route_entry *next;
+	struct re_owner_list_head *owners;
+	struct route_entry *re, *next;
 	struct route_table *table;
 	int32_t n = 0;
-	afi_t afi, curr_afi;
+	afi_t afi;
 	uint8_t proto;
 	uint16_t instance;
 	struct zserv *s_client;
@@ -531,73 +528,88 @@ static int32_t zebra_gr_delete_stale_route(struct client_gr_info *info,
 
 	proto = s_client->proto;
 	instance = s_client->instance;
-	curr_afi = info->current_afi;
 
 	LOG_GR("%s: Client %s stale routes are being deleted", __func__,
 	       zebra_route_string(proto));
 
 	/* Process routes for all AFI */
-	for (afi = curr_afi; afi < AFI_MAX; afi++) {
+	for (afi = info->current_afi; afi < AFI_MAX; afi++) {
 		table = zvrf->table[afi][SAFI_UNICAST];
+		if (!table)
+			continue;
+
+		owners = &rib_table_info(table)->owners[proto];
+
+		/* Continue where the last run stopped, if it did in here */
+		re = info->current_re;
+		info->current_re = NULL;
+		if (!re)
+			re = re_owner_list_first(owners);
+
+		for (; re; re = next) {
+			next = re_owner_list_next(owners, re);
+
+			if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED)
+			    || re->instance != instance)
+				continue;
 
-		if (table) {
-			/*
-			 * If the current prefix is NULL then get the first
-			 * route entry in the table
+			/* If the route refresh is received after restart
+			 * then do not delete the route
 			 */
-			if (info->current_prefix == NULL) {
-				rn = route_top(table);
-				if (rn == NULL)
-					continue;
-				curr = rn;
-			} else
-				/* Get the next route entry */
-				curr = route_table_get_next(
-					table, info->current_prefix);
-
-			for (rn = curr; rn; rn = srcdest_route_next(rn)) {
-				RNODE_FOREACH_RE_SAFE (rn, re, next) {
-					if (CHECK_FLAG(re->status,
-						       ROUTE_ENTRY_REMOVED))
-						continue;
-					/* If the route refresh is received
-					 * after restart then do not delete
-					 * the route
-					 */
-					if (re->type == proto
-					    && re->instance == instance) {
-						zebra_gr_process_route_entry(
-							s_client, rn, re);
-						n++;
-					}
-
-					/* If the max route count is reached
-					 * then timer thread will be restarted
-					 * Store the current prefix and afi
-					 */
-					if ((n >= ZEBRA_MAX_STALE_ROUTE_COUNT)
-					    && (info->do_delete == false)) {
-						info->current_afi = afi;
-						info->current_prefix = XCALLOC(
-							MTYPE_TMP,
-							sizeof(struct prefix));
-						prefix_copy(
-							info->current_prefix,
-							&rn->p);
-						return n;
-					}
-				}
+			zebra_gr_process_route_entry(s_client, re->rn, re);
+			n++;
+
+			/* If the max route count is reached then timer thread
+			 * will be restarted, store where to continue.
+			 */
+			if (n >= ZEBRA_MAX_STALE_ROUTE_COUNT
+			    && info->do_delete == false && next) {
+				info->current_afi = afi;
+				info->current_re = next;
+				SET_FLAG(next->status, ROUTE_ENTRY_GR_CURSOR);
+				return n;
 			}
 		}
-		/*
-		 * Reset the current prefix to indicate processing completion
-		 * of the current AFI
-		 */
-		XFREE(MTYPE_TMP, info->current_prefix);
 	}
 	return 0;
 }
 
+/*
+ * A route is going away, move any sweep that was going to continue with it
+ * on to the next one.
+ */
+static void zebra_gr_route_unlink_client(struct zserv *client,
+					 struct route_entry *re)
+{
+	struct rib_table_info *tinfo;
+	struct client_gr_info *info;
+	struct route_entry *next;
+
+	TAILQ_FOREACH (info, &client->gr_info_queue, gr_info) {
+		if (info->current_re != re)
+			continue;
+
+		tinfo = srcdest_rnode_table_info(re->rn);
+		next = re_owner_list_next(&tinfo->owners[re->type], re);
+		info->current_re = next;
+		if (next)
+			SET_FLAG(next->status, ROUTE_ENTRY_GR_CURSOR);
+		else
+			info->current_afi = tinfo->afi + 1;
+	}
+}
+
+void zebra_gr_route_unlink(struct route_entry *re)
+{
+	struct listnode *node;
+	struct zserv *client;
+
+	for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client))
+		zebra_gr_route_unlink_client(client, re);
+	for (ALL_LIST_ELEMENTS_RO(zrouter.stale_client_list, node, client))
+		zebra_gr_route_unlink_client(client, re);
+}
+
 /*
  * Delete the stale routes when client is restarted and routes are not
  * refreshed within the stale timeout
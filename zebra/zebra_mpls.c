@@ -53,6 +53,33 @@ DEFINE_MTYPE_STATIC(ZEBRA, LSP, "MPLS LSP object");
 DEFINE_MTYPE_STATIC(ZEBRA, FEC, "MPLS FEC object");
 DEFINE_MTYPE_STATIC(ZEBRA, NHLFE, "MPLS nexthop object");
 
+/* LSPs scheduled for processing;  the work queue itself only ever holds
+ * a single item pointing here, like the rib meta queue.
+ */
+static struct lsp_sched_head lsp_sched_q;
+
+/* Max. LSPs processed per work queue call, their dplane updates are handed
+ * over together.
+ */
+#define LSP_PROCESS_BATCH 256
+
+/* FEC label changes are sent to clients after a short hold-down, so that
+ * a burst of changes (e.g. from a new SRGB) goes out in few messages.
+ */
+static struct fec_pending_head fec_pending_q;
+static struct thread *fec_update_timer;
+
+#define FEC_UPDATE_HOLD_MSEC 10
+
+/* family, prefix length, prefix and label */
+#define FEC_UPDATE_ENTRY_MAX (2 + 1 + IPV6_MAX_BYTELEN + 4)
+
+static struct {
+	uint64_t updates_sent;
+	uint64_t msgs_sent;
+	uint64_t updates_suppressed;
+} fec_update_stats;
+
 bool mpls_enabled;
 bool mpls_pw_reach_strict; /* Strict reachability checking */
 
@@ -86,8 +113,9 @@ static int nhlfe_nexthop_active(struct zebra_nhlfe *nhlfe);
 static void lsp_select_best_nhlfe(struct zebra_lsp *lsp);
 static void lsp_uninstall_from_kernel(struct hash_bucket *bucket, void *ctxt);
 static void lsp_schedule(struct hash_bucket *bucket, void *ctxt);
-static wq_item_status lsp_process(struct work_queue *wq, void *data);
-static void lsp_processq_del(struct work_queue *wq, void *data);
+static void lsp_process(struct zebra_lsp *lsp);
+static void lsp_process_done(struct zebra_lsp *lsp);
+static wq_item_status lsp_processq_run(struct work_queue *wq, void *data);
 static void lsp_processq_complete(struct work_queue *wq);
 static int lsp_processq_add(struct zebra_lsp *lsp);
 static void *lsp_alloc(void *p);
@@ -440,43 +468,114 @@ static int fec_change_update_lsp(struct zebra_vrf *zvrf, struct zebra_fec *fec,
 	return 0;
 }
 
+/*
+ * Encode FEC binding; a ZEBRA_FEC_UPDATE message carries one or more.
+ */
+static void fec_put(struct stream *s, struct zebra_fec *fec)
+{
+	struct route_node *rn = fec->rn;
+
+	stream_putw(s, rn->p.family);
+	stream_put_prefix(s, &rn->p);
+	stream_putl(s, fec->label);
+}
+
 /*
  * Inform about FEC to a registered client.
  */
 static int fec_send(struct zebra_fec *fec, struct zserv *client)
 {
 	struct stream *s;
-	struct route_node *rn;
-
-	rn = fec->rn;
 
 	/* Get output stream. */
 	s = stream_new(ZEBRA_MAX_PACKET_SIZ);
 
 	zclient_create_header(s, ZEBRA_FEC_UPDATE, VRF_DEFAULT);
 
-	stream_putw(s, rn->p.family);
-	stream_put_prefix(s, &rn->p);
-	stream_putl(s, fec->label);
+	fec_put(s, fec);
 	stream_putw_at(s, 0, stream_get_endp(s));
+	fec_update_stats.updates_sent++;
+	fec_update_stats.msgs_sent++;
 	return zserv_send_message(client, s);
 }
 
+static void fec_update_flush(struct zserv *client, struct stream *s,
+			     unsigned int count)
+{
+	if (IS_ZEBRA_DEBUG_MPLS)
+		zlog_debug("Update client %s, %u FECs",
+			   zebra_route_string(client->proto), count);
+
+	stream_putw_at(s, 0, stream_get_endp(s));
+	zserv_send_message(client, s);
+	fec_update_stats.msgs_sent++;
+}
+
 /*
- * Update all registered clients about this FEC. Caller should've updated
- * FEC and ensure no duplicate updates.
+ * Hold-down expired, send all pending FEC updates, packing as many as
+ * fit into each message to a client.
  */
-static void fec_update_clients(struct zebra_fec *fec)
+static void fec_update_send(struct thread *thread)
 {
 	struct listnode *node;
 	struct zserv *client;
+	struct zebra_fec *fec;
+	struct stream *s;
+	unsigned int count;
 
-	for (ALL_LIST_ELEMENTS_RO(fec->client_list, node, client)) {
-		if (IS_ZEBRA_DEBUG_MPLS)
-			zlog_debug("Update client %s",
-				   zebra_route_string(client->proto));
-		fec_send(fec, client);
+	for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client)) {
+		s = NULL;
+		count = 0;
+
+		frr_each (fec_pending, &fec_pending_q, fec) {
+			if (!listnode_lookup(fec->client_list, client))
+				continue;
+
+			if (s && STREAM_WRITEABLE(s) < FEC_UPDATE_ENTRY_MAX) {
+				fec_update_flush(client, s, count);
+				s = NULL;
+			}
+			if (!s) {
+				s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+				zclient_create_header(s, ZEBRA_FEC_UPDATE,
+						      VRF_DEFAULT);
+				count = 0;
+			}
+
+			fec_put(s, fec);
+			count++;
+			fec_update_stats.updates_sent++;
+		}
+
+		if (s)
+			fec_update_flush(client, s, count);
 	}
+
+	while ((fec = fec_pending_pop(&fec_pending_q)))
+		UNSET_FLAG(fec->flags, FEC_FLAG_UPDATE_PENDING);
+}
+
+/*
+ * Update all registered clients about this FEC. Caller should've updated
+ * FEC.  The update is sent after FEC_UPDATE_HOLD_MSEC, further changes
+ * to the FEC until then are sent along with it.
+ */
+static void fec_update_clients(struct zebra_fec *fec)
+{
+	if (list_isempty(fec->client_list))
+		return;
+
+	if (CHECK_FLAG(fec->flags, FEC_FLAG_UPDATE_PENDING)) {
+		fec_update_stats.updates_suppressed +=
+			listcount(fec->client_list);
+		return;
+	}
+
+	SET_FLAG(fec->flags, FEC_FLAG_UPDATE_PENDING);
+	fec_pending_add_tail(&fec_pending_q, fec);
+
+	thread_add_timer_msec(zrouter.master, fec_update_send, NULL,
+			      FEC_UPDATE_HOLD_MSEC, &fec_update_timer);
 }
 
 
@@ -565,6 +664,9 @@ static struct zebra_fec *fec_add(struct route_table *table, struct prefix *p,
  */
 static int fec_del(struct zebra_fec *fec)
 {
+	if (CHECK_FLAG(fec->flags, FEC_FLAG_UPDATE_PENDING))
+		fec_pending_del(&fec_pending_q, fec);
+
 	list_delete(&fec->client_list);
 	fec->rn->info = NULL;
 	route_unlock_node(fec->rn);
@@ -784,7 +886,7 @@ static void lsp_select_best_nhlfe(struct zebra_lsp *lsp)
 	 * First compute the best path, after checking nexthop status. We are
 	 * only concerned with non-deleted NHLFEs.
 	 */
-	frr_each_safe(nhlfe_list, &lsp->nhlfe_list, nhlfe) {
+	frr_each(nhlfe_list, &lsp->nhlfe_list, nhlfe) {
 		/* Clear selection flags. */
 		UNSET_FLAG(nhlfe->flags,
 			   (NHLFE_FLAG_SELECTED | NHLFE_FLAG_MULTIPATH));
@@ -803,7 +905,7 @@ static void lsp_select_best_nhlfe(struct zebra_lsp *lsp)
 	/*
 	 * Check the active status of backup nhlfes also
 	 */
-	frr_each_safe(nhlfe_list, &lsp->backup_nhlfe_list, nhlfe) {
+	frr_each(nhlfe_list, &lsp->backup_nhlfe_list, nhlfe) {
 		if (!CHECK_FLAG(nhlfe->flags, NHLFE_FLAG_DELETED))
 			(void)nhlfe_nexthop_active(nhlfe);
 	}
@@ -897,18 +999,13 @@ static void lsp_schedule(struct hash_bucket *bucket, void *ctxt)
  * Process a LSP entry that is in the queue. Recalculate best NHLFE and
  * any multipaths and update or delete from the kernel, as needed.
  */
-static wq_item_status lsp_process(struct work_queue *wq, void *data)
+static void lsp_process(struct zebra_lsp *lsp)
 {
-	struct zebra_lsp *lsp;
 	struct zebra_nhlfe *oldbest, *newbest;
 	char buf[BUFSIZ], buf2[BUFSIZ];
 	struct zebra_vrf *zvrf = vrf_info_lookup(VRF_DEFAULT);
 	enum zebra_dplane_result res;
 
-	lsp = (struct zebra_lsp *)data;
-	if (!lsp) // unexpected
-		return WQ_SUCCESS;
-
 	oldbest = lsp->best_nhlfe;
 
 	/* Select best NHLFE(s) */
@@ -1021,28 +1118,18 @@ static wq_item_status lsp_process(struct work_queue *wq, void *data)
 			}
 		}
 	}
-
-	return WQ_SUCCESS;
 }
 
 
 /*
- * Callback upon processing completion of a LSP forwarding entry.
+ * Cleanup upon processing completion of a LSP forwarding entry.
  */
-static void lsp_processq_del(struct work_queue *wq, void *data)
+static void lsp_process_done(struct zebra_lsp *lsp)
 {
 	struct zebra_vrf *zvrf;
-	struct zebra_lsp *lsp;
 	struct hash *lsp_table;
 	struct zebra_nhlfe *nhlfe;
 
-	/* If zebra is shutting down, don't delete any structs,
-	 * just ignore this callback. The LSPs will be cleaned up
-	 * during the shutdown processing.
-	 */
-	if (zebra_router_in_shutdown())
-		return;
-
 	zvrf = vrf_info_lookup(VRF_DEFAULT);
 	assert(zvrf);
 
@@ -1050,10 +1137,6 @@ static void lsp_processq_del(struct work_queue *wq, void *data)
 	if (!lsp_table) // unexpected
 		return;
 
-	lsp = (struct zebra_lsp *)data;
-	if (!lsp) // unexpected
-		return;
-
 	/* Clear flag, remove any NHLFEs marked for deletion. If no NHLFEs
 	 * exist,
 	 * delete LSP entry also.
@@ -1073,6 +1156,48 @@ static void lsp_processq_del(struct work_queue *wq, void *data)
 	lsp_check_free(lsp_table, &lsp);
 }
 
+/*
+ * Work queue callback, process a batch of scheduled LSPs.  The dplane
+ * updates for the whole batch are handed over at once, which lets the
+ * kernel provider put them into full netlink batches.
+ */
+static wq_item_status lsp_processq_run(struct work_queue *wq, void *data)
+{
+	struct lsp_sched_head *q = data;
+	struct zebra_lsp *lsp;
+	uint32_t queue_limit;
+	unsigned int n;
+
+	/* If zebra is shutting down, don't touch any structs, the LSPs
+	 * will be cleaned up during the shutdown processing.
+	 */
+	if (zebra_router_in_shutdown())
+		return WQ_SUCCESS;
+
+	/* Ensure there's room for more dataplane updates */
+	queue_limit = dplane_get_in_queue_limit();
+	if (dplane_get_in_queue_len() > queue_limit)
+		return WQ_QUEUE_BLOCKED;
+
+	dplane_enqueue_hold();
+
+	for (n = 0; n < LSP_PROCESS_BATCH; n++) {
+		lsp = lsp_sched_pop(q);
+		if (!lsp)
+			break;
+
+		lsp_process(lsp);
+		lsp_process_done(lsp);
+
+		if (dplane_get_in_queue_len() > queue_limit)
+			break;
+	}
+
+	dplane_enqueue_release();
+
+	return lsp_sched_count(q) ? WQ_REQUEUE : WQ_SUCCESS;
+}
+
 /*
  * Callback upon finishing the processing of all scheduled
  * LSP forwarding entries.
@@ -1097,8 +1222,11 @@ static int lsp_processq_add(struct zebra_lsp *lsp)
 		return -1;
 	}
 
-	work_queue_add(zrouter.lsp_process_q, lsp);
+	lsp_sched_add_tail(&lsp_sched_q, lsp);
 	SET_FLAG(lsp->flags, LSP_FLAG_SCHEDULED);
+
+	if (work_queue_empty(zrouter.lsp_process_q))
+		work_queue_add(zrouter.lsp_process_q, &lsp_sched_q);
 	return 0;
 }
 
@@ -1173,6 +1301,9 @@ static void lsp_free(struct hash *lsp_table, struct zebra_lsp **plsp)
 
 	lsp_free_nhlfe(lsp);
 
+	if (CHECK_FLAG(lsp->flags, LSP_FLAG_SCHEDULED))
+		lsp_sched_del(&lsp_sched_q, lsp);
+
 	hash_release(lsp_table, &lsp->ile);
 	XFREE(MTYPE_LSP, lsp);
 
@@ -1750,10 +1881,11 @@ static int lsp_cmp(const struct zebra_lsp *lsp1, const struct zebra_lsp *lsp2)
  */
 static void mpls_processq_init(void)
 {
+	lsp_sched_init(&lsp_sched_q);
 	zrouter.lsp_process_q = work_queue_new(zrouter.master, "LSP processing");
 
-	zrouter.lsp_process_q->spec.workfunc = &lsp_process;
-	zrouter.lsp_process_q->spec.del_item_data = &lsp_processq_del;
+	zrouter.lsp_process_q->spec.workfunc = &lsp_processq_run;
+	zrouter.lsp_process_q->spec.del_item_data = NULL;
 	zrouter.lsp_process_q->spec.errorfunc = NULL;
 	zrouter.lsp_process_q->spec.completion_func = &lsp_processq_complete;
 	zrouter.lsp_process_q->spec.max_retries = 0;
@@ -2696,6 +2828,13 @@ void zebra_mpls_print_fec_table(struct vty *vty, struct zebra_vrf *zvrf)
 			fec_print(rn->info, vty);
 		}
 	}
+
+	vty_out(vty,
+		"Client updates: %" PRIu64 " sent in %" PRIu64
+		" messages, %" PRIu64 " suppressed, %zu pending\n",
+		fec_update_stats.updates_sent, fec_update_stats.msgs_sent,
+		fec_update_stats.updates_suppressed,
+		fec_pending_count(&fec_pending_q));
 }
 
 /*
@@ -4016,6 +4155,12 @@ static void lsp_table_free(void *p)
  */
 void zebra_mpls_close_tables(struct zebra_vrf *zvrf)
 {
+	struct zebra_fec *fec;
+
+	THREAD_OFF(fec_update_timer);
+	while ((fec = fec_pending_pop(&fec_pending_q)))
+		UNSET_FLAG(fec->flags, FEC_FLAG_UPDATE_PENDING);
+
 	hash_iterate(zvrf->lsp_table, lsp_uninstall_from_kernel, NULL);
 	hash_clean(zvrf->lsp_table, lsp_table_free);
 	hash_free(zvrf->lsp_table);
@@ -4068,6 +4213,7 @@ void zebra_mpls_init(void)
 {
 	mpls_enabled = false;
 	mpls_pw_reach_strict = false;
+	fec_pending_init(&fec_pending_q);
 
 	if (mpls_kernel_init() < 0) {
 		flog_warn(EC_ZEBRA_MPLS_SUPPORT_DISABLED,
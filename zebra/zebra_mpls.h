@@ -50,6 +50,12 @@ extern "C" {
 /* Declare LSP nexthop list types */
 PREDECL_DLIST(nhlfe_list);
 
+/* LSPs waiting to be processed */
+PREDECL_DLIST(lsp_sched);
+
+/* FECs with label updates waiting to be sent to clients */
+PREDECL_DLIST(fec_pending);
+
 /*
  * (Outgoing) nexthop label forwarding entry
  */
@@ -114,6 +120,9 @@ struct zebra_lsp {
 	/* Address-family of NHLFE - saved here for delete. All NHLFEs */
 	/* have to be of the same AF */
 	uint8_t addr_family;
+
+	/* Linkage on the processing queue while LSP_FLAG_SCHEDULED */
+	struct lsp_sched_item sched;
 };
 
 /*
@@ -132,13 +141,19 @@ struct zebra_fec {
 	/* Flags. */
 	uint32_t flags;
 #define FEC_FLAG_CONFIGURED       (1 << 0)
+#define FEC_FLAG_UPDATE_PENDING   (1 << 1)
 
 	/* Clients interested in this FEC. */
 	struct list *client_list;
+
+	/* Linkage on the client update queue while UPDATE_PENDING */
+	struct fec_pending_item pending;
 };
 
 /* Declare typesafe list apis/macros */
 DECLARE_DLIST(nhlfe_list, struct zebra_nhlfe, list);
+DECLARE_DLIST(lsp_sched, struct zebra_lsp, sched);
+DECLARE_DLIST(fec_pending, struct zebra_fec, pending);
 
 /* Function declarations. */
 
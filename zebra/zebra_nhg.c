@@ -27,8 +27,11 @@
 #include "lib/routemap.h"
 #include "lib/mpls.h"
 #include "lib/jhash.h"
+#include "lib/fhash.h"
 #include "lib/debug.h"
 #include "lib/lib_errors.h"
+#include "lib/frr_pthread.h"
+#include "lib/taskpool.h"
 
 #include "zebra/connected.h"
 #include "zebra/debug.h"
@@ -48,6 +51,9 @@
 DEFINE_MTYPE_STATIC(ZEBRA, NHG, "Nexthop Group Entry");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CONNECTED, "Nexthop Group Connected");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CTX, "Nexthop Group Context");
+DEFINE_MTYPE_STATIC(ZEBRA, NHG_ACTIVE, "Nexthop Group Resolution Cache");
+DEFINE_MTYPE_STATIC(ZEBRA, NHG_LOOKUP, "Nexthop Lookup Cache");
+DEFINE_MTYPE_STATIC(ZEBRA, NHG_KERNEL, "Nexthop Group Kernel Object");
 
 /* Map backup nexthop indices between two nhes */
 struct backup_nh_map_s {
@@ -481,7 +487,7 @@ static void *zebra_nhg_hash_alloc(void *arg)
 uint32_t zebra_nhg_hash_key(const void *arg)
 {
 	const struct nhg_hash_entry *nhe = arg;
-	uint32_t key = 0x5a351234;
+	uint64_t key = fhash_init(0x5a351234);
 	uint32_t primary = 0;
 	uint32_t backup = 0;
 
@@ -489,11 +495,11 @@ uint32_t zebra_nhg_hash_key(const void *arg)
 	if (nhe->backup_info)
 		backup = nexthop_group_hash(&(nhe->backup_info->nhe->nhg));
 
-	key = jhash_3words(primary, backup, nhe->type, key);
+	key = fhash_add(key, ((uint64_t)primary << 32) | backup,
+			((uint64_t)nhe->type << 32) | nhe->vrf_id);
+	key = fhash_add(key, nhe->afi, 0);
 
-	key = jhash_2words(nhe->vrf_id, nhe->afi, key);
-
-	return key;
+	return fhash_final(key);
 }
 
 uint32_t zebra_nhg_id_key(const void *arg)
@@ -1598,6 +1604,200 @@ static void zebra_nhg_free_members(struct nhg_hash_entry *nhe)
 	nhg_connected_tree_free(&nhe->nhg_dependents);
 }
 
+/*
+ * Kernel nexthop objects shared between groups.
+ *
+ * Groups that differ for zebra (backup nexthops, inactive or recursive
+ * members, nexthops in other VRFs resolving the same way, ...) can still
+ * come down to the same member list in the kernel.  The first group
+ * installed with a member list owns the kernel object; groups installed
+ * later with the same list use the owner's ID for their routes and hold a
+ * reference on the owner, so the object stays around as long as any of
+ * them does.  Only zebra's own groups are shared, protocol owned ones
+ * have IDs the daemons know about.
+ */
+PREDECL_HASH(nhg_kernel_objs);
+
+struct nhg_kernel_obj {
+	struct nhg_kernel_objs_item item;
+
+	/* Namespace, with netns based VRFs */
+	vrf_id_t vrf_id;
+
+	uint8_t count;
+	struct nh_grp *grp;
+
+	/* NULL once the owner is freed, while shutting down */
+	struct nhg_hash_entry *owner;
+	/* Groups using the owner's object */
+	uint32_t users;
+
+	bool hashed;
+};
+
+static int nhg_kernel_obj_cmp(const struct nhg_kernel_obj *a,
+			      const struct nhg_kernel_obj *b)
+{
+	if (a->vrf_id != b->vrf_id)
+		return numcmp(a->vrf_id, b->vrf_id);
+	if (a->count != b->count)
+		return numcmp(a->count, b->count);
+	return memcmp(a->grp, b->grp, a->count * sizeof(a->grp[0]));
+}
+
+static uint32_t nhg_kernel_obj_hash(const struct nhg_kernel_obj *obj)
+{
+	return jhash(obj->grp, obj->count * sizeof(obj->grp[0]),
+		     jhash_2words(obj->vrf_id, obj->count, 0x6b6e6867));
+}
+
+DECLARE_HASH(nhg_kernel_objs, struct nhg_kernel_obj, item, nhg_kernel_obj_cmp,
+	     nhg_kernel_obj_hash);
+
+static struct nhg_kernel_objs_head nhg_kernel_objs =
+	INIT_HASH(nhg_kernel_objs);
+
+uint32_t zebra_nhg_kernel_id(const struct nhg_hash_entry *nhe)
+{
+	if (nhe->kobj && nhe->kobj->owner)
+		return nhe->kobj->owner->id;
+
+	return nhe->id;
+}
+
+static bool zebra_nhg_kernel_shareable(const struct nhg_hash_entry *nhe)
+{
+	return zebra_nhg_kernel_nexthops_enabled() && !PROTO_OWNED(nhe)
+	       && ZEBRA_NHG_CREATED(nhe) && !zebra_nhg_depends_is_empty(nhe)
+	       && !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_RECURSIVE);
+}
+
+/* Kernel member list of nhe, grp holds MULTIPATH_NUM entries */
+static bool zebra_nhg_kernel_key(struct nhg_kernel_obj *key,
+				 struct nhg_hash_entry *nhe,
+				 struct nh_grp *grp)
+{
+	memset(key, 0, sizeof(*key));
+	memset(grp, 0, MULTIPATH_NUM * sizeof(*grp));
+	key->vrf_id = nhe->vrf_id;
+	key->grp = grp;
+	key->count = zebra_nhg_nhe2grp(grp, nhe, MULTIPATH_NUM);
+
+	return key->count > 0;
+}
+
+static void zebra_nhg_kernel_obj_free(struct nhg_kernel_obj *obj)
+{
+	if (obj->hashed)
+		nhg_kernel_objs_del(&nhg_kernel_objs, obj);
+
+	XFREE(MTYPE_NHG_KERNEL, obj->grp);
+	XFREE(MTYPE_NHG_KERNEL, obj);
+}
+
+/*
+ * Uses the kernel object of an installed group with the same member list
+ * as nhe, if there is one.  Returns false if nhe has to be installed.
+ */
+static bool zebra_nhg_kernel_share(struct nhg_hash_entry *nhe)
+{
+	struct nh_grp grp[MULTIPATH_NUM];
+	struct nhg_kernel_obj key, *obj;
+
+	if (!zebra_nhg_kernel_shareable(nhe)
+	    || !zebra_nhg_kernel_key(&key, nhe, grp))
+		return false;
+
+	obj = nhg_kernel_objs_find(&nhg_kernel_objs, &key);
+	if (!obj || !obj->owner || obj->owner == nhe
+	    || !(CHECK_FLAG(obj->owner->flags, NEXTHOP_GROUP_INSTALLED)
+		 || CHECK_FLAG(obj->owner->flags, NEXTHOP_GROUP_QUEUED)))
+		return false;
+
+	if (IS_ZEBRA_DEBUG_NHG)
+		zlog_debug("%s: nhe %p (%pNG) uses kernel object of %pNG",
+			   __func__, nhe, nhe, obj->owner);
+
+	nhe->kobj = obj;
+	obj->users++;
+	zebra_nhg_increment_ref(obj->owner);
+
+	SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+	zebra_nhg_handle_install(nhe);
+
+	return true;
+}
+
+/* nhe was sent to the kernel, later groups may share its object */
+static void zebra_nhg_kernel_own(struct nhg_hash_entry *nhe)
+{
+	struct nh_grp grp[MULTIPATH_NUM];
+	struct nhg_kernel_obj key, *obj;
+
+	if (!zebra_nhg_kernel_shareable(nhe)
+	    || !zebra_nhg_kernel_key(&key, nhe, grp))
+		return;
+
+	obj = nhe->kobj;
+	if (obj) {
+		/* Sent again, the member list may have changed */
+		if (obj->hashed && !nhg_kernel_obj_cmp(obj, &key))
+			return;
+
+		if (obj->hashed) {
+			nhg_kernel_objs_del(&nhg_kernel_objs, obj);
+			obj->hashed = false;
+		}
+		XFREE(MTYPE_NHG_KERNEL, obj->grp);
+	} else {
+		obj = XCALLOC(MTYPE_NHG_KERNEL, sizeof(*obj));
+		obj->vrf_id = key.vrf_id;
+		obj->owner = nhe;
+		nhe->kobj = obj;
+	}
+
+	obj->count = key.count;
+	obj->grp = XMALLOC(MTYPE_NHG_KERNEL, key.count * sizeof(grp[0]));
+	memcpy(obj->grp, grp, key.count * sizeof(grp[0]));
+
+	/* Another object with this list already, nothing to share then */
+	if (!nhg_kernel_objs_add(&nhg_kernel_objs, obj))
+		obj->hashed = true;
+}
+
+/*
+ * nhe stops using its kernel object.  Returns the owner a sharing group
+ * held a reference on, to be released by the caller.
+ */
+static struct nhg_hash_entry *
+zebra_nhg_kernel_unshare(struct nhg_hash_entry *nhe)
+{
+	struct nhg_kernel_obj *obj = nhe->kobj;
+	struct nhg_hash_entry *owner = NULL;
+
+	if (!obj)
+		return NULL;
+
+	nhe->kobj = NULL;
+
+	if (obj->owner == nhe) {
+		/* Users hold references, so normally there are none left */
+		obj->owner = NULL;
+		if (obj->hashed) {
+			nhg_kernel_objs_del(&nhg_kernel_objs, obj);
+			obj->hashed = false;
+		}
+	} else {
+		owner = obj->owner;
+		obj->users--;
+	}
+
+	if (!obj->owner && !obj->users)
+		zebra_nhg_kernel_obj_free(obj);
+
+	return owner;
+}
+
 void zebra_nhg_free(struct nhg_hash_entry *nhe)
 {
 	if (IS_ZEBRA_DEBUG_NHG_DETAIL) {
@@ -1613,6 +1813,7 @@ void zebra_nhg_free(struct nhg_hash_entry *nhe)
 
 	THREAD_OFF(nhe->timer);
 
+	zebra_nhg_kernel_unshare(nhe);
 	zebra_nhg_free_members(nhe);
 
 	XFREE(MTYPE_NHG, nhe);
@@ -1638,6 +1839,7 @@ void zebra_nhg_hash_free(void *p)
 
 	THREAD_OFF(nhe->timer);
 
+	zebra_nhg_kernel_unshare(nhe);
 	nexthops_free(nhe->nhg.nexthop);
 
 	XFREE(MTYPE_NHG, nhe);
@@ -2089,6 +2291,191 @@ zebra_nhg_connected_ifindex(struct route_node *rn, struct route_entry *match,
 	return match;
 }
 
+/*
+ * Cache of the route nodes nexthop addresses resolve over, so that the
+ * table lookup is done once per (vrf, address) rather than once per
+ * nexthop of every route entry.  Like the resolution cache below, it only
+ * lives for one meta-queue run, and entries are dropped when the fib route
+ * of a prefix covering their address changes.  Only nodes with a usable
+ * fib route are cached, so that such a change is guaranteed before the
+ * node can go away, and each entry holds a lock on its node on top of
+ * that.  Dropped entries keep the lock until the end of the run, the
+ * route table they belong to may be in use on another pthread.  Nexthops
+ * are resolved on the RIB pthreads too, hence the mutex.
+ */
+#define NHG_LOOKUP_CACHE_MAX 1024
+
+PREDECL_HASH(nhg_lookup_cache);
+
+struct nhg_lookup_entry {
+	struct nhg_lookup_cache_item item;
+
+	vrf_id_t vrf_id;
+	struct prefix p;
+
+	/* First node with a usable fib route, locked */
+	struct route_node *rn;
+
+	/* on nhg_lookup_stale after being dropped */
+	struct nhg_lookup_entry *next;
+};
+
+static int nhg_lookup_cmp(const struct nhg_lookup_entry *a,
+			  const struct nhg_lookup_entry *b)
+{
+	if (a->vrf_id != b->vrf_id)
+		return numcmp(a->vrf_id, b->vrf_id);
+	return prefix_cmp(&a->p, &b->p);
+}
+
+static uint32_t nhg_lookup_hash(const struct nhg_lookup_entry *e)
+{
+	return jhash_1word(e->vrf_id, prefix_hash_key(&e->p));
+}
+
+DECLARE_HASH(nhg_lookup_cache, struct nhg_lookup_entry, item, nhg_lookup_cmp,
+	     nhg_lookup_hash);
+
+static pthread_mutex_t nhg_lookup_mtx = PTHREAD_MUTEX_INITIALIZER;
+/* Requires: nhg_lookup_mtx */
+static struct nhg_lookup_cache_head nhg_lookup_cache =
+	INIT_HASH(nhg_lookup_cache);
+/* Requires: nhg_lookup_mtx */
+static struct nhg_lookup_entry *nhg_lookup_stale;
+
+/* Called between meta-queue runs, when no other pthread uses the tables */
+static void nhg_lookup_cache_flush(void)
+{
+	struct nhg_lookup_entry *e;
+
+	frr_with_mutex (&nhg_lookup_mtx) {
+		while ((e = nhg_lookup_cache_pop(&nhg_lookup_cache))) {
+			e->next = nhg_lookup_stale;
+			nhg_lookup_stale = e;
+		}
+
+		while ((e = nhg_lookup_stale)) {
+			nhg_lookup_stale = e->next;
+			route_unlock_node(e->rn);
+			XFREE(MTYPE_NHG_LOOKUP, e);
+		}
+	}
+}
+
+static void nhg_lookup_cache_invalidate(const struct prefix *p)
+{
+	struct nhg_lookup_entry *e;
+
+	frr_with_mutex (&nhg_lookup_mtx) {
+		frr_each_safe (nhg_lookup_cache, &nhg_lookup_cache, e) {
+			if (!prefix_match(p, &e->p))
+				continue;
+
+			nhg_lookup_cache_del(&nhg_lookup_cache, e);
+			e->next = nhg_lookup_stale;
+			nhg_lookup_stale = e;
+		}
+	}
+}
+
+/* Has rn got a fib route nexthops can resolve over? */
+static bool nhg_lookup_usable(struct route_node *rn)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+
+	return dest && dest->selected_fib
+	       && !CHECK_FLAG(dest->selected_fib->status, ROUTE_ENTRY_REMOVED)
+	       && dest->selected_fib->type != ZEBRA_ROUTE_TABLE;
+}
+
+/* Walks up from the longest match for p, up to the first node to look at */
+static struct route_node *nhg_lookup_walk(struct route_table *table,
+					  const struct prefix *p)
+{
+	struct route_node *rn;
+
+	rn = route_node_match(table, p);
+	while (rn) {
+		route_unlock_node(rn);
+
+		if (is_default_prefix(&rn->p) || nhg_lookup_usable(rn))
+			return rn;
+
+		do {
+			rn = rn->parent;
+		} while (rn && rn->info == NULL);
+		if (rn)
+			route_lock_node(rn);
+	}
+
+	return NULL;
+}
+
+static struct route_node *nhg_lookup(struct route_table *table,
+				     vrf_id_t vrf_id, const struct prefix *p)
+{
+	struct nhg_lookup_entry key = {}, *e;
+	struct route_node *rn;
+
+	key.vrf_id = vrf_id;
+	prefix_copy(&key.p, p);
+
+	frr_with_mutex (&nhg_lookup_mtx) {
+		e = nhg_lookup_cache_find(&nhg_lookup_cache, &key);
+		if (e)
+			return e->rn;
+	}
+
+	rn = nhg_lookup_walk(table, p);
+
+	/* nothing would drop an entry for a node without a fib route */
+	if (!rn || !nhg_lookup_usable(rn))
+		return rn;
+
+	frr_with_mutex (&nhg_lookup_mtx) {
+		if (nhg_lookup_cache_count(&nhg_lookup_cache)
+		    >= NHG_LOOKUP_CACHE_MAX)
+			break;
+
+		e = XCALLOC(MTYPE_NHG_LOOKUP, sizeof(*e));
+		*e = key;
+		e->rn = route_lock_node(rn);
+		if (nhg_lookup_cache_add(&nhg_lookup_cache, e)) {
+			route_unlock_node(e->rn);
+			XFREE(MTYPE_NHG_LOOKUP, e);
+		}
+	}
+
+	return rn;
+}
+
+/*
+ * Would the lookup for p, ending at rn, have gone through top?  This is
+ * the case if top is a node visited on the way up, e.g. a less specific
+ * route resolving its own nexthop.
+ */
+static bool nhg_lookup_through(struct route_table *table,
+			       const struct prefix *p,
+			       const struct route_node *rn,
+			       const struct prefix *top)
+{
+	struct route_node *trn;
+	bool found;
+
+	if (!top || top->family != p->family || !prefix_match(top, p))
+		return false;
+	if (rn && top->prefixlen < rn->p.prefixlen)
+		return false;
+
+	trn = route_node_lookup(table, top);
+	if (!trn)
+		return false;
+
+	found = trn->info != NULL;
+	route_unlock_node(trn);
+	return found;
+}
+
 /*
  * Given a nexthop we need to properly recursively resolve,
  * do a table lookup to find and match if at all possible.
@@ -2106,7 +2493,6 @@ static int nexthop_active(struct nexthop *nexthop, struct nhg_hash_entry *nhe,
 	struct zebra_nhlfe *nhlfe;
 	struct nexthop *newhop;
 	struct interface *ifp;
-	rib_dest_t *dest;
 	struct zebra_vrf *zvrf;
 	struct in_addr local_ipv4;
 	struct in_addr *ipv4;
@@ -2281,27 +2667,23 @@ static int nexthop_active(struct nexthop *nexthop, struct nhg_hash_entry *nhe,
 		return 0;
 	}
 
-	rn = route_node_match(table, (struct prefix *)&p);
-	while (rn) {
-		route_unlock_node(rn);
+	rn = nhg_lookup(table, nexthop->vrf_id, &p);
 
-		/* Lookup should halt if we've matched against ourselves ('top',
-		 * if specified) - i.e., we cannot have a nexthop NH1 is
-		 * resolved by a route NH1. The exception is if the route is a
-		 * host route.
-		 */
-		if (prefix_same(&rn->p, top))
-			if (((afi == AFI_IP)
-			     && (rn->p.prefixlen != IPV4_MAX_BITLEN))
-			    || ((afi == AFI_IP6)
-				&& (rn->p.prefixlen != IPV6_MAX_BITLEN))) {
-				if (IS_ZEBRA_DEBUG_RIB_DETAILED)
-					zlog_debug(
-						"        %s: Matched against ourself and prefix length is not max bit length",
-						__func__);
-				return 0;
-			}
+	/* Lookup should halt if we've matched against ourselves ('top', if
+	 * specified) - i.e., we cannot have a nexthop NH1 is resolved by a
+	 * route NH1. The exception is if the route is a host route.
+	 */
+	if (nhg_lookup_through(table, &p, rn, top)
+	    && (((afi == AFI_IP) && (top->prefixlen != IPV4_MAX_BITLEN))
+		|| ((afi == AFI_IP6) && (top->prefixlen != IPV6_MAX_BITLEN)))) {
+		if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+			zlog_debug(
+				"        %s: Matched against ourself and prefix length is not max bit length",
+				__func__);
+		return 0;
+	}
 
+	if (rn) {
 		/* Pick up selected route. */
 		/* However, do not resolve over default route unless explicitly
 		 * allowed.
@@ -2315,26 +2697,12 @@ static int nexthop_active(struct nexthop *nexthop, struct nhg_hash_entry *nhe,
 			return 0;
 		}
 
-		dest = rib_dest_from_rnode(rn);
-		if (dest && dest->selected_fib
-		    && !CHECK_FLAG(dest->selected_fib->status,
-				   ROUTE_ENTRY_REMOVED)
-		    && dest->selected_fib->type != ZEBRA_ROUTE_TABLE)
-			match = dest->selected_fib;
-
-		/* If there is no selected route or matched route is EGP, go up
-		 * tree.
-		 */
-		if (!match) {
-			do {
-				rn = rn->parent;
-			} while (rn && rn->info == NULL);
-			if (rn)
-				route_lock_node(rn);
-
-			continue;
-		}
+		if (nhg_lookup_usable(rn))
+			match = rib_dest_from_rnode(rn)->selected_fib;
+	}
 
+	/* Resolve over the selected route found on the way up, if any */
+	if (match) {
 		if ((match->type == ZEBRA_ROUTE_CONNECT) ||
 		    (RIB_SYSTEM_ROUTE(match) && RSYSTEM_ROUTE(type))) {
 			match = zebra_nhg_connected_ifindex(rn, match,
@@ -2749,23 +3117,221 @@ static uint32_t proto_nhg_nexthop_active_update(struct nexthop_group *nhg)
 }
 
 /*
- * Iterate over all nexthops of the given RIB entry and refresh their
- * ACTIVE flag.  If any nexthop is found to toggle the ACTIVE flag,
- * the whole re structure is flagged with ROUTE_ENTRY_CHANGED.
- *
- * Return value is the new number of active nexthops.
+ * Cache of nexthop resolution results, so that route entries sharing an
+ * nhe (e.g. lots of BGP routes with the same nexthops) are only resolved
+ * once.  Resolution depends on the RIB, so the cache only lives for one
+ * meta-queue run (see zebra_nhg_active_cache_flush()), during which the
+ * RIB only changes under rib_process(); on top of that, entries are dropped
+ * when the fib route of a prefix covering one of their gateways changes.
  */
-int nexthop_active_update(struct route_node *rn, struct route_entry *re)
+#define NHG_ACTIVE_CACHE_MAX 1024
+
+PREDECL_HASH(nhg_active_cache);
+
+struct nhg_active_entry {
+	struct nhg_active_cache_item item;
+
+	/* The nhe to resolve, and what else resolution depends on */
+	struct nhg_hash_entry *nhe;
+	afi_t afi;
+	vrf_id_t vrf_id;
+	int type;
+	unsigned short instance;
+	uint32_t flags;
+
+	/* Result of nexthop_active_update() */
+	struct nhg_hash_entry *new_nhe;
+	bool changed;
+	int active;
+	uint32_t mtu;
+};
+
+static int nhg_active_cmp(const struct nhg_active_entry *a,
+			  const struct nhg_active_entry *b)
 {
-	struct nhg_hash_entry *curr_nhe;
-	uint32_t curr_active = 0, backup_active = 0;
+	if (a->nhe != b->nhe)
+		return a->nhe < b->nhe ? -1 : 1;
+	if (a->afi != b->afi)
+		return numcmp(a->afi, b->afi);
+	if (a->vrf_id != b->vrf_id)
+		return numcmp(a->vrf_id, b->vrf_id);
+	if (a->type != b->type)
+		return numcmp(a->type, b->type);
+	if (a->instance != b->instance)
+		return numcmp(a->instance, b->instance);
+	return numcmp(a->flags, b->flags);
+}
 
-	if (PROTO_OWNED(re->nhe))
-		return proto_nhg_nexthop_active_update(&re->nhe->nhg);
+static uint32_t nhg_active_hash(const struct nhg_active_entry *e)
+{
+	uint32_t key;
 
-	afi_t rt_afi = family2afi(rn->p.family);
+	key = jhash(&e->nhe, sizeof(e->nhe), 0x5e1ec7ed);
+	key = jhash_3words(e->afi, e->vrf_id, e->type, key);
+	return jhash_2words(e->instance, e->flags, key);
+}
 
-	UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+DECLARE_HASH(nhg_active_cache, struct nhg_active_entry, item, nhg_active_cmp,
+	     nhg_active_hash);
+
+static struct nhg_active_cache_head nhg_active_cache =
+	INIT_HASH(nhg_active_cache);
+
+static bool nhg_active_covers(const struct prefix *p,
+			      const struct nexthop_group *nhg)
+{
+	struct nexthop *nh;
+	struct prefix np;
+
+	for (nh = nhg->nexthop; nh; nh = nh->next) {
+		switch (nh->type) {
+		case NEXTHOP_TYPE_IPV4:
+		case NEXTHOP_TYPE_IPV4_IFINDEX:
+			np.family = AF_INET;
+			np.prefixlen = IPV4_MAX_BITLEN;
+			np.u.prefix4 = nh->gate.ipv4;
+			break;
+		case NEXTHOP_TYPE_IPV6:
+		case NEXTHOP_TYPE_IPV6_IFINDEX:
+			/* resolved over IPv4, see nexthop_active() */
+			if (IS_MAPPED_IPV6(&nh->gate.ipv6)) {
+				np.family = AF_INET;
+				np.prefixlen = IPV4_MAX_BITLEN;
+				ipv4_mapped_ipv6_to_ipv4(&nh->gate.ipv6,
+							 &np.u.prefix4);
+				break;
+			}
+			np.family = AF_INET6;
+			np.prefixlen = IPV6_MAX_BITLEN;
+			np.u.prefix6 = nh->gate.ipv6;
+			break;
+		case NEXTHOP_TYPE_IFINDEX:
+		case NEXTHOP_TYPE_BLACKHOLE:
+			continue;
+		}
+
+		if (prefix_match(p, &np))
+			return true;
+	}
+
+	return false;
+}
+
+/* Can a route to p be resolved by a route entry with this nhe? */
+static bool nhg_active_nhe_covered(const struct prefix *p,
+				   const struct nhg_hash_entry *nhe)
+{
+	if (nhg_active_covers(p, &nhe->nhg))
+		return true;
+
+	return nhe->backup_info && nhe->backup_info->nhe
+	       && nhg_active_covers(p, &nhe->backup_info->nhe->nhg);
+}
+
+static void nhg_active_entry_free(struct nhg_active_entry *e)
+{
+	zebra_nhg_decrement_ref(e->nhe);
+	zebra_nhg_decrement_ref(e->new_nhe);
+	XFREE(MTYPE_NHG_ACTIVE, e);
+}
+
+void zebra_nhg_active_cache_flush(void)
+{
+	struct nhg_active_entry *e;
+
+	while ((e = nhg_active_cache_pop(&nhg_active_cache)))
+		nhg_active_entry_free(e);
+
+	nhg_lookup_cache_flush();
+}
+
+void zebra_nhg_active_cache_invalidate(const struct prefix *p)
+{
+	struct nhg_active_entry *e;
+
+	frr_each_safe (nhg_active_cache, &nhg_active_cache, e) {
+		if (!nhg_active_nhe_covered(p, e->nhe))
+			continue;
+
+		nhg_active_cache_del(&nhg_active_cache, e);
+		nhg_active_entry_free(e);
+	}
+
+	nhg_lookup_cache_invalidate(p);
+}
+
+/*
+ * Sets up the cache key for re, returns false if re's resolution can't be
+ * shared with other route entries.
+ */
+static bool nhg_active_key(struct nhg_active_entry *key,
+			   const struct route_node *rn,
+			   const struct route_entry *re, afi_t afi)
+{
+	struct zebra_vrf *zvrf;
+	afi_t rm_afi;
+
+	/* Labels change per route entry */
+	if (CHECK_FLAG(re->status, ROUTE_ENTRY_LABELS_CHANGED))
+		return false;
+
+	/* Nexthops can't resolve over the route itself */
+	if (nhg_active_nhe_covered(&rn->p, re->nhe))
+		return false;
+
+	/* 'ip protocol' route-maps match on the prefix */
+	zvrf = zebra_vrf_lookup_by_id(re->vrf_id);
+	if (!zvrf)
+		return false;
+
+	for (rm_afi = AFI_IP; rm_afi <= AFI_IP6; rm_afi++)
+		if (PROTO_RM_NAME(zvrf, rm_afi, re->type)
+		    || PROTO_RM_NAME(zvrf, rm_afi, ZEBRA_ROUTE_MAX))
+			return false;
+
+	memset(key, 0, sizeof(*key));
+	key->nhe = re->nhe;
+	key->afi = afi;
+	key->vrf_id = re->vrf_id;
+	key->type = re->type;
+	key->instance = re->instance;
+	key->flags = re->flags & ~ZEBRA_FLAG_SELECTED;
+
+	return true;
+}
+
+static void nhg_active_cache_store(const struct nhg_active_entry *key,
+				   struct nhg_hash_entry *new_nhe, bool changed,
+				   int active, uint32_t mtu)
+{
+	struct nhg_active_entry *e;
+
+	if (nhg_active_cache_count(&nhg_active_cache) >= NHG_ACTIVE_CACHE_MAX)
+		return;
+
+	e = XMALLOC(MTYPE_NHG_ACTIVE, sizeof(*e));
+	*e = *key;
+	e->new_nhe = new_nhe;
+	e->changed = changed;
+	e->active = active;
+	e->mtu = mtu;
+
+	zebra_nhg_increment_ref(e->nhe);
+	zebra_nhg_increment_ref(e->new_nhe);
+	nhg_active_cache_add(&nhg_active_cache, e);
+}
+
+/*
+ * Resolves the nexthops of a private copy of re's nhe, which is returned.
+ * Sets ROUTE_ENTRY_CHANGED and the nexthop mtu on re, and returns the
+ * number of active nexthops in 'active'.
+ */
+static struct nhg_hash_entry *nexthop_active_resolve(struct route_node *rn,
+						     struct route_entry *re,
+						     uint32_t *active)
+{
+	struct nhg_hash_entry *curr_nhe;
+	uint32_t curr_active, backup_active;
 
 	/* Make a local copy of the existing nhe, so we don't work on/modify
 	 * the shared nhe.
@@ -2790,17 +3356,61 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re)
 			   curr_active);
 
 	/* If there are no backup nexthops, we are done */
-	if (zebra_nhg_get_backup_nhg(curr_nhe) == NULL)
-		goto backups_done;
+	if (zebra_nhg_get_backup_nhg(curr_nhe) != NULL) {
+		backup_active = nexthop_list_active_update(
+			rn, re, curr_nhe->backup_info->nhe,
+			true /*is_backup*/);
 
-	backup_active = nexthop_list_active_update(
-		rn, re, curr_nhe->backup_info->nhe, true /*is_backup*/);
+		if (IS_ZEBRA_DEBUG_NHG_DETAIL)
+			zlog_debug("%s: re %p backup_active %u", __func__, re,
+				   backup_active);
+	}
 
-	if (IS_ZEBRA_DEBUG_NHG_DETAIL)
-		zlog_debug("%s: re %p backup_active %u", __func__, re,
-			   backup_active);
+	*active = curr_active;
+	return curr_nhe;
+}
 
-backups_done:
+/*
+ * Iterate over all nexthops of the given RIB entry and refresh their
+ * ACTIVE flag.  If any nexthop is found to toggle the ACTIVE flag,
+ * the whole re structure is flagged with ROUTE_ENTRY_CHANGED.
+ *
+ * Return value is the new number of active nexthops.
+ */
+int nexthop_active_update(struct route_node *rn, struct route_entry *re)
+{
+	struct nhg_hash_entry *curr_nhe;
+	uint32_t curr_active = 0;
+	struct nhg_active_entry key, *cached = NULL;
+	bool cacheable;
+
+	if (PROTO_OWNED(re->nhe))
+		return proto_nhg_nexthop_active_update(&re->nhe->nhg);
+
+	afi_t rt_afi = family2afi(rn->p.family);
+
+	cacheable = nhg_active_key(&key, rn, re, rt_afi);
+	if (cacheable)
+		cached = nhg_active_cache_find(&nhg_active_cache, &key);
+	if (cached) {
+		if (IS_ZEBRA_DEBUG_NHG_DETAIL)
+			zlog_debug("%s: re %p nhe %p (%pNG) cached => %p (%pNG)",
+				   __func__, re, re->nhe, re->nhe,
+				   cached->new_nhe, cached->new_nhe);
+
+		if (cached->changed) {
+			SET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+			route_entry_update_nhe(re, cached->new_nhe);
+		} else
+			UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+
+		re->nexthop_mtu = cached->mtu;
+		return cached->active;
+	}
+
+	UNSET_FLAG(re->status, ROUTE_ENTRY_CHANGED);
+
+	curr_nhe = nexthop_active_resolve(rn, re, &curr_active);
 
 	/*
 	 * Ref or create an nhe that matches the current state of the
@@ -2827,6 +3437,12 @@ backups_done:
 	if (curr_active)
 		zebra_nhg_set_valid_if_active(re->nhe);
 
+	if (cacheable)
+		nhg_active_cache_store(&key, re->nhe,
+				       CHECK_FLAG(re->status,
+						  ROUTE_ENTRY_CHANGED),
+				       curr_active, re->nexthop_mtu);
+
 	/*
 	 * Do not need the old / copied nhe anymore since it
 	 * was either copied over into a new nhe or not
@@ -2836,6 +3452,166 @@ backups_done:
 	return curr_active;
 }
 
+/*
+ * Resolving the nexthops of the route entries about to be processed, on
+ * the RIB pthreads.  Route entries are spread across the pthreads by VRF;
+ * only those whose nexthops, including backups, are all in their own VRF
+ * are considered, so that each routing table is only looked at by one
+ * pthread.  The main pthread is blocked in the meantime, so the RIB
+ * doesn't change.  Resolved copies of the nhes are then turned into real
+ * ones serially, on the main pthread, and the results go into the
+ * resolution cache for rib_process() to pick up.
+ */
+struct nhg_active_job {
+	/* key, then result */
+	struct nhg_active_entry e;
+
+	struct route_node *rn;
+	struct route_entry *re;
+	unsigned int shard;
+
+	struct nhg_hash_entry *curr_nhe;
+};
+
+struct nhg_active_shard {
+	struct nhg_active_job *jobs;
+	unsigned int count;
+	unsigned int shard;
+};
+
+static bool nhg_active_same_vrf(const struct nexthop_group *nhg,
+				vrf_id_t vrf_id)
+{
+	struct nexthop *nh;
+
+	for (nh = nhg->nexthop; nh; nh = nh->next)
+		if (nh->vrf_id != vrf_id
+		    || CHECK_FLAG(nh->flags, NEXTHOP_FLAG_EVPN))
+			return false;
+
+	return true;
+}
+
+static void nhg_active_prepare_shard(void *arg)
+{
+	struct nhg_active_shard *shard = arg;
+	struct nhg_active_job *job;
+	struct route_entry re;
+	uint32_t active;
+	unsigned int i;
+
+	for (i = 0; i < shard->count; i++) {
+		job = &shard->jobs[i];
+		if (job->shard != shard->shard)
+			continue;
+
+		/* Don't touch the route entry's own status */
+		re = *job->re;
+		UNSET_FLAG(re.status, ROUTE_ENTRY_CHANGED);
+
+		job->curr_nhe = nexthop_active_resolve(job->rn, &re, &active);
+		job->e.active = active;
+		job->e.changed = CHECK_FLAG(re.status, ROUTE_ENTRY_CHANGED);
+		job->e.mtu = re.nexthop_mtu;
+	}
+}
+
+void zebra_nhg_active_prepare(struct taskpool *pool, struct route_node **nodes,
+			      unsigned int count)
+{
+	struct nhg_active_cache_head pending;
+	struct nhg_active_shard *shards;
+	struct nhg_active_job *jobs, *job;
+	struct nhg_hash_entry *new_nhe;
+	struct taskpool_group grp;
+	struct route_entry *re;
+	unsigned int room, njobs = 0, nshards, i;
+
+	room = NHG_ACTIVE_CACHE_MAX - nhg_active_cache_count(&nhg_active_cache);
+	if (!room)
+		return;
+
+	nshards = taskpool_nworkers(pool) + 1;
+	jobs = XCALLOC(MTYPE_NHG_ACTIVE, room * sizeof(*jobs));
+	nhg_active_cache_init(&pending);
+
+	for (i = 0; i < count && njobs < room; i++) {
+		RNODE_FOREACH_RE (nodes[i], re) {
+			if (njobs == room)
+				break;
+
+			/* Same as what rib_process() resolves */
+			if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED)
+			    || !CHECK_FLAG(re->status, ROUTE_ENTRY_CHANGED)
+			    || PROTO_OWNED(re->nhe))
+				continue;
+
+			job = &jobs[njobs];
+			if (!nhg_active_key(&job->e, nodes[i], re,
+					    family2afi(nodes[i]->p.family)))
+				continue;
+
+			if (!nhg_active_same_vrf(&re->nhe->nhg, re->vrf_id)
+			    || (re->nhe->backup_info && re->nhe->backup_info->nhe
+				&& !nhg_active_same_vrf(
+					&re->nhe->backup_info->nhe->nhg,
+					re->vrf_id)))
+				continue;
+
+			if (nhg_active_cache_find(&nhg_active_cache, &job->e)
+			    || nhg_active_cache_find(&pending, &job->e))
+				continue;
+
+			job->rn = nodes[i];
+			job->re = re;
+			job->shard = jhash_1word(re->vrf_id, 0) % nshards;
+			nhg_active_cache_add(&pending, &job->e);
+			njobs++;
+		}
+	}
+
+	if (njobs) {
+		shards = XCALLOC(MTYPE_NHG_ACTIVE, nshards * sizeof(*shards));
+
+		taskpool_group_init(&grp);
+		for (i = 0; i < nshards; i++) {
+			shards[i].jobs = jobs;
+			shards[i].count = njobs;
+			shards[i].shard = i;
+			taskpool_submit(pool, &grp, nhg_active_prepare_shard,
+					&shards[i]);
+		}
+		taskpool_group_wait(pool, &grp);
+		taskpool_group_fini(&grp);
+
+		XFREE(MTYPE_NHG_ACTIVE, shards);
+	}
+
+	for (i = 0; i < njobs; i++) {
+		job = &jobs[i];
+		nhg_active_cache_del(&pending, &job->e);
+
+		if (job->e.changed)
+			new_nhe = zebra_nhg_rib_find_nhe(job->curr_nhe,
+							 job->e.afi);
+		else
+			new_nhe = job->e.nhe;
+
+		if (new_nhe) {
+			if (job->e.active)
+				zebra_nhg_set_valid_if_active(new_nhe);
+			nhg_active_cache_store(&job->e, new_nhe,
+					       job->e.changed, job->e.active,
+					       job->e.mtu);
+		}
+
+		zebra_nhg_free(job->curr_nhe);
+	}
+
+	nhg_active_cache_fini(&pending);
+	XFREE(MTYPE_NHG_ACTIVE, jobs);
+}
+
 /* Recursively construct a grp array of fully resolved IDs.
  *
  * This function allows us to account for groups within groups,
@@ -2971,11 +3747,15 @@ void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 		if (!ZEBRA_NHG_CREATED(nhe))
 			nhe->type = ZEBRA_ROUTE_NHG;
 
+		if (zebra_nhg_kernel_share(nhe))
+			return;
+
 		int ret = dplane_nexthop_add(nhe);
 
 		switch (ret) {
 		case ZEBRA_DPLANE_REQUEST_QUEUED:
 			SET_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED);
+			zebra_nhg_kernel_own(nhe);
 			break;
 		case ZEBRA_DPLANE_REQUEST_FAILURE:
 			flog_err(
@@ -2985,6 +3765,7 @@ void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 			break;
 		case ZEBRA_DPLANE_REQUEST_SUCCESS:
 			SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+			zebra_nhg_kernel_own(nhe);
 			zebra_nhg_handle_install(nhe);
 			break;
 		}
@@ -2993,6 +3774,20 @@ void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 
 void zebra_nhg_uninstall_kernel(struct nhg_hash_entry *nhe)
 {
+	struct nhg_hash_entry *owner;
+
+	if (nhe->kobj && nhe->kobj->owner != nhe) {
+		/* Only used another group's kernel object */
+		UNSET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+		owner = zebra_nhg_kernel_unshare(nhe);
+		zebra_nhg_handle_uninstall(nhe);
+		if (owner)
+			zebra_nhg_decrement_ref(owner);
+		return;
+	}
+
+	zebra_nhg_kernel_unshare(nhe);
+
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED)) {
 		int ret = dplane_nexthop_delete(nhe);
 
@@ -43,6 +43,8 @@ struct nh_grp {
 
 PREDECL_RBTREE_UNIQ(nhg_connected_tree);
 
+struct nhg_kernel_obj;
+
 /*
  * Hashtables containing nhg entries is in `zebra_router`.
  */
@@ -107,6 +109,11 @@ struct nhg_hash_entry {
 
 	struct thread *timer;
 
+	/* Kernel nexthop object this group is installed as, if it is
+	 * shared with other groups; see zebra_nhg_kernel_id().
+	 */
+	struct nhg_kernel_obj *kobj;
+
 /*
  * Is this nexthop group valid, ie all nexthops are fully resolved.
  * What is fully resolved?  It's a nexthop that is either self contained
@@ -373,6 +380,13 @@ extern uint8_t zebra_nhg_nhe2grp(struct nh_grp *grp, struct nhg_hash_entry *nhe,
 extern void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe);
 extern void zebra_nhg_uninstall_kernel(struct nhg_hash_entry *nhe);
 
+/*
+ * ID of the kernel nexthop object used for nhe.  Usually nhe's own ID,
+ * unless another group with the same kernel member list was installed
+ * first and nhe shares its object.
+ */
+extern uint32_t zebra_nhg_kernel_id(const struct nhg_hash_entry *nhe);
+
 /* Forward ref of dplane update context type */
 struct zebra_dplane_ctx;
 extern void zebra_nhg_dplane_result(struct zebra_dplane_ctx *ctx);
@@ -392,6 +406,23 @@ extern void zebra_nhg_mark_keep(void);
 struct route_entry; /* Forward ref to avoid circular includes */
 extern int nexthop_active_update(struct route_node *rn, struct route_entry *re);
 
+/*
+ * nexthop_active_update() results, and the table lookups for nexthop
+ * addresses, are shared between route entries until flushed; invalidate
+ * drops those that may resolve over prefix p.
+ */
+extern void zebra_nhg_active_cache_flush(void);
+extern void zebra_nhg_active_cache_invalidate(const struct prefix *p);
+
+/*
+ * Resolves the nexthops of the changed route entries on 'nodes' on the
+ * pool's pthreads, spread by VRF, and puts the results in the cache.
+ */
+struct taskpool;
+extern void zebra_nhg_active_prepare(struct taskpool *pool,
+				     struct route_node **nodes,
+				     unsigned int count);
+
 #ifdef _FRR_ATTRIBUTE_PRINTFRR
 #pragma FRR printfrr_ext "%pNG" (const struct nhg_hash_entry *)
 #endif
@@ -33,6 +33,8 @@ extern "C" {
 #endif
 
 #ifdef HAVE_NETLINK
+struct nl_rcv_batch;
+
 /* Socket interface to kernel */
 struct nlsock {
 	int sock;
@@ -42,6 +44,16 @@ struct nlsock {
 
 	uint8_t *buf;
 	size_t buflen;
+
+	/* datagrams read ahead by netlink_parse_info(), allocated on use */
+	struct nl_rcv_batch *rcv;
+
+	/* largest batch known to fit the send buffer, 0 if not checked */
+	size_t sndbufsize;
+
+	/* dplane only: sockets of the other kernel provider instances */
+	struct nlsock *instances;
+	unsigned int ninstances;
 };
 #endif
 
@@ -59,6 +59,7 @@
 #include "zebra/zebra_dplane.h"
 #include "zebra/zebra_evpn_mh.h"
 #include "zebra/zebra_script.h"
+#include "zebra/zebra_trace.h"
 
 DEFINE_MGROUP(ZEBRA, "zebra");
 
@@ -1216,6 +1217,8 @@ static void rib_process(struct route_node *rn)
 	zvrf = rib_dest_vrf(dest);
 	vrf_id = zvrf_id(zvrf);
 
+	frrtrace(2, frr_zebra, rib_process, rn, vrf_id);
+
 	vrf = vrf_lookup_by_id(vrf_id);
 
 	/*
@@ -1376,6 +1379,11 @@ static void rib_process(struct route_node *rn)
 			(void *)old_fib, (void *)new_fib);
 	}
 
+	/* Nexthops resolving over this prefix need to be looked at again */
+	if (old_fib != new_fib
+	    || (new_fib && CHECK_FLAG(new_fib->status, ROUTE_ENTRY_CHANGED)))
+		zebra_nhg_active_cache_invalidate(&rn->p);
+
 	/* Buffer ROUTE_ENTRY_CHANGED here, because it will get cleared if
 	 * fib == selected */
 	bool selected_changed = new_selected && CHECK_FLAG(new_selected->status,
@@ -2919,6 +2927,7 @@ static void process_subq_early_route_delete(struct zebra_early_route *ere)
 				 * it as deleted
 				 */
 				dest->selected_fib = NULL;
+				zebra_nhg_active_cache_invalidate(&rn->p);
 			} else {
 				/*
 				 * This means someone else, other than Zebra,
@@ -3056,14 +3065,48 @@ static unsigned int process_subq(struct list *subq,
 	return 1;
 }
 
-/* Dispatch the meta queue by picking and processing the next node from
- * a non-empty sub-queue with lowest priority. wq is equal to zebra->ribq and
+/* Nodes processed per meta_queue_process() call. Nexthop resolution
+ * results are shared between the route entries processed in one call.
+ */
+#define META_QUEUE_BATCH 64
+/* With RIB pthreads, nexthops are resolved in parallel for this many */
+#define META_QUEUE_BATCH_MT 1024
+
+/*
+ * Resolves the nexthops for the next 'count' route nodes on the RIB
+ * pthreads, before they are processed.  Only done when nothing but route
+ * nodes is queued, as the other sub-queues change the RIB under them.
+ */
+static void meta_queue_prepare(struct meta_queue *mq, unsigned int count)
+{
+	struct route_node *nodes[META_QUEUE_BATCH_MT];
+	struct listnode *lnode;
+	struct route_node *rnode;
+	unsigned int i, n = 0;
+
+	for (i = 0; i < META_QUEUE_CONNECTED; i++)
+		if (listcount(mq->subq[i]))
+			return;
+
+	for (i = META_QUEUE_CONNECTED; i < MQ_SIZE && n < count; i++)
+		for (ALL_LIST_ELEMENTS_RO(mq->subq[i], lnode, rnode)) {
+			nodes[n++] = rnode;
+			if (n == count)
+				break;
+		}
+
+	if (n)
+		zebra_nhg_active_prepare(zrouter.rib_pool, nodes, n);
+}
+
+/* Dispatch the meta queue by picking and processing the next nodes from
+ * non-empty sub-queues with lowest priority. wq is equal to zebra->ribq and
  * data is pointed to the meta queue structure.
  */
 static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 {
 	struct meta_queue *mq = data;
-	unsigned i;
+	unsigned i, n, batch = META_QUEUE_BATCH;
 	uint32_t queue_len, queue_limit;
 
 	/* Ensure there's room for more dataplane updates */
@@ -3082,11 +3125,30 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 		return WQ_QUEUE_BLOCKED;
 	}
 
-	for (i = 0; i < MQ_SIZE; i++)
-		if (process_subq(mq->subq[i], i)) {
-			mq->size--;
+	if (zrouter.rib_pool) {
+		batch = META_QUEUE_BATCH_MT;
+		meta_queue_prepare(mq, batch);
+	}
+
+	/* Hand everything from this run to the dataplane at once */
+	dplane_enqueue_hold();
+
+	for (n = 0; n < batch && mq->size; n++) {
+		for (i = 0; i < MQ_SIZE; i++)
+			if (process_subq(mq->subq[i], i)) {
+				mq->size--;
+				break;
+			}
+
+		if (dplane_get_in_queue_len() > queue_limit)
 			break;
-		}
+	}
+
+	dplane_enqueue_release();
+
+	/* The RIB may change before the next call */
+	zebra_nhg_active_cache_flush();
+
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
@@ -3708,6 +3770,8 @@ static void rib_queue_init(void)
 	zrouter.ribq->spec.max_retries = 3;
 	zrouter.ribq->spec.hold = ZEBRA_RIB_PROCESS_HOLD_TIME;
 	zrouter.ribq->spec.retry = ZEBRA_RIB_PROCESS_RETRY_TIME;
+	/* keep RIB churn from delaying zapi/netlink I/O on the main thread */
+	zrouter.ribq->spec.adaptive = true;
 
 	if (!(zrouter.mq = meta_queue_new())) {
 		flog_err(EC_ZEBRA_WQ_NONEXISTENT,
@@ -3771,6 +3835,7 @@ rib_dest_t *zebra_rib_create_dest(struct route_node *rn)
 /* Add RE to head of the route node. */
 static void rib_link(struct route_node *rn, struct route_entry *re, int process)
 {
+	struct rib_table_info *info = srcdest_rnode_table_info(rn);
 	rib_dest_t *dest;
 	afi_t afi;
 	const char *rmap_name;
@@ -3787,6 +3852,9 @@ static void rib_link(struct route_node *rn, struct route_entry *re, int process)
 
 	re_list_add_head(&dest->routes, re);
 
+	re->rn = rn;
+	re_owner_list_add_tail(&info->owners[re->type], re);
+
 	afi = (rn->p.family == AF_INET)
 		      ? AFI_IP
 		      : (rn->p.family == AF_INET6) ? AFI_IP6 : AFI_MAX;
@@ -3827,6 +3895,7 @@ static void rib_addnode(struct route_node *rn,
  */
 void rib_unlink(struct route_node *rn, struct route_entry *re)
 {
+	struct rib_table_info *info = srcdest_rnode_table_info(rn);
 	rib_dest_t *dest;
 
 	assert(rn && re);
@@ -3839,8 +3908,14 @@ void rib_unlink(struct route_node *rn, struct route_entry *re)
 
 	re_list_del(&dest->routes, re);
 
-	if (dest->selected_fib == re)
+	if (CHECK_FLAG(re->status, ROUTE_ENTRY_GR_CURSOR))
+		zebra_gr_route_unlink(re);
+	re_owner_list_del(&info->owners[re->type], re);
+
+	if (dest->selected_fib == re) {
 		dest->selected_fib = NULL;
+		zebra_nhg_active_cache_invalidate(&rn->p);
+	}
 
 	rib_re_nhg_free(re);
 
@@ -3858,6 +3933,10 @@ void rib_delnode(struct route_node *rn, struct route_entry *re)
 			    (void *)rn, (void *)re);
 	SET_FLAG(re->status, ROUTE_ENTRY_REMOVED);
 
+	/* No longer usable for nexthop resolution */
+	if (re == rib_dest_from_rnode(rn)->selected_fib)
+		zebra_nhg_active_cache_invalidate(&rn->p);
+
 	afi = (rn->p.family == AF_INET)
 		      ? AFI_IP
 		      : (rn->p.family == AF_INET6) ? AFI_IP6 : AFI_MAX;
@@ -4466,22 +4545,23 @@ void rib_sweep_route(struct thread *t)
 unsigned long rib_score_proto_table(uint8_t proto, unsigned short instance,
 				    struct route_table *table)
 {
-	struct route_node *rn;
+	struct rib_table_info *info;
 	struct route_entry *re;
-	struct route_entry *next;
 	unsigned long n = 0;
 
-	if (table)
-		for (rn = route_top(table); rn; rn = srcdest_route_next(rn))
-			RNODE_FOREACH_RE_SAFE (rn, re, next) {
-				if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
-					continue;
-				if (re->type == proto
-				    && re->instance == instance) {
-					rib_delnode(rn, re);
-					n++;
-				}
-			}
+	if (!table)
+		return 0;
+
+	/* only the protocol's own routes, not the whole table */
+	info = rib_table_info(table);
+	frr_each_safe (re_owner_list, &info->owners[proto], re) {
+		if (CHECK_FLAG(re->status, ROUTE_ENTRY_REMOVED))
+			continue;
+		if (re->instance == instance) {
+			rib_delnode(re->rn, re);
+			n++;
+		}
+	}
 	return n;
 }
 
@@ -4528,6 +4608,8 @@ void rib_close_table(struct route_table *table)
 			dest->selected_fib = NULL;
 		}
 	}
+
+	zebra_nhg_active_cache_flush();
 }
 
 /*
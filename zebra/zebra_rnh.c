@@ -57,6 +57,15 @@ DEFINE_MTYPE_STATIC(ZEBRA, RNH, "Nexthop tracking object");
  */
 static bool rnh_hide_backups;
 
+/* Changes to tracked nexthops are sent to clients after this delay,
+ * so that a nexthop changing several times in a row (e.g. while the
+ * IGP converges) only results in one update.
+ */
+#define ZEBRA_RNH_NOTIFY_DELAY_MSEC 10
+
+static struct rnh_notify_list_head rnh_notify_pending;
+static struct thread *t_rnh_notify;
+
 static void free_state(vrf_id_t vrf_id, struct route_entry *re,
 		       struct route_node *rn);
 static void copy_state(struct rnh *rnh, const struct route_entry *re,
@@ -68,6 +77,7 @@ static int zebra_client_cleanup_rnh(struct zserv *client);
 void zebra_rnh_init(void)
 {
 	hook_register(zserv_client_close, zebra_client_cleanup_rnh);
+	rnh_notify_list_init(&rnh_notify_pending);
 }
 
 static inline struct route_table *get_rnh_table(vrf_id_t vrfid, afi_t afi,
@@ -220,6 +230,8 @@ void zebra_free_rnh(struct rnh *rnh)
 	struct route_table *table;
 
 	zebra_rnh_remove_from_routing_table(rnh);
+	if (CHECK_FLAG(rnh->flags, ZEBRA_NHT_NOTIFY_PENDING))
+		rnh_notify_list_del(&rnh_notify_pending, rnh);
 	rnh->flags |= ZEBRA_NHT_DELETED;
 	list_delete(&rnh->client_list);
 	list_delete(&rnh->zebra_pseudowire_list);
@@ -390,18 +402,18 @@ static void zebra_rnh_clear_nexthop_rnh_filters(struct route_entry *re)
  * resolving a NH.
  */
 static int zebra_rnh_apply_nht_rmap(afi_t afi, struct zebra_vrf *zvrf,
-				    struct route_node *prn,
+				    const struct prefix *p,
 				    struct route_entry *re, int proto)
 {
 	int at_least_one = 0;
 	struct nexthop *nexthop;
 	route_map_result_t ret;
 
-	if (prn && re) {
+	if (p && re) {
 		for (nexthop = re->nhe->nhg.nexthop; nexthop;
 		     nexthop = nexthop->next) {
 			ret = zebra_nht_route_map_check(
-				afi, proto, &prn->p, zvrf, re, nexthop);
+				afi, proto, p, zvrf, re, nexthop);
 			if (ret != RMAP_DENYMATCH)
 				at_least_one++; /* at least one valid NH */
 			else {
@@ -414,38 +426,27 @@ static int zebra_rnh_apply_nht_rmap(afi_t afi, struct zebra_vrf *zvrf,
 }
 
 /*
- * Notify clients registered for this nexthop about a change.
+ * Notify clients registered for this nexthop about its current state.
  */
 static void zebra_rnh_notify_protocol_clients(struct zebra_vrf *zvrf, afi_t afi,
-					      struct route_node *nrn,
-					      struct rnh *rnh,
-					      struct route_node *prn,
-					      struct route_entry *re)
+					      struct rnh *rnh)
 {
+	struct route_node *nrn = rnh->node;
+	struct route_entry *re = rnh->state;
 	struct listnode *node;
 	struct zserv *client;
 	int num_resolving_nh;
 
-	if (IS_ZEBRA_DEBUG_NHT) {
-		if (prn && re) {
-			zlog_debug("%s(%u):%pRN: NH resolved over route %pRN",
-				   VRF_LOGNAME(zvrf->vrf), zvrf->vrf->vrf_id,
-				   nrn, prn);
-		} else
-			zlog_debug("%s(%u):%pRN: NH has become unresolved",
-				   VRF_LOGNAME(zvrf->vrf), zvrf->vrf->vrf_id,
-				   nrn);
-	}
-
 	for (ALL_LIST_ELEMENTS_RO(rnh->client_list, node, client)) {
-		if (prn && re) {
+		if (re) {
 			/* Apply route-map for this client to route resolving
 			 * this
 			 * nexthop to see if it is filtered or not.
 			 */
 			zebra_rnh_clear_nexthop_rnh_filters(re);
 			num_resolving_nh = zebra_rnh_apply_nht_rmap(
-				afi, zvrf, prn, re, client->proto);
+				afi, zvrf, &rnh->resolved_route, re,
+				client->proto);
 			if (num_resolving_nh)
 				rnh->filtered[client->proto] = 0;
 			else
@@ -477,6 +478,45 @@ static void zebra_rnh_notify_protocol_clients(struct zebra_vrf *zvrf, afi_t afi,
 		zebra_rnh_clear_nexthop_rnh_filters(re);
 }
 
+static void zebra_rnh_notify_pending(struct thread *thread)
+{
+	struct zebra_vrf *zvrf;
+	struct rnh *rnh;
+
+	while ((rnh = rnh_notify_list_pop(&rnh_notify_pending))) {
+		UNSET_FLAG(rnh->flags, ZEBRA_NHT_NOTIFY_PENDING);
+
+		zvrf = zebra_vrf_lookup_by_id(rnh->vrf_id);
+		if (zvrf)
+			zebra_rnh_notify_protocol_clients(zvrf, rnh->afi, rnh);
+	}
+}
+
+/*
+ * Schedule notifying the clients of a nexthop, or do it right away; the
+ * state sent is the one at that time.
+ */
+static void zebra_rnh_notify(struct zebra_vrf *zvrf, afi_t afi,
+			     struct rnh *rnh, bool now)
+{
+	if (now) {
+		if (CHECK_FLAG(rnh->flags, ZEBRA_NHT_NOTIFY_PENDING)) {
+			rnh_notify_list_del(&rnh_notify_pending, rnh);
+			UNSET_FLAG(rnh->flags, ZEBRA_NHT_NOTIFY_PENDING);
+		}
+		zebra_rnh_notify_protocol_clients(zvrf, afi, rnh);
+		return;
+	}
+
+	if (CHECK_FLAG(rnh->flags, ZEBRA_NHT_NOTIFY_PENDING))
+		return;
+
+	SET_FLAG(rnh->flags, ZEBRA_NHT_NOTIFY_PENDING);
+	rnh_notify_list_add_tail(&rnh_notify_pending, rnh);
+	thread_add_timer_msec(zrouter.master, zebra_rnh_notify_pending, NULL,
+			      ZEBRA_RNH_NOTIFY_DELAY_MSEC, &t_rnh_notify);
+}
+
 /*
  * Utility to determine whether a candidate nexthop is useable. We make this
  * check in a couple of places, so this is a single home for the logic we
@@ -698,12 +738,26 @@ static void zebra_rnh_eval_nexthop_entry(struct zebra_vrf *zvrf, afi_t afi,
 	zebra_rnh_store_in_routing_table(rnh);
 
 	if (state_changed || force) {
+		if (IS_ZEBRA_DEBUG_NHT) {
+			if (prn && re)
+				zlog_debug(
+					"%s(%u):%pRN: NH resolved over route %pRN",
+					VRF_LOGNAME(zvrf->vrf),
+					zvrf->vrf->vrf_id, nrn, prn);
+			else
+				zlog_debug(
+					"%s(%u):%pRN: NH has become unresolved",
+					VRF_LOGNAME(zvrf->vrf),
+					zvrf->vrf->vrf_id, nrn);
+		}
+
 		/* NOTE: Use the "copy" of resolving route stored in 'rnh' i.e.,
 		 * rnh->state.
 		 */
-		/* Notify registered protocol clients. */
-		zebra_rnh_notify_protocol_clients(zvrf, afi, nrn, rnh, prn,
-						  rnh->state);
+		/* Notify registered protocol clients; forced evaluations
+		 * (e.g. on registration) are answered right away.
+		 */
+		zebra_rnh_notify(zvrf, afi, rnh, force);
 
 		/* Process pseudowires attached to this nexthop */
 		zebra_rnh_process_pseudowires(zvrf->vrf->vrf_id, rnh);
@@ -23,6 +23,7 @@
 
 #include <pthread.h>
 #include "lib/frratomic.h"
+#include "lib/taskpool.h"
 
 #include "zebra_router.h"
 #include "zebra_pbr.h"
@@ -112,6 +113,7 @@ struct route_table *zebra_router_get_table(struct zebra_vrf *zvrf,
 	struct zebra_router_table finder;
 	struct zebra_router_table *zrt;
 	struct rib_table_info *info;
+	int type;
 
 	memset(&finder, 0, sizeof(finder));
 	finder.afi = afi;
@@ -136,6 +138,8 @@ struct route_table *zebra_router_get_table(struct zebra_vrf *zvrf,
 	info->afi = afi;
 	info->safi = safi;
 	info->table_id = tableid;
+	for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+		re_owner_list_init(&info->owners[type]);
 	route_table_set_info(zrt->table, info);
 	zrt->table->cleanup = zebra_rtable_node_cleanup;
 
@@ -180,12 +184,16 @@ void zebra_router_sweep_nhgs(void)
 
 static void zebra_router_free_table(struct zebra_router_table *zrt)
 {
-	void *table_info;
+	struct rib_table_info *table_info;
+	int type;
 
 	table_info = route_table_get_info(zrt->table);
 	route_table_finish(zrt->table);
 	RB_REMOVE(zebra_router_table_head, &zrouter.tables, zrt);
 
+	for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+		re_owner_list_fini(&table_info->owners[type]);
+
 	XFREE(MTYPE_RIB_TABLE_INFO, table_info);
 	XFREE(MTYPE_ZEBRA_RT_TABLE, zrt);
 }
@@ -240,6 +248,7 @@ void zebra_router_terminate(void)
 
 	work_queue_free_and_null(&zrouter.ribq);
 	meta_queue_free(zrouter.mq, NULL);
+	taskpool_free(&zrouter.rib_pool);
 
 	zebra_vxlan_disable();
 	zebra_mlag_terminate();
@@ -311,10 +320,17 @@ void zebra_router_init(bool asic_offload, bool notify_on_ack)
 	zrouter.nhgs_id =
 		hash_create_size(8, zebra_nhg_id_key, zebra_nhg_hash_id_equal,
 				 "Zebra Router Nexthop Groups ID index");
+	hash_set_incremental(zrouter.nhgs, true);
+	hash_set_incremental(zrouter.nhgs_id, true);
 
 	zrouter.asic_offloaded = asic_offload;
 	zrouter.notify_on_ack = notify_on_ack;
 
+	/* the main pthread does its share of the work too */
+	if (zrouter.rib_threads > 1)
+		zrouter.rib_pool =
+			taskpool_new("zebra_rib", zrouter.rib_threads - 1);
+
 #ifdef HAVE_SCRIPTING
 	zebra_script_init();
 #endif
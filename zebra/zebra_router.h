@@ -183,6 +183,13 @@ struct zebra_router {
 	/* Meta Queue Information */
 	struct meta_queue *mq;
 
+	/* pthreads resolving nexthops for the meta queue,
+	 * see zebra_nhg_active_prepare()
+	 */
+#define ZEBRA_RIB_THREADS_MAX 64
+	unsigned int rib_threads;
+	struct taskpool *rib_pool;
+
 	/* LSP work queue */
 	struct work_queue *lsp_process_q;
 
@@ -230,6 +237,9 @@ struct zebra_router {
 #define ZEBRA_DEFAULT_NHG_KEEP_TIMER 180
 	uint32_t nhg_keep;
 
+	/* msecs to coalesce interface oper state changes for, 0 is off */
+	uint32_t if_coalesce_time;
+
 	/* Should we allow non FRR processes to delete our routes */
 	bool allow_delete;
 };
@@ -36,6 +36,7 @@
 #include "vrf.h"
 #include "hook.h"
 #include "libfrr.h"
+#include "monotime.h"
 #include "lib/version.h"
 
 #include "zebra/rib.h"
@@ -88,6 +89,50 @@
 
 static oid ipfw_oid[] = {IPFWMIB};
 
+DEFINE_MTYPE_STATIC(ZEBRA, SNMP_FWCACHE, "SNMP forwarding table snapshot");
+
+/* ipForwardTable row, in OID index order (dest, proto, policy, nexthop);
+ * policy is always 0.
+ */
+struct fwtable_entry {
+	struct in_addr dest;
+	int proto;
+	struct in_addr nexthop;
+
+	uint8_t prefixlen;
+	ifindex_t ifindex;
+	enum nexthop_types_t nh_type;
+};
+
+/* Walking the table with GETNEXT looks up one row at a time, which used to
+ * scan the whole RIB for each of them.  Rows are instead served from a
+ * sorted snapshot that is rebuilt when the RIB has changed since, but not
+ * more than once per FWCACHE_MIN_AGE so a walk during churn still finishes.
+ */
+#define FWCACHE_MIN_AGE 1000000 /* usec */
+
+static struct {
+	struct fwtable_entry *entries;
+	size_t count, alloc;
+	/* route entries, including those without nexthop that have no row */
+	int routes;
+
+	bool valid;
+	uint64_t version;
+	struct timeval built;
+} fwcache;
+
+static uint64_t fwcache_rib_version;
+
+static bool fwcache_refresh(void);
+
+static int fwcache_rib_update(struct route_node *rn, const char *reason)
+{
+	if (rn->p.family == AF_INET)
+		fwcache_rib_version++;
+	return 0;
+}
+
 /* Hook functions. */
 static uint8_t *ipFwNumber(struct variable *, oid[], size_t *, int, size_t *,
 			   WriteMethod **);
@@ -139,26 +184,17 @@ static uint8_t *ipFwNumber(struct variable *v, oid objid[], size_t *objid_len,
 			   WriteMethod **write_method)
 {
 	static int result;
-	struct route_table *table;
-	struct route_node *rn;
-	struct route_entry *re;
 
 	if (smux_header_generic(v, objid, objid_len, exact, val_len,
 				write_method)
 	    == MATCH_FAILED)
 		return NULL;
 
-	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
-	if (!table)
+	if (!fwcache_refresh())
 		return NULL;
 
 	/* Return number of routing entries. */
-	result = 0;
-	for (rn = route_top(table); rn; rn = route_next(rn))
-		RNODE_FOREACH_RE (rn, re) {
-			result++;
-		}
-
+	result = fwcache.routes;
 	return (uint8_t *)&result;
 }
 
@@ -167,68 +203,20 @@ static uint8_t *ipCidrNumber(struct variable *v, oid objid[], size_t *objid_len,
 			     WriteMethod **write_method)
 {
 	static int result;
-	struct route_table *table;
-	struct route_node *rn;
-	struct route_entry *re;
 
 	if (smux_header_generic(v, objid, objid_len, exact, val_len,
 				write_method)
 	    == MATCH_FAILED)
 		return NULL;
 
-	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
-	if (!table)
+	if (!fwcache_refresh())
 		return 0;
 
 	/* Return number of routing entries. */
-	result = 0;
-	for (rn = route_top(table); rn; rn = route_next(rn))
-		RNODE_FOREACH_RE (rn, re) {
-			result++;
-		}
-
+	result = fwcache.routes;
 	return (uint8_t *)&result;
 }
 
-static int in_addr_cmp(uint8_t *p1, uint8_t *p2)
-{
-	int i;
-
-	for (i = 0; i < 4; i++) {
-		if (*p1 < *p2)
-			return -1;
-		if (*p1 > *p2)
-			return 1;
-		p1++;
-		p2++;
-	}
-	return 0;
-}
-
-static int in_addr_add(uint8_t *p, int num)
-{
-	int i, ip0;
-
-	ip0 = *p;
-	p += 4;
-	for (i = 3; 0 <= i; i--) {
-		p--;
-		if (*p + num > 255) {
-			*p += num;
-			num = 1;
-		} else {
-			*p += num;
-			return 1;
-		}
-	}
-	if (ip0 > *p) {
-		/* ip + num > 0xffffffff */
-		return 0;
-	}
-
-	return 1;
-}
-
 static int proto_trans(int type)
 {
 	switch (type) {
@@ -255,87 +243,118 @@ static int proto_trans(int type)
 	}
 }
 
-static void check_replace(struct route_node *np2, struct route_entry *re2,
-			  struct route_node **np, struct route_entry **re)
+static int fwtable_cmp(const struct fwtable_entry *a,
+		       const struct fwtable_entry *b)
 {
-	int proto, proto2;
+	if (a->dest.s_addr != b->dest.s_addr)
+		return ntohl(a->dest.s_addr) < ntohl(b->dest.s_addr) ? -1 : 1;
+	if (a->proto != b->proto)
+		return a->proto < b->proto ? -1 : 1;
+	if (a->nexthop.s_addr != b->nexthop.s_addr)
+		return ntohl(a->nexthop.s_addr) < ntohl(b->nexthop.s_addr) ? -1
+									  : 1;
+	return 0;
+}
 
-	if (!*np) {
-		*np = np2;
-		*re = re2;
-		return;
-	}
+static int fwtable_qsort_cmp(const void *a, const void *b)
+{
+	const struct fwtable_entry *ea = a, *eb = b;
+	int ret = fwtable_cmp(ea, eb);
 
-	if (prefix_cmp(&(*np)->p, &np2->p) < 0)
-		return;
-	if (prefix_cmp(&(*np)->p, &np2->p) > 0) {
-		*np = np2;
-		*re = re2;
-		return;
-	}
+	/* same OID index, more specific prefix last as before */
+	if (!ret && ea->prefixlen != eb->prefixlen)
+		ret = ea->prefixlen < eb->prefixlen ? -1 : 1;
+	return ret;
+}
 
-	proto = proto_trans((*re)->type);
-	proto2 = proto_trans(re2->type);
+/* false if there's no table */
+static bool fwcache_refresh(void)
+{
+	struct route_table *table;
+	struct route_node *rn;
+	struct route_entry *re;
+	struct nexthop *nexthop;
+	struct fwtable_entry *e;
 
-	if (proto2 > proto)
-		return;
-	if (proto2 < proto) {
-		*np = np2;
-		*re = re2;
-		return;
-	}
+	if (fwcache.valid
+	    && (fwcache.version == fwcache_rib_version
+		|| monotime_since(&fwcache.built, NULL) < FWCACHE_MIN_AGE))
+		return true;
 
-	if (in_addr_cmp((uint8_t *)&(*re)->nhe->nhg.nexthop->gate.ipv4,
-			(uint8_t *)&re2->nhe->nhg.nexthop->gate.ipv4)
-	    <= 0)
-		return;
+	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
+	if (!table)
+		return false;
 
-	*np = np2;
-	*re = re2;
-	return;
-}
+	fwcache.count = 0;
+	fwcache.routes = 0;
 
-static void get_fwtable_route_node(struct variable *v, oid objid[],
-				   size_t *objid_len, int exact,
-				   struct route_node **np,
-				   struct route_entry **re)
-{
-	struct in_addr dest;
-	struct route_table *table;
-	struct route_node *np2;
-	struct route_entry *re2;
-	int proto;
-	int policy;
-	struct in_addr nexthop;
-	uint8_t *pnt;
-	int i;
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		RNODE_FOREACH_RE (rn, re) {
+			fwcache.routes++;
 
-	/* Init index variables */
+			nexthop = re->nhe->nhg.nexthop;
+			if (!nexthop)
+				continue;
 
-	pnt = (uint8_t *)&dest;
-	for (i = 0; i < 4; i++)
-		*pnt++ = 0;
+			if (fwcache.count == fwcache.alloc) {
+				fwcache.alloc = MAX(fwcache.alloc * 2, 64);
+				fwcache.entries = XREALLOC(
+					MTYPE_SNMP_FWCACHE, fwcache.entries,
+					fwcache.alloc * sizeof(*e));
+			}
 
-	pnt = (uint8_t *)&nexthop;
-	for (i = 0; i < 4; i++)
-		*pnt++ = 0;
+			e = &fwcache.entries[fwcache.count++];
+			e->dest = rn->p.u.prefix4;
+			e->prefixlen = rn->p.prefixlen;
+			e->proto = proto_trans(re->type);
+			e->nexthop = nexthop->gate.ipv4;
+			e->ifindex = nexthop->ifindex;
+			e->nh_type = nexthop->type;
+		}
+
+	qsort(fwcache.entries, fwcache.count, sizeof(*fwcache.entries),
+	      fwtable_qsort_cmp);
 
-	proto = 0;
-	policy = 0;
+	fwcache.valid = true;
+	fwcache.version = fwcache_rib_version;
+	monotime(&fwcache.built);
+	return true;
+}
 
-	/* Init return variables */
+/* first row with an index >= key, or > key if after is set */
+static struct fwtable_entry *fwcache_find(const struct fwtable_entry *key,
+					  bool after)
+{
+	size_t lo = 0, hi = fwcache.count, mid;
+	int cmp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = fwtable_cmp(&fwcache.entries[mid], key);
+		if (cmp < 0 || (after && cmp == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < fwcache.count ? &fwcache.entries[lo] : NULL;
+}
 
-	*np = NULL;
-	*re = NULL;
+static struct fwtable_entry *get_fwtable_entry(struct variable *v,
+					       oid objid[], size_t *objid_len,
+					       int exact)
+{
+	struct fwtable_entry key = {}, *e;
+	int policy = 0;
+	uint8_t *pnt;
+	int i;
 
 	/* Short circuit exact matches of wrong length */
 
 	if (exact && (*objid_len != (unsigned)v->namelen + 10))
-		return;
+		return NULL;
 
-	table = zebra_vrf_table(AFI_IP, SAFI_UNICAST, VRF_DEFAULT);
-	if (!table)
-		return;
+	if (!fwcache_refresh())
+		return NULL;
 
 	/* Get INDEX information out of OID.
 	 * ipForwardDest, ipForwardProto, ipForwardPolicy, ipForwardNextHop
@@ -343,135 +362,82 @@ static void get_fwtable_route_node(struct variable *v, oid objid[],
 
 	if (*objid_len > (unsigned)v->namelen)
 		oid2in_addr(objid + v->namelen,
-			    MIN(4U, *objid_len - v->namelen), &dest);
+			    MIN(4U, *objid_len - v->namelen), &key.dest);
 
 	if (*objid_len > (unsigned)v->namelen + 4)
-		proto = objid[v->namelen + 4];
+		key.proto = objid[v->namelen + 4];
 
 	if (*objid_len > (unsigned)v->namelen + 5)
 		policy = objid[v->namelen + 5];
 
 	if (*objid_len > (unsigned)v->namelen + 6)
 		oid2in_addr(objid + v->namelen + 6,
-			    MIN(4U, *objid_len - v->namelen - 6), &nexthop);
-
-	/* Apply GETNEXT on not exact search */
-
-	if (!exact && (*objid_len >= (unsigned)v->namelen + 10)) {
-		if (!in_addr_add((uint8_t *)&nexthop, 1))
-			return;
-	}
+			    MIN(4U, *objid_len - v->namelen - 6),
+			    &key.nexthop);
 
-	/* For exact: search matching entry in rib table. */
+	/* For exact: search matching entry in the snapshot. */
 
 	if (exact) {
 		if (policy) /* Not supported (yet?) */
-			return;
-		for (*np = route_top(table); *np; *np = route_next(*np)) {
-			if (!in_addr_cmp(&(*np)->p.u.prefix,
-					 (uint8_t *)&dest)) {
-				RNODE_FOREACH_RE (*np, *re) {
-					if (!in_addr_cmp((uint8_t *)&(*re)->nhe
-							 ->nhg.nexthop
-							 ->gate.ipv4,
-							 (uint8_t *)&nexthop))
-						if (proto
-						    == proto_trans((*re)->type))
-							return;
-				}
-			}
-		}
-		return;
-	}
-
-	/* Search next best entry */
-
-	for (np2 = route_top(table); np2; np2 = route_next(np2)) {
-
-		/* Check destination first */
-		if (in_addr_cmp(&np2->p.u.prefix, (uint8_t *)&dest) > 0)
-			RNODE_FOREACH_RE (np2, re2) {
-				check_replace(np2, re2, np, re);
-			}
-
-		if (in_addr_cmp(&np2->p.u.prefix, (uint8_t *)&dest)
-		    == 0) { /* have to look at each re individually */
-			RNODE_FOREACH_RE (np2, re2) {
-				int proto2, policy2;
-
-				proto2 = proto_trans(re2->type);
-				policy2 = 0;
-
-				if ((policy < policy2)
-				    || ((policy == policy2) && (proto < proto2))
-				    || ((policy == policy2) && (proto == proto2)
-					&& (in_addr_cmp(
-						    (uint8_t *)&re2->nhe
-						    ->nhg.nexthop->gate.ipv4,
-						    (uint8_t *)&nexthop)
-					    >= 0)))
-					check_replace(np2, re2, np, re);
-			}
-		}
+			return NULL;
+		e = fwcache_find(&key, false);
+		if (e && fwtable_cmp(e, &key) == 0)
+			return e;
+		return NULL;
 	}
 
-	if (!*re)
-		return;
+	/* Search next entry;  all rows have policy 0, so a higher one in the
+	 * OID means the next protocol.  A partial OID is followed by its
+	 * first row, a complete one by the row after.
+	 */
 
-	policy = 0;
-	proto = proto_trans((*re)->type);
+	if (policy) {
+		key.nexthop.s_addr = INADDR_BROADCAST;
+		e = fwcache_find(&key, true);
+	} else
+		e = fwcache_find(&key,
+				 *objid_len >= (unsigned)v->namelen + 10);
+	if (!e)
+		return NULL;
 
 	*objid_len = v->namelen + 10;
-	pnt = (uint8_t *)&(*np)->p.u.prefix;
+	pnt = (uint8_t *)&e->dest;
 	for (i = 0; i < 4; i++)
 		objid[v->namelen + i] = *pnt++;
 
-	objid[v->namelen + 4] = proto;
-	objid[v->namelen + 5] = policy;
-
-	{
-		struct nexthop *nexthop;
+	objid[v->namelen + 4] = e->proto;
+	objid[v->namelen + 5] = 0;
 
-		nexthop = (*re)->nhe->nhg.nexthop;
-		if (nexthop) {
-			pnt = (uint8_t *)&nexthop->gate.ipv4;
-			for (i = 0; i < 4; i++)
-				objid[i + v->namelen + 6] = *pnt++;
-		}
-	}
+	pnt = (uint8_t *)&e->nexthop;
+	for (i = 0; i < 4; i++)
+		objid[i + v->namelen + 6] = *pnt++;
 
-	return;
+	return e;
 }
 
 static uint8_t *ipFwTable(struct variable *v, oid objid[], size_t *objid_len,
 			  int exact, size_t *val_len,
 			  WriteMethod **write_method)
 {
-	struct route_node *np;
-	struct route_entry *re;
+	struct fwtable_entry *e;
 	static int result;
 	static int resarr[2];
 	static struct in_addr netmask;
-	struct nexthop *nexthop;
 
 	if (smux_header_table(v, objid, objid_len, exact, val_len, write_method)
 	    == MATCH_FAILED)
 		return NULL;
 
-	get_fwtable_route_node(v, objid, objid_len, exact, &np, &re);
-	if (!np)
-		return NULL;
-
-	nexthop = re->nhe->nhg.nexthop;
-	if (!nexthop)
+	e = get_fwtable_entry(v, objid, objid_len, exact);
+	if (!e)
 		return NULL;
 
 	switch (v->magic) {
 	case IPFORWARDDEST:
 		*val_len = 4;
-		return &np->p.u.prefix;
+		return (uint8_t *)&e->dest;
 	case IPFORWARDMASK:
-		masklen2ip(np->p.prefixlen, &netmask);
+		masklen2ip(e->prefixlen, &netmask);
 		*val_len = 4;
 		return (uint8_t *)&netmask;
 	case IPFORWARDPOLICY:
@@ -480,19 +446,19 @@ static uint8_t *ipFwTable(struct variable *v, oid objid[], size_t *objid_len,
 		return (uint8_t *)&result;
 	case IPFORWARDNEXTHOP:
 		*val_len = 4;
-		return (uint8_t *)&nexthop->gate.ipv4;
+		return (uint8_t *)&e->nexthop;
 	case IPFORWARDIFINDEX:
 		*val_len = sizeof(int);
-		return (uint8_t *)&nexthop->ifindex;
+		return (uint8_t *)&e->ifindex;
 	case IPFORWARDTYPE:
-		if (nexthop->type == NEXTHOP_TYPE_IFINDEX)
+		if (e->nh_type == NEXTHOP_TYPE_IFINDEX)
 			result = 3;
 		else
 			result = 4;
 		*val_len = sizeof(int);
 		return (uint8_t *)&result;
 	case IPFORWARDPROTO:
-		result = proto_trans(re->type);
+		result = e->proto;
 		*val_len = sizeof(int);
 		return (uint8_t *)&result;
 	case IPFORWARDAGE:
@@ -554,6 +520,7 @@ static uint8_t *ipCidrTable(struct variable *v, oid objid[], size_t *objid_len,
 static int zebra_snmp_init(struct thread_master *tm)
 {
 	smux_init(tm);
+	hook_register(rib_update, fwcache_rib_update);
 	REGISTER_MIB("mibII/ipforward", zebra_variables, variable, ipfw_oid);
 	return 0;
 }
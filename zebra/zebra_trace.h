@@ -123,6 +123,88 @@ TRACEPOINT_EVENT(
 		)
 	)
 
+TRACEPOINT_EVENT(
+	frr_zebra,
+	netlink_batch_flush,
+	TP_ARGS(
+		const char *, nl_name,
+		size_t, length,
+		size_t, msgcnt,
+		int, err),
+	TP_FIELDS(
+		ctf_string(nl_name, nl_name)
+		ctf_integer(size_t, length, length)
+		ctf_integer(size_t, msgcnt, msgcnt)
+		ctf_integer(int, err, err)
+		)
+	)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	rib_process,
+	TP_ARGS(
+		struct route_node *, rn,
+		vrf_id_t, vrf_id),
+	TP_FIELDS(
+		ctf_integer(uint32_t, vrf_id, vrf_id)
+		ctf_integer(uint8_t, family, rn->p.family)
+		ctf_integer(uint16_t, prefixlen, rn->p.prefixlen)
+		ctf_array(unsigned char, prefix, &rn->p.u.prefix6, 16)
+		)
+	)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	dplane_enqueue,
+	TP_ARGS(
+		int, op,
+		uint32_t, queued),
+	TP_FIELDS(
+		ctf_integer(int, op, op)
+		ctf_integer(uint32_t, queued, queued)
+		)
+	)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	dplane_dequeue,
+	TP_ARGS(
+		int, count),
+	TP_FIELDS(
+		ctf_integer(int, count, count)
+		)
+	)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	zserv_recv,
+	TP_ARGS(
+		uint8_t, proto,
+		uint16_t, command,
+		uint16_t, length,
+		uint32_t, vrf_id),
+	TP_FIELDS(
+		ctf_integer(uint8_t, proto, proto)
+		ctf_integer(uint16_t, command, command)
+		ctf_integer(uint16_t, length, length)
+		ctf_integer(uint32_t, vrf_id, vrf_id)
+		)
+	)
+
+TRACEPOINT_EVENT(
+	frr_zebra,
+	zserv_send,
+	TP_ARGS(
+		uint8_t, proto,
+		uint16_t, command,
+		size_t, length),
+	TP_FIELDS(
+		ctf_integer(uint8_t, proto, proto)
+		ctf_integer(uint16_t, command, command)
+		ctf_integer(size_t, length, length)
+		)
+	)
+
 #include <lttng/tracepoint-event.h>
 
 #endif /* HAVE_LTTNG */
@@ -1182,6 +1182,26 @@ static void vty_show_ip_route_detail_json(struct vty *vty,
 	vty_json(vty, json);
 }
 
+/*
+ * First node (in route_next() order) at or below p, locked, or NULL if the
+ * table has nothing covered by p.  Saves "longer-prefixes" from looking at
+ * every route in the table.
+ */
+static struct route_node *show_route_subtree_top(struct route_table *table,
+						 const struct prefix *p)
+{
+	struct route_node *node = table->top;
+
+	while (node && node->p.prefixlen < p->prefixlen
+	       && prefix_match(&node->p, p))
+		node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
+
+	if (!node || !prefix_match(p, &node->p))
+		return NULL;
+
+	return route_lock_node(node);
+}
+
 static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 				 struct route_table *table, afi_t afi,
 				 bool use_fib, route_tag_t tag,
@@ -1195,7 +1215,7 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 	struct route_entry *re;
 	int first = 1;
 	rib_dest_t *dest;
-	json_object *json = NULL;
+	struct vty_json_stream js;
 	json_object *json_prefix = NULL;
 	uint32_t addr;
 	char buf[BUFSIZ];
@@ -1211,11 +1231,26 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 	 *   => display the VRF and table if specific
 	 */
 
-	if (use_json)
-		json = json_object_new_object();
+	/* Prefixes are written out one by one, not as a single JSON tree */
+	if (use_json) {
+		vty_json_stream_init(&js, vty);
+		vty_json_stream_open(&js, NULL, false);
+	}
+
+	/* Show all routes, or only the subtree under longer_prefix_p */
+	if (longer_prefix_p)
+		rn = show_route_subtree_top(table, longer_prefix_p);
+	else
+		rn = route_top(table);
+
+	for (; rn; rn = srcdest_route_next(rn)) {
+		/* subtree is contiguous in walk order, done once we leave it */
+		if (longer_prefix_p && !rnode_is_srcnode(rn)
+		    && !prefix_match(longer_prefix_p, &rn->p)) {
+			route_unlock_node(rn);
+			break;
+		}
 
-	/* Show all routes. */
-	for (rn = route_top(table); rn; rn = srcdest_route_next(rn)) {
 		dest = rib_dest_from_rnode(rn);
 
 		RNODE_FOREACH_RE (rn, re) {
@@ -1286,13 +1321,13 @@ static void do_show_route_helper(struct vty *vty, struct zebra_vrf *zvrf,
 
 		if (json_prefix) {
 			prefix2str(&rn->p, buf, sizeof(buf));
-			json_object_object_add(json, buf, json_prefix);
+			vty_json_stream_add(&js, buf, json_prefix);
 			json_prefix = NULL;
 		}
 	}
 
 	if (use_json)
-		vty_json(vty, json);
+		vty_json_stream_end(&js);
 }
 
 static void do_show_ip_route_all(struct vty *vty, struct zebra_vrf *zvrf,
@@ -1455,7 +1490,9 @@ static void show_nexthop_group_out(struct vty *vty, struct nhg_hash_entry *nhe)
 
 	vty_out(vty, "     Uptime: %s\n", up_str);
 	vty_out(vty, "     VRF: %s\n", vrf_id_to_name(nhe->vrf_id));
-
+	if (zebra_nhg_kernel_id(nhe) != nhe->id)
+		vty_out(vty, "     Kernel ID: %u (shared)\n",
+			zebra_nhg_kernel_id(nhe));
 
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_VALID)) {
 		vty_out(vty, "     Valid");
@@ -1596,6 +1633,62 @@ static void show_nexthop_group_cmd_helper(struct vty *vty,
 	hash_walk(zrouter.nhgs_id, nhe_show_walker, &ctx);
 }
 
+struct nhe_summary_context {
+	uint32_t total;
+	uint32_t singletons;
+	uint32_t proto;
+	uint32_t installed;
+	uint32_t shared;
+};
+
+static int nhe_summary_walker(struct hash_bucket *bucket, void *arg)
+{
+	struct nhe_summary_context *ctx = arg;
+	struct nhg_hash_entry *nhe = bucket->data;
+
+	ctx->total++;
+	if (zebra_nhg_depends_is_empty(nhe))
+		ctx->singletons++;
+	if (PROTO_OWNED(nhe))
+		ctx->proto++;
+
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED)) {
+		ctx->installed++;
+		if (zebra_nhg_kernel_id(nhe) != nhe->id)
+			ctx->shared++;
+	}
+
+	return HASHWALK_CONTINUE;
+}
+
+DEFPY (show_nexthop_group_summary,
+       show_nexthop_group_summary_cmd,
+       "show nexthop-group rib summary",
+       SHOW_STR
+       "Show Nexthop Groups\n"
+       "RIB information\n"
+       "Summary of nexthop groups and kernel objects\n")
+{
+	struct nhe_summary_context ctx = {};
+
+	hash_walk(zrouter.nhgs_id, nhe_summary_walker, &ctx);
+
+	vty_out(vty, "Nexthop groups:       %u\n", ctx.total);
+	vty_out(vty, "  Singletons:         %u\n", ctx.singletons);
+	vty_out(vty, "  Groups:             %u\n",
+		ctx.total - ctx.singletons);
+	vty_out(vty, "  Protocol owned:     %u\n", ctx.proto);
+	vty_out(vty, "Installed:            %u\n", ctx.installed);
+	vty_out(vty, "  In own object:      %u\n",
+		ctx.installed - ctx.shared);
+	vty_out(vty, "  In shared object:   %u\n", ctx.shared);
+
+	if (!zebra_nhg_kernel_nexthops_enabled())
+		vty_out(vty, "Kernel nexthop objects are not in use\n");
+
+	return CMD_SUCCESS;
+}
+
 static void if_nexthop_group_dump_vty(struct vty *vty, struct interface *ifp)
 {
 	struct zebra_if *zebra_if = NULL;
@@ -3907,6 +4000,24 @@ DEFPY (zebra_nexthop_group_keep,
 	return CMD_SUCCESS;
 }
 
+DEFPY (zebra_interface_coalesce_time,
+       zebra_interface_coalesce_time_cmd,
+       "[no] zebra interface coalesce-time (1-10000)",
+       NO_STR
+       ZEBRA_STR
+       "Interface events\n"
+       "Coalesce interface up/down changes\n"
+       "Time in milliseconds from 1-10000\n")
+{
+	zrouter.if_coalesce_time = no ? 0 : coalesce_time;
+
+	/* pending changes are applied when the timer fires otherwise */
+	if (!zrouter.if_coalesce_time)
+		if_oper_flush_all();
+
+	return CMD_SUCCESS;
+}
+
 static int config_write_protocol(struct vty *vty)
 {
 	if (zrouter.allow_delete)
@@ -3915,6 +4026,10 @@ static int config_write_protocol(struct vty *vty)
 	if (zrouter.nhg_keep != ZEBRA_DEFAULT_NHG_KEEP_TIMER)
 		vty_out(vty, "zebra nexthop-group keep %u\n", zrouter.nhg_keep);
 
+	if (zrouter.if_coalesce_time)
+		vty_out(vty, "zebra interface coalesce-time %u\n",
+			zrouter.if_coalesce_time);
+
 	if (zrouter.ribq->spec.hold != ZEBRA_RIB_PROCESS_HOLD_TIME)
 		vty_out(vty, "zebra work-queue %u\n", zrouter.ribq->spec.hold);
 
@@ -4381,6 +4496,54 @@ DEFUN_HIDDEN(no_zebra_kernel_netlink_batch_tx_buf,
 	return CMD_SUCCESS;
 }
 
+DEFPY_HIDDEN(zebra_kernel_netlink_batch_adaptive,
+	     zebra_kernel_netlink_batch_adaptive_cmd,
+	     "[no] zebra kernel netlink batch-tx-buf adaptive",
+	     NO_STR ZEBRA_STR
+	     "Zebra kernel interface\n"
+	     "Set Netlink parameters\n"
+	     "Set batch buffer size and send threshold\n"
+	     "Size batches for all pending updates\n")
+{
+	netlink_set_batch_adaptive(!no);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (zebra_kernel_netlink_ignore,
+       zebra_kernel_netlink_ignore_cmd,
+       "[no] zebra kernel netlink ignore <route table (1-4294967295)$table|route protocol (0-255)$proto|neighbor interface IFNAME$ifname>",
+       NO_STR ZEBRA_STR
+       "Zebra kernel interface\n"
+       "Set Netlink parameters\n"
+       "Filter out kernel notifications\n"
+       "Routes\n"
+       "Routes in a table\n"
+       "Table ID\n"
+       "Routes\n"
+       "Routes of a protocol\n"
+       "Protocol number (rtm_protocol)\n"
+       "Neighbors and FDB entries\n"
+       "Neighbors on an interface\n"
+       "Interface name\n")
+{
+	int ret;
+
+	if (table_str)
+		ret = netlink_ignore_table(table, !no);
+	else if (proto_str)
+		ret = netlink_ignore_protocol(proto, !no);
+	else
+		ret = netlink_ignore_interface(ifname, !no);
+
+	if (ret < 0) {
+		vty_out(vty, "%% Too many entries of this kind are ignored\n");
+		return CMD_WARNING_CONFIG_FAILED;
+	}
+
+	return CMD_SUCCESS;
+}
+
 DEFPY (zebra_protodown_bit,
        zebra_protodown_bit_cmd,
        "zebra protodown reason-bit (0-31)$bit",
@@ -4517,6 +4680,7 @@ void zebra_vty_init(void)
 	install_element(CONFIG_NODE, &no_ip_multicast_mode_cmd);
 
 	install_element(CONFIG_NODE, &zebra_nexthop_group_keep_cmd);
+	install_element(CONFIG_NODE, &zebra_interface_coalesce_time_cmd);
 	install_element(CONFIG_NODE, &ip_zebra_import_table_distance_cmd);
 	install_element(CONFIG_NODE, &no_ip_zebra_import_table_cmd);
 	install_element(CONFIG_NODE, &zebra_workqueue_timer_cmd);
@@ -4528,6 +4692,7 @@ void zebra_vty_init(void)
 	install_element(CONFIG_NODE, &backup_nexthop_recursive_use_enable_cmd);
 
 	install_element(VIEW_NODE, &show_nexthop_group_cmd);
+	install_element(VIEW_NODE, &show_nexthop_group_summary_cmd);
 	install_element(VIEW_NODE, &show_interface_nexthop_group_cmd);
 
 	install_element(VIEW_NODE, &show_vrf_cmd);
@@ -4611,6 +4776,8 @@ void zebra_vty_init(void)
 #ifdef HAVE_NETLINK
 	install_element(CONFIG_NODE, &zebra_kernel_netlink_batch_tx_buf_cmd);
 	install_element(CONFIG_NODE, &no_zebra_kernel_netlink_batch_tx_buf_cmd);
+	install_element(CONFIG_NODE, &zebra_kernel_netlink_batch_adaptive_cmd);
+	install_element(CONFIG_NODE, &zebra_kernel_netlink_ignore_cmd);
 	install_element(CONFIG_NODE, &zebra_protodown_bit_cmd);
 	install_element(CONFIG_NODE, &no_zebra_protodown_bit_cmd);
 #endif /* HAVE_NETLINK */
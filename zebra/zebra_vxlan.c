@@ -3795,7 +3795,7 @@ zebra_vxlan_remote_macip_helper(bool add, struct stream *s, vni_t *vni,
 
 		STREAM_GET(&ip->ip.addr, s, *ipa_len);
 	}
-	l += 4 + ETH_ALEN + 4 + *ipa_len;
+	l += 4 + ETH_ALEN + 2 + *ipa_len;
 	STREAM_GET(&vtep_ip->s_addr, s, IPV4_MAX_BYTELEN);
 	l += IPV4_MAX_BYTELEN;
 
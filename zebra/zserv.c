@@ -55,6 +55,7 @@
 #include "lib/frratomic.h"        /* for atomic_load_explicit, atomic_stor... */
 #include "lib/lib_errors.h"       /* for generic ferr ids */
 #include "lib/printfrr.h"         /* for string functions */
+#include "lib/jhash.h"            /* for jhash_3words */
 
 #include "zebra/debug.h"          /* for various debugging macros */
 #include "zebra/rib.h"            /* for rib_score_proto */
@@ -63,6 +64,7 @@
 #include "zebra/zserv.h"          /* for zserv */
 #include "zebra/zebra_router.h"
 #include "zebra/zebra_errors.h"   /* for error messages */
+#include "zebra/zebra_trace.h"    /* for frrtrace */
 /* clang-format on */
 
 /* privileges */
@@ -74,6 +76,32 @@ static int zsock;
 /* The lock that protects access to zapi client objects */
 static pthread_mutex_t client_mutex;
 
+/*
+ * Clients by {proto, instance, session_id}, lockless for readers.  Only
+ * changed on the main pthread.  Clients can share a key (e.g. before their
+ * hello); the oldest one on zrouter.client_list is the one in the table,
+ * which is what a search of the list used to find.
+ */
+static int zserv_client_cmp(const struct zserv *a, const struct zserv *b)
+{
+	if (a->proto != b->proto)
+		return numcmp(a->proto, b->proto);
+	if (a->instance != b->instance)
+		return numcmp(a->instance, b->instance);
+	return numcmp(a->session_id, b->session_id);
+}
+
+static uint32_t zserv_client_hash(const struct zserv *client)
+{
+	return jhash_3words(client->proto, client->instance,
+			    client->session_id, 0x5a41d1);
+}
+
+DECLARE_RCUHASH(zserv_clients, struct zserv, hitem, zserv_client_cmp,
+		zserv_client_hash);
+
+static struct zserv_clients_head zserv_clients;
+
 static struct zserv *find_client_internal(uint8_t proto,
 					  unsigned short instance,
 					  uint32_t session_id);
@@ -301,10 +329,11 @@ zwrite_fail:
  * ZAPI message (specifically at the header). The header is read and validated.
  * If the header passed validation then the length field found in the header is
  * used to compute the total length of the message. That much data is read (but
- * not inspected), appended to the header, placed into a stream and pushed onto
- * the client's input queue. A task is then scheduled on the main thread to
- * process the client's input queue. Finally, if all of this was successful,
- * this task reschedules itself.
+ * not inspected) into a stream of that size, after a copy of the header, and
+ * that stream is pushed onto the client's input queue without copying it
+ * again. A task is then scheduled on the main thread to process the client's
+ * input queue. Finally, if all of this was successful, this task reschedules
+ * itself.
  *
  * Any failure in any of these actions is handled by terminating the client.
  */
@@ -390,9 +419,20 @@ static void zserv_read(struct thread *thread)
 			goto zread_fail;
 		}
 
-		/* Read rest of data. */
+		/*
+		 * Read rest of data straight into a stream of the message's
+		 * size, which then goes on the input queue as is.
+		 */
+		if (!client->ibuf_msg) {
+			client->ibuf_msg = stream_new_pooled(hdr.length);
+			stream_put(client->ibuf_msg,
+				   STREAM_DATA(client->ibuf_work),
+				   ZEBRA_HEADER_SIZE);
+		}
+		already = stream_get_endp(client->ibuf_msg);
+
 		if (already < hdr.length) {
-			nb = stream_read_try(client->ibuf_work, sock,
+			nb = stream_read_try(client->ibuf_msg, sock,
 					     hdr.length - already);
 			if ((nb == 0 || nb == -1)) {
 				if (IS_ZEBRA_DEBUG_EVENT)
@@ -414,10 +454,8 @@ static void zserv_read(struct thread *thread)
 				   hdr.vrf_id, hdr.length,
 				   sock);
 
-		stream_set_getp(client->ibuf_work, 0);
-		struct stream *msg = stream_dup(client->ibuf_work);
-
-		stream_fifo_push(cache, msg);
+		stream_fifo_push(cache, client->ibuf_msg);
+		client->ibuf_msg = NULL;
 		stream_reset(client->ibuf_work);
 		p2p--;
 	}
@@ -529,6 +567,10 @@ static void zserv_process_messages(struct thread *thread)
 
 int zserv_send_message(struct zserv *client, struct stream *msg)
 {
+	frrtrace(3, frr_zebra, zserv_send, client->proto,
+		 stream_getw_from(msg, ZEBRA_HEADER_SIZE - 2),
+		 stream_get_endp(msg));
+
 	frr_with_mutex (&client->obuf_mtx) {
 		stream_fifo_push(client->obuf_fifo, msg);
 	}
@@ -611,6 +653,8 @@ static void zserv_client_free(struct zserv *client)
 	/* Free stream buffers. */
 	if (client->ibuf_work)
 		stream_free(client->ibuf_work);
+	if (client->ibuf_msg)
+		stream_free(client->ibuf_msg);
 	if (client->obuf_work)
 		stream_free(client->obuf_work);
 	if (client->ibuf_fifo)
@@ -644,7 +688,8 @@ static void zserv_client_free(struct zserv *client)
 		if (IS_ZEBRA_DEBUG_EVENT)
 			zlog_debug("%s: Deleting client %s", __func__,
 				   zebra_route_string(client->proto));
-		XFREE(MTYPE_TMP, client);
+		/* other pthreads may still have it from zserv_clients */
+		rcu_free(MTYPE_TMP, client, rcu_head);
 	} else {
 		/* Handle cases where client has GR instance. */
 		if (IS_ZEBRA_DEBUG_EVENT)
@@ -657,6 +702,47 @@ static void zserv_client_free(struct zserv *client)
 	}
 }
 
+/*
+ * Put the first client on zrouter.client_list with the same key as "key" in
+ * zserv_clients, in place of whatever is there now.  "skip" is left out.
+ */
+static void zserv_clients_rehash(const struct zserv *key,
+				 const struct zserv *skip)
+{
+	struct listnode *node;
+	struct zserv *client, *prev;
+
+	prev = zserv_clients_find(&zserv_clients, key);
+
+	for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client))
+		if (client != skip && !zserv_client_cmp(client, key))
+			break;
+
+	if (prev == client)
+		return;
+	if (prev)
+		zserv_clients_del(&zserv_clients, prev);
+	if (client)
+		zserv_clients_add(&zserv_clients, client);
+}
+
+void zserv_client_set_id(struct zserv *client, uint8_t proto,
+			 unsigned short instance, uint32_t session_id)
+{
+	if (client->proto == proto && client->instance == instance
+	    && client->session_id == session_id)
+		return;
+
+	if (zserv_clients_find(&zserv_clients, client) == client)
+		zserv_clients_rehash(client, client);
+
+	client->proto = proto;
+	client->instance = instance;
+	client->session_id = session_id;
+
+	zserv_clients_rehash(client, NULL);
+}
+
 void zserv_close_client(struct zserv *client)
 {
 	bool free_p = true;
@@ -684,6 +770,9 @@ void zserv_close_client(struct zserv *client)
 	 */
 	frr_with_mutex (&client_mutex) {
 		if (client->busy_count <= 0) {
+			/* lookups racing with this will see it closed */
+			client->is_closed = true;
+
 			/* remove from client list */
 			listnode_delete(zrouter.client_list, client);
 		} else {
@@ -698,8 +787,11 @@ void zserv_close_client(struct zserv *client)
 	}
 
 	/* delete client */
-	if (free_p)
+	if (free_p) {
+		if (zserv_clients_find(&zserv_clients, client) == client)
+			zserv_clients_rehash(client, client);
 		zserv_client_free(client);
+	}
 }
 
 /*
@@ -762,6 +854,8 @@ static struct zserv *zserv_client_create(int sock)
 	frr_with_mutex (&client_mutex) {
 		listnode_add(zrouter.client_list, client);
 	}
+	/* no-op if an older client has the same (all zero) key */
+	zserv_clients_add(&zserv_clients, client);
 
 	struct frr_pthread_attr zclient_pthr_attrs = {
 		.start = frr_pthread_attr_default.start,
@@ -793,11 +887,13 @@ static struct zserv *zserv_client_create(int sock)
 struct zserv *zserv_acquire_client(uint8_t proto, unsigned short instance,
 				   uint32_t session_id)
 {
-	struct zserv *client = NULL;
+	struct zserv *client;
 
-	frr_with_mutex (&client_mutex) {
-		client = find_client_internal(proto, instance, session_id);
-		if (client) {
+	/* the lock only orders busy_count against zserv_close_client() */
+	rcu_read_lock();
+	client = find_client_internal(proto, instance, session_id);
+	if (client) {
+		frr_with_mutex (&client_mutex) {
 			/* Don't return a dead/closed client object */
 			if (client->is_closed)
 				client = NULL;
@@ -805,6 +901,7 @@ struct zserv *zserv_acquire_client(uint8_t proto, unsigned short instance,
 				client->busy_count++;
 		}
 	}
+	rcu_read_unlock();
 
 	return client;
 }
@@ -1157,9 +1254,9 @@ static void zebra_show_stale_client_detail(struct vty *vty,
 				}
 			}
 			vty_out(vty, "Current AFI : %d\n", info->current_afi);
-			if (info->current_prefix)
-				vty_out(vty, "Current prefix : %pFX\n",
-					info->current_prefix);
+			if (info->current_re)
+				vty_out(vty, "Current prefix : %pRN\n",
+					info->current_re->rn);
 		}
 	}
 	vty_out(vty, "\n");
@@ -1200,23 +1297,20 @@ static void zebra_show_client_brief(struct vty *vty, struct zserv *client)
 }
 
 /*
- * Common logic that searches the client list for a zapi client; this
- * MUST be called holding the client list mutex.
+ * Common logic that looks up a zapi client; this MUST be called holding
+ * the RCU read lock, the result is only valid until it is released.
  */
 static struct zserv *find_client_internal(uint8_t proto,
 					  unsigned short instance,
 					  uint32_t session_id)
 {
-	struct listnode *node, *nnode;
-	struct zserv *client = NULL;
+	struct zserv ref;
 
-	for (ALL_LIST_ELEMENTS(zrouter.client_list, node, nnode, client)) {
-		if (client->proto == proto && client->instance == instance &&
-		    client->session_id == session_id)
-			break;
-	}
+	ref.proto = proto;
+	ref.instance = instance;
+	ref.session_id = session_id;
 
-	return client;
+	return zserv_clients_find(&zserv_clients, &ref);
 }
 
 /*
@@ -1227,9 +1321,9 @@ struct zserv *zserv_find_client(uint8_t proto, unsigned short instance)
 {
 	struct zserv *client;
 
-	frr_with_mutex (&client_mutex) {
-		client = find_client_internal(proto, instance, 0);
-	}
+	rcu_read_lock();
+	client = find_client_internal(proto, instance, 0);
+	rcu_read_unlock();
 
 	return client;
 }
@@ -1242,9 +1336,9 @@ struct zserv *zserv_find_client_session(uint8_t proto, unsigned short instance,
 {
 	struct zserv *client;
 
-	frr_with_mutex (&client_mutex) {
-		client = find_client_internal(proto, instance, session_id);
-	}
+	rcu_read_lock();
+	client = find_client_internal(proto, instance, session_id);
+	rcu_read_unlock();
 
 	return client;
 
@@ -1318,6 +1412,7 @@ void zserv_init(void)
 	/* Misc init. */
 	zsock = -1;
 	pthread_mutex_init(&client_mutex, NULL);
+	zserv_clients_init(&zserv_clients);
 
 	install_element(ENABLE_NODE, &show_zebra_client_cmd);
 	install_element(ENABLE_NODE, &show_zebra_client_summary_cmd);
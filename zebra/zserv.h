@@ -36,6 +36,8 @@
 #include "lib/linklist.h"     /* for list */
 #include "lib/workqueue.h"    /* for work_queue */
 #include "lib/hook.h"         /* for DECLARE_HOOK, DECLARE_KOOH */
+#include "lib/atomlist.h"     /* for PREDECL_RCUHASH */
+#include "lib/frrcu.h"        /* for rcu_head */
 /* clang-format on */
 
 #ifdef __cplusplus
@@ -43,6 +45,7 @@ extern "C" {
 #endif
 
 struct zebra_vrf;
+struct route_entry;
 
 /* Default port information. */
 #define ZEBRA_VTY_PORT                2601
@@ -80,14 +83,16 @@ struct client_gr_info {
 	bool af_enabled[AFI_MAX][SAFI_MAX];
 	bool route_sync[AFI_MAX][SAFI_MAX];
 
-	/* Book keeping */
-	struct prefix *current_prefix;
+	/* Book keeping, the stale sweep resumes at current_re */
+	struct route_entry *current_re;
 	void *stale_client_ptr;
 	struct thread *t_stale_removal;
 
 	TAILQ_ENTRY(client_gr_info) gr_info;
 };
 
+PREDECL_RCUHASH(zserv_clients);
+
 /* Client structure. */
 struct zserv {
 	/* Client pthread */
@@ -104,6 +109,12 @@ struct zserv {
 	int busy_count;
 	bool is_closed;
 
+	/* Lookup by {proto, instance, session_id}; lockless for readers,
+	 * the object is freed through RCU.
+	 */
+	struct zserv_clients_item hitem;
+	struct rcu_head rcu_head;
+
 	/* Input/output buffer to the client. */
 	pthread_mutex_t ibuf_mtx;
 	struct stream_fifo *ibuf_fifo;
@@ -113,6 +124,8 @@ struct zserv {
 	/* Private I/O buffers */
 	struct stream *ibuf_work;
 	struct stream *obuf_work;
+	/* Message being read, after its header in ibuf_work. */
+	struct stream *ibuf_msg;
 
 	/* Buffer of data waiting to be written to client. */
 	struct buffer *wb;
@@ -331,6 +344,14 @@ extern struct zserv *zserv_find_client(uint8_t proto, unsigned short instance);
 struct zserv *zserv_find_client_session(uint8_t proto, unsigned short instance,
 					uint32_t session_id);
 
+/*
+ * Set a client's protocol, instance, and session id, as reported by the
+ * client itself.  This must be used instead of writing the fields directly
+ * so the client can still be found.  Main pthread only.
+ */
+extern void zserv_client_set_id(struct zserv *client, uint8_t proto,
+				unsigned short instance, uint32_t session_id);
+
 /*
  * Retrieve a client object by the complete tuple of
  * {protocol, instance, session}. This version supports use
@@ -387,6 +408,7 @@ __attribute__((__noreturn__)) void zebra_finalize(struct thread *event);
 extern int zebra_gr_client_disconnect(struct zserv *client);
 extern void zebra_gr_client_reconnect(struct zserv *client);
 extern void zebra_gr_stale_client_cleanup(struct list *client_list);
+extern void zebra_gr_route_unlink(struct route_entry *re);
 extern void zread_client_capabilities(struct zserv *client, struct zmsghdr *hdr,
 				      struct stream *msg,
 				      struct zebra_vrf *zvrf);